@@ -0,0 +1,106 @@
+dnl ===================================================================
+dnl   Licensed to the Apache Software Foundation (ASF) under one
+dnl   or more contributor license agreements.  See the NOTICE file
+dnl   distributed with this work for additional information
+dnl   regarding copyright ownership.  The ASF licenses this file
+dnl   to you under the Apache License, Version 2.0 (the
+dnl   "License"); you may not use this file except in compliance
+dnl   with the License.  You may obtain a copy of the License at
+dnl
+dnl     http://www.apache.org/licenses/LICENSE-2.0
+dnl
+dnl   Unless required by applicable law or agreed to in writing,
+dnl   software distributed under the License is distributed on an
+dnl   "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+dnl   KIND, either express or implied.  See the License for the
+dnl   specific language governing permissions and limitations
+dnl   under the License.
+dnl ===================================================================
+dnl
+dnl  SVN_LZ4
+dnl
+dnl  Check configure options and assign variables related to
+dnl  the LZ4 library.  Unlike zlib, LZ4 is optional; without it,
+dnl  svndiff version 2 will not be available.
+dnl
+
+AC_DEFUN(SVN_LZ4,
+[
+  lz4_found=no
+  lz4_skip=no
+
+  AC_ARG_WITH(lz4,AS_HELP_STRING([--with-lz4=PREFIX],
+                                 [LZ4 compression library]),
+  [
+    if test "$withval" = "yes"; then
+      lz4_skip=no
+    elif test "$withval" = "no"; then
+      lz4_skip=yes
+    else
+      lz4_skip=no
+      lz4_prefix="$withval"
+    fi
+  ])
+
+  if test "$lz4_skip" = "yes"; then
+    AC_MSG_NOTICE([LZ4 support disabled])
+  elif test -n "$lz4_prefix"; then
+    AC_MSG_NOTICE([LZ4 library configuration via prefix])
+    save_cppflags="$CPPFLAGS"
+    CPPFLAGS="$CPPFLAGS -I$lz4_prefix/include"
+    AC_CHECK_HEADERS(lz4.h,[
+      save_ldflags="$LDFLAGS"
+      LDFLAGS="$LDFLAGS -L$lz4_prefix/lib"
+      AC_CHECK_LIB(lz4, LZ4_compress_default, [
+        lz4_found="yes"
+        SVN_LZ4_INCLUDES="-I$lz4_prefix/include"
+        SVN_LZ4_LIBS="`SVN_REMOVE_STANDARD_LIB_DIRS(-L$lz4_prefix/lib)` -llz4"
+      ])
+      LDFLAGS="$save_ldflags"
+    ])
+    CPPFLAGS="$save_cppflags"
+
+    if test "$lz4_found" = "no"; then
+      AC_MSG_ERROR([[--with-lz4 requested, but LZ4 not found at $lz4_prefix]])
+    fi
+  else
+    SVN_LZ4_PKG_CONFIG()
+
+    if test "$lz4_found" = "no"; then
+      AC_MSG_NOTICE([LZ4 library configuration])
+      AC_CHECK_HEADER(lz4.h, [
+        AC_CHECK_LIB(lz4, LZ4_compress_default, [
+          lz4_found="builtin"
+          SVN_LZ4_LIBS="-llz4"
+        ])
+      ])
+    fi
+  fi
+
+  if test "$lz4_found" != "no"; then
+    AC_DEFINE([SVN_HAVE_LZ4], [1],
+              [Defined if LZ4 compression support is enabled])
+  fi
+
+  AC_SUBST(SVN_LZ4_INCLUDES)
+  AC_SUBST(SVN_LZ4_LIBS)
+])
+
+dnl SVN_LZ4_PKG_CONFIG()
+dnl Use pkg-config to try and detect and configure LZ4
+AC_DEFUN(SVN_LZ4_PKG_CONFIG,
+[
+  AC_MSG_NOTICE([LZ4 library configuration via pkg-config])
+  if test -n "$PKG_CONFIG"; then
+    AC_MSG_CHECKING([for LZ4 library])
+    if $PKG_CONFIG liblz4 --atleast-version=1.7.0; then
+      AC_MSG_RESULT([yes])
+      lz4_found=yes
+      SVN_LZ4_INCLUDES=`$PKG_CONFIG liblz4 --cflags`
+      SVN_LZ4_LIBS=`$PKG_CONFIG liblz4 --libs`
+      SVN_LZ4_LIBS="`SVN_REMOVE_STANDARD_LIB_DIRS($SVN_LZ4_LIBS)`"
+    else
+      AC_MSG_RESULT([no])
+    fi
+  fi
+])
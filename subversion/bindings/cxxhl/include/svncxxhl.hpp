@@ -30,6 +30,7 @@
 
 // Expose the whole API and alias the default version namespace
 #include "svncxxhl/exception.hpp"
+#include "svncxxhl/stream.hpp"
 #include "svncxxhl/tristate.hpp"
 
 namespace SVN = ::apache::subversion::cxxhl;
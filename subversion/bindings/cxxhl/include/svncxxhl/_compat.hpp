@@ -141,4 +141,23 @@ typedef noncopyable_::noncopyable noncopyable;
 
 #endif // SVN_CXXHL_USING_BOOST
 
+// Configuration test: rvalue references and std::move
+// Currently detects: clang++, g++, msvc-2010+
+#ifndef SVN_CXXHL_HAVE_RVALUE_REFERENCES
+#  if   (defined(__clang__) && __cplusplus >= 201103L) \
+     || (defined(__GNUC__) && defined(__GXX_EXPERIMENTAL_CXX0X__)) \
+     || (defined(_MSC_VER) && _MSC_VER >= 1600)
+#    define SVN_CXXHL_HAVE_RVALUE_REFERENCES
+#  endif  // config test: rvalue references
+#endif  // SVN_CXXHL_HAVE_RVALUE_REFERENCES
+
+// Configuration test: std::string_view
+// Currently detects: any C++17 compiler, msvc-2017+ in C++17 mode
+#ifndef SVN_CXXHL_HAVE_STD_STRING_VIEW
+#  if   (__cplusplus >= 201703L) \
+     || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#    define SVN_CXXHL_HAVE_STD_STRING_VIEW
+#  endif  // config test: std::string_view
+#endif  // SVN_CXXHL_HAVE_STD_STRING_VIEW
+
 #endif  // SVN_CXXHL_COMPAT_HPP
@@ -0,0 +1,139 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ */
+
+#ifndef __cplusplus
+#error "This is a C++ header file."
+#endif
+
+#ifndef SVN_CXXHL_STREAM_HPP
+#define SVN_CXXHL_STREAM_HPP
+
+#include <cstddef>
+#include <string>
+
+#include "svncxxhl/_compat.hpp"
+
+#ifdef SVN_CXXHL_HAVE_STD_STRING_VIEW
+#include <string_view>
+#endif
+
+namespace apache {
+namespace subversion {
+namespace cxxhl {
+
+namespace detail {
+// Forward declaration of implementation-specific structure
+class StreamImpl;
+} // namespace detail
+
+/**
+ * Encapsulates a Subversion generic stream.
+ *
+ * Stream objects are handles: copies refer to the same underlying
+ * stream, which will be closed when the last handle goes away.  If
+ * the compiler supports rvalue references, handles can also be moved,
+ * which leaves the source without a stream.
+ *
+ * Reading and writing work directly on the caller's buffers and do
+ * not allocate memory.
+ */
+class Stream
+{
+public:
+  /**
+   * Open the file at @a path for reading.
+   */
+  static Stream open_readonly(const char* path);
+
+  /**
+   * Create the file at @a path, or truncate it if it exists, and open
+   * it for writing.
+   */
+  static Stream open_writable(const char* path);
+
+  /**
+   * Return a stream that reads nothing and ignores all data written.
+   */
+  static Stream empty();
+
+  Stream(const Stream& that) throw();
+  Stream& operator=(const Stream& that) throw();
+  ~Stream() throw();
+
+#ifdef SVN_CXXHL_HAVE_RVALUE_REFERENCES
+  Stream(Stream&& that) throw();
+  Stream& operator=(Stream&& that) throw();
+#endif
+
+  /**
+   * Read up to @a length bytes into @a buffer.
+   * @return the number of bytes read, which will be less than
+   *         @a length only at the end of the stream.
+   */
+  std::size_t read(char* buffer, std::size_t length);
+
+  /**
+   * Write @a length bytes from @a data.
+   */
+  void write(const char* data, std::size_t length);
+
+#ifdef SVN_CXXHL_HAVE_STD_STRING_VIEW
+  /**
+   * Write the contents of @a data.
+   */
+  void write(std::string_view data)
+    {
+      write(data.data(), data.size());
+    }
+#else
+  /**
+   * Write the contents of @a data.
+   */
+  void write(const std::string& data)
+    {
+      write(data.data(), data.size());
+    }
+#endif
+
+  /**
+   * Close the stream and report any errors that occur while doing
+   * so.  Other handles to the same stream become unusable.  Closing
+   * a closed stream is a no-op.
+   */
+  void close();
+
+private:
+  typedef compat::shared_ptr<detail::StreamImpl> impl_ptr;
+  explicit Stream(impl_ptr impl) throw()
+    : m_impl(impl)
+    {}
+
+  detail::StreamImpl& impl() const;
+  impl_ptr m_impl;
+};
+
+} // namespace cxxhl
+} // namespace subversion
+} // namespace apache
+
+#endif  // SVN_CXXHL_STREAM_HPP
@@ -0,0 +1,154 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ */
+
+#include "svncxxhl/stream.hpp"
+
+#include "aprwrap.hpp"
+#include "private.hpp"
+
+#include "svn_io.h"
+#undef TRUE
+#undef FALSE
+
+namespace apache {
+namespace subversion {
+namespace cxxhl {
+
+namespace detail {
+
+/**
+ * The stream shared by all handles.  The stream lives in its own pool
+ * so that it is released as soon as the last handle goes away.
+ */
+class StreamImpl : compat::noncopyable
+{
+public:
+  StreamImpl()
+    : m_stream(NULL)
+    {}
+
+  ~StreamImpl() throw()
+    {
+      // Errors cannot be reported from here; use Stream::close()
+      // if they matter.
+      if (m_stream)
+        svn_error_clear(svn_stream_close(m_stream));
+    }
+
+  APR::Pool m_pool;
+  svn_stream_t* m_stream;
+};
+
+} // namespace detail
+
+Stream Stream::open_readonly(const char* path)
+{
+  impl_ptr impl(new detail::StreamImpl);
+  apr_pool_t* const pool = impl->m_pool.get();
+  detail::checked_call(svn_stream_open_readonly(&impl->m_stream, path,
+                                                pool, pool));
+  return Stream(impl);
+}
+
+Stream Stream::open_writable(const char* path)
+{
+  impl_ptr impl(new detail::StreamImpl);
+  apr_pool_t* const pool = impl->m_pool.get();
+  apr_file_t* file;
+  detail::checked_call(svn_io_file_open(&file, path,
+                                        (APR_WRITE | APR_CREATE
+                                         | APR_TRUNCATE | APR_BUFFERED),
+                                        APR_OS_DEFAULT, pool));
+  impl->m_stream = svn_stream_from_aprfile2(file, false, pool);
+  return Stream(impl);
+}
+
+Stream Stream::empty()
+{
+  impl_ptr impl(new detail::StreamImpl);
+  impl->m_stream = svn_stream_empty(impl->m_pool.get());
+  return Stream(impl);
+}
+
+Stream::Stream(const Stream& that) throw()
+  : m_impl(that.m_impl)
+{}
+
+Stream& Stream::operator=(const Stream& that) throw()
+{
+  m_impl = that.m_impl;
+  return *this;
+}
+
+Stream::~Stream() throw() {}
+
+#ifdef SVN_CXXHL_HAVE_RVALUE_REFERENCES
+Stream::Stream(Stream&& that) throw()
+{
+  m_impl.swap(that.m_impl);
+}
+
+Stream& Stream::operator=(Stream&& that) throw()
+{
+  if (this != &that)
+    {
+      m_impl.swap(that.m_impl);
+      that.m_impl.reset();
+    }
+  return *this;
+}
+#endif // SVN_CXXHL_HAVE_RVALUE_REFERENCES
+
+detail::StreamImpl& Stream::impl() const
+{
+  if (!m_impl || !m_impl->m_stream)
+    throw InternalError("Stream is closed or has been moved from");
+  return *m_impl;
+}
+
+std::size_t Stream::read(char* buffer, std::size_t length)
+{
+  apr_size_t len = length;
+  detail::checked_call(svn_stream_read_full(impl().m_stream, buffer, &len));
+  return len;
+}
+
+void Stream::write(const char* data, std::size_t length)
+{
+  apr_size_t len = length;
+  detail::checked_call(svn_stream_write(impl().m_stream, data, &len));
+}
+
+void Stream::close()
+{
+  if (!m_impl || !m_impl->m_stream)
+    return;
+
+  svn_stream_t* const stream = m_impl->m_stream;
+  m_impl->m_stream = NULL;
+  detail::checked_call(svn_stream_close(stream));
+}
+
+} // namespace cxxhl
+} // namespace subversion
+} // namespace apache
@@ -0,0 +1,97 @@
+/*
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <algorithm>
+
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "svncxxhl.hpp"
+#include "../src/aprwrap.hpp"
+#include "../src/private.hpp"
+
+#include "svn_io.h"
+#undef TRUE
+#undef FALSE
+
+#include <gtest/gtest.h>
+
+namespace {
+const char* make_temp_file(APR::Pool& pool)
+{
+  const char* path;
+  SVN::detail::checked_call(
+      svn_io_open_unique_file3(NULL, &path, NULL,
+                               svn_io_file_del_on_pool_cleanup,
+                               pool.get(), pool.get()));
+  return path;
+}
+} // anonymous namespace
+
+TEST(Streams, WriteAndRead)
+{
+  APR::Pool pool;
+  const char* const path = make_temp_file(pool);
+  const std::string text("Hello, stream!");
+
+  SVN::Stream out = SVN::Stream::open_writable(path);
+  out.write(text);
+  out.write("\n", 1);
+  out.close();
+
+  char buffer[64];
+  SVN::Stream in = SVN::Stream::open_readonly(path);
+  const std::size_t len = in.read(buffer, sizeof(buffer));
+  EXPECT_EQ(text.size() + 1, len);
+  EXPECT_EQ(text + "\n", std::string(buffer, len));
+  EXPECT_EQ(0, in.read(buffer, sizeof(buffer)));
+}
+
+TEST(Streams, Closed)
+{
+  SVN::Stream stream = SVN::Stream::empty();
+  SVN::Stream copy(stream);
+  stream.close();
+  EXPECT_NO_THROW(stream.close());
+  EXPECT_THROW(copy.write("x", 1), SVN::InternalError);
+}
+
+TEST(Streams, OpenMissing)
+{
+  EXPECT_THROW(SVN::Stream::open_readonly("/this/file/does/not/exist"),
+               SVN::Error);
+}
+
+#ifdef SVN_CXXHL_HAVE_RVALUE_REFERENCES
+TEST(Streams, Move)
+{
+  char buffer[1];
+  SVN::Stream stream = SVN::Stream::empty();
+  SVN::Stream moved(std::move(stream));
+  EXPECT_EQ(0, moved.read(buffer, sizeof(buffer)));
+  EXPECT_THROW(stream.read(buffer, sizeof(buffer)), SVN::InternalError);
+
+  stream = std::move(moved);
+  EXPECT_EQ(0, stream.read(buffer, sizeof(buffer)));
+  EXPECT_THROW(moved.read(buffer, sizeof(buffer)), SVN::InternalError);
+}
+#endif // SVN_CXXHL_HAVE_RVALUE_REFERENCES
@@ -39,6 +39,7 @@
 LogMessageCallback::LogMessageCallback(jobject jcallback)
 {
   m_callback = jcallback;
+  m_batchSize = -1;
 }
 
 /**
@@ -48,7 +49,30 @@ LogMessageCallback::~LogMessageCallback()
 {
   // The m_callback does not need to be destroyed because it is the
   // passed in parameter to the Java SVNClientInterface.logMessages
-  // method.
+  // method.  Messages may still be queued if the operation failed.
+  clearQueue();
+}
+
+/**
+ * Release the global references of all queued messages.
+ */
+void
+LogMessageCallback::clearQueue()
+{
+  JNIEnv *env = JNIUtil::getEnv();
+
+  for (std::vector<jobject>::size_type i = 0; i < m_revisions.size(); ++i)
+    {
+      if (m_changedPaths[i])
+        env->DeleteGlobalRef(m_changedPaths[i]);
+      if (m_revprops[i])
+        env->DeleteGlobalRef(m_revprops[i]);
+    }
+
+  m_changedPaths.clear();
+  m_revisions.clear();
+  m_revprops.clear();
+  m_hasChildren.clear();
 }
 
 svn_error_t *
@@ -92,6 +116,29 @@ LogMessageCallback::singleMessage(svn_log_entry_t *log_entry, apr_pool_t *pool)
         POP_AND_RETURN(SVN_NO_ERROR);
     }
 
+  // Check once whether the callback wants the messages in batches.
+  if (m_batchSize < 0)
+    {
+      jclass clazz =
+        env->FindClass(JAVAHL_CLASS("/callback/LogMessageBatchCallback"));
+      if (JNIUtil::isJavaExceptionThrown())
+        POP_AND_RETURN(SVN_NO_ERROR);
+
+      m_batchSize = 0;
+      if (env->IsInstanceOf(m_callback, clazz))
+        {
+          jmethodID mid = env->GetMethodID(clazz, "getBatchSize", "()I");
+          if (JNIUtil::isJavaExceptionThrown())
+            POP_AND_RETURN(SVN_NO_ERROR);
+
+          jint batchSize = env->CallIntMethod(m_callback, mid);
+          if (JNIUtil::isJavaExceptionThrown())
+            POP_AND_RETURN_EXCEPTION_AS_SVNERROR();
+
+          m_batchSize = batchSize < 1 ? 1 : batchSize;
+        }
+    }
+
   jobject jChangedPaths = NULL;
   if (log_entry->changed_paths)
     {
@@ -119,6 +166,20 @@ LogMessageCallback::singleMessage(svn_log_entry_t *log_entry, apr_pool_t *pool)
   if (log_entry->revprops != NULL && apr_hash_count(log_entry->revprops) > 0)
     jrevprops = CreateJ::PropertyMap(log_entry->revprops, pool);
 
+  if (m_batchSize > 0)
+    {
+      m_changedPaths.push_back(env->NewGlobalRef(jChangedPaths));
+      m_revisions.push_back((jlong)log_entry->revision);
+      m_revprops.push_back(env->NewGlobalRef(jrevprops));
+      m_hasChildren.push_back((jboolean)log_entry->has_children);
+
+      env->PopLocalFrame(NULL);
+      if (m_revisions.size() >= static_cast<std::size_t>(m_batchSize))
+        return flush();
+
+      return SVN_NO_ERROR;
+    }
+
   env->CallVoidMethod(m_callback,
                       sm_mid,
                       jChangedPaths,
@@ -128,3 +189,88 @@ LogMessageCallback::singleMessage(svn_log_entry_t *log_entry, apr_pool_t *pool)
 
   POP_AND_RETURN_EXCEPTION_AS_SVNERROR();
 }
+
+/**
+ * Pass the queued messages to the batch callback.
+ */
+svn_error_t *
+LogMessageCallback::flush()
+{
+  if (m_revisions.empty())
+    return SVN_NO_ERROR;
+
+  JNIEnv *env = JNIUtil::getEnv();
+  jsize count = static_cast<jsize>(m_revisions.size());
+
+  // Create a local frame for our references
+  env->PushLocalFrame(LOCAL_FRAME_SIZE);
+  if (JNIUtil::isJavaExceptionThrown())
+    {
+      clearQueue();
+      return SVN_NO_ERROR;
+    }
+
+  // The method id will not change during the time this library is
+  // loaded, so it can be cached.
+  static jmethodID sm_mid = 0;
+  if (sm_mid == 0)
+    {
+      jclass clazz =
+        env->FindClass(JAVAHL_CLASS("/callback/LogMessageBatchCallback"));
+      if (JNIUtil::isJavaExceptionThrown())
+        {
+          clearQueue();
+          POP_AND_RETURN(SVN_NO_ERROR);
+        }
+
+      sm_mid = env->GetMethodID(clazz, "messages",
+                                "([Ljava/util/Set;[J[Ljava/util/Map;[Z)V");
+      if (JNIUtil::isJavaExceptionThrown())
+        {
+          clearQueue();
+          POP_AND_RETURN(SVN_NO_ERROR);
+        }
+    }
+
+  jclass setClass = env->FindClass("java/util/Set");
+  if (JNIUtil::isJavaExceptionThrown())
+    {
+      clearQueue();
+      POP_AND_RETURN(SVN_NO_ERROR);
+    }
+
+  jclass mapClass = env->FindClass("java/util/Map");
+  if (JNIUtil::isJavaExceptionThrown())
+    {
+      clearQueue();
+      POP_AND_RETURN(SVN_NO_ERROR);
+    }
+
+  jobjectArray jChangedPaths = env->NewObjectArray(count, setClass, NULL);
+  jobjectArray jrevprops = env->NewObjectArray(count, mapClass, NULL);
+  jlongArray jrevisions = env->NewLongArray(count);
+  jbooleanArray jhasChildren = env->NewBooleanArray(count);
+  if (JNIUtil::isJavaExceptionThrown())
+    {
+      clearQueue();
+      POP_AND_RETURN(SVN_NO_ERROR);
+    }
+
+  for (jsize i = 0; i < count; ++i)
+    {
+      env->SetObjectArrayElement(jChangedPaths, i, m_changedPaths[i]);
+      env->SetObjectArrayElement(jrevprops, i, m_revprops[i]);
+    }
+  env->SetLongArrayRegion(jrevisions, 0, count, &m_revisions[0]);
+  env->SetBooleanArrayRegion(jhasChildren, 0, count, &m_hasChildren[0]);
+
+  // The arrays hold their own references now.
+  clearQueue();
+  if (JNIUtil::isJavaExceptionThrown())
+    POP_AND_RETURN(SVN_NO_ERROR);
+
+  env->CallVoidMethod(m_callback, sm_mid, jChangedPaths, jrevisions,
+                      jrevprops, jhasChildren);
+
+  POP_AND_RETURN_EXCEPTION_AS_SVNERROR();
+}
@@ -28,11 +28,14 @@
 #define LOGMESSAGECALLBACK_H
 
 #include <jni.h>
+#include <vector>
 #include "svn_client.h"
 
 /**
  * This class holds a Java callback object, which will receive every
  * log message for which the callback information is requested.
+ * If the Java object implements LogMessageBatchCallback, the messages
+ * get queued and are passed to Java in batches.
  */
 class LogMessageCallback
 {
@@ -43,6 +46,12 @@ class LogMessageCallback
   static svn_error_t *callback(void *baton,
                                svn_log_entry_t *log_entry,
                                apr_pool_t *pool);
+
+  /**
+   * Pass the log messages still queued for a batch callback to Java.
+   * Call this after the log operation has completed successfully.
+   */
+  svn_error_t *flush();
  protected:
   svn_error_t *singleMessage(svn_log_entry_t *log_entry, apr_pool_t *pool);
 
@@ -51,6 +60,23 @@ class LogMessageCallback
    * This a local reference to the Java object.
    */
   jobject m_callback;
+
+  /**
+   * The maximum number of messages per batch, 0 if the Java object
+   * is not a batch callback and -1 if that has not been checked, yet.
+   */
+  jint m_batchSize;
+
+  /**
+   * The messages queued for the next batch.  The Java objects are
+   * global references.
+   */
+  std::vector<jobject> m_changedPaths;
+  std::vector<jlong> m_revisions;
+  std::vector<jobject> m_revprops;
+  std::vector<jboolean> m_hasChildren;
+
+  void clearQueue();
 };
 
 #endif  // LOGMESSAGECALLBACK_H
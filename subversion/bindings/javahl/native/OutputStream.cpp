@@ -35,6 +35,7 @@
 OutputStream::OutputStream(jobject jthis)
 {
   m_jthis = jthis;
+  m_isChannel = -1;
 }
 
 /**
@@ -94,6 +95,21 @@ svn_error_t *OutputStream::write(void *baton, const char *buffer,
       env->DeleteLocalRef(clazz);
     }
 
+  // Streams that also implement WritableByteChannel get the data
+  // without copying it into a Java byte array.
+  if (that->m_isChannel < 0)
+    {
+      jclass clazz = env->FindClass("java/nio/channels/WritableByteChannel");
+      if (JNIUtil::isJavaExceptionThrown())
+        return SVN_NO_ERROR;
+
+      that->m_isChannel = env->IsInstanceOf(that->m_jthis, clazz) ? 1 : 0;
+      env->DeleteLocalRef(clazz);
+    }
+
+  if (that->m_isChannel && writeToChannel(that, buffer, *len))
+    return SVN_NO_ERROR;
+
   // convert the data to a Java byte array
   jbyteArray data = JNIUtil::makeJByteArray(buffer, static_cast<int>(*len));
   if (JNIUtil::isJavaExceptionThrown())
@@ -109,6 +125,73 @@ svn_error_t *OutputStream::write(void *baton, const char *buffer,
   return SVN_NO_ERROR;
 }
 
+/**
+ * Write LEN bytes from BUFFER to THAT, which must be a channel, by
+ * wrapping BUFFER in a direct ByteBuffer.
+ * @return false if the JVM does not support direct buffers and the
+ *         data needs to be written as a byte array instead
+ */
+bool OutputStream::writeToChannel(OutputStream *that, const char *buffer,
+                                  apr_size_t len)
+{
+  JNIEnv *env = JNIUtil::getEnv();
+
+  // The method ids will not change during the time this library is
+  // loaded, so they can be cached.
+  static jmethodID write_mid = 0;
+  static jmethodID remaining_mid = 0;
+  if (write_mid == 0)
+    {
+      jclass clazz = env->FindClass("java/nio/channels/WritableByteChannel");
+      if (JNIUtil::isJavaExceptionThrown())
+        return true;
+
+      write_mid = env->GetMethodID(clazz, "write", "(Ljava/nio/ByteBuffer;)I");
+      if (JNIUtil::isJavaExceptionThrown() || write_mid == 0)
+        return true;
+
+      env->DeleteLocalRef(clazz);
+
+      clazz = env->FindClass("java/nio/Buffer");
+      if (JNIUtil::isJavaExceptionThrown())
+        return true;
+
+      remaining_mid = env->GetMethodID(clazz, "remaining", "()I");
+      if (JNIUtil::isJavaExceptionThrown() || remaining_mid == 0)
+        return true;
+
+      env->DeleteLocalRef(clazz);
+    }
+
+  // The buffer is only valid during this call.  Channels must not keep
+  // a reference to it.
+  jobject data = env->NewDirectByteBuffer(const_cast<char *>(buffer),
+                                          static_cast<jlong>(len));
+  if (JNIUtil::isJavaExceptionThrown())
+    return true;
+
+  if (data == NULL)
+    {
+      that->m_isChannel = 0;
+      return false;
+    }
+
+  // Channels may write only part of the data per call.
+  while (env->CallIntMethod(data, remaining_mid) > 0)
+    {
+      if (JNIUtil::isJavaExceptionThrown())
+        return true;
+
+      env->CallIntMethod(that->m_jthis, write_mid, data);
+      if (JNIUtil::isJavaExceptionThrown())
+        return true;
+    }
+
+  env->DeleteLocalRef(data);
+
+  return true;
+}
+
 /**
  * Implements svn_close_fn_t to close the output stream.
  * @param baton     an OutputStream object for the callback
@@ -41,8 +41,15 @@ class OutputStream
    * A local reference to the Java object.
    */
   jobject m_jthis;
+  /**
+   * Whether m_jthis also implements WritableByteChannel.  -1 if that
+   * has not been checked, yet.
+   */
+  int m_isChannel;
   static svn_error_t *write(void *baton,
                             const char *buffer, apr_size_t *len);
+  static bool writeToChannel(OutputStream *that,
+                             const char *buffer, apr_size_t len);
   static svn_error_t *close(void *baton);
  public:
   OutputStream(jobject jthis);
@@ -59,6 +59,7 @@ class RemoteSession : public SVNBase
     virtual ~RemoteSession();
 
     void cancelOperation() const { m_context->cancelOperation(); }
+    void resetCancelRequest() const { m_context->resetCancelRequest(); }
 
     virtual void dispose(jobject jthis);
 
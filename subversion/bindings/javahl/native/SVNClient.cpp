@@ -225,6 +225,7 @@ SVNClient::status(const char *path, svn_depth_t depth,
                                    changelists.array(subPool),
                                    StatusCallback::callback, callback,
                                    subPool.getPool()), );
+    SVN_JNI_ERR(callback->flush(), );
 }
 
 /* Convert a vector of revision ranges to an APR array of same. */
@@ -297,6 +298,7 @@ void SVNClient::logMessages(const char *path, Revision &pegRevision,
                                 includeMergedRevisions, revprops,
                                 LogMessageCallback::callback, callback, ctx,
                                 subPool.getPool()), );
+    SVN_JNI_ERR(callback->flush(), );
 }
 
 jlong SVNClient::checkout(const char *moduleName, const char *destPath,
@@ -881,6 +883,7 @@ void SVNClient::getMergeinfoLog(int type, const char *pathOrURL,
                                           revProps.array(subPool),
                                           ctx,
                                           subPool.getPool()), );
+    SVN_JNI_ERR(callback->flush(), );
 
     return;
 }
@@ -37,6 +37,7 @@
 StatusCallback::StatusCallback(jobject jcallback)
 {
   m_callback = jcallback;
+  m_batchSize = -1;
 }
 
 /**
@@ -45,7 +46,28 @@ StatusCallback::StatusCallback(jobject jcallback)
 StatusCallback::~StatusCallback()
 {
   // the m_callback does not need to be destroyed, because it is the passed
-  // in parameter to the Java SVNClient.status method.
+  // in parameter to the Java SVNClient.status method.  Items may still
+  // be queued if the operation failed.
+  clearQueue();
+}
+
+/**
+ * Release the global references of all queued items.
+ */
+void
+StatusCallback::clearQueue()
+{
+  JNIEnv *env = JNIUtil::getEnv();
+
+  for (std::vector<jobject>::size_type i = 0; i < m_paths.size(); ++i)
+    {
+      env->DeleteGlobalRef(m_paths[i]);
+      if (m_statuses[i])
+        env->DeleteGlobalRef(m_statuses[i]);
+    }
+
+  m_paths.clear();
+  m_statuses.clear();
 }
 
 svn_error_t *
@@ -92,6 +114,30 @@ StatusCallback::doStatus(const char *local_abspath,
         POP_AND_RETURN(SVN_NO_ERROR);
     }
 
+  // Check once whether the callback wants the items in batches.
+  if (m_batchSize < 0)
+    {
+      jclass clazz =
+        env->FindClass(JAVAHL_CLASS("/callback/StatusBatchCallback"));
+      if (JNIUtil::isJavaExceptionThrown())
+        POP_AND_RETURN(SVN_NO_ERROR);
+
+      m_batchSize = 0;
+      if (env->IsInstanceOf(m_callback, clazz))
+        {
+          jmethodID batchSizeMid =
+            env->GetMethodID(clazz, "getBatchSize", "()I");
+          if (JNIUtil::isJavaExceptionThrown())
+            POP_AND_RETURN(SVN_NO_ERROR);
+
+          jint batchSize = env->CallIntMethod(m_callback, batchSizeMid);
+          if (JNIUtil::isJavaExceptionThrown())
+            POP_AND_RETURN_EXCEPTION_AS_SVNERROR();
+
+          m_batchSize = batchSize < 1 ? 1 : batchSize;
+        }
+    }
+
   jstring jPath = JNIUtil::makeJString(local_abspath);
   if (JNIUtil::isJavaExceptionThrown())
     POP_AND_RETURN(SVN_NO_ERROR);
@@ -100,11 +146,104 @@ StatusCallback::doStatus(const char *local_abspath,
   if (JNIUtil::isJavaExceptionThrown())
     POP_AND_RETURN(SVN_NO_ERROR);
 
+  if (m_batchSize > 0)
+    {
+      m_paths.push_back(env->NewGlobalRef(jPath));
+      m_statuses.push_back(env->NewGlobalRef(jStatus));
+
+      env->PopLocalFrame(NULL);
+      if (m_paths.size() >= static_cast<std::size_t>(m_batchSize))
+        return flush();
+
+      return SVN_NO_ERROR;
+    }
+
   env->CallVoidMethod(m_callback, mid, jPath, jStatus);
 
   POP_AND_RETURN_EXCEPTION_AS_SVNERROR();
 }
 
+/**
+ * Pass the queued items to the batch callback.
+ */
+svn_error_t *
+StatusCallback::flush()
+{
+  if (m_paths.empty())
+    return SVN_NO_ERROR;
+
+  JNIEnv *env = JNIUtil::getEnv();
+  jsize count = static_cast<jsize>(m_paths.size());
+
+  // Create a local frame for our references
+  env->PushLocalFrame(LOCAL_FRAME_SIZE);
+  if (JNIUtil::isJavaExceptionThrown())
+    {
+      clearQueue();
+      return SVN_NO_ERROR;
+    }
+
+  static jmethodID mid = 0; // the method id will not change during
+  // the time this library is loaded, so
+  // it can be cached.
+  if (mid == 0)
+    {
+      jclass clazz =
+        env->FindClass(JAVAHL_CLASS("/callback/StatusBatchCallback"));
+      if (JNIUtil::isJavaExceptionThrown())
+        {
+          clearQueue();
+          POP_AND_RETURN(SVN_NO_ERROR);
+        }
+
+      mid = env->GetMethodID(clazz, "doStatus",
+                             "([Ljava/lang/String;"
+                             "[" JAVAHL_ARG("/types/Status;") ")V");
+      if (JNIUtil::isJavaExceptionThrown() || mid == 0)
+        {
+          clearQueue();
+          POP_AND_RETURN(SVN_NO_ERROR);
+        }
+    }
+
+  jclass stringClass = env->FindClass("java/lang/String");
+  if (JNIUtil::isJavaExceptionThrown())
+    {
+      clearQueue();
+      POP_AND_RETURN(SVN_NO_ERROR);
+    }
+
+  jclass statusClass = env->FindClass(JAVAHL_CLASS("/types/Status"));
+  if (JNIUtil::isJavaExceptionThrown())
+    {
+      clearQueue();
+      POP_AND_RETURN(SVN_NO_ERROR);
+    }
+
+  jobjectArray jPaths = env->NewObjectArray(count, stringClass, NULL);
+  jobjectArray jStatuses = env->NewObjectArray(count, statusClass, NULL);
+  if (JNIUtil::isJavaExceptionThrown())
+    {
+      clearQueue();
+      POP_AND_RETURN(SVN_NO_ERROR);
+    }
+
+  for (jsize i = 0; i < count; ++i)
+    {
+      env->SetObjectArrayElement(jPaths, i, m_paths[i]);
+      env->SetObjectArrayElement(jStatuses, i, m_statuses[i]);
+    }
+
+  // The arrays hold their own references now.
+  clearQueue();
+  if (JNIUtil::isJavaExceptionThrown())
+    POP_AND_RETURN(SVN_NO_ERROR);
+
+  env->CallVoidMethod(m_callback, mid, jPaths, jStatuses);
+
+  POP_AND_RETURN_EXCEPTION_AS_SVNERROR();
+}
+
 void
 StatusCallback::setWcCtx(svn_wc_context_t *wc_ctx_in)
 {
@@ -28,11 +28,14 @@
 #define STATUSCALLBACK_H
 
 #include <jni.h>
+#include <vector>
 #include "svn_client.h"
 
 /**
  * This class holds a Java callback object, each status item
- * for which the callback information is requested.
+ * for which the callback information is requested.  If the Java
+ * object implements StatusBatchCallback, the items get queued and
+ * are passed to Java in batches.
  */
 class StatusCallback
 {
@@ -47,6 +50,12 @@ class StatusCallback
                                const svn_client_status_t *status,
                                apr_pool_t *pool);
 
+  /**
+   * Pass the status items still queued for a batch callback to Java.
+   * Call this after the status operation has completed successfully.
+   */
+  svn_error_t *flush();
+
  protected:
   svn_error_t *doStatus(const char *local_abspath,
                         const svn_client_status_t *status,
@@ -59,6 +68,20 @@ class StatusCallback
   jobject m_callback;
 
   svn_wc_context_t *wc_ctx;
+
+  /**
+   * The maximum number of items per batch, 0 if the Java object is
+   * not a batch callback and -1 if that has not been checked, yet.
+   */
+  jint m_batchSize;
+
+  /**
+   * The items queued for the next batch, as global references.
+   */
+  std::vector<jobject> m_paths;
+  std::vector<jobject> m_statuses;
+
+  void clearQueue();
 };
 
 #endif // STATUSCALLBACK_H
@@ -66,6 +66,17 @@ Java_org_apache_subversion_javahl_remote_RemoteSession_cancelOperation(
   ras->cancelOperation();
 }
 
+JNIEXPORT void JNICALL
+Java_org_apache_subversion_javahl_remote_RemoteSession_resetCancelRequest(
+    JNIEnv *env, jobject jthis)
+{
+  JNIEntry(RemoteSession, resetCancelRequest);
+  RemoteSession *ras = RemoteSession::getCppObject(jthis);
+  CPPADDR_NULL_PTR(ras, );
+
+  ras->resetCancelRequest();
+}
+
 JNIEXPORT void JNICALL
 Java_org_apache_subversion_javahl_remote_RemoteSession_reparent(
     JNIEnv *env, jobject jthis, jstring jurl)
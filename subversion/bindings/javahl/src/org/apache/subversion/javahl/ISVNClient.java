@@ -94,6 +94,10 @@ public interface ISVNClient
      * @param depthAsSticky When set, interpret <code>depth</code> as
      *                      the ambient depth of the working copy.
      * @param changelists changelists to filter by
+     * @param callback    the object to receive the status items; if it
+     *                    is a {@link
+     *                    org.apache.subversion.javahl.callback.StatusBatchCallback},
+     *                    the items will be passed in batches
      * @since 1.9
      */
     void status(String path, Depth depth,
@@ -227,7 +231,10 @@ public interface ISVNClient
      *                      revision properties
      * @param limit         limit the number of log messages (if 0 or less no
      *                      limit)
-     * @param callback      the object to receive the log messages
+     * @param callback      the object to receive the log messages; if
+     *                      it is a {@link
+     *                      org.apache.subversion.javahl.callback.LogMessageBatchCallback},
+     *                      the messages will be passed in batches
      * @since 1.10
      */
     void logMessages(String path, Revision pegRevision,
@@ -1335,7 +1342,12 @@ public interface ISVNClient
      * @param path        the path of the file
      * @param revision    the revision to retrieve
      * @param pegRevision the revision at which to interpret the path
-     * @param stream      the stream to write the file's content to
+     * @param stream      the stream to write the file's content to; if it
+     *                    also implements
+     *                    {@link java.nio.channels.WritableByteChannel},
+     *                    the content will be passed as direct
+     *                    {@link java.nio.ByteBuffer}s which must not be
+     *                    used after the write call returned
      * @param returnProps whether to return the file's own (not inherited)
      *                    properties dalong with the contents
      * @return The file's properties if <code>returnProps</code> is
@@ -241,7 +241,11 @@ public interface ISVNRemote
      * returns <code>revision</code>.
      * <p>
      * If <code>contents</code> is not <code>null</code>, push the
-     * contents of the file into the stream.
+     * contents of the file into the stream.  If the stream also
+     * implements {@link java.nio.channels.WritableByteChannel}, the
+     * contents will be passed as direct {@link java.nio.ByteBuffer}s,
+     * avoiding a copy into Java byte arrays.  These buffers must not
+     * be used after the write call returned.
      * <p>
      * If <code>properties</code> is not <code>null</code>, set
      * <code>properties</code> to contain the properties of the file. This
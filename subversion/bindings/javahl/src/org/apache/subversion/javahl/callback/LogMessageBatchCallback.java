@@ -0,0 +1,67 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ */
+
+package org.apache.subversion.javahl.callback;
+
+import org.apache.subversion.javahl.types.ChangePath;
+
+import java.util.Map;
+import java.util.Set;
+
+/**
+ * A {@link LogMessageCallback} that receives the log messages in
+ * batches.  This saves most of the transitions from native code to
+ * Java when retrieving long histories.
+ * <p>
+ * The native implementation calls {@link #messages} instead of
+ * {@link LogMessageCallback#singleMessage} for callbacks that
+ * implement this interface.  The messages are reported in the same
+ * order and with the same nesting as they would be to
+ * {@link LogMessageCallback#singleMessage}.
+ * @since 1.10
+ */
+public interface LogMessageBatchCallback extends LogMessageCallback
+{
+    /**
+     * @return the maximum number of log messages to pass to a single
+     *         {@link #messages} call.  Values smaller than 1 will be
+     *         treated as 1.
+     */
+    public int getBatchSize();
+
+    /**
+     * The method will be called for every batch of log messages.  All
+     * arrays have the same length and their elements at the same index
+     * describe one log message, just like the parameters of
+     * {@link LogMessageCallback#singleMessage}.
+     *
+     * @param changedPaths   the sets of paths that were changed
+     * @param revisions      the revisions of the commits
+     * @param revprops       the requested revision properties
+     * @param hasChildren    whether or not the entries have child entries
+     */
+    public void messages(Set<ChangePath>[] changedPaths,
+                         long[] revisions,
+                         Map<String, byte[]>[] revprops,
+                         boolean[] hasChildren);
+}
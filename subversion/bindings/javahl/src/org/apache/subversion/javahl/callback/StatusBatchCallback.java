@@ -0,0 +1,56 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ */
+
+package org.apache.subversion.javahl.callback;
+
+import org.apache.subversion.javahl.types.Status;
+
+/**
+ * A {@link StatusCallback} that receives the status items in batches.
+ * This saves most of the transitions from native code to Java when
+ * retrieving the status of large working copies.
+ * <p>
+ * The native implementation calls {@link #doStatus(String[], Status[])}
+ * instead of {@link StatusCallback#doStatus(String, Status)} for
+ * callbacks that implement this interface.  The items are reported in
+ * the same order as they would be to the latter.
+ * @since 1.10
+ */
+public interface StatusBatchCallback extends StatusCallback
+{
+    /**
+     * @return the maximum number of status items to pass to a single
+     *         {@link #doStatus(String[], Status[])} call.  Values
+     *         smaller than 1 will be treated as 1.
+     */
+    public int getBatchSize();
+
+    /**
+     * The method will be called for every batch of status items.  Both
+     * arrays have the same length and their elements at the same index
+     * describe one item.
+     * @param paths     the paths of the objects
+     * @param statuses  the status objects, may contain null
+     */
+    public void doStatus(String[] paths, Status[] statuses);
+}
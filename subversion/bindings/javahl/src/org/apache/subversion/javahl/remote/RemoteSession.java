@@ -57,28 +57,7 @@ public class RemoteSession extends JNIObject implements ISVNRemote
 
     public void dispose()
     {
-        if (editorReference != null)
-        {
-            // Deactivate the open editor
-            ISVNEditor ed = editorReference.get();
-            if (ed != null)
-            {
-                ed.dispose();
-                editorReference.clear();
-            }
-            editorReference = null;
-        }
-        if (reporterReference != null)
-        {
-            // Deactivate the open reporter
-            ISVNReporter rp = reporterReference.get();
-            if (rp != null)
-            {
-                rp.dispose();
-                reporterReference.clear();
-            }
-            reporterReference = null;
-        }
+        deactivate();
         nativeDispose();
     }
 
@@ -402,6 +381,48 @@ public class RemoteSession extends JNIObject implements ISVNRemote
         reporterReference.clear();
     }
 
+    /*
+     * Called by RemoteSessionPool before handing out this session
+     * again: deactivate any open editor or reporter and forget about
+     * earlier cancellation requests.
+     */
+    void recycle()
+    {
+        deactivate();
+        resetCancelRequest();
+    }
+
+    private native void resetCancelRequest();
+
+    /*
+     * Deactivate the open editor or reporter, if any.
+     */
+    private void deactivate()
+    {
+        if (editorReference != null)
+        {
+            // Deactivate the open editor
+            ISVNEditor ed = editorReference.get();
+            if (ed != null)
+            {
+                ed.dispose();
+                editorReference.clear();
+            }
+            editorReference = null;
+        }
+        if (reporterReference != null)
+        {
+            // Deactivate the open reporter
+            ISVNReporter rp = reporterReference.get();
+            if (rp != null)
+            {
+                rp.dispose();
+                reporterReference.clear();
+            }
+            reporterReference = null;
+        }
+    }
+
     /*
      * Private helper methods.
      */
@@ -0,0 +1,228 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ */
+
+package org.apache.subversion.javahl.remote;
+
+package org.apache.subversion.javahl.remote;
+
+import org.apache.subversion.javahl.ISVNRemote;
+import org.apache.subversion.javahl.ClientException;
+import org.apache.subversion.javahl.SubversionException;
+
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.LinkedList;
+import java.util.List;
+import java.util.Map;
+
+/**
+ * A pool of reusable {@link ISVNRemote} sessions.
+ * <p>
+ * Opening a session requires a connection to the server and usually
+ * authentication.  Applications that issue many short requests can
+ * avoid that overhead by checking out a session from this pool and
+ * returning it when done.  Sessions returned to the pool stay
+ * connected; the next checkout for a URL within the same repository
+ * reparents one of them instead of opening a new one.
+ * <p>
+ * The pool itself may be used by multiple threads concurrently.  The
+ * sessions are not thread-safe, but each of them is handed out to only
+ * one caller at a time.
+ * @since 1.10
+ */
+public class RemoteSessionPool
+{
+    /**
+     * Create a pool that opens new sessions through
+     * <code>factory</code> and keeps up to <code>maxIdle</code>
+     * unused sessions open.
+     * @throws IllegalArgumentException If <code>factory</code> is null
+     *         or <code>maxIdle</code> is negative.
+     */
+    public RemoteSessionPool(RemoteFactory factory, int maxIdle)
+    {
+        if (factory == null)
+            throw new IllegalArgumentException("factory may not be null");
+        if (maxIdle < 0)
+            throw new IllegalArgumentException("maxIdle must not be negative");
+        this.factory = factory;
+        this.maxIdle = maxIdle;
+    }
+
+    /**
+     * Return a session whose session URL is <code>url</code>.  Reuse
+     * an idle session of the same repository, if possible, and open a
+     * new one otherwise.
+     * <p>
+     * <b>Note:</b> Pass the session to {@link #checkin} when done with
+     * it or call its {@link ISVNRemote#dispose} method if it is in an
+     * unknown state, e.g. after a network error.
+     *
+     * @param url The session URL.
+     * @throws RetryOpenSession If the session URL was redirected
+     * @throws SubversionException If an URL redirect cycle was detected
+     * @throws ClientException
+     */
+    public ISVNRemote checkout(String url)
+            throws ClientException, SubversionException
+    {
+        RemoteSession session;
+        while ((session = takeIdle(url)) != null)
+        {
+            try
+            {
+                session.reparent(url);
+                return session;
+            }
+            catch (ClientException ex)
+            {
+                // Don't let a broken session fail the request.
+                session.dispose();
+            }
+        }
+
+        return factory.openRemoteSession(url);
+    }
+
+    /**
+     * Return <code>session</code>, which must have been obtained from
+     * {@link #checkout}, to the pool.  Any editor or reporter still
+     * active on it will be disposed.  If the pool already holds the
+     * maximum number of idle sessions, <code>session</code> will be
+     * disposed instead.
+     *
+     * @throws IllegalArgumentException If <code>session</code> was not
+     *         created by a {@link RemoteFactory}.
+     */
+    public void checkin(ISVNRemote session)
+    {
+        if (!(session instanceof RemoteSession))
+            throw new IllegalArgumentException("Not a pooled session");
+
+        RemoteSession rs = (RemoteSession) session;
+        String root;
+        try
+        {
+            rs.recycle();
+            root = rs.getReposRootUrl();
+        }
+        catch (ClientException ex)
+        {
+            rs.dispose();
+            return;
+        }
+
+        synchronized (this)
+        {
+            if (!disposed && idleCount < maxIdle)
+            {
+                LinkedList<RemoteSession> sessions = idle.get(root);
+                if (sessions == null)
+                {
+                    sessions = new LinkedList<RemoteSession>();
+                    idle.put(root, sessions);
+                }
+
+                sessions.addFirst(rs);
+                ++idleCount;
+                return;
+            }
+        }
+
+        rs.dispose();
+    }
+
+    /**
+     * Return the number of idle sessions in the pool.
+     */
+    public synchronized int getIdleCount()
+    {
+        return idleCount;
+    }
+
+    /**
+     * Dispose all idle sessions.  Sessions returned later will be
+     * disposed immediately.
+     */
+    public void dispose()
+    {
+        List<RemoteSession> sessions = new ArrayList<RemoteSession>();
+        synchronized (this)
+        {
+            disposed = true;
+            for (LinkedList<RemoteSession> list : idle.values())
+                sessions.addAll(list);
+            idle.clear();
+            idleCount = 0;
+        }
+
+        for (RemoteSession session : sessions)
+            session.dispose();
+    }
+
+    /*
+     * Remove and return the most recently used idle session of the
+     * repository containing URL, or null if there is none.
+     */
+    private synchronized RemoteSession takeIdle(String url)
+    {
+        for (Map.Entry<String, LinkedList<RemoteSession>> entry
+                 : idle.entrySet())
+        {
+            String root = entry.getKey();
+            if (isWithin(url, root))
+            {
+                LinkedList<RemoteSession> sessions = entry.getValue();
+                RemoteSession session = sessions.removeFirst();
+                if (sessions.isEmpty())
+                    idle.remove(root);
+                --idleCount;
+                return session;
+            }
+        }
+
+        return null;
+    }
+
+    /*
+     * Return true if URL is ROOT or a URL below it.
+     */
+    private static boolean isWithin(String url, String root)
+    {
+        if (!url.startsWith(root))
+            return false;
+
+        return url.length() == root.length()
+            || root.endsWith("/")
+            || url.charAt(root.length()) == '/';
+    }
+
+    private final RemoteFactory factory;
+    private final int maxIdle;
+
+    /* Idle sessions by repository root URL, most recently used first. */
+    private final Map<String, LinkedList<RemoteSession>> idle =
+        new HashMap<String, LinkedList<RemoteSession>>();
+    private int idleCount = 0;
+    private boolean disposed = false;
+}
@@ -309,6 +309,57 @@ public class BasicTests extends SVNTests
         assertEquals(1, branchRange.size());
     }
 
+    /**
+     * Test that SVNClient.status passes the items to batch callbacks in
+     * batches of the requested size and in the usual order.
+     * @throws Throwable
+     */
+    public void testBatchStatus() throws Throwable
+    {
+        // build the test setup
+        OneTest thisTest = new OneTest();
+
+        MyStatusCallback expected = new MyStatusCallback();
+        client.status(thisTest.getWCPath(), Depth.infinity,
+                      false, true, true, false, false, false,
+                      null, expected);
+
+        class BatchCallback implements StatusBatchCallback
+        {
+            List<String> paths = new ArrayList<String>();
+            int batches = 0;
+
+            public int getBatchSize()
+            {
+                return 4;
+            }
+
+            public void doStatus(String[] batchPaths, Status[] statuses)
+            {
+                assertTrue("batch too large", batchPaths.length <= 4);
+                assertEquals(batchPaths.length, statuses.length);
+                paths.addAll(Arrays.asList(batchPaths));
+                batches++;
+            }
+
+            public void doStatus(String path, Status status)
+            {
+                fail("single item passed to batch callback");
+            }
+        }
+
+        BatchCallback callback = new BatchCallback();
+        client.status(thisTest.getWCPath(), Depth.infinity,
+                      false, true, true, false, false, false,
+                      null, callback);
+
+        Status[] statuses = expected.getStatusArray();
+        assertEquals(statuses.length, callback.paths.size());
+        assertEquals((statuses.length + 3) / 4, callback.batches);
+        for (int i = 0; i < statuses.length; ++i)
+            assertEquals(statuses[i].getPath(), callback.paths.get(i));
+    }
+
     /**
      * Test the basic SVNClient.status functionality.
      * @throws Throwable
@@ -2305,6 +2356,52 @@ public class BasicTests extends SVNTests
         assertTrue("content changed", Arrays.equals(content, testContent));
     }
 
+    /**
+     * Test that SVNClient.streamFileContent passes direct buffers to
+     * streams that are channels as well.
+     * @throws Throwable
+     */
+    public void testCatToChannel() throws Throwable
+    {
+        // create the working copy
+        OneTest thisTest = new OneTest();
+
+        class ChannelOutputStream extends ByteArrayOutputStream
+            implements WritableByteChannel
+        {
+            int directWrites = 0;
+
+            public boolean isOpen()
+            {
+                return true;
+            }
+
+            public int write(ByteBuffer src)
+            {
+                if (src.isDirect())
+                    directWrites++;
+
+                // Take at most 3 bytes per call.
+                int length = Math.min(3, src.remaining());
+                byte[] bytes = new byte[length];
+                src.get(bytes);
+                write(bytes, 0, length);
+                return length;
+            }
+        }
+
+        ChannelOutputStream stream = new ChannelOutputStream();
+        client.streamFileContent(thisTest.getWCPath() + "/A/mu", null, null,
+                                 stream);
+
+        byte[] content = stream.toByteArray();
+        byte[] testContent = thisTest.getWc().getItemContent("A/mu").getBytes();
+
+        // the content should be the same
+        assertTrue("content changed", Arrays.equals(content, testContent));
+        assertTrue("no direct buffers used", stream.directWrites > 0);
+    }
+
     /**
      * Test the basic SVNClient.list functionality.
      * @throws Throwable
@@ -2715,6 +2812,74 @@ public class BasicTests extends SVNTests
             }
     }
 
+    /**
+     * Test that SVNClient.logMessages passes the messages to batch
+     * callbacks in batches of the requested size and in the usual order.
+     * @throws Throwable
+     */
+    public void testBatchLogMessages() throws Throwable
+    {
+        // create the working copy and a few more revisions
+        OneTest thisTest = new OneTest();
+        for (int i = 0; i < 4; ++i)
+        {
+            Set<String> urls = new HashSet<String>(1);
+            urls.add(thisTest.getUrl() + "/Y" + i);
+            client.mkdir(urls, false, null, new ConstMsg("log_msg"), null);
+        }
+
+        class BatchCallback implements LogMessageBatchCallback
+        {
+            List<Long> revisions = new ArrayList<Long>();
+            int batches = 0;
+
+            public int getBatchSize()
+            {
+                return 2;
+            }
+
+            public void messages(Set<ChangePath>[] changedPaths,
+                                 long[] batchRevisions,
+                                 Map<String, byte[]>[] revprops,
+                                 boolean[] hasChildren)
+            {
+                assertTrue("batch too large", batchRevisions.length <= 2);
+                assertEquals(batchRevisions.length, changedPaths.length);
+                assertEquals(batchRevisions.length, revprops.length);
+                assertEquals(batchRevisions.length, hasChildren.length);
+                for (int i = 0; i < batchRevisions.length; ++i)
+                {
+                    assertEquals(1, changedPaths[i].size());
+                    assertEquals("log_msg",
+                                 new String(revprops[i].get("svn:log")));
+                    revisions.add(new Long(batchRevisions[i]));
+                }
+                batches++;
+            }
+
+            public void singleMessage(Set<ChangePath> changedPaths,
+                                      long revision,
+                                      Map<String, byte[]> revprops,
+                                      boolean hasChildren)
+            {
+                fail("single message passed to batch callback");
+            }
+        }
+
+        List<RevisionRange> ranges = new ArrayList<RevisionRange>(1);
+        ranges.add(new RevisionRange(new Revision.Number(5),
+                                     new Revision.Number(2)));
+
+        BatchCallback callback = new BatchCallback();
+        client.logMessages(thisTest.getUrl().toString(), null, ranges,
+                           false, true, false, null, true, 0, callback);
+
+        assertEquals(2, callback.batches);
+        assertEquals(Arrays.asList(new Long(5), new Long(4),
+                                   new Long(3), new Long(2)),
+                     callback.revisions);
+    }
+
     /**
      * Calls the API to get mergeinfo revisions and returns
      * the revision numbers in a sorted array, or null if there
@@ -328,6 +328,42 @@ public class SVNRemoteTests extends SVNTests
         assertEquals(newUrl, session.getSessionUrl());
     }
 
+    public void testSessionPool() throws Exception
+    {
+        RemoteFactory factory = new RemoteFactory();
+        factory.setConfigDirectory(super.conf.getAbsolutePath());
+        factory.setUsername(USERNAME);
+        if (DefaultAuthn.useDeprecated())
+            factory.setPrompt(DefaultAuthn.getDeprecated());
+        else
+            factory.setPrompt(DefaultAuthn.getDefault());
+
+        RemoteSessionPool pool = new RemoteSessionPool(factory, 2);
+        String url = getTestRepoUrl();
+
+        ISVNRemote first = pool.checkout(url);
+        assertEquals(0, pool.getIdleCount());
+        pool.checkin(first);
+        assertEquals(1, pool.getIdleCount());
+
+        // The idle session gets reused and reparented.
+        ISVNRemote second = pool.checkout(url + "/A/B/E");
+        assertSame(first, second);
+        assertEquals(url + "/A/B/E", second.getSessionUrl());
+        assertEquals(1, second.getLatestRevision());
+
+        // No idle session left, so this one must be new.
+        ISVNRemote third = pool.checkout(url);
+        assertNotSame(second, third);
+
+        pool.checkin(second);
+        pool.checkin(third);
+        assertEquals(2, pool.getIdleCount());
+
+        pool.dispose();
+        assertEquals(0, pool.getIdleCount());
+    }
+
     public void testGetRelativePath() throws Exception
     {
         ISVNRemote session = getSession();
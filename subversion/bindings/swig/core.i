@@ -899,6 +899,41 @@ void svn_swig_py_clear_application_pool();
 svn_swig_py_initialize();
 %}
 
+/* -----------------------------------------------------------------------
+   svn_stream_readinto(): read into any writable object supporting the
+   buffer protocol, such as a bytearray or a memoryview slice of one,
+   without the intermediate copy svn_stream_read() makes.
+*/
+%typemap(in) (char *WRITABLE_BUFFER, apr_size_t *len)
+             (Py_buffer view, int got_view = 0, $*2_type temp) {
+    if (PyObject_GetBuffer($input, &view, PyBUF_WRITABLE) == -1)
+        SWIG_fail;
+    got_view = 1;
+    temp = view.len;
+    $1 = view.buf;
+    $2 = ($2_ltype)&temp;
+}
+%typemap(argout) (char *WRITABLE_BUFFER, apr_size_t *len) {
+  %append_output(PyInt_FromSize_t(*$2));
+}
+%typemap(freearg) (char *WRITABLE_BUFFER, apr_size_t *len) {
+  if (got_view$argnum)
+    PyBuffer_Release(&view$argnum);
+}
+
+%inline %{
+/* Fill WRITABLE_BUFFER from STREAM as far as possible and return the
+ * number of bytes read, which will be less than the buffer size only at
+ * the end of the stream. */
+static svn_error_t *
+svn_stream_readinto(svn_stream_t *stream,
+                    char *WRITABLE_BUFFER,
+                    apr_size_t *len)
+{
+  return svn_stream_read_full(stream, WRITABLE_BUFFER, len);
+}
+%}
+
 /* Proxy classes for APR classes */
 %include proxy_apr.swg
 
@@ -3286,6 +3286,85 @@ finished:
   return err;
 }
 
+/* Return a dict mapping the paths in HASH, a hash of
+   svn_log_changed_path2_t *, to plain tuples
+   (action, copyfrom_path, copyfrom_rev, node_kind).  Unlike
+   svn_swig_py_changed_path2_hash_to_dict(), this does not need a pool
+   and a wrapper object for every path. */
+static PyObject *changed_path2_hash_to_tuples(apr_hash_t *hash)
+{
+  apr_hash_index_t *hi;
+  PyObject *dict;
+
+  if (hash == NULL)
+    Py_RETURN_NONE;
+
+  if ((dict = PyDict_New()) == NULL)
+    return NULL;
+
+  for (hi = apr_hash_first(NULL, hash); hi; hi = apr_hash_next(hi))
+    {
+      const void *key;
+      void *val;
+      svn_log_changed_path2_t *change;
+      PyObject *value;
+
+      apr_hash_this(hi, &key, NULL, &val);
+      change = val;
+      value = Py_BuildValue((char *)"czli", change->action,
+                            change->copyfrom_path,
+                            (long)change->copyfrom_rev,
+                            (int)change->node_kind);
+      if (value == NULL)
+        {
+          Py_DECREF(dict);
+          return NULL;
+        }
+      if (PyDict_SetItemString(dict, (char *)key, value) == -1)
+        {
+          Py_DECREF(value);
+          Py_DECREF(dict);
+          return NULL;
+        }
+      Py_DECREF(value);
+    }
+
+  return dict;
+}
+
+svn_error_t *svn_swig_py_log_entry_collector(void *baton,
+                                             svn_log_entry_t *log_entry,
+                                             apr_pool_t *pool)
+{
+  PyObject *entries = baton;
+  PyObject *revprops, *changed_paths, *entry;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  svn_swig_py_acquire_py_lock();
+
+  revprops = svn_swig_py_prophash_to_dict(log_entry->revprops);
+  changed_paths = changed_path2_hash_to_tuples(log_entry->changed_paths2);
+
+  /* "N" steals the references, even on failure. */
+  if (revprops == NULL || changed_paths == NULL)
+    {
+      Py_XDECREF(revprops);
+      Py_XDECREF(changed_paths);
+      entry = NULL;
+    }
+  else
+    entry = Py_BuildValue((char *)"lNNi", (long)log_entry->revision,
+                          revprops, changed_paths,
+                          (int)log_entry->has_children);
+
+  if (entry == NULL || PyList_Append(entries, entry) == -1)
+    err = callback_exception_error();
+
+  Py_XDECREF(entry);
+  svn_swig_py_release_py_lock();
+  return err;
+}
+
 svn_error_t *svn_swig_py_info_receiver_func(void *baton,
                                             const char *path,
                                             const svn_info_t *info,
@@ -358,6 +358,14 @@ svn_error_t *svn_swig_py_log_entry_receiver(void *baton,
                                             svn_log_entry_t *log_entry,
                                             apr_pool_t *pool);
 
+/* log entry receiver appending every entry to the Python list BATON as
+   a tuple (revision, revprops, changed_paths, has_children).
+   CHANGED_PATHS maps paths to tuples
+   (action, copyfrom_path, copyfrom_rev, node_kind). */
+svn_error_t *svn_swig_py_log_entry_collector(void *baton,
+                                             svn_log_entry_t *log_entry,
+                                             apr_pool_t *pool);
+
 /* thunked repos freeze function */
 svn_error_t *svn_swig_py_repos_freeze_func(void *baton,
                                            apr_pool_t *pool);
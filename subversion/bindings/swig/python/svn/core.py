@@ -176,6 +176,13 @@ class Stream:
     # read the amount specified
     return svn_stream_read(self._stream, int(amt))
 
+  def readinto(self, b):
+    """Read into the writable buffer B and return the number of bytes
+    read, which is less than len(B) only at the end of the stream."""
+    if self._stream is None:
+      raise ValueError
+    return svn_stream_readinto(self._stream, b)
+
   def write(self, buf):
     if self._stream is None:
       raise ValueError
@@ -47,6 +47,17 @@ class SubversionCoreTestCase(unittest.TestCase):
             svn.core.svn_mime_type_validate, "this\nis\ninvalid\n")
     svn.core.svn_mime_type_validate("unknown/but-valid; charset=utf8")
 
+  def test_stream_readinto(self):
+    stream = svn.core.svn_stream_from_stringbuf("hello world")
+    buf = bytearray(8)
+    self.assertEqual(8, svn.core.svn_stream_readinto(stream, buf))
+    self.assertEqual("hello wo", str(buf))
+    self.assertEqual(3, svn.core.svn_stream_readinto(stream,
+                                                     memoryview(buf)[2:]))
+    self.assertEqual("herld wo", str(buf))
+    self.assertEqual(0, svn.core.svn_stream_readinto(stream, buf))
+    svn.core.svn_stream_close(stream)
+
   def test_exception_interoperability(self):
     """Test if SubversionException is correctly converted into svn_error_t
     and vice versa."""
@@ -400,6 +400,28 @@ class SubversionRepositoryAccessTestCase(unittest.TestCase):
                     log_revprops, receiver)
         self.assert_(called[0])
 
+  def test_get_log_list(self):
+    self.test_commit3()
+    rev = fs.youngest_rev(self.fs)
+    entries = []
+    ra.get_log_list(self.ra_ctx, [""], rev, 0, 0,
+                    True,       # discover_changed_paths
+                    True,       # strict_node_history
+                    False,      # include_merged_revisions
+                    ["svn:log", "testprop"], entries)
+    revisions = [entry[0] for entry in entries]
+    self.assertEqual(revisions, sorted(revisions, reverse=True))
+
+    (revision, revprops, changed_paths, has_children) = entries[0]
+    self.assertEqual(revision, rev)
+    self.assertEqual(revprops, {"svn:log": "foobar", "testprop": ""})
+    self.assertEqual(list(changed_paths.keys()), ['/bla3'])
+    (action, copyfrom_path, copyfrom_rev, kind) = changed_paths['/bla3']
+    self.assert_(action in ['A', 'D', 'R', 'M'])
+    self.assertEqual(copyfrom_path, None)
+    self.assertEqual(copyfrom_rev, -1)
+    self.assertFalse(has_children)
+
   def test_update(self):
     class TestEditor(delta.Editor):
         pass
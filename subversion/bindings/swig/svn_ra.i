@@ -108,3 +108,29 @@
 /* ----------------------------------------------------------------------- */
 
 %include svn_ra_h.swg
+
+#ifdef SWIGPYTHON
+%inline %{
+/* Like svn_ra_get_log2(), but append all log entries to the Python list
+ * ENTRIES as plain tuples instead of calling back into Python once per
+ * revision.  See svn_swig_py_log_entry_collector() for their format. */
+static svn_error_t *
+svn_ra_get_log_list(svn_ra_session_t *session,
+                    const apr_array_header_t *paths,
+                    svn_revnum_t start,
+                    svn_revnum_t end,
+                    int limit,
+                    svn_boolean_t discover_changed_paths,
+                    svn_boolean_t strict_node_history,
+                    svn_boolean_t include_merged_revisions,
+                    const apr_array_header_t *revprops,
+                    PyObject *entries,
+                    apr_pool_t *pool)
+{
+  return svn_ra_get_log2(session, paths, start, end, limit,
+                         discover_changed_paths, strict_node_history,
+                         include_merged_revisions, revprops,
+                         svn_swig_py_log_entry_collector, entries, pool);
+}
+%}
+#endif
@@ -54,6 +54,24 @@ typedef int (*authz_svn__subreq_bypass_func_t)(request_rec *r,
                                               const char *repos_path,
                                               const char *repos_name);
 
+/** Provider name for subtree checks without subrequests */
+#define AUTHZ_SVN__SUBTREE_BYPASS_PROV_NAME "mod_authz_svn_subtree_bypass"
+/** Provider version for subtree checks without subrequests */
+#define AUTHZ_SVN__SUBTREE_BYPASS_PROV_VER "00.00a"
+/** Provider to allow mod_dav_svn to check read access to a whole subtree
+ * with a single call instead of asking for each path within it.  It is
+ * registered in the #AUTHZ_SVN__SUBREQ_BYPASS_PROV_GRP group.
+ *
+ * Uses @a r @a repos_path and @a repos_name to determine if the user
+ * making the request may read @a repos_path and everything below it.
+ *
+ * Returns @c OK if that is the case or @c HTTP_FORBIDDEN if there is
+ * at least one path in that subtree that the user may not read.
+ */
+typedef int (*authz_svn__subtree_bypass_func_t)(request_rec *r,
+                                               const char *repos_path,
+                                               const char *repos_name);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
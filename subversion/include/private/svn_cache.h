@@ -148,6 +148,11 @@ typedef struct svn_cache__info_t
    */
   apr_uint64_t failures;
 
+  /** Number of entries that got removed to make room for new ones.
+   * May be 0 if that information is not available.
+   */
+  apr_uint64_t evictions;
+
   /** Size of the data currently stored in the cache.
    * May be 0 if that information is not available.
    */
@@ -260,6 +265,11 @@ svn_cache__create_memcache(svn_cache__t **cache_p,
  * memcached servers; otherwise, sets @a *memcache_p to NULL.  Use
  * @a scratch_pool for temporary allocations.
  *
+ * The SVN_CACHE_CONFIG_CATEGORY_MEMCACHED_OPTIONS section of @a config
+ * may limit the number of connections per server, enable asynchronous
+ * writes (if APR has thread support) and select memcached to be used as
+ * a second-level cache.
+ *
  * If Subversion was not built with apr_memcache_support, then raises
  * SVN_ERR_NO_APR_MEMCACHE if and only if @a config is configured to
  * use memcache.
@@ -270,6 +280,16 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
                                      apr_pool_t *result_pool,
                                      apr_pool_t *scratch_pool);
 
+/**
+ * Return TRUE if caches using @a memcache should be put below local
+ * membuffer caches instead of replacing them, i.e. @a memcache has been
+ * configured with SVN_CACHE_CONFIG_OPTION_MEMCACHED_SECOND_LEVEL.
+ *
+ * @since New in 1.10.
+ */
+svn_boolean_t
+svn_cache__memcache_is_second_level(const svn_memcache_t *memcache);
+
 /**
  * Creates a new membuffer cache object in @a *cache. It will contain
  * up to @a total_size bytes of data, using @a directory_size bytes
@@ -310,6 +330,175 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
                                   svn_boolean_t allow_blocking_writes,
                                   apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__membuffer_cache_create() but place the cache in
+ * anonymous shared memory.  All processes forked from the current one
+ * after this call will share the cache contents with it and with each
+ * other.  Access is serialized across processes and threads, i.e. the
+ * cache is always thread-safe.
+ *
+ * The cache can't be shared with processes that have not been forked
+ * from the creating one.  Return #SVN_ERR_UNSUPPORTED_FEATURE if the
+ * platform lacks the required shared memory or process-shared locks.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *result_pool);
+
+/**
+ * Eviction / admission policies of membuffer caches.
+ *
+ * @since New in 1.10.
+ */
+typedef enum svn_cache__membuffer_policy_t
+{
+  /** Entries compete based on their priority and the hits they got while
+   * being in the cache.  This is the default. */
+  svn_cache__membuffer_policy_priority,
+
+  /** Like svn_cache__membuffer_policy_priority but access frequencies of
+   * all keys are being tracked across evictions (TinyLFU).  New entries
+   * may only displace equally important entries that are less frequently
+   * used.  This prevents large one-off scans from pushing hot data out of
+   * the cache. */
+  svn_cache__membuffer_policy_tinylfu
+} svn_cache__membuffer_policy_t;
+
+/**
+ * Make the membuffer @a cache use the eviction @a policy.  Allocate any
+ * policy-specific data structures in @a pool.
+ *
+ * This must be called before @a cache gets used.  For caches in shared
+ * memory, this must also be called before forking any children.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__membuffer_set_policy(svn_membuffer_t *cache,
+                                svn_cache__membuffer_policy_t policy,
+                                apr_pool_t *pool);
+
+/**
+ * Ask the operating system to back the data buffers and directories of
+ * the membuffer @a cache with huge pages if @a huge_pages is set.  That
+ * reduces TLB misses for large caches.  If @a numa_interleave is set,
+ * spread the memory evenly across all NUMA nodes that this process may
+ * allocate from.  Otherwise, all of it may end up on a single node and
+ * threads on all other nodes pay the remote access latency.
+ *
+ * These are hints only and must be given before @a cache gets used.
+ * Memory that has already been touched will not be affected.  Return
+ * #SVN_ERR_UNSUPPORTED_FEATURE if the platform does not support them.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__membuffer_set_memory_hints(svn_membuffer_t *cache,
+                                      svn_boolean_t huge_pages,
+                                      svn_boolean_t numa_interleave);
+
+/**
+ * Attach a spill file of @a size bytes at @a path to the membuffer
+ * @a cache.  Entries of at least #SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY
+ * that get evicted from @a cache will be written to that file and be
+ * read back from there upon cache misses.  Only keys within namespaces
+ * registered with svn_cache__membuffer_spill_namespace() will be spilled.
+ *
+ * The spill file persists across process restarts.  Each file can only
+ * be used by one process at a time.  Should @a path be in use already,
+ * @a path.1, @a path.2 etc. will be tried.  Spill files are not supported
+ * for caches in shared memory.
+ *
+ * This must be called before @a cache gets used.  Allocate the spill
+ * file structures in @a pool.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__membuffer_set_spill_file(svn_membuffer_t *cache,
+                                    const char *path,
+                                    apr_uint64_t size,
+                                    apr_pool_t *pool);
+
+/**
+ * Return TRUE if the membuffer @a cache has a spill file attached.
+ *
+ * @since New in 1.10.
+ */
+svn_boolean_t
+svn_cache__membuffer_has_spill_file(svn_membuffer_t *cache);
+
+/**
+ * Allow the spill file of the membuffer @a cache to store entries whose
+ * key prefix starts with @a name_space.  @a youngest is the current
+ * youngest revision of the repository that @a name_space refers to.
+ * If it is lower than the one reported by an earlier process, e.g.
+ * because the repository has been restored from a backup, all data
+ * spilled for @a name_space before will be discarded.
+ *
+ * Note that a repository that got rolled back and then had grown beyond
+ * its former youngest revision before the next registration cannot be
+ * detected.  Namespaces should therefore contain e.g. the repository UUID.
+ *
+ * This is a no-op for caches without spill file.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__membuffer_spill_namespace(svn_membuffer_t *cache,
+                                     const char *name_space,
+                                     svn_revnum_t youngest);
+
+/**
+ * Write all entries of the membuffer @a cache whose key prefix starts with
+ * @a name_space to @a stream, followed by nothing else.  @a youngest and
+ * the arbitrary @a state string will be recorded in the snapshot and are
+ * being checked by svn_cache__membuffer_load().  Use @a scratch_pool for
+ * temporary allocations.
+ *
+ * The snapshot uses the native data representation and the serialization
+ * formats of the current build.  It can only be loaded by the same release
+ * on the same platform.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__membuffer_dump(svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          const char *name_space,
+                          svn_revnum_t youngest,
+                          const char *state,
+                          apr_pool_t *scratch_pool);
+
+/**
+ * Read a snapshot written by svn_cache__membuffer_dump() from @a stream
+ * and add its entries to the membuffer @a cache.  The snapshot will only
+ * be used if it has been taken for the same @a name_space and @a state
+ * and if its youngest revision does not exceed @a youngest.  Set
+ * @a *loaded to TRUE if that was the case and to FALSE otherwise.
+ * Loading stops silently at the first truncated or corrupted record.
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * Return #SVN_ERR_BAD_VERSION_FILE_FORMAT if @a stream does not contain
+ * a snapshot that is compatible with the current build.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__membuffer_load(svn_boolean_t *loaded,
+                          svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          const char *name_space,
+                          svn_revnum_t youngest,
+                          const char *state,
+                          apr_pool_t *scratch_pool);
+
 /**
  * @defgroup Standard priority classes for #svn_cache__create_membuffer_cache.
  * @{
@@ -378,6 +567,23 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
                                   apr_pool_t *result_pool,
                                   apr_pool_t *scratch_pool);
 
+/**
+ * Make the membuffer-based @a cache store serialized items of at least
+ * @a threshold bytes LZ4-compressed, trading CPU time for cache capacity.
+ * Items that don't compress well will be stored as they are.  Compressed
+ * items are not written to the spill file.  A @a threshold of 0 disables
+ * compression, which is the default.
+ *
+ * Call this before any concurrent access to @a cache.  Returns
+ * #SVN_ERR_UNSUPPORTED_FEATURE if @a cache is not a membuffer cache or
+ * if this build does not support LZ4.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__membuffer_set_compression(svn_cache__t *cache,
+                                     apr_size_t threshold);
+
 /**
  * Creates a null-cache instance in @a *cache_p, allocated from
  * @a result_pool.  The given @c id is the only data stored in it and can
@@ -391,6 +597,24 @@ svn_cache__create_null(svn_cache__t **cache_p,
                        const char *id,
                        apr_pool_t *result_pool);
 
+/**
+ * Creates a cache instance in @a *cache_p, allocated from @a result_pool,
+ * that combines the faster cache @a l1 with the slower cache @a l2.
+ * Lookups try @a l1 first and items found in @a l2 will be copied to
+ * @a l1.  New items are being added to both.  Both caches must use the
+ * same key type and the same kind of values.
+ *
+ * Errors reported by either cache are subject to its own error handler.
+ * The result is as thread-safe as @a l1 and @a l2 are.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__create_tiered(svn_cache__t **cache_p,
+                         svn_cache__t *l1,
+                         svn_cache__t *l2,
+                         apr_pool_t *result_pool);
+
 /**
  * Sets @a handler to be @a cache's error handling routine.  If any
  * error is returned from a call to svn_cache__get or svn_cache__set, @a
@@ -419,6 +643,13 @@ svn_cache__is_cachable(svn_cache__t *cache,
 
 #define SVN_CACHE_CONFIG_CATEGORY_MEMCACHED_SERVERS "memcached-servers"
 
+/* Config section and options tuning how memcached servers get used.
+ * @since New in 1.10. */
+#define SVN_CACHE_CONFIG_CATEGORY_MEMCACHED_OPTIONS "memcached-options"
+#define SVN_CACHE_CONFIG_OPTION_MEMCACHED_CONNECTIONS "connections-per-server"
+#define SVN_CACHE_CONFIG_OPTION_MEMCACHED_ASYNC_WRITES "asynchronous-writes"
+#define SVN_CACHE_CONFIG_OPTION_MEMCACHED_SECOND_LEVEL "second-level"
+
 /**
  * Fetches a value indexed by @a key from @a cache into @a *value,
  * setting @a *found to TRUE iff it is in the cache and FALSE if it is
@@ -433,6 +664,25 @@ svn_cache__get(void **value,
                const void *key,
                apr_pool_t *result_pool);
 
+/**
+ * Like svn_cache__get() but looks up all @a count entries given in
+ * @a keys in one go.  The results will be returned in the first @a count
+ * elements of @a values and @a found, respectively.  Individual entries
+ * of @a keys may be NULL.  Implementations may use this to reduce the
+ * synchronization overhead, so prefer this over calling svn_cache__get()
+ * in a loop.  Temporary allocations are made in @a scratch_pool.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__get_many(void **values,
+                    svn_boolean_t *found,
+                    svn_cache__t *cache,
+                    const void *const *keys,
+                    int count,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool);
+
 /**
  * Looks for an entry indexed by @a key in @a cache,  setting @a *found
  * to TRUE if an entry has been found and FALSE otherwise.  @a key may be
@@ -544,6 +794,17 @@ svn_cache__format_info(const svn_cache__info_t *info,
                        svn_boolean_t access_only,
                        apr_pool_t *result_pool);
 
+/**
+ * Return the per-prefix statistics in @a infos, as returned by
+ * svn_cache__membuffer_get_prefix_info(), formatted as a table with one
+ * line per prefix.  Allocations take place in @a result_pool.
+ *
+ * @since New in 1.10.
+ */
+svn_string_t *
+svn_cache__format_prefix_info(const apr_array_header_t *infos,
+                              apr_pool_t *result_pool);
+
 /**
  * Access the process-global (singleton) membuffer cache. The first call
  * will automatically allocate the cache using the current cache config.
@@ -554,6 +815,63 @@ svn_cache__format_info(const svn_cache__info_t *info,
 struct svn_membuffer_t *
 svn_cache__get_global_membuffer_cache(void);
 
+/**
+ * Request that the process-global membuffer cache be created in shared
+ * memory if @a shared is set, see svn_cache__membuffer_cache_create_shared.
+ * Should creating the shared cache fail, a private one will be used.
+ *
+ * This must be called before the first call to
+ * svn_cache__get_global_membuffer_cache() to have any effect.  Pre-fork
+ * servers should then call the latter before forking their children.
+ *
+ * @since New in 1.10.
+ */
+void
+svn_cache__set_global_membuffer_shared(svn_boolean_t shared);
+
+/**
+ * Request that a spill file of @a size bytes at @a path be attached to the
+ * process-global membuffer cache, see svn_cache__membuffer_set_spill_file.
+ * @a path must remain valid for the lifetime of the process.  A NULL
+ * @a path disables the spill file.  Should opening the spill file fail,
+ * the cache will be used without it.
+ *
+ * This must be called before the first call to
+ * svn_cache__get_global_membuffer_cache() to have any effect.
+ *
+ * @since New in 1.10.
+ */
+void
+svn_cache__set_global_membuffer_spill_file(const char *path,
+                                           apr_uint64_t size);
+
+/**
+ * Request that the process-global membuffer cache shall be created with
+ * the memory placement hints @a huge_pages and @a numa_interleave, see
+ * svn_cache__membuffer_set_memory_hints.  Should the platform not support
+ * them, they will be ignored.
+ *
+ * This must be called before the first call to
+ * svn_cache__get_global_membuffer_cache() to have any effect.
+ *
+ * @since New in 1.10.
+ */
+void
+svn_cache__set_global_membuffer_memory_hints(svn_boolean_t huge_pages,
+                                             svn_boolean_t numa_interleave);
+
+/**
+ * Request that the process-global membuffer cache uses the eviction
+ * @a policy, see svn_cache__membuffer_set_policy.
+ *
+ * This must be called before the first call to
+ * svn_cache__get_global_membuffer_cache() to have any effect.
+ *
+ * @since New in 1.10.
+ */
+void
+svn_cache__set_global_membuffer_policy(svn_cache__membuffer_policy_t policy);
+
 /**
  * Return total access and size stats over all membuffer caches as they
  * share the underlying data buffer.  The result will be allocated in POOL.
@@ -561,6 +879,37 @@ svn_cache__get_global_membuffer_cache(void);
 svn_cache__info_t *
 svn_cache__membuffer_get_global_info(apr_pool_t *pool);
 
+/**
+ * Set @a *gets and @a *hits to the total number of lookups and hits seen
+ * by the global membuffer cache so far.  Both will be 0 if there is no
+ * such cache.
+ *
+ * Unlike svn_cache__membuffer_get_global_info(), this does not take any
+ * locks and is cheap enough to be called for every request a server
+ * handles.  The counters are not synchronized, so the values are
+ * approximate.
+ */
+void
+svn_cache__membuffer_get_global_counters(apr_uint64_t *gets,
+                                         apr_uint64_t *hits);
+
+/**
+ * Set @a *infos to an array of #svn_cache__info_t *, one element for each
+ * key prefix used with the membuffer @a cache.  The @c id of each element
+ * is the key prefix.  Access counters, the number of evictions and the
+ * number and size of the entries currently in @a cache are given for each
+ * prefix.  Prefixes that are too long to be pooled are not covered.
+ * If @a reset has been set, the access and eviction counters will be reset
+ * after copying them.  Allocate the result in @a result_pool.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_cache__membuffer_get_prefix_info(apr_array_header_t **infos,
+                                     svn_membuffer_t *cache,
+                                     svn_boolean_t reset,
+                                     apr_pool_t *result_pool);
+
 /**
  * Remove all current contents from CACHE.
  *
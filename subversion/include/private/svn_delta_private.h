@@ -108,6 +108,24 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
                                  svn_stream_t *stream,
                                  apr_pool_t *pool);
 
+/** Like svn_txdelta__read_raw_window_len() but also check whether the
+    window simply inserts verbatim data, i.e. it has no source view,
+    consists of a single new-data instruction and its new data is stored
+    uncompressed.  If so, set @a *data_offset to the offset of that data
+    relative to the start of the window and @a *data_len to its length.
+    Otherwise, set @a *data_len to 0.
+
+    This reads at most the window header, the instructions and the length
+    prefix of the new data from @a stream.  The window is expected to be
+    in svndiff version @a svndiff_version. */
+svn_error_t *
+svn_txdelta__read_raw_window_data(apr_size_t *window_len,
+                                  apr_size_t *data_offset,
+                                  apr_size_t *data_len,
+                                  svn_stream_t *stream,
+                                  int svndiff_version,
+                                  apr_pool_t *pool);
+
 /* Return a debug editor that wraps @a wrapped_editor.
  *
  * The debug editor simply prints an indication of what callbacks are being
@@ -95,6 +95,25 @@ extern "C" {
 #endif
 #endif
 
+/**
+ * Indicate whether the compiler targets a CPU with 128 bit SIMD support
+ * and provides the respective intrinsics.  SSE2 and NEON are part of the
+ * base instruction sets of x86-64 and AArch64, respectively, so these do
+ * not require any runtime detection.  Define SVN_DISABLE_SIMD to use the
+ * portable code paths only.
+ *
+ * @since New in 1.10.
+ */
+#ifndef SVN_DISABLE_SIMD
+#if    defined(__SSE2__) \
+    || defined(_M_X64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define SVN__HAVE_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#  define SVN__HAVE_NEON 1
+#endif
+#endif
+
 /**
  * APR keeps a few interesting defines hidden away in its private
  * headers apr_arch_file_io.h, so we redefined them here.
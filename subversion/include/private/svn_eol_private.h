@@ -44,11 +44,13 @@ extern "C" {
 #  define SVN__BIT_7_SET       0x8080808080808080
 #  define SVN__R_MASK          0x0a0a0a0a0a0a0a0a
 #  define SVN__N_MASK          0x0d0d0d0d0d0d0d0d
+#  define SVN__DOLLAR_MASK     0x2424242424242424
 #else
 #  define SVN__LOWER_7BITS_SET 0x7f7f7f7f
 #  define SVN__BIT_7_SET       0x80808080
 #  define SVN__R_MASK          0x0a0a0a0a
 #  define SVN__N_MASK          0x0d0d0d0d
+#  define SVN__DOLLAR_MASK     0x24242424
 #endif
 
 /* Generic EOL character helper routines */
@@ -62,6 +64,14 @@ extern "C" {
 char *
 svn_eol__find_eol_start(char *buf, apr_size_t len);
 
+/* Like svn_eol__find_eol_start() but also stop at the start of a
+ * keyword, i.e. at a '$'.
+ *
+ * @since New in 1.10
+ */
+char *
+svn_eol__find_eol_or_keyword_start(char *buf, apr_size_t len);
+
 /* Return the first eol marker found in buffer @a buf as a NUL-terminated
  * string, or NULL if no eol marker is found. Do not examine more than
  * @a len bytes in @a buf.
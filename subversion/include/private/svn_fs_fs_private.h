@@ -259,11 +259,19 @@ typedef struct svn_fs_fs__stats_t
 /* Scan all contents of the repository FS and return statistics in *STATS,
  * allocated in RESULT_POOL.  Report progress through PROGRESS_FUNC with
  * PROGRESS_BATON, if PROGRESS_FUNC is not NULL.
+ *
+ * In logical addressing mode, up to JOBS pack files will be read
+ * concurrently.  If CACHE_DIR is not NULL, the data read from pack files
+ * will be stored in that directory and reused by later calls, so only new
+ * shards need to be read.  The results will be the same in either case.
+ *
  * Use SCRATCH_POOL for temporary allocations.
  */
 svn_error_t *
 svn_fs_fs__get_stats(svn_fs_fs__stats_t **stats,
                      svn_fs_t *fs,
+                     int jobs,
+                     const char *cache_dir,
                      svn_fs_progress_notify_func_t progress_func,
                      void *progress_baton,
                      svn_cancel_func_t cancel_func,
@@ -353,6 +361,51 @@ svn_fs_fs__load_index(svn_fs_t *fs,
                       apr_array_header_t *entries,
                       apr_pool_t *scratch_pool);
 
+/* Rewrite the L2P and P2L indexes of all rev / pack files in FS from the
+ * entries of their current P2L indexes.  The item checksums are being
+ * recalculated from the file contents and the new indexes use the page
+ * sizes currently configured for FS.  Up to JOBS files will be processed
+ * concurrently.  FS will not be packed while this runs.
+ *
+ * After each file, call NOTIFY_FUNC, if not NULL, with NOTIFY_BATON and
+ * the file's first revision, in revision order.  If not NULL, call
+ * CANCEL_FUNC with CANCEL_BATON from time to time.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__rebuild_indexes(svn_fs_t *fs,
+                           int jobs,
+                           svn_fs_progress_notify_func_t notify_func,
+                           void *notify_baton,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool);
+
+/* Write a snapshot of all entries that the process-global membuffer cache
+ * currently holds for FS to STREAM.  Use SCRATCH_POOL for temporary
+ * allocations.
+ *
+ * The snapshot can later be fed into svn_fs_fs__load_cache() or be
+ * configured in fsfs.conf to be loaded automatically when FS gets opened.
+ * It is specific to the Subversion release and the platform.
+ */
+svn_error_t *
+svn_fs_fs__dump_cache(svn_fs_t *fs,
+                      svn_stream_t *stream,
+                      apr_pool_t *scratch_pool);
+
+/* Add the cache contents from the snapshot in STREAM that has been
+ * written by svn_fs_fs__dump_cache() to the process-global membuffer cache.
+ * Set *LOADED to FALSE if the snapshot does not match FS, e.g. because it
+ * has been taken for a different repository or FS has been packed since.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__load_cache(svn_boolean_t *loaded,
+                      svn_fs_t *fs,
+                      svn_stream_t *stream,
+                      apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
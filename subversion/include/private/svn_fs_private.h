@@ -211,6 +211,53 @@ svn_fs__get_deleted_node(svn_fs_root_t **node_root,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool);
 
+/** A contiguous range of bytes within a file. */
+typedef struct svn_fs__file_region_t
+{
+  /** Offset of the first byte. */
+  apr_off_t offset;
+
+  /** Number of bytes. */
+  svn_filesize_t length;
+} svn_fs__file_region_t;
+
+/** Try to locate the contents of the file @a path in @a root as a list of
+ * byte ranges within a single file on disk.  On success, set @a *file to
+ * that file, opened for reading, and @a *regions to an array of
+ * #svn_fs__file_region_t that, concatenated in order, form the contents.
+ * Otherwise, set @a *file to @c NULL.
+ *
+ * This is intended to support sending large file contents using OS-level
+ * zero-copy mechanisms such as @c sendfile.  Contents that are not stored
+ * verbatim, e.g. deltified against other contents or compressed, or that
+ * are not committed yet will never be found.  Backends that don't support
+ * this will always set @a *file to @c NULL.  The caller must not modify
+ * @a *file and should not rely on its current position.  The contents are
+ * not verified against their checksum.
+ *
+ * Allocate @a *file and @a *regions in @a result_pool while using
+ * @a scratch_pool for temporaries.
+ */
+svn_error_t *
+svn_fs__try_get_contents_regions(apr_file_t **file,
+                                 apr_array_header_t **regions,
+                                 svn_fs_root_t *root,
+                                 const char *path,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool);
+
+/**
+ * Tag all access traces of @a fs with @a request_id from now on, so that
+ * they can be matched with the client request being served.  Pass @c NULL
+ * to remove the tag.  @a request_id is not copied and must remain valid
+ * until it gets replaced.
+ *
+ * @see svn_trace__t
+ */
+void
+svn_fs__set_request_id(svn_fs_t *fs,
+                       const char *request_id);
+
 
 /** @} */
 
@@ -85,12 +85,120 @@ svn_io__file_lock_autocreate(const char *lock_file,
                              apr_pool_t *pool);
 
 
+/* One read request for svn_io__file_prefetch().
+ * @since New in 1.10. */
+typedef struct svn_io__read_request_t
+{
+  /* Position in the file to read from. */
+  apr_off_t offset;
+
+  /* Number of bytes to read. */
+  apr_size_t len;
+} svn_io__read_request_t;
+
+/* Tell the OS that the @a count ranges given in @a requests in @a file
+ * will be read soon, so it can fetch them asynchronously and all at once.
+ * This is merely a hint and may be a no-op.  Use @a scratch_pool for
+ * temporary allocations.
+ * @since New in 1.10. */
+svn_error_t *
+svn_io__file_prefetch(apr_file_t *file,
+                      const svn_io__read_request_t *requests,
+                      int count,
+                      apr_pool_t *scratch_pool);
+
 /** Return the underlying file, if any, associated with the stream, or
  * NULL if not available.  Accessing the file bypasses the stream.
  */
 apr_file_t *
 svn_stream__aprfile(svn_stream_t *stream);
 
+/* Borrow handler function for a generic stream, see svn_stream__borrow().
+ * @since New in 1.10. */
+typedef svn_error_t *(*svn_stream__borrow_fn_t)(void *baton,
+                                                const char **data,
+                                                apr_size_t *len);
+
+/* Gather write handler function for a generic stream, see
+ * svn_stream__writev().
+ * @since New in 1.10. */
+typedef svn_error_t *(*svn_stream__writev_fn_t)(void *baton,
+                                                const svn_string_t *vec,
+                                                int count);
+
+/* Set @a stream's borrow function to @a borrow_fn.
+ * @since New in 1.10. */
+void
+svn_stream__set_borrow(svn_stream_t *stream,
+                       svn_stream__borrow_fn_t borrow_fn);
+
+/* Set @a stream's gather write function to @a writev_fn.
+ * @since New in 1.10. */
+void
+svn_stream__set_writev(svn_stream_t *stream,
+                       svn_stream__writev_fn_t writev_fn);
+
+/* Return whether @a stream supports svn_stream__borrow().
+ * @since New in 1.10. */
+svn_boolean_t
+svn_stream__supports_borrow(svn_stream_t *stream);
+
+/* Read up to @a *len bytes from @a stream without copying them into a
+ * caller-provided buffer.  Set @a *data to the next data in @a stream
+ * and @a *len to the number of bytes available there, which may be less
+ * than requested.  The data is consumed from @a stream and remains
+ * valid until the next operation on @a stream.  @a *len will only be
+ * set to 0 at the end of the stream.
+ *
+ * Return SVN_ERR_STREAM_NOT_SUPPORTED, if @a stream does not support
+ * borrowing, see svn_stream__supports_borrow().
+ * @since New in 1.10. */
+svn_error_t *
+svn_stream__borrow(svn_stream_t *stream,
+                   const char **data,
+                   apr_size_t *len);
+
+/* Write the @a count pieces of data in @a vec to @a stream, in order.
+ * Streams without a gather write function will see one
+ * svn_stream_write() call per non-empty piece.
+ * @since New in 1.10. */
+svn_error_t *
+svn_stream__writev(svn_stream_t *stream,
+                   const svn_string_t *vec,
+                   int count);
+
+/* Return a stream that reads STREAM on a separate thread, staying up to
+ * BLOCK_COUNT chunks of SVN__STREAM_CHUNK_SIZE bytes ahead of the reader.
+ * This lets the caller process data while the next data is being read.
+ * Closing the result will close STREAM.  Allocate the result in
+ * RESULT_POOL.
+ *
+ * Reading STREAM must not allocate from pools used by other threads;
+ * e.g. open it in a pool of its own.  Stopping the worker early, i.e.
+ * closing the stream before the end of STREAM, has to wait for pending
+ * reads to return.
+ *
+ * If threads are not supported or BLOCK_COUNT is less than 2, or the
+ * worker thread could not be started, return STREAM itself.
+ */
+svn_stream_t *
+svn_stream__read_ahead(svn_stream_t *stream,
+                       int block_count,
+                       apr_pool_t *result_pool);
+
+/* Return a stream that decompresses all data read and compresses all
+ * data written using LZ4, in independent blocks of 64 kB.  STREAM is
+ * used to read and write all compressed data.  Closing the
+ * result flushes pending data and closes STREAM.  Allocate the result
+ * in RESULT_POOL.
+ *
+ * Reading and writing fails with SVN_ERR_UNSUPPORTED_FEATURE, if this
+ * build does not support LZ4, see svn__lz4_supported().
+ */
+svn_stream_t *
+svn_stream__lz4_compressed(svn_stream_t *stream,
+                           apr_pool_t *result_pool);
+
 /* Creates as *INSTALL_STREAM a stream that once completed can be installed
    using Windows checkouts much slower than Unix.
 
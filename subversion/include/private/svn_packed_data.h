@@ -235,6 +235,18 @@ svn_packed__get_uint(svn_packed__int_stream_t *stream);
 apr_int64_t
 svn_packed__get_int(svn_packed__int_stream_t *stream);
 
+/* Read the next COUNT numbers from STREAM as unsigned integers into
+ * VALUES.  Entries beyond the end of the stream will be set to 0.
+ *
+ * This is equivalent to calling svn_packed__get_uint() COUNT times but
+ * decodes streams without sub-streams in a single pass.  Use it to read
+ * whole columns of structured data.
+ */
+void
+svn_packed__get_uints(svn_packed__int_stream_t *stream,
+                      apr_uint64_t *values,
+                      apr_size_t count);
+
 /* Return the next byte sequence from STREAM and set *LEN to the length
  * of that sequence.  Sets *LEN to 0 when reading beyond the end of the
  * stream.
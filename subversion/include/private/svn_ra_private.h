@@ -32,6 +32,7 @@
 #include "svn_error.h"
 #include "svn_ra.h"
 #include "svn_delta.h"
+#include "svn_diff.h"
 #include "svn_editor.h"
 #include "svn_io.h"
 
@@ -83,6 +84,57 @@ svn_ra__assert_capable_server(svn_ra_session_t *ra_session,
                               const char *path_or_url,
                               apr_pool_t *pool);
 
+/* Like svn_ra_check_path() but for all session-relative PATHS (const
+   char *) at once.  Set *KINDS to an array of svn_node_kind_t, allocated
+   in RESULT_POOL, with one element per element in PATHS.
+
+   RA layers may process all paths in a single request, saving one
+   network round-trip per path.  If checking any of the paths fails,
+   return that error.
+
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_ra__check_paths(svn_ra_session_t *session,
+                    apr_array_header_t **kinds,
+                    const apr_array_header_t *paths,
+                    svn_revnum_t revision,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool);
+
+/* Callback type for svn_ra__blame().  START_LINE is the 0-based index of
+   the first line of a range of lines that were last changed in REVISION,
+   which has the revision properties REV_PROPS.  The range ends where the
+   next one starts or at the end of the file.  REVISION is
+   SVN_INVALID_REVNUM and REV_PROPS is NULL for lines that were last
+   changed before the start of the blame range. */
+typedef svn_error_t *(*svn_ra__blame_receiver_t)(void *baton,
+                                                 apr_int64_t start_line,
+                                                 svn_revnum_t revision,
+                                                 apr_hash_t *rev_props,
+                                                 apr_pool_t *scratch_pool);
+
+/* Let the server attribute each line of the file at session-relative PATH
+   in revision END to the revision between START and END that last changed
+   it, comparing revisions with DIFF_OPTIONS.  Report the result to
+   RECEIVER with RECEIVER_BATON, in line order.
+
+   Only the final attribution gets transferred instead of every revision
+   of the file.  START must not be greater than END.  Merge tracking is
+   not supported.  If the RA layer or the server can't do this, return
+   SVN_ERR_RA_NOT_IMPLEMENTED; the caller then has to fall back to
+   svn_ra_get_file_revs2().
+
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_ra__blame(svn_ra_session_t *session,
+              const char *path,
+              svn_revnum_t start,
+              svn_revnum_t end,
+              const svn_diff_file_options_t *diff_options,
+              svn_ra__blame_receiver_t receiver,
+              void *receiver_baton,
+              apr_pool_t *scratch_pool);
+
 
 /*** Operational Locks ***/
 
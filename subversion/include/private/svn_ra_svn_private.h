@@ -141,6 +141,14 @@ svn_ra_svn__set_shim_callbacks(svn_ra_svn_conn_t *conn,
 apr_pool_t *
 svn_ra_svn__get_pool(svn_ra_svn_conn_t *conn);
 
+/**
+ * Return the svndiff version to use when sending deltas over @a conn.
+ * That depends on the compression level configured for @a conn and
+ * on the capabilities announced by the other side.
+ */
+int
+svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn);
+
 /**
  * @defgroup ra_svn_deprecated ra_svn low-level functions
  * @{
@@ -164,6 +172,20 @@ svn_ra_svn__write_string(svn_ra_svn_conn_t *conn,
                          apr_pool_t *pool,
                          const svn_string_t *str);
 
+/** Write @a len bytes from @a file, starting at @a offset, as a string
+ * over the net.  Where possible, the data will be sent without copying it
+ * through user-space buffers.  The current position of @a file may change.
+ *
+ * Writes will be buffered until the next read or flush but the string
+ * contents themselves may be sent immediately.
+ */
+svn_error_t *
+svn_ra_svn__write_string_from_file(svn_ra_svn_conn_t *conn,
+                                   apr_pool_t *pool,
+                                   apr_file_t *file,
+                                   apr_off_t offset,
+                                   apr_size_t len);
+
 /** Write a cstring over the net.
  *
  * Writes will be buffered until the next read or flush.
@@ -220,6 +242,18 @@ svn_error_t *
 svn_ra_svn__flush(svn_ra_svn_conn_t *conn,
                   apr_pool_t *pool);
 
+/** Compress all further traffic on @a conn in both directions as
+ * described for the "lz4-stream" capability in the protocol docs.
+ * Pending output gets flushed first.  This is a no-op if @a conn has
+ * been compressed already.
+ *
+ * Return @c SVN_ERR_UNSUPPORTED_FEATURE if this build does not support
+ * LZ4.  Use @a pool for temporary allocations.
+ */
+svn_error_t *
+svn_ra_svn__enable_lz4_stream(svn_ra_svn_conn_t *conn,
+                              apr_pool_t *pool);
+
 /** Write a tuple, using a printf-like interface.
  *
  * The format string @a fmt may contain:
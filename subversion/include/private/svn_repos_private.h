@@ -33,9 +33,11 @@
 #include "svn_repos.h"
 #include "svn_editor.h"
 #include "svn_config.h"
+#include "svn_diff.h"
 
 #include "private/svn_object_pool.h"
 #include "private/svn_string_private.h"
+#include "private/svn_trace.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -119,6 +121,25 @@ svn_repos__get_commit_ev2(svn_editor_t **editor,
                           apr_pool_t *result_pool,
                           apr_pool_t *scratch_pool);
 
+/* Like svn_repos_replay2() but, if BASE_ROOT is not NULL, use it as the
+ * root to compute the deltas against.  It must be the revision root of
+ * the revision preceding ROOT or, if ROOT is a transaction root, of its
+ * base revision.  When replaying consecutive revisions, pass the previous
+ * revision's ROOT here to make its already looked-up nodes and contents
+ * the delta sources.
+ */
+svn_error_t *
+svn_repos__replay_with_base(svn_fs_root_t *root,
+                            svn_fs_root_t *base_root,
+                            const char *base_path,
+                            svn_revnum_t low_water_mark,
+                            svn_boolean_t send_deltas,
+                            const svn_delta_editor_t *editor,
+                            void *edit_baton,
+                            svn_repos_authz_func_t authz_read_func,
+                            void *authz_read_baton,
+                            apr_pool_t *pool);
+
 svn_error_t *
 svn_repos__replay_ev2(svn_fs_root_t *root,
                       const char *base_dir,
@@ -162,7 +183,7 @@ svn_repos__get_logs_compat(svn_repos_t *repos,
  * from multiple threads.  Configuration objects no longer referenced by
  * any user may linger for a while before being cleaned up.
  */
-typedef svn_object_pool__t svn_repos__config_pool_t;
+typedef struct svn_repos__config_pool_t svn_repos__config_pool_t;
 
 /* Create a new configuration pool object with a lifetime determined by
  * POOL and return it in *CONFIG_POOL.
@@ -189,6 +210,11 @@ svn_repos__config_pool_create(svn_repos__config_pool_t **config_pool,
  * instead of creating a new repo instance.  Note that this might not
  * return the latest content.
  *
+ * Local configuration files that have been read before will only be
+ * read again if their timestamp or size changed.  Within a second after
+ * such a check, they will not even be looked at.  So, modifications may
+ * take up to that long to become visible.
+ *
  * POOL determines the minimum lifetime of *CFG (may remain cached after
  * release) but must not exceed the lifetime of the pool provided to
  * #svn_repos__config_pool_create.
@@ -325,6 +351,92 @@ svn_repos__dump_node_record(svn_stream_t *dump_stream,
                             svn_boolean_t content_length_always,
                             apr_pool_t *scratch_pool);
 
+/* Like svn_repos_authz_read3() but if RELOAD_IN_BACKGROUND is set, the
+ * authz cache has been enabled by svn_repos_authz_initialize() and PATH
+ * or GROUPS_PATH changed since the last call, parse the new contents in
+ * a separate thread.  Until that has been completed, return the model
+ * read by the previous call instead.  Errors in the new contents will
+ * be reported by later calls.
+ *
+ * This trades a short period of outdated access rules for not blocking
+ * all callers while large authz files are being parsed.
+ */
+svn_error_t *
+svn_repos__authz_read(svn_authz_t **authz_p,
+                      const char *path,
+                      const char *groups_path,
+                      svn_boolean_t must_exist,
+                      svn_boolean_t reload_in_background,
+                      svn_repos_t *repos_hint,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool);
+
+/* Let the reporter REPORT_BATON, created by svn_repos_begin_report3(),
+ * use AUTHZ_CALLBACK with AUTHZ_BATON to find out whether a target
+ * directory and everything below it is readable.  The reporter asks this
+ * once per directory and then skips the individual checks with the
+ * authz_read_func for all paths in that sub-tree.
+ *
+ * AUTHZ_CALLBACK must support #svn_authz_recursive.  It is only used
+ * if the report has an authz_read_func and must never grant more access
+ * than that function would.  Call this before the report is finished.
+ */
+void
+svn_repos__report_set_subtree_authz(void *report_baton,
+                                    svn_repos_authz_callback_t authz_callback,
+                                    void *authz_baton);
+
+/* Callback type for svn_repos__blame().  START_LINE is the 0-based index
+ * of the first line of a range of lines that were last changed in
+ * REVISION, which has the revision properties REV_PROPS.  The range ends
+ * where the next one starts or at the end of the file.  REVISION is
+ * SVN_INVALID_REVNUM and REV_PROPS is NULL for lines that were last
+ * changed before the start of the blame range.
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+typedef svn_error_t *(*svn_repos__blame_receiver_t)(
+  void *baton,
+  apr_int64_t start_line,
+  svn_revnum_t revision,
+  apr_hash_t *rev_props,
+  apr_pool_t *scratch_pool);
+
+/* Attribute each line of the file at PATH in revision END of REPOS to the
+ * revision between START and END that last changed it, comparing the
+ * revisions of the file with DIFF_OPTIONS.  Report the result to RECEIVER
+ * with RECEIVER_BATON, one range of lines at a time and in line order.
+ *
+ * This is what svn_client_blame5() does without merge tracking, but it
+ * runs next to the repository and only needs to transfer the result.
+ * START must not be greater than END.  Check path readability with
+ * AUTHZ_READ_FUNC and AUTHZ_READ_BATON, like svn_repos_get_file_revs2().
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_repos__blame(svn_repos_t *repos,
+                 const char *path,
+                 svn_revnum_t start,
+                 svn_revnum_t end,
+                 const svn_diff_file_options_t *diff_options,
+                 svn_repos_authz_func_t authz_read_func,
+                 void *authz_read_baton,
+                 svn_repos__blame_receiver_t receiver,
+                 void *receiver_baton,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool);
+
+/* Record the spans of the operations on REPOS in TRACE from now on, and
+ * tag the events traced by its filesystem with the request ID of TRACE.
+ * TRACE may be NULL to stop tracing.  The caller must make sure TRACE
+ * remains valid until it gets replaced or REPOS is no longer used.
+ */
+void
+svn_repos__set_trace(svn_repos_t *repos,
+                     svn_trace__t *trace);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -196,6 +196,15 @@ svn_skel__parse_proplist(apr_hash_t **proplist_p,
                          const svn_skel_t *skel,
                          apr_pool_t *result_pool);
 
+/* Like svn_skel__parse_proplist(), but parse the `PROPLIST' skel directly
+   from the LEN bytes at DATA without building an svn_skel_t tree.  All
+   names and values get copied into a single block in RESULT_POOL.  */
+svn_error_t *
+svn_skel__parse_proplist_data(apr_hash_t **proplist_p,
+                              const char *data,
+                              apr_size_t len,
+                              apr_pool_t *result_pool);
+
 /* Parse a `IPROPS' SKEL into a depth-first ordered array of
    svn_prop_inherited_item_t * structures *IPROPS. Use RESULT_POOL
    for all allocations.  */
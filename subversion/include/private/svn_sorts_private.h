@@ -74,6 +74,10 @@ svn_sort__hash(apr_hash_t *ht,
 
 /* Sort APR array @a array using ordering defined by @a comparison_func.
  * @a comparison_func is defined as for the C stdlib function qsort().
+ *
+ * Arrays of <tt>const char *</tt> sorted by svn_sort_compare_paths() use
+ * a specialized algorithm that does not call @a comparison_func at all.
+ * The same goes for svn_sort__hash() and svn_sort_compare_items_as_paths().
  */
 void
 svn_sort__array(apr_array_header_t *array,
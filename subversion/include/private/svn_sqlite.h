@@ -133,6 +133,27 @@ svn_sqlite__open(svn_sqlite__db_t **db, const char *path,
 svn_error_t *
 svn_sqlite__close(svn_sqlite__db_t *db);
 
+/* Limit the page cache of DB to about KILOBYTES KiB. */
+svn_error_t *
+svn_sqlite__set_cache_size(svn_sqlite__db_t *db,
+                           int kilobytes);
+
+/* Switch DB to write-ahead logging with synchronous=NORMAL and let SQLite
+   map up to MMAP_SIZE bytes of the database into memory.  Writers then no
+   longer block readers and commits only append to the log.
+
+   WAL requires shared memory between all connections to DB, so use this
+   only for databases on local disks.  The journal mode is persistent and
+   svn_sqlite__open() keeps it, so it stays in effect for all connections
+   that open DB later, whether they call this function or not. */
+svn_error_t *
+svn_sqlite__enable_wal(svn_sqlite__db_t *db,
+                       apr_int64_t mmap_size);
+
+/* Return TRUE if a transaction or savepoint is active in DB. */
+svn_boolean_t
+svn_sqlite__in_transaction(svn_sqlite__db_t *db);
+
 /* Add a custom function to be used with this database connection.  The data
    in BATON should live at least as long as the connection in DB.
 
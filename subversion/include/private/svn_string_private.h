@@ -326,6 +326,39 @@ svn_prefix_string__compare(const svn_prefix_string__t *lhs,
 
 /** @} */
 
+/**
+ * Interning stores each distinct string value only once, so that repeated
+ * values such as paths share their storage and equal interned strings can
+ * be compared by pointer.
+ *
+ * @defgroup svn_string_intern String interning.
+ * @{
+ */
+
+/**
+ * Opaque data type for a string interning table.  It is not thread-safe.
+ */
+typedef struct svn_string__interner_t svn_string__interner_t;
+
+/**
+ * Return a new, empty interning table allocated in @a pool.  All interned
+ * strings will be allocated in @a pool as well.
+ */
+svn_string__interner_t *
+svn_string__interner_create(apr_pool_t *pool);
+
+/**
+ * Return the NUL-terminated copy of the @a len bytes at @a s that is
+ * stored in @a interner, adding it if no such string exists yet.  Equal
+ * strings interned in the same table yield the same pointer.
+ */
+const char *
+svn_string__intern(svn_string__interner_t *interner,
+                   const char *s,
+                   apr_size_t len);
+
+/** @} */
+
 /** @} */
 
 
@@ -118,7 +118,8 @@ const char *
 svn_spillbuf__get_filename(const svn_spillbuf_t *buf);
 
 /* Retrieve the handle of the spill file. The returned value can be
-   NULL if the file has not been created yet. */
+   NULL if the file has not been created yet. The caller must not move
+   the file pointer of the returned file. */
 apr_file_t *
 svn_spillbuf__get_file(const svn_spillbuf_t *buf);
 
@@ -295,6 +296,18 @@ svn_checksum__wrap_write_stream_fnv1a_32x4(apr_uint32_t *digest,
                                            svn_stream_t *inner_stream,
                                            apr_pool_t *pool);
 
+/**
+ * Feed @a len bytes from @a data into both checksum contexts @a ctx1 and
+ * @a ctx2.  This is equivalent to calling svn_checksum_update() for each
+ * of them but processes @a data in cache-sized pieces, such that large
+ * buffers get read from memory only once.
+ */
+svn_error_t *
+svn_checksum__update_both(svn_checksum_ctx_t *ctx1,
+                          svn_checksum_ctx_t *ctx2,
+                          const void *data,
+                          apr_size_t len);
+
 /**
  * Return a 32 bit FNV-1a checksum for the first @a len bytes in @a input.
  *
@@ -428,6 +441,23 @@ svn_hash__read_entry(svn_hash__entry_t *entry,
                      svn_boolean_t incremental,
                      apr_pool_t *pool);
 
+/** Like svn_hash_read2() but read the serialized hash from the @a len
+ * bytes at @a data instead of a stream.  @a data[@a len] must be NUL.
+ *
+ * Rather than copying them, the keys and values added to @a hash point
+ * into @a data, which must therefore remain valid as long as @a hash is
+ * being used.  To make them NUL-terminated, @a data gets modified.
+ * Only the #svn_string_t structures are allocated in @a pool.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_hash__read_buffer(apr_hash_t *hash,
+                      char *data,
+                      apr_size_t len,
+                      const char *terminator,
+                      apr_pool_t *pool);
+
 /** @} */
 
 /** @} */
@@ -555,6 +585,26 @@ svn__decode_int(apr_int64_t *val,
                 const unsigned char *p,
                 const unsigned char *end);
 
+/* Decode up to *COUNT unsigned integers from the range [P..END-1] into
+ * VALUES and set *COUNT to the number of values actually decoded.  Return
+ * a pointer to the byte after the last decoded integer.
+ *
+ * Unlike svn__decode_uint(), this expects the low-order 7 bits to be
+ * encoded first, as used by packed data containers and FSFS index files.
+ * Decoding stops at the first integer that is incomplete or longer than
+ * SVN__MAX_ENCODED_UINT_LEN bytes.  If ENDS is not NULL, set ENDS[I] to
+ * the offset of the byte after the I-th integer, relative to P.
+ *
+ * Runs of single-byte values get decoded many at a time using SIMD
+ * instructions, if available.
+ */
+const unsigned char *
+svn__decode_uints(apr_uint64_t *values,
+                  apr_size_t *ends,
+                  apr_size_t *count,
+                  const unsigned char *p,
+                  const unsigned char *end);
+
 /* Compress the data from DATA with length LEN, it according to the
  * specified COMPRESSION_METHOD and write the result to OUT.
  * SVN__COMPRESSION_NONE is valid for COMPRESSION_METHOD.
@@ -573,6 +623,35 @@ svn__decompress(const void *data, apr_size_t len,
                 svn_stringbuf_t *out,
                 apr_size_t limit);
 
+/* Compress the data from DATA with length LEN using LZ4 and write the
+ * result to OUT.  Like svn__compress(), the output will be prefixed with
+ * the original length and data for which compression does not pay off
+ * will be stored uncompressed.
+ *
+ * Return SVN_ERR_UNSUPPORTED_FEATURE if this build does not support LZ4,
+ * see svn__lz4_supported().
+ */
+svn_error_t *
+svn__compress_lz4(const void *data, apr_size_t len,
+                  svn_stringbuf_t *out);
+
+/* Decompress the LZ4-compressed data from DATA with length LEN and write
+ * the result to OUT.  Return an error if the decompressed size is larger
+ * than LIMIT.
+ *
+ * Return SVN_ERR_UNSUPPORTED_FEATURE if this build does not support LZ4,
+ * see svn__lz4_supported().
+ */
+svn_error_t *
+svn__decompress_lz4(const void *data, apr_size_t len,
+                    svn_stringbuf_t *out,
+                    apr_size_t limit);
+
+/* Return TRUE, if this build has been linked against LZ4, i.e. if
+ * svn__compress_lz4() and svn__decompress_lz4() are available. */
+svn_boolean_t
+svn__lz4_supported(void);
+
 /** @} */
 
 /**
@@ -600,7 +679,9 @@ apr_pool_t *
 svn_root_pools__acquire_pool(svn_root_pools__t *pools);
 
 /* Clear and release the given root POOL and put it back into POOLS.
- * If that fails, destroy POOL.
+ * If that fails, destroy POOL.  Each thread keeps the last pool it
+ * released for its next acquisition.  Beyond that, POOLS retains only a
+ * limited number of unused pools and destroys any excess.
  */
 void
 svn_root_pools__release_pool(apr_pool_t *pool,
@@ -720,6 +801,14 @@ const char *svn_zlib__compiled_version(void);
 /* Return the zlib version we run against. */
 const char *svn_zlib__runtime_version(void);
 
+/* Return the LZ4 version we compiled against or NULL, if we were compiled
+   without LZ4 support. */
+const char *svn_lz4__compiled_version(void);
+
+/* Return the LZ4 version we run against or NULL, if we were compiled
+   without LZ4 support. */
+const char *svn_lz4__runtime_version(void);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
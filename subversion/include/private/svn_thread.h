@@ -0,0 +1,70 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_thread.h
+ * @brief Running batches of independent jobs on several threads
+ */
+
+#ifndef SVN_THREAD_H
+#define SVN_THREAD_H
+
+#include <apr_tables.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/** Callback processing @a job, an element of the batch passed to
+ * svn_thread__run_batch() together with @a baton.
+ *
+ * @a thread_index identifies the calling thread: 0 for the thread that
+ * called svn_thread__run_batch() and 1 up to the number of additional
+ * threads for the others.  No two threads share the same index, so it may
+ * be used to select per-thread resources such as RA sessions.
+ *
+ * Jobs run concurrently.  Implementations must therefore return their
+ * results, including errors, through @a job and may only allocate from
+ * pools that are used by the current job alone.
+ */
+typedef void (*svn_thread__job_func_t)(void *job,
+                                       int thread_index,
+                                       void *baton);
+
+/** Call @a worker_fn with @a baton for each element of @a jobs, an array
+ * of @c void *, using up to @a max_threads threads including the calling
+ * one.  Return after all jobs have been processed.
+ *
+ * The jobs are started in array order but may finish in any order.  If
+ * APR has been compiled without thread support, or if threads cannot be
+ * created, the calling thread processes the remaining jobs itself.
+ */
+void
+svn_thread__run_batch(const apr_array_header_t *jobs,
+                      svn_thread__job_func_t worker_fn,
+                      void *baton,
+                      int max_threads);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_THREAD_H */
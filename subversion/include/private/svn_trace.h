@@ -0,0 +1,122 @@
+/**
+ * @copyright
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ * @endcopyright
+ *
+ * @file svn_trace.h
+ * @brief Timing spans of requests across client and server
+ */
+
+#ifndef SVN_TRACE_H
+#define SVN_TRACE_H
+
+#include <apr_pools.h>
+#include <apr_time.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * A trace collects the time spent in the phases of one request, or a
+ * series of requests, under a request ID.  The client generates the ID
+ * and sends it along with its requests, so that the spans recorded by
+ * the client, the server and the repository backend can be matched up.
+ *
+ * Spans get appended to a trace file as text, one line per span with the
+ * tab-separated fields
+ *
+ *   <start> <request-id> <component> <phase> <detail> <duration>
+ *
+ * with START and DURATION in microseconds and "-" for an empty DETAIL.
+ * Lines are buffered and written when the buffer is full and when the
+ * trace's pool gets cleaned up.  Multiple traces and processes may share
+ * one file.
+ *
+ * A trace must not be used by multiple threads at the same time.
+ */
+typedef struct svn_trace__t svn_trace__t;
+
+/**
+ * Return a new trace allocated in @a pool that appends to the file at
+ * @a path.  If @a request_id is @c NULL, generate a new, unique ID.
+ *
+ * @a path may be @c NULL.  The trace will then discard all spans but
+ * can still be used to pass the request ID around.
+ */
+svn_trace__t *
+svn_trace__create(const char *path,
+                  const char *request_id,
+                  apr_pool_t *pool);
+
+/**
+ * Return a new trace allocated in @a pool that appends to the same file
+ * as @a trace under the same request ID.  Return @c NULL if @a trace is
+ * @c NULL.
+ */
+svn_trace__t *
+svn_trace__dup(const svn_trace__t *trace,
+               apr_pool_t *pool);
+
+/** Maximum length of a request ID accepted from the network. */
+#define SVN_TRACE__MAX_REQUEST_ID_LEN 64
+
+/**
+ * Return TRUE if @a request_id may be used as the ID of a trace: it must
+ * be non-empty, not longer than #SVN_TRACE__MAX_REQUEST_ID_LEN and consist
+ * of printable ASCII characters other than space only.  Servers use this
+ * to reject IDs that would corrupt their trace files.
+ */
+svn_boolean_t
+svn_trace__valid_request_id(const char *request_id);
+
+/**
+ * Return the request ID of @a trace, or @c NULL if @a trace is @c NULL.
+ */
+const char *
+svn_trace__request_id(const svn_trace__t *trace);
+
+/**
+ * Return the start time to pass to svn_trace__span() for an operation
+ * that is about to begin, or 0 if @a trace is @c NULL.
+ */
+apr_time_t
+svn_trace__start(const svn_trace__t *trace);
+
+/**
+ * Record that @a component spent the time since @a start in @a phase for
+ * @a trace.  @a detail may be @c NULL.  Do nothing if @a trace is @c NULL
+ * or if @a start is 0, i.e. there was no trace when the operation began.
+ * Never fails; tracing must not break the operation being traced.
+ */
+void
+svn_trace__span(svn_trace__t *trace,
+                const char *component,
+                const char *phase,
+                const char *detail,
+                apr_time_t start);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_TRACE_H */
@@ -2018,6 +2018,81 @@ svn_wc__complete_directory_add(svn_wc_context_t *wc_ctx,
                                apr_pool_t *scratch_pool);
 
 
+/* A merge into a working file that is being performed in steps, so that
+   the contents of several files can be merged concurrently.  See
+   svn_wc__merge_prepare(). */
+typedef struct svn_wc__merge_t svn_wc__merge_t;
+
+/* Like svn_wc_merge5(), but only perform the steps that read the working
+   copy database and return the merge in *MERGE.  Don't change the working
+   copy.  If MERGE_PROPS is TRUE, merge PROP_DIFF as svn_wc_merge5() does
+   when it is given a MERGE_PROPS_OUTCOME.
+
+   If COPY_INPUTS is TRUE, svn_wc__merge_run() will use copies of
+   LEFT_ABSPATH and RIGHT_ABSPATH, so that the caller may remove these
+   files before.
+
+   Call svn_wc__merge_run() and then svn_wc__merge_complete() to finish
+   the merge.  Merges of different files may be prepared before completing
+   any of them.
+
+   Allocate *MERGE, with copies of the arguments needed later, in
+   RESULT_POOL, which must not be used by other threads while
+   svn_wc__merge_run() is running.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_wc__merge_prepare(svn_wc__merge_t **merge,
+                      svn_wc_context_t *wc_ctx,
+                      const char *left_abspath,
+                      const char *right_abspath,
+                      const char *target_abspath,
+                      const char *left_label,
+                      const char *right_label,
+                      const char *target_label,
+                      const svn_wc_conflict_version_t *left_version,
+                      const svn_wc_conflict_version_t *right_version,
+                      svn_boolean_t dry_run,
+                      const char *diff3_cmd,
+                      const apr_array_header_t *merge_options,
+                      apr_hash_t *original_props,
+                      const apr_array_header_t *prop_diff,
+                      svn_boolean_t merge_props,
+                      svn_boolean_t copy_inputs,
+                      svn_wc_conflict_resolver_func2_t conflict_func,
+                      void *conflict_baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool);
+
+/* Return TRUE if svn_wc__merge_run() has any work to do for MERGE, i.e.
+   if the file contents need an actual 3-way merge. */
+svn_boolean_t
+svn_wc__merge_needs_run(const svn_wc__merge_t *merge);
+
+/* Merge the file contents for MERGE.  This doesn't access the working copy
+   database, so it may be called for different merges from several threads
+   at once.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_wc__merge_run(svn_wc__merge_t *merge,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *scratch_pool);
+
+/* Complete MERGE after svn_wc__merge_run() and set *MERGE_CONTENT_OUTCOME
+   and, if the merge has been prepared with MERGE_PROPS, set
+   *MERGE_PROPS_OUTCOME as svn_wc_merge5() does.  Unless it is a dry run,
+   install the result in the working copy and invoke the conflict
+   resolver.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_wc__merge_complete(enum svn_wc_merge_outcome_t *merge_content_outcome,
+                       enum svn_wc_notify_state_t *merge_props_outcome,
+                       svn_wc__merge_t *merge,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *scratch_pool);
+
+
 /* Acquire a write lock on LOCAL_ABSPATH or an ancestor that covers
    all possible paths affected by resolving the conflicts in the tree
    LOCAL_ABSPATH.  Set *LOCK_ROOT_ABSPATH to the path of the lock
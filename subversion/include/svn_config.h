@@ -112,6 +112,14 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_HTTP_MAX_CONNECTIONS      "http-max-connections"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_HTTP_CHUNKED_REQUESTS     "http-chunked-requests"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_HTTP_HTTP2                "http-http2"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_HTTP_METADATA_CACHE_TTL   "http-metadata-cache-ttl"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_HTTP_CONTENT_CACHE_SIZE   "http-content-cache-size"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_TRACE_FILE                "trace-file"
 
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_SERF_LOG_COMPONENTS       "serf-log-components"
@@ -161,6 +169,10 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_MEMORY_CACHE_SIZE         "memory-cache-size"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_DIFF_IGNORE_CONTENT_TYPE  "diff-ignore-content-type"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_PARALLEL_DIFF_FETCHES     "parallel-diff-fetches"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_LOG_CACHE_TTL             "log-cache-ttl"
 #define SVN_CONFIG_SECTION_TUNNELS              "tunnels"
 #define SVN_CONFIG_SECTION_AUTO_PROPS           "auto-props"
 /** @since New in 1.8. */
@@ -171,6 +183,20 @@ typedef struct svn_config_t svn_config_t;
 #define SVN_CONFIG_OPTION_SQLITE_EXCLUSIVE_CLIENTS  "exclusive-locking-clients"
 /** @since New in 1.9. */
 #define SVN_CONFIG_OPTION_SQLITE_BUSY_TIMEOUT       "busy-timeout"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_COMPRESS_PRISTINES        "compress-pristines"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE     "shared-pristine-store"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_PARALLEL_EXTERNALS        "parallel-externals"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_CACHE_TEXT_HASHES         "cache-text-hashes"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_MAX_OPEN_WORKING_COPIES   "max-open-working-copies"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_SQLITE_CACHE_SIZE         "sqlite-cache-size"
+/** @since New in 1.10. */
+#define SVN_CONFIG_OPTION_SQLITE_PROFILE            "sqlite-profile"
 /** @} */
 
 /** @name Repository conf directory configuration files strings
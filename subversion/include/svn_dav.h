@@ -205,6 +205,12 @@ extern "C" {
  * @since New in 1.8.  */
 #define SVN_DAV_REPOSITORY_MERGEINFO "SVN-Repository-MergeInfo"
 
+/** This header is sent by clients that trace their requests.  Its value
+ * is the request ID under which the server should record its part of the
+ * work, so that the spans on both sides can be matched up.
+ * @since New in 1.10.  */
+#define SVN_DAV_REQUEST_ID_HEADER "SVN-Request-Id"
+
 /**
  * @name Fulltext MD5 headers
  *
@@ -395,6 +401,15 @@ extern "C" {
 #define SVN_DAV_NS_DAV_SVN_SVNDIFF1\
             SVN_DAV_PROP_NS_DAV "svn/svndiff1"
 
+/** Presence of this in a DAV header in an OPTIONS response indicates
+ * that the transmitter (in this case, the server) knows how to handle
+ * svndiff2 format encoding.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_DAV_NS_DAV_SVN_SVNDIFF2\
+            SVN_DAV_PROP_NS_DAV "svn/svndiff2"
+
 
 /** @} */
 
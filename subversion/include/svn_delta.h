@@ -508,7 +508,13 @@ svn_txdelta_apply(svn_stream_t *source,
  * version is @a svndiff_version. @a compression_level is the zlib
  * compression level from 0 (no compression) and 9 (maximum compression).
  *
+ * Version 0 produces uncompressed windows, version 1 compresses them
+ * with zlib and version 2 with LZ4.  For version 2, @a compression_level
+ * only determines whether compression is enabled (non-zero) or not.
+ * If this build does not support LZ4, version 2 falls back to version 1.
+ *
  * @since New in 1.7.
+ * @since Support for svndiff version 2 is new in 1.10.
  */
 void
 svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
@@ -487,6 +487,14 @@ typedef struct svn_diff_file_options_t
    *
    * @since New in 1.9 */
   int context_size;
+
+  /** Whether to compute the diff with the patience algorithm, which aligns
+   * on lines that are unique in both files.  It usually produces more
+   * readable diffs for reorganized code and is faster on files that
+   * changed almost completely.  The default is @c FALSE.
+   *
+   * @since New in 1.10 */
+  svn_boolean_t patience;
 } svn_diff_file_options_t;
 
 /** Allocate a @c svn_diff_file_options_t structure in @a pool, initializing
@@ -510,6 +518,7 @@ svn_diff_file_options_create(apr_pool_t *pool);
  * - --ignore-eol-style
  * - --show-c-function, -p @since New in 1.5.
  * - --context, -U ARG @since New in 1.9.
+ * - --patience @since New in 1.10.
  * - --unified, -u (for compatibility, does nothing).
  */
 svn_error_t *
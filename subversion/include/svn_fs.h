@@ -166,6 +166,110 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_FSFS_LOG_ADDRESSING       "fsfs-log-addressing"
 
+/** String with a decimal representation of the number of shards that
+ * svn_fs_pack2() may pack concurrently in a FSFS repository.  Values
+ * below 2 mean that shards will be packed one after the other, which
+ * is also the default.  With concurrent packing, the cancellation
+ * callback passed to svn_fs_pack2() may be invoked from multiple threads.
+ *
+ * This option will only be used by svn_fs_pack2() and is otherwise
+ * ignored.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_FS_CONFIG_FSFS_PACK_JOBS            "fsfs-pack-jobs"
+
+/** String with a decimal representation of the number of revisions or
+ * shards that svn_fs_verify() and svn_repos_verify_fs3() may verify
+ * concurrently.  Values below 2 mean that everything will be verified
+ * sequentially, which is also the default.  Notifications and errors
+ * are still reported in revision order.  With concurrent verification,
+ * the cancellation callback may be invoked from multiple threads.
+ *
+ * svn_fs_verify() only supports this for FSFS repositories.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_FS_CONFIG_VERIFY_JOBS               "verify-jobs"
+
+/** String with a decimal representation of the number of worker threads
+ * that svn_repos_finish_report() may use to compute the text deltas of
+ * upcoming files while the editor drive is still busy with earlier ones.
+ * The editor calls themselves are still made in the usual order and from
+ * the calling thread.  Values below 2 disable the workers, which is also
+ * the default.
+ *
+ * The workers open the filesystem themselves and share its caches with
+ * the calling thread.  This option is therefore ignored unless the cache
+ * configuration allows for multiple threads, see
+ * #svn_cache_config_t.single_threaded.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_FS_CONFIG_REPORT_DELTA_JOBS         "report-delta-jobs"
+
+/** String with a decimal representation of the number of revision ranges
+ * that svn_repos_dump_fs4() may dump concurrently.  Values below 2 mean
+ * that all revisions will be dumped sequentially, which is also the
+ * default.  The dump stream and the notifications are still produced in
+ * revision order.  With concurrent dumps, the cancellation callback may
+ * be invoked from multiple threads.
+ *
+ * Like #SVN_FS_CONFIG_REPORT_DELTA_JOBS, this option is ignored unless the
+ * cache configuration allows for multiple threads.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_FS_CONFIG_DUMP_JOBS                 "dump-jobs"
+
+/** String with a decimal representation of the number of sub-trees that
+ * svn_repos_list() may list concurrently when walking a revision root
+ * with infinite depth.  Values below 2 mean that the whole tree will be
+ * walked sequentially, which is also the default.  The entries are still
+ * reported in path order and from the calling thread.  With concurrent
+ * listings, the cancellation callback may be invoked from multiple
+ * threads.
+ *
+ * Like #SVN_FS_CONFIG_REPORT_DELTA_JOBS, this option is ignored unless the
+ * cache configuration allows for multiple threads.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_FS_CONFIG_LIST_JOBS                 "list-jobs"
+
+/** String with a decimal representation of the number of shards that
+ * svn_fs_hotcopy4() may copy concurrently from a FSFS repository.  Values
+ * below 2 mean that shards will be copied one after the other, which is
+ * also the default.  Notifications are still sent in revision order and
+ * the destination's 'current' file advances just like with a sequential
+ * copy.
+ *
+ * This option will only be used by svn_fs_hotcopy4() and is otherwise
+ * ignored.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_FS_CONFIG_FSFS_HOTCOPY_JOBS         "fsfs-hotcopy-jobs"
+
+/** Boolean value ("true" / "false") that makes svn_fs_hotcopy4() create
+ * hard links to the pack and index files of packed shards in a FSFS
+ * repository instead of copying them.  Packed shards never get modified in place, so the
+ * hotcopy only needs to actually copy the revisions that have not been
+ * packed yet and the repository metadata.  Where the destination file
+ * system does not support hard links to the source, the files are copied.
+ * The default is "false".
+ *
+ * Note that the source and the destination will share the disk space
+ * of the linked files and that changing their permissions or ownership
+ * affects both repositories.
+ *
+ * This option will only be used by svn_fs_hotcopy4() and is otherwise
+ * ignored.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_FS_CONFIG_FSFS_HOTCOPY_LINK         "fsfs-hotcopy-link"
+
 /* Note to maintainers: if you add further SVN_FS_CONFIG_FSFS_CACHE_* knobs,
    update fs_fs.c:verify_as_revision_before_current_plus_plus(). */
 
@@ -227,6 +331,19 @@ typedef struct svn_fs_t svn_fs_t;
  */
 #define SVN_FS_CONFIG_NO_FLUSH_TO_DISK          "no-flush-to-disk"
 
+/** Boolean value ("true" / "false") that puts a FSFS filesystem into bulk
+ * load mode, meant for initial imports such as loading a dump file into
+ * a new repository.  In this mode, commits neither flush data to disk
+ * (as with #SVN_FS_CONFIG_NO_FLUSH_TO_DISK) nor update the rep-cache.
+ * The new rep-cache entries are kept in memory, still get used for
+ * rep-sharing by later commits of the same filesystem object, and are
+ * written in large batches.  Call svn_fs_sync() once done to write the
+ * remaining entries and make all data durable.  The default is "false".
+ *
+ * @since New in 1.10.
+ */
+#define SVN_FS_CONFIG_FSFS_BULK_LOAD            "fsfs-bulk-load"
+
 /** @} */
 
 
@@ -553,10 +670,32 @@ typedef void (*svn_fs_hotcopy_notify_t)(void *baton,
  * @a cancel_baton as usual to allow the user to preempt this potentially
  * lengthy operation.
  *
+ * Use the backend-specific configuration @a fs_config when opening the
+ * source and destination filesystems.  @a NULL is valid for all backends.
+ *
  * Use @a scratch_pool for temporary allocations.
  *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_fs_hotcopy4(const char *src_path,
+                const char *dest_path,
+                svn_boolean_t clean,
+                svn_boolean_t incremental,
+                apr_hash_t *fs_config,
+                svn_fs_hotcopy_notify_t notify_func,
+                void *notify_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_fs_hotcopy4(), but with @a fs_config always being @c NULL.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.9 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_hotcopy3(const char *src_path,
                 const char *dest_path,
@@ -671,6 +810,24 @@ svn_fs_freeze(svn_fs_t *fs,
               void *freeze_baton,
               apr_pool_t *pool);
 
+/**
+ * Make everything written to @a fs so far durable: write out data that
+ * @a fs may be holding back, e.g. because of #SVN_FS_CONFIG_FSFS_BULK_LOAD,
+ * and flush the filesystem's files to disk.  This can be used to trade
+ * many small flushes during a long series of operations for a single
+ * large one at the end.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @note The BDB backend takes care of durability itself and this function
+ * does nothing for it.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_fs_sync(svn_fs_t *fs,
+            apr_pool_t *scratch_pool);
+
 
 /** Subversion filesystems based on Berkeley DB.
  *
@@ -1735,6 +1892,37 @@ svn_fs_paths_changed3(svn_fs_path_change_iterator_t **iterator,
                       apr_pool_t *result_pool,
                       apr_pool_t *scratch_pool);
 
+/** Find the revisions between @a start and @a end (inclusive, in either
+ * order) that touched @a path in @a fs.
+ *
+ * A revision touched @a path if its changed paths list contains @a path
+ * itself or anything below it, or if it added, deleted or replaced any
+ * parent of @a path.  Between two consecutive revisions returned, the
+ * node at @a path is therefore the same.
+ *
+ * Set @a *revisions to an array of #svn_revnum_t, youngest first,
+ * allocated in @a result_pool.  If @a limit is positive, stop after
+ * that many revisions.
+ *
+ * This is meant as a cheap filter that helps to avoid reading many change
+ * lists.  If @a fs cannot answer the query without doing just that, set
+ * @a *revisions to @c NULL instead.  Callers must then fall back to
+ * inspecting the revisions themselves.
+ *
+ * Use @a scratch_pool for temporary allocations.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_fs_revisions_changed(apr_array_header_t **revisions,
+                         svn_fs_t *fs,
+                         const char *path,
+                         svn_revnum_t start,
+                         svn_revnum_t end,
+                         int limit,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool);
+
 /** Same as svn_fs_paths_changed3() but returning all changes in a single,
  * large data structure and using a single pool for all allocations.
  *
@@ -1784,6 +1972,28 @@ svn_fs_check_path(svn_node_kind_t *kind_p,
                   const char *path,
                   apr_pool_t *pool);
 
+/** Like svn_fs_check_path() but for many @a paths (const char *) at
+ * once.  Set @a *kinds to an array of #svn_node_kind_t, giving the kind
+ * of node present at each of the @a paths under @a root in the same
+ * order as @a paths.
+ *
+ * The paths may be given in any order.  Backends may resolve them in a
+ * single walk, visiting each parent directory only once.  This is much
+ * cheaper than individual svn_fs_check_path() calls when many of the
+ * paths share parents, e.g. the siblings in a directory tree.
+ *
+ * Allocate @a *kinds in @a result_pool and use @a scratch_pool for
+ * temporary allocations.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_fs_check_paths(apr_array_header_t **kinds,
+                   svn_fs_root_t *root,
+                   const apr_array_header_t *paths,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool);
+
 
 /** An opaque node history object. */
 typedef struct svn_fs_history_t svn_fs_history_t;
@@ -3301,11 +3511,29 @@ typedef svn_error_t *(*svn_fs_pack_notify_t)(void *baton,
                                              apr_pool_t *pool);
 
 /**
- * Possibly update the filesystem located in the directory @a path
- * to use disk space more efficiently.
+ * Possibly update the filesystem located in the directory @a db_path
+ * to use disk space more efficiently.  Use the backend-specific
+ * configuration @a fs_config when opening the filesystem.  @a NULL is
+ * valid for all backends.
+ *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_fs_pack2(const char *db_path,
+             apr_hash_t *fs_config,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool);
+
+/**
+ * Like svn_fs_pack2(), but with @a fs_config always being @c NULL.
  *
  * @since New in 1.6.
+ * @deprecated Provided for backward compatibility with the 1.9 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_fs_pack(const char *db_path,
             svn_fs_pack_notify_t notify_func,
@@ -49,6 +49,7 @@ extern "C" {
 /** Currently-defined capabilities. */
 #define SVN_RA_SVN_CAP_EDIT_PIPELINE "edit-pipeline"
 #define SVN_RA_SVN_CAP_SVNDIFF1 "svndiff1"
+#define SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED "accepts-svndiff2"
 #define SVN_RA_SVN_CAP_ABSENT_ENTRIES "absent-entries"
 /* maps to SVN_RA_CAPABILITY_COMMIT_REVPROPS: */
 #define SVN_RA_SVN_CAP_COMMIT_REVPROPS "commit-revprops"
@@ -70,6 +71,14 @@ extern "C" {
 #define SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE "file-revs-reverse"
 /* maps to SVN_RA_CAPABILITY_LIST */
 #define SVN_RA_SVN_CAP_LIST "list"
+/* server supports the check-path-many command */
+#define SVN_RA_SVN_CAP_CHECK_PATH_MANY "check-path-many"
+/* all traffic after authentication may be LZ4 compressed */
+#define SVN_RA_SVN_CAP_LZ4_STREAM "lz4-stream"
+/* server supports the get-blame command */
+#define SVN_RA_SVN_CAP_BLAME "blame"
+/* server records its work under a client-provided request ID */
+#define SVN_RA_SVN_CAP_REQUEST_ID "request-id"
 
 
 /** ra_svn passes @c svn_dirent_t fields over the wire as a list of
@@ -38,6 +38,7 @@
 #include "svn_fs.h"
 #include "svn_io.h"
 #include "svn_mergeinfo.h"
+#include "svn_version.h"
 
 
 #ifdef __cplusplus
@@ -662,10 +663,33 @@ svn_repos_fs_type(svn_repos_t *repos,
  * @a cancel_baton as usual to allow the user to preempt this potentially
  * lengthy operation.
  * 
+ * Pass @a fs_config to the filesystem layer when opening the source and
+ * destination filesystems; it may be @c NULL.
+ *
  * Use @a scratch_pool for temporary allocations.
  *
+ * @since New in 1.10.
+ */
+svn_error_t *
+svn_repos_hotcopy4(const char *src_path,
+                   const char *dst_path,
+                   svn_boolean_t clean_logs,
+                   svn_boolean_t incremental,
+                   apr_hash_t *fs_config,
+                   svn_repos_notify_func_t notify_func,
+                   void *notify_baton,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *scratch_pool);
+
+/**
+ * Like svn_repos_hotcopy4(), but with @a fs_config always passed as
+ * @c NULL.
+ *
  * @since New in 1.9.
+ * @deprecated Provided for backward compatibility with the 1.9 API.
  */
+SVN_DEPRECATED
 svn_error_t *
 svn_repos_hotcopy3(const char *src_path,
                    const char *dst_path,
@@ -982,6 +1006,98 @@ svn_repos_hooks_setenv(svn_repos_t *repos,
 
 /** @} */
 
+/** @defgroup svn_repos_hook_modules In-process hook modules
+ * @{
+ *
+ * Besides hook programs, a repository may use a hook module: a shared
+ * library at #SVN_REPOS_HOOK_MODULE within the repository's hooks
+ * directory.  Its functions run within the process that accesses the
+ * repository and get to use the already open filesystem.  That makes
+ * them much cheaper than hook programs, which have to be started and
+ * then re-open the repository for every commit.
+ *
+ * A hook module runs before the corresponding hook program, if both
+ * exist.  Any error returned by a module function has the same effect
+ * as a failing hook program, i.e. the start-commit and pre-commit
+ * functions block the commit.
+ *
+ * Because it runs in-process, a hook module can crash or corrupt the
+ * server process.  Only install modules you trust.
+ *
+ * @since New in 1.10.
+ */
+
+/** The name of the hook module file within the repository's hooks
+ * directory.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_REPOS_HOOK_MODULE "hook-module"
+
+/** The name of the function that a hook module must export.  Its
+ * signature is #svn_repos_hook_module_init_t.
+ *
+ * @since New in 1.10.
+ */
+#define SVN_REPOS_HOOK_MODULE_INIT "svn_repos_hook_module_init"
+
+/** The table of functions provided by a hook module.  Any of them may be
+ * @c NULL.  They correspond to the hook programs of the same name and are
+ * called with the same information, using @a scratch_pool for temporary
+ * allocations.
+ *
+ * @note Fields may be added to the end of this structure in future
+ * versions.  Modules must check the @a repos_version passed to their
+ * #svn_repos_hook_module_init_t function and only use fields that exist
+ * in that version.
+ *
+ * @since New in 1.10.
+ */
+typedef struct svn_repos_hook_module_t
+{
+  /** Called before a commit transaction gets created.  @a user may be
+   * @c NULL and @a capabilities is a list of const char *.
+   */
+  svn_error_t *(*start_commit)(svn_repos_t *repos,
+                               const char *user,
+                               const apr_array_header_t *capabilities,
+                               const char *txn_name,
+                               apr_pool_t *scratch_pool);
+
+  /** Called before the transaction @a txn, with @a txn_root being its
+   * root, gets committed.  @a lock_tokens maps the lock tokens supplied
+   * with the commit to the paths they belong to; it may be @c NULL.
+   */
+  svn_error_t *(*pre_commit)(svn_repos_t *repos,
+                             svn_fs_txn_t *txn,
+                             svn_fs_root_t *txn_root,
+                             apr_hash_t *lock_tokens,
+                             apr_pool_t *scratch_pool);
+
+  /** Called after the transaction named @a txn_name has been committed
+   * as revision @a revision.
+   */
+  svn_error_t *(*post_commit)(svn_repos_t *repos,
+                              svn_revnum_t revision,
+                              const char *txn_name,
+                              apr_pool_t *scratch_pool);
+} svn_repos_hook_module_t;
+
+/** The type of the #SVN_REPOS_HOOK_MODULE_INIT function.  Set @a *module
+ * to the function table of the hook module.  The table must remain valid
+ * for the lifetime of the process.  @a repos_version is the version of
+ * the library that loads the module.  Use @a scratch_pool for temporary
+ * allocations.
+ *
+ * @since New in 1.10.
+ */
+typedef svn_error_t *(*svn_repos_hook_module_init_t)(
+  const svn_repos_hook_module_t **module,
+  const svn_version_t *repos_version,
+  apr_pool_t *scratch_pool);
+
+/** @} */
+
 /* ---------------------------------------------------------------*/
 
 /* Reporting the state of a working copy, for updates. */
@@ -1749,6 +1865,11 @@ typedef svn_error_t *(* svn_repos_dirent_receiver_t)(const char *path,
  * Cancellation support is provided in the usual way through the optional
  * @a cancel_func and @a cancel_baton.
  *
+ * If @a root is a revision root and its filesystem has been opened with
+ * #SVN_FS_CONFIG_LIST_JOBS, the sub-directories of @a path may be walked
+ * by multiple threads.  The @a receiver and @a authz_read_func will still
+ * only be called from the calling thread.
+ *
  * @a path must point to a directory and @a depth must be at least
  * @c svn_depth_empty.
  *
@@ -3150,6 +3271,11 @@ typedef svn_error_t *(*svn_repos_verify_callback_t)(void *baton,
  * cancel_baton as argument to see if the caller wishes to cancel the
  * verification.
  *
+ * If #SVN_FS_CONFIG_VERIFY_JOBS has been set in the filesystem config of
+ * @a repos, several revisions may be verified concurrently.  In that case,
+ * @a cancel_func may be called from multiple threads.  All other callbacks
+ * are only invoked from the calling thread and in revision order.
+ *
  * Use @a scratch_pool for temporary allocation.
  *
  * @see svn_repos_verify_callback_t
@@ -3265,6 +3391,11 @@ svn_repos_verify_fs(svn_repos_t *repos,
  * @a cancel_baton as argument to see if the client wishes to cancel
  * the dump.
  *
+ * If #SVN_FS_CONFIG_DUMP_JOBS has been set in the filesystem config of
+ * @a repos, several revisions may be dumped concurrently.  In that case,
+ * @a cancel_func may be called from multiple threads.  All other callbacks
+ * are only invoked from the calling thread and in revision order.
+ *
  * Use @a scratch_pool for temporary allocation.
  *
  * @since New in 1.10.
@@ -37,6 +37,7 @@
 #include "svn_hash.h"
 #include "svn_sorts.h"
 
+#include "private/svn_ra_private.h"
 #include "private/svn_wc_private.h"
 
 #include "svn_private_config.h"
@@ -58,13 +59,24 @@ struct blame
   const struct rev *rev;    /* the responsible revision */
   apr_off_t start;          /* the starting diff-token (line) */
   struct blame *next;       /* the next chunk */
+
+  /* While the chain is being built, the chunks form a treap ordered by
+     START, so that every diff hunk can be applied in logarithmic time
+     instead of walking and shifting all chunks of large files.
+     ADJUST is a shift of START that has not been applied to the chunks
+     below this one, yet. */
+  struct blame *left, *right;
+  apr_uint32_t priority;
+  apr_off_t adjust;
 };
 
 /* A chain of blame chunks */
 struct blame_chain
 {
-  struct blame *blame;      /* linked list of blame chunks */
+  struct blame *root;       /* treap of blame chunks while building */
+  struct blame *blame;      /* linked list of blame chunks when done */
   struct blame *avail;      /* linked list of free blame chunks */
+  apr_uint32_t seed;        /* state of the treap priority generator */
   struct apr_pool_t *pool;  /* Allocate members from this pool. */
 };
 
@@ -141,6 +153,16 @@ blame_create(struct blame_chain *chain,
   blame->rev = rev;
   blame->start = start;
   blame->next = NULL;
+  blame->left = NULL;
+  blame->right = NULL;
+  blame->adjust = 0;
+
+  /* xorshift32; any sufficiently random sequence will do. */
+  chain->seed ^= chain->seed << 13;
+  chain->seed ^= chain->seed >> 17;
+  chain->seed ^= chain->seed << 5;
+  blame->priority = chain->seed;
+
   return blame;
 }
 
@@ -153,33 +175,160 @@ blame_destroy(struct blame_chain *chain,
   chain->avail = blame;
 }
 
-/* Return the blame chunk that contains token OFF, starting the search at
-   BLAME. */
+/* Shift the start-point of BLAME and all chunks below it in the treap
+   by ADJUST tokens.  BLAME may be NULL. */
+static void
+blame_adjust(struct blame *blame, apr_off_t adjust)
+{
+  if (blame)
+    {
+      blame->start += adjust;
+      blame->adjust += adjust;
+    }
+}
+
+/* Apply the pending shift of BLAME to its children. */
+static void
+blame_push(struct blame *blame)
+{
+  if (blame->adjust)
+    {
+      blame_adjust(blame->left, blame->adjust);
+      blame_adjust(blame->right, blame->adjust);
+      blame->adjust = 0;
+    }
+}
+
+/* Split the treap ROOT into *LESS, containing all chunks that start
+   before token OFF, and *REST, containing all others. */
+static void
+blame_split(struct blame **less,
+            struct blame **rest,
+            struct blame *root,
+            apr_off_t off)
+{
+  if (!root)
+    {
+      *less = *rest = NULL;
+    }
+  else
+    {
+      blame_push(root);
+      if (root->start < off)
+        {
+          blame_split(&root->right, rest, root->right, off);
+          *less = root;
+        }
+      else
+        {
+          blame_split(less, &root->left, root->left, off);
+          *rest = root;
+        }
+    }
+}
+
+/* Return the treap containing all chunks of LESS and REST.  All chunks
+   in LESS must start before all chunks in REST. */
 static struct blame *
-blame_find(struct blame *blame, apr_off_t off)
+blame_merge(struct blame *less,
+            struct blame *rest)
+{
+  if (!less)
+    return rest;
+  if (!rest)
+    return less;
+
+  if (less->priority > rest->priority)
+    {
+      blame_push(less);
+      less->right = blame_merge(less->right, rest);
+      return less;
+    }
+  else
+    {
+      blame_push(rest);
+      rest->left = blame_merge(less, rest->left);
+      return rest;
+    }
+}
+
+/* Return the blame chunk that contains token OFF in the treap ROOT. */
+static struct blame *
+blame_find(struct blame *root, apr_off_t off)
 {
   struct blame *prev = NULL;
-  while (blame)
+  while (root)
     {
-      if (blame->start > off) break;
-      prev = blame;
-      blame = blame->next;
+      blame_push(root);
+      if (root->start > off)
+        root = root->left;
+      else
+        {
+          prev = root;
+          root = root->right;
+        }
     }
   return prev;
 }
 
-/* Shift the start-point of BLAME and all subsequence blame-chunks
-   by ADJUST tokens */
+/* Destroy all chunks in the treap ROOT except for KEEP. */
 static void
-blame_adjust(struct blame *blame, apr_off_t adjust)
+blame_destroy_tree(struct blame_chain *chain,
+                   struct blame *root,
+                   struct blame *keep)
 {
-  while (blame)
+  if (root)
     {
-      blame->start += adjust;
-      blame = blame->next;
+      blame_destroy_tree(chain, root->left, keep);
+      blame_destroy_tree(chain, root->right, keep);
+      if (root != keep)
+        blame_destroy(chain, root);
+    }
+}
+
+/* Append the chunks of the treap ROOT, in order, to the list ending at
+   *LAST and update *LAST. */
+static void
+blame_link_tree(struct blame **last,
+                struct blame *root)
+{
+  if (root)
+    {
+      blame_push(root);
+      blame_link_tree(last, root->left);
+      (*last)->next = root;
+      *last = root;
+      blame_link_tree(last, root->right);
+      root->left = root->right = NULL;
     }
 }
 
+/* Append a chunk associated with REV, starting at token START, to CHAIN.
+   START must be larger than that of any chunk in CHAIN. */
+static void
+blame_append(struct blame_chain *chain,
+             const struct rev *rev,
+             apr_off_t start)
+{
+  chain->root = blame_merge(chain->root, blame_create(chain, rev, start));
+}
+
+/* Turn the treap of CHAIN into the linked list CHAIN->BLAME, once all
+   changes have been added. */
+static void
+blame_finish(struct blame_chain *chain)
+{
+  struct blame head;
+  struct blame *last = &head;
+
+  head.next = NULL;
+  blame_link_tree(&last, chain->root);
+  last->next = NULL;
+
+  chain->blame = head.next;
+  chain->root = NULL;
+}
+
 /* Delete the blame associated with the region from token START to
    START + LENGTH */
 static svn_error_t *
@@ -187,37 +336,24 @@ blame_delete_range(struct blame_chain *chain,
                    apr_off_t start,
                    apr_off_t length)
 {
-  struct blame *first = blame_find(chain->blame, start);
-  struct blame *last = blame_find(chain->blame, start + length);
-  struct blame *tail = last->next;
+  struct blame *before, *range, *tail;
 
-  if (first != last)
+  /* The chunks starting within the range get removed, except for the
+     last one, which still covers the lines following the range. */
+  blame_split(&before, &range, chain->root, start);
+  blame_split(&range, &tail, range, start + length + 1);
+  if (range)
     {
-      struct blame *walk = first->next;
-      while (walk != last)
-        {
-          struct blame *next = walk->next;
-          blame_destroy(chain, walk);
-          walk = next;
-        }
-      first->next = last;
-      last->start = start;
-      if (first->start == start)
-        {
-          *first = *last;
-          blame_destroy(chain, last);
-          last = first;
-        }
-    }
+      struct blame *last = blame_find(range, start + length);
 
-  if (tail && tail->start == last->start + length)
-    {
-      *last = *tail;
-      blame_destroy(chain, tail);
-      tail = last->next;
+      blame_destroy_tree(chain, range, last);
+      last->left = last->right = NULL;
+      last->start = start;
+      range = last;
     }
 
   blame_adjust(tail, -length);
+  chain->root = blame_merge(blame_merge(before, range), tail);
 
   return SVN_NO_ERROR;
 }
@@ -230,27 +366,19 @@ blame_insert_range(struct blame_chain *chain,
                    apr_off_t start,
                    apr_off_t length)
 {
-  struct blame *head = chain->blame;
-  struct blame *point = blame_find(head, start);
-  struct blame *insert;
+  struct blame *head, *tail, *point, *insert;
+
+  blame_split(&head, &tail, chain->root, start + 1);
+  point = blame_find(head, start);
 
+  insert = blame_create(chain, point->rev, start + length);
   if (point->start == start)
-    {
-      insert = blame_create(chain, point->rev, point->start + length);
-      point->rev = rev;
-      insert->next = point->next;
-      point->next = insert;
-    }
+    point->rev = rev;
   else
-    {
-      struct blame *middle;
-      middle = blame_create(chain, rev, start);
-      insert = blame_create(chain, point->rev, start + length);
-      middle->next = insert;
-      insert->next = point->next;
-      point->next = middle;
-    }
-  blame_adjust(insert->next, length);
+    head = blame_merge(head, blame_create(chain, rev, start));
+
+  blame_adjust(tail, length);
+  chain->root = blame_merge(blame_merge(head, insert), tail);
 
   return SVN_NO_ERROR;
 }
@@ -297,8 +425,8 @@ add_file_blame(const char *last_file,
 {
   if (!last_file)
     {
-      SVN_ERR_ASSERT(chain->blame == NULL);
-      chain->blame = blame_create(chain, rev, 0);
+      SVN_ERR_ASSERT(chain->root == NULL);
+      blame_append(chain, rev, 0);
     }
   else
     {
@@ -591,6 +719,99 @@ file_rev_handler(void *baton, const char *path, svn_revnum_t revnum,
   return SVN_NO_ERROR;
 }
 
+/* Baton for server_blame_receiver(). */
+struct server_blame_baton
+{
+  struct blame_chain *chain;
+  apr_hash_t *revs;         /* svn_revnum_t -> struct rev * */
+  struct rev *unknown_rev;  /* for lines changed before the start rev */
+};
+
+/* Append the range of lines starting at START_LINE to the blame chain.
+
+   Implements svn_ra__blame_receiver_t. */
+static svn_error_t *
+server_blame_receiver(void *baton,
+                      apr_int64_t start_line,
+                      svn_revnum_t revision,
+                      apr_hash_t *rev_props,
+                      apr_pool_t *scratch_pool)
+{
+  struct server_blame_baton *sbb = baton;
+  struct rev *rev;
+
+  if (!SVN_IS_VALID_REVNUM(revision))
+    rev = sbb->unknown_rev;
+  else
+    {
+      rev = apr_hash_get(sbb->revs, &revision, sizeof(revision));
+      if (!rev)
+        {
+          rev = apr_pcalloc(sbb->chain->pool, sizeof(*rev));
+          rev->revision = revision;
+          if (rev_props)
+            rev->rev_props = svn_prop_hash_dup(rev_props, sbb->chain->pool);
+          apr_hash_set(sbb->revs, &rev->revision, sizeof(rev->revision),
+                       rev);
+        }
+    }
+
+  blame_append(sbb->chain, rev, start_line);
+
+  return SVN_NO_ERROR;
+}
+
+/* Let the server of RA_SESSION attribute the lines of the file at the
+   session URL in FRB->END_REV to revisions, and fetch only that revision
+   of the file, instead of every single one.  On success, set *HANDLED to
+   TRUE, fill FRB->CHAIN and set FRB->LAST_FILENAME.  Set *HANDLED to
+   FALSE if the server can't do this.
+
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+blame_on_server(svn_boolean_t *handled,
+                struct file_rev_baton *frb,
+                svn_ra_session_t *ra_session,
+                apr_pool_t *scratch_pool)
+{
+  struct server_blame_baton sbb;
+  svn_stream_t *stream;
+  const char *filename;
+  svn_error_t *err;
+
+  sbb.chain = frb->chain;
+  sbb.revs = apr_hash_make(scratch_pool);
+  sbb.unknown_rev = apr_pcalloc(frb->mainpool, sizeof(*sbb.unknown_rev));
+  sbb.unknown_rev->revision = SVN_INVALID_REVNUM;
+
+  err = svn_ra__blame(ra_session, "", frb->start_rev, frb->end_rev,
+                      frb->diff_options, server_blame_receiver, &sbb,
+                      scratch_pool);
+  if (err && err->apr_err == SVN_ERR_RA_NOT_IMPLEMENTED)
+    {
+      svn_error_clear(err);
+      *handled = FALSE;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  /* Every file has at least one (possibly empty) range of lines. */
+  if (!frb->chain->root)
+    blame_append(frb->chain, sbb.unknown_rev, 0);
+
+  SVN_ERR(svn_stream_open_unique(&stream, &filename, NULL,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 frb->mainpool, scratch_pool));
+  SVN_ERR(svn_ra_get_file(ra_session, "", frb->end_rev, stream, NULL, NULL,
+                          scratch_pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  frb->last_filename = filename;
+  *handled = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
 /* Ensure that CHAIN_ORIG and CHAIN_MERGED have the same number of chunks,
    and that for every chunk C, CHAIN_ORIG[C] and CHAIN_MERGED[C] have the
    same starting value.  Both CHAIN_ORIG and CHAIN_MERGED should not be
@@ -676,6 +897,7 @@ svn_client_blame5(const char *target,
   svn_stream_t *last_stream;
   svn_stream_t *stream;
   const char *target_abspath_or_url;
+  svn_boolean_t server_blame;
 
   if (start->kind == svn_opt_revision_unspecified
       || end->kind == svn_opt_revision_unspecified)
@@ -777,14 +999,18 @@ svn_client_blame5(const char *target,
   frb.last_rev = NULL;
   frb.last_original_filename = NULL;
   frb.chain = apr_palloc(pool, sizeof(*frb.chain));
+  frb.chain->root = NULL;
   frb.chain->blame = NULL;
   frb.chain->avail = NULL;
+  frb.chain->seed = 2463534242U;
   frb.chain->pool = pool;
   if (include_merged_revisions)
     {
       frb.merged_chain = apr_palloc(pool, sizeof(*frb.merged_chain));
+      frb.merged_chain->root = NULL;
       frb.merged_chain->blame = NULL;
       frb.merged_chain->avail = NULL;
+      frb.merged_chain->seed = 2463534242U;
       frb.merged_chain->pool = pool;
     }
   frb.backwards = (frb.start_rev > frb.end_rev);
@@ -806,16 +1032,24 @@ svn_client_blame5(const char *target,
       frb.prevfilepool = svn_pool_create(pool);
     }
 
+  /* Without merge tracking, the server may be able to do all the work and
+     send us just the result. */
+  if (!include_merged_revisions && !frb.backwards)
+    SVN_ERR(blame_on_server(&server_blame, &frb, ra_session, pool));
+  else
+    server_blame = FALSE;
+
   /* Collect all blame information.
      We need to ensure that we get one revision before the start_rev,
      if available so that we can know what was actually changed in the start
      revision. */
-  SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
-                                frb.backwards ? start_revnum
-                                              : MAX(0, start_revnum-1),
-                                end_revnum,
-                                include_merged_revisions,
-                                file_rev_handler, &frb, pool));
+  if (!server_blame)
+    SVN_ERR(svn_ra_get_file_revs2(ra_session, "",
+                                  frb.backwards ? start_revnum
+                                                : MAX(0, start_revnum-1),
+                                  end_revnum,
+                                  include_merged_revisions,
+                                  file_rev_handler, &frb, pool));
 
   if (end->kind == svn_opt_revision_working)
     {
@@ -882,6 +1116,10 @@ svn_client_blame5(const char *target,
   /* The callback has to have been called at least once. */
   SVN_ERR_ASSERT(frb.last_filename != NULL);
 
+  blame_finish(frb.chain);
+  if (include_merged_revisions)
+    blame_finish(frb.merged_chain);
+
   /* Create a pool for the iteration below. */
   iterpool = svn_pool_create(pool);
 
@@ -73,6 +73,17 @@ typedef struct svn_client__private_ctx_t
 svn_client__private_ctx_t *
 svn_client__get_private_ctx(svn_client_ctx_t *ctx);
 
+/* Set *THREAD_CTX to a copy of CTX that is independent enough to be used
+   by another thread: it gets its own working copy context, a copy of the
+   configuration and a non-interactive authentication baton with the same
+   parameters.  It shares CTX's cancellation callback, which must be
+   thread-safe, but has no notification or conflict callbacks.  Allocate
+   everything in RESULT_POOL. */
+svn_error_t *
+svn_client__create_thread_ctx(svn_client_ctx_t **thread_ctx,
+                              const svn_client_ctx_t *ctx,
+                              apr_pool_t *result_pool);
+
 /* Set *ORIGINAL_REPOS_RELPATH and *ORIGINAL_REVISION to the original location
    that served as the source of the copy from which PATH_OR_URL at REVISION was
    created, or NULL and SVN_INVALID_REVNUM (respectively) if PATH_OR_URL at
@@ -91,6 +102,30 @@ svn_client__get_copy_source(const char **original_repos_relpath,
                             apr_pool_t *result_pool,
                             apr_pool_t *scratch_pool);
 
+/* Like svn_ra_get_log2() with the same parameters, but answer the query
+   from the persistent log cache in the user's configuration area, if
+   SVN_CONFIG_OPTION_LOG_CACHE_TTL in CTX's configuration enables it and
+   the same query has been answered recently enough.  Otherwise, ask the
+   server through RA_SESSION and record the answer in the cache.
+
+   START and END must be valid revision numbers for the cache to be used.
+
+   Use POOL for all allocations. */
+svn_error_t *
+svn_client__get_log_cached(svn_ra_session_t *ra_session,
+                           const apr_array_header_t *paths,
+                           svn_revnum_t start,
+                           svn_revnum_t end,
+                           int limit,
+                           svn_boolean_t discover_changed_paths,
+                           svn_boolean_t strict_node_history,
+                           svn_boolean_t include_merged_revisions,
+                           const apr_array_header_t *revprops,
+                           svn_log_entry_receiver_t receiver,
+                           void *receiver_baton,
+                           svn_client_ctx_t *ctx,
+                           apr_pool_t *pool);
+
 /* Set *START_URL and *START_REVISION (and maybe *END_URL
    and *END_REVISION) to the revisions and repository URLs of one
    (or two) points of interest along a particular versioned resource's
@@ -663,6 +698,11 @@ svn_client__get_inheritable_props(apr_hash_t **wcroot_iprops,
    This must be FALSE if the edit producer is not sending text deltas,
    otherwise the file content checksum comparisons will fail.
 
+   If FETCH_CTX is not NULL and TEXT_DELTAS is TRUE, file contents may be
+   fetched through up to SVN_CONFIG_OPTION_PARALLEL_DIFF_FETCHES separate
+   RA sessions, opened with copies of FETCH_CTX, on as many threads.  The
+   changes are still reported to PROCESSOR in the order of the edit drive.
+
    EDITOR/EDIT_BATON return the newly created editor and baton.
 
    @since New in 1.8.
@@ -675,6 +715,7 @@ svn_client__get_diff_editor2(const svn_delta_editor_t **editor,
                              svn_revnum_t revision,
                              svn_boolean_t text_deltas,
                              const svn_diff_tree_processor_t *processor,
+                             svn_client_ctx_t *fetch_ctx,
                              svn_cancel_func_t cancel_func,
                              void *cancel_baton,
                              apr_pool_t *result_pool);
@@ -691,16 +691,33 @@ harvest_status_callback(void *status_baton,
   if (status->conflicted && status->kind == svn_node_unknown)
     return SVN_NO_ERROR; /* Ignore delete-delete conflict */
 
-  /* Return error on unknown path kinds.  We check both the entry and
-     the node itself, since a path might have changed kind since its
-     entry was written. */
-  SVN_ERR(svn_wc__node_get_commit_status(&is_added, &is_deleted,
-                                         &is_replaced,
-                                         &is_op_root,
-                                         &node_rev,
-                                         &original_rev, &original_relpath,
-                                         wc_ctx, local_abspath,
-                                         scratch_pool, scratch_pool));
+  if (!copy_mode && !status->copied
+      && (status->node_status == svn_wc_status_modified
+          || status->node_status == svn_wc_status_normal))
+    {
+      /* A BASE node with only local modifications.  These make up the bulk
+         of large commits, and the status walker has already read all we
+         need from the working copy database, in a single query per
+         directory.  Don't query the node again. */
+      is_added = FALSE;
+      is_deleted = FALSE;
+      is_replaced = FALSE;
+      is_op_root = FALSE;
+      node_rev = status->revision;
+      original_rev = SVN_INVALID_REVNUM;
+      original_relpath = NULL;
+    }
+  else
+    /* Return error on unknown path kinds.  We check both the entry and
+       the node itself, since a path might have changed kind since its
+       entry was written. */
+    SVN_ERR(svn_wc__node_get_commit_status(&is_added, &is_deleted,
+                                           &is_replaced,
+                                           &is_op_root,
+                                           &node_rev,
+                                           &original_rev, &original_relpath,
+                                           wc_ctx, local_abspath,
+                                           scratch_pool, scratch_pool));
 
   /* Hande file externals only when passed as explicit target. Note that
    * svn_client_commit6() passes all committable externals in as explicit
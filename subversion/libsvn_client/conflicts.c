@@ -6886,7 +6886,7 @@ merge_newly_added_dir(const char *added_repos_relpath,
   SVN_ERR(svn_client__get_diff_editor2(
                 &diff_editor, &diff_edit_baton,
                 extra_ra_session, svn_depth_infinity, rev1, TRUE,
-                diff_processor, ctx->cancel_func, ctx->cancel_baton,
+                diff_processor, NULL, ctx->cancel_func, ctx->cancel_baton,
                 scratch_pool));
 
   /* We want to switch our txn into URL2 */
@@ -32,6 +32,9 @@
 #include "svn_hash.h"
 #include "svn_client.h"
 #include "svn_error.h"
+#include "svn_auth.h"
+#include "svn_cmdline.h"
+#include "svn_config.h"
 
 #include "private/svn_wc_private.h"
 
@@ -127,6 +130,54 @@ svn_client_create_context2(svn_client_ctx_t **ctx,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_client__create_thread_ctx(svn_client_ctx_t **thread_ctx,
+                              const svn_client_ctx_t *ctx,
+                              apr_pool_t *result_pool)
+{
+  apr_hash_t *config = NULL;
+  svn_config_t *cfg = NULL;
+  svn_client_ctx_t *new_ctx;
+
+  if (ctx->config)
+    {
+      SVN_ERR(svn_config_copy_config(&config, ctx->config, result_pool));
+      cfg = svn_hash_gets(config, SVN_CONFIG_CATEGORY_CONFIG);
+    }
+
+  SVN_ERR(svn_client_create_context2(&new_ctx, config, result_pool));
+
+  /* Credentials must be available without prompting; only one thread
+     could talk to the user at a time. */
+  if (ctx->auth_baton)
+    {
+      svn_auth_baton_t *ab = ctx->auth_baton;
+
+      SVN_ERR(svn_cmdline_create_auth_baton2(
+                &new_ctx->auth_baton, TRUE /* non_interactive */,
+                svn_auth_get_parameter(ab, SVN_AUTH_PARAM_DEFAULT_USERNAME),
+                svn_auth_get_parameter(ab, SVN_AUTH_PARAM_DEFAULT_PASSWORD),
+                svn_auth_get_parameter(ab, SVN_AUTH_PARAM_CONFIG_DIR),
+                svn_auth_get_parameter(ab, SVN_AUTH_PARAM_NO_AUTH_CACHE)
+                  != NULL,
+                FALSE, FALSE, FALSE, FALSE, FALSE,
+                cfg, ctx->cancel_func, ctx->cancel_baton, result_pool));
+    }
+
+  /* Conflicts get postponed for the same reason, as NEW_CTX has no
+     conflict resolver. */
+  new_ctx->cancel_func = ctx->cancel_func;
+  new_ctx->cancel_baton = ctx->cancel_baton;
+  new_ctx->client_name = ctx->client_name;
+  new_ctx->mimetypes_map = ctx->mimetypes_map;
+  new_ctx->notify_func2 = NULL;
+  new_ctx->notify_baton2 = NULL;
+
+  *thread_ctx = new_ctx;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_client_create_context(svn_client_ctx_t **ctx,
                           apr_pool_t *pool)
@@ -301,7 +301,6 @@ delete_urls_multi_repos(const apr_array_header_t *uris,
       const char *uri = APR_ARRAY_IDX(uris, i, const char *);
       struct repos_deletables_t *repos_deletables = NULL;
       const char *repos_relpath;
-      svn_node_kind_t kind;
 
       for (hi = apr_hash_first(pool, deletables); hi; hi = apr_hash_next(hi))
         {
@@ -356,13 +355,34 @@ delete_urls_multi_repos(const apr_array_header_t *uris,
       if (!repos_relpath || !*repos_relpath)
         return svn_error_createf(SVN_ERR_RA_ILLEGAL_URL, NULL,
                                  _("URL '%s' not within a repository"), uri);
+    }
 
-      /* Now, test to see if the thing actually exists in HEAD. */
-      SVN_ERR(svn_ra_check_path(repos_deletables->ra_session, repos_relpath,
-                                SVN_INVALID_REVNUM, &kind, pool));
-      if (kind == svn_node_none)
-        return svn_error_createf(SVN_ERR_FS_NOT_FOUND, NULL,
-                                 _("URL '%s' does not exist"), uri);
+  /* Now, test to see if the things actually exist in HEAD.  Do that with
+     a single request per repository. */
+  for (hi = apr_hash_first(pool, deletables); hi; hi = apr_hash_next(hi))
+    {
+      const char *repos_root = apr_hash_this_key(hi);
+      struct repos_deletables_t *repos_deletables = apr_hash_this_val(hi);
+      apr_array_header_t *relpaths
+        = apr_array_make(pool, repos_deletables->target_uris->nelts,
+                         sizeof(const char *));
+      apr_array_header_t *kinds;
+
+      for (i = 0; i < repos_deletables->target_uris->nelts; i++)
+        APR_ARRAY_PUSH(relpaths, const char *)
+          = svn_uri_skip_ancestor(repos_root,
+                                  APR_ARRAY_IDX(repos_deletables->target_uris,
+                                                i, const char *),
+                                  pool);
+
+      SVN_ERR(svn_ra__check_paths(repos_deletables->ra_session, &kinds,
+                                  relpaths, SVN_INVALID_REVNUM, pool, pool));
+      for (i = 0; i < kinds->nelts; i++)
+        if (APR_ARRAY_IDX(kinds, i, svn_node_kind_t) == svn_node_none)
+          return svn_error_createf(SVN_ERR_FS_NOT_FOUND, NULL,
+                                   _("URL '%s' does not exist"),
+                                   APR_ARRAY_IDX(repos_deletables->target_uris,
+                                                 i, const char *));
     }
 
   /* Now we iterate over the DELETABLES hash, issuing a commit for
@@ -2013,7 +2013,7 @@ diff_repos_repos(const char **root_relpath,
                 extra_ra_session, depth,
                 rev1,
                 text_deltas,
-                diff_processor,
+                diff_processor, ctx,
                 ctx->cancel_func, ctx->cancel_baton,
                 scratch_pool));
 
@@ -45,6 +45,7 @@
 #include "svn_private_config.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_delta_private.h"
+#include "private/svn_thread.h"
 #include "private/svn_wc_private.h"
 
 #ifndef ENABLE_EV2_IMPL
@@ -511,6 +512,13 @@ struct edit_baton
   void *cancel_baton;
   svn_wc_notify_func2_t notify_func;
   void *notify_baton;
+
+  /* install_job_t * for the files received but not yet moved into place,
+     in the order they were closed.  Allocated in JOBS_POOL. */
+  apr_array_header_t *pending;
+
+  /* Thread-safe root pool that holds PENDING and the job pools. */
+  apr_pool_t *jobs_pool;
 };
 
 
@@ -785,7 +793,162 @@ change_dir_prop(void *dir_baton,
 }
 
 
-/* Move the tmpfile to file, and send feedback. */
+/* Number of received files to collect before moving them into place. */
+#define INSTALL_BATCH_SIZE 256
+
+/* Maximum number of threads moving a batch of files into place. */
+#define INSTALL_THREAD_COUNT 8
+
+/* A file received by the export editor that still has to be translated
+   and moved into place. */
+typedef struct install_job_t
+{
+  /* Target path and the temporary file holding the received text. */
+  const char *path;
+  const char *tmppath;
+
+  /* Translation to apply as for svn_subst_copy_and_translate4(). */
+  const char *eol;
+  svn_boolean_t repair;
+  apr_hash_t *keywords;
+  svn_boolean_t special;
+
+  svn_boolean_t executable;
+  apr_time_t date;
+
+  /* Result of the install. */
+  svn_error_t *err;
+
+  /* Pool only to be used by the thread processing this job. */
+  apr_pool_t *pool;
+} install_job_t;
+
+/* Translate JOB's temporary file into its target and set the file's
+   flags and timestamp.  This only touches the file system. */
+static svn_error_t *
+perform_install(install_job_t *job)
+{
+  if ((! job->eol) && (! job->keywords) && (! job->special))
+    {
+      SVN_ERR(svn_io_file_rename2(job->tmppath, job->path, FALSE,
+                                  job->pool));
+    }
+  else
+    {
+      /* The calling thread checks for cancellation between batches. */
+      SVN_ERR(svn_subst_copy_and_translate4(job->tmppath, job->path,
+                                            job->eol, job->repair,
+                                            job->keywords,
+                                            TRUE, /* expand */
+                                            job->special,
+                                            NULL, NULL,
+                                            job->pool));
+
+      SVN_ERR(svn_io_remove_file2(job->tmppath, FALSE, job->pool));
+    }
+
+  if (job->executable)
+    SVN_ERR(svn_io_set_file_executable(job->path, TRUE, FALSE, job->pool));
+
+  if (job->date && (! job->special))
+    SVN_ERR(svn_io_set_file_affected_time(job->date, job->path, job->pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_thread__job_func_t, installing the install_job_t in
+   DATA. */
+static void
+install_job_func(void *data,
+                 int thread_index,
+                 void *baton)
+{
+  install_job_t *job = data;
+
+  job->err = perform_install(job);
+}
+
+/* Pool cleanup handler for the edit_baton in BATON.  Remove the temporary
+   files of all pending installs and release their memory. */
+static apr_status_t
+discard_pending_installs(void *baton)
+{
+  struct edit_baton *eb = baton;
+  int i;
+
+  for (i = 0; i < eb->pending->nelts; ++i)
+    {
+      install_job_t *job = APR_ARRAY_IDX(eb->pending, i, install_job_t *);
+      svn_error_clear(svn_io_remove_file2(job->tmppath, TRUE, job->pool));
+    }
+
+  svn_pool_destroy(eb->jobs_pool);
+
+  return APR_SUCCESS;
+}
+
+/* Prepare EB to collect pending installs.  Any that are still pending
+   when POOL gets cleaned up will be discarded. */
+static void
+init_pending_installs(struct edit_baton *eb,
+                      apr_pool_t *pool)
+{
+  /* Job pools are used from several threads. */
+  eb->jobs_pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  eb->pending = apr_array_make(eb->jobs_pool, INSTALL_BATCH_SIZE,
+                               sizeof(install_job_t *));
+
+  apr_pool_cleanup_register(pool, eb, discard_pending_installs,
+                            apr_pool_cleanup_null);
+}
+
+/* Move all files pending in EB into place, several at a time, and send
+   feedback for them in the order they have been received.  Return the
+   first failure in that order.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+flush_pending_installs(struct edit_baton *eb,
+                       apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  if (eb->pending->nelts == 0)
+    return SVN_NO_ERROR;
+
+  svn_thread__run_batch(eb->pending, install_job_func, NULL,
+                        INSTALL_THREAD_COUNT);
+
+  for (i = 0; i < eb->pending->nelts; ++i)
+    {
+      install_job_t *job = APR_ARRAY_IDX(eb->pending, i, install_job_t *);
+
+      if (job->err || err)
+        {
+          /* Don't leave temporary files behind. */
+          err = svn_error_compose_create(err, job->err);
+          svn_error_clear(svn_io_remove_file2(job->tmppath, TRUE,
+                                              scratch_pool));
+        }
+      else if (eb->notify_func)
+        {
+          svn_wc_notify_t *notify
+            = svn_wc_create_notify(job->path, svn_wc_notify_update_add,
+                                   scratch_pool);
+          notify->kind = svn_node_file;
+          (*eb->notify_func)(eb->notify_baton, notify, scratch_pool);
+        }
+
+      svn_pool_destroy(job->pool);
+    }
+
+  apr_array_clear(eb->pending);
+
+  return svn_error_trace(err);
+}
+
+/* Verify the tmpfile and queue it to be moved to file.  Feedback will be
+   sent once it has been moved. */
 static svn_error_t *
 close_file(void *file_baton,
            const char *text_digest,
@@ -795,6 +958,8 @@ close_file(void *file_baton,
   struct edit_baton *eb = fb->edit_baton;
   svn_checksum_t *text_checksum;
   svn_checksum_t *actual_checksum;
+  apr_pool_t *job_pool;
+  install_job_t *job;
 
   /* Was a txdelta even sent? */
   if (! fb->tmppath)
@@ -814,59 +979,49 @@ close_file(void *file_baton,
                                      _("Checksum mismatch for '%s'"),
                                      svn_dirent_local_style(fb->path, pool));
 
-  if ((! fb->eol_style_val) && (! fb->keywords_val) && (! fb->special))
-    {
-      SVN_ERR(svn_io_file_rename2(fb->tmppath, fb->path, FALSE, pool));
-    }
-  else
+  job_pool = svn_pool_create(eb->jobs_pool);
+  job = apr_pcalloc(job_pool, sizeof(*job));
+  job->pool = job_pool;
+  job->path = apr_pstrdup(job->pool, fb->path);
+  job->tmppath = apr_pstrdup(job->pool, fb->tmppath);
+  job->special = fb->special;
+  job->executable = (fb->executable_val != NULL);
+  job->date = fb->date;
+
+  if (fb->eol_style_val)
     {
       svn_subst_eol_style_t style;
-      const char *eol = NULL;
-      svn_boolean_t repair = FALSE;
-      apr_hash_t *final_kw = NULL;
-
-      if (fb->eol_style_val)
-        {
-          SVN_ERR(get_eol_style(&style, &eol, fb->eol_style_val->data,
-                                eb->native_eol));
-          repair = TRUE;
-        }
 
-      if (fb->keywords_val)
-        SVN_ERR(svn_subst_build_keywords3(&final_kw, fb->keywords_val->data,
-                                          fb->revision, fb->url,
-                                          fb->repos_root_url, fb->date,
-                                          fb->author, pool));
-
-      SVN_ERR(svn_subst_copy_and_translate4(fb->tmppath, fb->path,
-                                            eol, repair, final_kw,
-                                            TRUE, /* expand */
-                                            fb->special,
-                                            eb->cancel_func, eb->cancel_baton,
-                                            pool));
-
-      SVN_ERR(svn_io_remove_file2(fb->tmppath, FALSE, pool));
+      SVN_ERR(get_eol_style(&style, &job->eol, fb->eol_style_val->data,
+                            eb->native_eol));
+      job->repair = TRUE;
     }
 
-  if (fb->executable_val)
-    SVN_ERR(svn_io_set_file_executable(fb->path, TRUE, FALSE, pool));
+  if (fb->keywords_val)
+    SVN_ERR(svn_subst_build_keywords3(&job->keywords,
+                                      fb->keywords_val->data,
+                                      fb->revision, fb->url,
+                                      fb->repos_root_url, fb->date,
+                                      fb->author, job->pool));
 
-  if (fb->date && (! fb->special))
-    SVN_ERR(svn_io_set_file_affected_time(fb->date, fb->path, pool));
+  APR_ARRAY_PUSH(eb->pending, install_job_t *) = job;
 
-  if (fb->edit_baton->notify_func)
-    {
-      svn_wc_notify_t *notify = svn_wc_create_notify(fb->path,
-                                                     svn_wc_notify_update_add,
-                                                     pool);
-      notify->kind = svn_node_file;
-      (*fb->edit_baton->notify_func)(fb->edit_baton->notify_baton, notify,
-                                     pool);
-    }
+  if (eb->pending->nelts >= INSTALL_BATCH_SIZE)
+    SVN_ERR(flush_pending_installs(eb, pool));
 
   return SVN_NO_ERROR;
 }
 
+/* Move the remaining received files into place. */
+static svn_error_t *
+close_edit(void *edit_baton,
+           apr_pool_t *pool)
+{
+  struct edit_baton *eb = edit_baton;
+
+  return svn_error_trace(flush_pending_installs(eb, pool));
+}
+
 static svn_error_t *
 fetch_props_func(apr_hash_t **props,
                  void *baton,
@@ -914,6 +1069,7 @@ get_editor_ev1(const svn_delta_editor_t **export_editor,
   editor->close_file = close_file;
   editor->change_file_prop = change_file_prop;
   editor->change_dir_prop = change_dir_prop;
+  editor->close_edit = close_edit;
 
   SVN_ERR(svn_delta_get_cancellation_editor(ctx->cancel_func,
                                             ctx->cancel_baton,
@@ -1284,7 +1440,7 @@ export_file(const char *from_path_or_url,
    * work, and put the file into place. */
   SVN_ERR(close_file(fb, NULL, scratch_pool));
 
-  return SVN_NO_ERROR;
+  return svn_error_trace(flush_pending_installs(eb, scratch_pool));
 }
 
 static svn_error_t *
@@ -1422,6 +1578,7 @@ svn_client_export5(svn_revnum_t *result_rev,
       eb->cancel_baton = ctx->cancel_baton;
       eb->notify_func = ctx->notify_func2;
       eb->notify_baton = ctx->notify_baton2;
+      init_pending_installs(eb, pool);
 
       SVN_ERR(svn_ra_check_path(ra_session, "", loc->rev, &kind, pool));
 
@@ -38,9 +38,11 @@
 #include "svn_path.h"
 #include "svn_props.h"
 #include "svn_config.h"
+#include "svn_sorts.h"
 #include "client.h"
 
 #include "svn_private_config.h"
+#include "private/svn_thread.h"
 #include "private/svn_wc_private.h"
 
 
@@ -141,35 +143,71 @@ relegate_dir_external(svn_wc_context_t *wc_ctx,
   return svn_error_trace(err);
 }
 
-/* Try to update a directory external at PATH to URL at REVISION.
-   Use POOL for temporary allocations, and use the client context CTX. */
+/* The ways to bring a directory external up to date. */
+typedef enum dir_external_action_t
+{
+  /* Update the existing working copy of the external. */
+  dir_external_update,
+
+  /* Switch the existing working copy of the external to another URL. */
+  dir_external_switch,
+
+  /* Check out a new working copy of the external. */
+  dir_external_checkout
+} dir_external_action_t;
+
+/* A directory external as prepared by prepare_dir_external(), which still
+   has to be fetched from the repository and registered. */
+typedef struct dir_external_t
+{
+  dir_external_action_t action;
+
+  const char *local_abspath;
+  const char *url;
+  const svn_opt_revision_t *peg_revision;
+  const svn_opt_revision_t *revision;
+  const char *defining_abspath;
+
+  /* Repository of the external's working copy.  Not known before the
+     fetch for dir_external_checkout. */
+  const char *repos_root_url;
+  const char *repos_uuid;
+} dir_external_t;
+
+/* Decide how to bring the directory external at LOCAL_ABSPATH up to date
+   with URL at REVISION and return that in *EXT_P, allocated in
+   RESULT_POOL.  Do all the local preparations, i.e. relocate or relegate
+   an existing working copy at LOCAL_ABSPATH as needed, but do not fetch
+   anything yet.  Use POOL for temporary allocations, and use the client
+   context CTX. */
 static svn_error_t *
-switch_dir_external(const char *local_abspath,
-                    const char *url,
-                    const char *url_from_externals_definition,
-                    const svn_opt_revision_t *peg_revision,
-                    const svn_opt_revision_t *revision,
-                    const char *defining_abspath,
-                    svn_boolean_t *timestamp_sleep,
-                    svn_ra_session_t *ra_session,
-                    svn_client_ctx_t *ctx,
-                    apr_pool_t *pool)
+prepare_dir_external(dir_external_t **ext_p,
+                     const char *local_abspath,
+                     const char *url,
+                     const char *url_from_externals_definition,
+                     const svn_opt_revision_t *peg_revision,
+                     const svn_opt_revision_t *revision,
+                     const char *defining_abspath,
+                     svn_client_ctx_t *ctx,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *pool)
 {
+  dir_external_t *ext = apr_pcalloc(result_pool, sizeof(*ext));
   svn_node_kind_t kind;
   svn_error_t *err;
-  svn_revnum_t external_peg_rev = SVN_INVALID_REVNUM;
-  svn_revnum_t external_rev = SVN_INVALID_REVNUM;
   apr_pool_t *subpool = svn_pool_create(pool);
   const char *repos_root_url;
   const char *repos_uuid;
 
   SVN_ERR_ASSERT(svn_dirent_is_absolute(local_abspath));
 
-  if (peg_revision->kind == svn_opt_revision_number)
-    external_peg_rev = peg_revision->value.number;
-
-  if (revision->kind == svn_opt_revision_number)
-    external_rev = revision->value.number;
+  ext->local_abspath = apr_pstrdup(result_pool, local_abspath);
+  ext->url = apr_pstrdup(result_pool, url);
+  ext->peg_revision = apr_pmemdup(result_pool, peg_revision,
+                                  sizeof(*peg_revision));
+  ext->revision = apr_pmemdup(result_pool, revision, sizeof(*revision));
+  ext->defining_abspath = apr_pstrdup(result_pool, defining_abspath);
+  *ext_p = ext;
 
   /*
    * The code below assumes existing versioned paths are *not* part of
@@ -272,28 +310,15 @@ switch_dir_external(const char *local_abspath,
              externals definition, perform an update. */
           if (strcmp(node_url, url) == 0)
             {
-              SVN_ERR(svn_client__update_internal(NULL, timestamp_sleep,
-                                                  local_abspath,
-                                                  revision, svn_depth_unknown,
-                                                  FALSE, FALSE, FALSE, TRUE,
-                                                  FALSE, TRUE,
-                                                  ra_session, ctx, subpool));
-
-              /* We just decided that this existing directory is an external,
-                 so update the external registry with this information, like
-                 when checking out an external */
-              SVN_ERR(svn_wc__external_register(ctx->wc_ctx,
-                                    defining_abspath,
-                                    local_abspath, svn_node_dir,
-                                    repos_root_url, repos_uuid,
-                                    svn_uri_skip_ancestor(repos_root_url,
-                                                          url, pool),
-                                    external_peg_rev,
-                                    external_rev,
-                                    pool));
+              /* We just decided that this existing directory is an
+                 external, so the external registry will be updated with
+                 this information, like when checking out an external */
+              ext->action = dir_external_update;
+              ext->repos_root_url = apr_pstrdup(result_pool, repos_root_url);
+              ext->repos_uuid = apr_pstrdup(result_pool, repos_uuid);
 
               svn_pool_destroy(subpool);
-              goto cleanup;
+              return SVN_NO_ERROR;
             }
 
           /* We'd really prefer not to have to do a brute-force
@@ -357,27 +382,12 @@ switch_dir_external(const char *local_abspath,
                   repos_root_url = repos_root;
                 }
 
-              SVN_ERR(svn_client__switch_internal(NULL, local_abspath, url,
-                                                  peg_revision, revision,
-                                                  svn_depth_infinity,
-                                                  TRUE, FALSE, FALSE,
-                                                  TRUE /* ignore_ancestry */,
-                                                  timestamp_sleep,
-                                                  ctx, subpool));
-
-              SVN_ERR(svn_wc__external_register(ctx->wc_ctx,
-                                                defining_abspath,
-                                                local_abspath, svn_node_dir,
-                                                repos_root_url, repos_uuid,
-                                                svn_uri_skip_ancestor(
-                                                            repos_root_url,
-                                                            url, subpool),
-                                                external_peg_rev,
-                                                external_rev,
-                                                subpool));
+              ext->action = dir_external_switch;
+              ext->repos_root_url = apr_pstrdup(result_pool, repos_root_url);
+              ext->repos_uuid = apr_pstrdup(result_pool, repos_uuid);
 
               svn_pool_destroy(subpool);
-              goto cleanup;
+              return SVN_NO_ERROR;
             }
         }
     }
@@ -408,33 +418,128 @@ switch_dir_external(const char *local_abspath,
     }
 
   /* ... Hello, new hotness. */
-  SVN_ERR(svn_client__checkout_internal(NULL, timestamp_sleep,
-                                        url, local_abspath, peg_revision,
-                                        revision, svn_depth_infinity,
-                                        FALSE, FALSE,
-                                        ra_session,
-                                        ctx, pool));
-
-  SVN_ERR(svn_wc__node_get_repos_info(NULL, NULL,
-                                      &repos_root_url,
-                                      &repos_uuid,
-                                      ctx->wc_ctx, local_abspath,
-                                      pool, pool));
+  ext->action = dir_external_checkout;
+
+  return SVN_NO_ERROR;
+}
+
+/* Fetch the directory external EXT prepared by prepare_dir_external().
+   For dir_external_checkout, set EXT->REPOS_ROOT_URL and EXT->REPOS_UUID,
+   allocated in RESULT_POOL.  Pass TIMESTAMP_SLEEP and RA_SESSION on to the
+   update, switch or checkout.  Use SCRATCH_POOL for temporary allocations,
+   and use the client context CTX. */
+static svn_error_t *
+fetch_dir_external(dir_external_t *ext,
+                   svn_boolean_t *timestamp_sleep,
+                   svn_ra_session_t *ra_session,
+                   svn_client_ctx_t *ctx,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  switch (ext->action)
+    {
+      case dir_external_update:
+        SVN_ERR(svn_client__update_internal(NULL, timestamp_sleep,
+                                            ext->local_abspath,
+                                            ext->revision, svn_depth_unknown,
+                                            FALSE, FALSE, FALSE, TRUE,
+                                            FALSE, TRUE,
+                                            ra_session, ctx, scratch_pool));
+        break;
+
+      case dir_external_switch:
+        SVN_ERR(svn_client__switch_internal(NULL, ext->local_abspath,
+                                            ext->url,
+                                            ext->peg_revision, ext->revision,
+                                            svn_depth_infinity,
+                                            TRUE, FALSE, FALSE,
+                                            TRUE /* ignore_ancestry */,
+                                            timestamp_sleep,
+                                            ctx, scratch_pool));
+        break;
+
+      case dir_external_checkout:
+        SVN_ERR(svn_client__checkout_internal(NULL, timestamp_sleep,
+                                              ext->url, ext->local_abspath,
+                                              ext->peg_revision,
+                                              ext->revision,
+                                              svn_depth_infinity,
+                                              FALSE, FALSE,
+                                              ra_session,
+                                              ctx, scratch_pool));
+
+        SVN_ERR(svn_wc__node_get_repos_info(NULL, NULL,
+                                            &ext->repos_root_url,
+                                            &ext->repos_uuid,
+                                            ctx->wc_ctx, ext->local_abspath,
+                                            result_pool, scratch_pool));
+        break;
+
+      default:
+        SVN_ERR_MALFUNCTION();
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Record the fetched directory external EXT in the external registry of
+   its defining working copy.  Use SCRATCH_POOL for temporary allocations,
+   and use the client context CTX. */
+static svn_error_t *
+register_dir_external(const dir_external_t *ext,
+                      svn_client_ctx_t *ctx,
+                      apr_pool_t *scratch_pool)
+{
+  svn_revnum_t external_peg_rev = SVN_INVALID_REVNUM;
+  svn_revnum_t external_rev = SVN_INVALID_REVNUM;
+
+  if (ext->peg_revision->kind == svn_opt_revision_number)
+    external_peg_rev = ext->peg_revision->value.number;
+
+  if (ext->revision->kind == svn_opt_revision_number)
+    external_rev = ext->revision->value.number;
 
   SVN_ERR(svn_wc__external_register(ctx->wc_ctx,
-                                    defining_abspath,
-                                    local_abspath, svn_node_dir,
-                                    repos_root_url, repos_uuid,
-                                    svn_uri_skip_ancestor(repos_root_url,
-                                                          url, pool),
+                                    ext->defining_abspath,
+                                    ext->local_abspath, svn_node_dir,
+                                    ext->repos_root_url, ext->repos_uuid,
+                                    svn_uri_skip_ancestor(ext->repos_root_url,
+                                                          ext->url,
+                                                          scratch_pool),
                                     external_peg_rev,
                                     external_rev,
-                                    pool));
+                                    scratch_pool));
 
- cleanup:
   /* Issues #4123 and #4130: We don't need to keep the newly checked
      out external's DB open. */
-  SVN_ERR(svn_wc__close_db(local_abspath, ctx->wc_ctx, pool));
+  SVN_ERR(svn_wc__close_db(ext->local_abspath, ctx->wc_ctx, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Try to update a directory external at PATH to URL at REVISION.
+   Use POOL for temporary allocations, and use the client context CTX. */
+static svn_error_t *
+switch_dir_external(const char *local_abspath,
+                    const char *url,
+                    const char *url_from_externals_definition,
+                    const svn_opt_revision_t *peg_revision,
+                    const svn_opt_revision_t *revision,
+                    const char *defining_abspath,
+                    svn_boolean_t *timestamp_sleep,
+                    svn_ra_session_t *ra_session,
+                    svn_client_ctx_t *ctx,
+                    apr_pool_t *pool)
+{
+  dir_external_t *ext;
+
+  SVN_ERR(prepare_dir_external(&ext, local_abspath, url,
+                               url_from_externals_definition,
+                               peg_revision, revision, defining_abspath,
+                               ctx, pool, pool));
+  SVN_ERR(fetch_dir_external(ext, timestamp_sleep, ra_session, ctx,
+                             pool, pool));
+  SVN_ERR(register_dir_external(ext, ctx, pool));
 
   return SVN_NO_ERROR;
 }
@@ -745,6 +850,329 @@ handle_external_item_removal(const svn_client_ctx_t *ctx,
   return svn_error_trace(err);
 }
 
+static svn_error_t *
+wrap_external_error(const svn_client_ctx_t *ctx,
+                    const char *target_abspath,
+                    svn_error_t *err,
+                    apr_pool_t *scratch_pool)
+{
+  if (err && err->apr_err != SVN_ERR_CANCELLED)
+    {
+      if (ctx->notify_func2)
+        {
+          svn_wc_notify_t *notifier = svn_wc_create_notify(
+                                            target_abspath,
+                                            svn_wc_notify_failed_external,
+                                            scratch_pool);
+          notifier->err = err;
+          ctx->notify_func2(ctx->notify_baton2, notifier, scratch_pool);
+        }
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  return err;
+}
+
+/* Upper limit for SVN_CONFIG_OPTION_PARALLEL_EXTERNALS. */
+#define MAX_PARALLEL_EXTERNALS 64
+
+/* A directory external to be fetched by a separate thread. */
+typedef struct external_fetch_t
+{
+  dir_external_t *ext;
+
+  /* Client context to be used for this fetch only.  It has a private
+     working copy context, configuration and authentication baton. */
+  svn_client_ctx_t *ctx;
+
+  /* svn_wc_notify_t * for this external in the order they were sent.
+     They are passed on to the caller once the fetch has completed, so
+     the notifications for different externals don't get mixed up. */
+  apr_array_header_t *notifications;
+
+  /* Results. */
+  svn_boolean_t timestamp_sleep;
+  svn_error_t *err;
+
+  /* Pool only to be used by the thread processing this fetch. */
+  apr_pool_t *pool;
+} external_fetch_t;
+
+/* The directory externals to be fetched in parallel. */
+typedef struct external_fetch_queue_t
+{
+  /* external_fetch_t * in the order in which they were queued. */
+  apr_array_header_t *fetches;
+
+  /* Maximum number of threads fetching externals. */
+  int parallelism;
+
+  /* Thread-safe pool containing the fetches. */
+  apr_pool_t *pool;
+} external_fetch_queue_t;
+
+/* Implements svn_wc_notify_func2_t, adding a copy of NOTIFY to the
+   notifications of the external_fetch_t in BATON. */
+static void
+queue_notification(void *baton,
+                   const svn_wc_notify_t *notify,
+                   apr_pool_t *pool)
+{
+  external_fetch_t *fetch = baton;
+
+  APR_ARRAY_PUSH(fetch->notifications, svn_wc_notify_t *)
+    = svn_wc_dup_notify(notify, fetch->pool);
+}
+
+/* Pass the notifications queued for FETCH on to CTX's notify function.
+   Use SCRATCH_POOL for temporary allocations. */
+static void
+send_notifications(svn_client_ctx_t *ctx,
+                   external_fetch_t *fetch,
+                   apr_pool_t *scratch_pool)
+{
+  int i;
+
+  for (i = 0; ctx->notify_func2 && i < fetch->notifications->nelts; i++)
+    ctx->notify_func2(ctx->notify_baton2,
+                      APR_ARRAY_IDX(fetch->notifications, i,
+                                    svn_wc_notify_t *),
+                      scratch_pool);
+
+  apr_array_clear(fetch->notifications);
+}
+
+/* Set up FETCH->CTX as a copy of CTX that can be used by another thread,
+   see svn_client__create_thread_ctx().  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+create_fetch_ctx(external_fetch_t *fetch,
+                 svn_client_ctx_t *ctx,
+                 apr_pool_t *scratch_pool)
+{
+  svn_config_t *cfg = NULL;
+  svn_client_ctx_t *fetch_ctx;
+
+  SVN_ERR(svn_client__create_thread_ctx(&fetch_ctx, ctx, fetch->pool));
+
+  /* Externals defined within the external are left to this thread. */
+  if (fetch_ctx->config)
+    cfg = svn_hash_gets(fetch_ctx->config, SVN_CONFIG_CATEGORY_CONFIG);
+  if (cfg)
+    svn_config_set(cfg, SVN_CONFIG_SECTION_WORKING_COPY,
+                   SVN_CONFIG_OPTION_PARALLEL_EXTERNALS, "1");
+
+  if (ctx->notify_func2)
+    {
+      fetch_ctx->notify_func2 = queue_notification;
+      fetch_ctx->notify_baton2 = fetch;
+    }
+
+  fetch->ctx = fetch_ctx;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_thread__job_func_t, fetching the external_fetch_t in
+   DATA. */
+static void
+fetch_job_func(void *data,
+               int thread_index,
+               void *baton)
+{
+  external_fetch_t *fetch = data;
+
+  fetch->err = fetch_dir_external(fetch->ext, &fetch->timestamp_sleep,
+                                  NULL, fetch->ctx,
+                                  fetch->pool, fetch->pool);
+
+  /* Don't keep the external's DB open, so the caller can use it. */
+  fetch->err = svn_error_compose_create(
+                 fetch->err,
+                 svn_wc_context_destroy(fetch->ctx->wc_ctx));
+}
+
+/* Fetch the directory externals in QUEUE and register them in the order
+   they were queued.  Pass their notifications on to CTX's notify function
+   and report errors like wrap_external_error().  Set *TIMESTAMP_SLEEP if
+   any of the fetches requires it.  Leave QUEUE empty, even on error.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+complete_external_fetches(external_fetch_queue_t *queue,
+                          svn_boolean_t *timestamp_sleep,
+                          svn_client_ctx_t *ctx,
+                          apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  if (ctx->cancel_func)
+    err = ctx->cancel_func(ctx->cancel_baton);
+
+  if (!err)
+    svn_thread__run_batch(queue->fetches, fetch_job_func, NULL,
+                          queue->parallelism);
+
+  for (i = 0; i < queue->fetches->nelts; i++)
+    {
+      external_fetch_t *fetch = APR_ARRAY_IDX(queue->fetches, i,
+                                              external_fetch_t *);
+      svn_error_t *fetch_err = fetch->err;
+
+      svn_pool_clear(iterpool);
+
+      /* Only report the first error that can't be ignored. */
+      if (err)
+        {
+          svn_error_clear(fetch_err);
+          svn_pool_destroy(fetch->pool);
+          continue;
+        }
+
+      if (fetch->timestamp_sleep)
+        *timestamp_sleep = TRUE;
+
+      send_notifications(ctx, fetch, iterpool);
+
+      if (!fetch_err)
+        fetch_err = register_dir_external(fetch->ext, ctx, iterpool);
+
+      err = wrap_external_error(ctx, fetch->ext->local_abspath, fetch_err,
+                                iterpool);
+      svn_pool_destroy(fetch->pool);
+    }
+
+  apr_array_clear(queue->fetches);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+/* If any external in QUEUE is at LOCAL_ABSPATH, above or below it,
+   complete all the fetches in QUEUE using complete_external_fetches()
+   with TIMESTAMP_SLEEP, CTX and SCRATCH_POOL.  The external at
+   LOCAL_ABSPATH can then be handled safely. */
+static svn_error_t *
+wait_for_overlapping_fetches(external_fetch_queue_t *queue,
+                             const char *local_abspath,
+                             svn_boolean_t *timestamp_sleep,
+                             svn_client_ctx_t *ctx,
+                             apr_pool_t *scratch_pool)
+{
+  int i;
+
+  for (i = 0; i < queue->fetches->nelts; i++)
+    {
+      external_fetch_t *fetch = APR_ARRAY_IDX(queue->fetches, i,
+                                              external_fetch_t *);
+
+      if (svn_dirent_is_ancestor(fetch->ext->local_abspath, local_abspath)
+          || svn_dirent_is_ancestor(local_abspath, fetch->ext->local_abspath))
+        return svn_error_trace(complete_external_fetches(queue,
+                                                         timestamp_sleep,
+                                                         ctx, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Like switch_dir_external() but only prepare the external, using
+   IS_NEW to tell whether it gets created.  Add it to QUEUE to be
+   fetched and registered by complete_external_fetches() later.  Queue
+   all notifications for the external as well.
+
+   New working copies that may still be known to CTX's working copy
+   context as part of their parent get fetched right away. */
+static svn_error_t *
+queue_dir_external(external_fetch_queue_t *queue,
+                   const char *local_abspath,
+                   const char *url,
+                   const char *url_from_externals_definition,
+                   const svn_opt_revision_t *peg_revision,
+                   const svn_opt_revision_t *revision,
+                   const char *defining_abspath,
+                   svn_boolean_t is_new,
+                   svn_boolean_t *timestamp_sleep,
+                   svn_ra_session_t *ra_session,
+                   svn_client_ctx_t *ctx,
+                   apr_pool_t *scratch_pool)
+{
+  svn_wc_notify_func2_t notify_func2 = ctx->notify_func2;
+  void *notify_baton2 = ctx->notify_baton2;
+  apr_pool_t *pool;
+  external_fetch_t *fetch;
+  svn_node_kind_t kind = svn_node_none;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(wait_for_overlapping_fetches(queue, local_abspath, timestamp_sleep,
+                                       ctx, scratch_pool));
+
+  pool = svn_pool_create(queue->pool);
+  fetch = apr_pcalloc(pool, sizeof(*fetch));
+  fetch->pool = pool;
+  fetch->notifications = apr_array_make(pool, 16, sizeof(svn_wc_notify_t *));
+
+  /* Collect everything reported about this external from here on. */
+  if (notify_func2)
+    {
+      ctx->notify_func2 = queue_notification;
+      ctx->notify_baton2 = fetch;
+      ctx->notify_func2(ctx->notify_baton2,
+                        svn_wc_create_notify(local_abspath,
+                                             svn_wc_notify_update_external,
+                                             scratch_pool),
+                        scratch_pool);
+    }
+
+  /* The target dir might have multiple components.  Guarantee the path
+     leading down to the last component. */
+  if (is_new)
+    err = svn_io_make_dir_recursively(svn_dirent_dirname(local_abspath,
+                                                         scratch_pool),
+                                      scratch_pool);
+
+  if (!err)
+    err = prepare_dir_external(&fetch->ext, local_abspath, url,
+                               url_from_externals_definition,
+                               peg_revision, revision, defining_abspath,
+                               ctx, pool, scratch_pool);
+
+  ctx->notify_func2 = notify_func2;
+  ctx->notify_baton2 = notify_baton2;
+
+  /* An existing directory to be checked out may still be cached as part
+     of the parent working copy in CTX.  Another working copy context
+     would not update that.  Otherwise, close the external's working copy
+     here, so the fetching thread can open it. */
+  if (!err && fetch->ext->action == dir_external_checkout)
+    err = svn_io_check_path(local_abspath, &kind, scratch_pool);
+  else if (!err)
+    err = svn_wc__close_db(local_abspath, ctx->wc_ctx, scratch_pool);
+
+  if (!err && kind == svn_node_none)
+    err = create_fetch_ctx(fetch, ctx, scratch_pool);
+
+  if (err || kind != svn_node_none)
+    {
+      send_notifications(ctx, fetch, scratch_pool);
+
+      if (!err)
+        err = fetch_dir_external(fetch->ext, timestamp_sleep, ra_session,
+                                 ctx, pool, scratch_pool);
+      if (!err)
+        err = register_dir_external(fetch->ext, ctx, scratch_pool);
+
+      svn_pool_destroy(pool);
+      return svn_error_trace(err);
+    }
+
+  APR_ARRAY_PUSH(queue->fetches, external_fetch_t *) = fetch;
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 handle_external_item_change(svn_client_ctx_t *ctx,
                             const char *repos_root_url,
@@ -755,6 +1183,7 @@ handle_external_item_change(svn_client_ctx_t *ctx,
                             const svn_wc_external_item2_t *new_item,
                             svn_ra_session_t *ra_session,
                             svn_boolean_t *timestamp_sleep,
+                            external_fetch_queue_t *fetch_queue,
                             apr_pool_t *scratch_pool)
 {
   svn_client__pathrev_t *new_loc;
@@ -830,6 +1259,21 @@ handle_external_item_change(svn_client_ctx_t *ctx,
      the global case is hard, and it should be pretty obvious to a
      user when it happens.  Worst case: your disk fills up :-). */
 
+  if (svn_node_dir == ext_kind && fetch_queue)
+    return svn_error_trace(queue_dir_external(fetch_queue, local_abspath,
+                                              new_loc->url, new_item->url,
+                                              &(new_item->peg_revision),
+                                              &(new_item->revision),
+                                              parent_dir_abspath,
+                                              ! old_defining_abspath,
+                                              timestamp_sleep, ra_session,
+                                              ctx, scratch_pool));
+
+  if (fetch_queue)
+    SVN_ERR(wait_for_overlapping_fetches(fetch_queue, local_abspath,
+                                         timestamp_sleep, ctx,
+                                         scratch_pool));
+
   /* First notify that we're about to handle an external. */
   if (ctx->notify_func2)
     {
@@ -934,30 +1378,6 @@ handle_external_item_change(svn_client_ctx_t *ctx,
   return SVN_NO_ERROR;
 }
 
-static svn_error_t *
-wrap_external_error(const svn_client_ctx_t *ctx,
-                    const char *target_abspath,
-                    svn_error_t *err,
-                    apr_pool_t *scratch_pool)
-{
-  if (err && err->apr_err != SVN_ERR_CANCELLED)
-    {
-      if (ctx->notify_func2)
-        {
-          svn_wc_notify_t *notifier = svn_wc_create_notify(
-                                            target_abspath,
-                                            svn_wc_notify_failed_external,
-                                            scratch_pool);
-          notifier->err = err;
-          ctx->notify_func2(ctx->notify_baton2, notifier, scratch_pool);
-        }
-      svn_error_clear(err);
-      return SVN_NO_ERROR;
-    }
-
-  return err;
-}
-
 static svn_error_t *
 handle_externals_change(svn_client_ctx_t *ctx,
                         const char *repos_root_url,
@@ -968,6 +1388,7 @@ handle_externals_change(svn_client_ctx_t *ctx,
                         svn_depth_t ambient_depth,
                         svn_depth_t requested_depth,
                         svn_ra_session_t *ra_session,
+                        external_fetch_queue_t *fetch_queue,
                         apr_pool_t *scratch_pool)
 {
   apr_array_header_t *new_desc;
@@ -1038,6 +1459,7 @@ handle_externals_change(svn_client_ctx_t *ctx,
                                                   old_defining_abspath,
                                                   new_item, ra_session,
                                                   timestamp_sleep,
+                                                  fetch_queue,
                                                   iterpool),
                       iterpool));
 
@@ -1066,6 +1488,11 @@ svn_client__handle_externals(apr_hash_t *externals_new,
   apr_hash_t *old_external_defs;
   apr_hash_index_t *hi;
   apr_pool_t *iterpool;
+  external_fetch_queue_t *fetch_queue = NULL;
+  apr_int64_t parallelism;
+  svn_config_t *cfg = ctx->config
+                      ? svn_hash_gets(ctx->config, SVN_CONFIG_CATEGORY_CONFIG)
+                      : NULL;
 
   SVN_ERR_ASSERT(repos_root_url);
 
@@ -1075,6 +1502,25 @@ svn_client__handle_externals(apr_hash_t *externals_new,
                                           ctx->wc_ctx, target_abspath,
                                           scratch_pool, iterpool));
 
+  SVN_ERR(svn_config_get_int64(cfg, &parallelism,
+                               SVN_CONFIG_SECTION_WORKING_COPY,
+                               SVN_CONFIG_OPTION_PARALLEL_EXTERNALS, 1));
+
+  /* Directory externals are independent working copies, which other
+     threads can fetch while we go through the definitions. */
+  if (parallelism > 1)
+    {
+      apr_pool_t *pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+
+      fetch_queue = apr_pcalloc(pool, sizeof(*fetch_queue));
+      fetch_queue->fetches = apr_array_make(pool, 16,
+                                            sizeof(external_fetch_t *));
+      fetch_queue->parallelism = (int)MIN(parallelism,
+                                           MAX_PARALLEL_EXTERNALS);
+      fetch_queue->pool = pool;
+    }
+
   for (hi = apr_hash_first(scratch_pool, externals_new);
        hi;
        hi = apr_hash_next(hi))
@@ -1082,6 +1528,7 @@ svn_client__handle_externals(apr_hash_t *externals_new,
       const char *local_abspath = apr_hash_this_key(hi);
       const char *desc_text = apr_hash_this_val(hi);
       svn_depth_t ambient_depth = svn_depth_infinity;
+      svn_error_t *err;
 
       svn_pool_clear(iterpool);
 
@@ -1094,10 +1541,13 @@ svn_client__handle_externals(apr_hash_t *externals_new,
 
           if (ambient_depth_w == NULL)
             {
-              return svn_error_createf(
+              err = svn_error_createf(
                         SVN_ERR_WC_CORRUPT, NULL,
                         _("Traversal of '%s' found no ambient depth"),
                         svn_dirent_local_style(local_abspath, scratch_pool));
+              if (fetch_queue)
+                svn_pool_destroy(fetch_queue->pool);
+              return err;
             }
           else
             {
@@ -1105,13 +1555,23 @@ svn_client__handle_externals(apr_hash_t *externals_new,
             }
         }
 
-      SVN_ERR(handle_externals_change(ctx, repos_root_url, timestamp_sleep,
-                                      local_abspath,
-                                      desc_text, old_external_defs,
-                                      ambient_depth, requested_depth,
-                                      ra_session, iterpool));
+      err = handle_externals_change(ctx, repos_root_url, timestamp_sleep,
+                                    local_abspath,
+                                    desc_text, old_external_defs,
+                                    ambient_depth, requested_depth,
+                                    ra_session, fetch_queue, iterpool);
+      if (err)
+        {
+          if (fetch_queue)
+            svn_pool_destroy(fetch_queue->pool);
+          return svn_error_trace(err);
+        }
     }
 
+  if (fetch_queue)
+    SVN_ERR(complete_external_fetches(fetch_queue, timestamp_sleep, ctx,
+                                      iterpool));
+
   /* Remove the remaining externals */
   for (hi = apr_hash_first(scratch_pool, old_external_defs);
        hi;
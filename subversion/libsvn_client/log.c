@@ -806,18 +806,19 @@ run_ra_get_log(apr_array_header_t *revision_ranges,
           passed_receiver_baton = &lb;
         }
 
-      SVN_ERR(svn_ra_get_log2(ra_session,
-                              paths,
-                              range->range_start,
-                              range->range_end,
-                              limit,
-                              discover_changed_paths,
-                              strict_node_history,
-                              include_merged_revisions,
-                              passed_receiver_revprops,
-                              passed_receiver,
-                              passed_receiver_baton,
-                              iterpool));
+      SVN_ERR(svn_client__get_log_cached(ra_session,
+                                         paths,
+                                         range->range_start,
+                                         range->range_end,
+                                         limit,
+                                         discover_changed_paths,
+                                         strict_node_history,
+                                         include_merged_revisions,
+                                         passed_receiver_revprops,
+                                         passed_receiver,
+                                         passed_receiver_baton,
+                                         ctx,
+                                         iterpool));
 
       if (limit && revision_ranges->nelts > 1)
         {
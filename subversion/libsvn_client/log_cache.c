@@ -0,0 +1,602 @@
+/*
+ * log_cache.c:  persistent client-side cache of log query results
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* IDEs and other tools run the very same log queries over and over.
+ * Except for revision properties, the history of a repository never
+ * changes, so the answer to a query with fixed revision numbers can be
+ * replayed from disk.  Revision properties may be changed after the fact,
+ * which is why cached answers expire after a configurable time, much like
+ * ra_serf's on-disk repository metadata.
+ *
+ * Every query gets its own file in a per-repository (UUID) directory.
+ * The file starts with a hash dump holding the full query key and the
+ * expiry time, followed by one skel per log entry:
+ *
+ *   LENGTH "\n" SKEL "\n"
+ *
+ * where SKEL is
+ *
+ *   (REVISION FLAGS REVPROPS (CHANGE ...))
+ *   CHANGE ::= (PATH ACTION KIND TEXT-MODIFIED PROPS-MODIFIED
+ *               COPYFROM-PATH COPYFROM-REV)
+ *
+ * FLAGS contains 'c' for entries with children, 'n' for non-inheritable
+ * and 's' for subtractive merges, 'r' if there were revprops and 'p' if
+ * there were changed paths.
+ */
+
+#include <apr_strings.h>
+
+#include "svn_auth.h"
+#include "svn_checksum.h"
+#include "svn_config.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_ra.h"
+#include "svn_string.h"
+
+#include "private/svn_skel.h"
+
+#include "client.h"
+
+#include "svn_private_config.h"
+
+/* Name of the cache directory within the user's config area. */
+#define LOG_CACHE_SUBDIR "log-cache"
+
+/* Keys in the header of a cache file. */
+#define KEY_QUERY "query"
+#define KEY_EXPIRES "expires"
+
+/* Return the key identifying the log query given by the parameters as
+ * per svn_ra_get_log2() for the repository with UUID, sent through a
+ * session at SESSION_RELPATH.  Allocate the result in POOL.
+ */
+static const char *
+make_query_key(const char *uuid,
+               const char *session_relpath,
+               const apr_array_header_t *paths,
+               svn_revnum_t start,
+               svn_revnum_t end,
+               int limit,
+               svn_boolean_t discover_changed_paths,
+               svn_boolean_t strict_node_history,
+               svn_boolean_t include_merged_revisions,
+               const apr_array_header_t *revprops,
+               apr_pool_t *pool)
+{
+  svn_stringbuf_t *key;
+  int i;
+
+  key = svn_stringbuf_createf(pool, "%s\n%s\n%ld:%ld:%d:%d%d%d\n",
+                              uuid, session_relpath, start, end, limit,
+                              discover_changed_paths != 0,
+                              strict_node_history != 0,
+                              include_merged_revisions != 0);
+
+  for (i = 0; paths && i < paths->nelts; i++)
+    {
+      svn_stringbuf_appendcstr(key, "P ");
+      svn_stringbuf_appendcstr(key, APR_ARRAY_IDX(paths, i, const char *));
+      svn_stringbuf_appendbyte(key, '\n');
+    }
+
+  if (revprops == NULL)
+    svn_stringbuf_appendcstr(key, "*\n");
+  else
+    for (i = 0; i < revprops->nelts; i++)
+      {
+        svn_stringbuf_appendcstr(key, "R ");
+        svn_stringbuf_appendcstr(key, APR_ARRAY_IDX(revprops, i,
+                                                    const char *));
+        svn_stringbuf_appendbyte(key, '\n');
+      }
+
+  return key->data;
+}
+
+/* Return the word to store for TRISTATE.
+ */
+static const char *
+tristate_to_word(svn_tristate_t tristate)
+{
+  const char *word = svn_tristate__to_word(tristate);
+
+  return word ? word : "";
+}
+
+/* Return the serialized form of LOG_ENTRY.  Allocate it in POOL.
+ */
+static svn_stringbuf_t *
+serialize_log_entry(const svn_log_entry_t *log_entry,
+                    apr_pool_t *pool)
+{
+  svn_skel_t *skel = svn_skel__make_empty_list(pool);
+  svn_skel_t *changes = svn_skel__make_empty_list(pool);
+  svn_skel_t *revprops;
+  svn_stringbuf_t *flags = svn_stringbuf_create_empty(pool);
+
+  if (log_entry->changed_paths2)
+    {
+      apr_hash_index_t *hi;
+
+      for (hi = apr_hash_first(pool, log_entry->changed_paths2); hi;
+           hi = apr_hash_next(hi))
+        {
+          const svn_log_changed_path2_t *change = apr_hash_this_val(hi);
+          svn_skel_t *change_skel = svn_skel__make_empty_list(pool);
+
+          svn_skel__prepend_int(change->copyfrom_rev, change_skel, pool);
+          svn_skel__prepend_str(change->copyfrom_path
+                                  ? change->copyfrom_path : "",
+                                change_skel, pool);
+          svn_skel__prepend_str(tristate_to_word(change->props_modified),
+                                change_skel, pool);
+          svn_skel__prepend_str(tristate_to_word(change->text_modified),
+                                change_skel, pool);
+          svn_skel__prepend_str(svn_node_kind_to_word(change->node_kind),
+                                change_skel, pool);
+          svn_skel__prepend(svn_skel__mem_atom(&change->action, 1, pool),
+                            change_skel);
+          svn_skel__prepend_str(apr_hash_this_key(hi), change_skel, pool);
+
+          svn_skel__prepend(change_skel, changes);
+        }
+
+      svn_stringbuf_appendbyte(flags, 'p');
+    }
+
+  if (log_entry->revprops)
+    {
+      /* Can't fail for hashes of svn_string_t. */
+      svn_error_clear(svn_skel__unparse_proplist(&revprops,
+                                                 log_entry->revprops, pool));
+      svn_stringbuf_appendbyte(flags, 'r');
+    }
+  else
+    revprops = svn_skel__make_empty_list(pool);
+
+  if (log_entry->has_children)
+    svn_stringbuf_appendbyte(flags, 'c');
+  if (log_entry->non_inheritable)
+    svn_stringbuf_appendbyte(flags, 'n');
+  if (log_entry->subtractive_merge)
+    svn_stringbuf_appendbyte(flags, 's');
+
+  svn_skel__prepend(changes, skel);
+  svn_skel__prepend(revprops, skel);
+  svn_skel__prepend_str(flags->data, skel, pool);
+  svn_skel__prepend_int(log_entry->revision, skel, pool);
+
+  return svn_skel__unparse(skel, pool);
+}
+
+/* Return a copy of the contents of the atom SKEL as C string,
+ * allocated in POOL.
+ */
+static const char *
+atom_to_cstring(const svn_skel_t *skel,
+                apr_pool_t *pool)
+{
+  return apr_pstrmemdup(pool, skel->data, skel->len);
+}
+
+/* Return a new error about a malformed entry in the log cache.
+ */
+static svn_error_t *
+malformed_entry_error(void)
+{
+  return svn_error_create(SVN_ERR_MALFORMED_FILE, NULL,
+                          _("Malformed log cache entry"));
+}
+
+/* Parse the serialized log entry in DATA of length LEN into *LOG_ENTRY,
+ * allocated in POOL.
+ */
+static svn_error_t *
+parse_log_entry(svn_log_entry_t **log_entry,
+                const char *data,
+                apr_size_t len,
+                apr_pool_t *pool)
+{
+  svn_skel_t *skel = svn_skel__parse(data, len, pool);
+  svn_skel_t *flags_skel, *revprops_skel, *changes_skel, *change_skel;
+  const char *flags;
+  svn_log_entry_t *entry;
+  apr_int64_t value;
+
+  if (!skel || svn_skel__list_length(skel) != 4)
+    return svn_error_trace(malformed_entry_error());
+
+  flags_skel = skel->children->next;
+  revprops_skel = flags_skel->next;
+  changes_skel = revprops_skel->next;
+  if (!flags_skel->is_atom || revprops_skel->is_atom || changes_skel->is_atom)
+    return svn_error_trace(malformed_entry_error());
+
+  entry = svn_log_entry_create(pool);
+  SVN_ERR(svn_skel__parse_int(&value, skel->children, pool));
+  entry->revision = (svn_revnum_t)value;
+
+  flags = atom_to_cstring(flags_skel, pool);
+  entry->has_children = (strchr(flags, 'c') != NULL);
+  entry->non_inheritable = (strchr(flags, 'n') != NULL);
+  entry->subtractive_merge = (strchr(flags, 's') != NULL);
+
+  if (strchr(flags, 'r'))
+    SVN_ERR(svn_skel__parse_proplist(&entry->revprops, revprops_skel, pool));
+
+  if (strchr(flags, 'p'))
+    {
+      entry->changed_paths2 = apr_hash_make(pool);
+      for (change_skel = changes_skel->children; change_skel;
+           change_skel = change_skel->next)
+        {
+          svn_log_changed_path2_t *change;
+          const svn_skel_t *field;
+          const char *path;
+
+          if (svn_skel__list_length(change_skel) != 7)
+            return svn_error_trace(malformed_entry_error());
+
+          for (field = change_skel->children; field; field = field->next)
+            if (!field->is_atom)
+              return svn_error_trace(malformed_entry_error());
+
+          change = svn_log_changed_path2_create(pool);
+          field = change_skel->children;
+          path = atom_to_cstring(field, pool);
+
+          field = field->next;
+          if (field->len != 1)
+            return svn_error_trace(malformed_entry_error());
+          change->action = field->data[0];
+
+          field = field->next;
+          change->node_kind
+            = svn_node_kind_from_word(atom_to_cstring(field, pool));
+          field = field->next;
+          change->text_modified
+            = svn_tristate__from_word(atom_to_cstring(field, pool));
+          field = field->next;
+          change->props_modified
+            = svn_tristate__from_word(atom_to_cstring(field, pool));
+
+          field = field->next;
+          if (field->len)
+            change->copyfrom_path = atom_to_cstring(field, pool);
+
+          field = field->next;
+          SVN_ERR(svn_skel__parse_int(&value, field, pool));
+          change->copyfrom_rev = (svn_revnum_t)value;
+
+          svn_hash_sets(entry->changed_paths2, path, change);
+        }
+
+      /* Fill in the deprecated field like the RA layers do. */
+      entry->changed_paths = entry->changed_paths2;
+    }
+
+  *log_entry = entry;
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the cache file at PATH and return the serialized log entries in
+ * it as an array of svn_stringbuf_t * in *ENTRIES.  Set *ENTRIES to NULL,
+ * if there is no such file, it belongs to a different query than KEY
+ * (checksum collision) or has expired.  Allocate the result in
+ * RESULT_POOL.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_cache_file(apr_array_header_t **entries,
+                const char *path,
+                const char *key,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  svn_stream_t *stream;
+  apr_hash_t *header = apr_hash_make(scratch_pool);
+  svn_string_t *value;
+  apr_int64_t expires;
+  svn_error_t *err;
+  apr_array_header_t *result;
+
+  *entries = NULL;
+
+  err = svn_stream_open_readonly(&stream, path, scratch_pool, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_hash_read2(header, stream, SVN_HASH_TERMINATOR, scratch_pool));
+
+  value = svn_hash_gets(header, KEY_QUERY);
+  if (!value || strcmp(value->data, key))
+    return svn_error_trace(svn_stream_close(stream));
+
+  value = svn_hash_gets(header, KEY_EXPIRES);
+  if (!value)
+    return svn_error_trace(svn_stream_close(stream));
+
+  SVN_ERR(svn_cstring_atoi64(&expires, value->data));
+  if (expires <= apr_time_now())
+    return svn_error_trace(svn_stream_close(stream));
+
+  result = apr_array_make(result_pool, 16, sizeof(svn_stringbuf_t *));
+  while (TRUE)
+    {
+      svn_stringbuf_t *line;
+      svn_stringbuf_t *data;
+      svn_boolean_t eof;
+      apr_uint64_t len;
+      apr_size_t read_len;
+
+      SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, scratch_pool));
+      if (eof && line->len == 0)
+        break;
+
+      SVN_ERR(svn_cstring_strtoui64(&len, line->data, 0, APR_SIZE_MAX - 1,
+                                    10));
+      read_len = (apr_size_t)len + 1;
+      data = svn_stringbuf_create_ensure(read_len, result_pool);
+      SVN_ERR(svn_stream_read_full(stream, data->data, &read_len));
+      if (read_len != (apr_size_t)len + 1 || data->data[len] != '\n')
+        return svn_error_trace(malformed_entry_error());
+
+      data->len = (apr_size_t)len;
+      data->data[len] = '\0';
+      APR_ARRAY_PUSH(result, svn_stringbuf_t *) = data;
+    }
+
+  SVN_ERR(svn_stream_close(stream));
+  *entries = result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for record_receiver(). */
+typedef struct record_baton_t
+{
+  /* The temporary cache file being written. */
+  svn_stream_t *stream;
+
+  /* Set once writing to STREAM failed. */
+  svn_boolean_t failed;
+
+  /* The receiver and baton as passed by the caller. */
+  svn_log_entry_receiver_t receiver;
+  void *baton;
+} record_baton_t;
+
+/* Write LOG_ENTRY to STREAM.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+write_log_entry(svn_stream_t *stream,
+                const svn_log_entry_t *log_entry,
+                apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *data = serialize_log_entry(log_entry, scratch_pool);
+
+  SVN_ERR(svn_stream_printf(stream, scratch_pool, "%" APR_SIZE_T_FMT "\n",
+                            data->len));
+  svn_stringbuf_appendbyte(data, '\n');
+
+  return svn_error_trace(svn_stream_write(stream, data->data, &data->len));
+}
+
+/* Implements svn_log_entry_receiver_t.  Write LOG_ENTRY to the cache
+ * file in the record_baton_t BATON, then pass it on to the actual
+ * receiver.  Failing to write the cache must not fail the log query.
+ */
+static svn_error_t *
+record_receiver(void *baton,
+                svn_log_entry_t *log_entry,
+                apr_pool_t *pool)
+{
+  record_baton_t *rb = baton;
+
+  if (!rb->failed)
+    {
+      svn_error_t *err = write_log_entry(rb->stream, log_entry, pool);
+
+      if (err)
+        {
+          svn_error_clear(err);
+          rb->failed = TRUE;
+        }
+    }
+
+  return svn_error_trace(rb->receiver(rb->baton, log_entry, pool));
+}
+
+svn_error_t *
+svn_client__get_log_cached(svn_ra_session_t *ra_session,
+                           const apr_array_header_t *paths,
+                           svn_revnum_t start,
+                           svn_revnum_t end,
+                           int limit,
+                           svn_boolean_t discover_changed_paths,
+                           svn_boolean_t strict_node_history,
+                           svn_boolean_t include_merged_revisions,
+                           const apr_array_header_t *revprops,
+                           svn_log_entry_receiver_t receiver,
+                           void *receiver_baton,
+                           svn_client_ctx_t *ctx,
+                           apr_pool_t *pool)
+{
+  svn_config_t *cfg = ctx->config
+                      ? svn_hash_gets(ctx->config, SVN_CONFIG_CATEGORY_CONFIG)
+                      : NULL;
+  apr_int64_t ttl;
+  const char *cache_dir;
+  const char *uuid;
+  const char *repos_root_url;
+  const char *session_url;
+  const char *key;
+  const char *cache_path;
+  svn_checksum_t *checksum;
+  apr_array_header_t *entries;
+  apr_pool_t *write_pool;
+  const char *tmp_path;
+  record_baton_t rb;
+  apr_hash_t *header;
+  svn_error_t *err;
+
+  SVN_ERR(svn_config_get_int64(cfg, &ttl, SVN_CONFIG_SECTION_MISCELLANY,
+                               SVN_CONFIG_OPTION_LOG_CACHE_TTL, 0));
+
+  /* Queries relative to HEAD can't be cached. */
+  if (ttl > 0 && SVN_IS_VALID_REVNUM(start) && SVN_IS_VALID_REVNUM(end))
+    SVN_ERR(svn_config_get_user_config_path(
+              &cache_dir,
+              ctx->auth_baton
+                ? svn_auth_get_parameter(ctx->auth_baton,
+                                         SVN_AUTH_PARAM_CONFIG_DIR)
+                : NULL,
+              LOG_CACHE_SUBDIR, pool));
+  else
+    cache_dir = NULL;
+
+  if (!cache_dir)
+    return svn_error_trace(svn_ra_get_log2(ra_session, paths, start, end,
+                                           limit, discover_changed_paths,
+                                           strict_node_history,
+                                           include_merged_revisions,
+                                           revprops, receiver,
+                                           receiver_baton, pool));
+
+  SVN_ERR(svn_ra_get_uuid2(ra_session, &uuid, pool));
+  SVN_ERR(svn_ra_get_repos_root2(ra_session, &repos_root_url, pool));
+  SVN_ERR(svn_ra_get_session_url(ra_session, &session_url, pool));
+
+  key = make_query_key(uuid,
+                       svn_uri_skip_ancestor(repos_root_url, session_url,
+                                             pool),
+                       paths, start, end, limit, discover_changed_paths,
+                       strict_node_history, include_merged_revisions,
+                       revprops, pool);
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_md5, key, strlen(key), pool));
+  cache_dir = svn_dirent_join(cache_dir, uuid, pool);
+  cache_path = svn_dirent_join(cache_dir,
+                               svn_checksum_to_cstring(checksum, pool),
+                               pool);
+
+  /* Treat a damaged cache file like a missing one. */
+  err = read_cache_file(&entries, cache_path, key, pool, pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      entries = NULL;
+    }
+
+  if (entries)
+    {
+      apr_pool_t *iterpool = svn_pool_create(pool);
+      apr_array_header_t *log_entries
+        = apr_array_make(pool, entries->nelts, sizeof(svn_log_entry_t *));
+      int i;
+
+      /* Parse everything before passing anything on, so that we can
+       * still fall back to the server. */
+      for (i = 0; i < entries->nelts; i++)
+        {
+          const svn_stringbuf_t *data
+            = APR_ARRAY_IDX(entries, i, const svn_stringbuf_t *);
+          svn_log_entry_t *log_entry;
+
+          err = parse_log_entry(&log_entry, data->data, data->len, pool);
+          if (err)
+            {
+              svn_error_clear(err);
+              log_entries = NULL;
+              break;
+            }
+
+          APR_ARRAY_PUSH(log_entries, svn_log_entry_t *) = log_entry;
+        }
+
+      for (i = 0; log_entries && i < log_entries->nelts; i++)
+        {
+          svn_pool_clear(iterpool);
+
+          if (ctx->cancel_func)
+            SVN_ERR(ctx->cancel_func(ctx->cancel_baton));
+
+          SVN_ERR(receiver(receiver_baton,
+                           APR_ARRAY_IDX(log_entries, i, svn_log_entry_t *),
+                           iterpool));
+        }
+      svn_pool_destroy(iterpool);
+
+      if (log_entries)
+        return SVN_NO_ERROR;
+    }
+
+  /* Run the query and record the result in a temporary file.  Destroying
+   * WRITE_POOL removes that file unless it has been moved into place. */
+  write_pool = svn_pool_create(pool);
+  header = apr_hash_make(write_pool);
+  svn_hash_sets(header, KEY_QUERY, svn_string_create(key, write_pool));
+  svn_hash_sets(header, KEY_EXPIRES,
+                svn_string_createf(write_pool, "%" APR_TIME_T_FMT,
+                                   apr_time_now() + apr_time_from_sec(ttl)));
+
+  err = svn_io_make_dir_recursively(cache_dir, write_pool);
+  if (!err)
+    err = svn_stream_open_unique(&rb.stream, &tmp_path, cache_dir,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 write_pool, write_pool);
+  if (!err)
+    err = svn_hash_write2(header, rb.stream, SVN_HASH_TERMINATOR,
+                          write_pool);
+
+  /* An unwritable cache doesn't keep us from answering the query. */
+  rb.failed = (err != NULL);
+  svn_error_clear(err);
+
+  rb.receiver = receiver;
+  rb.baton = receiver_baton;
+  err = svn_ra_get_log2(ra_session, paths, start, end, limit,
+                        discover_changed_paths, strict_node_history,
+                        include_merged_revisions, revprops,
+                        record_receiver, &rb, write_pool);
+
+  /* Concurrent processes may write the same file.  Replace it
+   * atomically; the last one wins. */
+  if (!err && !rb.failed)
+    svn_error_clear(svn_error_compose_create(
+                      svn_stream_close(rb.stream),
+                      svn_io_file_rename2(tmp_path, cache_path, FALSE,
+                                          write_pool)));
+
+  svn_pool_destroy(write_pool);
+
+  return svn_error_trace(err);
+}
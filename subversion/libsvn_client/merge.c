@@ -59,6 +59,7 @@
 #include "private/svn_client_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_thread.h"
 #include "private/svn_wc_private.h"
 
 #include "svn_private_config.h"
@@ -310,6 +311,10 @@ typedef struct merge_cmd_baton_t {
   svn_ra_session_t *ra_session1;
   svn_ra_session_t *ra_session2;
 
+  /* Repository mergeinfo within the merge target, shared by all merge
+     sources.  NULL if the target is a local addition. */
+  svn_client__mergeinfo_cache_t *repos_mergeinfo;
+
   /* During the merge, *USE_SLEEP is set to TRUE if a sleep will be required
      afterwards to ensure timestamp integrity, or unchanged if not. */
   svn_boolean_t *use_sleep;
@@ -319,6 +324,13 @@ typedef struct merge_cmd_baton_t {
      or do_file_merge() in do_merge(). */
   apr_pool_t *pool;
 
+  /* Text merges of files that have been prepared but not yet run and
+     completed, see flush_pending_text_merges(), and the thread-safe pool
+     containing them.  Both are NULL until the first text merge gets
+     queued after POOL has been cleared. */
+  apr_array_header_t *pending_text_merges;
+  apr_pool_t *text_merge_jobs_pool;
+
 
   /* State for notify_merge_begin() */
   struct notify_begin_state_t
@@ -1509,6 +1521,163 @@ record_update_update(merge_cmd_baton_t *merge_b,
   return SVN_NO_ERROR;
 }
 
+/* Number of text merges to prepare before running them. */
+#define TEXT_MERGE_BATCH_SIZE 64
+
+/* Maximum number of threads running a batch of text merges. */
+#define TEXT_MERGE_THREAD_COUNT 8
+
+/* A file merge that has been prepared and waits for its contents to be
+   merged. */
+typedef struct text_merge_job_t
+{
+  svn_wc__merge_t *merge;
+  const char *local_abspath;
+  svn_boolean_t has_local_mods;
+
+  /* Result of svn_wc__merge_run(). */
+  svn_error_t *err;
+
+  /* Pool only to be used by the thread processing this job. */
+  apr_pool_t *pool;
+} text_merge_job_t;
+
+/* Implements svn_thread__job_func_t, merging the contents of the
+   text_merge_job_t in DATA.  BATON is the svn_client_ctx_t used for
+   cancellation. */
+static void
+text_merge_job_func(void *data,
+                    int thread_index,
+                    void *baton)
+{
+  text_merge_job_t *job = data;
+  svn_client_ctx_t *ctx = baton;
+
+  job->err = svn_wc__merge_run(job->merge,
+                               ctx->cancel_func, ctx->cancel_baton,
+                               job->pool);
+}
+
+/* Pool cleanup handler destroying the jobs pool in BATON, and with it all
+   text merges that are still pending. */
+static apr_status_t
+discard_pending_text_merges(void *baton)
+{
+  svn_pool_destroy(baton);
+
+  return APR_SUCCESS;
+}
+
+/* Record the update of the file at LOCAL_ABSPATH with TEXT_STATE and
+   PROPERTY_STATE, if there is anything to record. */
+static svn_error_t *
+record_file_changed(merge_cmd_baton_t *merge_b,
+                    const char *local_abspath,
+                    svn_wc_notify_state_t text_state,
+                    svn_wc_notify_state_t property_state,
+                    apr_pool_t *scratch_pool)
+{
+  if (text_state == svn_wc_notify_state_conflicted
+      || text_state == svn_wc_notify_state_merged
+      || text_state == svn_wc_notify_state_changed
+      || property_state == svn_wc_notify_state_conflicted
+      || property_state == svn_wc_notify_state_merged
+      || property_state == svn_wc_notify_state_changed)
+    {
+      SVN_ERR(record_update_update(merge_b, local_abspath, svn_node_file,
+                                   text_state, property_state,
+                                   scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Complete MERGE of the file at LOCAL_ABSPATH, after its contents have been
+   merged, and record the outcome.  HAS_LOCAL_MODS tells whether the file
+   was modified before the merge. */
+static svn_error_t *
+complete_file_merge(merge_cmd_baton_t *merge_b,
+                    svn_wc__merge_t *merge,
+                    const char *local_abspath,
+                    svn_boolean_t has_local_mods,
+                    apr_pool_t *scratch_pool)
+{
+  svn_client_ctx_t *ctx = merge_b->ctx;
+  enum svn_wc_merge_outcome_t content_outcome;
+  svn_wc_notify_state_t text_state;
+  svn_wc_notify_state_t property_state;
+
+  SVN_ERR(svn_wc__merge_complete(&content_outcome, &property_state, merge,
+                                 ctx->cancel_func, ctx->cancel_baton,
+                                 scratch_pool));
+
+  if (content_outcome == svn_wc_merge_conflict
+      || property_state == svn_wc_notify_state_conflicted)
+    {
+      alloc_and_store_path(&merge_b->conflicted_paths, local_abspath,
+                           merge_b->pool);
+    }
+
+  if (content_outcome == svn_wc_merge_conflict)
+    text_state = svn_wc_notify_state_conflicted;
+  else if (has_local_mods
+           && content_outcome != svn_wc_merge_unchanged)
+    text_state = svn_wc_notify_state_merged;
+  else if (content_outcome == svn_wc_merge_merged)
+    text_state = svn_wc_notify_state_changed;
+  else if (content_outcome == svn_wc_merge_no_merge)
+    text_state = svn_wc_notify_state_missing;
+  else /* merge_outcome == svn_wc_merge_unchanged */
+    text_state = svn_wc_notify_state_unchanged;
+
+  return svn_error_trace(record_file_changed(merge_b, local_abspath,
+                                             text_state, property_state,
+                                             scratch_pool));
+}
+
+/* Merge the contents of all files with pending text merges in MERGE_B,
+   several at a time, then complete the merges and record their outcome
+   in the order in which they have been prepared.  Return the first
+   failure in that order.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+flush_pending_text_merges(merge_cmd_baton_t *merge_b,
+                          apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  if (! merge_b->pending_text_merges
+      || merge_b->pending_text_merges->nelts == 0)
+    return SVN_NO_ERROR;
+
+  svn_thread__run_batch(merge_b->pending_text_merges, text_merge_job_func,
+                        merge_b->ctx, TEXT_MERGE_THREAD_COUNT);
+
+  /* Access to the working copy database is kept in this thread. */
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < merge_b->pending_text_merges->nelts; ++i)
+    {
+      text_merge_job_t *job = APR_ARRAY_IDX(merge_b->pending_text_merges, i,
+                                            text_merge_job_t *);
+
+      svn_pool_clear(iterpool);
+
+      if (job->err || err)
+        err = svn_error_compose_create(err, job->err);
+      else
+        err = complete_file_merge(merge_b, job->merge, job->local_abspath,
+                                  job->has_local_mods, iterpool);
+
+      svn_pool_destroy(job->pool);
+    }
+  svn_pool_destroy(iterpool);
+
+  apr_array_clear(merge_b->pending_text_merges);
+
+  return svn_error_trace(err);
+}
+
 /* Record the delete for future processing and for (later) producing the
    update_delete notification */
 static svn_error_t *
@@ -2046,7 +2215,7 @@ merge_file_changed(const char *relpath,
     }
 
   /* This callback is essentially no more than a wrapper around
-     svn_wc_merge5().  Thank goodness that all the
+     svn_wc__merge_prepare().  Thank goodness that all the
      diff-editor-mechanisms are doing the hard work of getting the
      fulltexts! */
 
@@ -2087,7 +2256,9 @@ merge_file_changed(const char *relpath,
   else if (left_file)
     {
       svn_boolean_t has_local_mods;
-      enum svn_wc_merge_outcome_t content_outcome;
+      svn_wc__merge_t *merge;
+      apr_pool_t *job_pool;
+      svn_error_t *err;
       const char *target_label;
       const char *left_label;
       const char *right_label;
@@ -2122,52 +2293,72 @@ merge_file_changed(const char *relpath,
       SVN_ERR(svn_wc_text_modified_p2(&has_local_mods, ctx->wc_ctx,
                                       local_abspath, FALSE, scratch_pool));
 
+      if (! merge_b->pending_text_merges)
+        {
+          /* Job pools are used from several threads. */
+          merge_b->text_merge_jobs_pool
+            = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+          merge_b->pending_text_merges
+            = apr_array_make(merge_b->text_merge_jobs_pool,
+                             TEXT_MERGE_BATCH_SIZE,
+                             sizeof(text_merge_job_t *));
+          apr_pool_cleanup_register(merge_b->pool,
+                                    merge_b->text_merge_jobs_pool,
+                                    discard_pending_text_merges,
+                                    apr_pool_cleanup_null);
+        }
+
+      job_pool = svn_pool_create(merge_b->text_merge_jobs_pool);
+
       /* Do property merge and text merge in one step so that keyword expansion
-         takes into account the new property values. */
-      SVN_ERR(svn_wc_merge5(&content_outcome, &property_state, ctx->wc_ctx,
-                            left_file, right_file, local_abspath,
-                            left_label, right_label, target_label,
-                            left, right,
-                            merge_b->dry_run, merge_b->diff3_cmd,
-                            merge_b->merge_options,
-                            left_props, prop_changes,
-                            NULL, NULL,
-                            ctx->cancel_func,
-                            ctx->cancel_baton,
-                            scratch_pool));
+         takes into account the new property values.  The diff driver
+         removes LEFT_FILE and RIGHT_FILE when we return, so have the merge
+         use copies of them if it has to be run later. */
+      err = svn_wc__merge_prepare(&merge, ctx->wc_ctx,
+                                  left_file, right_file, local_abspath,
+                                  left_label, right_label, target_label,
+                                  left, right,
+                                  merge_b->dry_run, merge_b->diff3_cmd,
+                                  merge_b->merge_options,
+                                  left_props, prop_changes,
+                                  TRUE, TRUE,
+                                  NULL, NULL,
+                                  ctx->cancel_func,
+                                  ctx->cancel_baton,
+                                  job_pool, scratch_pool);
 
-      if (content_outcome == svn_wc_merge_conflict
-          || property_state == svn_wc_notify_state_conflicted)
+      if (! err && svn_wc__merge_needs_run(merge))
         {
-          alloc_and_store_path(&merge_b->conflicted_paths, local_abspath,
-                               merge_b->pool);
+          text_merge_job_t *job = apr_pcalloc(job_pool, sizeof(*job));
+
+          job->merge = merge;
+          job->local_abspath = apr_pstrdup(job_pool, local_abspath);
+          job->has_local_mods = has_local_mods;
+          job->pool = job_pool;
+
+          APR_ARRAY_PUSH(merge_b->pending_text_merges,
+                         text_merge_job_t *) = job;
+
+          /* The outcome will be recorded once the batch has been run. */
+          if (merge_b->pending_text_merges->nelts >= TEXT_MERGE_BATCH_SIZE)
+            SVN_ERR(flush_pending_text_merges(merge_b, scratch_pool));
+
+          return SVN_NO_ERROR;
         }
 
-      if (content_outcome == svn_wc_merge_conflict)
-        text_state = svn_wc_notify_state_conflicted;
-      else if (has_local_mods
-               && content_outcome != svn_wc_merge_unchanged)
-        text_state = svn_wc_notify_state_merged;
-      else if (content_outcome == svn_wc_merge_merged)
-        text_state = svn_wc_notify_state_changed;
-      else if (content_outcome == svn_wc_merge_no_merge)
-        text_state = svn_wc_notify_state_missing;
-      else /* merge_outcome == svn_wc_merge_unchanged */
-        text_state = svn_wc_notify_state_unchanged;
-    }
+      if (! err)
+        err = complete_file_merge(merge_b, merge, local_abspath,
+                                  has_local_mods, scratch_pool);
 
-  if (text_state == svn_wc_notify_state_conflicted
-      || text_state == svn_wc_notify_state_merged
-      || text_state == svn_wc_notify_state_changed
-      || property_state == svn_wc_notify_state_conflicted
-      || property_state == svn_wc_notify_state_merged
-      || property_state == svn_wc_notify_state_changed)
-    {
-      SVN_ERR(record_update_update(merge_b, local_abspath, svn_node_file,
-                                   text_state, property_state,
-                                   scratch_pool));
+      svn_pool_destroy(job_pool);
+
+      return svn_error_trace(err);
     }
 
+  SVN_ERR(record_file_changed(merge_b, local_abspath,
+                              text_state, property_state,
+                              scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -4213,6 +4404,7 @@ fix_deleted_subtree_ranges(const merge_source_t *source,
 
    RA_SESSION is an RA session open to the repository in which TARGET_ABSPATH
    lives.  It may be temporarily reparented as needed by this function.
+   CACHE is passed through to svn_client__get_wc_or_repos_mergeinfo().
 
    Allocate *RECORDED_MERGEINFO and *IMPLICIT_MERGEINFO in RESULT_POOL.
    Use SCRATCH_POOL for any temporary allocations. */
@@ -4222,6 +4414,7 @@ get_full_mergeinfo(svn_mergeinfo_t *recorded_mergeinfo,
                    svn_boolean_t *inherited,
                    svn_mergeinfo_inheritance_t inherit,
                    svn_ra_session_t *ra_session,
+                   svn_client__mergeinfo_cache_t *cache,
                    const char *target_abspath,
                    svn_revnum_t start,
                    svn_revnum_t end,
@@ -4237,7 +4430,7 @@ get_full_mergeinfo(svn_mergeinfo_t *recorded_mergeinfo,
                                                     NULL /* from_repos */,
                                                     FALSE,
                                                     inherit, ra_session,
-                                                    target_abspath,
+                                                    cache, target_abspath,
                                                     ctx, result_pool));
     }
 
@@ -4327,7 +4520,7 @@ inherit_implicit_mergeinfo_from_parent(svn_client__merge_path_t *parent,
   if (!parent->implicit_mergeinfo)
     SVN_ERR(get_full_mergeinfo(NULL, &(parent->implicit_mergeinfo),
                                NULL, svn_mergeinfo_inherited,
-                               ra_session, child->abspath,
+                               ra_session, NULL, child->abspath,
                                MAX(revision1, revision2),
                                MIN(revision1, revision2),
                                ctx, result_pool, scratch_pool));
@@ -4392,7 +4585,7 @@ ensure_implicit_mergeinfo(svn_client__merge_path_t *parent,
     SVN_ERR(get_full_mergeinfo(NULL,
                                &(child->implicit_mergeinfo),
                                NULL, svn_mergeinfo_inherited,
-                               ra_session, child->abspath,
+                               ra_session, NULL, child->abspath,
                                MAX(revision1, revision2),
                                MIN(revision1, revision2),
                                ctx, result_pool, scratch_pool));
@@ -5030,7 +5223,7 @@ populate_remaining_ranges(apr_array_header_t *children_with_mergeinfo,
                                          &(child->implicit_mergeinfo),
                                          NULL, /* child->inherited_mergeinfo */
                                          svn_mergeinfo_inherited, ra_session,
-                                         child->abspath,
+                                         NULL, child->abspath,
                                          MAX(source->loc1->rev,
                                              source->loc2->rev),
                                          MIN(source->loc1->rev,
@@ -5135,7 +5328,7 @@ populate_remaining_ranges(apr_array_header_t *children_with_mergeinfo,
         (i == 0) ? &(child->implicit_mergeinfo) : NULL,
         &(child->inherited_mergeinfo),
         svn_mergeinfo_inherited, ra_session,
-        child->abspath,
+        merge_b->repos_mergeinfo, child->abspath,
         MAX(source->loc1->rev, source->loc2->rev),
         MIN(source->loc1->rev, source->loc2->rev),
         merge_b->ctx, result_pool, iterpool));
@@ -5768,7 +5961,7 @@ drive_merge_report_editor(const char *target_abspath,
                                        depth,
                                        source->loc1->rev,
                                        TRUE /* text_deltas */,
-                                       processor,
+                                       processor, NULL,
                                        merge_b->ctx->cancel_func,
                                        merge_b->ctx->cancel_baton,
                                        scratch_pool));
@@ -5881,6 +6074,9 @@ drive_merge_report_editor(const char *target_abspath,
     }
   SVN_ERR(reporter->finish_report(report_baton, scratch_pool));
 
+  /* Complete the text merges still waiting to be run. */
+  SVN_ERR(flush_pending_text_merges(merge_b, scratch_pool));
+
   /* Point the merge baton's RA sessions back where they were. */
   SVN_ERR(svn_ra_reparent(merge_b->ra_session1, old_sess1_url, scratch_pool));
   SVN_ERR(svn_ra_reparent(merge_b->ra_session2, old_sess2_url, scratch_pool));
@@ -7495,7 +7691,8 @@ do_file_merge(svn_mergeinfo_catalog_t result_catalog,
       err = get_full_mergeinfo(&target_mergeinfo,
                                &(merge_target->implicit_mergeinfo),
                                &inherited, svn_mergeinfo_inherited,
-                               merge_b->ra_session1, target_abspath,
+                               merge_b->ra_session1,
+                               merge_b->repos_mergeinfo, target_abspath,
                                MAX(source->loc1->rev, source->loc2->rev),
                                MIN(source->loc1->rev, source->loc2->rev),
                                ctx, scratch_pool, iterpool);
@@ -7738,6 +7935,8 @@ do_file_merge(svn_mergeinfo_catalog_t result_catalog,
                                               file_baton,
                                               processor,
                                               iterpool));
+
+              SVN_ERR(flush_pending_text_merges(merge_b, iterpool));
             }
 
           if (is_path_conflicted_by_merge(merge_b))
@@ -7904,6 +8103,7 @@ process_children_with_new_mergeinfo(merge_cmd_baton_t *merge_b,
             FALSE,
             svn_mergeinfo_nearest_ancestor, /* We only want inherited MI */
             merge_b->ra_session2,
+            merge_b->repos_mergeinfo,
             abspath_with_new_mergeinfo,
             merge_b->ctx,
             iterpool));
@@ -9873,6 +10073,10 @@ do_merge(apr_hash_t **modified_subtrees,
   merge_cmd_baton.reintegrate_merge = reintegrate_merge;
   merge_cmd_baton.target = target;
   merge_cmd_baton.pool = iterpool;
+  merge_cmd_baton.repos_mergeinfo
+    = target->loc.url
+        ? svn_client__mergeinfo_cache_create(target->loc.url, scratch_pool)
+        : NULL;
   merge_cmd_baton.merge_options = merge_options;
   merge_cmd_baton.diff3_cmd = diff3_cmd;
   merge_cmd_baton.ext_patterns = *preserved_exts_str
@@ -9951,6 +10155,8 @@ do_merge(apr_hash_t **modified_subtrees,
       merge_cmd_baton.conflicted_paths = NULL;
       merge_cmd_baton.paths_with_new_mergeinfo = NULL;
       merge_cmd_baton.paths_with_deleted_mergeinfo = NULL;
+      merge_cmd_baton.pending_text_merges = NULL;
+      merge_cmd_baton.text_merge_jobs_pool = NULL;
       merge_cmd_baton.ra_session1 = ra_session1;
       merge_cmd_baton.ra_session2 = ra_session2;
 
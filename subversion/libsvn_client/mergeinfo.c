@@ -551,6 +551,173 @@ svn_client__get_repos_mergeinfo_catalog(svn_mergeinfo_catalog_t *mergeinfo_cat,
 }
 
 
+struct svn_client__mergeinfo_cache_t
+{
+  /* URL of the root of the cached tree. */
+  const char *root_url;
+
+  /* Repository root-relative path of ROOT_URL.  NULL until known. */
+  const char *root_relpath;
+
+  /* Maps svn_revnum_t revisions to the mergeinfo_cache_entry_t for the
+     tree in that revision. */
+  apr_hash_t *revisions;
+
+  /* For everything above. */
+  apr_pool_t *pool;
+};
+
+/* The mergeinfo of a tree in one revision. */
+typedef struct mergeinfo_cache_entry_t
+{
+  svn_revnum_t revision;
+
+  /* FALSE if the mergeinfo could not be fetched.  Such lookups have to
+     be passed on to the server. */
+  svn_boolean_t available;
+
+  /* The mergeinfo of the tree's root, explicit or inherited, plus the
+     explicit mergeinfo of all its descendants, keyed by repository
+     root-relative path.  May be NULL if there is none. */
+  svn_mergeinfo_catalog_t catalog;
+} mergeinfo_cache_entry_t;
+
+svn_client__mergeinfo_cache_t *
+svn_client__mergeinfo_cache_create(const char *root_url,
+                                   apr_pool_t *result_pool)
+{
+  svn_client__mergeinfo_cache_t *cache = apr_pcalloc(result_pool,
+                                                     sizeof(*cache));
+  cache->root_url = apr_pstrdup(result_pool, root_url);
+  cache->revisions = apr_hash_make(result_pool);
+  cache->pool = result_pool;
+
+  return cache;
+}
+
+/* Look up the mergeinfo of URL, which lives at REPOS_RELPATH, in REV in
+   CACHE, in the way svn_client__get_repos_mergeinfo_catalog() with INHERIT
+   and without descendants would.  Fetch the mergeinfo for REV through
+   RA_SESSION if it is not in CACHE, yet.
+
+   Set *FOUND to FALSE if CACHE can't answer this query, e.g. because URL
+   is outside the cached tree.  Otherwise, set *FOUND to TRUE and
+   *MERGEINFO_CAT as svn_client__get_repos_mergeinfo_catalog() would,
+   allocated in RESULT_POOL.
+
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+mergeinfo_cache_lookup(svn_mergeinfo_catalog_t *mergeinfo_cat,
+                       svn_boolean_t *found,
+                       svn_client__mergeinfo_cache_t *cache,
+                       svn_ra_session_t *ra_session,
+                       const char *url,
+                       const char *repos_relpath,
+                       svn_revnum_t rev,
+                       svn_mergeinfo_inheritance_t inherit,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  mergeinfo_cache_entry_t *entry;
+  const char *relpath;
+  const char *ancestor_relpath;
+  svn_mergeinfo_t mergeinfo = NULL;
+
+  *found = FALSE;
+  *mergeinfo_cat = NULL;
+
+  /* The mergeinfo of the tree's root may have been inherited.  So, we
+     only know the explicit mergeinfo of its descendants. */
+  relpath = svn_uri_skip_ancestor(cache->root_url, url, scratch_pool);
+  if (!relpath || !*relpath)
+    return SVN_NO_ERROR;
+
+  entry = apr_hash_get(cache->revisions, &rev, sizeof(rev));
+  if (!entry)
+    {
+      svn_error_t *err;
+
+      entry = apr_pcalloc(cache->pool, sizeof(*entry));
+      entry->revision = rev;
+      apr_hash_set(cache->revisions, &entry->revision,
+                   sizeof(entry->revision), entry);
+
+      if (!cache->root_relpath)
+        SVN_ERR(svn_ra_get_path_relative_to_root(ra_session,
+                                                 &cache->root_relpath,
+                                                 cache->root_url,
+                                                 cache->pool));
+
+      /* E.g. the root may not exist in REV if the working copy has mixed
+         revisions.  Leave those queries to the server. */
+      err = svn_client__get_repos_mergeinfo_catalog(&entry->catalog,
+                                                    ra_session,
+                                                    cache->root_url, rev,
+                                                    svn_mergeinfo_inherited,
+                                                    FALSE, TRUE,
+                                                    cache->pool,
+                                                    scratch_pool);
+      if (err)
+        svn_error_clear(err);
+      else
+        entry->available = TRUE;
+    }
+
+  if (!entry->available)
+    return SVN_NO_ERROR;
+
+  *found = TRUE;
+  if (!entry->catalog)
+    return SVN_NO_ERROR;
+
+  /* Find the nearest path with mergeinfo, just like the repository
+     would. */
+  ancestor_relpath = repos_relpath;
+  if (inherit == svn_mergeinfo_nearest_ancestor)
+    ancestor_relpath = svn_relpath_dirname(ancestor_relpath, scratch_pool);
+
+  while (TRUE)
+    {
+      mergeinfo = svn_hash_gets(entry->catalog, ancestor_relpath);
+      if (mergeinfo || inherit == svn_mergeinfo_explicit)
+        break;
+
+      /* The mergeinfo of the root is in the catalog, if there is any. */
+      if (strcmp(ancestor_relpath, cache->root_relpath) == 0
+          || !*ancestor_relpath)
+        break;
+
+      ancestor_relpath = svn_relpath_dirname(ancestor_relpath, scratch_pool);
+    }
+
+  if (!mergeinfo)
+    return SVN_NO_ERROR;
+
+  if (ancestor_relpath == repos_relpath)
+    {
+      mergeinfo = svn_mergeinfo_dup(mergeinfo, result_pool);
+    }
+  else
+    {
+      /* Inherited mergeinfo: Remove non-inheritable ranges and adjust
+         the merge source paths. */
+      SVN_ERR(svn_mergeinfo_inheritable2(&mergeinfo, mergeinfo, NULL,
+                                         SVN_INVALID_REVNUM,
+                                         SVN_INVALID_REVNUM, TRUE,
+                                         scratch_pool, scratch_pool));
+      SVN_ERR(svn_mergeinfo__add_suffix_to_mergeinfo(
+                &mergeinfo, mergeinfo,
+                svn_relpath_skip_ancestor(ancestor_relpath, repos_relpath),
+                result_pool, scratch_pool));
+    }
+
+  *mergeinfo_cat = apr_hash_make(result_pool);
+  svn_hash_sets(*mergeinfo_cat, apr_pstrdup(result_pool, repos_relpath),
+                mergeinfo);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_client__get_wc_or_repos_mergeinfo(svn_mergeinfo_t *target_mergeinfo,
                                       svn_boolean_t *inherited,
@@ -558,6 +725,7 @@ svn_client__get_wc_or_repos_mergeinfo(svn_mergeinfo_t *target_mergeinfo,
                                       svn_boolean_t repos_only,
                                       svn_mergeinfo_inheritance_t inherit,
                                       svn_ra_session_t *ra_session,
+                                      svn_client__mergeinfo_cache_t *cache,
                                       const char *target_wcpath,
                                       svn_client_ctx_t *ctx,
                                       apr_pool_t *pool)
@@ -571,7 +739,7 @@ svn_client__get_wc_or_repos_mergeinfo(svn_mergeinfo_t *target_mergeinfo,
                                                         FALSE,
                                                         repos_only,
                                                         FALSE, inherit,
-                                                        ra_session,
+                                                        ra_session, cache,
                                                         target_wcpath, ctx,
                                                         pool, pool));
   if (tgt_mergeinfo_cat && apr_hash_count(tgt_mergeinfo_cat))
@@ -599,6 +767,7 @@ svn_client__get_wc_or_repos_mergeinfo_catalog(
   svn_boolean_t ignore_invalid_mergeinfo,
   svn_mergeinfo_inheritance_t inherit,
   svn_ra_session_t *ra_session,
+  svn_client__mergeinfo_cache_t *cache,
   const char *target_wcpath,
   svn_client_ctx_t *ctx,
   apr_pool_t *result_pool,
@@ -680,6 +849,7 @@ svn_client__get_wc_or_repos_mergeinfo_catalog(
           if (!svn_hash_gets(original_props, SVN_PROP_MERGEINFO))
             {
               apr_pool_t *sesspool = NULL;
+              svn_boolean_t found = FALSE;
 
               if (! ra_session)
                 {
@@ -689,11 +859,19 @@ svn_client__get_wc_or_repos_mergeinfo_catalog(
                                                       sesspool, sesspool));
                 }
 
-              SVN_ERR(svn_client__get_repos_mergeinfo_catalog(
-                        &target_mergeinfo_cat_repos, ra_session,
-                        url, target_rev, inherit,
-                        TRUE, include_descendants,
-                        result_pool, scratch_pool));
+              if (cache && !include_descendants)
+                SVN_ERR(mergeinfo_cache_lookup(&target_mergeinfo_cat_repos,
+                                               &found, cache, ra_session,
+                                               url, repos_relpath,
+                                               target_rev, inherit,
+                                               result_pool, scratch_pool));
+
+              if (!found)
+                SVN_ERR(svn_client__get_repos_mergeinfo_catalog(
+                          &target_mergeinfo_cat_repos, ra_session,
+                          url, target_rev, inherit,
+                          TRUE, include_descendants,
+                          result_pool, scratch_pool));
 
               if (target_mergeinfo_cat_repos
                   && svn_hash_gets(target_mergeinfo_cat_repos, repos_relpath))
@@ -978,7 +1156,7 @@ svn_client__elide_mergeinfo(const char *target_abspath,
           err = svn_client__get_wc_or_repos_mergeinfo(
             &mergeinfo, NULL, NULL, TRUE,
             svn_mergeinfo_nearest_ancestor,
-            NULL, target_abspath, ctx, pool);
+            NULL, NULL, target_abspath, ctx, pool);
           if (err)
             {
               if (err->apr_err == SVN_ERR_MERGEINFO_PARSE_ERROR)
@@ -1093,7 +1271,7 @@ get_mergeinfo(svn_mergeinfo_catalog_t *mergeinfo_catalog,
       SVN_ERR(svn_client__get_wc_or_repos_mergeinfo_catalog(
         mergeinfo_catalog, NULL, NULL, include_descendants, FALSE,
         ignore_invalid_mergeinfo, svn_mergeinfo_inherited,
-        ra_session, path_or_url, ctx,
+        ra_session, NULL, path_or_url, ctx,
         result_pool, scratch_pool));
     }
 
@@ -220,6 +220,23 @@ svn_client__get_repos_mergeinfo_catalog(svn_mergeinfo_catalog_t *mergeinfo_cat,
                                         apr_pool_t *result_pool,
                                         apr_pool_t *scratch_pool);
 
+/* A cache of the repository mergeinfo within one tree of the repository,
+   e.g. that of a merge target.
+
+   The first lookup for a given revision fetches the mergeinfo of the whole
+   tree in that revision with a single request.  All further lookups for
+   paths within that tree and revision are answered from memory.  This is
+   much cheaper than asking the server for the mergeinfo of every single
+   subtree of a merge target. */
+typedef struct svn_client__mergeinfo_cache_t svn_client__mergeinfo_cache_t;
+
+/* Return a new, empty mergeinfo cache for the tree at ROOT_URL, allocated
+   in RESULT_POOL.  The cache will allocate the mergeinfo it fetches in
+   RESULT_POOL, too. */
+svn_client__mergeinfo_cache_t *
+svn_client__mergeinfo_cache_create(const char *root_url,
+                                   apr_pool_t *result_pool);
+
 /* Retrieve the direct mergeinfo for the TARGET_WCPATH from the WC's
    mergeinfo prop, or that inherited from its nearest ancestor if the
    target has no info of its own.
@@ -228,7 +245,8 @@ svn_client__get_repos_mergeinfo_catalog(svn_mergeinfo_catalog_t *mergeinfo_cat,
    get it from the repository.  If the repository is contacted for mergeinfo
    and RA_SESSION does not point to TARGET_WCPATH's URL, then it is
    temporarily reparented.  If RA_SESSION is NULL, then a temporary session
-   is opened as needed.
+   is opened as needed.  If CACHE is not NULL, use it to look up mergeinfo
+   in the repository.
 
    Store any mergeinfo obtained for TARGET_WCPATH in
    *TARGET_MERGEINFO, if no mergeinfo is found *TARGET_MERGEINFO is
@@ -255,6 +273,7 @@ svn_client__get_wc_or_repos_mergeinfo(svn_mergeinfo_t *target_mergeinfo,
                                       svn_boolean_t repos_only,
                                       svn_mergeinfo_inheritance_t inherit,
                                       svn_ra_session_t *ra_session,
+                                      svn_client__mergeinfo_cache_t *cache,
                                       const char *target_wcpath,
                                       svn_client_ctx_t *ctx,
                                       apr_pool_t *pool);
@@ -284,6 +303,7 @@ svn_client__get_wc_or_repos_mergeinfo_catalog(
   svn_boolean_t ignore_invalid_mergeinfo,
   svn_mergeinfo_inheritance_t inherit,
   svn_ra_session_t *ra_session,
+  svn_client__mergeinfo_cache_t *cache,
   const char *target_wcpath,
   svn_client_ctx_t *ctx,
   apr_pool_t *result_pool,
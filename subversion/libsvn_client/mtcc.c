@@ -40,6 +40,10 @@
 
 #define SVN_PATH_IS_EMPTY(s) ((s)[0] == '\0')
 
+/* After this many nodes within the same repository directory had to be
+   checked one by one, fetch the kinds of all its children at once */
+#define DIR_LISTING_THRESHOLD 8
+
 /* The kind of operation to perform in an mtcc_op_t */
 typedef enum mtcc_kind_t
 {
@@ -89,8 +93,23 @@ struct svn_client__mtcc_t
   svn_client_ctx_t *ctx;
 
   mtcc_op_t *root_op;
+
+  /* Maps "REV/RELPATH" of repository directories to dir_kinds_t *,
+     see mtcc_repos_check_path() */
+  apr_hash_t *dir_kinds;
 };
 
+/* Node kinds of the children of a repository directory, as already
+   obtained from the repository */
+typedef struct dir_kinds_t
+{
+  apr_hash_t *kinds;          /* Maps const char * names to
+                                 svn_node_kind_t * */
+  svn_boolean_t complete;     /* KINDS lists all existing children */
+  int checks;                 /* Children checked one by one, or -1 if
+                                 the directory can't be listed */
+} dir_kinds_t;
+
 static mtcc_op_t *
 mtcc_op_create(const char *name,
                svn_boolean_t add,
@@ -339,6 +358,7 @@ svn_client__mtcc_create(svn_client__mtcc_t **mtcc,
   (*mtcc)->pool = mtcc_pool;
 
   (*mtcc)->root_op = mtcc_op_create(NULL, FALSE, TRUE, mtcc_pool);
+  (*mtcc)->dir_kinds = apr_hash_make(mtcc_pool);
 
   (*mtcc)->ctx = ctx;
 
@@ -417,6 +437,9 @@ mtcc_reparent(const char *new_anchor_url,
 
   SVN_ERR(svn_ra_reparent(mtcc->ra_session, new_anchor_url, scratch_pool));
 
+  /* The known kinds are keyed by session relative paths */
+  apr_hash_clear(mtcc->dir_kinds);
+
   /* Create directory open operations for new ancestors */
   while (*up)
     {
@@ -435,6 +458,97 @@ mtcc_reparent(const char *new_anchor_url,
   return SVN_NO_ERROR;
 }
 
+/* Like svn_ra_check_path() on the session of MTCC, but remember the
+   results.  Once several children of the same directory have been checked,
+   fetch the kinds of all its children with a single request, so that
+   operating on thousands of nodes in one directory doesn't take thousands
+   of round trips to the server. */
+static svn_error_t *
+mtcc_repos_check_path(svn_node_kind_t *kind,
+                      const char *relpath,
+                      svn_revnum_t revision,
+                      svn_client__mtcc_t *mtcc,
+                      apr_pool_t *scratch_pool)
+{
+  const char *dir_relpath;
+  const char *name;
+  const char *key;
+  dir_kinds_t *dk;
+  svn_node_kind_t *known_kind;
+
+  if (SVN_PATH_IS_EMPTY(relpath))
+    return svn_error_trace(svn_ra_check_path(mtcc->ra_session, relpath,
+                                             revision, kind, scratch_pool));
+
+  svn_relpath_split(&dir_relpath, &name, relpath, scratch_pool);
+  key = apr_psprintf(scratch_pool, "%ld/%s", revision, dir_relpath);
+
+  dk = svn_hash_gets(mtcc->dir_kinds, key);
+  if (!dk)
+    {
+      dk = apr_pcalloc(mtcc->pool, sizeof(*dk));
+      dk->kinds = apr_hash_make(mtcc->pool);
+      svn_hash_sets(mtcc->dir_kinds, apr_pstrdup(mtcc->pool, key), dk);
+    }
+
+  if (!dk->complete && dk->checks >= DIR_LISTING_THRESHOLD)
+    {
+      apr_hash_t *dirents;
+      apr_hash_index_t *hi;
+      svn_error_t *err;
+
+      err = svn_ra_get_dir2(mtcc->ra_session, &dirents, NULL, NULL,
+                            dir_relpath, revision, SVN_DIRENT_KIND,
+                            scratch_pool);
+
+      if (err && err->apr_err == SVN_ERR_CANCELLED)
+        return svn_error_trace(err);
+      else if (err)
+        {
+          /* Not a directory or not listable for us. Keep asking for the
+             individual nodes */
+          svn_error_clear(err);
+          dk->checks = -1;
+        }
+      else
+        {
+          for (hi = apr_hash_first(scratch_pool, dirents); hi;
+               hi = apr_hash_next(hi))
+            {
+              const svn_dirent_t *dirent = apr_hash_this_val(hi);
+
+              svn_hash_sets(dk->kinds,
+                            apr_pstrdup(mtcc->pool, apr_hash_this_key(hi)),
+                            apr_pmemdup(mtcc->pool, &dirent->kind,
+                                        sizeof(dirent->kind)));
+            }
+          dk->complete = TRUE;
+        }
+    }
+
+  known_kind = svn_hash_gets(dk->kinds, name);
+  if (known_kind)
+    {
+      *kind = *known_kind;
+      return SVN_NO_ERROR;
+    }
+  else if (dk->complete)
+    {
+      *kind = svn_node_none;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_ra_check_path(mtcc->ra_session, relpath, revision, kind,
+                            scratch_pool));
+
+  if (dk->checks >= 0)
+    dk->checks++;
+  svn_hash_sets(dk->kinds, apr_pstrdup(mtcc->pool, name),
+                apr_pmemdup(mtcc->pool, kind, sizeof(*kind)));
+
+  return SVN_NO_ERROR;
+}
+
 /* Check if it is safe to create a new node at NEW_RELPATH. Return a proper
    error if it is not */
 static svn_error_t *
@@ -541,8 +655,8 @@ svn_client__mtcc_add_copy(const char *src_relpath,
   SVN_ERR(mtcc_verify_create(mtcc, dst_relpath, scratch_pool));
 
   /* Subversion requires the kind of a copy */
-  SVN_ERR(svn_ra_check_path(mtcc->ra_session, src_relpath, revision, &kind,
-                            scratch_pool));
+  SVN_ERR(mtcc_repos_check_path(&kind, src_relpath, revision, mtcc,
+                                scratch_pool));
 
   if (kind != svn_node_dir && kind != svn_node_file)
     {
@@ -1025,8 +1139,8 @@ svn_client__mtcc_check_path(svn_node_kind_t *kind,
       if (!origin_relpath)
         *kind = svn_node_none;
       else
-        SVN_ERR(svn_ra_check_path(mtcc->ra_session, origin_relpath,
-                                  origin_rev, kind, scratch_pool));
+        SVN_ERR(mtcc_repos_check_path(kind, origin_relpath, origin_rev,
+                                      mtcc, scratch_pool));
 
       if (op && *kind == svn_node_dir)
         {
@@ -73,6 +73,32 @@ typedef struct hunk_info_t {
   svn_linenum_t report_fuzz;
 } hunk_info_t;
 
+/* A line of unpatched content as returned by readline(). */
+typedef struct cached_line_t {
+  /* The line without its EOL, with keywords contracted. */
+  const char *line;
+
+  /* The EOL string of the line, or NULL if it had none. */
+  const char *eol_str;
+
+  /* Whether reading the line hit the end of the unpatched content. */
+  svn_boolean_t eof;
+
+  /* Whether the line counts towards the line number, i.e. whether it was
+   * not just the empty remainder at the end of the content. */
+  svn_boolean_t advanced;
+
+  /* The offset in the unpatched content right behind the line. */
+  apr_off_t next_offset;
+} cached_line_t;
+
+/* The original and modified texts of a hunk, split into lines without
+ * EOL and with keywords contracted.  Either array is NULL until needed. */
+typedef struct hunk_lines_t {
+  apr_array_header_t *original;
+  apr_array_header_t *modified;
+} hunk_lines_t;
+
 /* A struct carrying information related to the patched and unpatched
  * content of a target, be it a property or the text of a file. */
 typedef struct target_content_t {
@@ -95,6 +121,22 @@ typedef struct target_content_t {
    * each line in the unpatched content. */
   apr_array_header_t *lines;
 
+  /* An array containing a cached_line_t for each line in LINES, in the
+   * same order.  Hunks are matched at many candidate positions, so every
+   * line gets read many times, but it only gets read from the unpatched
+   * content and translated once. */
+  apr_array_header_t *line_cache;
+
+  /* If TRUE, lines have been served from LINE_CACHE and the unpatched
+   * content has to be positioned at PENDING_OFFSET before reading from
+   * it again. */
+  svn_boolean_t seek_pending;
+  apr_off_t pending_offset;
+
+  /* A hash mapping svn_diff_hunk_t * to hunk_lines_t, caching the hunk
+   * texts matched against this content. */
+  apr_hash_t *hunk_lines;
+
   /* An array containing hunk_info_t structures for hunks already matched. */
   apr_array_header_t *hunks;
 
@@ -759,6 +801,8 @@ init_prop_target(prop_patch_target_t **prop_target,
   content->current_line = 1;
   content->eol_style = svn_subst_eol_style_none;
   content->lines = apr_array_make(result_pool, 0, sizeof(apr_off_t));
+  content->line_cache = apr_array_make(result_pool, 0, sizeof(cached_line_t));
+  content->hunk_lines = apr_hash_make(result_pool);
   content->hunks = apr_array_make(result_pool, 0, sizeof(hunk_info_t *));
   content->keywords = apr_hash_make(result_pool);
 
@@ -1028,6 +1072,8 @@ init_patch_target(patch_target_t **patch_target,
   content->current_line = 1;
   content->eol_style = svn_subst_eol_style_none;
   content->lines = apr_array_make(result_pool, 0, sizeof(apr_off_t));
+  content->line_cache = apr_array_make(result_pool, 0, sizeof(cached_line_t));
+  content->hunk_lines = apr_hash_make(result_pool);
   content->hunks = apr_array_make(result_pool, 0, sizeof(hunk_info_t *));
   content->keywords = apr_hash_make(result_pool);
 
@@ -1441,19 +1487,18 @@ init_patch_target(patch_target_t **patch_target,
 }
 
 /* Read a *LINE from CONTENT. If the line has not been read before
- * mark the line in CONTENT->LINES.
- * If a line could be read successfully, increase CONTENT->CURRENT_LINE,
- * and allocate *LINE in RESULT_POOL.
+ * mark the line in CONTENT->LINES and remember it in CONTENT->LINE_CACHE.
+ * Lines read before are taken from that cache.
+ * If a line could be read successfully, increase CONTENT->CURRENT_LINE.
+ * *LINE lives as long as CONTENT.
  * Do temporary allocations in SCRATCH_POOL.
  */
 static svn_error_t *
 readline(target_content_t *content,
          const char **line,
-         apr_pool_t *result_pool,
          apr_pool_t *scratch_pool)
 {
-  svn_stringbuf_t *line_raw;
-  const char *eol_str;
+  const cached_line_t *cached;
   svn_linenum_t max_line = (svn_linenum_t)content->lines->nelts + 1;
 
   if (content->eof || content->readline == NULL)
@@ -1463,33 +1508,65 @@ readline(target_content_t *content,
     }
 
   SVN_ERR_ASSERT(content->current_line <= max_line);
-  if (content->current_line == max_line)
+  if (content->current_line < max_line)
+    {
+      cached = &APR_ARRAY_IDX(content->line_cache,
+                              content->current_line - 1, cached_line_t);
+
+      /* Defer the seek until we actually need to read. */
+      content->seek_pending = TRUE;
+      content->pending_offset = cached->next_offset;
+    }
+  else
     {
+      cached_line_t new_line;
+      svn_stringbuf_t *line_raw;
       apr_off_t offset;
+      apr_pool_t *cache_pool = content->line_cache->pool;
+
+      if (content->seek_pending)
+        {
+          SVN_ERR(content->seek(content->read_baton, content->pending_offset,
+                                scratch_pool));
+          content->seek_pending = FALSE;
+        }
 
       SVN_ERR(content->tell(content->read_baton, &offset,
                             scratch_pool));
+      SVN_ERR(content->readline(content->read_baton, &line_raw,
+                                &new_line.eol_str, &new_line.eof,
+                                scratch_pool, scratch_pool));
+      SVN_ERR(content->tell(content->read_baton, &new_line.next_offset,
+                            scratch_pool));
+
+      if (line_raw)
+        {
+          /* Contract keywords. */
+          SVN_ERR(svn_subst_translate_cstring2(line_raw->data,
+                                               &new_line.line,
+                                               NULL, FALSE,
+                                               content->keywords, FALSE,
+                                               cache_pool));
+        }
+      else
+        new_line.line = "";
+
+      new_line.advanced = ((line_raw && line_raw->len > 0)
+                           || new_line.eol_str);
+
       APR_ARRAY_PUSH(content->lines, apr_off_t) = offset;
+      APR_ARRAY_PUSH(content->line_cache, cached_line_t) = new_line;
+      cached = &APR_ARRAY_IDX(content->line_cache,
+                              content->line_cache->nelts - 1, cached_line_t);
     }
 
-  SVN_ERR(content->readline(content->read_baton, &line_raw,
-                            &eol_str, &content->eof,
-                            result_pool, scratch_pool));
+  content->eof = cached->eof;
   if (content->eol_style == svn_subst_eol_style_none)
-    content->eol_str = eol_str;
+    content->eol_str = cached->eol_str;
 
-  if (line_raw)
-    {
-      /* Contract keywords. */
-      SVN_ERR(svn_subst_translate_cstring2(line_raw->data, line,
-                                           NULL, FALSE,
-                                           content->keywords, FALSE,
-                                           result_pool));
-    }
-  else
-    *line = "";
+  *line = cached->line;
 
-  if ((line_raw && line_raw->len > 0) || eol_str)
+  if (cached->advanced)
     content->current_line++;
 
   SVN_ERR_ASSERT(content->current_line > 0);
@@ -1520,9 +1597,11 @@ seek_to_line(target_content_t *content, svn_linenum_t line,
     {
       apr_off_t offset;
 
+      /* The line is in CONTENT->LINE_CACHE, so there is no need to
+       * reposition the unpatched content until we read past it. */
       offset = APR_ARRAY_IDX(content->lines, line - 1, apr_off_t);
-      SVN_ERR(content->seek(content->read_baton, offset,
-                            scratch_pool));
+      content->seek_pending = TRUE;
+      content->pending_offset = offset;
       content->current_line = line;
     }
   else
@@ -1533,7 +1612,7 @@ seek_to_line(target_content_t *content, svn_linenum_t line,
       while (! content->eof && content->current_line < line)
         {
           svn_pool_clear(iterpool);
-          SVN_ERR(readline(content, &dummy, iterpool, iterpool));
+          SVN_ERR(readline(content, &dummy, iterpool));
         }
       svn_pool_destroy(iterpool);
     }
@@ -1545,6 +1624,93 @@ seek_to_line(target_content_t *content, svn_linenum_t line,
   return SVN_NO_ERROR;
 }
 
+/* Set *LINES to an array of const char * holding the lines of the
+ * original text of HUNK, or of its modified text if MATCH_MODIFIED is
+ * TRUE, with the keywords of CONTENT contracted.  The hunk text gets read
+ * from the patch file only once per CONTENT, no matter at how many
+ * positions it is being matched.  *LINES lives as long as CONTENT.
+ * Do temporary allocations in SCRATCH_POOL. */
+static svn_error_t *
+get_hunk_lines(apr_array_header_t **lines,
+               target_content_t *content,
+               svn_diff_hunk_t *hunk,
+               svn_boolean_t match_modified,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *result_pool = apr_hash_pool_get(content->hunk_lines);
+  hunk_lines_t *hunk_lines;
+  apr_array_header_t **cached;
+  apr_array_header_t *result;
+  apr_pool_t *iterpool;
+
+  hunk_lines = apr_hash_get(content->hunk_lines, &hunk, sizeof(hunk));
+  if (hunk_lines == NULL)
+    {
+      hunk_lines = apr_pcalloc(result_pool, sizeof(*hunk_lines));
+      apr_hash_set(content->hunk_lines,
+                   apr_pmemdup(result_pool, &hunk, sizeof(hunk)),
+                   sizeof(hunk), hunk_lines);
+    }
+
+  cached = match_modified ? &hunk_lines->modified : &hunk_lines->original;
+  if (*cached)
+    {
+      *lines = *cached;
+      return SVN_NO_ERROR;
+    }
+
+  if (match_modified)
+    {
+      svn_diff_hunk_reset_modified_text(hunk);
+      result = apr_array_make(result_pool,
+                              (int)svn_diff_hunk_get_modified_length(hunk),
+                              sizeof(const char *));
+    }
+  else
+    {
+      svn_diff_hunk_reset_original_text(hunk);
+      result = apr_array_make(result_pool,
+                              (int)svn_diff_hunk_get_original_length(hunk),
+                              sizeof(const char *));
+    }
+
+  iterpool = svn_pool_create(scratch_pool);
+  while (TRUE)
+    {
+      svn_stringbuf_t *hunk_line;
+      svn_boolean_t hunk_eof;
+      const char *hunk_line_translated;
+
+      svn_pool_clear(iterpool);
+
+      if (match_modified)
+        SVN_ERR(svn_diff_hunk_readline_modified_text(hunk, &hunk_line,
+                                                     NULL, &hunk_eof,
+                                                     iterpool, iterpool));
+      else
+        SVN_ERR(svn_diff_hunk_readline_original_text(hunk, &hunk_line,
+                                                     NULL, &hunk_eof,
+                                                     iterpool, iterpool));
+
+      if (hunk_eof && hunk_line->len == 0)
+        break;
+
+      /* Contract keywords, if any, before matching. */
+      SVN_ERR(svn_subst_translate_cstring2(hunk_line->data,
+                                           &hunk_line_translated,
+                                           NULL, FALSE,
+                                           content->keywords, FALSE,
+                                           result_pool));
+      APR_ARRAY_PUSH(result, const char *) = hunk_line_translated;
+    }
+  svn_pool_destroy(iterpool);
+
+  *cached = result;
+  *lines = result;
+
+  return SVN_NO_ERROR;
+}
+
 /* Indicate in *MATCHED whether the original text of HUNK matches the patch
  * CONTENT at its current line. Lines within FUZZ lines of the start or
  * end of HUNK will always match. If IGNORE_WHITESPACE is set, we ignore
@@ -1559,7 +1725,7 @@ match_hunk(svn_boolean_t *matched, target_content_t *content,
            svn_boolean_t ignore_whitespace,
            svn_boolean_t match_modified, apr_pool_t *pool)
 {
-  svn_stringbuf_t *hunk_line;
+  apr_array_header_t *hunk_lines;
   const char *target_line;
   svn_linenum_t lines_read;
   svn_linenum_t saved_line;
@@ -1589,45 +1755,29 @@ match_hunk(svn_boolean_t *matched, target_content_t *content,
   leading_context = svn_diff_hunk_get_leading_context(hunk);
   trailing_context = svn_diff_hunk_get_trailing_context(hunk);
   if (match_modified)
-    {
-      svn_diff_hunk_reset_modified_text(hunk);
-      hunk_length = svn_diff_hunk_get_modified_length(hunk);
-    }
+    hunk_length = svn_diff_hunk_get_modified_length(hunk);
   else
-    {
-      svn_diff_hunk_reset_original_text(hunk);
-      hunk_length = svn_diff_hunk_get_original_length(hunk);
-    }
+    hunk_length = svn_diff_hunk_get_original_length(hunk);
+  SVN_ERR(get_hunk_lines(&hunk_lines, content, hunk, match_modified, pool));
+
   iterpool = svn_pool_create(pool);
   do
     {
-      const char *hunk_line_translated;
+      const char *hunk_line;
 
       svn_pool_clear(iterpool);
 
-      if (match_modified)
-        SVN_ERR(svn_diff_hunk_readline_modified_text(hunk, &hunk_line,
-                                                     NULL, &hunk_eof,
-                                                     iterpool, iterpool));
-      else
-        SVN_ERR(svn_diff_hunk_readline_original_text(hunk, &hunk_line,
-                                                     NULL, &hunk_eof,
-                                                     iterpool, iterpool));
-
-      /* Contract keywords, if any, before matching. */
-      SVN_ERR(svn_subst_translate_cstring2(hunk_line->data,
-                                           &hunk_line_translated,
-                                           NULL, FALSE,
-                                           content->keywords, FALSE,
-                                           iterpool));
-      SVN_ERR(readline(content, &target_line, iterpool, iterpool));
+      hunk_eof = (lines_read >= (svn_linenum_t)hunk_lines->nelts);
+      hunk_line = hunk_eof ? ""
+                           : APR_ARRAY_IDX(hunk_lines, lines_read,
+                                           const char *);
+      SVN_ERR(readline(content, &target_line, iterpool));
 
       lines_read++;
 
       /* If the last line doesn't have a newline, we get EOF but still
        * have a non-empty line to compare. */
-      if ((hunk_eof && hunk_line->len == 0) ||
-          (content->eof && *target_line == 0))
+      if (hunk_eof || (content->eof && *target_line == 0))
         break;
 
       /* Leading/trailing fuzzy lines always match. */
@@ -1641,19 +1791,19 @@ match_hunk(svn_boolean_t *matched, target_content_t *content,
               char *hunk_line_trimmed;
               char *target_line_trimmed;
 
-              hunk_line_trimmed = apr_pstrdup(iterpool, hunk_line_translated);
+              hunk_line_trimmed = apr_pstrdup(iterpool, hunk_line);
               target_line_trimmed = apr_pstrdup(iterpool, target_line);
               apr_collapse_spaces(hunk_line_trimmed, hunk_line_trimmed);
               apr_collapse_spaces(target_line_trimmed, target_line_trimmed);
               lines_matched = ! strcmp(hunk_line_trimmed, target_line_trimmed);
             }
           else
-            lines_matched = ! strcmp(hunk_line_translated, target_line);
+            lines_matched = ! strcmp(hunk_line, target_line);
         }
     }
   while (lines_matched);
 
-  *matched = lines_matched && hunk_eof && hunk_line->len == 0;
+  *matched = lines_matched && hunk_eof;
   SVN_ERR(seek_to_line(content, saved_line, iterpool));
   svn_pool_destroy(iterpool);
 
@@ -1770,7 +1920,7 @@ match_existing_target(svn_boolean_t *match,
 
       svn_pool_clear(iterpool);
 
-      SVN_ERR(readline(content, &line, iterpool, iterpool));
+      SVN_ERR(readline(content, &line, iterpool));
       SVN_ERR(svn_diff_hunk_readline_modified_text(hunk, &hunk_line,
                                                    NULL, &hunk_eof,
                                                    iterpool, iterpool));
@@ -2114,7 +2264,7 @@ copy_lines_to_target(target_content_t *content, svn_linenum_t line,
 
       svn_pool_clear(iterpool);
 
-      SVN_ERR(readline(content, &target_line, iterpool, iterpool));
+      SVN_ERR(readline(content, &target_line, iterpool));
       if (! content->eof)
         target_line = apr_pstrcat(iterpool, target_line, content->eol_str,
                                   SVN_VA_NULL);
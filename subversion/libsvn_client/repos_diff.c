@@ -37,6 +37,7 @@
 #include <assert.h>
 
 #include "svn_checksum.h"
+#include "svn_config.h"
 #include "svn_hash.h"
 #include "svn_wc.h"
 #include "svn_pools.h"
@@ -44,6 +45,7 @@
 #include "svn_path.h"
 #include "svn_io.h"
 #include "svn_props.h"
+#include "svn_sorts.h"
 #include "svn_private_config.h"
 
 #include "client.h"
@@ -51,6 +53,7 @@
 #include "private/svn_subr_private.h"
 #include "private/svn_wc_private.h"
 #include "private/svn_editor.h"
+#include "private/svn_thread.h"
 
 /* Overall crawler editor baton.  */
 struct edit_baton {
@@ -88,6 +91,26 @@ struct edit_baton {
   /* A baton to pass to the cancellation callback. */
   void *cancel_baton;
 
+  /* Number of connections through which file contents get fetched.  If
+     this is larger than 1, close_file() queues files in PENDING and
+     flush_pending_files() fetches them in batches. */
+  int parallelism;
+
+  /* Client context used to open the additional RA sessions. */
+  svn_client_ctx_t *fetch_ctx;
+
+  /* struct file_baton * of the closed files that have not been reported
+     to PROCESSOR yet, in the order they were closed. */
+  apr_array_header_t *pending;
+
+  /* svn_ra_session_t * used by the additional fetching threads, one
+     each.  They are opened as needed. */
+  apr_array_header_t *fetch_sessions;
+
+  /* Thread-safe root pool for everything the fetching threads use,
+     i.e. FETCH_SESSIONS and the files' FETCH_POOLs. */
+  apr_pool_t *fetch_pool;
+
   apr_pool_t *pool;
 };
 
@@ -208,6 +231,17 @@ struct file_baton {
   svn_diff_source_t *left_source;
   svn_diff_source_t *right_source;
 
+  /* If the text delta has been written to a temporary file, to be
+     applied by a fetching thread, the path of that svndiff file and the
+     expected checksums of the start and the resulting revision. */
+  const char *delta_spool;
+  svn_checksum_t *base_md5_checksum;
+  svn_checksum_t *expected_md5_checksum;
+
+  /* Pool and result of the fetching thread while the file is queued. */
+  apr_pool_t *fetch_pool;
+  svn_error_t *fetch_err;
+
   /* The pool passed in by add_file or open_file.
      Also, the pool this file_baton is allocated in. */
   apr_pool_t *pool;
@@ -438,6 +472,276 @@ get_empty_file(struct edit_baton *eb,
   return SVN_NO_ERROR;
 }
 
+/* Report the changes to the file described by FB to the diff processor,
+ * if there are any.  The texts of both revisions, as far as needed, must
+ * be available already.  Use FB->pool for temporary allocations.
+ */
+static svn_error_t *
+report_file(struct file_baton *fb)
+{
+  struct edit_baton *eb = fb->edit_baton;
+  apr_hash_t *right_props;
+
+  if (!fb->added && !fb->path_end_revision && !fb->has_propchange)
+    return SVN_NO_ERROR;
+
+  if (!fb->added && !fb->pristine_props)
+    {
+      /* We didn't receive a text change, so we have no pristine props.
+         Retrieve just the props now. */
+      SVN_ERR(get_file_from_ra(fb, TRUE, fb->pool));
+    }
+
+  if (fb->pristine_props)
+    remove_non_prop_changes(fb->pristine_props, fb->propchanges);
+
+  right_props = svn_prop__patch(fb->pristine_props, fb->propchanges,
+                                fb->pool);
+
+  if (fb->added)
+    SVN_ERR(eb->processor->file_added(fb->path,
+                                      NULL /* copyfrom_src */,
+                                      fb->right_source,
+                                      NULL /* copyfrom_file */,
+                                      fb->path_end_revision,
+                                      NULL /* copyfrom_props */,
+                                      right_props,
+                                      fb->pfb,
+                                      eb->processor,
+                                      fb->pool));
+  else
+    SVN_ERR(eb->processor->file_changed(fb->path,
+                                        fb->left_source,
+                                        fb->right_source,
+                                        fb->path_end_revision
+                                                ? fb->path_start_revision
+                                                : NULL,
+                                        fb->path_end_revision,
+                                        fb->pristine_props,
+                                        right_props,
+                                        (fb->path_end_revision != NULL),
+                                        fb->propchanges,
+                                        fb->pfb,
+                                        eb->processor,
+                                        fb->pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Upper limit for SVN_CONFIG_OPTION_PARALLEL_DIFF_FETCHES. */
+#define MAX_PARALLEL_DIFF_FETCHES 16
+
+/* Number of files queued per fetching connection before they get fetched.
+   Queued files keep their text deltas on disk, so this limits the number
+   of temporary files rather than memory. */
+#define PENDING_FILES_PER_FETCH 4
+
+/* Fetch what the queued file FB needs to be reported through RA_SESSION:
+ * its pristine properties, unless it was added, and the texts of both
+ * revisions if a text delta has been spooled for it.  Check the text
+ * checksums.  Allocate the results in FB->fetch_pool, which must only be
+ * used by the calling thread.
+ */
+static svn_error_t *
+fetch_pending_file(struct file_baton *fb,
+                   svn_ra_session_t *ra_session,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton)
+{
+  apr_pool_t *pool = fb->fetch_pool;
+
+  if (!fb->added)
+    {
+      svn_stream_t *fstream = NULL;
+
+      if (fb->delta_spool)
+        {
+          SVN_ERR(svn_stream_open_unique(&fstream, &fb->path_start_revision,
+                                         NULL,
+                                         svn_io_file_del_on_pool_cleanup,
+                                         pool, pool));
+          fstream = svn_stream_checksummed2(fstream, NULL,
+                                            &fb->start_md5_checksum,
+                                            svn_checksum_md5, TRUE, pool);
+        }
+
+      SVN_ERR(svn_ra_get_file(ra_session, fb->path, fb->base_revision,
+                              fstream, NULL, &fb->pristine_props, pool));
+      if (fstream)
+        SVN_ERR(svn_stream_close(fstream));
+    }
+
+  if (fb->delta_spool)
+    {
+      svn_stream_t *source;
+      svn_stream_t *result;
+      svn_stream_t *spool;
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+
+      if (!svn_checksum_match(fb->base_md5_checksum,
+                              fb->start_md5_checksum))
+        return svn_error_trace(svn_checksum_mismatch_err(
+                                      fb->base_md5_checksum,
+                                      fb->start_md5_checksum,
+                                      pool,
+                                      _("Base checksum mismatch for '%s'"),
+                                      fb->path));
+
+      if (fb->added)
+        source = svn_stream_empty(pool);
+      else
+        SVN_ERR(svn_stream_open_readonly(&source, fb->path_start_revision,
+                                         pool, pool));
+
+      SVN_ERR(svn_stream_open_unique(&result, &fb->path_end_revision, NULL,
+                                     svn_io_file_del_on_pool_cleanup,
+                                     pool, pool));
+
+      svn_txdelta_apply(source, result, fb->result_digest, fb->path, pool,
+                        &handler, &handler_baton);
+
+      SVN_ERR(svn_stream_open_readonly(&spool, fb->delta_spool, pool, pool));
+      SVN_ERR(svn_stream_copy3(spool,
+                               svn_txdelta_parse_svndiff(handler,
+                                                         handler_baton,
+                                                         TRUE, pool),
+                               cancel_func, cancel_baton, pool));
+
+      fb->result_md5_checksum = svn_checksum__from_digest_md5(
+                                        fb->result_digest, pool);
+
+      if (!svn_checksum_match(fb->expected_md5_checksum,
+                              fb->result_md5_checksum))
+        return svn_error_trace(svn_checksum_mismatch_err(
+                                      fb->expected_md5_checksum,
+                                      fb->result_md5_checksum,
+                                      pool,
+                                      _("Checksum mismatch for '%s'"),
+                                      fb->path));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_thread__job_func_t, fetching the struct file_baton in
+   DATA for the struct edit_baton in BATON.  The calling thread uses the
+   editor's session, all other threads use one of the fetch sessions. */
+static void
+fetch_job_func(void *data,
+               int thread_index,
+               void *baton)
+{
+  struct file_baton *fb = data;
+  struct edit_baton *eb = baton;
+  svn_ra_session_t *ra_session
+    = thread_index == 0
+    ? eb->ra_session
+    : APR_ARRAY_IDX(eb->fetch_sessions, thread_index - 1,
+                    svn_ra_session_t *);
+
+  fb->fetch_err = fetch_pending_file(fb, ra_session,
+                                     eb->cancel_func, eb->cancel_baton);
+}
+
+/* Make sure that EB has up to COUNT additional sessions for fetching
+ * threads.  If they can't be opened, make do with fewer.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static void
+open_fetch_sessions(struct edit_baton *eb,
+                    int count,
+                    apr_pool_t *scratch_pool)
+{
+  const char *session_url;
+  svn_error_t *err;
+
+  if (eb->fetch_sessions->nelts >= count)
+    return;
+
+  err = svn_ra_get_session_url(eb->ra_session, &session_url, scratch_pool);
+  while (!err && eb->fetch_sessions->nelts < count)
+    {
+      apr_pool_t *session_pool = svn_pool_create(eb->fetch_pool);
+      svn_client_ctx_t *thread_ctx;
+      svn_ra_session_t *ra_session;
+
+      err = svn_client__create_thread_ctx(&thread_ctx, eb->fetch_ctx,
+                                          session_pool);
+      if (!err)
+        err = svn_client__open_ra_session_internal(&ra_session, NULL,
+                                                   session_url, NULL, NULL,
+                                                   FALSE, TRUE, thread_ctx,
+                                                   session_pool,
+                                                   session_pool);
+      if (err)
+        svn_pool_destroy(session_pool);
+      else
+        APR_ARRAY_PUSH(eb->fetch_sessions, svn_ra_session_t *) = ra_session;
+    }
+
+  /* Don't try again with every batch. */
+  if (err)
+    {
+      svn_error_clear(err);
+      eb->parallelism = eb->fetch_sessions->nelts + 1;
+    }
+}
+
+/* Fetch all files queued in EB, several at a time, and report them to the
+ * diff processor in the order they were closed.  Return the first error
+ * in that order.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+flush_pending_files(struct edit_baton *eb,
+                    apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  if (!eb->pending || eb->pending->nelts == 0)
+    return SVN_NO_ERROR;
+
+  open_fetch_sessions(eb, MIN(eb->parallelism, eb->pending->nelts) - 1,
+                      scratch_pool);
+  svn_thread__run_batch(eb->pending, fetch_job_func, eb,
+                        eb->fetch_sessions->nelts + 1);
+
+  for (i = 0; i < eb->pending->nelts; ++i)
+    {
+      struct file_baton *fb = APR_ARRAY_IDX(eb->pending, i,
+                                            struct file_baton *);
+      struct dir_baton *pb = fb->parent_baton;
+
+      if (err)
+        svn_error_clear(fb->fetch_err);
+      else
+        err = fb->fetch_err;
+
+      if (!err)
+        err = report_file(fb);
+
+      svn_pool_destroy(fb->fetch_pool);
+      svn_pool_destroy(fb->pool);
+
+      if (!err)
+        err = release_dir(pb);
+    }
+
+  apr_array_clear(eb->pending);
+
+  return svn_error_trace(err);
+}
+
+/* Pool cleanup handler destroying the pool given as BATON. */
+static apr_status_t
+destroy_fetch_pool(void *baton)
+{
+  svn_pool_destroy(baton);
+
+  return APR_SUCCESS;
+}
+
 /* An svn_delta_editor_t function.  */
 static svn_error_t *
 set_target_revision(void *edit_baton,
@@ -631,6 +935,8 @@ delete_entry(const char *path,
   svn_node_kind_t kind;
   apr_pool_t *scratch_pool;
 
+  SVN_ERR(flush_pending_files(eb, pool));
+
   /* Process skips. */
   if (pb->skip_children)
     return SVN_NO_ERROR;
@@ -677,6 +983,8 @@ add_directory(const char *path,
 
   /* ### TODO: support copyfrom? */
 
+  SVN_ERR(flush_pending_files(eb, pool));
+
   db = make_dir_baton(path, pb, eb, TRUE, SVN_INVALID_REVNUM, pb->pool);
   *child_baton = db;
 
@@ -718,6 +1026,8 @@ open_directory(const char *path,
   struct edit_baton *eb = pb->edit_baton;
   struct dir_baton *db;
 
+  SVN_ERR(flush_pending_files(eb, pool));
+
   db = make_dir_baton(path, pb, eb, FALSE, base_revision, pb->pool);
 
   *child_baton = db;
@@ -912,6 +1222,25 @@ apply_textdelta(void *file_baton,
       return SVN_NO_ERROR;
     }
 
+  /* When fetching in parallel, only store the delta for now. */
+  if (fb->edit_baton->pending)
+    {
+      svn_stream_t *spool;
+
+      if (base_md5_digest != NULL)
+        SVN_ERR(svn_checksum_parse_hex(&fb->base_md5_checksum,
+                                       svn_checksum_md5, base_md5_digest,
+                                       fb->pool));
+
+      SVN_ERR(svn_stream_open_unique(&spool, &fb->delta_spool, NULL,
+                                     svn_io_file_del_on_pool_cleanup,
+                                     fb->pool, scratch_pool));
+      svn_txdelta_to_svndiff3(handler, handler_baton, spool, 0,
+                              SVN_DELTA_COMPRESSION_LEVEL_NONE, fb->pool);
+
+      return SVN_NO_ERROR;
+    }
+
   /* We need the expected pristine file, so go get it */
   if (!fb->added)
     SVN_ERR(get_file_from_ra(fb, FALSE, scratch_pool));
@@ -966,6 +1295,8 @@ apply_textdelta(void *file_baton,
  * ### would probably involve calculating the checksum as the data is
  * ### received, storing the final checksum in the file_baton, and
  * ### comparing against it here.
+ *
+ * When fetching in parallel, the file only gets queued here.
  */
 static svn_error_t *
 close_file(void *file_baton,
@@ -994,7 +1325,11 @@ close_file(void *file_baton,
       SVN_ERR(svn_checksum_parse_hex(&expected_md5_checksum, svn_checksum_md5,
                                      expected_md5_digest, scratch_pool));
 
-      if (!svn_checksum_match(expected_md5_checksum, fb->result_md5_checksum))
+      /* A spooled delta gets verified once it has been applied. */
+      if (fb->delta_spool)
+        fb->expected_md5_checksum = expected_md5_checksum;
+      else if (!svn_checksum_match(expected_md5_checksum,
+                                   fb->result_md5_checksum))
         return svn_error_trace(svn_checksum_mismatch_err(
                                       expected_md5_checksum,
                                       fb->result_md5_checksum,
@@ -1003,51 +1338,19 @@ close_file(void *file_baton,
                                       fb->path));
     }
 
-  if (fb->added || fb->path_end_revision || fb->has_propchange)
+  if (eb->pending && (fb->added || fb->delta_spool || fb->has_propchange))
     {
-      apr_hash_t *right_props;
-
-      if (!fb->added && !fb->pristine_props)
-        {
-          /* We didn't receive a text change, so we have no pristine props.
-             Retrieve just the props now. */
-          SVN_ERR(get_file_from_ra(fb, TRUE, scratch_pool));
-        }
+      fb->fetch_pool = svn_pool_create(eb->fetch_pool);
+      APR_ARRAY_PUSH(eb->pending, struct file_baton *) = fb;
 
-      if (fb->pristine_props)
-        remove_non_prop_changes(fb->pristine_props, fb->propchanges);
+      if (eb->pending->nelts >= eb->parallelism * PENDING_FILES_PER_FETCH)
+        SVN_ERR(flush_pending_files(eb, pool));
 
-      right_props = svn_prop__patch(fb->pristine_props, fb->propchanges,
-                                    fb->pool);
-
-      if (fb->added)
-        SVN_ERR(eb->processor->file_added(fb->path,
-                                          NULL /* copyfrom_src */,
-                                          fb->right_source,
-                                          NULL /* copyfrom_file */,
-                                          fb->path_end_revision,
-                                          NULL /* copyfrom_props */,
-                                          right_props,
-                                          fb->pfb,
-                                          eb->processor,
-                                          fb->pool));
-      else
-        SVN_ERR(eb->processor->file_changed(fb->path,
-                                            fb->left_source,
-                                            fb->right_source,
-                                            fb->path_end_revision
-                                                    ? fb->path_start_revision
-                                                    : NULL,
-                                            fb->path_end_revision,
-                                            fb->pristine_props,
-                                            right_props,
-                                            (fb->path_end_revision != NULL),
-                                            fb->propchanges,
-                                            fb->pfb,
-                                            eb->processor,
-                                            fb->pool));
+      return SVN_NO_ERROR;
     }
 
+  SVN_ERR(report_file(fb));
+
   svn_pool_destroy(fb->pool); /* Destroy file and scratch pool */
 
   SVN_ERR(release_dir(pb));
@@ -1072,6 +1375,8 @@ close_directory(void *dir_baton,
   apr_hash_t *pristine_props;
   svn_boolean_t send_changed = FALSE;
 
+  SVN_ERR(flush_pending_files(eb, pool));
+
   scratch_pool = db->pool;
 
   if ((db->has_propchange || db->added) && !db->skip)
@@ -1209,6 +1514,8 @@ close_edit(void *edit_baton,
 {
   struct edit_baton *eb = edit_baton;
 
+  SVN_ERR(flush_pending_files(eb, pool));
+
   svn_pool_destroy(eb->pool);
 
   return SVN_NO_ERROR;
@@ -1224,6 +1531,7 @@ absent_directory(const char *path,
   struct dir_baton *pb = parent_baton;
   struct edit_baton *eb = pb->edit_baton;
 
+  SVN_ERR(flush_pending_files(eb, pool));
   SVN_ERR(eb->processor->node_absent(path, pb->pdb, eb->processor, pool));
 
   return SVN_NO_ERROR;
@@ -1240,6 +1548,7 @@ absent_file(const char *path,
   struct dir_baton *pb = parent_baton;
   struct edit_baton *eb = pb->edit_baton;
 
+  SVN_ERR(flush_pending_files(eb, pool));
   SVN_ERR(eb->processor->node_absent(path, pb->pdb, eb->processor, pool));
 
   return SVN_NO_ERROR;
@@ -1351,6 +1660,7 @@ svn_client__get_diff_editor2(const svn_delta_editor_t **editor,
                              svn_revnum_t revision,
                              svn_boolean_t text_deltas,
                              const svn_diff_tree_processor_t *processor,
+                             svn_client_ctx_t *fetch_ctx,
                              svn_cancel_func_t cancel_func,
                              void *cancel_baton,
                              apr_pool_t *result_pool)
@@ -1376,6 +1686,41 @@ svn_client__get_diff_editor2(const svn_delta_editor_t **editor,
   eb->cancel_func = cancel_func;
   eb->cancel_baton = cancel_baton;
 
+#if APR_HAS_THREADS
+  if (fetch_ctx && text_deltas)
+    {
+      apr_int64_t parallelism;
+      svn_config_t *cfg = fetch_ctx->config
+                          ? svn_hash_gets(fetch_ctx->config,
+                                          SVN_CONFIG_CATEGORY_CONFIG)
+                          : NULL;
+
+      SVN_ERR(svn_config_get_int64(cfg, &parallelism,
+                                   SVN_CONFIG_SECTION_MISCELLANY,
+                                   SVN_CONFIG_OPTION_PARALLEL_DIFF_FETCHES,
+                                   1));
+
+      /* Files can be fetched independently of each other, as long as
+         they get reported in order. */
+      if (parallelism > 1)
+        {
+          eb->parallelism = (int)MIN(parallelism, MAX_PARALLEL_DIFF_FETCHES);
+          eb->fetch_ctx = fetch_ctx;
+          eb->pending = apr_array_make(eb->pool,
+                                       eb->parallelism
+                                         * PENDING_FILES_PER_FETCH,
+                                       sizeof(struct file_baton *));
+          eb->fetch_sessions = apr_array_make(eb->pool, eb->parallelism,
+                                              sizeof(svn_ra_session_t *));
+          eb->fetch_pool
+            = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+          apr_pool_cleanup_register(eb->pool, eb->fetch_pool,
+                                    destroy_fetch_pool,
+                                    apr_pool_cleanup_null);
+        }
+    }
+#endif
+
   tree_editor->set_target_revision = set_target_revision;
   tree_editor->open_root = open_root;
   tree_editor->delete_entry = delete_entry;
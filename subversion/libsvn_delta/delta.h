@@ -40,7 +40,8 @@ extern "C" {
 
 /* Private interface for text deltas. */
 
-/* The standard size of one svndiff window. */
+/* The standard size of one svndiff window.  This is also the limit that
+   readers of all svndiff versions enforce; see notes/svndiff. */
 
 #define SVN_DELTA_WINDOW_SIZE 102400
 
@@ -38,13 +38,16 @@
 
 static const char SVNDIFF_V0[] = { 'S', 'V', 'N', 0 };
 static const char SVNDIFF_V1[] = { 'S', 'V', 'N', 1 };
+static const char SVNDIFF_V2[] = { 'S', 'V', 'N', 2 };
 
 #define SVNDIFF_HEADER_SIZE (sizeof(SVNDIFF_V0))
 
 static const char *
 get_svndiff_header(int version)
 {
-  if (version == 1)
+  if (version == 2)
+    return SVNDIFF_V2;
+  else if (version == 1)
     return SVNDIFF_V1;
   else
     return SVNDIFF_V0;
@@ -147,6 +150,32 @@ send_simple_insertion_window(svn_txdelta_window_t *window,
   return SVN_NO_ERROR;
 }
 
+/* Set *OUT to the contents of the DATA buffer with length LEN, compressed
+   as required by svndiff VERSION, i.e. using zlib for svndiff1 and LZ4 for
+   svndiff2.  COMPRESSION_LEVEL is the zlib compression level to use; for
+   svndiff2, only SVN_DELTA_COMPRESSION_LEVEL_NONE is significant and
+   disables compression.  Allocate the result in POOL. */
+static svn_error_t *
+compress_section(svn_stringbuf_t **out,
+                 const char *data,
+                 apr_size_t len,
+                 int version,
+                 int compression_level,
+                 apr_pool_t *pool)
+{
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+
+  if (version == 2 && compression_level != SVN_DELTA_COMPRESSION_LEVEL_NONE)
+    SVN_ERR(svn__compress_lz4(data, len, compressed));
+  else if (version == 2)
+    SVN_ERR(svn__compress(data, len, compressed, SVN__COMPRESSION_NONE));
+  else
+    SVN_ERR(svn__compress(data, len, compressed, compression_level));
+
+  *out = compressed;
+  return SVN_NO_ERROR;
+}
+
 /* Encodes delta window WINDOW to svndiff-format.
    The svndiff version is VERSION. COMPRESSION_LEVEL is the zlib
    compression level to use.
@@ -195,21 +224,18 @@ encode_window(svn_stringbuf_t **instructions_p,
   append_encoded_int(header, window->sview_offset);
   append_encoded_int(header, window->sview_len);
   append_encoded_int(header, window->tview_len);
-  if (version == 1)
-    {
-      svn_stringbuf_t *compressed_instructions;
-      compressed_instructions = svn_stringbuf_create_empty(pool);
-      SVN_ERR(svn__compress(instructions->data, instructions->len,
-                            compressed_instructions, compression_level));
-      instructions = compressed_instructions;
-    }
+  if (version > 0)
+    SVN_ERR(compress_section(&instructions, instructions->data,
+                             instructions->len, version, compression_level,
+                             pool));
   append_encoded_int(header, instructions->len);
-  if (version == 1)
+  if (version > 0)
     {
-      svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+      svn_stringbuf_t *compressed;
 
-      SVN_ERR(svn__compress(window->new_data->data, window->new_data->len,
-                            compressed, compression_level));
+      SVN_ERR(compress_section(&compressed, window->new_data->data,
+                               window->new_data->len, version,
+                               compression_level, pool));
       newdata = svn_stringbuf__morph_into_string(compressed);
     }
   else
@@ -294,6 +320,11 @@ svn_txdelta_to_svndiff3(svn_txdelta_window_handler_t *handler,
   eb->header_done = FALSE;
   eb->scratch_pool = svn_pool_create(pool);
   eb->version = svndiff_version;
+
+  /* Every svndiff2 consumer understands svndiff1, so that is a safe
+     fallback if we can't produce LZ4-compressed data. */
+  if (eb->version == 2 && !svn__lz4_supported())
+    eb->version = 1;
   eb->compression_level = compression_level;
 
   *handler = window_handler;
@@ -519,16 +550,64 @@ count_and_verify_instructions(int *ninst,
   return SVN_NO_ERROR;
 }
 
+/* Set *OUT_DATA and *OUT_LEN to the contents of the LEN bytes long
+   svndiff1 or svndiff2 section at DATA, compressed as described by svndiff
+   VERSION.  The contents must not exceed LIMIT bytes.  If IN_PLACE is set
+   and the section has been stored uncompressed, *OUT_DATA will point into
+   DATA.  Otherwise, the contents will be allocated in POOL and be
+   NUL-terminated. */
+static svn_error_t *
+decode_section(const unsigned char **out_data,
+               apr_size_t *out_len,
+               const unsigned char *data,
+               apr_size_t len,
+               apr_size_t limit,
+               svn_boolean_t in_place,
+               unsigned int version,
+               apr_pool_t *pool)
+{
+  svn_stringbuf_t *out;
+
+  /* Uncompressed sections consist of the original length followed by
+     the original data. */
+  if (in_place)
+    {
+      apr_uint64_t orig_len;
+      const unsigned char *p = svn__decode_uint(&orig_len, data, data + len);
+
+      if (p && orig_len <= limit && orig_len == (apr_uint64_t)(data + len - p))
+        {
+          *out_data = p;
+          *out_len = (apr_size_t)orig_len;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  out = svn_stringbuf_create_empty(pool);
+  if (version == 2)
+    SVN_ERR(svn__decompress_lz4(data, len, out, limit));
+  else
+    SVN_ERR(svn__decompress(data, len, out, limit));
+
+  *out_data = (const unsigned char *)out->data;
+  *out_len = out->len;
+
+  return SVN_NO_ERROR;
+}
+
 /* Given the five integer fields of a window header and a pointer to
    the remainder of the window contents, fill in a delta window
-   structure *WINDOW.  New allocations will be performed in POOL;
-   the new_data field of *WINDOW will refer directly to memory pointed
-   to by DATA. */
+   structure *WINDOW.  New allocations will be performed in POOL.
+
+   If IN_PLACE is set, uncompressed new data will not be copied but the
+   new_data field of *WINDOW will refer directly to memory pointed to by
+   DATA.  In that case, DATA must remain valid for as long as *WINDOW is
+   in use and DATA[INSLEN + NEWLEN] must be NUL. */
 static svn_error_t *
 decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
               apr_size_t sview_len, apr_size_t tview_len, apr_size_t inslen,
               apr_size_t newlen, const unsigned char *data, apr_pool_t *pool,
-              unsigned int version)
+              unsigned int version, svn_boolean_t in_place)
 {
   const unsigned char *insend;
   int ninst;
@@ -542,21 +621,31 @@ decode_window(svn_txdelta_window_t *window, svn_filesize_t sview_offset,
 
   insend = data + inslen;
 
-  if (version == 1)
+  if (version == 1 || version == 2)
     {
-      svn_stringbuf_t *instout = svn_stringbuf_create_empty(pool);
-      svn_stringbuf_t *ndout = svn_stringbuf_create_empty(pool);
-
-      SVN_ERR(svn__decompress(insend, newlen, ndout,
-                              SVN_DELTA_WINDOW_SIZE));
-      SVN_ERR(svn__decompress(data, insend - data, instout,
-                              MAX_INSTRUCTION_SECTION_LEN));
-
-      newlen = ndout->len;
-      data = (unsigned char *)instout->data;
-      insend = (unsigned char *)instout->data + instout->len;
-
-      new_data = svn_stringbuf__morph_into_string(ndout);
+      const unsigned char *new_start;
+
+      /* The instructions are only needed until the end of this function,
+         so they never need to be copied. */
+      SVN_ERR(decode_section(&new_start, &newlen, insend, newlen,
+                             SVN_DELTA_WINDOW_SIZE, in_place, version,
+                             pool));
+      SVN_ERR(decode_section(&data, &inslen, data, inslen,
+                             MAX_INSTRUCTION_SECTION_LEN, TRUE, version,
+                             pool));
+      insend = data + inslen;
+
+      new_data = apr_palloc(pool, sizeof(*new_data));
+      new_data->data = (const char *)new_start;
+      new_data->len = newlen;
+    }
+  else if (in_place)
+    {
+      /* The caller guarantees the NUL terminator that svn_string_t
+         requires. */
+      new_data = apr_palloc(pool, sizeof(*new_data));
+      new_data->data = (const char *)insend;
+      new_data->len = newlen;
     }
   else
     {
@@ -612,6 +701,8 @@ write_handler(void *baton,
         db->version = 0;
       else if (memcmp(buffer, SVNDIFF_V1 + db->header_bytes, nheader) == 0)
         db->version = 1;
+      else if (memcmp(buffer, SVNDIFF_V2 + db->header_bytes, nheader) == 0)
+        db->version = 2;
       else
         return svn_error_create(SVN_ERR_SVNDIFF_INVALID_HEADER, NULL,
                                 _("Svndiff has invalid header"));
@@ -671,7 +762,7 @@ write_handler(void *baton,
 
           if (tview_len > SVN_DELTA_WINDOW_SIZE ||
               sview_len > SVN_DELTA_WINDOW_SIZE ||
-              /* for svndiff1, newlen includes the original length */
+              /* for svndiff1 and 2, newlen includes the original length */
               newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
               inslen > MAX_INSTRUCTION_SECTION_LEN)
             return svn_error_create(
@@ -717,7 +808,7 @@ write_handler(void *baton,
       /* Decode the window and send it off. */
       SVN_ERR(decode_window(&window, db->sview_offset, db->sview_len,
                             db->tview_len, db->inslen, db->newlen, p,
-                            db->subpool, db->version));
+                            db->subpool, db->version, FALSE));
       SVN_ERR(db->consumer_func(&window, db->consumer_baton));
 
       p += db->inslen + db->newlen;
@@ -882,7 +973,7 @@ read_window_header(svn_stream_t *stream, svn_filesize_t *sview_offset,
 
   if (*tview_len > SVN_DELTA_WINDOW_SIZE ||
       *sview_len > SVN_DELTA_WINDOW_SIZE ||
-      /* for svndiff1, newlen includes the original length */
+      /* for svndiff1 and 2, newlen includes the original length */
       *newlen > SVN_DELTA_WINDOW_SIZE + SVN__MAX_ENCODED_UINT_LEN ||
       *inslen > MAX_INSTRUCTION_SECTION_LEN)
     return svn_error_create(SVN_ERR_SVNDIFF_CORRUPT_WINDOW, NULL,
@@ -911,14 +1002,19 @@ svn_txdelta_read_svndiff_window(svn_txdelta_window_t **window,
   SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
                              &inslen, &newlen, &header_len));
   len = inslen + newlen;
-  buf = apr_palloc(pool, len);
+
+  /* The buffer belongs to the window, so the window can use it directly
+     for any uncompressed data. */
+  buf = apr_palloc(pool, len + 1);
   SVN_ERR(svn_stream_read_full(stream, (char*)buf, &len));
   if (len < inslen + newlen)
     return svn_error_create(SVN_ERR_SVNDIFF_UNEXPECTED_END, NULL,
                             _("Unexpected end of svndiff input"));
+  buf[len] = '\0';
+
   *window = apr_palloc(pool, sizeof(**window));
   return decode_window(*window, sview_offset, sview_len, tview_len, inslen,
-                       newlen, buf, pool, svndiff_version);
+                       newlen, buf, pool, svndiff_version, TRUE);
 }
 
 
@@ -954,3 +1050,75 @@ svn_txdelta__read_raw_window_len(apr_size_t *window_len,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_txdelta__read_raw_window_data(apr_size_t *window_len,
+                                  apr_size_t *data_offset,
+                                  apr_size_t *data_len,
+                                  svn_stream_t *stream,
+                                  int svndiff_version,
+                                  apr_pool_t *pool)
+{
+  svn_filesize_t sview_offset;
+  apr_size_t sview_len, tview_len, inslen, newlen, header_len;
+  unsigned char buf[2 * SVN__MAX_ENCODED_UINT_LEN + 1];
+  const unsigned char *p, *end;
+  apr_uint64_t orig_len;
+  svn_txdelta_op_t op;
+  apr_size_t len;
+
+  SVN_ERR(read_window_header(stream, &sview_offset, &sview_len, &tview_len,
+                             &inslen, &newlen, &header_len));
+
+  *window_len = inslen + newlen + header_len;
+  *data_offset = header_len + inslen;
+  *data_len = 0;
+
+  /* A single instruction, plus its svndiff1/2 length prefix, is short. */
+  if (sview_len != 0 || tview_len == 0 || inslen > sizeof(buf))
+    return SVN_NO_ERROR;
+
+  len = inslen;
+  SVN_ERR(svn_stream_read_full(stream, (char *)buf, &len));
+  if (len != inslen)
+    return svn_error_create(SVN_ERR_SVNDIFF_UNEXPECTED_END, NULL,
+                            _("Unexpected end of svndiff input"));
+
+  p = buf;
+  end = buf + inslen;
+  if (svndiff_version == 1 || svndiff_version == 2)
+    {
+      p = svn__decode_uint(&orig_len, p, end);
+      if (p == NULL || orig_len != (apr_uint64_t)(end - p))
+        return SVN_NO_ERROR;
+    }
+
+  p = decode_instruction(&op, p, end);
+  if (   p != end
+      || op.action_code != svn_txdelta_new
+      || op.length != tview_len)
+    return SVN_NO_ERROR;
+
+  if (svndiff_version == 1 || svndiff_version == 2)
+    {
+      /* The new data must have been stored uncompressed. */
+      len = newlen < SVN__MAX_ENCODED_UINT_LEN ? newlen
+                                               : SVN__MAX_ENCODED_UINT_LEN;
+      SVN_ERR(svn_stream_read_full(stream, (char *)buf, &len));
+
+      p = svn__decode_uint(&orig_len, buf, buf + len);
+      if (   p == NULL
+          || orig_len != tview_len
+          || (apr_size_t)(p - buf) + tview_len != newlen)
+        return SVN_NO_ERROR;
+
+      *data_offset += p - buf;
+    }
+  else if (newlen != tview_len)
+    {
+      return SVN_NO_ERROR;
+    }
+
+  *data_len = tview_len;
+  return SVN_NO_ERROR;
+}
+
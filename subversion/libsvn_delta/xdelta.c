@@ -29,8 +29,15 @@
 
 #include "svn_hash.h"
 #include "svn_delta.h"
+#include "private/svn_dep_compat.h"
 #include "private/svn_string_private.h"
 #include "delta.h"
+
+#if defined(SVN__HAVE_SSE2)
+#include <emmintrin.h>
+#elif defined(SVN__HAVE_NEON)
+#include <arm_neon.h>
+#endif
 
 /* This is pseudo-adler32. It is adler32 without the prime modulus.
    The idea is borrowed from monotone, and is a translation of the C++
@@ -77,7 +84,82 @@ adler32_replace(apr_uint32_t adler32, const char c_out, const char c_in)
 }
 
 /* Calculate an pseudo-adler32 checksum for MATCH_BLOCKSIZE bytes starting
-   at DATA.  Return the checksum value.  */
+   at DATA.  Return the checksum value.
+
+   The SIMD variants use the fact that the I-th byte gets added
+   MATCH_BLOCKSIZE - I times to S2, i.e. S2 is a weighted sum of the
+   input bytes.  They produce the exact same results as the scalar code. */
+
+#if defined(SVN__HAVE_SSE2) && MATCH_BLOCKSIZE == 64
+
+static APR_INLINE apr_uint32_t
+init_adler32(const char *data)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i step = _mm_set1_epi16(8);
+  __m128i weights = _mm_set_epi16(57, 58, 59, 60, 61, 62, 63, 64);
+  __m128i s1 = zero;
+  __m128i s2 = zero;
+  int i;
+
+  for (i = 0; i < MATCH_BLOCKSIZE; i += sizeof(__m128i))
+    {
+      __m128i input = _mm_loadu_si128((const __m128i *)(data + i));
+
+      /* Sum of bytes, in two 64 bit lanes. */
+      s1 = _mm_add_epi64(s1, _mm_sad_epu8(input, zero));
+
+      /* Weighted sums, in four 32 bit lanes. */
+      s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpacklo_epi8(input, zero),
+                                            weights));
+      weights = _mm_sub_epi16(weights, step);
+      s2 = _mm_add_epi32(s2, _mm_madd_epi16(_mm_unpackhi_epi8(input, zero),
+                                            weights));
+      weights = _mm_sub_epi16(weights, step);
+    }
+
+  /* Horizontal sums. */
+  s1 = _mm_add_epi64(s1, _mm_unpackhi_epi64(s1, s1));
+  s2 = _mm_add_epi32(s2, _mm_shuffle_epi32(s2, _MM_SHUFFLE(1, 0, 3, 2)));
+  s2 = _mm_add_epi32(s2, _mm_shuffle_epi32(s2, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  return (apr_uint32_t)_mm_cvtsi128_si32(s2) * 0x10000
+       + (apr_uint32_t)_mm_cvtsi128_si32(s1);
+}
+
+#elif defined(SVN__HAVE_NEON) && MATCH_BLOCKSIZE == 64
+
+static APR_INLINE apr_uint32_t
+init_adler32(const char *data)
+{
+  static const uint8_t weights[MATCH_BLOCKSIZE] =
+    {
+      64, 63, 62, 61, 60, 59, 58, 57, 56, 55, 54, 53, 52, 51, 50, 49,
+      48, 47, 46, 45, 44, 43, 42, 41, 40, 39, 38, 37, 36, 35, 34, 33,
+      32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+      16, 15, 14, 13, 12, 11, 10,  9,  8,  7,  6,  5,  4,  3,  2,  1
+    };
+
+  const uint8_t *input = (const uint8_t *)data;
+  uint32x4_t s1 = vdupq_n_u32(0);
+  uint32x4_t s2 = vdupq_n_u32(0);
+  int i;
+
+  for (i = 0; i < MATCH_BLOCKSIZE; i += sizeof(uint8x16_t))
+    {
+      uint8x16_t bytes = vld1q_u8(input + i);
+      uint8x16_t w = vld1q_u8(weights + i);
+
+      /* The products are at most 255 * 64 and fit into 16 bits. */
+      s1 = vpadalq_u16(s1, vpaddlq_u8(bytes));
+      s2 = vpadalq_u16(s2, vmull_u8(vget_low_u8(bytes), vget_low_u8(w)));
+      s2 = vpadalq_u16(s2, vmull_high_u8(bytes, w));
+    }
+
+  return vaddvq_u32(s2) * 0x10000 + vaddvq_u32(s1);
+}
+
+#else
 
 static APR_INLINE apr_uint32_t
 init_adler32(const char *data)
@@ -103,6 +185,8 @@ init_adler32(const char *data)
   return s2 * 0x10000 + s1;
 }
 
+#endif
+
 /* Information for a block of the delta source.  The length of the
    block is the smaller of MATCH_BLOCKSIZE and the difference between
    the size of the source data and the position of this block. */
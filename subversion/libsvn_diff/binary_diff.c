@@ -25,7 +25,9 @@
 
 #include "svn_pools.h"
 #include "svn_error.h"
+#include "svn_delta.h"
 #include "svn_diff.h"
+#include "svn_sorts.h"
 #include "svn_types.h"
 
 #include "diff.h"
@@ -33,9 +35,12 @@
 #include "svn_private_config.h"
 
 /* Copies the data from ORIGINAL_STREAM to a temporary file, returning both
-   the original and compressed size. */
+   the original and compressed size.  If RAW_PATH is not NULL, also keep an
+   uncompressed copy of the data in a temporary file and return its path in
+   *RAW_PATH. */
 static svn_error_t *
 create_compressed(apr_file_t **result,
+                  const char **raw_path,
                   svn_filesize_t *full_size,
                   svn_filesize_t *compressed_size,
                   svn_stream_t *original_stream,
@@ -56,6 +61,19 @@ create_compressed(apr_file_t **result,
                   svn_stream_from_aprfile2(*result, TRUE, scratch_pool),
                   scratch_pool);
 
+  if (raw_path)
+    {
+      apr_file_t *raw;
+
+      SVN_ERR(svn_io_open_unique_file3(&raw, raw_path, NULL,
+                                       svn_io_file_del_on_pool_cleanup,
+                                       result_pool, scratch_pool));
+      compressed = svn_stream_tee(compressed,
+                                  svn_stream_from_aprfile2(raw, FALSE,
+                                                           scratch_pool),
+                                  scratch_pool);
+    }
+
   if (original_stream)
     do
     {
@@ -85,9 +103,239 @@ create_compressed(apr_file_t **result,
   return SVN_NO_ERROR;
 }
 
+/* Largest number of bytes a single git delta copy instruction covers. */
+#define GIT_DELTA_MAX_COPY 0x10000
+
+/* Largest number of bytes a single git delta insert instruction covers. */
+#define GIT_DELTA_MAX_INSERT 0x7f
+
+/* Baton for git_delta_window_handler */
+struct git_delta_baton_t
+{
+  /* Receives the (compressed) delta instructions */
+  svn_stream_t *output;
+
+  /* Number of uncompressed bytes written to OUTPUT */
+  svn_filesize_t delta_size;
+
+  /* The uncompressed target and the offset of the current target view */
+  apr_file_t *target;
+  svn_filesize_t target_offset;
+
+  apr_pool_t *iterpool;
+};
+
+/* Write the LEN bytes at DATA as delta data to GDB. */
+static svn_error_t *
+write_delta_data(struct git_delta_baton_t *gdb,
+                 const void *data,
+                 apr_size_t len)
+{
+  apr_size_t written = len;
+
+  SVN_ERR(svn_stream_write(gdb->output, data, &written));
+  gdb->delta_size += len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write VALUE in the variable length size encoding used in git delta
+   headers to GDB. */
+static svn_error_t *
+write_delta_size(struct git_delta_baton_t *gdb,
+                 svn_filesize_t value)
+{
+  unsigned char buffer[10];
+  apr_size_t len = 0;
+
+  do
+    {
+      buffer[len] = (unsigned char)(value & 0x7f);
+      value >>= 7;
+      if (value)
+        buffer[len] |= 0x80;
+      len++;
+    }
+  while (value);
+
+  return svn_error_trace(write_delta_data(gdb, buffer, len));
+}
+
+/* Write git delta instructions to GDB that copy LENGTH bytes from OFFSET
+   in the source. */
+static svn_error_t *
+write_delta_copy(struct git_delta_baton_t *gdb,
+                 svn_filesize_t offset,
+                 apr_size_t length)
+{
+  while (length)
+    {
+      unsigned char instruction[8];
+      apr_size_t len = 1;
+      apr_size_t size = MIN(length, GIT_DELTA_MAX_COPY);
+      int i;
+
+      instruction[0] = 0x80;
+
+      /* Only the non-zero bytes of offset and size get written.  A size
+         of GIT_DELTA_MAX_COPY is written as 0. */
+      for (i = 0; i < 4; i++)
+        if ((offset >> (i * 8)) & 0xff)
+          {
+            instruction[0] |= 1 << i;
+            instruction[len++] = (unsigned char)(offset >> (i * 8));
+          }
+
+      for (i = 0; i < 2; i++)
+        if ((size & 0xffff) >> (i * 8) & 0xff)
+          {
+            instruction[0] |= 0x10 << i;
+            instruction[len++] = (unsigned char)(size >> (i * 8));
+          }
+
+      SVN_ERR(write_delta_data(gdb, instruction, len));
+
+      offset += size;
+      length -= size;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Write git delta instructions to GDB that insert the LENGTH bytes at
+   DATA. */
+static svn_error_t *
+write_delta_insert(struct git_delta_baton_t *gdb,
+                   const char *data,
+                   apr_size_t length)
+{
+  while (length)
+    {
+      unsigned char size = (unsigned char)MIN(length, GIT_DELTA_MAX_INSERT);
+
+      SVN_ERR(write_delta_data(gdb, &size, 1));
+      SVN_ERR(write_delta_data(gdb, data, size));
+
+      data += size;
+      length -= size;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_txdelta_window_handler_t, converting the instructions
+   of WINDOW to git delta instructions.  Git deltas can't copy from the
+   target, so data copied from the target view gets inserted instead. */
+static svn_error_t *
+git_delta_window_handler(svn_txdelta_window_t *window,
+                         void *baton)
+{
+  struct git_delta_baton_t *gdb = baton;
+  int i;
+
+  if (window == NULL)
+    return SVN_NO_ERROR;
+
+  svn_pool_clear(gdb->iterpool);
+
+  for (i = 0; i < window->num_ops; i++)
+    {
+      const svn_txdelta_op_t *op = &window->ops[i];
+
+      switch (op->action_code)
+        {
+          case svn_txdelta_source:
+            SVN_ERR(write_delta_copy(gdb, window->sview_offset + op->offset,
+                                     op->length));
+            break;
+
+          case svn_txdelta_target:
+            {
+              char *buffer = apr_palloc(gdb->iterpool, op->length);
+              apr_off_t offset = gdb->target_offset + op->offset;
+
+              SVN_ERR(svn_io_file_seek(gdb->target, APR_SET, &offset,
+                                       gdb->iterpool));
+              SVN_ERR(svn_io_file_read_full2(gdb->target, buffer, op->length,
+                                             NULL, NULL, gdb->iterpool));
+              SVN_ERR(write_delta_insert(gdb, buffer, op->length));
+            }
+            break;
+
+          case svn_txdelta_new:
+            SVN_ERR(write_delta_insert(gdb,
+                                       window->new_data->data + op->offset,
+                                       op->length));
+            break;
+        }
+    }
+
+  gdb->target_offset += window->tview_len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Writes a compressed git delta that transforms the data in the file
+   SOURCE_PATH of SOURCE_SIZE bytes into the data in the file TARGET_PATH
+   of TARGET_SIZE bytes to a temporary file, returning both the
+   uncompressed and compressed size of the delta. */
+static svn_error_t *
+create_compressed_delta(apr_file_t **result,
+                        svn_filesize_t *delta_size,
+                        svn_filesize_t *compressed_size,
+                        const char *source_path,
+                        svn_filesize_t source_size,
+                        const char *target_path,
+                        svn_filesize_t target_size,
+                        svn_cancel_func_t cancel_func,
+                        void *cancel_baton,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  struct git_delta_baton_t gdb = { 0 };
+  svn_stream_t *source;
+  svn_stream_t *target;
+
+  SVN_ERR(svn_io_open_uniquely_named(result, NULL, NULL, "diffgz",
+                                     NULL, svn_io_file_del_on_pool_cleanup,
+                                     result_pool, scratch_pool));
+
+  gdb.output = svn_stream_compressed(
+                  svn_stream_from_aprfile2(*result, TRUE, scratch_pool),
+                  scratch_pool);
+  gdb.iterpool = svn_pool_create(scratch_pool);
+
+  /* The delta reads the target sequentially, while we look up data copied
+     from the target view through a separate handle. */
+  SVN_ERR(svn_io_file_open(&gdb.target, target_path, APR_READ,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_stream_open_readonly(&source, source_path,
+                                   scratch_pool, scratch_pool));
+  SVN_ERR(svn_stream_open_readonly(&target, target_path,
+                                   scratch_pool, scratch_pool));
+
+  SVN_ERR(write_delta_size(&gdb, source_size));
+  SVN_ERR(write_delta_size(&gdb, target_size));
+
+  SVN_ERR(svn_txdelta_run(source, target,
+                          git_delta_window_handler, &gdb,
+                          svn_checksum_md5, NULL,
+                          cancel_func, cancel_baton,
+                          scratch_pool, scratch_pool));
+
+  SVN_ERR(svn_stream_close(gdb.output)); /* Flush compression */
+  SVN_ERR(svn_io_file_close(gdb.target, scratch_pool));
+  svn_pool_destroy(gdb.iterpool);
+
+  *delta_size = gdb.delta_size;
+  SVN_ERR(svn_io_file_size_get(compressed_size, *result, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 #define GIT_BASE85_CHUNKSIZE 52
 
-/* Git Base-85 table for write_literal */
+/* Git Base-85 table for write_hunk */
 static const char b85str[] =
     "0123456789"
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
@@ -154,28 +402,29 @@ svn_diff__base85_decode_line(char *output_data,
 }
 
 
-/* Git length encoding table for write_literal */
+/* Git length encoding table for write_hunk */
 static const char b85lenstr[] =
     "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
     "abcdefghijklmnopqrstuvwxyz";
 
-/* Writes out a git-like literal output of the compressed data in
-   COMPRESSED_DATA to OUTPUT_STREAM, describing that its normal length is
-   UNCOMPRESSED_SIZE. */
+/* Writes out a git-like hunk of type HUNK_TYPE ("literal" or "delta") of
+   the compressed data in COMPRESSED_DATA to OUTPUT_STREAM, describing that
+   its normal length is UNCOMPRESSED_SIZE. */
 static svn_error_t *
-write_literal(svn_filesize_t uncompressed_size,
-              svn_stream_t *compressed_data,
-              svn_stream_t *output_stream,
-              svn_cancel_func_t cancel_func,
-              void *cancel_baton,
-              apr_pool_t *scratch_pool)
+write_hunk(const char *hunk_type,
+           svn_filesize_t uncompressed_size,
+           svn_stream_t *compressed_data,
+           svn_stream_t *output_stream,
+           svn_cancel_func_t cancel_func,
+           void *cancel_baton,
+           apr_pool_t *scratch_pool)
 {
   apr_size_t rd;
   SVN_ERR(svn_stream_seek(compressed_data, NULL)); /* Seek to start */
 
   SVN_ERR(svn_stream_printf(output_stream, scratch_pool,
-                            "literal %" SVN_FILESIZE_T_FMT APR_EOL_STR,
-                            uncompressed_size));
+                            "%s %" SVN_FILESIZE_T_FMT APR_EOL_STR,
+                            hunk_type, uncompressed_size));
 
   do
     {
@@ -237,44 +486,76 @@ svn_diff_output_binary(svn_stream_t *output_stream,
                        apr_pool_t *scratch_pool)
 {
   apr_file_t *original_apr;
+  const char *original_raw = NULL;
   svn_filesize_t original_full;
   svn_filesize_t original_deflated;
   apr_file_t *latest_apr;
+  const char *latest_raw = NULL;
   svn_filesize_t latest_full;
   svn_filesize_t latest_deflated;
+  apr_file_t *delta_apr = NULL;
+  svn_filesize_t delta_full;
+  svn_filesize_t delta_deflated;
+  svn_boolean_t try_delta = (original && latest);
   apr_pool_t *subpool = svn_pool_create(scratch_pool);
 
-  SVN_ERR(create_compressed(&original_apr, &original_full, &original_deflated,
+  SVN_ERR(create_compressed(&original_apr,
+                            try_delta ? &original_raw : NULL,
+                            &original_full, &original_deflated,
                             original, cancel_func, cancel_baton,
                             scratch_pool, subpool));
   svn_pool_clear(subpool);
 
-  SVN_ERR(create_compressed(&latest_apr, &latest_full, &latest_deflated,
+  SVN_ERR(create_compressed(&latest_apr,
+                            try_delta ? &latest_raw : NULL,
+                            &latest_full, &latest_deflated,
                             latest,  cancel_func, cancel_baton,
                             scratch_pool, subpool));
   svn_pool_clear(subpool);
 
+  /* Like git, describe the latest version as a delta against the original
+     one when that is shorter than the zipped data.  Git deltas can only
+     address the first 4GB of the original. */
+  if (try_delta && original_full > 0 && latest_full > 0
+      && original_full <= APR_UINT32_MAX)
+    {
+      SVN_ERR(create_compressed_delta(&delta_apr, &delta_full,
+                                      &delta_deflated,
+                                      original_raw, original_full,
+                                      latest_raw, latest_full,
+                                      cancel_func, cancel_baton,
+                                      scratch_pool, subpool));
+      svn_pool_clear(subpool);
+
+      if (delta_deflated >= latest_deflated)
+        delta_apr = NULL;
+    }
+
   SVN_ERR(svn_stream_puts(output_stream, "GIT binary patch" APR_EOL_STR));
 
-  /* ### git would first calculate if a git-delta latest->original would be
-         shorter than the zipped data. For now lets assume that it is not
-         and just dump the literal data */
-  SVN_ERR(write_literal(latest_full,
-                        svn_stream_from_aprfile2(latest_apr, FALSE, subpool),
-                        output_stream,
-                        cancel_func, cancel_baton,
-                        scratch_pool));
+  if (delta_apr)
+    SVN_ERR(write_hunk("delta", delta_full,
+                       svn_stream_from_aprfile2(delta_apr, FALSE, subpool),
+                       output_stream,
+                       cancel_func, cancel_baton,
+                       scratch_pool));
+  else
+    SVN_ERR(write_hunk("literal", latest_full,
+                       svn_stream_from_aprfile2(latest_apr, FALSE, subpool),
+                       output_stream,
+                       cancel_func, cancel_baton,
+                       scratch_pool));
   svn_pool_clear(subpool);
   SVN_ERR(svn_stream_puts(output_stream, APR_EOL_STR));
 
-  /* ### git would first calculate if a git-delta original->latest would be
-         shorter than the zipped data. For now lets assume that it is not
-         and just dump the literal data */
-  SVN_ERR(write_literal(original_full,
-                        svn_stream_from_aprfile2(original_apr, FALSE, subpool),
-                        output_stream,
-                        cancel_func, cancel_baton,
-                        scratch_pool));
+  /* ### git would first calculate if a git-delta latest->original would be
+         shorter than the zipped data.  We always dump the literal data, so
+         that both versions can be reconstructed from the patch alone. */
+  SVN_ERR(write_hunk("literal", original_full,
+                     svn_stream_from_aprfile2(original_apr, FALSE, subpool),
+                     output_stream,
+                     cancel_func, cancel_baton,
+                     scratch_pool));
   svn_pool_destroy(subpool);
 
   return SVN_NO_ERROR;
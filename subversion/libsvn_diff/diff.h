@@ -33,7 +33,24 @@
 
 #define SVN_DIFF__UNIFIED_CONTEXT_SIZE 3
 
-typedef struct svn_diff__node_t svn_diff__node_t;
+/* The number of identical suffix lines to keep with the middle section. These
+ * lines are not eliminated as suffix, and can be picked up by the token
+ * parsing and lcs steps. This is mainly for backward compatibility with
+ * the previous diff (and blame) output (if there are multiple diff solutions,
+ * our lcs algorithm prefers taking common lines from the start, rather than
+ * from the end. By giving it back some suffix lines, we give it some wiggle
+ * room to find the exact same diff as before).
+ *
+ * The number 50 is more or less arbitrary, based on some real-world tests
+ * with big files (and then doubling the required number to be on the safe
+ * side). This has a negligible effect on the power of the optimization.
+ *
+ * Both the file and the in-memory data sources use this. */
+/* If you change this number, update test_identical_suffix() in diff-diff3-test.c */
+#ifndef SUFFIX_LINES_TO_KEEP
+#define SUFFIX_LINES_TO_KEEP 50
+#endif
+
 typedef struct svn_diff__tree_t svn_diff__tree_t;
 typedef struct svn_diff__position_t svn_diff__position_t;
 typedef struct svn_diff__lcs_t svn_diff__lcs_t;
@@ -114,6 +131,26 @@ svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
               apr_off_t suffix_lines,
               apr_pool_t *pool);
 
+/*
+ * Like svn_diff__lcs() but use the patience diff heuristic: anchor the
+ * LCS on lines that occur exactly once in both sequences and recurse
+ * into the gaps between them.  Regions without any such unique lines
+ * are passed on to svn_diff__lcs().
+ *
+ * The result is not necessarily the longest common subsequence but tends
+ * to align on distinctive lines rather than blank lines or braces, and
+ * avoids the worst case of the O(NP) algorithm on largely rewritten files.
+ */
+svn_diff__lcs_t *
+svn_diff__lcs_patience(svn_diff__position_t *position_list1,
+                       svn_diff__position_t *position_list2,
+                       svn_diff__token_index_t *token_counts_list1,
+                       svn_diff__token_index_t *token_counts_list2,
+                       svn_diff__token_index_t num_tokens,
+                       apr_off_t prefix_lines,
+                       apr_off_t suffix_lines,
+                       apr_pool_t *pool);
+
 
 /*
  * Returns number of tokens in a tree
@@ -158,6 +195,24 @@ svn_diff__diff(svn_diff__lcs_t *lcs,
                svn_boolean_t want_common,
                apr_pool_t *pool);
 
+/* Like svn_diff_diff_2() but use svn_diff__lcs_patience() instead of
+ * svn_diff__lcs() if PATIENCE is set. */
+svn_error_t *
+svn_diff__diff_2(svn_diff_t **diff,
+                 void *diff_baton,
+                 const svn_diff_fns2_t *vtable,
+                 svn_boolean_t patience,
+                 apr_pool_t *pool);
+
+/* Like svn_diff_diff3_2() but use svn_diff__lcs_patience() instead of
+ * svn_diff__lcs() if PATIENCE is set. */
+svn_error_t *
+svn_diff__diff3_2(svn_diff_t **diff,
+                  void *diff_baton,
+                  const svn_diff_fns2_t *vtable,
+                  svn_boolean_t patience,
+                  apr_pool_t *pool);
+
 void
 svn_diff__resolve_conflict(svn_diff_t *hunk,
                            svn_diff__position_t **position_list1,
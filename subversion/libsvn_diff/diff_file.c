@@ -80,6 +80,11 @@ typedef struct svn_diff__file_baton_t
     apr_file_t *file;  /* handle of this file */
     apr_off_t size;    /* total raw size in bytes of this file */
 
+    /* The entire file contents if the file has been mapped into memory,
+       NULL otherwise.  Chunks of a mapped file are not read into a buffer;
+       BUFFER simply points into the mapped region. */
+    char *map;
+
     /* The current chunk: CHUNK_SIZE bytes except for the last chunk. */
     int chunk;     /* the current chunk number, zero-based */
     char *buffer;  /* a buffer containing the current chunk */
@@ -152,6 +157,35 @@ read_chunk(apr_file_t *file,
 }
 
 
+/* Like read_chunk() but for the datasource FILE.  If FILE is mapped into
+ * memory, set *BUFFER to the requested part of the map instead of reading
+ * into it.
+ */
+static APR_INLINE svn_error_t *
+read_file_chunk(struct file_info *file,
+                char **buffer, apr_off_t length,
+                apr_off_t offset, apr_pool_t *scratch_pool)
+{
+  if (file->map)
+    {
+      *buffer = file->map + offset;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(read_chunk(file->file, *buffer, length, offset,
+                                    scratch_pool));
+}
+
+/* On 64 bit platforms, we map datasources that span more than one chunk
+ * into memory as a whole.  Moving between chunks then becomes free and
+ * comparing tokens doesn't need to re-read them from disk.  We can only
+ * do that if no whitespace or EOL normalization is requested, because
+ * that modifies the buffer contents in place.
+ */
+#if APR_HAS_MMAP && APR_SIZEOF_VOIDP >= 8
+#define SVN_DIFF__MAP_DATASOURCES
+#endif
+
 /* Map or read a file at PATH. *BUFFER will point to the file
  * contents; if the file was mapped, *FILE and *MM will contain the
  * mmap context; otherwise they will be NULL.  SIZE will contain the
@@ -288,9 +322,9 @@ increment_chunk(struct file_info *file, apr_pool_t *pool)
       file->chunk++;
       length = file->chunk == last_chunk ?
         offset_in_chunk(file->size) : CHUNK_SIZE;
-      SVN_ERR(read_chunk(file->file, file->buffer,
-                         length, chunk_to_offset(file->chunk),
-                         pool));
+      SVN_ERR(read_file_chunk(file, &file->buffer,
+                              length, chunk_to_offset(file->chunk),
+                              pool));
       file->endp = file->buffer + length;
       file->curp = file->buffer;
     }
@@ -315,9 +349,9 @@ decrement_chunk(struct file_info *file, apr_pool_t *pool)
     {
       /* Read previous chunk and reset pointers. */
       file->chunk--;
-      SVN_ERR(read_chunk(file->file, file->buffer,
-                         CHUNK_SIZE, chunk_to_offset(file->chunk),
-                         pool));
+      SVN_ERR(read_file_chunk(file, &file->buffer,
+                              CHUNK_SIZE, chunk_to_offset(file->chunk),
+                              pool));
       file->endp = file->buffer + CHUNK_SIZE;
       file->curp = file->endp - 1;
     }
@@ -355,20 +389,39 @@ is_one_at_eof(struct file_info file[], apr_size_t file_len)
   return FALSE;
 }
 
-/* Quickly determine whether there is a eol char in CHUNK.
- * (mainly copy-n-paste from eol.c#svn_eol__find_eol_start).
+#if SVN_UNALIGNED_ACCESS_IS_OK
+/* A machine word with the lowest bit of every byte set. */
+#define LSB_SET (SVN__BIT_7_SET >> 7)
+
+/* Return a machine word with bit 7 set in exactly those bytes of CHUNK
+ * that equal the respective bytes of MASK.
  */
+static APR_INLINE apr_uintptr_t
+matching_bytes(apr_uintptr_t chunk, apr_uintptr_t mask)
+{
+  apr_uintptr_t test = chunk ^ mask;
 
-#if SVN_UNALIGNED_ACCESS_IS_OK
-static svn_boolean_t contains_eol(apr_uintptr_t chunk)
+  test |= (test & SVN__LOWER_7BITS_SET) + SVN__LOWER_7BITS_SET;
+  return ~test & SVN__BIT_7_SET;
+}
+
+/* Quickly determine whether there is a CR in CHUNK.
+ */
+static APR_INLINE svn_boolean_t
+contains_cr(apr_uintptr_t chunk)
 {
-  apr_uintptr_t r_test = chunk ^ SVN__R_MASK;
-  apr_uintptr_t n_test = chunk ^ SVN__N_MASK;
+  return matching_bytes(chunk, SVN__N_MASK) != 0;
+}
 
-  r_test |= (r_test & SVN__LOWER_7BITS_SET) + SVN__LOWER_7BITS_SET;
-  n_test |= (n_test & SVN__LOWER_7BITS_SET) + SVN__LOWER_7BITS_SET;
+/* Return the number of LF chars in CHUNK.  The per-byte flags are summed
+ * up in the most significant byte by the multiplication.
+ */
+static APR_INLINE apr_size_t
+count_lf(apr_uintptr_t chunk)
+{
+  apr_uintptr_t flags = matching_bytes(chunk, SVN__R_MASK) >> 7;
 
-  return (r_test & n_test & SVN__BIT_7_SET) != SVN__BIT_7_SET;
+  return (apr_size_t)((flags * LSB_SET) >> (8 * (sizeof(chunk) - 1)));
 }
 #endif
 
@@ -425,8 +478,13 @@ find_identical_prefix(svn_boolean_t *reached_one_eof, apr_off_t *prefix_lines,
        * Determine how far we may advance with chunky ops without reaching
        * endp for any of the files.
        * Signedness is important here if curp gets close to endp.
+       *
+       * LF chars are counted within the words, so we only fall back to
+       * the byte-wise loop above for CRs and mismatches.  Don't start
+       * right behind a CR because a subsequent LF would be counted twice.
        */
-      max_delta = file[0].endp - file[0].curp - sizeof(apr_uintptr_t);
+      max_delta = had_cr ? 0 : file[0].endp - file[0].curp
+                                 - sizeof(apr_uintptr_t);
       for (i = 1; i < file_len; i++)
         {
           delta = file[i].endp - file[i].curp - sizeof(apr_uintptr_t);
@@ -438,7 +496,7 @@ find_identical_prefix(svn_boolean_t *reached_one_eof, apr_off_t *prefix_lines,
       for (delta = 0; delta < max_delta; delta += sizeof(apr_uintptr_t))
         {
           apr_uintptr_t chunk = *(const apr_uintptr_t *)(file[0].curp + delta);
-          if (contains_eol(chunk))
+          if (contains_cr(chunk))
             break;
 
           for (i = 1; i < file_len; i++)
@@ -450,18 +508,21 @@ find_identical_prefix(svn_boolean_t *reached_one_eof, apr_off_t *prefix_lines,
 
           if (! is_match)
             break;
+
+          lines += count_lf(chunk);
         }
 
       if (delta /* > 0*/)
         {
-          /* We either found a mismatch or an EOL at or shortly behind curp+delta
+          /* We either found a mismatch or a CR at or shortly behind curp+delta
            * or we cannot proceed with chunky ops without exceeding endp.
-           * In any way, everything up to curp + delta is equal and not an EOL.
+           * In any way, everything up to curp + delta is equal, contains no
+           * CR and its LFs have been counted.
            */
           for (i = 0; i < file_len; i++)
             file[i].curp += delta;
 
-          /* Skipped data without EOL markers, so last char was not a CR. */
+          /* Skipped data without CRs, so last char was not a CR. */
           had_cr = FALSE;
         }
 #endif
@@ -509,22 +570,6 @@ find_identical_prefix(svn_boolean_t *reached_one_eof, apr_off_t *prefix_lines,
 }
 
 
-/* The number of identical suffix lines to keep with the middle section. These
- * lines are not eliminated as suffix, and can be picked up by the token
- * parsing and lcs steps. This is mainly for backward compatibility with
- * the previous diff (and blame) output (if there are multiple diff solutions,
- * our lcs algorithm prefers taking common lines from the start, rather than
- * from the end. By giving it back some suffix lines, we give it some wiggle
- * room to find the exact same diff as before).
- *
- * The number 50 is more or less arbitrary, based on some real-world tests
- * with big files (and then doubling the required number to be on the safe
- * side). This has a negligible effect on the power of the optimization. */
-/* If you change this number, update test_identical_suffix() in diff-diff3-test.c */
-#ifndef SUFFIX_LINES_TO_KEEP
-#define SUFFIX_LINES_TO_KEEP 50
-#endif
-
 /* Find the suffix which is identical between all elements of the FILE array.
  * Return the number of suffix lines in SUFFIX_LINES.
  *
@@ -553,6 +598,7 @@ find_identical_suffix(apr_off_t *suffix_lines, struct file_info file[],
     {
       file_for_suffix[i].path = file[i].path;
       file_for_suffix[i].file = file[i].file;
+      file_for_suffix[i].map = file[i].map;
       file_for_suffix[i].size = file[i].size;
       file_for_suffix[i].chunk =
         (int) offset_to_chunk(file_for_suffix[i].size); /* last chunk */
@@ -573,11 +619,12 @@ find_identical_suffix(apr_off_t *suffix_lines, struct file_info file[],
         {
           /* There is at least more than 1 chunk,
              so allocate full chunk size buffer */
-          file_for_suffix[i].buffer = apr_palloc(pool, CHUNK_SIZE);
-          SVN_ERR(read_chunk(file_for_suffix[i].file,
-                             file_for_suffix[i].buffer, length[i],
-                             chunk_to_offset(file_for_suffix[i].chunk),
-                             pool));
+          if (! file_for_suffix[i].map)
+            file_for_suffix[i].buffer = apr_palloc(pool, CHUNK_SIZE);
+          SVN_ERR(read_file_chunk(&file_for_suffix[i],
+                                  &file_for_suffix[i].buffer, length[i],
+                                  chunk_to_offset(file_for_suffix[i].chunk),
+                                  pool));
         }
       file_for_suffix[i].endp = file_for_suffix[i].buffer + length[i];
       file_for_suffix[i].curp = file_for_suffix[i].endp - 1;
@@ -661,7 +708,7 @@ find_identical_suffix(apr_off_t *suffix_lines, struct file_info file[],
 
           chunk = *(const apr_uintptr_t *)(file_for_suffix[0].curp + 1
                                              - sizeof(apr_uintptr_t));
-          if (contains_eol(chunk))
+          if (contains_cr(chunk))
             break;
 
           for (i = 1, is_match = TRUE; is_match && i < file_len; i++)
@@ -673,6 +720,9 @@ find_identical_suffix(apr_off_t *suffix_lines, struct file_info file[],
           if (! is_match)
             break;
 
+          /* Every LF ends a line, no matter what precedes it. */
+          lines += count_lf(chunk);
+
           for (i = 0; i < file_len; i++)
             {
               file_for_suffix[i].curp -= sizeof(apr_uintptr_t);
@@ -682,8 +732,9 @@ find_identical_suffix(apr_off_t *suffix_lines, struct file_info file[],
                                   > min_curp[i]);
             }
 
-          /* We skipped some bytes, so there are no closing EOLs */
-          had_nl = FALSE;
+          /* A CR directly before the skipped bytes only ends a line of its
+             own if the first skipped byte is not a LF. */
+          had_nl = file_for_suffix[0].curp[1] == '\n';
         }
 
       /* The > min_curp[i] check leaves at least one final byte for checking
@@ -757,11 +808,11 @@ find_identical_suffix(apr_off_t *suffix_lines, struct file_info file[],
  * BATON's type is (svn_diff__file_baton_t *).
  *
  * For each file in the FILE array, open the file at FILE.path; initialize
- * FILE.file, FILE.size, FILE.buffer, FILE.curp and FILE.endp; allocate a
- * buffer and read the first chunk.  Then find the prefix and suffix lines
- * which are identical between all the files.  Return the number of identical
- * prefix lines in PREFIX_LINES, and the number of identical suffix lines in
- * SUFFIX_LINES.
+ * FILE.file, FILE.size, FILE.map, FILE.buffer, FILE.curp and FILE.endp;
+ * map the file or allocate a buffer and read the first chunk.  Then find
+ * the prefix and suffix lines which are identical between all the files.
+ * Return the number of identical prefix lines in PREFIX_LINES, and the
+ * number of identical suffix lines in SUFFIX_LINES.
  *
  * Finding the identical prefix and suffix allows us to exclude those from the
  * rest of the diff algorithm, which increases performance by reducing the
@@ -799,9 +850,27 @@ datasources_open(void *baton,
       SVN_ERR(svn_io_file_size_get(&filesize, file->file, file_baton->pool));
       file->size = filesize;
       length[i] = filesize > CHUNK_SIZE ? CHUNK_SIZE : filesize;
-      file->buffer = apr_palloc(file_baton->pool, (apr_size_t) length[i]);
-      SVN_ERR(read_chunk(file->file, file->buffer,
-                         length[i], 0, file_baton->pool));
+      file->map = NULL;
+
+#ifdef SVN_DIFF__MAP_DATASOURCES
+      if (filesize > CHUNK_SIZE
+          && ! file_baton->options->ignore_space
+          && ! file_baton->options->ignore_eol_style)
+        {
+          apr_mmap_t *mm;
+
+          /* On failure, just fall back to reading chunks. */
+          if (apr_mmap_create(&mm, file->file, 0, (apr_size_t) filesize,
+                              APR_MMAP_READ, file_baton->pool)
+              == APR_SUCCESS)
+            file->map = mm->mm;
+        }
+#endif
+
+      if (! file->map)
+        file->buffer = apr_palloc(file_baton->pool, (apr_size_t) length[i]);
+      SVN_ERR(read_file_chunk(file, &file->buffer,
+                              length[i], 0, file_baton->pool));
       file->endp = file->buffer + length[i];
       file->curp = file->buffer;
       /* Set suffix_start_chunk to a guard value, so if suffix scanning is
@@ -953,12 +1022,9 @@ datasource_get_next_token(apr_uint32_t *hash, void **token, void *baton,
         h = svn__adler32(h, c, length);
       }
 
-      curp = endp = file->buffer;
       file->chunk++;
       length = file->chunk == last_chunk ?
         offset_in_chunk(file->size) : CHUNK_SIZE;
-      endp += length;
-      file->endp = endp;
 
       /* Issue #4283: Normally we should have checked for reaching the skipped
          suffix here, but because we assume that a suffix always starts on a
@@ -968,10 +1034,13 @@ datasource_get_next_token(apr_uint32_t *hash, void **token, void *baton,
          When changing things here, make sure the whitespace settings are
          applied, or we might not reach the exact suffix boundary as token
          boundary. */
-      SVN_ERR(read_chunk(file->file,
-                         curp, length,
-                         chunk_to_offset(file->chunk),
-                         file_baton->pool));
+      SVN_ERR(read_file_chunk(file,
+                              &file->buffer, length,
+                              chunk_to_offset(file->chunk),
+                              file_baton->pool));
+      curp = file->buffer;
+      endp = curp + length;
+      file->endp = endp;
 
       /* If the last chunk ended in a CR, we're done. */
       if (had_cr)
@@ -1104,14 +1173,16 @@ token_compare(void *baton, void *token1, void *token2, int *compare)
                                            " during diff"),
                                          file[i]->path);
 
-              /* Read a chunk from disk into a buffer */
+              /* Read a chunk from disk into a buffer.  Mapped files
+                 provide the whole rest of the token at once. */
               bufp[i] = buffer[i];
-              length[i] = raw_length[i] > COMPARE_CHUNK_SIZE ?
+              length[i] = raw_length[i] > COMPARE_CHUNK_SIZE
+                          && ! file[i]->map ?
                 COMPARE_CHUNK_SIZE : raw_length[i];
 
-              SVN_ERR(read_chunk(file[i]->file,
-                                 bufp[i], length[i], offset[i],
-                                 file_baton->pool));
+              SVN_ERR(read_file_chunk(file[i],
+                                      &bufp[i], length[i], offset[i],
+                                      file_baton->pool));
               offset[i] += length[i];
               raw_length[i] -= length[i];
               /* bufp[i] gets reset to buffer[i] before reading each chunk,
@@ -1179,8 +1250,9 @@ static const svn_diff_fns2_t svn_diff__file_vtable =
   token_discard_all
 };
 
-/* Id for the --ignore-eol-style option, which doesn't have a short name. */
+/* Ids for the options which don't have a short name. */
 #define SVN_DIFF__OPT_IGNORE_EOL_STYLE 256
+#define SVN_DIFF__OPT_PATIENCE 257
 
 /* Options supported by svn_diff_file_options_parse(). */
 static const apr_getopt_option_t diff_options[] =
@@ -1193,6 +1265,7 @@ static const apr_getopt_option_t diff_options[] =
    * ### we don't have optional argument support. */
   { "unified", 'u', 0, NULL },
   { "context", 'U', 1, NULL },
+  { "patience", SVN_DIFF__OPT_PATIENCE, 0, NULL },
   { NULL, 0, 0, NULL }
 };
 
@@ -1298,6 +1371,9 @@ svn_diff_file_options_parse(svn_diff_file_options_t *options,
         case 'U':
           SVN_ERR(svn_cstring_atoi(&options->context_size, opt_arg));
           break;
+        case SVN_DIFF__OPT_PATIENCE:
+          options->patience = TRUE;
+          break;
         default:
           break;
         }
@@ -1326,7 +1402,8 @@ svn_diff_file_diff_2(svn_diff_t **diff,
   baton.files[1].path = modified;
   baton.pool = svn_pool_create(pool);
 
-  SVN_ERR(svn_diff_diff_2(diff, &baton, &svn_diff__file_vtable, pool));
+  SVN_ERR(svn_diff__diff_2(diff, &baton, &svn_diff__file_vtable,
+                           options->patience, pool));
 
   svn_pool_destroy(baton.pool);
   return SVN_NO_ERROR;
@@ -1348,7 +1425,8 @@ svn_diff_file_diff3_2(svn_diff_t **diff,
   baton.files[2].path = latest;
   baton.pool = svn_pool_create(pool);
 
-  SVN_ERR(svn_diff_diff3_2(diff, &baton, &svn_diff__file_vtable, pool));
+  SVN_ERR(svn_diff__diff3_2(diff, &baton, &svn_diff__file_vtable,
+                            options->patience, pool));
 
   svn_pool_destroy(baton.pool);
   return SVN_NO_ERROR;
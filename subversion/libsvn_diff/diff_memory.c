@@ -38,6 +38,7 @@
 #include "svn_private_config.h"
 #include "private/svn_adler32.h"
 #include "private/svn_diff_private.h"
+#include "private/svn_eol_private.h"
 
 typedef struct source_tokens_t
 {
@@ -49,6 +50,10 @@ typedef struct source_tokens_t
   /* Next token to be consumed */
   apr_size_t next_token;
 
+  /* Index of the first token of the identical suffix, i.e. one past
+     the last token to be consumed */
+  apr_size_t end_token;
+
   /* The source, containing the in-memory data to be diffed */
   const svn_string_t *source;
 
@@ -91,6 +96,33 @@ datasource_to_index(svn_diff_datasource_e datasource)
 }
 
 
+/* Return TRUE if the tokens at index IDX of all LEN sources in SRC are
+   byte-wise identical.  Count IDX from the last token if FROM_END is set. */
+static svn_boolean_t
+tokens_identical(source_tokens_t *src[],
+                 apr_size_t len,
+                 apr_size_t idx,
+                 svn_boolean_t from_end)
+{
+  const svn_string_t *first = NULL;
+  apr_size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      const svn_string_t *token
+        = APR_ARRAY_IDX(src[i]->tokens,
+                        from_end ? src[i]->tokens->nelts - 1 - idx : idx,
+                        svn_string_t *);
+
+      if (!first)
+        first = token;
+      else if (! svn_string_compare(first, token))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 /* Implements svn_diff_fns2_t::datasources_open */
 static svn_error_t *
 datasources_open(void *baton,
@@ -99,9 +131,43 @@ datasources_open(void *baton,
                  const svn_diff_datasource_e *datasources,
                  apr_size_t datasources_len)
 {
-  /* Do nothing: everything is already there and initialized to 0 */
-  *prefix_lines = 0;
-  *suffix_lines = 0;
+  diff_mem_baton_t *mem_baton = baton;
+  source_tokens_t *src[4];
+  apr_size_t min_tokens = APR_SIZE_MAX;
+  apr_size_t prefix;
+  apr_size_t suffix;
+  apr_size_t i;
+
+  /* Everything is already tokenized.  Like diff_file.c, skip the identical
+     prefix and suffix, so that only the differing middle section goes
+     through the token tree and the lcs.  Tokens which are byte-wise
+     identical compare equal under any normalization options. */
+  for (i = 0; i < datasources_len; i++)
+    {
+      src[i] = &mem_baton->sources[datasource_to_index(datasources[i])];
+      if ((apr_size_t)src[i]->tokens->nelts < min_tokens)
+        min_tokens = src[i]->tokens->nelts;
+    }
+
+  for (prefix = 0; prefix < min_tokens; prefix++)
+    if (! tokens_identical(src, datasources_len, prefix, FALSE))
+      break;
+
+  for (suffix = 0; prefix + suffix < min_tokens; suffix++)
+    if (! tokens_identical(src, datasources_len, suffix, TRUE))
+      break;
+
+  suffix = (suffix > SUFFIX_LINES_TO_KEEP) ? suffix - SUFFIX_LINES_TO_KEEP
+                                           : 0;
+
+  for (i = 0; i < datasources_len; i++)
+    {
+      src[i]->next_token = prefix;
+      src[i]->end_token = src[i]->tokens->nelts - suffix;
+    }
+
+  *prefix_lines = prefix;
+  *suffix_lines = suffix;
   return SVN_NO_ERROR;
 }
 
@@ -126,7 +192,7 @@ datasource_get_next_token(apr_uint32_t *hash, void **token, void *baton,
   diff_mem_baton_t *mem_baton = baton;
   source_tokens_t *src = &(mem_baton->sources[datasource_to_index(datasource)]);
 
-  if ((apr_size_t)src->tokens->nelts > src->next_token)
+  if (src->end_token > src->next_token)
     {
       /* There are actually tokens to be returned */
       char *buf = mem_baton->normalization_buf[0];
@@ -206,12 +272,44 @@ static const svn_diff_fns2_t svn_diff__mem_vtable =
   token_discard_all
 };
 
+/* Return the end of the token (line) starting at STARTP in a text that
+   ends at ENDP, i.e. the position just past its EOL sequence, or ENDP if
+   there is none. */
+static const char *
+find_token_end(const char *startp, const char *endp)
+{
+  const char *eolp = svn_eol__find_eol_start((char *)startp, endp - startp);
+
+  if (! eolp)
+    return endp;
+
+  if (*eolp == '\r' && eolp + 1 != endp && eolp[1] == '\n')
+    eolp++;
+
+  return eolp + 1;
+}
+
+/* Return the number of diff tokens (e.g. lines) in TEXT. */
+static apr_size_t
+count_source_tokens(const svn_string_t *text)
+{
+  const char *curp = text->data;
+  const char *endp = curp + text->len;
+  apr_size_t count = 0;
+
+  for (; curp != endp; count++)
+    curp = find_token_end(curp, endp);
+
+  return count;
+}
+
 /* Fill SRC with the diff tokens (e.g. lines).
 
    TEXT is assumed to live long enough for the tokens to
    stay valid during their lifetime: no data is copied,
    instead, svn_string_t's are allocated pointing straight
-   into TEXT.
+   into TEXT.  They all come from a single block sized
+   by a first pass over TEXT.
 */
 static void
 fill_source_tokens(source_tokens_t *src,
@@ -221,47 +319,49 @@ fill_source_tokens(source_tokens_t *src,
   const char *curp;
   const char *endp;
   const char *startp;
+  apr_size_t count = count_source_tokens(text);
+  svn_string_t *strings = apr_palloc(pool, count * sizeof(*strings));
 
-  src->tokens = apr_array_make(pool, 0, sizeof(svn_string_t *));
+  src->tokens = apr_array_make(pool, (int)count, sizeof(svn_string_t *));
   src->next_token = 0;
+  src->end_token = count;
   src->source = text;
+  src->ends_without_eol = FALSE;
 
   for (startp = curp = text->data, endp = curp + text->len;
-       curp != endp; curp++)
+       startp != endp; startp = curp)
     {
-      if (curp != endp && *curp == '\r' && *(curp + 1) == '\n')
-        curp++;
+      curp = find_token_end(startp, endp);
 
-      if (*curp == '\r' || *curp == '\n')
-        {
-          APR_ARRAY_PUSH(src->tokens, svn_string_t *) =
-            svn_string_ncreate(startp, curp - startp + 1, pool);
-
-          startp = curp + 1;
-        }
-    }
+      strings->data = startp;
+      strings->len = curp - startp;
+      APR_ARRAY_PUSH(src->tokens, svn_string_t *) = strings++;
 
-  /* If there's anything remaining (ie last line doesn't have a newline) */
-  if (startp != endp)
-    {
-      APR_ARRAY_PUSH(src->tokens, svn_string_t *) =
-        svn_string_ncreate(startp, endp - startp, pool);
-      src->ends_without_eol = TRUE;
+      /* The last line doesn't have a newline? */
+      if (curp == endp && *(curp - 1) != '\n' && *(curp - 1) != '\r')
+        src->ends_without_eol = TRUE;
     }
-  else
-    src->ends_without_eol = FALSE;
 }
 
 
 static void
 alloc_normalization_bufs(diff_mem_baton_t *btn,
                          int sources,
+                         const svn_diff_file_options_t *options,
                          apr_pool_t *pool)
 {
   apr_size_t max_len = 0;
   apr_off_t idx;
   int i;
 
+  /* Without normalization, tokens are compared in place. */
+  if (! options->ignore_space && ! options->ignore_eol_style)
+    {
+      btn->normalization_buf[0] = NULL;
+      btn->normalization_buf[1] = NULL;
+      return;
+    }
+
   for (i = 0; i < sources; i++)
     {
       apr_array_header_t *tokens = btn->sources[i].tokens;
@@ -287,13 +387,32 @@ svn_diff_mem_string_diff(svn_diff_t **diff,
 {
   diff_mem_baton_t baton;
 
+  /* Identical texts, e.g. most properties, need neither tokens nor an
+     lcs: the diff is a single common range, or empty. */
+  if (svn_string_compare(original, modified))
+    {
+      apr_size_t count = count_source_tokens(original);
+
+      *diff = NULL;
+      if (count)
+        {
+          *diff = apr_pcalloc(pool, sizeof(**diff));
+          (*diff)->type = svn_diff__type_common;
+          (*diff)->original_length = count;
+          (*diff)->modified_length = count;
+        }
+
+      return SVN_NO_ERROR;
+    }
+
   fill_source_tokens(&(baton.sources[0]), original, pool);
   fill_source_tokens(&(baton.sources[1]), modified, pool);
-  alloc_normalization_bufs(&baton, 2, pool);
+  alloc_normalization_bufs(&baton, 2, options, pool);
 
   baton.normalization_options = options;
 
-  return svn_diff_diff_2(diff, &baton, &svn_diff__mem_vtable, pool);
+  return svn_diff__diff_2(diff, &baton, &svn_diff__mem_vtable,
+                          options->patience, pool);
 }
 
 svn_error_t *
@@ -309,11 +428,12 @@ svn_diff_mem_string_diff3(svn_diff_t **diff,
   fill_source_tokens(&(baton.sources[0]), original, pool);
   fill_source_tokens(&(baton.sources[1]), modified, pool);
   fill_source_tokens(&(baton.sources[2]), latest, pool);
-  alloc_normalization_bufs(&baton, 3, pool);
+  alloc_normalization_bufs(&baton, 3, options, pool);
 
   baton.normalization_options = options;
 
-  return svn_diff_diff3_2(diff, &baton, &svn_diff__mem_vtable, pool);
+  return svn_diff__diff3_2(diff, &baton, &svn_diff__mem_vtable,
+                           options->patience, pool);
 }
 
 
@@ -332,7 +452,7 @@ svn_diff_mem_string_diff4(svn_diff_t **diff,
   fill_source_tokens(&(baton.sources[1]), modified, pool);
   fill_source_tokens(&(baton.sources[2]), latest, pool);
   fill_source_tokens(&(baton.sources[3]), ancestor, pool);
-  alloc_normalization_bufs(&baton, 4, pool);
+  alloc_normalization_bufs(&baton, 4, options, pool);
 
   baton.normalization_options = options;
 
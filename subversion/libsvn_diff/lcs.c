@@ -26,6 +26,8 @@
 #include <apr_pools.h>
 #include <apr_general.h>
 
+#include "svn_pools.h"
+
 #include "diff.h"
 
 
@@ -373,3 +375,432 @@ svn_diff__lcs(svn_diff__position_t *position_list1, /* pointer to tail (ring) */
   else
     return lcs;
 }
+
+
+/*
+ * Patience diff.
+ *
+ * The O(NP) algorithm above is optimal, but its runtime grows with the
+ * product of the file size and the number of differences.  Files that
+ * got regenerated or reformatted easily take minutes.
+ *
+ * Patience diff first matches the lines that occur exactly once in both
+ * sources.  The longest sequence of such matches that is in the same
+ * order in both sources splits the problem into independent, smaller
+ * ones, which get processed the same way.  Matching identical lines at
+ * the start and end of each sub-problem happens before that.  Only
+ * sub-problems without any unique lines fall back to the O(NP) algorithm.
+ * Since unique lines tend to be the interesting ones, the resulting hunks
+ * are often more natural, too.
+ */
+
+/* A sub-problem: lines [START[0], END[0]) of the first source are to be
+ * compared to lines [START[1], END[1]) of the second source.  If
+ * IS_MATCH is set, this is not a sub-problem but a single matching line
+ * pair at START that has to be reported once all previous sub-problems
+ * have been processed. */
+typedef struct patience_task_t
+{
+  apr_off_t start[2];
+  apr_off_t end[2];
+  svn_boolean_t is_match;
+} patience_task_t;
+
+/* State of a patience diff run. */
+typedef struct patience_baton_t
+{
+  /* The positions of both sources, i.e. the lines between the common
+   * prefix and suffix, as arrays. */
+  svn_diff__position_t **positions[2];
+
+  /* Scratch arrays indexed by token: number of occurrences within the
+   * current sub-problem in either source and the index of the last of
+   * them in the second source.  All counts are 0 between uses. */
+  svn_diff__token_index_t *counts[2];
+  apr_off_t *index;
+
+  /* Maps tokens to dense indexes for the fallback to svn_diff__lcs().
+   * All -1 between uses. */
+  svn_diff__token_index_t *dense_index;
+
+  /* The matches found so far, in order, and the tail of that list. */
+  svn_diff__lcs_t *lcs;
+  svn_diff__lcs_t *lcs_tail;
+
+  apr_pool_t *pool;
+} patience_baton_t;
+
+/* Add LENGTH matching lines starting at I in the first and J in the
+ * second source of BATON to its list of matches.
+ */
+static void
+patience_add_match(patience_baton_t *baton,
+                   apr_off_t i,
+                   apr_off_t j,
+                   apr_off_t length)
+{
+  svn_diff__lcs_t *lcs = baton->lcs_tail;
+
+  /* Extend the previous match, if this is a continuation of it. */
+  if (lcs
+      && lcs->position[0]->offset + lcs->length
+           == baton->positions[0][i]->offset
+      && lcs->position[1]->offset + lcs->length
+           == baton->positions[1][j]->offset)
+    {
+      lcs->length += length;
+      return;
+    }
+
+  lcs = apr_palloc(baton->pool, sizeof(*lcs));
+  lcs->position[0] = baton->positions[0][i];
+  lcs->position[1] = baton->positions[1][j];
+  lcs->length = length;
+  lcs->refcount = 1;
+  lcs->next = NULL;
+
+  if (baton->lcs_tail)
+    baton->lcs_tail->next = lcs;
+  else
+    baton->lcs = lcs;
+  baton->lcs_tail = lcs;
+}
+
+/* Compare the lines of TASK in BATON with the O(NP) algorithm and add
+ * the matches to BATON.  Use SCRATCH_POOL for temporary allocations.
+ */
+static void
+patience_fallback(patience_baton_t *baton,
+                  const patience_task_t *task,
+                  apr_pool_t *scratch_pool)
+{
+  svn_diff__position_t *lists[2];
+  svn_diff__token_index_t *counts[2];
+  svn_diff__token_index_t num_tokens = 0;
+  svn_diff__lcs_t *lcs;
+  apr_off_t length[2];
+  apr_off_t i;
+  int s;
+
+  /* svn_diff__lcs() rewires its inputs temporarily and wants token counts
+   * for the lines it compares only.  Hand it copies of our positions with
+   * the tokens renumbered densely, so that this costs no more than the
+   * size of the sub-problem. */
+  for (s = 0; s < 2; s++)
+    {
+      length[s] = task->end[s] - task->start[s];
+      for (i = task->start[s]; i < task->end[s]; i++)
+        {
+          svn_diff__token_index_t token
+            = baton->positions[s][i]->token_index;
+
+          if (baton->dense_index[token] < 0)
+            baton->dense_index[token] = num_tokens++;
+        }
+    }
+
+  for (s = 0; s < 2; s++)
+    {
+      svn_diff__position_t *copies
+        = apr_palloc(scratch_pool, (apr_size_t)length[s] * sizeof(*copies));
+
+      counts[s] = apr_pcalloc(scratch_pool, num_tokens * sizeof(*counts[s]));
+      for (i = 0; i < length[s]; i++)
+        {
+          const svn_diff__position_t *position
+            = baton->positions[s][task->start[s] + i];
+
+          copies[i].token_index = baton->dense_index[position->token_index];
+          copies[i].offset = position->offset;
+          copies[i].next = &copies[(i + 1) % length[s]];
+          counts[s][copies[i].token_index]++;
+        }
+
+      lists[s] = &copies[length[s] - 1];
+    }
+
+  lcs = svn_diff__lcs(lists[0], lists[1], counts[0], counts[1], num_tokens,
+                      0, 0, scratch_pool);
+
+  for (; lcs->length; lcs = lcs->next)
+    patience_add_match(baton,
+                       task->start[0] + lcs->position[0]->offset
+                         - lists[0]->next->offset,
+                       task->start[1] + lcs->position[1]->offset
+                         - lists[1]->next->offset,
+                       lcs->length);
+
+  for (s = 0; s < 2; s++)
+    for (i = task->start[s]; i < task->end[s]; i++)
+      baton->dense_index[baton->positions[s][i]->token_index] = -1;
+}
+
+/* Process TASK in BATON: report a match or strip the common start and
+ * end of a sub-problem and split the remainder at the longest ordered
+ * sequence of lines that are unique in both sources.  Push the resulting
+ * work onto the STACK of patience_task_t in reverse order.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static void
+patience_process(patience_baton_t *baton,
+                 patience_task_t task,
+                 apr_array_header_t *stack,
+                 apr_pool_t *scratch_pool)
+{
+  svn_diff__position_t **positions0 = baton->positions[0];
+  svn_diff__position_t **positions1 = baton->positions[1];
+  apr_off_t *unique_i;
+  apr_off_t *unique_j;
+  apr_off_t *pile_tops;
+  apr_off_t *predecessors;
+  apr_off_t unique_count = 0;
+  apr_off_t piles = 0;
+  apr_off_t tail_length = 0;
+  apr_off_t i, k;
+
+  if (task.is_match)
+    {
+      patience_add_match(baton, task.start[0], task.start[1], 1);
+      return;
+    }
+
+  /* Common start. */
+  while (task.start[0] < task.end[0] && task.start[1] < task.end[1]
+         && positions0[task.start[0]]->token_index
+              == positions1[task.start[1]]->token_index)
+    {
+      patience_add_match(baton, task.start[0], task.start[1], 1);
+      task.start[0]++;
+      task.start[1]++;
+    }
+
+  /* Common end, reported after everything else. */
+  while (task.start[0] < task.end[0] && task.start[1] < task.end[1]
+         && positions0[task.end[0] - 1]->token_index
+              == positions1[task.end[1] - 1]->token_index)
+    {
+      task.end[0]--;
+      task.end[1]--;
+      tail_length++;
+    }
+
+  if (tail_length)
+    {
+      patience_task_t *tail = apr_array_push(stack);
+
+      tail->start[0] = task.end[0];
+      tail->start[1] = task.end[1];
+      tail->end[0] = task.end[0] + tail_length;
+      tail->end[1] = task.end[1] + tail_length;
+      tail->is_match = FALSE;
+    }
+
+  if (task.start[0] == task.end[0] || task.start[1] == task.end[1])
+    return;
+
+  /* Find the lines unique to both sides, in the order of the first. */
+  for (i = task.start[0]; i < task.end[0]; i++)
+    baton->counts[0][positions0[i]->token_index]++;
+  for (i = task.start[1]; i < task.end[1]; i++)
+    {
+      svn_diff__token_index_t token = positions1[i]->token_index;
+
+      baton->counts[1][token]++;
+      baton->index[token] = i;
+    }
+
+  unique_i = apr_palloc(scratch_pool, (apr_size_t)(task.end[0] - task.start[0])
+                                      * sizeof(*unique_i));
+  unique_j = apr_palloc(scratch_pool, (apr_size_t)(task.end[0] - task.start[0])
+                                      * sizeof(*unique_j));
+  for (i = task.start[0]; i < task.end[0]; i++)
+    {
+      svn_diff__token_index_t token = positions0[i]->token_index;
+
+      if (baton->counts[0][token] == 1 && baton->counts[1][token] == 1)
+        {
+          unique_i[unique_count] = i;
+          unique_j[unique_count] = baton->index[token];
+          unique_count++;
+        }
+    }
+
+  for (i = task.start[0]; i < task.end[0]; i++)
+    baton->counts[0][positions0[i]->token_index] = 0;
+  for (i = task.start[1]; i < task.end[1]; i++)
+    baton->counts[1][positions1[i]->token_index] = 0;
+
+  if (unique_count == 0)
+    {
+      patience_fallback(baton, &task, scratch_pool);
+      return;
+    }
+
+  /* Longest increasing subsequence of UNIQUE_J by patience sorting:
+   * PILE_TOPS[P] is the match with the smallest J that ends an increasing
+   * sequence of length P + 1. */
+  pile_tops = apr_palloc(scratch_pool,
+                         (apr_size_t)unique_count * sizeof(*pile_tops));
+  predecessors = apr_palloc(scratch_pool,
+                            (apr_size_t)unique_count * sizeof(*predecessors));
+  for (k = 0; k < unique_count; k++)
+    {
+      apr_off_t low = 0;
+      apr_off_t high = piles;
+
+      while (low < high)
+        {
+          apr_off_t middle = low + (high - low) / 2;
+
+          if (unique_j[pile_tops[middle]] < unique_j[k])
+            low = middle + 1;
+          else
+            high = middle;
+        }
+
+      predecessors[k] = low ? pile_tops[low - 1] : -1;
+      pile_tops[low] = k;
+      if (low == piles)
+        piles++;
+    }
+
+  /* Push the gaps and anchors from the last to the first. */
+  {
+    apr_off_t next_i = task.end[0];
+    apr_off_t next_j = task.end[1];
+
+    for (k = pile_tops[piles - 1]; ; k = predecessors[k])
+      {
+        apr_off_t anchor_i = k >= 0 ? unique_i[k] : task.start[0] - 1;
+        apr_off_t anchor_j = k >= 0 ? unique_j[k] : task.start[1] - 1;
+        patience_task_t *gap = apr_array_push(stack);
+
+        gap->start[0] = anchor_i + 1;
+        gap->start[1] = anchor_j + 1;
+        gap->end[0] = next_i;
+        gap->end[1] = next_j;
+        gap->is_match = FALSE;
+
+        if (k < 0)
+          break;
+
+        gap = apr_array_push(stack);
+        gap->start[0] = anchor_i;
+        gap->start[1] = anchor_j;
+        gap->end[0] = anchor_i + 1;
+        gap->end[1] = anchor_j + 1;
+        gap->is_match = TRUE;
+
+        next_i = anchor_i;
+        next_j = anchor_j;
+      }
+  }
+}
+
+
+svn_diff__lcs_t *
+svn_diff__lcs_patience(svn_diff__position_t *position_list1,
+                       svn_diff__position_t *position_list2,
+                       svn_diff__token_index_t *token_counts_list1,
+                       svn_diff__token_index_t *token_counts_list2,
+                       svn_diff__token_index_t num_tokens,
+                       apr_off_t prefix_lines,
+                       apr_off_t suffix_lines,
+                       apr_pool_t *pool)
+{
+  patience_baton_t baton;
+  svn_diff__position_t *lists[2];
+  apr_off_t length[2];
+  apr_array_header_t *stack;
+  apr_pool_t *scratch_pool;
+  apr_pool_t *iterpool;
+  svn_diff__lcs_t *lcs;
+  patience_task_t *task;
+  svn_diff__token_index_t token_index;
+  int s;
+
+  /* Nothing to split. */
+  if (position_list1 == NULL || position_list2 == NULL)
+    return svn_diff__lcs(position_list1, position_list2, token_counts_list1,
+                         token_counts_list2, num_tokens, prefix_lines,
+                         suffix_lines, pool);
+
+  scratch_pool = svn_pool_create(pool);
+  baton.pool = pool;
+  baton.lcs = NULL;
+  baton.lcs_tail = NULL;
+
+  lists[0] = position_list1;
+  lists[1] = position_list2;
+  for (s = 0; s < 2; s++)
+    {
+      svn_diff__position_t *position = lists[s]->next;
+      apr_off_t i;
+
+      length[s] = lists[s]->offset - lists[s]->next->offset + 1;
+      baton.positions[s] = apr_palloc(scratch_pool,
+                                      (apr_size_t)length[s]
+                                        * sizeof(*baton.positions[s]));
+      for (i = 0; i < length[s]; i++, position = position->next)
+        baton.positions[s][i] = position;
+
+      baton.counts[s] = apr_pcalloc(scratch_pool,
+                                    num_tokens * sizeof(*baton.counts[s]));
+    }
+
+  baton.index = apr_palloc(scratch_pool, num_tokens * sizeof(*baton.index));
+
+  baton.dense_index = apr_palloc(scratch_pool,
+                                 num_tokens * sizeof(*baton.dense_index));
+  for (token_index = 0; token_index < num_tokens; token_index++)
+    baton.dense_index[token_index] = -1;
+
+  /* Process the sub-problems depth first, without recursion; the nesting
+   * may get as deep as the files are long. */
+  stack = apr_array_make(scratch_pool, 64, sizeof(patience_task_t));
+  task = apr_array_push(stack);
+  task->start[0] = 0;
+  task->start[1] = 0;
+  task->end[0] = length[0];
+  task->end[1] = length[1];
+  task->is_match = FALSE;
+
+  iterpool = svn_pool_create(scratch_pool);
+  while (stack->nelts)
+    {
+      patience_task_t current = *(patience_task_t *)apr_array_pop(stack);
+
+      svn_pool_clear(iterpool);
+      patience_process(&baton, current, stack, iterpool);
+    }
+  svn_pool_destroy(iterpool);
+
+  /* EOF is always a sync point, just as in svn_diff__lcs(). */
+  lcs = apr_palloc(pool, sizeof(*lcs));
+  lcs->position[0] = apr_pcalloc(pool, sizeof(*lcs->position[0]));
+  lcs->position[0]->offset = position_list1->offset + suffix_lines + 1;
+  lcs->position[1] = apr_pcalloc(pool, sizeof(*lcs->position[1]));
+  lcs->position[1]->offset = position_list2->offset + suffix_lines + 1;
+  lcs->length = 0;
+  lcs->refcount = 1;
+  lcs->next = NULL;
+
+  if (suffix_lines)
+    lcs = prepend_lcs(lcs, suffix_lines,
+                      lcs->position[0]->offset - suffix_lines,
+                      lcs->position[1]->offset - suffix_lines,
+                      pool);
+
+  if (baton.lcs_tail)
+    {
+      baton.lcs_tail->next = lcs;
+      lcs = baton.lcs;
+    }
+
+  svn_pool_destroy(scratch_pool);
+
+  if (prefix_lines)
+    return prepend_lcs(lcs, prefix_lines, 1, 1, pool);
+  else
+    return lcs;
+}
@@ -25,6 +25,8 @@
 #include <stddef.h>
 #include <string.h>
 
+#include <apr_mmap.h>
+
 #include "svn_hash.h"
 #include "svn_types.h"
 #include "svn_error.h"
@@ -54,6 +56,91 @@
 /* Like strlen() but for string literals. */
 #define STRLEN_LITERAL(str) (sizeof(str) - 1)
 
+/* The contents of a patch file, as seen by the parser and by the hunks
+ * and binary patches that refer back into it. */
+typedef struct patch_data_t
+{
+  /* APR file handle to the patch file, NULL if MAPPED holds all data. */
+  apr_file_t *file;
+
+  /* The contents of FILE, if they could be mapped into memory.  Lines
+   * are then taken directly from there instead of seeking and reading
+   * FILE byte by byte.  NULL otherwise. */
+  const char *mapped;
+
+#if APR_HAS_MMAP
+  /* The mmap context of MAPPED, or NULL. */
+  apr_mmap_t *mm;
+#endif
+
+  /* Size of the patch file in bytes. */
+  apr_off_t size;
+} patch_data_t;
+
+/* Read the line starting at offset *POS in DATA, with the same semantics
+ * as svn_io_file_readline() would have for a file positioned there, and
+ * set *POS to the offset just after the bytes consumed. */
+static svn_error_t *
+read_line(svn_stringbuf_t **stringbuf,
+          const char **eol,
+          svn_boolean_t *eof,
+          apr_off_t *pos,
+          const patch_data_t *data,
+          apr_size_t max_len,
+          apr_pool_t *result_pool,
+          apr_pool_t *scratch_pool)
+{
+  const char *start;
+  const char *eol_start;
+  const char *eol_str = NULL;
+  apr_size_t limit;
+  apr_size_t len;
+
+  if (! data->mapped)
+    {
+      SVN_ERR(svn_io_file_seek(data->file, APR_SET, pos, scratch_pool));
+      SVN_ERR(svn_io_file_readline(data->file, stringbuf, eol, eof, max_len,
+                                   result_pool, scratch_pool));
+      return svn_error_trace(svn_io_file_get_offset(pos, data->file,
+                                                    scratch_pool));
+    }
+
+  start = data->mapped + *pos;
+  limit = *pos < data->size ? (apr_size_t)(data->size - *pos) : 0;
+  if (limit > max_len)
+    limit = max_len;
+
+  eol_start = svn_eol__find_eol_start((char *)start, limit);
+  len = eol_start ? eol_start - start : limit;
+  *stringbuf = svn_stringbuf_ncreate(start, len, result_pool);
+  *pos += len;
+
+  if (eol_start && *eol_start == '\n')
+    {
+      eol_str = "\n";
+      *pos += 1;
+    }
+  else if (eol_start)
+    {
+      /* Like svn_io_file_readline(), only look for "\r\n" if MAX_LEN
+       * permits reading one more byte. */
+      eol_str = "\r";
+      *pos += 1;
+      if (len + 1 < max_len && *pos < data->size && eol_start[1] == '\n')
+        {
+          eol_str = "\r\n";
+          *pos += 1;
+        }
+    }
+
+  if (eol)
+    *eol = eol_str;
+  if (eof)
+    *eof = (eol_str == NULL);
+
+  return SVN_NO_ERROR;
+}
+
 /* This struct describes a range within a file, as well as the
  * current cursor position within the range. All numbers are in bytes. */
 struct svn_diff__hunk_range {
@@ -66,8 +153,8 @@ struct svn_diff_hunk_t {
   /* The patch this hunk belongs to. */
   const svn_patch_t *patch;
 
-  /* APR file handle to the patch file this hunk came from. */
-  apr_file_t *apr_file;
+  /* The patch file this hunk came from. */
+  const patch_data_t *data;
 
   /* Ranges used to keep track of this hunk's texts positions within
    * the patch file. */
@@ -99,18 +186,20 @@ struct svn_diff_binary_patch_t {
   /* The patch this hunk belongs to. */
   const svn_patch_t *patch;
 
-  /* APR file handle to the patch file this hunk came from. */
-  apr_file_t *apr_file;
+  /* The patch file this hunk came from. */
+  const patch_data_t *data;
 
-  /* Offsets inside APR_FILE representing the location of the patch */
+  /* Offsets inside DATA representing the location of the patch */
   apr_off_t src_start;
   apr_off_t src_end;
   svn_filesize_t src_filesize; /* Expanded/final size */
+  svn_boolean_t src_is_delta;  /* Git delta against the result? */
 
-  /* Offsets inside APR_FILE representing the location of the patch */
+  /* Offsets inside DATA representing the location of the patch */
   apr_off_t dst_start;
   apr_off_t dst_end;
   svn_filesize_t dst_filesize; /* Expanded/final size */
+  svn_boolean_t dst_is_delta;  /* Git delta against the original? */
 };
 
 /* Common guts of svn_diff_hunk__create_adds_single_line() and
@@ -127,15 +216,16 @@ add_or_delete_single_line(svn_diff_hunk_t **hunk_out,
                           apr_pool_t *scratch_pool)
 {
   svn_diff_hunk_t *hunk = apr_pcalloc(result_pool, sizeof(*hunk));
+  patch_data_t *data = apr_pcalloc(result_pool, sizeof(*data));
   static const char *hunk_header[] = { "@@ -1 +0,0 @@\n", "@@ -0,0 +1 @@\n" };
   const apr_size_t header_len = strlen(hunk_header[add]);
   const apr_size_t len = strlen(line);
   const apr_size_t end = header_len + (1 + len); /* The +1 is for the \n. */
-  svn_stringbuf_t *buf = svn_stringbuf_create_ensure(end + 1, scratch_pool);
+  svn_stringbuf_t *buf = svn_stringbuf_create_ensure(end + 1, result_pool);
 
   hunk->patch = patch;
 
-  /* hunk->apr_file is created below. */
+  /* hunk->data is filled in below. */
 
   hunk->diff_text_range.start = header_len;
   hunk->diff_text_range.current = header_len;
@@ -180,8 +270,8 @@ add_or_delete_single_line(svn_diff_hunk_t **hunk_out,
   hunk->leading_context = 0;
   hunk->trailing_context = 0;
 
-  /* Create APR_FILE and put just a hunk in it (without a diff header).
-   * Save the offset of the last byte of the diff line. */
+  /* Put just a hunk in BUF (without a diff header) and read the hunk
+   * text from there.  Save the offset of the last byte of the diff line. */
   svn_stringbuf_appendbytes(buf, hunk_header[add], header_len);
   svn_stringbuf_appendbyte(buf, add ? '+' : '-');
   svn_stringbuf_appendbytes(buf, line, len);
@@ -190,14 +280,9 @@ add_or_delete_single_line(svn_diff_hunk_t **hunk_out,
 
   hunk->diff_text_range.end = buf->len;
 
-  SVN_ERR(svn_io_open_unique_file3(&hunk->apr_file, NULL /* filename */,
-                                   NULL /* system tempdir */,
-                                   svn_io_file_del_on_pool_cleanup,
-                                   result_pool, scratch_pool));
-  SVN_ERR(svn_io_file_write_full(hunk->apr_file,
-                                 buf->data, buf->len,
-                                 NULL, scratch_pool));
-  /* No need to seek. */
+  data->mapped = buf->data;
+  data->size = buf->len;
+  hunk->data = data;
 
   *hunk_out = hunk;
   return SVN_NO_ERROR;
@@ -298,7 +383,7 @@ svn_diff_hunk__get_fuzz_penalty(const svn_diff_hunk_t *hunk)
 /* Baton for the base85 stream implementation */
 struct base85_baton_t
 {
-  apr_file_t *file;
+  const patch_data_t *data;
   apr_pool_t *iterpool;
   char buffer[52];        /* Bytes on current line */
   apr_off_t next_pos;     /* Start position of next line */
@@ -347,17 +432,10 @@ read_handler_base85(void *baton, char *buffer, apr_size_t *len)
 
       if (b85b->next_pos >= b85b->end_pos)
         break; /* At EOF */
-      SVN_ERR(svn_io_file_seek(b85b->file, APR_SET, &b85b->next_pos,
-                               iterpool));
-      SVN_ERR(svn_io_file_readline(b85b->file, &line, NULL, &at_eof,
-                                   APR_SIZE_MAX, iterpool, iterpool));
+      SVN_ERR(read_line(&line, NULL, &at_eof, &b85b->next_pos, b85b->data,
+                        APR_SIZE_MAX, iterpool, iterpool));
       if (at_eof)
         b85b->next_pos = b85b->end_pos;
-      else
-        {
-          SVN_ERR(svn_io_file_get_offset(&b85b->next_pos, b85b->file,
-                                         iterpool));
-        }
 
       if (line->len && line->data[0] >= 'A' && line->data[0] <= 'Z')
         b85b->buf_size = line->data[0] - 'A' + 1;
@@ -397,7 +475,7 @@ close_handler_base85(void *baton)
    The current implementation might assume that both start_pos and end_pos
    are located at line boundaries. */
 static svn_stream_t *
-get_base85_data_stream(apr_file_t *file,
+get_base85_data_stream(const patch_data_t *data,
                        apr_off_t start_pos,
                        apr_off_t end_pos,
                        apr_pool_t *result_pool)
@@ -405,7 +483,7 @@ get_base85_data_stream(apr_file_t *file,
   struct base85_baton_t *b85b = apr_pcalloc(result_pool, sizeof(*b85b));
   svn_stream_t *base85s = svn_stream_create(b85b, result_pool);
 
-  b85b->file = file;
+  b85b->data = data;
   b85b->iterpool = svn_pool_create(result_pool);
   b85b->next_pos = start_pos;
   b85b->end_pos = end_pos;
@@ -475,34 +553,291 @@ get_verify_length_stream(svn_stream_t *inner,
   return len_stream;
 }
 
-svn_stream_t *
-svn_diff_get_binary_diff_original_stream(const svn_diff_binary_patch_t *bpatch,
-                                         apr_pool_t *result_pool)
+/* Baton for the git undelta stream functions */
+struct undelta_baton_t
 {
-  svn_stream_t *s = get_base85_data_stream(bpatch->apr_file, bpatch->src_start,
-                                           bpatch->src_end, result_pool);
+  svn_stream_t *delta;          /* Git delta instructions */
+  svn_stream_t *base_stream;    /* Data the delta applies to */
 
-  s = svn_stream_compressed(s, result_pool);
+  apr_file_t *base;             /* Spooled BASE_STREAM, NULL until used */
+  svn_filesize_t base_size;
+  svn_filesize_t remaining;     /* Bytes of the result not yet produced */
 
-  /* ### If we (ever) want to support the DELTA format, then we should hook the
-         undelta handling here */
+  /* The instruction being processed */
+  apr_off_t copy_offset;
+  apr_size_t copy_left;
+  apr_size_t insert_left;
 
-  return get_verify_length_stream(s, bpatch->src_filesize, result_pool);
+  apr_pool_t *pool;
+  apr_pool_t *iterpool;
+};
+
+/* Reads a byte of the delta instructions of UDB into *BYTE */
+static svn_error_t *
+read_delta_byte(unsigned char *byte, struct undelta_baton_t *udb)
+{
+  apr_size_t len = 1;
+
+  SVN_ERR(svn_stream_read_full(udb->delta, (char *)byte, &len));
+  if (len != 1)
+    return svn_error_create(SVN_ERR_DIFF_UNEXPECTED_DATA, NULL,
+                            _("Unexpected end of binary delta"));
+
+  return SVN_NO_ERROR;
 }
 
-svn_stream_t *
-svn_diff_get_binary_diff_result_stream(const svn_diff_binary_patch_t *bpatch,
-                                       apr_pool_t *result_pool)
+/* Reads a size from the header of the delta instructions of UDB into
+   *SIZE */
+static svn_error_t *
+read_delta_size(svn_filesize_t *size, struct undelta_baton_t *udb)
+{
+  unsigned char byte;
+  int shift = 0;
+
+  *size = 0;
+  do
+    {
+      if (shift > 56)
+        return svn_error_create(SVN_ERR_DIFF_UNEXPECTED_DATA, NULL,
+                                _("Invalid size in binary delta"));
+
+      SVN_ERR(read_delta_byte(&byte, udb));
+      *size |= (svn_filesize_t)(byte & 0x7f) << shift;
+      shift += 7;
+    }
+  while (byte & 0x80);
+
+  return SVN_NO_ERROR;
+}
+
+/* Spools the base of UDB to a temporary file and reads the delta header */
+static svn_error_t *
+start_undelta(struct undelta_baton_t *udb)
 {
-  svn_stream_t *s = get_base85_data_stream(bpatch->apr_file, bpatch->dst_start,
-                                           bpatch->dst_end, result_pool);
+  svn_filesize_t source_size;
+
+  SVN_ERR(svn_io_open_unique_file3(&udb->base, NULL, NULL,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   udb->pool, udb->iterpool));
+  SVN_ERR(svn_stream_copy3(svn_stream_disown(udb->base_stream,
+                                             udb->iterpool),
+                           svn_stream_from_aprfile2(udb->base, TRUE,
+                                                    udb->iterpool),
+                           NULL, NULL, udb->iterpool));
+  SVN_ERR(svn_io_file_size_get(&udb->base_size, udb->base, udb->iterpool));
+
+  SVN_ERR(read_delta_size(&source_size, udb));
+  SVN_ERR(read_delta_size(&udb->remaining, udb));
+
+  if (source_size != udb->base_size)
+    return svn_error_create(SVN_ERR_DIFF_UNEXPECTED_DATA, NULL,
+                            _("Binary delta doesn't match the size of its "
+                              "base"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Reads the next instruction of UDB */
+static svn_error_t *
+read_delta_instruction(struct undelta_baton_t *udb)
+{
+  unsigned char cmd;
+  apr_size_t size;
+
+  SVN_ERR(read_delta_byte(&cmd, udb));
+
+  if (cmd & 0x80)
+    {
+      apr_uint32_t offset = 0;
+      int i;
+
+      size = 0;
+      for (i = 0; i < 4; i++)
+        if (cmd & (1 << i))
+          {
+            unsigned char byte;
+
+            SVN_ERR(read_delta_byte(&byte, udb));
+            offset |= (apr_uint32_t)byte << (i * 8);
+          }
+      for (i = 0; i < 3; i++)
+        if (cmd & (0x10 << i))
+          {
+            unsigned char byte;
+
+            SVN_ERR(read_delta_byte(&byte, udb));
+            size |= (apr_size_t)byte << (i * 8);
+          }
+      if (size == 0)
+        size = 0x10000;
+
+      if (offset + (svn_filesize_t)size > udb->base_size)
+        return svn_error_create(SVN_ERR_DIFF_UNEXPECTED_DATA, NULL,
+                                _("Binary delta copies beyond the end of "
+                                  "its base"));
+
+      udb->copy_offset = offset;
+      udb->copy_left = size;
+    }
+  else if (cmd)
+    {
+      size = cmd;
+      udb->insert_left = size;
+    }
+  else
+    return svn_error_create(SVN_ERR_DIFF_UNEXPECTED_DATA, NULL,
+                            _("Invalid instruction in binary delta"));
+
+  if (size > udb->remaining)
+    return svn_error_create(SVN_ERR_DIFF_UNEXPECTED_DATA, NULL,
+                            _("Binary delta expands to longer than "
+                              "declared"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_read_fn_t for the git undelta stream */
+static svn_error_t *
+read_handler_undelta(void *baton, char *buffer, apr_size_t *len)
+{
+  struct undelta_baton_t *udb = baton;
+  apr_size_t remaining = *len;
+
+  svn_pool_clear(udb->iterpool);
+
+  if (! udb->base)
+    SVN_ERR(start_undelta(udb));
+
+  while (remaining && udb->remaining)
+    {
+      apr_size_t n;
+
+      if (udb->copy_left)
+        {
+          n = MIN(remaining, udb->copy_left);
+
+          SVN_ERR(svn_io_file_seek(udb->base, APR_SET, &udb->copy_offset,
+                                   udb->iterpool));
+          SVN_ERR(svn_io_file_read_full2(udb->base, buffer, n, NULL, NULL,
+                                         udb->iterpool));
+          udb->copy_offset += n;
+          udb->copy_left -= n;
+        }
+      else if (udb->insert_left)
+        {
+          apr_size_t len_read = n = MIN(remaining, udb->insert_left);
+
+          SVN_ERR(svn_stream_read_full(udb->delta, buffer, &len_read));
+          if (len_read != n)
+            return svn_error_create(SVN_ERR_DIFF_UNEXPECTED_DATA, NULL,
+                                    _("Unexpected end of binary delta"));
+          udb->insert_left -= n;
+        }
+      else
+        {
+          SVN_ERR(read_delta_instruction(udb));
+          continue;
+        }
+
+      buffer += n;
+      remaining -= n;
+      udb->remaining -= n;
+    }
+
+  *len -= remaining;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t for the git undelta stream */
+static svn_error_t *
+close_handler_undelta(void *baton)
+{
+  struct undelta_baton_t *udb = baton;
+
+  SVN_ERR(svn_stream_close(udb->delta));
+  SVN_ERR(svn_stream_close(udb->base_stream));
+  svn_pool_destroy(udb->iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Gets a stream that reads the result of applying the git delta
+   instructions read from DELTA to the data read from BASE */
+static svn_stream_t *
+get_undelta_stream(svn_stream_t *delta,
+                   svn_stream_t *base,
+                   apr_pool_t *result_pool)
+{
+  struct undelta_baton_t *udb = apr_pcalloc(result_pool, sizeof(*udb));
+  svn_stream_t *undelta_stream = svn_stream_create(udb, result_pool);
+
+  udb->delta = delta;
+  udb->base_stream = base;
+  udb->pool = result_pool;
+  udb->iterpool = svn_pool_create(result_pool);
+
+  svn_stream_set_read2(undelta_stream, NULL /* only full read support */,
+                       read_handler_undelta);
+  svn_stream_set_close(undelta_stream, close_handler_undelta);
+  return undelta_stream;
+}
+
+/* Gets a stream that reads one side of a binary patch, stored as literal
+   data of EXPANDED_SIZE bytes between START_POS and END_POS in DATA */
+static svn_stream_t *
+get_literal_stream(const patch_data_t *data,
+                   apr_off_t start_pos,
+                   apr_off_t end_pos,
+                   svn_filesize_t expanded_size,
+                   apr_pool_t *result_pool)
+{
+  svn_stream_t *s = get_base85_data_stream(data, start_pos, end_pos,
+                                           result_pool);
 
   s = svn_stream_compressed(s, result_pool);
 
-  /* ### If we (ever) want to support the DELTA format, then we should hook the
-  undelta handling here */
+  return get_verify_length_stream(s, expanded_size, result_pool);
+}
+
+svn_stream_t *
+svn_diff_get_binary_diff_original_stream(const svn_diff_binary_patch_t *bpatch,
+                                         apr_pool_t *result_pool)
+{
+  svn_stream_t *s = get_literal_stream(bpatch->data, bpatch->src_start,
+                                       bpatch->src_end, bpatch->src_filesize,
+                                       result_pool);
+
+  /* A delta applies to the result, which then is stored as literal. */
+  if (bpatch->src_is_delta)
+    s = get_undelta_stream(s, get_literal_stream(bpatch->data,
+                                                 bpatch->dst_start,
+                                                 bpatch->dst_end,
+                                                 bpatch->dst_filesize,
+                                                 result_pool),
+                           result_pool);
+
+  return s;
+}
 
-  return get_verify_length_stream(s, bpatch->dst_filesize, result_pool);
+svn_stream_t *
+svn_diff_get_binary_diff_result_stream(const svn_diff_binary_patch_t *bpatch,
+                                       apr_pool_t *result_pool)
+{
+  svn_stream_t *s = get_literal_stream(bpatch->data, bpatch->dst_start,
+                                       bpatch->dst_end, bpatch->dst_filesize,
+                                       result_pool);
+
+  /* A delta applies to the original, which then is stored as literal. */
+  if (bpatch->dst_is_delta)
+    s = get_undelta_stream(s, get_literal_stream(bpatch->data,
+                                                 bpatch->src_start,
+                                                 bpatch->src_end,
+                                                 bpatch->src_filesize,
+                                                 result_pool),
+                           result_pool);
+
+  return s;
 }
 
 /* Try to parse a positive number from a decimal number encoded
@@ -638,7 +973,7 @@ parse_hunk_header(const char *header, svn_diff_hunk_t *hunk,
 }
 
 /* Read a line of original or modified hunk text from the specified
- * RANGE within FILE. FILE is expected to contain unidiff text.
+ * RANGE within DATA. DATA is expected to contain unidiff text.
  * Leading unidiff symbols ('+', '-', and ' ') are removed from the line,
  * Any lines commencing with the VERBOTEN character are discarded.
  * VERBOTEN should be '+' or '-', depending on which form of hunk text
@@ -649,7 +984,7 @@ parse_hunk_header(const char *header, svn_diff_hunk_t *hunk,
  * and svn_diff_hunk_readline_modified_text().
  */
 static svn_error_t *
-hunk_readline_original_or_modified(apr_file_t *file,
+hunk_readline_original_or_modified(const patch_data_t *data,
                                    struct svn_diff__hunk_range *range,
                                    svn_stringbuf_t **stringbuf,
                                    const char **eol,
@@ -661,7 +996,6 @@ hunk_readline_original_or_modified(apr_file_t *file,
 {
   apr_size_t max_len;
   svn_boolean_t filtered;
-  apr_off_t pos;
   svn_stringbuf_t *str;
   const char *eol_p;
   apr_pool_t *last_pool;
@@ -678,9 +1012,6 @@ hunk_readline_original_or_modified(apr_file_t *file,
       return SVN_NO_ERROR;
     }
 
-  SVN_ERR(svn_io_file_get_offset(&pos, file, scratch_pool));
-  SVN_ERR(svn_io_file_seek(file, APR_SET, &range->current, scratch_pool));
-
   /* It's not ITERPOOL because we use data allocated in LAST_POOL out
      of the loop. */
   last_pool = svn_pool_create(scratch_pool);
@@ -689,9 +1020,8 @@ hunk_readline_original_or_modified(apr_file_t *file,
       svn_pool_clear(last_pool);
 
       max_len = range->end - range->current;
-      SVN_ERR(svn_io_file_readline(file, &str, eol, eof, max_len,
-                                   last_pool, last_pool));
-      SVN_ERR(svn_io_file_get_offset(&range->current, file, last_pool));
+      SVN_ERR(read_line(&str, eol, eof, &range->current, data, max_len,
+                        last_pool, last_pool));
       filtered = (str->data[0] == verboten || str->data[0] == '\\');
     }
   while (filtered && ! *eof);
@@ -725,19 +1055,15 @@ hunk_readline_original_or_modified(apr_file_t *file,
         {
           apr_off_t start = 0;
 
-          SVN_ERR(svn_io_file_seek(file, APR_SET, &start, scratch_pool));
-
-          SVN_ERR(svn_io_file_readline(file, &str, eol, NULL, APR_SIZE_MAX,
-                                       scratch_pool, scratch_pool));
+          SVN_ERR(read_line(&str, eol, NULL, &start, data, APR_SIZE_MAX,
+                            scratch_pool, scratch_pool));
 
           /* Every patch file that has hunks has at least one EOL*/
           SVN_ERR_ASSERT(*eol != NULL);
         }
 
       *eof = FALSE;
-      /* Fall through to seek back to the right location */
     }
-  SVN_ERR(svn_io_file_seek(file, APR_SET, &pos, scratch_pool));
 
   svn_pool_destroy(last_pool);
   return SVN_NO_ERROR;
@@ -752,7 +1078,7 @@ svn_diff_hunk_readline_original_text(svn_diff_hunk_t *hunk,
                                      apr_pool_t *scratch_pool)
 {
   return svn_error_trace(
-    hunk_readline_original_or_modified(hunk->apr_file,
+    hunk_readline_original_or_modified(hunk->data,
                                        hunk->patch->reverse ?
                                          &hunk->modified_text_range :
                                          &hunk->original_text_range,
@@ -773,7 +1099,7 @@ svn_diff_hunk_readline_modified_text(svn_diff_hunk_t *hunk,
                                      apr_pool_t *scratch_pool)
 {
   return svn_error_trace(
-    hunk_readline_original_or_modified(hunk->apr_file,
+    hunk_readline_original_or_modified(hunk->data,
                                        hunk->patch->reverse ?
                                          &hunk->original_text_range :
                                          &hunk->modified_text_range,
@@ -795,7 +1121,6 @@ svn_diff_hunk_readline_diff_text(svn_diff_hunk_t *hunk,
 {
   svn_stringbuf_t *line;
   apr_size_t max_len;
-  apr_off_t pos;
   const char *eol_p;
 
   if (!eol)
@@ -810,15 +1135,9 @@ svn_diff_hunk_readline_diff_text(svn_diff_hunk_t *hunk,
       return SVN_NO_ERROR;
     }
 
-  SVN_ERR(svn_io_file_get_offset(&pos, hunk->apr_file, scratch_pool));
-  SVN_ERR(svn_io_file_seek(hunk->apr_file, APR_SET,
-                           &hunk->diff_text_range.current, scratch_pool));
   max_len = hunk->diff_text_range.end - hunk->diff_text_range.current;
-  SVN_ERR(svn_io_file_readline(hunk->apr_file, &line, eol, eof, max_len,
-                               result_pool,
-                   scratch_pool));
-  SVN_ERR(svn_io_file_get_offset(&hunk->diff_text_range.current,
-                                 hunk->apr_file, scratch_pool));
+  SVN_ERR(read_line(&line, eol, eof, &hunk->diff_text_range.current,
+                    hunk->data, max_len, result_pool, scratch_pool));
 
   if (*eof && !*eol && *line->data)
     {
@@ -834,24 +1153,16 @@ svn_diff_hunk_readline_diff_text(svn_diff_hunk_t *hunk,
           apr_off_t start = 0;
           svn_stringbuf_t *str;
 
-          SVN_ERR(svn_io_file_seek(hunk->apr_file, APR_SET, &start,
-                                   scratch_pool));
-
-          SVN_ERR(svn_io_file_readline(hunk->apr_file, &str, eol, NULL,
-                                       APR_SIZE_MAX,
-                                       scratch_pool, scratch_pool));
+          SVN_ERR(read_line(&str, eol, NULL, &start, hunk->data,
+                            APR_SIZE_MAX, scratch_pool, scratch_pool));
 
           /* Every patch file that has hunks has at least one EOL*/
           SVN_ERR_ASSERT(*eol != NULL);
         }
 
       *eof = FALSE;
-
-      /* Fall through to seek back to the right location */
     }
 
-  SVN_ERR(svn_io_file_seek(hunk->apr_file, APR_SET, &pos, scratch_pool));
-
   if (hunk->patch->reverse)
     {
       if (line->data[0] == '+')
@@ -1028,7 +1339,8 @@ parse_mergeinfo(svn_boolean_t *found_mergeinfo,
   return SVN_NO_ERROR;
 }
 
-/* Return the next *HUNK from a PATCH in APR_FILE.
+/* Return the next *HUNK from a PATCH in DATA, starting at offset *POS.
+ * Set *POS to the offset where parsing should continue.
  * If no hunk can be found, set *HUNK to NULL.
  * Set IS_PROPERTY to TRUE if we have a property hunk. If the returned HUNK
  * is the first belonging to a certain property, then PROP_NAME and
@@ -1042,7 +1354,8 @@ parse_next_hunk(svn_diff_hunk_t **hunk,
                 const char **prop_name,
                 svn_diff_operation_kind_t *prop_operation,
                 svn_patch_t *patch,
-                apr_file_t *apr_file,
+                apr_off_t *pos,
+                const patch_data_t *data,
                 svn_boolean_t ignore_whitespace,
                 apr_pool_t *result_pool,
                 apr_pool_t *scratch_pool)
@@ -1052,7 +1365,7 @@ parse_next_hunk(svn_diff_hunk_t **hunk,
   static const char * const prop_atat = "##";
   svn_stringbuf_t *line;
   svn_boolean_t eof, in_hunk, hunk_seen;
-  apr_off_t pos, last_line;
+  apr_off_t last_line;
   apr_off_t start, end;
   apr_off_t original_end;
   apr_off_t modified_end;
@@ -1077,7 +1390,7 @@ parse_next_hunk(svn_diff_hunk_t **hunk,
   *prop_name = NULL;
   *is_property = FALSE;
 
-  if (apr_file_eof(apr_file) == APR_EOF)
+  if (*pos >= data->size)
     {
       /* No more hunks here. */
       *hunk = NULL;
@@ -1093,9 +1406,6 @@ parse_next_hunk(svn_diff_hunk_t **hunk,
   modified_end = 0;
   *hunk = apr_pcalloc(result_pool, sizeof(**hunk));
 
-  /* Get current seek position. */
-  SVN_ERR(svn_io_file_get_offset(&pos, apr_file, scratch_pool));
-
   /* Start out assuming noise. */
   last_line_type = noise_line;
 
@@ -1105,13 +1415,11 @@ parse_next_hunk(svn_diff_hunk_t **hunk,
 
       svn_pool_clear(iterpool);
 
-      /* Remember the current line's offset, and read the line. */
-      last_line = pos;
-      SVN_ERR(svn_io_file_readline(apr_file, &line, NULL, &eof, APR_SIZE_MAX,
-                                   iterpool, iterpool));
-
-      /* Update line offset for next iteration. */
-      SVN_ERR(svn_io_file_get_offset(&pos, apr_file, iterpool));
+      /* Remember the current line's offset, and read the line.
+       * This also updates *POS for the next iteration. */
+      last_line = *pos;
+      SVN_ERR(read_line(&line, NULL, &eof, pos, data, APR_SIZE_MAX,
+                        iterpool, iterpool));
 
       /* Lines starting with a backslash indicate a missing EOL:
        * "\ No newline at end of file" or "end of property". */
@@ -1120,18 +1428,27 @@ parse_next_hunk(svn_diff_hunk_t **hunk,
           if (in_hunk)
             {
               char eolbuf[2];
-              apr_size_t len;
-              apr_off_t off;
               apr_off_t hunk_text_end;
 
               /* Comment terminates the hunk text and says the hunk text
                * has no trailing EOL. Snip off trailing EOL which is part
                * of the patch file but not part of the hunk text. */
-              off = last_line - 2;
-              SVN_ERR(svn_io_file_seek(apr_file, APR_SET, &off, iterpool));
-              len = sizeof(eolbuf);
-              SVN_ERR(svn_io_file_read_full2(apr_file, eolbuf, len, &len,
-                                             &eof, iterpool));
+              if (data->mapped)
+                {
+                  memcpy(eolbuf, data->mapped + last_line - 2,
+                         sizeof(eolbuf));
+                }
+              else
+                {
+                  apr_size_t len = sizeof(eolbuf);
+                  apr_off_t off = last_line - 2;
+
+                  SVN_ERR(svn_io_file_seek(data->file, APR_SET, &off,
+                                           iterpool));
+                  SVN_ERR(svn_io_file_read_full2(data->file, eolbuf, len,
+                                                 &len, NULL, iterpool));
+                }
+
               if (eolbuf[0] == '\r' && eolbuf[1] == '\n')
                 hunk_text_end = last_line - 2;
               else if (eolbuf[1] == '\n' || eolbuf[1] == '\r')
@@ -1151,7 +1468,6 @@ parse_next_hunk(svn_diff_hunk_t **hunk,
                     modified_end = hunk_text_end;
                 }
 
-              SVN_ERR(svn_io_file_seek(apr_file, APR_SET, &pos, iterpool));
               /* Set for the type and context by using != the other type */
               if (last_line_type != modified_line)
                 original_no_final_eol = TRUE;
@@ -1270,7 +1586,7 @@ parse_next_hunk(svn_diff_hunk_t **hunk,
               if (eof)
                 {
                   /* The hunk ends at EOF. */
-                  end = pos;
+                  end = *pos;
                 }
               else
                 {
@@ -1350,7 +1666,7 @@ parse_next_hunk(svn_diff_hunk_t **hunk,
     /* Rewind to the start of the line just read, so subsequent calls
      * to this function or svn_diff_parse_next_patch() don't end
      * up skipping the line -- it may contain a patch or hunk header. */
-    SVN_ERR(svn_io_file_seek(apr_file, APR_SET, &last_line, scratch_pool));
+    *pos = last_line;
 
   if (hunk_seen && start < end)
     {
@@ -1370,7 +1686,7 @@ parse_next_hunk(svn_diff_hunk_t **hunk,
         }
 
       (*hunk)->patch = patch;
-      (*hunk)->apr_file = apr_file;
+      (*hunk)->data = data;
       (*hunk)->leading_context = leading_context;
       (*hunk)->trailing_context = trailing_context;
       (*hunk)->diff_text_range.start = start;
@@ -1909,8 +2225,8 @@ add_property_hunk(svn_patch_t *patch, const char *prop_name,
 
 struct svn_patch_file_t
 {
-  /* The APR file handle to the patch file. */
-  apr_file_t *apr_file;
+  /* The contents of the patch file. */
+  patch_data_t data;
 
   /* The file offset at which the next patch is expected. */
   apr_off_t next_patch_offset;
@@ -1922,25 +2238,43 @@ svn_diff_open_patch_file(svn_patch_file_t **patch_file,
                          apr_pool_t *result_pool)
 {
   svn_patch_file_t *p;
+  svn_filesize_t size;
 
-  p = apr_palloc(result_pool, sizeof(*p));
-  SVN_ERR(svn_io_file_open(&p->apr_file, local_abspath,
+  p = apr_pcalloc(result_pool, sizeof(*p));
+  SVN_ERR(svn_io_file_open(&p->data.file, local_abspath,
                            APR_READ | APR_BUFFERED, APR_OS_DEFAULT,
                            result_pool));
+  SVN_ERR(svn_io_file_size_get(&size, p->data.file, result_pool));
+  p->data.size = size;
+
+#if APR_HAS_MMAP
+  /* Parsing reads the patch line by line and the hunks jump back into it
+   * later, so take lines directly from memory where we can.  On failure,
+   * just fall back to reading the file. */
+  if (p->data.size > APR_MMAP_THRESHOLD && p->data.size <= APR_SIZE_MAX
+      && apr_mmap_create(&p->data.mm, p->data.file, 0,
+                         (apr_size_t) p->data.size, APR_MMAP_READ,
+                         result_pool) == APR_SUCCESS)
+    p->data.mapped = p->data.mm->mm;
+  else
+    p->data.mm = NULL;
+#endif
+
   p->next_patch_offset = 0;
   *patch_file = p;
 
   return SVN_NO_ERROR;
 }
 
-/* Parse hunks from APR_FILE and store them in PATCH->HUNKS.
+/* Parse hunks from DATA, starting at offset *POS, and store them in
+ * PATCH->HUNKS.  Set *POS to the offset where parsing should continue.
  * Parsing stops if no valid next hunk can be found.
  * If IGNORE_WHITESPACE is TRUE, lines without
  * leading spaces will be treated as context lines.
  * Allocate results in RESULT_POOL.
  * Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
-parse_hunks(svn_patch_t *patch, apr_file_t *apr_file,
+parse_hunks(svn_patch_t *patch, apr_off_t *pos, const patch_data_t *data,
             svn_boolean_t ignore_whitespace,
             apr_pool_t *result_pool, apr_pool_t *scratch_pool)
 {
@@ -1961,8 +2295,8 @@ parse_hunks(svn_patch_t *patch, apr_file_t *apr_file,
       svn_pool_clear(iterpool);
 
       SVN_ERR(parse_next_hunk(&hunk, &is_property, &prop_name, &prop_operation,
-                              patch, apr_file, ignore_whitespace, result_pool,
-                              iterpool));
+                              patch, pos, data, ignore_whitespace,
+                              result_pool, iterpool));
 
       if (hunk && is_property)
         {
@@ -1993,33 +2327,32 @@ parse_hunks(svn_patch_t *patch, apr_file_t *apr_file,
   return SVN_NO_ERROR;
 }
 
+/* Parse a git binary patch from DATA, starting at offset *POS, and store
+ * it in PATCH->BINARY_PATCH.  Set *POS to the offset where parsing should
+ * continue. */
 static svn_error_t *
-parse_binary_patch(svn_patch_t *patch, apr_file_t *apr_file,
-                   svn_boolean_t reverse,
+parse_binary_patch(svn_patch_t *patch, apr_off_t *pos,
+                   const patch_data_t *data, svn_boolean_t reverse,
                    apr_pool_t *result_pool, apr_pool_t *scratch_pool)
 {
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  apr_off_t pos, last_line;
+  apr_off_t last_line;
   svn_stringbuf_t *line;
   svn_boolean_t eof = FALSE;
   svn_diff_binary_patch_t *bpatch = apr_pcalloc(result_pool, sizeof(*bpatch));
   svn_boolean_t in_blob = FALSE;
   svn_boolean_t in_src = FALSE;
 
-  bpatch->apr_file = apr_file;
+  bpatch->data = data;
 
   patch->prop_patches = apr_hash_make(result_pool);
 
-  SVN_ERR(svn_io_file_get_offset(&pos, apr_file, scratch_pool));
-
   while (!eof)
     {
-      last_line = pos;
-      SVN_ERR(svn_io_file_readline(apr_file, &line, NULL, &eof, APR_SIZE_MAX,
-                               iterpool, iterpool));
-
-      /* Update line offset for next iteration. */
-      SVN_ERR(svn_io_file_get_offset(&pos, apr_file, iterpool));
+      /* This also updates *POS for the next iteration. */
+      last_line = *pos;
+      SVN_ERR(read_line(&line, NULL, &eof, pos, data, APR_SIZE_MAX,
+                        iterpool, iterpool));
 
       if (in_blob)
         {
@@ -2033,9 +2366,9 @@ parse_binary_patch(svn_patch_t *patch, apr_file_t *apr_file,
             {
               /* One more blop line */
               if (in_src)
-                bpatch->src_end = pos;
+                bpatch->src_end = *pos;
               else
-                bpatch->dst_end = pos;
+                bpatch->dst_end = *pos;
             }
           else if (svn_stringbuf_first_non_whitespace(line) < line->len
                    && !(in_src && bpatch->src_start < last_line))
@@ -2053,11 +2386,15 @@ parse_binary_patch(svn_patch_t *patch, apr_file_t *apr_file,
               in_src = TRUE;
             }
         }
-      else if (starts_with(line->data, "literal "))
+      else if (starts_with(line->data, "literal ")
+               || starts_with(line->data, "delta "))
         {
+          svn_boolean_t is_delta = (line->data[0] == 'd');
+          const char *size_str = line->data
+                                 + (is_delta ? STRLEN_LITERAL("delta ")
+                                             : STRLEN_LITERAL("literal "));
           apr_uint64_t expanded_size;
-          svn_error_t *err = svn_cstring_strtoui64(&expanded_size,
-                                                   &line->data[8],
+          svn_error_t *err = svn_cstring_strtoui64(&expanded_size, size_str,
                                                    0, APR_UINT64_MAX, 10);
 
           if (err)
@@ -2068,45 +2405,55 @@ parse_binary_patch(svn_patch_t *patch, apr_file_t *apr_file,
 
           if (in_src)
             {
-              bpatch->src_start = pos;
+              bpatch->src_start = *pos;
               bpatch->src_filesize = expanded_size;
+              bpatch->src_is_delta = is_delta;
             }
           else
             {
-              bpatch->dst_start = pos;
+              bpatch->dst_start = *pos;
               bpatch->dst_filesize = expanded_size;
+              bpatch->dst_is_delta = is_delta;
             }
           in_blob = TRUE;
         }
       else
-        break; /* We don't support GIT deltas (yet) */
+        break; /* Bad patch */
     }
   svn_pool_destroy(iterpool);
 
   if (!eof)
     /* Rewind to the start of the line just read, so subsequent calls
      * don't end up skipping the line. It may contain a patch or hunk header.*/
-    SVN_ERR(svn_io_file_seek(apr_file, APR_SET, &last_line, scratch_pool));
+    *pos = last_line;
   else if (in_src
            && ((bpatch->src_end > bpatch->src_start) || !bpatch->src_filesize))
     {
       patch->binary_patch = bpatch; /* SUCCESS */
     }
 
+  /* We can only reconstruct both sides if at most one of them is a delta
+     against the other.  ### Use the patch target as base for the other? */
+  if (patch->binary_patch && bpatch->src_is_delta && bpatch->dst_is_delta)
+    patch->binary_patch = NULL;
+
   /* Reverse patch if requested */
   if (reverse && patch->binary_patch)
     {
       apr_off_t tmp_start = bpatch->src_start;
       apr_off_t tmp_end = bpatch->src_end;
       svn_filesize_t tmp_filesize = bpatch->src_filesize;
+      svn_boolean_t tmp_is_delta = bpatch->src_is_delta;
 
       bpatch->src_start = bpatch->dst_start;
       bpatch->src_end = bpatch->dst_end;
       bpatch->src_filesize = bpatch->dst_filesize;
+      bpatch->src_is_delta = bpatch->dst_is_delta;
 
       bpatch->dst_start = tmp_start;
       bpatch->dst_end = tmp_end;
       bpatch->dst_filesize = tmp_filesize;
+      bpatch->dst_is_delta = tmp_is_delta;
     }
 
   return SVN_NO_ERROR;
@@ -2167,7 +2514,7 @@ svn_diff_parse_next_patch(svn_patch_t **patch_p,
   svn_patch_t *patch;
   enum parse_state state = state_start;
 
-  if (apr_file_eof(patch_file->apr_file) == APR_EOF)
+  if (patch_file->next_patch_offset >= patch_file->data.size)
     {
       /* No more patches here. */
       *patch_p = NULL;
@@ -2181,7 +2528,6 @@ svn_diff_parse_next_patch(svn_patch_t **patch_p,
   patch->new_symlink_bit = svn_tristate_unknown;
 
   pos = patch_file->next_patch_offset;
-  SVN_ERR(svn_io_file_seek(patch_file->apr_file, APR_SET, &pos, scratch_pool));
 
   iterpool = svn_pool_create(scratch_pool);
   do
@@ -2192,17 +2538,11 @@ svn_diff_parse_next_patch(svn_patch_t **patch_p,
 
       svn_pool_clear(iterpool);
 
-      /* Remember the current line's offset, and read the line. */
+      /* Remember the current line's offset, and read the line.
+       * This also updates POS for the next iteration. */
       last_line = pos;
-      SVN_ERR(svn_io_file_readline(patch_file->apr_file, &line, NULL, &eof,
-                                   APR_SIZE_MAX, iterpool, iterpool));
-
-      if (! eof)
-        {
-          /* Update line offset for next iteration. */
-          SVN_ERR(svn_io_file_get_offset(&pos, patch_file->apr_file,
-                                         iterpool));
-        }
+      SVN_ERR(read_line(&line, NULL, &eof, &pos, &patch_file->data,
+                        APR_SIZE_MAX, iterpool, iterpool));
 
       /* Run the state machine. */
       for (i = 0; i < (sizeof(transitions) / sizeof(transitions[0])); i++)
@@ -2232,8 +2572,7 @@ svn_diff_parse_next_patch(svn_patch_t **patch_p,
            * Rewind to the start of the line just read, so subsequent calls
            * to this function don't end up skipping the line -- it may
            * contain a patch. */
-          SVN_ERR(svn_io_file_seek(patch_file->apr_file, APR_SET, &last_line,
-                                   scratch_pool));
+          pos = last_line;
           break;
         }
       else if (state == state_git_tree_seen
@@ -2248,8 +2587,7 @@ svn_diff_parse_next_patch(svn_patch_t **patch_p,
            *
            * Rewind to the start of the line just read - it may be a new
            * header that begins there. */
-          SVN_ERR(svn_io_file_seek(patch_file->apr_file, APR_SET, &last_line,
-                                   scratch_pool));
+          pos = last_line;
           state = state_start;
         }
 
@@ -2303,19 +2641,18 @@ svn_diff_parse_next_patch(svn_patch_t **patch_p,
     {
       if (state == state_binary_patch_found)
         {
-          SVN_ERR(parse_binary_patch(patch, patch_file->apr_file, reverse,
-                                     result_pool, iterpool));
+          SVN_ERR(parse_binary_patch(patch, &pos, &patch_file->data,
+                                     reverse, result_pool, iterpool));
           /* And fall through in property parsing */
         }
 
-      SVN_ERR(parse_hunks(patch, patch_file->apr_file, ignore_whitespace,
+      SVN_ERR(parse_hunks(patch, &pos, &patch_file->data, ignore_whitespace,
                           result_pool, iterpool));
     }
 
   svn_pool_destroy(iterpool);
 
-  SVN_ERR(svn_io_file_get_offset(&patch_file->next_patch_offset,
-                                 patch_file->apr_file, scratch_pool));
+  patch_file->next_patch_offset = pos;
 
   if (patch && patch->hunks)
     {
@@ -2334,6 +2671,18 @@ svn_error_t *
 svn_diff_close_patch_file(svn_patch_file_t *patch_file,
                           apr_pool_t *scratch_pool)
 {
-  return svn_error_trace(svn_io_file_close(patch_file->apr_file,
+#if APR_HAS_MMAP
+  if (patch_file->data.mm)
+    {
+      apr_status_t status = apr_mmap_delete(patch_file->data.mm);
+
+      patch_file->data.mm = NULL;
+      patch_file->data.mapped = NULL;
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unmap patch file"));
+    }
+#endif
+
+  return svn_error_trace(svn_io_file_close(patch_file->data.file,
                                            scratch_pool));
 }
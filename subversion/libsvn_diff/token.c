@@ -22,6 +22,8 @@
  */
 
 
+#include <string.h>
+
 #include <apr.h>
 #include <apr_pools.h>
 #include <apr_general.h>
@@ -34,25 +36,39 @@
 
 
 /*
- * Prime number to use as the size of the hash table.  This number was
- * not selected by testing of any kind and may need tweaking.
+ * Initial number of slots in the token hash table.  Must be a power of 2.
+ * The table doubles whenever it gets half full.
  */
-#define SVN_DIFF__HASH_SIZE 127
+#define SVN_DIFF__HASH_INITIAL_BITS 10
 
-struct svn_diff__node_t
-{
-  svn_diff__node_t       *parent;
-  svn_diff__node_t       *left;
-  svn_diff__node_t       *right;
+/* Multiplier for Fibonacci hashing, i.e. 2^32 divided by the golden ratio.
+ * The datasource hashes are not necessarily well distributed in their low
+ * bits, so we use the high bits of the product to select a slot.
+ */
+#define SVN_DIFF__HASH_MULTIPLIER 0x9E3779B9
 
+/* A slot in the open-addressing token table. */
+typedef struct token_slot_t
+{
   apr_uint32_t            hash;
+
+  /* Index of the token in the tree's TOKENS array; -1 if unused. */
   svn_diff__token_index_t index;
-  void                   *token;
-};
+} token_slot_t;
 
 struct svn_diff__tree_t
 {
-  svn_diff__node_t       *root[SVN_DIFF__HASH_SIZE];
+  /* Hash table of distinct tokens, using linear probing.  It has
+   * 2^BITS entries. */
+  token_slot_t           *slots;
+  int                     bits;
+
+  /* The most recently read token for each token index.  The array has
+   * room for TOKENS_SIZE entries, the first NODE_COUNT of which are in
+   * use. */
+  void                  **tokens;
+  svn_diff__token_index_t tokens_size;
+
   apr_pool_t             *pool;
   svn_diff__token_index_t node_count;
 };
@@ -68,75 +84,129 @@ svn_diff__get_node_count(svn_diff__tree_t *tree)
 }
 
 /*
- * Support functions to build a tree of token positions
+ * Support functions to build the table of distinct tokens
  */
 
+/* Return the first slot to probe for HASH in a table of 2^BITS slots. */
+static APR_INLINE apr_size_t
+slot_of(apr_uint32_t hash, int bits)
+{
+  return (apr_uint32_t)(hash * SVN_DIFF__HASH_MULTIPLIER) >> (32 - bits);
+}
+
+/* Allocate 2^BITS empty slots for TREE. */
+static void
+alloc_slots(svn_diff__tree_t *tree, int bits)
+{
+  apr_size_t count = (apr_size_t)1 << bits;
+  apr_size_t i;
+
+  tree->slots = apr_palloc(tree->pool, count * sizeof(*tree->slots));
+  tree->bits = bits;
+  for (i = 0; i < count; i++)
+    tree->slots[i].index = -1;
+}
+
+/* Double the number of slots in TREE.  Since we keep the hash values in
+ * the slots, no token comparison is necessary.
+ */
+static void
+grow_slots(svn_diff__tree_t *tree)
+{
+  token_slot_t *old_slots = tree->slots;
+  apr_size_t old_count = (apr_size_t)1 << tree->bits;
+  apr_size_t mask;
+  apr_size_t i;
+
+  alloc_slots(tree, tree->bits + 1);
+  mask = ((apr_size_t)1 << tree->bits) - 1;
+
+  for (i = 0; i < old_count; i++)
+    if (old_slots[i].index >= 0)
+      {
+        apr_size_t slot = slot_of(old_slots[i].hash, tree->bits);
+
+        while (tree->slots[slot].index >= 0)
+          slot = (slot + 1) & mask;
+
+        tree->slots[slot] = old_slots[i];
+      }
+}
+
 void
 svn_diff__tree_create(svn_diff__tree_t **tree, apr_pool_t *pool)
 {
   *tree = apr_pcalloc(pool, sizeof(**tree));
   (*tree)->pool = pool;
   (*tree)->node_count = 0;
+
+  alloc_slots(*tree, SVN_DIFF__HASH_INITIAL_BITS);
+  (*tree)->tokens_size = (svn_diff__token_index_t)1
+                         << (SVN_DIFF__HASH_INITIAL_BITS - 1);
+  (*tree)->tokens = apr_palloc(pool, (*tree)->tokens_size
+                                     * sizeof(*(*tree)->tokens));
 }
 
 
+/* Look up TOKEN with hash value HASH in TREE and return its index in
+ * *INDEX.  Add it to TREE as a new distinct token, if it was not found.
+ */
 static svn_error_t *
-tree_insert_token(svn_diff__node_t **node, svn_diff__tree_t *tree,
+tree_insert_token(svn_diff__token_index_t *index, svn_diff__tree_t *tree,
                   void *diff_baton,
                   const svn_diff_fns2_t *vtable,
                   apr_uint32_t hash, void *token)
 {
-  svn_diff__node_t *new_node;
-  svn_diff__node_t **node_ref;
-  svn_diff__node_t *parent;
+  apr_size_t mask = ((apr_size_t)1 << tree->bits) - 1;
+  apr_size_t slot;
   int rv;
 
   SVN_ERR_ASSERT(token);
 
-  parent = NULL;
-  node_ref = &tree->root[hash % SVN_DIFF__HASH_SIZE];
-
-  while (*node_ref != NULL)
+  for (slot = slot_of(hash, tree->bits);
+       tree->slots[slot].index >= 0;
+       slot = (slot + 1) & mask)
     {
-      parent = *node_ref;
+      svn_diff__token_index_t candidate = tree->slots[slot].index;
 
-      rv = hash - parent->hash;
-      if (!rv)
-        SVN_ERR(vtable->token_compare(diff_baton, parent->token, token, &rv));
+      if (tree->slots[slot].hash != hash)
+        continue;
 
+      SVN_ERR(vtable->token_compare(diff_baton, tree->tokens[candidate],
+                                    token, &rv));
       if (rv == 0)
         {
           /* Discard the previous token.  This helps in cases where
            * only recently read tokens are still in memory.
            */
           if (vtable->token_discard != NULL)
-            vtable->token_discard(diff_baton, parent->token);
+            vtable->token_discard(diff_baton, tree->tokens[candidate]);
 
-          parent->token = token;
-          *node = parent;
+          tree->tokens[candidate] = token;
+          *index = candidate;
 
           return SVN_NO_ERROR;
         }
-      else if (rv > 0)
-        {
-          node_ref = &parent->left;
-        }
-      else
-        {
-          node_ref = &parent->right;
-        }
     }
 
-  /* Create a new node */
-  new_node = apr_palloc(tree->pool, sizeof(*new_node));
-  new_node->parent = parent;
-  new_node->left = NULL;
-  new_node->right = NULL;
-  new_node->hash = hash;
-  new_node->token = token;
-  new_node->index = tree->node_count++;
+  /* A new distinct token */
+  if (tree->node_count == tree->tokens_size)
+    {
+      void **tokens = apr_palloc(tree->pool, 2 * tree->tokens_size
+                                             * sizeof(*tokens));
+      memcpy(tokens, tree->tokens, tree->tokens_size * sizeof(*tokens));
+      tree->tokens = tokens;
+      tree->tokens_size *= 2;
+    }
+
+  *index = tree->node_count++;
+  tree->tokens[*index] = token;
+  tree->slots[slot].hash = hash;
+  tree->slots[slot].index = *index;
 
-  *node = *node_ref = new_node;
+  /* Keep the load factor below 1/2. */
+  if ((apr_size_t)tree->node_count * 2 > mask)
+    grow_slots(tree);
 
   return SVN_NO_ERROR;
 }
@@ -158,7 +228,7 @@ svn_diff__get_tokens(svn_diff__position_t **position_list,
   svn_diff__position_t *start_position;
   svn_diff__position_t *position = NULL;
   svn_diff__position_t **position_ref;
-  svn_diff__node_t *node;
+  svn_diff__token_index_t token_index;
   void *token;
   apr_off_t offset;
   apr_uint32_t hash;
@@ -176,12 +246,13 @@ svn_diff__get_tokens(svn_diff__position_t **position_list,
         break;
 
       offset++;
-      SVN_ERR(tree_insert_token(&node, tree, diff_baton, vtable, hash, token));
+      SVN_ERR(tree_insert_token(&token_index, tree, diff_baton, vtable,
+                                hash, token));
 
       /* Create a new position */
       position = apr_palloc(pool, sizeof(*position));
       position->next = NULL;
-      position->token_index = node->index;
+      position->token_index = token_index;
       position->offset = offset;
 
       *position_ref = position;
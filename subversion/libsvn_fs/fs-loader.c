@@ -504,6 +504,7 @@ fs_new(apr_hash_t *fs_config, apr_pool_t *pool)
   fs->vtable = NULL;
   fs->fsap_data = NULL;
   fs->uuid = NULL;
+  fs->request_id = NULL;
   return fs;
 }
 
@@ -521,6 +522,13 @@ svn_fs_set_warning_func(svn_fs_t *fs, svn_fs_warning_callback_t warning,
   fs->warning_baton = warning_baton;
 }
 
+void
+svn_fs__set_request_id(svn_fs_t *fs,
+                       const char *request_id)
+{
+  fs->request_id = request_id;
+}
+
 svn_error_t *
 svn_fs_create2(svn_fs_t **fs_p,
                const char *path,
@@ -645,8 +653,9 @@ svn_fs_delete_fs(const char *path, apr_pool_t *pool)
 }
 
 svn_error_t *
-svn_fs_hotcopy3(const char *src_path, const char *dst_path,
+svn_fs_hotcopy4(const char *src_path, const char *dst_path,
                 svn_boolean_t clean, svn_boolean_t incremental,
+                apr_hash_t *fs_config,
                 svn_fs_hotcopy_notify_t notify_func,
                 void *notify_baton,
                 svn_cancel_func_t cancel_func,
@@ -666,8 +675,8 @@ svn_fs_hotcopy3(const char *src_path, const char *dst_path,
 
   SVN_ERR(svn_fs_type(&src_fs_type, src_path, scratch_pool));
   SVN_ERR(get_library_vtable(&vtable, src_fs_type, scratch_pool));
-  src_fs = fs_new(NULL, scratch_pool);
-  dst_fs = fs_new(NULL, scratch_pool);
+  src_fs = fs_new(fs_config, scratch_pool);
+  dst_fs = fs_new(fs_config, scratch_pool);
 
   SVN_ERR(svn_io_check_path(dst_path, &dst_kind, scratch_pool));
   if (dst_kind == svn_node_file)
@@ -710,18 +719,19 @@ svn_fs_hotcopy3(const char *src_path, const char *dst_path,
 }
 
 svn_error_t *
-svn_fs_pack(const char *path,
-            svn_fs_pack_notify_t notify_func,
-            void *notify_baton,
-            svn_cancel_func_t cancel_func,
-            void *cancel_baton,
-            apr_pool_t *pool)
+svn_fs_pack2(const char *path,
+             apr_hash_t *fs_config,
+             svn_fs_pack_notify_t notify_func,
+             void *notify_baton,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool)
 {
   fs_library_vtable_t *vtable;
   svn_fs_t *fs;
 
   SVN_ERR(fs_library_vtable(&vtable, path, pool));
-  fs = fs_new(NULL, pool);
+  fs = fs_new(fs_config, pool);
 
   SVN_ERR(vtable->pack_fs(fs, path, notify_func, notify_baton,
                           cancel_func, cancel_baton, common_pool_lock,
@@ -767,6 +777,16 @@ svn_fs_freeze(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_sync(svn_fs_t *fs,
+            apr_pool_t *scratch_pool)
+{
+  if (fs->vtable->sync)
+    SVN_ERR(fs->vtable->sync(fs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 
 /* --- Berkeley-specific functions --- */
 
@@ -816,8 +836,8 @@ svn_error_t *
 svn_fs_hotcopy_berkeley(const char *src_path, const char *dest_path,
                         svn_boolean_t clean_logs, apr_pool_t *pool)
 {
-  return svn_error_trace(svn_fs_hotcopy3(src_path, dest_path, clean_logs,
-                                         FALSE, NULL, NULL, NULL, NULL,
+  return svn_error_trace(svn_fs_hotcopy4(src_path, dest_path, clean_logs,
+                                         FALSE, NULL, NULL, NULL, NULL, NULL,
                                          pool));
 }
 
@@ -1216,6 +1236,32 @@ svn_fs_paths_changed3(svn_fs_path_change_iterator_t **iterator,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_revisions_changed(apr_array_header_t **revisions,
+                         svn_fs_t *fs,
+                         const char *path,
+                         svn_revnum_t start,
+                         svn_revnum_t end,
+                         int limit,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  if (start > end)
+    {
+      svn_revnum_t tmp = start;
+      start = end;
+      end = tmp;
+    }
+
+  *revisions = NULL;
+  if (fs->vtable->revisions_changed)
+    SVN_ERR(fs->vtable->revisions_changed(revisions, fs, path, start, end,
+                                          limit, result_pool,
+                                          scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_check_path(svn_node_kind_t *kind_p, svn_fs_root_t *root,
                   const char *path, apr_pool_t *pool)
@@ -1223,6 +1269,40 @@ svn_fs_check_path(svn_node_kind_t *kind_p, svn_fs_root_t *root,
   return svn_error_trace(root->vtable->check_path(kind_p, root, path, pool));
 }
 
+svn_error_t *
+svn_fs_check_paths(apr_array_header_t **kinds,
+                   svn_fs_root_t *root,
+                   const apr_array_header_t *paths,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  int i;
+
+  if (root->vtable->check_paths)
+    return svn_error_trace(root->vtable->check_paths(kinds, root, paths,
+                                                     result_pool,
+                                                     scratch_pool));
+
+  /* The backend can't do better than checking one path after another. */
+  *kinds = apr_array_make(result_pool, paths->nelts,
+                          sizeof(svn_node_kind_t));
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      const char *path = APR_ARRAY_IDX(paths, i, const char *);
+      svn_node_kind_t kind;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(root->vtable->check_path(&kind, root, path, iterpool));
+      APR_ARRAY_PUSH(*kinds, svn_node_kind_t) = kind;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_node_history2(svn_fs_history_t **history_p, svn_fs_root_t *root,
                      const char *path, apr_pool_t *result_pool,
@@ -1564,6 +1644,27 @@ svn_fs_try_process_file_contents(svn_boolean_t *success,
                          processor, baton, pool));
 }
 
+svn_error_t *
+svn_fs__try_get_contents_regions(apr_file_t **file,
+                                 apr_array_header_t **regions,
+                                 svn_fs_root_t *root,
+                                 const char *path,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool)
+{
+  /* if the FS doesn't implement this function, report a "failed" attempt */
+  if (root->vtable->try_get_contents_regions == NULL)
+    {
+      *file = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(root->vtable->try_get_contents_regions(
+                         file, regions,
+                         root, path,
+                         result_pool, scratch_pool));
+}
+
 svn_error_t *
 svn_fs_make_file(svn_fs_root_t *root, const char *path, apr_pool_t *pool)
 {
@@ -266,6 +266,17 @@ typedef struct fs_vtable_t
   svn_error_t *(*bdb_set_errcall)(svn_fs_t *fs,
                                   void (*handler)(const char *errpfx,
                                                   char *msg));
+  /* May be NULL if the backend has no index for this query. */
+  svn_error_t *(*revisions_changed)(apr_array_header_t **revisions,
+                                    svn_fs_t *fs,
+                                    const char *path,
+                                    svn_revnum_t start,
+                                    svn_revnum_t end,
+                                    int limit,
+                                    apr_pool_t *result_pool,
+                                    apr_pool_t *scratch_pool);
+  /* May be NULL if the backend does not defer any writes. */
+  svn_error_t *(*sync)(svn_fs_t *fs, apr_pool_t *scratch_pool);
 } fs_vtable_t;
 
 
@@ -309,6 +320,12 @@ typedef struct root_vtable_t
   /* Generic node operations */
   svn_error_t *(*check_path)(svn_node_kind_t *kind_p, svn_fs_root_t *root,
                              const char *path, apr_pool_t *pool);
+  /* May be NULL, in which case check_path gets called for each path. */
+  svn_error_t *(*check_paths)(apr_array_header_t **kinds,
+                              svn_fs_root_t *root,
+                              const apr_array_header_t *paths,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
   svn_error_t *(*node_history)(svn_fs_history_t **history_p,
                                svn_fs_root_t *root, const char *path,
                                apr_pool_t *result_pool,
@@ -387,6 +404,12 @@ typedef struct root_vtable_t
                                             svn_fs_process_contents_func_t processor,
                                             void* baton,
                                             apr_pool_t *pool);
+  svn_error_t *(*try_get_contents_regions)(apr_file_t **file,
+                                           apr_array_header_t **regions,
+                                           svn_fs_root_t *root,
+                                           const char *path,
+                                           apr_pool_t *result_pool,
+                                           apr_pool_t *scratch_pool);
   svn_error_t *(*make_file)(svn_fs_root_t *root, const char *path,
                             apr_pool_t *pool);
   svn_error_t *(*apply_textdelta)(svn_txdelta_window_handler_t *contents_p,
@@ -490,6 +513,10 @@ struct svn_fs_t
 
   /* UUID, stored by open(), create(), and set_uuid(). */
   const char *uuid;
+
+  /* ID of the client request currently being served, for tracing.
+     NULL if unknown.  See svn_fs__set_request_id(). */
+  const char *request_id;
 };
 
 
@@ -21,9 +21,11 @@
  */
 
 #include <assert.h>
+#include <string.h>
 
 #include "svn_fs.h"
 #include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "fs.h"
 #include "err.h"
@@ -618,6 +620,9 @@ svn_fs_base__delete_rep_if_mutable(svn_fs_t *fs,
 
 /** Reading. **/
 
+/* Size of the read-ahead buffer of rep_read_baton. */
+#define READ_AHEAD_SIZE (256 * 1024)
+
 struct rep_read_baton
 {
   /* The FS from which we're reading. */
@@ -673,6 +678,20 @@ struct rep_read_baton
      is digestified. */
   svn_boolean_t checksum_finalized;
 
+  /* The checksums recorded in the rep, to be compared with the ones
+     we calculate.  Retrieved when the baton is created, so that the
+     final comparison does not need another trail.  May be NULL. */
+  svn_checksum_t *rep_md5_checksum;
+  svn_checksum_t *rep_sha1_checksum;
+
+  /* Read-ahead buffer of BUFFER_SIZE bytes, holding BUFFER_LEN bytes of
+     data starting at BUFFER_OFFSET.  BUFFER is NULL if BUFFER_SIZE is 0.
+   */
+  char *buffer;
+  apr_size_t buffer_size;
+  apr_size_t buffer_len;
+  svn_filesize_t buffer_offset;
+
   /* Used for temporary allocations.  This pool is cleared at the
      start of each invocation of the relevant stream read function --
      see rep_read_contents().  */
@@ -696,11 +715,23 @@ rep_read_get_baton(struct rep_read_baton **rb_p,
   b->sha1_checksum_ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
 
   if (rep_key)
-    SVN_ERR(svn_fs_base__rep_contents_size(&(b->size), fs, rep_key,
-                                           trail, pool));
+    {
+      SVN_ERR(svn_fs_base__rep_contents_size(&(b->size), fs, rep_key,
+                                             trail, pool));
+      SVN_ERR(svn_fs_base__rep_contents_checksums(&b->rep_md5_checksum,
+                                                  &b->rep_sha1_checksum,
+                                                  fs, rep_key, trail,
+                                                  pool));
+    }
   else
     b->size = 0;
 
+  /* Don't allocate more than the whole contents for small reps. */
+  b->buffer_size = (apr_size_t)MIN(b->size, READ_AHEAD_SIZE);
+  b->buffer = b->buffer_size ? apr_palloc(pool, b->buffer_size) : NULL;
+  b->buffer_len = 0;
+  b->buffer_offset = 0;
+
   b->checksum_finalized = FALSE;
   b->fs = fs;
   b->trail = use_trail_for_reads ? trail : NULL;
@@ -838,148 +869,210 @@ svn_fs_base__rep_contents(svn_string_t *str,
 struct read_rep_args
 {
   struct rep_read_baton *rb;   /* The data source.             */
+  svn_filesize_t offset;       /* Where to start reading.      */
   char *buf;                   /* Where to put what we read.   */
-  apr_size_t *len;             /* How much to read / was read. */
+  apr_size_t requested;        /* How much to read.            */
+  apr_size_t *len;             /* How much was read.           */
 };
 
 
 /* BATON is of type `read_rep_args':
 
-   Read into BATON->rb->buf the *(BATON->len) bytes starting at
-   BATON->rb->offset from the data represented at BATON->rb->rep_key
+   Read into BATON->buf the BATON->requested bytes starting at
+   BATON->offset from the data represented at BATON->rb->rep_key
    in BATON->rb->fs, as part of TRAIL.
 
-   Afterwards, *(BATON->len) is the number of bytes actually read, and
-   BATON->rb->offset is incremented by that amount.
-
-   If BATON->rb->rep_key is null, this is assumed to mean the file's
-   contents have no representation, i.e., the file has no contents.
-   In that case, if BATON->rb->offset > 0, return the error
-   SVN_ERR_FS_FILE_CONTENTS_CHANGED, else just set *(BATON->len) to
-   zero and return.  */
+   Afterwards, *(BATON->len) is the number of bytes actually read.
+   Nothing else in BATON gets modified, so this may be retried. */
 static svn_error_t *
 txn_body_read_rep(void *baton, trail_t *trail)
 {
   struct read_rep_args *args = baton;
 
-  if (args->rb->rep_key)
-    {
-      SVN_ERR(rep_read_range(args->rb->fs,
-                             args->rb->rep_key,
-                             args->rb->offset,
-                             args->buf,
-                             args->len,
-                             trail,
-                             args->rb->scratch_pool));
-
-      args->rb->offset += *(args->len);
-
-      /* We calculate the checksum just once, the moment we see the
-       * last byte of data.  But we can't assume there was a short
-       * read.  The caller may have known the length of the data and
-       * requested exactly that amount, so there would never be a
-       * short read.  (That's why the read baton has to know the
-       * length of the data in advance.)
-       *
-       * On the other hand, some callers invoke the stream reader in a
-       * loop whose termination condition is that the read returned
-       * zero bytes of data -- which usually results in the read
-       * function being called one more time *after* the call that got
-       * a short read (indicating end-of-stream).
-       *
-       * The conditions below ensure that we compare checksums even
-       * when there is no short read associated with the last byte of
-       * data, while also ensuring that it's harmless to repeatedly
-       * read 0 bytes from the stream.
-       */
-      if (! args->rb->checksum_finalized)
-        {
-          SVN_ERR(svn_checksum_update(args->rb->md5_checksum_ctx, args->buf,
-                                      *(args->len)));
-          SVN_ERR(svn_checksum_update(args->rb->sha1_checksum_ctx, args->buf,
-                                      *(args->len)));
+  *(args->len) = args->requested;
+  return svn_error_trace(rep_read_range(args->rb->fs,
+                                        args->rb->rep_key,
+                                        args->offset,
+                                        args->buf,
+                                        args->len,
+                                        trail,
+                                        args->rb->scratch_pool));
+}
 
-          if (args->rb->offset == args->rb->size)
-            {
-              representation_t *rep;
-
-              SVN_ERR(svn_checksum_final(&args->rb->md5_checksum,
-                                         args->rb->md5_checksum_ctx,
-                                         trail->pool));
-              SVN_ERR(svn_checksum_final(&args->rb->sha1_checksum,
-                                         args->rb->sha1_checksum_ctx,
-                                         trail->pool));
-              args->rb->checksum_finalized = TRUE;
-
-              SVN_ERR(svn_fs_bdb__read_rep(&rep, args->rb->fs,
-                                           args->rb->rep_key,
-                                           trail, trail->pool));
-
-              if (rep->md5_checksum
-                  && (! svn_checksum_match(rep->md5_checksum,
-                                           args->rb->md5_checksum)))
-                return svn_error_create(SVN_ERR_FS_CORRUPT,
-                        svn_checksum_mismatch_err(rep->md5_checksum,
-                             args->rb->md5_checksum, trail->pool,
-                             _("MD5 checksum mismatch on representation '%s'"),
-                             args->rb->rep_key),
-                        NULL);
-
-              if (rep->sha1_checksum
-                  && (! svn_checksum_match(rep->sha1_checksum,
-                                           args->rb->sha1_checksum)))
-                return svn_error_createf(SVN_ERR_FS_CORRUPT,
-                        svn_checksum_mismatch_err(rep->sha1_checksum,
-                            args->rb->sha1_checksum, trail->pool,
-                            _("SHA1 checksum mismatch on representation '%s'"),
-                            args->rb->rep_key),
-                        NULL);
-            }
-        }
-    }
-  else if (args->rb->offset > 0)
-    {
-      return
-        svn_error_create
-        (SVN_ERR_FS_REP_CHANGED, NULL,
-         _("Null rep, but offset past zero already"));
-    }
-  else
-    *(args->len) = 0;
+
+/* Read into BUF up to *LEN bytes starting at OFFSET from the data
+   represented at RB->rep_key and set *LEN to the number of bytes
+   actually read.  Use RB's trail, if any.  */
+static svn_error_t *
+read_range(struct rep_read_baton *rb,
+           svn_filesize_t offset,
+           char *buf,
+           apr_size_t *len)
+{
+  struct read_rep_args args;
+
+  args.rb = rb;
+  args.offset = offset;
+  args.buf = buf;
+  args.requested = *len;
+  args.len = len;
+
+  /* If we got a trail, use it; else make one. */
+  if (rb->trail)
+    return svn_error_trace(txn_body_read_rep(&args, rb->trail));
+
+  /* In the case of reading from the db, any returned data should
+     live in our pre-allocated buffer, so the whole operation can
+     happen within a single malloc/free cycle.  This prevents us
+     from creating millions of unnecessary trail subpools when
+     reading a big file.
+
+     We only read committed data here, so there is no need for
+     a Berkeley DB transaction unless something goes wrong. */
+  return svn_error_trace(svn_fs_base__retry_read(rb->fs,
+                                                 txn_body_read_rep,
+                                                 &args,
+                                                 TRUE,
+                                                 rb->scratch_pool));
+}
+
+
+/* Update the checksums in RB with the LEN bytes in BUF, which have just
+   been read, and compare them with those recorded in the rep once we have
+   seen the last byte of data.
+
+   We calculate the checksum just once, the moment we see the last byte
+   of data.  But we can't assume there was a short read.  The caller may
+   have known the length of the data and requested exactly that amount,
+   so there would never be a short read.  (That's why the read baton has
+   to know the length of the data in advance.)
+
+   On the other hand, some callers invoke the stream reader in a loop
+   whose termination condition is that the read returned zero bytes of
+   data -- which usually results in the read function being called one
+   more time *after* the call that got a short read (indicating
+   end-of-stream).
+
+   The conditions below ensure that we compare checksums even when there
+   is no short read associated with the last byte of data, while also
+   ensuring that it's harmless to repeatedly read 0 bytes from the
+   stream.  */
+static svn_error_t *
+update_checksums(struct rep_read_baton *rb,
+                 const char *buf,
+                 apr_size_t len)
+{
+  if (rb->checksum_finalized)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_checksum_update(rb->md5_checksum_ctx, buf, len));
+  SVN_ERR(svn_checksum_update(rb->sha1_checksum_ctx, buf, len));
+
+  if (rb->offset != rb->size)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_checksum_final(&rb->md5_checksum, rb->md5_checksum_ctx,
+                             rb->scratch_pool));
+  SVN_ERR(svn_checksum_final(&rb->sha1_checksum, rb->sha1_checksum_ctx,
+                             rb->scratch_pool));
+  rb->checksum_finalized = TRUE;
+
+  if (rb->rep_md5_checksum
+      && (! svn_checksum_match(rb->rep_md5_checksum, rb->md5_checksum)))
+    return svn_error_create(SVN_ERR_FS_CORRUPT,
+            svn_checksum_mismatch_err(rb->rep_md5_checksum,
+                 rb->md5_checksum, rb->scratch_pool,
+                 _("MD5 checksum mismatch on representation '%s'"),
+                 rb->rep_key),
+            NULL);
+
+  if (rb->rep_sha1_checksum
+      && (! svn_checksum_match(rb->rep_sha1_checksum, rb->sha1_checksum)))
+    return svn_error_create(SVN_ERR_FS_CORRUPT,
+            svn_checksum_mismatch_err(rb->rep_sha1_checksum,
+                rb->sha1_checksum, rb->scratch_pool,
+                _("SHA1 checksum mismatch on representation '%s'"),
+                rb->rep_key),
+            NULL);
 
   return SVN_NO_ERROR;
 }
 
 
+/* Implements svn_read_fn_t.
+
+   Read *LEN bytes into BUF from the rep behind BATON, a rep_read_baton,
+   starting at BATON->offset, which gets incremented accordingly.
+   Set *LEN to the number of bytes actually read, which will be less
+   than requested only at the end of the data.
+
+   Locating an offset within a string means stepping through all
+   the string's records up to that offset, so small reads get served
+   from a read-ahead buffer filled by much larger ones.
+
+   If BATON->rep_key is null, this is assumed to mean the file's
+   contents have no representation, i.e., the file has no contents.
+   In that case, if BATON->offset > 0, return the error
+   SVN_ERR_FS_REP_CHANGED, else just set *LEN to zero and return.  */
 static svn_error_t *
 rep_read_contents(void *baton, char *buf, apr_size_t *len)
 {
   struct rep_read_baton *rb = baton;
-  struct read_rep_args args;
+  apr_size_t requested = *len;
+  apr_size_t total = 0;
 
   /* Clear the scratch pool of the results of previous invocations. */
   svn_pool_clear(rb->scratch_pool);
 
-  args.rb = rb;
-  args.buf = buf;
-  args.len = len;
+  if (! rb->rep_key)
+    {
+      if (rb->offset > 0)
+        return svn_error_create(SVN_ERR_FS_REP_CHANGED, NULL,
+                                _("Null rep, but offset past zero already"));
 
-  /* If we got a trail, use it; else make one. */
-  if (rb->trail)
-    SVN_ERR(txn_body_read_rep(&args, rb->trail));
-  else
+      *len = 0;
+      return SVN_NO_ERROR;
+    }
+
+  if (requested >= rb->buffer_size)
     {
-      /* In the case of reading from the db, any returned data should
-         live in our pre-allocated buffer, so the whole operation can
-         happen within a single malloc/free cycle.  This prevents us
-         from creating millions of unnecessary trail subpools when
-         reading a big file.  */
-      SVN_ERR(svn_fs_base__retry_txn(rb->fs,
-                                     txn_body_read_rep,
-                                     &args,
-                                     TRUE,
-                                     rb->scratch_pool));
+      /* Buffering would not save us anything. */
+      SVN_ERR(read_range(rb, rb->offset, buf, len));
+      rb->offset += *len;
+      return svn_error_trace(update_checksums(rb, buf, *len));
     }
+
+  while (total < requested)
+    {
+      apr_size_t available, to_copy;
+
+      /* Refill the buffer if it doesn't cover our current position. */
+      if (   rb->offset < rb->buffer_offset
+          || rb->offset >= rb->buffer_offset + rb->buffer_len)
+        {
+          rb->buffer_offset = rb->offset;
+          rb->buffer_len = rb->buffer_size;
+          SVN_ERR(read_range(rb, rb->buffer_offset, rb->buffer,
+                             &rb->buffer_len));
+
+          /* End of data? */
+          if (rb->buffer_len == 0)
+            break;
+        }
+
+      available = (apr_size_t)(rb->buffer_offset + rb->buffer_len
+                               - rb->offset);
+      to_copy = MIN(available, requested - total);
+      memcpy(buf + total,
+             rb->buffer + (apr_size_t)(rb->offset - rb->buffer_offset),
+             to_copy);
+
+      rb->offset += to_copy;
+      SVN_ERR(update_checksums(rb, buf + total, to_copy));
+      total += to_copy;
+    }
+
+  *len = total;
   return SVN_NO_ERROR;
 }
 
@@ -159,6 +159,11 @@ commit_trail(trail_t *trail)
                        trail->db_txn->commit(trail->db_txn, 0)));
     }
 
+  /* Trails without a transaction are read-only, so there is nothing to
+     checkpoint. */
+  if (! trail->db_txn)
+    return SVN_NO_ERROR;
+
   /* Do a checkpoint here, if enough has gone on.
      The checkpoint parameters below are pretty arbitrary.  Perhaps
      there should be an svn_fs_berkeley_mumble function to set them.  */
@@ -290,3 +295,23 @@ svn_fs_base__retry(svn_fs_t *fs,
   return do_retry(fs, txn_body, baton, FALSE, destroy_trail_pool, pool,
                   NULL, NULL, 0);
 }
+
+
+svn_error_t *
+svn_fs_base__retry_read(svn_fs_t *fs,
+                        svn_error_t *(*txn_body)(void *baton, trail_t *trail),
+                        void *baton,
+                        svn_boolean_t destroy_trail_pool,
+                        apr_pool_t *pool)
+{
+  svn_error_t *err = do_retry(fs, txn_body, baton, FALSE,
+                              destroy_trail_pool, pool, NULL, NULL, 0);
+  if (! err)
+    return SVN_NO_ERROR;
+
+  /* Whatever went wrong, a consistent view will tell the truth. */
+  svn_error_clear(err);
+  return svn_error_trace(do_retry(fs, txn_body, baton, TRUE,
+                                  destroy_trail_pool, pool,
+                                  "unknown", "", 0));
+}
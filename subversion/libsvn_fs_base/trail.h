@@ -224,6 +224,21 @@ svn_error_t *svn_fs_base__retry(svn_fs_t *fs,
                                 apr_pool_t *pool);
 
 
+/* Run the read-only action TXN_BODY like svn_fs_base__retry(), i.e.
+   without the overhead of a Berkeley DB transaction.  Without one,
+   a sequence of reads is not isolated from concurrent writers,
+   which may, for instance, deltify a representation in between.  So if
+   that fails, try again with svn_fs_base__retry_txn() and return the
+   result of that.  TXN_BODY must therefore not leave any changes to
+   BATON behind when it fails. */
+svn_error_t *svn_fs_base__retry_read(svn_fs_t *fs,
+                                     svn_error_t *(*txn_body)(void *baton,
+                                                              trail_t *trail),
+                                     void *baton,
+                                     svn_boolean_t destroy_trail_pool,
+                                     apr_pool_t *pool);
+
+
 /* Record that OPeration is being done on TABLE in the TRAIL. */
 #if defined(SVN_FS__TRAIL_DEBUG)
 void svn_fs_base__trail_debug(trail_t *trail, const char *table,
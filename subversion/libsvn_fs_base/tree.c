@@ -5512,6 +5512,7 @@ static root_vtable_t root_vtable = {
   base_paths_changed,
   NULL,
   base_check_path,
+  NULL,
   base_node_history,
   base_node_id,
   base_node_relation,
@@ -5535,6 +5536,7 @@ static root_vtable_t root_vtable = {
   base_file_checksum,
   base_file_contents,
   NULL,
+  NULL,
   base_make_file,
   base_apply_textdelta,
   base_apply_text,
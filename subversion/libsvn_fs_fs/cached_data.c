@@ -24,10 +24,12 @@
 
 #include <assert.h>
 
+#include "svn_cache_config.h"
 #include "svn_hash.h"
 #include "svn_ctype.h"
 #include "svn_sorts.h"
 #include "private/svn_delta_private.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_io_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
@@ -38,6 +40,7 @@
 #include "index.h"
 #include "low_level.h"
 #include "pack.h"
+#include "trace.h"
 #include "util.h"
 #include "temp_serializer.h"
 
@@ -133,6 +136,8 @@ dbg_log_access(svn_fs_t *fs,
         description = "  PLAIN";
       else if (header->type == svn_fs_fs__rep_self_delta)
         description = "  DELTA";
+      else if (header->type == svn_fs_fs__rep_chunked)
+        description = "  CHUNKED";
       else
         description = apr_psprintf(scratch_pool,
                                    "  DELTA against %ld/%" APR_UINT64_T_FMT,
@@ -462,6 +467,9 @@ get_node_revision_body(node_revision_t **noderev_p,
                                  result_pool));
           if (is_cached)
             return SVN_NO_ERROR;
+
+          SVN_FS_FS__TRACE(fs, svn_fs_fs__trace_cache_miss, "noderev",
+                           key.revision, key.second, 0, 0, 0);
         }
 
       /* read the data from disk */
@@ -534,6 +542,268 @@ svn_fs_fs__get_node_revision(node_revision_t **noderev_p,
 }
 
 
+/* A committed node-revision to be read by svn_fs_fs__get_node_revisions.
+ */
+typedef struct noderev_request_t
+{
+  /* index within the caller's arrays */
+  int index;
+
+  /* the node-revision's ID */
+  const svn_fs_id_t *id;
+
+  /* first revision in the rev / pack file containing the node-revision */
+  svn_revnum_t file_rev;
+
+  /* location of the node-revision */
+  const svn_fs_fs__id_part_t *rev_item;
+  apr_off_t offset;
+} noderev_request_t;
+
+/* implements compare_fn_t.  Group by rev / pack file, then order by item.
+ */
+static int
+compare_noderev_requests_by_file(const void *lhs_p,
+                                 const void *rhs_p)
+{
+  const noderev_request_t *lhs = lhs_p;
+  const noderev_request_t *rhs = rhs_p;
+
+  if (lhs->file_rev != rhs->file_rev)
+    return lhs->file_rev < rhs->file_rev ? -1 : 1;
+
+  return svn_fs_fs__id_part_compare(lhs->rev_item, rhs->rev_item);
+}
+
+/* implements compare_fn_t.  Order by position within the rev / pack file.
+ */
+static int
+compare_noderev_requests_by_offset(const void *lhs_p,
+                                   const void *rhs_p)
+{
+  const noderev_request_t *lhs = lhs_p;
+  const noderev_request_t *rhs = rhs_p;
+
+  if (lhs->offset != rhs->offset)
+    return lhs->offset < rhs->offset ? -1 : 1;
+
+  return 0;
+}
+
+/* Read the COUNT node-revisions described by REQUESTS from FS, all of
+   which must be stored in the same rev / pack file.  Return them in the
+   respective elements of NODEREVS, allocated in RESULT_POOL.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_node_revisions(node_revision_t **noderevs,
+                    svn_fs_t *fs,
+                    noderev_request_t *requests,
+                    int count,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_revnum_t *revisions = apr_palloc(scratch_pool,
+                                       count * sizeof(*revisions));
+  apr_uint64_t *item_indexes = apr_palloc(scratch_pool,
+                                          count * sizeof(*item_indexes));
+  apr_off_t *offsets = apr_palloc(scratch_pool, count * sizeof(*offsets));
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs,
+                                           requests[0].rev_item->revision,
+                                           scratch_pool, iterpool));
+
+  /* Resolve all item offsets at once. */
+  for (i = 0; i < count; ++i)
+    {
+      revisions[i] = requests[i].rev_item->revision;
+      item_indexes[i] = requests[i].rev_item->number;
+    }
+
+  SVN_ERR(svn_fs_fs__item_offsets(offsets, fs, rev_file, revisions,
+                                  item_indexes, count, scratch_pool));
+  for (i = 0; i < count; ++i)
+    requests[i].offset = offsets[i];
+
+  /* Read the node-revisions in file order. */
+  qsort(requests, count, sizeof(*requests),
+        compare_noderev_requests_by_offset);
+
+  /* Have the OS fetch all blocks that we are about to read at once
+     instead of waiting for them one by one. */
+  if (count > 1)
+    {
+      svn_io__read_request_t *blocks
+        = apr_pcalloc(scratch_pool, count * sizeof(*blocks));
+
+      for (i = 0; i < count; ++i)
+        {
+          blocks[i].offset = requests[i].offset
+                           - requests[i].offset % ffd->block_size;
+          blocks[i].len = (apr_size_t)ffd->block_size;
+        }
+
+      SVN_ERR(svn_io__file_prefetch(rev_file->file, blocks, count,
+                                    scratch_pool));
+    }
+
+  for (i = 0; i < count; ++i)
+    {
+      noderev_request_t *request = &requests[i];
+      node_revision_t **noderev_p = &noderevs[request->index];
+      svn_boolean_t is_cached = FALSE;
+      pair_cache_key_t key = { 0 };
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+
+      key.revision = request->rev_item->revision;
+      key.second = request->rev_item->number;
+
+      if (use_block_read(fs))
+        {
+          /* Reading the previous blocks may have cached this one. */
+          if (ffd->node_revision_cache)
+            SVN_ERR(svn_cache__get((void **)noderev_p, &is_cached,
+                                   ffd->node_revision_cache, &key,
+                                   result_pool));
+
+          err = is_cached
+              ? SVN_NO_ERROR
+              : block_read((void **)noderev_p, fs,
+                           request->rev_item->revision,
+                           request->rev_item->number, rev_file,
+                           result_pool, iterpool);
+        }
+      else
+        {
+          err = aligned_seek(fs, rev_file->file, NULL, request->offset,
+                             iterpool);
+          if (!err)
+            err = svn_fs_fs__read_noderev(noderev_p, rev_file->stream,
+                                          result_pool, iterpool);
+          if (!err)
+            err = fixup_node_revision(fs, *noderev_p, iterpool);
+          if (!err && ffd->node_revision_cache)
+            err = svn_cache__set(ffd->node_revision_cache, &key,
+                                 *noderev_p, iterpool);
+        }
+
+      if (err && err->apr_err == SVN_ERR_FS_CORRUPT)
+        {
+          svn_string_t *id_string = svn_fs_fs__id_unparse(request->id,
+                                                          iterpool);
+          return svn_error_createf(SVN_ERR_FS_CORRUPT, err,
+                                   "Corrupt node-revision '%s'",
+                                   id_string->data);
+        }
+
+      SVN_ERR(err);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+}
+
+svn_error_t *
+svn_fs_fs__get_node_revisions(node_revision_t **noderevs,
+                              svn_fs_t *fs,
+                              const svn_fs_id_t *const *ids,
+                              int count,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  noderev_request_t *requests;
+  svn_boolean_t *found;
+  svn_revnum_t max_rev = SVN_INVALID_REVNUM;
+  apr_pool_t *iterpool;
+  int request_count = 0;
+  int first, last, i;
+
+  if (count == 0)
+    return SVN_NO_ERROR;
+
+  /* Look up all committed node-revisions in the cache at once. */
+  found = apr_pcalloc(scratch_pool, count * sizeof(*found));
+  if (ffd->node_revision_cache)
+    {
+      pair_cache_key_t *keys = apr_pcalloc(scratch_pool,
+                                           count * sizeof(*keys));
+      const void **key_ptrs = apr_pcalloc(scratch_pool,
+                                          count * sizeof(*key_ptrs));
+
+      for (i = 0; i < count; ++i)
+        if (!svn_fs_fs__id_is_txn(ids[i]))
+          {
+            const svn_fs_fs__id_part_t *rev_item
+              = svn_fs_fs__id_rev_item(ids[i]);
+            keys[i].revision = rev_item->revision;
+            keys[i].second = rev_item->number;
+            key_ptrs[i] = &keys[i];
+          }
+
+      SVN_ERR(svn_cache__get_many((void **)noderevs, found,
+                                  ffd->node_revision_cache, key_ptrs, count,
+                                  result_pool, scratch_pool));
+    }
+
+  /* Collect what remains to be read from rev / pack files.  Transaction
+     node-revisions use a different storage and are read individually. */
+  requests = apr_palloc(scratch_pool, count * sizeof(*requests));
+  for (i = 0; i < count; ++i)
+    if (!found[i])
+      {
+        if (svn_fs_fs__id_is_txn(ids[i]))
+          {
+            SVN_ERR(svn_fs_fs__get_node_revision(&noderevs[i], fs, ids[i],
+                                                 result_pool, scratch_pool));
+          }
+        else
+          {
+            noderev_request_t *request = &requests[request_count++];
+            request->index = i;
+            request->id = ids[i];
+            request->rev_item = svn_fs_fs__id_rev_item(ids[i]);
+            request->file_rev
+              = svn_fs_fs__packed_base_rev(fs, request->rev_item->revision);
+            request->offset = -1;
+
+            max_rev = MAX(max_rev, request->rev_item->revision);
+          }
+      }
+
+  if (request_count == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__ensure_revision_exists(max_rev, fs, scratch_pool));
+
+  /* Access each rev / pack file only once. */
+  qsort(requests, request_count, sizeof(*requests),
+        compare_noderev_requests_by_file);
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (first = 0; first < request_count; first = last)
+    {
+      for (last = first + 1; last < request_count; ++last)
+        if (requests[last].file_rev != requests[first].file_rev)
+          break;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(read_node_revisions(noderevs, fs, requests + first,
+                                  last - first, result_pool, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* Given a revision file REV_FILE, opened to REV in FS, find the Node-ID
    of the header located at OFFSET and store it in *ID_P.  Allocate
    temporary variables from POOL. */
@@ -964,8 +1234,10 @@ create_rep_state_body(rep_state_t **rep_state,
   *rep_state = rs;
   *rep_header = rh;
 
-  if (rh->type == svn_fs_fs__rep_plain)
-    /* This is a plaintext, so just return the current rep_state. */
+  if (   rh->type == svn_fs_fs__rep_plain
+      || rh->type == svn_fs_fs__rep_chunked)
+    /* This is a plaintext or a chunk list, so just return the current
+       rep_state. */
     return SVN_NO_ERROR;
 
   /* skip "SVNx" diff marker */
@@ -1082,6 +1354,26 @@ svn_fs_fs__check_rep(representation_t *rep,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__rep_is_chunked(svn_boolean_t *chunked,
+                          representation_t *rep,
+                          svn_fs_t *fs,
+                          apr_pool_t *scratch_pool)
+{
+  rep_state_t *rs;
+  svn_fs_fs__rep_header_t *rep_header;
+
+  SVN_ERR(create_rep_state(&rs, &rep_header, NULL, rep, fs, scratch_pool,
+                           scratch_pool));
+  *chunked = rep_header->type == svn_fs_fs__rep_chunked;
+
+  /* Don't keep file handles open for longer than necessary. */
+  if (rs->sfile->rfile)
+    SVN_ERR(svn_fs_fs__close_revision_file(rs->sfile->rfile));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__rep_chain_length(int *chain_length,
                             int *shard_count,
@@ -1182,11 +1474,25 @@ struct rep_read_baton
   /* The plaintext state, if there is a plaintext. */
   rep_state_t *src_state;
 
+  /* If not NULL, REP is a CHUNKED rep and this lists the representations
+     (representation_t *) whose contents are to be concatenated. */
+  apr_array_header_t *chunks;
+
+  /* Index of the next element in CHUNKS to read. */
+  int next_chunk;
+
+  /* Contents of the current element in CHUNKS.  NULL before reading the
+     first chunk and when the previous one has been read completely. */
+  svn_stream_t *chunk_stream;
+
+  /* Pool for CHUNK_STREAM.  Gets cleared for every new chunk. */
+  apr_pool_t *chunk_pool;
+
   /* The index of the current delta chunk, if we are reading a delta. */
   int chunk_index;
 
   /* The buffer where we store undeltified data. */
-  char *buf;
+  const char *buf;
   apr_size_t buf_pos;
   apr_size_t buf_len;
 
@@ -1268,8 +1574,8 @@ parse_raw_window(void **out,
   stream = svn_stream_from_string(&raw_window, result_pool);
 
   /* parse it */
-  SVN_ERR(svn_txdelta_read_svndiff_window(&result->window, stream, 1,
-                                          result_pool));
+  SVN_ERR(svn_txdelta_read_svndiff_window(&result->window, stream,
+                                          window->ver, result_pool));
 
   /* complete the window and return it */
   result->end_offset = window->end_offset;
@@ -1336,6 +1642,12 @@ get_cached_window(svn_txdelta_window_t **window_p,
           rs->current = cached_window->end_offset;
           rs->chunk_index = chunk_index;
         }
+      else
+        {
+          SVN_FS_FS__TRACE(rs->sfile->fs, svn_fs_fs__trace_cache_miss,
+                           "window", rs->revision, rs->item_index,
+                           0, 0, 0);
+        }
     }
 
   return SVN_NO_ERROR;
@@ -1422,6 +1734,37 @@ set_cached_combined_window(svn_stringbuf_t *window,
   return SVN_NO_ERROR;
 }
 
+/* Read the chunk list of the CHUNKED representation REP from RS and
+   return it in *CHUNKS, allocated in RESULT_POOL.  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+read_chunk_list(apr_array_header_t **chunks,
+                rep_state_t *rs,
+                const representation_t *rep,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *text;
+
+  if (rs->size > SVN_MAX_OBJECT_SIZE)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Chunk list too large"));
+
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  SVN_ERR(auto_set_start_offset(rs, scratch_pool));
+  SVN_ERR(rs_aligned_seek(rs, NULL, rs->start, scratch_pool));
+
+  text = svn_stringbuf_create_ensure((apr_size_t)rs->size, scratch_pool);
+  SVN_ERR(svn_io_file_read_full2(rs->sfile->rfile->file, text->data,
+                                 (apr_size_t)rs->size, &text->len, NULL,
+                                 scratch_pool));
+  text->data[text->len] = 0;
+
+  return svn_error_trace(svn_fs_fs__parse_chunk_list(chunks, text, rep,
+                                                     result_pool,
+                                                     scratch_pool));
+}
+
 /* Build an array of rep_state structures in *LIST giving the delta
    reps from first_rep to a plain-text or self-compressed rep.  Set
    *SRC_STATE to the plain-text rep we find at the end of the chain,
@@ -1430,11 +1773,15 @@ set_cached_combined_window(svn_stringbuf_t *window,
    ID, and representation REP.
    Also, set *WINDOW_P to the base window content for *LIST, if it
    could be found in cache. Otherwise, *LIST will contain the base
-   representation for the whole delta chain. */
+   representation for the whole delta chain.
+   If REP is a CHUNKED representation, return its chunk list in *CHUNKS
+   and set *SRC_STATE to its rep_state.  CHUNKS may be NULL if REP must
+   not be CHUNKED. */
 static svn_error_t *
 build_rep_list(apr_array_header_t **list,
                svn_stringbuf_t **window_p,
                rep_state_t **src_state,
+               apr_array_header_t **chunks,
                svn_fs_t *fs,
                representation_t *first_rep,
                apr_pool_t *pool)
@@ -1461,6 +1808,19 @@ build_rep_list(apr_array_header_t **list,
         SVN_ERR(create_rep_state(&rs, &rep_header, &shared_file,
                                  &rep, fs, pool, iterpool));
 
+      if (rep_header->type == svn_fs_fs__rep_chunked)
+        {
+          /* Chunk lists are never used as delta bases. */
+          if (!chunks || (*list)->nelts)
+            return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                    _("Chunked representation used as "
+                                      "delta base"));
+
+          SVN_ERR(read_chunk_list(chunks, rs, first_rep, pool, iterpool));
+          *src_state = rs;
+          break;
+        }
+
       /* for txn reps, there won't be a cached combined window */
       if (!svn_fs_fs__id_txn_used(&rep.txn_id))
         SVN_ERR(get_cached_combined_window(window_p, rs, &is_cached, pool));
@@ -1551,6 +1911,7 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
   svn_boolean_t is_cached;
   apr_off_t start_offset;
   apr_off_t end_offset;
+  apr_time_t start;
   apr_pool_t *iterpool;
 
   SVN_ERR_ASSERT(rs->chunk_index <= this_chunk);
@@ -1593,6 +1954,7 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
 
   /* RS->FILE may be shared between RS instances -> make sure we point
    * to the right data. */
+  start = SVN_FS_FS__TRACE_START(rs->sfile->fs);
   start_offset = rs->start + rs->current;
   SVN_ERR(rs_aligned_seek(rs, NULL, start_offset, scratch_pool));
 
@@ -1624,6 +1986,10 @@ read_delta_window(svn_txdelta_window_t **nwin, int this_chunk,
                             _("Reading one svndiff window read beyond "
                               "the end of the representation"));
 
+  SVN_FS_FS__TRACE(rs->sfile->fs, svn_fs_fs__trace_window_read, "delta",
+                   rs->revision, rs->item_index, start_offset,
+                   end_offset - start_offset, start);
+
   /* the window has not been cached before, thus cache it now
    * (if caching is used for them at all) */
   if (SVN_IS_VALID_REVNUM(rs->revision))
@@ -1639,6 +2005,7 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
                   apr_pool_t *scratch_pool)
 {
   apr_off_t offset;
+  apr_time_t start = SVN_FS_FS__TRACE_START(rs->sfile->fs);
 
   /* RS->FILE may be shared between RS instances -> make sure we point
    * to the right data. */
@@ -1654,19 +2021,82 @@ read_plain_window(svn_stringbuf_t **nwin, rep_state_t *rs,
                                  NULL, NULL, result_pool));
   (*nwin)->data[size] = 0;
 
+  SVN_FS_FS__TRACE(rs->sfile->fs, svn_fs_fs__trace_window_read, "plain",
+                   rs->revision, rs->item_index, offset, size, start);
+
   /* Update RS. */
   rs->current += (apr_off_t)size;
 
   return SVN_NO_ERROR;
 }
 
-/* Skip SIZE bytes from the PLAIN representation RS. */
+/* Read the combined chunk number RB->CHUNK_INDEX of the delta rep whose
+ * state is RS from the current FSFS session's cache.  If found, set
+ * *CHUNK_P to its contents allocated in RB->POOL and update RS as though
+ * we had just combined that chunk.  Otherwise, set *CHUNK_P to NULL.
+ */
 static svn_error_t *
-skip_plain_window(rep_state_t *rs,
-                  apr_size_t size)
+get_cached_combined_chunk(const svn_string_t **chunk_p,
+                          struct rep_read_baton *rb,
+                          rep_state_t *rs)
 {
-  /* Update RS. */
-  rs->current += (apr_off_t)size;
+  fs_fs_data_t *ffd = rb->fs->fsap_data;
+  svn_fs_fs__combined_cached_chunk_t *cached_chunk;
+  svn_boolean_t is_cached = FALSE;
+
+  /* Txn reps may still change. */
+  if (ffd->combined_chunk_cache && SVN_IS_VALID_REVNUM(rs->revision))
+    {
+      window_cache_key_t key = { 0 };
+      get_window_key(&key, rs);
+      key.chunk_index = rb->chunk_index;
+      SVN_ERR(svn_cache__get((void **) &cached_chunk, &is_cached,
+                             ffd->combined_chunk_cache, &key, rb->pool));
+    }
+
+  if (is_cached)
+    {
+      /* Deeper reps in the chain will skip the respective windows when
+         they get read the next time.  Only RS needs to be up-to-date. */
+      *chunk_p = &cached_chunk->contents;
+      rs->current = cached_chunk->end_offset;
+      rs->chunk_index = rb->chunk_index + 1;
+    }
+  else
+    {
+      *chunk_p = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Store CHUNK, the combined chunk number RB->CHUNK_INDEX of the delta rep
+ * whose state is RS, in the current FSFS session's cache.  This will be a
+ * no-op if no cache has been given.
+ * Temporary allocations will be made from SCRATCH_POOL. */
+static svn_error_t *
+set_cached_combined_chunk(svn_stringbuf_t *chunk,
+                          struct rep_read_baton *rb,
+                          rep_state_t *rs,
+                          apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = rb->fs->fsap_data;
+
+  if (ffd->combined_chunk_cache)
+    {
+      /* store the chunk and the first offset _past_ its delta window */
+      svn_fs_fs__combined_cached_chunk_t cached_chunk;
+      window_cache_key_t key = { 0 };
+
+      cached_chunk.contents.data = chunk->data;
+      cached_chunk.contents.len = chunk->len;
+      cached_chunk.end_offset = rs->current;
+
+      get_window_key(&key, rs);
+      key.chunk_index = rb->chunk_index;
+      SVN_ERR(svn_cache__set(ffd->combined_chunk_cache, &key, &cached_chunk,
+                             scratch_pool));
+    }
 
   return SVN_NO_ERROR;
 }
@@ -1728,17 +2158,15 @@ get_combined_window(svn_stringbuf_t **result,
          Also note that we may have short-cut reading the delta chain --
          in which case SRC_OPS is 0 and it might not be a PLAIN rep. */
       source = buf;
-      if (source == NULL && rb->src_state != NULL)
+      if (source == NULL && rb->src_state != NULL && window->src_ops)
         {
-          /* Even if we don't need the source rep now, we still must keep
-           * its read offset in sync with what we might need for the next
-           * window. */
-          if (window->src_ops)
-            SVN_ERR(read_plain_window(&source, rb->src_state,
-                                      window->sview_len,
-                                      pool, iterpool));
-          else
-            SVN_ERR(skip_plain_window(rb->src_state, window->sview_len));
+          /* Previous chunks may have been skipped, e.g. because they were
+           * found in the combined chunk cache.  So, don't rely on the
+           * current read offset of the source rep. */
+          rb->src_state->current = window->sview_offset;
+          SVN_ERR(read_plain_window(&source, rb->src_state,
+                                    window->sview_len,
+                                    pool, iterpool));
         }
 
       /* Combine this window with the current one. */
@@ -1760,6 +2188,13 @@ get_combined_window(svn_stringbuf_t **result,
           && SVN_IS_VALID_REVNUM(rs->revision))
         SVN_ERR(set_cached_combined_window(buf, rs, new_pool));
 
+      /* Otherwise, cache the final result per chunk if it took more than
+         a single delta to produce it.  Repeated reads of the same rep will
+         then not need to walk the delta chain again. */
+      else if (i == 0 && windows->nelts > 1
+               && SVN_IS_VALID_REVNUM(rs->revision))
+        SVN_ERR(set_cached_combined_chunk(buf, rb, rs, new_pool));
+
       rs->chunk_index++;
 
       /* Cycle pools so that we only need to hold three windows at a time. */
@@ -1797,6 +2232,54 @@ rep_read_contents_close(void *baton)
   return SVN_NO_ERROR;
 }
 
+/* Return the next *LEN bytes of the CHUNKED rep in RB from its list of
+   chunks and store them in *BUF. */
+static svn_error_t *
+get_contents_from_chunks(struct rep_read_baton *rb,
+                         char *buf,
+                         apr_size_t *len)
+{
+  apr_size_t remaining = *len;
+  char *cur = buf;
+
+  while (remaining > 0)
+    {
+      apr_size_t read_len = remaining;
+
+      /* Continue with the next chunk, if any. */
+      if (!rb->chunk_stream)
+        {
+          representation_t *chunk;
+          if (rb->next_chunk == rb->chunks->nelts)
+            break;
+
+          chunk = APR_ARRAY_IDX(rb->chunks, rb->next_chunk,
+                                representation_t *);
+          rb->next_chunk++;
+
+          svn_pool_clear(rb->chunk_pool);
+          SVN_ERR(svn_fs_fs__get_contents(&rb->chunk_stream, rb->fs, chunk,
+                                          TRUE, rb->chunk_pool));
+        }
+
+      /* The chunk streams verify their own contents. */
+      SVN_ERR(svn_stream_read_full(rb->chunk_stream, cur, &read_len));
+      cur += read_len;
+      remaining -= read_len;
+
+      /* A short read means that the current chunk has been exhausted. */
+      if (remaining > 0)
+        {
+          SVN_ERR(svn_stream_close(rb->chunk_stream));
+          rb->chunk_stream = NULL;
+        }
+    }
+
+  *len = cur - buf;
+
+  return SVN_NO_ERROR;
+}
+
 /* Return the next *LEN bytes of the rep from our plain / delta windows
    and store them in *BUF. */
 static svn_error_t *
@@ -1808,6 +2291,10 @@ get_contents_from_windows(struct rep_read_baton *rb,
   char *cur = buf;
   rep_state_t *rs;
 
+  /* CHUNKED reps don't have windows but other reps to concatenate. */
+  if (rb->chunks)
+    return svn_error_trace(get_contents_from_chunks(rb, buf, len));
+
   /* Special case for when there are no delta reps, only a plain
      text. */
   if (rb->rs_list->nelts == 0)
@@ -1875,17 +2362,28 @@ get_contents_from_windows(struct rep_read_baton *rb,
       else
         {
           svn_stringbuf_t *sbuf = NULL;
+          const svn_string_t *chunk;
 
           rs = APR_ARRAY_IDX(rb->rs_list, 0, rep_state_t *);
           if (rs->current == rs->size)
             break;
 
-          /* Get more buffered data by evaluating a chunk. */
-          SVN_ERR(get_combined_window(&sbuf, rb));
+          /* Get more buffered data by evaluating a chunk, unless we
+             already did that before. */
+          SVN_ERR(get_cached_combined_chunk(&chunk, rb, rs));
+          if (chunk)
+            {
+              rb->buf_len = chunk->len;
+              rb->buf = chunk->data;
+            }
+          else
+            {
+              SVN_ERR(get_combined_window(&sbuf, rb));
+              rb->buf_len = sbuf->len;
+              rb->buf = sbuf->data;
+            }
 
           rb->chunk_index++;
-          rb->buf_len = sbuf->len;
-          rb->buf = sbuf->data;
           rb->buf_pos = 0;
         }
     }
@@ -2129,8 +2627,10 @@ rep_read_contents(void *baton,
       /* Window stream not initialized, yet.  Do it now. */
       rb->len = rb->rep.expanded_size;
       SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
-                             &rb->src_state, rb->fs, &rb->rep,
+                             &rb->src_state, &rb->chunks, rb->fs, &rb->rep,
                              rb->filehandle_pool));
+      if (rb->chunks)
+        rb->chunk_pool = svn_pool_create(rb->filehandle_pool);
 
       /* In case we did read from the fulltext cache before, make the
        * window stream catch up.  Also, initialize the fulltext buffer
@@ -2289,6 +2789,15 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
       rb->rs_list = apr_array_make(pool, 0, sizeof(rep_state_t *));
       rb->src_state = rs;
     }
+  else if (rh->type == svn_fs_fs__rep_chunked)
+    {
+      /* The chunk list is the plain contents of REP.  The chunks
+       * themselves can then be read in the usual way. */
+      rb->rs_list = apr_array_make(pool, 0, sizeof(rep_state_t *));
+      rb->src_state = rs;
+      rb->chunk_pool = svn_pool_create(rb->filehandle_pool);
+      SVN_ERR(read_chunk_list(&rb->chunks, rs, rep, pool, pool));
+    }
   else if (rh->type == svn_fs_fs__rep_self_delta)
     {
       rb->rs_list = apr_array_make(pool, 1, sizeof(rep_state_t *));
@@ -2310,7 +2819,7 @@ svn_fs_fs__get_contents_from_file(svn_stream_t **contents_p,
       svn_fs_fs__id_txn_reset(&next_rep.txn_id);
 
       SVN_ERR(build_rep_list(&rb->rs_list, &rb->base_window,
-                             &rb->src_state, rb->fs, &next_rep,
+                             &rb->src_state, NULL, rb->fs, &next_rep,
                              rb->filehandle_pool));
 
       /* Insert the access to REP as the first element of the delta chain. */
@@ -2395,6 +2904,106 @@ svn_fs_fs__try_process_file_contents(svn_boolean_t *success,
   return SVN_NO_ERROR;
 }
 
+/* The number of bytes at the start of a delta window that
+   svn_txdelta__read_raw_window_data() may need to look at: the window
+   header plus a single instruction and the length prefixes of the
+   instruction and data sections. */
+#define WINDOW_PROBE_SIZE (9 * SVN__MAX_ENCODED_UINT_LEN)
+
+svn_error_t *
+svn_fs_fs__try_get_rep_regions(apr_file_t **file,
+                               apr_array_header_t **regions,
+                               svn_fs_t *fs,
+                               representation_t *rep,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool)
+{
+  rep_state_t *rs;
+  svn_fs_fs__rep_header_t *rh;
+  svn_fs__file_region_t *region;
+  apr_file_t *rev_file;
+  apr_off_t offset, end;
+  svn_filesize_t total = 0;
+  apr_pool_t *iterpool;
+  apr_status_t status;
+
+  *file = NULL;
+
+  /* Only committed representations are immutable. */
+  if (rep == NULL || svn_fs_fs__id_txn_used(&rep->txn_id))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(create_rep_state(&rs, &rh, NULL, rep, fs, result_pool,
+                           scratch_pool));
+  if (   rh->type != svn_fs_fs__rep_plain
+      && rh->type != svn_fs_fs__rep_self_delta)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(auto_open_shared_file(rs->sfile));
+  SVN_ERR(auto_set_start_offset(rs, scratch_pool));
+  rev_file = rs->sfile->rfile->file;
+  *regions = apr_array_make(result_pool, 1, sizeof(*region));
+
+  if (rh->type == svn_fs_fs__rep_plain)
+    {
+      if (rep->expanded_size && rep->expanded_size != rep->size)
+        return SVN_NO_ERROR;
+
+      region = apr_array_push(*regions);
+      region->offset = rs->start;
+      region->length = rs->size;
+      *file = rev_file;
+
+      return SVN_NO_ERROR;
+    }
+
+  /* Self-deltas qualify if each of their windows simply inserts verbatim
+     data.  We only look at the start of each window, so don't let
+     buffering read the whole file.  RS->SFILE is not shared with anyone. */
+  SVN_ERR(auto_read_diff_version(rs, scratch_pool));
+  status = apr_file_buffer_set(rev_file, NULL, 0);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't set file buffer"));
+
+  iterpool = svn_pool_create(scratch_pool);
+  offset = rs->start + 4;
+  end = rs->start + rs->size;
+  while (offset < end)
+    {
+      char buf[WINDOW_PROBE_SIZE];
+      svn_string_t probe;
+      apr_size_t window_len, data_offset, data_len;
+
+      svn_pool_clear(iterpool);
+
+      probe.data = buf;
+      probe.len = (apr_size_t)MIN(sizeof(buf), end - offset);
+      SVN_ERR(svn_io_file_seek(rev_file, APR_SET, &offset, iterpool));
+      SVN_ERR(svn_io_file_read_full2(rev_file, buf, probe.len, NULL, NULL,
+                                     iterpool));
+      SVN_ERR(svn_txdelta__read_raw_window_data(&window_len, &data_offset,
+                                                &data_len,
+                                                svn_stream_from_string(
+                                                    &probe, iterpool),
+                                                rs->ver, iterpool));
+      if (data_len == 0)
+        break;
+
+      region = apr_array_push(*regions);
+      region->offset = offset + data_offset;
+      region->length = data_len;
+
+      total += data_len;
+      offset += window_len;
+    }
+  svn_pool_destroy(iterpool);
+
+  if (offset == end && total == rep->expanded_size)
+    *file = rev_file;
+
+  return SVN_NO_ERROR;
+}
+
 
 /* Baton used when reading delta windows. */
 struct delta_read_baton
@@ -2555,14 +3164,69 @@ compare_dirent_name(const void *a, const void *b)
   return strcmp(lhs->name, rhs);
 }
 
+/* Convert the hash dump ENTRY, read from the directory representation
+ * of node ID, into a new directory entry in *DIRENT_P.  ENTRY must not
+ * be a deletion.  Allocate the result in RESULT_POOL and use SCRATCH_POOL
+ * for temporaries.
+ */
+static svn_error_t *
+parse_dir_entry(svn_fs_dirent_t **dirent_p,
+                svn_hash__entry_t *entry,
+                const svn_fs_id_t *id,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  svn_fs_dirent_t *dirent;
+  char *str;
+
+  dirent = apr_pcalloc(result_pool, sizeof(*dirent));
+  dirent->name = apr_pstrmemdup(result_pool, entry->key, entry->keylen);
+
+  str = svn_cstring_tokenize(" ", &entry->val);
+  if (str == NULL)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                       _("Directory entry corrupt in '%s'"),
+                       svn_fs_fs__id_unparse(id, scratch_pool)->data);
+
+  if (strcmp(str, SVN_FS_FS__KIND_FILE) == 0)
+    {
+      dirent->kind = svn_node_file;
+    }
+  else if (strcmp(str, SVN_FS_FS__KIND_DIR) == 0)
+    {
+      dirent->kind = svn_node_dir;
+    }
+  else
+    {
+      return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                       _("Directory entry corrupt in '%s'"),
+                       svn_fs_fs__id_unparse(id, scratch_pool)->data);
+    }
+
+  str = svn_cstring_tokenize(" ", &entry->val);
+  if (str == NULL)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                       _("Directory entry corrupt in '%s'"),
+                       svn_fs_fs__id_unparse(id, scratch_pool)->data);
+
+  SVN_ERR(svn_fs_fs__id_parse(&dirent->id, str, result_pool));
+
+  *dirent_p = dirent;
+  return SVN_NO_ERROR;
+}
+
 /* Into *ENTRIES_P, read all directories entries from the key-value text in
  * STREAM.  If INCREMENTAL is TRUE, read until the end of the STREAM and
- * update the data.  ID is provided for nicer error messages.
+ * update the data.  If BASE is not NULL, INCREMENTAL must be TRUE and
+ * STREAM contains only the changes to the BASE entries, i.e. no initial
+ * hash dump.  BASE must be allocated in RESULT_POOL.  ID is provided for
+ * nicer error messages.
  */
 static svn_error_t *
 read_dir_entries(apr_array_header_t **entries_p,
                  svn_stream_t *stream,
                  svn_boolean_t incremental,
+                 apr_array_header_t *base,
                  const svn_fs_id_t *id,
                  apr_pool_t *result_pool,
                  apr_pool_t *scratch_pool)
@@ -2577,6 +3241,20 @@ read_dir_entries(apr_array_header_t **entries_p,
   else
     entries = apr_array_make(result_pool, 16, sizeof(svn_fs_dirent_t *));
 
+  if (base)
+    {
+      int i;
+
+      assert(hash);
+      for (i = 0; i < base->nelts; ++i)
+        {
+          svn_fs_dirent_t *dirent = APR_ARRAY_IDX(base, i, svn_fs_dirent_t *);
+          svn_hash_sets(hash, dirent->name, dirent);
+        }
+
+      terminator = NULL;
+    }
+
   /* Read until the terminator (non-incremental) or the end of STREAM
      (incremental mode).  In the latter mode, we use a temporary HASH
      to make updating and removing entries cheaper. */
@@ -2584,7 +3262,6 @@ read_dir_entries(apr_array_header_t **entries_p,
     {
       svn_hash__entry_t entry;
       svn_fs_dirent_t *dirent;
-      char *str;
 
       svn_pool_clear(iterpool);
       SVN_ERR_W(svn_hash__read_entry(&entry, stream, terminator,
@@ -2614,37 +3291,8 @@ read_dir_entries(apr_array_header_t **entries_p,
         }
 
       /* Add a new directory entry. */
-      dirent = apr_pcalloc(result_pool, sizeof(*dirent));
-      dirent->name = apr_pstrmemdup(result_pool, entry.key, entry.keylen);
-
-      str = svn_cstring_tokenize(" ", &entry.val);
-      if (str == NULL)
-        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                           _("Directory entry corrupt in '%s'"),
-                           svn_fs_fs__id_unparse(id, scratch_pool)->data);
-
-      if (strcmp(str, SVN_FS_FS__KIND_FILE) == 0)
-        {
-          dirent->kind = svn_node_file;
-        }
-      else if (strcmp(str, SVN_FS_FS__KIND_DIR) == 0)
-        {
-          dirent->kind = svn_node_dir;
-        }
-      else
-        {
-          return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                           _("Directory entry corrupt in '%s'"),
-                           svn_fs_fs__id_unparse(id, scratch_pool)->data);
-        }
-
-      str = svn_cstring_tokenize(" ", &entry.val);
-      if (str == NULL)
-        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                           _("Directory entry corrupt in '%s'"),
-                           svn_fs_fs__id_unparse(id, scratch_pool)->data);
-
-      SVN_ERR(svn_fs_fs__id_parse(&dirent->id, str, result_pool));
+      SVN_ERR(parse_dir_entry(&dirent, &entry, id, result_pool,
+                              scratch_pool));
 
       /* In incremental mode, update the hash; otherwise, write to the
        * final array.  Be sure to use hash keys that survive this iteration.
@@ -2724,6 +3372,9 @@ get_dir_contents(svn_fs_fs__dir_data_t *dir,
   if (noderev->data_rep && svn_fs_fs__id_txn_used(&noderev->data_rep->txn_id))
     {
       /* Get location & current size of the directory representation. */
+      const apr_size_t prefix_len = sizeof(SVN_FS_FS__DIR_BASE_PREFIX) - 1;
+      apr_array_header_t *base = NULL;
+      svn_stringbuf_t *text;
       const char *filename;
       apr_file_t *file;
 
@@ -2740,9 +3391,40 @@ get_dir_contents(svn_fs_fs__dir_data_t *dir,
       SVN_ERR(svn_io_file_size_get(&dir->txn_filesize, file, scratch_pool));
 
       contents = svn_stream_from_aprfile2(file, FALSE, scratch_pool);
-      SVN_ERR(read_dir_entries(&dir->entries, contents, TRUE, noderev->id,
-                               result_pool, scratch_pool));
+      SVN_ERR(svn_stringbuf_from_stream(&text, contents,
+                                        (apr_size_t)dir->txn_filesize,
+                                        scratch_pool));
       SVN_ERR(svn_stream_close(contents));
+
+      /* The old contents may be given as a reference to a committed
+         rep that the rest of the file modifies. */
+      if (strncmp(text->data, SVN_FS_FS__DIR_BASE_PREFIX, prefix_len) == 0)
+        {
+          node_revision_t base_noderev = *noderev;
+          const char *eol = strchr(text->data, '\n');
+          svn_stringbuf_t *base_text;
+
+          if (eol == NULL)
+            return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                           _("Directory representation corrupt in '%s'"),
+                           svn_fs_fs__id_unparse(noderev->id,
+                                                 scratch_pool)->data);
+
+          base_text = svn_stringbuf_ncreate(text->data + prefix_len,
+                                            eol - text->data - prefix_len,
+                                            scratch_pool);
+          SVN_ERR(svn_fs_fs__parse_representation(&base_noderev.data_rep,
+                                                  base_text, scratch_pool,
+                                                  scratch_pool));
+          SVN_ERR(svn_fs_fs__rep_contents_dir(&base, fs, &base_noderev,
+                                              result_pool, scratch_pool));
+
+          svn_stringbuf_remove(text, 0, eol + 1 - text->data);
+        }
+
+      contents = svn_stream_from_stringbuf(text, scratch_pool);
+      SVN_ERR(read_dir_entries(&dir->entries, contents, TRUE, base,
+                               noderev->id, result_pool, scratch_pool));
     }
   else if (noderev->data_rep)
     {
@@ -2760,8 +3442,8 @@ get_dir_contents(svn_fs_fs__dir_data_t *dir,
 
       /* de-serialize hash */
       contents = svn_stream_from_stringbuf(text, scratch_pool);
-      SVN_ERR(read_dir_entries(&dir->entries, contents, FALSE, noderev->id,
-                               result_pool, scratch_pool));
+      SVN_ERR(read_dir_entries(&dir->entries, contents, FALSE, NULL,
+                               noderev->id, result_pool, scratch_pool));
     }
   else
     {
@@ -2831,7 +3513,10 @@ svn_fs_fs__rep_contents_dir(apr_array_header_t **entries_p,
 
       SVN_ERR(svn_cache__get((void **)&dir, &found, cache, key,
                              result_pool));
-      if (found)
+      if (!found)
+        SVN_FS_FS__TRACE(fs, svn_fs_fs__trace_cache_miss, "dir",
+                         pair_key.revision, pair_key.second, 0, 0, 0);
+      else
         {
           /* Verify that the cached dir info is not stale
            * (no-op for committed data). */
@@ -2873,6 +3558,210 @@ svn_fs_fs__find_dir_entry(apr_array_header_t *entries,
   return result ? *result : NULL;
 }
 
+/* Parse the 8 lowercase hex digits at DATA into *VALUE.  Return FALSE if
+ * DATA does not contain a valid number followed by the character SEP. */
+static svn_boolean_t
+parse_dir_index_number(apr_uint32_t *value,
+                       const char *data,
+                       char sep)
+{
+  apr_uint32_t result = 0;
+  int i;
+
+  for (i = 0; i < SVN_FS_FS__DIR_INDEX_RECORD_LEN - 1; ++i)
+    {
+      char c = data[i];
+      if (c >= '0' && c <= '9')
+        result = result * 16 + (c - '0');
+      else if (c >= 'a' && c <= 'f')
+        result = result * 16 + (c - 'a' + 10);
+      else
+        return FALSE;
+    }
+
+  if (data[i] != sep)
+    return FALSE;
+
+  *value = result;
+  return TRUE;
+}
+
+/* Read LEN bytes at OFFSET in REV_FILE of FS into BUFFER.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+read_dir_index_bytes(char *buffer,
+                     svn_fs_t *fs,
+                     svn_fs_fs__revision_file_t *rev_file,
+                     apr_off_t offset,
+                     apr_size_t len,
+                     apr_pool_t *pool)
+{
+  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, pool));
+  return svn_error_trace(svn_io_file_read_full2(rev_file->file, buffer, len,
+                                                NULL, NULL, pool));
+}
+
+/* Return an SVN_ERR_FS_CORRUPT error for the directory index of node ID.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+err_corrupt_dir_index(const svn_fs_id_t *id,
+                      apr_pool_t *pool)
+{
+  return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                           _("Directory index corrupt in '%s'"),
+                           svn_fs_fs__id_unparse(id, pool)->data);
+}
+
+/* If the committed directory representation of NODEREV in FS comes with
+ * an entry index, binary-search it for NAME, set *DIRENT to the entry
+ * found or NULL if there is none and set *INDEXED to TRUE.  Otherwise,
+ * set *INDEXED to FALSE and leave *DIRENT untouched.  This reads only
+ * O(log n) entries instead of the whole directory.  See the "structure"
+ * file for the index format.
+ *
+ * Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+find_indexed_dir_entry(svn_fs_dirent_t **dirent,
+                       svn_boolean_t *indexed,
+                       svn_fs_t *fs,
+                       node_revision_t *noderev,
+                       const char *name,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  const apr_size_t prefix_len = sizeof(SVN_FS_FS__DIR_INDEX_PREFIX) - 1;
+  const apr_size_t terminator_len = sizeof(SVN_HASH_TERMINATOR "\n") - 1;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  representation_t *rep = noderev->data_rep;
+  svn_fs_fs__revision_file_t *rev_file;
+  svn_fs_fs__rep_header_t *rep_header;
+  char footer[SVN_FS_FS__DIR_INDEX_FOOTER_LEN];
+  apr_uint32_t count, table, lower, upper;
+  apr_off_t offset, start;
+  apr_pool_t *iterpool;
+
+  *indexed = FALSE;
+
+  /* Only large, committed PLAIN representations may have an index. */
+  if (   ffd->format < SVN_FS_FS__MIN_DIR_INDEX_FORMAT
+      || rep == NULL
+      || svn_fs_fs__id_txn_used(&rep->txn_id)
+      || (rep->expanded_size != 0 && rep->expanded_size != rep->size)
+      || rep->size <   SVN_FS_FS__DIR_INDEX_MIN_ENTRIES
+                     * SVN_FS_FS__DIR_INDEX_RECORD_LEN
+                     + SVN_FS_FS__DIR_INDEX_FOOTER_LEN)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, rep->revision,
+                                           scratch_pool, scratch_pool));
+  SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, rep->revision, NULL,
+                                 rep->item_index, scratch_pool));
+  SVN_ERR(aligned_seek(fs, rev_file->file, NULL, offset, scratch_pool));
+  SVN_ERR(svn_fs_fs__read_rep_header(&rep_header, rev_file->stream,
+                                     scratch_pool, scratch_pool));
+  if (rep_header->type != svn_fs_fs__rep_plain)
+    return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+
+  /* Un-indexed directories end with the hash terminator, which can never
+   * be mistaken for a valid footer. */
+  start = offset + rep_header->header_size;
+  SVN_ERR(read_dir_index_bytes(footer, fs, rev_file,
+                               start + rep->size - (apr_off_t)sizeof(footer),
+                               sizeof(footer), scratch_pool));
+  if (   memcmp(footer, SVN_FS_FS__DIR_INDEX_PREFIX, prefix_len)
+      || !parse_dir_index_number(&count, footer + prefix_len, ' ')
+      || !parse_dir_index_number(&table,
+                                 footer + prefix_len
+                                        + SVN_FS_FS__DIR_INDEX_RECORD_LEN,
+                                 '\n'))
+    return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+
+  if (   count == 0
+      || table < terminator_len
+      ||   table + (svn_filesize_t)count * SVN_FS_FS__DIR_INDEX_RECORD_LEN
+         + SVN_FS_FS__DIR_INDEX_FOOTER_LEN != rep->size)
+    return svn_error_trace(err_corrupt_dir_index(noderev->id, scratch_pool));
+
+  /* Binary search.  The extent of each entry is given by its own index
+   * record and the next one resp. the hash terminator after the last. */
+  *indexed = TRUE;
+  *dirent = NULL;
+
+  iterpool = svn_pool_create(scratch_pool);
+  lower = 0;
+  upper = count;
+  while (lower < upper)
+    {
+      apr_uint32_t middle = lower + (upper - lower) / 2;
+      char records[2 * SVN_FS_FS__DIR_INDEX_RECORD_LEN];
+      apr_uint32_t entry_start, entry_end;
+      svn_boolean_t is_last = middle + 1 == count;
+      svn_stringbuf_t *text;
+      svn_hash__entry_t entry;
+      int diff;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(read_dir_index_bytes(records, fs, rev_file,
+                                   start + table
+                                     + (apr_off_t)middle
+                                     * SVN_FS_FS__DIR_INDEX_RECORD_LEN,
+                                   is_last ? SVN_FS_FS__DIR_INDEX_RECORD_LEN
+                                           : sizeof(records),
+                                   iterpool));
+      if (!parse_dir_index_number(&entry_start, records, '\n'))
+        return svn_error_trace(err_corrupt_dir_index(noderev->id, iterpool));
+
+      if (is_last)
+        entry_end = table - (apr_uint32_t)terminator_len;
+      else if (!parse_dir_index_number(&entry_end,
+                                       records
+                                         + SVN_FS_FS__DIR_INDEX_RECORD_LEN,
+                                       '\n'))
+        return svn_error_trace(err_corrupt_dir_index(noderev->id, iterpool));
+
+      if (entry_start >= entry_end || entry_end > table - terminator_len)
+        return svn_error_trace(err_corrupt_dir_index(noderev->id, iterpool));
+
+      /* Read and parse the entry. */
+      text = svn_stringbuf_create_ensure(entry_end - entry_start, iterpool);
+      text->len = entry_end - entry_start;
+      SVN_ERR(read_dir_index_bytes(text->data, fs, rev_file,
+                                   start + entry_start, text->len,
+                                   iterpool));
+      text->data[text->len] = '\0';
+
+      SVN_ERR_W(svn_hash__read_entry(&entry,
+                                     svn_stream_from_stringbuf(text,
+                                                               iterpool),
+                                     SVN_HASH_TERMINATOR, FALSE, iterpool),
+                apr_psprintf(iterpool,
+                             _("Directory representation corrupt in '%s'"),
+                             svn_fs_fs__id_unparse(noderev->id,
+                                                   iterpool)->data));
+      if (entry.key == NULL || entry.val == NULL)
+        return svn_error_trace(err_corrupt_dir_index(noderev->id, iterpool));
+
+      diff = strcmp(entry.key, name);
+      if (diff == 0)
+        {
+          SVN_ERR(parse_dir_entry(dirent, &entry, noderev->id, result_pool,
+                                  iterpool));
+          break;
+        }
+
+      if (diff < 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+}
+
 svn_error_t *
 svn_fs_fs__rep_contents_dir_entry(svn_fs_dirent_t **dirent,
                                   svn_fs_t *fs,
@@ -2884,6 +3773,9 @@ svn_fs_fs__rep_contents_dir_entry(svn_fs_dirent_t **dirent,
   extract_dir_entry_baton_t baton;
   svn_boolean_t found = FALSE;
 
+  /* Not set by cache misses. */
+  baton.out_of_date = FALSE;
+
   /* find the cache we may use */
   pair_cache_key_t pair_key = { 0 };
   const void *key;
@@ -2906,6 +3798,11 @@ svn_fs_fs__rep_contents_dir_entry(svn_fs_dirent_t **dirent,
                                      result_pool));
     }
 
+  /* Large committed directories may be searched on disk directly. */
+  if (! found)
+    SVN_ERR(find_indexed_dir_entry(dirent, &found, fs, noderev, name,
+                                   result_pool, scratch_pool));
+
   /* fetch data from disk if we did not find it in the cache */
   if (! found || baton.out_of_date)
     {
@@ -2949,7 +3846,9 @@ svn_fs_fs__get_proplist(apr_hash_t **proplist_p,
 {
   apr_hash_t *proplist;
   svn_stream_t *stream;
+  svn_stringbuf_t *content;
 
+  /* The property values in PROPLIST will point into CONTENT. */
   if (noderev->prop_rep && svn_fs_fs__id_txn_used(&noderev->prop_rep->txn_id))
     {
       svn_error_t *err;
@@ -2957,18 +3856,17 @@ svn_fs_fs__get_proplist(apr_hash_t **proplist_p,
         = svn_fs_fs__path_txn_node_props(fs, noderev->id, pool);
       proplist = apr_hash_make(pool);
 
-      SVN_ERR(svn_stream_open_readonly(&stream, filename, pool, pool));
-      err = svn_hash_read2(proplist, stream, SVN_HASH_TERMINATOR, pool);
+      SVN_ERR(svn_stringbuf_from_file2(&content, filename, pool));
+      err = svn_hash__read_buffer(proplist, content->data, content->len,
+                                  SVN_HASH_TERMINATOR, pool);
       if (err)
         {
           svn_string_t *id_str = svn_fs_fs__id_unparse(noderev->id, pool);
 
-          err = svn_error_compose_create(err, svn_stream_close(stream));
           return svn_error_quick_wrapf(err,
                    _("malformed property list for node-revision '%s' in '%s'"),
                    id_str->data, filename);
         }
-      SVN_ERR(svn_stream_close(stream));
     }
   else if (noderev->prop_rep)
     {
@@ -2986,22 +3884,28 @@ svn_fs_fs__get_proplist(apr_hash_t **proplist_p,
                                  ffd->properties_cache, &key, pool));
           if (is_cached)
             return SVN_NO_ERROR;
+
+          SVN_FS_FS__TRACE(fs, svn_fs_fs__trace_cache_miss, "props",
+                           key.revision, key.second, 0, 0, 0);
         }
 
       proplist = apr_hash_make(pool);
       SVN_ERR(svn_fs_fs__get_contents(&stream, fs, noderev->prop_rep, FALSE,
                                       pool));
-      err = svn_hash_read2(proplist, stream, SVN_HASH_TERMINATOR, pool);
+      SVN_ERR(svn_stringbuf_from_stream(&content, stream,
+                                        (apr_size_t)rep->expanded_size,
+                                        pool));
+      SVN_ERR(svn_stream_close(stream));
+      err = svn_hash__read_buffer(proplist, content->data, content->len,
+                                  SVN_HASH_TERMINATOR, pool);
       if (err)
         {
           svn_string_t *id_str = svn_fs_fs__id_unparse(noderev->id, pool);
 
-          err = svn_error_compose_create(err, svn_stream_close(stream));
           return svn_error_quick_wrapf(err,
                    _("malformed property list for node-revision '%s'"),
                    id_str->data);
         }
-      SVN_ERR(svn_stream_close(stream));
 
       if (ffd->properties_cache && SVN_IS_VALID_REVNUM(rep->revision))
         SVN_ERR(svn_cache__set(ffd->properties_cache, &key, proplist, pool));
@@ -3062,6 +3966,9 @@ svn_fs_fs__get_changes(apr_array_header_t **changes,
 
   if (!found)
     {
+      SVN_FS_FS__TRACE(context->fs, svn_fs_fs__trace_cache_miss, "changes",
+                       key.revision, key.second, 0, 0, 0);
+
       /* read changes from revision file */
 
       if (!context->revision_file)
@@ -3205,7 +4112,7 @@ init_rep_state(rep_state_t *rs,
   rs->start = entry->offset + rs->header_size;
   rs->current = rep_header->type == svn_fs_fs__rep_plain ? 0 : 4;
   rs->size = entry->size - rep_header->header_size - 7;
-  rs->ver = 1;
+  rs->ver = -1;
   rs->chunk_index = 0;
   rs->raw_window_cache = ffd->raw_window_cache;
   rs->window_cache = ffd->txdelta_window_cache;
@@ -3321,6 +4228,7 @@ cache_windows(svn_fs_t *fs,
 
           /* Construct the cachable raw window object. */
           window.end_offset = rs->current;
+          window.ver = rs->ver;
           window.window.len = window_len;
           window.window.data = buf;
 
@@ -3361,6 +4269,10 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
   apr_off_t offset;
   window_cache_key_t key = { 0 };
 
+  /* Chunk lists are not windows and will be read in one go. */
+  if (rep_header->type == svn_fs_fs__rep_chunked)
+    return SVN_NO_ERROR;
+
   if (   (rep_header->type != svn_fs_fs__rep_plain
           && (!ffd->txdelta_window_cache || !ffd->raw_window_cache))
       || (rep_header->type == svn_fs_fs__rep_plain
@@ -3401,6 +4313,8 @@ block_read_windows(svn_fs_fs__rep_header_t *rep_header,
     }
   else
     {
+      /* The svndiff version is required to parse the cached windows. */
+      SVN_ERR(auto_read_diff_version(&rs, scratch_pool));
       SVN_ERR(cache_windows(fs, &rs, max_offset, scratch_pool));
     }
 
@@ -3631,6 +4545,255 @@ block_read_noderev(node_revision_t **noderev_p,
   return SVN_NO_ERROR;
 }
 
+/* Item type names used in access traces, indexed by the
+ * SVN_FS_FS__ITEM_TYPE_* constants. */
+static const char * const trace_item_types[] =
+{
+  "unused", "file-rep", "dir-rep", "file-props", "dir-props",
+  "noderev", "changes", "any-rep"
+};
+
+/* Read the item described by ENTRY from the already open REVISION_FILE
+ * in FS and put it into the respective cache.  BLOCK_START is the start
+ * of the block currently being processed.  IS_WANTED is set for the item
+ * that the block read has been triggered for; IS_RESULT additionally
+ * means that node-revisions and change lists are to be returned in *ITEM,
+ * allocated in RESULT_POOL.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+block_read_item(void **item,
+                svn_fs_t *fs,
+                svn_fs_fs__revision_file_t *revision_file,
+                svn_fs_fs__p2l_entry_t *entry,
+                svn_boolean_t is_wanted,
+                svn_boolean_t is_result,
+                apr_off_t block_start,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_time_t start = SVN_FS_FS__TRACE_START(fs);
+
+  SVN_ERR(svn_io_file_seek(revision_file->file, APR_SET, &entry->offset,
+                           scratch_pool));
+  switch (entry->type)
+    {
+      case SVN_FS_FS__ITEM_TYPE_FILE_REP:
+      case SVN_FS_FS__ITEM_TYPE_DIR_REP:
+      case SVN_FS_FS__ITEM_TYPE_FILE_PROPS:
+      case SVN_FS_FS__ITEM_TYPE_DIR_PROPS:
+        SVN_ERR(block_read_contents(fs, revision_file, entry,
+                                    is_wanted
+                                      ? -1
+                                      : block_start + ffd->block_size,
+                                    scratch_pool));
+        break;
+
+      case SVN_FS_FS__ITEM_TYPE_NODEREV:
+        if (ffd->node_revision_cache || is_result)
+          SVN_ERR(block_read_noderev((node_revision_t **)item,
+                                     fs, revision_file,
+                                     entry, is_result, result_pool,
+                                     scratch_pool));
+        break;
+
+      case SVN_FS_FS__ITEM_TYPE_CHANGES:
+        SVN_ERR(block_read_changes(fs, revision_file, entry, scratch_pool));
+        break;
+
+      default:
+        return SVN_NO_ERROR;
+    }
+
+  SVN_FS_FS__TRACE(fs, svn_fs_fs__trace_item_read,
+                   trace_item_types[entry->type], entry->item.revision,
+                   entry->item.number, entry->offset, entry->size, start);
+
+  return SVN_NO_ERROR;
+}
+
+/* Maximum number of read-ahead jobs queued at any time per repository.
+ * Requests beyond that will simply not be prefetched.
+ */
+#define MAX_READ_AHEAD_JOBS 4
+
+#if APR_HAS_THREADS
+
+/* A read-ahead job as handed over to the helper thread.
+ */
+typedef struct read_ahead_t
+{
+  /* Repository-global data.  Survives the job. */
+  fs_fs_shared_data_t *shared;
+
+  /* Any revision within the rev / pack file to read from. */
+  svn_revnum_t revision;
+
+  /* Block-aligned section of the file to prefetch. */
+  apr_off_t start;
+  apr_off_t end;
+} read_ahead_t;
+
+/* Implements svn_atomic__init_once callback.  Create the read-ahead
+ * thread pool for the fs_fs_shared_data_t in BATON.  POOL is unused.
+ */
+static svn_error_t *
+create_read_ahead_threads(void *baton,
+                          apr_pool_t *pool)
+{
+  fs_fs_shared_data_t *shared = baton;
+
+  return svn_error_trace(svn_fs_fs__create_background_threads(
+                           &shared->read_ahead_threads, NULL,
+                           _("Can't create read-ahead thread")));
+}
+
+/* Read all small items starting in the blocks covered by JOB and put
+ * them into the caches.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_ahead(read_ahead_t *job,
+           svn_fs_t *fs,
+           apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__revision_file_t *rev_file;
+  apr_off_t block_start, max_offset;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, job->revision,
+                                           scratch_pool, iterpool));
+  SVN_ERR(svn_fs_fs__p2l_get_max_offset(&max_offset, fs, rev_file,
+                                        job->revision, iterpool));
+
+  for (block_start = job->start;
+       block_start < MIN(job->end, max_offset);
+       block_start += ffd->block_size)
+    {
+      apr_array_header_t *entries;
+      int i;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, fs, rev_file,
+                                          job->revision, block_start,
+                                          ffd->block_size, iterpool,
+                                          iterpool));
+      SVN_ERR(aligned_seek(fs, rev_file->file, &block_start, block_start,
+                           iterpool));
+
+      for (i = 0; i < entries->nelts; ++i)
+        {
+          svn_fs_fs__p2l_entry_t *entry
+            = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
+          void *item = NULL;
+
+          /* Same selection as in block_read. */
+          if (   entry->type == SVN_FS_FS__ITEM_TYPE_UNUSED
+              || entry->offset < block_start
+              || entry->size >= ffd->block_size)
+            continue;
+
+          SVN_ERR(block_read_item(&item, fs, rev_file, entry, FALSE, FALSE,
+                                  block_start, iterpool, iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_fs_fs__close_revision_file(rev_file));
+}
+
+/* Implements svn_fs_fs__background_func_t.  Execute the read_ahead_t
+ * in BATON.
+ */
+static void
+read_ahead_worker(void *baton,
+                  svn_fs_t *fs,
+                  apr_pool_t *pool)
+{
+  read_ahead_t *job = baton;
+
+  /* Prefetching is a mere optimization.  Anything that fails here will
+   * be read (and reported) on demand. */
+  svn_error_clear(read_ahead(job, fs, pool));
+  svn_atomic_dec(&job->shared->read_ahead_jobs);
+}
+
+#endif
+
+/* Block reads in FS have just reached OFFSET within the rev / pack file
+ * containing REVISION.  If enabled, queue the next blocks for read-ahead
+ * unless they have already been.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+schedule_read_ahead(svn_fs_t *fs,
+                    svn_revnum_t revision,
+                    apr_off_t offset,
+                    apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_revnum_t file_rev;
+  apr_off_t window, start, end;
+  read_ahead_t job;
+  svn_error_t *err;
+
+  /* The helper thread fills the same caches as we do, so they must be
+   * thread-safe. */
+  if (!ffd->block_read_ahead || svn_cache_config_get()->single_threaded)
+    return SVN_NO_ERROR;
+
+  window = ffd->block_read_ahead * ffd->block_size;
+  file_rev = svn_fs_fs__packed_base_rev(fs, revision);
+  start = offset;
+  end = offset + window;
+
+  /* Don't queue tiny increments while plenty of prefetched data remains
+   * ahead of us. */
+  if (   file_rev == ffd->read_ahead_file_rev
+      && offset < ffd->read_ahead_end)
+    {
+      if (offset + window / 2 < ffd->read_ahead_end)
+        return SVN_NO_ERROR;
+
+      start = ffd->read_ahead_end;
+    }
+
+  SVN_ERR(svn_atomic__init_once(&ffd->shared->read_ahead_initialized,
+                                create_read_ahead_threads, ffd->shared,
+                                NULL));
+
+  /* Limit the backlog.  Prefetched data arriving late is useless. */
+  if (svn_atomic_inc(&ffd->shared->read_ahead_jobs) >= MAX_READ_AHEAD_JOBS)
+    {
+      svn_atomic_dec(&ffd->shared->read_ahead_jobs);
+      return SVN_NO_ERROR;
+    }
+
+  job.shared = ffd->shared;
+  job.revision = revision;
+  job.start = start;
+  job.end = end;
+
+  err = svn_fs_fs__start_background_job(ffd->shared->read_ahead_threads, fs,
+                                        read_ahead_worker, &job, sizeof(job),
+                                        APR_THREAD_TASK_PRIORITY_NORMAL,
+                                        _("Can't queue read-ahead"),
+                                        scratch_pool);
+  if (err)
+    {
+      svn_atomic_dec(&ffd->shared->read_ahead_jobs);
+      return svn_error_trace(err);
+    }
+
+  ffd->read_ahead_file_rev = file_rev;
+  ffd->read_ahead_end = end;
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the whole (e.g. 64kB) block containing ITEM_INDEX of REVISION in FS
  * and put all data into cache.  If necessary and depending on heuristics,
  * neighboring blocks may also get read.  The data is being read from
@@ -3684,6 +4847,8 @@ block_read(void **result,
    */
   do
     {
+      apr_time_t start = SVN_FS_FS__TRACE_START(fs);
+
       /* fetch list of items in the block surrounding OFFSET */
       block_start = offset - (offset % ffd->block_size);
       SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, fs, revision_file,
@@ -3724,37 +4889,9 @@ block_read(void **result,
                             && entry->size < ffd->block_size))
             {
               void *item = NULL;
-              SVN_ERR(svn_io_file_seek(revision_file->file, APR_SET,
-                                       &entry->offset, iterpool));
-              switch (entry->type)
-                {
-                  case SVN_FS_FS__ITEM_TYPE_FILE_REP:
-                  case SVN_FS_FS__ITEM_TYPE_DIR_REP:
-                  case SVN_FS_FS__ITEM_TYPE_FILE_PROPS:
-                  case SVN_FS_FS__ITEM_TYPE_DIR_PROPS:
-                    SVN_ERR(block_read_contents(fs, revision_file, entry,
-                                                is_wanted
-                                                  ? -1
-                                                  : block_start + ffd->block_size,
-                                                iterpool));
-                    break;
-
-                  case SVN_FS_FS__ITEM_TYPE_NODEREV:
-                    if (ffd->node_revision_cache || is_result)
-                      SVN_ERR(block_read_noderev((node_revision_t **)&item,
-                                                 fs, revision_file,
-                                                 entry, is_result, pool,
-                                                 iterpool));
-                    break;
-
-                  case SVN_FS_FS__ITEM_TYPE_CHANGES:
-                    SVN_ERR(block_read_changes(fs, revision_file,
-                                               entry, iterpool));
-                    break;
-
-                  default:
-                    break;
-                }
+              SVN_ERR(block_read_item(&item, fs, revision_file, entry,
+                                      is_wanted, is_result, block_start,
+                                      pool, iterpool));
 
               if (is_result)
                 *result = item;
@@ -3767,6 +4904,8 @@ block_read(void **result,
             }
         }
 
+      SVN_FS_FS__TRACE(fs, svn_fs_fs__trace_block_read, NULL, revision,
+                       item_index, block_start, ffd->block_size, start);
     }
   while(run_count++ == 1); /* can only be true once and only if a block
                             * boundary got crossed */
@@ -3775,5 +4914,9 @@ block_read(void **result,
   assert(!result || *result);
   svn_pool_destroy(iterpool);
 
+  /* Data following this block will likely be requested next. */
+  SVN_ERR(schedule_read_ahead(fs, revision, block_start + ffd->block_size,
+                              scratch_pool));
+
   return SVN_NO_ERROR;
 }
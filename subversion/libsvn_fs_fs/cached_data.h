@@ -51,6 +51,20 @@ svn_fs_fs__get_node_revision(node_revision_t **noderev_p,
                              apr_pool_t *result_pool,
                              apr_pool_t *scratch_pool);
 
+/* Batched version of svn_fs_fs__get_node_revision.  For each of the
+   COUNT node IDS in FS, set NODEREVS[i] to the respective node-revision.
+   Committed node-revisions get looked up in the cache at once and those
+   not found get read from one rev / pack file after the other with
+   combined index lookups.  Allocate the results in RESULT_POOL and use
+   SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__get_node_revisions(node_revision_t **noderevs,
+                              svn_fs_t *fs,
+                              const svn_fs_id_t *const *ids,
+                              int count,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
 /* Set *ROOT_ID to the node-id for the root of revision REV in
    filesystem FS.  Do any allocations in POOL. */
 svn_error_t *
@@ -70,6 +84,15 @@ svn_fs_fs__check_rep(representation_t *rep,
                      void **hint,
                      apr_pool_t *scratch_pool);
 
+/* Set *CHUNKED to TRUE if REP in FS is a CHUNKED representation, i.e. a
+   list of other representations whose contents are to be concatenated.
+   Do any allocations in SCRATCH_POOL. */
+svn_error_t *
+svn_fs_fs__rep_is_chunked(svn_boolean_t *chunked,
+                          representation_t *rep,
+                          svn_fs_t *fs,
+                          apr_pool_t *scratch_pool);
+
 /* Follow the representation delta chain in FS starting with REP.  The
    number of reps (including REP) in the chain will be returned in
    *CHAIN_LENGTH.  *SHARD_COUNT will be set to the number of shards
@@ -119,6 +142,23 @@ svn_fs_fs__try_process_file_contents(svn_boolean_t *success,
                                      void* baton,
                                      apr_pool_t *pool);
 
+/* If the committed representation REP in filesystem FS is stored as
+   plain text or as a self-delta that merely inserts uncompressed data,
+   set *FILE to the revision or pack file containing it and *REGIONS to
+   the svn_fs__file_region_t within that file that make up the expanded
+   text.  Otherwise, or if REP is NULL, set *FILE to NULL.
+
+   Allocate *FILE and *REGIONS in RESULT_POOL and use SCRATCH_POOL for
+   temporaries.
+ */
+svn_error_t *
+svn_fs_fs__try_get_rep_regions(apr_file_t **file,
+                               apr_array_header_t **regions,
+                               svn_fs_t *fs,
+                               representation_t *rep,
+                               apr_pool_t *result_pool,
+                               apr_pool_t *scratch_pool);
+
 /* Set *STREAM_P to a delta stream turning the contents of the file SOURCE into
    the contents of the file TARGET, allocated in POOL.
    If SOURCE is null, the empty string will be used. */
@@ -37,6 +37,7 @@
 #include "svn_pools.h"
 
 #include "private/svn_debug.h"
+#include "private/svn_fs_fs_private.h"
 #include "private/svn_subr_private.h"
 
 /* Take the ORIGINAL string and replace all occurrences of ":" without
@@ -279,11 +280,43 @@ init_callbacks(svn_cache__t *cache,
   return SVN_NO_ERROR;
 }
 
+/* If FS has been configured to compress the cache with the given PREFIX,
+ * enable compression for the membuffer CACHE.  Without LZ4 support in
+ * this build, caches will remain uncompressed.
+ */
+static svn_error_t *
+configure_compression(svn_cache__t *cache,
+                      const char *prefix,
+                      svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_size_t prefix_len;
+  int i;
+
+  if (ffd->cache_compression_threshold == 0 || !svn__lz4_supported())
+    return SVN_NO_ERROR;
+
+  /* Only caches using the common prefix do have a configurable name.
+   * The remainder of their PREFIX is just that name. */
+  prefix_len = strlen(ffd->cache_prefix);
+  if (strncmp(prefix, ffd->cache_prefix, prefix_len))
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < ffd->compressed_caches->nelts; ++i)
+    if (!strcmp(prefix + prefix_len,
+                APR_ARRAY_IDX(ffd->compressed_caches, i, const char *)))
+      return svn_error_trace(svn_cache__membuffer_set_compression(
+                                 cache, ffd->cache_compression_threshold));
+
+  return SVN_NO_ERROR;
+}
+
 /* Sets *CACHE_P to cache instance based on provided options.
  * Creates memcache if MEMCACHE is not NULL. Creates membuffer cache if
- * MEMBUFFER is not NULL. Fallbacks to inprocess cache if MEMCACHE and
- * MEMBUFFER are NULL and pages is non-zero.  Sets *CACHE_P to NULL
- * otherwise.  Use the given PRIORITY class for the new cache.  If it
+ * MEMBUFFER is not NULL. If both are given and MEMCACHE shall be used as
+ * a second level cache, combine both. Fallbacks to inprocess cache if
+ * MEMCACHE and MEMBUFFER are NULL and pages is non-zero.  Sets *CACHE_P
+ * to NULL otherwise.  Use the given PRIORITY class for the new cache.  If it
  * is 0, then use the default priority class.  HAS_NAMESPACE indicates
  * whether we prefixed this cache instance with a namespace.
  *
@@ -315,7 +348,30 @@ create_cache(svn_cache__t **cache_p,
   if (priority == 0)
     priority = SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY;
 
-  if (memcache)
+  if (memcache && membuffer
+      && svn_cache__memcache_is_second_level(memcache))
+    {
+      svn_cache__t *l1;
+      svn_cache__t *l2;
+
+      /* Use memcached only for what we don't have locally.  Errors in
+       * the shared second level will merely be reported as warnings. */
+      SVN_ERR(svn_cache__create_membuffer_cache(
+                &l1, membuffer, serializer, deserializer,
+                klen, prefix, priority, FALSE, has_namespace,
+                result_pool, scratch_pool));
+      SVN_ERR(configure_compression(l1, prefix, fs));
+      SVN_ERR(svn_cache__create_memcache(&l2, memcache,
+                                         serializer, deserializer, klen,
+                                         prefix, result_pool));
+      SVN_ERR(init_callbacks(l2, fs,
+                             no_handler
+                               ? NULL
+                               : warn_and_continue_on_cache_errors,
+                             result_pool));
+      SVN_ERR(svn_cache__create_tiered(cache_p, l1, l2, result_pool));
+    }
+  else if (memcache)
     {
       SVN_ERR(svn_cache__create_memcache(cache_p, memcache,
                                          serializer, deserializer, klen,
@@ -332,6 +388,7 @@ create_cache(svn_cache__t **cache_p,
                 cache_p, membuffer, serializer, deserializer,
                 klen, prefix, priority, FALSE, has_namespace,
                 result_pool, scratch_pool));
+      SVN_ERR(configure_compression(*cache_p, prefix, fs));
     }
   else if (pages)
     {
@@ -377,9 +434,27 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
 
   prefix = apr_pstrcat(pool, "ns:", cache_namespace, ":", prefix, SVN_VA_NULL);
   has_namespace = strlen(cache_namespace) > 0;
+  ffd->cache_prefix = apr_pstrdup(fs->pool, prefix);
 
   membuffer = svn_cache__get_global_membuffer_cache();
 
+  /* Allow our data to be spilled to disk.  The youngest revision lets
+   * later processes detect repositories that have been rolled back.
+   * If we can't determine it, e.g. during repository creation, this
+   * instance simply won't use the spill file.  The same goes for any
+   * spill file trouble. */
+  if (membuffer && svn_cache__membuffer_has_spill_file(membuffer))
+    {
+      svn_revnum_t youngest;
+      svn_error_t *err = svn_fs_fs__youngest_rev(&youngest, fs, pool);
+
+      if (!err)
+        err = svn_cache__membuffer_spill_namespace(membuffer, prefix,
+                                                   youngest);
+
+      svn_error_clear(err);
+    }
+
   /* General rules for assigning cache priorities:
    *
    * - Data that can be reconstructed from other elements has low prio
@@ -657,11 +732,27 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
                            fs,
                            no_handler,
                            fs->pool, pool));
+
+      SVN_ERR(create_cache(&(ffd->combined_chunk_cache),
+                           NULL,
+                           membuffer,
+                           0, 0, /* Do not use the inprocess cache */
+                           svn_fs_fs__serialize_combined_chunk,
+                           svn_fs_fs__deserialize_combined_chunk,
+                           sizeof(window_cache_key_t),
+                           apr_pstrcat(pool, prefix, "COMBINED_CHUNK",
+                                       SVN_VA_NULL),
+                           SVN_CACHE__MEMBUFFER_LOW_PRIORITY,
+                           has_namespace,
+                           fs,
+                           no_handler,
+                           fs->pool, pool));
     }
   else
     {
       ffd->txdelta_window_cache = NULL;
       ffd->combined_window_cache = NULL;
+      ffd->combined_chunk_cache = NULL;
     }
 
   SVN_ERR(create_cache(&(ffd->l2p_header_cache),
@@ -730,6 +821,102 @@ svn_fs_fs__initialize_caches(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Set *YOUNGEST to the youngest revision in FS and *STATE to a string
+ * describing all other aspects of FS that cached data depends on.
+ * Allocate the result in POOL.
+ */
+static svn_error_t *
+get_snapshot_state(svn_revnum_t *youngest,
+                   const char **state,
+                   svn_fs_t *fs,
+                   apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_revnum_t min_unpacked_rev = 0;
+
+  /* Packing moves data around, i.e. cached offsets become invalid. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
+    SVN_ERR(svn_fs_fs__min_unpacked_rev(&min_unpacked_rev, fs, pool));
+
+  SVN_ERR(svn_fs_fs__youngest_rev(youngest, fs, pool));
+  *state = apr_psprintf(pool, "%d %d %ld", ffd->format,
+                        ffd->max_files_per_dir, min_unpacked_rev);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__dump_cache(svn_fs_t *fs,
+                      svn_stream_t *stream,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  svn_revnum_t youngest;
+  const char *state;
+
+  if (!membuffer)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Caching is disabled"));
+
+  SVN_ERR(get_snapshot_state(&youngest, &state, fs, scratch_pool));
+  SVN_ERR(svn_cache__membuffer_dump(membuffer, stream, ffd->cache_prefix,
+                                    youngest, state, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__load_cache(svn_boolean_t *loaded,
+                      svn_fs_t *fs,
+                      svn_stream_t *stream,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  svn_revnum_t youngest;
+  const char *state;
+
+  *loaded = FALSE;
+  if (!membuffer)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_snapshot_state(&youngest, &state, fs, scratch_pool));
+  SVN_ERR(svn_cache__membuffer_load(loaded, membuffer, stream,
+                                    ffd->cache_prefix, youngest, state,
+                                    scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__preload_caches(svn_fs_t *fs,
+                          apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_stream_t *stream;
+  svn_boolean_t loaded;
+  svn_error_t *err;
+
+  /* Only the first instance within this process shall do the work. */
+  if (   !ffd->cache_snapshot_file
+      || svn_atomic_cas(&ffd->shared->cache_snapshot_loaded, 1, 0) != 0)
+    return SVN_NO_ERROR;
+
+  /* The snapshot is merely an optimization.  Ignore missing, outdated
+   * or otherwise unusable ones. */
+  err = svn_stream_open_readonly(&stream, ffd->cache_snapshot_file,
+                                 scratch_pool, scratch_pool);
+  if (!err)
+    err = svn_error_compose_create(svn_fs_fs__load_cache(&loaded, fs, stream,
+                                                         scratch_pool),
+                                   svn_stream_close(stream));
+
+  svn_error_clear(err);
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton to be used for the remove_txn_cache() pool cleanup function, */
 struct txn_cleanup_baton_t
 {
@@ -0,0 +1,513 @@
+/* changed_paths.c --- per-shard index of changed paths
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_pools.h"
+#include "svn_hash.h"
+#include "svn_sorts.h"
+#include "svn_dirent_uri.h"
+#include "private/svn_fspath.h"
+#include "private/svn_fs_util.h"
+#include "private/svn_sorts_private.h"
+
+#include "fs.h"
+#include "cached_data.h"
+#include "changed_paths.h"
+#include "util.h"
+
+#include "svn_private_config.h"
+
+/* The index file starts with this line, followed by a line with the
+ * number of entries.  Each entry is a line of the form
+ *
+ *   <offset><kind>[,<offset><kind>...] <path>
+ *
+ * where <offset> is the revision relative to the first revision of the
+ * shard and <kind> is 'm' for plain modifications and 'x' for additions,
+ * deletions and replacements.  Entries are sorted by path in strcmp
+ * order, such that all paths below some directory form a single range.
+ */
+#define CHANGED_PATHS_HEADER "changed-paths 1\n"
+
+/* One line of a changed paths index. */
+typedef struct index_entry_t
+{
+  /* Changed path in the repository, starting with a slash. */
+  const char *path;
+
+  /* List of revision offsets and change kinds, see CHANGED_PATHS_HEADER. */
+  const char *revs;
+} index_entry_t;
+
+/* Return TRUE if a change of CHANGE_KIND at CHANGE_PATH touched PATH
+ * in the sense of svn_fs_revisions_changed(). */
+static svn_boolean_t
+change_touches_path(const char *change_path,
+                    svn_fs_path_change_kind_t change_kind,
+                    const char *path)
+{
+  if (svn_fspath__skip_ancestor(path, change_path))
+    return TRUE;
+
+  return change_kind != svn_fs_path_change_modify
+      && svn_fspath__skip_ancestor(change_path, path) != NULL;
+}
+
+/* Invoke RECEIVER with BATON for all changes in revision REV of FS.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+walk_changes(svn_fs_t *fs,
+             svn_revnum_t rev,
+             svn_error_t *(*receiver)(void *baton,
+                                      const change_t *change,
+                                      apr_pool_t *scratch_pool),
+             void *baton,
+             apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__changes_context_t *context;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_fs_fs__create_changes_context(&context, fs, rev,
+                                            scratch_pool));
+  while (!context->eol)
+    {
+      apr_array_header_t *changes;
+      int i;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__get_changes(&changes, context, iterpool,
+                                     iterpool));
+      for (i = 0; i < changes->nelts; ++i)
+        SVN_ERR(receiver(baton, APR_ARRAY_IDX(changes, i, change_t *),
+                         iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for add_to_index(). */
+typedef struct add_to_index_baton_t
+{
+  /* Maps changed paths to svn_stringbuf_t * lists of revisions. */
+  apr_hash_t *paths;
+
+  /* Offset of the current revision within the shard. */
+  int offset;
+} add_to_index_baton_t;
+
+/* Receiver for walk_changes(), recording CHANGE in the
+ * add_to_index_baton_t BATON. */
+static svn_error_t *
+add_to_index(void *baton,
+             const change_t *change,
+             apr_pool_t *scratch_pool)
+{
+  add_to_index_baton_t *b = baton;
+  apr_pool_t *pool = apr_hash_pool_get(b->paths);
+  svn_stringbuf_t *revs = apr_hash_get(b->paths, change->path.data,
+                                       change->path.len);
+
+  if (revs)
+    {
+      svn_stringbuf_appendbyte(revs, ',');
+    }
+  else
+    {
+      revs = svn_stringbuf_create_empty(pool);
+      apr_hash_set(b->paths,
+                   apr_pstrmemdup(pool, change->path.data, change->path.len),
+                   change->path.len, revs);
+    }
+
+  svn_stringbuf_appendcstr(revs, apr_itoa(scratch_pool, b->offset));
+  svn_stringbuf_appendbyte(revs,
+                           change->info.change_kind
+                             == svn_fs_path_change_modify ? 'm' : 'x');
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__write_changed_paths_index(svn_fs_t *fs,
+                                     const char *pack_file_dir,
+                                     svn_revnum_t shard_rev,
+                                     int max_files_per_dir,
+                                     svn_cancel_func_t cancel_func,
+                                     void *cancel_baton,
+                                     apr_pool_t *scratch_pool)
+{
+  add_to_index_baton_t baton;
+  apr_array_header_t *sorted;
+  svn_stringbuf_t *contents;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  baton.paths = svn_hash__make(scratch_pool);
+  for (baton.offset = 0; baton.offset < max_files_per_dir; ++baton.offset)
+    {
+      svn_pool_clear(iterpool);
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      SVN_ERR(walk_changes(fs, shard_rev + baton.offset, add_to_index,
+                           &baton, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  sorted = svn_sort__hash(baton.paths, svn_sort_compare_items_lexically,
+                          scratch_pool);
+  contents = svn_stringbuf_create(CHANGED_PATHS_HEADER, scratch_pool);
+  svn_stringbuf_appendcstr(contents, apr_psprintf(scratch_pool, "%d\n",
+                                                  sorted->nelts));
+  for (i = 0; i < sorted->nelts; ++i)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(sorted, i, svn_sort__item_t);
+      svn_stringbuf_t *revs = item->value;
+
+      svn_stringbuf_appendbytes(contents, revs->data, revs->len);
+      svn_stringbuf_appendbyte(contents, ' ');
+      svn_stringbuf_appendbytes(contents, item->key, item->klen);
+      svn_stringbuf_appendbyte(contents, '\n');
+    }
+
+  return svn_error_trace(svn_io_file_create(
+                           svn_dirent_join(pack_file_dir, PATH_CHANGED_PATHS,
+                                           scratch_pool),
+                           contents->data, scratch_pool));
+}
+
+/* Read the changed paths index of the packed shard containing SHARD_REV
+ * in FS and return its entries in *ENTRIES, allocated in RESULT_POOL.
+ * Set *ENTRIES to NULL if the shard has no index.  Use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+read_changed_paths_index(apr_array_header_t **entries,
+                         svn_fs_t *fs,
+                         svn_revnum_t shard_rev,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  const char *path = svn_fs_fs__path_rev_packed(fs, shard_rev,
+                                                PATH_CHANGED_PATHS,
+                                                scratch_pool);
+  svn_stringbuf_t *contents;
+  apr_int64_t count;
+  char *line, *next;
+  const char *prev_path = NULL;
+  svn_error_t *err;
+
+  err = svn_stringbuf_from_file2(&contents, path, result_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *entries = NULL;
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  if (strncmp(contents->data, CHANGED_PATHS_HEADER,
+              sizeof(CHANGED_PATHS_HEADER) - 1))
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Changed paths index '%s' has an "
+                               "unsupported format"),
+                             svn_dirent_local_style(path, scratch_pool));
+
+  line = contents->data + sizeof(CHANGED_PATHS_HEADER) - 1;
+  next = strchr(line, '\n');
+  if (!next)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Changed paths index '%s' is truncated"),
+                             svn_dirent_local_style(path, scratch_pool));
+
+  *next = '\0';
+  SVN_ERR(svn_cstring_atoi64(&count, line));
+  *entries = apr_array_make(result_pool, (int)count, sizeof(index_entry_t));
+
+  for (line = next + 1; *line; line = next + 1)
+    {
+      index_entry_t *entry = apr_array_push(*entries);
+      char *space;
+
+      next = strchr(line, '\n');
+      space = strchr(line, ' ');
+      if (!next || !space || space > next || space[1] != '/')
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Malformed entry in changed paths "
+                                   "index '%s'"),
+                                 svn_dirent_local_style(path,
+                                                        scratch_pool));
+
+      *space = '\0';
+      *next = '\0';
+      entry->revs = line;
+      entry->path = space + 1;
+
+      /* Lookups rely on the entries being sorted. */
+      if (prev_path && strcmp(prev_path, entry->path) >= 0)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Changed paths index '%s' is not "
+                                   "sorted"),
+                                 svn_dirent_local_style(path,
+                                                        scratch_pool));
+      prev_path = entry->path;
+    }
+
+  if ((*entries)->nelts != count)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Changed paths index '%s' is truncated"),
+                             svn_dirent_local_style(path, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the index of the first element in ENTRIES whose path is not
+ * smaller than PATH. */
+static int
+lower_bound(const apr_array_header_t *entries,
+            const char *path)
+{
+  int lower = 0;
+  int upper = entries->nelts;
+
+  while (lower < upper)
+    {
+      int middle = lower + (upper - lower) / 2;
+      const index_entry_t *entry = &APR_ARRAY_IDX(entries, middle,
+                                                  index_entry_t);
+      if (strcmp(entry->path, path) < 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  return lower;
+}
+
+/* Set TOUCHED[offset] for all revision offsets listed in ENTRY.  If
+ * STRUCTURAL_ONLY is set, ignore plain modifications. */
+static void
+mark_revisions(svn_boolean_t *touched,
+               int max_files_per_dir,
+               const index_entry_t *entry,
+               svn_boolean_t structural_only)
+{
+  const char *p = entry->revs;
+
+  while (*p)
+    {
+      int offset = 0;
+
+      while (*p >= '0' && *p <= '9')
+        offset = offset * 10 + (*p++ - '0');
+
+      if (   offset < max_files_per_dir
+          && (*p == 'x' || (*p == 'm' && !structural_only)))
+        touched[offset] = TRUE;
+
+      /* Skip the kind and the separator. */
+      while (*p && *p != ',')
+        ++p;
+      if (*p == ',')
+        ++p;
+    }
+}
+
+/* Set *TOUCHED to a newly allocated array that, for each revision of
+ * the packed shard starting at SHARD_REV in FS, tells whether it touched
+ * PATH.  Set *TOUCHED to NULL if that shard has no changed paths index.
+ * Allocate the result in RESULT_POOL and use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+shard_revisions_changed(svn_boolean_t **touched,
+                        svn_fs_t *fs,
+                        svn_revnum_t shard_rev,
+                        const char *path,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  int max_files_per_dir = ffd->max_files_per_dir;
+  apr_array_header_t *entries;
+  const char *parent;
+  int i;
+
+  SVN_ERR(read_changed_paths_index(&entries, fs, shard_rev, scratch_pool,
+                                   scratch_pool));
+  if (!entries)
+    {
+      *touched = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  *touched = apr_pcalloc(result_pool,
+                         max_files_per_dir * sizeof(**touched));
+
+  /* Changes to PATH itself and anything below it. */
+  if (svn_fspath__is_root(path, strlen(path)))
+    {
+      for (i = 0; i < entries->nelts; ++i)
+        mark_revisions(*touched, max_files_per_dir,
+                       &APR_ARRAY_IDX(entries, i, index_entry_t), FALSE);
+
+      return SVN_NO_ERROR;
+    }
+
+  i = lower_bound(entries, path);
+  if (   i < entries->nelts
+      && strcmp(APR_ARRAY_IDX(entries, i, index_entry_t).path, path) == 0)
+    mark_revisions(*touched, max_files_per_dir,
+                   &APR_ARRAY_IDX(entries, i, index_entry_t), FALSE);
+
+  for (i = lower_bound(entries, apr_pstrcat(scratch_pool, path, "/",
+                                            SVN_VA_NULL));
+       i < entries->nelts;
+       ++i)
+    {
+      const index_entry_t *entry = &APR_ARRAY_IDX(entries, i,
+                                                  index_entry_t);
+      if (!svn_fspath__skip_ancestor(path, entry->path))
+        break;
+
+      mark_revisions(*touched, max_files_per_dir, entry, FALSE);
+    }
+
+  /* Nodes getting added, deleted or replaced further up the tree. */
+  for (parent = svn_fspath__dirname(path, scratch_pool);
+       ;
+       parent = svn_fspath__dirname(parent, scratch_pool))
+    {
+      i = lower_bound(entries, parent);
+      if (   i < entries->nelts
+          && strcmp(APR_ARRAY_IDX(entries, i, index_entry_t).path,
+                    parent) == 0)
+        mark_revisions(*touched, max_files_per_dir,
+                       &APR_ARRAY_IDX(entries, i, index_entry_t), TRUE);
+
+      if (svn_fspath__is_root(parent, strlen(parent)))
+        break;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for check_change(). */
+typedef struct check_change_baton_t
+{
+  /* The path to look for. */
+  const char *path;
+
+  /* Set when a change touching PATH has been found. */
+  svn_boolean_t touched;
+} check_change_baton_t;
+
+/* Receiver for walk_changes(), checking whether CHANGE touched the path
+ * given in the check_change_baton_t BATON. */
+static svn_error_t *
+check_change(void *baton,
+             const change_t *change,
+             apr_pool_t *scratch_pool)
+{
+  check_change_baton_t *b = baton;
+  if (change_touches_path(change->path.data, change->info.change_kind,
+                          b->path))
+    b->touched = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__revisions_changed(apr_array_header_t **revisions,
+                             svn_fs_t *fs,
+                             const char *path,
+                             svn_revnum_t start,
+                             svn_revnum_t end,
+                             int limit,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  int max_files_per_dir = ffd->max_files_per_dir;
+  apr_array_header_t *result;
+  apr_pool_t *iterpool;
+  svn_revnum_t rev;
+
+  *revisions = NULL;
+
+  /* Without indexes, we could only read every change list. */
+  if (!ffd->changed_paths_index || max_files_per_dir == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, scratch_pool));
+  if (end - MAX(start, ffd->min_unpacked_rev) >= max_files_per_dir)
+    return SVN_NO_ERROR;
+
+  path = svn_fs__canonicalize_abspath(path, scratch_pool);
+  result = apr_array_make(result_pool, 16, sizeof(svn_revnum_t));
+  iterpool = svn_pool_create(scratch_pool);
+
+  for (rev = end;
+       rev >= start && (limit <= 0 || result->nelts < limit);
+       )
+    {
+      svn_pool_clear(iterpool);
+
+      if (svn_fs_fs__is_packed_rev(fs, rev))
+        {
+          svn_revnum_t shard_rev = rev - rev % max_files_per_dir;
+          svn_boolean_t *touched;
+
+          SVN_ERR(shard_revisions_changed(&touched, fs, shard_rev, path,
+                                          iterpool, iterpool));
+          if (!touched)
+            {
+              svn_pool_destroy(iterpool);
+              return SVN_NO_ERROR;
+            }
+
+          for (; rev >= MAX(start, shard_rev); --rev)
+            if (   touched[rev - shard_rev]
+                && (limit <= 0 || result->nelts < limit))
+              APR_ARRAY_PUSH(result, svn_revnum_t) = rev;
+        }
+      else
+        {
+          check_change_baton_t baton;
+          baton.path = path;
+          baton.touched = FALSE;
+
+          SVN_ERR(walk_changes(fs, rev, check_change, &baton, iterpool));
+          if (baton.touched)
+            APR_ARRAY_PUSH(result, svn_revnum_t) = rev;
+
+          --rev;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  *revisions = result;
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,64 @@
+/* changed_paths.h : interface to the per-shard changed paths index
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_CHANGED_PATHS_H
+#define SVN_LIBSVN_FS_FS_CHANGED_PATHS_H
+
+#include "svn_fs.h"
+
+/* A packed shard may come with an index that maps every path changed in
+ * any of its revisions to the list of those revisions.  It allows to
+ * answer "which revisions touched PATH" for a whole shard with a single
+ * small read instead of reading one change list per revision.
+ */
+
+/* Write the changed paths index for the shard starting at SHARD_REV and
+ * containing MAX_FILES_PER_DIR revisions of FS into PACK_FILE_DIR.  The
+ * revisions must not have been switched over to the packed shard yet.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__write_changed_paths_index(svn_fs_t *fs,
+                                     const char *pack_file_dir,
+                                     svn_revnum_t shard_rev,
+                                     int max_files_per_dir,
+                                     svn_cancel_func_t cancel_func,
+                                     void *cancel_baton,
+                                     apr_pool_t *scratch_pool);
+
+/* Implements svn_fs_revisions_changed() for FSFS.  Packed shards are
+ * looked up in their changed paths indexes and at most one shard worth of
+ * non-packed revisions will be read directly.  If changed paths indexes
+ * are disabled for FS, a packed shard in the range has no index or there
+ * are more non-packed revisions to scan, set *REVISIONS to NULL.
+ */
+svn_error_t *
+svn_fs_fs__revisions_changed(apr_array_header_t **revisions,
+                             svn_fs_t *fs,
+                             const char *path,
+                             svn_revnum_t start,
+                             svn_revnum_t end,
+                             int limit,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool);
+
+#endif
@@ -1019,6 +1019,22 @@ svn_fs_fs__dag_try_process_file_contents(svn_boolean_t *success,
                                               processor, baton, pool);
 }
 
+svn_error_t *
+svn_fs_fs__dag_try_get_contents_regions(apr_file_t **file,
+                                        apr_array_header_t **regions,
+                                        dag_node_t *node,
+                                        apr_pool_t *result_pool,
+                                        apr_pool_t *scratch_pool)
+{
+  node_revision_t *noderev;
+
+  SVN_ERR(get_node_revision(&noderev, node));
+
+  return svn_fs_fs__try_get_rep_regions(file, regions, node->fs,
+                                        noderev->data_rep,
+                                        result_pool, scratch_pool);
+}
+
 
 svn_error_t *
 svn_fs_fs__dag_file_length(svn_filesize_t *length,
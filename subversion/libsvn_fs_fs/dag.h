@@ -426,6 +426,19 @@ svn_fs_fs__dag_try_process_file_contents(svn_boolean_t *success,
                                          void* baton,
                                          apr_pool_t *pool);
 
+/* Attempt to locate the contents of NODE as verbatim byte ranges on disk.
+   See svn_fs_fs__try_get_rep_regions() for the details.
+
+   Allocate *FILE and *REGIONS in RESULT_POOL and use SCRATCH_POOL for
+   temporaries.
+ */
+svn_error_t *
+svn_fs_fs__dag_try_get_contents_regions(apr_file_t **file,
+                                        apr_array_header_t **regions,
+                                        dag_node_t *node,
+                                        apr_pool_t *result_pool,
+                                        apr_pool_t *scratch_pool);
+
 
 /* Set *STREAM_P to a delta stream that will turn the contents of SOURCE into
    the contents of TARGET, allocated in POOL.  If SOURCE is null, the empty
@@ -31,9 +31,12 @@
 #include "svn_fs.h"
 #include "svn_delta.h"
 #include "svn_version.h"
+#include "svn_hash.h"
 #include "svn_pools.h"
 #include "fs.h"
 #include "fs_fs.h"
+#include "batch_fsync.h"
+#include "changed_paths.h"
 #include "tree.h"
 #include "lock.h"
 #include "hotcopy.h"
@@ -123,6 +126,15 @@ fs_serialized_init(svn_fs_t *fs, apr_pool_t *common_pool, apr_pool_t *pool)
          transaction list and free transaction pointer. */
       SVN_ERR(svn_mutex__init(&ffsd->txn_list_lock, TRUE, common_pool));
 
+      /* Group commits need a queue of waiting committers, too. */
+      SVN_ERR(svn_mutex__init(&ffsd->group_commit_lock, TRUE, common_pool));
+#if APR_HAS_THREADS
+      status = apr_thread_cond_create(&ffsd->group_commit_done, common_pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create condition variable"));
+#endif
+
       key = apr_pstrdup(common_pool, key);
       status = apr_pool_userdata_set(ffsd, key, NULL, common_pool);
       if (status)
@@ -279,7 +291,9 @@ static fs_vtable_t fs_vtable = {
   fs_info,
   svn_fs_fs__verify_root,
   fs_freeze,
-  fs_set_errcall
+  fs_set_errcall,
+  svn_fs_fs__revisions_changed,
+  svn_fs_fs__sync
 };
 
 
@@ -359,12 +373,53 @@ fs_open(svn_fs_t *fs,
   SVN_ERR(svn_fs_fs__initialize_caches(fs, subpool));
   SVN_MUTEX__WITH_LOCK(common_pool_lock,
                        fs_serialized_init(fs, common_pool, subpool));
+  SVN_ERR(svn_fs_fs__preload_caches(fs, subpool));
 
   svn_pool_destroy(subpool);
 
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__open_private(svn_fs_t **new_fs_p,
+                        svn_fs_t *fs,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  svn_fs_t *new_fs = apr_pcalloc(result_pool, sizeof(*new_fs));
+  fs_fs_data_t *ffd = fs->fsap_data;
+  fs_fs_data_t *new_ffd;
+
+  new_fs->pool = result_pool;
+  new_fs->warning = fs->warning;
+  new_fs->warning_baton = fs->warning_baton;
+
+  if (fs->config)
+    {
+      apr_hash_index_t *hi;
+
+      new_fs->config = apr_hash_make(result_pool);
+      for (hi = apr_hash_first(scratch_pool, fs->config);
+           hi;
+           hi = apr_hash_next(hi))
+        svn_hash_sets(new_fs->config,
+                      apr_pstrdup(result_pool, apr_hash_this_key(hi)),
+                      apr_pstrdup(result_pool, apr_hash_this_val(hi)));
+    }
+
+  SVN_ERR(initialize_fs_struct(new_fs));
+  SVN_ERR(svn_fs_fs__open(new_fs, fs->path, scratch_pool));
+  SVN_ERR(svn_fs_fs__initialize_caches(new_fs, scratch_pool));
+
+  /* The shared data lives in the process-wide common pool. */
+  new_ffd = new_fs->fsap_data;
+  new_ffd->shared = ffd->shared;
+
+  *new_fs_p = new_fs;
+
+  return SVN_NO_ERROR;
+}
+
 
 
 /* This implements the fs_library_vtable_t.open_for_recovery() API. */
@@ -625,6 +680,8 @@ svn_fs_fs__init(const svn_version_t *loader_version,
                              loader_version->major);
   SVN_ERR(svn_ver_check_list2(fs_version(), checklist, svn_ver_equal));
 
+  SVN_ERR(svn_fs_fs__batch_fsync_init(common_pool));
+
   *vtable = &library_vtable;
   return SVN_NO_ERROR;
 }
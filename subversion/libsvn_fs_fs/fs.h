@@ -28,6 +28,10 @@
 #include <apr_network_io.h>
 #include <apr_md5.h>
 #include <apr_sha1.h>
+#if APR_HAS_THREADS
+#include <apr_thread_pool.h>
+#include <apr_thread_cond.h>
+#endif
 
 #include "svn_fs.h"
 #include "svn_config.h"
@@ -70,6 +74,8 @@ extern "C" {
                                                  /* Current revprop generation*/
 #define PATH_MANIFEST         "manifest"         /* Manifest file name */
 #define PATH_PACKED           "pack"             /* Packed revision data file */
+#define PATH_CHANGED_PATHS    "changed-paths"    /* Changed paths index of
+                                                    a packed shard */
 #define PATH_EXT_PACKED_SHARD ".pack"            /* Extension for packed
                                                     shards */
 #define PATH_EXT_L2P_INDEX    ".l2p"             /* extension of the log-
@@ -91,6 +97,8 @@ extern "C" {
 #define PATH_EXT_REV_LOCK  ".rev-lock"     /* Extension of protorev lock file */
 #define PATH_TXN_ITEM_INDEX "itemidx"      /* File containing the current item
                                               index number */
+#define PATH_TXN_CHUNK_REPS "chunk-reps"   /* New chunk reps to be added to
+                                              the rep-cache */
 #define PATH_INDEX          "index"        /* name of index files w/o ext */
 
 /* Names of files in legacy FS formats */
@@ -100,23 +108,45 @@ extern "C" {
 /* Names of sections and options in fsfs.conf. */
 #define CONFIG_SECTION_CACHES            "caches"
 #define CONFIG_OPTION_FAIL_STOP          "fail-stop"
+#define CONFIG_OPTION_SNAPSHOT_FILE      "snapshot-file"
+#define CONFIG_OPTION_COMPRESSION_THRESHOLD "compression-threshold"
+#define CONFIG_OPTION_COMPRESSED_CACHES  "compressed-caches"
+#define CONFIG_OPTION_HISTORY_INDEX      "history-index"
 #define CONFIG_SECTION_REP_SHARING       "rep-sharing"
 #define CONFIG_OPTION_ENABLE_REP_SHARING "enable-rep-sharing"
+#define CONFIG_OPTION_CHUNKED_REP_THRESHOLD     "chunked-rep-threshold"
+#define CONFIG_OPTION_ASYNC_REP_CACHE_UPDATES   "async-rep-cache-updates"
+#define CONFIG_OPTION_REP_CACHE_FILTER          "rep-cache-filter"
 #define CONFIG_SECTION_DELTIFICATION     "deltification"
 #define CONFIG_OPTION_ENABLE_DIR_DELTIFICATION   "enable-dir-deltification"
 #define CONFIG_OPTION_ENABLE_PROPS_DELTIFICATION "enable-props-deltification"
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
+#define CONFIG_OPTION_COMPRESSION        "compression"
+#define CONFIG_OPTION_LARGE_REP_THRESHOLD       "large-rep-threshold"
+#define CONFIG_OPTION_LARGE_REP_COMPRESSION     "large-rep-compression"
+#define CONFIG_OPTION_UNCOMPRESSED_MIME_TYPES   "uncompressed-mime-types"
+#define CONFIG_OPTION_ENABLE_SIMILARITY_DELTIFICATION \
+                                        "enable-similarity-deltification"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
 #define CONFIG_OPTION_COMPRESS_PACKED_REVPROPS  "compress-packed-revprops"
+#define CONFIG_SECTION_PACKING           "packing"
+#define CONFIG_OPTION_BACKGROUND_PACK    "background-pack"
+#define CONFIG_OPTION_CHANGED_PATHS_INDEX       "changed-paths-index"
 #define CONFIG_SECTION_IO                "io"
 #define CONFIG_OPTION_BLOCK_SIZE         "block-size"
 #define CONFIG_OPTION_L2P_PAGE_SIZE      "l2p-page-size"
 #define CONFIG_OPTION_P2L_PAGE_SIZE      "p2l-page-size"
+#define CONFIG_OPTION_BLOCK_READ_AHEAD   "block-read-ahead"
+#define CONFIG_OPTION_MEMORY_MAP         "memory-map"
+#define CONFIG_SECTION_COMMIT            "commit"
+#define CONFIG_OPTION_GROUP_COMMIT       "group-commit"
 #define CONFIG_SECTION_DEBUG             "debug"
 #define CONFIG_OPTION_PACK_AFTER_COMMIT  "pack-after-commit"
+#define CONFIG_OPTION_TRACE_FILE         "trace-file"
+#define CONFIG_OPTION_TRACE_BUFFER_SIZE  "trace-buffer-size"
 
 /* The format number of this filesystem.
    This is independent of the repository format number, and
@@ -125,11 +155,31 @@ extern "C" {
    Note: If you bump this, please update the switch statement in
          svn_fs_fs__create() as well.
  */
-#define SVN_FS_FS__FORMAT_NUMBER   7
+#define SVN_FS_FS__FORMAT_NUMBER   8
 
 /* The minimum format number that supports svndiff version 1.  */
 #define SVN_FS_FS__MIN_SVNDIFF1_FORMAT 2
 
+/* The minimum format number that supports svndiff version 2. */
+#define SVN_FS_FS__MIN_SVNDIFF2_FORMAT 8
+
+/* The minimum format number that supports CHUNKED representations. */
+#define SVN_FS_FS__MIN_CHUNKED_REP_FORMAT 8
+
+/* The minimum format number that writes indexed revprop pack files. */
+#define SVN_FS_FS__MIN_INDEXED_REVPROP_PACK_FORMAT 8
+
+/* The minimum format number that supports indexed directory reps. */
+#define SVN_FS_FS__MIN_DIR_INDEX_FORMAT 8
+
+/* The minimum format number that stores mutable directories in txns as
+   change logs against their committed base representation. */
+#define SVN_FS_FS__MIN_DIR_CHANGE_LOG_FORMAT 8
+
+/* The minimum format number that may add changed paths indexes to packed
+   shards. */
+#define SVN_FS_FS__MIN_CHANGED_PATHS_INDEX_FORMAT 8
+
 /* The minimum format number that supports transaction ID generation
    using a transaction sequence in the txn-current file. */
 #define SVN_FS_FS__MIN_TXN_CURRENT_FORMAT 3
@@ -241,7 +291,8 @@ typedef struct fs_fs_shared_data_t
      declaration here.  Any subset may be acquired and held at any given
      time but their relative acquisition order must not change.
 
-     (lock 'txn-current' before 'pack' before 'write' before 'txn-list') */
+     (lock 'txn-current' before 'pack' before 'write' before 'txn-list'
+      and before 'group-commit') */
 
   /* A lock for intra-process synchronization when accessing the TXNS list. */
   svn_mutex__t *txn_list_lock;
@@ -258,6 +309,78 @@ typedef struct fs_fs_shared_data_t
      txn-current file. */
   svn_mutex__t *txn_current_lock;
 
+  /* Non-zero once some instance tried to pre-load the caches from the
+     snapshot file.  That is done at most once per process. */
+  svn_atomic_t cache_snapshot_loaded;
+
+  /* Thread pool running background packs for this repository, see
+     svn_fs_fs__schedule_background_pack().  Created upon first use,
+     guarded by BACKGROUND_PACKER_INITIALIZED.  Non-zero
+     BACKGROUND_PACK_PENDING means that a pack has been queued and not
+     finished yet. */
+#if APR_HAS_THREADS
+  apr_thread_pool_t *background_packer;
+#endif
+  svn_atomic_t background_packer_initialized;
+  svn_atomic_t background_pack_pending;
+
+  /* Thread pool prefetching rev / pack file blocks into the caches, see
+     block-read-ahead in fsfs.conf.  Created upon first use, guarded by
+     READ_AHEAD_INITIALIZED.  READ_AHEAD_JOBS counts the jobs queued or
+     running. */
+#if APR_HAS_THREADS
+  apr_thread_pool_t *read_ahead_threads;
+#endif
+  svn_atomic_t read_ahead_initialized;
+  svn_atomic_t read_ahead_jobs;
+
+  /* Thread pool adding the representations of committed revisions to
+     rep-cache.db, see svn_fs_fs__queue_rep_references().  Created upon
+     first use, guarded by REP_CACHE_WRITER_INITIALIZED.  The entries
+     still to write are in REP_CACHE_QUEUE, allocated in their own root
+     pool REP_CACHE_QUEUE_POOL; both are NULL if there are none.  These
+     are guarded by REP_CACHE_QUEUE_LOCK.  Non-zero REP_CACHE_UPDATES_-
+     PENDING means that a writer task has been queued and not finished
+     yet. */
+#if APR_HAS_THREADS
+  apr_thread_pool_t *rep_cache_writer;
+#endif
+  svn_atomic_t rep_cache_writer_initialized;
+  svn_mutex__t *rep_cache_queue_lock;
+  apr_array_header_t *rep_cache_queue;
+  apr_pool_t *rep_cache_queue_pool;
+  svn_atomic_t rep_cache_updates_pending;
+
+  /* Bloom filter over the keys in rep-cache.db, see rep-cache-filter in
+     fsfs.conf.  NULL until first use or after a reset.  Guarded by
+     REP_CACHE_FILTER_LOCK, which is created upon first use and guarded
+     by REP_CACHE_FILTER_INITIALIZED. */
+  struct svn_fs_fs__rep_cache_filter_t *rep_cache_filter;
+  svn_mutex__t *rep_cache_filter_lock;
+  svn_atomic_t rep_cache_filter_initialized;
+
+  /* Commits waiting to be run by the current group commit leader, see
+     svn_fs_fs__group_commit().  GROUP_COMMIT_QUEUE is a linked list in
+     arrival order and GROUP_COMMIT_LEADER is set while some thread is
+     running the queued commits.  Both are guarded by GROUP_COMMIT_LOCK.
+     Waiting committers get woken up through GROUP_COMMIT_DONE. */
+#if APR_HAS_THREADS
+  apr_thread_cond_t *group_commit_done;
+#endif
+  svn_mutex__t *group_commit_lock;
+  struct svn_fs_fs__group_commit_t *group_commit_queue;
+  svn_boolean_t group_commit_leader;
+
+  /* Process-wide 1st level DAG node caches for revision roots, shared by
+     all svn_fs_t instances of this filesystem.  Maps the instances' cache
+     prefix to a fs_fs_dag_cache_t *, allocated in DAG_NODE_CACHES_POOL.
+     The caches and the pool are guarded by DAG_NODE_CACHES_LOCK.  All are
+     created upon first use, guarded by DAG_NODE_CACHES_INITIALIZED. */
+  apr_hash_t *dag_node_caches;
+  apr_pool_t *dag_node_caches_pool;
+  svn_mutex__t *dag_node_caches_lock;
+  svn_atomic_t dag_node_caches_initialized;
+
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
@@ -294,6 +417,20 @@ typedef struct window_cache_key_t
   apr_uint64_t item_index;
 } window_cache_key_t;
 
+/* Compression codecs that may be selected for new representations in
+   fsfs.conf. */
+typedef enum compression_type_t
+{
+  /* Store the data uncompressed (svndiff0). */
+  compression_type_none,
+
+  /* Use zlib compression (svndiff1). */
+  compression_type_zlib,
+
+  /* Use LZ4 compression (svndiff2, format 8+). */
+  compression_type_lz4
+} compression_type_t;
+
 /* Private (non-shared) FSFS-specific data for each svn_fs_t object.
    Any caches in here may be NULL. */
 typedef struct fs_fs_data_t
@@ -323,6 +460,19 @@ typedef struct fs_fs_data_t
    * (not just the one bit that we need, atm). */
   svn_boolean_t use_block_read;
 
+  /* Number of blocks following the latest block read to prefetch on a
+   * helper thread.  0 disables read-ahead. */
+  apr_int64_t block_read_ahead;
+
+  /* If set, map rev / pack files into memory when opening them for
+   * reading. */
+  svn_boolean_t memory_map;
+
+  /* First revision of the rev / pack file that we last scheduled
+   * read-ahead for and the offset up to which it has been scheduled. */
+  svn_revnum_t read_ahead_file_rev;
+  apr_off_t read_ahead_end;
+
   /* The revision that was youngest, last time we checked. */
   svn_revnum_t youngest_rev_cache;
 
@@ -336,6 +486,22 @@ typedef struct fs_fs_data_t
      e.g. memcached may be ignored as caching is an optional feature. */
   svn_boolean_t fail_stop;
 
+  /* Absolute path of the cache snapshot to pre-load the membuffer cache
+     from when the repository gets opened.  NULL if not configured. */
+  const char *cache_snapshot_file;
+
+  /* Membuffer cache entries of at least this many bytes will be stored
+     LZ4-compressed in the caches named in COMPRESSED_CACHES.
+     0 disables compression. */
+  apr_size_t cache_compression_threshold;
+
+  /* Names (const char *) of the caches to apply compression to, e.g.
+     "DIR" or "TEXT".  Only used with a non-zero threshold. */
+  apr_array_header_t *compressed_caches;
+
+  /* Key prefix used for all our entries in the membuffer cache. */
+  const char *cache_prefix;
+
   /* A cache of revision root IDs, mapping from (svn_revnum_t *) to
      (svn_fs_id_t *).  (Not threadsafe.) */
   svn_cache__t *rev_root_id_cache;
@@ -343,6 +509,11 @@ typedef struct fs_fs_data_t
   /* Caches native dag_node_t* instances and acts as a 1st level cache */
   fs_fs_dag_cache_t *dag_node_cache;
 
+  /* The entry for this instance in SHARED->DAG_NODE_CACHES.  Consulted
+     after DAG_NODE_CACHE and before REV_NODE_CACHE.  NULL until first
+     use. */
+  fs_fs_dag_cache_t *shared_dag_node_cache;
+
   /* DAG node cache for immutable nodes.  Maps (revision, fspath)
      to (dag_node_t *). This is the 2nd level cache for DAG nodes. */
   svn_cache__t *rev_node_cache;
@@ -385,6 +556,11 @@ typedef struct fs_fs_data_t
      the key is window_cache_key_t */
   svn_cache__t *combined_window_cache;
 
+  /* Cache for svn_fs_fs__combined_cached_chunk_t objects, i.e. combined
+     windows of reps that consist of multiple windows;
+     the key is window_cache_key_t */
+  svn_cache__t *combined_chunk_cache;
+
   /* Cache for node_revision_t objects; the key is (revision, item_index) */
   svn_cache__t *node_revision_cache;
 
@@ -469,12 +645,66 @@ typedef struct fs_fs_data_t
    * deltification history after which skip deltas will be used. */
   apr_int64_t max_linear_deltification;
 
-  /* Compression level to use with txdelta storage format in new revs. */
+  /* Compression codec to use with txdelta storage format in new revs. */
+  compression_type_t delta_compression_type;
+
+  /* Compression level to use with txdelta storage format in new revs.
+   * Only relevant for compression_type_zlib. */
   int delta_compression_level;
 
+  /* File representations whose expanded size exceeds this number of bytes
+   * use LARGE_REP_COMPRESSION_TYPE and LARGE_REP_COMPRESSION_LEVEL
+   * instead of the defaults above.  0 disables the size-based policy. */
+  apr_int64_t large_rep_threshold;
+  compression_type_t large_rep_compression_type;
+  int large_rep_compression_level;
+
+  /* File representations whose svn:mime-type matches any of these glob
+   * patterns (const char *) will be stored uncompressed.  Typically used
+   * for already compressed formats.  May be NULL. */
+  apr_array_header_t *uncompressed_mime_types;
+
+  /* Whether new files without a predecessor may be deltified against
+   * similar existing file representations.  Requires rep-sharing. */
+  svn_boolean_t similarity_deltification;
+
+  /* File representations larger than this number of bytes get split into
+   * content-defined chunks that are shared individually through the
+   * rep-cache.  0 disables chunking.  Requires rep-sharing. */
+  apr_int64_t chunked_rep_threshold;
+
+  /* Add new representations to the rep-cache on a background thread
+   * after the commit instead of within the commit.  Requires rep-sharing. */
+  svn_boolean_t async_rep_cache_updates;
+
+  /* Consult an in-memory Bloom filter before querying rep-cache.db.
+   * Requires rep-sharing. */
+  svn_boolean_t rep_cache_filter;
+
+  /* Let concurrent commits of this process that wait for the write lock
+   * be committed back-to-back within a single lock hold. */
+  svn_boolean_t group_commit;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
+  /* Pack completed shards on a background thread after commits. */
+  svn_boolean_t background_pack;
+
+  /* Write a changed paths index for every shard being packed. */
+  svn_boolean_t changed_paths_index;
+
+  /* Trace linear node history through the history index files in the
+   * node-origins directory, see history_index.h. */
+  svn_boolean_t history_index;
+
+  /* History index file currently in use.  Created upon first use. */
+  struct svn_fs_fs__history_index_t *history_index_state;
+
+  /* Access trace buffer, see trace.h.  NULL if no trace file has been
+   * configured. */
+  struct svn_fs_fs__tracer_t *tracer;
+
   /* Per-instance filesystem ID, which provides an additional level of
      uniqueness for filesystems that share the same UUID, but should
      still be distinguishable (e.g. backups produced by svn_fs_hotcopy()
@@ -484,6 +714,16 @@ typedef struct fs_fs_data_t
   /* Ensure that all filesystem changes are written to disk. */
   svn_boolean_t flush_to_disk;
 
+  /* Bulk load mode, see SVN_FS_CONFIG_FSFS_BULK_LOAD.  Implies that
+   * FLUSH_TO_DISK is not set. */
+  svn_boolean_t bulk_load;
+
+  /* New rep-cache entries held back in bulk load mode.  Maps SHA1 digests
+   * to representation_t *, both allocated in DEFERRED_REPS_POOL.  NULL if
+   * there are none. */
+  apr_hash_t *deferred_reps;
+  apr_pool_t *deferred_reps_pool;
+
   /* Pointer to svn_fs_open. */
   svn_error_t *(*svn_fs_open_)(svn_fs_t **, const char *, apr_hash_t *,
                                apr_pool_t *, apr_pool_t *);
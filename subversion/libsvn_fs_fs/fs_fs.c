@@ -34,11 +34,13 @@
 #include "svn_sorts.h"
 #include "svn_version.h"
 
+#include "batch_fsync.h"
 #include "cached_data.h"
 #include "id.h"
 #include "index.h"
 #include "rep-cache.h"
 #include "revprops.h"
+#include "trace.h"
 #include "transaction.h"
 #include "tree.h"
 #include "util.h"
@@ -683,6 +685,67 @@ verify_block_size(apr_int64_t block_size,
   return SVN_NO_ERROR;
 }
 
+/* Parse the compression codec specification VALUE given for fsfs.conf
+ * option NAME and return the codec in *TYPE and the compression level
+ * in *LEVEL.  FORMAT is the format of the repository.  Codecs not
+ * supported by FORMAT or this build fall back to zlib.
+ */
+static svn_error_t *
+parse_compression_option(compression_type_t *type,
+                         int *level,
+                         const char *value,
+                         const char *name,
+                         int format)
+{
+  if (strcmp(value, "none") == 0)
+    {
+      *type = compression_type_none;
+      *level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+    }
+  else if (strcmp(value, "lz4") == 0)
+    {
+      *type = compression_type_lz4;
+      *level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (strcmp(value, "zlib") == 0)
+    {
+      *type = compression_type_zlib;
+      *level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (strncmp(value, "zlib-", 5) == 0)
+    {
+      int zlib_level;
+      svn_error_t *err = svn_cstring_atoi(&zlib_level, value + 5);
+
+      if (err || zlib_level < SVN_DELTA_COMPRESSION_LEVEL_NONE
+              || zlib_level > SVN_DELTA_COMPRESSION_LEVEL_MAX)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, err,
+                                 _("Invalid zlib compression level '%s' "
+                                   "for fsfs.conf setting '%s'"),
+                                 value + 5, name);
+
+      *type = zlib_level == SVN_DELTA_COMPRESSION_LEVEL_NONE
+            ? compression_type_none
+            : compression_type_zlib;
+      *level = zlib_level;
+    }
+  else
+    {
+      return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                               _("Invalid value '%s' for fsfs.conf "
+                                 "setting '%s'"),
+                               value, name);
+    }
+
+  /* LZ4 requires svndiff2 support in the repository format as well as
+   * in this build.  Don't fail in that case but use the default. */
+  if (   *type == compression_type_lz4
+      && (format < SVN_FS_FS__MIN_SVNDIFF2_FORMAT || !svn__lz4_supported()))
+    *type = compression_type_zlib;
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the configuration information of the file system at FS_PATH
  * and set the respective values in FFD.  Use pools as usual.
  */
@@ -693,6 +756,10 @@ read_config(fs_fs_data_t *ffd,
             apr_pool_t *scratch_pool)
 {
   svn_config_t *config;
+  apr_int64_t compression_threshold;
+  const char *compressed_caches;
+  const char *trace_file;
+  apr_int64_t trace_buffer_size;
 
   SVN_ERR(svn_config_read3(&config,
                            svn_dirent_join(fs_path, PATH_CONFIG, scratch_pool),
@@ -706,10 +773,40 @@ read_config(fs_fs_data_t *ffd,
   else
     ffd->rep_sharing_allowed = FALSE;
 
+  /* Chunk-level sharing uses the same rep-cache as full rep-sharing. */
+  if (   ffd->format >= SVN_FS_FS__MIN_CHUNKED_REP_FORMAT
+      && ffd->rep_sharing_allowed)
+    {
+      SVN_ERR(svn_config_get_int64(config, &ffd->chunked_rep_threshold,
+                                   CONFIG_SECTION_REP_SHARING,
+                                   CONFIG_OPTION_CHUNKED_REP_THRESHOLD, 0));
+      ffd->chunked_rep_threshold = MAX(0, ffd->chunked_rep_threshold);
+    }
+  else
+    ffd->chunked_rep_threshold = 0;
+
+  if (ffd->rep_sharing_allowed)
+    SVN_ERR(svn_config_get_bool(config, &ffd->async_rep_cache_updates,
+                                CONFIG_SECTION_REP_SHARING,
+                                CONFIG_OPTION_ASYNC_REP_CACHE_UPDATES,
+                                FALSE));
+  else
+    ffd->async_rep_cache_updates = FALSE;
+
+  if (ffd->rep_sharing_allowed)
+    SVN_ERR(svn_config_get_bool(config, &ffd->rep_cache_filter,
+                                CONFIG_SECTION_REP_SHARING,
+                                CONFIG_OPTION_REP_CACHE_FILTER,
+                                FALSE));
+  else
+    ffd->rep_cache_filter = FALSE;
+
   /* Initialize deltification settings in ffd. */
   if (ffd->format >= SVN_FS_FS__MIN_DELTIFICATION_FORMAT)
     {
       apr_int64_t compression_level;
+      const char *compression;
+      const char *mime_types;
 
       SVN_ERR(svn_config_get_bool(config, &ffd->deltify_directories,
                                   CONFIG_SECTION_DELTIFICATION,
@@ -735,6 +832,53 @@ read_config(fs_fs_data_t *ffd,
       ffd->delta_compression_level
         = (int)MIN(MAX(SVN_DELTA_COMPRESSION_LEVEL_NONE, compression_level),
                    SVN_DELTA_COMPRESSION_LEVEL_MAX);
+      ffd->delta_compression_type = compression_type_zlib;
+
+      /* An explicit codec selection overrides the zlib level above. */
+      svn_config_get(config, &compression, CONFIG_SECTION_DELTIFICATION,
+                     CONFIG_OPTION_COMPRESSION, NULL);
+      if (compression)
+        SVN_ERR(parse_compression_option(&ffd->delta_compression_type,
+                                         &ffd->delta_compression_level,
+                                         compression,
+                                         CONFIG_OPTION_COMPRESSION,
+                                         ffd->format));
+
+      /* Size-based policy for large representations. */
+      SVN_ERR(svn_config_get_int64(config, &ffd->large_rep_threshold,
+                                   CONFIG_SECTION_DELTIFICATION,
+                                   CONFIG_OPTION_LARGE_REP_THRESHOLD, 0));
+      ffd->large_rep_threshold = MAX(0, ffd->large_rep_threshold);
+      ffd->large_rep_compression_type = ffd->delta_compression_type;
+      ffd->large_rep_compression_level = ffd->delta_compression_level;
+
+      svn_config_get(config, &compression, CONFIG_SECTION_DELTIFICATION,
+                     CONFIG_OPTION_LARGE_REP_COMPRESSION, NULL);
+      if (compression)
+        SVN_ERR(parse_compression_option(&ffd->large_rep_compression_type,
+                                         &ffd->large_rep_compression_level,
+                                         compression,
+                                         CONFIG_OPTION_LARGE_REP_COMPRESSION,
+                                         ffd->format));
+
+      /* MIME types of content that is known not to compress well. */
+      svn_config_get(config, &mime_types, CONFIG_SECTION_DELTIFICATION,
+                     CONFIG_OPTION_UNCOMPRESSED_MIME_TYPES, NULL);
+      ffd->uncompressed_mime_types = NULL;
+      if (mime_types)
+        {
+          apr_array_header_t *patterns
+            = svn_cstring_split(mime_types, ", \t", TRUE, result_pool);
+          if (patterns->nelts)
+            ffd->uncompressed_mime_types = patterns;
+        }
+
+      /* Cross-file deltification uses the rep-cache to find bases. */
+      SVN_ERR(svn_config_get_bool(config, &ffd->similarity_deltification,
+                                  CONFIG_SECTION_DELTIFICATION,
+                                  CONFIG_OPTION_ENABLE_SIMILARITY_DELTIFICATION,
+                                  FALSE));
+      ffd->similarity_deltification &= ffd->rep_sharing_allowed;
     }
   else
     {
@@ -742,7 +886,13 @@ read_config(fs_fs_data_t *ffd,
       ffd->deltify_properties = FALSE;
       ffd->max_deltification_walk = SVN_FS_FS_MAX_DELTIFICATION_WALK;
       ffd->max_linear_deltification = SVN_FS_FS_MAX_LINEAR_DELTIFICATION;
+      ffd->delta_compression_type = compression_type_zlib;
       ffd->delta_compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+      ffd->large_rep_threshold = 0;
+      ffd->large_rep_compression_type = compression_type_zlib;
+      ffd->large_rep_compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+      ffd->uncompressed_mime_types = NULL;
+      ffd->similarity_deltification = FALSE;
     }
 
   /* Initialize revprop packing settings in ffd. */
@@ -781,6 +931,14 @@ read_config(fs_fs_data_t *ffd,
                                    CONFIG_SECTION_IO,
                                    CONFIG_OPTION_P2L_PAGE_SIZE,
                                    0x400));
+      SVN_ERR(svn_config_get_int64(config, &ffd->block_read_ahead,
+                                   CONFIG_SECTION_IO,
+                                   CONFIG_OPTION_BLOCK_READ_AHEAD,
+                                   0));
+      SVN_ERR(svn_config_get_bool(config, &ffd->memory_map,
+                                  CONFIG_SECTION_IO,
+                                  CONFIG_OPTION_MEMORY_MAP,
+                                  FALSE));
 
       /* Don't accept unreasonable or illegal values.
        * Block size and P2L page size are in kbytes;
@@ -791,6 +949,14 @@ read_config(fs_fs_data_t *ffd,
                                 CONFIG_OPTION_P2L_PAGE_SIZE, scratch_pool));
       SVN_ERR(verify_block_size(ffd->l2p_page_size, sizeof(apr_off_t),
                                 CONFIG_OPTION_L2P_PAGE_SIZE, scratch_pool));
+      if (ffd->block_read_ahead < 0)
+        return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                                 _("%s is too small for fsfs.conf setting "
+                                   "'%s'."),
+                                 apr_psprintf(scratch_pool,
+                                              "%" APR_INT64_T_FMT,
+                                              ffd->block_read_ahead),
+                                 CONFIG_OPTION_BLOCK_READ_AHEAD);
 
       /* convert kBytes to bytes */
       ffd->block_size *= 0x400;
@@ -803,20 +969,40 @@ read_config(fs_fs_data_t *ffd,
       ffd->block_size = 0x1000; /* Matches default APR file buffer size. */
       ffd->l2p_page_size = 0x2000;    /* Matches above default. */
       ffd->p2l_page_size = 0x100000;  /* Matches above default in bytes. */
+      ffd->block_read_ahead = 0;
+      ffd->memory_map = FALSE;
     }
 
+  SVN_ERR(svn_config_get_bool(config, &ffd->group_commit,
+                              CONFIG_SECTION_COMMIT,
+                              CONFIG_OPTION_GROUP_COMMIT,
+                              FALSE));
+
   if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
     {
       SVN_ERR(svn_config_get_bool(config, &ffd->pack_after_commit,
                                   CONFIG_SECTION_DEBUG,
                                   CONFIG_OPTION_PACK_AFTER_COMMIT,
                                   FALSE));
+      SVN_ERR(svn_config_get_bool(config, &ffd->background_pack,
+                                  CONFIG_SECTION_PACKING,
+                                  CONFIG_OPTION_BACKGROUND_PACK,
+                                  FALSE));
     }
   else
     {
       ffd->pack_after_commit = FALSE;
+      ffd->background_pack = FALSE;
     }
 
+  if (ffd->format >= SVN_FS_FS__MIN_CHANGED_PATHS_INDEX_FORMAT)
+    SVN_ERR(svn_config_get_bool(config, &ffd->changed_paths_index,
+                                CONFIG_SECTION_PACKING,
+                                CONFIG_OPTION_CHANGED_PATHS_INDEX,
+                                FALSE));
+  else
+    ffd->changed_paths_index = FALSE;
+
   /* memcached configuration */
   SVN_ERR(svn_cache__make_memcache_from_config(&ffd->memcache, config,
                                                result_pool, scratch_pool));
@@ -825,6 +1011,49 @@ read_config(fs_fs_data_t *ffd,
                               CONFIG_SECTION_CACHES, CONFIG_OPTION_FAIL_STOP,
                               FALSE));
 
+  svn_config_get(config, &ffd->cache_snapshot_file,
+                 CONFIG_SECTION_CACHES, CONFIG_OPTION_SNAPSHOT_FILE, NULL);
+  if (ffd->cache_snapshot_file)
+    ffd->cache_snapshot_file = svn_dirent_join(fs_path,
+                                               ffd->cache_snapshot_file,
+                                               result_pool);
+
+  SVN_ERR(svn_config_get_int64(config, &compression_threshold,
+                               CONFIG_SECTION_CACHES,
+                               CONFIG_OPTION_COMPRESSION_THRESHOLD, 0));
+  if (compression_threshold < 0 || compression_threshold > APR_SIZE_MAX)
+    return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                             _("Invalid cache compression threshold "
+                               "%" APR_INT64_T_FMT),
+                             compression_threshold);
+  ffd->cache_compression_threshold = (apr_size_t)compression_threshold;
+
+  svn_config_get(config, &compressed_caches, CONFIG_SECTION_CACHES,
+                 CONFIG_OPTION_COMPRESSED_CACHES, "DIR TEXT CHANGES");
+  ffd->compressed_caches = svn_cstring_split(compressed_caches, ", \t",
+                                             TRUE, result_pool);
+
+  SVN_ERR(svn_config_get_bool(config, &ffd->history_index,
+                              CONFIG_SECTION_CACHES,
+                              CONFIG_OPTION_HISTORY_INDEX, FALSE));
+
+  /* Access tracing.  Reading the config again must not start a second
+   * trace buffer. */
+  svn_config_get(config, &trace_file, CONFIG_SECTION_DEBUG,
+                 CONFIG_OPTION_TRACE_FILE, NULL);
+  SVN_ERR(svn_config_get_int64(config, &trace_buffer_size,
+                               CONFIG_SECTION_DEBUG,
+                               CONFIG_OPTION_TRACE_BUFFER_SIZE, 64));
+  if (trace_buffer_size <= 0 || trace_buffer_size > 0x100000)
+    return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                             _("Invalid trace buffer size "
+                               "%" APR_INT64_T_FMT),
+                             trace_buffer_size);
+  if (trace_file && !ffd->tracer)
+    ffd->tracer = svn_fs_fs__tracer_create(
+                      svn_dirent_join(fs_path, trace_file, scratch_pool),
+                      (apr_size_t)trace_buffer_size * 1024, result_pool);
+
   return SVN_NO_ERROR;
 }
 
@@ -851,12 +1080,46 @@ write_config(svn_fs_t *fs,
 "### no authentication for reads or writes, so you must ensure that your"    NL
 "### memcached servers are only accessible by trusted users."                NL
 ""                                                                           NL
+"[" SVN_CACHE_CONFIG_CATEGORY_MEMCACHED_OPTIONS "]"                          NL
+"### These options tune how the memcached servers above get used."           NL
+"### Connections to each server are pooled.  This limits their number:"      NL
+"# " SVN_CACHE_CONFIG_OPTION_MEMCACHED_CONNECTIONS " = 10"                   NL
+"### Writes may be handed over to a background thread such that they"        NL
+"### don't delay the request being processed.  Uncomment this to do so:"     NL
+"# " SVN_CACHE_CONFIG_OPTION_MEMCACHED_ASYNC_WRITES " = true"                NL
+"### By default, memcached replaces the in-process caches.  To use it as"    NL
+"### a second level cache below them instead, uncomment this line:"          NL
+"# " SVN_CACHE_CONFIG_OPTION_MEMCACHED_SECOND_LEVEL " = true"                NL
+""                                                                           NL
 "[" CONFIG_SECTION_CACHES "]"                                                NL
 "### When a cache-related error occurs, normally Subversion ignores it"      NL
 "### and continues, logging an error if the server is appropriately"         NL
 "### configured (and ignoring it with file:// access).  To make"             NL
 "### Subversion never ignore cache errors, uncomment this line."             NL
 "# " CONFIG_OPTION_FAIL_STOP " = true"                                       NL
+"### Servers can pre-load their in-memory cache from a snapshot taken"       NL
+"### with 'svnfsfs dump-cache' when they first open this repository."        NL
+"### That snapshot can only be used by the same Subversion release and"      NL
+"### platform that created it and will be ignored if the repository has"     NL
+"### changed in incompatible ways since.  Relative paths are relative to"    NL
+"### the repository's db/ directory.  By default, no snapshot is used."      NL
+"# " CONFIG_OPTION_SNAPSHOT_FILE " = cache.snapshot"                         NL
+"### Large cache entries may be kept LZ4-compressed to fit more of them"     NL
+"### into the in-memory cache at the expense of some CPU time when they"     NL
+"### are being read.  Entries at least as large as the threshold given"      NL
+"### in bytes get compressed if that actually saves space.  Compression"     NL
+"### applies only to the caches listed in the option below, which"           NL
+"### defaults to directories, file contents and changed paths."              NL
+"### By default, i.e. with a threshold of 0, nothing gets compressed."       NL
+"# " CONFIG_OPTION_COMPRESSION_THRESHOLD " = 16384"                          NL
+"# " CONFIG_OPTION_COMPRESSED_CACHES " = DIR TEXT CHANGES"                   NL
+"### Tracing the history of nodes with many revisions, e.g. for 'svn log'"   NL
+"### or 'svn blame', may keep a persistent copy of the predecessor chains"   NL
+"### in the node-origins directory.  Later history traces will read them"    NL
+"### from there instead of reading every node revision from the revision"    NL
+"### files.  This is just a cache and can be switched on and off at will."   NL
+"### History indexes are disabled by default."                               NL
+"# " CONFIG_OPTION_HISTORY_INDEX " = false"                                  NL
 ""                                                                           NL
 "[" CONFIG_SECTION_REP_SHARING "]"                                           NL
 "### To conserve space, the filesystem can optionally avoid storing"         NL
@@ -873,6 +1136,37 @@ write_config(svn_fs_t *fs,
 "### 'svnadmin verify' will check the rep-cache regardless of this setting." NL
 "### rep-sharing is enabled by default."                                     NL
 "# " CONFIG_OPTION_ENABLE_REP_SHARING " = true"                              NL
+"###"                                                                        NL
+"### Large files that are modified in place, e.g. artwork or disk images,"   NL
+"### are rarely identical to any existing representation as a whole.  If"    NL
+"### this threshold (in bytes) is set, file representations exceeding it"    NL
+"### will be split into chunks at content-defined boundaries and each"       NL
+"### chunk will be shared individually.  Thus, regions of the file that"     NL
+"### did not change will be stored only once.  Chunks are between 256"       NL
+"### kBytes and 4 MBytes in size.  Files up to the threshold size will be"   NL
+"### buffered in memory during commits.  This requires rep-sharing and a"    NL
+"### Subversion 1.10+ server to read the repository."                        NL
+"### The default is 0, which disables chunking."                             NL
+"# " CONFIG_OPTION_CHUNKED_REP_THRESHOLD " = 0"                              NL
+"###"                                                                        NL
+"### When enabled, the representations of a new revision get added to the"   NL
+"### rep-cache on a background thread of the committing process, in"         NL
+"### batched SQLite transactions, instead of within the commit.  This"       NL
+"### shortens large commits but new representations may not be shared"       NL
+"### until the queue has been written; entries still queued when the"        NL
+"### process ends are lost."                                                 NL
+"### This has no effect in builds without thread support."                   NL
+"### Asynchronous rep-cache updates are disabled by default."                NL
+"# " CONFIG_OPTION_ASYNC_REP_CACHE_UPDATES " = false"                        NL
+"###"                                                                        NL
+"### When enabled, rep-cache lookups first consult an in-memory Bloom"       NL
+"### filter of all known representations.  This saves the database query"    NL
+"### for most new file contents and speeds up large imports.  The filter"    NL
+"### takes 2 bytes of memory per rep-cache entry and is saved to the file"   NL
+"### " REP_CACHE_FILTER_NAME " next to the database.  Contents added"        NL
+"### by other processes may not be shared until after the next commit."      NL
+"### The rep-cache filter is disabled by default."                           NL
+"# " CONFIG_OPTION_REP_CACHE_FILTER " = false"                               NL
 ""                                                                           NL
 "[" CONFIG_SECTION_DELTIFICATION "]"                                         NL
 "### To conserve space, the filesystem stores data as differences against"   NL
@@ -893,6 +1187,8 @@ write_config(svn_fs_t *fs,
 "### Repositories containing large directories will benefit greatly."        NL
 "### In rarely accessed repositories, the I/O overhead may be significant"   NL
 "### as caches will most likely be low."                                     NL
+"### Without deltification, directories with 1024 or more entries get an"    NL
+"### index that allows for looking up single entries quickly."               NL
 "### directory deltification is enabled by default."                         NL
 "# " CONFIG_OPTION_ENABLE_DIR_DELTIFICATION " = true"                        NL
 "###"                                                                        NL
@@ -952,6 +1248,43 @@ write_config(svn_fs_t *fs,
 "### and 0 disabling it altogether."                                         NL
 "### The default value is 5."                                                NL
 "# " CONFIG_OPTION_COMPRESSION_LEVEL " = 5"                                  NL
+"###"                                                                        NL
+"### Alternatively, the compression codec can be selected explicitly.  If"   NL
+"### set, this option takes precedence over the compression level above."    NL
+"### Valid values are 'none', 'lz4', 'zlib' and 'zlib-1' to 'zlib-9', with"  NL
+"### 'zlib' being equivalent to 'zlib-5'.  LZ4 compresses and decompresses"  NL
+"### much faster than zlib, at the expense of a lower compression ratio."    NL
+"### It requires repository format 8 and a Subversion build with LZ4"        NL
+"### support; zlib will be used otherwise."                                  NL
+"# " CONFIG_OPTION_COMPRESSION " = zlib"                                     NL
+"###"                                                                        NL
+"### File representations whose size exceeds the given threshold in bytes"   NL
+"### will be compressed using the large-rep-compression codec instead.  It"  NL
+"### takes the same values as the compression option above.  Large binary"   NL
+"### content often compresses poorly, so a cheaper codec like 'lz4' may be"  NL
+"### preferable for it.  Files up to the threshold size will be buffered"    NL
+"### in memory during commits.  The default is 0, which disables the"        NL
+"### size-based codec selection."                                            NL
+"# " CONFIG_OPTION_LARGE_REP_THRESHOLD " = 0"                                NL
+"# " CONFIG_OPTION_LARGE_REP_COMPRESSION " = lz4"                            NL
+"###"                                                                        NL
+"### Files whose svn:mime-type matches one of the (whitespace or comma"      NL
+"### separated) glob patterns given here will be stored uncompressed."       NL
+"### Use this for archives and media formats that are already compressed."   NL
+"### The default is an empty list."                                          NL
+"# " CONFIG_OPTION_UNCOMPRESSED_MIME_TYPES " = application/zip image/*"      NL
+"###"                                                                        NL
+"### Newly added files have no history to deltify against and are usually"   NL
+"### stored as fulltext.  If this option is enabled, fingerprints of the"    NL
+"### first 64 kBytes of all file contents will be recorded in the"           NL
+"### rep-cache and new files will be stored as deltas against the most"      NL
+"### similar existing file.  That can save a lot of space when importing"    NL
+"### copies of existing data, e.g. vendor drops.  It requires rep-sharing"   NL
+"### and keeps up to 64 kBytes per file in memory during commits.  Files"    NL
+"### committed while this option was disabled will not be found as delta"    NL
+"### bases."                                                                 NL
+"### similarity deltification is disabled by default."                       NL
+"# " CONFIG_OPTION_ENABLE_SIMILARITY_DELTIFICATION " = false"                NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -974,6 +1307,23 @@ write_config(svn_fs_t *fs,
 "### Compressing packed revprops is disabled by default."                    NL
 "# " CONFIG_OPTION_COMPRESS_PACKED_REVPROPS " = false"                       NL
 ""                                                                           NL
+"[" CONFIG_SECTION_PACKING "]"                                               NL
+"### When enabled, the server packs each shard in the background as soon as" NL
+"### the commit of its last revision completed.  This keeps repositories"    NL
+"### served by mod_dav_svn or svnserve packed without running 'svnadmin"     NL
+"### pack' from cron jobs.  The pack runs on a separate low-priority thread" NL
+"### of the committing process and takes out the usual pack lock.  It has"   NL
+"### no effect in builds without thread support."                            NL
+"### Background packing is disabled by default."                             NL
+"# " CONFIG_OPTION_BACKGROUND_PACK " = false"                                NL
+"### When enabled, packing a shard also writes an index of all paths"        NL
+"### changed within that shard.  Path-based log requests use it to skip"     NL
+"### shards in which the path was not touched instead of reading their"      NL
+"### change lists.  This option applies to format 8 repositories and"        NL
+"### later.  Shards packed without it are searched the usual way."           NL
+"### Changed paths indexes are disabled by default."                         NL
+"# " CONFIG_OPTION_CHANGED_PATHS_INDEX " = false"                            NL
+""                                                                           NL
 "[" CONFIG_SECTION_IO "]"                                                    NL
 "### Parameters in this section control the data access granularity in"      NL
 "### format 7 repositories and later.  The defaults should translate into"   NL
@@ -1020,6 +1370,49 @@ write_config(svn_fs_t *fs,
 "### Must be a power of 2."                                                  NL
 "### p2l-page-size is given in kBytes and with a default of 1024 kBytes."    NL
 "# " CONFIG_OPTION_P2L_PAGE_SIZE " = 1024"                                   NL
+"###"                                                                        NL
+"### Sequential reads of large parts of a repository,  e.g. checkouts and"   NL
+"### exports,  may benefit from reading the blocks following the current"    NL
+"### one in advance.  That happens on a helper thread of the server process" NL
+"### and puts the data into the caches before it is being requested.  This"  NL
+"### requires block-read to be enabled and caches to be large enough to"     NL
+"### hold the prefetched data until it gets used.  It has no effect in"      NL
+"### builds without thread support and in processes whose caches are not"    NL
+"### thread-safe,  e.g. svnlook."                                            NL
+"### block-read-ahead is the number of blocks to prefetch and read-ahead is" NL
+"### disabled (0) by default."                                               NL
+"# " CONFIG_OPTION_BLOCK_READ_AHEAD " = 0"                                   NL
+"###"                                                                        NL
+"### Rev and pack files as well as their indexes may be mapped into memory"  NL
+"### instead of being accessed through buffered reads.  That saves a system" NL
+"### call for every index lookup and works best on 64 bit servers with lots" NL
+"### of RAM available to the OS file cache.  On 32 bit systems, large pack"  NL
+"### files will quickly exhaust the address space and mapping should not be" NL
+"### used.  Files that can't be mapped will simply be read as usual."        NL
+"### Memory mapping is disabled by default."                                 NL
+"# " CONFIG_OPTION_MEMORY_MAP " = false"                                     NL
+""                                                                           NL
+"[" CONFIG_SECTION_COMMIT "]"                                                NL
+"### When many small commits arrive at the same time, each of them has to"   NL
+"### wait for the write lock and to flush 'current' to disk separately."     NL
+"### With group commits enabled, one committer of the server process takes"  NL
+"### the write lock for all commits that are waiting for it at that moment"  NL
+"### and commits them back-to-back.  Transactions that are out of date get"  NL
+"### merged with the latest revision under the lock as usual; only actual"   NL
+"### conflicts fail.  'current' gets flushed to disk once per group.  This"  NL
+"### has no effect in builds without thread support."                        NL
+"### Group commits are disabled by default."                                 NL
+"# " CONFIG_OPTION_GROUP_COMMIT " = false"                                   NL
+""                                                                           NL
+"[" CONFIG_SECTION_DEBUG "]"                                                 NL
+"### To find out which parts of the revision and pack files get read and"    NL
+"### how long that takes, FSFS can log every file open, block read, item"    NL
+"### read and cache miss to a trace file.  Each FSFS instance collects the"  NL
+"### events in a buffer of the given size in kBytes and appends them to"     NL
+"### the file when the buffer is full.  Relative paths are relative to the"  NL
+"### repository's db/ directory.  Tracing is disabled by default."           NL
+"# " CONFIG_OPTION_TRACE_FILE " = access.trace"                              NL
+"# " CONFIG_OPTION_TRACE_BUFFER_SIZE " = 64"                                 NL
 ;
 #undef NL
   return svn_io_file_create(svn_dirent_join(fs->path, PATH_CONFIG, pool),
@@ -1036,7 +1429,11 @@ read_global_config(svn_fs_t *fs)
   ffd->use_block_read = svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_FSFS_BLOCK_READ,
                                            FALSE);
-  ffd->flush_to_disk = !svn_hash__get_bool(fs->config,
+  ffd->bulk_load = svn_hash__get_bool(fs->config,
+                                      SVN_FS_CONFIG_FSFS_BULK_LOAD,
+                                      FALSE);
+  ffd->flush_to_disk = !ffd->bulk_load
+                    && !svn_hash__get_bool(fs->config,
                                            SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                                            FALSE);
 
@@ -1812,6 +2209,9 @@ svn_fs_fs__create(svn_fs_t *fs,
           case 8: format = 6;
                   break;
 
+          case 9: format = 7;
+                  break;
+
           default:format = SVN_FS_FS__FORMAT_NUMBER;
         }
 
@@ -2180,8 +2580,11 @@ svn_fs_fs__info_format(int *fs_format,
     case 7:
       (*supports_version)->minor = 9;
       break;
+    case 8:
+      (*supports_version)->minor = 10;
+      break;
 #ifdef SVN_DEBUG
-# if SVN_FS_FS__FORMAT_NUMBER != 7
+# if SVN_FS_FS__FORMAT_NUMBER != 8
 #  error "Need to add a 'case' statement here"
 # endif
 #endif
@@ -2201,3 +2604,91 @@ svn_fs_fs__info_config_files(apr_array_header_t **files,
                                                          result_pool);
   return SVN_NO_ERROR;
 }
+
+/* Maximum number of files to flush at once in sync_tree.  This limits the
+ * number of open file handles. */
+#define SYNC_BATCH_SIZE 256
+
+/* Flush the directory at PATH and everything below it to disk using
+ * BATCH.  Skip the sub-directories of PATH named in EXCLUDED, a
+ * NULL-terminated list of names.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+sync_tree(svn_fs_fs__batch_fsync_t *batch,
+          const char *path,
+          const char *const *excluded,
+          apr_pool_t *scratch_pool)
+{
+  apr_hash_t *dirents;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int pending = 0;
+
+  SVN_ERR(svn_io_get_dirents3(&dirents, path, TRUE, scratch_pool,
+                              scratch_pool));
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      const char *child_path;
+
+      svn_pool_clear(iterpool);
+      child_path = svn_dirent_join(path, name, iterpool);
+
+      if (dirent->kind == svn_node_dir)
+        {
+          const char *const *skip = excluded;
+
+          while (skip && *skip && strcmp(*skip, name))
+            ++skip;
+          if (!skip || !*skip)
+            SVN_ERR(sync_tree(batch, child_path, NULL, iterpool));
+        }
+      else if (dirent->kind == svn_node_file)
+        {
+          SVN_ERR(svn_fs_fs__batch_fsync_existing_path(batch, child_path,
+                                                       iterpool));
+          if (++pending == SYNC_BATCH_SIZE)
+            {
+              SVN_ERR(svn_fs_fs__batch_fsync_run(batch, iterpool));
+              pending = 0;
+            }
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* The directory entries must be durable as well. */
+  SVN_ERR(svn_fs_fs__batch_fsync_existing_path(batch, path, scratch_pool));
+
+  return svn_error_trace(svn_fs_fs__batch_fsync_run(batch, scratch_pool));
+}
+
+/* Implements svn_fs_fs__with_all_locks() callback. */
+static svn_error_t *
+sync_body(void *baton,
+          apr_pool_t *pool)
+{
+  svn_fs_t *fs = baton;
+  svn_fs_fs__batch_fsync_t *batch;
+
+  /* Transactions and locks are not part of the revision history and may
+   * change underneath us. */
+  static const char *const excluded[]
+    = { PATH_TXNS_DIR, PATH_TXN_PROTOS_DIR, PATH_LOCKS_DIR, NULL };
+
+  SVN_ERR(svn_fs_fs__write_deferred_rep_references(fs, pool));
+
+  SVN_ERR(svn_fs_fs__batch_fsync_create(&batch, TRUE, pool));
+  SVN_ERR(sync_tree(batch, fs->path, excluded, pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__sync(svn_fs_t *fs,
+                apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_fs_fs__with_all_locks(fs, sync_body, fs,
+                                                   scratch_pool));
+}
@@ -48,6 +48,20 @@ svn_error_t *svn_fs_fs__initialize_shared_data(svn_fs_t *fs,
                                                apr_pool_t *pool,
                                                apr_pool_t *common_pool);
 
+/* Open another instance of the fsfs filesystem FS and return it in
+   *NEW_FS_P.  The new instance shares neither caches nor open files
+   with FS and may, therefore, be used by a different thread than FS.
+   It uses the same process-wide shared data as FS, i.e. repository
+   locks taken through it synchronize with those taken through FS.
+   The new instance does not depend on FS's lifetime.
+
+   Allocate *NEW_FS_P in RESULT_POOL and use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *svn_fs_fs__open_private(svn_fs_t **new_fs_p,
+                                     svn_fs_t *fs,
+                                     apr_pool_t *result_pool,
+                                     apr_pool_t *scratch_pool);
+
 /* Upgrade the fsfs filesystem FS.  Indicate progress via the optional
  * NOTIFY_FUNC callback using NOTIFY_BATON.  The optional CANCEL_FUNC
  * will periodically be called with CANCEL_BATON to allow for preemption.
@@ -59,6 +73,12 @@ svn_error_t *svn_fs_fs__upgrade(svn_fs_t *fs,
                                 void *cancel_baton,
                                 apr_pool_t *pool);
 
+/* Implements svn_fs_sync() for FSFS.  Write the rep-cache entries held
+   back in bulk load mode and flush all revision data and metadata of FS
+   to disk.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *svn_fs_fs__sync(svn_fs_t *fs,
+                             apr_pool_t *scratch_pool);
+
 /* Set *YOUNGEST to the youngest revision in filesystem FS.  Do any
    temporary allocation in POOL. */
 svn_error_t *svn_fs_fs__youngest_rev(svn_revnum_t *youngest,
@@ -288,6 +308,14 @@ svn_fs_fs__get_node_origin(const svn_fs_id_t **origin_id,
 svn_error_t *
 svn_fs_fs__initialize_caches(svn_fs_t *fs, apr_pool_t *pool);
 
+/* Pre-load the global membuffer cache from the snapshot file configured
+   for FS, if any.  This will be done at most once per process and
+   repository.  Problems with the snapshot will be ignored.  Use
+   SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__preload_caches(svn_fs_t *fs,
+                          apr_pool_t *scratch_pool);
+
 /* Initialize all transaction-local caches in FS according to the global
    cache settings and make TXN_ID part of their key space. Use POOL for
    allocations.
@@ -0,0 +1,448 @@
+/* history_index.c --- persistent node history index
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+
+#include "fs.h"
+#include "fs_fs.h"
+#include "history_index.h"
+#include "id.h"
+
+#include "svn_private_config.h"
+
+/* The index file starts with this line, followed by a line with the
+ * number of entries.  Each entry describes one node revision and the
+ * entries are ordered from the oldest to the youngest node revision,
+ * each being the predecessor of the next one.  An entry is a line
+ *
+ *   <id> <predecessor-id> <predecessor-count> <copyfrom-rev> <created-path>
+ *
+ * where <predecessor-id> is "-" if there is no predecessor.  If
+ * <copyfrom-rev> is not -1, the entry continues with another line
+ * containing the copyfrom path.
+ */
+#define HISTORY_INDEX_HEADER "history 1\n"
+
+/* One node revision in a history index. */
+typedef struct history_entry_t
+{
+  const svn_fs_id_t *id;
+  const svn_fs_id_t *predecessor_id;
+  int predecessor_count;
+  svn_revnum_t copyfrom_rev;
+  const char *copyfrom_path;
+  const char *created_path;
+} history_entry_t;
+
+/* The history index file that we currently work with. */
+struct svn_fs_fs__history_index_t
+{
+  /* Owns all data below, cleared when switching to another file. */
+  apr_pool_t *pool;
+
+  /* File name of the index within the node-origins directory.  NULL if
+   * nothing has been loaded yet. */
+  const char *name;
+
+  /* The history_entry_t * read from the file, oldest first. */
+  apr_array_header_t *entries;
+
+  /* The history_entry_t * passed to svn_fs_fs__history_index_add() but
+   * not written to the file yet, youngest first.  Each entry is the
+   * predecessor of the previous one. */
+  apr_array_header_t *pending;
+};
+
+typedef struct svn_fs_fs__history_index_t history_index_t;
+
+/* Return the name of the history index file covering node revision ID.
+ * Allocate it in POOL. */
+static const char *
+index_name(const svn_fs_id_t *id,
+           apr_pool_t *pool)
+{
+  /* "<node-id>.<copy-id>.r<rev>/<item>" becomes "<node-id>.<copy-id>".
+   * Unlike the node origin files, this always contains a dot. */
+  const svn_string_t *id_str = svn_fs_fs__id_unparse(id, pool);
+  char *name = apr_pstrmemdup(pool, id_str->data, id_str->len);
+  *strrchr(name, '.') = '\0';
+
+  return name;
+}
+
+/* Read the history index file NAME of FS into *ENTRIES.  Return an empty
+ * array if the file does not exist.  Allocate the result in RESULT_POOL
+ * and use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_history_index(apr_array_header_t **entries,
+                   svn_fs_t *fs,
+                   const char *name,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  const char *path = svn_dirent_join_many(scratch_pool, fs->path,
+                                          PATH_NODE_ORIGINS_DIR, name,
+                                          SVN_VA_NULL);
+  svn_stringbuf_t *contents;
+  apr_int64_t count;
+  char *line, *next;
+  svn_error_t *err;
+
+  *entries = apr_array_make(result_pool, 0, sizeof(history_entry_t *));
+  err = svn_stringbuf_from_file2(&contents, path, result_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  if (strncmp(contents->data, HISTORY_INDEX_HEADER,
+              sizeof(HISTORY_INDEX_HEADER) - 1))
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("History index '%s' has an unsupported "
+                               "format"),
+                             svn_dirent_local_style(path, scratch_pool));
+
+  line = contents->data + sizeof(HISTORY_INDEX_HEADER) - 1;
+  next = strchr(line, '\n');
+  if (!next)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("History index '%s' is truncated"),
+                             svn_dirent_local_style(path, scratch_pool));
+
+  *next = '\0';
+  SVN_ERR(svn_cstring_atoi64(&count, line));
+
+  for (line = next + 1; *line; line = next + 1)
+    {
+      history_entry_t *entry = apr_pcalloc(result_pool, sizeof(*entry));
+      char *id, *predecessor_id, *predecessor_count, *copyfrom_rev;
+      apr_int64_t value;
+
+      next = strchr(line, '\n');
+      if (!next)
+        break;
+      *next = '\0';
+
+      id = svn_cstring_tokenize(" ", &line);
+      predecessor_id = svn_cstring_tokenize(" ", &line);
+      predecessor_count = svn_cstring_tokenize(" ", &line);
+      copyfrom_rev = svn_cstring_tokenize(" ", &line);
+      if (!copyfrom_rev || !line || *line != '/')
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Malformed entry in history index '%s'"),
+                                 svn_dirent_local_style(path,
+                                                        scratch_pool));
+
+      SVN_ERR(svn_fs_fs__id_parse(&entry->id, id, result_pool));
+      if (strcmp(predecessor_id, "-"))
+        SVN_ERR(svn_fs_fs__id_parse(&entry->predecessor_id, predecessor_id,
+                                    result_pool));
+      SVN_ERR(svn_cstring_strtoi64(&value, predecessor_count, 0, INT_MAX,
+                                   10));
+      entry->predecessor_count = (int)value;
+      SVN_ERR(svn_revnum_parse(&entry->copyfrom_rev, copyfrom_rev, NULL));
+      entry->created_path = line;
+
+      if (SVN_IS_VALID_REVNUM(entry->copyfrom_rev))
+        {
+          line = next + 1;
+          next = strchr(line, '\n');
+          if (!next)
+            break;
+          *next = '\0';
+          entry->copyfrom_path = line;
+        }
+
+      /* Lookups rely on the entries forming a chain. */
+      if ((*entries)->nelts)
+        {
+          history_entry_t *previous
+            = APR_ARRAY_IDX(*entries, (*entries)->nelts - 1,
+                            history_entry_t *);
+          if (   !entry->predecessor_id
+              || !svn_fs_fs__id_eq(entry->predecessor_id, previous->id)
+              || entry->predecessor_count != previous->predecessor_count + 1)
+            return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                     _("Broken predecessor chain in history "
+                                       "index '%s'"),
+                                     svn_dirent_local_style(path,
+                                                            scratch_pool));
+        }
+
+      APR_ARRAY_PUSH(*entries, history_entry_t *) = entry;
+    }
+
+  if ((*entries)->nelts != count)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("History index '%s' is truncated"),
+                             svn_dirent_local_style(path, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Write ENTRIES to the history index file NAME of FS.  Use SCRATCH_POOL
+ * for temporary allocations. */
+static svn_error_t *
+write_history_index(svn_fs_t *fs,
+                    const char *name,
+                    const apr_array_header_t *entries,
+                    apr_pool_t *scratch_pool)
+{
+  const char *dir = svn_dirent_join(fs->path, PATH_NODE_ORIGINS_DIR,
+                                    scratch_pool);
+  svn_stringbuf_t *contents = svn_stringbuf_create(HISTORY_INDEX_HEADER,
+                                                   scratch_pool);
+  svn_error_t *err;
+  int i;
+
+  svn_stringbuf_appendcstr(contents,
+                           apr_psprintf(scratch_pool, "%d\n",
+                                        entries->nelts));
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      const history_entry_t *entry
+        = APR_ARRAY_IDX(entries, i, const history_entry_t *);
+
+      svn_stringbuf_appendcstr(contents,
+        apr_psprintf(scratch_pool, "%s %s %d %ld %s\n",
+                     svn_fs_fs__id_unparse(entry->id, scratch_pool)->data,
+                     entry->predecessor_id
+                       ? svn_fs_fs__id_unparse(entry->predecessor_id,
+                                               scratch_pool)->data
+                       : "-",
+                     entry->predecessor_count,
+                     entry->copyfrom_rev,
+                     entry->created_path));
+      if (SVN_IS_VALID_REVNUM(entry->copyfrom_rev))
+        svn_stringbuf_appendcstr(contents,
+                                 apr_pstrcat(scratch_pool,
+                                             entry->copyfrom_path, "\n",
+                                             SVN_VA_NULL));
+    }
+
+  /* Sure, concurrent writers may overwrite each other's extensions.  But
+   * just like the node origins, this is only a cache and either result
+   * is a valid index. */
+  err = svn_fs_fs__ensure_dir_exists(dir, fs->path, scratch_pool);
+  if (!err)
+    err = svn_io_write_atomic2(svn_dirent_join(dir, name, scratch_pool),
+                               contents->data, contents->len, fs->path,
+                               FALSE, scratch_pool);
+
+  if (err && APR_STATUS_IS_EACCES(err->apr_err))
+    {
+      /* It's just a cache; stop trying if I can't write. */
+      svn_error_clear(err);
+      err = SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Return the history index state of FS, loaded for node revision ID.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_history_index(history_index_t **index,
+                  svn_fs_t *fs,
+                  const svn_fs_id_t *id,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  history_index_t *state = ffd->history_index_state;
+  const char *name = index_name(id, scratch_pool);
+
+  if (!state)
+    {
+      state = apr_pcalloc(fs->pool, sizeof(*state));
+      state->pool = svn_pool_create(fs->pool);
+      ffd->history_index_state = state;
+    }
+
+  if (!state->name || strcmp(state->name, name))
+    {
+      svn_pool_clear(state->pool);
+      state->name = NULL;
+      state->pending = apr_array_make(state->pool, 0,
+                                      sizeof(history_entry_t *));
+      SVN_ERR(read_history_index(&state->entries, fs, name, state->pool,
+                                 scratch_pool));
+      state->name = apr_pstrdup(state->pool, name);
+    }
+
+  *index = state;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the index of the last element in ENTRIES whose revision is not
+ * larger than REVISION, or -1 if there is none. */
+static int
+find_entry(const apr_array_header_t *entries,
+           svn_revnum_t revision)
+{
+  int lower = 0;
+  int upper = entries->nelts;
+
+  /* The revisions along a predecessor chain are strictly increasing. */
+  while (lower < upper)
+    {
+      int middle = lower + (upper - lower) / 2;
+      const history_entry_t *entry
+        = APR_ARRAY_IDX(entries, middle, const history_entry_t *);
+
+      if (svn_fs_fs__id_rev(entry->id) <= revision)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  return lower - 1;
+}
+
+svn_error_t *
+svn_fs_fs__history_index_lookup(svn_boolean_t *found,
+                                const svn_fs_id_t **predecessor_id,
+                                const char **created_path,
+                                svn_fs_t *fs,
+                                const svn_fs_id_t *id,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  history_index_t *index;
+  const history_entry_t *entry;
+  int i;
+
+  *found = FALSE;
+  if (!ffd->history_index || svn_fs_fs__id_is_txn(id))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_history_index(&index, fs, id, scratch_pool));
+  i = find_entry(index->entries, svn_fs_fs__id_rev(id));
+  if (i < 0)
+    return SVN_NO_ERROR;
+
+  entry = APR_ARRAY_IDX(index->entries, i, const history_entry_t *);
+  if (!svn_fs_fs__id_eq(entry->id, id))
+    return SVN_NO_ERROR;
+
+  *found = TRUE;
+  *predecessor_id = entry->predecessor_id
+                  ? svn_fs_fs__id_copy(entry->predecessor_id, result_pool)
+                  : NULL;
+  *created_path = apr_pstrdup(result_pool, entry->created_path);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__history_index_add(svn_fs_t *fs,
+                             const node_revision_t *noderev,
+                             svn_boolean_t last,
+                             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  history_index_t *index;
+  apr_array_header_t *entries;
+  history_entry_t *entry;
+  history_entry_t *oldest = NULL, *youngest = NULL;
+  int i;
+
+  if (!ffd->history_index || svn_fs_fs__id_is_txn(noderev->id))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_history_index(&index, fs, noderev->id, scratch_pool));
+  if (index->entries->nelts)
+    {
+      oldest = APR_ARRAY_IDX(index->entries, 0, history_entry_t *);
+      youngest = APR_ARRAY_IDX(index->entries, index->entries->nelts - 1,
+                               history_entry_t *);
+    }
+
+  /* Only collect contiguous parts of the predecessor chain. */
+  if (index->pending->nelts)
+    {
+      history_entry_t *previous
+        = APR_ARRAY_IDX(index->pending, index->pending->nelts - 1,
+                        history_entry_t *);
+      if (   !previous->predecessor_id
+          || !svn_fs_fs__id_eq(previous->predecessor_id, noderev->id))
+        apr_array_clear(index->pending);
+    }
+
+  entry = apr_pcalloc(index->pool, sizeof(*entry));
+  entry->id = svn_fs_fs__id_copy(noderev->id, index->pool);
+  entry->predecessor_id = noderev->predecessor_id
+                        ? svn_fs_fs__id_copy(noderev->predecessor_id,
+                                             index->pool)
+                        : NULL;
+  entry->predecessor_count = noderev->predecessor_count;
+  entry->copyfrom_rev = noderev->copyfrom_rev;
+  entry->copyfrom_path = apr_pstrdup(index->pool, noderev->copyfrom_path);
+  entry->created_path = apr_pstrdup(index->pool, noderev->created_path);
+  APR_ARRAY_PUSH(index->pending, history_entry_t *) = entry;
+
+  /* Keep collecting until the walk ends or reaches the indexed part. */
+  if (   !last
+      && !(   youngest && entry->predecessor_id
+           && svn_fs_fs__id_eq(entry->predecessor_id, youngest->id)))
+    return SVN_NO_ERROR;
+
+  /* Combine the pending entries with the ones in the file, if they are
+   * adjacent.  Otherwise, replace the file contents. */
+  entries = apr_array_make(index->pool,
+                           index->entries->nelts + index->pending->nelts,
+                           sizeof(history_entry_t *));
+  entry = APR_ARRAY_IDX(index->pending, 0, history_entry_t *);
+  if (oldest && oldest->predecessor_id
+      && svn_fs_fs__id_eq(oldest->predecessor_id, entry->id))
+    {
+      for (i = index->pending->nelts - 1; i >= 0; --i)
+        APR_ARRAY_PUSH(entries, history_entry_t *)
+          = APR_ARRAY_IDX(index->pending, i, history_entry_t *);
+      apr_array_cat(entries, index->entries);
+    }
+  else
+    {
+      entry = APR_ARRAY_IDX(index->pending, index->pending->nelts - 1,
+                            history_entry_t *);
+      if (youngest && entry->predecessor_id
+          && svn_fs_fs__id_eq(entry->predecessor_id, youngest->id))
+        apr_array_cat(entries, index->entries);
+
+      for (i = index->pending->nelts - 1; i >= 0; --i)
+        APR_ARRAY_PUSH(entries, history_entry_t *)
+          = APR_ARRAY_IDX(index->pending, i, history_entry_t *);
+    }
+
+  index->entries = entries;
+  apr_array_clear(index->pending);
+
+  return svn_error_trace(write_history_index(fs, index->name, entries,
+                                             scratch_pool));
+}
@@ -0,0 +1,69 @@
+/* history_index.h : interface to the persistent node history index
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_HISTORY_INDEX_H
+#define SVN_LIBSVN_FS_FS_HISTORY_INDEX_H
+
+#include "fs.h"
+
+/* Next to the node origins, the node-origins directory may contain
+ * history index files.  Each describes a contiguous part of the
+ * predecessor chain of one node / copy ID pair, i.e. the successive
+ * modifications of a node between two copies.  Walking the linear parts
+ * of a node's history can then be done from a single small file instead
+ * of reading every node revision from the revision files.
+ *
+ * Like the node origins, these files are a cache of reconstructible data.
+ * They get written lazily while history is being traced.
+ */
+
+/* If the history index of FS knows the node revision ID, set *FOUND to
+ * TRUE, *PREDECESSOR_ID to its predecessor (NULL, if there is none) and
+ * *CREATED_PATH to its created path, both allocated in RESULT_POOL.
+ * Otherwise, set *FOUND to FALSE.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+svn_error_t *
+svn_fs_fs__history_index_lookup(svn_boolean_t *found,
+                                const svn_fs_id_t **predecessor_id,
+                                const char **created_path,
+                                svn_fs_t *fs,
+                                const svn_fs_id_t *id,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
+/* Tell the history index of FS about NODEREV, which has just been read
+ * while walking a node's predecessor chain from young to old and could
+ * not be found by svn_fs_fs__history_index_lookup().  Set LAST if the
+ * walk does not continue with NODEREV's predecessor.  Use SCRATCH_POOL
+ * for temporary allocations.
+ *
+ * Because this is just a cache, failing to write it due to insufficient
+ * permissions will not be reported as an error.
+ */
+svn_error_t *
+svn_fs_fs__history_index_add(svn_fs_t *fs,
+                             const node_revision_t *noderev,
+                             svn_boolean_t last,
+                             apr_pool_t *scratch_pool);
+
+#endif
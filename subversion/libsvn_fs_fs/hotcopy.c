@@ -22,6 +22,9 @@
 #include "svn_pools.h"
 #include "svn_path.h"
 #include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_sorts.h"
+#include "private/svn_subr_private.h"
 
 #include "fs_fs.h"
 #include "hotcopy.h"
@@ -34,16 +37,56 @@
 
 #include "svn_private_config.h"
 
+/* Upper limit to the number of shards being copied concurrently.
+ */
+#define MAX_HOTCOPY_JOBS 256
+
+/* Number of revisions to copy per job if the repository is not sharded.
+ */
+#define UNSHARDED_JOB_SIZE 1000
+
+/* Try to make DST_TARGET a hard link to the existing file SRC_TARGET.
+ * DST_TARGET must not exist.  Set *LINKED to FALSE if the link could not
+ * be created, e.g. because the platform or file system does not support
+ * it or because both paths are on different devices.  The caller should
+ * then copy the file instead.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+hotcopy_link_file(svn_boolean_t *linked,
+                  const char *src_target,
+                  const char *dst_target,
+                  apr_pool_t *scratch_pool)
+{
+  const char *src_apr;
+  const char *dst_apr;
+
+  SVN_ERR(svn_path_cstring_from_utf8(&src_apr,
+                                     svn_dirent_local_style(src_target,
+                                                            scratch_pool),
+                                     scratch_pool));
+  SVN_ERR(svn_path_cstring_from_utf8(&dst_apr,
+                                     svn_dirent_local_style(dst_target,
+                                                            scratch_pool),
+                                     scratch_pool));
+
+  *linked = apr_file_link(src_apr, dst_apr) == APR_SUCCESS;
+
+  return SVN_NO_ERROR;
+}
+
 /* Like svn_io_dir_file_copy(), but doesn't copy files that exist at
  * the destination and do not differ in terms of kind, size, and mtime.
  * Set *SKIPPED_P to FALSE only if the file was copied, do not change
  * the value in *SKIPPED_P otherwise. SKIPPED_P may be NULL if not
- * required. */
+ * required.  If LINK_FILE is set and the destination does not exist,
+ * try to hard-link it to the source instead of copying the contents.
+ * Only do that for files that never get modified in place. */
 static svn_error_t *
 hotcopy_io_dir_file_copy(svn_boolean_t *skipped_p,
                          const char *src_path,
                          const char *dst_path,
                          const char *file,
+                         svn_boolean_t link_file,
                          apr_pool_t *scratch_pool)
 {
   const svn_io_dirent2_t *src_dirent;
@@ -72,6 +115,18 @@ hotcopy_io_dir_file_copy(svn_boolean_t *skipped_p,
   if (skipped_p)
     *skipped_p = FALSE;
 
+  if (link_file && dst_dirent->kind == svn_node_none)
+    {
+      svn_boolean_t linked;
+
+      SVN_ERR(hotcopy_link_file(&linked,
+                                svn_dirent_join(src_path, file,
+                                                scratch_pool),
+                                dst_target, scratch_pool));
+      if (linked)
+        return SVN_NO_ERROR;
+    }
+
   return svn_error_trace(svn_io_dir_file_copy(src_path, dst_path, file,
                                               scratch_pool));
 }
@@ -115,13 +170,15 @@ entry_name_to_utf8(const char **name_p,
  * exist in the destination and do not differ from the source in terms of
  * kind, size, and mtime. Set *SKIPPED_P to FALSE only if at least one
  * file was copied, do not change the value in *SKIPPED_P otherwise.
- * SKIPPED_P may be NULL if not required. */
+ * SKIPPED_P may be NULL if not required.  LINK_FILES is passed through
+ * to hotcopy_io_dir_file_copy(). */
 static svn_error_t *
 hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
                                 const char *src,
                                 const char *dst_parent,
                                 const char *dst_basename,
                                 svn_boolean_t copy_perms,
+                                svn_boolean_t link_files,
                                 svn_cancel_func_t cancel_func,
                                 void *cancel_baton,
                                 apr_pool_t *pool)
@@ -185,7 +242,8 @@ hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
           if (this_entry.filetype == APR_REG) /* regular file */
             {
               SVN_ERR(hotcopy_io_dir_file_copy(skipped_p, src, dst_path,
-                                               entryname_utf8, subpool));
+                                               entryname_utf8, link_files,
+                                               subpool));
             }
           else if (this_entry.filetype == APR_LNK) /* symlink */
             {
@@ -213,6 +271,7 @@ hotcopy_io_copy_dir_recursively(svn_boolean_t *skipped_p,
                                                       dst_path,
                                                       entryname_utf8,
                                                       copy_perms,
+                                                      link_files,
                                                       cancel_func,
                                                       cancel_baton,
                                                       subpool));
@@ -271,7 +330,7 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
   SVN_ERR(hotcopy_io_dir_file_copy(skipped_p,
                                    src_subdir_shard, dst_subdir_shard,
                                    apr_psprintf(scratch_pool, "%ld", rev),
-                                   scratch_pool));
+                                   FALSE, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -279,19 +338,27 @@ hotcopy_copy_shard_file(svn_boolean_t *skipped_p,
 
 /* Copy a packed shard containing revision REV, and which contains
  * MAX_FILES_PER_DIR revisions, from SRC_FS to DST_FS.
- * Update *DST_MIN_UNPACKED_REV in case the shard is new in DST_FS.
  * Do not re-copy data which already exists in DST_FS.
  * Set *SKIPPED_P to FALSE only if at least one part of the shard
  * was copied, do not change the value in *SKIPPED_P otherwise.
  * SKIPPED_P may be NULL if not required.
+ *
+ * This only touches the shard's own files and may therefore run
+ * concurrently with copying other shards.  The caller is responsible
+ * for updating the min-unpacked-rev of DST_FS.
+ *
+ * If LINK_FILES is set, try to hard-link the pack and index files instead
+ * of copying them.  They never change once the shard has been packed.
+ * Packed revprops are always being copied.
+ *
  * Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
 hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
-                          svn_revnum_t *dst_min_unpacked_rev,
                           svn_fs_t *src_fs,
                           svn_fs_t *dst_fs,
                           svn_revnum_t rev,
                           int max_files_per_dir,
+                          svn_boolean_t link_files,
                           apr_pool_t *scratch_pool)
 {
   const char *src_subdir;
@@ -312,6 +379,7 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
   SVN_ERR(hotcopy_io_copy_dir_recursively(skipped_p, src_subdir_packed_shard,
                                           dst_subdir, packed_shard,
                                           TRUE /* copy_perms */,
+                                          link_files,
                                           NULL /* cancel_func */, NULL,
                                           scratch_pool));
 
@@ -353,19 +421,11 @@ hotcopy_copy_packed_shard(svn_boolean_t *skipped_p,
                                               src_subdir_packed_shard,
                                               dst_subdir, packed_shard,
                                               TRUE /* copy_perms */,
+                                              FALSE /* link_files */,
                                               NULL /* cancel_func */, NULL,
                                               scratch_pool));
     }
 
-  /* If necessary, update the min-unpacked rev file in the hotcopy. */
-  if (*dst_min_unpacked_rev < rev + max_files_per_dir)
-    {
-      *dst_min_unpacked_rev = rev + max_files_per_dir;
-      SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
-                                                *dst_min_unpacked_rev,
-                                                scratch_pool));
-    }
-
   return SVN_NO_ERROR;
 }
 
@@ -532,13 +592,252 @@ remove_folder(const char *path,
   return svn_error_trace(err);
 }
 
+/* A range of revisions whose rev and revprop files get copied by
+ * hotcopy_revisions() in one go, possibly by a worker thread.  Ranges are
+ * being processed as jobs of a svn_fs_fs__job_ring_t. */
+typedef struct hotcopy_job_t
+{
+  /* Source and destination filesystem.  Workers only read their paths
+   * and format information but never use them to access the repository. */
+  svn_fs_t *src_fs;
+  svn_fs_t *dst_fs;
+
+  /* Rev and revprop folders of the source and destination. */
+  const char *src_revs_dir;
+  const char *dst_revs_dir;
+  const char *src_revprops_dir;
+  const char *dst_revprops_dir;
+
+  /* Copy revisions START_REV up to but not including END_REV.  If PACKED
+   * is set, this is exactly one packed shard. */
+  svn_revnum_t start_rev;
+  svn_revnum_t end_rev;
+  svn_boolean_t packed;
+
+  /* Whether to hard-link packed shards instead of copying them. */
+  svn_boolean_t link_files;
+
+  /* Whether the files of a revision already existed in the destination,
+   * indexed by the revision's offset from START_REV.  Packed shards only
+   * use the first element.  Allocated in the job's pool. */
+  svn_boolean_t *skipped;
+} hotcopy_job_t;
+
+/* Implements svn_fs_fs__job_func_t, copying all files of the hotcopy_job_t
+ * in BATON without doing any bookkeeping in the destination.  FS is not
+ * used.  Allocate the results in POOL.  */
+static svn_error_t *
+hotcopy_copy_range(void *baton,
+                   svn_fs_t *fs,
+                   apr_pool_t *pool)
+{
+  hotcopy_job_t *job = baton;
+  fs_fs_data_t *src_ffd = job->src_fs->fsap_data;
+  int max_files_per_dir = src_ffd->max_files_per_dir;
+  apr_pool_t *iterpool;
+  svn_revnum_t rev;
+
+  job->skipped = apr_palloc(pool, (job->end_rev - job->start_rev)
+                                  * sizeof(*job->skipped));
+  for (rev = job->start_rev; rev < job->end_rev; rev++)
+    job->skipped[rev - job->start_rev] = TRUE;
+
+  if (job->packed)
+    return svn_error_trace(hotcopy_copy_packed_shard(&job->skipped[0],
+                                                     job->src_fs,
+                                                     job->dst_fs,
+                                                     job->start_rev,
+                                                     max_files_per_dir,
+                                                     job->link_files,
+                                                     pool));
+
+  iterpool = svn_pool_create(pool);
+  for (rev = job->start_rev; rev < job->end_rev; rev++)
+    {
+      svn_boolean_t *skipped = &job->skipped[rev - job->start_rev];
+      svn_pool_clear(iterpool);
+
+      /* Copying non-packed revisions is racy in case the source repository
+       * is being packed concurrently with this hotcopy operation. The race
+       * can happen with FS formats prior to SVN_FS_FS__MIN_PACK_LOCK_FORMAT
+       * that support packed revisions. With the pack lock, however, the
+       * race is impossible, because hotcopy and pack operations block each
+       * other.
+       *
+       * We assume that all revisions coming after 'min-unpacked-rev' really
+       * are unpacked and that's not necessarily true with concurrent
+       * packing.  Don't try to be smart in this edge case, because handling
+       * it properly might require copying *everything* from the start.
+       * Just abort the hotcopy with an ENOENT (revision file moved to a
+       * pack, so it is no longer where we expect it to be). */
+
+      /* Copy the rev file. */
+      SVN_ERR(hotcopy_copy_shard_file(skipped,
+                                      job->src_revs_dir, job->dst_revs_dir,
+                                      rev, max_files_per_dir,
+                                      iterpool));
+      /* Copy the revprop file. */
+      SVN_ERR(hotcopy_copy_shard_file(skipped,
+                                      job->src_revprops_dir,
+                                      job->dst_revprops_dir,
+                                      rev, max_files_per_dir,
+                                      iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the end of the revision range that hotcopy_revisions() shall
+ * copy in one job starting at REV.  Packed shards below MIN_UNPACKED_REV
+ * form jobs of their own, unpacked revisions are grouped by shard.
+ * Never go beyond YOUNGEST. */
+static svn_revnum_t
+hotcopy_range_end(svn_revnum_t rev,
+                  svn_revnum_t min_unpacked_rev,
+                  svn_revnum_t youngest,
+                  int max_files_per_dir)
+{
+  if (rev < min_unpacked_rev)
+    return rev + max_files_per_dir;
+
+  if (max_files_per_dir)
+    return MIN(youngest + 1, (rev / max_files_per_dir + 1)
+                             * max_files_per_dir);
+
+  return MIN(youngest + 1, rev + UNSHARDED_JOB_SIZE);
+}
+
+/* After the files of the packed shard in JOB have been copied, switch
+ * DST_FS over to it:  Update *DST_MIN_UNPACKED_REV and 'current' if
+ * necessary, notify about the shard and remove any non-packed files that
+ * an earlier incremental hotcopy may have left.  DST_YOUNGEST, INCREMENTAL,
+ * NOTIFY_FUNC, NOTIFY_BATON, CANCEL_FUNC and CANCEL_BATON are as for
+ * hotcopy_revisions().  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+hotcopy_finish_packed_shard(const hotcopy_job_t *job,
+                            svn_revnum_t *dst_min_unpacked_rev,
+                            svn_revnum_t dst_youngest,
+                            svn_boolean_t incremental,
+                            svn_fs_hotcopy_notify_t notify_func,
+                            void* notify_baton,
+                            svn_cancel_func_t cancel_func,
+                            void* cancel_baton,
+                            apr_pool_t *scratch_pool)
+{
+  svn_fs_t *dst_fs = job->dst_fs;
+  fs_fs_data_t *dst_ffd = dst_fs->fsap_data;
+  svn_revnum_t rev = job->start_rev;
+  svn_revnum_t pack_end_rev = job->end_rev - 1;
+  int max_files_per_dir = (int)(job->end_rev - job->start_rev);
+
+  /* If necessary, update the min-unpacked rev file in the hotcopy. */
+  if (*dst_min_unpacked_rev < job->end_rev)
+    {
+      *dst_min_unpacked_rev = job->end_rev;
+      SVN_ERR(svn_fs_fs__write_min_unpacked_rev(dst_fs,
+                                                *dst_min_unpacked_rev,
+                                                scratch_pool));
+    }
+
+  /* Whenever this pack did not previously exist in the destination,
+   * update 'current' to the most recent packed rev (so readers can see
+   * new revisions which arrived in this pack). */
+  if (pack_end_rev > dst_youngest)
+    {
+      SVN_ERR(svn_fs_fs__write_current(dst_fs, pack_end_rev, 0, 0,
+                                       scratch_pool));
+    }
+
+  /* When notifying about packed shards, make things simpler by either
+   * reporting a full revision range, i.e [pack start, pack end] or
+   * reporting nothing. There is one case when this approach might not
+   * be exact (incremental hotcopy with a pack replacing last unpacked
+   * revisions), but generally this is good enough. */
+  if (notify_func && !job->skipped[0])
+    notify_func(notify_baton, rev, pack_end_rev, scratch_pool);
+
+  /* Remove revision files which are now packed. */
+  if (incremental)
+    {
+      SVN_ERR(hotcopy_remove_rev_files(dst_fs, rev,
+                                       rev + max_files_per_dir,
+                                       max_files_per_dir, scratch_pool));
+      if (dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
+        SVN_ERR(hotcopy_remove_revprop_files(dst_fs, rev,
+                                             rev + max_files_per_dir,
+                                             max_files_per_dir,
+                                             scratch_pool));
+    }
+
+  /* Now that all revisions have moved into the pack, the original
+   * rev dir can be removed. */
+  SVN_ERR(remove_folder(svn_fs_fs__path_rev_shard(dst_fs, rev, scratch_pool),
+                        cancel_func, cancel_baton, scratch_pool));
+  if (rev > 0 && dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
+    SVN_ERR(remove_folder(svn_fs_fs__path_revprops_shard(dst_fs, rev,
+                                                         scratch_pool),
+                          cancel_func, cancel_baton, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* After the files of the non-packed revisions in JOB have been copied,
+ * checkpoint the progress in the destination's 'current' file if the
+ * job completed a whole shard that did not previously exist there, and
+ * report each copied revision.  DST_YOUNGEST, NOTIFY_FUNC and NOTIFY_BATON
+ * are as for hotcopy_revisions().  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+hotcopy_finish_unpacked_range(const hotcopy_job_t *job,
+                              svn_revnum_t dst_youngest,
+                              svn_fs_hotcopy_notify_t notify_func,
+                              void* notify_baton,
+                              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *src_ffd = job->src_fs->fsap_data;
+  int max_files_per_dir = src_ffd->max_files_per_dir;
+  svn_revnum_t rev;
+
+  /* Whenever this shard did not previously exist in the destination,
+   * checkpoint the progress via 'current' (do that once per full shard
+   * in order not to slow things down). */
+  if (   max_files_per_dir
+      && job->end_rev % max_files_per_dir == 0
+      && job->end_rev - 1 > dst_youngest)
+    {
+      SVN_ERR(svn_fs_fs__write_current(job->dst_fs, job->end_rev - 1, 0, 0,
+                                       scratch_pool));
+    }
+
+  if (notify_func)
+    for (rev = job->start_rev; rev < job->end_rev; rev++)
+      if (!job->skipped[rev - job->start_rev])
+        notify_func(notify_baton, rev, rev, scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Copy the revision and revprop files (possibly sharded / packed) from
  * SRC_FS to DST_FS.  Do not re-copy data which already exists in DST_FS.
  * When copying packed or unpacked shards, checkpoint the result in DST_FS
  * for every shard by updating the 'current' file if necessary.  Assume
  * the >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT filesystem format without
  * global next-ID counters.  Indicate progress via the optional NOTIFY_FUNC
- * callback using NOTIFY_BATON.  Use POOL for temporary allocations.
+ * callback using NOTIFY_BATON.
+ *
+ * If SRC_FS has been configured with SVN_FS_CONFIG_FSFS_HOTCOPY_LINK,
+ * hard-link packed shards instead of copying them.
+ *
+ * If SRC_FS has been configured with SVN_FS_CONFIG_FSFS_HOTCOPY_JOBS, copy
+ * that many shards concurrently.  Only the file copying happens in worker
+ * threads.  Switching DST_FS over to new packs, checkpointing, removing
+ * obsolete files, notifications and cancellation happen in the calling
+ * thread and in revision order, so readers of DST_FS see the same sequence
+ * of states as with a sequential hotcopy.  Use POOL for temporary
+ * allocations.
  */
 static svn_error_t *
 hotcopy_revisions(svn_fs_t *src_fs,
@@ -557,12 +856,17 @@ hotcopy_revisions(svn_fs_t *src_fs,
                   apr_pool_t *pool)
 {
   fs_fs_data_t *src_ffd = src_fs->fsap_data;
-  fs_fs_data_t *dst_ffd = dst_fs->fsap_data;
   int max_files_per_dir = src_ffd->max_files_per_dir;
   svn_revnum_t src_min_unpacked_rev;
   svn_revnum_t dst_min_unpacked_rev;
   svn_revnum_t rev;
+  svn_revnum_t next_rev;
   apr_pool_t *iterpool;
+  hotcopy_job_t common = { 0 };
+  svn_fs_fs__job_ring_t *ring;
+  const char *jobs_str;
+  int job_count = 1;
+  svn_error_t *err = SVN_NO_ERROR;
 
   /* Copy the min unpacked rev, and read its value. */
   if (src_ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
@@ -596,130 +900,86 @@ hotcopy_revisions(svn_fs_t *src_fs,
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
 
-  /*
-   * Copy the necessary rev files.
-   */
-
-  iterpool = svn_pool_create(pool);
-  /* First, copy packed shards. */
-  for (rev = 0; rev < src_min_unpacked_rev; rev += max_files_per_dir)
+  jobs_str = src_fs->config
+           ? svn_hash_gets(src_fs->config, SVN_FS_CONFIG_FSFS_HOTCOPY_JOBS)
+           : NULL;
+  if (jobs_str)
     {
-      svn_boolean_t skipped = TRUE;
-      svn_revnum_t pack_end_rev;
-
-      svn_pool_clear(iterpool);
-
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-
-      /* Copy the packed shard. */
-      SVN_ERR(hotcopy_copy_packed_shard(&skipped, &dst_min_unpacked_rev,
-                                        src_fs, dst_fs,
-                                        rev, max_files_per_dir,
-                                        iterpool));
-
-      pack_end_rev = rev + max_files_per_dir - 1;
-
-      /* Whenever this pack did not previously exist in the destination,
-       * update 'current' to the most recent packed rev (so readers can see
-       * new revisions which arrived in this pack). */
-      if (pack_end_rev > dst_youngest)
-        {
-          SVN_ERR(svn_fs_fs__write_current(dst_fs, pack_end_rev, 0, 0,
-                                           iterpool));
-        }
-
-      /* When notifying about packed shards, make things simpler by either
-       * reporting a full revision range, i.e [pack start, pack end] or
-       * reporting nothing. There is one case when this approach might not
-       * be exact (incremental hotcopy with a pack replacing last unpacked
-       * revisions), but generally this is good enough. */
-      if (notify_func && !skipped)
-        notify_func(notify_baton, rev, pack_end_rev, iterpool);
-
-      /* Remove revision files which are now packed. */
-      if (incremental)
-        {
-          SVN_ERR(hotcopy_remove_rev_files(dst_fs, rev,
-                                           rev + max_files_per_dir,
-                                           max_files_per_dir, iterpool));
-          if (dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
-            SVN_ERR(hotcopy_remove_revprop_files(dst_fs, rev,
-                                                 rev + max_files_per_dir,
-                                                 max_files_per_dir,
-                                                 iterpool));
-        }
-
-      /* Now that all revisions have moved into the pack, the original
-       * rev dir can be removed. */
-      SVN_ERR(remove_folder(svn_fs_fs__path_rev_shard(dst_fs, rev, iterpool),
-                            cancel_func, cancel_baton, iterpool));
-      if (rev > 0 && dst_ffd->format >= SVN_FS_FS__MIN_PACKED_REVPROP_FORMAT)
-        SVN_ERR(remove_folder(svn_fs_fs__path_revprops_shard(dst_fs, rev,
-                                                             iterpool),
-                              cancel_func, cancel_baton, iterpool));
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, jobs_str, 0, MAX_HOTCOPY_JOBS, 10));
+      job_count = MAX(1, (int)val);
     }
 
-  if (cancel_func)
-    SVN_ERR(cancel_func(cancel_baton));
+  /* The workers never access the repositories themselves. */
+  ring = svn_fs_fs__job_ring_create(NULL, job_count, sizeof(hotcopy_job_t),
+                                    hotcopy_copy_range, pool);
 
-  SVN_ERR_ASSERT(rev == src_min_unpacked_rev);
-  SVN_ERR_ASSERT(src_min_unpacked_rev == dst_min_unpacked_rev);
+  common.src_fs = src_fs;
+  common.dst_fs = dst_fs;
+  common.src_revs_dir = src_revs_dir;
+  common.dst_revs_dir = dst_revs_dir;
+  common.src_revprops_dir = src_revprops_dir;
+  common.dst_revprops_dir = dst_revprops_dir;
+  common.link_files = svn_hash__get_bool(src_fs->config,
+                                         SVN_FS_CONFIG_FSFS_HOTCOPY_LINK,
+                                         FALSE);
 
-  /* Now, copy pairs of non-packed revisions and revprop files.
-   * If necessary, update 'current' after copying all files from a shard. */
-  for (; rev <= src_youngest; rev++)
+  /*
+   * Copy the necessary rev files.  Packed shards come first, followed by
+   * pairs of non-packed revision and revprop files.  In both cases, one
+   * job covers one shard.
+   */
+
+  iterpool = svn_pool_create(pool);
+  for (rev = 0, next_rev = 0; rev <= src_youngest && !err; )
     {
-      svn_boolean_t skipped = TRUE;
+      hotcopy_job_t *job;
 
       svn_pool_clear(iterpool);
 
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-
-      /* Copying non-packed revisions is racy in case the source repository is
-       * being packed concurrently with this hotcopy operation. The race can
-       * happen with FS formats prior to SVN_FS_FS__MIN_PACK_LOCK_FORMAT that
-       * support packed revisions. With the pack lock, however, the race is
-       * impossible, because hotcopy and pack operations block each other.
-       *
-       * We assume that all revisions coming after 'min-unpacked-rev' really
-       * are unpacked and that's not necessarily true with concurrent packing.
-       * Don't try to be smart in this edge case, because handling it properly
-       * might require copying *everything* from the start. Just abort the
-       * hotcopy with an ENOENT (revision file moved to a pack, so it is no
-       * longer where we expect it to be). */
-
-      /* Copy the rev file. */
-      SVN_ERR(hotcopy_copy_shard_file(&skipped,
-                                      src_revs_dir, dst_revs_dir, rev,
-                                      max_files_per_dir,
-                                      iterpool));
-      /* Copy the revprop file. */
-      SVN_ERR(hotcopy_copy_shard_file(&skipped,
-                                      src_revprops_dir, dst_revprops_dir,
-                                      rev, max_files_per_dir,
-                                      iterpool));
-
-      /* Whenever this revision did not previously exist in the destination,
-       * checkpoint the progress via 'current' (do that once per full shard
-       * in order not to slow things down). */
-      if (rev > dst_youngest)
+      /* Keep up to JOB_COUNT ranges in flight. */
+      while (next_rev <= src_youngest
+             && !svn_fs_fs__job_ring_is_full(ring))
         {
-          if (max_files_per_dir && (rev % max_files_per_dir == 0))
-            {
-              SVN_ERR(svn_fs_fs__write_current(dst_fs, rev, 0, 0,
-                                               iterpool));
-            }
+          hotcopy_job_t new_job = common;
+          new_job.start_rev = next_rev;
+          new_job.end_rev = hotcopy_range_end(next_rev, src_min_unpacked_rev,
+                                              src_youngest,
+                                              max_files_per_dir);
+          new_job.packed = next_rev < src_min_unpacked_rev;
+          svn_fs_fs__job_ring_push(ring, &new_job);
+          next_rev = new_job.end_rev;
         }
 
-      if (notify_func && !skipped)
-        notify_func(notify_baton, rev, rev, iterpool);
+      /* Process the results one range at a time and in order. */
+      err = svn_fs_fs__job_ring_wait((void **)&job, ring);
+      if (!err && job->packed)
+        err = hotcopy_finish_packed_shard(job, &dst_min_unpacked_rev,
+                                          dst_youngest, incremental,
+                                          notify_func, notify_baton,
+                                          cancel_func, cancel_baton,
+                                          iterpool);
+      else if (!err)
+        err = hotcopy_finish_unpacked_range(job, dst_youngest,
+                                            notify_func, notify_baton,
+                                            iterpool);
+
+      rev = job->end_rev;
+      svn_fs_fs__job_ring_pop(ring);
+
+      if (!err && cancel_func)
+        err = cancel_func(cancel_baton);
     }
+
+  /* Don't leave any workers behind.  Whatever they copied will simply be
+   * skipped by the next incremental hotcopy. */
+  svn_fs_fs__job_ring_clear(ring);
   svn_pool_destroy(iterpool);
+  SVN_ERR(err);
 
   /* We assume that all revisions were copied now, i.e. we didn't exit the
-   * above loop early. 'rev' was last incremented during exit of the loop. */
+   * above loop early. */
+  SVN_ERR_ASSERT(src_min_unpacked_rev == dst_min_unpacked_rev);
   SVN_ERR_ASSERT(rev == src_youngest + 1);
 
   return SVN_NO_ERROR;
@@ -965,7 +1225,7 @@ hotcopy_body(void *baton, apr_pool_t *pool)
   if (kind == svn_node_dir)
     SVN_ERR(hotcopy_io_copy_dir_recursively(NULL, src_subdir, dst_fs->path,
                                             PATH_NODE_ORIGINS_DIR, TRUE,
-                                            cancel_func, cancel_baton, pool));
+                                            FALSE, cancel_func, cancel_baton, pool));
 
   /*
    * NB: Data copied below is only read by writers, not readers.
@@ -186,6 +186,10 @@ struct svn_fs_fs__packed_number_stream_t
   /* underlying data file containing the packed values */
   apr_file_t *file;
 
+  /* Memory mapping of the whole FILE or NULL.  If given, all data will
+   * be decoded directly from there instead of reading FILE. */
+  const unsigned char *mapped_data;
+
   /* Offset within FILE at which the stream data starts
    * (i.e. which offset will reported as offset 0 by packed_stream_offset). */
   apr_off_t stream_start;
@@ -250,43 +254,57 @@ SVN__PREVENT_INLINE
 static svn_error_t *
 packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 {
-  unsigned char buffer[MAX_NUMBER_PREFETCH];
+  unsigned char file_buffer[MAX_NUMBER_PREFETCH];
+  const unsigned char *buffer = file_buffer;
+  const unsigned char *end;
+  apr_uint64_t values[MAX_NUMBER_PREFETCH];
+  apr_size_t ends[MAX_NUMBER_PREFETCH];
   apr_size_t bytes_read = 0;
+  apr_size_t count;
   apr_size_t i;
-  value_position_pair_t *target;
   apr_off_t block_start = 0;
   apr_off_t block_left = 0;
-  apr_status_t err;
+  apr_status_t err = APR_SUCCESS;
 
   /* all buffered data will have been read starting here */
   stream->start_offset = stream->next_offset;
 
-  /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH blocks,
-   * i.e. the last number has been incomplete (and not buffered in stream)
-   * and need to be re-read.  Therefore, always correct the file pointer.
-   */
-  SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
-                                   &block_start, stream->next_offset,
-                                   stream->pool));
+  if (stream->mapped_data)
+    {
+      /* No I/O nor copying required.  Simply decode from memory. */
+      buffer = stream->mapped_data + stream->next_offset;
+      bytes_read = (apr_size_t)MIN(sizeof(file_buffer),
+                                   stream->stream_end - stream->next_offset);
+    }
+  else
+    {
+      /* packed numbers are usually not aligned to MAX_NUMBER_PREFETCH blocks,
+       * i.e. the last number has been incomplete (and not buffered in stream)
+       * and need to be re-read.  Therefore, always correct the file pointer.
+       */
+      SVN_ERR(svn_io_file_aligned_seek(stream->file, stream->block_size,
+                                       &block_start, stream->next_offset,
+                                       stream->pool));
 
-  /* prefetch at least one number but, if feasible, don't cross block
-   * boundaries.  This shall prevent jumping back and forth between two
-   * blocks because the extra data was not actually request _now_.
-   */
-  bytes_read = sizeof(buffer);
-  block_left = stream->block_size - (stream->next_offset - block_start);
-  if (block_left >= 10 && block_left < bytes_read)
-    bytes_read = (apr_size_t)block_left;
-
-  /* Don't read beyond the end of the file section that belongs to this
-   * index / stream. */
-  bytes_read = (apr_size_t)MIN(bytes_read,
-                               stream->stream_end - stream->next_offset);
-
-  err = apr_file_read(stream->file, buffer, &bytes_read);
-  if (err && !APR_STATUS_IS_EOF(err))
-    return stream_error_create(stream, err,
-      _("Can't read index file '%s' at offset 0x%s"));
+      /* prefetch at least one number but, if feasible, don't cross block
+       * boundaries.  This shall prevent jumping back and forth between two
+       * blocks because the extra data was not actually request _now_.
+       */
+      bytes_read = sizeof(file_buffer);
+      block_left = stream->block_size - (stream->next_offset - block_start);
+      if (block_left >= 10 && block_left < bytes_read)
+        bytes_read = (apr_size_t)block_left;
+
+      /* Don't read beyond the end of the file section that belongs to this
+       * index / stream. */
+      bytes_read = (apr_size_t)MIN(bytes_read,
+                                   stream->stream_end - stream->next_offset);
+
+      err = apr_file_read(stream->file, file_buffer, &bytes_read);
+      if (err && !APR_STATUS_IS_EOF(err))
+        return stream_error_create(stream, err,
+          _("Can't read index file '%s' at offset 0x%s"));
+    }
 
   /* if the last number is incomplete, trim it from the buffer */
   while (bytes_read > 0 && buffer[bytes_read-1] >= 0x80)
@@ -298,46 +316,26 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
     return stream_error_create(stream, err,
       _("Unexpected end of index file %s at offset 0x%s"));
 
-  /* parse file buffer and expand into stream buffer */
-  target = stream->buffer;
-  for (i = 0; i < bytes_read;)
-    {
-      if (buffer[i] < 0x80)
-        {
-          /* numbers < 128 are relatively frequent and particularly easy
-           * to decode.  Give them special treatment. */
-          target->value = buffer[i];
-          ++i;
-          target->total_len = i;
-          ++target;
-        }
-      else
-        {
-          apr_uint64_t value = 0;
-          apr_uint64_t shift = 0;
-          while (buffer[i] >= 0x80)
-            {
-              value += ((apr_uint64_t)buffer[i] & 0x7f) << shift;
-              shift += 7;
-              ++i;
-            }
+  /* parse file buffer and expand into stream buffer.  Runs of numbers
+   * < 128 are relatively frequent and get decoded en bloc. */
+  count = MAX_NUMBER_PREFETCH;
+  end = svn__decode_uints(values, ends, &count, buffer, buffer + bytes_read);
 
-          target->value = value + ((apr_uint64_t)buffer[i] << shift);
-          ++i;
-          target->total_len = i;
-          ++target;
-
-          /* let's catch corrupted data early.  It would surely cause
-           * havoc further down the line. */
-          if SVN__PREDICT_FALSE(shift > 8 * sizeof(value))
-            return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
-                                     _("Corrupt index: number too large"));
-       }
+  /* let's catch corrupted data early.  It would surely cause
+   * havoc further down the line. */
+  if SVN__PREDICT_FALSE(end != buffer + bytes_read)
+    return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                             _("Corrupt index: number too large"));
+
+  for (i = 0; i < count; ++i)
+    {
+      stream->buffer[i].value = values[i];
+      stream->buffer[i].total_len = ends[i];
     }
 
   /* update stream state */
-  stream->used = target - stream->buffer;
-  stream->next_offset = stream->start_offset + i;
+  stream->used = count;
+  stream->next_offset = stream->start_offset + bytes_read;
   stream->current = 0;
 
   return SVN_NO_ERROR;
@@ -345,12 +343,15 @@ packed_stream_read(svn_fs_fs__packed_number_stream_t *stream)
 
 /* Create and open a packed number stream reading from offsets START to
  * END in FILE and return it in *STREAM.  Access the file in chunks of
- * BLOCK_SIZE bytes.  Expect the stream to be prefixed by STREAM_PREFIX.
- * Allocate *STREAM in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ * BLOCK_SIZE bytes.  If MAPPED_DATA is not NULL, it must map the whole
+ * FILE and will be read instead.  Expect the stream to be prefixed by
+ * STREAM_PREFIX.  Allocate *STREAM in RESULT_POOL and use SCRATCH_POOL
+ * for temporaries.
  */
 static svn_error_t *
 packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
                    apr_file_t *file,
+                   const unsigned char *mapped_data,
                    apr_off_t start,
                    apr_off_t end,
                    const char *stream_prefix,
@@ -367,10 +368,17 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
   SVN_ERR_ASSERT(len < sizeof(buffer));
 
   /* Read the header prefix and compare it with the expected prefix */
-  SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
-                                   scratch_pool));
-  SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
-                                 scratch_pool));
+  if (mapped_data && end - start >= len)
+    {
+      memcpy(buffer, mapped_data + start, len);
+    }
+  else
+    {
+      SVN_ERR(svn_io_file_aligned_seek(file, block_size, NULL, start,
+                                       scratch_pool));
+      SVN_ERR(svn_io_file_read_full2(file, buffer, len, NULL, NULL,
+                                     scratch_pool));
+    }
 
   if (strncmp(buffer, stream_prefix, len))
     return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
@@ -383,6 +391,7 @@ packed_stream_open(svn_fs_fs__packed_number_stream_t **stream,
 
   result->pool = result_pool;
   result->file = file;
+  result->mapped_data = mapped_data;
   result->stream_start = start + len;
   result->stream_end = end;
 
@@ -947,6 +956,7 @@ auto_open_l2p_index(svn_fs_fs__revision_file_t *rev_file,
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->l2p_stream,
                                  rev_file->file,
+                                 rev_file->mapped_data,
                                  rev_file->l2p_offset,
                                  rev_file->p2l_offset,
                                  L2P_STREAM_PREFIX,
@@ -1632,6 +1642,160 @@ l2p_index_lookup(apr_off_t *offset,
   return SVN_NO_ERROR;
 }
 
+/* A single request within a batch of log-to-phys index lookups.
+ */
+typedef struct l2p_batch_entry_t
+{
+  /* index of the request within the caller's arrays */
+  int index;
+
+  /* location of the page containing the requested item */
+  l2p_page_info_baton_t info;
+
+  /* offset within the page and, after the lookup, the result */
+  l2p_entry_baton_t entry;
+} l2p_batch_entry_t;
+
+/* A range of requests within a batch, all for the same page.
+ */
+typedef struct l2p_batch_baton_t
+{
+  l2p_batch_entry_t *entries;
+  int count;
+} l2p_batch_baton_t;
+
+/* implements compare_fn_t.  Order by revision, page and offset within the
+ * page.
+ */
+static int
+compare_l2p_batch_entries(const void *lhs_p,
+                          const void *rhs_p)
+{
+  const l2p_batch_entry_t *lhs = lhs_p;
+  const l2p_batch_entry_t *rhs = rhs_p;
+
+  if (lhs->info.revision != rhs->info.revision)
+    return lhs->info.revision < rhs->info.revision ? -1 : 1;
+  if (lhs->info.page_no != rhs->info.page_no)
+    return lhs->info.page_no < rhs->info.page_no ? -1 : 1;
+  if (lhs->info.page_offset != rhs->info.page_offset)
+    return lhs->info.page_offset < rhs->info.page_offset ? -1 : 1;
+
+  return 0;
+}
+
+/* Implement svn_cache__partial_getter_func_t: look up all entries in the
+ * l2p_batch_baton_t *BATON in l2p_page_t *DATA.  *OUT remains unchanged.
+ */
+static svn_error_t *
+l2p_batch_access_func(void **out,
+                      const void *data,
+                      apr_size_t data_len,
+                      void *baton,
+                      apr_pool_t *result_pool)
+{
+  l2p_batch_baton_t *batch = baton;
+  const l2p_page_t *page = data;
+  const apr_uint64_t *offsets
+    = svn_temp_deserializer__ptr(page, (const void *const *)&page->offsets);
+  int i;
+
+  for (i = 0; i < batch->count; ++i)
+    SVN_ERR(l2p_page_get_entry(&batch->entries[i].entry, page, offsets,
+                               result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Using the log-to-phys indexes in FS, look up all COUNT items in ENTRIES.
+ * All of them must be stored in REV_FILE.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+l2p_index_lookup_batch(svn_fs_t *fs,
+                       svn_fs_fs__revision_file_t *rev_file,
+                       l2p_batch_entry_t *entries,
+                       int count,
+                       apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int first, last, i;
+
+  /* Locate the index pages.  The index header will usually be cached. */
+  for (i = 0; i < count; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(get_l2p_page_info(&entries[i].info, rev_file, fs, iterpool));
+
+      entries[i].entry.revision = entries[i].info.revision;
+      entries[i].entry.item_index = entries[i].info.item_index;
+      entries[i].entry.page_offset = entries[i].info.page_offset;
+    }
+
+  qsort(entries, count, sizeof(*entries), compare_l2p_batch_entries);
+
+  /* Access each page only once. */
+  for (first = 0; first < count; first = last)
+    {
+      svn_fs_fs__page_cache_key_t key = { 0 };
+      l2p_batch_baton_t batch;
+      svn_boolean_t is_cached = FALSE;
+      void *dummy = NULL;
+      apr_off_t offset;
+
+      for (last = first + 1; last < count; ++last)
+        if (   entries[last].info.revision != entries[first].info.revision
+            || entries[last].info.page_no != entries[first].info.page_no)
+          break;
+
+      svn_pool_clear(iterpool);
+
+      assert(entries[first].info.revision <= APR_UINT32_MAX);
+      key.revision = (apr_uint32_t)entries[first].info.revision;
+      key.is_packed = svn_fs_fs__is_packed_rev(fs,
+                                               entries[first].info.revision);
+      key.page = entries[first].info.page_no;
+
+      batch.entries = entries + first;
+      batch.count = last - first;
+
+      SVN_ERR(svn_cache__get_partial(&dummy, &is_cached,
+                                     ffd->l2p_page_cache, &key,
+                                     l2p_batch_access_func, &batch,
+                                     iterpool));
+      if (is_cached)
+        continue;
+
+      /* The regular lookup reads, caches and prefetches the page. */
+      SVN_ERR(l2p_index_lookup(&offset, fs, rev_file,
+                               entries[first].info.revision,
+                               entries[first].info.item_index, iterpool));
+      entries[first].entry.offset = offset;
+      if (batch.count == 1)
+        continue;
+
+      SVN_ERR(svn_cache__get_partial(&dummy, &is_cached,
+                                     ffd->l2p_page_cache, &key,
+                                     l2p_batch_access_func, &batch,
+                                     iterpool));
+
+      /* The page may not be cachable.  Look up the remainder one-by-one. */
+      if (!is_cached)
+        for (i = first + 1; i < last; ++i)
+          {
+            SVN_ERR(l2p_index_lookup(&offset, fs, rev_file,
+                                     entries[i].info.revision,
+                                     entries[i].info.item_index, iterpool));
+            entries[i].entry.offset = offset;
+          }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Using the log-to-phys proto index in transaction TXN_ID in FS, find the
  * absolute offset in the proto rev file for the given ITEM_INDEX and return
  * it in *OFFSET.  Use SCRATCH_POOL for temporary allocations.
@@ -1816,6 +1980,49 @@ svn_fs_fs__item_offset(apr_off_t *absolute_position,
   return svn_error_trace(err);
 }
 
+svn_error_t *
+svn_fs_fs__item_offsets(apr_off_t *offsets,
+                        svn_fs_t *fs,
+                        svn_fs_fs__revision_file_t *rev_file,
+                        const svn_revnum_t *revisions,
+                        const apr_uint64_t *item_indexes,
+                        int count,
+                        apr_pool_t *scratch_pool)
+{
+  l2p_batch_entry_t *entries;
+  int i;
+
+  /* Only the log-to-phys index lookups are worth batching. */
+  if (!svn_fs_fs__use_log_addressing(fs))
+    {
+      for (i = 0; i < count; ++i)
+        SVN_ERR(svn_fs_fs__item_offset(&offsets[i], fs, rev_file,
+                                       revisions[i], NULL, item_indexes[i],
+                                       scratch_pool));
+
+      return SVN_NO_ERROR;
+    }
+
+  if (count == 0)
+    return SVN_NO_ERROR;
+
+  entries = apr_pcalloc(scratch_pool, count * sizeof(*entries));
+  for (i = 0; i < count; ++i)
+    {
+      entries[i].index = i;
+      entries[i].info.revision = revisions[i];
+      entries[i].info.item_index = item_indexes[i];
+    }
+
+  SVN_ERR(l2p_index_lookup_batch(fs, rev_file, entries, count,
+                                 scratch_pool));
+
+  for (i = 0; i < count; ++i)
+    offsets[entries[i].index] = (apr_off_t)entries[i].entry.offset;
+
+  return SVN_NO_ERROR;
+}
+
 /*
  * phys-to-log index
  */
@@ -2139,6 +2346,7 @@ auto_open_p2l_index(svn_fs_fs__revision_file_t *rev_file,
       SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
       SVN_ERR(packed_stream_open(&rev_file->p2l_stream,
                                  rev_file->file,
+                                 rev_file->mapped_data,
                                  rev_file->p2l_offset,
                                  rev_file->footer_offset,
                                  P2L_STREAM_PREFIX,
@@ -200,6 +200,22 @@ svn_fs_fs__item_offset(apr_off_t *absolute_position,
                        apr_uint64_t item_index,
                        apr_pool_t *scratch_pool);
 
+/* Batched version of svn_fs_fs__item_offset for committed items.  For
+ * each of the COUNT items (REVISIONS[i], ITEM_INDEXES[i]), set OFFSETS[i]
+ * to its absolute position within REV_FILE.  All items must be stored in
+ * REV_FILE.  Lookups in the same log-to-phys index page get combined, i.e.
+ * each page will be accessed only once.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__item_offsets(apr_off_t *offsets,
+                        svn_fs_t *fs,
+                        svn_fs_fs__revision_file_t *rev_file,
+                        const svn_revnum_t *revisions,
+                        const apr_uint64_t *item_indexes,
+                        int count,
+                        apr_pool_t *scratch_pool);
+
 /* Use the log-to-phys indexes in FS to determine the maximum item indexes
  * assigned to revision START_REV to START_REV + COUNT - 1.  That is a
  * close upper limit to the actual number of items in the respective revs.
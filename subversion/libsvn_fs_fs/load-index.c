@@ -21,14 +21,22 @@
  */
 
 #include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "private/svn_fs_fs_private.h"
 #include "private/svn_sorts_private.h"
 
+#include "fs_fs.h"
 #include "index.h"
 #include "util.h"
 #include "transaction.h"
 
+#include "svn_private_config.h"
+
+/* Upper limit to the number of rev / pack files being rebuilt
+ * concurrently. */
+#define MAX_REBUILD_JOBS 256
+
 /* From the ENTRIES array of svn_fs_fs__p2l_entry_t*, sorted by offset,
  * return the first offset behind the last item. */
 static apr_off_t
@@ -172,3 +180,170 @@ svn_fs_fs__load_index(svn_fs_t *fs,
 
   return SVN_NO_ERROR;
 }
+
+/* Implements svn_fs_fs__dump_index_func_t, appending a copy of ENTRY to
+ * the apr_array_header_t * of svn_fs_fs__p2l_entry_t * given as BATON.
+ * The copies are allocated in the array's pool. */
+static svn_error_t *
+collect_p2l_entry(const svn_fs_fs__p2l_entry_t *entry,
+                  void *baton,
+                  apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *entries = baton;
+  svn_fs_fs__p2l_entry_t *copy = apr_pmemdup(entries->pool, entry,
+                                             sizeof(*entry));
+
+  APR_ARRAY_PUSH(entries, svn_fs_fs__p2l_entry_t *) = copy;
+
+  return SVN_NO_ERROR;
+}
+
+/* Rewrite both indexes of the rev / pack file in FS that starts at BASE
+ * from the entries of its P2L index.  If not NULL, call CANCEL_FUNC with
+ * CANCEL_BATON from time to time.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+rebuild_file_indexes(svn_fs_t *fs,
+                     svn_revnum_t base,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *entries = apr_array_make(scratch_pool, 16,
+                                               sizeof(void *));
+
+  SVN_ERR(svn_fs_fs__dump_index(fs, base, collect_p2l_entry, entries,
+                                cancel_func, cancel_baton, scratch_pool));
+  SVN_ERR(svn_fs_fs__load_index(fs, base, entries, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the first revision of the rev / pack file in FS that follows the
+ * one starting at BASE. */
+static svn_revnum_t
+next_file_base(svn_fs_t *fs,
+               svn_revnum_t base)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  return svn_fs_fs__is_packed_rev(fs, base)
+       ? base + ffd->max_files_per_dir
+       : base + 1;
+}
+
+/* A rev / pack file whose indexes are being rebuilt by a job in
+ * rebuild_indexes_body(). */
+typedef struct rebuild_job_t
+{
+  /* First revision of the rev / pack file to process. */
+  svn_revnum_t base;
+
+  /* Cancellation support. */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} rebuild_job_t;
+
+/* Implements svn_fs_fs__job_func_t, rebuilding the indexes of the
+ * rev / pack file in FS given by the rebuild_job_t in BATON. */
+static svn_error_t *
+rebuild_job_func(void *baton,
+                 svn_fs_t *fs,
+                 apr_pool_t *pool)
+{
+  rebuild_job_t *job = baton;
+
+  return svn_error_trace(rebuild_file_indexes(fs, job->base,
+                                              job->cancel_func,
+                                              job->cancel_baton, pool));
+}
+
+/* Baton type for rebuild_indexes_body().  The fields correspond to the
+ * parameters of svn_fs_fs__rebuild_indexes. */
+typedef struct rebuild_indexes_baton_t
+{
+  svn_fs_t *fs;
+  int jobs;
+  svn_fs_progress_notify_func_t notify_func;
+  void *notify_baton;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} rebuild_indexes_baton_t;
+
+/* Implements the body of svn_fs_fs__rebuild_indexes, to be run while
+ * holding the pack lock.  BATON is a rebuild_indexes_baton_t. */
+static svn_error_t *
+rebuild_indexes_body(void *baton,
+                     apr_pool_t *pool)
+{
+  rebuild_indexes_baton_t *b = baton;
+  svn_fs_t *fs = b->fs;
+  svn_revnum_t youngest, base;
+  svn_revnum_t next_base = 0;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* The rev / pack files currently being processed.  The first one always
+   * starts at the current BASE. */
+  svn_fs_fs__job_ring_t *ring
+    = svn_fs_fs__job_ring_create(fs, b->jobs, sizeof(rebuild_job_t),
+                                 rebuild_job_func, pool);
+
+  /* We hold the pack lock, so this will remain valid. */
+  SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, pool));
+  SVN_ERR(svn_fs_fs__youngest_rev(&youngest, fs, pool));
+
+  for (base = 0; base <= youngest && !err; base = next_file_base(fs, base))
+    {
+      svn_pool_clear(iterpool);
+
+      /* Keep up to JOBS rev / pack files in flight. */
+      for (; !svn_fs_fs__job_ring_is_full(ring) && next_base <= youngest;
+           next_base = next_file_base(fs, next_base))
+        {
+          rebuild_job_t new_job;
+          new_job.base = next_base;
+          new_job.cancel_func = b->cancel_func;
+          new_job.cancel_baton = b->cancel_baton;
+          svn_fs_fs__job_ring_push(ring, &new_job);
+        }
+
+      err = svn_fs_fs__job_ring_wait(NULL, ring);
+      svn_fs_fs__job_ring_pop(ring);
+
+      if (!err && b->notify_func)
+        b->notify_func(base, b->notify_baton, iterpool);
+    }
+
+  /* Don't leave any workers behind. */
+  svn_fs_fs__job_ring_clear(ring);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+svn_error_t *
+svn_fs_fs__rebuild_indexes(svn_fs_t *fs,
+                           int jobs,
+                           svn_fs_progress_notify_func_t notify_func,
+                           void *notify_baton,
+                           svn_cancel_func_t cancel_func,
+                           void *cancel_baton,
+                           apr_pool_t *scratch_pool)
+{
+  rebuild_indexes_baton_t baton;
+
+  /* Check the FS format number. */
+  if (! svn_fs_fs__use_log_addressing(fs))
+    return svn_error_create(SVN_ERR_FS_UNSUPPORTED_FORMAT, NULL, NULL);
+
+  baton.fs = fs;
+  baton.jobs = MAX(1, MIN(jobs, MAX_REBUILD_JOBS));
+  baton.notify_func = notify_func;
+  baton.notify_baton = notify_baton;
+  baton.cancel_func = cancel_func;
+  baton.cancel_baton = cancel_baton;
+
+  /* Packing would move the files underneath us. */
+  return svn_error_trace(svn_fs_fs__with_pack_lock(fs, rebuild_indexes_body,
+                                                   &baton, scratch_pool));
+}
@@ -156,11 +156,94 @@ digest_path_from_path(const char **digest_path,
 }
 
 
+/* State shared by all digest file accesses within one lock_body() or
+   unlock_body() call, i.e. while we hold the write lock.  Locking many
+   paths touches the same digest directories and parent paths over and
+   over, so we remember what we already know. */
+typedef struct digest_batch_t
+{
+  /* Maps 'const char *' FS paths to their digests. */
+  apr_hash_t *digests;
+
+  /* Set of the 'const char *' digest sub-directory names that exist. */
+  apr_hash_t *existing_dirs;
+
+  /* Whether the locks directory itself exists. */
+  svn_boolean_t locks_dir_exists;
+
+  /* All of the above is allocated in this pool. */
+  apr_pool_t *pool;
+} digest_batch_t;
+
+/* Return a new, empty digest_batch_t allocated in RESULT_POOL. */
+static digest_batch_t *
+create_digest_batch(apr_pool_t *result_pool)
+{
+  digest_batch_t *batch = apr_pcalloc(result_pool, sizeof(*batch));
+  batch->digests = apr_hash_make(result_pool);
+  batch->existing_dirs = apr_hash_make(result_pool);
+  batch->pool = result_pool;
+
+  return batch;
+}
+
+/* Like digest_path_from_path but compute the digest of PATH only once
+   per BATCH. */
+static svn_error_t *
+batch_digest_path(const char **digest_path,
+                  digest_batch_t *batch,
+                  const char *fs_path,
+                  const char *path,
+                  apr_pool_t *pool)
+{
+  const char *digest = svn_hash_gets(batch->digests, path);
+  if (!digest)
+    {
+      SVN_ERR(make_digest(&digest, path, batch->pool));
+      svn_hash_sets(batch->digests, apr_pstrdup(batch->pool, path), digest);
+    }
+
+  *digest_path = digest_path_from_digest(fs_path, digest, pool);
+  return SVN_NO_ERROR;
+}
+
+/* Make sure that the directories containing DIGEST_PATH in FS_PATH exist.
+   Check every directory only once per BATCH.  Use POOL for temporary
+   allocations. */
+static svn_error_t *
+ensure_digest_dir(digest_batch_t *batch,
+                  const char *fs_path,
+                  const char *digest_path,
+                  apr_pool_t *pool)
+{
+  const char *dir = svn_dirent_dirname(digest_path, pool);
+  const char *subdir = svn_dirent_basename(dir, NULL);
+
+  if (!batch->locks_dir_exists)
+    {
+      SVN_ERR(svn_fs_fs__ensure_dir_exists(svn_dirent_join(fs_path,
+                                                           PATH_LOCKS_DIR,
+                                                           pool),
+                                           fs_path, pool));
+      batch->locks_dir_exists = TRUE;
+    }
+
+  if (!svn_hash_gets(batch->existing_dirs, subdir))
+    {
+      SVN_ERR(svn_fs_fs__ensure_dir_exists(dir, fs_path, pool));
+      svn_hash_sets(batch->existing_dirs, apr_pstrdup(batch->pool, subdir),
+                    (void *)1);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Write to DIGEST_PATH a representation of CHILDREN (which may be
    empty, if the versioned path in FS represented by DIGEST_PATH has
    no children) and LOCK (which may be NULL if that versioned path is
    lock itself locked).  Set the permissions of DIGEST_PATH to those of
-   PERMS_REFERENCE.  Use POOL for all allocations.
+   PERMS_REFERENCE.  BATCH is the digest_batch_t of the current operation.
+   Use POOL for all allocations.
  */
 static svn_error_t *
 write_digest_file(apr_hash_t *children,
@@ -168,6 +251,7 @@ write_digest_file(apr_hash_t *children,
                   const char *fs_path,
                   const char *digest_path,
                   const char *perms_reference,
+                  digest_batch_t *batch,
                   apr_pool_t *pool)
 {
   svn_error_t *err = SVN_NO_ERROR;
@@ -176,10 +260,7 @@ write_digest_file(apr_hash_t *children,
   apr_hash_t *hash = apr_hash_make(pool);
   const char *tmp_path;
 
-  SVN_ERR(svn_fs_fs__ensure_dir_exists(svn_dirent_join(fs_path, PATH_LOCKS_DIR,
-                                                       pool), fs_path, pool));
-  SVN_ERR(svn_fs_fs__ensure_dir_exists(svn_dirent_dirname(digest_path, pool),
-                                       fs_path, pool));
+  SVN_ERR(ensure_digest_dir(batch, fs_path, digest_path, pool));
 
   if (lock)
     {
@@ -252,23 +333,28 @@ read_digest_file(apr_hash_t **children_p,
   apr_hash_t *hash;
   svn_stream_t *stream;
   const char *val;
-  svn_node_kind_t kind;
 
   if (lock_p)
     *lock_p = NULL;
   if (children_p)
     *children_p = apr_hash_make(pool);
 
-  SVN_ERR(svn_io_check_path(digest_path, &kind, pool));
-  if (kind == svn_node_none)
-    return SVN_NO_ERROR;
-
   /* If our caller doesn't care about anything but the presence of the
      file... whatever. */
-  if (kind == svn_node_file && !lock_p && !children_p)
+  if (!lock_p && !children_p)
     return SVN_NO_ERROR;
 
-  SVN_ERR(svn_stream_open_readonly(&stream, digest_path, pool, pool));
+  /* Most digest files that we get asked for don't exist.  Simply try to
+     open them instead of checking for their existence first.  This saves
+     a stat() for every lock that we read while walking large sub-trees. */
+  err = svn_stream_open_readonly(&stream, digest_path, pool, pool);
+  if (err && (   APR_STATUS_IS_ENOENT(err->apr_err)
+              || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
 
   hash = apr_hash_make(pool);
   if ((err = svn_hash_read2(hash, stream, SVN_HASH_TERMINATOR, pool)))
@@ -338,25 +424,27 @@ read_digest_file(apr_hash_t **children_p,
 
 /* Write LOCK in FS to the actual OS filesystem.
 
-   Use PERMS_REFERENCE for the permissions of any digest files.
+   Use PERMS_REFERENCE for the permissions of any digest files.  BATCH is
+   the digest_batch_t of the current operation.
  */
 static svn_error_t *
 set_lock(const char *fs_path,
          svn_lock_t *lock,
          const char *perms_reference,
+         digest_batch_t *batch,
          apr_pool_t *pool)
 {
   const char *digest_path;
   apr_hash_t *children;
 
-  SVN_ERR(digest_path_from_path(&digest_path, fs_path, lock->path, pool));
+  SVN_ERR(batch_digest_path(&digest_path, batch, fs_path, lock->path, pool));
 
   /* We could get away without reading the file as children should
      always come back empty. */
   SVN_ERR(read_digest_file(&children, NULL, fs_path, digest_path, pool));
 
   SVN_ERR(write_digest_file(children, lock, fs_path, digest_path,
-                            perms_reference, pool));
+                            perms_reference, batch, pool));
 
   return SVN_NO_ERROR;
 }
@@ -364,11 +452,12 @@ set_lock(const char *fs_path,
 static svn_error_t *
 delete_lock(const char *fs_path,
             const char *path,
+            digest_batch_t *batch,
             apr_pool_t *pool)
 {
   const char *digest_path;
 
-  SVN_ERR(digest_path_from_path(&digest_path, fs_path, path, pool));
+  SVN_ERR(batch_digest_path(&digest_path, batch, fs_path, path, pool));
 
   SVN_ERR(svn_io_remove_file2(digest_path, TRUE, pool));
 
@@ -380,6 +469,7 @@ add_to_digest(const char *fs_path,
               apr_array_header_t *paths,
               const char *index_path,
               const char *perms_reference,
+              digest_batch_t *batch,
               apr_pool_t *pool)
 {
   const char *index_digest_path;
@@ -388,7 +478,8 @@ add_to_digest(const char *fs_path,
   int i;
   unsigned int original_count;
 
-  SVN_ERR(digest_path_from_path(&index_digest_path, fs_path, index_path, pool));
+  SVN_ERR(batch_digest_path(&index_digest_path, batch, fs_path, index_path,
+                            pool));
 
   SVN_ERR(read_digest_file(&children, &lock, fs_path, index_digest_path, pool));
 
@@ -399,14 +490,14 @@ add_to_digest(const char *fs_path,
       const char *path = APR_ARRAY_IDX(paths, i, const char *);
       const char *digest_path, *digest_file;
 
-      SVN_ERR(digest_path_from_path(&digest_path, fs_path, path, pool));
+      SVN_ERR(batch_digest_path(&digest_path, batch, fs_path, path, pool));
       digest_file = svn_dirent_basename(digest_path, NULL);
       svn_hash_sets(children, digest_file, (void *)1);
     }
 
   if (apr_hash_count(children) != original_count)
     SVN_ERR(write_digest_file(children, lock, fs_path, index_digest_path,
-                              perms_reference, pool));
+                              perms_reference, batch, pool));
 
   return SVN_NO_ERROR;
 }
@@ -416,6 +507,7 @@ delete_from_digest(const char *fs_path,
                    apr_array_header_t *paths,
                    const char *index_path,
                    const char *perms_reference,
+                   digest_batch_t *batch,
                    apr_pool_t *pool)
 {
   const char *index_digest_path;
@@ -423,7 +515,8 @@ delete_from_digest(const char *fs_path,
   svn_lock_t *lock;
   int i;
 
-  SVN_ERR(digest_path_from_path(&index_digest_path, fs_path, index_path, pool));
+  SVN_ERR(batch_digest_path(&index_digest_path, batch, fs_path, index_path,
+                            pool));
 
   SVN_ERR(read_digest_file(&children, &lock, fs_path, index_digest_path, pool));
 
@@ -432,14 +525,14 @@ delete_from_digest(const char *fs_path,
       const char *path = APR_ARRAY_IDX(paths, i, const char *);
       const char *digest_path, *digest_file;
 
-      SVN_ERR(digest_path_from_path(&digest_path, fs_path, path, pool));
+      SVN_ERR(batch_digest_path(&digest_path, batch, fs_path, path, pool));
       digest_file = svn_dirent_basename(digest_path, NULL);
       svn_hash_sets(children, digest_file, NULL);
     }
 
   if (apr_hash_count(children) || lock)
     SVN_ERR(write_digest_file(children, lock, fs_path, index_digest_path,
-                              perms_reference, pool));
+                              perms_reference, batch, pool));
   else
     SVN_ERR(svn_io_remove_file2(index_digest_path, TRUE, pool));
 
@@ -845,6 +938,7 @@ lock_body(void *baton, apr_pool_t *pool)
   apr_hash_t *index_updates = apr_hash_make(pool);
   apr_hash_index_t *hi;
   apr_pool_t *iterpool = svn_pool_create(pool);
+  digest_batch_t *batch = create_digest_batch(pool);
 
   /* Until we implement directory locks someday, we only allow locks
      on files. */
@@ -894,7 +988,7 @@ lock_body(void *baton, apr_pool_t *pool)
 
       svn_pool_clear(iterpool);
       SVN_ERR(add_to_digest(lb->fs->path, children, path, rev_0_path,
-                            iterpool));
+                            batch, iterpool));
     }
 
   for (i = 0; i < lb->infos->nelts; ++i)
@@ -926,7 +1020,7 @@ lock_body(void *baton, apr_pool_t *pool)
           info->lock->expiration_date = lb->expiration_date;
 
           info->fs_err = set_lock(lb->fs->path, info->lock, rev_0_path,
-                                  iterpool);
+                                  batch, iterpool);
         }
     }
 
@@ -997,6 +1091,7 @@ unlock_body(void *baton, apr_pool_t *pool)
   apr_hash_t *indices_updates = apr_hash_make(pool);
   apr_hash_index_t *hi;
   apr_pool_t *iterpool = svn_pool_create(pool);
+  digest_batch_t *batch = create_digest_batch(pool);
 
   SVN_ERR(ub->fs->vtable->youngest_rev(&youngest, ub->fs, pool));
   SVN_ERR(ub->fs->vtable->revision_root(&root, ub->fs, youngest, pool));
@@ -1040,7 +1135,7 @@ unlock_body(void *baton, apr_pool_t *pool)
 
       if (! info->fs_err)
         {
-          SVN_ERR(delete_lock(ub->fs->path, info->path, iterpool));
+          SVN_ERR(delete_lock(ub->fs->path, info->path, batch, iterpool));
           info->done = TRUE;
         }
     }
@@ -1052,7 +1147,7 @@ unlock_body(void *baton, apr_pool_t *pool)
 
       svn_pool_clear(iterpool);
       SVN_ERR(delete_from_digest(ub->fs->path, children, path, rev_0_path,
-                                 iterpool));
+                                 batch, iterpool));
     }
 
   svn_pool_destroy(iterpool);
@@ -1361,6 +1456,20 @@ svn_fs_fs__get_locks(svn_fs_t *fs,
 
   /* Get the top digest path in our tree of interest, and then walk it. */
   SVN_ERR(digest_path_from_path(&digest_path, fs->path, path, pool));
+
+  /* With depth empty, only PATH itself is of interest.  Its digest file
+     lists all locks in the sub-tree, so don't read those. */
+  if (depth == svn_depth_empty)
+    {
+      svn_lock_t *lock;
+
+      SVN_ERR(read_digest_file(NULL, &lock, fs->path, digest_path, pool));
+      if (lock && !lock_expired(lock))
+        SVN_ERR(get_locks_func(get_locks_baton, lock, pool));
+
+      return SVN_NO_ERROR;
+    }
+
   SVN_ERR(walk_locks(fs, digest_path, get_locks_filter_func, &glfb,
                      FALSE, pool));
   return SVN_NO_ERROR;
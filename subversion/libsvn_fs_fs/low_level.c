@@ -61,6 +61,7 @@
 /* Kinds of representation. */
 #define REP_PLAIN          "PLAIN"
 #define REP_DELTA          "DELTA"
+#define REP_CHUNKED        "CHUNKED"
 
 /* An arbitrary maximum path length, so clients can't run us out of memory
  * by giving us arbitrarily large paths. */
@@ -1089,6 +1090,91 @@ svn_fs_fs__unparse_representation(representation_t *rep,
 }
 
 
+svn_error_t *
+svn_fs_fs__parse_chunk_list(apr_array_header_t **chunks_p,
+                            svn_stringbuf_t *text,
+                            const representation_t *container,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *chunks = apr_array_make(result_pool, 16,
+                                              sizeof(representation_t *));
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_filesize_t total = 0;
+  char *line = text->data;
+  char *eol;
+
+  for (; *line; line = eol + 1)
+    {
+      representation_t *chunk;
+
+      svn_pool_clear(iterpool);
+
+      eol = strchr(line, '\n');
+      if (eol == NULL)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Unterminated line in chunk list"));
+
+      SVN_ERR(svn_fs_fs__parse_representation(&chunk,
+                                 svn_stringbuf_ncreate(line, eol - line,
+                                                       iterpool),
+                                 result_pool, iterpool));
+
+      /* Chunks written together with CONTAINER don't know their final
+       * revision number, yet. */
+      if (!SVN_IS_VALID_REVNUM(chunk->revision))
+        {
+          chunk->revision = container->revision;
+          chunk->txn_id = container->txn_id;
+        }
+
+      total += chunk->expanded_size;
+      APR_ARRAY_PUSH(chunks, representation_t *) = chunk;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  if (total != container->expanded_size)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Chunks add up to %s bytes instead of %s"),
+                             apr_psprintf(scratch_pool,
+                                          "%" SVN_FILESIZE_T_FMT, total),
+                             apr_psprintf(scratch_pool,
+                                          "%" SVN_FILESIZE_T_FMT,
+                                          container->expanded_size));
+
+  *chunks_p = chunks;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__write_chunk_list(svn_stream_t *stream,
+                            const apr_array_header_t *chunks,
+                            int format,
+                            apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < chunks->nelts; ++i)
+    {
+      representation_t *chunk = APR_ARRAY_IDX(chunks, i, representation_t *);
+      svn_stringbuf_t *str;
+
+      svn_pool_clear(iterpool);
+
+      /* Chunks within the same txn will be written as revision -1. */
+      str = svn_fs_fs__unparse_representation(chunk, format, FALSE,
+                                              iterpool, iterpool);
+      svn_stringbuf_appendbyte(str, '\n');
+      SVN_ERR(svn_stream_write(stream, str->data, &str->len));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__write_noderev(svn_stream_t *outfile,
                          node_revision_t *noderev,
@@ -1187,6 +1273,13 @@ svn_fs_fs__read_rep_header(svn_fs_fs__rep_header_t **header,
       return SVN_NO_ERROR;
     }
 
+  if (strcmp(buffer->data, REP_CHUNKED) == 0)
+    {
+      /* The contents are the concatenation of other representations. */
+      (*header)->type = svn_fs_fs__rep_chunked;
+      return SVN_NO_ERROR;
+    }
+
   (*header)->type = svn_fs_fs__rep_delta;
 
   /* We have hopefully a DELTA vs. a non-empty base revision. */
@@ -1233,6 +1326,10 @@ svn_fs_fs__write_rep_header(svn_fs_fs__rep_header_t *header,
         text = REP_DELTA "\n";
         break;
 
+      case svn_fs_fs__rep_chunked:
+        text = REP_CHUNKED "\n";
+        break;
+
       default:
         text = apr_psprintf(scratch_pool, REP_DELTA " %ld %" APR_OFF_T_FMT
                                           " %" SVN_FILESIZE_T_FMT "\n",
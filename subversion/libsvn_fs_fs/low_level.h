@@ -29,6 +29,21 @@
 #define SVN_FS_FS__KIND_FILE          "file"
 #define SVN_FS_FS__KIND_DIR           "dir"
 
+/* Directories with at least this many entries will be stored as PLAIN
+ * representations with an entry index appended (format 8+), unless
+ * directory deltification has been enabled. */
+#define SVN_FS_FS__DIR_INDEX_MIN_ENTRIES 1024
+
+/* The directory index footer starts with this prefix.  It has a fixed
+ * length and so have the index records, i.e. the entry offsets. */
+#define SVN_FS_FS__DIR_INDEX_PREFIX     "DIRIDX "
+#define SVN_FS_FS__DIR_INDEX_FOOTER_LEN 25
+#define SVN_FS_FS__DIR_INDEX_RECORD_LEN 9
+
+/* In-txn directory change logs start with this prefix, followed by the
+ * base representation and a newline (format 8+). */
+#define SVN_FS_FS__DIR_BASE_PREFIX      "BASE "
+
 /* The functions are grouped as follows:
  *
  * - revision trailer (up to format 6)
@@ -179,6 +194,29 @@ svn_fs_fs__unparse_representation(representation_t *rep,
                                   apr_pool_t *result_pool,
                                   apr_pool_t *scratch_pool);
 
+/* Parse the contents TEXT of the CHUNKED representation CONTAINER and
+   return the list of chunk representations (representation_t *) in
+   *CHUNKS_P.  Chunks that are stored in the same revision or transaction
+   as CONTAINER will be marked accordingly.  TEXT will be invalidated by
+   this call.  Allocate *CHUNKS_P in RESULT_POOL and use SCRATCH_POOL for
+   temporaries. */
+svn_error_t *
+svn_fs_fs__parse_chunk_list(apr_array_header_t **chunks_p,
+                            svn_stringbuf_t *text,
+                            const representation_t *container,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool);
+
+/* Write the list of chunk representations (representation_t *) CHUNKS
+   as contents of a CHUNKED representation to STREAM, compatible with
+   filesystem format FORMAT.  Temporary allocations are from
+   SCRATCH_POOL. */
+svn_error_t *
+svn_fs_fs__write_chunk_list(svn_stream_t *stream,
+                            const apr_array_header_t *chunks,
+                            int format,
+                            apr_pool_t *scratch_pool);
+
 /* This type enumerates all forms of representations that we support. */
 typedef enum svn_fs_fs__rep_type_t
 {
@@ -189,7 +227,10 @@ typedef enum svn_fs_fs__rep_type_t
   svn_fs_fs__rep_self_delta,
 
   /* this is a DELTA representation against some base representation */
-  svn_fs_fs__rep_delta
+  svn_fs_fs__rep_delta,
+
+  /* this is a list of representations to be concatenated, one per line */
+  svn_fs_fs__rep_chunked
 } svn_fs_fs__rep_type_t;
 
 /* This structure is used to hold the information stored in a representation
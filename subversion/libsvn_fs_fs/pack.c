@@ -22,8 +22,16 @@
 #include <assert.h>
 #include <string.h>
 
+#include <apr_general.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_pool.h>
+#endif
+
+#include "svn_cache_config.h"
 #include "svn_pools.h"
 #include "svn_dirent_uri.h"
+#include "svn_hash.h"
 #include "svn_sorts.h"
 #include "private/svn_temp_serializer.h"
 #include "private/svn_sorts_private.h"
@@ -33,6 +41,7 @@
 
 #include "fs_fs.h"
 #include "pack.h"
+#include "changed_paths.h"
 #include "util.h"
 #include "id.h"
 #include "index.h"
@@ -54,12 +63,12 @@
  * of items to "place" (i.e. determine their optimal position within the
  * future pack file).  For each item, we will need a constant amount of
  * memory to track it.  A MAX_MEM parameter sets a limit to the number of
- * items we may place in one go.  That means, we may not be able to add
- * all revisions at once.  Instead, we will run the placement for a subset
- * of revisions at a time.  The very unlikely worst case will simply append
- * all revision data with just a little reshuffling inside each revision.
+ * items we may place in memory.  If the shard contains more items than
+ * that, we use external sorting instead (see pack_shard_streamed()), which
+ * handles any shard in a single pass with memory usage bound by MAX_MEM.
+ * The remainder of this description covers the in-memory case.
  *
- * In a second step, we read all revisions in the selected range, build
+ * In a second step, we read all revisions in the shard, build
  * the item tracking information and copy the items themselves from the
  * revision files to temporary files.  The latter serve as buckets for a
  * very coarse bucket presort:  Separate change lists, file properties,
@@ -81,7 +90,7 @@
  * Step 4 copies the items from the temporary buckets into the final
  * pack file and writes the temporary index files.
  *
- * Finally, after the last range of revisions, create the final indexes.
+ * Finally, create the final indexes.
  */
 
 /* Maximum amount of memory we allocate for placement information during
@@ -89,6 +98,10 @@
  */
 #define DEFAULT_MAX_MEM (64 * 1024 * 1024)
 
+/* Upper limit to the number of shards being packed concurrently.
+ */
+#define MAX_PACK_JOBS 256
+
 /* Data structure describing a node change at PATH, REVISION.
  * We will sort these instances by PATH and NODE_ID such that we can combine
  * similar nodes in the same reps container and store containers in path
@@ -233,9 +246,6 @@ typedef struct pack_context_t
   /* pool used for temporary data structures that will be cleaned up when
    * the next range of revisions is being processed */
   apr_pool_t *info_pool;
-
-  /* ensure that all filesystem changes are written to disk. */
-  svn_boolean_t flush_to_disk;
 } pack_context_t;
 
 /* Create and initialize a new pack context for packing shard SHARD_REV in
@@ -243,7 +253,7 @@ typedef struct pack_context_t
  * and return the structure in *CONTEXT.
  *
  * Limit the number of items being copied per iteration to MAX_ITEMS.
- * Set FLUSH_TO_DISK, CANCEL_FUNC and CANCEL_BATON as well.
+ * Set CANCEL_FUNC and CANCEL_BATON as well.
  */
 static svn_error_t *
 initialize_pack_context(pack_context_t *context,
@@ -252,7 +262,6 @@ initialize_pack_context(pack_context_t *context,
                         const char *shard_dir,
                         svn_revnum_t shard_rev,
                         int max_items,
-                        svn_boolean_t flush_to_disk,
                         svn_cancel_func_t cancel_func,
                         void *cancel_baton,
                         apr_pool_t *pool)
@@ -329,8 +338,6 @@ initialize_pack_context(pack_context_t *context,
   context->info_pool = svn_pool_create(pool);
   context->paths = svn_prefix_tree__create(context->info_pool);
 
-  context->flush_to_disk = flush_to_disk;
-
   return SVN_NO_ERROR;
 }
 
@@ -409,9 +416,6 @@ close_pack_context(pack_context_t *context,
   SVN_ERR(svn_io_remove_file2(proto_l2p_index_path, FALSE, pool));
   SVN_ERR(svn_io_remove_file2(proto_p2l_index_path, FALSE, pool));
 
-  /* Ensure that packed file is written to disk.*/
-  if (context->flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(context->pack_file, pool));
   SVN_ERR(svn_io_file_close(context->pack_file, pool));
 
   return SVN_NO_ERROR;
@@ -868,6 +872,40 @@ classify_nodes(path_order_t **path_order,
     }
 }
 
+/* Return TRUE, if a node with PREDECESSOR_COUNT in the filesystem with
+ * FSFS-specific data FFD belongs to the "hot zone", i.e. its representation
+ * is likely to be referenced by future pack files.
+ */
+static svn_boolean_t
+is_hot_node(fs_fs_data_t *ffd,
+            int predecessor_count)
+{
+  int round = roundness(predecessor_count);
+
+  /* Class 1:
+   * Pretty round _and_ a significant stop in the node's delta chain.
+   * This may pick up more than one representation from the same chain
+   * but that's rare and not a problem.  Prefer simple checks here.
+   *
+   * The divider of 4 is arbitrary but seems to work well in practice.
+   * Larger values increase the number of items in the "hot zone".
+   * Smaller values make delta chains at HEAD more likely to contain
+   * "cold zone" representations. */
+  svn_boolean_t likely_target
+    =    (round >= ffd->max_linear_deltification)
+      && (round >= predecessor_count / 4);
+
+  /* Class 2:
+   * Anything from short node chains.  The default of 16 is generous
+   * but we'd rather include too many than too few nodes here to keep
+   * seeks between different regions of this pack file at a minimum. */
+  svn_boolean_t likely_head
+    = predecessor_count < ffd->max_linear_deltification;
+
+  /* Pick any node that from either class. */
+  return likely_target || likely_head;
+}
+
 /* Order a range of data collected in CONTEXT such that we can place them
  * in the desired order.  The input is taken from *PATH_ORDER, offsets FIRST
  * to LAST and then written in the final order to the same range in *TEMP.
@@ -913,37 +951,11 @@ sort_reps_range(pack_context_t *context,
    * thing we need from very old pack files.
    */
   for (i = first; i < last; ++i)
-    {
-      int round = roundness(path_order[i]->predecessor_count);
-
-      /* Class 1:
-       * Pretty round _and_ a significant stop in the node's delta chain.
-       * This may pick up more than one representation from the same chain
-       * but that's rare and not a problem.  Prefer simple checks here.
-       *
-       * The divider of 4 is arbitrary but seems to work well in practice.
-       * Larger values increase the number of items in the "hot zone".
-       * Smaller values make delta chains at HEAD more likely to contain
-       * "cold zone" representations. */
-      svn_boolean_t likely_target
-        =    (round >= ffd->max_linear_deltification)
-          && (round >= path_order[i]->predecessor_count / 4);
-
-      /* Class 2:
-       * Anything from short node chains.  The default of 16 is generous
-       * but we'd rather include too many than too few nodes here to keep
-       * seeks between different regions of this pack file at a minimum. */
-      svn_boolean_t likely_head
-        =   path_order[i]->predecessor_count
-          < ffd->max_linear_deltification;
-
-      /* Pick any node that from either class. */
-      if (likely_target || likely_head)
-        {
-          temp[dest++] = path_order[i];
-          path_order[i] = NULL;
-        }
-    }
+    if (is_hot_node(ffd, path_order[i]->predecessor_count))
+      {
+        temp[dest++] = path_order[i];
+        path_order[i] = NULL;
+      }
 
   /* (2) For each (remaining) path, pick the nodes along the delta chain
    * for the highest revision.  Due to our ordering, this is the first
@@ -1124,21 +1136,18 @@ auto_pad_block(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
-/* Read the contents of ITEM, if not empty, from TEMP_FILE and write it
- * to CONTEXT->PACK_FILE.  Use POOL for allocations.
+/* Read the contents of ITEM from TEMP_FILE and write it to CONTEXT->
+ * PACK_FILE.  Update ITEM's offset accordingly and add it to the P2L
+ * proto index.  Use POOL for allocations.
  */
 static svn_error_t *
-store_item(pack_context_t *context,
+write_item(pack_context_t *context,
            apr_file_t *temp_file,
            svn_fs_fs__p2l_entry_t *item,
            apr_pool_t *pool)
 {
   apr_off_t safety_margin;
 
-  /* skip empty entries */
-  if (item->type == SVN_FS_FS__ITEM_TYPE_UNUSED)
-    return SVN_NO_ERROR;
-
   /* If the next item does not fit into the current block, auto-pad it.
       Take special care of textual noderevs since their parsers may
       prefetch up to 80 bytes and we don't want them to cross block
@@ -1161,6 +1170,23 @@ store_item(pack_context_t *context,
   SVN_ERR(svn_fs_fs__p2l_proto_index_add_entry(context->proto_p2l_index,
                                                item, pool));
 
+  return SVN_NO_ERROR;
+}
+
+/* Read the contents of ITEM, if not empty, from TEMP_FILE and write it
+ * to CONTEXT->PACK_FILE.  Use POOL for allocations.
+ */
+static svn_error_t *
+store_item(pack_context_t *context,
+           apr_file_t *temp_file,
+           svn_fs_fs__p2l_entry_t *item,
+           apr_pool_t *pool)
+{
+  /* skip empty entries */
+  if (item->type == SVN_FS_FS__ITEM_TYPE_UNUSED)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(write_item(context, temp_file, item, pool));
   APR_ARRAY_PUSH(context->reps, svn_fs_fs__p2l_entry_t *) = item;
 
   return SVN_NO_ERROR;
@@ -1201,8 +1227,10 @@ copy_reps_from_temp(pack_context_t *context,
                     apr_file_t *temp_file,
                     apr_pool_t *pool)
 {
+  fs_fs_data_t *ffd = context->fs->fsap_data;
   apr_pool_t *iterpool = svn_pool_create(pool);
   apr_array_header_t *path_order = context->path_order;
+  int item_count = context->reps->nelts;
   int i;
 
   /* copy items in path order.  Exclude the non-HEAD noderevs. */
@@ -1227,6 +1255,22 @@ copy_reps_from_temp(pack_context_t *context,
         SVN_ERR(store_item(context, temp_file, rep_part, iterpool));
     }
 
+  /* The chunks of CHUNKED reps are not referenced by any noderev.  Copy
+   * all remaining file reps to not lose them. */
+  if (ffd->format >= SVN_FS_FS__MIN_CHUNKED_REP_FORMAT)
+    for (i = 0; i < item_count; ++i)
+      {
+        svn_fs_fs__p2l_entry_t *entry
+          = APR_ARRAY_IDX(context->reps, i, svn_fs_fs__p2l_entry_t *);
+
+        svn_pool_clear(iterpool);
+        if (entry && entry->type == SVN_FS_FS__ITEM_TYPE_FILE_REP)
+          {
+            APR_ARRAY_IDX(context->reps, i, svn_fs_fs__p2l_entry_t *) = NULL;
+            SVN_ERR(store_item(context, temp_file, entry, iterpool));
+          }
+      }
+
   /* copy the remaining non-head noderevs. */
   for (i = 0; i < path_order->nelts; ++i)
     {
@@ -1454,315 +1498,1257 @@ pack_range(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
-/* Append CONTEXT->START_REV to the context's pack file with no re-ordering.
- * This function will only be used for very large revisions (>>100k changes).
- * Use POOL for temporary allocations.
+/* External sorting for shards that are too large to be placed in memory.
+ *
+ * A sorter collects records consisting of a binary KEY and an opaque DATA
+ * payload and returns them ordered by KEY.  Keys get compared byte-wise,
+ * i.e. callers must encode their sort criteria such that memcmp() yields
+ * the desired order.
+ *
+ * The records are buffered in memory until they exceed the sorter's memory
+ * budget.  Then, they get sorted and appended to a temporary file as a new
+ * "run".  Reading the records back merges all runs, using a priority queue
+ * of the runs' current head records.
  */
-static svn_error_t *
-append_revision(pack_context_t *context,
-                apr_pool_t *pool)
-{
-  fs_fs_data_t *ffd = context->fs->fsap_data;
-  apr_off_t offset = 0;
-  apr_pool_t *iterpool = svn_pool_create(pool);
-  svn_fs_fs__revision_file_t *rev_file;
-  svn_filesize_t revdata_size;
-
-  /* Copy all non-index contents the rev file to the end of the pack file. */
-  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, context->fs,
-                                           context->start_rev, pool,
-                                           iterpool));
-  SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
-  revdata_size = rev_file->l2p_offset;
-
-  SVN_ERR(svn_io_file_aligned_seek(rev_file->file, ffd->block_size, NULL, 0,
-                                   iterpool));
-  SVN_ERR(copy_file_data(context, context->pack_file, rev_file->file,
-                         revdata_size, iterpool));
-
-  /* mark the start of a new revision */
-  SVN_ERR(svn_fs_fs__l2p_proto_index_add_revision(context->proto_l2p_index,
-                                                  pool));
-
-  /* read the phys-to-log index file until we covered the whole rev file.
-   * That index contains enough info to build both target indexes from it. */
-  while (offset < revdata_size)
-    {
-      /* read one cluster */
-      int i;
-      apr_array_header_t *entries;
 
-      svn_pool_clear(iterpool);
-      SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, context->fs, rev_file,
-                                          context->start_rev, offset,
-                                          ffd->p2l_page_size, iterpool,
-                                          iterpool));
+/* Maximum number of runs to merge at once.  If there are more, we merge
+ * them into fewer but longer runs first.  This also limits the number of
+ * read buffers allocated at the same time.
+ */
+#define MERGE_FAN_IN 16
 
-      for (i = 0; i < entries->nelts; ++i)
-        {
-          svn_fs_fs__p2l_entry_t *entry
-            = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
+/* Minimum size of the read buffer per run during a merge.
+ */
+#define MERGE_BUFFER_SIZE 0x4000
 
-          /* skip first entry if that was duplicated due crossing a
-             cluster boundary */
-          if (offset > entry->offset)
-            continue;
+/* A key / value pair stored in a sorter.
+ */
+typedef struct sort_record_t
+{
+  /* binary sort key */
+  const char *key;
 
-          /* process entry while inside the rev file */
-          offset = entry->offset;
-          if (offset < revdata_size)
-            {
-              entry->offset += context->pack_offset;
-              offset += entry->size;
-              SVN_ERR(svn_fs_fs__l2p_proto_index_add_entry(
-                         context->proto_l2p_index, entry->offset,
-                         entry->item.number, iterpool));
-              SVN_ERR(svn_fs_fs__p2l_proto_index_add_entry(
-                         context->proto_p2l_index, entry, iterpool));
-            }
-        }
-    }
+  /* number of bytes in KEY */
+  apr_uint32_t key_len;
 
-  svn_pool_destroy(iterpool);
-  context->pack_offset += revdata_size;
+  /* payload, not interpreted by the sorter */
+  const char *data;
 
-  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+  /* number of bytes in DATA */
+  apr_uint32_t data_len;
+} sort_record_t;
 
-  return SVN_NO_ERROR;
-}
+/* Header preceding the key and data of each record in a sorter file.
+ */
+typedef struct record_header_t
+{
+  apr_uint32_t key_len;
+  apr_uint32_t data_len;
+} record_header_t;
 
-/* Logical addressing mode packing logic.
- *
- * Pack the revision shard starting at SHARD_REV in filesystem FS from
- * SHARD_DIR into the PACK_FILE_DIR, using POOL for allocations.  Limit
- * the extra memory consumption to MAX_MEM bytes.  If FLUSH_TO_DISK is
- * non-zero, do not return until the data has actually been written on
- * the disk.  CANCEL_FUNC and CANCEL_BATON are what you think they are.
+/* Read access to a single run in a sorter file.
  */
-static svn_error_t *
-pack_log_addressed(svn_fs_t *fs,
-                   const char *pack_file_dir,
-                   const char *shard_dir,
-                   svn_revnum_t shard_rev,
-                   apr_size_t max_mem,
-                   svn_boolean_t flush_to_disk,
-                   svn_cancel_func_t cancel_func,
-                   void *cancel_baton,
-                   apr_pool_t *pool)
+typedef struct merge_source_t
 {
-  enum
-    {
-      /* estimated amount of memory used to represent one item in memory
-       * during rev file packing */
-      PER_ITEM_MEM = APR_ALIGN_DEFAULT(sizeof(path_order_t))
-                   + APR_ALIGN_DEFAULT(2 *sizeof(void*))
-                   + APR_ALIGN_DEFAULT(sizeof(reference_t))
-                   + APR_ALIGN_DEFAULT(sizeof(svn_fs_fs__p2l_entry_t))
-                   + 6 * sizeof(void*)
-    };
+  /* next offset to read from the sorter file */
+  apr_off_t pos;
 
-  int max_items;
-  apr_array_header_t *max_ids;
-  pack_context_t context = { 0 };
-  int i;
-  apr_size_t item_count = 0;
-  apr_pool_t *iterpool = svn_pool_create(pool);
+  /* end of this run within the sorter file */
+  apr_off_t end;
 
-  /* Prevent integer overflow.  We use apr arrays to process the items so
-   * the maximum number of items is INT_MAX. */
-    {
-      apr_size_t temp = max_mem / PER_ITEM_MEM;
-      SVN_ERR_ASSERT(temp <= INT_MAX);
-      max_items = (int)temp;
-    }
+  /* read-ahead buffer and its capacity */
+  char *buffer;
+  apr_size_t buffer_size;
 
-  /* set up a pack context */
-  SVN_ERR(initialize_pack_context(&context, fs, pack_file_dir, shard_dir,
-                                  shard_rev, max_items, flush_to_disk,
-                                  cancel_func, cancel_baton, pool));
+  /* first unprocessed byte and end of valid data in BUFFER */
+  apr_size_t buffer_pos;
+  apr_size_t buffer_len;
 
-  /* phase 1: determine the size of the revisions to pack */
-  SVN_ERR(svn_fs_fs__l2p_get_max_ids(&max_ids, fs, shard_rev,
-                                     context.shard_end_rev - shard_rev,
-                                     pool, pool));
+  /* storage for the contents of RECORD */
+  svn_membuf_t record_buffer;
 
-  /* pack revisions in ranges that don't exceed MAX_MEM */
-  for (i = 0; i < max_ids->nelts; ++i)
-    if (   APR_ARRAY_IDX(max_ids, i, apr_uint64_t)
-        <= (apr_uint64_t)max_items - item_count)
-      {
-        item_count += APR_ARRAY_IDX(max_ids, i, apr_uint64_t);
-        context.end_rev++;
-      }
-    else
-      {
-        svn_pool_clear(iterpool);
+  /* current head record of this run */
+  sort_record_t record;
+} merge_source_t;
 
-        /* some unpacked revisions before this one? */
-        if (context.start_rev < context.end_rev)
-          {
-            /* pack them intelligently (might be just 1 rev but still ...) */
-            SVN_ERR(pack_range(&context, iterpool));
-            SVN_ERR(reset_pack_context(&context, iterpool));
-            item_count = 0;
-          }
+/* Merge state for a set of runs from the same sorter file.
+ */
+typedef struct merger_t
+{
+  /* file containing all runs */
+  apr_file_t *file;
 
-        /* next revision range is to start with the current revision */
-        context.start_rev = i + context.shard_rev;
-        context.end_rev = context.start_rev + 1;
+  /* array of merge_source_t *, used as storage by QUEUE */
+  apr_array_header_t *sources;
 
-        /* if this is a very large revision, we must place it as is */
-        if (APR_ARRAY_IDX(max_ids, i, apr_uint64_t) > max_items)
-          {
-            SVN_ERR(append_revision(&context, iterpool));
-            context.start_rev++;
-          }
-        else
-          item_count += (apr_size_t)APR_ARRAY_IDX(max_ids, i, apr_uint64_t);
-      }
+  /* sources that still have records, ordered by their head records */
+  svn_priority_queue__t *queue;
 
-  /* non-empty revision range at the end? */
-  if (context.start_rev < context.end_rev)
-    SVN_ERR(pack_range(&context, iterpool));
+  /* if set, the record at the head of QUEUE has already been returned */
+  svn_boolean_t advance;
+} merger_t;
 
-  /* last phase: finalize indexes and clean up */
-  SVN_ERR(reset_pack_context(&context, iterpool));
-  SVN_ERR(close_pack_context(&context, iterpool));
-  svn_pool_destroy(iterpool);
+/* An external sorter.
+ */
+typedef struct sorter_t
+{
+  /* approximate memory limit for buffered records */
+  apr_size_t max_mem;
 
-  return SVN_NO_ERROR;
-}
+  /* approximate memory used by buffered records */
+  apr_size_t mem_used;
 
-/* Given REV in FS, set *REV_OFFSET to REV's offset in the packed file.
-   Use POOL for temporary allocations. */
-svn_error_t *
-svn_fs_fs__get_packed_offset(apr_off_t *rev_offset,
-                             svn_fs_t *fs,
-                             svn_revnum_t rev,
-                             apr_pool_t *pool)
-{
-  fs_fs_data_t *ffd = fs->fsap_data;
-  svn_stream_t *manifest_stream;
-  svn_boolean_t is_cached;
-  svn_revnum_t shard;
-  apr_int64_t shard_pos;
-  apr_array_header_t *manifest;
-  apr_pool_t *iterpool;
+  /* array of sort_record_t *, buffered records not yet written to FILE */
+  apr_array_header_t *records;
 
-  shard = rev / ffd->max_files_per_dir;
+  /* pool containing RECORDS' contents */
+  apr_pool_t *record_pool;
 
-  /* position of the shard within the manifest */
-  shard_pos = rev % ffd->max_files_per_dir;
+  /* temporary file containing all runs.  NULL, if no run has been
+   * written yet. */
+  apr_file_t *file;
 
-  /* fetch exactly that element into *rev_offset, if the manifest is found
-     in the cache */
-  SVN_ERR(svn_cache__get_partial((void **) rev_offset, &is_cached,
-                                 ffd->packed_offset_cache, &shard,
-                                 svn_fs_fs__get_sharded_offset, &shard_pos,
-                                 pool));
+  /* current size of FILE */
+  apr_off_t file_size;
 
-  if (is_cached)
-      return SVN_NO_ERROR;
+  /* array of apr_off_t, start offsets of the runs in FILE */
+  apr_array_header_t *runs;
 
-  /* Open the manifest file. */
-  SVN_ERR(svn_stream_open_readonly(&manifest_stream,
-                                   svn_fs_fs__path_rev_packed(fs, rev,
-                                                              PATH_MANIFEST,
-                                                              pool),
-                                   pool, pool));
+  /* index of the next record in RECORDS to return, if FILE is NULL */
+  int next_record;
 
-  /* While we're here, let's just read the entire manifest file into an array,
-     so we can cache the entire thing. */
-  iterpool = svn_pool_create(pool);
-  manifest = apr_array_make(pool, ffd->max_files_per_dir, sizeof(apr_off_t));
-  while (1)
-    {
-      svn_boolean_t eof;
-      apr_int64_t val;
+  /* merge state while reading back records from FILE */
+  merger_t *merger;
 
-      svn_pool_clear(iterpool);
-      SVN_ERR(svn_fs_fs__read_number_from_stream(&val, &eof, manifest_stream,
-                                                 iterpool));
-      if (eof)
-        break;
+  /* pool used for all of the above */
+  apr_pool_t *pool;
+} sorter_t;
 
-      APR_ARRAY_PUSH(manifest, apr_off_t) = (apr_off_t)val;
-    }
-  svn_pool_destroy(iterpool);
+/* implements compare_fn_t.  Order by key, shorter keys first if one is a
+ * prefix of the other.
+ */
+static int
+compare_sort_records(const sort_record_t *lhs,
+                     const sort_record_t *rhs)
+{
+  int diff = memcmp(lhs->key, rhs->key, MIN(lhs->key_len, rhs->key_len));
+  if (diff)
+    return diff;
 
-  *rev_offset = APR_ARRAY_IDX(manifest, rev % ffd->max_files_per_dir,
-                              apr_off_t);
+  if (lhs->key_len == rhs->key_len)
+    return 0;
 
-  /* Close up shop and cache the array. */
-  SVN_ERR(svn_stream_close(manifest_stream));
-  return svn_cache__set(ffd->packed_offset_cache, &shard, manifest, pool);
+  return lhs->key_len < rhs->key_len ? -1 : 1;
 }
 
-/* Packing logic for physical addresssing mode:
- * Simply concatenate all revision contents.
- *
- * Pack the revision shard starting at SHARD_REV containing exactly
- * MAX_FILES_PER_DIR revisions from SHARD_PATH into the PACK_FILE_DIR,
- * using POOL for allocations.  If FLUSH_TO_DISK is non-zero, do not
- * return until the data has actually been written on the disk.
- * CANCEL_FUNC and CANCEL_BATON are what you think they are.
+/* implements compare_fn_t for arrays of sort_record_t *.
  */
-static svn_error_t *
-pack_phys_addressed(const char *pack_file_dir,
-                    const char *shard_path,
-                    svn_revnum_t start_rev,
-                    int max_files_per_dir,
-                    svn_boolean_t flush_to_disk,
-                    svn_cancel_func_t cancel_func,
-                    void *cancel_baton,
-                    apr_pool_t *pool)
+static int
+compare_sort_record_ptrs(const sort_record_t * const * lhs,
+                         const sort_record_t * const * rhs)
 {
-  const char *pack_file_path, *manifest_file_path;
-  apr_file_t *pack_file;
-  apr_file_t *manifest_file;
-  svn_stream_t *manifest_stream;
-  svn_revnum_t end_rev, rev;
-  apr_pool_t *iterpool;
-
-  /* Some useful paths. */
-  pack_file_path = svn_dirent_join(pack_file_dir, PATH_PACKED, pool);
-  manifest_file_path = svn_dirent_join(pack_file_dir, PATH_MANIFEST, pool);
+  return compare_sort_records(*lhs, *rhs);
+}
 
-  /* Create the new directory and pack file.
-   * Use unbuffered apr_file_t since we're going to write using 16kb
-   * chunks. */
-  SVN_ERR(svn_io_file_open(&pack_file, pack_file_path,
-                           APR_WRITE | APR_CREATE | APR_EXCL,
-                           APR_OS_DEFAULT, pool));
+/* implements compare_fn_t for arrays of merge_source_t *.
+ */
+static int
+compare_merge_sources(const merge_source_t * const * lhs,
+                      const merge_source_t * const * rhs)
+{
+  return compare_sort_records(&(*lhs)->record, &(*rhs)->record);
+}
 
-  /* Create the manifest file. */
-  SVN_ERR(svn_io_file_open(&manifest_file, manifest_file_path,
-                           APR_WRITE | APR_BUFFERED | APR_CREATE | APR_EXCL,
-                           APR_OS_DEFAULT, pool));
-  manifest_stream = svn_stream_from_aprfile2(manifest_file, TRUE, pool);
+/* Create a new sorter that buffers about MAX_MEM bytes before writing
+ * a run to disk.  Allocate it in RESULT_POOL and return it in *SORTER.
+ */
+static void
+sorter_create(sorter_t **sorter,
+              apr_size_t max_mem,
+              apr_pool_t *result_pool)
+{
+  sorter_t *result = apr_pcalloc(result_pool, sizeof(*result));
 
-  end_rev = start_rev + max_files_per_dir - 1;
-  iterpool = svn_pool_create(pool);
+  result->max_mem = max_mem;
+  result->records = apr_array_make(result_pool, 16, sizeof(sort_record_t *));
+  result->record_pool = svn_pool_create(result_pool);
+  result->runs = apr_array_make(result_pool, 4, sizeof(apr_off_t));
+  result->pool = result_pool;
 
-  /* Iterate over the revisions in this shard, squashing them together. */
-  for (rev = start_rev; rev <= end_rev; rev++)
-    {
-      svn_stream_t *rev_stream;
-      const char *path;
-      apr_off_t offset;
-      apr_file_t *rev_file;
+  *sorter = result;
+}
 
-      svn_pool_clear(iterpool);
+/* Sort the records buffered in SORTER and append them as a new run to its
+ * temporary file.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+sorter_write_run(sorter_t *sorter,
+                 apr_pool_t *scratch_pool)
+{
+  int i;
 
-      path = svn_dirent_join(shard_path, apr_psprintf(iterpool, "%ld", rev),
-                             iterpool);
+  if (sorter->records->nelts == 0)
+    return SVN_NO_ERROR;
 
-      /* Obtain current offset in pack file. */
-      SVN_ERR(svn_io_file_get_offset(&offset, pack_file, iterpool));
+  if (sorter->file == NULL)
+    SVN_ERR(svn_io_open_unique_file3(&sorter->file, NULL, NULL,
+                                     svn_io_file_del_on_close,
+                                     sorter->pool, scratch_pool));
 
-      /* build manifest */
-      SVN_ERR(svn_stream_printf(manifest_stream, iterpool,
-                                "%" APR_OFF_T_FMT "\n", offset));
+  svn_sort__array(sorter->records,
+                  (int (*)(const void *, const void *))
+                    compare_sort_record_ptrs);
+
+  APR_ARRAY_PUSH(sorter->runs, apr_off_t) = sorter->file_size;
+  for (i = 0; i < sorter->records->nelts; ++i)
+    {
+      const sort_record_t *record
+        = APR_ARRAY_IDX(sorter->records, i, const sort_record_t *);
+      record_header_t header;
+
+      header.key_len = record->key_len;
+      header.data_len = record->data_len;
+
+      SVN_ERR(svn_io_file_write_full(sorter->file, &header, sizeof(header),
+                                     NULL, scratch_pool));
+      SVN_ERR(svn_io_file_write_full(sorter->file, record->key,
+                                     record->key_len, NULL, scratch_pool));
+      SVN_ERR(svn_io_file_write_full(sorter->file, record->data,
+                                     record->data_len, NULL, scratch_pool));
+      sorter->file_size += sizeof(header) + record->key_len
+                         + record->data_len;
+    }
+
+  apr_array_clear(sorter->records);
+  svn_pool_clear(sorter->record_pool);
+  sorter->mem_used = 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Add a copy of the record with KEY of KEY_LEN bytes and payload DATA of
+ * DATA_LEN bytes to SORTER.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+sorter_add(sorter_t *sorter,
+           const char *key,
+           apr_size_t key_len,
+           const void *data,
+           apr_size_t data_len,
+           apr_pool_t *scratch_pool)
+{
+  sort_record_t *record;
+  char *buffer;
+
+  SVN_ERR_ASSERT(sorter->merger == NULL);
+
+  record = apr_palloc(sorter->record_pool,
+                      sizeof(*record) + key_len + data_len);
+  buffer = (char *)(record + 1);
+  memcpy(buffer, key, key_len);
+  if (data_len)
+    memcpy(buffer + key_len, data, data_len);
+
+  record->key = buffer;
+  record->key_len = (apr_uint32_t)key_len;
+  record->data = buffer + key_len;
+  record->data_len = (apr_uint32_t)data_len;
+  APR_ARRAY_PUSH(sorter->records, sort_record_t *) = record;
+
+  /* Each run contains at least one record, no matter how small the
+   * memory budget is. */
+  sorter->mem_used += sizeof(*record) + key_len + data_len + sizeof(record);
+  if (sorter->mem_used >= sorter->max_mem)
+    SVN_ERR(sorter_write_run(sorter, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Copy the next LEN bytes of the run in SOURCE to BUFFER.  FILE is the
+ * sorter file containing the run.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+source_read(merge_source_t *source,
+            apr_file_t *file,
+            char *buffer,
+            apr_size_t len,
+            apr_pool_t *scratch_pool)
+{
+  while (len)
+    {
+      apr_size_t to_copy;
+
+      if (source->buffer_pos == source->buffer_len)
+        {
+          apr_off_t offset = source->pos;
+          apr_size_t to_read
+            = (apr_size_t)MIN(source->end - source->pos,
+                              (apr_off_t)source->buffer_size);
+
+          if (to_read == 0)
+            return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                    _("Unexpected end of pack sort run"));
+
+          SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, scratch_pool));
+          SVN_ERR(svn_io_file_read_full2(file, source->buffer, to_read,
+                                         NULL, NULL, scratch_pool));
+          source->pos += to_read;
+          source->buffer_pos = 0;
+          source->buffer_len = to_read;
+        }
+
+      to_copy = MIN(len, source->buffer_len - source->buffer_pos);
+      memcpy(buffer, source->buffer + source->buffer_pos, to_copy);
+      source->buffer_pos += to_copy;
+      buffer += to_copy;
+      len -= to_copy;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the next record of the run in SOURCE, stored in FILE, into SOURCE->
+ * RECORD.  Set *FOUND to FALSE, if the run has been exhausted.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+source_next(svn_boolean_t *found,
+            merge_source_t *source,
+            apr_file_t *file,
+            apr_pool_t *scratch_pool)
+{
+  record_header_t header;
+  apr_size_t len;
+
+  if (   source->pos == source->end
+      && source->buffer_pos == source->buffer_len)
+    {
+      *found = FALSE;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(source_read(source, file, (char *)&header, sizeof(header),
+                      scratch_pool));
+
+  len = (apr_size_t)header.key_len + header.data_len;
+  svn_membuf__ensure(&source->record_buffer, MAX(len, 1));
+  SVN_ERR(source_read(source, file, source->record_buffer.data, len,
+                      scratch_pool));
+
+  source->record.key = source->record_buffer.data;
+  source->record.key_len = header.key_len;
+  source->record.data = source->record.key + header.key_len;
+  source->record.data_len = header.data_len;
+  *found = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Prepare merging COUNT runs starting with run index FIRST in SORTER.
+ * Allocate the result in RESULT_POOL and return it in *MERGER.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+merger_open(merger_t **merger,
+            sorter_t *sorter,
+            int first,
+            int count,
+            apr_pool_t *result_pool,
+            apr_pool_t *scratch_pool)
+{
+  merger_t *result = apr_pcalloc(result_pool, sizeof(*result));
+  apr_size_t buffer_size = MAX(sorter->max_mem / MERGE_FAN_IN,
+                               MERGE_BUFFER_SIZE);
+  int i;
+
+  result->file = sorter->file;
+  result->sources = apr_array_make(result_pool, count,
+                                   sizeof(merge_source_t *));
+
+  for (i = first; i < first + count; ++i)
+    {
+      merge_source_t *source = apr_pcalloc(result_pool, sizeof(*source));
+      svn_boolean_t found;
+
+      source->pos = APR_ARRAY_IDX(sorter->runs, i, apr_off_t);
+      source->end = i + 1 < sorter->runs->nelts
+                  ? APR_ARRAY_IDX(sorter->runs, i + 1, apr_off_t)
+                  : sorter->file_size;
+      source->buffer_size = buffer_size;
+      source->buffer = apr_palloc(result_pool, buffer_size);
+      svn_membuf__create(&source->record_buffer, 0, result_pool);
+
+      SVN_ERR(source_next(&found, source, result->file, scratch_pool));
+      if (found)
+        APR_ARRAY_PUSH(result->sources, merge_source_t *) = source;
+    }
+
+  result->queue = svn_priority_queue__create(result->sources,
+                      (int (*)(const void *, const void *))
+                        compare_merge_sources);
+
+  *merger = result;
+  return SVN_NO_ERROR;
+}
+
+/* Return the next record from MERGER in *RECORD or NULL if all runs have
+ * been exhausted.  The record is valid until the next call.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+merger_next(const sort_record_t **record,
+            merger_t *merger,
+            apr_pool_t *scratch_pool)
+{
+  merge_source_t *source;
+
+  /* Replace the record we returned last time. */
+  if (merger->advance)
+    {
+      svn_boolean_t found;
+
+      source = *(merge_source_t **)svn_priority_queue__peek(merger->queue);
+      SVN_ERR(source_next(&found, source, merger->file, scratch_pool));
+      if (found)
+        svn_priority_queue__update(merger->queue);
+      else
+        svn_priority_queue__pop(merger->queue);
+
+      merger->advance = FALSE;
+    }
+
+  if (svn_priority_queue__size(merger->queue) == 0)
+    {
+      *record = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  source = *(merge_source_t **)svn_priority_queue__peek(merger->queue);
+  *record = &source->record;
+  merger->advance = TRUE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Merge the runs in SORTER into at most MERGE_FAN_IN longer runs, stored
+ * in a new temporary file.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+sorter_merge_runs(sorter_t *sorter,
+                  apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *mergepool = svn_pool_create(scratch_pool);
+  apr_file_t *file;
+  apr_off_t file_size = 0;
+  apr_array_header_t *runs;
+  int i;
+
+  while (sorter->runs->nelts > MERGE_FAN_IN)
+    {
+      SVN_ERR(svn_io_open_unique_file3(&file, NULL, NULL,
+                                       svn_io_file_del_on_close,
+                                       sorter->pool, scratch_pool));
+      runs = apr_array_make(sorter->pool,
+                            sorter->runs->nelts / MERGE_FAN_IN + 1,
+                            sizeof(apr_off_t));
+      file_size = 0;
+
+      for (i = 0; i < sorter->runs->nelts; i += MERGE_FAN_IN)
+        {
+          merger_t *merger;
+          const sort_record_t *record;
+
+          svn_pool_clear(mergepool);
+          SVN_ERR(merger_open(&merger, sorter, i,
+                              MIN(MERGE_FAN_IN, sorter->runs->nelts - i),
+                              mergepool, mergepool));
+
+          APR_ARRAY_PUSH(runs, apr_off_t) = file_size;
+          while (TRUE)
+            {
+              record_header_t header;
+
+              svn_pool_clear(iterpool);
+              SVN_ERR(merger_next(&record, merger, iterpool));
+              if (record == NULL)
+                break;
+
+              header.key_len = record->key_len;
+              header.data_len = record->data_len;
+
+              SVN_ERR(svn_io_file_write_full(file, &header, sizeof(header),
+                                             NULL, iterpool));
+              SVN_ERR(svn_io_file_write_full(file, record->key,
+                                             record->key_len + record->data_len,
+                                             NULL, iterpool));
+              file_size += sizeof(header) + record->key_len
+                         + record->data_len;
+            }
+        }
+
+      /* Replace the old runs. */
+      SVN_ERR(svn_io_file_close(sorter->file, scratch_pool));
+      sorter->file = file;
+      sorter->file_size = file_size;
+      sorter->runs = runs;
+    }
+
+  svn_pool_destroy(mergepool);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Finish adding records to SORTER and prepare reading them back in order.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+sorter_finish(sorter_t *sorter,
+              apr_pool_t *scratch_pool)
+{
+  /* Everything fit into memory?  Then, we don't need to touch the disk. */
+  if (sorter->file == NULL)
+    {
+      svn_sort__array(sorter->records,
+                      (int (*)(const void *, const void *))
+                        compare_sort_record_ptrs);
+      sorter->next_record = 0;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(sorter_write_run(sorter, scratch_pool));
+  SVN_ERR(sorter_merge_runs(sorter, scratch_pool));
+
+  return svn_error_trace(merger_open(&sorter->merger, sorter, 0,
+                                     sorter->runs->nelts, sorter->pool,
+                                     scratch_pool));
+}
+
+/* Return the next record from the finished SORTER in *RECORD or NULL if
+ * there are no more records.  The record is valid until the next call.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+sorter_next(const sort_record_t **record,
+            sorter_t *sorter,
+            apr_pool_t *scratch_pool)
+{
+  if (sorter->merger)
+    return svn_error_trace(merger_next(record, sorter->merger,
+                                       scratch_pool));
+
+  if (sorter->next_record < sorter->records->nelts)
+    *record = APR_ARRAY_IDX(sorter->records, sorter->next_record++,
+                            const sort_record_t *);
+  else
+    *record = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Sections of the pack file, in placement order, as used by the streaming
+ * pack.  Their values form the first byte of the respective sort keys.
+ */
+enum stream_bucket_t
+{
+  /* changed paths lists, newest first */
+  BUCKET_CHANGES = 0,
+
+  /* file properties, newest first */
+  BUCKET_FILE_PROPS,
+
+  /* directory properties, newest first */
+  BUCKET_DIR_PROPS,
+
+  /* HEAD noderevs and all representations, hot zone first, then in path
+   * order, each representation behind the first noderev referring to it */
+  BUCKET_PATHS,
+
+  /* representations not referenced by any noderev, e.g. chunks of CHUNKED
+   * representations, in revision order */
+  BUCKET_UNREFERENCED_REPS,
+
+  /* the remaining non-HEAD noderevs */
+  BUCKET_OLD_NODEREVS
+};
+
+/* Payload of the per-noderev records in the streaming pack.
+ */
+typedef struct stream_noderev_t
+{
+  /* location of the noderev in the items temp file */
+  svn_fs_fs__p2l_entry_t entry;
+
+  /* whether the noderev belongs to the "hot zone", see is_hot_node() */
+  svn_boolean_t is_hot;
+} stream_noderev_t;
+
+/* Append VALUE to KEY such that byte-wise comparison of keys yields the
+ * same order as comparing the values.  Reverse the order, if DESCENDING
+ * is set.
+ */
+static void
+append_key_number(svn_stringbuf_t *key,
+                  apr_int64_t value,
+                  svn_boolean_t descending)
+{
+  /* Flipping the sign bit makes negative values sort before positive
+   * ones as unsigned numbers. */
+  apr_uint64_t number = (apr_uint64_t)value ^ APR_UINT64_C(0x8000000000000000);
+  unsigned char buffer[8];
+  int i;
+
+  if (descending)
+    number = ~number;
+
+  for (i = 0; i < 8; ++i)
+    buffer[i] = (unsigned char)(number >> (56 - 8 * i));
+
+  svn_stringbuf_appendbytes(key, (const char *)buffer, sizeof(buffer));
+}
+
+/* Set KEY to sort ID in ascending order and directly after all references
+ * to it, if IS_REP is set, or before the item itself otherwise.
+ */
+static void
+make_rep_key(svn_stringbuf_t *key,
+             const svn_fs_fs__id_part_t *id,
+             svn_boolean_t is_rep)
+{
+  svn_stringbuf_setempty(key);
+  append_key_number(key, id->revision, FALSE);
+  append_key_number(key, (apr_int64_t)id->number, FALSE);
+  svn_stringbuf_appendbyte(key, is_rep ? 1 : 0);
+}
+
+/* Length of the item ID prefix of keys created by make_rep_key(). */
+#define REP_KEY_ID_LEN 16
+
+/* The sorters used during the streaming pack.
+ */
+typedef struct stream_sorters_t
+{
+  /* all items except noderevs and reps, later everything, in placement
+   * order */
+  sorter_t *placement;
+
+  /* reps and the references to them as keyed by make_rep_key() */
+  sorter_t *reps;
+
+  /* all noderevs in path, node ID, revision order */
+  sorter_t *noderevs;
+
+  /* reusable key buffer */
+  svn_stringbuf_t *key;
+} stream_sorters_t;
+
+/* Copy the item described by ENTRY from the current position in REV_FILE
+ * to CONTEXT->REPS_FILE and add it to the respective sorter in SORTERS.
+ * Use POOL for temporary allocations.
+ */
+static svn_error_t *
+copy_item_to_stream(pack_context_t *context,
+                    stream_sorters_t *sorters,
+                    svn_fs_fs__revision_file_t *rev_file,
+                    const svn_fs_fs__p2l_entry_t *entry,
+                    apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = context->fs->fsap_data;
+  svn_fs_fs__p2l_entry_t copy = *entry;
+  svn_stringbuf_t *key = sorters->key;
+  node_revision_t *noderev = NULL;
+  apr_off_t source_offset = entry->offset;
+
+  /* parse noderevs before copying them */
+  if (entry->type == SVN_FS_FS__ITEM_TYPE_NODEREV)
+    {
+      SVN_ERR(svn_fs_fs__read_noderev(&noderev, rev_file->stream, pool,
+                                      pool));
+      SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &source_offset,
+                               pool));
+    }
+
+  SVN_ERR(svn_io_file_get_offset(&copy.offset, context->reps_file, pool));
+  SVN_ERR(copy_file_data(context, context->reps_file, rev_file->file,
+                         entry->size, pool));
+
+  switch (entry->type)
+    {
+      case SVN_FS_FS__ITEM_TYPE_CHANGES:
+      case SVN_FS_FS__ITEM_TYPE_FILE_PROPS:
+      case SVN_FS_FS__ITEM_TYPE_DIR_PROPS:
+        svn_stringbuf_setempty(key);
+        svn_stringbuf_appendbyte(key,
+            entry->type == SVN_FS_FS__ITEM_TYPE_CHANGES ? BUCKET_CHANGES
+          : entry->type == SVN_FS_FS__ITEM_TYPE_FILE_PROPS
+                                                  ? BUCKET_FILE_PROPS
+                                                  : BUCKET_DIR_PROPS);
+        append_key_number(key, entry->item.revision, TRUE);
+        append_key_number(key, (apr_int64_t)entry->item.number, TRUE);
+        SVN_ERR(sorter_add(sorters->placement, key->data, key->len,
+                           &copy, sizeof(copy), pool));
+        break;
+
+      case SVN_FS_FS__ITEM_TYPE_FILE_REP:
+      case SVN_FS_FS__ITEM_TYPE_DIR_REP:
+        make_rep_key(key, &entry->item, TRUE);
+        SVN_ERR(sorter_add(sorters->reps, key->data, key->len,
+                           &copy, sizeof(copy), pool));
+        break;
+
+      case SVN_FS_FS__ITEM_TYPE_NODEREV:
+        {
+          stream_noderev_t node;
+          svn_stringbuf_t *node_key;
+          const char *sort_path;
+
+          node.entry = copy;
+          node.is_hot = is_hot_node(ffd, noderev->predecessor_count);
+
+          /* Same order as compare_path_order(). */
+          sort_path = tweak_path_for_ordering(noderev->created_path, pool);
+          node_key = svn_stringbuf_create_ensure(strlen(sort_path) + 32,
+                                                 pool);
+          svn_stringbuf_appendbytes(node_key, sort_path,
+                                    strlen(sort_path) + 1);
+          append_key_number(node_key,
+                            svn_fs_fs__id_node_id(noderev->id)->revision,
+                            TRUE);
+          append_key_number(node_key, (apr_int64_t)
+                            svn_fs_fs__id_node_id(noderev->id)->number,
+                            TRUE);
+          append_key_number(node_key, svn_fs_fs__id_rev(noderev->id), TRUE);
+          SVN_ERR(sorter_add(sorters->noderevs, node_key->data,
+                             node_key->len, &node, sizeof(node), pool));
+
+          /* Reference the data representation, if it is in this shard.
+           * The reference leads with the noderev's final position. */
+          if (   noderev->data_rep
+              && noderev->data_rep->revision >= context->shard_rev)
+            {
+              svn_fs_fs__id_part_t rep_id;
+              rep_id.revision = noderev->data_rep->revision;
+              rep_id.number = noderev->data_rep->item_index;
+
+              make_rep_key(key, &rep_id, FALSE);
+              svn_stringbuf_appendbyte(key, BUCKET_PATHS);
+              svn_stringbuf_appendbyte(key, node.is_hot ? 0 : 1);
+              svn_stringbuf_appendbytes(key, node_key->data, node_key->len);
+              SVN_ERR(sorter_add(sorters->reps, key->data, key->len,
+                                 NULL, 0, pool));
+            }
+        }
+        break;
+
+      default:
+        SVN_ERR_ASSERT(entry->type == SVN_FS_FS__ITEM_TYPE_UNUSED);
+        break;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read all items of CONTEXT's shard, copy them to CONTEXT->REPS_FILE and
+ * feed them into SORTERS.  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+scan_shard_to_stream(pack_context_t *context,
+                     stream_sorters_t *sorters,
+                     apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = context->fs->fsap_data;
+  apr_pool_t *revpool = svn_pool_create(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_pool_t *iterpool2 = svn_pool_create(pool);
+  svn_revnum_t revision;
+
+  for (revision = context->shard_rev;
+       revision < context->shard_end_rev;
+       ++revision)
+    {
+      apr_off_t offset = 0;
+      svn_fs_fs__revision_file_t *rev_file;
+
+      svn_pool_clear(revpool);
+
+      /* Get the rev file dimensions (mainly index locations). */
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, context->fs,
+                                               revision, revpool, iterpool));
+      SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
+
+      /* read the phys-to-log index file until we covered the whole rev
+       * file. */
+      while (offset < rev_file->l2p_offset)
+        {
+          /* read one cluster */
+          int i;
+          apr_array_header_t *entries;
+
+          svn_pool_clear(iterpool);
+
+          SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, context->fs,
+                                              rev_file, revision, offset,
+                                              ffd->p2l_page_size, iterpool,
+                                              iterpool));
+
+          for (i = 0; i < entries->nelts; ++i)
+            {
+              svn_fs_fs__p2l_entry_t *entry
+                = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
+
+              /* skip first entry if that was duplicated due crossing a
+                 cluster boundary */
+              if (offset > entry->offset)
+                continue;
+
+              svn_pool_clear(iterpool2);
+
+              /* process entry while inside the rev file */
+              offset = entry->offset;
+              if (offset < rev_file->l2p_offset)
+                {
+                  SVN_ERR(svn_io_file_seek(rev_file->file, APR_SET, &offset,
+                                           iterpool2));
+                  SVN_ERR(copy_item_to_stream(context, sorters, rev_file,
+                                              entry, iterpool2));
+                  offset += entry->size;
+                }
+            }
+
+          if (context->cancel_func)
+            SVN_ERR(context->cancel_func(context->cancel_baton));
+        }
+
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+    }
+
+  svn_pool_destroy(iterpool2);
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(revpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Move all noderevs from SORTERS->NODEREVS to SORTERS->PLACEMENT, keyed
+ * by their final position.  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+place_noderevs_streamed(stream_sorters_t *sorters,
+                        apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_stringbuf_t *path = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *key = sorters->key;
+  const sort_record_t *record;
+
+  SVN_ERR(sorter_finish(sorters->noderevs, pool));
+  while (TRUE)
+    {
+      stream_noderev_t node;
+      apr_size_t path_len;
+      svn_boolean_t is_head;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(sorter_next(&record, sorters->noderevs, iterpool));
+      if (record == NULL)
+        break;
+
+      /* The first noderev per path is the latest for that path. */
+      memcpy(&node, record->data, sizeof(node));
+      path_len = strlen(record->key);
+      is_head = path->len != path_len
+             || memcmp(path->data, record->key, path_len);
+      if (is_head)
+        svn_stringbuf_set(path, record->key);
+
+      svn_stringbuf_setempty(key);
+      svn_stringbuf_appendbyte(key,
+                               is_head ? BUCKET_PATHS : BUCKET_OLD_NODEREVS);
+      svn_stringbuf_appendbyte(key, node.is_hot ? 0 : 1);
+      svn_stringbuf_appendbytes(key, record->key, record->key_len);
+
+      /* HEAD noderevs go in front of their representations. */
+      if (is_head)
+        svn_stringbuf_appendbyte(key, 0);
+
+      SVN_ERR(sorter_add(sorters->placement, key->data, key->len,
+                         &node.entry, sizeof(node.entry), iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Move all representations from SORTERS->REPS to SORTERS->PLACEMENT, each
+ * directly behind the noderev with the lowest placement key referring to
+ * it.  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+place_reps_streamed(stream_sorters_t *sorters,
+                    apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_stringbuf_t *first_ref = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *key = sorters->key;
+  char current_id[REP_KEY_ID_LEN] = { 0 };
+  svn_boolean_t have_ref = FALSE;
+  const sort_record_t *record;
+
+  SVN_ERR(sorter_finish(sorters->reps, pool));
+  while (TRUE)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(sorter_next(&record, sorters->reps, iterpool));
+      if (record == NULL)
+        break;
+
+      /* New rep? */
+      if (memcmp(current_id, record->key, REP_KEY_ID_LEN))
+        {
+          memcpy(current_id, record->key, REP_KEY_ID_LEN);
+          have_ref = FALSE;
+        }
+
+      /* References sort before the rep itself, lowest position first. */
+      if (record->key[REP_KEY_ID_LEN] == 0)
+        {
+          if (!have_ref)
+            {
+              svn_stringbuf_setempty(first_ref);
+              svn_stringbuf_appendbytes(first_ref,
+                                        record->key + REP_KEY_ID_LEN + 1,
+                                        record->key_len - REP_KEY_ID_LEN - 1);
+              have_ref = TRUE;
+            }
+
+          continue;
+        }
+
+      if (have_ref)
+        {
+          svn_stringbuf_setempty(key);
+          svn_stringbuf_appendbytes(key, first_ref->data, first_ref->len);
+          svn_stringbuf_appendbyte(key, 1);
+        }
+      else
+        {
+          svn_stringbuf_setempty(key);
+          svn_stringbuf_appendbyte(key, BUCKET_UNREFERENCED_REPS);
+          svn_stringbuf_appendbytes(key, record->key, REP_KEY_ID_LEN);
+        }
+
+      SVN_ERR(sorter_add(sorters->placement, key->data, key->len,
+                         record->data, record->data_len, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Pack CONTEXT's whole shard in a single pass using about MAX_MEM bytes
+ * of memory, independently of the number of items in the shard.
+ *
+ * The placement follows that of pack_range() except for the delta chain
+ * heuristics, which would require random access to all references.  All
+ * items are first copied into a temporary file.  External sorters then
+ * determine the final position of each item, the pack file gets written
+ * in that order and the L2P index entries sorted by revision and item
+ * number.  Use POOL for allocations.
+ */
+static svn_error_t *
+pack_shard_streamed(pack_context_t *context,
+                    apr_size_t max_mem,
+                    apr_pool_t *pool)
+{
+  apr_pool_t *sorter_pool = svn_pool_create(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t prev_rev = SVN_INVALID_REVNUM;
+  stream_sorters_t sorters;
+  sorter_t *l2p_sorter;
+  const sort_record_t *record;
+
+  /* Phase 2: copy all items to the temp file and collect placement
+   * information.  The three sorters share the memory budget. */
+  sorter_create(&sorters.placement, max_mem / 3, pool);
+  sorter_create(&sorters.reps, max_mem / 3, sorter_pool);
+  sorter_create(&sorters.noderevs, max_mem / 3, sorter_pool);
+  sorters.key = svn_stringbuf_create_empty(pool);
+
+  SVN_ERR(scan_shard_to_stream(context, &sorters, iterpool));
+
+  /* Phase 3: placement. */
+  SVN_ERR(place_noderevs_streamed(&sorters, iterpool));
+  SVN_ERR(place_reps_streamed(&sorters, iterpool));
+  svn_pool_destroy(sorter_pool);
+
+  /* Phase 4: copy the items to the pack file and write the P2L index.
+   * Collect the L2P entries for the final step. */
+  sorter_create(&l2p_sorter, max_mem / 3, pool);
+  SVN_ERR(sorter_finish(sorters.placement, iterpool));
+  while (TRUE)
+    {
+      svn_fs_fs__p2l_entry_t entry;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(sorter_next(&record, sorters.placement, iterpool));
+      if (record == NULL)
+        break;
+
+      memcpy(&entry, record->data, sizeof(entry));
+      SVN_ERR(write_item(context, context->reps_file, &entry, iterpool));
+
+      make_rep_key(sorters.key, &entry.item, TRUE);
+      SVN_ERR(sorter_add(l2p_sorter, sorters.key->data, REP_KEY_ID_LEN,
+                         &entry, sizeof(entry), iterpool));
+
+      if (context->cancel_func)
+        SVN_ERR(context->cancel_func(context->cancel_baton));
+    }
+
+  /* write L2P index as well (now that we know all target offsets) */
+  SVN_ERR(sorter_finish(l2p_sorter, iterpool));
+  while (TRUE)
+    {
+      svn_fs_fs__p2l_entry_t entry;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(sorter_next(&record, l2p_sorter, iterpool));
+      if (record == NULL)
+        break;
+
+      memcpy(&entry, record->data, sizeof(entry));
+
+      /* next revision? */
+      if (prev_rev != entry.item.revision)
+        {
+          prev_rev = entry.item.revision;
+          SVN_ERR(svn_fs_fs__l2p_proto_index_add_revision(
+                       context->proto_l2p_index, iterpool));
+        }
+
+      SVN_ERR(svn_fs_fs__l2p_proto_index_add_entry(context->proto_l2p_index,
+                                                   entry.offset,
+                                                   entry.item.number,
+                                                   iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Logical addressing mode packing logic.
+ *
+ * Pack the revision shard starting at SHARD_REV in filesystem FS from
+ * SHARD_DIR into the PACK_FILE_DIR, using POOL for allocations.  Limit
+ * the extra memory consumption to MAX_MEM bytes.  The caller is
+ * responsible for flushing the result to disk.  CANCEL_FUNC and
+ * CANCEL_BATON are what you think they are.
+ */
+static svn_error_t *
+pack_log_addressed(svn_fs_t *fs,
+                   const char *pack_file_dir,
+                   const char *shard_dir,
+                   svn_revnum_t shard_rev,
+                   apr_size_t max_mem,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *pool)
+{
+  enum
+    {
+      /* estimated amount of memory used to represent one item in memory
+       * during rev file packing */
+      PER_ITEM_MEM = APR_ALIGN_DEFAULT(sizeof(path_order_t))
+                   + APR_ALIGN_DEFAULT(2 *sizeof(void*))
+                   + APR_ALIGN_DEFAULT(sizeof(reference_t))
+                   + APR_ALIGN_DEFAULT(sizeof(svn_fs_fs__p2l_entry_t))
+                   + 6 * sizeof(void*)
+    };
+
+  fs_fs_data_t *ffd = fs->fsap_data;
+  int max_items;
+  apr_array_header_t *max_ids;
+  pack_context_t context = { 0 };
+  int i;
+  apr_uint64_t item_count = 0;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Prevent integer overflow.  We use apr arrays to process the items so
+   * the maximum number of items is INT_MAX. */
+    {
+      apr_size_t temp = max_mem / PER_ITEM_MEM;
+      SVN_ERR_ASSERT(temp <= INT_MAX);
+      max_items = (int)temp;
+    }
+
+  /* phase 1: determine the size of the revisions to pack */
+  SVN_ERR(svn_fs_fs__l2p_get_max_ids(&max_ids, fs, shard_rev,
+                                     ffd->max_files_per_dir,
+                                     pool, pool));
+  for (i = 0; i < max_ids->nelts; ++i)
+    item_count += APR_ARRAY_IDX(max_ids, i, apr_uint64_t);
+
+  if (item_count <= (apr_uint64_t)max_items)
+    {
+      /* The whole shard can be placed in memory. */
+      SVN_ERR(initialize_pack_context(&context, fs, pack_file_dir,
+                                      shard_dir, shard_rev,
+                                      (int)item_count, cancel_func,
+                                      cancel_baton, pool));
+      context.end_rev = context.shard_end_rev;
+      SVN_ERR(pack_range(&context, iterpool));
+    }
+  else
+    {
+      /* Too large.  Sort the items on disk instead. */
+      SVN_ERR(initialize_pack_context(&context, fs, pack_file_dir,
+                                      shard_dir, shard_rev, 0,
+                                      cancel_func, cancel_baton, pool));
+      SVN_ERR(pack_shard_streamed(&context, max_mem, iterpool));
+    }
+
+  /* last phase: finalize indexes and clean up */
+  SVN_ERR(reset_pack_context(&context, iterpool));
+  SVN_ERR(close_pack_context(&context, iterpool));
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Given REV in FS, set *REV_OFFSET to REV's offset in the packed file.
+   Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__get_packed_offset(apr_off_t *rev_offset,
+                             svn_fs_t *fs,
+                             svn_revnum_t rev,
+                             apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_stream_t *manifest_stream;
+  svn_boolean_t is_cached;
+  svn_revnum_t shard;
+  apr_int64_t shard_pos;
+  apr_array_header_t *manifest;
+  apr_pool_t *iterpool;
+
+  shard = rev / ffd->max_files_per_dir;
+
+  /* position of the shard within the manifest */
+  shard_pos = rev % ffd->max_files_per_dir;
+
+  /* fetch exactly that element into *rev_offset, if the manifest is found
+     in the cache */
+  SVN_ERR(svn_cache__get_partial((void **) rev_offset, &is_cached,
+                                 ffd->packed_offset_cache, &shard,
+                                 svn_fs_fs__get_sharded_offset, &shard_pos,
+                                 pool));
+
+  if (is_cached)
+      return SVN_NO_ERROR;
+
+  /* Open the manifest file. */
+  SVN_ERR(svn_stream_open_readonly(&manifest_stream,
+                                   svn_fs_fs__path_rev_packed(fs, rev,
+                                                              PATH_MANIFEST,
+                                                              pool),
+                                   pool, pool));
+
+  /* While we're here, let's just read the entire manifest file into an array,
+     so we can cache the entire thing. */
+  iterpool = svn_pool_create(pool);
+  manifest = apr_array_make(pool, ffd->max_files_per_dir, sizeof(apr_off_t));
+  while (1)
+    {
+      svn_boolean_t eof;
+      apr_int64_t val;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__read_number_from_stream(&val, &eof, manifest_stream,
+                                                 iterpool));
+      if (eof)
+        break;
+
+      APR_ARRAY_PUSH(manifest, apr_off_t) = (apr_off_t)val;
+    }
+  svn_pool_destroy(iterpool);
+
+  *rev_offset = APR_ARRAY_IDX(manifest, rev % ffd->max_files_per_dir,
+                              apr_off_t);
+
+  /* Close up shop and cache the array. */
+  SVN_ERR(svn_stream_close(manifest_stream));
+  return svn_cache__set(ffd->packed_offset_cache, &shard, manifest, pool);
+}
+
+/* Packing logic for physical addresssing mode:
+ * Simply concatenate all revision contents.
+ *
+ * Pack the revision shard starting at SHARD_REV containing exactly
+ * MAX_FILES_PER_DIR revisions from SHARD_PATH into the PACK_FILE_DIR,
+ * using POOL for allocations.  The caller is responsible for flushing
+ * the result to disk and for making the manifest file read-only.
+ * CANCEL_FUNC and CANCEL_BATON are what you think they are.
+ */
+static svn_error_t *
+pack_phys_addressed(const char *pack_file_dir,
+                    const char *shard_path,
+                    svn_revnum_t start_rev,
+                    int max_files_per_dir,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *pool)
+{
+  const char *pack_file_path, *manifest_file_path;
+  apr_file_t *pack_file;
+  apr_file_t *manifest_file;
+  svn_stream_t *manifest_stream;
+  svn_revnum_t end_rev, rev;
+  apr_pool_t *iterpool;
+
+  /* Some useful paths. */
+  pack_file_path = svn_dirent_join(pack_file_dir, PATH_PACKED, pool);
+  manifest_file_path = svn_dirent_join(pack_file_dir, PATH_MANIFEST, pool);
+
+  /* Create the new directory and pack file.
+   * Use unbuffered apr_file_t since we're going to write using 16kb
+   * chunks. */
+  SVN_ERR(svn_io_file_open(&pack_file, pack_file_path,
+                           APR_WRITE | APR_CREATE | APR_EXCL,
+                           APR_OS_DEFAULT, pool));
+
+  /* Create the manifest file. */
+  SVN_ERR(svn_io_file_open(&manifest_file, manifest_file_path,
+                           APR_WRITE | APR_BUFFERED | APR_CREATE | APR_EXCL,
+                           APR_OS_DEFAULT, pool));
+  manifest_stream = svn_stream_from_aprfile2(manifest_file, TRUE, pool);
+
+  end_rev = start_rev + max_files_per_dir - 1;
+  iterpool = svn_pool_create(pool);
+
+  /* Iterate over the revisions in this shard, squashing them together. */
+  for (rev = start_rev; rev <= end_rev; rev++)
+    {
+      svn_stream_t *rev_stream;
+      const char *path;
+      apr_off_t offset;
+      apr_file_t *rev_file;
+
+      svn_pool_clear(iterpool);
+
+      path = svn_dirent_join(shard_path, apr_psprintf(iterpool, "%ld", rev),
+                             iterpool);
+
+      /* Obtain current offset in pack file. */
+      SVN_ERR(svn_io_file_get_offset(&offset, pack_file, iterpool));
+
+      /* build manifest */
+      SVN_ERR(svn_stream_printf(manifest_stream, iterpool,
+                                "%" APR_OFF_T_FMT "\n", offset));
 
       /* Copy all the bits from the rev file to the end of the pack file.
        * Use unbuffered apr_file_t since we're going to write using 16kb
@@ -1778,18 +2764,7 @@ pack_phys_addressed(const char *pack_file_dir,
 
   /* Close stream over APR file. */
   SVN_ERR(svn_stream_close(manifest_stream));
-
-  /* Ensure that pack file is written to disk. */
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(manifest_file, pool));
   SVN_ERR(svn_io_file_close(manifest_file, pool));
-
-  /* disallow write access to the manifest file */
-  SVN_ERR(svn_io_set_file_read_only(manifest_file_path, FALSE, iterpool));
-
-  /* Ensure that pack file is written to disk. */
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(pack_file, pool));
   SVN_ERR(svn_io_file_close(pack_file, pool));
 
   svn_pool_destroy(iterpool);
@@ -1821,13 +2796,20 @@ pack_rev_shard(svn_fs_t *fs,
                void *cancel_baton,
                apr_pool_t *pool)
 {
-  const char *pack_file_path;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *pack_file_path, *manifest_file_path;
+  svn_fs_fs__batch_fsync_t *batch;
+  apr_file_t *file;
   svn_revnum_t shard_rev = (svn_revnum_t) (shard * max_files_per_dir);
 
   /* Some useful paths. */
   pack_file_path = svn_dirent_join(pack_file_dir, PATH_PACKED, pool);
+  manifest_file_path = svn_dirent_join(pack_file_dir, PATH_MANIFEST, pool);
 
   /* Remove any existing pack file for this shard, since it is incomplete. */
+  SVN_ERR(svn_fs_fs__forget_cached_handles(fs, shard_rev,
+                                           shard_rev + max_files_per_dir,
+                                           pool));
   SVN_ERR(svn_io_remove_dir2(pack_file_dir, TRUE, cancel_func, cancel_baton,
                              pool));
 
@@ -1837,16 +2819,46 @@ pack_rev_shard(svn_fs_t *fs,
   /* Index information files */
   if (svn_fs_fs__use_log_addressing(fs))
     SVN_ERR(pack_log_addressed(fs, pack_file_dir, shard_path,
-                               shard_rev, max_mem, flush_to_disk,
+                               shard_rev, max_mem,
                                cancel_func, cancel_baton, pool));
   else
     SVN_ERR(pack_phys_addressed(pack_file_dir, shard_path, shard_rev,
-                                max_files_per_dir, flush_to_disk,
+                                max_files_per_dir,
                                 cancel_func, cancel_baton, pool));
 
+  /* The changed paths index must be written while readers still see the
+     shard as non-packed, i.e. before it becomes visible to them. */
+  if (ffd->changed_paths_index)
+    SVN_ERR(svn_fs_fs__write_changed_paths_index(fs, pack_file_dir,
+                                                 shard_rev,
+                                                 max_files_per_dir,
+                                                 cancel_func, cancel_baton,
+                                                 pool));
+
+  /* Ensure that the pack file, the manifest and their directory entries
+     are written to disk.  Issue all fsyncs at once. */
+  SVN_ERR(svn_fs_fs__batch_fsync_create(&batch, flush_to_disk, pool));
+  SVN_ERR(svn_fs_fs__batch_fsync_open_file(&file, batch, pack_file_path,
+                                           pool));
+  SVN_ERR(svn_fs_fs__batch_fsync_new_path(batch, pack_file_path, pool));
+  SVN_ERR(svn_fs_fs__batch_fsync_new_path(batch, pack_file_dir, pool));
+  if (!svn_fs_fs__use_log_addressing(fs))
+    SVN_ERR(svn_fs_fs__batch_fsync_open_file(&file, batch,
+                                             manifest_file_path, pool));
+  if (ffd->changed_paths_index)
+    SVN_ERR(svn_fs_fs__batch_fsync_open_file(&file, batch,
+                              svn_dirent_join(pack_file_dir,
+                                              PATH_CHANGED_PATHS, pool),
+                              pool));
+  SVN_ERR(svn_fs_fs__batch_fsync_run(batch, pool));
+
   SVN_ERR(svn_io_copy_perms(shard_path, pack_file_dir, pool));
   SVN_ERR(svn_io_set_file_read_only(pack_file_path, FALSE, pool));
 
+  /* disallow write access to the manifest file */
+  if (!svn_fs_fs__use_log_addressing(fs))
+    SVN_ERR(svn_io_set_file_read_only(manifest_file_path, FALSE, pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -1863,6 +2875,9 @@ struct pack_baton
   void *cancel_baton;
   size_t max_mem;
 
+  /* Number of shards that may be packed concurrently. */
+  int jobs;
+
   /* Additional entries valid when entering pack_shard(). */
   const char *revs_dir;
   const char *revsprops_dir;
@@ -1891,6 +2906,8 @@ synced_pack_shard(void *baton,
   if (pb->revsprops_dir)
     {
       apr_int64_t pack_size_limit = 0.9 * ffd->revprop_pack_size;
+      svn_boolean_t indexed
+        = ffd->format >= SVN_FS_FS__MIN_INDEXED_REVPROP_PACK_FORMAT;
 
       revprops_pack_file_dir = svn_dirent_join(pb->revsprops_dir,
                    apr_psprintf(pool,
@@ -1909,6 +2926,7 @@ synced_pack_shard(void *baton,
                                              ffd->compress_packed_revprops
                                                ? SVN__COMPRESSION_ZLIB_DEFAULT
                                                : SVN__COMPRESSION_NONE,
+                                             indexed,
                                              ffd->flush_to_disk,
                                              pb->cancel_func,
                                              pb->cancel_baton,
@@ -1925,6 +2943,10 @@ synced_pack_shard(void *baton,
   /* Finally, remove the existing shard directories.
    * For revprops, clean up older obsolete shards as well as they might
    * have been left over from an interrupted FS upgrade. */
+  SVN_ERR(svn_fs_fs__forget_cached_handles(pb->fs,
+                    (svn_revnum_t)(pb->shard * ffd->max_files_per_dir),
+                    (svn_revnum_t)((pb->shard + 1) * ffd->max_files_per_dir),
+                    pool));
   SVN_ERR(svn_io_remove_dir2(pb->rev_shard_path, TRUE,
                              pb->cancel_func, pb->cancel_baton, pool));
   if (pb->revsprops_dir)
@@ -1954,6 +2976,33 @@ synced_pack_shard(void *baton,
   return SVN_NO_ERROR;
 }
 
+/* Make the packed revision data of the shard described by BATON
+ * available to readers and notify the caller.  Use POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+switch_to_packed_shard(struct pack_baton *baton,
+                       apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+
+  /* For newer repo formats, we only acquired the pack lock so far.
+     Before modifying the repo state by switching over to the packed
+     data, we need to acquire the global (write) lock. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
+    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
+                                       pool));
+  else
+    SVN_ERR(synced_pack_shard(baton, pool));
+
+  /* Notify caller we're done packing this shard. */
+  if (baton->notify_func)
+    SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
+                               svn_fs_pack_notify_end, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Pack the shard described by BATON.
  *
  * If for some reason we detect a partial packing already performed,
@@ -1989,23 +3038,119 @@ pack_shard(struct pack_baton *baton,
                          baton->max_mem, ffd->flush_to_disk,
                          baton->cancel_func, baton->cancel_baton, pool));
 
-  /* For newer repo formats, we only acquired the pack lock so far.
-     Before modifying the repo state by switching over to the packed
-     data, we need to acquire the global (write) lock. */
-  if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
-    SVN_ERR(svn_fs_fs__with_write_lock(baton->fs, synced_pack_shard, baton,
-                                       pool));
-  else
-    SVN_ERR(synced_pack_shard(baton, pool));
+  return svn_error_trace(switch_to_packed_shard(baton, pool));
+}
 
-  /* Notify caller we're starting to pack this shard. */
-  if (baton->notify_func)
-    SVN_ERR(baton->notify_func(baton->notify_baton, baton->shard,
-                               svn_fs_pack_notify_end, pool));
+/* A shard being packed by a job in pack_shards_concurrently(). */
+typedef struct pack_job_t
+{
+  /* All shared parameters of this pack run. */
+  struct pack_baton *pb;
 
-  return SVN_NO_ERROR;
+  /* The shard to pack. */
+  apr_int64_t shard;
+
+  /* Share of the pack run's memory limit to use for this shard. */
+  apr_size_t max_mem;
+
+  /* Path of the shard's revision files, allocated in the job's pool. */
+  const char *rev_shard_path;
+} pack_job_t;
+
+/* Implements svn_fs_fs__job_func_t, packing the revision data of the
+   pack_job_t in BATON from FS. */
+static svn_error_t *
+pack_job_func(void *baton,
+              svn_fs_t *fs,
+              apr_pool_t *pool)
+{
+  pack_job_t *job = baton;
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *rev_pack_file_dir
+    = svn_dirent_join(job->pb->revs_dir,
+                      apr_psprintf(pool,
+                                   "%" APR_INT64_T_FMT PATH_EXT_PACKED_SHARD,
+                                   job->shard),
+                      pool);
+
+  job->rev_shard_path
+    = svn_dirent_join(job->pb->revs_dir,
+                      apr_psprintf(pool, "%" APR_INT64_T_FMT, job->shard),
+                      pool);
+
+  return svn_error_trace(pack_rev_shard(fs, rev_pack_file_dir,
+                                        job->rev_shard_path, job->shard,
+                                        ffd->max_files_per_dir, job->max_mem,
+                                        ffd->flush_to_disk,
+                                        job->pb->cancel_func,
+                                        job->pb->cancel_baton, pool));
+}
+
+/* Pack the shards from PB->SHARD up to but not including COMPLETED_SHARDS
+   with up to PB->JOBS shards being packed at the same time.  Only the
+   revision data gets packed concurrently.  Switching over to the packed
+   shards happens in the calling thread and in shard order, such that
+   readers and the min-unpacked-rev will see the same sequence of states
+   as with a sequential pack.  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+pack_shards_concurrently(struct pack_baton *pb,
+                         apr_int64_t completed_shards,
+                         apr_pool_t *pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_size_t max_mem = pb->max_mem / pb->jobs;
+  apr_int64_t next_shard = pb->shard;
+  svn_fs_fs__job_ring_t *ring
+    = svn_fs_fs__job_ring_create(pb->fs, pb->jobs, sizeof(pack_job_t),
+                                 pack_job_func, pool);
+
+  for (; pb->shard < completed_shards && !err; pb->shard++)
+    {
+      pack_job_t *job;
+      svn_pool_clear(iterpool);
+
+      /* Keep up to PB->JOBS shards in flight. */
+      for (; !svn_fs_fs__job_ring_is_full(ring)
+             && next_shard < completed_shards;
+           ++next_shard)
+        {
+          pack_job_t new_job = { 0 };
+          new_job.pb = pb;
+          new_job.shard = next_shard;
+          new_job.max_mem = max_mem;
+          svn_fs_fs__job_ring_push(ring, &new_job);
+        }
+
+      /* Report the shards one at a time and in order. */
+      if (pb->notify_func)
+        err = pb->notify_func(pb->notify_baton, pb->shard,
+                              svn_fs_pack_notify_start, iterpool);
+
+      if (!err)
+        err = svn_fs_fs__job_ring_wait((void **)&job, ring);
+      if (!err)
+        {
+          pb->rev_shard_path = apr_pstrdup(iterpool, job->rev_shard_path);
+          err = switch_to_packed_shard(pb, iterpool);
+        }
+
+      svn_fs_fs__job_ring_pop(ring);
+
+      if (!err && pb->cancel_func)
+        err = pb->cancel_func(pb->cancel_baton);
+    }
+
+  /* Don't leave any workers behind.  Their shards will be packed again
+     by the next run. */
+  svn_fs_fs__job_ring_clear(ring);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
 }
 
+
 /* Read the youngest rev and the first non-packed rev info for FS from disk.
    Set *FULLY_PACKED when there is no completed unpacked shard.
    Use SCRATCH_POOL for temporary allocations.
@@ -2077,10 +3222,14 @@ pack_body(void *baton,
     pb->revsprops_dir = svn_dirent_join(pb->fs->path, PATH_REVPROPS_DIR,
                                         pool);
 
+  pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
+
+  if (pb->jobs > 1)
+    return svn_error_trace(pack_shards_concurrently(pb, completed_shards,
+                                                    pool));
+
   iterpool = svn_pool_create(pool);
-  for (pb->shard = ffd->min_unpacked_rev / ffd->max_files_per_dir;
-       pb->shard < completed_shards;
-       pb->shard++)
+  for (; pb->shard < completed_shards; pb->shard++)
     {
       svn_pool_clear(iterpool);
 
@@ -2107,6 +3256,7 @@ svn_fs_fs__pack(svn_fs_t *fs,
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_error_t *err;
   svn_boolean_t fully_packed;
+  const char *jobs;
 
   /* If the repository isn't a new enough format, we don't support packing.
      Return a friendly error to that effect. */
@@ -2143,6 +3293,16 @@ svn_fs_fs__pack(svn_fs_t *fs,
   pb.cancel_func = cancel_func;
   pb.cancel_baton = cancel_baton;
   pb.max_mem = max_mem ? max_mem : DEFAULT_MAX_MEM;
+  pb.jobs = 1;
+
+  jobs = fs->config ? svn_hash_gets(fs->config, SVN_FS_CONFIG_FSFS_PACK_JOBS)
+                    : NULL;
+  if (jobs)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, jobs, 0, MAX_PACK_JOBS, 10));
+      pb.jobs = MAX(1, (int)val);
+    }
 
   if (ffd->format >= SVN_FS_FS__MIN_PACK_LOCK_FORMAT)
     {
@@ -2163,3 +3323,93 @@ svn_fs_fs__pack(svn_fs_t *fs,
 
   return svn_error_trace(err);
 }
+
+#if APR_HAS_THREADS
+
+/* Implements svn_cancel_func_t.  Background packs never get cancelled
+ * but we use the regular callbacks to give way to other threads.
+ */
+static svn_error_t *
+background_pack_yield(void *baton)
+{
+  apr_thread_yield();
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_atomic__init_once callback.  Create the background pack
+ * thread pool for the fs_fs_shared_data_t in BATON.  POOL is unused.
+ */
+static svn_error_t *
+create_background_packer(void *baton,
+                         apr_pool_t *pool)
+{
+  fs_fs_shared_data_t *shared = baton;
+
+  return svn_error_trace(svn_fs_fs__create_background_threads(
+                           &shared->background_packer, NULL,
+                           _("Can't create background pack thread")));
+}
+
+/* Implements svn_fs_fs__background_func_t.  Pack FS, which belongs to
+ * the fs_fs_shared_data_t in BATON.
+ */
+static void
+background_pack_worker(void *baton,
+                       svn_fs_t *fs,
+                       apr_pool_t *pool)
+{
+  fs_fs_shared_data_t *shared = *(fs_fs_shared_data_t **)baton;
+
+  /* Failures are not fatal.  Any unpacked shards will simply be packed
+   * next time. */
+  svn_error_clear(svn_fs_fs__pack(fs, 0, NULL, NULL,
+                                  background_pack_yield, NULL, pool));
+
+  svn_atomic_set(&shared->background_pack_pending, 0);
+}
+
+#endif
+
+svn_error_t *
+svn_fs_fs__schedule_background_pack(svn_fs_t *fs,
+                                    svn_revnum_t new_rev,
+                                    apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
+
+  /* Only the completion of a shard creates new work. */
+  if (   !ffd->background_pack
+      || !ffd->max_files_per_dir
+      || (new_rev + 1) % ffd->max_files_per_dir)
+    return SVN_NO_ERROR;
+
+  /* A background pack would share our caches, which can only be used by
+   * one thread at a time.  Pack right away instead. */
+  if (svn_cache_config_get()->single_threaded)
+    return svn_error_trace(svn_fs_fs__pack(fs, 0, NULL, NULL, NULL, NULL,
+                                           scratch_pool));
+
+  SVN_ERR(svn_atomic__init_once(&ffd->shared->background_packer_initialized,
+                                create_background_packer, ffd->shared,
+                                NULL));
+
+  /* A pending pack will cover all complete shards. */
+  if (svn_atomic_cas(&ffd->shared->background_pack_pending, 1, 0) != 0)
+    return SVN_NO_ERROR;
+
+  err = svn_fs_fs__start_background_job(ffd->shared->background_packer, fs,
+                                        background_pack_worker,
+                                        &ffd->shared, sizeof(ffd->shared),
+                                        APR_THREAD_TASK_PRIORITY_LOWEST,
+                                        _("Can't queue background pack"),
+                                        scratch_pool);
+  if (err)
+    svn_atomic_set(&ffd->shared->background_pack_pending, 0);
+
+  return svn_error_trace(err);
+#else
+  return SVN_NO_ERROR;
+#endif
+}
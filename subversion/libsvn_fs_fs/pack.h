@@ -45,6 +45,19 @@ svn_fs_fs__pack(svn_fs_t *fs,
                 void *cancel_baton,
                 apr_pool_t *pool);
 
+/* If background packing has been enabled for FS and NEW_REV completes
+   a shard, queue a pack of FS on a low-priority background thread.  The
+   pack uses a private instance of FS and takes out the usual pack lock.
+   At most one background pack per repository will be queued or running
+   at any given time.  If the caches of this process are not thread-safe,
+   pack FS synchronously instead.  This is a no-op without thread support.
+
+   Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__schedule_background_pack(svn_fs_t *fs,
+                                    svn_revnum_t new_rev,
+                                    apr_pool_t *scratch_pool);
+
 /**
  * For the packed revision @a rev in @a fs,  determine the offset within
  * the revision pack file and return it in @a rev_offset.  Use @a pool for
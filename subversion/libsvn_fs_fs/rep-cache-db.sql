@@ -48,6 +48,17 @@ SELECT hash, revision, offset, size, expanded_size
 FROM rep_cache
 WHERE revision >= ?1 AND revision <= ?2
 
+-- STMT_GET_HASHES_AFTER_ROWID
+SELECT rowid, hash
+FROM rep_cache
+WHERE rowid > ?1
+ORDER BY rowid
+
+-- STMT_GET_HASH_BY_ROWID
+SELECT hash
+FROM rep_cache
+WHERE rowid = ?1
+
 -- STMT_GET_MAX_REV
 SELECT MAX(revision)
 FROM rep_cache
@@ -56,6 +67,29 @@ FROM rep_cache
 DELETE FROM rep_cache
 WHERE revision > ?1
 
+/* Similarity fingerprints of file representations, used to find delta
+   bases for new files.  Rows are keyed by content, i.e. they never become
+   invalid.  But they are only useful if there is a matching REP_CACHE row.
+   This table is optional and old clients simply ignore it. */
+-- STMT_CREATE_FINGERPRINT_SCHEMA
+CREATE TABLE IF NOT EXISTS rep_fingerprint (
+  fingerprint INTEGER NOT NULL,
+  hash TEXT NOT NULL,
+  PRIMARY KEY (fingerprint, hash)
+  );
+
+-- STMT_SET_REP_FINGERPRINT
+INSERT OR IGNORE INTO rep_fingerprint (fingerprint, hash)
+VALUES (?1, ?2)
+
+/* Limit the number of candidates for very common fingerprints. */
+-- STMT_GET_REPS_FOR_FINGERPRINT
+SELECT rep_cache.hash
+FROM rep_fingerprint JOIN rep_cache ON rep_fingerprint.hash = rep_cache.hash
+WHERE fingerprint = ?1
+ORDER BY revision DESC
+LIMIT 16
+
 /* An INSERT takes an SQLite reserved lock that prevents other writes
    but doesn't block reads.  The incomplete transaction means that no
    permanent change is made to the database and the transaction is
@@ -20,7 +20,10 @@
  * ====================================================================
  */
 
+#include <apr_strings.h>
+
 #include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "svn_private_config.h"
 
@@ -28,6 +31,7 @@
 #include "fs_fs.h"
 #include "fs.h"
 #include "rep-cache.h"
+#include "util.h"
 #include "../libsvn_fs/fs-loader.h"
 
 #include "svn_path.h"
@@ -111,6 +115,13 @@ open_rep_cache(void *baton,
                             sdb);
     }
 
+  /* The similarity index is optional and does not change the schema
+     version. */
+  if (ffd->similarity_deltification)
+    SVN_SQLITE__ERR_CLOSE(svn_sqlite__exec_statements(sdb,
+                                             STMT_CREATE_FINGERPRINT_SCHEMA),
+                          sdb);
+
   /* This is used as a flag that the database is available so don't
      set it earlier. */
   ffd->rep_cache_db = sdb;
@@ -256,6 +267,470 @@ svn_fs_fs__walk_rep_reference(svn_fs_t *fs,
 }
 
 
+/** The rep-cache filter. **/
+
+/* A Bloom filter over the SHA1 keys in rep-cache.db, allowing most
+ * lookups of unknown keys to skip the database query.  All members live
+ * in POOL.  A filter never reports false negatives for entries with a
+ * ROWID up to MAX_ROWID or for entries added through this process.
+ */
+struct svn_fs_fs__rep_cache_filter_t
+{
+  /* root pool of this filter */
+  apr_pool_t *pool;
+
+  /* the bit array and its length in bits, a multiple of 8 */
+  unsigned char *bits;
+  apr_uint64_t bit_count;
+
+  /* number of keys the filter has been sized for and has seen */
+  apr_int64_t capacity;
+  apr_int64_t key_count;
+
+  /* largest ROWID in rep-cache.db covered by the filter and the key in
+   * that row; 0 and NULL for an empty table */
+  apr_int64_t max_rowid;
+  const char *max_hash;
+
+  /* youngest revision at the time of the last catch-up */
+  svn_revnum_t youngest;
+
+  /* number of keys added since the filter file got written */
+  apr_int64_t unsaved;
+};
+
+/* Number of filter bits per rep-cache entry and bits to set per key.
+ * This results in a false positive rate of about 0.05%. */
+#define FILTER_BITS_PER_KEY 16
+#define FILTER_HASH_COUNT 8
+
+/* Minimum filter capacity in keys. */
+#define FILTER_MIN_CAPACITY 0x10000
+
+/* Rewrite the filter file after this many new keys. */
+#define FILTER_SAVE_THRESHOLD 0x1000
+
+/* Header line of the filter file. */
+#define FILTER_FILE_HEADER "REP-CACHE-FILTER 1\n"
+
+static APR_INLINE const char *
+path_rep_cache_filter(const char *fs_path,
+                      apr_pool_t *result_pool)
+{
+  return svn_dirent_join(fs_path, REP_CACHE_FILTER_NAME, result_pool);
+}
+
+/* Return the INDEX-th bit position for the SHA1 DIGEST in FILTER.
+ * SHA1 digests are uniformly distributed, so we simply use parts of
+ * them for double hashing. */
+static APR_INLINE apr_uint64_t
+filter_bit(const svn_fs_fs__rep_cache_filter_t *filter,
+           const unsigned char *digest,
+           int index)
+{
+  apr_uint64_t h1 = 0, h2 = 0;
+  int i;
+
+  for (i = 0; i < 8; ++i)
+    {
+      h1 = (h1 << 8) | digest[i];
+      h2 = (h2 << 8) | digest[i + 8];
+    }
+
+  return (h1 + (apr_uint64_t)index * (h2 | 1)) % filter->bit_count;
+}
+
+/* Add the SHA1 DIGEST to FILTER. */
+static void
+filter_add(svn_fs_fs__rep_cache_filter_t *filter,
+           const unsigned char *digest)
+{
+  int i;
+  for (i = 0; i < FILTER_HASH_COUNT; ++i)
+    {
+      apr_uint64_t bit = filter_bit(filter, digest, i);
+      filter->bits[bit / 8] |= (unsigned char)(1 << (bit % 8));
+    }
+
+  ++filter->key_count;
+  ++filter->unsaved;
+}
+
+/* Return TRUE if the SHA1 DIGEST may have been added to FILTER. */
+static svn_boolean_t
+filter_may_contain(const svn_fs_fs__rep_cache_filter_t *filter,
+                   const unsigned char *digest)
+{
+  int i;
+  for (i = 0; i < FILTER_HASH_COUNT; ++i)
+    {
+      apr_uint64_t bit = filter_bit(filter, digest, i);
+      if ((filter->bits[bit / 8] & (1 << (bit % 8))) == 0)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Return a new, empty filter for CAPACITY keys. */
+static svn_fs_fs__rep_cache_filter_t *
+filter_create(apr_int64_t capacity)
+{
+  apr_pool_t *pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  svn_fs_fs__rep_cache_filter_t *filter = apr_pcalloc(pool, sizeof(*filter));
+
+  filter->pool = pool;
+  filter->capacity = MAX(capacity, FILTER_MIN_CAPACITY);
+  filter->bit_count = (apr_uint64_t)filter->capacity * FILTER_BITS_PER_KEY;
+  filter->bits = apr_pcalloc(pool, (apr_size_t)(filter->bit_count / 8));
+  filter->youngest = SVN_INVALID_REVNUM;
+
+  return filter;
+}
+
+/* Add all keys in FS' rep-cache.db with a ROWID larger than
+ * FILTER->MAX_ROWID to FILTER.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+filter_catch_up(svn_fs_fs__rep_cache_filter_t *filter,
+                svn_fs_t *fs,
+                apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  const char *hash = NULL;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                    STMT_GET_HASHES_AFTER_ROWID));
+  SVN_ERR(svn_sqlite__bindf(stmt, "L", filter->max_rowid));
+
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      svn_checksum_t *checksum;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+      filter->max_rowid = svn_sqlite__column_int64(stmt, 0);
+      hash = svn_sqlite__column_text(stmt, 1, iterpool);
+
+      err = svn_checksum_parse_hex(&checksum, svn_checksum_sha1, hash,
+                                   iterpool);
+      if (err)
+        return svn_error_compose_create(err, svn_sqlite__reset(stmt));
+      filter_add(filter, checksum->digest);
+
+      err = svn_sqlite__step(&have_row, stmt);
+      if (err)
+        return svn_error_compose_create(err, svn_sqlite__reset(stmt));
+
+      /* Remember the last key before ITERPOOL gets cleared. */
+      if (!have_row)
+        filter->max_hash = apr_pstrdup(filter->pool, hash);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* Write FILTER to the filter file of FS.  Failures to do so are not
+ * fatal, so ignore them.  Use SCRATCH_POOL for temporaries. */
+static void
+filter_save(svn_fs_fs__rep_cache_filter_t *filter,
+            svn_fs_t *fs,
+            apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buffer
+    = svn_stringbuf_createf(scratch_pool,
+                            FILTER_FILE_HEADER
+                            "%" APR_INT64_T_FMT " %" APR_INT64_T_FMT
+                            " %" APR_INT64_T_FMT " %s\n",
+                            filter->capacity, filter->key_count,
+                            filter->max_rowid,
+                            filter->max_hash ? filter->max_hash : "-");
+  svn_stringbuf_appendbytes(buffer, (const char *)filter->bits,
+                            (apr_size_t)(filter->bit_count / 8));
+
+  svn_error_clear(svn_io_write_atomic2(path_rep_cache_filter(fs->path,
+                                                             scratch_pool),
+                                       buffer->data, buffer->len,
+                                       path_rep_cache_db(fs->path,
+                                                         scratch_pool),
+                                       FALSE, scratch_pool));
+  filter->unsaved = 0;
+}
+
+/* Try to read the filter file of FS and return its contents in *FILTER.
+ * Set *FILTER to NULL if the file does not exist or does not match the
+ * current contents of rep-cache.db.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+filter_load(svn_fs_fs__rep_cache_filter_t **filter,
+            svn_fs_t *fs,
+            apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__rep_cache_filter_t *result;
+  svn_stringbuf_t *contents;
+  apr_int64_t capacity, key_count, max_rowid;
+  apr_array_header_t *fields;
+  const char *line, *bits, *hash;
+  svn_error_t *err;
+
+  *filter = NULL;
+
+  err = svn_stringbuf_from_file2(&contents,
+                                 path_rep_cache_filter(fs->path,
+                                                       scratch_pool),
+                                 scratch_pool);
+  if (err)
+    {
+      /* Missing or unreadable filter files simply get rebuilt. */
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  /* Parse the header and check it matches the file size. */
+  if (strncmp(contents->data, FILTER_FILE_HEADER,
+              sizeof(FILTER_FILE_HEADER) - 1))
+    return SVN_NO_ERROR;
+
+  line = contents->data + sizeof(FILTER_FILE_HEADER) - 1;
+  bits = strchr(line, '\n');
+  if (!bits)
+    return SVN_NO_ERROR;
+
+  fields = svn_cstring_split(apr_pstrmemdup(scratch_pool, line, bits - line),
+                             " ", TRUE, scratch_pool);
+  if (fields->nelts != 4)
+    return SVN_NO_ERROR;
+
+  err = svn_cstring_atoi64(&capacity, APR_ARRAY_IDX(fields, 0, const char *));
+  if (!err)
+    err = svn_cstring_atoi64(&key_count,
+                             APR_ARRAY_IDX(fields, 1, const char *));
+  if (!err)
+    err = svn_cstring_atoi64(&max_rowid,
+                             APR_ARRAY_IDX(fields, 2, const char *));
+  if (err)
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  hash = APR_ARRAY_IDX(fields, 3, const char *);
+  if (   capacity < FILTER_MIN_CAPACITY
+      || (apr_uint64_t)(contents->data + contents->len - bits - 1)
+           != (apr_uint64_t)capacity * FILTER_BITS_PER_KEY / 8)
+    return SVN_NO_ERROR;
+
+  /* The row at MAX_ROWID must still be the same.  Otherwise, the
+   * rep-cache has been replaced or truncated since. */
+  if (max_rowid)
+    {
+      svn_sqlite__stmt_t *stmt;
+      svn_boolean_t have_row;
+      svn_boolean_t match;
+
+      SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                        STMT_GET_HASH_BY_ROWID));
+      SVN_ERR(svn_sqlite__bindf(stmt, "L", max_rowid));
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+      match = have_row
+           && !strcmp(svn_sqlite__column_text(stmt, 0, NULL), hash);
+      SVN_ERR(svn_sqlite__reset(stmt));
+
+      if (!match)
+        return SVN_NO_ERROR;
+    }
+
+  result = filter_create(capacity);
+  memcpy(result->bits, bits + 1, (apr_size_t)(result->bit_count / 8));
+  result->key_count = key_count;
+  result->max_rowid = max_rowid;
+  result->max_hash = max_rowid ? apr_pstrdup(result->pool, hash) : NULL;
+
+  *filter = result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Make sure that FS' shared filter exists, covers rep-cache.db as of
+ * FS' youngest revision and is not overloaded.  The caller must hold
+ * the filter lock.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+filter_update(svn_fs_t *fs,
+              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__rep_cache_filter_t *filter = ffd->shared->rep_cache_filter;
+  svn_error_t *err;
+
+  if (filter && filter->youngest == ffd->youngest_rev_cache)
+    return SVN_NO_ERROR;
+
+  if (!filter)
+    {
+      SVN_ERR(filter_load(&filter, fs, scratch_pool));
+      if (!filter)
+        filter = filter_create(FILTER_MIN_CAPACITY);
+    }
+
+  err = filter_catch_up(filter, fs, scratch_pool);
+
+  /* Once overloaded, the filter would become useless.  Rebuild it with
+   * plenty of room for growth. */
+  if (!err && filter->key_count > filter->capacity)
+    {
+      apr_int64_t capacity = 2 * filter->key_count;
+
+      svn_pool_destroy(filter->pool);
+      filter = filter_create(capacity);
+      err = filter_catch_up(filter, fs, scratch_pool);
+    }
+
+  if (err)
+    {
+      svn_pool_destroy(filter->pool);
+      ffd->shared->rep_cache_filter = NULL;
+
+      return svn_error_trace(err);
+    }
+
+  filter->youngest = ffd->youngest_rev_cache;
+  if (filter->unsaved >= FILTER_SAVE_THRESHOLD)
+    filter_save(filter, fs, scratch_pool);
+
+  ffd->shared->rep_cache_filter = filter;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_atomic__init_once callback.  Create the filter lock for
+ * the fs_fs_shared_data_t in BATON.  POOL is unused. */
+static svn_error_t *
+create_filter_lock(void *baton,
+                   apr_pool_t *pool)
+{
+  fs_fs_shared_data_t *shared = baton;
+  return svn_error_trace(svn_mutex__init(&shared->rep_cache_filter_lock,
+                                         TRUE, shared->common_pool));
+}
+
+/* Baton type for filter_check_body. */
+typedef struct filter_check_baton_t
+{
+  svn_boolean_t *may_exist;
+  svn_fs_t *fs;
+  const unsigned char *digest;
+  apr_pool_t *scratch_pool;
+} filter_check_baton_t;
+
+/* Body of filter_check, called with the filter lock held. */
+static svn_error_t *
+filter_check_body(filter_check_baton_t *baton)
+{
+  fs_fs_data_t *ffd = baton->fs->fsap_data;
+
+  SVN_ERR(filter_update(baton->fs, baton->scratch_pool));
+  *baton->may_exist
+    = filter_may_contain(ffd->shared->rep_cache_filter, baton->digest);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *MAY_EXIST to FALSE if FS' rep-cache definitely has no entry for
+ * the SHA1 DIGEST.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+filter_check(svn_boolean_t *may_exist,
+             svn_fs_t *fs,
+             const unsigned char *digest,
+             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  filter_check_baton_t baton;
+
+  *may_exist = TRUE;
+  if (!ffd->rep_cache_filter)
+    return SVN_NO_ERROR;
+
+  baton.may_exist = may_exist;
+  baton.fs = fs;
+  baton.digest = digest;
+  baton.scratch_pool = scratch_pool;
+
+  SVN_ERR(svn_atomic__init_once(&ffd->shared->rep_cache_filter_initialized,
+                                create_filter_lock, ffd->shared, NULL));
+  SVN_MUTEX__WITH_LOCK(ffd->shared->rep_cache_filter_lock,
+                       filter_check_body(&baton));
+
+  return SVN_NO_ERROR;
+}
+
+/* Body of filter_record. */
+static svn_error_t *
+filter_record_body(fs_fs_shared_data_t *shared,
+                   const unsigned char *digest)
+{
+  if (shared->rep_cache_filter)
+    filter_add(shared->rep_cache_filter, digest);
+
+  return SVN_NO_ERROR;
+}
+
+/* Add the SHA1 DIGEST, just written to FS' rep-cache, to the filter. */
+static svn_error_t *
+filter_record(svn_fs_t *fs,
+              const unsigned char *digest)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (!ffd->rep_cache_filter)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&ffd->shared->rep_cache_filter_initialized,
+                                create_filter_lock, ffd->shared, NULL));
+  SVN_MUTEX__WITH_LOCK(ffd->shared->rep_cache_filter_lock,
+                       filter_record_body(ffd->shared, digest));
+
+  return SVN_NO_ERROR;
+}
+
+/* Body of filter_reset. */
+static svn_error_t *
+filter_reset_body(svn_fs_t *fs,
+                  apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->shared->rep_cache_filter)
+    svn_pool_destroy(ffd->shared->rep_cache_filter->pool);
+  ffd->shared->rep_cache_filter = NULL;
+
+  return svn_error_trace(svn_io_remove_file2(
+                           path_rep_cache_filter(fs->path, scratch_pool),
+                           TRUE, scratch_pool));
+}
+
+/* Drop the rep-cache filter of FS after entries got removed from its
+ * rep-cache.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+filter_reset(svn_fs_t *fs,
+             apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  SVN_ERR(svn_atomic__init_once(&ffd->shared->rep_cache_filter_initialized,
+                                create_filter_lock, ffd->shared, NULL));
+  SVN_MUTEX__WITH_LOCK(ffd->shared->rep_cache_filter_lock,
+                       filter_reset_body(fs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* This function's caller ignores most errors it returns.
    If you extend this function, check the callsite to see if you have
    to make it not-ignore additional error codes.  */
@@ -268,6 +743,7 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+  svn_boolean_t may_exist;
   representation_t *rep;
 
   SVN_ERR_ASSERT(ffd->rep_sharing_allowed);
@@ -280,6 +756,26 @@ svn_fs_fs__get_rep_reference(representation_t **rep_p,
                             _("Only SHA1 checksums can be used as keys in the "
                               "rep_cache table.\n"));
 
+  /* Entries held back in bulk load mode are not in the database, yet. */
+  if (ffd->deferred_reps)
+    {
+      rep = apr_hash_get(ffd->deferred_reps, checksum->digest,
+                         APR_SHA1_DIGESTSIZE);
+      if (rep)
+        {
+          *rep_p = svn_fs_fs__rep_copy(rep, pool);
+          return SVN_NO_ERROR;
+        }
+    }
+
+  /* Most misses don't need to query the database. */
+  SVN_ERR(filter_check(&may_exist, fs, checksum->digest, pool));
+  if (!may_exist)
+    {
+      *rep_p = NULL;
+      return SVN_NO_ERROR;
+    }
+
   SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db, STMT_GET_REP));
   SVN_ERR(svn_sqlite__bindf(stmt, "s",
                             svn_checksum_to_cstring(checksum, pool)));
@@ -351,7 +847,9 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
                             (apr_int64_t) rep->expanded_size));
 
   err = svn_sqlite__insert(NULL, stmt);
-  if (err)
+  if (!err)
+    SVN_ERR(filter_record(fs, rep->sha1_digest));
+  else
     {
       representation_t *old_rep;
 
@@ -376,6 +874,450 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__set_rep_references(svn_fs_t *fs,
+                              const apr_array_header_t *reps,
+                              apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *iterpool;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  if (! ffd->rep_cache_db)
+    SVN_ERR(svn_fs_fs__open_rep_cache(fs, scratch_pool));
+
+  /* We use an sqlite transaction to speed things up;
+   * see <http://www.sqlite.org/faq.html#q19>.
+   */
+  SVN_ERR(svn_sqlite__begin_transaction(ffd->rep_cache_db));
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < reps->nelts && !err; i++)
+    {
+      representation_t *rep = APR_ARRAY_IDX(reps, i, representation_t *);
+
+      svn_pool_clear(iterpool);
+      err = svn_fs_fs__set_rep_reference(fs, rep, iterpool);
+    }
+  svn_pool_destroy(iterpool);
+
+  err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
+  if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
+    {
+      /* Failed rollback means that our db connection is unusable, and
+         the only thing we can do is close it.  The connection will be
+         reopened during the next operation with rep-cache.db. */
+      return svn_error_trace(
+          svn_error_compose_create(err, svn_fs_fs__close_rep_cache(fs)));
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Maximum number of queued entries to write within a single SQLite
+ * transaction.  This limits the time other rep-cache writers may have
+ * to wait for us. */
+#define REP_CACHE_BATCH_SIZE 1000
+
+/* Write all of QUEUE (representation_t *) to FS in batches of at most
+ * REP_CACHE_BATCH_SIZE entries.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+write_rep_cache_queue(svn_fs_t *fs,
+                      const apr_array_header_t *queue,
+                      apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *batch
+    = apr_array_make(scratch_pool, REP_CACHE_BATCH_SIZE,
+                     sizeof(representation_t *));
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i, k;
+
+  for (i = 0; i < queue->nelts; i += REP_CACHE_BATCH_SIZE)
+    {
+      svn_pool_clear(iterpool);
+      apr_array_clear(batch);
+
+      for (k = i; k < queue->nelts && k < i + REP_CACHE_BATCH_SIZE; ++k)
+        APR_ARRAY_PUSH(batch, representation_t *)
+          = APR_ARRAY_IDX(queue, k, representation_t *);
+
+      SVN_ERR(svn_fs_fs__set_rep_references(fs, batch, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Maximum number of new rep-cache entries to hold back in bulk load mode
+ * before writing them anyway.  This limits the memory they use. */
+#define MAX_DEFERRED_REPS 100000
+
+/* Add copies of all REPS (representation_t *) to the rep-cache entries
+ * held back by FS.  Entries for already known SHA1 digests are ignored,
+ * just as the database would ignore them.  Write them all once there are
+ * more than MAX_DEFERRED_REPS.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+defer_rep_references(svn_fs_t *fs,
+                     const apr_array_header_t *reps,
+                     apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  int i;
+
+  if (ffd->deferred_reps == NULL)
+    {
+      ffd->deferred_reps_pool = svn_pool_create(fs->pool);
+      ffd->deferred_reps = apr_hash_make(ffd->deferred_reps_pool);
+    }
+
+  for (i = 0; i < reps->nelts; ++i)
+    {
+      representation_t *rep = APR_ARRAY_IDX(reps, i, representation_t *);
+
+      if (!apr_hash_get(ffd->deferred_reps, rep->sha1_digest,
+                        APR_SHA1_DIGESTSIZE))
+        {
+          rep = svn_fs_fs__rep_copy(rep, ffd->deferred_reps_pool);
+          apr_hash_set(ffd->deferred_reps, rep->sha1_digest,
+                       APR_SHA1_DIGESTSIZE, rep);
+        }
+    }
+
+  if (apr_hash_count(ffd->deferred_reps) > MAX_DEFERRED_REPS)
+    SVN_ERR(svn_fs_fs__write_deferred_rep_references(fs, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__write_deferred_rep_references(svn_fs_t *fs,
+                                         apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_array_header_t *reps;
+  apr_hash_index_t *hi;
+
+  if (ffd->deferred_reps == NULL)
+    return SVN_NO_ERROR;
+
+  reps = apr_array_make(scratch_pool, apr_hash_count(ffd->deferred_reps),
+                        sizeof(representation_t *));
+  for (hi = apr_hash_first(scratch_pool, ffd->deferred_reps);
+       hi;
+       hi = apr_hash_next(hi))
+    APR_ARRAY_PUSH(reps, representation_t *) = apr_hash_this_val(hi);
+
+  /* Keep the entries if we fail, so a later attempt may write them. */
+  SVN_ERR(write_rep_cache_queue(fs, reps, scratch_pool));
+
+  svn_pool_destroy(ffd->deferred_reps_pool);
+  ffd->deferred_reps = NULL;
+  ffd->deferred_reps_pool = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Implements svn_atomic__init_once callback.  Create the rep-cache
+ * writer thread pool and the queue lock for the fs_fs_shared_data_t in
+ * BATON.  POOL is unused.
+ */
+static svn_error_t *
+create_rep_cache_writer(void *baton,
+                        apr_pool_t *pool)
+{
+  fs_fs_shared_data_t *shared = baton;
+  apr_pool_t *writer_pool;
+
+  SVN_ERR(svn_fs_fs__create_background_threads(
+            &shared->rep_cache_writer, &writer_pool,
+            _("Can't create rep-cache writer thread")));
+
+  return svn_error_trace(svn_mutex__init(&shared->rep_cache_queue_lock,
+                                         TRUE, writer_pool));
+}
+
+/* Detach the current queue from SHARED and return it in *QUEUE and its
+ * root pool in *QUEUE_POOL.  If the queue is empty, set both to NULL and
+ * mark the writer as no longer pending.
+ */
+static svn_error_t *
+take_rep_cache_queue(apr_array_header_t **queue,
+                     apr_pool_t **queue_pool,
+                     fs_fs_shared_data_t *shared)
+{
+  *queue = shared->rep_cache_queue;
+  *queue_pool = shared->rep_cache_queue_pool;
+  shared->rep_cache_queue = NULL;
+  shared->rep_cache_queue_pool = NULL;
+
+  if (*queue == NULL)
+    svn_atomic_set(&shared->rep_cache_updates_pending, 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__background_func_t.  Write the rep-cache queue
+ * of FS, which belongs to the fs_fs_shared_data_t in BATON, until it is
+ * empty.
+ */
+static void
+rep_cache_writer_worker(void *baton,
+                        svn_fs_t *fs,
+                        apr_pool_t *pool)
+{
+  fs_fs_shared_data_t *shared = *(fs_fs_shared_data_t **)baton;
+
+  while (TRUE)
+    {
+      apr_array_header_t *queue;
+      apr_pool_t *queue_pool;
+      svn_error_t *err;
+
+      err = svn_mutex__lock(shared->rep_cache_queue_lock);
+      if (err)
+        {
+          /* Leave the queue to the next writer. */
+          svn_error_clear(err);
+          svn_atomic_set(&shared->rep_cache_updates_pending, 0);
+          break;
+        }
+
+      err = svn_mutex__unlock(shared->rep_cache_queue_lock,
+                              take_rep_cache_queue(&queue, &queue_pool,
+                                                   shared));
+      svn_error_clear(err);
+      if (queue == NULL)
+        break;
+
+      /* Failures are not fatal.  The rep-cache is merely an optimization
+       * and the affected representations simply won't get shared. */
+      svn_error_clear(write_rep_cache_queue(fs, queue, queue_pool));
+      svn_pool_destroy(queue_pool);
+    }
+}
+
+/* Append copies of all REPS (representation_t *) to SHARED's rep-cache
+ * queue.  Set *START_WRITER if no writer task is pending, in which case
+ * the caller must now create one.
+ */
+static svn_error_t *
+append_rep_cache_queue(svn_boolean_t *start_writer,
+                       fs_fs_shared_data_t *shared,
+                       const apr_array_header_t *reps)
+{
+  int i;
+
+  if (shared->rep_cache_queue == NULL)
+    {
+      shared->rep_cache_queue_pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+      shared->rep_cache_queue
+        = apr_array_make(shared->rep_cache_queue_pool, reps->nelts,
+                         sizeof(representation_t *));
+    }
+
+  for (i = 0; i < reps->nelts; ++i)
+    APR_ARRAY_PUSH(shared->rep_cache_queue, representation_t *)
+      = svn_fs_fs__rep_copy(APR_ARRAY_IDX(reps, i, representation_t *),
+                            shared->rep_cache_queue_pool);
+
+  *start_writer
+    = svn_atomic_cas(&shared->rep_cache_updates_pending, 1, 0) == 0;
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+svn_error_t *
+svn_fs_fs__queue_rep_references(svn_fs_t *fs,
+                                const apr_array_header_t *reps,
+                                apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+#if APR_HAS_THREADS
+  svn_boolean_t start_writer;
+  svn_error_t *err;
+
+  if (ffd->bulk_load)
+    return svn_error_trace(defer_rep_references(fs, reps, scratch_pool));
+
+  if (!ffd->async_rep_cache_updates)
+    return svn_error_trace(svn_fs_fs__set_rep_references(fs, reps,
+                                                         scratch_pool));
+
+  if (reps->nelts == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&ffd->shared->rep_cache_writer_initialized,
+                                create_rep_cache_writer, ffd->shared,
+                                NULL));
+
+  SVN_MUTEX__WITH_LOCK(ffd->shared->rep_cache_queue_lock,
+                       append_rep_cache_queue(&start_writer, ffd->shared,
+                                              reps));
+
+  /* A pending writer will pick up our entries as well. */
+  if (!start_writer)
+    return SVN_NO_ERROR;
+
+  err = svn_fs_fs__start_background_job(ffd->shared->rep_cache_writer, fs,
+                                        rep_cache_writer_worker,
+                                        &ffd->shared, sizeof(ffd->shared),
+                                        APR_THREAD_TASK_PRIORITY_NORMAL,
+                                        _("Can't queue rep-cache update"),
+                                        scratch_pool);
+
+  /* The entries remain queued for the next commit to pick up. */
+  if (err)
+    svn_atomic_set(&ffd->shared->rep_cache_updates_pending, 0);
+
+  return svn_error_trace(err);
+#else
+  if (ffd->bulk_load)
+    return svn_error_trace(defer_rep_references(fs, reps, scratch_pool));
+
+  return svn_error_trace(svn_fs_fs__set_rep_references(fs, reps,
+                                                       scratch_pool));
+#endif
+}
+
+/* Store all FINGERPRINTS (apr_uint32_t) of the representation with SHA1
+   checksum HASH in SDB. */
+static svn_error_t *
+set_fingerprints(svn_sqlite__db_t *sdb,
+                 const char *hash,
+                 const apr_array_header_t *fingerprints)
+{
+  svn_sqlite__stmt_t *stmt;
+  int i;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SET_REP_FINGERPRINT));
+  for (i = 0; i < fingerprints->nelts; ++i)
+    {
+      apr_uint32_t fingerprint = APR_ARRAY_IDX(fingerprints, i, apr_uint32_t);
+
+      SVN_ERR(svn_sqlite__bindf(stmt, "is", (apr_int64_t)fingerprint, hash));
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__set_rep_fingerprints(svn_fs_t *fs,
+                                representation_t *rep,
+                                const apr_array_header_t *fingerprints,
+                                apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_checksum_t checksum;
+  checksum.kind = svn_checksum_sha1;
+  checksum.digest = rep->sha1_digest;
+
+  SVN_ERR_ASSERT(ffd->similarity_deltification);
+  if (! ffd->rep_cache_db)
+    SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+
+  /* We only allow SHA1 checksums in this table. */
+  if (! rep->has_sha1)
+    return svn_error_create(SVN_ERR_BAD_CHECKSUM_KIND, NULL,
+                            _("Only SHA1 checksums can be used as keys in the "
+                              "rep_fingerprint table.\n"));
+
+  SVN_SQLITE__WITH_TXN(set_fingerprints(ffd->rep_cache_db,
+                                        svn_checksum_to_cstring(&checksum,
+                                                                pool),
+                                        fingerprints),
+                       ffd->rep_cache_db);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__get_similar_rep(representation_t **rep_p,
+                           svn_fs_t *fs,
+                           const apr_array_header_t *fingerprints,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_sqlite__stmt_t *stmt;
+  apr_hash_t *matches = apr_hash_make(scratch_pool);
+  apr_hash_index_t *hi;
+  const char *best_hash = NULL;
+  int best_count;
+  int i;
+
+  SVN_ERR_ASSERT(ffd->similarity_deltification);
+  if (! ffd->rep_cache_db)
+    SVN_ERR(svn_fs_fs__open_rep_cache(fs, scratch_pool));
+
+  /* A single common chunk is not enough to tell similar files apart from
+     ones that merely share some boilerplate. */
+  best_count = MIN(2, fingerprints->nelts) - 1;
+
+  /* Count the number of fingerprints that each candidate shares with
+     the new content. */
+  SVN_ERR(svn_sqlite__get_statement(&stmt, ffd->rep_cache_db,
+                                    STMT_GET_REPS_FOR_FINGERPRINT));
+  for (i = 0; i < fingerprints->nelts; ++i)
+    {
+      apr_uint32_t fingerprint = APR_ARRAY_IDX(fingerprints, i, apr_uint32_t);
+      svn_boolean_t have_row;
+
+      SVN_ERR(svn_sqlite__bindf(stmt, "i", (apr_int64_t)fingerprint));
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+      while (have_row)
+        {
+          const char *hash = svn_sqlite__column_text(stmt, 0, NULL);
+          apr_size_t len = strlen(hash);
+          int *count = apr_hash_get(matches, hash, len);
+
+          if (!count)
+            {
+              count = apr_pcalloc(scratch_pool, sizeof(*count));
+              apr_hash_set(matches, apr_pstrmemdup(scratch_pool, hash, len),
+                           len, count);
+            }
+          ++*count;
+
+          SVN_ERR(svn_sqlite__step(&have_row, stmt));
+        }
+
+      SVN_ERR(svn_sqlite__reset(stmt));
+    }
+
+  /* Pick the candidate with the most matches. */
+  for (hi = apr_hash_first(scratch_pool, matches); hi; hi = apr_hash_next(hi))
+    {
+      int count = *(int *)apr_hash_this_val(hi);
+      if (count > best_count)
+        {
+          best_count = count;
+          best_hash = apr_hash_this_key(hi);
+        }
+    }
+
+  *rep_p = NULL;
+  if (best_hash)
+    {
+      svn_checksum_t *checksum;
+
+      SVN_ERR(svn_checksum_parse_hex(&checksum, svn_checksum_sha1, best_hash,
+                                     scratch_pool));
+      SVN_ERR(svn_fs_fs__get_rep_reference(rep_p, fs, checksum, result_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 
 svn_error_t *
 svn_fs_fs__del_rep_reference(svn_fs_t *fs,
@@ -394,6 +1336,9 @@ svn_fs_fs__del_rep_reference(svn_fs_t *fs,
   SVN_ERR(svn_sqlite__bindf(stmt, "r", youngest));
   SVN_ERR(svn_sqlite__step_done(stmt));
 
+  /* The filter would not notice ROWIDs getting reused. */
+  SVN_ERR(filter_reset(fs, pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -33,6 +33,10 @@ extern "C" {
 
 
 #define REP_CACHE_DB_NAME        "rep-cache.db"
+#define REP_CACHE_FILTER_NAME    "rep-cache.filter"
+
+/* Opaque Bloom filter over the keys in rep-cache.db. */
+typedef struct svn_fs_fs__rep_cache_filter_t svn_fs_fs__rep_cache_filter_t;
 
 /* Open and create, if needed, the rep cache database associated with FS.
    Use POOL for temporary allocations. */
@@ -83,6 +87,58 @@ svn_fs_fs__set_rep_reference(svn_fs_t *fs,
                              representation_t *rep,
                              apr_pool_t *pool);
 
+/* Set all representations in REPS (representation_t *) in FS within a
+   single SQLite transaction.  Use SCRATCH_POOL for temporary allocations.
+
+   If the rep cache database has not been opened, this will open it. */
+svn_error_t *
+svn_fs_fs__set_rep_references(svn_fs_t *fs,
+                              const apr_array_header_t *reps,
+                              apr_pool_t *scratch_pool);
+
+/* Add all representations in REPS (representation_t *) of committed
+   revisions to FS's rep-cache.  In bulk load mode, hold them back in FS
+   until svn_fs_fs__write_deferred_rep_references gets called.  If
+   asynchronous rep-cache updates have been enabled for FS, copy them to
+   a per-repository queue that gets written in batches by a background
+   thread using a private instance of FS.  Otherwise, or without thread
+   support, write them immediately.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *
+svn_fs_fs__queue_rep_references(svn_fs_t *fs,
+                                const apr_array_header_t *reps,
+                                apr_pool_t *scratch_pool);
+
+/* Write the rep-cache entries that FS holds back in bulk load mode to
+   its rep-cache.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__write_deferred_rep_references(svn_fs_t *fs,
+                                         apr_pool_t *scratch_pool);
+
+/* Record the similarity FINGERPRINTS (apr_uint32_t) of representation REP
+   in FS, using REP->CHECKSUM.  They will become effective once REP itself
+   has been added to the rep cache.  Use POOL for temporary allocations.
+
+   Only allowed if similarity deltification has been enabled for FS. */
+svn_error_t *
+svn_fs_fs__set_rep_fingerprints(svn_fs_t *fs,
+                                representation_t *rep,
+                                const apr_array_header_t *fingerprints,
+                                apr_pool_t *pool);
+
+/* Return the representation in FS that shares the most of the given
+   similarity FINGERPRINTS (apr_uint32_t) in *REP_P.  Set it to NULL if
+   there is no sufficiently similar one.  Allocate *REP_P in RESULT_POOL
+   and use SCRATCH_POOL for temporary allocations.
+
+   Only allowed if similarity deltification has been enabled for FS. */
+svn_error_t *
+svn_fs_fs__get_similar_rep(representation_t **rep_p,
+                           svn_fs_t *fs,
+                           const apr_array_header_t *fingerprints,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool);
+
 /* Delete from the cache all reps corresponding to revisions younger
    than YOUNGEST. */
 svn_error_t *
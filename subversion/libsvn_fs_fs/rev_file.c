@@ -24,11 +24,18 @@
 #include "fs_fs.h"
 #include "index.h"
 #include "low_level.h"
+#include "trace.h"
 #include "util.h"
 
 #include "../libsvn_fs/fs-loader.h"
 
+#include "svn_cache_config.h"
+#include "svn_hash.h"
+#include "svn_pools.h"
+
+#include "private/svn_atomic.h"
 #include "private/svn_io_private.h"
+#include "private/svn_mutex.h"
 #include "svn_private_config.h"
 
 /* Initialize the *FILE structure for REVISION in filesystem FS.  Set its
@@ -46,6 +53,11 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
 
   file->file = NULL;
   file->stream = NULL;
+  file->mapped_data = NULL;
+  file->mapped_size = 0;
+#if APR_HAS_MMAP
+  file->mmap = NULL;
+#endif
   file->p2l_stream = NULL;
   file->l2p_stream = NULL;
   file->block_size = ffd->block_size;
@@ -54,6 +66,7 @@ init_revision_file(svn_fs_fs__revision_file_t *file,
   file->p2l_offset = -1;
   file->p2l_checksum = NULL;
   file->footer_offset = -1;
+  file->cached_handle = NULL;
   file->pool = pool;
 }
 
@@ -120,6 +133,438 @@ auto_make_writable(const char *path,
   return SVN_NO_ERROR;
 }
 
+/* If enabled for FS, map the whole APR_FILE opened for FILE into memory.
+ * Mapping is an optimization only and will silently be skipped if it is
+ * not supported or fails.  Allocate the mapping in RESULT_POOL.
+ */
+static void
+auto_map_file(svn_fs_fs__revision_file_t *file,
+              svn_fs_t *fs,
+              apr_file_t *apr_file,
+              apr_pool_t *result_pool)
+{
+#if APR_HAS_MMAP
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_finfo_t finfo;
+  apr_mmap_t *mmap;
+
+  if (!ffd->memory_map || file->mapped_data)
+    return;
+
+  /* Empty files can't be mapped and huge ones won't fit into our address
+   * space. */
+  if (   apr_file_info_get(&finfo, APR_FINFO_SIZE, apr_file)
+      || finfo.size <= 0
+      || finfo.size > APR_SIZE_MAX)
+    return;
+
+  if (apr_mmap_create(&mmap, apr_file, 0, (apr_size_t)finfo.size,
+                      APR_MMAP_READ, result_pool))
+    return;
+
+  file->mmap = mmap;
+  file->mapped_data = mmap->mm;
+  file->mapped_size = mmap->size;
+#endif
+}
+
+/* The process-wide cache of open read-only rev / pack files.
+ *
+ * Opening a file, determining its size and parsing its footer is costly
+ * compared to the actual data access of short-lived sessions.  Therefore,
+ * svn_fs_fs__close_revision_file will put read-only files into this cache
+ * instead of closing them and svn_fs_fs__open_pack_or_rev_file will try
+ * to reuse them.
+ *
+ * A handle is either idle, i.e. in the cache, or borrowed by exactly one
+ * svn_fs_fs__revision_file_t.  Hence, file pointers and buffers never get
+ * shared between threads.  Idle handles are kept in LRU order and the
+ * oldest ones get closed when more than svn_cache_config_t.file_handle_count
+ * become idle.
+ *
+ * Our own modifications to rev / pack files, i.e. packing and index
+ * rewrites, explicitly remove the affected handles from the cache.  To
+ * catch files being replaced behind our back, we compare the file's
+ * identity, size and timestamp with the path's before reusing a handle.
+ */
+struct svn_fs_fs__cached_handle_t
+{
+  /* Identifies the file: repository UUID, path and packed state. */
+  const char *key;
+
+  /* Owns this handle and all its contents. */
+  apr_pool_t *pool;
+
+  /* The open file and its optional mapping. */
+  apr_file_t *file;
+  const unsigned char *mapped_data;
+  apr_size_t mapped_size;
+#if APR_HAS_MMAP
+  apr_mmap_t *mmap;
+#endif
+
+  /* Footer contents.  L2P_OFFSET is -1 if not read, yet. */
+  apr_off_t l2p_offset;
+  svn_checksum_t *l2p_checksum;
+  apr_off_t p2l_offset;
+  svn_checksum_t *p2l_checksum;
+  apr_off_t footer_offset;
+
+  /* First revision in the file. */
+  svn_revnum_t start_revision;
+
+  /* Identity, size and mtime of FILE at the time we opened it. */
+  apr_finfo_t finfo;
+
+  /* Next idle handle with the same KEY. */
+  svn_fs_fs__cached_handle_t *next_same;
+
+  /* Neighbors in the list of idle handles.  NEWER is NULL for the most
+   * recently used one and OLDER is NULL for the least recently used. */
+  svn_fs_fs__cached_handle_t *newer;
+  svn_fs_fs__cached_handle_t *older;
+};
+
+/* Singleton object collecting all idle handles. */
+typedef struct handle_cache_t
+{
+  /* Serializes all access to the members below. */
+  svn_mutex__t *mutex;
+
+  /* Thread-safe root pool.  Parent of all handle pools. */
+  apr_pool_t *pool;
+
+  /* Maps KEY to the most recently returned idle handle for it.  Further
+   * idle handles for the same KEY are chained via NEXT_SAME. */
+  apr_hash_t *idle;
+
+  /* LRU list of all idle handles. */
+  svn_fs_fs__cached_handle_t *newest;
+  svn_fs_fs__cached_handle_t *oldest;
+
+  /* Number of handles in that list. */
+  apr_size_t count;
+} handle_cache_t;
+
+/* The handle cache and its initialization state. */
+static handle_cache_t *handle_cache = NULL;
+static volatile svn_atomic_t handle_cache_initialized = 0;
+
+/* Implements svn_atomic__init_once callback.  Create HANDLE_CACHE.
+ * Both parameters are unused. */
+static svn_error_t *
+create_handle_cache(void *baton,
+                    apr_pool_t *unused_pool)
+{
+  apr_pool_t *pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  handle_cache_t *cache = apr_pcalloc(pool, sizeof(*cache));
+
+  SVN_ERR(svn_mutex__init(&cache->mutex, TRUE, pool));
+  cache->pool = pool;
+  cache->idle = apr_hash_make(pool);
+
+  handle_cache = cache;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the maximum number of idle handles to keep.  0 disables the
+ * handle cache. */
+static apr_size_t
+handle_cache_capacity(void)
+{
+  return svn_cache_config_get()->file_handle_count;
+}
+
+/* Remove HANDLE from the idle lists of HANDLE_CACHE.
+ * The caller must hold the cache mutex. */
+static void
+unlink_handle(svn_fs_fs__cached_handle_t *handle)
+{
+  svn_fs_fs__cached_handle_t *first
+    = svn_hash_gets(handle_cache->idle, handle->key);
+
+  /* Remove it from its chain of same-key handles.  Because the hash uses
+   * the head's KEY, re-insert any remaining chain under the new head. */
+  if (first == handle)
+    {
+      svn_hash_sets(handle_cache->idle, handle->key, NULL);
+      if (handle->next_same)
+        svn_hash_sets(handle_cache->idle, handle->next_same->key,
+                      handle->next_same);
+    }
+  else
+    {
+      while (first->next_same != handle)
+        first = first->next_same;
+
+      first->next_same = handle->next_same;
+    }
+
+  handle->next_same = NULL;
+
+  /* Remove it from the LRU list. */
+  if (handle->newer)
+    handle->newer->older = handle->older;
+  else
+    handle_cache->newest = handle->older;
+
+  if (handle->older)
+    handle->older->newer = handle->newer;
+  else
+    handle_cache->oldest = handle->newer;
+
+  handle->newer = NULL;
+  handle->older = NULL;
+  --handle_cache->count;
+}
+
+/* Set *HANDLE to an idle handle for KEY taken from HANDLE_CACHE or to
+ * NULL if there is none.  The caller must hold the cache mutex. */
+static svn_error_t *
+take_idle_handle(svn_fs_fs__cached_handle_t **handle,
+                 const char *key)
+{
+  *handle = svn_hash_gets(handle_cache->idle, key);
+  if (*handle)
+    unlink_handle(*handle);
+
+  return SVN_NO_ERROR;
+}
+
+/* Make HANDLE the most recently used idle handle in HANDLE_CACHE and close
+ * old ones as necessary.  The caller must hold the cache mutex. */
+static svn_error_t *
+add_idle_handle(svn_fs_fs__cached_handle_t *handle)
+{
+  handle->next_same = svn_hash_gets(handle_cache->idle, handle->key);
+  if (handle->next_same)
+    svn_hash_sets(handle_cache->idle, handle->key, NULL);
+  svn_hash_sets(handle_cache->idle, handle->key, handle);
+
+  handle->older = handle_cache->newest;
+  handle->newer = NULL;
+  if (handle_cache->newest)
+    handle_cache->newest->newer = handle;
+  else
+    handle_cache->oldest = handle;
+  handle_cache->newest = handle;
+  ++handle_cache->count;
+
+  while (handle_cache->count > handle_cache_capacity())
+    {
+      svn_fs_fs__cached_handle_t *victim = handle_cache->oldest;
+      unlink_handle(victim);
+      svn_pool_destroy(victim->pool);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Give the handle borrowed by FILE back to HANDLE_CACHE and remember the
+ * footer info, if FILE has read it. */
+static svn_error_t *
+release_handle(svn_fs_fs__revision_file_t *file)
+{
+  svn_fs_fs__cached_handle_t *handle = file->cached_handle;
+
+  file->cached_handle = NULL;
+  if (handle->l2p_offset == -1 && file->l2p_offset != -1)
+    {
+      handle->l2p_offset = file->l2p_offset;
+      handle->l2p_checksum = svn_checksum_dup(file->l2p_checksum,
+                                              handle->pool);
+      handle->p2l_offset = file->p2l_offset;
+      handle->p2l_checksum = svn_checksum_dup(file->p2l_checksum,
+                                              handle->pool);
+      handle->footer_offset = file->footer_offset;
+    }
+
+  SVN_MUTEX__WITH_LOCK(handle_cache->mutex, add_idle_handle(handle));
+
+  return SVN_NO_ERROR;
+}
+
+/* APR pool cleanup handler returning the handle borrowed by the
+ * svn_fs_fs__revision_file_t in BATON to the cache. */
+static apr_status_t
+release_handle_cleanup(void *baton)
+{
+  svn_fs_fs__revision_file_t *file = baton;
+  svn_error_t *err = release_handle(file);
+  apr_status_t status = err ? err->apr_err : APR_SUCCESS;
+
+  svn_error_clear(err);
+
+  return status;
+}
+
+/* The file info fields that identify a specific version of a file. */
+#define HANDLE_FINFO_FLAGS (APR_FINFO_IDENT | APR_FINFO_SIZE | APR_FINFO_MTIME)
+
+/* Return TRUE if the file at PATH is still the one opened by HANDLE.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_boolean_t
+handle_is_current(svn_fs_fs__cached_handle_t *handle,
+                  const char *path,
+                  apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  svn_error_t *err = svn_io_stat(&finfo, path, HANDLE_FINFO_FLAGS,
+                                 scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return FALSE;
+    }
+
+  return finfo.inode == handle->finfo.inode
+      && finfo.device == handle->finfo.device
+      && finfo.size == handle->finfo.size
+      && finfo.mtime == handle->finfo.mtime;
+}
+
+/* Try to open the rev / pack file at PATH for REV in FS through the
+ * process-wide file handle cache and initialize FILE from it.  Set
+ * *AVAILABLE to FALSE if the cache has been disabled.  Allocate the
+ * stream in RESULT_POOL and use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+open_cached_handle(svn_boolean_t *available,
+                   svn_fs_fs__revision_file_t *file,
+                   svn_fs_t *fs,
+                   svn_revnum_t rev,
+                   const char *path,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  svn_fs_fs__cached_handle_t *handle;
+  svn_boolean_t is_packed = svn_fs_fs__is_packed_rev(fs, rev);
+  const char *key;
+  svn_error_t *err;
+
+  *available = fs->uuid && handle_cache_capacity() > 0;
+  if (!*available)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&handle_cache_initialized,
+                                create_handle_cache, NULL, NULL));
+
+  key = apr_psprintf(scratch_pool, "%s:%d:%s", fs->uuid, is_packed, path);
+  SVN_MUTEX__WITH_LOCK(handle_cache->mutex,
+                       take_idle_handle(&handle, key));
+
+  /* Don't use stale handles. */
+  if (handle && !handle_is_current(handle, path, scratch_pool))
+    {
+      svn_pool_destroy(handle->pool);
+      handle = NULL;
+    }
+
+  if (!handle)
+    {
+      apr_pool_t *pool;
+
+      /* The parent pool is thread-safe. */
+      pool = svn_pool_create(handle_cache->pool);
+
+      handle = apr_pcalloc(pool, sizeof(*handle));
+      handle->pool = pool;
+      handle->key = apr_pstrdup(pool, key);
+      handle->start_revision = svn_fs_fs__packed_base_rev(fs, rev);
+      handle->l2p_offset = -1;
+      handle->p2l_offset = -1;
+      handle->footer_offset = -1;
+
+      err = svn_io_file_open(&handle->file, path, APR_READ | APR_BUFFERED,
+                             APR_OS_DEFAULT, pool);
+      if (!err)
+        err = svn_io_file_info_get(&handle->finfo, HANDLE_FINFO_FLAGS,
+                                   handle->file, pool);
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+
+      auto_map_file(file, fs, handle->file, pool);
+      handle->mapped_data = file->mapped_data;
+      handle->mapped_size = file->mapped_size;
+#if APR_HAS_MMAP
+      handle->mmap = file->mmap;
+      file->mmap = NULL;
+#endif
+    }
+
+  file->file = handle->file;
+  file->stream = svn_stream_from_aprfile2(handle->file, TRUE, result_pool);
+  file->is_packed = is_packed;
+  file->mapped_data = handle->mapped_data;
+  file->mapped_size = handle->mapped_size;
+  if (handle->l2p_offset != -1)
+    {
+      file->l2p_offset = handle->l2p_offset;
+      file->l2p_checksum = svn_checksum_dup(handle->l2p_checksum,
+                                            result_pool);
+      file->p2l_offset = handle->p2l_offset;
+      file->p2l_checksum = svn_checksum_dup(handle->p2l_checksum,
+                                            result_pool);
+      file->footer_offset = handle->footer_offset;
+    }
+
+  file->cached_handle = handle;
+  apr_pool_cleanup_register(result_pool, file, release_handle_cleanup,
+                            apr_pool_cleanup_null);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_fs_fs__forget_cached_handles while holding the cache
+ * mutex.  UUID identifies the repository. */
+static svn_error_t *
+forget_cached_handles(const char *uuid,
+                      svn_revnum_t start_rev,
+                      svn_revnum_t end_rev)
+{
+  svn_fs_fs__cached_handle_t *handle = handle_cache->oldest;
+  apr_size_t uuid_len = strlen(uuid);
+
+  while (handle)
+    {
+      svn_fs_fs__cached_handle_t *next = handle->newer;
+      if (   handle->start_revision >= start_rev
+          && handle->start_revision < end_rev
+          && strncmp(handle->key, uuid, uuid_len) == 0
+          && handle->key[uuid_len] == ':')
+        {
+          unlink_handle(handle);
+          svn_pool_destroy(handle->pool);
+        }
+
+      handle = next;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__forget_cached_handles(svn_fs_t *fs,
+                                 svn_revnum_t start_rev,
+                                 svn_revnum_t end_rev,
+                                 apr_pool_t *scratch_pool)
+{
+  if (!fs->uuid || !svn_atomic_read(&handle_cache_initialized))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&handle_cache_initialized,
+                                create_handle_cache, NULL, NULL));
+  SVN_MUTEX__WITH_LOCK(handle_cache->mutex,
+                       forget_cached_handles(fs->uuid, start_rev, end_rev));
+
+  return SVN_NO_ERROR;
+}
+
 /* Core implementation of svn_fs_fs__open_pack_or_rev_file working on an
  * existing, initialized FILE structure.  If WRITABLE is TRUE, give write
  * access to the file - temporarily resetting the r/o state if necessary.
@@ -135,6 +580,7 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_error_t *err;
   svn_boolean_t retry = FALSE;
+  apr_time_t start = SVN_FS_FS__TRACE_START(fs);
 
   do
     {
@@ -143,10 +589,22 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
       apr_int32_t flags = writable
                         ? APR_READ | APR_WRITE | APR_BUFFERED
                         : APR_READ | APR_BUFFERED;
+      svn_boolean_t cached = FALSE;
+
+      /* Read-only access may reuse files opened by other sessions. */
+      err = writable ? SVN_NO_ERROR
+                     : open_cached_handle(&cached, file, fs, rev, path,
+                                          result_pool, scratch_pool);
+      if (!err && cached)
+        {
+          SVN_FS_FS__TRACE(fs, svn_fs_fs__trace_file_open, "cached", rev,
+                           0, 0, 0, start);
+          return SVN_NO_ERROR;
+        }
 
       /* We may have to *temporarily* enable write access. */
-      err = writable ? auto_make_writable(path, result_pool, scratch_pool)
-                     : SVN_NO_ERROR;
+      if (!err && writable)
+        err = auto_make_writable(path, result_pool, scratch_pool);
 
       /* open the revision file in buffered r/o or r/w mode */
       if (!err)
@@ -160,6 +618,12 @@ open_pack_or_rev_file(svn_fs_fs__revision_file_t *file,
                                                   result_pool);
           file->is_packed = svn_fs_fs__is_packed_rev(fs, rev);
 
+          /* Writers need to see their own changes. */
+          if (!writable)
+            auto_map_file(file, fs, apr_file, result_pool);
+
+          SVN_FS_FS__TRACE(fs, svn_fs_fs__trace_file_open, NULL, rev,
+                           0, 0, 0, start);
           return SVN_NO_ERROR;
         }
 
@@ -223,6 +687,11 @@ svn_fs_fs__open_pack_or_rev_file_writable(svn_fs_fs__revision_file_t** file,
   *file = apr_palloc(result_pool, sizeof(**file));
   init_revision_file(*file, fs, rev, result_pool);
 
+  /* Readers must not see stale data after we modified the file. */
+  SVN_ERR(svn_fs_fs__forget_cached_handles(fs, (*file)->start_revision,
+                                           (*file)->start_revision + 1,
+                                           scratch_pool));
+
   return svn_error_trace(open_pack_or_rev_file(*file, fs, rev, TRUE,
                                                result_pool, scratch_pool));
 }
@@ -230,7 +699,31 @@ svn_fs_fs__open_pack_or_rev_file_writable(svn_fs_fs__revision_file_t** file,
 svn_error_t *
 svn_fs_fs__auto_read_footer(svn_fs_fs__revision_file_t *file)
 {
-  if (file->l2p_offset == -1)
+  if (file->l2p_offset == -1 && file->mapped_data)
+    {
+      apr_size_t filesize = file->mapped_size;
+      unsigned char footer_length = file->mapped_data[filesize - 1];
+      svn_stringbuf_t *footer;
+
+      /* The footer is right in front of its length byte. */
+      if (footer_length >= filesize)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Footer length %d exceeds file size"),
+                                 (int)footer_length);
+
+      footer = svn_stringbuf_ncreate((const char *)file->mapped_data
+                                       + filesize - 1 - footer_length,
+                                     footer_length, file->pool);
+
+      /* Extract index locations. */
+      SVN_ERR(svn_fs_fs__parse_footer(&file->l2p_offset, &file->l2p_checksum,
+                                      &file->p2l_offset, &file->p2l_checksum,
+                                      footer, file->start_revision,
+                                      filesize - footer_length - 1,
+                                      file->pool));
+      file->footer_offset = filesize - footer_length - 1;
+    }
+  else if (file->l2p_offset == -1)
     {
       apr_off_t filesize = 0;
       unsigned char footer_length;
@@ -295,11 +788,44 @@ svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file)
 {
   if (file->stream)
     SVN_ERR(svn_stream_close(file->stream));
+
+  if (file->cached_handle)
+    {
+      /* Hand the file back to the cache.  That will also unregister the
+       * pool cleanup. */
+      apr_status_t status = apr_pool_cleanup_run(file->pool, file,
+                                                 release_handle_cleanup);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't release revision file"));
+
+      file->file = NULL;
+      file->stream = NULL;
+      file->mapped_data = NULL;
+      file->mapped_size = 0;
+      file->l2p_stream = NULL;
+      file->p2l_stream = NULL;
+
+      return SVN_NO_ERROR;
+    }
+
+#if APR_HAS_MMAP
+  if (file->mmap)
+    {
+      apr_status_t status = apr_mmap_delete(file->mmap);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unmap revision file"));
+    }
+
+  file->mmap = NULL;
+#endif
+
   if (file->file)
     SVN_ERR(svn_io_file_close(file->file, file->pool));
 
   file->file = NULL;
   file->stream = NULL;
+  file->mapped_data = NULL;
+  file->mapped_size = 0;
   file->l2p_stream = NULL;
   file->p2l_stream = NULL;
 
@@ -23,6 +23,8 @@
 #ifndef SVN_LIBSVN_FS__REV_FILE_H
 #define SVN_LIBSVN_FS__REV_FILE_H
 
+#include <apr_mmap.h>
+
 #include "svn_fs.h"
 #include "id.h"
 
@@ -38,6 +40,10 @@
 typedef struct svn_fs_fs__packed_number_stream_t
   svn_fs_fs__packed_number_stream_t;
 
+/* Opaque entry in the process-wide cache of open rev / pack files.
+ */
+typedef struct svn_fs_fs__cached_handle_t svn_fs_fs__cached_handle_t;
+
 /* Data file, including indexes data, and associated properties for
  * START_REVISION.  As the FILE is kept open, background pack operations
  * will not cause access to this file to fail.
@@ -57,6 +63,19 @@ typedef struct svn_fs_fs__revision_file_t
   /* stream based on FILE and not NULL exactly when FILE is not NULL */
   svn_stream_t *stream;
 
+  /* Read-only memory mapping of the whole FILE or NULL.  Only used for
+   * rev / pack files if enabled in fsfs.conf.  The index streams will
+   * then decode directly from this memory. */
+  const unsigned char *mapped_data;
+
+  /* Number of bytes in MAPPED_DATA.  0 if MAPPED_DATA is NULL. */
+  apr_size_t mapped_size;
+
+#if APR_HAS_MMAP
+  /* The mapping providing MAPPED_DATA or NULL. */
+  apr_mmap_t *mmap;
+#endif
+
   /* the opened P2L index stream or NULL.  Always NULL for txns. */
   svn_fs_fs__packed_number_stream_t *p2l_stream;
 
@@ -90,6 +109,11 @@ typedef struct svn_fs_fs__revision_file_t
    * been called, yet. */
   apr_off_t footer_offset;
 
+  /* If not NULL, FILE and the mapping have been borrowed from the
+   * process-wide file handle cache and will be given back to it when
+   * this object gets closed or POOL gets cleaned up. */
+  svn_fs_fs__cached_handle_t *cached_handle;
+
   /* pool containing this object */
   apr_pool_t *pool;
 } svn_fs_fs__revision_file_t;
@@ -137,9 +161,21 @@ svn_fs_fs__open_proto_rev_file(svn_fs_fs__revision_file_t **file,
                                apr_pool_t* result_pool,
                                apr_pool_t *scratch_pool);
 
-/* Close all files and streams in FILE.
+/* Close all files and streams in FILE.  Files borrowed from the
+ * process-wide file handle cache will be returned to it instead.
  */
 svn_error_t *
 svn_fs_fs__close_revision_file(svn_fs_fs__revision_file_t *file);
 
+/* Close all currently unused handles in the process-wide file handle
+ * cache that belong to rev / pack files in FS starting at a revision
+ * within START_REV ... END_REV - 1.  Call this before modifying or
+ * removing those files.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__forget_cached_handles(svn_fs_t *fs,
+                                 svn_revnum_t start_rev,
+                                 svn_revnum_t end_rev,
+                                 apr_pool_t *scratch_pool);
+
 #endif
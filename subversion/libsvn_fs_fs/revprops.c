@@ -59,6 +59,8 @@ svn_fs_fs__upgrade_pack_revprops(svn_fs_t *fs,
   int compression_level = ffd->compress_packed_revprops
                            ? SVN_DELTA_COMPRESSION_LEVEL_DEFAULT
                            : SVN_DELTA_COMPRESSION_LEVEL_NONE;
+  svn_boolean_t indexed
+    = ffd->format >= SVN_FS_FS__MIN_INDEXED_REVPROP_PACK_FORMAT;
 
   /* first, pack all revprops shards to match the packed revision shards */
   for (shard = 0; shard < first_unpacked_shard; ++shard)
@@ -79,6 +81,7 @@ svn_fs_fs__upgrade_pack_revprops(svn_fs_t *fs,
                                              shard, ffd->max_files_per_dir,
                                              (int)(0.9 * ffd->revprop_pack_size),
                                              compression_level,
+                                             indexed,
                                              ffd->flush_to_disk,
                                              cancel_func, cancel_baton,
                                              iterpool));
@@ -133,6 +136,22 @@ svn_fs_fs__upgrade_cleanup_pack_revprops(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Indexed revprop pack files start with this line, followed by the line
+ * "<first revision> <count>" and COUNT lines of INDEX_ENTRY_LEN chars,
+ * each holding the end offset of the respective revprops relative to the
+ * end of that header.  The revprops follow in revision order, compressed
+ * individually.  Thus, one revision's revprops can be read or replaced
+ * without touching the others.
+ *
+ * Non-indexed pack files start with a compressed length header followed
+ * by either a zlib stream or a decimal revision number.  Neither can start
+ * with this line.
+ */
+#define INDEXED_PACK_MAGIC "indexed revprops 1\n"
+
+/* Length of an offset entry in an indexed pack: 10 digits plus newline. */
+#define INDEX_ENTRY_LEN 11
+
 /* Container for all data required to access the packed revprop file
  * for a given REVISION.  This structure will be filled incrementally
  * by read_pack_revprops() its sub-routines.
@@ -170,9 +189,17 @@ typedef struct packed_revprops_t
 
 
   /* concatenation of the serialized representation of all revprops
-   * in the pack, i.e. the pack content without header and compression */
+   * in the pack, i.e. the pack content without header and compression.
+   * For INDEXED packs, this is the pack file content and SIZES, OFFSETS
+   * as well as TOTAL_SIZE refer to the compressed revprops in it. */
   svn_stringbuf_t *packed_revprops;
 
+  /* TRUE, if the pack file uses the indexed format. */
+  svn_boolean_t indexed;
+
+  /* INDEXED packs only: offset of the first revprops in PACKED_REVPROPS. */
+  apr_size_t data_start;
+
   /* First revision covered by MANIFEST.
    * Will equal the shard start revision or 1, for the 1st shard. */
   svn_revnum_t manifest_start;
@@ -429,6 +456,214 @@ same_shard(svn_fs_t *fs,
   return (r1 / ffd->max_files_per_dir) == (r2 / ffd->max_files_per_dir);
 }
 
+/* Return an error if a revprop pack for REVPROPS->REVISION in FS may not
+ * contain the COUNT revisions starting at FIRST_REV.
+ */
+static svn_error_t *
+verify_pack_range(svn_fs_t *fs,
+                  packed_revprops_t *revprops,
+                  apr_int64_t first_rev,
+                  apr_int64_t count)
+{
+  /* Check revision range for validity. */
+  if (   !same_shard(fs, revprops->revision, first_rev)
+      || !same_shard(fs, revprops->revision, first_rev + count - 1)
+      || count < 1)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Revprop pack for revision r%ld"
+                               " contains revprops for r%ld .. r%ld"),
+                             revprops->revision,
+                             (svn_revnum_t)first_rev,
+                             (svn_revnum_t)(first_rev + count -1));
+
+  /* Since start & end are in the same shard, it is enough to just test
+   * the FIRST_REV for being actually packed.  That will also cover the
+   * special case of rev 0 never being packed. */
+  if (!svn_fs_fs__is_packed_revprop(fs, first_rev))
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Revprop pack for revision r%ld"
+                               " starts at non-packed revisions r%ld"),
+                             revprops->revision, (svn_revnum_t)first_rev);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE, if CONTENT is an indexed revprop pack file. */
+static svn_boolean_t
+is_indexed_pack(svn_stringbuf_t *content)
+{
+  return content->len >= sizeof(INDEXED_PACK_MAGIC) - 1
+      && !memcmp(content->data, INDEXED_PACK_MAGIC,
+                 sizeof(INDEXED_PACK_MAGIC) - 1);
+}
+
+/* Set *END to the end offset of the revprops at INDEX in the indexed pack
+ * REVPROPS, relative to REVPROPS->DATA_START.  INDEX_START is the offset
+ * of the first index entry in REVPROPS->PACKED_REVPROPS.
+ */
+static svn_error_t *
+get_index_entry(apr_size_t *end,
+                packed_revprops_t *revprops,
+                apr_size_t index_start,
+                int index)
+{
+  char entry[INDEX_ENTRY_LEN];
+  apr_uint64_t value;
+  const char *data = revprops->packed_revprops->data
+                   + index_start + (apr_size_t)index * INDEX_ENTRY_LEN;
+
+  if (data[INDEX_ENTRY_LEN - 1] != '\n')
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed revprop pack index"));
+
+  memcpy(entry, data, INDEX_ENTRY_LEN - 1);
+  entry[INDEX_ENTRY_LEN - 1] = '\0';
+  SVN_ERR(svn_cstring_strtoui64(&value, entry, 0,
+                                revprops->packed_revprops->len
+                                  - revprops->data_start,
+                                10));
+  *end = (apr_size_t)value;
+
+  return SVN_NO_ERROR;
+}
+
+/* Decompress the revprops DATA of length LEN from an indexed pack and
+ * return them in *SERIALIZED, allocated in RESULT_POOL.
+ */
+static svn_error_t *
+decompress_revprops(svn_string_t **serialized,
+                    const char *data,
+                    apr_size_t len,
+                    apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *uncompressed = svn_stringbuf_create_empty(result_pool);
+  SVN_ERR(svn__decompress(data, len, uncompressed, APR_SIZE_MAX));
+  *serialized = svn_stringbuf__morph_into_string(uncompressed);
+
+  return SVN_NO_ERROR;
+}
+
+/* Like parse_packed_revprops but for indexed pack files.  Only the
+ * revprops needed are being decompressed.
+ */
+static svn_error_t *
+parse_indexed_revprops(svn_fs_t *fs,
+                       packed_revprops_t *revprops,
+                       svn_boolean_t read_all,
+                       svn_boolean_t populate_cache,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *content = revprops->packed_revprops;
+  const char *line = content->data + sizeof(INDEXED_PACK_MAGIC) - 1;
+  const char *line_end = memchr(line, '\n',
+                                content->len - (line - content->data));
+  apr_array_header_t *fields;
+  apr_int64_t first_rev, count;
+  apr_size_t index_start, start, end;
+  apr_pool_t *iterpool;
+  int i;
+
+  /* read first revision number and number of revisions in the pack */
+  if (line_end == NULL)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Header end not found"));
+
+  fields = svn_cstring_split(apr_pstrmemdup(scratch_pool, line,
+                                            line_end - line),
+                             " ", TRUE, scratch_pool);
+  if (fields->nelts != 2)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Malformed revprop pack header"));
+
+  SVN_ERR(svn_cstring_atoi64(&first_rev,
+                             APR_ARRAY_IDX(fields, 0, const char *)));
+  SVN_ERR(svn_cstring_atoi64(&count,
+                             APR_ARRAY_IDX(fields, 1, const char *)));
+  SVN_ERR(verify_pack_range(fs, revprops, first_rev, count));
+
+  /* The fixed-size index follows immediately. */
+  index_start = line_end + 1 - content->data;
+  if ((content->len - index_start) / INDEX_ENTRY_LEN < (apr_uint64_t)count)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                            _("Revprop pack index exceeds pack file size"));
+
+  revprops->indexed = TRUE;
+  revprops->data_start = index_start + (apr_size_t)count * INDEX_ENTRY_LEN;
+  revprops->start_revision = (svn_revnum_t)first_rev;
+
+  /* Direct access to the revprops of the revision we want. */
+  if (   revprops->revision >= first_rev
+      && revprops->revision < first_rev + count)
+    {
+      svn_string_t *serialized;
+
+      i = (int)(revprops->revision - first_rev);
+      start = 0;
+      if (i > 0)
+        SVN_ERR(get_index_entry(&start, revprops, index_start, i - 1));
+      SVN_ERR(get_index_entry(&end, revprops, index_start, i));
+      if (start > end)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Malformed revprop pack index"));
+
+      SVN_ERR(decompress_revprops(&serialized,
+                                  content->data + revprops->data_start
+                                                + start,
+                                  end - start, scratch_pool));
+      SVN_ERR(parse_revprop(&revprops->properties, fs, revprops->revision,
+                            serialized, result_pool, scratch_pool));
+      revprops->serialized_size = serialized->len;
+    }
+
+  if (!read_all && !populate_cache)
+    return SVN_NO_ERROR;
+
+  /* Walk the whole index. */
+  if (read_all)
+    {
+      revprops->sizes = apr_array_make(result_pool, (int)count,
+                                       sizeof(apr_size_t));
+      revprops->offsets = apr_array_make(result_pool, (int)count,
+                                         sizeof(apr_size_t));
+    }
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0, start = 0, revprops->total_size = 0; i < count; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(get_index_entry(&end, revprops, index_start, i));
+      if (start > end)
+        return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                                _("Malformed revprop pack index"));
+
+      if (populate_cache)
+        {
+          svn_string_t *serialized;
+          SVN_ERR(decompress_revprops(&serialized,
+                                      content->data + revprops->data_start
+                                                    + start,
+                                      end - start, iterpool));
+          SVN_ERR(cache_revprops(fs, (svn_revnum_t)(first_rev + i),
+                                 serialized, iterpool));
+        }
+
+      if (read_all)
+        {
+          APR_ARRAY_PUSH(revprops->sizes, apr_size_t) = end - start;
+          APR_ARRAY_PUSH(revprops->offsets, apr_size_t) = start;
+        }
+
+      revprops->total_size += end - start;
+      start = end;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Given FS and the full packed file content in REVPROPS->PACKED_REVPROPS,
  * fill the START_REVISION member, and make PACKED_REVPROPS point to the
  * first serialized revprop.  If READ_ALL is set, initialize the SIZES
@@ -451,12 +686,21 @@ parse_packed_revprops(svn_fs_t *fs,
   apr_int64_t first_rev, count, i;
   apr_size_t offset;
   const char *header_end;
-  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *iterpool;
+  svn_stringbuf_t *compressed = revprops->packed_revprops;
+  svn_stringbuf_t *uncompressed;
+
+  /* Indexed packs don't need to be decompressed as a whole. */
+  if (is_indexed_pack(compressed))
+    return svn_error_trace(parse_indexed_revprops(fs, revprops, read_all,
+                                                  populate_cache,
+                                                  result_pool,
+                                                  scratch_pool));
 
   /* decompress (even if the data is only "stored", there is still a
    * length header to remove) */
-  svn_stringbuf_t *compressed = revprops->packed_revprops;
-  svn_stringbuf_t *uncompressed = svn_stringbuf_create_empty(result_pool);
+  iterpool = svn_pool_create(scratch_pool);
+  uncompressed = svn_stringbuf_create_empty(result_pool);
   SVN_ERR(svn__decompress(compressed->data, compressed->len,
                           uncompressed, APR_SIZE_MAX));
 
@@ -466,26 +710,7 @@ parse_packed_revprops(svn_fs_t *fs,
                                              iterpool));
   SVN_ERR(svn_fs_fs__read_number_from_stream(&count, NULL, stream,
                                              iterpool));
-
-  /* Check revision range for validity. */
-  if (   !same_shard(fs, revprops->revision, first_rev)
-      || !same_shard(fs, revprops->revision, first_rev + count - 1)
-      || count < 1)
-    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                             _("Revprop pack for revision r%ld"
-                               " contains revprops for r%ld .. r%ld"),
-                             revprops->revision,
-                             (svn_revnum_t)first_rev,
-                             (svn_revnum_t)(first_rev + count -1));
-
-  /* Since start & end are in the same shard, it is enough to just test
-   * the FIRST_REV for being actually packed.  That will also cover the
-   * special case of rev 0 never being packed. */
-  if (!svn_fs_fs__is_packed_revprop(fs, first_rev))
-    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
-                             _("Revprop pack for revision r%ld"
-                               " starts at non-packed revisions r%ld"),
-                             revprops->revision, (svn_revnum_t)first_rev);
+  SVN_ERR(verify_pack_range(fs, revprops, first_rev, count));
 
   /* make PACKED_REVPROPS point to the first char after the header.
    * This is where the serialized revprops are. */
@@ -842,6 +1067,97 @@ serialize_revprops_header(svn_stream_t *stream,
   return SVN_NO_ERROR;
 }
 
+/* Append the header of an indexed pack file to CONTENT.  The pack starts
+ * at revision START_REVISION and contains the revprops of the compressed
+ * sizes given by the indexes [START,END) of SIZES.
+ */
+static svn_error_t *
+serialize_indexed_header(svn_stringbuf_t *content,
+                         svn_revnum_t start_revision,
+                         apr_array_header_t *sizes,
+                         int start,
+                         int end,
+                         apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_size_t offset = 0;
+  int i;
+
+  SVN_ERR_ASSERT(start < end);
+
+  svn_stringbuf_appendcstr(content, INDEXED_PACK_MAGIC);
+  svn_stringbuf_appendcstr(content, apr_psprintf(pool, "%ld %d\n",
+                                                 start_revision,
+                                                 end - start));
+
+  /* the fixed-size index of end offsets */
+  for (i = start; i < end; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      offset += APR_ARRAY_IDX(sizes, i, apr_size_t);
+      SVN_ERR_ASSERT(offset < APR_UINT64_C(10000000000));
+      svn_stringbuf_appendcstr(content,
+                               apr_psprintf(iterpool,
+                                            "%010" APR_SIZE_T_FMT "\n",
+                                            offset));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Like repack_revprops but for REVPROPS that use the indexed pack format.
+ * NEW_COMPRESSED is the already compressed new data for CHANGED_INDEX.
+ * All other revprops are copied verbatim, i.e. without being decompressed
+ * and compressed again.
+ */
+static svn_error_t *
+repack_indexed_revprops(svn_fs_t *fs,
+                        packed_revprops_t *revprops,
+                        int start,
+                        int end,
+                        int changed_index,
+                        svn_stringbuf_t *new_compressed,
+                        apr_size_t new_total_size,
+                        apr_file_t *file,
+                        apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_stringbuf_t *content
+    = svn_stringbuf_create_ensure(new_total_size, pool);
+  int i;
+
+  SVN_ERR(serialize_indexed_header(content,
+                                   revprops->start_revision + start,
+                                   revprops->sizes, start, end, pool));
+
+  for (i = start; i < end; ++i)
+    if (i == changed_index)
+      {
+        svn_stringbuf_appendstr(content, new_compressed);
+      }
+    else
+      {
+        apr_size_t size = APR_ARRAY_IDX(revprops->sizes, i, apr_size_t);
+        apr_size_t offset = APR_ARRAY_IDX(revprops->offsets, i, apr_size_t);
+
+        svn_stringbuf_appendbytes(content,
+                                  revprops->packed_revprops->data
+                                    + revprops->data_start + offset,
+                                  size);
+      }
+
+  /* write the content to the target file, flush and close it */
+  SVN_ERR(svn_io_file_write_full(file, content->data, content->len,
+                                 NULL, pool));
+  if (ffd->flush_to_disk)
+    SVN_ERR(svn_io_file_flush_to_disk(file, pool));
+  SVN_ERR(svn_io_file_close(file, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Writes the a pack file to FILE.  It copies the serialized data
  * from REVPROPS for the indexes [START,END) except for index CHANGED_INDEX.
  *
@@ -850,6 +1166,7 @@ serialize_revprops_header(svn_stream_t *stream,
  * taken in that case but only a subset of the old data will be copied.
  *
  * NEW_TOTAL_SIZE is a hint for pre-allocating buffers of appropriate size.
+ * For indexed packs, NEW_SERIALIZED must already be compressed.
  * POOL is used for temporary allocations.
  */
 static svn_error_t *
@@ -865,13 +1182,21 @@ repack_revprops(svn_fs_t *fs,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_stream_t *stream;
+  svn_stringbuf_t *uncompressed;
+  svn_stringbuf_t *compressed;
   int i;
 
+  if (revprops->indexed)
+    return svn_error_trace(repack_indexed_revprops(fs, revprops, start, end,
+                                                   changed_index,
+                                                   new_serialized,
+                                                   new_total_size,
+                                                   file, pool));
+
   /* create data empty buffers and the stream object */
-  svn_stringbuf_t *uncompressed
-    = svn_stringbuf_create_ensure((apr_size_t)new_total_size, pool);
-  svn_stringbuf_t *compressed
-    = svn_stringbuf_create_empty(pool);
+  uncompressed = svn_stringbuf_create_ensure((apr_size_t)new_total_size,
+                                             pool);
+  compressed = svn_stringbuf_create_empty(pool);
   stream = svn_stream_from_stringbuf(uncompressed, pool);
 
   /* write the header*/
@@ -1007,9 +1332,22 @@ write_packed_revprop(const char **final_path,
   SVN_ERR(svn_hash_write2(proplist, stream, SVN_HASH_TERMINATOR, pool));
   SVN_ERR(svn_stream_close(stream));
 
+  /* Indexed packs store each revprop list individually compressed.
+   * Only the new one needs compressing; all others get copied as-is. */
+  if (revprops->indexed)
+    {
+      svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+      SVN_ERR(svn__compress(serialized->data, serialized->len, compressed,
+                            ffd->compress_packed_revprops
+                              ? SVN_DELTA_COMPRESSION_LEVEL_DEFAULT
+                              : SVN_DELTA_COMPRESSION_LEVEL_NONE));
+      serialized = compressed;
+    }
+
   /* calculate the size of the new data */
   changed_index = (int)(rev - revprops->start_revision);
-  new_total_size = revprops->total_size - revprops->serialized_size
+  new_total_size = revprops->total_size
+                 - APR_ARRAY_IDX(revprops->sizes, changed_index, apr_size_t)
                  + serialized->len
                  + (revprops->offsets->nelts + 2) * SVN_INT64_BUFFER_SIZE;
 
@@ -1244,6 +1582,84 @@ svn_fs_fs__packed_revprop_available(svn_boolean_t *missing,
 
 /****** Packing FSFS shards *********/
 
+/* Write CONTENT to the pack file FILE, flush it to disk if FLUSH_TO_DISK
+ * is set and close it.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+write_pack_file(apr_file_t *file,
+                svn_stringbuf_t *content,
+                svn_boolean_t flush_to_disk,
+                apr_pool_t *scratch_pool)
+{
+  SVN_ERR(svn_io_file_write_full(file, content->data, content->len,
+                                 NULL, scratch_pool));
+  if (flush_to_disk)
+    SVN_ERR(svn_io_file_flush_to_disk(file, scratch_pool));
+  SVN_ERR(svn_io_file_close(file, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return in *CONTENT, allocated in RESULT_POOL, an indexed pack file for
+ * the non-packed revprop files of revisions [START_REV, END_REV] in
+ * SHARD_PATH.  Each revprop list gets compressed individually according
+ * to COMPRESSION_LEVEL.  TOTAL_SIZE is a hint on the size of the result.
+ * CANCEL_FUNC and CANCEL_BATON are used as usual.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+static svn_error_t *
+pack_indexed_revprops(svn_stringbuf_t **content,
+                      const char *shard_path,
+                      svn_revnum_t start_rev,
+                      svn_revnum_t end_rev,
+                      apr_size_t total_size,
+                      int compression_level,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_stringbuf_t *data = svn_stringbuf_create_ensure(total_size,
+                                                      scratch_pool);
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(scratch_pool);
+  apr_array_header_t *sizes
+    = apr_array_make(scratch_pool, (int)(end_rev - start_rev + 1),
+                     sizeof(apr_size_t));
+  svn_revnum_t rev;
+
+  for (rev = start_rev; rev <= end_rev; rev++)
+    {
+      svn_stringbuf_t *serialized;
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+
+      path = svn_dirent_join(shard_path, apr_psprintf(iterpool, "%ld", rev),
+                             iterpool);
+      SVN_ERR(svn_stringbuf_from_file2(&serialized, path, iterpool));
+      SVN_ERR(svn__compress(serialized->data, serialized->len, compressed,
+                            compression_level));
+
+      svn_stringbuf_appendstr(data, compressed);
+      APR_ARRAY_PUSH(sizes, apr_size_t) = compressed->len;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  *content = svn_stringbuf_create_ensure(data->len
+                                         + (sizes->nelts + 2)
+                                           * SVN_INT64_BUFFER_SIZE,
+                                         result_pool);
+  SVN_ERR(serialize_indexed_header(*content, start_rev, sizes, 0,
+                                   sizes->nelts, scratch_pool));
+  svn_stringbuf_appendstr(*content, data);
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__copy_revprops(const char *pack_file_dir,
                          const char *pack_filename,
@@ -1253,6 +1669,7 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
                          apr_array_header_t *sizes,
                          apr_size_t total_size,
                          int compression_level,
+                         svn_boolean_t indexed,
                          svn_boolean_t flush_to_disk,
                          svn_cancel_func_t cancel_func,
                          void *cancel_baton,
@@ -1261,19 +1678,10 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
   svn_stream_t *pack_stream;
   apr_file_t *pack_file;
   svn_revnum_t rev;
+  svn_stringbuf_t *uncompressed;
+  svn_stringbuf_t *compressed;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
 
-  /* create empty data buffer and a write stream on top of it */
-  svn_stringbuf_t *uncompressed
-    = svn_stringbuf_create_ensure(total_size, scratch_pool);
-  svn_stringbuf_t *compressed
-    = svn_stringbuf_create_empty(scratch_pool);
-  pack_stream = svn_stream_from_stringbuf(uncompressed, scratch_pool);
-
-  /* write the pack file header */
-  SVN_ERR(serialize_revprops_header(pack_stream, start_rev, sizes, 0,
-                                    sizes->nelts, iterpool));
-
   /* Some useful paths. */
   SVN_ERR(svn_io_file_open(&pack_file, svn_dirent_join(pack_file_dir,
                                                        pack_filename,
@@ -1281,6 +1689,29 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
                            APR_WRITE | APR_CREATE, APR_OS_DEFAULT,
                            scratch_pool));
 
+  if (indexed)
+    {
+      SVN_ERR(pack_indexed_revprops(&compressed, shard_path,
+                                    start_rev, end_rev, total_size,
+                                    compression_level,
+                                    cancel_func, cancel_baton,
+                                    scratch_pool, iterpool));
+      SVN_ERR(write_pack_file(pack_file, compressed, flush_to_disk,
+                              iterpool));
+      svn_pool_destroy(iterpool);
+
+      return SVN_NO_ERROR;
+    }
+
+  /* create empty data buffer and a write stream on top of it */
+  uncompressed = svn_stringbuf_create_ensure(total_size, scratch_pool);
+  compressed = svn_stringbuf_create_empty(scratch_pool);
+  pack_stream = svn_stream_from_stringbuf(uncompressed, scratch_pool);
+
+  /* write the pack file header */
+  SVN_ERR(serialize_revprops_header(pack_stream, start_rev, sizes, 0,
+                                    sizes->nelts, iterpool));
+
   /* Iterate over the revisions in this shard, squashing them together. */
   for (rev = start_rev; rev <= end_rev; rev++)
     {
@@ -1312,11 +1743,8 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
                         compressed, compression_level));
 
   /* write the pack file content to disk */
-  SVN_ERR(svn_io_file_write_full(pack_file, compressed->data, compressed->len,
-                                 NULL, scratch_pool));
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(pack_file, scratch_pool));
-  SVN_ERR(svn_io_file_close(pack_file, scratch_pool));
+  SVN_ERR(write_pack_file(pack_file, compressed, flush_to_disk,
+                          scratch_pool));
 
   svn_pool_destroy(iterpool);
 
@@ -1330,6 +1758,7 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
                                int max_files_per_dir,
                                apr_int64_t max_pack_size,
                                int compression_level,
+                               svn_boolean_t indexed,
                                svn_boolean_t flush_to_disk,
                                svn_cancel_func_t cancel_func,
                                void *cancel_baton,
@@ -1402,7 +1831,8 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
           SVN_ERR(svn_fs_fs__copy_revprops(pack_file_dir, pack_filename,
                                            shard_path, start_rev, rev-1,
                                            sizes, total_size,
-                                           compression_level, flush_to_disk,
+                                           compression_level, indexed,
+                                           flush_to_disk,
                                            cancel_func, cancel_baton,
                                            iterpool));
 
@@ -1430,7 +1860,8 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
     SVN_ERR(svn_fs_fs__copy_revprops(pack_file_dir, pack_filename,
                                      shard_path, start_rev, rev-1,
                                      sizes, (apr_size_t)total_size,
-                                     compression_level, flush_to_disk,
+                                     compression_level, indexed,
+                                     flush_to_disk,
                                      cancel_func, cancel_baton, iterpool));
 
   /* flush the manifest file to disk and update permissions */
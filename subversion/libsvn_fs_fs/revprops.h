@@ -109,7 +109,9 @@ svn_fs_fs__packed_revprop_available(svn_boolean_t *missing,
  * COMPRESSION_LEVEL defines how well the resulting pack file shall be
  * compressed or whether is shall be compressed at all.  TOTAL_SIZE is
  * a hint on which initial buffer size we should use to hold the pack file
- * content.
+ * content.  If INDEXED is set, write the indexed pack file format that
+ * compresses each revision's revprops individually and allows for reading
+ * and replacing them without processing the whole pack.
  *
  * If FLUSH_TO_DISK is non-zero, do not return until the data has actually
  * been written on the disk.  CANCEL_FUNC and CANCEL_BATON are used as usual.
@@ -124,6 +126,7 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
                          apr_array_header_t *sizes,
                          apr_size_t total_size,
                          int compression_level,
+                         svn_boolean_t indexed,
                          svn_boolean_t flush_to_disk,
                          svn_cancel_func_t cancel_func,
                          void *cancel_baton,
@@ -136,6 +139,8 @@ svn_fs_fs__copy_revprops(const char *pack_file_dir,
  * have no unpacked data anymore.  Call upgrade_cleanup_pack_revprops after
  * the bump.
  *
+ * INDEXED selects the pack file format, see svn_fs_fs__copy_revprops.
+ *
  * If FLUSH_TO_DISK is non-zero, do not return until the data has actually
  * been written on the disk.  CANCEL_FUNC and CANCEL_BATON areused in the
  * usual way.  Temporary allocations are done in SCRATCH_POOL.
@@ -147,6 +152,7 @@ svn_fs_fs__pack_revprops_shard(const char *pack_file_dir,
                                int max_files_per_dir,
                                apr_int64_t max_pack_size,
                                int compression_level,
+                               svn_boolean_t indexed,
                                svn_boolean_t flush_to_disk,
                                svn_cancel_func_t cancel_func,
                                void *cancel_baton,
@@ -0,0 +1,295 @@
+/* similarity.c : content fingerprints and content-defined chunking
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_sorts.h"
+
+#include "similarity.h"
+
+/* Chunks will be at least that long, unless the content ends early. */
+#define MIN_CHUNK_SIZE 0x100
+
+/* Chunks will be cut after that many bytes, even without a boundary. */
+#define MAX_CHUNK_SIZE 0x2000
+
+/* A chunk boundary is where the top bits of the rolling hash are all 0.
+ * With 10 bits, the average chunk is about MIN_CHUNK_SIZE + 1kB long. */
+#define BOUNDARY_SHIFT (32 - 10)
+
+/* FNV-1a parameters used to hash the chunk contents. */
+#define FNV1_BASE_32 0x811c9dc5
+#define FNV1_PRIME_32 0x01000193
+
+/* Boundaries of chunked representations use the top 20 bits, i.e. chunks
+ * are about SVN_FS_FS__CHUNK_MIN_SIZE + 1MB long on average. */
+#define CHUNKER_BOUNDARY_SHIFT (32 - 20)
+
+/* Per-byte values of the "gear" rolling hash.  Since the hash gets shifted
+ * by one bit per byte, its top bits depend on the last 32 bytes only.
+ *
+ * Fingerprints get stored in the rep-cache and chunk boundaries determine
+ * which chunks can be shared, i.e. these values must never change.  They
+ * have been derived from the integers 1 to 256 by a fixed integer mixing
+ * function. */
+static const apr_uint32_t gear[256] =
+{
+  0x0ab656ac, 0x82724c0e, 0xd3671dd6, 0xa0f55055,
+  0x643a0950, 0xf41d6d0e, 0xc0e014a3, 0xd0c8f25d,
+  0xb10940d6, 0xde5bf672, 0x20214f43, 0x7ddd5a3c,
+  0x76176b7a, 0x7d01ab76, 0xe5b6e935, 0xa48f1801,
+  0x8474aa4e, 0xc80356ac, 0xeff04ad2, 0x2044f192,
+  0x5f74af63, 0xab6554d4, 0xb1ef99eb, 0xfbbab478,
+  0x3f6968a0, 0x7a46409c, 0xccf51af8, 0x79f509ee,
+  0xfa6ada04, 0x1c36db75, 0xac6a274f, 0x4506356a,
+  0xc667ec19, 0x208dc18c, 0x8706ad16, 0x52b9b922,
+  0xeab79468, 0x514a7f7b, 0x3ed843a4, 0x9154c0bd,
+  0x272bff0a, 0xdf4f5038, 0x67b9641b, 0xe6e1f6ca,
+  0x8c94edbd, 0xcd767846, 0x01b3ba3e, 0xfb6209f6,
+  0xc89407df, 0x8ea5541c, 0x880cb02b, 0xb2f37ee7,
+  0x4b9890f1, 0x61985ab3, 0x490d1631, 0x5e786cd5,
+  0x8f9cbb18, 0xb4c6305f, 0x61bd206c, 0x80270cad,
+  0x910ca478, 0xe6edf0a7, 0x6534eff0, 0xaf78b9f0,
+  0x4ca58119, 0xdd99dea0, 0x7e657b88, 0x411b8319,
+  0xed169f99, 0xfc0cf3a1, 0x5fc14bb7, 0x175bc06d,
+  0x7fd5d112, 0x8145bb4b, 0xfd47e6b5, 0xa294fef6,
+  0x4ae7e705, 0x7db08748, 0x29364898, 0xa9f18073,
+  0x070d2ddb, 0x074d6ac0, 0x9cdee53f, 0x802a3cc0,
+  0x618852db, 0x7520df73, 0x0c6bc329, 0x15216ef3,
+  0xb225068d, 0x74709f0e, 0x86be7a8b, 0x535b72fe,
+  0x89b41965, 0x7fb1e9a7, 0x8f3cd6e4, 0x75ca0c37,
+  0xbcba864f, 0xec229830, 0x20573273, 0x2f2c0487,
+  0x4ce825d9, 0xa5b80f26, 0x6c77771e, 0x65e7fdcf,
+  0xb3be9b48, 0x57bdbe3f, 0x4f50a5f9, 0x5148271e,
+  0x5c82c6db, 0x2b234946, 0x349d25d5, 0x680ef004,
+  0xd02f0610, 0xe1ebf6ae, 0x1acc9ccb, 0x367db7c2,
+  0xfa399638, 0xc37a40d8, 0xd7cb6c9c, 0xc3010450,
+  0x57efcd02, 0xe63de70d, 0xc5a5c5ea, 0x732f240b,
+  0x081edb24, 0x652afeda, 0xd5e11e7a, 0xb46e39f5,
+  0x72c50a2d, 0x9f39bc54, 0xcd9c842d, 0x010544e6,
+  0xb46e19ef, 0x7f86b595, 0xdd79f87d, 0xd35844a9,
+  0x3ac36a48, 0x71ccab4e, 0xe7a54c11, 0x9c42679c,
+  0xb181c965, 0x3c86fbcf, 0x86364bc4, 0xf16aadc3,
+  0x5099179f, 0xffaba225, 0xc83cc155, 0x258268ee,
+  0xc47d4384, 0xfa8ecd6a, 0x220db024, 0xf4d947cd,
+  0x1110497f, 0x216aaf7b, 0x309d2122, 0x6d4998b9,
+  0xe40b725b, 0x1ec6184f, 0xd658affc, 0x53e200e6,
+  0xa804695c, 0x9c32c99e, 0x9d8ee83a, 0x611eac85,
+  0xa57a65c4, 0x45643c99, 0x9e99a2d5, 0x7a847c0d,
+  0x32f22673, 0xdd6e5a74, 0x67861b1f, 0x9823f184,
+  0x3061e7f9, 0xb2a501fc, 0xd9fb1641, 0x38fe27d7,
+  0x17d391cc, 0x9e96200e, 0xd256a4ee, 0xdac107a5,
+  0x85fdb6c4, 0x7a367d88, 0xe40c1eff, 0xd9dc2eeb,
+  0x10454b3f, 0x6433abec, 0x0cc97243, 0xff63d34f,
+  0x43d3a622, 0xf7bfd53f, 0xbc8e6085, 0x202f8218,
+  0x49ddda3e, 0x3c552062, 0x54106d32, 0xb4eb88fa,
+  0x26c10788, 0x0360d1e5, 0x3c87a368, 0x91b18632,
+  0x52922302, 0x99d04bb2, 0xc94986e7, 0x244ceafb,
+  0x2259ea7e, 0xccc05dc6, 0xd7a880af, 0xf9b49fa1,
+  0x2d295a52, 0x894e7441, 0xd654c0fb, 0x7f631b92,
+  0xae46864b, 0x9d9fffcc, 0x407e8c83, 0x39ab9247,
+  0x10fa9aca, 0x6c105a03, 0x222821a3, 0x6dc6bf70,
+  0x75cb07d8, 0x84b2e8c7, 0x465ae309, 0xd01de009,
+  0x08382132, 0x4fef53c1, 0xc5db6346, 0x86885a4f,
+  0xa489a9a8, 0xc3b1cfbf, 0x26dd67b8, 0x9665ea6e,
+  0xcd6737da, 0x665abe58, 0xc23dae58, 0x0b0d293c,
+  0xa0c18f16, 0x19c045fb, 0x6e22e426, 0x141b9ab9,
+  0xbe8bcc8b, 0x6d8bf1c1, 0xa3bba56d, 0xdbd5850d,
+  0x0c419c61, 0xadf6b79c, 0x0bb77d1b, 0xb43edb6e,
+  0xe89a76bd, 0xebb5b249, 0xdb97d821, 0xeb9b8d84,
+  0x8a623eaf, 0x42113a1e, 0x9877bd28, 0xd94e63a1
+};
+
+struct svn_fs_fs__similarity_t
+{
+  /* Number of bytes processed so far.  Never exceeds the prefix size. */
+  apr_size_t processed;
+
+  /* Current rolling hash value. */
+  apr_uint32_t rolling;
+
+  /* FNV-1a hash and length of the current chunk. */
+  apr_uint32_t chunk_hash;
+  apr_size_t chunk_len;
+
+  /* The smallest chunk hashes found so far, sorted in ascending order. */
+  apr_uint32_t smallest[SVN_FS_FS__SIMILARITY_FINGERPRINTS];
+  int count;
+};
+
+/* Add the chunk HASH to the sorted array SMALLEST of *COUNT elements,
+ * keeping only the SVN_FS_FS__SIMILARITY_FINGERPRINTS smallest values. */
+static void
+add_chunk_hash(apr_uint32_t *smallest,
+               int *count,
+               apr_uint32_t hash)
+{
+  int i;
+
+  /* Find the insertion point and ignore duplicates. */
+  for (i = 0; i < *count && smallest[i] < hash; ++i)
+    ;
+  if (i < *count && smallest[i] == hash)
+    return;
+  if (i == SVN_FS_FS__SIMILARITY_FINGERPRINTS)
+    return;
+
+  if (*count < SVN_FS_FS__SIMILARITY_FINGERPRINTS)
+    ++*count;
+  memmove(smallest + i + 1, smallest + i,
+          (*count - i - 1) * sizeof(*smallest));
+  smallest[i] = hash;
+}
+
+svn_fs_fs__similarity_t *
+svn_fs_fs__similarity_create(apr_pool_t *result_pool)
+{
+  svn_fs_fs__similarity_t *similarity
+    = apr_pcalloc(result_pool, sizeof(*similarity));
+
+  similarity->chunk_hash = FNV1_BASE_32;
+
+  return similarity;
+}
+
+void
+svn_fs_fs__similarity_update(svn_fs_fs__similarity_t *similarity,
+                             const char *data,
+                             apr_size_t len)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  const unsigned char *end;
+  apr_uint32_t rolling = similarity->rolling;
+  apr_uint32_t chunk_hash = similarity->chunk_hash;
+  apr_size_t chunk_len = similarity->chunk_len;
+
+  len = MIN(len, SVN_FS_FS__SIMILARITY_PREFIX_SIZE - similarity->processed);
+  similarity->processed += len;
+
+  for (end = p + len; p < end; ++p)
+    {
+      rolling = (rolling << 1) + gear[*p];
+      chunk_hash = (chunk_hash ^ *p) * FNV1_PRIME_32;
+      ++chunk_len;
+
+      if (   (chunk_len >= MIN_CHUNK_SIZE && (rolling >> BOUNDARY_SHIFT) == 0)
+          || chunk_len >= MAX_CHUNK_SIZE)
+        {
+          add_chunk_hash(similarity->smallest, &similarity->count,
+                         chunk_hash);
+          chunk_hash = FNV1_BASE_32;
+          chunk_len = 0;
+        }
+    }
+
+  similarity->rolling = rolling;
+  similarity->chunk_hash = chunk_hash;
+  similarity->chunk_len = chunk_len;
+}
+
+apr_array_header_t *
+svn_fs_fs__similarity_fingerprints(const svn_fs_fs__similarity_t *similarity,
+                                   apr_pool_t *result_pool)
+{
+  apr_uint32_t smallest[SVN_FS_FS__SIMILARITY_FINGERPRINTS];
+  int count = similarity->count;
+  apr_array_header_t *result;
+  int i;
+
+  memcpy(smallest, similarity->smallest, sizeof(smallest));
+
+  /* The last chunk is complete only if the content ended before the
+   * prefix size limit.  Otherwise, it would depend on where that limit
+   * happens to cut the data. */
+  if (   similarity->chunk_len
+      && similarity->processed < SVN_FS_FS__SIMILARITY_PREFIX_SIZE)
+    add_chunk_hash(smallest, &count, similarity->chunk_hash);
+
+  result = apr_array_make(result_pool, count, sizeof(apr_uint32_t));
+  for (i = 0; i < count; ++i)
+    APR_ARRAY_PUSH(result, apr_uint32_t) = smallest[i];
+
+  return result;
+}
+
+struct svn_fs_fs__chunker_t
+{
+  /* Current rolling hash value. */
+  apr_uint32_t rolling;
+
+  /* Length of the current chunk so far. */
+  apr_size_t chunk_len;
+};
+
+svn_fs_fs__chunker_t *
+svn_fs_fs__chunker_create(apr_pool_t *result_pool)
+{
+  return apr_pcalloc(result_pool, sizeof(svn_fs_fs__chunker_t));
+}
+
+apr_size_t
+svn_fs_fs__chunker_scan(svn_fs_fs__chunker_t *chunker,
+                        const char *data,
+                        apr_size_t len,
+                        svn_boolean_t *boundary)
+{
+  const unsigned char *p = (const unsigned char *)data;
+  const unsigned char *end;
+  apr_uint32_t rolling = chunker->rolling;
+  apr_size_t chunk_len = chunker->chunk_len;
+
+  /* Bytes before the minimum chunk size cannot end the chunk.  Skip them
+   * but keep the rolling hash up to date for the last 32 of them. */
+  if (chunk_len + len < SVN_FS_FS__CHUNK_MIN_SIZE)
+    {
+      chunker->chunk_len += len;
+      for (end = p + len, p = end - MIN(len, 32); p < end; ++p)
+        rolling = (rolling << 1) + gear[*p];
+
+      chunker->rolling = rolling;
+      *boundary = FALSE;
+      return len;
+    }
+
+  for (end = p + len; p < end; ++p)
+    {
+      rolling = (rolling << 1) + gear[*p];
+      ++chunk_len;
+
+      if (   (   chunk_len >= SVN_FS_FS__CHUNK_MIN_SIZE
+              && (rolling >> CHUNKER_BOUNDARY_SHIFT) == 0)
+          || chunk_len >= SVN_FS_FS__CHUNK_MAX_SIZE)
+        {
+          chunker->rolling = 0;
+          chunker->chunk_len = 0;
+          *boundary = TRUE;
+
+          return (const char *)p + 1 - data;
+        }
+    }
+
+  chunker->rolling = rolling;
+  chunker->chunk_len = chunk_len;
+  *boundary = FALSE;
+
+  return len;
+}
@@ -0,0 +1,101 @@
+/* similarity.h : content fingerprints and content-defined chunking
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_SIMILARITY_H
+#define SVN_LIBSVN_FS_FS_SIMILARITY_H
+
+#include <apr_pools.h>
+#include <apr_tables.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Similarity fingerprints are taken from this many leading bytes of a
+ * file representation.  When writing a new file without a predecessor,
+ * that much content will be buffered before a delta base is chosen. */
+#define SVN_FS_FS__SIMILARITY_PREFIX_SIZE 0x10000
+
+/* Maximum number of fingerprints per representation. */
+#define SVN_FS_FS__SIMILARITY_FINGERPRINTS 8
+
+/* The content is split into chunks at content-defined boundaries and
+ * the smallest SVN_FS_FS__SIMILARITY_FINGERPRINTS chunk hashes form the
+ * fingerprint set.  Files that share much of their leading content will
+ * therefore share most of their fingerprints, even if some data has been
+ * inserted or removed.  This is the opaque calculation state. */
+typedef struct svn_fs_fs__similarity_t svn_fs_fs__similarity_t;
+
+/* Return a new fingerprint calculation state allocated in RESULT_POOL. */
+svn_fs_fs__similarity_t *
+svn_fs_fs__similarity_create(apr_pool_t *result_pool);
+
+/* Feed the next LEN bytes of content in DATA into SIMILARITY.  Data
+ * beyond SVN_FS_FS__SIMILARITY_PREFIX_SIZE will be ignored. */
+void
+svn_fs_fs__similarity_update(svn_fs_fs__similarity_t *similarity,
+                             const char *data,
+                             apr_size_t len);
+
+/* Return the fingerprints (apr_uint32_t) of the content fed into
+ * SIMILARITY so far, allocated in RESULT_POOL.  The result may be empty
+ * for very short contents.  SIMILARITY itself is not modified. */
+apr_array_header_t *
+svn_fs_fs__similarity_fingerprints(const svn_fs_fs__similarity_t *similarity,
+                                   apr_pool_t *result_pool);
+
+/* Chunks of chunked representations will be at least this long, unless
+ * the file ends early. */
+#define SVN_FS_FS__CHUNK_MIN_SIZE 0x40000
+
+/* Chunks of chunked representations will be cut after this many bytes,
+ * even if the content did not produce a boundary. */
+#define SVN_FS_FS__CHUNK_MAX_SIZE 0x400000
+
+/* Large file contents get split into chunks at positions that depend on
+ * the local content only.  Inserting or removing data will therefore
+ * change only the chunks around the modification and all others can be
+ * shared with the previous version of the file.  This is the opaque
+ * calculation state. */
+typedef struct svn_fs_fs__chunker_t svn_fs_fs__chunker_t;
+
+/* Return a new chunking state allocated in RESULT_POOL. */
+svn_fs_fs__chunker_t *
+svn_fs_fs__chunker_create(apr_pool_t *result_pool);
+
+/* Scan the next LEN bytes of content in DATA using CHUNKER and return
+ * how many of them belong to the current chunk.  If that chunk ends
+ * within DATA, set *BOUNDARY to TRUE and start a new chunk with the
+ * remaining data.  Otherwise, set *BOUNDARY to FALSE and return LEN. */
+apr_size_t
+svn_fs_fs__chunker_scan(svn_fs_fs__chunker_t *chunker,
+                        const char *data,
+                        apr_size_t len,
+                        svn_boolean_t *boundary);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_FS_FS_SIMILARITY_H */
@@ -164,6 +164,9 @@ typedef struct revision_info_t
   svn_fs_fs__revision_file_t *rev_file;
 } revision_info_t;
 
+/* Upper limit to the number of pack files being scanned concurrently. */
+#define MAX_STATS_JOBS 256
+
 /* Root data structure containing all information about a given repository.
  * We use it as a wrapper around svn_fs_t and pass it around where we would
  * otherwise just use a svn_fs_t.
@@ -203,8 +206,65 @@ typedef struct query_t
 
   /* Baton for CANCEL_FUNC. */
   void *cancel_baton;
+
+  /* Number of pack files to scan concurrently.  Between 1 and
+   * MAX_STATS_JOBS. */
+  int jobs;
+
+  /* Directory containing the scan results of previous runs for packed
+   * shards.  NULL if results shall neither be reused nor stored. */
+  const char *cache_dir;
 } query_t;
 
+/* A noderev as far as relevant to the statistics. */
+typedef struct noderev_info_t
+{
+  /* Revision that contains the noderev. */
+  svn_revnum_t revision;
+
+  /* Node kind, i.e. file or directory. */
+  svn_node_kind_t kind;
+
+  /* Size of the noderev struct in the rev / pack file in bytes. */
+  apr_size_t size;
+
+  /* Text and property representations.  Either may be NULL. */
+  representation_t *data_rep;
+  representation_t *prop_rep;
+
+  /* Path at which this node first came into existence. */
+  const char *created_path;
+
+  /* Whether this node has a predecessor. */
+  svn_boolean_t has_predecessor;
+} noderev_info_t;
+
+/* Contents of a single logically addressed rev / pack file, as far as
+ * relevant to the statistics.  Gathering this data only reads the file
+ * and does not depend on other revisions.  Therefore, it may happen
+ * concurrently for multiple files and even be stored for packed shards.
+ * The results then get added to the query in revision order. */
+typedef struct file_scan_t
+{
+  /* First revision in the file and number of revisions in it. */
+  svn_revnum_t base;
+  int count;
+
+  /* Size of the file as covered by the p2l index. */
+  apr_off_t max_offset;
+
+  /* Number of changes and size of the changes lists for each of the
+   * COUNT revisions. */
+  apr_uint64_t *change_count;
+  apr_uint64_t *changes_len;
+
+  /* All noderev_info_t * in file order. */
+  apr_array_header_t *noderevs;
+
+  /* The rep_ref_t * of all representations in file order. */
+  apr_array_header_t *rep_refs;
+} file_scan_t;
+
 /* Initialize the LARGEST_CHANGES member in STATS with a capacity of COUNT
  * entries.  Allocate the result in RESULT_POOL.
  */
@@ -596,27 +656,41 @@ parse_dir(query_t *query,
   return SVN_NO_ERROR;
 }
 
-/* Parse the noderev given as NODEREV_STR and store the info in QUERY and
- * REVISION_INFO.  In phys. addressing mode, continue reading all DAG nodes,
- * directories and representations linked in that tree structure.
+/* Set *INFO to the parts of NODEREV relevant to the statistics for a
+ * noderev struct of SIZE bytes in REVISION.  *INFO will reference the
+ * data in NODEREV.
+ */
+static void
+init_noderev_info(noderev_info_t *info,
+                  node_revision_t *noderev,
+                  apr_size_t size,
+                  svn_revnum_t revision)
+{
+  info->revision = revision;
+  info->kind = noderev->kind;
+  info->size = size;
+  info->data_rep = noderev->data_rep;
+  info->prop_rep = noderev->prop_rep;
+  info->created_path = noderev->created_path;
+  info->has_predecessor = noderev->predecessor_id != NULL;
+}
+
+/* Store the info on NODEREV in QUERY and REVISION_INFO.  Return the stats
+ * of its text representation in *TEXT; NULL if it has none.
  *
  * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
  * temporaries.
  */
 static svn_error_t *
-read_noderev(query_t *query,
-             svn_stringbuf_t *noderev_str,
-             revision_info_t *revision_info,
-             apr_pool_t *result_pool,
-             apr_pool_t *scratch_pool)
+add_noderev(rep_stats_t **text_p,
+            query_t *query,
+            const noderev_info_t *noderev,
+            revision_info_t *revision_info,
+            apr_pool_t *result_pool,
+            apr_pool_t *scratch_pool)
 {
   rep_stats_t *text = NULL;
   rep_stats_t *props = NULL;
-  node_revision_t *noderev;
-
-  svn_stream_t *stream = svn_stream_from_stringbuf(noderev_str, scratch_pool);
-  SVN_ERR(svn_fs_fs__read_noderev(&noderev, stream, scratch_pool,
-                                  scratch_pool));
 
   if (noderev->data_rep)
     {
@@ -644,31 +718,63 @@ read_noderev(query_t *query,
   /* record largest changes */
   if (text && text->ref_count == 1)
     add_change(query->stats, text->size, text->expanded_size, text->revision,
-               noderev->created_path, text->kind, !noderev->predecessor_id);
+               noderev->created_path, text->kind, !noderev->has_predecessor);
   if (props && props->ref_count == 1)
     add_change(query->stats, props->size, props->expanded_size,
                props->revision, noderev->created_path, props->kind,
-               !noderev->predecessor_id);
-
-  /* if this is a directory and has not been processed, yet, read and
-   * process it recursively */
-  if (   noderev->kind == svn_node_dir && text && text->ref_count == 1
-      && !svn_fs_fs__use_log_addressing(query->fs))
-    SVN_ERR(parse_dir(query, noderev, revision_info, result_pool,
-                      scratch_pool));
+               !noderev->has_predecessor);
 
   /* update stats */
   if (noderev->kind == svn_node_dir)
     {
-      revision_info->dir_noderev_size += noderev_str->len;
+      revision_info->dir_noderev_size += noderev->size;
       revision_info->dir_noderev_count++;
     }
   else
     {
-      revision_info->file_noderev_size += noderev_str->len;
+      revision_info->file_noderev_size += noderev->size;
       revision_info->file_noderev_count++;
     }
 
+  *text_p = text;
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the noderev given as NODEREV_STR and store the info in QUERY and
+ * REVISION_INFO.  Continue reading all DAG nodes, directories and
+ * representations linked in that tree structure.  Only called in phys.
+ * addressing mode.
+ *
+ * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
+ * temporaries.
+ */
+static svn_error_t *
+read_noderev(query_t *query,
+             svn_stringbuf_t *noderev_str,
+             revision_info_t *revision_info,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+  rep_stats_t *text;
+  node_revision_t *noderev;
+  noderev_info_t info;
+
+  svn_stream_t *stream = svn_stream_from_stringbuf(noderev_str, scratch_pool);
+  SVN_ERR(svn_fs_fs__read_noderev(&noderev, stream, scratch_pool,
+                                  scratch_pool));
+
+  init_noderev_info(&info, noderev, noderev_str->len,
+                    revision_info->revision);
+  SVN_ERR(add_noderev(&text, query, &info, revision_info, result_pool,
+                      scratch_pool));
+
+  /* if this is a directory and has not been processed, yet, read and
+   * process it recursively */
+  if (noderev->kind == svn_node_dir && text && text->ref_count == 1)
+    SVN_ERR(parse_dir(query, noderev, revision_info, result_pool,
+                      scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -984,68 +1090,62 @@ resolve_representation_refs(query_t *query,
   return SVN_NO_ERROR;
 }
 
-/* Process the logically addressed revision contents of revisions BASE to
- * BASE + COUNT - 1 in QUERY.
+/* Read the logically addressed revision contents of revisions BASE to
+ * BASE + COUNT - 1 in FS and return them in *SCAN.  Only read access to
+ * FS is required.  Call CANCEL_FUNC with CANCEL_BATON once in a while.
  *
- * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
- * temporaries.
+ * Allocate *SCAN in RESULT_POOL and use SCRATCH_POOL for temporaries.
  */
 static svn_error_t *
-read_log_rev_or_packfile(query_t *query,
+scan_log_rev_or_packfile(file_scan_t **scan,
+                         svn_fs_t *fs,
                          svn_revnum_t base,
                          int count,
+                         svn_cancel_func_t cancel_func,
+                         void *cancel_baton,
                          apr_pool_t *result_pool,
                          apr_pool_t *scratch_pool)
 {
-  fs_fs_data_t *ffd = query->fs->fsap_data;
+  fs_fs_data_t *ffd = fs->fsap_data;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  apr_off_t max_offset;
   apr_off_t offset = 0;
   int i;
   svn_fs_fs__revision_file_t *rev_file;
+  file_scan_t *result = apr_pcalloc(result_pool, sizeof(*result));
 
-  /* We collect the delta chain links as we scan the file.  Afterwards,
-   * we determine the lengths of those delta chains and throw this
-   * temporary container away. */
-  apr_array_header_t *rep_refs = apr_array_make(scratch_pool, 64,
-                                                sizeof(rep_ref_t *));
-
-  /* we will process every revision in the rev / pack file */
-  for (i = 0; i < count; ++i)
-    {
-      /* create the revision info for the current rev */
-      revision_info_t *info = apr_pcalloc(result_pool, sizeof(*info));
-      info->representations = apr_array_make(result_pool, 4,
-                                             sizeof(rep_stats_t*));
-      info->revision = base + i;
+  result->base = base;
+  result->count = count;
+  result->change_count = apr_pcalloc(result_pool,
+                                     count * sizeof(*result->change_count));
+  result->changes_len = apr_pcalloc(result_pool,
+                                    count * sizeof(*result->changes_len));
+  result->noderevs = apr_array_make(result_pool, 64,
+                                    sizeof(noderev_info_t *));
 
-      APR_ARRAY_PUSH(query->revisions, revision_info_t*) = info;
-    }
+  /* We collect the delta chain links as we scan the file.  Their lengths
+   * get determined when adding the scan results to the query. */
+  result->rep_refs = apr_array_make(result_pool, 64, sizeof(rep_ref_t *));
 
   /* open the pack / rev file that is covered by the p2l index */
-  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, query->fs, base,
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, base,
                                            scratch_pool, iterpool));
-  SVN_ERR(svn_fs_fs__p2l_get_max_offset(&max_offset, query->fs, rev_file,
+  SVN_ERR(svn_fs_fs__p2l_get_max_offset(&result->max_offset, fs, rev_file,
                                         base, scratch_pool));
 
-  /* record the whole pack size in the first rev so the total sum will
-     still be correct */
-  APR_ARRAY_IDX(query->revisions, base, revision_info_t*)->end = max_offset;
-
   /* for all offsets in the file, get the P2L index entries and process
      the interesting items (change lists, noderevs) */
-  for (offset = 0; offset < max_offset; )
+  for (offset = 0; offset < result->max_offset; )
     {
       apr_array_header_t *entries;
 
       svn_pool_clear(iterpool);
 
       /* cancellation support */
-      if (query->cancel_func)
-        SVN_ERR(query->cancel_func(query->cancel_baton));
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
 
       /* get all entries for the current block */
-      SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, query->fs, rev_file, base,
+      SVN_ERR(svn_fs_fs__p2l_index_lookup(&entries, fs, rev_file, base,
                                           offset, ffd->p2l_page_size,
                                           iterpool, iterpool));
 
@@ -1053,7 +1153,6 @@ read_log_rev_or_packfile(query_t *query,
       for (i = 0; i < entries->nelts; ++i)
         {
           svn_stringbuf_t *item;
-          revision_info_t *info;
           svn_fs_fs__p2l_entry_t *entry
             = &APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t);
 
@@ -1066,20 +1165,29 @@ read_log_rev_or_packfile(query_t *query,
             continue;
 
           /* read and process interesting items */
-          info = APR_ARRAY_IDX(query->revisions, entry->item.revision,
-                               revision_info_t*);
-
           if (entry->type == SVN_FS_FS__ITEM_TYPE_NODEREV)
             {
+              node_revision_t *noderev;
+              noderev_info_t *info = apr_pcalloc(result_pool, sizeof(*info));
+
               SVN_ERR(read_item(&item, rev_file, entry, iterpool, iterpool));
-              SVN_ERR(read_noderev(query, item, info, result_pool, iterpool));
+              SVN_ERR(svn_fs_fs__read_noderev(&noderev,
+                                        svn_stream_from_stringbuf(item,
+                                                                  iterpool),
+                                        result_pool, iterpool));
+
+              init_noderev_info(info, noderev, item->len,
+                                entry->item.revision);
+              APR_ARRAY_PUSH(result->noderevs, noderev_info_t *) = info;
             }
           else if (entry->type == SVN_FS_FS__ITEM_TYPE_CHANGES)
             {
+              apr_size_t idx = (apr_size_t)(entry->item.revision - base);
+
               SVN_ERR(read_item(&item, rev_file, entry, iterpool, iterpool));
-              info->change_count
+              result->change_count[idx]
                 = get_log_change_count(item->data + 0, item->len);
-              info->changes_len += entry->size;
+              result->changes_len[idx] += entry->size;
             }
           else if (   (entry->type == SVN_FS_FS__ITEM_TYPE_FILE_REP)
                    || (entry->type == SVN_FS_FS__ITEM_TYPE_DIR_REP)
@@ -1088,7 +1196,7 @@ read_log_rev_or_packfile(query_t *query,
             {
               /* Collect the delta chain link. */
               svn_fs_fs__rep_header_t *header;
-              rep_ref_t *ref = apr_pcalloc(scratch_pool, sizeof(*ref));
+              rep_ref_t *ref = apr_pcalloc(result_pool, sizeof(*ref));
 
               SVN_ERR(svn_io_file_aligned_seek(rev_file->file,
                                                rev_file->block_size,
@@ -1113,7 +1221,7 @@ read_log_rev_or_packfile(query_t *query,
                   ref->base_revision = SVN_INVALID_REVNUM;
                 }
 
-              APR_ARRAY_PUSH(rep_refs, rep_ref_t *) = ref;
+              APR_ARRAY_PUSH(result->rep_refs, rep_ref_t *) = ref;
             }
 
           /* advance offset */
@@ -1121,8 +1229,7 @@ read_log_rev_or_packfile(query_t *query,
         }
     }
 
-  /* Resolve the delta chain links. */
-  SVN_ERR(resolve_representation_refs(query, rep_refs));
+  *scan = result;
 
   /* clean up and close file handles */
   svn_pool_destroy(iterpool);
@@ -1130,6 +1237,475 @@ read_log_rev_or_packfile(query_t *query,
   return SVN_NO_ERROR;
 }
 
+/* Add the rev / pack file contents in SCAN to QUERY.  SCAN must directly
+ * follow the revisions already in QUERY.
+ *
+ * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
+ * temporaries.
+ */
+static svn_error_t *
+add_file_scan(query_t *query,
+              file_scan_t *scan,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  SVN_ERR_ASSERT(query->revisions->nelts == scan->base);
+
+  /* we will process every revision in the rev / pack file */
+  for (i = 0; i < scan->count; ++i)
+    {
+      /* create the revision info for the current rev */
+      revision_info_t *info = apr_pcalloc(result_pool, sizeof(*info));
+      info->representations = apr_array_make(result_pool, 4,
+                                             sizeof(rep_stats_t*));
+      info->revision = scan->base + i;
+      info->change_count = scan->change_count[i];
+      info->changes_len = scan->changes_len[i];
+
+      APR_ARRAY_PUSH(query->revisions, revision_info_t*) = info;
+    }
+
+  /* record the whole pack size in the first rev so the total sum will
+     still be correct */
+  APR_ARRAY_IDX(query->revisions, scan->base, revision_info_t*)->end
+    = scan->max_offset;
+
+  /* Rep sharing and delta chains may refer to earlier revisions.  Hence,
+   * we must process the noderevs in revision order. */
+  for (i = 0; i < scan->noderevs->nelts; ++i)
+    {
+      rep_stats_t *text;
+      const noderev_info_t *noderev
+        = APR_ARRAY_IDX(scan->noderevs, i, const noderev_info_t *);
+      revision_info_t *info
+        = APR_ARRAY_IDX(query->revisions, noderev->revision,
+                        revision_info_t *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(add_noderev(&text, query, noderev, info, result_pool,
+                          iterpool));
+    }
+
+  /* Resolve the delta chain links. */
+  SVN_ERR(resolve_representation_refs(query, scan->rep_refs));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Process the logically addressed revision contents of revisions BASE to
+ * BASE + COUNT - 1 in QUERY.
+ *
+ * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
+ * temporaries.
+ */
+static svn_error_t *
+read_log_rev_or_packfile(query_t *query,
+                         svn_revnum_t base,
+                         int count,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  file_scan_t *scan;
+
+  SVN_ERR(scan_log_rev_or_packfile(&scan, query->fs, base, count,
+                                   query->cancel_func, query->cancel_baton,
+                                   scratch_pool, scratch_pool));
+  SVN_ERR(add_file_scan(query, scan, result_pool, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Scan results for packed shards are cached in files named after the
+ * first revision of the shard.  They start with this line, followed by
+ * a line giving the repository UUID and instance ID as well as the first
+ * revision, number of revisions and size of the pack file, e.g.
+ *
+ *   <uuid> <instance-id> <base> <count> <max-offset>
+ *
+ * Then follow COUNT lines "<change-count> <changes-len>", one for each
+ * revision, and a line giving the number of noderevs.  Each noderev is
+ * written as
+ *
+ *   <revision> <d|f> <size> <has-predecessor> <text> <props> <path>
+ *
+ * where <text> and <props> are "-" or of the form
+ * "<revision>/<item-index>/<size>/<expanded-size>".  The remaining lines
+ * describe the delta chain links of all representations:
+ *
+ *   <revision> <item-index> <base-revision> <base-item-index> <header-size>
+ */
+#define STATS_CACHE_HEADER "stats-cache 1\n"
+
+/* Return the path of the file caching the scan results for the packed
+ * shard starting at BASE in QUERY.  Allocate the result in POOL. */
+static const char *
+stats_cache_path(const query_t *query,
+                 svn_revnum_t base,
+                 apr_pool_t *pool)
+{
+  return svn_dirent_join(query->cache_dir,
+                         apr_psprintf(pool, "%ld", base),
+                         pool);
+}
+
+/* Return the line in the stats cache that identifies the packed shard of
+ * COUNT revisions starting at BASE in FS.  The pack file size is not part
+ * of it.  Allocate the result in POOL. */
+static const char *
+stats_cache_id(svn_fs_t *fs,
+               svn_revnum_t base,
+               int count,
+               apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  return apr_psprintf(pool, "%s %s %ld %d", fs->uuid, ffd->instance_id,
+                      base, count);
+}
+
+/* Append REP to BUFFER in the stats cache format. */
+static void
+write_cached_rep(svn_stringbuf_t *buffer,
+                 const representation_t *rep)
+{
+  char number[SVN_INT64_BUFFER_SIZE];
+
+  if (!rep)
+    {
+      svn_stringbuf_appendbyte(buffer, '-');
+      return;
+    }
+
+  svn_stringbuf_appendbytes(buffer, number,
+                            svn__i64toa(number, rep->revision));
+  svn_stringbuf_appendbyte(buffer, '/');
+  svn_stringbuf_appendbytes(buffer, number,
+                            svn__ui64toa(number, rep->item_index));
+  svn_stringbuf_appendbyte(buffer, '/');
+  svn_stringbuf_appendbytes(buffer, number,
+                            svn__i64toa(number, rep->size));
+  svn_stringbuf_appendbyte(buffer, '/');
+  svn_stringbuf_appendbytes(buffer, number,
+                            svn__i64toa(number, rep->expanded_size));
+}
+
+/* Store SCAN for the packed shard of FS in the stats cache of QUERY.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_stats_cache(const query_t *query,
+                  svn_fs_t *fs,
+                  const file_scan_t *scan,
+                  apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buffer = svn_stringbuf_create(STATS_CACHE_HEADER,
+                                                 scratch_pool);
+  int i;
+
+  svn_stringbuf_appendcstr(buffer,
+                           apr_psprintf(scratch_pool, "%s %" APR_OFF_T_FMT
+                                        "\n",
+                                        stats_cache_id(fs, scan->base,
+                                                       scan->count,
+                                                       scratch_pool),
+                                        scan->max_offset));
+
+  for (i = 0; i < scan->count; ++i)
+    svn_stringbuf_appendcstr(buffer,
+                             apr_psprintf(scratch_pool,
+                                          "%" APR_UINT64_T_FMT
+                                          " %" APR_UINT64_T_FMT "\n",
+                                          scan->change_count[i],
+                                          scan->changes_len[i]));
+
+  svn_stringbuf_appendcstr(buffer,
+                           apr_psprintf(scratch_pool, "%d\n",
+                                        scan->noderevs->nelts));
+  for (i = 0; i < scan->noderevs->nelts; ++i)
+    {
+      const noderev_info_t *noderev
+        = APR_ARRAY_IDX(scan->noderevs, i, const noderev_info_t *);
+
+      svn_stringbuf_appendcstr(buffer,
+                               apr_psprintf(scratch_pool, "%ld %c %"
+                                            APR_SIZE_T_FMT " %d ",
+                                            noderev->revision,
+                                            noderev->kind == svn_node_dir
+                                              ? 'd' : 'f',
+                                            noderev->size,
+                                            noderev->has_predecessor));
+      write_cached_rep(buffer, noderev->data_rep);
+      svn_stringbuf_appendbyte(buffer, ' ');
+      write_cached_rep(buffer, noderev->prop_rep);
+      svn_stringbuf_appendbyte(buffer, ' ');
+      svn_stringbuf_appendcstr(buffer, noderev->created_path);
+      svn_stringbuf_appendbyte(buffer, '\n');
+    }
+
+  for (i = 0; i < scan->rep_refs->nelts; ++i)
+    {
+      const rep_ref_t *ref = APR_ARRAY_IDX(scan->rep_refs, i,
+                                           const rep_ref_t *);
+
+      svn_stringbuf_appendcstr(buffer,
+                               apr_psprintf(scratch_pool,
+                                            "%ld %" APR_UINT64_T_FMT
+                                            " %ld %" APR_UINT64_T_FMT
+                                            " %d\n",
+                                            ref->revision, ref->item_index,
+                                            ref->base_revision,
+                                            ref->base_item_index,
+                                            (int)ref->header_size));
+    }
+
+  return svn_error_trace(svn_io_write_atomic2(stats_cache_path(query,
+                                                               scan->base,
+                                                               scratch_pool),
+                                              buffer->data, buffer->len,
+                                              NULL, FALSE, scratch_pool));
+}
+
+/* Return an error for the malformed stats cache file at PATH.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+malformed_stats_cache(const char *path,
+                      apr_pool_t *scratch_pool)
+{
+  return svn_error_createf(SVN_ERR_MALFORMED_FILE, NULL,
+                           _("Malformed stats cache file '%s'"),
+                           svn_dirent_local_style(path, scratch_pool));
+}
+
+/* Parse the next token in *LINE, delimited by SEPARATOR, as a number and
+ * return it in *VALUE.  Advance *LINE behind it.  Report errors for the
+ * stats cache file at PATH. */
+static svn_error_t *
+read_cached_number(apr_int64_t *value,
+                   char **line,
+                   const char *separator,
+                   const char *path,
+                   apr_pool_t *scratch_pool)
+{
+  const char *token = svn_cstring_tokenize(separator, line);
+  if (!token)
+    return malformed_stats_cache(path, scratch_pool);
+
+  return svn_error_trace(svn_cstring_atoi64(value, token));
+}
+
+/* Parse the next token in *LINE as a representation written by
+ * write_cached_rep() and return it in *REP, allocated in RESULT_POOL.
+ * Advance *LINE behind it.  Report errors for the stats cache file at
+ * PATH.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_cached_rep(representation_t **rep,
+                char **line,
+                const char *path,
+                apr_pool_t *result_pool,
+                apr_pool_t *scratch_pool)
+{
+  char *token = svn_cstring_tokenize(" ", line);
+  apr_int64_t value;
+
+  *rep = NULL;
+  if (!token)
+    return malformed_stats_cache(path, scratch_pool);
+  if (strcmp(token, "-") == 0)
+    return SVN_NO_ERROR;
+
+  *rep = apr_pcalloc(result_pool, sizeof(**rep));
+  SVN_ERR(read_cached_number(&value, &token, "/", path, scratch_pool));
+  (*rep)->revision = (svn_revnum_t)value;
+  SVN_ERR(read_cached_number(&value, &token, "/", path, scratch_pool));
+  (*rep)->item_index = (apr_uint64_t)value;
+  SVN_ERR(read_cached_number(&value, &token, "/", path, scratch_pool));
+  (*rep)->size = value;
+  SVN_ERR(read_cached_number(&value, &token, "/", path, scratch_pool));
+  (*rep)->expanded_size = value;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the next line in *CONTENTS and advance *CONTENTS behind it.
+ * Report errors for the stats cache file at PATH. */
+static svn_error_t *
+next_cached_line(char **line,
+                 char **contents,
+                 const char *path,
+                 apr_pool_t *scratch_pool)
+{
+  char *eol = strchr(*contents, '\n');
+  if (!eol)
+    return malformed_stats_cache(path, scratch_pool);
+
+  *eol = '\0';
+  *line = *contents;
+  *contents = eol + 1;
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the scan results for the packed shard of COUNT revisions starting
+ * at BASE in FS from the stats cache of QUERY and return them in *SCAN.
+ * Set *SCAN to NULL if there are none or they are for a different
+ * repository.  Allocate *SCAN in RESULT_POOL and use SCRATCH_POOL for
+ * temporary allocations. */
+static svn_error_t *
+read_stats_cache(file_scan_t **scan,
+                 const query_t *query,
+                 svn_fs_t *fs,
+                 svn_revnum_t base,
+                 int count,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  const char *path = stats_cache_path(query, base, scratch_pool);
+  const char *id = stats_cache_id(fs, base, count, scratch_pool);
+  svn_stringbuf_t *buffer;
+  char *contents, *line;
+  file_scan_t *result;
+  apr_int64_t value;
+  int i, noderev_count;
+  svn_error_t *err;
+
+  *scan = NULL;
+  err = svn_stringbuf_from_file2(&buffer, path, result_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  contents = buffer->data;
+  if (strncmp(contents, STATS_CACHE_HEADER, sizeof(STATS_CACHE_HEADER) - 1))
+    return malformed_stats_cache(path, scratch_pool);
+
+  /* Silently ignore results for other repositories and shard sizes. */
+  contents += sizeof(STATS_CACHE_HEADER) - 1;
+  SVN_ERR(next_cached_line(&line, &contents, path, scratch_pool));
+  if (strncmp(line, id, strlen(id)) || line[strlen(id)] != ' ')
+    return SVN_NO_ERROR;
+
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  result->base = base;
+  result->count = count;
+  line += strlen(id);
+  SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+  result->max_offset = (apr_off_t)value;
+
+  result->change_count = apr_pcalloc(result_pool,
+                                     count * sizeof(*result->change_count));
+  result->changes_len = apr_pcalloc(result_pool,
+                                    count * sizeof(*result->changes_len));
+  for (i = 0; i < count; ++i)
+    {
+      SVN_ERR(next_cached_line(&line, &contents, path, scratch_pool));
+      SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+      result->change_count[i] = (apr_uint64_t)value;
+      SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+      result->changes_len[i] = (apr_uint64_t)value;
+    }
+
+  SVN_ERR(next_cached_line(&line, &contents, path, scratch_pool));
+  SVN_ERR(svn_cstring_atoi(&noderev_count, line));
+  result->noderevs = apr_array_make(result_pool, noderev_count,
+                                    sizeof(noderev_info_t *));
+  for (i = 0; i < noderev_count; ++i)
+    {
+      noderev_info_t *noderev = apr_pcalloc(result_pool, sizeof(*noderev));
+      const char *kind;
+
+      SVN_ERR(next_cached_line(&line, &contents, path, scratch_pool));
+      SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+      noderev->revision = (svn_revnum_t)value;
+      if (noderev->revision < base || noderev->revision >= base + count)
+        return malformed_stats_cache(path, scratch_pool);
+
+      kind = svn_cstring_tokenize(" ", &line);
+      if (!kind)
+        return malformed_stats_cache(path, scratch_pool);
+      noderev->kind = strcmp(kind, "d") == 0 ? svn_node_dir : svn_node_file;
+
+      SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+      noderev->size = (apr_size_t)value;
+      SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+      noderev->has_predecessor = value != 0;
+      SVN_ERR(read_cached_rep(&noderev->data_rep, &line, path, result_pool,
+                              scratch_pool));
+      SVN_ERR(read_cached_rep(&noderev->prop_rep, &line, path, result_pool,
+                              scratch_pool));
+      if (!line)
+        return malformed_stats_cache(path, scratch_pool);
+      noderev->created_path = line;
+
+      APR_ARRAY_PUSH(result->noderevs, noderev_info_t *) = noderev;
+    }
+
+  result->rep_refs = apr_array_make(result_pool, 64, sizeof(rep_ref_t *));
+  while (*contents)
+    {
+      rep_ref_t *ref = apr_pcalloc(result_pool, sizeof(*ref));
+
+      SVN_ERR(next_cached_line(&line, &contents, path, scratch_pool));
+      SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+      ref->revision = (svn_revnum_t)value;
+      SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+      ref->item_index = (apr_uint64_t)value;
+      SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+      ref->base_revision = (svn_revnum_t)value;
+      SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+      ref->base_item_index = (apr_uint64_t)value;
+      SVN_ERR(read_cached_number(&value, &line, " ", path, scratch_pool));
+      ref->header_size = (apr_uint16_t)value;
+
+      APR_ARRAY_PUSH(result->rep_refs, rep_ref_t *) = ref;
+    }
+
+  *scan = result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the scan results for the packed shard starting at BASE in QUERY
+ * in *SCAN, reading the data through FS.  Use and update the stats cache,
+ * if enabled.  Allocate *SCAN in RESULT_POOL and use SCRATCH_POOL for
+ * temporary allocations.
+ *
+ * Only QUERY's configuration will be accessed, i.e. this may be called
+ * concurrently for different shards as long as each thread uses its own
+ * FS instance.
+ */
+static svn_error_t *
+get_pack_file_scan(file_scan_t **scan,
+                   const query_t *query,
+                   svn_fs_t *fs,
+                   svn_revnum_t base,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  if (query->cache_dir)
+    {
+      SVN_ERR(read_stats_cache(scan, query, fs, base, query->shard_size,
+                               result_pool, scratch_pool));
+      if (*scan)
+        return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(scan_log_rev_or_packfile(scan, fs, base, query->shard_size,
+                                   query->cancel_func, query->cancel_baton,
+                                   result_pool, scratch_pool));
+
+  if (query->cache_dir)
+    SVN_ERR(write_stats_cache(query, fs, *scan, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the content of the pack file staring at revision BASE logical
  * addressing mode and store it in QUERY.
  *
@@ -1142,8 +1718,11 @@ read_log_pack_file(query_t *query,
                    apr_pool_t *result_pool,
                    apr_pool_t *scratch_pool)
 {
-  SVN_ERR(read_log_rev_or_packfile(query, base, query->shard_size,
-                                   result_pool, scratch_pool));
+  file_scan_t *scan;
+
+  SVN_ERR(get_pack_file_scan(&scan, query, query->fs, base, scratch_pool,
+                             scratch_pool));
+  SVN_ERR(add_file_scan(query, scan, result_pool, scratch_pool));
 
   /* one more pack file processed */
   if (query->progress_func)
@@ -1152,6 +1731,91 @@ read_log_pack_file(query_t *query,
   return SVN_NO_ERROR;
 }
 
+/* A pack file being scanned by a job in read_log_pack_files_concurrently().
+ */
+typedef struct stats_job_t
+{
+  /* The query being processed.  Jobs only read its configuration. */
+  query_t *query;
+
+  /* First revision of the pack file to scan. */
+  svn_revnum_t base;
+
+  /* Result of the scan, allocated in the job's pool. */
+  file_scan_t *scan;
+} stats_job_t;
+
+/* Implements svn_fs_fs__job_func_t, scanning the pack file in FS given by
+ * the stats_job_t in BATON. */
+static svn_error_t *
+stats_job_func(void *baton,
+               svn_fs_t *fs,
+               apr_pool_t *pool)
+{
+  stats_job_t *job = baton;
+
+  return svn_error_trace(get_pack_file_scan(&job->scan, job->query, fs,
+                                            job->base, pool, pool));
+}
+
+/* Read the contents of all pack files in QUERY with up to QUERY->JOBS of
+ * them being scanned at the same time.  The results get added to QUERY in
+ * revision order, such that they are the same as for a sequential run.
+ *
+ * Use RESULT_POOL for persistent allocations and SCRATCH_POOL for
+ * temporaries.
+ */
+static svn_error_t *
+read_log_pack_files_concurrently(query_t *query,
+                                 apr_pool_t *result_pool,
+                                 apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_revnum_t next_base = 0;
+  svn_revnum_t base;
+  svn_fs_fs__job_ring_t *ring
+    = svn_fs_fs__job_ring_create(query->fs, query->jobs,
+                                 sizeof(stats_job_t), stats_job_func,
+                                 scratch_pool);
+
+  for (base = 0;
+       base < query->min_unpacked_rev && !err;
+       base += query->shard_size)
+    {
+      stats_job_t *job;
+      svn_pool_clear(iterpool);
+
+      /* Keep up to QUERY->JOBS pack files in flight. */
+      for (; !svn_fs_fs__job_ring_is_full(ring)
+             && next_base < query->min_unpacked_rev;
+           next_base += query->shard_size)
+        {
+          stats_job_t new_job = { 0 };
+          new_job.query = query;
+          new_job.base = next_base;
+          svn_fs_fs__job_ring_push(ring, &new_job);
+        }
+
+      /* Add the results to QUERY in revision order. */
+      err = svn_fs_fs__job_ring_wait((void **)&job, ring);
+      if (!err)
+        err = add_file_scan(query, job->scan, result_pool, iterpool);
+
+      /* one more pack file processed */
+      if (!err && query->progress_func)
+        query->progress_func(base, query->progress_baton, iterpool);
+
+      svn_fs_fs__job_ring_pop(ring);
+    }
+
+  /* Don't leave any workers behind. */
+  svn_fs_fs__job_ring_clear(ring);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
 /* Read the content of the file for REVISION in logical addressing mode
  * and store its contents in QUERY.
  *
@@ -1191,15 +1855,27 @@ read_revisions(query_t *query,
 {
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   svn_revnum_t revision;
+  svn_boolean_t use_log_addressing
+    = svn_fs_fs__use_log_addressing(query->fs);
+
+  if (use_log_addressing && query->cache_dir)
+    SVN_ERR(svn_io_make_dir_recursively(query->cache_dir, scratch_pool));
 
   /* read all packed revs */
-  for ( revision = 0
-      ; revision < query->min_unpacked_rev
+  revision = 0;
+  if (use_log_addressing && query->jobs > 1)
+    {
+      SVN_ERR(read_log_pack_files_concurrently(query, result_pool,
+                                               scratch_pool));
+      revision = query->min_unpacked_rev;
+    }
+
+  for ( ; revision < query->min_unpacked_rev
       ; revision += query->shard_size)
     {
       svn_pool_clear(iterpool);
 
-      if (svn_fs_fs__use_log_addressing(query->fs))
+      if (use_log_addressing)
         SVN_ERR(read_log_pack_file(query, revision, result_pool, iterpool));
       else
         SVN_ERR(read_phys_pack_file(query, revision, result_pool, iterpool));
@@ -1210,7 +1886,7 @@ read_revisions(query_t *query,
     {
       svn_pool_clear(iterpool);
 
-      if (svn_fs_fs__use_log_addressing(query->fs))
+      if (use_log_addressing)
         SVN_ERR(read_log_revision_file(query, revision, result_pool,
                                        iterpool));
       else
@@ -1335,6 +2011,8 @@ static svn_error_t *
 create_query(query_t **query,
              svn_fs_t *fs,
              svn_fs_fs__stats_t *stats,
+             int jobs,
+             const char *cache_dir,
              svn_fs_progress_notify_func_t progress_func,
              void *progress_baton,
              svn_cancel_func_t cancel_func,
@@ -1364,6 +2042,8 @@ create_query(query_t **query,
   /* Store other parameters */
   (*query)->fs = fs;
   (*query)->stats = stats;
+  (*query)->jobs = MAX(1, MIN(jobs, MAX_STATS_JOBS));
+  (*query)->cache_dir = cache_dir;
   (*query)->progress_func = progress_func;
   (*query)->progress_baton = progress_baton;
   (*query)->cancel_func = cancel_func;
@@ -1375,6 +2055,8 @@ create_query(query_t **query,
 svn_error_t *
 svn_fs_fs__get_stats(svn_fs_fs__stats_t **stats,
                      svn_fs_t *fs,
+                     int jobs,
+                     const char *cache_dir,
                      svn_fs_progress_notify_func_t progress_func,
                      void *progress_baton,
                      svn_cancel_func_t cancel_func,
@@ -1385,9 +2067,9 @@ svn_fs_fs__get_stats(svn_fs_fs__stats_t **stats,
   query_t *query;
 
   *stats = create_stats(result_pool);
-  SVN_ERR(create_query(&query, fs, *stats, progress_func, progress_baton,
-                       cancel_func, cancel_baton, scratch_pool,
-                       scratch_pool));
+  SVN_ERR(create_query(&query, fs, *stats, jobs, cache_dir, progress_func,
+                       progress_baton, cancel_func, cancel_baton,
+                       scratch_pool, scratch_pool));
   SVN_ERR(read_revisions(query, scratch_pool, scratch_pool));
   aggregate_stats(query->revisions, *stats);
 
@@ -400,6 +400,55 @@ svn_fs_fs__deserialize_raw_window(void **item,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__serialize_combined_chunk(void **buffer,
+                                    apr_size_t *buffer_size,
+                                    void *item,
+                                    apr_pool_t *pool)
+{
+  svn_fs_fs__combined_cached_chunk_t *chunk = item;
+  svn_stringbuf_t *serialized;
+
+  /* initialize the serialization process and allocate a buffer large
+   * enough to do prevent re-allocations. */
+  svn_temp_serializer__context_t *context =
+      svn_temp_serializer__init(chunk,
+                                sizeof(*chunk),
+                                sizeof(*chunk) + chunk->contents.len + 16,
+                                pool);
+
+  /* serialize the sub-structure(s) */
+  svn_temp_serializer__add_leaf(context,
+                                (const void * const *)&chunk->contents.data,
+                                chunk->contents.len + 1);
+
+  /* return the serialized result */
+  serialized = svn_temp_serializer__get(context);
+
+  *buffer = serialized->data;
+  *buffer_size = serialized->len;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_fs_fs__deserialize_combined_chunk(void **item,
+                                      void *buffer,
+                                      apr_size_t buffer_size,
+                                      apr_pool_t *pool)
+{
+  svn_fs_fs__combined_cached_chunk_t *chunk =
+      (svn_fs_fs__combined_cached_chunk_t *)buffer;
+
+  /* pointer reference fixup */
+  svn_temp_deserializer__resolve(chunk, (void **)&chunk->contents.data);
+
+  /* done */
+  *item = buffer;
+
+  return SVN_NO_ERROR;
+}
+
 
 /* Utility function to serialize COUNT svn_txdelta_op_t objects
  * at OPS in the given serialization CONTEXT.
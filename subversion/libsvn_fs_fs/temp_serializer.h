@@ -60,6 +60,9 @@ typedef struct
 
   /* the offset within the representation right after reading the window */
   apr_off_t end_offset;
+
+  /* svndiff version of the window data */
+  int ver;
 } svn_fs_fs__raw_cached_window_t;
 
 /**
@@ -82,6 +85,40 @@ svn_fs_fs__deserialize_raw_window(void **item,
                                   apr_size_t buffer_size,
                                   apr_pool_t *pool);
 
+/**
+ * Adds position information to a fully reconstructed chunk of a
+ * delta representation.
+ */
+typedef struct
+{
+  /* the combined (undeltified) contents of the chunk */
+  svn_string_t contents;
+
+  /* the offset within the representation right after reading the
+     window that the chunk has been reconstructed from */
+  apr_off_t end_offset;
+} svn_fs_fs__combined_cached_chunk_t;
+
+/**
+ * Implements #svn_cache__serialize_func_t for
+ * #svn_fs_fs__combined_cached_chunk_t.
+ */
+svn_error_t *
+svn_fs_fs__serialize_combined_chunk(void **buffer,
+                                    apr_size_t *buffer_size,
+                                    void *item,
+                                    apr_pool_t *pool);
+
+/**
+ * Implements #svn_cache__deserialize_func_t for
+ * #svn_fs_fs__combined_cached_chunk_t.
+ */
+svn_error_t *
+svn_fs_fs__deserialize_combined_chunk(void **item,
+                                      void *buffer,
+                                      apr_size_t buffer_size,
+                                      apr_pool_t *pool);
+
 /**
  * #svn_txdelta_window_t is not sufficient for caching the data it
  * represents because data read process needs auxiliary information.
@@ -0,0 +1,202 @@
+/* trace.c --- FSFS access tracing
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+#include <apr_strings.h>
+
+#include "svn_pools.h"
+#include "svn_io.h"
+#include "svn_sorts.h"
+
+#include "fs.h"
+#include "trace.h"
+
+#include "svn_private_config.h"
+
+#ifdef HAVE_SYS_SDT_H
+#include <sys/sdt.h>
+const int svn_fs_fs__trace_probes = 1;
+#else
+const int svn_fs_fs__trace_probes = 0;
+#endif
+
+/* Upper limit for the length of a single formatted event line. */
+#define MAX_LINE_LEN 256
+
+/* Event names as they appear in the trace file, indexed by
+ * svn_fs_fs__trace_event_t. */
+static const char * const event_names[] =
+{
+  "file-open",
+  "block-read",
+  "item-read",
+  "window-read",
+  "cache-miss"
+};
+
+struct svn_fs_fs__tracer_t
+{
+  /* Absolute path of the trace file to append to. */
+  const char *path;
+
+  /* Formatted events not written yet.  BUFFER holds CAPACITY bytes of
+   * which the first USED are in use. */
+  char *buffer;
+  apr_size_t capacity;
+  apr_size_t used;
+
+  /* Owns this structure.  Scratch pool for writing the buffer. */
+  apr_pool_t *pool;
+  apr_pool_t *scratch_pool;
+};
+
+/* Append the buffer contents of TRACER to its file using SCRATCH_POOL
+ * and empty the buffer.  The file gets opened and closed every time so
+ * that multiple FS instances and processes may share it; each flush is
+ * a single append. */
+static svn_error_t *
+flush_buffer(svn_fs_fs__tracer_t *tracer,
+             apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  apr_size_t used = tracer->used;
+
+  if (used == 0)
+    return SVN_NO_ERROR;
+
+  /* Drop the data even if we fail to write it.  A trace with gaps is
+   * still more useful than one that stops at the first problem. */
+  tracer->used = 0;
+
+  SVN_ERR(svn_io_file_open(&file, tracer->path,
+                           APR_WRITE | APR_CREATE | APR_APPEND,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, tracer->buffer, used, NULL,
+                                 scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Pool cleanup function writing the remaining events in DATA, a
+ * svn_fs_fs__tracer_t. */
+static apr_status_t
+tracer_cleanup(void *data)
+{
+  svn_fs_fs__tracer_t *tracer = data;
+
+  /* SCRATCH_POOL has been destroyed already as it is a sub-pool of
+   * TRACER->POOL. */
+  svn_error_clear(flush_buffer(tracer, tracer->pool));
+
+  return APR_SUCCESS;
+}
+
+svn_fs_fs__tracer_t *
+svn_fs_fs__tracer_create(const char *path,
+                         apr_size_t buffer_size,
+                         apr_pool_t *pool)
+{
+  apr_pool_t *tracer_pool = svn_pool_create(pool);
+  svn_fs_fs__tracer_t *tracer = apr_pcalloc(tracer_pool, sizeof(*tracer));
+
+  tracer->path = apr_pstrdup(tracer_pool, path);
+  tracer->capacity = MAX(buffer_size, MAX_LINE_LEN);
+  tracer->buffer = apr_palloc(tracer_pool, tracer->capacity);
+  tracer->used = 0;
+  tracer->pool = tracer_pool;
+  tracer->scratch_pool = svn_pool_create(tracer_pool);
+
+  apr_pool_cleanup_register(tracer_pool, tracer, tracer_cleanup,
+                            apr_pool_cleanup_null);
+
+  return tracer;
+}
+
+void
+svn_fs_fs__trace_event(svn_fs_t *fs,
+                       svn_fs_fs__trace_event_t event,
+                       const char *what,
+                       svn_revnum_t revision,
+                       apr_uint64_t item_index,
+                       apr_off_t offset,
+                       apr_off_t size,
+                       apr_time_t start)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_fs_fs__tracer_t *tracer = ffd->tracer;
+  apr_time_t now = apr_time_now();
+  apr_time_t latency = start ? now - start : 0;
+
+#ifdef HAVE_SYS_SDT_H
+  switch (event)
+    {
+      case svn_fs_fs__trace_file_open:
+        DTRACE_PROBE6(svn_fs_fs, file_open, what, revision, item_index,
+                      offset, size, latency);
+        break;
+
+      case svn_fs_fs__trace_block_read:
+        DTRACE_PROBE6(svn_fs_fs, block_read, what, revision, item_index,
+                      offset, size, latency);
+        break;
+
+      case svn_fs_fs__trace_item_read:
+        DTRACE_PROBE6(svn_fs_fs, item_read, what, revision, item_index,
+                      offset, size, latency);
+        break;
+
+      case svn_fs_fs__trace_window_read:
+        DTRACE_PROBE6(svn_fs_fs, window_read, what, revision, item_index,
+                      offset, size, latency);
+        break;
+
+      case svn_fs_fs__trace_cache_miss:
+        DTRACE_PROBE6(svn_fs_fs, cache_miss, what, revision, item_index,
+                      offset, size, latency);
+        break;
+    }
+#endif
+
+  if (tracer)
+    {
+      char line[MAX_LINE_LEN];
+      apr_size_t len;
+
+      len = apr_snprintf(line, sizeof(line),
+                         "%" APR_TIME_T_FMT "\t%s\t%s\t%ld"
+                         "\t%" APR_UINT64_T_FMT
+                         "\t%" APR_OFF_T_FMT "\t%" APR_OFF_T_FMT
+                         "\t%" APR_TIME_T_FMT "\t%s\n",
+                         now, event_names[event], what ? what : "-",
+                         revision, item_index, offset, size, latency,
+                         fs->request_id ? fs->request_id : "-");
+
+      if (tracer->used + len > tracer->capacity)
+        {
+          svn_error_clear(flush_buffer(tracer, tracer->scratch_pool));
+          svn_pool_clear(tracer->scratch_pool);
+        }
+
+      memcpy(tracer->buffer + tracer->used, line, len);
+      tracer->used += len;
+    }
+}
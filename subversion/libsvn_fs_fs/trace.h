@@ -0,0 +1,123 @@
+/* trace.h : interface to the FSFS access tracing
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_FS_FS_TRACE_H
+#define SVN_LIBSVN_FS_FS_TRACE_H
+
+#include "fs.h"
+
+/* Access tracing records what parts of the revision and pack files get
+ * read, when, and how long that took.  It replaces running the server
+ * under strace and feeding the output to tools/dev/fsfs-access-map.
+ *
+ * There are two consumers.  If fsfs.conf names a trace file, the events
+ * of each FS instance are collected in a fixed-size buffer and appended
+ * to that file as text whenever the buffer is full and when the FS gets
+ * closed.  Each line has the tab-separated fields
+ *
+ *   <time> <event> <what> <revision> <item> <offset> <size> <latency>
+ *   <request-id>
+ *
+ * with TIME and LATENCY in microseconds and "-" for an empty WHAT.
+ * REQUEST-ID is the one set by svn_fs__set_request_id, or "-", and links
+ * the events to the spans of an svn_trace__t.
+ * Independently of that, builds that found <sys/sdt.h> fire a USDT probe
+ * named after the event in the "svn_fs_fs" provider for every event,
+ * with the fields up to LATENCY as arguments.  Without either consumer,
+ * tracing costs a single test per event.
+ */
+
+/* The kinds of events being traced. */
+typedef enum svn_fs_fs__trace_event_t
+{
+  /* A rev or pack file has been opened.  WHAT is "cached" if an open
+   * handle could be reused.  No offset or size. */
+  svn_fs_fs__trace_file_open,
+
+  /* A block of a rev or pack file has been read by block_read.
+   * OFFSET and SIZE describe the block. */
+  svn_fs_fs__trace_block_read,
+
+  /* An item has been parsed from a rev or pack file.  WHAT is its type. */
+  svn_fs_fs__trace_item_read,
+
+  /* A delta window or a plain chunk of a representation has been read
+   * from disk.  WHAT is "delta" or "plain", respectively. */
+  svn_fs_fs__trace_window_read,
+
+  /* A cache lookup failed and the data has to come from disk.  WHAT
+   * names the cache.  No offset, size or latency. */
+  svn_fs_fs__trace_cache_miss
+} svn_fs_fs__trace_event_t;
+
+/* Per-FS trace buffer.  Opaque. */
+typedef struct svn_fs_fs__tracer_t svn_fs_fs__tracer_t;
+
+/* Non-zero if this build fires USDT probes for trace events. */
+extern const int svn_fs_fs__trace_probes;
+
+/* Evaluates to non-zero if events in FS need to be recorded at all. */
+#define SVN_FS_FS__TRACE_ENABLED(fs) \
+  (   svn_fs_fs__trace_probes \
+   || ((fs_fs_data_t *)(fs)->fsap_data)->tracer)
+
+/* Return the time to pass as START to SVN_FS_FS__TRACE for an operation
+ * in FS that is about to begin, or 0 if tracing is disabled for FS. */
+#define SVN_FS_FS__TRACE_START(fs) \
+  (SVN_FS_FS__TRACE_ENABLED(fs) ? apr_time_now() : 0)
+
+/* Record EVENT in FS if tracing is enabled for it.  The parameters are
+ * those of svn_fs_fs__trace_event. */
+#define SVN_FS_FS__TRACE(fs, event, what, revision, item_index, offset, \
+                         size, start) \
+  do \
+    { \
+      if (SVN_FS_FS__TRACE_ENABLED(fs)) \
+        svn_fs_fs__trace_event((fs), (event), (what), (revision), \
+                               (item_index), (offset), (size), (start)); \
+    } \
+  while (0)
+
+/* Return a new tracer for FS appending to the file at PATH with a buffer
+ * of BUFFER_SIZE bytes.  Remaining events will be written when POOL gets
+ * cleaned up. */
+svn_fs_fs__tracer_t *
+svn_fs_fs__tracer_create(const char *path,
+                         apr_size_t buffer_size,
+                         apr_pool_t *pool);
+
+/* Record EVENT for the item ITEM_INDEX in REVISION of FS, described by
+ * WHAT (may be NULL), covering SIZE bytes starting at OFFSET.  START is
+ * the result of SVN_FS_FS__TRACE_START when the operation began, or 0 if
+ * latency does not apply.  Never fails; tracing must not break the FS.
+ * Use the SVN_FS_FS__TRACE macro rather than calling this directly. */
+void
+svn_fs_fs__trace_event(svn_fs_t *fs,
+                       svn_fs_fs__trace_event_t event,
+                       const char *what,
+                       svn_revnum_t revision,
+                       apr_uint64_t item_index,
+                       apr_off_t offset,
+                       apr_off_t size,
+                       apr_time_t start);
+
+#endif
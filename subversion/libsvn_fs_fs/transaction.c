@@ -42,6 +42,7 @@
 #include "cached_data.h"
 #include "lock.h"
 #include "rep-cache.h"
+#include "similarity.h"
 
 #include "private/svn_fs_util.h"
 #include "private/svn_fspath.h"
@@ -70,6 +71,18 @@ path_txn_sha1(svn_fs_t *fs,
                          pool);
 }
 
+/* Return the name of the file listing the chunk representations written
+ * in transaction TXN_ID within FS.  Use POOL for allocations.
+ */
+static APR_INLINE const char *
+path_txn_chunk_reps(svn_fs_t *fs,
+                    const svn_fs_fs__id_part_t *txn_id,
+                    apr_pool_t *pool)
+{
+  return svn_dirent_join(svn_fs_fs__path_txn_dir(fs, txn_id, pool),
+                         PATH_TXN_CHUNK_REPS, pool);
+}
+
 static APR_INLINE const char *
 path_txn_changes(svn_fs_t *fs,
                  const svn_fs_fs__id_part_t *txn_id,
@@ -531,6 +544,35 @@ svn_fs_fs__put_node_revision(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* For the in-transaction representation REP within FS, write the
+ * sha1->rep mapping file in the respective transaction.  Pass
+ * MUTABLE_REP_TRUNCATED on to svn_fs_fs__unparse_representation.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+store_sha1_rep(svn_fs_t *fs,
+               representation_t *rep,
+               svn_boolean_t mutable_rep_truncated,
+               apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_file_t *rep_file;
+  const char *file_name = path_txn_sha1(fs, &rep->txn_id, rep->sha1_digest,
+                                        scratch_pool);
+  svn_stringbuf_t *rep_string
+    = svn_fs_fs__unparse_representation(rep, ffd->format,
+                                        mutable_rep_truncated,
+                                        scratch_pool, scratch_pool);
+  SVN_ERR(svn_io_file_open(&rep_file, file_name,
+                           APR_WRITE | APR_CREATE | APR_TRUNCATE
+                           | APR_BUFFERED, APR_OS_DEFAULT, scratch_pool));
+
+  SVN_ERR(svn_io_file_write_full(rep_file, rep_string->data,
+                                 rep_string->len, NULL, scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(rep_file, scratch_pool));
+}
+
 /* For the in-transaction NODEREV within FS, write the sha1->rep mapping
  * file in the respective transaction, if rep sharing has been enabled etc.
  * Use SCATCH_POOL for temporary allocations.
@@ -547,32 +589,17 @@ store_sha1_rep_mapping(svn_fs_t *fs,
   if (   ffd->rep_sharing_allowed
       && noderev->data_rep
       && noderev->data_rep->has_sha1)
-    {
-      apr_file_t *rep_file;
-      const char *file_name = path_txn_sha1(fs,
-                                            &noderev->data_rep->txn_id,
-                                            noderev->data_rep->sha1_digest,
-                                            scratch_pool);
-      svn_stringbuf_t *rep_string
-        = svn_fs_fs__unparse_representation(noderev->data_rep,
-                                            ffd->format,
-                                            (noderev->kind == svn_node_dir),
-                                            scratch_pool, scratch_pool);
-      SVN_ERR(svn_io_file_open(&rep_file, file_name,
-                               APR_WRITE | APR_CREATE | APR_TRUNCATE
-                               | APR_BUFFERED, APR_OS_DEFAULT, scratch_pool));
-
-      SVN_ERR(svn_io_file_write_full(rep_file, rep_string->data,
-                                     rep_string->len, NULL, scratch_pool));
-
-      SVN_ERR(svn_io_file_close(rep_file, scratch_pool));
-    }
+    SVN_ERR(store_sha1_rep(fs, noderev->data_rep,
+                           (noderev->kind == svn_node_dir), scratch_pool));
 
   return SVN_NO_ERROR;
 }
 
+/* Write DIRENT to STREAM in hash dump format.  If not NULL, set *LEN to
+   the number of bytes written.  Perform temporary allocations in POOL. */
 static svn_error_t *
-unparse_dir_entry(svn_fs_dirent_t *dirent,
+unparse_dir_entry(apr_size_t *len,
+                  svn_fs_dirent_t *dirent,
                   svn_stream_t *stream,
                   apr_pool_t *pool)
 {
@@ -632,6 +659,9 @@ unparse_dir_entry(svn_fs_dirent_t *dirent,
   /* Add the entry to the output stream. */
   to_write = p - buffer;
   SVN_ERR(svn_stream_write(stream, buffer, &to_write));
+  if (len)
+    *len = to_write;
+
   return SVN_NO_ERROR;
 }
 
@@ -650,7 +680,7 @@ unparse_dir_entries(apr_array_header_t *entries,
 
       svn_pool_clear(iterpool);
       dirent = APR_ARRAY_IDX(entries, i, svn_fs_dirent_t *);
-      SVN_ERR(unparse_dir_entry(dirent, stream, iterpool));
+      SVN_ERR(unparse_dir_entry(NULL, dirent, stream, iterpool));
     }
 
   SVN_ERR(svn_stream_printf(stream, pool, "%s\n", SVN_HASH_TERMINATOR));
@@ -660,16 +690,19 @@ unparse_dir_entries(apr_array_header_t *entries,
 }
 
 /* Return a deep copy of SOURCE and allocate it in RESULT_POOL.
+ * Take the copy-from path from PATHS.
  */
 static svn_fs_path_change2_t *
 path_change_dup(const svn_fs_path_change2_t *source,
+                svn_string__interner_t *paths,
                 apr_pool_t *result_pool)
 {
   svn_fs_path_change2_t *result = apr_pmemdup(result_pool, source,
                                               sizeof(*source));
   result->node_rev_id = svn_fs_fs__id_copy(source->node_rev_id, result_pool);
   if (source->copyfrom_path)
-    result->copyfrom_path = apr_pstrdup(result_pool, source->copyfrom_path);
+    result->copyfrom_path = svn_string__intern(paths, source->copyfrom_path,
+                                               strlen(source->copyfrom_path));
 
   return result;
 }
@@ -678,10 +711,12 @@ path_change_dup(const svn_fs_path_change2_t *source,
    svn_fs_path_change2_t CHANGED_PATHS, collapsing multiple changes into a
    single summarical (is that real word?) change per path.  DELETIONS is
    also a path->svn_fs_path_change2_t hash and contains all the deletions
-   that got turned into a replacement. */
+   that got turned into a replacement.  Keys and copy-from paths added to
+   CHANGED_PATHS get interned in PATHS. */
 static svn_error_t *
 fold_change(apr_hash_t *changed_paths,
             apr_hash_t *deletions,
+            svn_string__interner_t *paths,
             const change_t *change)
 {
   apr_pool_t *pool = apr_hash_pool_get(changed_paths);
@@ -759,7 +794,7 @@ fold_change(apr_hash_t *changed_paths,
           else
             {
               /* A deletion overrules a previous change (modify). */
-              new_change = path_change_dup(info, pool);
+              new_change = path_change_dup(info, paths, pool);
               apr_hash_set(changed_paths, path->data, path->len, new_change);
             }
           break;
@@ -770,7 +805,7 @@ fold_change(apr_hash_t *changed_paths,
              so treat it just like a replace.  Remember the original
              deletion such that we are able to delete this path again
              (the replacement may have changed node kind and id). */
-          new_change = path_change_dup(info, pool);
+          new_change = path_change_dup(info, paths, pool);
           new_change->change_kind = svn_fs_path_change_replace;
 
           apr_hash_set(changed_paths, path->data, path->len, new_change);
@@ -803,8 +838,9 @@ fold_change(apr_hash_t *changed_paths,
          will not be retained.  Thus, we copy the key into the target pool
          to ensure a proper lifetime.  */
       apr_hash_set(changed_paths,
-                   apr_pstrmemdup(pool, path->data, path->len), path->len,
-                   path_change_dup(info, pool));
+                   svn_string__intern(paths, path->data, path->len),
+                   path->len,
+                   path_change_dup(info, paths, pool));
     }
 
   return SVN_NO_ERROR;
@@ -820,6 +856,9 @@ typedef struct process_changes_baton_t
      replacements.  If those replacements get deleted again, this
      container contains the record that we have to revert to. */
   apr_hash_t *deletions;
+
+  /* Paths used in CHANGED_PATHS.  Copy sources tend to repeat. */
+  svn_string__interner_t *paths;
 } process_changes_baton_t;
 
 /* An implementation of svn_fs_fs__change_receiver_t.
@@ -833,7 +872,8 @@ process_changes(void *baton_p,
 {
   process_changes_baton_t *baton = baton_p;
 
-  SVN_ERR(fold_change(baton->changed_paths, baton->deletions, change));
+  SVN_ERR(fold_change(baton->changed_paths, baton->deletions, baton->paths,
+                      change));
 
   /* Now, if our change was a deletion or replacement, we have to
      blow away any changes thus far on paths that are (or, were)
@@ -907,6 +947,7 @@ svn_fs_fs__txn_changes_fetch(apr_hash_t **changed_paths_p,
 
   baton.changed_paths = changed_paths;
   baton.deletions = apr_hash_make(scratch_pool);
+  baton.paths = svn_string__interner_create(pool);
 
   SVN_ERR(svn_io_file_open(&file,
                            path_txn_changes(fs, txn_id, scratch_pool),
@@ -1549,7 +1590,34 @@ svn_fs_fs__set_entry(svn_fs_t *fs,
   fs_fs_data_t *ffd = fs->fsap_data;
   apr_pool_t *subpool = svn_pool_create(pool);
 
-  if (!rep || !is_txn_rep(rep))
+  if (rep && !is_txn_rep(rep)
+      && ffd->format >= SVN_FS_FS__MIN_DIR_CHANGE_LOG_FORMAT)
+    {
+      svn_stringbuf_t *base
+        = svn_fs_fs__unparse_representation(rep, ffd->format, FALSE,
+                                            subpool, subpool);
+
+      /* Instead of dumping all old contents, refer to them as the base
+         of a change log.  This is O(1) even for huge directories. */
+      SVN_ERR(svn_io_file_open(&file, filename,
+                               APR_WRITE | APR_CREATE | APR_BUFFERED,
+                               APR_OS_DEFAULT, pool));
+      out = svn_stream_from_aprfile2(file, TRUE, pool);
+      SVN_ERR(svn_stream_printf(out, subpool, SVN_FS_FS__DIR_BASE_PREFIX
+                                "%s\n", base->data));
+
+      /* Mark the node-rev's data rep as mutable. */
+      rep = apr_pcalloc(pool, sizeof(*rep));
+      rep->revision = SVN_INVALID_REVNUM;
+      rep->txn_id = *txn_id;
+      SVN_ERR(set_uniquifier(fs, rep, pool));
+      parent_noderev->data_rep = rep;
+      SVN_ERR(svn_fs_fs__put_node_revision(fs, parent_noderev->id,
+                                           parent_noderev, FALSE, pool));
+
+      svn_pool_clear(subpool);
+    }
+  else if (!rep || !is_txn_rep(rep))
     {
       apr_array_header_t *entries;
 
@@ -1641,7 +1709,7 @@ svn_fs_fs__set_entry(svn_fs_t *fs,
       entry.id = id;
       entry.kind = kind;
 
-      SVN_ERR(unparse_dir_entry(&entry, out, subpool));
+      SVN_ERR(unparse_dir_entry(NULL, &entry, out, subpool));
     }
   else
     {
@@ -1902,6 +1970,18 @@ fnv1a_checksum_finalize(apr_uint32_t *digest,
   return SVN_NO_ERROR;
 }
 
+/* A chunk of a CHUNKED representation that has been written to the
+   proto-rev file. */
+typedef struct new_chunk_t
+{
+  /* The chunk representation.  Its item index will only be allocated
+     when the chunk list gets written. */
+  representation_t *rep;
+
+  /* The chunk's phys-to-log index entry, except for the item number. */
+  svn_fs_fs__p2l_entry_t entry;
+} new_chunk_t;
+
 /* This baton is used by the representation writing streams.  It keeps
    track of the checksum information as well as the total size of the
    representation so far. */
@@ -1917,6 +1997,55 @@ struct rep_write_baton
      deltified, then eventually written to rep_stream. */
   svn_stream_t *delta_stream;
 
+  /* The delta base contents.  DELTA_STREAM will be created from it. */
+  svn_stream_t *delta_source;
+
+  /* If not NULL, contents written so far that have not been passed to
+     DELTA_STREAM yet because we don't know the delta base or whether we
+     will exceed the large-rep threshold. */
+  svn_stringbuf_t *pending;
+
+  /* TRUE, if the compression depends on whether the contents exceed the
+     large-rep threshold. */
+  svn_boolean_t large_rep_pending;
+
+  /* TRUE, if the delta base will be chosen by similarity once we have
+     seen enough of the contents.  The rep header has not been written
+     in that case. */
+  svn_boolean_t base_pending;
+
+  /* If not NULL, similarity fingerprints are being calculated from the
+     contents. */
+  svn_fs_fs__similarity_t *similarity;
+
+  /* TRUE, if the contents may still exceed the chunked-rep threshold.
+     The rep header has not been written in that case. */
+  svn_boolean_t chunk_pending;
+
+  /* Delta base chosen from the node history, if BASE_PENDING is not set.
+     May be NULL. */
+  representation_t *base_rep;
+
+  /* If not NULL, the contents get stored as a CHUNKED rep and this is
+     the state of the chunk boundary detection. */
+  svn_fs_fs__chunker_t *chunker;
+
+  /* Contents of the current chunk that have not been written, yet. */
+  svn_stringbuf_t *chunk_data;
+
+  /* All chunks (representation_t *) of a CHUNKED rep so far, in order. */
+  apr_array_header_t *chunks;
+
+  /* The chunks (new_chunk_t *) that we wrote to the proto-rev file. */
+  apr_array_header_t *new_chunks;
+
+  /* Maps the SHA1 digests of all NEW_CHUNKS to their new_chunk_t *. */
+  apr_hash_t *new_chunks_hash;
+
+  /* Compression to use, unless the large-rep threshold gets exceeded. */
+  compression_type_t compression_type;
+  int compression_level;
+
   /* Where is this representation header stored. */
   apr_off_t rep_offset;
 
@@ -1948,25 +2077,83 @@ struct rep_write_baton
   apr_pool_t *result_pool;
 };
 
-/* Handler for the write method of the representation writable stream.
-   BATON is a rep_write_baton, DATA is the data to write, and *LEN is
-   the length of this data. */
-static svn_error_t *
-rep_write_contents(void *baton,
-                   const char *data,
-                   apr_size_t *len)
+/* Set *DIFF_VERSION and *DIFF_COMPRESSION_LEVEL to the svndiff encoder
+   parameters that implement compression codec TYPE at zlib compression
+   LEVEL for new representations in FS. */
+static void
+get_svndiff_options(int *diff_version,
+                    int *diff_compression_level,
+                    svn_fs_t *fs,
+                    compression_type_t type,
+                    int level)
 {
-  struct rep_write_baton *b = baton;
+  fs_fs_data_t *ffd = fs->fsap_data;
 
-  SVN_ERR(svn_checksum_update(b->md5_checksum_ctx, data, *len));
-  SVN_ERR(svn_checksum_update(b->sha1_checksum_ctx, data, *len));
-  b->rep_size += *len;
+  if (   type == compression_type_lz4
+      && ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT)
+    {
+      *diff_version = 2;
+      *diff_compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (type == compression_type_none)
+    {
+      *diff_version = 0;
+      *diff_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+    }
+  else
+    {
+      *diff_version = ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT ? 1 : 0;
+      *diff_compression_level = level;
+    }
+}
 
-  /* If we are writing a delta, use that stream. */
-  if (b->delta_stream)
-    return svn_stream_write(b->delta_stream, data, len);
+/* Create the svndiff encoder for B using compression codec TYPE at
+   zlib compression LEVEL and set B->DELTA_STREAM accordingly. */
+static void
+start_delta_stream(struct rep_write_baton *b,
+                   compression_type_t type,
+                   int level)
+{
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  int diff_version;
+  int diff_compression_level;
+
+  get_svndiff_options(&diff_version, &diff_compression_level, b->fs,
+                      type, level);
+  svn_txdelta_to_svndiff3(&wh,
+                          &whb,
+                          b->rep_stream,
+                          diff_version,
+                          diff_compression_level,
+                          b->result_pool);
+
+  /* Always use standard-sized windows: reading a delta chain combines
+     the N-th window of each rep in the chain, which requires all of them
+     to cover the same range of the file. */
+  b->delta_stream = svn_txdelta_target_push(wh, whb, b->delta_source,
+                                            b->scratch_pool);
+}
+
+/* Create B's delta stream and pass all of B's pending contents to it.
+   The compression depends on whether the large-rep threshold has been
+   exceeded. */
+static svn_error_t *
+flush_pending_contents(struct rep_write_baton *b)
+{
+  fs_fs_data_t *ffd = b->fs->fsap_data;
+  svn_stringbuf_t *pending = b->pending;
+  apr_size_t len = pending->len;
+
+  b->pending = NULL;
+  if (b->large_rep_pending && b->rep_size > ffd->large_rep_threshold)
+    start_delta_stream(b, ffd->large_rep_compression_type,
+                       ffd->large_rep_compression_level);
   else
-    return svn_stream_write(b->rep_stream, data, len);
+    start_delta_stream(b, b->compression_type, b->compression_level);
+
+  return svn_error_trace(svn_stream_write(b->delta_stream, pending->data,
+                                          &len));
 }
 
 /* Set *SPANNED to the number of shards touched when walking WALK steps on
@@ -2005,6 +2192,67 @@ shards_spanned(int *spanned,
   return SVN_NO_ERROR;
 }
 
+/* Set *REP to NULL if the representation *REP in FS is not worth being
+   used as a delta base or would make the delta chain too long.  *REP may
+   be NULL.  Perform temporary allocations in POOL. */
+static svn_error_t *
+check_delta_base(representation_t **rep,
+                 svn_fs_t *fs,
+                 apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (*rep)
+    {
+      int chain_length = 0;
+      int shard_count = 0;
+
+      /* Very short rep bases are simply not worth it as we are unlikely
+       * to re-coup the deltification space overhead of 20+ bytes. */
+      svn_filesize_t rep_size = (*rep)->expanded_size;
+      if (rep_size < 64)
+        {
+          *rep = NULL;
+          return SVN_NO_ERROR;
+        }
+
+      /* CHUNKED reps can't be delta bases.  Their chunks get shared
+       * instead. */
+      if (ffd->format >= SVN_FS_FS__MIN_CHUNKED_REP_FORMAT)
+        {
+          svn_boolean_t chunked;
+          SVN_ERR(svn_fs_fs__rep_is_chunked(&chunked, *rep, fs, pool));
+          if (chunked)
+            {
+              *rep = NULL;
+              return SVN_NO_ERROR;
+            }
+        }
+
+      /* Check whether the length of the deltification chain is acceptable.
+       * Otherwise, shared reps may form a non-skipping delta chain in
+       * extreme cases. */
+      SVN_ERR(svn_fs_fs__rep_chain_length(&chain_length, &shard_count,
+                                          *rep, fs, pool));
+
+      /* Some reasonable limit, depending on how acceptable longer linear
+       * chains are in this repo.  Also, allow for some minimal chain. */
+      if (chain_length >= 2 * (int)ffd->max_linear_deltification + 2)
+        *rep = NULL;
+      else
+        /* To make it worth opening additional shards / pack files, we
+         * require that the reps have a certain minimal size.  To deltify
+         * against a rep in different shard, the lower limit is 512 bytes
+         * and doubles with every extra shard to visit along the delta
+         * chain. */
+        if (   shard_count > 1
+            && ((svn_filesize_t)128 << shard_count) >= rep_size)
+          *rep = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Given a node-revision NODEREV in filesystem FS, return the
    representation in *REP to use as the base for a text representation
    delta if PROPS is FALSE.  If PROPS has been set, a suitable props
@@ -2088,44 +2336,69 @@ choose_delta_base(representation_t **rep,
 
   /* if we encountered a shared rep, its parent chain may be different
    * from the node-rev parent chain. */
-  if (*rep)
-    {
-      int chain_length = 0;
-      int shard_count = 0;
+  return svn_error_trace(check_delta_base(rep, fs, pool));
+}
 
-      /* Very short rep bases are simply not worth it as we are unlikely
-       * to re-coup the deltification space overhead of 20+ bytes. */
-      svn_filesize_t rep_size = (*rep)->expanded_size;
-      if (rep_size < 64)
-        {
-          *rep = NULL;
-          return SVN_NO_ERROR;
-        }
+/* Set B's delta source to the contents of BASE_REP and write the rep
+   header for it.  BASE_REP may be NULL for a self-delta. */
+static svn_error_t *
+write_rep_header(struct rep_write_baton *b,
+                 representation_t *base_rep)
+{
+  svn_fs_fs__rep_header_t header = { 0 };
 
-      /* Check whether the length of the deltification chain is acceptable.
-       * Otherwise, shared reps may form a non-skipping delta chain in
-       * extreme cases. */
-      SVN_ERR(svn_fs_fs__rep_chain_length(&chain_length, &shard_count,
-                                          *rep, fs, pool));
+  SVN_ERR(svn_fs_fs__get_contents(&b->delta_source, b->fs, base_rep, TRUE,
+                                  b->scratch_pool));
 
-      /* Some reasonable limit, depending on how acceptable longer linear
-       * chains are in this repo.  Also, allow for some minimal chain. */
-      if (chain_length >= 2 * (int)ffd->max_linear_deltification + 2)
-        *rep = NULL;
-      else
-        /* To make it worth opening additional shards / pack files, we
-         * require that the reps have a certain minimal size.  To deltify
-         * against a rep in different shard, the lower limit is 512 bytes
-         * and doubles with every extra shard to visit along the delta
-         * chain. */
-        if (   shard_count > 1
-            && ((svn_filesize_t)128 << shard_count) >= rep_size)
-          *rep = NULL;
+  if (base_rep)
+    {
+      header.base_revision = base_rep->revision;
+      header.base_item_index = base_rep->item_index;
+      header.base_length = base_rep->size;
+      header.type = svn_fs_fs__rep_delta;
+    }
+  else
+    {
+      header.type = svn_fs_fs__rep_self_delta;
     }
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+
+  /* Now determine the offset of the actual svndiff data. */
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
 
   return SVN_NO_ERROR;
 }
 
+/* Look for an existing representation that is similar to the contents
+   written to B so far, use it as delta base and write the rep header. */
+static svn_error_t *
+choose_similar_base(struct rep_write_baton *b)
+{
+  representation_t *base_rep;
+  apr_array_header_t *fingerprints
+    = svn_fs_fs__similarity_fingerprints(b->similarity, b->scratch_pool);
+  svn_error_t *err = svn_fs_fs__get_similar_rep(&base_rep, b->fs,
+                                                fingerprints,
+                                                b->scratch_pool,
+                                                b->scratch_pool);
+
+  /* Not finding a delta base is not fatal.  We simply store the contents
+     as fulltext then but warn about the problem. */
+  if (err)
+    {
+      (b->fs->warning)(b->fs->warning_baton, err);
+      svn_error_clear(err);
+      base_rep = NULL;
+    }
+
+  SVN_ERR(check_delta_base(&base_rep, b->fs, b->scratch_pool));
+
+  b->base_pending = FALSE;
+  return svn_error_trace(write_rep_header(b, base_rep));
+}
+
 /* Something went wrong and the pool for the rep write is being
    cleared before we've finished writing the rep.  So we need
    to remove the rep from the protorevfile and we need to unlock
@@ -2159,6 +2432,32 @@ rep_write_cleanup(void *data)
   return APR_SUCCESS;
 }
 
+/* Set *UNCOMPRESSED to TRUE, if the svn:mime-type of NODEREV in FS matches
+   any of the uncompressed-mime-types patterns in fsfs.conf.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+is_uncompressed_mime_type(svn_boolean_t *uncompressed,
+                          svn_fs_t *fs,
+                          node_revision_t *noderev,
+                          apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_hash_t *proplist;
+  svn_string_t *mime_type;
+
+  *uncompressed = FALSE;
+  if (!ffd->uncompressed_mime_types || !noderev->prop_rep)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_fs__get_proplist(&proplist, fs, noderev, scratch_pool));
+  mime_type = svn_hash_gets(proplist, SVN_PROP_MIME_TYPE);
+  if (mime_type)
+    *uncompressed = svn_cstring_match_glob_list(mime_type->data,
+                                                ffd->uncompressed_mime_types);
+
+  return SVN_NO_ERROR;
+}
+
 /* Get a rep_write_baton and store it in *WB_P for the representation
    indicated by NODEREV in filesystem FS.  Perform allocations in
    POOL.  Only appropriate for file contents, not for props or
@@ -2171,13 +2470,8 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
 {
   struct rep_write_baton *b;
   apr_file_t *file;
-  representation_t *base_rep;
-  svn_stream_t *source;
-  svn_txdelta_window_handler_t wh;
-  void *whb;
   fs_fs_data_t *ffd = fs->fsap_data;
-  int diff_version = ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT ? 1 : 0;
-  svn_fs_fs__rep_header_t header = { 0 };
+  svn_boolean_t uncompressed;
 
   b = apr_pcalloc(pool, sizeof(*b));
 
@@ -2203,44 +2497,56 @@ rep_write_get_baton(struct rep_write_baton **wb_p,
 
   SVN_ERR(svn_io_file_get_offset(&b->rep_offset, file, b->scratch_pool));
 
-  /* Get the base for this delta. */
-  SVN_ERR(choose_delta_base(&base_rep, fs, noderev, FALSE, b->scratch_pool));
-  SVN_ERR(svn_fs_fs__get_contents(&source, fs, base_rep, TRUE,
-                                  b->scratch_pool));
+  /* Get the base for this delta.  New files have no history to deltify
+     against.  With similarity deltification, we will look for a similar
+     rep instead as soon as we have seen enough of the contents. */
+  if (ffd->similarity_deltification)
+    b->similarity = svn_fs_fs__similarity_create(b->scratch_pool);
 
-  /* Write out the rep header. */
-  if (base_rep)
-    {
-      header.base_revision = base_rep->revision;
-      header.base_item_index = base_rep->item_index;
-      header.base_length = base_rep->size;
-      header.type = svn_fs_fs__rep_delta;
-    }
+  if (b->similarity && !noderev->predecessor_count)
+    b->base_pending = TRUE;
   else
-    {
-      header.type = svn_fs_fs__rep_self_delta;
-    }
-  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
-                                      b->scratch_pool));
+    SVN_ERR(choose_delta_base(&b->base_rep, fs, noderev, FALSE,
+                              b->scratch_pool));
 
-  /* Now determine the offset of the actual svndiff data. */
-  SVN_ERR(svn_io_file_get_offset(&b->delta_start, file,
-                                 b->scratch_pool));
+  /* Large contents will be stored as CHUNKED reps.  Defer writing the
+     rep header until we know whether the contents exceed the threshold. */
+  if (ffd->chunked_rep_threshold > 0)
+    b->chunk_pending = TRUE;
+  else if (!b->base_pending)
+    SVN_ERR(write_rep_header(b, b->base_rep));
 
   /* Cleanup in case something goes wrong. */
   apr_pool_cleanup_register(b->scratch_pool, b, rep_write_cleanup,
                             apr_pool_cleanup_null);
 
+  /* Select the compression for this representation.  Already compressed
+     content will be stored as is.  Otherwise, if large reps get special
+     treatment, defer the decision until we know the size. */
+  SVN_ERR(is_uncompressed_mime_type(&uncompressed, fs, noderev,
+                                    b->scratch_pool));
+  if (uncompressed)
+    {
+      b->compression_type = compression_type_none;
+      b->compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+    }
+  else
+    {
+      b->compression_type = ffd->delta_compression_type;
+      b->compression_level = ffd->delta_compression_level;
+    }
+
   /* Prepare to write the svndiff data. */
-  svn_txdelta_to_svndiff3(&wh,
-                          &whb,
-                          b->rep_stream,
-                          diff_version,
-                          ffd->delta_compression_level,
-                          pool);
-
-  b->delta_stream = svn_txdelta_target_push(wh, whb, source,
-                                            b->scratch_pool);
+  b->large_rep_pending
+    =    !uncompressed
+      && ffd->large_rep_threshold > 0
+      && (   ffd->large_rep_compression_type != b->compression_type
+          || ffd->large_rep_compression_level != b->compression_level);
+
+  if (b->large_rep_pending || b->base_pending || b->chunk_pending)
+    b->pending = svn_stringbuf_create_empty(b->scratch_pool);
+  else
+    start_delta_stream(b, b->compression_type, b->compression_level);
 
   *wb_p = b;
 
@@ -2467,6 +2773,325 @@ get_shared_rep(representation_t **old_rep,
   return SVN_NO_ERROR;
 }
 
+/* Set *SAME to TRUE if the contents of the representation REP, stored in
+   B's proto-rev file at OFFSET, equal DATA.  B's file position will be
+   restored afterwards.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+chunk_contents_same(svn_boolean_t *same,
+                    struct rep_write_baton *b,
+                    representation_t *rep,
+                    apr_off_t offset,
+                    svn_stringbuf_t *data,
+                    apr_pool_t *scratch_pool)
+{
+  apr_off_t old_position;
+  svn_stream_t *contents;
+
+  SVN_ERR(svn_io_file_get_offset(&old_position, b->file, scratch_pool));
+  SVN_ERR(svn_fs_fs__get_contents_from_file(&contents, b->fs, rep, b->file,
+                                            offset, scratch_pool));
+  SVN_ERR(svn_stream_contents_same2(same, contents,
+                                    svn_stream_from_stringbuf(data,
+                                                              scratch_pool),
+                                    scratch_pool));
+
+  return svn_error_trace(svn_io_file_seek(b->file, APR_SET, &old_position,
+                                          scratch_pool));
+}
+
+/* Store B's current chunk data as a self-delta representation at the end
+   of the proto-rev file, unless an identical representation already
+   exists, and append it to B's list of chunks. */
+static svn_error_t *
+write_chunk(struct rep_write_baton *b)
+{
+  fs_fs_data_t *ffd = b->fs->fsap_data;
+  apr_pool_t *scratch_pool = svn_pool_create(b->scratch_pool);
+  svn_stringbuf_t *data = b->chunk_data;
+  representation_t *rep = apr_pcalloc(b->result_pool, sizeof(*rep));
+  representation_t *old_rep;
+  new_chunk_t *new_chunk;
+  svn_fs_fs__rep_header_t header = { 0 };
+  svn_checksum_t *checksum;
+  svn_checksum_ctx_t *fnv1a_checksum_ctx = NULL;
+  svn_stream_t *stream;
+  svn_stream_t *delta_stream;
+  svn_txdelta_window_handler_t wh;
+  void *whb;
+  int diff_version;
+  int diff_compression_level;
+  apr_off_t offset;
+  apr_off_t delta_start;
+  apr_off_t end_offset;
+  apr_size_t len = data->len;
+
+  rep->revision = SVN_INVALID_REVNUM;
+  rep->txn_id = *svn_fs_fs__id_txn_id(b->noderev->id);
+  rep->expanded_size = data->len;
+
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_md5, data->data, data->len,
+                       scratch_pool));
+  memcpy(rep->md5_digest, checksum->digest, sizeof(rep->md5_digest));
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, data->data, data->len,
+                       scratch_pool));
+  memcpy(rep->sha1_digest, checksum->digest, sizeof(rep->sha1_digest));
+  rep->has_sha1 = TRUE;
+
+  /* The same chunk may occur multiple times within the same file. */
+  new_chunk = apr_hash_get(b->new_chunks_hash, rep->sha1_digest,
+                           APR_SHA1_DIGESTSIZE);
+  if (new_chunk)
+    {
+      svn_boolean_t same;
+      SVN_ERR(chunk_contents_same(&same, b, new_chunk->rep,
+                                  new_chunk->entry.offset, data,
+                                  scratch_pool));
+      if (same)
+        {
+          APR_ARRAY_PUSH(b->chunks, representation_t *) = new_chunk->rep;
+          svn_stringbuf_setempty(data);
+          svn_pool_destroy(scratch_pool);
+
+          return SVN_NO_ERROR;
+        }
+    }
+
+  /* Write the chunk as a stand-alone rep. */
+  SVN_ERR(svn_io_file_get_offset(&offset, b->file, scratch_pool));
+  stream = svn_stream_from_aprfile2(b->file, TRUE, scratch_pool);
+  if (svn_fs_fs__use_log_addressing(b->fs))
+    stream = fnv1a_wrap_stream(&fnv1a_checksum_ctx, stream, scratch_pool);
+
+  header.type = svn_fs_fs__rep_self_delta;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, stream, scratch_pool));
+  SVN_ERR(svn_io_file_get_offset(&delta_start, b->file, scratch_pool));
+
+  if (b->large_rep_pending && b->rep_size > ffd->large_rep_threshold)
+    get_svndiff_options(&diff_version, &diff_compression_level, b->fs,
+                        ffd->large_rep_compression_type,
+                        ffd->large_rep_compression_level);
+  else
+    get_svndiff_options(&diff_version, &diff_compression_level, b->fs,
+                        b->compression_type, b->compression_level);
+
+  svn_txdelta_to_svndiff3(&wh, &whb, stream, diff_version,
+                          diff_compression_level, scratch_pool);
+  delta_stream = svn_txdelta_target_push(wh, whb,
+                                         svn_stream_empty(scratch_pool),
+                                         scratch_pool);
+  SVN_ERR(svn_stream_write(delta_stream, data->data, &len));
+  SVN_ERR(svn_stream_close(delta_stream));
+
+  SVN_ERR(svn_io_file_get_offset(&end_offset, b->file, scratch_pool));
+  rep->size = end_offset - delta_start;
+  SVN_ERR(set_uniquifier(b->fs, rep, scratch_pool));
+
+  /* Chunks are shared with other files and revisions through the same
+     rep-cache as whole representations. */
+  SVN_ERR(get_shared_rep(&old_rep, b->fs, rep, b->file, offset, NULL,
+                         b->result_pool, scratch_pool));
+  if (old_rep)
+    {
+      SVN_ERR(svn_io_file_trunc(b->file, offset, scratch_pool));
+      APR_ARRAY_PUSH(b->chunks, representation_t *) = old_rep;
+    }
+  else
+    {
+      SVN_ERR(svn_stream_puts(stream, "ENDREP\n"));
+      SVN_ERR(svn_io_file_get_offset(&end_offset, b->file, scratch_pool));
+
+      new_chunk = apr_pcalloc(b->result_pool, sizeof(*new_chunk));
+      new_chunk->rep = rep;
+      new_chunk->entry.offset = offset;
+      new_chunk->entry.size = end_offset - offset;
+      new_chunk->entry.type = SVN_FS_FS__ITEM_TYPE_FILE_REP;
+      new_chunk->entry.item.revision = SVN_INVALID_REVNUM;
+      if (fnv1a_checksum_ctx)
+        SVN_ERR(fnv1a_checksum_finalize(&new_chunk->entry.fnv1_checksum,
+                                        fnv1a_checksum_ctx, scratch_pool));
+
+      APR_ARRAY_PUSH(b->new_chunks, new_chunk_t *) = new_chunk;
+      apr_hash_set(b->new_chunks_hash, rep->sha1_digest, APR_SHA1_DIGESTSIZE,
+                   new_chunk);
+      APR_ARRAY_PUSH(b->chunks, representation_t *) = rep;
+    }
+
+  svn_stringbuf_setempty(data);
+  svn_pool_destroy(scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Split the next LEN bytes of contents in DATA into chunks and write all
+   chunks completed by them as representations for B. */
+static svn_error_t *
+write_chunked_contents(struct rep_write_baton *b,
+                       const char *data,
+                       apr_size_t len)
+{
+  while (len > 0)
+    {
+      svn_boolean_t boundary;
+      apr_size_t chunk_len = svn_fs_fs__chunker_scan(b->chunker, data, len,
+                                                     &boundary);
+
+      svn_stringbuf_appendbytes(b->chunk_data, data, chunk_len);
+      if (boundary)
+        SVN_ERR(write_chunk(b));
+
+      data += chunk_len;
+      len -= chunk_len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* The contents written to B exceeded the chunked-rep threshold.  Store
+   them as a CHUNKED rep, starting with all pending contents. */
+static svn_error_t *
+start_chunking(struct rep_write_baton *b)
+{
+  svn_stringbuf_t *pending = b->pending;
+
+  b->pending = NULL;
+  b->chunk_pending = FALSE;
+  b->base_pending = FALSE;
+
+  b->chunker = svn_fs_fs__chunker_create(b->scratch_pool);
+  b->chunk_data = svn_stringbuf_create_empty(b->scratch_pool);
+  b->chunks = apr_array_make(b->result_pool, 16,
+                             sizeof(representation_t *));
+  b->new_chunks = apr_array_make(b->scratch_pool, 16, sizeof(new_chunk_t *));
+  b->new_chunks_hash = apr_hash_make(b->scratch_pool);
+
+  return svn_error_trace(write_chunked_contents(b, pending->data,
+                                                pending->len));
+}
+
+/* Write the last chunk of B, finalize all new chunks and write the rep
+   header and chunk list of the CHUNKED rep.  B->REP_OFFSET and
+   B->DELTA_START will then refer to the CHUNKED rep itself. */
+static svn_error_t *
+write_chunk_list(struct rep_write_baton *b)
+{
+  fs_fs_data_t *ffd = b->fs->fsap_data;
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__id_txn_id(b->noderev->id);
+  svn_fs_fs__rep_header_t header = { 0 };
+  svn_stringbuf_t *chunk_reps = svn_stringbuf_create_empty(b->scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(b->scratch_pool);
+  int i;
+
+  if (b->chunk_data->len)
+    SVN_ERR(write_chunk(b));
+
+  /* Make the new chunks addressable, in the order of their offsets. */
+  for (i = 0; i < b->new_chunks->nelts; ++i)
+    {
+      new_chunk_t *new_chunk = APR_ARRAY_IDX(b->new_chunks, i, new_chunk_t *);
+      representation_t *rep = new_chunk->rep;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(allocate_item_index(&rep->item_index, b->fs, txn_id,
+                                  new_chunk->entry.offset, iterpool));
+      if (svn_fs_fs__use_log_addressing(b->fs))
+        {
+          new_chunk->entry.item.number = rep->item_index;
+          SVN_ERR(store_p2l_index_entry(b->fs, txn_id, &new_chunk->entry,
+                                        iterpool));
+        }
+
+      /* Other files in this txn may share the chunk as well. */
+      SVN_ERR(store_sha1_rep(b->fs, rep, FALSE, iterpool));
+      svn_stringbuf_appendstr(chunk_reps,
+                              svn_fs_fs__unparse_representation(rep,
+                                  ffd->format, FALSE, iterpool, iterpool));
+      svn_stringbuf_appendbyte(chunk_reps, '\n');
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Remember the new chunks for the rep-cache update upon commit. */
+  if (chunk_reps->len)
+    {
+      apr_file_t *file;
+      SVN_ERR(svn_io_file_open(&file,
+                               path_txn_chunk_reps(b->fs, txn_id,
+                                                   b->scratch_pool),
+                               APR_WRITE | APR_CREATE | APR_APPEND
+                               | APR_BUFFERED, APR_OS_DEFAULT,
+                               b->scratch_pool));
+      SVN_ERR(svn_io_file_write_full(file, chunk_reps->data, chunk_reps->len,
+                                     NULL, b->scratch_pool));
+      SVN_ERR(svn_io_file_close(file, b->scratch_pool));
+    }
+
+  /* From here on, failures must not remove the chunks anymore. */
+  SVN_ERR(svn_io_file_get_offset(&b->rep_offset, b->file, b->scratch_pool));
+
+  header.type = svn_fs_fs__rep_chunked;
+  SVN_ERR(svn_fs_fs__write_rep_header(&header, b->rep_stream,
+                                      b->scratch_pool));
+  SVN_ERR(svn_io_file_get_offset(&b->delta_start, b->file,
+                                 b->scratch_pool));
+
+  return svn_error_trace(svn_fs_fs__write_chunk_list(b->rep_stream,
+                                                     b->chunks, ffd->format,
+                                                     b->scratch_pool));
+}
+
+/* Handler for the write method of the representation writable stream.
+   BATON is a rep_write_baton, DATA is the data to write, and *LEN is
+   the length of this data. */
+static svn_error_t *
+rep_write_contents(void *baton,
+                   const char *data,
+                   apr_size_t *len)
+{
+  struct rep_write_baton *b = baton;
+
+  SVN_ERR(svn_checksum__update_both(b->md5_checksum_ctx,
+                                    b->sha1_checksum_ctx, data, *len));
+  b->rep_size += *len;
+
+  /* CHUNKED reps will never be used as delta bases. */
+  if (b->chunker)
+    return svn_error_trace(write_chunked_contents(b, data, *len));
+
+  if (b->similarity)
+    svn_fs_fs__similarity_update(b->similarity, data, *len);
+
+  if (b->pending)
+    {
+      fs_fs_data_t *ffd = b->fs->fsap_data;
+      svn_stringbuf_appendbytes(b->pending, data, *len);
+
+      /* Until the chunked-rep threshold has been exceeded, we don't know
+         whether this will become a CHUNKED rep. */
+      if (b->chunk_pending)
+        return b->rep_size <= ffd->chunked_rep_threshold
+             ? SVN_NO_ERROR
+             : svn_error_trace(start_chunking(b));
+
+      /* Fingerprints are complete once we have seen the full prefix. */
+      if (   b->base_pending
+          && b->rep_size >= SVN_FS_FS__SIMILARITY_PREFIX_SIZE)
+        SVN_ERR(choose_similar_base(b));
+
+      /* Until the large-rep threshold has been exceeded, we don't know
+         which compression to use. */
+      if (   b->base_pending
+          || (b->large_rep_pending && b->rep_size <= ffd->large_rep_threshold))
+        return SVN_NO_ERROR;
+
+      return svn_error_trace(flush_pending_contents(b));
+    }
+
+  /* If we are writing a delta, use that stream. */
+  if (b->delta_stream)
+    return svn_stream_write(b->delta_stream, data, len);
+  else
+    return svn_stream_write(b->rep_stream, data, len);
+}
+
 /* Copy the hash sum calculation results from MD5_CTX, SHA1_CTX into REP.
  * SHA1 results are only be set if SHA1_CTX is not NULL.
  * Use POOL for allocations.
@@ -2504,6 +3129,21 @@ rep_write_contents_close(void *baton)
 
   rep = apr_pcalloc(b->result_pool, sizeof(*rep));
 
+  /* Small reps may not have been written to the delta stream, yet. */
+  if (b->chunk_pending)
+    {
+      b->chunk_pending = FALSE;
+      if (!b->base_pending)
+        SVN_ERR(write_rep_header(b, b->base_rep));
+    }
+  if (b->base_pending)
+    SVN_ERR(choose_similar_base(b));
+
+  if (b->chunker)
+    SVN_ERR(write_chunk_list(b));
+  else if (b->pending)
+    SVN_ERR(flush_pending_contents(b));
+
   /* Close our delta stream so the last bits of svndiff are written
      out. */
   if (b->delta_stream)
@@ -2579,6 +3219,23 @@ rep_write_contents_close(void *baton)
 
   SVN_ERR(unlock_proto_rev(b->fs, &rep->txn_id, b->lockcookie,
                            b->scratch_pool));
+
+  /* Make the new contents available as a delta base for similar files.
+     Like for rep-sharing, problems with the rep-cache are not fatal. */
+  if (!old_rep && b->similarity && !b->chunker)
+    {
+      apr_array_header_t *fingerprints
+        = svn_fs_fs__similarity_fingerprints(b->similarity, b->scratch_pool);
+      svn_error_t *err = svn_fs_fs__set_rep_fingerprints(b->fs, rep,
+                                                         fingerprints,
+                                                         b->scratch_pool);
+      if (err)
+        {
+          (b->fs->warning)(b->fs->warning_baton, err);
+          svn_error_clear(err);
+        }
+    }
+
   svn_pool_destroy(b->scratch_pool);
 
   return SVN_NO_ERROR;
@@ -2711,9 +3368,11 @@ write_container_handler(void *baton,
 {
   struct write_container_baton *whb = baton;
 
-  SVN_ERR(svn_checksum_update(whb->md5_ctx, data, *len));
   if (whb->sha1_ctx)
-    SVN_ERR(svn_checksum_update(whb->sha1_ctx, data, *len));
+    SVN_ERR(svn_checksum__update_both(whb->md5_ctx, whb->sha1_ctx,
+                                      data, *len));
+  else
+    SVN_ERR(svn_checksum_update(whb->md5_ctx, data, *len));
 
   SVN_ERR(svn_stream_write(whb->stream, data, len));
   whb->size += *len;
@@ -2751,6 +3410,87 @@ write_directory_to_stream(svn_stream_t *stream,
   return SVN_NO_ERROR;
 }
 
+/* Implement collection_writer_t writing the svn_fs_dirent_t* array given
+   as BATON followed by an index on the entries.  The entries must be
+   sorted by name.  See the "structure" file for the data format. */
+static svn_error_t *
+write_indexed_directory_to_stream(svn_stream_t *stream,
+                                  void *baton,
+                                  apr_pool_t *pool)
+{
+  apr_array_header_t *dir = baton;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint32_t *offsets = apr_palloc(pool, dir->nelts * sizeof(*offsets));
+  svn_stringbuf_t *index;
+  apr_size_t offset = 0;
+  apr_size_t len;
+  int i;
+
+  for (i = 0; i < dir->nelts; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      offsets[i] = (apr_uint32_t)offset;
+      SVN_ERR(unparse_dir_entry(&len,
+                                APR_ARRAY_IDX(dir, i, svn_fs_dirent_t *),
+                                stream, iterpool));
+      offset += len;
+    }
+
+  len = sizeof(SVN_HASH_TERMINATOR "\n") - 1;
+  SVN_ERR(svn_stream_write(stream, SVN_HASH_TERMINATOR "\n", &len));
+  offset += len;
+
+  /* Fixed-size records allow for random access. */
+  index = svn_stringbuf_create_ensure(  dir->nelts
+                                      * SVN_FS_FS__DIR_INDEX_RECORD_LEN
+                                      + SVN_FS_FS__DIR_INDEX_FOOTER_LEN,
+                                      pool);
+  for (i = 0; i < dir->nelts; ++i)
+    {
+      char record[SVN_FS_FS__DIR_INDEX_RECORD_LEN + 1];
+      apr_snprintf(record, sizeof(record), "%08x\n", offsets[i]);
+      svn_stringbuf_appendbytes(index, record,
+                                SVN_FS_FS__DIR_INDEX_RECORD_LEN);
+    }
+
+  svn_stringbuf_appendcstr(index,
+                           apr_psprintf(iterpool,
+                                        SVN_FS_FS__DIR_INDEX_PREFIX
+                                        "%08x %08x\n",
+                                        (unsigned)dir->nelts,
+                                        (unsigned)offset));
+
+  len = index->len;
+  SVN_ERR(svn_stream_write(stream, index->data, &len));
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if directory ENTRIES in FS shall be stored with an index. */
+static svn_boolean_t
+use_dir_index(svn_fs_t *fs,
+              apr_array_header_t *entries)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  int i;
+
+  /* Deltified reps are much smaller but can't be searched on disk. */
+  if (   ffd->format < SVN_FS_FS__MIN_DIR_INDEX_FORMAT
+      || ffd->deltify_directories
+      || entries->nelts < SVN_FS_FS__DIR_INDEX_MIN_ENTRIES)
+    return FALSE;
+
+  /* The index is useless unless we can binary-search the entries. */
+  for (i = 1; i < entries->nelts; ++i)
+    if (strcmp(APR_ARRAY_IDX(entries, i - 1, svn_fs_dirent_t *)->name,
+               APR_ARRAY_IDX(entries, i, svn_fs_dirent_t *)->name) >= 0)
+      return FALSE;
+
+  return TRUE;
+}
+
 /* Write out the COLLECTION as a text representation to file FILE using
    WRITER.  In the process, record position, the total size of the dump and
    MD5 as well as SHA1 in REP.   Add the representation of type ITEM_TYPE to
@@ -2898,7 +3638,8 @@ write_container_delta_rep(representation_t *rep,
 
   struct write_container_baton *whb;
   fs_fs_data_t *ffd = fs->fsap_data;
-  int diff_version = ffd->format >= SVN_FS_FS__MIN_SVNDIFF1_FORMAT ? 1 : 0;
+  int diff_version;
+  int diff_compression_level;
   svn_boolean_t is_props = (item_type == SVN_FS_FS__ITEM_TYPE_FILE_PROPS)
                         || (item_type == SVN_FS_FS__ITEM_TYPE_DIR_PROPS);
 
@@ -2931,11 +3672,14 @@ write_container_delta_rep(representation_t *rep,
   SVN_ERR(svn_io_file_get_offset(&delta_start, file, scratch_pool));
 
   /* Prepare to write the svndiff data. */
+  get_svndiff_options(&diff_version, &diff_compression_level, fs,
+                      ffd->delta_compression_type,
+                      ffd->delta_compression_level);
   svn_txdelta_to_svndiff3(&diff_wh,
                           &diff_whb,
                           file_stream,
                           diff_version,
-                          ffd->delta_compression_level,
+                          diff_compression_level,
                           scratch_pool);
 
   whb = apr_pcalloc(scratch_pool, sizeof(*whb));
@@ -3089,6 +3833,41 @@ get_final_id(svn_fs_fs__id_part_t *part,
     }
 }
 
+/* A directory written to the proto-rev file, to be cached once the
+   commit is known to succeed. */
+typedef struct new_directory_t
+{
+  /* Key in the directory cache. */
+  pair_cache_key_t key;
+
+  /* Contents, i.e. all svn_fs_dirent_t * entries, sorted by name. */
+  apr_array_header_t *entries;
+} new_directory_t;
+
+/* Return a deep copy of the directory ENTRIES allocated in RESULT_POOL. */
+static apr_array_header_t *
+copy_dir_entries(const apr_array_header_t *entries,
+                 apr_pool_t *result_pool)
+{
+  apr_array_header_t *result
+    = apr_array_make(result_pool, entries->nelts, sizeof(svn_fs_dirent_t *));
+  int i;
+
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      const svn_fs_dirent_t *source
+        = APR_ARRAY_IDX(entries, i, svn_fs_dirent_t *);
+      svn_fs_dirent_t *dirent = apr_palloc(result_pool, sizeof(*dirent));
+
+      dirent->name = apr_pstrdup(result_pool, source->name);
+      dirent->id = svn_fs_fs__id_copy(source->id, result_pool);
+      dirent->kind = source->kind;
+      APR_ARRAY_PUSH(result, svn_fs_dirent_t *) = dirent;
+    }
+
+  return result;
+}
+
 /* Copy a node-revision specified by id ID in fileystem FS from a
    transaction into the proto-rev-file FILE.  Set *NEW_ID_P to a
    pointer to the new node-id which will be allocated in POOL.
@@ -3103,8 +3882,8 @@ get_final_id(svn_fs_fs__id_part_t *part,
    INITIAL_OFFSET is the offset of the proto-rev-file on entry to
    commit_body.
 
-   Collect the pair_cache_key_t of all directories written to the
-   committed cache in DIRECTORY_IDS.
+   If FS has a directory cache, collect a new_directory_t for each
+   directory written in DIRECTORY_IDS, allocated in its pool.
 
    If REPS_TO_CACHE is not NULL, append to it a copy (allocated in
    REPS_POOL) of each data rep that is new in this revision.
@@ -3178,12 +3957,14 @@ write_final_rev(const svn_fs_id_t **new_id_p,
 
       if (noderev->data_rep && is_txn_rep(noderev->data_rep))
         {
-          pair_cache_key_t *key;
-          svn_fs_fs__dir_data_t dir_data;
-
           /* Write out the contents of this directory as a text rep. */
           noderev->data_rep->revision = rev;
-          if (ffd->deltify_directories)
+          if (use_dir_index(fs, entries))
+            SVN_ERR(write_container_rep(noderev->data_rep, file, entries,
+                                        write_indexed_directory_to_stream,
+                                        fs, NULL, FALSE,
+                                        SVN_FS_FS__ITEM_TYPE_DIR_REP, pool));
+          else if (ffd->deltify_directories)
             SVN_ERR(write_container_delta_rep(noderev->data_rep, file,
                                               entries,
                                               write_directory_to_stream,
@@ -3198,22 +3979,21 @@ write_final_rev(const svn_fs_id_t **new_id_p,
 
           reset_txn_in_rep(noderev->data_rep);
 
-          /* Cache the new directory contents.  Otherwise, subsequent reads
-           * or commits will likely have to reconstruct, verify and parse
-           * it again. */
-          key = apr_array_push(directory_ids);
-          key->revision = noderev->data_rep->revision;
-          key->second = noderev->data_rep->item_index;
-
-          /* Store directory contents under the new revision number but mark
-           * it as "stale" by setting the file length to 0.  Committed dirs
-           * will report -1, in-txn dirs will report > 0, so that this can
-           * never match.  We reset that to -1 after the commit is complete.
-           */
-          dir_data.entries = entries;
-          dir_data.txn_filesize = 0;
+          /* Remember the new directory contents so that commit_body can
+           * cache them.  Otherwise, subsequent reads or commits will likely
+           * have to reconstruct, verify and parse them again.  We may not
+           * be holding the write lock here, so the cache must not be
+           * touched yet: a concurrent commit based on the same revision
+           * would use the same keys. */
+          if (ffd->dir_cache)
+            {
+              apr_pool_t *result_pool = directory_ids->pool;
+              new_directory_t *dir = apr_array_push(directory_ids);
 
-          SVN_ERR(svn_cache__set(ffd->dir_cache, key, &dir_data, subpool));
+              dir->key.revision = noderev->data_rep->revision;
+              dir->key.second = noderev->data_rep->item_index;
+              dir->entries = copy_dir_entries(entries, result_pool);
+            }
         }
     }
   else
@@ -3468,13 +4248,15 @@ verify_as_revision_before_current_plus_plus(svn_fs_t *fs,
 
 /* Update the 'current' file to hold the correct next node and copy_ids
    from transaction TXN_ID in filesystem FS.  The current revision is
-   set to REV.  Perform temporary allocations in POOL. */
+   set to REV.  If DEFER_FLUSH is set, leave it to the caller to flush
+   the file to disk.  Perform temporary allocations in POOL. */
 static svn_error_t *
 write_final_current(svn_fs_t *fs,
                     const svn_fs_fs__id_part_t *txn_id,
                     svn_revnum_t rev,
                     apr_uint64_t start_node_id,
                     apr_uint64_t start_copy_id,
+                    svn_boolean_t defer_flush,
                     apr_pool_t *pool)
 {
   apr_uint64_t txn_node_id;
@@ -3482,14 +4264,20 @@ write_final_current(svn_fs_t *fs,
   fs_fs_data_t *ffd = fs->fsap_data;
 
   if (ffd->format >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT)
-    return svn_fs_fs__write_current(fs, rev, 0, 0, pool);
+    start_node_id = start_copy_id = 0;
+  else
+    {
+      /* To find the next available ids, we add the id that used to be in
+         the 'current' file, to the next ids from the transaction file. */
+      SVN_ERR(read_next_ids(&txn_node_id, &txn_copy_id, fs, txn_id, pool));
 
-  /* To find the next available ids, we add the id that used to be in
-     the 'current' file, to the next ids from the transaction file. */
-  SVN_ERR(read_next_ids(&txn_node_id, &txn_copy_id, fs, txn_id, pool));
+      start_node_id += txn_node_id;
+      start_copy_id += txn_copy_id;
+    }
 
-  start_node_id += txn_node_id;
-  start_copy_id += txn_copy_id;
+  if (defer_flush)
+    return svn_fs_fs__write_current_no_flush(fs, rev, start_node_id,
+                                             start_copy_id, pool);
 
   return svn_fs_fs__write_current(fs, rev, start_node_id, start_copy_id,
                                   pool);
@@ -3569,12 +4357,13 @@ verify_locks(svn_fs_t *fs,
 
 /* Writes final revision properties to file PATH applying permissions
    from file PERMS_REFERENCE. This involves setting svn:date and
-   removing any temporary properties associated with the commit flags. */
+   removing any temporary properties associated with the commit flags.
+   The file and its directory entry get scheduled for fsync in BATCH. */
 static svn_error_t *
 write_final_revprop(const char *path,
                     const char *perms_reference,
                     svn_fs_txn_t *txn,
-                    svn_boolean_t flush_to_disk,
+                    svn_fs_fs__batch_fsync_t *batch,
                     apr_pool_t *pool)
 {
   apr_hash_t *txnprops;
@@ -3604,20 +4393,18 @@ write_final_revprop(const char *path,
       svn_hash_sets(txnprops, SVN_PROP_REVISION_DATE, &date);
     }
 
-  /* Create new revprops file. Tell OS to truncate existing file,
-     since  file may already exists from failed transaction. */
-  SVN_ERR(svn_io_file_open(&revprop_file, path,
-                           APR_WRITE | APR_CREATE | APR_TRUNCATE
-                           | APR_BUFFERED, APR_OS_DEFAULT, pool));
+  /* Create new revprops file.  Truncate any existing file, since the
+     file may already exist from a failed transaction.  BATCH owns the
+     file handle and will flush and close it. */
+  SVN_ERR(svn_fs_fs__batch_fsync_open_file(&revprop_file, batch, path,
+                                           pool));
+  SVN_ERR(svn_fs_fs__batch_fsync_new_path(batch, path, pool));
+  SVN_ERR(svn_io_file_trunc(revprop_file, 0, pool));
 
   stream = svn_stream_from_aprfile2(revprop_file, TRUE, pool);
   SVN_ERR(svn_hash_write2(txnprops, stream, SVN_HASH_TERMINATOR, pool));
   SVN_ERR(svn_stream_close(stream));
 
-  if (flush_to_disk)
-    SVN_ERR(svn_io_file_flush_to_disk(revprop_file, pool));
-  SVN_ERR(svn_io_file_close(revprop_file, pool));
-
   SVN_ERR(svn_io_copy_perms(perms_reference, path, pool));
 
   return SVN_NO_ERROR;
@@ -3664,6 +4451,46 @@ svn_fs_fs__add_index_data(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Store the new_directory_t contents in DIRECTORY_IDS in the directory
+ * cache of FS but mark them as "stale" by setting the file length to 0.
+ * Committed dirs will report -1, in-txn dirs will report > 0, so that
+ * this can never match.  promote_cached_directories() resets that to -1
+ * after the commit is complete.
+ *
+ * The caller must hold the FS write lock and have checked that the
+ * transaction is not out of date.  Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+cache_new_directories(svn_fs_t *fs,
+                      apr_array_header_t *directory_ids,
+                      apr_pool_t *scratch_pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  apr_pool_t *iterpool;
+  int i;
+
+  if (!ffd->dir_cache)
+    return SVN_NO_ERROR;
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < directory_ids->nelts; ++i)
+    {
+      const new_directory_t *dir
+        = &APR_ARRAY_IDX(directory_ids, i, new_directory_t);
+      svn_fs_fs__dir_data_t dir_data;
+
+      svn_pool_clear(iterpool);
+
+      dir_data.entries = dir->entries;
+      dir_data.txn_filesize = 0;
+      SVN_ERR(svn_cache__set(ffd->dir_cache, &dir->key, &dir_data,
+                             iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Mark the directories cached in FS with the keys from DIRECTORY_IDS
  * as "valid" now.  Use SCRATCH_POOL for temporaries. */
 static svn_error_t *
@@ -3682,7 +4509,7 @@ promote_cached_directories(svn_fs_t *fs,
   for (i = 0; i < directory_ids->nelts; ++i)
     {
       const pair_cache_key_t *key
-        = &APR_ARRAY_IDX(directory_ids, i, pair_cache_key_t);
+        = &APR_ARRAY_IDX(directory_ids, i, new_directory_t).key;
 
       svn_pool_clear(iterpool);
 
@@ -3699,6 +4526,47 @@ promote_cached_directories(svn_fs_t *fs,
   return SVN_NO_ERROR;
 }
 
+/* Add the chunk representations written in transaction TXN_ID within FS
+ * to REPS_TO_CACHE, allocated in RESULT_POOL.  NEW_REV is the revision
+ * the chunks now belong to.  Use SCRATCH_POOL for temporaries.
+ */
+static svn_error_t *
+get_chunk_reps_to_cache(apr_array_header_t *reps_to_cache,
+                        svn_fs_t *fs,
+                        const svn_fs_fs__id_part_t *txn_id,
+                        svn_revnum_t new_rev,
+                        apr_pool_t *result_pool,
+                        apr_pool_t *scratch_pool)
+{
+  const char *path = path_txn_chunk_reps(fs, txn_id, scratch_pool);
+  apr_pool_t *iterpool;
+  svn_node_kind_t kind;
+  svn_stringbuf_t *contents;
+  char *line, *eol;
+
+  SVN_ERR(svn_io_check_path(path, &kind, scratch_pool));
+  if (kind != svn_node_file)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_stringbuf_from_file2(&contents, path, scratch_pool));
+  iterpool = svn_pool_create(scratch_pool);
+  for (line = contents->data; (eol = strchr(line, '\n')); line = eol + 1)
+    {
+      representation_t *rep;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_fs__parse_representation(&rep,
+                                 svn_stringbuf_ncreate(line, eol - line,
+                                                       iterpool),
+                                 result_pool, iterpool));
+      rep->revision = new_rev;
+      APR_ARRAY_PUSH(reps_to_cache, representation_t *) = rep;
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Baton used for commit_body below. */
 struct commit_baton {
   svn_revnum_t *new_rev_p;
@@ -3707,97 +4575,154 @@ struct commit_baton {
   apr_array_header_t *reps_to_cache;
   apr_hash_t *reps_hash;
   apr_pool_t *reps_pool;
-};
 
-/* The work-horse for svn_fs_fs__commit, called with the FS write lock.
-   This implements the svn_fs_fs__with_write_lock() 'body' callback
-   type.  BATON is a 'struct commit_baton *'. */
-static svn_error_t *
-commit_body(void *baton, apr_pool_t *pool)
-{
-  struct commit_baton *cb = baton;
-  fs_fs_data_t *ffd = cb->fs->fsap_data;
-  const char *old_rev_filename, *rev_filename, *proto_filename;
-  const char *revprop_filename;
-  const svn_fs_id_t *root_id, *new_root_id;
-  apr_uint64_t start_node_id;
-  apr_uint64_t start_copy_id;
-  svn_revnum_t old_rev, new_rev;
-  apr_file_t *proto_file;
-  void *proto_file_lockcookie;
-  apr_off_t initial_offset, changed_path_offset;
-  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
+  /* TRUE, if prepare_commit() has finalized the proto-rev file and we
+     still hold its lock. */
+  svn_boolean_t prepared;
+
+  /* TRUE, once the proto-rev file has been moved into place, i.e. the
+     preparation can no longer be rolled back. */
+  svn_boolean_t moved;
+
+  /* Repository format and revision number that the proto-rev file has
+     been finalized for.  Only valid if PREPARED is set. */
+  int prepared_format;
+  svn_revnum_t new_rev;
+
+  /* Results of prepare_commit() that commit_body needs as well. */
   apr_hash_t *changed_paths;
-  apr_array_header_t *directory_ids = apr_array_make(pool, 4,
-                                                     sizeof(pair_cache_key_t));
+  apr_array_header_t *directory_ids;
+  void *proto_file_lockcookie;
 
-  /* Re-Read the current repository format.  All our repo upgrade and
-     config evaluation strategies are such that existing information in
-     FS and FFD remains valid.
+  /* Sizes of the proto-rev file and its proto-index files before
+     prepare_commit() appended to them. */
+  apr_off_t proto_rev_size;
+  apr_off_t l2p_proto_index_size;
+  apr_off_t p2l_proto_index_size;
 
-     Although we don't recommend upgrading hot repositories, people may
-     still do it and we must make sure to either handle them gracefully
-     or to error out.
+  /* TRUE, if the caller of commit_body() flushes 'current' to disk. */
+  svn_boolean_t defer_current_flush;
 
-     Committing pre-format 3 txns will fail after upgrade to format 3+
-     because the proto-rev cannot be found; no further action needed.
-     Upgrades from pre-f7 to f7+ means a potential change in addressing
-     mode for the final rev.  We must be sure to detect that cause because
-     the failure would only manifest once the new revision got committed.
-   */
-  SVN_ERR(svn_fs_fs__read_format_file(cb->fs, pool));
+  /* Pool for the results of prepare_commit(), including the proto-rev
+     lock.  Must survive the commit_body() call. */
+  apr_pool_t *pool;
+};
 
-  /* Read the current youngest revision and, possibly, the next available
-     node id and copy id (for old format filesystems).  Update the cached
-     value for the youngest revision, because we have just checked it. */
-  SVN_ERR(svn_fs_fs__read_current(&old_rev, &start_node_id, &start_copy_id,
-                                  cb->fs, pool));
-  ffd->youngest_rev_cache = old_rev;
+/* Set *SIZE to the size of file PATH or to 0, if it does not exist.
+   Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+get_file_size(apr_off_t *size,
+              const char *path,
+              apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  svn_error_t *err = svn_io_stat(&finfo, path, APR_FINFO_SIZE,
+                                 scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *size = 0;
+      return SVN_NO_ERROR;
+    }
 
-  /* Check to make sure this transaction is based off the most recent
-     revision. */
-  if (cb->txn->base_rev != old_rev)
-    return svn_error_create(SVN_ERR_FS_TXN_OUT_OF_DATE, NULL,
-                            _("Transaction out of date"));
+  SVN_ERR(err);
+  *size = finfo.size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Truncate file PATH to SIZE bytes, if it exists.
+   Use SCRATCH_POOL for temporaries. */
+static svn_error_t *
+truncate_file(const char *path,
+              apr_off_t size,
+              apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  svn_error_t *err = svn_io_file_open(&file, path, APR_WRITE,
+                                      APR_OS_DEFAULT, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(err);
+  SVN_ERR(svn_io_file_trunc(file, size, scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Finalize the proto-rev file of the transaction in CB as revision
+   CB->TXN->BASE_REV + 1, i.e. write the node-revisions, directories,
+   the changed-paths list and either the index data or the revision
+   trailer.  The proto-rev file remains locked.  START_NODE_ID and
+   START_COPY_ID are the first available node and copy ids for older
+   FS formats.
+
+   This does not require the FS write lock as long as the repository
+   uses txn-local ids: the new revision number is implied by the base
+   revision and the result will simply be rolled back by
+   rollback_commit() if the transaction turns out to be out of date.
+   Use POOL for allocations that commit_body needs as well. */
+static svn_error_t *
+prepare_commit(struct commit_baton *cb,
+               apr_uint64_t start_node_id,
+               apr_uint64_t start_copy_id,
+               apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
+  const svn_fs_id_t *root_id, *new_root_id;
+  apr_file_t *proto_file;
+  apr_off_t changed_path_offset;
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
+  const char *l2p_proto_index
+    = svn_fs_fs__path_l2p_proto_index(cb->fs, txn_id, pool);
+  const char *p2l_proto_index
+    = svn_fs_fs__path_p2l_proto_index(cb->fs, txn_id, pool);
+
+  /* We are going to be one better than our base revision. */
+  cb->new_rev = cb->txn->base_rev + 1;
+  cb->prepared_format = ffd->format;
+  cb->directory_ids = apr_array_make(pool, 4, sizeof(new_directory_t));
 
   /* We need the changes list for verification as well as for writing it
      to the final rev file. */
-  SVN_ERR(svn_fs_fs__txn_changes_fetch(&changed_paths, cb->fs, txn_id,
+  SVN_ERR(svn_fs_fs__txn_changes_fetch(&cb->changed_paths, cb->fs, txn_id,
                                        pool));
 
-  /* Locks may have been added (or stolen) between the calling of
-     previous svn_fs.h functions and svn_fs_commit_txn(), so we need
-     to re-examine every changed-path in the txn and re-verify all
-     discovered locks. */
-  SVN_ERR(verify_locks(cb->fs, txn_id, changed_paths, pool));
-
-  /* We are going to be one better than this puny old revision. */
-  new_rev = old_rev + 1;
-
   /* Get a write handle on the proto revision file. */
-  SVN_ERR(get_writable_proto_rev(&proto_file, &proto_file_lockcookie,
+  SVN_ERR(get_writable_proto_rev(&proto_file, &cb->proto_file_lockcookie,
                                  cb->fs, txn_id, pool));
-  SVN_ERR(svn_io_file_get_offset(&initial_offset, proto_file, pool));
+  SVN_ERR(svn_io_file_get_offset(&cb->proto_rev_size, proto_file, pool));
+  SVN_ERR(get_file_size(&cb->l2p_proto_index_size, l2p_proto_index, pool));
+  SVN_ERR(get_file_size(&cb->p2l_proto_index_size, p2l_proto_index, pool));
+  cb->prepared = TRUE;
 
   /* Write out all the node-revisions and directory contents. */
   root_id = svn_fs_fs__id_txn_create_root(txn_id, pool);
-  SVN_ERR(write_final_rev(&new_root_id, proto_file, new_rev, cb->fs, root_id,
-                          start_node_id, start_copy_id, initial_offset,
-                          directory_ids, cb->reps_to_cache, cb->reps_hash,
+  SVN_ERR(write_final_rev(&new_root_id, proto_file, cb->new_rev, cb->fs,
+                          root_id, start_node_id, start_copy_id,
+                          cb->proto_rev_size, cb->directory_ids,
+                          cb->reps_to_cache, cb->reps_hash,
                           cb->reps_pool, TRUE, pool));
 
+  /* Chunks of CHUNKED reps are not referenced by any noderev. */
+  if (cb->reps_to_cache)
+    SVN_ERR(get_chunk_reps_to_cache(cb->reps_to_cache, cb->fs, txn_id,
+                                    cb->new_rev, cb->reps_pool, pool));
+
   /* Write the changed-path information. */
   SVN_ERR(write_final_changed_path_info(&changed_path_offset, proto_file,
-                                        cb->fs, txn_id, changed_paths,
+                                        cb->fs, txn_id, cb->changed_paths,
                                         pool));
 
   if (svn_fs_fs__use_log_addressing(cb->fs))
     {
       /* Append the index data to the rev file. */
       SVN_ERR(svn_fs_fs__add_index_data(cb->fs, proto_file,
-                      svn_fs_fs__path_l2p_proto_index(cb->fs, txn_id, pool),
-                      svn_fs_fs__path_p2l_proto_index(cb->fs, txn_id, pool),
-                      new_rev, pool));
+                                        l2p_proto_index, p2l_proto_index,
+                                        cb->new_rev, pool));
     }
   else
     {
@@ -3820,6 +4745,124 @@ commit_body(void *baton, apr_pool_t *pool)
      race with another caller writing to the prototype revision file
      before we commit it. */
 
+  return SVN_NO_ERROR;
+}
+
+/* Undo the effects of prepare_commit() for the transaction in CB, i.e.
+   cut the proto-rev file and its proto-indexes back to their original
+   sizes and release the proto-rev lock, leaving the transaction in the
+   same state as before the commit attempt.  Use SCRATCH_POOL for
+   temporaries. */
+static svn_error_t *
+rollback_commit(struct commit_baton *cb,
+                apr_pool_t *scratch_pool)
+{
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
+
+  SVN_ERR_ASSERT(cb->prepared && !cb->moved);
+  cb->prepared = FALSE;
+
+  /* Forget about reps and directories that will not be part of the new
+     revision. */
+  if (cb->reps_to_cache)
+    apr_array_clear(cb->reps_to_cache);
+  if (cb->reps_hash)
+    apr_hash_clear(cb->reps_hash);
+  apr_array_clear(cb->directory_ids);
+
+  SVN_ERR(truncate_file(svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id,
+                                                      scratch_pool),
+                        cb->proto_rev_size, scratch_pool));
+  if (svn_fs_fs__use_log_addressing(cb->fs))
+    {
+      SVN_ERR(truncate_file(svn_fs_fs__path_l2p_proto_index(cb->fs, txn_id,
+                                                            scratch_pool),
+                            cb->l2p_proto_index_size, scratch_pool));
+      SVN_ERR(truncate_file(svn_fs_fs__path_p2l_proto_index(cb->fs, txn_id,
+                                                            scratch_pool),
+                            cb->p2l_proto_index_size, scratch_pool));
+    }
+
+  return svn_error_trace(unlock_proto_rev(cb->fs, txn_id,
+                                          cb->proto_file_lockcookie,
+                                          scratch_pool));
+}
+
+/* The work-horse for svn_fs_fs__commit, called with the FS write lock.
+   This implements the svn_fs_fs__with_write_lock() 'body' callback
+   type.  BATON is a 'struct commit_baton *'.
+
+   If the proto-rev file has already been finalized by prepare_commit(),
+   only check that this is still valid and publish the new revision. */
+static svn_error_t *
+commit_body(void *baton, apr_pool_t *pool)
+{
+  struct commit_baton *cb = baton;
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
+  const char *old_rev_filename, *rev_filename, *proto_filename;
+  const char *revprop_filename;
+  apr_uint64_t start_node_id;
+  apr_uint64_t start_copy_id;
+  svn_revnum_t old_rev, new_rev;
+  svn_fs_fs__batch_fsync_t *batch;
+  const svn_fs_fs__id_part_t *txn_id = svn_fs_fs__txn_get_id(cb->txn);
+
+  /* Re-Read the current repository format.  All our repo upgrade and
+     config evaluation strategies are such that existing information in
+     FS and FFD remains valid.
+
+     Although we don't recommend upgrading hot repositories, people may
+     still do it and we must make sure to either handle them gracefully
+     or to error out.
+
+     Committing pre-format 3 txns will fail after upgrade to format 3+
+     because the proto-rev cannot be found; no further action needed.
+     Upgrades from pre-f7 to f7+ means a potential change in addressing
+     mode for the final rev.  We must be sure to detect that cause because
+     the failure would only manifest once the new revision got committed.
+     A proto-rev that has been finalized for a different format gets
+     rolled back and written again.
+   */
+  SVN_ERR(svn_fs_fs__read_format_file(cb->fs, pool));
+  if (cb->prepared && cb->prepared_format != ffd->format)
+    SVN_ERR(rollback_commit(cb, pool));
+
+  /* Read the current youngest revision and, possibly, the next available
+     node id and copy id (for old format filesystems).  Update the cached
+     value for the youngest revision, because we have just checked it. */
+  SVN_ERR(svn_fs_fs__read_current(&old_rev, &start_node_id, &start_copy_id,
+                                  cb->fs, pool));
+  ffd->youngest_rev_cache = old_rev;
+
+  /* Check to make sure this transaction is based off the most recent
+     revision. */
+  if (cb->txn->base_rev != old_rev)
+    return svn_error_create(SVN_ERR_FS_TXN_OUT_OF_DATE, NULL,
+                            _("Transaction out of date"));
+
+  /* Finalize the proto-rev file now, unless we already did so before
+     acquiring the write lock. */
+  if (!cb->prepared)
+    SVN_ERR(prepare_commit(cb, start_node_id, start_copy_id, cb->pool));
+
+  /* We are going to be one better than this puny old revision. */
+  new_rev = old_rev + 1;
+  SVN_ERR_ASSERT(new_rev == cb->new_rev);
+
+  /* Only now that we hold the lock and know that this transaction will
+     become NEW_REV may we cache its directories under that revision. */
+  SVN_ERR(cache_new_directories(cb->fs, cb->directory_ids, pool));
+
+  /* Locks may have been added (or stolen) between the calling of
+     previous svn_fs.h functions and svn_fs_commit_txn(), so we need
+     to re-examine every changed-path in the txn and re-verify all
+     discovered locks. */
+  SVN_ERR(verify_locks(cb->fs, txn_id, cb->changed_paths, pool));
+
+  /* Collect all files and directories that we touch from here on and
+     fsync them concurrently, right before bumping 'current'. */
+  SVN_ERR(svn_fs_fs__batch_fsync_create(&batch, ffd->flush_to_disk, pool));
+
   /* Create the shard for the rev and revprop file, if we're sharding and
      this is the first revision of a new shard.  We don't care if this
      fails because the shard already existed for some reason. */
@@ -3838,6 +4881,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_fs_fs__batch_fsync_new_path(batch, new_dir, pool));
         }
 
       /* Create the revprops shard. */
@@ -3854,6 +4898,7 @@ commit_body(void *baton, apr_pool_t *pool)
                                                     PATH_REVPROPS_DIR,
                                                     pool),
                                     new_dir, pool));
+          SVN_ERR(svn_fs_fs__batch_fsync_new_path(batch, new_dir, pool));
         }
     }
 
@@ -3865,26 +4910,32 @@ commit_body(void *baton, apr_pool_t *pool)
   old_rev_filename = svn_fs_fs__path_rev_absolute(cb->fs, old_rev, pool);
   rev_filename = svn_fs_fs__path_rev(cb->fs, new_rev, pool);
   proto_filename = svn_fs_fs__path_txn_proto_rev(cb->fs, txn_id, pool);
-  SVN_ERR(svn_fs_fs__move_into_place(proto_filename, rev_filename,
-                                     old_rev_filename, ffd->flush_to_disk,
-                                     pool));
+  SVN_ERR(svn_fs_fs__batch_move_into_place(proto_filename, rev_filename,
+                                           old_rev_filename, batch, pool));
+  cb->moved = TRUE;
 
   /* Now that we've moved the prototype revision file out of the way,
      we can unlock it (since further attempts to write to the file
      will fail as it no longer exists).  We must do this so that we can
      remove the transaction directory later. */
-  SVN_ERR(unlock_proto_rev(cb->fs, txn_id, proto_file_lockcookie, pool));
+  cb->prepared = FALSE;
+  SVN_ERR(unlock_proto_rev(cb->fs, txn_id, cb->proto_file_lockcookie, pool));
 
   /* Write final revprops file. */
   SVN_ERR_ASSERT(! svn_fs_fs__is_packed_revprop(cb->fs, new_rev));
   revprop_filename = svn_fs_fs__path_revprops(cb->fs, new_rev, pool);
   SVN_ERR(write_final_revprop(revprop_filename, old_rev_filename,
-                              cb->txn, ffd->flush_to_disk, pool));
+                              cb->txn, batch, pool));
+
+  /* Make sure the rev and revprop files as well as any new shard
+     directories are on disk before 'current' makes them visible. */
+  SVN_ERR(svn_fs_fs__batch_fsync_run(batch, pool));
 
   /* Update the 'current' file. */
   SVN_ERR(verify_as_revision_before_current_plus_plus(cb->fs, new_rev, pool));
   SVN_ERR(write_final_current(cb->fs, txn_id, new_rev, start_node_id,
-                              start_copy_id, pool));
+                              start_copy_id, cb->defer_current_flush,
+                              pool));
 
   /* At this point the new revision is committed and globally visible
      so let the caller know it succeeded by giving it the new revision
@@ -3897,7 +4948,7 @@ commit_body(void *baton, apr_pool_t *pool)
 
   /* Make the directory contents alreday cached for the new revision
    * visible. */
-  SVN_ERR(promote_cached_directories(cb->fs, directory_ids, pool));
+  SVN_ERR(promote_cached_directories(cb->fs, cb->directory_ids, pool));
 
   /* Remove this transaction directory. */
   SVN_ERR(svn_fs_fs__purge_txn(cb->fs, cb->txn->id, pool));
@@ -3905,25 +4956,93 @@ commit_body(void *baton, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
-/* Add the representations in REPS_TO_CACHE (an array of representation_t *)
- * to the rep-cache database of FS. */
+/* Initialize CB for committing TXN in FS, returning the new revision
+   in *NEW_REV_P.  Allocate the rep-sharing data and everything else that
+   must survive the write lock in POOL. */
+static void
+init_commit_baton(struct commit_baton *cb,
+                  svn_revnum_t *new_rev_p,
+                  svn_fs_t *fs,
+                  svn_fs_txn_t *txn,
+                  apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  cb->new_rev_p = new_rev_p;
+  cb->fs = fs;
+  cb->txn = txn;
+
+  if (ffd->rep_sharing_allowed)
+    {
+      cb->reps_to_cache = apr_array_make(pool, 5, sizeof(representation_t *));
+      cb->reps_hash = apr_hash_make(pool);
+      cb->reps_pool = pool;
+    }
+  else
+    {
+      cb->reps_to_cache = NULL;
+      cb->reps_hash = NULL;
+      cb->reps_pool = NULL;
+    }
+
+  cb->prepared = FALSE;
+  cb->moved = FALSE;
+  cb->defer_current_flush = FALSE;
+  cb->pool = pool;
+}
+
+/* With txn-local ids, the contents of the new revision depend on its
+   number only, which is implied by the base revision.  So, finalize
+   the proto-rev file for CB before acquiring the write lock to keep
+   other committers waiting for as short as possible.  Don't bother if
+   we know already that this will fail.  Use POOL for allocations. */
 static svn_error_t *
-write_reps_to_cache(svn_fs_t *fs,
-                    const apr_array_header_t *reps_to_cache,
-                    apr_pool_t *scratch_pool)
+prepare_commit_early(struct commit_baton *cb,
+                     apr_pool_t *pool)
 {
-  int i;
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
 
-  for (i = 0; i < reps_to_cache->nelts; i++)
+  if (ffd->format >= SVN_FS_FS__MIN_NO_GLOBAL_IDS_FORMAT)
     {
-      representation_t *rep = APR_ARRAY_IDX(reps_to_cache, i, representation_t *);
+      svn_revnum_t youngest;
+      SVN_ERR(svn_fs_fs__youngest_rev(&youngest, cb->fs, pool));
+      if (cb->txn->base_rev != youngest)
+        return svn_error_create(SVN_ERR_FS_TXN_OUT_OF_DATE, NULL,
+                                _("Transaction out of date"));
 
-      SVN_ERR(svn_fs_fs__set_rep_reference(fs, rep, scratch_pool));
+      SVN_ERR(prepare_commit(cb, 0, 0, pool));
     }
 
   return SVN_NO_ERROR;
 }
 
+/* Clean up after the commit described by CB returned ERR and do the
+   post-commit work.  Use POOL for allocations. */
+static svn_error_t *
+finish_commit(struct commit_baton *cb,
+              svn_error_t *err,
+              apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
+
+  /* Leave the txn intact if we could not complete the commit. */
+  if (err && cb->prepared && !cb->moved)
+    err = svn_error_compose_create(err, rollback_commit(cb, pool));
+
+  SVN_ERR(err);
+
+  /* At this point, *NEW_REV_P has been set, so errors below won't affect
+     the success of the commit.  (See svn_fs_commit_txn().)  */
+
+  /* Write new entries to the rep-sharing database, possibly in the
+     background.  They refer to a committed revision now. */
+  if (ffd->rep_sharing_allowed)
+    SVN_ERR(svn_fs_fs__queue_rep_references(cb->fs, cb->reps_to_cache,
+                                            pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__commit(svn_revnum_t *new_rev_p,
                   svn_fs_t *fs,
@@ -3931,64 +5050,275 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
                   apr_pool_t *pool)
 {
   struct commit_baton cb;
-  fs_fs_data_t *ffd = fs->fsap_data;
+  svn_error_t *err;
 
-  cb.new_rev_p = new_rev_p;
-  cb.fs = fs;
-  cb.txn = txn;
+  init_commit_baton(&cb, new_rev_p, fs, txn, pool);
 
-  if (ffd->rep_sharing_allowed)
+  err = prepare_commit_early(&cb, pool);
+  if (!err)
+    err = svn_fs_fs__with_write_lock(fs, commit_body, &cb, pool);
+
+  return svn_error_trace(finish_commit(&cb, err, pool));
+}
+
+#if APR_HAS_THREADS
+
+/* A commit waiting in FS_FS_SHARED_DATA_T.GROUP_COMMIT_QUEUE. */
+struct svn_fs_fs__group_commit_t
+{
+  /* The commit to run. */
+  struct commit_baton *cb;
+
+  /* Parameters given to svn_fs_fs__group_commit. */
+  svn_fs_fs__rebase_txn_func_t rebase_func;
+  void *rebase_baton;
+
+  /* Result of the commit.  Only valid once DONE has been set. */
+  svn_error_t *err;
+  svn_boolean_t done;
+
+  /* Next commit in the queue.  NULL for the last one. */
+  struct svn_fs_fs__group_commit_t *next;
+};
+
+typedef struct svn_fs_fs__group_commit_t group_commit_t;
+
+/* Baton for group_commit_enter and group_commit_leave. */
+typedef struct group_commit_baton_t
+{
+  /* Shared data of the repository. */
+  fs_fs_shared_data_t *ffsd;
+
+  /* The commit of the calling thread. */
+  group_commit_t *entry;
+
+  /* Set by group_commit_enter, iff the calling thread has to run the
+     queued commits. */
+  svn_boolean_t leader;
+
+  /* The commits taken from the queue by the leader. */
+  group_commit_t *group;
+} group_commit_baton_t;
+
+/* Append BATON->ENTRY to the queue and wait until either it has been
+   committed or we become the leader.  In the latter case, set
+   BATON->LEADER.  To be called with GROUP_COMMIT_LOCK held. */
+static svn_error_t *
+group_commit_enter(group_commit_baton_t *baton)
+{
+  fs_fs_shared_data_t *ffsd = baton->ffsd;
+  group_commit_t **last = &ffsd->group_commit_queue;
+
+  while (*last)
+    last = &(*last)->next;
+  *last = baton->entry;
+
+  while (!baton->entry->done)
     {
-      cb.reps_to_cache = apr_array_make(pool, 5, sizeof(representation_t *));
-      cb.reps_hash = apr_hash_make(pool);
-      cb.reps_pool = pool;
+      apr_status_t status;
+
+      if (!ffsd->group_commit_leader)
+        {
+          ffsd->group_commit_leader = TRUE;
+          baton->leader = TRUE;
+          break;
+        }
+
+      status = apr_thread_cond_wait(ffsd->group_commit_done,
+                                    svn_mutex__get(ffsd->group_commit_lock));
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't wait for condition variable"));
     }
-  else
+
+  return SVN_NO_ERROR;
+}
+
+/* Take all queued commits and put them into BATON->GROUP.  To be called
+   by the leader with GROUP_COMMIT_LOCK held. */
+static svn_error_t *
+group_commit_take(group_commit_baton_t *baton)
+{
+  baton->group = baton->ffsd->group_commit_queue;
+  baton->ffsd->group_commit_queue = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Mark all commits in BATON->GROUP as done, hand over the leadership and
+   wake up all waiting committers.  To be called by the leader with
+   GROUP_COMMIT_LOCK held. */
+static svn_error_t *
+group_commit_leave(group_commit_baton_t *baton)
+{
+  fs_fs_shared_data_t *ffsd = baton->ffsd;
+  group_commit_t *entry;
+  apr_status_t status;
+
+  for (entry = baton->group; entry; entry = entry->next)
+    entry->done = TRUE;
+
+  ffsd->group_commit_leader = FALSE;
+
+  status = apr_thread_cond_broadcast(ffsd->group_commit_done);
+  if (status)
+    return svn_error_wrap_apr(status,
+                              _("Can't broadcast condition variable"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Run the commit ENTRY of a group.  We hold the write lock, but it may
+   have been acquired through a different svn_fs_t.  Use POOL for
+   temporary allocations. */
+static svn_error_t *
+group_commit_one(group_commit_t *entry,
+                 apr_pool_t *pool)
+{
+  struct commit_baton *cb = entry->cb;
+  fs_fs_data_t *ffd = cb->fs->fsap_data;
+  svn_revnum_t youngest;
+
+  /* Read what svn_fs_fs__with_write_lock would have read for CB->FS. */
+  if (ffd->format >= SVN_FS_FS__MIN_PACKED_FORMAT)
+    SVN_ERR(svn_fs_fs__update_min_unpacked_rev(cb->fs, pool));
+  SVN_ERR(svn_fs_fs__youngest_rev(&youngest, cb->fs, pool));
+
+  /* Earlier commits of this group may have made the txn out of date.
+     Nobody can commit in between now, so merge the latest changes into
+     the txn and let commit_body() finalize the proto-rev again. */
+  if (cb->txn->base_rev != youngest)
     {
-      cb.reps_to_cache = NULL;
-      cb.reps_hash = NULL;
-      cb.reps_pool = NULL;
+      if (cb->prepared)
+        SVN_ERR(rollback_commit(cb, pool));
+
+      SVN_ERR(entry->rebase_func(entry->rebase_baton, cb->txn, youngest,
+                                 pool));
     }
 
-  SVN_ERR(svn_fs_fs__with_write_lock(fs, commit_body, &cb, pool));
+  return svn_error_trace(commit_body(cb, pool));
+}
 
-  /* At this point, *NEW_REV_P has been set, so errors below won't affect
-     the success of the commit.  (See svn_fs_commit_txn().)  */
+/* Make the contents of the 'current' file in FS and its name persistent.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+flush_current(svn_fs_t *fs,
+              apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  const char *path = svn_fs_fs__path_current(fs, pool);
+  svn_fs_fs__batch_fsync_t *batch;
+  apr_file_t *file;
 
-  if (ffd->rep_sharing_allowed)
-    {
-      svn_error_t *err;
+  SVN_ERR(svn_fs_fs__batch_fsync_create(&batch, ffd->flush_to_disk, pool));
+  SVN_ERR(svn_fs_fs__batch_fsync_open_file(&file, batch, path, pool));
+  SVN_ERR(svn_fs_fs__batch_fsync_new_path(batch, path, pool));
 
-      SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+  return svn_error_trace(svn_fs_fs__batch_fsync_run(batch, pool));
+}
 
-      /* Write new entries to the rep-sharing database.
-       *
-       * We use an sqlite transaction to speed things up;
-       * see <http://www.sqlite.org/faq.html#q19>.
-       */
-      /* ### A commit that touches thousands of files will starve other
-             (reader/writer) commits for the duration of the below call.
-             Maybe write in batches? */
-      SVN_ERR(svn_sqlite__begin_transaction(ffd->rep_cache_db));
-      err = write_reps_to_cache(fs, cb.reps_to_cache, pool);
-      err = svn_sqlite__finish_transaction(ffd->rep_cache_db, err);
-
-      if (svn_error_find_cause(err, SVN_ERR_SQLITE_ROLLBACK_FAILED))
-        {
-          /* Failed rollback means that our db connection is unusable, and
-             the only thing we can do is close it.  The connection will be
-             reopened during the next operation with rep-cache.db. */
-          return svn_error_trace(
-              svn_error_compose_create(err,
-                                       svn_fs_fs__close_rep_cache(fs)));
-        }
-      else if (err)
-        return svn_error_trace(err);
+/* Implements the svn_fs_fs__with_write_lock() body for the group commit
+   leader.  BATON is a group_commit_baton_t.  Commit all transactions of
+   the group back-to-back and flush 'current' once at the end. */
+static svn_error_t *
+group_commit_body(void *baton,
+                  apr_pool_t *pool)
+{
+  group_commit_baton_t *gcb = baton;
+  group_commit_t *entry;
+  svn_fs_t *last_fs = NULL;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_error_t *err;
+
+  SVN_MUTEX__WITH_LOCK(gcb->ffsd->group_commit_lock, group_commit_take(gcb));
+
+  for (entry = gcb->group; entry; entry = entry->next)
+    {
+      svn_pool_clear(iterpool);
+
+      entry->cb->defer_current_flush = TRUE;
+      entry->err = group_commit_one(entry, iterpool);
+      if (SVN_IS_VALID_REVNUM(*entry->cb->new_rev_p))
+        last_fs = entry->cb->fs;
     }
 
+  /* Don't report any commit as complete before 'current' is on disk.
+     If that fails, all revisions of this group are affected. */
+  svn_pool_clear(iterpool);
+  err = last_fs ? flush_current(last_fs, iterpool) : SVN_NO_ERROR;
+  if (err)
+    for (entry = gcb->group; entry; entry = entry->next)
+      if (SVN_IS_VALID_REVNUM(*entry->cb->new_rev_p))
+        entry->err = svn_error_compose_create(entry->err,
+                                              svn_error_dup(err));
+
+  svn_error_clear(err);
+  svn_pool_destroy(iterpool);
+
   return SVN_NO_ERROR;
 }
 
+#endif
+
+svn_error_t *
+svn_fs_fs__group_commit(svn_revnum_t *new_rev_p,
+                        svn_fs_t *fs,
+                        svn_fs_txn_t *txn,
+                        svn_fs_fs__rebase_txn_func_t rebase_func,
+                        void *rebase_baton,
+                        apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  fs_fs_data_t *ffd = fs->fsap_data;
+  struct commit_baton cb;
+  group_commit_t entry = { 0 };
+  group_commit_baton_t gcb = { 0 };
+  svn_error_t *err;
+
+  init_commit_baton(&cb, new_rev_p, fs, txn, pool);
+  *new_rev_p = SVN_INVALID_REVNUM;
+
+  /* Do as much as possible before joining the queue.  Being out of date
+     is not a problem here as the txn may be rebased under the lock. */
+  err = prepare_commit_early(&cb, pool);
+  if (err && err->apr_err == SVN_ERR_FS_TXN_OUT_OF_DATE)
+    {
+      svn_error_clear(err);
+      err = SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  entry.cb = &cb;
+  entry.rebase_func = rebase_func;
+  entry.rebase_baton = rebase_baton;
+  gcb.ffsd = ffd->shared;
+  gcb.entry = &entry;
+
+  /* Wait for our commit to be run by another thread or run it ourselves,
+     together with everything that has been queued by then. */
+  SVN_MUTEX__WITH_LOCK(gcb.ffsd->group_commit_lock, group_commit_enter(&gcb));
+  if (gcb.leader)
+    {
+      group_commit_t *member;
+
+      err = svn_fs_fs__with_write_lock(fs, group_commit_body, &gcb, pool);
+
+      /* If we could not get the lock, no commit of the group has run. */
+      if (err)
+        for (member = gcb.group; member; member = member->next)
+          member->err = svn_error_dup(err);
+      svn_error_clear(err);
+
+      SVN_MUTEX__WITH_LOCK(gcb.ffsd->group_commit_lock,
+                           group_commit_leave(&gcb));
+    }
+
+  return svn_error_trace(finish_commit(&cb, entry.err, pool));
+#else
+  return svn_error_trace(svn_fs_fs__commit(new_rev_p, fs, txn, pool));
+#endif
+}
+
 
 svn_error_t *
 svn_fs_fs__list_transactions(apr_array_header_t **names_p,
@@ -220,6 +220,33 @@ svn_fs_fs__commit(svn_revnum_t *new_rev_p,
                   svn_fs_txn_t *txn,
                   apr_pool_t *pool);
 
+/* Callback merging the changes committed since TXN's base revision up to
+   revision YOUNGEST into TXN and making YOUNGEST the new base revision
+   of TXN.  BATON is the baton passed to svn_fs_fs__group_commit.
+   Must return SVN_ERR_FS_CONFLICT if the changes cannot be merged.
+   Use SCRATCH_POOL for temporary allocations. */
+typedef svn_error_t *
+(*svn_fs_fs__rebase_txn_func_t)(void *baton,
+                                svn_fs_txn_t *txn,
+                                svn_revnum_t youngest,
+                                apr_pool_t *scratch_pool);
+
+/* Like svn_fs_fs__commit but let a single thread of this process commit
+   TXN together with all other transactions of FS that wait for the write
+   lock at the same time.  If TXN is out of date by the time it gets
+   committed, call REBASE_FUNC with REBASE_BATON under the write lock
+   instead of failing.  'current' is flushed to disk once per group.
+
+   Fall back to svn_fs_fs__commit in builds without thread support.
+   Use POOL for temporary allocations. */
+svn_error_t *
+svn_fs_fs__group_commit(svn_revnum_t *new_rev_p,
+                        svn_fs_t *fs,
+                        svn_fs_txn_t *txn,
+                        svn_fs_fs__rebase_txn_func_t rebase_func,
+                        void *rebase_baton,
+                        apr_pool_t *pool);
+
 /* Set *NAMES_P to an array of names which are all the active
    transactions in filesystem FS.  Allocate the array from POOL. */
 svn_error_t *
@@ -57,6 +57,7 @@
 #include "lock.h"
 #include "tree.h"
 #include "fs_fs.h"
+#include "history_index.h"
 #include "id.h"
 #include "pack.h"
 #include "temp_serializer.h"
@@ -66,6 +67,7 @@
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_fs_util.h"
+#include "private/svn_sorts_private.h"
 #include "private/svn_fspath.h"
 #include "../libsvn_fs/fs-loader.h"
 
@@ -386,6 +388,142 @@ cache_lookup_last_path(fs_fs_dag_cache_t *cache,
   return NULL;
 }
 
+/* Process-wide 1st level cache.
+ *
+ * Every svn_fs_t gets its own 1st level cache, i.e. servers that open a
+ * new svn_fs_t for each request start with an empty one and would need
+ * to deserialize the nodes of popular paths from the 2nd level cache
+ * again and again.  Therefore, all instances of the same filesystem share
+ * another cache of native DAG nodes for revision roots.  Access to it is
+ * serialized.  Nodes get copied in and out of it, so no instance depends
+ * on the lifetime of another.
+ */
+
+/* Implements svn_atomic__init_once_func_t, creating the containers for
+ * the shared DAG node caches in the fs_fs_shared_data_t in BATON. */
+static svn_error_t *
+create_shared_dag_caches(void *baton,
+                         apr_pool_t *pool)
+{
+  fs_fs_shared_data_t *shared = baton;
+
+  shared->dag_node_caches_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  shared->dag_node_caches = apr_hash_make(shared->dag_node_caches_pool);
+
+  return svn_error_trace(svn_mutex__init(&shared->dag_node_caches_lock,
+                                         TRUE, shared->common_pool));
+}
+
+/* Body of get_shared_dag_cache, called with the lock held. */
+static svn_error_t *
+get_shared_dag_cache_body(fs_fs_data_t *ffd)
+{
+  fs_fs_shared_data_t *shared = ffd->shared;
+  fs_fs_dag_cache_t *cache = svn_hash_gets(shared->dag_node_caches,
+                                           ffd->cache_prefix);
+
+  /* Instances with different cache namespaces or paths, e.g. naively
+   * copied repositories, must not see each other's nodes. */
+  if (cache == NULL)
+    {
+      cache = svn_fs_fs__create_dag_cache(shared->dag_node_caches_pool);
+      svn_hash_sets(shared->dag_node_caches,
+                    apr_pstrdup(shared->dag_node_caches_pool,
+                                ffd->cache_prefix),
+                    cache);
+    }
+
+  ffd->shared_dag_node_cache = cache;
+
+  return SVN_NO_ERROR;
+}
+
+/* Make sure that the shared DAG node cache of FS has been set. */
+static svn_error_t *
+get_shared_dag_cache(svn_fs_t *fs)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+
+  if (ffd->shared_dag_node_cache)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&ffd->shared->dag_node_caches_initialized,
+                                create_shared_dag_caches, ffd->shared,
+                                NULL));
+  SVN_MUTEX__WITH_LOCK(ffd->shared->dag_node_caches_lock,
+                       get_shared_dag_cache_body(ffd));
+
+  return SVN_NO_ERROR;
+}
+
+/* Body of shared_cache_lookup, called with the lock held. */
+static svn_error_t *
+shared_cache_lookup_body(dag_node_t **node_p,
+                         fs_fs_dag_cache_t *cache,
+                         svn_revnum_t revision,
+                         const char *path,
+                         apr_pool_t *pool)
+{
+  dag_node_t *node = cache_lookup(cache, revision, path);
+  *node_p = node ? svn_fs_fs__dag_dup(node, pool) : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* In *NODE_P, return a copy of the DAG node for PATH in revision ROOT
+   from the shared DAG node cache, or NULL if it isn't cached.  *NODE_P
+   is allocated in POOL. */
+static svn_error_t *
+shared_cache_lookup(dag_node_t **node_p,
+                    svn_fs_root_t *root,
+                    const char *path,
+                    apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = root->fs->fsap_data;
+
+  SVN_ERR(get_shared_dag_cache(root->fs));
+  SVN_MUTEX__WITH_LOCK(ffd->shared->dag_node_caches_lock,
+                       shared_cache_lookup_body(node_p,
+                                                ffd->shared_dag_node_cache,
+                                                root->rev, path, pool));
+
+  /* The node may have come from another FS object. */
+  if (*node_p)
+    svn_fs_fs__dag_set_fs(*node_p, root->fs);
+
+  return SVN_NO_ERROR;
+}
+
+/* Body of shared_cache_insert, called with the lock held. */
+static svn_error_t *
+shared_cache_insert_body(fs_fs_dag_cache_t *cache,
+                         svn_revnum_t revision,
+                         const char *path,
+                         dag_node_t *node)
+{
+  cache_insert(cache, revision, path, node);
+
+  return SVN_NO_ERROR;
+}
+
+/* Store a copy of NODE for PATH in revision ROOT in the shared DAG node
+   cache. */
+static svn_error_t *
+shared_cache_insert(svn_fs_root_t *root,
+                    const char *path,
+                    dag_node_t *node)
+{
+  fs_fs_data_t *ffd = root->fs->fsap_data;
+
+  SVN_ERR(get_shared_dag_cache(root->fs));
+  SVN_MUTEX__WITH_LOCK(ffd->shared->dag_node_caches_lock,
+                       shared_cache_insert_body(ffd->shared_dag_node_cache,
+                                                root->rev, path, node));
+
+  return SVN_NO_ERROR;
+}
+
 /* 2nd level cache */
 
 /* Find and return the DAG node cache for ROOT and the key that
@@ -443,17 +581,27 @@ dag_node_cache_get(dag_node_t **node_p,
       node = cache_lookup(ffd->dag_node_cache, root->rev, path);
       if (node == NULL)
         {
-          locate_cache(&cache, &key, root, path, pool);
-          SVN_ERR(svn_cache__get((void **)&node, &found, cache, key, pool));
-          if (found && node)
+          /* Other FS objects may have used that node recently. */
+          SVN_ERR(shared_cache_lookup(&node, root, path, pool));
+          if (node == NULL)
             {
-              /* Patch up the FS, since this might have come from an old FS
-               * object. */
-              svn_fs_fs__dag_set_fs(node, root->fs);
+              locate_cache(&cache, &key, root, path, pool);
+              SVN_ERR(svn_cache__get((void **)&node, &found, cache, key,
+                                     pool));
+              if (found && node)
+                {
+                  /* Patch up the FS, since this might have come from an
+                   * old FS object. */
+                  svn_fs_fs__dag_set_fs(node, root->fs);
 
-              /* Retain the DAG node in L1 cache. */
-              cache_insert(ffd->dag_node_cache, root->rev, path, node);
+                  /* Share it with the other FS objects. */
+                  SVN_ERR(shared_cache_insert(root, path, node));
+                }
             }
+
+          /* Retain the DAG node in L1 cache. */
+          if (node)
+            cache_insert(ffd->dag_node_cache, root->rev, path, node);
         }
       else
         {
@@ -495,7 +643,13 @@ dag_node_cache_set(svn_fs_root_t *root,
   SVN_ERR_ASSERT(*path == '/');
 
   locate_cache(&cache, &key, root, path, pool);
-  return svn_cache__set(cache, key, node, pool);
+  SVN_ERR(svn_cache__set(cache, key, node, pool));
+
+  /* Immutable nodes are also shared with the other FS objects. */
+  if (!root->is_txn_root)
+    SVN_ERR(shared_cache_insert(root, path, node));
+
+  return SVN_NO_ERROR;
 }
 
 
@@ -1502,6 +1656,137 @@ svn_fs_fs__check_path(svn_node_kind_t *kind_p,
   return SVN_NO_ERROR;
 }
 
+/* A path passed to fs_check_paths() and its position in the caller's list. */
+typedef struct check_paths_entry_t
+{
+  const char *path;
+  int idx;
+} check_paths_entry_t;
+
+/* Implements the comparison_func of svn_sort__array(), ordering
+   check_paths_entry_t elements such that all paths within a directory
+   come directly after the directory itself. */
+static int
+compare_check_paths_entries(const void *lhs,
+                            const void *rhs)
+{
+  const check_paths_entry_t *lhs_entry = lhs;
+  const check_paths_entry_t *rhs_entry = rhs;
+
+  return svn_path_compare_paths(lhs_entry->path, rhs_entry->path);
+}
+
+/* Implements root_vtable_t.check_paths().
+
+   Walk the PATHS in tree order and keep the chain of directories leading
+   to the previous path open, such that each directory gets opened only
+   once per call. */
+static svn_error_t *
+fs_check_paths(apr_array_header_t **kinds,
+               svn_fs_root_t *root,
+               const apr_array_header_t *paths,
+               apr_pool_t *result_pool,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *entries
+    = apr_array_make(scratch_pool, paths->nelts, sizeof(check_paths_entry_t));
+
+  /* The directories from the root down to the deepest one opened so far
+     and their respective paths. */
+  apr_array_header_t *dirs
+    = apr_array_make(scratch_pool, 16, sizeof(dag_node_t *));
+  apr_array_header_t *dir_paths
+    = apr_array_make(scratch_pool, 16, sizeof(const char *));
+  dag_node_t *node;
+  int i;
+
+  *kinds = apr_array_make(result_pool, paths->nelts,
+                          sizeof(svn_node_kind_t));
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      check_paths_entry_t *entry = apr_array_push(entries);
+      entry->path
+        = svn_fs__canonicalize_abspath(APR_ARRAY_IDX(paths, i, const char *),
+                                       scratch_pool);
+      entry->idx = i;
+
+      APR_ARRAY_PUSH(*kinds, svn_node_kind_t) = svn_node_none;
+    }
+
+  svn_sort__array(entries, compare_check_paths_entries);
+
+  SVN_ERR(root_node(&node, root, scratch_pool));
+  APR_ARRAY_PUSH(dirs, dag_node_t *) = node;
+  APR_ARRAY_PUSH(dir_paths, const char *) = "/";
+
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      const check_paths_entry_t *entry
+        = &APR_ARRAY_IDX(entries, i, check_paths_entry_t);
+      const char *remainder;
+      svn_node_kind_t kind;
+
+      svn_pool_clear(iterpool);
+
+      /* Return to the deepest open directory that contains this path.
+         The root contains all of them. */
+      while (!(remainder = svn_fspath__skip_ancestor(
+                             APR_ARRAY_IDX(dir_paths, dir_paths->nelts - 1,
+                                           const char *),
+                             entry->path)))
+        {
+          apr_array_pop(dirs);
+          apr_array_pop(dir_paths);
+        }
+
+      /* Open the remaining path components one by one. */
+      node = APR_ARRAY_IDX(dirs, dirs->nelts - 1, dag_node_t *);
+      kind = svn_fs_fs__dag_node_kind(node);
+      while (*remainder && kind == svn_node_dir)
+        {
+          const char *end = strchr(remainder, '/');
+          const char *name = end
+                           ? apr_pstrmemdup(iterpool, remainder,
+                                            end - remainder)
+                           : remainder;
+          dag_node_t *child;
+
+          SVN_ERR(svn_fs_fs__dag_open(&child, node, name, iterpool, iterpool));
+          if (child == NULL)
+            {
+              kind = svn_node_none;
+              break;
+            }
+
+          node = child;
+          kind = svn_fs_fs__dag_node_kind(node);
+          remainder = end ? end + 1 : "";
+
+          /* Keep sub-directories open for the following paths. */
+          if (kind == svn_node_dir)
+            {
+              apr_size_t len = end ? end - entry->path : strlen(entry->path);
+
+              APR_ARRAY_PUSH(dirs, dag_node_t *)
+                = svn_fs_fs__dag_dup(node, scratch_pool);
+              APR_ARRAY_PUSH(dir_paths, const char *)
+                = apr_pstrmemdup(scratch_pool, entry->path, len);
+            }
+        }
+
+      /* Files don't have sub-paths. */
+      if (*remainder)
+        kind = svn_node_none;
+
+      APR_ARRAY_IDX(*kinds, entry->idx, svn_node_kind_t) = kind;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Set *VALUE_P to the value of the property named PROPNAME of PATH in
    ROOT.  If the node has no property by that name, set *VALUE_P to
    zero.  Allocate the result in POOL. */
@@ -2177,6 +2462,36 @@ merge_changes(dag_node_t *ancestor_node,
 }
 
 
+/* Baton for rebase_txn(). */
+typedef struct rebase_txn_baton_t
+{
+  /* Receives the description of the conflict, if any. */
+  svn_stringbuf_t *conflict;
+} rebase_txn_baton_t;
+
+/* Implements svn_fs_fs__rebase_txn_func_t.  This does the same as
+   an iteration of the merge loop in svn_fs_fs__commit_txn(), only that
+   it gets called under the write lock by the group commit. */
+static svn_error_t *
+rebase_txn(void *baton,
+           svn_fs_txn_t *txn,
+           svn_revnum_t youngest,
+           apr_pool_t *scratch_pool)
+{
+  rebase_txn_baton_t *b = baton;
+  svn_fs_root_t *youngest_root;
+  dag_node_t *youngest_root_node;
+
+  SVN_ERR(svn_fs_fs__revision_root(&youngest_root, txn->fs, youngest,
+                                   scratch_pool));
+  SVN_ERR(get_root(&youngest_root_node, youngest_root, scratch_pool));
+  SVN_ERR(merge_changes(NULL, youngest_root_node, txn, b->conflict,
+                        scratch_pool));
+  txn->base_rev = youngest;
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_fs__commit_txn(const char **conflict_p,
                       svn_revnum_t *new_rev,
@@ -2277,8 +2592,23 @@ svn_fs_fs__commit_txn(const char **conflict_p,
         }
       txn->base_rev = youngish_rev;
 
-      /* Try to commit. */
-      err = svn_fs_fs__commit(new_rev, fs, txn, iterpool);
+      /* Try to commit.  Group commits merge once more under the write
+         lock, if they have to. */
+      if (ffd->group_commit)
+        {
+          rebase_txn_baton_t baton;
+          baton.conflict = conflict;
+
+          err = svn_fs_fs__group_commit(new_rev, fs, txn, rebase_txn,
+                                        &baton, iterpool);
+          if (err && (err->apr_err == SVN_ERR_FS_CONFLICT) && conflict_p)
+            *conflict_p = conflict->data;
+        }
+      else
+        {
+          err = svn_fs_fs__commit(new_rev, fs, txn, iterpool);
+        }
+
       if (err && (err->apr_err == SVN_ERR_FS_TXN_OUT_OF_DATE))
         {
           /* Did someone else finish committing a new revision while we
@@ -2316,6 +2646,10 @@ svn_fs_fs__commit_txn(const char **conflict_p,
     {
       SVN_ERR(svn_fs_fs__pack(fs, 0, NULL, NULL, NULL, NULL, pool));
     }
+  else
+    {
+      SVN_ERR(svn_fs_fs__schedule_background_pack(fs, *new_rev, pool));
+    }
 
   return SVN_NO_ERROR;
 }
@@ -2438,8 +2772,33 @@ fs_dir_optimal_order(apr_array_header_t **ordered_p,
                      apr_pool_t *result_pool,
                      apr_pool_t *scratch_pool)
 {
-  *ordered_p = svn_fs_fs__order_dir_entries(root->fs, entries, result_pool,
-                                            scratch_pool);
+  fs_fs_data_t *ffd = root->fs->fsap_data;
+  apr_array_header_t *ordered;
+
+  ordered = svn_fs_fs__order_dir_entries(root->fs, entries, result_pool,
+                                         scratch_pool);
+
+  /* Callers will typically visit all entries in that order.  Fetch their
+   * node-revisions with combined index lookups and I/O to warm the cache.
+   */
+  if (ffd->node_revision_cache && ordered->nelts > 1)
+    {
+      const svn_fs_id_t **ids = apr_palloc(scratch_pool,
+                                           ordered->nelts * sizeof(*ids));
+      node_revision_t **noderevs = apr_palloc(scratch_pool,
+                                              ordered->nelts
+                                                * sizeof(*noderevs));
+      int i;
+
+      for (i = 0; i < ordered->nelts; ++i)
+        ids[i] = APR_ARRAY_IDX(ordered, i, svn_fs_dirent_t *)->id;
+
+      SVN_ERR(svn_fs_fs__get_node_revisions(noderevs, root->fs, ids,
+                                            ordered->nelts, scratch_pool,
+                                            scratch_pool));
+    }
+
+  *ordered_p = ordered;
 
   return SVN_NO_ERROR;
 }
@@ -2918,6 +3277,33 @@ fs_try_process_file_contents(svn_boolean_t *success,
 /* --- End machinery for svn_fs_try_process_file_contents() ---  */
 
 
+/* --- Machinery for svn_fs__try_get_contents_regions() ---  */
+
+static svn_error_t *
+fs_try_get_contents_regions(apr_file_t **file,
+                            apr_array_header_t **regions,
+                            svn_fs_root_t *root,
+                            const char *path,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
+{
+  dag_node_t *node;
+
+  *file = NULL;
+  if (root->is_txn_root)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_dag(&node, root, path, scratch_pool));
+  if (svn_fs_fs__dag_node_kind(node) != svn_node_file)
+    return SVN_NO_ERROR;
+
+  return svn_fs_fs__dag_try_get_contents_regions(file, regions, node,
+                                                 result_pool, scratch_pool);
+}
+
+/* --- End machinery for svn_fs__try_get_contents_regions() ---  */
+
+
 /* --- Machinery for svn_fs_apply_textdelta() ---  */
 
 
@@ -3840,28 +4226,51 @@ history_prev(svn_fs_history_t **prev_history,
     {
       /* We know the last reported node (CURRENT_ID) and the NEXT_COPY
          revision is somewhat further in the past. */
-      node_revision_t *noderev;
+      svn_boolean_t indexed;
+      const svn_fs_id_t *predecessor_id;
+      const char *created_path;
       assert(reported);
 
-      /* Get the previous node change.  If there is none, then we already
-         reported the initial addition and this history traversal is done. */
-      SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs, fhd->current_id,
-                                           scratch_pool, scratch_pool));
-      if (! noderev->predecessor_id)
+      /* Get the previous node change, preferably from the history index.
+         If there is none, then we already reported the initial addition
+         and this history traversal is done. */
+      SVN_ERR(svn_fs_fs__history_index_lookup(&indexed, &predecessor_id,
+                                              &created_path, fs,
+                                              fhd->current_id,
+                                              scratch_pool, scratch_pool));
+      if (! indexed)
+        {
+          node_revision_t *noderev;
+          svn_boolean_t last;
+
+          SVN_ERR(svn_fs_fs__get_node_revision(&noderev, fs,
+                                               fhd->current_id,
+                                               scratch_pool, scratch_pool));
+          predecessor_id = noderev->predecessor_id;
+          created_path = noderev->created_path;
+
+          /* Remember the node change for the next traversal. */
+          last = ! predecessor_id
+              || svn_fs_fs__id_rev(predecessor_id) <= fhd->next_copy;
+          SVN_ERR(svn_fs_fs__history_index_add(fs, noderev, last,
+                                               scratch_pool));
+        }
+
+      if (! predecessor_id)
         return SVN_NO_ERROR;
 
       /* If the previous node change is younger than the next copy, it is
          part of the linear history section. */
-      commit_rev = svn_fs_fs__id_rev(noderev->predecessor_id);
+      commit_rev = svn_fs_fs__id_rev(predecessor_id);
       if (commit_rev > fhd->next_copy)
         {
           /* Within the linear history, simply report all node changes and
              continue with the respective predecessor. */
-          *prev_history = assemble_history(fs, noderev->created_path,
+          *prev_history = assemble_history(fs, created_path,
                                            commit_rev, TRUE, NULL,
                                            SVN_INVALID_REVNUM,
                                            fhd->next_copy,
-                                           noderev->predecessor_id,
+                                           predecessor_id,
                                            result_pool);
 
           return SVN_NO_ERROR;
@@ -4504,6 +4913,7 @@ static root_vtable_t root_vtable = {
   fs_paths_changed,
   fs_report_changes,
   svn_fs_fs__check_path,
+  fs_check_paths,
   fs_node_history,
   svn_fs_fs__node_id,
   fs_node_relation,
@@ -4527,6 +4937,7 @@ static root_vtable_t root_vtable = {
   fs_file_checksum,
   fs_file_contents,
   fs_try_process_file_contents,
+  fs_try_get_contents_regions,
   fs_make_file,
   fs_apply_textdelta,
   fs_apply_text,
@@ -21,9 +21,14 @@
  */
 
 #include <assert.h>
+#include <string.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#endif
 
 #include "svn_ctype.h"
 #include "svn_dirent_uri.h"
+#include "svn_sorts.h"
 #include "private/svn_string_private.h"
 
 #include "fs_fs.h"
@@ -492,12 +497,15 @@ svn_fs_fs__read_current(svn_revnum_t *rev,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_fs_fs__write_current(svn_fs_t *fs,
-                         svn_revnum_t rev,
-                         apr_uint64_t next_node_id,
-                         apr_uint64_t next_copy_id,
-                         apr_pool_t *pool)
+/* Implement svn_fs_fs__write_current and svn_fs_fs__write_current_no_flush.
+   Flush the new file to disk only if FLUSH_TO_DISK is set. */
+static svn_error_t *
+write_current(svn_fs_t *fs,
+              svn_revnum_t rev,
+              apr_uint64_t next_node_id,
+              apr_uint64_t next_copy_id,
+              svn_boolean_t flush_to_disk,
+              apr_pool_t *pool)
 {
   char *buf;
   const char *name;
@@ -521,11 +529,34 @@ svn_fs_fs__write_current(svn_fs_t *fs,
   name = svn_fs_fs__path_current(fs, pool);
   SVN_ERR(svn_io_write_atomic2(name, buf, strlen(buf),
                                name /* copy_perms_path */,
-                               ffd->flush_to_disk, pool));
+                               flush_to_disk, pool));
 
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__write_current(svn_fs_t *fs,
+                         svn_revnum_t rev,
+                         apr_uint64_t next_node_id,
+                         apr_uint64_t next_copy_id,
+                         apr_pool_t *pool)
+{
+  fs_fs_data_t *ffd = fs->fsap_data;
+  return svn_error_trace(write_current(fs, rev, next_node_id, next_copy_id,
+                                       ffd->flush_to_disk, pool));
+}
+
+svn_error_t *
+svn_fs_fs__write_current_no_flush(svn_fs_t *fs,
+                                  svn_revnum_t rev,
+                                  apr_uint64_t next_node_id,
+                                  apr_uint64_t next_copy_id,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(write_current(fs, rev, next_node_id, next_copy_id,
+                                       FALSE, pool));
+}
+
 svn_error_t *
 svn_fs_fs__try_stringbuf_from_file(svn_stringbuf_t **content,
                                    svn_boolean_t *missing,
@@ -673,9 +704,377 @@ svn_fs_fs__move_into_place(const char *old_filename,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_fs_fs__batch_move_into_place(const char *old_filename,
+                                 const char *new_filename,
+                                 const char *perms_reference,
+                                 svn_fs_fs__batch_fsync_t *batch,
+                                 apr_pool_t *pool)
+{
+  svn_error_t *err;
+  apr_file_t *file;
+
+  /* Copying permissions is a no-op on WIN32. */
+  SVN_ERR(svn_io_copy_perms(perms_reference, old_filename, pool));
+
+  /* The directory update fsync is POSIX-only and Windows has specific
+   * 'fsyncing move' API calls.  So, schedule the fsync on POSIX and use
+   * the "immediate" one everywhere else. */
+#if defined(SVN_ON_POSIX)
+  err = svn_io_file_rename2(old_filename, new_filename, FALSE, pool);
+#else
+  err = svn_io_file_rename2(old_filename, new_filename, TRUE, pool);
+#endif
+
+  if (err && APR_STATUS_IS_EXDEV(err->apr_err))
+    {
+      /* Can't rename across devices; fall back to copying.  The copy's
+         contents need to be flushed as well. */
+      svn_error_clear(err);
+      SVN_ERR(svn_io_copy_file(old_filename, new_filename, TRUE, pool));
+      SVN_ERR(svn_fs_fs__batch_fsync_open_file(&file, batch, new_filename,
+                                               pool));
+    }
+  else if (err)
+    return svn_error_trace(err);
+
+  /* Schedule the directory entry for synchronization. */
+  SVN_ERR(svn_fs_fs__batch_fsync_new_path(batch, new_filename, pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_boolean_t
 svn_fs_fs__use_log_addressing(svn_fs_t *fs)
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   return ffd->use_log_addressing;
 }
+
+/* A job in a svn_fs_fs__job_ring_t. */
+typedef struct job_t
+{
+  /* The ring this job belongs to. */
+  svn_fs_fs__job_ring_t *ring;
+
+  /* Copy of the baton passed to svn_fs_fs__job_ring_push(). */
+  void *baton;
+
+  /* Private pool of this job. */
+  apr_pool_t *pool;
+
+#if APR_HAS_THREADS
+  /* The worker thread.  NULL if it could not be started or has already
+   * been joined. */
+  apr_thread_t *thread;
+#endif
+
+  /* Set once the job has run.  ERR is its result. */
+  svn_boolean_t done;
+  svn_error_t *err;
+} job_t;
+
+struct svn_fs_fs__job_ring_t
+{
+  /* Parameters passed to svn_fs_fs__job_ring_create(). */
+  svn_fs_t *fs;
+  int capacity;
+  apr_size_t baton_size;
+  svn_fs_fs__job_func_t job_func;
+
+  /* Ring buffer of CAPACITY jobs.  COUNT of them are in use, starting at
+   * HEAD. */
+  job_t *jobs;
+  int head;
+  int count;
+
+  /* Parent of all job pools.  If jobs run in worker threads, this pool
+   * uses a thread-safe allocator. */
+  apr_pool_t *job_pool;
+};
+
+#if APR_HAS_THREADS
+
+/* Implements apr_thread_start_t, running the job_t in DATA.  The ring's
+ * FS must not be used by more than one thread, so give the job a private
+ * instance of it. */
+static void * APR_THREAD_FUNC
+job_worker(apr_thread_t *thread,
+           void *data)
+{
+  job_t *job = data;
+  svn_fs_t *fs = NULL;
+
+  if (job->ring->fs)
+    job->err = svn_fs_fs__open_private(&fs, job->ring->fs, job->pool,
+                                       job->pool);
+  if (!job->err)
+    job->err = job->ring->job_func(job->baton, fs, job->pool);
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+#endif
+
+/* Wait for the worker of JOB to finish and add any thread failure to
+ * JOB's result. */
+static void
+join_job(job_t *job)
+{
+#if APR_HAS_THREADS
+  if (job->thread)
+    {
+      apr_status_t result = APR_SUCCESS;
+      apr_status_t status = apr_thread_join(&result, job->thread);
+
+      job->thread = NULL;
+      job->done = TRUE;
+      if (status || result)
+        job->err = svn_error_compose_create(
+                     job->err,
+                     svn_error_wrap_apr(status ? status : result,
+                                        _("FSFS worker thread failed")));
+    }
+#endif
+}
+
+/* Pool cleanup handler aborting all jobs of the svn_fs_fs__job_ring_t
+ * in DATA. */
+static apr_status_t
+job_ring_cleanup(void *data)
+{
+  svn_fs_fs__job_ring_t *ring = data;
+
+  svn_fs_fs__job_ring_clear(ring);
+  svn_pool_destroy(ring->job_pool);
+
+  return APR_SUCCESS;
+}
+
+svn_fs_fs__job_ring_t *
+svn_fs_fs__job_ring_create(svn_fs_t *fs,
+                           int capacity,
+                           apr_size_t baton_size,
+                           svn_fs_fs__job_func_t job_func,
+                           apr_pool_t *result_pool)
+{
+  svn_fs_fs__job_ring_t *ring = apr_pcalloc(result_pool, sizeof(*ring));
+  int i;
+
+  ring->fs = fs;
+  ring->capacity = MAX(1, capacity);
+  ring->baton_size = baton_size;
+  ring->job_func = job_func;
+  ring->jobs = apr_pcalloc(result_pool,
+                           ring->capacity * sizeof(*ring->jobs));
+  for (i = 0; i < ring->capacity; ++i)
+    {
+      ring->jobs[i].ring = ring;
+      ring->jobs[i].baton = apr_palloc(result_pool, baton_size);
+    }
+
+  /* The workers allocate and release memory while the calling thread
+   * keeps starting new jobs.  Therefore, all job memory must come from
+   * a thread-safe allocator. */
+#if APR_HAS_THREADS
+  if (ring->capacity > 1)
+    ring->job_pool
+      = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  else
+#endif
+    ring->job_pool = svn_pool_create(NULL);
+
+  apr_pool_cleanup_register(result_pool, ring, job_ring_cleanup,
+                            apr_pool_cleanup_null);
+
+  return ring;
+}
+
+svn_boolean_t
+svn_fs_fs__job_ring_is_empty(const svn_fs_fs__job_ring_t *ring)
+{
+  return ring->count == 0;
+}
+
+svn_boolean_t
+svn_fs_fs__job_ring_is_full(const svn_fs_fs__job_ring_t *ring)
+{
+  return ring->count == ring->capacity;
+}
+
+void
+svn_fs_fs__job_ring_push(svn_fs_fs__job_ring_t *ring,
+                         const void *baton)
+{
+  job_t *job;
+
+  SVN_ERR_ASSERT_NO_RETURN(ring->count < ring->capacity);
+
+  job = &ring->jobs[(ring->head + ring->count) % ring->capacity];
+  ++ring->count;
+
+  memcpy(job->baton, baton, ring->baton_size);
+  job->pool = svn_pool_create(ring->job_pool);
+  job->done = FALSE;
+  job->err = SVN_NO_ERROR;
+
+#if APR_HAS_THREADS
+  job->thread = NULL;
+  if (ring->capacity > 1)
+    {
+      apr_status_t status = apr_thread_create(&job->thread, NULL,
+                                              job_worker, job, job->pool);
+      if (status)
+        job->thread = NULL;
+    }
+#endif
+}
+
+svn_error_t *
+svn_fs_fs__job_ring_wait(void **baton,
+                         svn_fs_fs__job_ring_t *ring)
+{
+  job_t *job;
+  svn_error_t *err;
+
+  SVN_ERR_ASSERT(ring->count > 0);
+
+  job = &ring->jobs[ring->head];
+  join_job(job);
+  if (!job->done)
+    {
+      job->err = ring->job_func(job->baton, ring->fs, job->pool);
+      job->done = TRUE;
+    }
+
+  /* Hand the result over to the caller. */
+  if (baton)
+    *baton = job->baton;
+  err = job->err;
+  job->err = SVN_NO_ERROR;
+
+  return svn_error_trace(err);
+}
+
+void
+svn_fs_fs__job_ring_pop(svn_fs_fs__job_ring_t *ring)
+{
+  job_t *job = &ring->jobs[ring->head];
+
+  SVN_ERR_ASSERT_NO_RETURN(ring->count > 0);
+
+  join_job(job);
+  svn_error_clear(job->err);
+  job->err = SVN_NO_ERROR;
+  svn_pool_destroy(job->pool);
+  job->pool = NULL;
+
+  ring->head = (ring->head + 1) % ring->capacity;
+  --ring->count;
+}
+
+void
+svn_fs_fs__job_ring_clear(svn_fs_fs__job_ring_t *ring)
+{
+  while (ring->count > 0)
+    svn_fs_fs__job_ring_pop(ring);
+}
+
+#if APR_HAS_THREADS
+
+svn_error_t *
+svn_fs_fs__create_background_threads(apr_thread_pool_t **threads,
+                                     apr_pool_t **pool,
+                                     const char *error_message)
+{
+  apr_pool_t *threads_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  apr_status_t status = apr_thread_pool_create(threads, 0, 1, threads_pool);
+
+  if (status)
+    {
+      svn_pool_destroy(threads_pool);
+      return svn_error_wrap_apr(status, "%s", error_message);
+    }
+
+  if (pool)
+    *pool = threads_pool;
+
+  return SVN_NO_ERROR;
+}
+
+/* A job queued by svn_fs_fs__start_background_job().  Everything,
+ * including the job itself, lives in POOL. */
+typedef struct background_job_t
+{
+  /* Parameters passed to svn_fs_fs__start_background_job(). */
+  svn_fs_fs__background_func_t job_func;
+  void *baton;
+
+  /* Private instance of the filesystem. */
+  svn_fs_t *fs;
+
+  /* Root pool of the job. */
+  apr_pool_t *pool;
+} background_job_t;
+
+/* Implements svn_fs_t.warning.  Nobody listens to background jobs. */
+static void
+ignore_background_warning(void *baton,
+                          svn_error_t *err)
+{
+}
+
+/* Thread pool task.  Run the background_job_t in DATA and release it. */
+static void * APR_THREAD_FUNC
+background_worker(apr_thread_t *thread,
+                  void *data)
+{
+  background_job_t *job = data;
+
+  job->job_func(job->baton, job->fs, job->pool);
+  svn_pool_destroy(job->pool);
+
+  return NULL;
+}
+
+svn_error_t *
+svn_fs_fs__start_background_job(apr_thread_pool_t *threads,
+                                svn_fs_t *fs,
+                                svn_fs_fs__background_func_t job_func,
+                                const void *baton,
+                                apr_size_t baton_size,
+                                apr_byte_t priority,
+                                const char *error_message,
+                                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  background_job_t *job = apr_pcalloc(pool, sizeof(*job));
+  svn_error_t *err;
+
+  job->job_func = job_func;
+  job->baton = apr_pmemdup(pool, baton, baton_size);
+  job->pool = pool;
+
+  err = svn_fs_fs__open_private(&job->fs, fs, pool, scratch_pool);
+  if (!err)
+    {
+      apr_status_t status;
+
+      job->fs->warning = ignore_background_warning;
+      job->fs->warning_baton = NULL;
+
+      status = apr_thread_pool_push(threads, background_worker, job,
+                                    priority, NULL);
+      if (status)
+        err = svn_error_wrap_apr(status, "%s", error_message);
+    }
+
+  if (err)
+    svn_pool_destroy(pool);
+
+  return svn_error_trace(err);
+}
+
+#endif
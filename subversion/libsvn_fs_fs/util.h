@@ -25,6 +25,7 @@
 
 #include "svn_fs.h"
 #include "id.h"
+#include "batch_fsync.h"
 
 /* Functions for dealing with recoverable errors on mutable files
  *
@@ -347,6 +348,15 @@ svn_fs_fs__write_current(svn_fs_t *fs,
                          apr_uint64_t next_copy_id,
                          apr_pool_t *pool);
 
+/* Like svn_fs_fs__write_current but never flush the new file to disk.
+   The caller must do that before reporting the new revision as durable. */
+svn_error_t *
+svn_fs_fs__write_current_no_flush(svn_fs_t *fs,
+                                  svn_revnum_t rev,
+                                  apr_uint64_t next_node_id,
+                                  apr_uint64_t next_copy_id,
+                                  apr_pool_t *pool);
+
 /* Read the file at PATH and return its content in *CONTENT. *CONTENT will
  * not be modified unless the whole file was read successfully.
  *
@@ -396,8 +406,134 @@ svn_fs_fs__move_into_place(const char *old_filename,
                            svn_boolean_t flush_to_disk,
                            apr_pool_t *pool);
 
+/* Like svn_fs_fs__move_into_place but instead of flushing immediately,
+   schedule the fsync of NEW_FILENAME's directory entry in BATCH.  The
+   caller must already have flushed the contents of OLD_FILENAME.
+   Temporary allocations are from POOL. */
+svn_error_t *
+svn_fs_fs__batch_move_into_place(const char *old_filename,
+                                 const char *new_filename,
+                                 const char *perms_reference,
+                                 svn_fs_fs__batch_fsync_t *batch,
+                                 apr_pool_t *pool);
+
 /* Return TRUE, iff FS uses logical addressing. */
 svn_boolean_t
 svn_fs_fs__use_log_addressing(svn_fs_t *fs);
 
+/* Ring buffer of jobs that get started in order, may run concurrently in
+ * worker threads and are being collected in the order they were started.
+ * This allows e.g. multiple pack files to be processed at the same time
+ * while notifications and results are still being reported sequentially.
+ */
+typedef struct svn_fs_fs__job_ring_t svn_fs_fs__job_ring_t;
+
+/* Callback executing one job of a svn_fs_fs__job_ring_t.  BATON is the
+ * job's copy of the baton given to svn_fs_fs__job_ring_push().  FS is the
+ * ring's filesystem when running in the calling thread and a private
+ * instance of it when running in a worker thread.  It is NULL if the ring
+ * has no filesystem.  Allocate everything in POOL, which is private to
+ * this job.
+ */
+typedef svn_error_t *
+(*svn_fs_fs__job_func_t)(void *baton,
+                         svn_fs_t *fs,
+                         apr_pool_t *pool);
+
+/* Return a new job ring running JOB_FUNC with batons of BATON_SIZE bytes
+ * for up to CAPACITY jobs at a time.  If CAPACITY is 1 or APR has no
+ * thread support, jobs will run in the calling thread once they get
+ * collected by svn_fs_fs__job_ring_wait().  Workers never use FS
+ * directly but open a private instance of it.  FS may be NULL.
+ *
+ * Any jobs left in the ring get aborted when RESULT_POOL is cleaned up.
+ * Allocate the ring in RESULT_POOL.
+ */
+svn_fs_fs__job_ring_t *
+svn_fs_fs__job_ring_create(svn_fs_t *fs,
+                           int capacity,
+                           apr_size_t baton_size,
+                           svn_fs_fs__job_func_t job_func,
+                           apr_pool_t *result_pool);
+
+/* Return TRUE, iff RING contains no jobs. */
+svn_boolean_t
+svn_fs_fs__job_ring_is_empty(const svn_fs_fs__job_ring_t *ring);
+
+/* Return TRUE, iff no further job may be added to RING. */
+svn_boolean_t
+svn_fs_fs__job_ring_is_full(const svn_fs_fs__job_ring_t *ring);
+
+/* Add a job with a copy of BATON to the non-full RING and start it in a
+ * worker thread, if possible.  Otherwise, it will be run by
+ * svn_fs_fs__job_ring_wait().
+ */
+void
+svn_fs_fs__job_ring_push(svn_fs_fs__job_ring_t *ring,
+                         const void *baton);
+
+/* Wait for the oldest job in the non-empty RING to complete and return
+ * its result.  Run the job in the calling thread if it has not been
+ * started yet.  Unless BATON is NULL, set *BATON to the job's baton,
+ * which, like all memory allocated by the job, remains valid until
+ * svn_fs_fs__job_ring_pop().
+ */
+svn_error_t *
+svn_fs_fs__job_ring_wait(void **baton,
+                         svn_fs_fs__job_ring_t *ring);
+
+/* Remove the oldest job from the non-empty RING and release all memory
+ * used by it.  If its worker is still running, wait for it to finish
+ * and discard its result.
+ */
+void
+svn_fs_fs__job_ring_pop(svn_fs_fs__job_ring_t *ring);
+
+/* Remove all jobs from RING without running those that have not been
+ * started.  Wait for all workers to finish and discard their results.
+ */
+void
+svn_fs_fs__job_ring_clear(svn_fs_fs__job_ring_t *ring);
+
+#if APR_HAS_THREADS
+
+/* Callback executing a job started by svn_fs_fs__start_background_job().
+ * BATON is the job's copy of the baton given to that function and FS is
+ * a private instance of the filesystem.  Nobody waits for the job, so it
+ * has to handle all errors itself.  Allocate everything in POOL, which
+ * gets destroyed once the job returns.
+ */
+typedef void
+(*svn_fs_fs__background_func_t)(void *baton,
+                                svn_fs_t *fs,
+                                apr_pool_t *pool);
+
+/* Set *THREADS to a new thread pool with a single worker thread for
+ * background jobs.  It outlives all filesystem instances, so allocate it
+ * in a new thread-safe root pool and, unless POOL is NULL, return that
+ * in *POOL.  Report failures with ERROR_MESSAGE.
+ */
+svn_error_t *
+svn_fs_fs__create_background_threads(apr_thread_pool_t **threads,
+                                     apr_pool_t **pool,
+                                     const char *error_message);
+
+/* Queue a job on THREADS with PRIORITY, running JOB_FUNC with a copy of
+ * the BATON_SIZE bytes at BATON on a private instance of FS.  The job does
+ * not depend on the lifetime of FS or of any caller pool and nobody gets
+ * to see its warnings.  If the job can't be queued, report that with
+ * ERROR_MESSAGE.  Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+svn_fs_fs__start_background_job(apr_thread_pool_t *threads,
+                                svn_fs_t *fs,
+                                svn_fs_fs__background_func_t job_func,
+                                const void *baton,
+                                apr_size_t baton_size,
+                                apr_byte_t priority,
+                                const char *error_message,
+                                apr_pool_t *scratch_pool);
+
+#endif
+
 #endif
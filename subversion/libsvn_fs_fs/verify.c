@@ -20,6 +20,8 @@
  * ====================================================================
  */
 
+#include "svn_hash.h"
+#include "svn_pools.h"
 #include "svn_sorts.h"
 #include "svn_checksum.h"
 #include "svn_time.h"
@@ -41,6 +43,11 @@
 
 /** Verifying. **/
 
+/* Upper limit to the number of rev / pack files being verified
+ * concurrently.
+ */
+#define MAX_VERIFY_JOBS 256
+
 /* Baton type expected by verify_walker().  The purpose is to reuse open
  * rev / pack file handles between calls.  Its contents need to be cleaned
  * periodically to limit resource usage.
@@ -761,12 +768,98 @@ pack_size(svn_fs_t *fs, svn_revnum_t rev)
   return rev < ffd->min_unpacked_rev ? ffd->max_files_per_dir : 1;
 }
 
+/* Run all index and revprop checks on the rev / pack file in FS that
+ * starts at revision PACK_START and contains COUNT revisions.  Support
+ * cancellation with CANCEL_FUNC and CANCEL_BATON.  Use POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+verify_pack_file(svn_fs_t *fs,
+                 svn_revnum_t pack_start,
+                 svn_revnum_t count,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *pool)
+{
+  /* Check for external corruption to the indexes. */
+  SVN_ERR(verify_index_checksums(fs, pack_start, cancel_func,
+                                 cancel_baton, pool));
+
+  /* two-way index check */
+  SVN_ERR(compare_l2p_to_p2l_index(fs, pack_start, count,
+                                   cancel_func, cancel_baton, pool));
+  SVN_ERR(compare_p2l_to_l2p_index(fs, pack_start, count,
+                                   cancel_func, cancel_baton, pool));
+
+  /* verify in-index checksums and types vs. actual rev / pack files */
+  SVN_ERR(compare_p2l_to_rev(fs, pack_start, count,
+                             cancel_func, cancel_baton, pool));
+
+  /* ensure that revprops are available and accessible */
+  SVN_ERR(verify_revprops(fs, pack_start, pack_start + count,
+                          cancel_func, cancel_baton, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* A rev / pack file being verified by a job in
+ * verify_f7_metadata_consistency(). */
+typedef struct verify_job_t
+{
+  /* The rev / pack file to check. */
+  svn_revnum_t pack_start;
+  svn_revnum_t count;
+
+  /* Cancellation support. */
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+} verify_job_t;
+
+/* Implements svn_fs_fs__job_func_t, verifying the rev / pack file in FS
+ * given by the verify_job_t in BATON. */
+static svn_error_t *
+verify_job_func(void *baton,
+                svn_fs_t *fs,
+                apr_pool_t *pool)
+{
+  verify_job_t *job = baton;
+
+  return svn_error_trace(verify_pack_file(fs, job->pack_start, job->count,
+                                          job->cancel_func,
+                                          job->cancel_baton, pool));
+}
+
+/* Set *JOBS to the number of rev / pack files to verify concurrently in
+ * FS, as given by its configuration. */
+static svn_error_t *
+get_verify_jobs(int *jobs,
+                svn_fs_t *fs)
+{
+  const char *value
+    = fs->config ? svn_hash_gets(fs->config, SVN_FS_CONFIG_VERIFY_JOBS)
+                 : NULL;
+
+  *jobs = 1;
+  if (value)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, value, 0, MAX_VERIFY_JOBS, 10));
+      *jobs = MAX(1, (int)val);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Verify that on-disk representation has not been tempered with (in a way
  * that leaves the repository in a corrupted state).  This compares log-to-
  * phys with phys-to-log indexes, verifies the low-level checksums and
  * checks that all revprops are available.  The function signature is
  * similar to svn_fs_fs__verify.
  *
+ * If configured, up to SVN_FS_CONFIG_VERIFY_JOBS rev / pack files will be
+ * checked concurrently.  Notifications and errors are still reported in
+ * revision order.
+ *
  * The values of START and END have already been auto-selected and
  * verified.  You may call this for format7 or higher repos.
  */
@@ -782,12 +875,21 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
 {
   fs_fs_data_t *ffd = fs->fsap_data;
   svn_revnum_t revision, next_revision;
+  svn_error_t *err = SVN_NO_ERROR;
   apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t next_start = start;
+  svn_fs_fs__job_ring_t *ring;
+  int jobs;
 
-  for (revision = start; revision <= end; revision = next_revision)
-    {
-      svn_error_t *err = SVN_NO_ERROR;
+  SVN_ERR(get_verify_jobs(&jobs, fs));
+
+  /* The rev / pack files currently being verified.  The first one always
+   * starts at the current REVISION. */
+  ring = svn_fs_fs__job_ring_create(fs, jobs, sizeof(verify_job_t),
+                                    verify_job_func, pool);
 
+  for (revision = start; revision <= end && !err; revision = next_revision)
+    {
       svn_revnum_t count = pack_size(fs, revision);
       svn_revnum_t pack_start = svn_fs_fs__packed_base_rev(fs, revision);
       svn_revnum_t pack_end = pack_start + count;
@@ -797,27 +899,23 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
       if (notify_func && (pack_start % ffd->max_files_per_dir == 0))
         notify_func(pack_start, notify_baton, iterpool);
 
-      /* Check for external corruption to the indexes. */
-      err = verify_index_checksums(fs, pack_start, cancel_func,
-                                   cancel_baton, iterpool);
+      /* Keep up to JOBS rev / pack files in flight. */
+      if (svn_fs_fs__job_ring_is_empty(ring))
+        next_start = pack_start;
 
-      /* two-way index check */
-      if (!err)
-        err = compare_l2p_to_p2l_index(fs, pack_start, pack_end - pack_start,
-                                       cancel_func, cancel_baton, iterpool);
-      if (!err)
-        err = compare_p2l_to_l2p_index(fs, pack_start, pack_end - pack_start,
-                                       cancel_func, cancel_baton, iterpool);
-
-      /* verify in-index checksums and types vs. actual rev / pack files */
-      if (!err)
-        err = compare_p2l_to_rev(fs, pack_start, pack_end - pack_start,
-                                 cancel_func, cancel_baton, iterpool);
+      for (; !svn_fs_fs__job_ring_is_full(ring) && next_start <= end;
+           next_start += pack_size(fs, next_start))
+        {
+          verify_job_t new_job;
+          new_job.pack_start = next_start;
+          new_job.count = pack_size(fs, next_start);
+          new_job.cancel_func = cancel_func;
+          new_job.cancel_baton = cancel_baton;
+          svn_fs_fs__job_ring_push(ring, &new_job);
+        }
 
-      /* ensure that revprops are available and accessible */
-      if (!err)
-        err = verify_revprops(fs, pack_start, pack_end,
-                              cancel_func, cancel_baton, iterpool);
+      err = svn_fs_fs__job_ring_wait(NULL, ring);
+      svn_fs_fs__job_ring_pop(ring);
 
       /* concurrent packing is one of the reasons why verification may fail.
          Make sure, we operate on up-to-date information. */
@@ -829,13 +927,20 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
 
           /* Be careful to not leak ERR. */
           if (err2)
-            return svn_error_trace(svn_error_compose_create(err, err2));
+            {
+              err = svn_error_compose_create(err, err2);
+              break;
+            }
         }
 
       /* retry the whole shard if it got packed in the meantime */
       if (err && count != pack_size(fs, revision))
         {
           svn_error_clear(err);
+          err = SVN_NO_ERROR;
+
+          /* The following jobs used the outdated pack layout as well. */
+          svn_fs_fs__job_ring_clear(ring);
 
           /* We could simply assign revision here but the code below is
              more intuitive to maintainers. */
@@ -843,14 +948,16 @@ verify_f7_metadata_consistency(svn_fs_t *fs,
         }
       else
         {
-          SVN_ERR(err);
           next_revision = pack_end;
         }
     }
 
+  /* Don't leave any workers behind. */
+  svn_fs_fs__job_ring_clear(ring);
+
   svn_pool_destroy(iterpool);
 
-  return SVN_NO_ERROR;
+  return svn_error_trace(err);
 }
 
 svn_error_t *
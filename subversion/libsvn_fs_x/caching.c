@@ -299,6 +299,8 @@ init_callbacks(svn_cache__t *cache,
  *
  * If DUMMY_CACHE is set, create a null cache.  Otherwise, creates a memcache
  * if MEMCACHE is not NULL or a membuffer cache if MEMBUFFER is not NULL.
+ * If both are given and MEMCACHE shall be used as a second level cache,
+ * the result will combine both.
  * Falls back to inprocess cache if no other cache type has been selected
  * and PAGES is not 0.  Create a null cache otherwise.
  *
@@ -339,6 +341,28 @@ create_cache(svn_cache__t **cache_p,
     {
       SVN_ERR(svn_cache__create_null(cache_p, prefix, result_pool));
     }
+  else if (memcache && membuffer
+           && svn_cache__memcache_is_second_level(memcache))
+    {
+      svn_cache__t *l1;
+      svn_cache__t *l2;
+
+      /* Use memcached only for what we don't have locally.  Errors in
+       * the shared second level will merely be reported as warnings. */
+      SVN_ERR(svn_cache__create_membuffer_cache(
+                &l1, membuffer, serializer, deserializer,
+                klen, prefix, priority, FALSE, has_namespace,
+                result_pool, scratch_pool));
+      SVN_ERR(svn_cache__create_memcache(&l2, memcache,
+                                         serializer, deserializer, klen,
+                                         prefix, result_pool));
+      SVN_ERR(init_callbacks(l2, fs,
+                             no_handler
+                               ? NULL
+                               : warn_and_continue_on_cache_errors,
+                             result_pool));
+      SVN_ERR(svn_cache__create_tiered(cache_p, l1, l2, result_pool));
+    }
   else if (memcache)
     {
       SVN_ERR(svn_cache__create_memcache(cache_p, memcache,
@@ -432,6 +456,7 @@ svn_fs_x__initialize_caches(svn_fs_t *fs,
 
   /* 1st level DAG node cache */
   ffd->dag_node_cache = svn_fs_x__create_dag_cache(fs->pool);
+  ffd->cache_prefix = apr_pstrdup(fs->pool, prefix);
 
   /* Very rough estimate: 1K per directory. */
   SVN_ERR(create_cache(&(ffd->dir_cache),
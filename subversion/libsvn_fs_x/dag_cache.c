@@ -467,6 +467,160 @@ svn_fs_x__invalidate_dag_cache(svn_fs_root_t *root,
 }
 
 
+/* Process-wide 1st level cache.
+ *
+ * Every svn_fs_t gets its own 1st level cache, i.e. servers that open a
+ * new svn_fs_t for each request start with an empty one and must rebuild
+ * the nodes of popular paths from the noderev cache again and again.
+ * Therefore, all instances of the same filesystem share another cache of
+ * native DAG nodes for committed revisions.  Access to it is serialized.
+ * Nodes get copied in and out of it, so no instance depends on the
+ * lifetime of another.
+ */
+
+/* Implements svn_atomic__init_once_func_t, creating the containers for
+ * the shared DAG node caches in the svn_fs_x__shared_data_t in BATON. */
+static svn_error_t *
+create_shared_dag_caches(void *baton,
+                         apr_pool_t *pool)
+{
+  svn_fs_x__shared_data_t *shared = baton;
+
+  shared->dag_node_caches_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+  shared->dag_node_caches = apr_hash_make(shared->dag_node_caches_pool);
+
+  return svn_error_trace(svn_mutex__init(&shared->dag_node_caches_lock,
+                                         TRUE, shared->common_pool));
+}
+
+/* Body of get_shared_dag_cache, called with the lock held. */
+static svn_error_t *
+get_shared_dag_cache_body(svn_fs_x__data_t *ffd)
+{
+  svn_fs_x__shared_data_t *shared = ffd->shared;
+  svn_fs_x__dag_cache_t *cache = svn_hash_gets(shared->dag_node_caches,
+                                               ffd->cache_prefix);
+
+  if (cache == NULL)
+    {
+      cache = svn_fs_x__create_dag_cache(shared->dag_node_caches_pool);
+      svn_hash_sets(shared->dag_node_caches,
+                    apr_pstrdup(shared->dag_node_caches_pool,
+                                ffd->cache_prefix),
+                    cache);
+    }
+
+  ffd->shared_dag_node_cache = cache;
+
+  return SVN_NO_ERROR;
+}
+
+/* Make sure that the shared DAG node cache of FS has been set, if FS
+ * has been fully initialized.  Otherwise, leave it NULL. */
+static svn_error_t *
+get_shared_dag_cache(svn_fs_t *fs)
+{
+  svn_fs_x__data_t *ffd = fs->fsap_data;
+
+  if (ffd->shared_dag_node_cache || !ffd->shared || !ffd->cache_prefix)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_atomic__init_once(&ffd->shared->dag_node_caches_initialized,
+                                create_shared_dag_caches, ffd->shared,
+                                NULL));
+  SVN_MUTEX__WITH_LOCK(ffd->shared->dag_node_caches_lock,
+                       get_shared_dag_cache_body(ffd));
+
+  return SVN_NO_ERROR;
+}
+
+/* Body of shared_cache_lookup, called with the lock held. */
+static svn_error_t *
+shared_cache_lookup_body(dag_node_t **node_p,
+                         svn_fs_x__dag_cache_t *cache,
+                         svn_fs_x__change_set_t change_set,
+                         const svn_string_t *path,
+                         apr_pool_t *result_pool)
+{
+  dag_node_t *node;
+
+  auto_clear_dag_cache(cache);
+  node = cache_lookup(cache, change_set, path)->node;
+  *node_p = node ? svn_fs_x__dag_dup(node, result_pool) : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* In *NODE_P, return a copy of the DAG node for PATH in the committed
+   CHANGE_SET of FS from the shared DAG node cache, or NULL if it isn't
+   cached.  *NODE_P is allocated in RESULT_POOL. */
+static svn_error_t *
+shared_cache_lookup(dag_node_t **node_p,
+                    svn_fs_t *fs,
+                    svn_fs_x__change_set_t change_set,
+                    const svn_string_t *path,
+                    apr_pool_t *result_pool)
+{
+  svn_fs_x__data_t *ffd = fs->fsap_data;
+
+  *node_p = NULL;
+  SVN_ERR(get_shared_dag_cache(fs));
+  if (ffd->shared_dag_node_cache == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(ffd->shared->dag_node_caches_lock,
+                       shared_cache_lookup_body(node_p,
+                                                ffd->shared_dag_node_cache,
+                                                change_set, path,
+                                                result_pool));
+
+  /* The node may have come from another FS object. */
+  if (*node_p)
+    svn_fs_x__dag_set_fs(*node_p, fs);
+
+  return SVN_NO_ERROR;
+}
+
+/* Body of shared_cache_insert, called with the lock held. */
+static svn_error_t *
+shared_cache_insert_body(svn_fs_x__dag_cache_t *cache,
+                         svn_fs_x__change_set_t change_set,
+                         const svn_string_t *path,
+                         dag_node_t *node)
+{
+  cache_entry_t *bucket;
+
+  auto_clear_dag_cache(cache);
+  bucket = cache_lookup(cache, change_set, path);
+  if (bucket->node == NULL)
+    bucket->node = svn_fs_x__dag_dup(node, cache->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Store a copy of NODE for PATH in the committed CHANGE_SET of FS in the
+   shared DAG node cache. */
+static svn_error_t *
+shared_cache_insert(svn_fs_t *fs,
+                    svn_fs_x__change_set_t change_set,
+                    const svn_string_t *path,
+                    dag_node_t *node)
+{
+  svn_fs_x__data_t *ffd = fs->fsap_data;
+
+  SVN_ERR(get_shared_dag_cache(fs));
+  if (ffd->shared_dag_node_cache == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(ffd->shared->dag_node_caches_lock,
+                       shared_cache_insert_body(ffd->shared_dag_node_cache,
+                                                change_set, path, node));
+
+  return SVN_NO_ERROR;
+}
+
+
 /* Traversing directory paths.  */
 
 /* Try a short-cut for the open_path() function using the last node accessed.
@@ -568,6 +722,19 @@ dag_step(dag_node_t **child_p,
       return SVN_NO_ERROR;
     }
 
+  /* Other FS objects may have used that node recently.  The insertion
+     has already been counted, so allocating it in the cache is fine. */
+  if (svn_fs_x__is_revision(change_set))
+    {
+      SVN_ERR(shared_cache_lookup(&bucket->node, fs, change_set, path,
+                                  ffd->dag_node_cache->pool));
+      if (bucket->node)
+        {
+          *child_p = bucket->node;
+          return SVN_NO_ERROR;
+        }
+    }
+
   /* Get the ID of the node we are looking for.  The function call checks
      for various error conditions such like PARENT not being a directory. */
   SVN_ERR(svn_fs_x__dir_entry_id(&node_id, parent, name, scratch_pool));
@@ -600,6 +767,10 @@ dag_step(dag_node_t **child_p,
                                  ffd->dag_node_cache->pool,
                                  scratch_pool));
 
+  /* Share it with the other FS objects. */
+  if (svn_fs_x__is_revision(change_set))
+    SVN_ERR(shared_cache_insert(fs, change_set, path, bucket->node));
+
   /* Return a reference to the cached object. */
   *child_p = bucket->node;
   return SVN_NO_ERROR;
@@ -629,9 +800,23 @@ get_root_node(dag_node_t **node_p,
 
   /* If it is not already cached, construct the DAG node object for NODE_ID.
      Let it live in the cache.  Sadly, we often can't reuse txn DAG nodes. */
-  if (bucket->node == NULL)
-    SVN_ERR(svn_fs_x__dag_root(&bucket->node, fs, change_set,
-                               ffd->dag_node_cache->pool, scratch_pool));
+  if (bucket->node == NULL && svn_fs_x__is_revision(change_set))
+    {
+      SVN_ERR(shared_cache_lookup(&bucket->node, fs, change_set, &path,
+                                  ffd->dag_node_cache->pool));
+      if (bucket->node == NULL)
+        {
+          SVN_ERR(svn_fs_x__dag_root(&bucket->node, fs, change_set,
+                                     ffd->dag_node_cache->pool,
+                                     scratch_pool));
+          SVN_ERR(shared_cache_insert(fs, change_set, &path, bucket->node));
+        }
+    }
+  else if (bucket->node == NULL)
+    {
+      SVN_ERR(svn_fs_x__dag_root(&bucket->node, fs, change_set,
+                                 ffd->dag_node_cache->pool, scratch_pool));
+    }
 
   /* Return a reference to the cached object. */
   *node_p = bucket->node;
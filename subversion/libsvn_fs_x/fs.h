@@ -104,6 +104,7 @@ extern "C" {
 #define CONFIG_OPTION_MAX_DELTIFICATION_WALK     "max-deltification-walk"
 #define CONFIG_OPTION_MAX_LINEAR_DELTIFICATION   "max-linear-deltification"
 #define CONFIG_OPTION_COMPRESSION_LEVEL  "compression-level"
+#define CONFIG_OPTION_REPS_CONTAINER_SIZE "reps-container-size"
 #define CONFIG_SECTION_PACKED_REVPROPS   "packed-revprops"
 #define CONFIG_OPTION_REVPROP_PACK_SIZE  "revprop-pack-size"
 #define CONFIG_OPTION_COMPRESS_PACKED_REVPROPS  "compress-packed-revprops"
@@ -202,6 +203,17 @@ typedef struct svn_fs_x__shared_data_t
      repository pack operation lock. */
   svn_mutex__t *fs_pack_lock;
 
+  /* Process-wide 1st level DAG node caches for committed revisions, shared
+     by all svn_fs_t instances of this filesystem.  Maps the instances'
+     cache prefix to a svn_fs_x__dag_cache_t *, allocated in
+     DAG_NODE_CACHES_POOL.  The caches and the pool are guarded by
+     DAG_NODE_CACHES_LOCK.  All are created upon first use, guarded by
+     DAG_NODE_CACHES_INITIALIZED. */
+  apr_hash_t *dag_node_caches;
+  apr_pool_t *dag_node_caches_pool;
+  svn_mutex__t *dag_node_caches_lock;
+  svn_atomic_t dag_node_caches_initialized;
+
   /* The common pool, under which this object is allocated, subpools
      of which are used to allocate the transaction objects. */
   apr_pool_t *common_pool;
@@ -290,6 +302,15 @@ typedef struct svn_fs_x__data_t
   /* Caches native dag_node_t* instances */
   svn_fs_x__dag_cache_t *dag_node_cache;
 
+  /* The entry for this instance in SHARED->DAG_NODE_CACHES.  Consulted
+     when DAG_NODE_CACHE misses a node of a committed revision.  NULL
+     until first use. */
+  svn_fs_x__dag_cache_t *shared_dag_node_cache;
+
+  /* Key prefix of all caches of this instance.  Instances with different
+     prefixes, e.g. naively copied repositories, must not share nodes. */
+  const char *cache_prefix;
+
   /* A cache of the contents of immutable directories; maps from
      unparsed FS ID to a apr_hash_t * mapping (const char *) dirent
      names to (svn_fs_x__dirent_t *). */
@@ -394,6 +415,11 @@ typedef struct svn_fs_x__data_t
   /* Compression level to use with txdelta storage format in new revs. */
   int delta_compression_level;
 
+  /* Size limit in bytes for the star-delta containers that pack shall
+   * combine file representations from multiple paths into.  0 means
+   * one container per path, sized to fit into a single block. */
+  apr_int64_t reps_container_size;
+
   /* Pack after every commit. */
   svn_boolean_t pack_after_commit;
 
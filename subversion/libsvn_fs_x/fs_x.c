@@ -288,6 +288,14 @@ read_config(svn_fs_x__data_t *ffd,
   ffd->delta_compression_level
     = (int)MIN(MAX(SVN_DELTA_COMPRESSION_LEVEL_NONE, compression_level),
                 SVN_DELTA_COMPRESSION_LEVEL_MAX);
+  SVN_ERR(svn_config_get_int64(config, &ffd->reps_container_size,
+                               CONFIG_SECTION_DELTIFICATION,
+                               CONFIG_OPTION_REPS_CONTAINER_SIZE,
+                               0));
+
+  /* Given in kBytes.  Containers can't hold more than 16MB of text. */
+  ffd->reps_container_size = MIN(MAX(ffd->reps_container_size, 0), 0x4000)
+                           * 0x400;
 
   /* Initialize revprop packing settings in ffd. */
   SVN_ERR(svn_config_get_bool(config, &ffd->compress_packed_revprops,
@@ -374,6 +382,17 @@ write_config(svn_fs_t *fs,
 "### no authentication for reads or writes, so you must ensure that your"    NL
 "### memcached servers are only accessible by trusted users."                NL
 ""                                                                           NL
+"[" SVN_CACHE_CONFIG_CATEGORY_MEMCACHED_OPTIONS "]"                          NL
+"### These options tune how the memcached servers above get used."           NL
+"### Connections to each server are pooled.  This limits their number:"      NL
+"# " SVN_CACHE_CONFIG_OPTION_MEMCACHED_CONNECTIONS " = 10"                   NL
+"### Writes may be handed over to a background thread such that they"        NL
+"### don't delay the request being processed.  Uncomment this to do so:"     NL
+"# " SVN_CACHE_CONFIG_OPTION_MEMCACHED_ASYNC_WRITES " = true"                NL
+"### By default, memcached replaces the in-process caches.  To use it as"    NL
+"### a second level cache below them instead, uncomment this line:"          NL
+"# " SVN_CACHE_CONFIG_OPTION_MEMCACHED_SECOND_LEVEL " = true"                NL
+""                                                                           NL
 "[" CONFIG_SECTION_CACHES "]"                                                NL
 "### When a cache-related error occurs, normally Subversion ignores it"      NL
 "### and continues, logging an error if the server is appropriately"         NL
@@ -457,6 +476,22 @@ write_config(svn_fs_t *fs,
 "### and 0 disabling it altogether."                                         NL
 "### The default value is 5."                                                NL
 "# " CONFIG_OPTION_COMPRESSION_LEVEL " = 5"                                  NL
+"###"                                                                        NL
+"### When packing a shard, the representations of small files get stored in" NL
+"### star-delta containers that eliminate redundancies across all of their"  NL
+"### contents.  By default, each path gets its own containers, each of"      NL
+"### which fits into a single block (see " CONFIG_OPTION_BLOCK_SIZE           NL
+"### below)."                                                                NL
+"### This setting allows for larger containers (in kBytes) that combine"     NL
+"### the representations of many paths in the shard.  That will reduce the"  NL
+"### repository size, in particular with many similar files on different"    NL
+"### branches.  However, a container must be read and cached as a whole"     NL
+"### before any of its contents can be used.  Values larger than the cache"  NL
+"### can hold will therefore slow down reading the data considerably."       NL
+"### Changes only affect shards packed in the future.  Values larger than"   NL
+"### 16384 kBytes will be reduced to that."                                  NL
+"### The default is 0, i.e. one container per path."                         NL
+"# " CONFIG_OPTION_REPS_CONTAINER_SIZE " = 0"                                NL
 ""                                                                           NL
 "[" CONFIG_SECTION_PACKED_REVPROPS "]"                                       NL
 "### This parameter controls the size (in kBytes) of packed revprop files."  NL
@@ -251,9 +251,12 @@ static svn_error_t *
 packed_stream_read(svn_fs_x__packed_number_stream_t *stream)
 {
   unsigned char buffer[MAX_NUMBER_PREFETCH];
+  const unsigned char *end;
+  apr_uint64_t values[MAX_NUMBER_PREFETCH];
+  apr_size_t ends[MAX_NUMBER_PREFETCH];
   apr_size_t bytes_read = 0;
+  apr_size_t count;
   apr_size_t i;
-  value_position_pair_t *target;
   apr_off_t block_start = 0;
   apr_off_t block_left = 0;
   apr_status_t err;
@@ -298,46 +301,26 @@ packed_stream_read(svn_fs_x__packed_number_stream_t *stream)
     return stream_error_create(stream, err,
       _("Unexpected end of index file %s at offset 0x%"));
 
-  /* parse file buffer and expand into stream buffer */
-  target = stream->buffer;
-  for (i = 0; i < bytes_read;)
-    {
-      if (buffer[i] < 0x80)
-        {
-          /* numbers < 128 are relatively frequent and particularly easy
-           * to decode.  Give them special treatment. */
-          target->value = buffer[i];
-          ++i;
-          target->total_len = i;
-          ++target;
-        }
-      else
-        {
-          apr_uint64_t value = 0;
-          apr_uint64_t shift = 0;
-          while (buffer[i] >= 0x80)
-            {
-              value += ((apr_uint64_t)buffer[i] & 0x7f) << shift;
-              shift += 7;
-              ++i;
-            }
+  /* parse file buffer and expand into stream buffer.  Runs of numbers
+   * < 128 are relatively frequent and get decoded en bloc. */
+  count = MAX_NUMBER_PREFETCH;
+  end = svn__decode_uints(values, ends, &count, buffer, buffer + bytes_read);
+
+  /* let's catch corrupted data early.  It would surely cause
+   * havoc further down the line. */
+  if SVN__PREDICT_FALSE(end != buffer + bytes_read)
+    return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
+                             _("Corrupt index: number too large"));
 
-          target->value = value + ((apr_uint64_t)buffer[i] << shift);
-          ++i;
-          target->total_len = i;
-          ++target;
-
-          /* let's catch corrupted data early.  It would surely cause
-           * havoc further down the line. */
-          if SVN__PREDICT_FALSE(shift > 8 * sizeof(value))
-            return svn_error_createf(SVN_ERR_FS_INDEX_CORRUPTION, NULL,
-                                     _("Corrupt index: number too large"));
-       }
+  for (i = 0; i < count; ++i)
+    {
+      stream->buffer[i].value = values[i];
+      stream->buffer[i].total_len = ends[i];
     }
 
   /* update stream state */
-  stream->used = target - stream->buffer;
-  stream->next_offset = stream->start_offset + i;
+  stream->used = count;
+  stream->next_offset = stream->start_offset + bytes_read;
   stream->current = 0;
 
   return SVN_NO_ERROR;
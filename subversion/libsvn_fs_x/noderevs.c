@@ -578,15 +578,46 @@ svn_fs_x__write_noderevs_container(svn_stream_t *stream,
   return SVN_NO_ERROR;
 }
 
+/* Decode the first COUNT values of each of the first COLUMN_COUNT
+ * sub-streams of STREAM into a single array allocated in RESULT_POOL and
+ * return it.  Column I starts at index I * COUNT.  Missing values read
+ * as 0.
+ *
+ * Each sub-stream holds one field of a struct.  Decoding them column by
+ * column is much faster than fetching the structs' fields round-robin
+ * through STREAM.
+ */
+static apr_uint64_t *
+read_columns(svn_packed__int_stream_t *stream,
+             int column_count,
+             apr_size_t count,
+             apr_pool_t *result_pool)
+{
+  apr_uint64_t *columns
+    = apr_pcalloc(result_pool, column_count * count * sizeof(*columns));
+  svn_packed__int_stream_t *column = svn_packed__first_int_substream(stream);
+  int i;
+
+  for (i = 0; i < column_count && column; ++i)
+    {
+      svn_packed__get_uints(column, columns + i * count, count);
+      column = svn_packed__next_int_stream(column);
+    }
+
+  return columns;
+}
+
 /* Allocate a svn_fs_x__representation_t array in RESULT_POOL and return it
  * in REPS_P.  Deserialize the data in REP_STREAM and DIGEST_STREAM and store
- * the resulting representations into the *REPS_P.
+ * the resulting representations into the *REPS_P.  Use SCRATCH_POOL for
+ * temporary allocations.
  */
 static svn_error_t *
 read_reps(apr_array_header_t **reps_p,
           svn_packed__int_stream_t *rep_stream,
           svn_packed__byte_stream_t *digest_stream,
-          apr_pool_t *result_pool)
+          apr_pool_t *result_pool,
+          apr_pool_t *scratch_pool)
 {
   apr_size_t i;
   apr_size_t len;
@@ -597,17 +628,19 @@ read_reps(apr_array_header_t **reps_p,
   apr_array_header_t *reps
     = apr_array_make(result_pool, (int)count,
                      sizeof(svn_fs_x__representation_t));
+  const apr_uint64_t *columns
+    = read_columns(rep_stream, 5, count, scratch_pool);
 
   for (i = 0; i < count; ++i)
     {
       svn_fs_x__representation_t rep;
 
-      rep.has_sha1 = (svn_boolean_t)svn_packed__get_uint(rep_stream);
+      rep.has_sha1 = (svn_boolean_t)columns[i];
 
-      rep.id.change_set = (svn_revnum_t)svn_packed__get_uint(rep_stream);
-      rep.id.number = svn_packed__get_uint(rep_stream);
-      rep.size = svn_packed__get_uint(rep_stream);
-      rep.expanded_size = svn_packed__get_uint(rep_stream);
+      rep.id.change_set = (svn_revnum_t)columns[count + i];
+      rep.id.number = columns[2 * count + i];
+      rep.size = columns[3 * count + i];
+      rep.expanded_size = columns[4 * count + i];
 
       /* when extracting the checksums, beware of buffer under/overflows
          caused by disk data corruption. */
@@ -651,6 +684,7 @@ svn_fs_x__read_noderevs_container(svn_fs_x__noderevs_t **container,
 {
   apr_size_t i;
   apr_size_t count;
+  const apr_uint64_t *columns;
 
   svn_fs_x__noderevs_t *noderevs
     = apr_pcalloc(result_pool, sizeof(*noderevs));
@@ -679,47 +713,49 @@ svn_fs_x__read_noderevs_container(svn_fs_x__noderevs_t **container,
     = svn_packed__int_count(svn_packed__first_int_substream(ids_stream));
   noderevs->ids
     = apr_array_make(result_pool, (int)count, sizeof(svn_fs_x__id_t));
+  columns = read_columns(ids_stream, 2, count, scratch_pool);
   for (i = 0; i < count; ++i)
     {
       svn_fs_x__id_t id;
 
-      id.change_set = (svn_revnum_t)svn_packed__get_int(ids_stream);
-      id.number = svn_packed__get_uint(ids_stream);
+      id.change_set = (svn_revnum_t)columns[i];
+      id.number = columns[count + i];
 
       APR_ARRAY_PUSH(noderevs->ids, svn_fs_x__id_t) = id;
     }
 
   /* read rep arrays */
   SVN_ERR(read_reps(&noderevs->reps, reps_stream, digests_stream,
-                    result_pool));
+                    result_pool, scratch_pool));
 
   /* read noderevs array */
   count
     = svn_packed__int_count(svn_packed__first_int_substream(noderevs_stream));
   noderevs->noderevs
     = apr_array_make(result_pool, (int)count, sizeof(binary_noderev_t));
+  columns = read_columns(noderevs_stream, 14, count, scratch_pool);
   for (i = 0; i < count; ++i)
     {
       binary_noderev_t noderev;
 
-      noderev.flags = (apr_uint32_t)svn_packed__get_uint(noderevs_stream);
+      noderev.flags = (apr_uint32_t)columns[i];
 
-      noderev.id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.node_id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.copy_id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.predecessor_id = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.predecessor_count = (int)svn_packed__get_uint(noderevs_stream);
+      noderev.id = (int)columns[count + i];
+      noderev.node_id = (int)columns[2 * count + i];
+      noderev.copy_id = (int)columns[3 * count + i];
+      noderev.predecessor_id = (int)columns[4 * count + i];
+      noderev.predecessor_count = (int)columns[5 * count + i];
 
-      noderev.copyfrom_path = (apr_size_t)svn_packed__get_uint(noderevs_stream);
-      noderev.copyfrom_rev = (svn_revnum_t)svn_packed__get_int(noderevs_stream);
-      noderev.copyroot_path = (apr_size_t)svn_packed__get_uint(noderevs_stream);
-      noderev.copyroot_rev = (svn_revnum_t)svn_packed__get_int(noderevs_stream);
+      noderev.copyfrom_path = (apr_size_t)columns[6 * count + i];
+      noderev.copyfrom_rev = (svn_revnum_t)columns[7 * count + i];
+      noderev.copyroot_path = (apr_size_t)columns[8 * count + i];
+      noderev.copyroot_rev = (svn_revnum_t)columns[9 * count + i];
 
-      noderev.prop_rep = (int)svn_packed__get_uint(noderevs_stream);
-      noderev.data_rep = (int)svn_packed__get_uint(noderevs_stream);
+      noderev.prop_rep = (int)columns[10 * count + i];
+      noderev.data_rep = (int)columns[11 * count + i];
 
-      noderev.created_path = (apr_size_t)svn_packed__get_uint(noderevs_stream);
-      noderev.mergeinfo_count = svn_packed__get_uint(noderevs_stream);
+      noderev.created_path = (apr_size_t)columns[12 * count + i];
+      noderev.mergeinfo_count = columns[13 * count + i];
 
       APR_ARRAY_PUSH(noderevs->noderevs, binary_noderev_t) = noderev;
     }
@@ -1206,6 +1206,46 @@ write_reps_container(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
+/* Read the fulltext of the representation described by ENTRY from
+ * TEMP_FILE, which has been wrapped as FILE, and return it in *CONTENTS.
+ * CONTEXT provides the file system.  Allocate the result in RESULT_POOL.
+ */
+static svn_error_t *
+read_rep_from_temp(svn_string_t **contents,
+                   pack_context_t *context,
+                   svn_fs_x__revision_file_t *file,
+                   apr_file_t *temp_file,
+                   svn_fs_x__p2l_entry_t *entry,
+                   apr_pool_t *result_pool)
+{
+  svn_fs_x__representation_t representation = { 0 };
+  svn_stringbuf_t *text;
+  svn_stream_t *stream;
+
+  assert(entry->item_count == 1);
+  representation.id = entry->items[0];
+
+  SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
+                           result_pool));
+  SVN_ERR(svn_fs_x__get_representation_length(&representation.size,
+                                              &representation.expanded_size,
+                                              context->fs, file,
+                                              entry, result_pool));
+  SVN_ERR(svn_fs_x__get_contents(&stream, context->fs, &representation,
+                                 FALSE, result_pool));
+  text = svn_stringbuf_create_ensure(representation.expanded_size,
+                                     result_pool);
+  text->len = representation.expanded_size;
+
+  /* The representation is immutable.  Read it normally. */
+  SVN_ERR(svn_stream_read_full(stream, text->data, &text->len));
+  SVN_ERR(svn_stream_close(stream));
+
+  *contents = svn_stringbuf__morph_into_string(text);
+
+  return SVN_NO_ERROR;
+}
+
 /* Read the (property) representations identified by svn_fs_x__p2l_entry_t
  * elements in ENTRIES from TEMP_FILE, aggregate them and write them into
  * CONTEXT->PACK_FILE.  Use SCRATCH_POOL for temporary allocations.
@@ -1235,9 +1275,7 @@ write_reps_containers(pack_context_t *context,
   /* copy all items in strict order */
   for (i = entries->nelts-1; i >= 0; --i)
     {
-      svn_fs_x__representation_t representation = { 0 };
-      svn_stringbuf_t *contents;
-      svn_stream_t *stream;
+      svn_string_t *contents;
       apr_size_t list_index;
       svn_fs_x__p2l_entry_t *entry
         = APR_ARRAY_IDX(entries, i, svn_fs_x__p2l_entry_t *);
@@ -1267,29 +1305,11 @@ write_reps_containers(pack_context_t *context,
           block_left = get_block_left(context);
         }
 
-      assert(entry->item_count == 1);
-      representation.id = entry->items[0];
-
-      /* select the change list in the source file, parse it and add it to
-       * the container */
-      SVN_ERR(svn_io_file_seek(temp_file, APR_SET, &entry->offset,
-                               iterpool));
-      SVN_ERR(svn_fs_x__get_representation_length(&representation.size,
-                                             &representation.expanded_size,
-                                             context->fs, file,
-                                             entry, iterpool));
-      SVN_ERR(svn_fs_x__get_contents(&stream, context->fs, &representation,
-                                     FALSE, iterpool));
-      contents = svn_stringbuf_create_ensure(representation.expanded_size,
-                                             iterpool);
-      contents->len = representation.expanded_size;
-
-      /* The representation is immutable.  Read it normally. */
-      SVN_ERR(svn_stream_read_full(stream, contents->data, &contents->len));
-      SVN_ERR(svn_stream_close(stream));
-
-      SVN_ERR(svn_fs_x__reps_add(&list_index, container,
-                                 svn_stringbuf__morph_into_string(contents)));
+      /* select the representation in the source file, read it and add it
+       * to the container */
+      SVN_ERR(read_rep_from_temp(&contents, context, file, temp_file, entry,
+                                 iterpool));
+      SVN_ERR(svn_fs_x__reps_add(&list_index, container, contents));
       SVN_ERR_ASSERT(list_index == sub_items->nelts);
       block_left -= entry->size;
 
@@ -1308,6 +1328,105 @@ write_reps_containers(pack_context_t *context,
   return SVN_NO_ERROR;
 }
 
+/* A star-delta container that collects the representations of multiple
+ * paths until it reaches the configured reps-container-size.
+ */
+typedef struct shared_reps_container_t
+{
+  /* Container being filled.  Allocated in POOL. */
+  svn_fs_x__reps_builder_t *builder;
+
+  /* svn_fs_x__id_t of all representations added to BUILDER so far. */
+  apr_array_header_t *sub_items;
+
+  /* Will be cleared whenever BUILDER has been written to disk. */
+  apr_pool_t *pool;
+} shared_reps_container_t;
+
+/* Write CONTAINER to CONTEXT's pack file, unless it is empty, and reset
+ * it for the next batch of representations.  Use SCRATCH_POOL for
+ * temporary allocations.
+ */
+static svn_error_t *
+flush_shared_reps_container(pack_context_t *context,
+                            shared_reps_container_t *container,
+                            apr_pool_t *scratch_pool)
+{
+  if (container->sub_items->nelts == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(write_reps_container(context, container->builder,
+                               container->sub_items, context->reps,
+                               scratch_pool));
+
+  apr_array_clear(container->sub_items);
+  svn_pool_clear(container->pool);
+  container->builder = svn_fs_x__reps_builder_create(context->fs,
+                                                     container->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the representations identified by svn_fs_x__p2l_entry_t elements
+ * in ENTRIES from TEMP_FILE and add them to CONTAINER.  Whenever the
+ * latter would exceed the configured size limit, write it to CONTEXT's
+ * pack file and continue with an empty one.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+add_to_shared_reps_container(pack_context_t *context,
+                             shared_reps_container_t *container,
+                             apr_array_header_t *entries,
+                             apr_file_t *temp_file,
+                             apr_pool_t *scratch_pool)
+{
+  svn_fs_x__data_t *ffd = context->fs->fsap_data;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_fs_x__revision_file_t *file;
+  int i;
+
+  SVN_ERR(svn_fs_x__rev_file_wrap_temp(&file, context->fs, temp_file,
+                                       scratch_pool));
+
+  /* same order as write_reps_containers */
+  for (i = entries->nelts-1; i >= 0; --i)
+    {
+      svn_string_t *contents;
+      apr_size_t list_index;
+      svn_error_t *err;
+      svn_fs_x__p2l_entry_t *entry
+        = APR_ARRAY_IDX(entries, i, svn_fs_x__p2l_entry_t *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(read_rep_from_temp(&contents, context, file, temp_file, entry,
+                                 iterpool));
+
+      if (  svn_fs_x__reps_estimate_size(container->builder) + entry->size
+          > ffd->reps_container_size)
+        SVN_ERR(flush_shared_reps_container(context, container, iterpool));
+
+      /* The size estimate is only a heuristics.  Should we hit the hard
+       * limits of the container, start a new one. */
+      err = svn_fs_x__reps_add(&list_index, container->builder, contents);
+      if (   err && err->apr_err == SVN_ERR_FS_CONTAINER_SIZE
+          && container->sub_items->nelts)
+        {
+          svn_error_clear(err);
+          SVN_ERR(flush_shared_reps_container(context, container, iterpool));
+          err = svn_fs_x__reps_add(&list_index, container->builder,
+                                   contents);
+        }
+
+      SVN_ERR(err);
+      SVN_ERR_ASSERT(list_index == container->sub_items->nelts);
+      APR_ARRAY_PUSH(container->sub_items, svn_fs_x__id_t) = entry->items[0];
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Return TRUE if the estimated size of the NODES_IN_CONTAINER plus the
  * representations given as svn_fs_x__p2l_entry_t * in ENTRIES may exceed
  * the space left in the current block.
@@ -1412,6 +1531,17 @@ copy_reps_from_temp(pack_context_t *context,
   svn_fs_x__noderevs_t *nodes_container
     = svn_fs_x__noderevs_create(16, container_pool);
 
+  /* If configured, 1 reps container shared by many paths. */
+  shared_reps_container_t shared_reps = { 0 };
+  if (ffd->reps_container_size)
+    {
+      shared_reps.pool = svn_pool_create(scratch_pool);
+      shared_reps.builder = svn_fs_x__reps_builder_create(context->fs,
+                                                          shared_reps.pool);
+      shared_reps.sub_items = apr_array_make(scratch_pool, 64,
+                                             sizeof(svn_fs_x__id_t));
+    }
+
   /* copy items in path order. Create block-sized containers. */
   for (i = 0; i < path_order->nelts; ++i)
     {
@@ -1433,14 +1563,19 @@ copy_reps_from_temp(pack_context_t *context,
                                       nodes_in_container, container_pool,
                                       iterpool));
 
-      /* if all reps are short enough put them into one container.
-       * Otherwise, just store all containers here. */
-      if (reps_fit_into_containers(selected, 2 * ffd->block_size))
-        SVN_ERR(write_reps_containers(context, rep_parts, temp_file,
-                                      context->reps, iterpool));
-      else
+      /* if all reps are short enough put them into one container - or
+       * the shared container, if configured.  Otherwise, just store all
+       * reps here. */
+      if (!reps_fit_into_containers(selected, 2 * ffd->block_size))
         SVN_ERR(store_items(context, temp_file, rep_parts, rep_parts->nelts,
                             iterpool));
+      else if (ffd->reps_container_size)
+        SVN_ERR(add_to_shared_reps_container(context, &shared_reps,
+                                             rep_parts, temp_file,
+                                             iterpool));
+      else
+        SVN_ERR(write_reps_containers(context, rep_parts, temp_file,
+                                      context->reps, iterpool));
 
       /* processed all items */
       apr_array_clear(selected);
@@ -1456,6 +1591,13 @@ copy_reps_from_temp(pack_context_t *context,
                                   nodes_in_container, container_pool,
                                   iterpool));
 
+  /* flush the remaining shared reps to disk */
+  if (ffd->reps_container_size)
+    {
+      SVN_ERR(flush_shared_reps_container(context, &shared_reps, iterpool));
+      svn_pool_destroy(shared_reps.pool);
+    }
+
   /* copy all items in strict order */
   SVN_ERR(store_items(context, temp_file, reps, initial_reps_count,
                       scratch_pool));
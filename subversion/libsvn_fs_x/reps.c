@@ -489,7 +489,9 @@ svn_fs_x__reps_add(apr_size_t *rep_idx,
   const char *current = contents->data;
   const char *processed = current;
   const char *end = current + contents->len;
-  const char *last_to_test = end - MATCH_BLOCKSIZE - 1;
+  const char *last_to_test = contents->len > MATCH_BLOCKSIZE
+                           ? end - MATCH_BLOCKSIZE - 1
+                           : current;
 
   if (builder->text->len + contents->len > MAX_TEXT_BODY)
     return svn_error_create(SVN_ERR_FS_CONTAINER_SIZE, NULL,
@@ -643,12 +645,21 @@ svn_fs_x__reps_get(svn_fs_x__rep_extractor_t **extractor,
                    apr_size_t idx,
                    apr_pool_t *result_pool)
 {
-  apr_uint32_t first = container->first_instructions[idx];
-  apr_uint32_t last = container->first_instructions[idx + 1];
+  apr_uint32_t first, last;
+  svn_fs_x__rep_extractor_t *result;
+
+  if (idx >= container->rep_count)
+    return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                             _("Representation index %" APR_SIZE_T_FMT
+                               " exceeds star delta container size %"
+                               APR_SIZE_T_FMT),
+                             idx, container->rep_count);
+
+  first = container->first_instructions[idx];
+  last = container->first_instructions[idx + 1];
 
   /* create the extractor object */
-  svn_fs_x__rep_extractor_t *result = apr_pcalloc(result_pool,
-                                                  sizeof(*result));
+  result = apr_pcalloc(result_pool, sizeof(*result));
   result->fs = fs;
   result->result = svn_stringbuf_create_empty(result_pool);
   result->pool = result_pool;
@@ -669,7 +680,9 @@ svn_fs_x__extractor_drive(svn_stringbuf_t **contents,
                           apr_pool_t *scratch_pool)
 {
   /* we don't support base reps right now */
-  SVN_ERR_ASSERT(extractor->missing == NULL);
+  if (extractor->missing)
+    return svn_error_create(SVN_ERR_FS_CORRUPT, NULL,
+                   _("Star delta container references base representations"));
 
   if (size == 0)
     {
@@ -765,6 +778,46 @@ svn_fs_x__write_reps_container(svn_stream_t *stream,
   return SVN_NO_ERROR;
 }
 
+/* Return an error if CONTAINER would cause get_text() to access data
+ * outside the container or to recurse endlessly.
+ */
+static svn_error_t *
+verify_reps_container(const svn_fs_x__reps_t *container)
+{
+  apr_size_t i;
+
+  for (i = 0; i < container->rep_count; ++i)
+    if (   container->first_instructions[i]
+        >  container->first_instructions[i + 1])
+      return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                               _("Invalid instruction range for "
+                                 "representation %" APR_SIZE_T_FMT
+                                 " in star delta container"), i);
+
+  for (i = 0; i < container->instruction_count; ++i)
+    {
+      const instruction_t *instruction = container->instructions + i;
+      apr_uint64_t end;
+
+      /* Instruction sub-sequences must end before the referencing
+       * instruction.  That also rules out cycles. */
+      if (instruction->offset < 0)
+        end = (apr_uint64_t)-(apr_int64_t)instruction->offset
+            + instruction->count;
+      else
+        end = (apr_uint64_t)instruction->offset + instruction->count;
+
+      if (instruction->offset < 0
+            ? end > i
+            : end > container->text_len + container->base_text_len)
+        return svn_error_createf(SVN_ERR_FS_CORRUPT, NULL,
+                                 _("Invalid instruction %" APR_SIZE_T_FMT
+                                   " in star delta container"), i);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
                               svn_stream_t *stream,
@@ -847,6 +900,9 @@ svn_fs_x__read_reps_container(svn_fs_x__reps_t **container,
   /* other elements */
   reps->base_text_len = (apr_size_t)svn_packed__get_uint(misc_stream);
 
+  /* Extraction trusts the container contents blindly. */
+  SVN_ERR(verify_reps_container(reps));
+
   /* return result */
   *container = reps;
 
@@ -67,6 +67,7 @@
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_fs_util.h"
+#include "private/svn_sorts_private.h"
 #include "private/svn_fspath.h"
 #include "../libsvn_fs/fs-loader.h"
 
@@ -416,6 +417,139 @@ svn_fs_x__check_path(svn_node_kind_t *kind_p,
   return svn_error_trace(err);
 }
 
+/* A path passed to x_check_paths() and its position in the caller's list. */
+typedef struct check_paths_entry_t
+{
+  const char *path;
+  int idx;
+} check_paths_entry_t;
+
+/* Implements the comparison_func of svn_sort__array(), ordering
+   check_paths_entry_t elements such that all paths within a directory
+   come directly after the directory itself. */
+static int
+compare_check_paths_entries(const void *lhs,
+                            const void *rhs)
+{
+  const check_paths_entry_t *lhs_entry = lhs;
+  const check_paths_entry_t *rhs_entry = rhs;
+
+  return svn_path_compare_paths(lhs_entry->path, rhs_entry->path);
+}
+
+/* Implements root_vtable_t.check_paths().
+
+   Walk the PATHS in tree order and keep the chain of directories leading
+   to the previous path open, such that each directory gets opened only
+   once per call. */
+static svn_error_t *
+x_check_paths(apr_array_header_t **kinds,
+              svn_fs_root_t *root,
+              const apr_array_header_t *paths,
+              apr_pool_t *result_pool,
+              apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *entries
+    = apr_array_make(scratch_pool, paths->nelts, sizeof(check_paths_entry_t));
+
+  /* The directories from the root down to the deepest one opened so far
+     and their respective paths. */
+  apr_array_header_t *dirs
+    = apr_array_make(scratch_pool, 16, sizeof(dag_node_t *));
+  apr_array_header_t *dir_paths
+    = apr_array_make(scratch_pool, 16, sizeof(const char *));
+  dag_node_t *node;
+  int i;
+
+  *kinds = apr_array_make(result_pool, paths->nelts,
+                          sizeof(svn_node_kind_t));
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      check_paths_entry_t *entry = apr_array_push(entries);
+      entry->path
+        = svn_fs__canonicalize_abspath(APR_ARRAY_IDX(paths, i, const char *),
+                                       scratch_pool);
+      entry->idx = i;
+
+      APR_ARRAY_PUSH(*kinds, svn_node_kind_t) = svn_node_none;
+    }
+
+  svn_sort__array(entries, compare_check_paths_entries);
+
+  SVN_ERR(svn_fs_x__dag_root(&node, root->fs,
+                             svn_fs_x__root_change_set(root),
+                             scratch_pool, scratch_pool));
+  APR_ARRAY_PUSH(dirs, dag_node_t *) = node;
+  APR_ARRAY_PUSH(dir_paths, const char *) = "/";
+
+  for (i = 0; i < entries->nelts; ++i)
+    {
+      const check_paths_entry_t *entry
+        = &APR_ARRAY_IDX(entries, i, check_paths_entry_t);
+      const char *remainder;
+      svn_node_kind_t kind;
+
+      svn_pool_clear(iterpool);
+
+      /* Return to the deepest open directory that contains this path.
+         The root contains all of them. */
+      while (!(remainder = svn_fspath__skip_ancestor(
+                             APR_ARRAY_IDX(dir_paths, dir_paths->nelts - 1,
+                                           const char *),
+                             entry->path)))
+        {
+          apr_array_pop(dirs);
+          apr_array_pop(dir_paths);
+        }
+
+      /* Open the remaining path components one by one. */
+      node = APR_ARRAY_IDX(dirs, dirs->nelts - 1, dag_node_t *);
+      kind = svn_fs_x__dag_node_kind(node);
+      while (*remainder && kind == svn_node_dir)
+        {
+          const char *end = strchr(remainder, '/');
+          const char *name = end
+                           ? apr_pstrmemdup(iterpool, remainder,
+                                            end - remainder)
+                           : remainder;
+          dag_node_t *child;
+
+          SVN_ERR(svn_fs_x__dag_open(&child, node, name, iterpool, iterpool));
+          if (child == NULL)
+            {
+              kind = svn_node_none;
+              break;
+            }
+
+          node = child;
+          kind = svn_fs_x__dag_node_kind(node);
+          remainder = end ? end + 1 : "";
+
+          /* Keep sub-directories open for the following paths. */
+          if (kind == svn_node_dir)
+            {
+              apr_size_t len = end ? end - entry->path : strlen(entry->path);
+
+              APR_ARRAY_PUSH(dirs, dag_node_t *)
+                = svn_fs_x__dag_dup(node, scratch_pool);
+              APR_ARRAY_PUSH(dir_paths, const char *)
+                = apr_pstrmemdup(scratch_pool, entry->path, len);
+            }
+        }
+
+      /* Files don't have sub-paths. */
+      if (*remainder)
+        kind = svn_node_none;
+
+      APR_ARRAY_IDX(*kinds, entry->idx, svn_node_kind_t) = kind;
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* Set *VALUE_P to the value of the property named PROPNAME of PATH in
    ROOT.  If the node has no property by that name, set *VALUE_P to
    zero.  Allocate the result in POOL. */
@@ -3199,6 +3333,7 @@ static root_vtable_t root_vtable = {
   NULL,
   x_report_changes,
   svn_fs_x__check_path,
+  x_check_paths,
   x_node_history,
   x_node_id,
   x_node_relation,
@@ -3222,6 +3357,7 @@ static root_vtable_t root_vtable = {
   x_file_checksum,
   x_file_contents,
   x_try_process_file_contents,
+  NULL,
   x_make_file,
   x_apply_textdelta,
   x_apply_text,
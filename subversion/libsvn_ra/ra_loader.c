@@ -256,6 +256,30 @@ svn_ra_create_callbacks(svn_ra_callbacks2_t **callbacks,
   return SVN_NO_ERROR;
 }
 
+/* Return a new trace allocated in POOL if the servers section of CONFIG
+   names a trace file for connections to HOSTNAME, NULL otherwise. */
+static svn_trace__t *
+create_trace(apr_hash_t *config,
+             const char *hostname,
+             apr_pool_t *pool)
+{
+  svn_config_t *servers = config
+                        ? svn_hash_gets(config, SVN_CONFIG_CATEGORY_SERVERS)
+                        : NULL;
+  const char *server_group;
+  const char *path;
+
+  if (! servers)
+    return NULL;
+
+  server_group = svn_config_find_group(servers, hostname,
+                                       SVN_CONFIG_SECTION_GROUPS, pool);
+  path = svn_config_get_server_setting(servers, server_group,
+                                       SVN_CONFIG_OPTION_TRACE_FILE, NULL);
+
+  return (path && *path) ? svn_trace__create(path, NULL, pool) : NULL;
+}
+
 svn_error_t *svn_ra_open4(svn_ra_session_t **session_p,
                           const char **corrected_url_p,
                           const char *repos_URL,
@@ -273,6 +297,7 @@ svn_error_t *svn_ra_open4(svn_ra_session_t **session_p,
   apr_uri_t repos_URI;
   apr_status_t apr_err;
   svn_error_t *err;
+  apr_time_t start;
 #ifdef CHOOSABLE_DAV_MODULE
   const char *http_library = DEFAULT_HTTP_LIBRARY;
 #endif
@@ -379,12 +404,15 @@ svn_error_t *svn_ra_open4(svn_ra_session_t **session_p,
   session->cancel_baton = callback_baton;
   session->vtable = vtable;
   session->pool = sesspool;
+  session->trace = create_trace(config, repos_URI.hostname, sesspool);
 
   /* Ask the library to open the session. */
+  start = svn_trace__start(session->trace);
   err = vtable->open_session(session, corrected_url_p,
                              repos_URL,
                              callbacks, callback_baton, auth_baton,
                              config, sesspool, scratch_pool);
+  svn_trace__span(session->trace, "ra", "open", repos_URL, start);
 
   if (err)
     {
@@ -464,6 +492,7 @@ svn_ra__dup_session(svn_ra_session_t **new_session,
   session->cancel_baton = old_session->cancel_baton;
   session->vtable = old_session->vtable;
   session->pool = result_pool;
+  session->trace = svn_trace__dup(old_session->trace, result_pool);
 
   SVN_ERR(old_session->vtable->dup_session(session,
                                            old_session,
@@ -626,9 +655,15 @@ svn_error_t *svn_ra_get_file(svn_ra_session_t *session,
                              apr_hash_t **props,
                              apr_pool_t *pool)
 {
+  apr_time_t start = svn_trace__start(session->trace);
+  svn_error_t *err;
+
   SVN_ERR_ASSERT(svn_relpath_is_canonical(path));
-  return session->vtable->get_file(session, path, revision, stream,
-                                   fetched_rev, props, pool);
+  err = session->vtable->get_file(session, path, revision, stream,
+                                  fetched_rev, props, pool);
+  svn_trace__span(session->trace, "ra", "get-file", path, start);
+
+  return svn_error_trace(err);
 }
 
 svn_error_t *svn_ra_get_dir2(svn_ra_session_t *session,
@@ -640,9 +675,15 @@ svn_error_t *svn_ra_get_dir2(svn_ra_session_t *session,
                              apr_uint32_t dirent_fields,
                              apr_pool_t *pool)
 {
+  apr_time_t start = svn_trace__start(session->trace);
+  svn_error_t *err;
+
   SVN_ERR_ASSERT(svn_relpath_is_canonical(path));
-  return session->vtable->get_dir(session, dirents, fetched_rev, props,
-                                  path, revision, dirent_fields, pool);
+  err = session->vtable->get_dir(session, dirents, fetched_rev, props,
+                                 path, revision, dirent_fields, pool);
+  svn_trace__span(session->trace, "ra", "get-dir", path, start);
+
+  return svn_error_trace(err);
 }
 
 svn_error_t *
@@ -699,6 +740,119 @@ svn_error_t *svn_ra_get_mergeinfo(svn_ra_session_t *session,
                                         include_descendants, pool);
 }
 
+/* Baton for the reporter installed by wrap_reporter(). */
+typedef struct trace_report_baton_t
+{
+  const svn_ra_reporter3_t *reporter;
+  void *report_baton;
+  svn_trace__t *trace;
+  const char *phase;
+  const char *target;
+  apr_time_t start;
+} trace_report_baton_t;
+
+/* Implements svn_ra_reporter3_t.set_path. */
+static svn_error_t *
+trace_set_path(void *report_baton,
+               const char *path,
+               svn_revnum_t revision,
+               svn_depth_t depth,
+               svn_boolean_t start_empty,
+               const char *lock_token,
+               apr_pool_t *pool)
+{
+  trace_report_baton_t *b = report_baton;
+  return b->reporter->set_path(b->report_baton, path, revision, depth,
+                               start_empty, lock_token, pool);
+}
+
+/* Implements svn_ra_reporter3_t.delete_path. */
+static svn_error_t *
+trace_delete_path(void *report_baton,
+                  const char *path,
+                  apr_pool_t *pool)
+{
+  trace_report_baton_t *b = report_baton;
+  return b->reporter->delete_path(b->report_baton, path, pool);
+}
+
+/* Implements svn_ra_reporter3_t.link_path. */
+static svn_error_t *
+trace_link_path(void *report_baton,
+                const char *path,
+                const char *url,
+                svn_revnum_t revision,
+                svn_depth_t depth,
+                svn_boolean_t start_empty,
+                const char *lock_token,
+                apr_pool_t *pool)
+{
+  trace_report_baton_t *b = report_baton;
+  return b->reporter->link_path(b->report_baton, path, url, revision,
+                                depth, start_empty, lock_token, pool);
+}
+
+/* Implements svn_ra_reporter3_t.finish_report.  Records the span from
+   the start of the operation until the server's response has been fully
+   processed by the editor. */
+static svn_error_t *
+trace_finish_report(void *report_baton,
+                    apr_pool_t *pool)
+{
+  trace_report_baton_t *b = report_baton;
+  svn_error_t *err = b->reporter->finish_report(b->report_baton, pool);
+
+  svn_trace__span(b->trace, "ra", b->phase, b->target, b->start);
+  return svn_error_trace(err);
+}
+
+/* Implements svn_ra_reporter3_t.abort_report. */
+static svn_error_t *
+trace_abort_report(void *report_baton,
+                   apr_pool_t *pool)
+{
+  trace_report_baton_t *b = report_baton;
+  return b->reporter->abort_report(b->report_baton, pool);
+}
+
+static const svn_ra_reporter3_t trace_reporter =
+{
+  trace_set_path,
+  trace_delete_path,
+  trace_link_path,
+  trace_finish_report,
+  trace_abort_report
+};
+
+/* If SESSION is being traced, replace *REPORTER and *REPORT_BATON with a
+   reporter that records PHASE for TARGET in the session's trace, starting
+   at START, once the report has been finished.  Allocate it in POOL. */
+static void
+wrap_reporter(const svn_ra_reporter3_t **reporter,
+              void **report_baton,
+              svn_ra_session_t *session,
+              const char *phase,
+              const char *target,
+              apr_time_t start,
+              apr_pool_t *pool)
+{
+  trace_report_baton_t *b;
+
+  if (! session->trace)
+    return;
+
+  b = apr_palloc(pool, sizeof(*b));
+  b->reporter = *reporter;
+  b->report_baton = *report_baton;
+  b->trace = session->trace;
+  b->phase = phase;
+  b->target = apr_pstrdup(pool, target);
+  b->start = start;
+
+  *reporter = &trace_reporter;
+  *report_baton = b;
+}
+
 svn_error_t *
 svn_ra_do_update3(svn_ra_session_t *session,
                   const svn_ra_reporter3_t **reporter,
@@ -713,15 +867,21 @@ svn_ra_do_update3(svn_ra_session_t *session,
                   apr_pool_t *result_pool,
                   apr_pool_t *scratch_pool)
 {
+  apr_time_t start = svn_trace__start(session->trace);
+
   SVN_ERR_ASSERT(svn_path_is_empty(update_target)
                  || svn_path_is_single_path_component(update_target));
-  return session->vtable->do_update(session,
-                                    reporter, report_baton,
-                                    revision_to_update_to, update_target,
-                                    depth, send_copyfrom_args,
-                                    ignore_ancestry,
-                                    update_editor, update_baton,
-                                    result_pool, scratch_pool);
+  SVN_ERR(session->vtable->do_update(session,
+                                     reporter, report_baton,
+                                     revision_to_update_to, update_target,
+                                     depth, send_copyfrom_args,
+                                     ignore_ancestry,
+                                     update_editor, update_baton,
+                                     result_pool, scratch_pool));
+
+  wrap_reporter(reporter, report_baton, session, "update", update_target,
+                start, result_pool);
+  return SVN_NO_ERROR;
 }
 
 svn_error_t *
@@ -739,17 +899,23 @@ svn_ra_do_switch3(svn_ra_session_t *session,
                   apr_pool_t *result_pool,
                   apr_pool_t *scratch_pool)
 {
+  apr_time_t start = svn_trace__start(session->trace);
+
   SVN_ERR_ASSERT(svn_path_is_empty(switch_target)
                  || svn_path_is_single_path_component(switch_target));
-  return session->vtable->do_switch(session,
-                                    reporter, report_baton,
-                                    revision_to_switch_to, switch_target,
-                                    depth, switch_url,
-                                    send_copyfrom_args,
-                                    ignore_ancestry,
-                                    switch_editor,
-                                    switch_baton,
-                                    result_pool, scratch_pool);
+  SVN_ERR(session->vtable->do_switch(session,
+                                     reporter, report_baton,
+                                     revision_to_switch_to, switch_target,
+                                     depth, switch_url,
+                                     send_copyfrom_args,
+                                     ignore_ancestry,
+                                     switch_editor,
+                                     switch_baton,
+                                     result_pool, scratch_pool));
+
+  wrap_reporter(reporter, report_baton, session, "switch", switch_target,
+                start, result_pool);
+  return SVN_NO_ERROR;
 }
 
 svn_error_t *svn_ra_do_status2(svn_ra_session_t *session,
@@ -762,12 +928,18 @@ svn_error_t *svn_ra_do_status2(svn_ra_session_t *session,
                                void *status_baton,
                                apr_pool_t *pool)
 {
+  apr_time_t start = svn_trace__start(session->trace);
+
   SVN_ERR_ASSERT(svn_path_is_empty(status_target)
                  || svn_path_is_single_path_component(status_target));
-  return session->vtable->do_status(session,
-                                    reporter, report_baton,
-                                    status_target, revision, depth,
-                                    status_editor, status_baton, pool);
+  SVN_ERR(session->vtable->do_status(session,
+                                     reporter, report_baton,
+                                     status_target, revision, depth,
+                                     status_editor, status_baton, pool));
+
+  wrap_reporter(reporter, report_baton, session, "status", status_target,
+                start, pool);
+  return SVN_NO_ERROR;
 }
 
 svn_error_t *svn_ra_do_diff3(svn_ra_session_t *session,
@@ -783,14 +955,20 @@ svn_error_t *svn_ra_do_diff3(svn_ra_session_t *session,
                              void *diff_baton,
                              apr_pool_t *pool)
 {
+  apr_time_t start = svn_trace__start(session->trace);
+
   SVN_ERR_ASSERT(svn_path_is_empty(diff_target)
                  || svn_path_is_single_path_component(diff_target));
-  return session->vtable->do_diff(session,
-                                  reporter, report_baton,
-                                  revision, diff_target,
-                                  depth, ignore_ancestry,
-                                  text_deltas, versus_url, diff_editor,
-                                  diff_baton, pool);
+  SVN_ERR(session->vtable->do_diff(session,
+                                   reporter, report_baton,
+                                   revision, diff_target,
+                                   depth, ignore_ancestry,
+                                   text_deltas, versus_url, diff_editor,
+                                   diff_baton, pool));
+
+  wrap_reporter(reporter, report_baton, session, "diff", diff_target,
+                start, pool);
+  return SVN_NO_ERROR;
 }
 
 svn_error_t *svn_ra_get_log2(svn_ra_session_t *session,
@@ -806,6 +984,9 @@ svn_error_t *svn_ra_get_log2(svn_ra_session_t *session,
                              void *receiver_baton,
                              apr_pool_t *pool)
 {
+  apr_time_t begin;
+  svn_error_t *err;
+
   if (paths)
     {
       int i;
@@ -819,10 +1000,14 @@ svn_error_t *svn_ra_get_log2(svn_ra_session_t *session,
   if (include_merged_revisions)
     SVN_ERR(svn_ra__assert_mergeinfo_capable_server(session, NULL, pool));
 
-  return session->vtable->get_log(session, paths, start, end, limit,
-                                  discover_changed_paths, strict_node_history,
-                                  include_merged_revisions, revprops,
-                                  receiver, receiver_baton, pool);
+  begin = svn_trace__start(session->trace);
+  err = session->vtable->get_log(session, paths, start, end, limit,
+                                 discover_changed_paths, strict_node_history,
+                                 include_merged_revisions, revprops,
+                                 receiver, receiver_baton, pool);
+  svn_trace__span(session->trace, "ra", "log", NULL, begin);
+
+  return svn_error_trace(err);
 }
 
 svn_error_t *svn_ra_check_path(svn_ra_session_t *session,
@@ -835,6 +1020,75 @@ svn_error_t *svn_ra_check_path(svn_ra_session_t *session,
   return session->vtable->check_path(session, path, revision, kind, pool);
 }
 
+svn_error_t *
+svn_ra__check_paths(svn_ra_session_t *session,
+                    apr_array_header_t **kinds,
+                    const apr_array_header_t *paths,
+                    svn_revnum_t revision,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool;
+  int i;
+
+  for (i = 0; i < paths->nelts; ++i)
+    SVN_ERR_ASSERT(svn_relpath_is_canonical(APR_ARRAY_IDX(paths, i,
+                                                          const char *)));
+
+  if (session->vtable->check_paths)
+    {
+      svn_error_t *err = session->vtable->check_paths(session, kinds, paths,
+                                                      revision, result_pool,
+                                                      scratch_pool);
+      if (!err || err->apr_err != SVN_ERR_RA_NOT_IMPLEMENTED)
+        return svn_error_trace(err);
+
+      svn_error_clear(err);
+    }
+
+  /* Fall back to one request per path. */
+  *kinds = apr_array_make(result_pool, paths->nelts, sizeof(svn_node_kind_t));
+  iterpool = svn_pool_create(scratch_pool);
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      svn_node_kind_t kind;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(session->vtable->check_path(session,
+                                          APR_ARRAY_IDX(paths, i,
+                                                        const char *),
+                                          revision, &kind, iterpool));
+      APR_ARRAY_PUSH(*kinds, svn_node_kind_t) = kind;
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra__blame(svn_ra_session_t *session,
+              const char *path,
+              svn_revnum_t start,
+              svn_revnum_t end,
+              const svn_diff_file_options_t *diff_options,
+              svn_ra__blame_receiver_t receiver,
+              void *receiver_baton,
+              apr_pool_t *scratch_pool)
+{
+  SVN_ERR_ASSERT(svn_relpath_is_canonical(path));
+  SVN_ERR_ASSERT(SVN_IS_VALID_REVNUM(start) && SVN_IS_VALID_REVNUM(end)
+                 && start <= end);
+
+  if (!session->vtable->blame)
+    return svn_error_create(SVN_ERR_RA_NOT_IMPLEMENTED, NULL,
+                            _("Server-side blame is not supported"));
+
+  return svn_error_trace(session->vtable->blame(session, path, start, end,
+                                                diff_options, receiver,
+                                                receiver_baton,
+                                                scratch_pool));
+}
+
 svn_error_t *svn_ra_stat(svn_ra_session_t *session,
                          const char *path,
                          svn_revnum_t revision,
@@ -33,6 +33,7 @@
 #include "svn_ra.h"
 
 #include "private/svn_ra_private.h"
+#include "private/svn_trace.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -343,6 +344,26 @@ typedef struct svn_ra__vtable_t {
                        void *receiver_baton,
                        apr_pool_t *scratch_pool);
 
+  /* See svn_ra__check_paths().  May be NULL or return
+     SVN_ERR_RA_NOT_IMPLEMENTED, in which case the paths get checked
+     one by one. */
+  svn_error_t *(*check_paths)(svn_ra_session_t *session,
+                              apr_array_header_t **kinds,
+                              const apr_array_header_t *paths,
+                              svn_revnum_t revision,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
+  /* See svn_ra__blame().  May be NULL. */
+  svn_error_t *(*blame)(svn_ra_session_t *session,
+                        const char *path,
+                        svn_revnum_t start,
+                        svn_revnum_t end,
+                        const svn_diff_file_options_t *diff_options,
+                        svn_ra__blame_receiver_t receiver,
+                        void *receiver_baton,
+                        apr_pool_t *scratch_pool);
+
   /* Experimental support below here */
 
   /* See svn_ra__register_editor_shim_callbacks() */
@@ -391,6 +412,11 @@ struct svn_ra_session_t {
   /* Pool used to manage this session. */
   apr_pool_t *pool;
 
+  /* Trace of the operations of this session, NULL if tracing has not been
+     enabled in the servers config.  Implementations pass its request ID
+     on to servers that support it. */
+  svn_trace__t *trace;
+
   /* Private data for the RA implementation. */
   void *priv;
 };
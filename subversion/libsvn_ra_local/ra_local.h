@@ -81,7 +81,8 @@ typedef struct svn_ra_local__session_baton_t
    repository on local disk, and return that in REPOS_URL (if not
    NULL); URI-decode and return the remainder (the path *within* the
    repository's filesystem) in FS_PATH.  Open REPOS to the repository
-   root (if not NULL).  Allocate the return values in POOL.
+   root (if not NULL), see svn_ra_local__open_repos().  Allocate the
+   return values in POOL.
    Currently, we are not expecting to handle `file://hostname/'-type
    URLs; hostname, in this case, is expected to be the empty string or
    "localhost". */
@@ -92,6 +93,18 @@ svn_ra_local__split_URL(svn_repos_t **repos,
                         const char *URL,
                         apr_pool_t *pool);
 
+/* Set *REPOS to a repository object for the repository at ROOT, which
+   is ready for use and has the hook script environment configured.
+   The object may have been used by an earlier session and will be
+   handed out for reuse when RESULT_POOL gets cleaned up; it must not be
+   used afterwards.  Until then, no other caller will get the same
+   object.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *
+svn_ra_local__open_repos(svn_repos_t **repos,
+                         const char *root,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool);
+
 
 
 
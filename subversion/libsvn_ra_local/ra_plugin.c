@@ -731,6 +731,30 @@ svn_ra_local__get_file_revs(svn_ra_session_t *session,
                                   handler, handler_baton, pool);
 }
 
+static svn_error_t *
+svn_ra_local__blame(svn_ra_session_t *session,
+                    const char *path,
+                    svn_revnum_t start,
+                    svn_revnum_t end,
+                    const svn_diff_file_options_t *diff_options,
+                    svn_ra__blame_receiver_t receiver,
+                    void *receiver_baton,
+                    apr_pool_t *scratch_pool)
+{
+  svn_ra_local__session_baton_t *sess = session->priv;
+  const char *abs_path = svn_fspath__join(sess->fs_path->data, path,
+                                          scratch_pool);
+
+  return svn_error_trace(svn_repos__blame(sess->repos, abs_path, start, end,
+                                          diff_options, NULL, NULL,
+                                          receiver, receiver_baton,
+                                          sess->callbacks
+                                            ? sess->callbacks->cancel_func
+                                            : NULL,
+                                          sess->callback_baton,
+                                          scratch_pool));
+}
+
 static svn_error_t *
 svn_ra_local__get_dated_revision(svn_ra_session_t *session,
                                  svn_revnum_t *revision,
@@ -1191,6 +1215,33 @@ svn_ra_local__do_check_path(svn_ra_session_t *session,
   return svn_fs_check_path(kind, root, abs_path, pool);
 }
 
+static svn_error_t *
+svn_ra_local__check_paths(svn_ra_session_t *session,
+                          apr_array_header_t **kinds,
+                          const apr_array_header_t *paths,
+                          svn_revnum_t revision,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_ra_local__session_baton_t *sess = session->priv;
+  svn_fs_root_t *root;
+  apr_array_header_t *abs_paths
+    = apr_array_make(scratch_pool, paths->nelts, sizeof(const char *));
+  int i;
+
+  for (i = 0; i < paths->nelts; ++i)
+    APR_ARRAY_PUSH(abs_paths, const char *)
+      = svn_fspath__join(sess->fs_path->data,
+                         APR_ARRAY_IDX(paths, i, const char *),
+                         scratch_pool);
+
+  if (! SVN_IS_VALID_REVNUM(revision))
+    SVN_ERR(svn_fs_youngest_rev(&revision, sess->fs, scratch_pool));
+  SVN_ERR(svn_fs_revision_root(&root, sess->fs, revision, scratch_pool));
+  return svn_fs_check_paths(kinds, root, abs_paths, result_pool,
+                            scratch_pool);
+}
+
 
 static svn_error_t *
 svn_ra_local__stat(svn_ra_session_t *session,
@@ -1652,7 +1703,51 @@ svn_ra_local__replay_range(svn_ra_session_t *session,
                            void *replay_baton,
                            apr_pool_t *pool)
 {
-  return svn_error_create(SVN_ERR_RA_NOT_IMPLEMENTED, NULL, NULL);
+  svn_ra_local__session_baton_t *sess = session->priv;
+  svn_fs_t *fs = svn_repos_fs(sess->repos);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_pool_t *root_pools[2];
+  svn_fs_root_t *prev_root = NULL;
+  svn_revnum_t rev;
+
+  /* Each revision root lives for two iterations, so it can serve as the
+     delta base when replaying the next revision. */
+  root_pools[0] = svn_pool_create(pool);
+  root_pools[1] = svn_pool_create(pool);
+  for (rev = start_revision; rev <= end_revision; rev++)
+    {
+      const svn_delta_editor_t *editor;
+      void *edit_baton;
+      apr_hash_t *rev_props;
+      svn_fs_root_t *root;
+      apr_pool_t *root_pool = root_pools[rev % 2];
+
+      svn_pool_clear(iterpool);
+      svn_pool_clear(root_pool);
+
+      SVN_ERR(svn_repos_fs_revision_proplist(&rev_props, sess->repos, rev,
+                                             NULL, NULL, iterpool));
+      SVN_ERR(revstart_func(rev, replay_baton, &editor, &edit_baton,
+                            rev_props, iterpool));
+
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, root_pool));
+      SVN_ERR(svn_repos__replay_with_base(root,
+                                          send_deltas ? prev_root : NULL,
+                                          sess->fs_path->data,
+                                          low_water_mark, send_deltas,
+                                          editor, edit_baton, NULL, NULL,
+                                          iterpool));
+
+      SVN_ERR(revfinish_func(rev, replay_baton, editor, edit_baton,
+                             rev_props, iterpool));
+      prev_root = root;
+    }
+
+  svn_pool_destroy(root_pools[1]);
+  svn_pool_destroy(root_pools[0]);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
 }
 
 
@@ -1914,6 +2009,8 @@ static const svn_ra__vtable_t ra_local_vtable =
   svn_ra_local__get_inherited_props,
   NULL /* set_svn_ra_open */,
   svn_ra_local__list ,
+  svn_ra_local__check_paths,
+  svn_ra_local__blame,
   svn_ra_local__register_editor_shim_callbacks,
   svn_ra_local__get_commit_ev2,
   NULL /* replay_range_ev2 */
@@ -0,0 +1,354 @@
+/*
+ * repos_cache.c : reuse repository objects across ra_local sessions
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_pools.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_repos.h"
+#include "ra_local.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_mutex.h"
+#include "private/svn_repos_private.h"
+
+/* Opening a repository reads its configuration and sets up all the
+ * FS-level caches.  Tools that open many sessions to the same local
+ * repository would do that over and over again, so we keep the
+ * repository objects of closed sessions around and hand them to the
+ * next session that wants the same repository.
+ *
+ * A repository object is never used by two sessions at the same time
+ * because svn_fs_t carries per-session state such as the access
+ * context.  Every cached object lives in its own root pool, so it may
+ * be picked up by sessions in other threads.
+ *
+ * BDB repositories are not kept because an open environment would get
+ * in the way of recovery and other operations requiring exclusive access.
+ */
+
+/* Maximum number of unused repository objects to keep. */
+#define MAX_IDLE_REPOS 8
+
+/* Names of the files that identify a repository instance on disk,
+ * see repos_stamp_t.  The FS backends store their format and UUID
+ * files in the same places. */
+#define PATH_FORMAT "format"
+#define PATH_DB     "db"
+#define PATH_UUID   "uuid"
+
+/* Identity of a file on disk.  Files that are being rewritten by
+ * replacing them will get a new identity. */
+typedef struct file_stamp_t
+{
+  apr_ino_t inode;
+  apr_dev_t device;
+  apr_time_t mtime;
+  apr_time_t ctime;
+} file_stamp_t;
+
+/* Identifies a specific instance of a repository on disk.  Re-creating
+ * or upgrading a repository as well as changing its UUID replaces at
+ * least one of these files. */
+typedef struct repos_stamp_t
+{
+  file_stamp_t format;
+  file_stamp_t db_format;
+  file_stamp_t uuid;
+} repos_stamp_t;
+
+/* A repository object together with what we need to find and reuse it.
+ */
+typedef struct cached_repos_t
+{
+  /* Absolute path of the repository root.  Allocated in POOL. */
+  const char *root;
+
+  /* State of the repository on disk when REPOS got opened. */
+  repos_stamp_t stamp;
+
+  /* The repository object and the root pool that owns it. */
+  svn_repos_t *repos;
+  apr_pool_t *pool;
+
+  /* Whether to keep REPOS around for reuse once it has been released. */
+  svn_boolean_t reusable;
+
+  /* Next unused object, if this one is unused. */
+  struct cached_repos_t *next;
+} cached_repos_t;
+
+/* Unused repository objects, most recently used first.  Access is
+ * serialized by CACHE_MUTEX. */
+static cached_repos_t *idle_repos = NULL;
+static svn_mutex__t *cache_mutex = NULL;
+static volatile svn_atomic_t cache_init_state = 0;
+
+/* Implements svn_atomic__init_once callback.  Creates the mutex for the
+ * cache of unused repository objects. */
+static svn_error_t *
+init_cache(void *baton,
+           apr_pool_t *scratch_pool)
+{
+  /* Lives until the process terminates. */
+  apr_pool_t *pool = svn_pool_create(NULL);
+
+  return svn_error_trace(svn_mutex__init(&cache_mutex, TRUE, pool));
+}
+
+/* Set *STAMP to the identity of the file at PATH, or all 0 if there is
+ * no such file.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_file_stamp(file_stamp_t *stamp,
+               const char *path,
+               apr_pool_t *scratch_pool)
+{
+  apr_finfo_t finfo;
+  svn_error_t *err;
+
+  memset(stamp, 0, sizeof(*stamp));
+  err = svn_io_stat(&finfo, path,
+                    APR_FINFO_INODE | APR_FINFO_DEV
+                    | APR_FINFO_MTIME | APR_FINFO_CTIME,
+                    scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  stamp->inode = finfo.inode;
+  stamp->device = finfo.device;
+  stamp->mtime = finfo.mtime;
+  stamp->ctime = finfo.ctime;
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *STAMP to the identity of the repository at ROOT.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_repos_stamp(repos_stamp_t *stamp,
+                const char *root,
+                apr_pool_t *scratch_pool)
+{
+  const char *db_path = svn_dirent_join(root, PATH_DB, scratch_pool);
+
+  SVN_ERR(get_file_stamp(&stamp->format,
+                         svn_dirent_join(root, PATH_FORMAT, scratch_pool),
+                         scratch_pool));
+  SVN_ERR(get_file_stamp(&stamp->db_format,
+                         svn_dirent_join(db_path, PATH_FORMAT,
+                                         scratch_pool),
+                         scratch_pool));
+  SVN_ERR(get_file_stamp(&stamp->uuid,
+                         svn_dirent_join(db_path, PATH_UUID, scratch_pool),
+                         scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return TRUE if the file stamps LHS and RHS are the same. */
+static svn_boolean_t
+same_file_stamp(const file_stamp_t *lhs,
+                const file_stamp_t *rhs)
+{
+  return lhs->inode == rhs->inode
+      && lhs->device == rhs->device
+      && lhs->mtime == rhs->mtime
+      && lhs->ctime == rhs->ctime;
+}
+
+/* Return TRUE if the repository stamps LHS and RHS are the same. */
+static svn_boolean_t
+same_repos_stamp(const repos_stamp_t *lhs,
+                 const repos_stamp_t *rhs)
+{
+  return same_file_stamp(&lhs->format, &rhs->format)
+      && same_file_stamp(&lhs->db_format, &rhs->db_format)
+      && same_file_stamp(&lhs->uuid, &rhs->uuid);
+}
+
+/* Remove the most recently used entry for the repository at ROOT with
+ * STAMP from the unused list and return it in *ENTRY.  Set *ENTRY to NULL
+ * if there is none.  Objects for ROOT that are outdated will be removed
+ * and added to *OUTDATED.  Call this only while holding CACHE_MUTEX. */
+static svn_error_t *
+take_idle_repos(cached_repos_t **entry,
+                cached_repos_t **outdated,
+                const char *root,
+                const repos_stamp_t *stamp)
+{
+  cached_repos_t **link = &idle_repos;
+
+  *entry = NULL;
+  while (*link)
+    {
+      cached_repos_t *current = *link;
+      if (strcmp(current->root, root))
+        {
+          link = &current->next;
+          continue;
+        }
+
+      *link = current->next;
+      if (same_repos_stamp(&current->stamp, stamp))
+        {
+          current->next = NULL;
+          *entry = current;
+          break;
+        }
+
+      current->next = *outdated;
+      *outdated = current;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Add ENTRY to the front of the unused list and remove all entries
+ * beyond MAX_IDLE_REPOS from it, returning them in *EVICTED.  Call this
+ * only while holding CACHE_MUTEX. */
+static svn_error_t *
+put_idle_repos(cached_repos_t **evicted,
+               cached_repos_t *entry)
+{
+  cached_repos_t *current;
+  int count;
+
+  entry->next = idle_repos;
+  idle_repos = entry;
+
+  for (current = idle_repos, count = 1;
+       current->next && count < MAX_IDLE_REPOS;
+       current = current->next, ++count)
+    ;
+
+  *evicted = current->next;
+  current->next = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Destroy all repository objects in the list starting at ENTRIES. */
+static void
+destroy_entries(cached_repos_t *entries)
+{
+  while (entries)
+    {
+      cached_repos_t *next = entries->next;
+      svn_pool_destroy(entries->pool);
+      entries = next;
+    }
+}
+
+/* Pool cleanup function returning the cached_repos_t in DATA to the list
+ * of unused repository objects. */
+static apr_status_t
+release_repos(void *data)
+{
+  cached_repos_t *entry = data;
+  cached_repos_t *evicted = NULL;
+  svn_error_t *err;
+
+  /* Forget everything that has been allocated in the session's pool. */
+  svn_error_clear(svn_fs_set_access(svn_repos_fs(entry->repos), NULL));
+  svn_error_clear(svn_repos_remember_client_capabilities(entry->repos,
+                                                         NULL));
+
+  if (!entry->reusable)
+    {
+      svn_pool_destroy(entry->pool);
+      return APR_SUCCESS;
+    }
+
+  err = svn_mutex__lock(cache_mutex);
+  if (err)
+    {
+      svn_error_clear(err);
+      svn_pool_destroy(entry->pool);
+      return APR_SUCCESS;
+    }
+
+  err = put_idle_repos(&evicted, entry);
+  svn_error_clear(svn_mutex__unlock(cache_mutex, err));
+
+  destroy_entries(evicted);
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+svn_ra_local__open_repos(svn_repos_t **repos,
+                         const char *root,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  repos_stamp_t stamp;
+  cached_repos_t *entry;
+  cached_repos_t *outdated = NULL;
+
+  SVN_ERR(svn_atomic__init_once(&cache_init_state, init_cache, NULL,
+                                scratch_pool));
+
+  /* Take the stamp before opening the repository.  If the latter gets
+     replaced in between, we simply won't be able to reuse the object. */
+  SVN_ERR(get_repos_stamp(&stamp, root, scratch_pool));
+  SVN_MUTEX__WITH_LOCK(cache_mutex,
+                       take_idle_repos(&entry, &outdated, root, &stamp));
+  destroy_entries(outdated);
+
+  if (!entry)
+    {
+      apr_pool_t *pool = svn_pool_create(NULL);
+      const char *fs_type;
+      svn_error_t *err;
+
+      entry = apr_pcalloc(pool, sizeof(*entry));
+      entry->root = apr_pstrdup(pool, root);
+      entry->stamp = stamp;
+      entry->pool = pool;
+
+      err = svn_repos_open3(&entry->repos, root, NULL, pool, scratch_pool);
+      if (!err)
+        err = svn_repos_hooks_setenv(entry->repos, NULL, scratch_pool);
+      if (!err)
+        err = svn_repos__fs_type(&fs_type, root, scratch_pool);
+
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+
+      entry->reusable = strcmp(fs_type, SVN_FS_TYPE_BDB) != 0;
+    }
+
+  apr_pool_cleanup_register(result_pool, entry, release_repos,
+                            apr_pool_cleanup_null);
+  *repos = entry->repos;
+
+  return SVN_NO_ERROR;
+}
@@ -49,8 +49,9 @@ svn_ra_local__split_URL(svn_repos_t **repos,
     return svn_error_createf(SVN_ERR_RA_LOCAL_REPOS_OPEN_FAILED, NULL,
                              _("Unable to open repository '%s'"), URL);
 
-  /* Attempt to open a repository at URL. */
-  err = svn_repos_open3(repos, repos_root_dirent, NULL, pool, pool);
+  /* Attempt to open a repository at URL, reusing a previously opened
+     one if possible. */
+  err = svn_ra_local__open_repos(repos, repos_root_dirent, pool, pool);
   if (err)
     return svn_error_createf(SVN_ERR_RA_LOCAL_REPOS_OPEN_FAILED, err,
                              _("Unable to open repository '%s'"), URL);
@@ -98,8 +99,5 @@ svn_ra_local__split_URL(svn_repos_t **repos,
                              - svn_path_component_count(repos_root_dirent));
   *repos_root_url = urlbuf->data;
 
-  /* Configure hook script environment variables. */
-  SVN_ERR(svn_repos_hooks_setenv(*repos, NULL, pool));
-
   return SVN_NO_ERROR;
 }
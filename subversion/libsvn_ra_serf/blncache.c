@@ -21,12 +21,17 @@
  * ====================================================================
  */
 
+#include <string.h>
+
 #include <apr_pools.h>
 
 #include "svn_hash.h"
+#include "svn_checksum.h"
 #include "svn_dirent_uri.h"
+#include "svn_io.h"
 #include "svn_types.h"
 #include "svn_pools.h"
+#include "svn_string.h"
 
 #include "blncache.h"
 
@@ -50,8 +55,37 @@ struct svn_ra_serf__blncache_t
    * structures. (Allocated from the same pool as 'revnum_to_bc'.)
    */
   apr_hash_t *baseline_info;
+
+  /* Repository the cached information belongs to and its immutable
+   * properties.  NULL resp. svn_tristate_unknown if unknown.
+   * (Allocated in POOL.)
+   */
+  const char *repos_root_url;
+  const char *uuid;
+  const char *vcc_url;
+  svn_tristate_t mergeinfo;
+
+  /* Directory to store the cache contents in or NULL, if the cache is
+   * not persistent.  Information read from there expires at EXPIRES.
+   * DIRTY is set when we learned something that is not on disk yet.
+   */
+  const char *cache_dir;
+  apr_time_t expires;
+  svn_boolean_t dirty;
+
+  /* The pool the cache has been created in. */
+  apr_pool_t *pool;
 };
 
+/* Keys and key prefixes used in the persistent cache files. */
+#define KEY_REPOS_ROOT  "repos-root"
+#define KEY_UUID        "uuid"
+#define KEY_VCC         "vcc"
+#define KEY_MERGEINFO   "mergeinfo"
+#define KEY_EXPIRES     "expires"
+#define PREFIX_REVISION "rev:"
+#define PREFIX_BASELINE "bln:"
+
 
 
 /* Return a pointer to an 'baseline_info_t' structure allocated from
@@ -99,6 +133,8 @@ svn_ra_serf__blncache_create(svn_ra_serf__blncache_t **blncache_p,
   cache_pool = svn_pool_create(pool);
   blncache->revnum_to_bc = apr_hash_make(cache_pool);
   blncache->baseline_info = apr_hash_make(cache_pool);
+  blncache->mergeinfo = svn_tristate_unknown;
+  blncache->pool = pool;
 
   *blncache_p = blncache;
 
@@ -127,14 +163,20 @@ svn_ra_serf__blncache_set(svn_ra_serf__blncache_t *blncache,
           blncache->baseline_info = apr_hash_make(cache_pool);
         }
 
-      hash_set_copy(blncache->revnum_to_bc, &revision, sizeof(revision),
-                    apr_pstrdup(cache_pool, bc_url));
+      if (!apr_hash_get(blncache->revnum_to_bc, &revision, sizeof(revision)))
+        {
+          hash_set_copy(blncache->revnum_to_bc, &revision, sizeof(revision),
+                        apr_pstrdup(cache_pool, bc_url));
+          blncache->dirty = TRUE;
+        }
 
-      if (baseline_url)
+      if (baseline_url && !svn_hash_gets(blncache->baseline_info,
+                                         baseline_url))
         {
           hash_set_copy(blncache->baseline_info, baseline_url,
                         APR_HASH_KEY_STRING,
                         baseline_info_make(bc_url, revision, cache_pool));
+          blncache->dirty = TRUE;
         }
     }
 
@@ -177,3 +219,363 @@ svn_ra_serf__blncache_get_baseline_info(const char **bc_url_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_ra_serf__blncache_get_repos_info(const char **repos_root_url_p,
+                                     const char **uuid_p,
+                                     const char **vcc_url_p,
+                                     svn_ra_serf__blncache_t *blncache,
+                                     apr_pool_t *result_pool)
+{
+  *repos_root_url_p = apr_pstrdup(result_pool, blncache->repos_root_url);
+  *uuid_p = apr_pstrdup(result_pool, blncache->uuid);
+  *vcc_url_p = apr_pstrdup(result_pool, blncache->vcc_url);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *FIELD to a copy of VALUE in BLNCACHE's pool, if it is not set yet.
+ */
+static void
+set_info_field(const char **field,
+               const char *value,
+               svn_ra_serf__blncache_t *blncache)
+{
+  if (value && !*field)
+    {
+      *field = apr_pstrdup(blncache->pool, value);
+      blncache->dirty = TRUE;
+    }
+}
+
+svn_error_t *
+svn_ra_serf__blncache_set_repos_info(svn_ra_serf__blncache_t *blncache,
+                                     const char *repos_root_url,
+                                     const char *uuid,
+                                     const char *vcc_url,
+                                     apr_pool_t *scratch_pool)
+{
+  /* Never mix information about different repositories. */
+  if (blncache->repos_root_url && repos_root_url
+      && strcmp(blncache->repos_root_url, repos_root_url))
+    return SVN_NO_ERROR;
+
+  set_info_field(&blncache->repos_root_url, repos_root_url, blncache);
+  set_info_field(&blncache->uuid, uuid, blncache);
+  set_info_field(&blncache->vcc_url, vcc_url, blncache);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_serf__blncache_get_mergeinfo(svn_tristate_t *supported_p,
+                                    svn_ra_serf__blncache_t *blncache)
+{
+  *supported_p = blncache->mergeinfo;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_serf__blncache_set_mergeinfo(svn_ra_serf__blncache_t *blncache,
+                                    svn_boolean_t supported)
+{
+  svn_tristate_t value = supported ? svn_tristate_true : svn_tristate_false;
+
+  if (blncache->mergeinfo != value)
+    {
+      blncache->mergeinfo = value;
+      blncache->dirty = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the file in BLNCACHE's cache directory that holds the
+ * information about the repository at REPOS_ROOT_URL.  Allocate the
+ * result in POOL.
+ */
+static const char *
+cache_file_path(svn_ra_serf__blncache_t *blncache,
+                const char *repos_root_url,
+                apr_pool_t *pool)
+{
+  svn_checksum_t *checksum;
+
+  svn_error_clear(svn_checksum(&checksum, svn_checksum_md5, repos_root_url,
+                               strlen(repos_root_url), pool));
+
+  return svn_dirent_join(blncache->cache_dir,
+                         svn_checksum_to_cstring(checksum, pool), pool);
+}
+
+/* Read the cache file for the repository at REPOS_ROOT_URL into *HASH,
+ * allocated in POOL.  Set *HASH to NULL if there is no such file, it
+ * belongs to a different repository (checksum collision) or has expired.
+ */
+static svn_error_t *
+read_cache_file(apr_hash_t **hash,
+                svn_ra_serf__blncache_t *blncache,
+                const char *repos_root_url,
+                apr_pool_t *pool)
+{
+  const char *path = cache_file_path(blncache, repos_root_url, pool);
+  svn_stream_t *stream;
+  svn_string_t *value;
+  apr_int64_t expires;
+  svn_error_t *err;
+
+  *hash = NULL;
+
+  err = svn_stream_open_readonly(&stream, path, pool, pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  SVN_ERR(err);
+
+  *hash = apr_hash_make(pool);
+  SVN_ERR(svn_hash_read2(*hash, stream, SVN_HASH_TERMINATOR, pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  value = svn_hash_gets(*hash, KEY_REPOS_ROOT);
+  if (!value || strcmp(value->data, repos_root_url))
+    {
+      *hash = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  value = svn_hash_gets(*hash, KEY_EXPIRES);
+  if (!value)
+    {
+      *hash = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_cstring_atoi64(&expires, value->data));
+  if (expires <= apr_time_now())
+    *hash = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Copy the contents of HASH, as read by read_cache_file(), into BLNCACHE.
+ */
+static svn_error_t *
+load_cache_file(svn_ra_serf__blncache_t *blncache,
+                apr_hash_t *hash,
+                apr_pool_t *scratch_pool)
+{
+  apr_pool_t *cache_pool = apr_hash_pool_get(blncache->revnum_to_bc);
+  apr_hash_index_t *hi;
+  svn_string_t *value;
+
+  value = svn_hash_gets(hash, KEY_REPOS_ROOT);
+  blncache->repos_root_url = apr_pstrdup(blncache->pool, value->data);
+  value = svn_hash_gets(hash, KEY_UUID);
+  blncache->uuid = value ? apr_pstrdup(blncache->pool, value->data) : NULL;
+  value = svn_hash_gets(hash, KEY_VCC);
+  blncache->vcc_url = value ? apr_pstrdup(blncache->pool, value->data)
+                            : NULL;
+  value = svn_hash_gets(hash, KEY_MERGEINFO);
+  blncache->mergeinfo = value ? svn_tristate__from_word(value->data)
+                              : svn_tristate_unknown;
+  value = svn_hash_gets(hash, KEY_EXPIRES);
+  SVN_ERR(svn_cstring_atoi64(&blncache->expires, value->data));
+
+  for (hi = apr_hash_first(scratch_pool, hash); hi; hi = apr_hash_next(hi))
+    {
+      const char *key = apr_hash_this_key(hi);
+      const char *val = ((svn_string_t *)apr_hash_this_val(hi))->data;
+      apr_int64_t revision;
+
+      if (strncmp(key, PREFIX_REVISION, sizeof(PREFIX_REVISION) - 1) == 0)
+        {
+          svn_revnum_t revnum;
+
+          SVN_ERR(svn_cstring_atoi64(&revision,
+                                     key + sizeof(PREFIX_REVISION) - 1));
+          revnum = (svn_revnum_t)revision;
+          hash_set_copy(blncache->revnum_to_bc, &revnum, sizeof(revnum),
+                        apr_pstrdup(cache_pool, val));
+        }
+      else if (strncmp(key, PREFIX_BASELINE,
+                       sizeof(PREFIX_BASELINE) - 1) == 0)
+        {
+          /* VAL is "<revision> <bc_url>". */
+          const char *bc_url = strchr(val, ' ');
+
+          if (bc_url)
+            {
+              SVN_ERR(svn_cstring_atoi64(&revision,
+                                         apr_pstrmemdup(scratch_pool, val,
+                                                        bc_url - val)));
+              hash_set_copy(blncache->baseline_info,
+                            key + sizeof(PREFIX_BASELINE) - 1,
+                            APR_HASH_KEY_STRING,
+                            baseline_info_make(bc_url + 1,
+                                               (svn_revnum_t)revision,
+                                               cache_pool));
+            }
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the contents of BLNCACHE to its cache file.
+ */
+static svn_error_t *
+write_cache_file(svn_ra_serf__blncache_t *blncache,
+                 apr_pool_t *scratch_pool)
+{
+  apr_hash_t *hash = apr_hash_make(scratch_pool);
+  const char *path = cache_file_path(blncache, blncache->repos_root_url,
+                                     scratch_pool);
+  const char *tmp_path;
+  svn_stream_t *stream;
+  apr_hash_index_t *hi;
+
+  svn_hash_sets(hash, KEY_REPOS_ROOT,
+                svn_string_create(blncache->repos_root_url, scratch_pool));
+  svn_hash_sets(hash, KEY_EXPIRES,
+                svn_string_createf(scratch_pool, "%" APR_TIME_T_FMT,
+                                   blncache->expires));
+  if (blncache->uuid)
+    svn_hash_sets(hash, KEY_UUID,
+                  svn_string_create(blncache->uuid, scratch_pool));
+  if (blncache->vcc_url)
+    svn_hash_sets(hash, KEY_VCC,
+                  svn_string_create(blncache->vcc_url, scratch_pool));
+  if (blncache->mergeinfo != svn_tristate_unknown)
+    svn_hash_sets(hash, KEY_MERGEINFO,
+                  svn_string_create(svn_tristate__to_word(blncache->mergeinfo),
+                                    scratch_pool));
+
+  for (hi = apr_hash_first(scratch_pool, blncache->revnum_to_bc);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const svn_revnum_t *revision = apr_hash_this_key(hi);
+      svn_hash_sets(hash,
+                    apr_psprintf(scratch_pool, PREFIX_REVISION "%ld",
+                                 *revision),
+                    svn_string_create(apr_hash_this_val(hi), scratch_pool));
+    }
+
+  for (hi = apr_hash_first(scratch_pool, blncache->baseline_info);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      const baseline_info_t *info = apr_hash_this_val(hi);
+      svn_hash_sets(hash,
+                    apr_pstrcat(scratch_pool, PREFIX_BASELINE,
+                                apr_hash_this_key(hi), SVN_VA_NULL),
+                    svn_string_createf(scratch_pool, "%ld %s",
+                                       info->revision, info->bc_url));
+    }
+
+  /* Concurrent processes may update the same file.  Replace it
+   * atomically; the last one wins. */
+  SVN_ERR(svn_io_make_dir_recursively(blncache->cache_dir, scratch_pool));
+  SVN_ERR(svn_stream_open_unique(&stream, &tmp_path, blncache->cache_dir,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 scratch_pool, scratch_pool));
+  SVN_ERR(svn_hash_write2(hash, stream, SVN_HASH_TERMINATOR, scratch_pool));
+  SVN_ERR(svn_stream_close(stream));
+  SVN_ERR(svn_io_file_rename2(tmp_path, path, FALSE, scratch_pool));
+
+  blncache->dirty = FALSE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Pool pre-cleanup function writing the svn_ra_serf__blncache_t in BATON
+ * to disk, if it contains anything new.  Runs before the cache's sub-pools
+ * are gone.
+ */
+static apr_status_t
+flush_on_cleanup(void *baton)
+{
+  svn_ra_serf__blncache_t *blncache = baton;
+
+  if (blncache->dirty && blncache->repos_root_url)
+    {
+      apr_pool_t *scratch_pool = svn_pool_create(blncache->pool);
+
+      /* The cache is merely an optimization.  Don't fail because of it. */
+      svn_error_clear(write_cache_file(blncache, scratch_pool));
+      svn_pool_destroy(scratch_pool);
+    }
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+svn_ra_serf__blncache_attach(svn_ra_serf__blncache_t *blncache,
+                             const char *cache_dir,
+                             apr_interval_time_t ttl,
+                             const char *session_url,
+                             const char *repos_root_url,
+                             const char *uuid,
+                             apr_pool_t *scratch_pool)
+{
+  apr_hash_t *hash = NULL;
+  const char *candidate;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  blncache->cache_dir = apr_pstrdup(blncache->pool, cache_dir);
+  blncache->expires = apr_time_now() + ttl;
+
+  /* The repository root is either known or one of SESSION_URL's
+   * ancestors.  Look for the closest one that we have a file for. */
+  if (repos_root_url)
+    {
+      err = read_cache_file(&hash, blncache, repos_root_url, scratch_pool);
+    }
+  else
+    {
+      for (candidate = session_url;
+           !err && !hash;
+           candidate = svn_uri_dirname(candidate, scratch_pool))
+        {
+          err = read_cache_file(&hash, blncache, candidate, scratch_pool);
+          if (svn_uri_is_root(candidate, strlen(candidate)))
+            break;
+        }
+    }
+
+  /* The repository may have been replaced since we wrote the file. */
+  if (!err && hash && uuid)
+    {
+      svn_string_t *cached_uuid = svn_hash_gets(hash, KEY_UUID);
+      if (!cached_uuid || strcmp(cached_uuid->data, uuid))
+        hash = NULL;
+    }
+
+  /* A broken cache file is as good as none. */
+  if (!err && hash)
+    err = load_cache_file(blncache, hash, scratch_pool);
+
+  if (err)
+    {
+      apr_pool_t *cache_pool = apr_hash_pool_get(blncache->revnum_to_bc);
+
+      svn_error_clear(err);
+      svn_pool_clear(cache_pool);
+      blncache->revnum_to_bc = apr_hash_make(cache_pool);
+      blncache->baseline_info = apr_hash_make(cache_pool);
+      blncache->repos_root_url = NULL;
+      blncache->uuid = NULL;
+      blncache->vcc_url = NULL;
+      blncache->mergeinfo = svn_tristate_unknown;
+      blncache->expires = apr_time_now() + ttl;
+    }
+
+  blncache->dirty = FALSE;
+  SVN_ERR(svn_ra_serf__blncache_set_repos_info(blncache, repos_root_url,
+                                               uuid, NULL, scratch_pool));
+
+  apr_pool_pre_cleanup_register(blncache->pool, blncache, flush_on_cleanup);
+
+  return SVN_NO_ERROR;
+}
@@ -37,6 +37,10 @@ extern "C" {
  * 1. URL of the baseline (bln)
  * 2. Revision number associated with baseline
  * 3. URL of baseline collection (bc).
+ *
+ * Along with it, the cache holds the immutable properties of the
+ * repository: root URL, UUID, VCC URL and mergeinfo support.  Optionally,
+ * all of this can be kept on disk across sessions and processes.
  */
 typedef struct svn_ra_serf__blncache_t svn_ra_serf__blncache_t;
 
@@ -83,6 +87,64 @@ svn_ra_serf__blncache_get_baseline_info(const char **bc_url_p,
                                         const char *baseline_url,
                                         apr_pool_t *pool);
 
+/* Sets *REPOS_ROOT_URL_P, *UUID_P and *VCC_URL_P to the root URL, UUID
+ * and version-controlled configuration URL of the repository BLNCACHE
+ * belongs to.  Each of them will be NULL if the cache doesn't know it.
+ * Allocate the results in RESULT_POOL.
+ */
+svn_error_t *
+svn_ra_serf__blncache_get_repos_info(const char **repos_root_url_p,
+                                     const char **uuid_p,
+                                     const char **vcc_url_p,
+                                     svn_ra_serf__blncache_t *blncache,
+                                     apr_pool_t *result_pool);
+
+/* Add information about the repository to BLNCACHE.  REPOS_ROOT_URL,
+ * UUID and VCC_URL may each be NULL if unknown.  Information that the
+ * cache already has will not be replaced.
+ */
+svn_error_t *
+svn_ra_serf__blncache_set_repos_info(svn_ra_serf__blncache_t *blncache,
+                                     const char *repos_root_url,
+                                     const char *uuid,
+                                     const char *vcc_url,
+                                     apr_pool_t *scratch_pool);
+
+/* Sets *SUPPORTED_P to whether the repository BLNCACHE belongs to supports
+ * mergeinfo, or to svn_tristate_unknown if the cache doesn't know.
+ */
+svn_error_t *
+svn_ra_serf__blncache_get_mergeinfo(svn_tristate_t *supported_p,
+                                    svn_ra_serf__blncache_t *blncache);
+
+/* Record in BLNCACHE whether the repository SUPPORTED mergeinfo.
+ */
+svn_error_t *
+svn_ra_serf__blncache_set_mergeinfo(svn_ra_serf__blncache_t *blncache,
+                                    svn_boolean_t supported);
+
+/* Make BLNCACHE persistent, storing one file per repository in CACHE_DIR.
+ *
+ * Load the information about the repository that contains SESSION_URL.
+ * If REPOS_ROOT_URL is not NULL, that is the repository's root URL;
+ * otherwise, the closest ancestor of SESSION_URL that has a cache file
+ * is used.  If UUID is not NULL, ignore files for a repository with a
+ * different UUID.  Files written more than TTL ago are ignored as well.
+ *
+ * Everything BLNCACHE learns until the pool it was created in gets
+ * cleaned up will be written back to CACHE_DIR at that point.  Since the
+ * cache is only an optimization, problems with reading or writing the
+ * files are silently ignored.
+ */
+svn_error_t *
+svn_ra_serf__blncache_attach(svn_ra_serf__blncache_t *blncache,
+                             const char *cache_dir,
+                             apr_interval_time_t ttl,
+                             const char *session_url,
+                             const char *repos_root_url,
+                             const char *uuid,
+                             apr_pool_t *scratch_pool);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -40,6 +40,7 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_fspath.h"
 #include "private/svn_skel.h"
+#include "private/svn_subr_private.h"
 
 #include "ra_serf.h"
 #include "../libsvn_ra/ra_loader.h"
@@ -72,10 +73,23 @@ typedef struct commit_context_t {
   const char *vcc_url;           /* vcc url */
 
   int open_batons;               /* Number of open batons */
+
+  int pending_puts;              /* Number of PUTs awaiting a response */
 } commit_context_t;
 
 #define USING_HTTPV2_COMMIT_SUPPORT(commit_ctx) ((commit_ctx)->txn_url != NULL)
 
+/* Send PUTs without waiting for their responses?  The server handles
+   requests on a http/1.1 connection strictly in order, so later requests
+   will still see the effects of earlier PUTs.  http/2 streams, however,
+   get processed concurrently. */
+#define PIPELINE_PUTS(commit_ctx) \
+  (!(commit_ctx)->session->http10 && !(commit_ctx)->session->http20)
+
+/* Maximum number of pipelined PUTs, each with its own spooled svndiff,
+   that may await their responses at any time. */
+#define MAX_PENDING_PUTS 16
+
 /* Structure associated with a PROPPATCH request. */
 typedef struct proppatch_context_t {
   apr_pool_t *pool;
@@ -188,8 +202,26 @@ typedef struct file_context_t {
   /* URL to PUT the file at. */
   const char *url;
 
+  /* If the PUT gets pipelined, the pool that holds SVNDIFF and the
+     request.  It outlives this file baton. */
+  apr_pool_t *put_pool;
+
 } file_context_t;
 
+/* A pipelined PUT request. */
+typedef struct put_context_t {
+  /* Pool containing this structure, the request and its body. */
+  apr_pool_t *pool;
+
+  /* Copy of the file baton with everything needed to create the request. */
+  file_context_t *file;
+
+  svn_ra_serf__handler_t *handler;
+
+  /* The HTTP status code we expect. */
+  int expected_result;
+} put_context_t;
+
 
 /* Setup routines and handlers for various requests we'll invoke. */
 
@@ -911,6 +943,56 @@ setup_put_headers(serf_bucket_t *headers,
   return APR_SUCCESS;
 }
 
+/* Implements svn_ra_serf__response_done_delegate_t for pipelined PUTs. */
+static svn_error_t *
+put_done(serf_request_t *request,
+         void *baton,
+         apr_pool_t *scratch_pool)
+{
+  put_context_t *put = baton;
+  svn_ra_serf__handler_t *handler = put->handler;
+
+  put->file->commit_ctx->pending_puts--;
+
+  if (handler->server_error)
+    return svn_error_trace(svn_ra_serf__server_error_create(handler,
+                                                            scratch_pool));
+
+  if (handler->sline.code != put->expected_result)
+    return svn_error_trace(svn_ra_serf__unexpected_status(handler));
+
+  /* Release the request and its spooled body.  Destroying the pool that
+     contains the handler is only valid from within this callback. */
+  svn_pool_destroy(put->pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Run the serf context of CTX until no more than MAX_PENDING pipelined
+   PUTs await their responses. */
+static svn_error_t *
+wait_for_puts(commit_context_t *ctx,
+              int max_pending,
+              apr_pool_t *scratch_pool)
+{
+  apr_interval_time_t waittime_left = ctx->session->timeout;
+  apr_pool_t *iterpool;
+
+  if (ctx->pending_puts <= max_pending)
+    return SVN_NO_ERROR;
+
+  iterpool = svn_pool_create(scratch_pool);
+  while (ctx->pending_puts > max_pending)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_serf__context_run(ctx->session, &waittime_left,
+                                       iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 setup_copy_file_headers(serf_bucket_t *headers,
                         void *baton,
@@ -1888,13 +1970,26 @@ apply_textdelta(void *file_baton,
    *     for sure after the request is completely available.
    */
 
+  /* Pipelined PUTs may be sent long after the file baton is gone. */
+  if (PIPELINE_PUTS(ctx->commit_ctx))
+    ctx->put_pool = svn_pool_create(ctx->commit_ctx->pool);
+
   ctx->svndiff =
     svn_ra_serf__request_body_create(SVN_RA_SERF__REQUEST_BODY_IN_MEM_SIZE,
-                                     ctx->pool);
+                                     ctx->put_pool ? ctx->put_pool
+                                                   : ctx->pool);
   ctx->stream = svn_ra_serf__request_body_get_stream(ctx->svndiff);
 
-  if (ctx->commit_ctx->session->supports_svndiff1 &&
-      ctx->commit_ctx->session->using_compression)
+  if (ctx->commit_ctx->session->supports_svndiff2 &&
+      ctx->commit_ctx->session->using_compression &&
+      svn__lz4_supported())
+    {
+      /* Prefer the cheap LZ4 compression of svndiff2, if possible. */
+      svndiff_version = 2;
+      compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
+    }
+  else if (ctx->commit_ctx->session->supports_svndiff1 &&
+           ctx->commit_ctx->session->using_compression)
     {
       /* Use compressed svndiff1 format, if possible. */
       svndiff_version = 1;
@@ -1963,7 +2058,74 @@ close_file(void *file_baton,
     put_empty_file = TRUE;
 
   /* If we had a stream of changes, push them to the server... */
-  if (ctx->svndiff || put_empty_file)
+  if ((ctx->svndiff || put_empty_file) && PIPELINE_PUTS(ctx->commit_ctx))
+    {
+      commit_context_t *commit_ctx = ctx->commit_ctx;
+      svn_ra_serf__handler_t *handler;
+      put_context_t *put;
+      apr_pool_t *put_pool = ctx->put_pool;
+
+      if (!put_pool)
+        put_pool = svn_pool_create(commit_ctx->pool);
+
+      /* Copy what the request needs out of the file baton. */
+      put = apr_pcalloc(put_pool, sizeof(*put));
+      put->pool = put_pool;
+      put->file = apr_pmemdup(put_pool, ctx, sizeof(*ctx));
+      put->file->relpath = apr_pstrdup(put_pool, ctx->relpath);
+      put->file->url = apr_pstrdup(put_pool, ctx->url);
+      put->file->base_checksum = apr_pstrdup(put_pool, ctx->base_checksum);
+      put->file->result_checksum = apr_pstrdup(put_pool,
+                                               ctx->result_checksum);
+
+      if (ctx->added && ! ctx->copy_path)
+        put->expected_result = 201; /* Created */
+      else
+        put->expected_result = 204; /* Updated */
+
+      handler = svn_ra_serf__create_handler(commit_ctx->session, put_pool);
+      put->handler = handler;
+
+      handler->method = "PUT";
+      handler->path = put->file->url;
+
+      handler->response_handler = svn_ra_serf__expect_empty_body;
+      handler->response_baton = handler;
+
+      handler->done_delegate = put_done;
+      handler->done_delegate_baton = put;
+
+      if (put_empty_file)
+        {
+          handler->body_delegate = create_empty_put_body;
+          handler->body_delegate_baton = put->file;
+          handler->body_type = "text/plain";
+        }
+      else
+        {
+          SVN_ERR(svn_stream_close(ctx->stream));
+
+          svn_ra_serf__request_body_get_delegate(&handler->body_delegate,
+                                                 &handler->body_delegate_baton,
+                                                 ctx->svndiff);
+          handler->body_type = SVN_SVNDIFF_MIME_TYPE;
+        }
+
+      handler->header_delegate = setup_put_headers;
+      handler->header_delegate_baton = put->file;
+
+      /* Don't wait for the response.  Errors get reported by the next
+         request we wait for and close_edit() waits for all PUTs. */
+      svn_ra_serf__request_create(handler);
+      commit_ctx->pending_puts++;
+
+      /* The body now belongs to the request. */
+      ctx->svndiff = NULL;
+      ctx->put_pool = NULL;
+
+      SVN_ERR(wait_for_puts(commit_ctx, MAX_PENDING_PUTS - 1, scratch_pool));
+    }
+  else if (ctx->svndiff || put_empty_file)
     {
       svn_ra_serf__handler_t *handler;
       int expected_result;
@@ -2048,6 +2210,9 @@ close_edit(void *edit_baton,
               SVN_ERR_FS_INCORRECT_EDITOR_COMPLETION, NULL,
               _("Closing editor with directories or files open"));
 
+  /* Never MERGE with outstanding or failed PUTs. */
+  SVN_ERR(wait_for_puts(ctx, 0, pool));
+
   /* MERGE our activity */
   SVN_ERR(svn_ra_serf__run_merge(&commit_info,
                                  ctx->session,
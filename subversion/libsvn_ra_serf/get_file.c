@@ -74,6 +74,10 @@ typedef struct stream_ctx_t {
   /* If we're writing this file to a stream, this will be non-NULL. */
   svn_stream_t *result_stream;
 
+  /* If we also add the contents to the session's contents cache, this
+   * is the stream to close once we got all of them. */
+  svn_stream_t *cache_stream;
+
 } stream_ctx_t;
 
 
@@ -134,8 +138,8 @@ cancel_fetch(serf_request_t *request,
 
 
 /* Helper svn_ra_serf__get_file(). Attempts to fetch file contents
- * using SESSION->wc_callbacks->get_wc_contents() if sha1 property is
- * present in PROPS.
+ * using SESSION->wc_callbacks->get_wc_contents() or from SESSION's
+ * contents cache if sha1 property is present in PROPS.
  *
  * Sets *FOUND_P to TRUE if file contents was successfuly fetched.
  *
@@ -155,7 +159,7 @@ try_get_wc_contents(svn_boolean_t *found_p,
   /* No contents found by default. */
   *found_p = FALSE;
 
-  if (!session->wc_callbacks->get_wc_contents
+  if ((!session->wc_callbacks->get_wc_contents && !session->textcache)
       || sha1_checksum_prop == NULL)
     {
       /* Nothing to do. */
@@ -165,17 +169,24 @@ try_get_wc_contents(svn_boolean_t *found_p,
   SVN_ERR(svn_checksum_parse_hex(&checksum, svn_checksum_sha1,
                                  sha1_checksum_prop, pool));
 
-  err = session->wc_callbacks->get_wc_contents(
-          session->wc_callback_baton, &wc_stream, checksum, pool);
-
-  if (err)
+  wc_stream = NULL;
+  if (session->wc_callbacks->get_wc_contents)
     {
-      svn_error_clear(err);
+      err = session->wc_callbacks->get_wc_contents(
+              session->wc_callback_baton, &wc_stream, checksum, pool);
 
-      /* Ignore errors for now. */
-      return SVN_NO_ERROR;
+      if (err)
+        {
+          /* Ignore errors for now. */
+          svn_error_clear(err);
+          wc_stream = NULL;
+        }
     }
 
+  if (!wc_stream && session->textcache)
+    SVN_ERR(svn_ra_serf__textcache_get(&wc_stream, session->textcache,
+                                       checksum, pool));
+
   if (wc_stream)
     {
         SVN_ERR(svn_stream_copy3(wc_stream,
@@ -353,7 +364,8 @@ svn_ra_serf__get_file(svn_ra_session_t *ra_session,
 
   if (props)
       which_props = all_props;
-  else if (stream && session->wc_callbacks->get_wc_contents)
+  else if (stream && (session->wc_callbacks->get_wc_contents
+                      || session->textcache))
       which_props = type_and_checksum_props;
   else
       which_props = check_path_props;
@@ -398,6 +410,23 @@ svn_ra_serf__get_file(svn_ra_session_t *ra_session,
           stream_ctx->result_stream = stream;
           stream_ctx->using_compression = session->using_compression;
 
+          /* Keep a copy for the next one asking for these contents. */
+          if (session->textcache && fb.sha1_checksum)
+            {
+              svn_checksum_t *checksum;
+              svn_stream_t *cache_stream;
+
+              SVN_ERR(svn_checksum_parse_hex(&checksum, svn_checksum_sha1,
+                                             fb.sha1_checksum, scratch_pool));
+              SVN_ERR(svn_ra_serf__textcache_put(&cache_stream,
+                                                 session->textcache,
+                                                 checksum, scratch_pool));
+              stream_ctx->cache_stream = cache_stream;
+              stream_ctx->result_stream
+                = svn_stream_tee(svn_stream_disown(stream, scratch_pool),
+                                 cache_stream, scratch_pool);
+            }
+
           handler = svn_ra_serf__create_handler(session, scratch_pool);
 
           handler->method = "GET";
@@ -421,6 +450,9 @@ svn_ra_serf__get_file(svn_ra_session_t *ra_session,
 
           if (handler->sline.code != 200)
             return svn_error_trace(svn_ra_serf__unexpected_status(handler));
+
+          if (stream_ctx->cache_stream)
+            SVN_ERR(svn_stream_close(stream_ctx->cache_stream));
         }
     }
 
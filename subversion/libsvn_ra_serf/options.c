@@ -232,6 +232,12 @@ capabilities_headers_iterator_callback(void *baton,
              advertise this capability (Subversion 1.10 and greater). */
           session->supports_svndiff1 = TRUE;
         }
+      if (svn_cstring_match_list(SVN_DAV_NS_DAV_SVN_SVNDIFF2, vals))
+        {
+          /* Use LZ4-compressed svndiff2 format for servers that properly
+             advertise this capability. */
+          session->supports_svndiff2 = TRUE;
+        }
     }
 
   /* SVN-specific headers -- if present, server supports HTTP protocol v2 */
@@ -694,37 +700,52 @@ svn_ra_serf__has_capability(svn_ra_session_t *ra_session,
              particular repository; but if it was 'yes', we still must
              change it to 'no' iff the repository itself doesn't
              support mergeinfo. */
-          svn_mergeinfo_catalog_t ignored;
-          svn_error_t *err;
-          apr_array_header_t *paths = apr_array_make(pool, 1,
-                                                     sizeof(char *));
-          APR_ARRAY_PUSH(paths, const char *) = "";
-
-          err = svn_ra_serf__get_mergeinfo(ra_session, &ignored, paths, 0,
-                                           svn_mergeinfo_explicit,
-                                           FALSE /* include_descendants */,
-                                           pool);
+          svn_tristate_t cached;
 
-          if (err)
+          SVN_ERR(svn_ra_serf__blncache_get_mergeinfo(&cached,
+                                                      serf_sess->blncache));
+          if (cached != svn_tristate_unknown)
             {
-              if (err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
-                {
-                  svn_error_clear(err);
-                  cap_result = capability_no;
-                }
-              else if (err->apr_err == SVN_ERR_FS_NOT_FOUND)
+              cap_result = cached == svn_tristate_true ? capability_yes
+                                                       : capability_no;
+            }
+          else
+            {
+              svn_mergeinfo_catalog_t ignored;
+              svn_error_t *err;
+              apr_array_header_t *paths = apr_array_make(pool, 1,
+                                                         sizeof(char *));
+              APR_ARRAY_PUSH(paths, const char *) = "";
+
+              err = svn_ra_serf__get_mergeinfo(ra_session, &ignored, paths, 0,
+                                               svn_mergeinfo_explicit,
+                                               FALSE /* include_descendants */,
+                                               pool);
+
+              if (err)
                 {
-                  /* Mergeinfo requests use relative paths, and
-                     anyway we're in r0, so this is a likely error,
-                     but it means the repository supports mergeinfo! */
-                  svn_error_clear(err);
-                  cap_result = capability_yes;
+                  if (err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+                    {
+                      svn_error_clear(err);
+                      cap_result = capability_no;
+                    }
+                  else if (err->apr_err == SVN_ERR_FS_NOT_FOUND)
+                    {
+                      /* Mergeinfo requests use relative paths, and
+                         anyway we're in r0, so this is a likely error,
+                         but it means the repository supports mergeinfo! */
+                      svn_error_clear(err);
+                      cap_result = capability_yes;
+                    }
+                  else
+                    return svn_error_trace(err);
                 }
               else
-                return svn_error_trace(err);
+                cap_result = capability_yes;
+
+              SVN_ERR(svn_ra_serf__blncache_set_mergeinfo(
+                        serf_sess->blncache, cap_result == capability_yes));
             }
-          else
-            cap_result = capability_yes;
 
           svn_hash_sets(serf_sess->capabilities,
                         SVN_RA_CAPABILITY_MERGEINFO,  cap_result);
@@ -42,6 +42,7 @@
 #include "private/svn_editor.h"
 
 #include "blncache.h"
+#include "textcache.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -89,7 +90,7 @@ typedef struct svn_ra_serf__connection_t {
  * Note: minimum 2 connections are required for ra_serf to function
  * correctly!
  */
-#define SVN_RA_SERF__MAX_CONNECTIONS_LIMIT 8
+#define SVN_RA_SERF__MAX_CONNECTIONS_LIMIT 64
 
 /*
  * The master serf RA session.
@@ -119,6 +120,10 @@ struct svn_ra_serf__session_t {
   /* The user agent string */
   const char *useragent;
 
+  /* The ID of the trace of this session, sent with every request.  NULL
+     if the session is not being traced. */
+  const char *request_id;
+
   /* The current connection */
   svn_ra_serf__connection_t *conns[SVN_RA_SERF__MAX_CONNECTIONS_LIMIT];
   int num_conns;
@@ -140,6 +145,17 @@ struct svn_ra_serf__session_t {
      requests may come in any order */
   svn_boolean_t http20;
 
+  /* Should we offer http/2 during the TLS handshake. */
+  svn_boolean_t http20_allowed;
+
+  /* How long to keep repository metadata in the on-disk cache.
+     0 disables the cache. */
+  apr_interval_time_t metadata_cache_ttl;
+
+  /* Size limit of the on-disk file contents cache in bytes.
+     0 disables the cache. */
+  apr_off_t content_cache_size;
+
   /* Should we use Transfer-Encoding: chunked for HTTP/1.1 servers. */
   svn_boolean_t using_chunked_requests;
 
@@ -163,6 +179,9 @@ struct svn_ra_serf__session_t {
   svn_ra_progress_notify_func_t progress_func;
   void *progress_baton;
 
+  /* Total number of bytes received through CONTEXT so far. */
+  apr_off_t bytes_read;
+
   /* Callback function to handle cancellation */
   svn_cancel_func_t cancel_func;
   void *cancel_baton;
@@ -239,6 +258,9 @@ struct svn_ra_serf__session_t {
 
   svn_ra_serf__blncache_t *blncache;
 
+  /* Cache of file contents shared with other sessions, or NULL. */
+  svn_ra_serf__textcache_t *textcache;
+
   /* Trisate flag that indicates user preference for using bulk updates
      (svn_tristate_true) with all the properties and content in the
      update-report response. If svn_tristate_false, request a skelta
@@ -261,6 +283,9 @@ struct svn_ra_serf__session_t {
 
   /* Indicates whether the server can understand svndiff version 1. */
   svn_boolean_t supports_svndiff1;
+
+  /* Indicates whether the server can understand svndiff version 2. */
+  svn_boolean_t supports_svndiff2;
 };
 
 #define SVN_RA_SERF__HAVE_HTTPV2_SUPPORT(sess) ((sess)->me_resource != NULL)
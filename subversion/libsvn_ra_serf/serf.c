@@ -150,6 +150,14 @@ load_http_auth_types(apr_pool_t *pool, svn_config_t *config,
    runtime configuration variable. */
 #define DEFAULT_HTTP_TIMEOUT 600
 
+/* Whether to offer http/2 unless the 'http-http2' runtime configuration
+   variable says otherwise. */
+#ifdef SVN__SERF_TEST_HTTP2
+#define DEFAULT_HTTP2 TRUE
+#else
+#define DEFAULT_HTTP2 FALSE
+#endif
+
 static svn_error_t *
 load_config(svn_ra_serf__session_t *session,
             apr_hash_t *config_hash,
@@ -164,6 +172,8 @@ load_config(svn_ra_serf__session_t *session,
   const char *exceptions;
   apr_port_t proxy_port;
   svn_tristate_t chunked_requests;
+  apr_int64_t metadata_cache_ttl;
+  apr_int64_t content_cache_size;
 #if SERF_VERSION_AT_LEAST(1, 4, 0) && !defined(SVN_SERF_NO_LOGGING)
   apr_int64_t log_components;
   apr_int64_t log_level;
@@ -250,6 +260,22 @@ load_config(svn_ra_serf__session_t *session,
                                   SVN_CONFIG_OPTION_HTTP_CHUNKED_REQUESTS,
                                   "auto", svn_tristate_unknown));
 
+  /* Should we offer http/2. */
+  SVN_ERR(svn_config_get_bool(config, &session->http20_allowed,
+                              SVN_CONFIG_SECTION_GLOBAL,
+                              SVN_CONFIG_OPTION_HTTP_HTTP2,
+                              DEFAULT_HTTP2));
+
+  /* How long to cache repository metadata on disk. */
+  SVN_ERR(svn_config_get_int64(config, &metadata_cache_ttl,
+                               SVN_CONFIG_SECTION_GLOBAL,
+                               SVN_CONFIG_OPTION_HTTP_METADATA_CACHE_TTL, 0));
+
+  /* How many megabytes of file contents to cache on disk. */
+  SVN_ERR(svn_config_get_int64(config, &content_cache_size,
+                               SVN_CONFIG_SECTION_GLOBAL,
+                               SVN_CONFIG_OPTION_HTTP_CONTENT_CACHE_SIZE, 0));
+
 #if SERF_VERSION_AT_LEAST(1, 4, 0) && !defined(SVN_SERF_NO_LOGGING)
   SVN_ERR(svn_config_get_int64(config, &log_components,
                                SVN_CONFIG_SECTION_GLOBAL,
@@ -317,6 +343,24 @@ load_config(svn_ra_serf__session_t *session,
                                       SVN_CONFIG_OPTION_HTTP_CHUNKED_REQUESTS,
                                       "auto", chunked_requests));
 
+      /* Should we offer http/2. */
+      SVN_ERR(svn_config_get_bool(config, &session->http20_allowed,
+                                  server_group,
+                                  SVN_CONFIG_OPTION_HTTP_HTTP2,
+                                  session->http20_allowed));
+
+      /* How long to cache repository metadata on disk. */
+      SVN_ERR(svn_config_get_int64(config, &metadata_cache_ttl,
+                                   server_group,
+                                   SVN_CONFIG_OPTION_HTTP_METADATA_CACHE_TTL,
+                                   metadata_cache_ttl));
+
+      /* How many megabytes of file contents to cache on disk. */
+      SVN_ERR(svn_config_get_int64(config, &content_cache_size,
+                                   server_group,
+                                   SVN_CONFIG_OPTION_HTTP_CONTENT_CACHE_SIZE,
+                                   content_cache_size));
+
 #if SERF_VERSION_AT_LEAST(1, 4, 0) && !defined(SVN_SERF_NO_LOGGING)
       SVN_ERR(svn_config_get_int64(config, &log_components,
                                    server_group,
@@ -356,6 +400,13 @@ load_config(svn_ra_serf__session_t *session,
   if (session->max_connections < 2)
     session->max_connections = 2;
 
+  session->metadata_cache_ttl = metadata_cache_ttl > 0
+                              ? apr_time_from_sec(metadata_cache_ttl)
+                              : 0;
+  session->content_cache_size = content_cache_size > 0
+                              ? (apr_off_t)content_cache_size * 0x100000
+                              : 0;
+
   /* Parse the connection timeout value, if any. */
   session->timeout = apr_time_from_sec(DEFAULT_HTTP_TIMEOUT);
   if (timeout_str)
@@ -445,12 +496,15 @@ load_config(svn_ra_serf__session_t *session,
   return SVN_NO_ERROR;
 }
 #undef DEFAULT_HTTP_TIMEOUT
+#undef DEFAULT_HTTP2
 
 static void
 svn_ra_serf__progress(void *progress_baton, apr_off_t bytes_read,
                       apr_off_t bytes_written)
 {
-  const svn_ra_serf__session_t *serf_sess = progress_baton;
+  svn_ra_serf__session_t *serf_sess = progress_baton;
+
+  serf_sess->bytes_read = bytes_read;
   if (serf_sess->progress_func)
     {
       serf_sess->progress_func(bytes_read + bytes_written, -1,
@@ -471,6 +525,76 @@ get_user_agent_string(apr_pool_t *pool)
                       major, minor, patch);
 }
 
+/* Names of the directories below the user's config area that hold the
+   on-disk repository metadata and file contents caches. */
+#define METADATA_CACHE_SUBDIR "dav-metadata"
+#define CONTENT_CACHE_SUBDIR "dav-contents"
+
+/* Set *CACHE_DIR to the directory SUBDIR in the user's config area as
+   used by SESSION, or to NULL if there is no such area.  Allocate the
+   result in RESULT_POOL. */
+static svn_error_t *
+get_cache_dir(const char **cache_dir,
+              svn_ra_serf__session_t *session,
+              const char *subdir,
+              apr_pool_t *result_pool)
+{
+  const char *config_dir = svn_auth_get_parameter(session->auth_baton,
+                                                  SVN_AUTH_PARAM_CONFIG_DIR);
+
+  return svn_error_trace(svn_config_get_user_config_path(cache_dir,
+                                                         config_dir, subdir,
+                                                         result_pool));
+}
+
+/* Make SESSION's baseline cache persistent, if configured to.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+attach_metadata_cache(svn_ra_serf__session_t *session,
+                      apr_pool_t *scratch_pool)
+{
+  const char *cache_dir;
+
+  if (session->metadata_cache_ttl == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_cache_dir(&cache_dir, session, METADATA_CACHE_SUBDIR,
+                        scratch_pool));
+  if (!cache_dir)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(svn_ra_serf__blncache_attach(
+                           session->blncache, cache_dir,
+                           session->metadata_cache_ttl,
+                           session->session_url_str,
+                           session->repos_root_str, session->uuid,
+                           scratch_pool));
+}
+
+/* Open SESSION's file contents cache, if configured to.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+open_content_cache(svn_ra_serf__session_t *session,
+                   apr_pool_t *scratch_pool)
+{
+  const char *cache_dir;
+
+  session->textcache = NULL;
+  if (session->content_cache_size == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_cache_dir(&cache_dir, session, CONTENT_CACHE_SUBDIR,
+                        scratch_pool));
+  if (!cache_dir)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(svn_ra_serf__textcache_open(
+                           &session->textcache, cache_dir,
+                           session->content_cache_size, session->pool));
+}
+#undef METADATA_CACHE_SUBDIR
+#undef CONTENT_CACHE_SUBDIR
+
 /* Implements svn_ra__vtable_t.open_session(). */
 static svn_error_t *
 svn_ra_serf__open(svn_ra_session_t *session,
@@ -558,6 +682,8 @@ svn_ra_serf__open(svn_ra_session_t *session,
   else
     serf_sess->useragent = get_user_agent_string(result_pool);
 
+  serf_sess->request_id = svn_trace__request_id(session->trace);
+
   /* go ahead and tell serf about the connection. */
   status =
     serf_connection_create2(&serf_sess->conns[0]->conn,
@@ -602,6 +728,13 @@ svn_ra_serf__open(svn_ra_session_t *session,
                             _("Connection to '%s' failed"), session_URL);
   SVN_ERR(err);
 
+  /* Don't cache anything for URLs that redirect elsewhere. */
+  if (corrected_url == NULL || *corrected_url == NULL)
+    {
+      SVN_ERR(attach_metadata_cache(serf_sess, scratch_pool));
+      SVN_ERR(open_content_cache(serf_sess, scratch_pool));
+    }
+
   /* We have set up a useful connection (that doesn't indication a redirect).
      If we've been told there is possibly a worrisome proxy in our path to the
      server AND we switched to HTTP/1.1 (chunked requests), then probe for
@@ -638,12 +771,15 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   /* using_compression */
   /* http10 */
   /* http20 */
+  /* http20_allowed */
   /* using_chunked_requests */
   /* detect_chunking */
 
   if (new_sess->useragent)
     new_sess->useragent = apr_pstrdup(result_pool, new_sess->useragent);
 
+  new_sess->request_id = svn_trace__request_id(new_session->trace);
+
   if (new_sess->vcc_url)
     new_sess->vcc_url = apr_pstrdup(result_pool, new_sess->vcc_url);
 
@@ -657,6 +793,8 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   /* progress_func */
   /* progress_baton */
 
+  new_sess->bytes_read = 0;
+
   /* cancel_func */
   /* cancel_baton */
 
@@ -752,6 +890,7 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   /* svn_boolean_t supports_inline_props */
   /* supports_rev_rsrc_replay */
   /* supports_svndiff1 */
+  /* supports_svndiff2 */
 
   new_sess->context = serf_context_create(result_pool);
 
@@ -783,6 +922,9 @@ ra_serf_dup_session(svn_ra_session_t *new_session,
   new_sess->num_conns = 1;
   new_sess->cur_conn = 0;
 
+  SVN_ERR(attach_metadata_cache(new_sess, scratch_pool));
+  SVN_ERR(open_content_cache(new_sess, scratch_pool));
+
   new_session->priv = new_sess;
 
   return SVN_NO_ERROR;
@@ -1056,6 +1198,8 @@ static const svn_ra__vtable_t serf_vtable = {
   svn_ra_serf__get_inherited_props,
   NULL /* set_svn_ra_open */,
   NULL /* svn_ra_list */,
+  NULL /* check_paths */,
+  NULL /* blame */,
   svn_ra_serf__register_editor_shim_callbacks,
   NULL /* commit_ev2 */,
   NULL /* replay_range_ev2 */
@@ -0,0 +1,342 @@
+/*
+ * textcache.c: Machine-wide cache of file contents, keyed by SHA-1.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+
+#include "svn_hash.h"
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+
+#include "private/svn_sorts_private.h"
+
+#include "textcache.h"
+
+/* The cache directory contains one sub-directory per leading two hex
+ * digits of the SHA-1, like the working copy pristine store.  Files that
+ * are still being written live in the cache directory itself.
+ */
+struct svn_ra_serf__textcache_t
+{
+  /* Root directory of the cache. */
+  const char *cache_dir;
+
+  /* Upper limit for the total size of all entries. */
+  apr_off_t max_size;
+
+  /* Number of bytes we added to the cache so far. */
+  apr_off_t added;
+
+  /* The pool this structure has been allocated in. */
+  apr_pool_t *pool;
+};
+
+/* Return the path of the cache entry for SHA1_CHECKSUM in TEXTCACHE.
+ * Allocate the result in POOL.
+ */
+static const char *
+entry_path(svn_ra_serf__textcache_t *textcache,
+           const svn_checksum_t *sha1_checksum,
+           apr_pool_t *pool)
+{
+  const char *hexdigest = svn_checksum_to_cstring(sha1_checksum, pool);
+
+  return svn_dirent_join_many(pool, textcache->cache_dir,
+                              apr_pstrmemdup(pool, hexdigest, 2),
+                              hexdigest, SVN_VA_NULL);
+}
+
+/* A cache entry as seen by shrink_cache().
+ */
+typedef struct entry_t
+{
+  const char *path;
+  apr_time_t mtime;
+  svn_filesize_t size;
+} entry_t;
+
+/* Sort function for entry_t *, sorting the least recently used first.
+ */
+static int
+compare_entries(const void *lhs, const void *rhs)
+{
+  const entry_t *lhs_entry = *(const entry_t * const *)lhs;
+  const entry_t *rhs_entry = *(const entry_t * const *)rhs;
+
+  if (lhs_entry->mtime == rhs_entry->mtime)
+    return 0;
+
+  return lhs_entry->mtime < rhs_entry->mtime ? -1 : 1;
+}
+
+/* Remove the least recently used entries from TEXTCACHE until its total
+ * size is within its limit.
+ */
+static svn_error_t *
+shrink_cache(svn_ra_serf__textcache_t *textcache,
+             apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *entries
+    = apr_array_make(scratch_pool, 0, sizeof(entry_t *));
+  svn_filesize_t total = 0;
+  apr_hash_t *subdirs;
+  apr_hash_index_t *hi;
+  int i;
+
+  SVN_ERR(svn_io_get_dirents3(&subdirs, textcache->cache_dir, TRUE,
+                              scratch_pool, scratch_pool));
+
+  for (hi = apr_hash_first(scratch_pool, subdirs); hi; hi = apr_hash_next(hi))
+    {
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      const char *subdir;
+      apr_hash_t *files;
+      apr_hash_index_t *fi;
+
+      if (dirent->kind != svn_node_dir)
+        continue;
+
+      subdir = svn_dirent_join(textcache->cache_dir, apr_hash_this_key(hi),
+                               scratch_pool);
+      SVN_ERR(svn_io_get_dirents3(&files, subdir, FALSE,
+                                  scratch_pool, scratch_pool));
+
+      for (fi = apr_hash_first(scratch_pool, files);
+           fi;
+           fi = apr_hash_next(fi))
+        {
+          entry_t *entry;
+
+          dirent = apr_hash_this_val(fi);
+          if (dirent->kind != svn_node_file)
+            continue;
+
+          entry = apr_palloc(scratch_pool, sizeof(*entry));
+          entry->path = svn_dirent_join(subdir, apr_hash_this_key(fi),
+                                        scratch_pool);
+          entry->mtime = dirent->mtime;
+          entry->size = dirent->filesize;
+
+          total += entry->size;
+          APR_ARRAY_PUSH(entries, entry_t *) = entry;
+        }
+    }
+
+  if (total <= textcache->max_size)
+    return SVN_NO_ERROR;
+
+  svn_sort__array(entries, compare_entries);
+  for (i = 0; i < entries->nelts && total > textcache->max_size; ++i)
+    {
+      const entry_t *entry = APR_ARRAY_IDX(entries, i, const entry_t *);
+
+      SVN_ERR(svn_io_remove_file2(entry->path, TRUE, scratch_pool));
+      total -= entry->size;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Pool pre-cleanup function enforcing the size limit of the
+ * svn_ra_serf__textcache_t given as BATON, if we added anything to it.
+ */
+static apr_status_t
+shrink_on_cleanup(void *baton)
+{
+  svn_ra_serf__textcache_t *textcache = baton;
+
+  if (textcache->added)
+    {
+      apr_pool_t *scratch_pool = svn_pool_create(textcache->pool);
+
+      /* Other processes may be removing entries at the same time.
+         The next one to add something will catch up. */
+      svn_error_clear(shrink_cache(textcache, scratch_pool));
+      svn_pool_destroy(scratch_pool);
+    }
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+svn_ra_serf__textcache_open(svn_ra_serf__textcache_t **textcache_p,
+                            const char *cache_dir,
+                            apr_off_t max_size,
+                            apr_pool_t *result_pool)
+{
+  svn_ra_serf__textcache_t *textcache
+    = apr_pcalloc(result_pool, sizeof(*textcache));
+
+  textcache->cache_dir = apr_pstrdup(result_pool, cache_dir);
+  textcache->max_size = max_size;
+  textcache->pool = result_pool;
+
+  apr_pool_pre_cleanup_register(result_pool, textcache, shrink_on_cleanup);
+
+  *textcache_p = textcache;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_serf__textcache_get(svn_stream_t **contents,
+                           svn_ra_serf__textcache_t *textcache,
+                           const svn_checksum_t *sha1_checksum,
+                           apr_pool_t *result_pool)
+{
+  const char *path = entry_path(textcache, sha1_checksum, result_pool);
+  svn_error_t *err;
+
+  err = svn_stream_open_readonly(contents, path, result_pool, result_pool);
+  if (err)
+    {
+      /* Not cached, evicted meanwhile or otherwise unusable. */
+      svn_error_clear(err);
+      *contents = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  /* Entries are removed in LRU order. */
+  svn_error_clear(svn_io_set_file_affected_time(apr_time_now(), path,
+                                                result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for the stream returned by svn_ra_serf__textcache_put().
+ */
+typedef struct put_baton_t
+{
+  svn_ra_serf__textcache_t *textcache;
+
+  /* Checksum of the expected contents and that of the data so far. */
+  const svn_checksum_t *sha1_checksum;
+  svn_checksum_ctx_t *checksum_ctx;
+
+  /* Temporary file receiving the data. */
+  svn_stream_t *tmp_stream;
+  const char *tmp_path;
+
+  /* Number of bytes written. */
+  apr_off_t size;
+
+  /* Set when we failed to write the temporary file. */
+  svn_boolean_t failed;
+
+  apr_pool_t *pool;
+} put_baton_t;
+
+/* Implements svn_write_fn_t for svn_ra_serf__textcache_put().  Don't
+ * report errors; just don't add the entry then.
+ */
+static svn_error_t *
+put_write(void *baton,
+          const char *data,
+          apr_size_t *len)
+{
+  put_baton_t *b = baton;
+  apr_size_t written = *len;
+  svn_error_t *err;
+
+  if (b->failed)
+    return SVN_NO_ERROR;
+
+  err = svn_checksum_update(b->checksum_ctx, data, written);
+  if (!err)
+    err = svn_stream_write(b->tmp_stream, data, &written);
+
+  b->size += written;
+  b->failed = (err != NULL);
+  svn_error_clear(err);
+
+  return SVN_NO_ERROR;
+}
+
+/* Move the temporary file of B into place, if its contents are complete.
+ */
+static svn_error_t *
+add_entry(put_baton_t *b)
+{
+  svn_checksum_t *checksum;
+  const char *path;
+
+  SVN_ERR(svn_stream_close(b->tmp_stream));
+  SVN_ERR(svn_checksum_final(&checksum, b->checksum_ctx, b->pool));
+  if (!svn_checksum_match(checksum, b->sha1_checksum))
+    return SVN_NO_ERROR;
+
+  path = entry_path(b->textcache, b->sha1_checksum, b->pool);
+  SVN_ERR(svn_io_make_dir_recursively(svn_dirent_dirname(path, b->pool),
+                                      b->pool));
+  SVN_ERR(svn_io_file_rename2(b->tmp_path, path, FALSE, b->pool));
+
+  b->textcache->added += b->size;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t for svn_ra_serf__textcache_put().
+ */
+static svn_error_t *
+put_close(void *baton)
+{
+  put_baton_t *b = baton;
+
+  /* The temporary file gets removed by its pool cleanup, unless we
+     renamed it. */
+  if (!b->failed)
+    svn_error_clear(add_entry(b));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_ra_serf__textcache_put(svn_stream_t **contents,
+                           svn_ra_serf__textcache_t *textcache,
+                           const svn_checksum_t *sha1_checksum,
+                           apr_pool_t *result_pool)
+{
+  put_baton_t *b = apr_pcalloc(result_pool, sizeof(*b));
+  svn_error_t *err;
+
+  b->textcache = textcache;
+  b->sha1_checksum = svn_checksum_dup(sha1_checksum, result_pool);
+  b->checksum_ctx = svn_checksum_ctx_create(svn_checksum_sha1, result_pool);
+  b->pool = result_pool;
+
+  err = svn_io_make_dir_recursively(textcache->cache_dir, result_pool);
+  if (!err)
+    err = svn_stream_open_unique(&b->tmp_stream, &b->tmp_path,
+                                 textcache->cache_dir,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 result_pool, result_pool);
+
+  /* Without a temporary file, we simply won't add anything. */
+  b->failed = (err != NULL);
+  svn_error_clear(err);
+
+  *contents = svn_stream_create(b, result_pool);
+  svn_stream_set_write(*contents, put_write);
+  svn_stream_set_close(*contents, put_close);
+
+  return SVN_NO_ERROR;
+}
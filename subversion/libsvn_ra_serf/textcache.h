@@ -0,0 +1,88 @@
+/*
+ * textcache.h: Machine-wide cache of file contents, keyed by SHA-1.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_RA_SERF_TEXTCACHE_H
+#define SVN_LIBSVN_RA_SERF_TEXTCACHE_H
+
+#include <apr_pools.h>
+
+#include "svn_types.h"
+#include "svn_checksum.h"
+#include "svn_io.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* File contents cache.  It lives in a directory shared by all sessions
+ * and processes of the user and complements the pristine store of the
+ * working copy at hand: a checkout of a tree that has been fetched
+ * before, e.g. into another working copy, doesn't need to download the
+ * same file contents again.
+ *
+ * Entries are named by the SHA-1 of their contents, so they never become
+ * stale.  Once the total size of the cache exceeds its limit, the least
+ * recently used entries get removed.
+ */
+typedef struct svn_ra_serf__textcache_t svn_ra_serf__textcache_t;
+
+/* Set *TEXTCACHE_P to a cache of file contents stored in CACHE_DIR.
+ * When RESULT_POOL gets cleaned up, remove old entries until the cache
+ * is no larger than MAX_SIZE bytes.
+ */
+svn_error_t *
+svn_ra_serf__textcache_open(svn_ra_serf__textcache_t **textcache_p,
+                            const char *cache_dir,
+                            apr_off_t max_size,
+                            apr_pool_t *result_pool);
+
+/* Set *CONTENTS to a readable stream of the file contents with the
+ * given SHA1_CHECKSUM, or to NULL if TEXTCACHE doesn't have them.
+ * Allocate the stream in RESULT_POOL.
+ */
+svn_error_t *
+svn_ra_serf__textcache_get(svn_stream_t **contents,
+                           svn_ra_serf__textcache_t *textcache,
+                           const svn_checksum_t *sha1_checksum,
+                           apr_pool_t *result_pool);
+
+/* Set *CONTENTS to a writable stream that adds the data written to it
+ * to TEXTCACHE as the file contents with SHA1_CHECKSUM.  The entry will
+ * only be added once the stream gets closed and the data actually matches
+ * the checksum.  Allocate the stream in RESULT_POOL; if that pool gets
+ * cleaned up before the stream has been closed, nothing will be added.
+ *
+ * The cache is merely an optimization.  The stream never returns errors;
+ * if the data cannot be stored, it will simply not be added.
+ */
+svn_error_t *
+svn_ra_serf__textcache_put(svn_stream_t **contents,
+                           svn_ra_serf__textcache_t *textcache,
+                           const svn_checksum_t *sha1_checksum,
+                           apr_pool_t *result_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_RA_SERF_TEXTCACHE_H */
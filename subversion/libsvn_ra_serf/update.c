@@ -45,6 +45,7 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_fspath.h"
 #include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
 
 #include "ra_serf.h"
 #include "../libsvn_ra/ra_loader.h"
@@ -251,7 +252,9 @@ static const svn_ra_serf__xml_transition_t update_ttable[] = {
    can make the measurements quite imprecise.
 
    We measure outstanding requests as the sum of NUM_ACTIVE_FETCHES and
-   NUM_ACTIVE_PROPFINDS in the report_context_t structure.  */
+   NUM_ACTIVE_PROPFINDS in the report_context_t structure.  With many
+   connections, the resume threshold grows with their number; see
+   max_active_requests().  */
 #define REQUEST_COUNT_TO_PAUSE 50
 #define REQUEST_COUNT_TO_RESUME 40
 
@@ -260,6 +263,11 @@ static const svn_ra_serf__xml_transition_t update_ttable[] = {
 
 #define PARSE_CHUNK_SIZE 8000 /* Copied from xml.c ### Needs tuning */
 
+/* Expat hands us the base64 encoded txdelta one line at a time.  Collect
+   up to this many bytes before pushing them through the base64 decoder
+   and the svndiff parser, so that both work on large blocks.  */
+#define TXDELTA_BUFFER_SIZE 0x10000
+
 /* Forward-declare our report context. */
 typedef struct report_context_t report_context_t;
 typedef struct body_create_baton_t body_create_baton_t;
@@ -354,6 +362,8 @@ typedef struct file_baton_t
 
   svn_stream_t *txdelta_stream;         /* Stream that feeds windows when
                                            written to within txdelta*/
+  svn_stringbuf_t *txdelta_buf;         /* Encoded data not yet written
+                                           to TXDELTA_STREAM */
 } file_baton_t;
 
 /*
@@ -445,6 +455,15 @@ struct report_context_t {
   /* number of pending PROPFIND requests */
   unsigned int num_active_propfinds;
 
+  /* Adaptive connection scaling: the session's received byte count and
+     the time when the current measurement started, the throughput in
+     bytes per second measured before and whether the last additional
+     connection failed to pay off. */
+  apr_off_t sample_bytes;
+  apr_time_t sample_start;
+  apr_off_t last_rate;
+  svn_boolean_t scaling_stopped;
+
   /* Are we done parsing the REPORT response? */
   svn_boolean_t done;
 
@@ -548,17 +567,99 @@ create_file_baton(file_baton_t **new_file,
  *  opened. */
 #define REQS_PER_CONN 8
 
-/** This function creates a new connection for this serf session, but only
- * if the number of NUM_ACTIVE_REQS > REQS_PER_CONN or if there currently is
- * only one main connection open.
+/** Time interval over which throughput gets measured to decide whether
+ *  yet another connection would help. */
+#define SCALING_INTERVAL apr_time_from_msec(500)
+
+/** Minimum relative throughput gain, in percent, that an additional
+ *  connection must have brought before we try yet another one. */
+#define SCALING_MIN_GAIN 10
+
+/** Number of outstanding requests to multiplex over a http/2 connection.
+ *  Servers typically allow 100 concurrent streams. */
+#define HTTP2_ACTIVE_REQUESTS 100
+
+/* Return the number of outstanding requests below which we continue
+ * parsing the REPORT response for CTX.  Keep all connections busy.
+ */
+static unsigned int
+max_active_requests(const report_context_t *ctx)
+{
+  unsigned int limit = (unsigned int)ctx->sess->num_conns * REQS_PER_CONN;
+
+  if (ctx->sess->http20)
+    return HTTP2_ACTIVE_REQUESTS;
+
+  return limit > REQUEST_COUNT_TO_RESUME ? limit : REQUEST_COUNT_TO_RESUME;
+}
+
+/* Return TRUE if the throughput of CTX's session kept improving with
+ * the number of connections and there is enough work in NUM_ACTIVE_REQS
+ * outstanding requests to keep another connection busy.
+ *
+ * High-latency links need more parallel connections than the request
+ * count alone would suggest.  Therefore, sample the throughput over
+ * SCALING_INTERVAL and keep adding connections as long as every one
+ * of them increases it by at least SCALING_MIN_GAIN percent.
+ */
+static svn_boolean_t
+throughput_scales(report_context_t *ctx, int num_active_reqs)
+{
+  svn_ra_serf__session_t *sess = ctx->sess;
+  apr_time_t now;
+  apr_off_t rate;
+
+  if (ctx->scaling_stopped || num_active_reqs <= sess->num_conns)
+    return FALSE;
+
+  now = apr_time_now();
+  if (ctx->sample_start == 0)
+    {
+      ctx->sample_start = now;
+      ctx->sample_bytes = sess->bytes_read;
+      return FALSE;
+    }
+
+  if (now - ctx->sample_start < SCALING_INTERVAL)
+    return FALSE;
+
+  rate = (sess->bytes_read - ctx->sample_bytes) * APR_USEC_PER_SEC
+       / (now - ctx->sample_start);
+  ctx->sample_start = now;
+  ctx->sample_bytes = sess->bytes_read;
+
+  if (rate <= ctx->last_rate + ctx->last_rate * SCALING_MIN_GAIN / 100)
+    {
+      ctx->scaling_stopped = TRUE;
+      return FALSE;
+    }
+
+  ctx->last_rate = rate;
+  return TRUE;
+}
+
+/** This function creates a new connection for the session of CTX, but only
+ * if the number of NUM_ACTIVE_REQS > REQS_PER_CONN, if there currently is
+ * only one main connection open or if more connections increase the
+ * throughput.
  */
 static svn_error_t *
-open_connection_if_needed(svn_ra_serf__session_t *sess, int num_active_reqs)
+open_connection_if_needed(report_context_t *ctx, int num_active_reqs)
 {
+  svn_ra_serf__session_t *sess = ctx->sess;
+
+  /* http/2 multiplexes all requests, including the REPORT itself, over
+   * a single connection.  More connections would only add overhead.
+   * See get_best_connection() for why we stick to 2 connections if that
+   * is the configured maximum. */
+  if (sess->http20 && sess->max_connections > 2)
+    return SVN_NO_ERROR;
+
   /* For each REQS_PER_CONN outstanding requests open a new connection, with
    * a minimum of 1 extra connection. */
   if (sess->num_conns == 1 ||
-      ((num_active_reqs / REQS_PER_CONN) > sess->num_conns))
+      ((num_active_reqs / REQS_PER_CONN) > sess->num_conns) ||
+      throughput_scales(ctx, num_active_reqs))
     {
       int cur = sess->num_conns;
       apr_status_t status;
@@ -608,6 +709,10 @@ get_best_connection(report_context_t *ctx)
   if (ctx->report_received && (ctx->sess->max_connections > 2))
     first_conn = 0;
 
+  /* With http/2, the REPORT response does not block other requests. */
+  if (ctx->sess->http20 && (ctx->sess->max_connections > 2))
+    first_conn = 0;
+
   /* If there's only one available auxiliary connection to use, don't bother
      doing all the cur_conn math -- just return that one connection.  */
   if (ctx->sess->num_conns - first_conn == 1)
@@ -797,7 +902,13 @@ headers_fetch(serf_bucket_t *headers,
     {
       serf_bucket_headers_setn(headers, SVN_DAV_DELTA_BASE_HEADER,
                                fetch_ctx->delta_base);
-      if (fetch_ctx->using_compression)
+      if (fetch_ctx->using_compression && svn__lz4_supported())
+        {
+          serf_bucket_headers_setn(headers, "Accept-Encoding",
+                                   "svndiff2;q=0.95,svndiff1;q=0.9,"
+                                   "svndiff;q=0.8");
+        }
+      else if (fetch_ctx->using_compression)
         {
           serf_bucket_headers_setn(headers, "Accept-Encoding",
                                    "svndiff1;q=0.9,svndiff;q=0.8");
@@ -951,6 +1062,65 @@ close_file(file_baton_t *file,
   return SVN_NO_ERROR;
 }
 
+/* Baton for cache_window_handler(). */
+typedef struct cache_window_baton_t
+{
+  /* The window handler we are wrapping. */
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+
+  /* Reconstructs the full text into the textcache.  NULL once it failed. */
+  svn_txdelta_window_handler_t cache_handler;
+  void *cache_handler_baton;
+} cache_window_baton_t;
+
+/* Implements svn_txdelta_window_handler_t.  Pass WINDOW on to the
+   wrapped handler as well as to the textcache in BATON. */
+static svn_error_t *
+cache_window_handler(svn_txdelta_window_t *window,
+                     void *baton)
+{
+  cache_window_baton_t *b = baton;
+
+  if (b->cache_handler)
+    {
+      svn_error_t *err = b->cache_handler(window, b->cache_handler_baton);
+
+      /* The cache is merely an optimization. */
+      if (err)
+        {
+          svn_error_clear(err);
+          b->cache_handler = NULL;
+        }
+    }
+
+  return svn_error_trace(b->handler(window, b->handler_baton));
+}
+
+/* Make FILE's txdelta window handler also add the full text to TEXTCACHE.
+   The windows must be relative to the empty source. */
+static svn_error_t *
+tee_to_textcache(file_baton_t *file,
+                 svn_ra_serf__textcache_t *textcache)
+{
+  cache_window_baton_t *b = apr_pcalloc(file->pool, sizeof(*b));
+  svn_stream_t *contents;
+
+  SVN_ERR(svn_ra_serf__textcache_put(&contents, textcache,
+                                     file->final_sha1_checksum,
+                                     file->pool));
+
+  b->handler = file->txdelta;
+  b->handler_baton = file->txdelta_baton;
+  svn_txdelta_apply(svn_stream_empty(file->pool), contents, NULL, NULL,
+                    file->pool, &b->cache_handler, &b->cache_handler_baton);
+
+  file->txdelta = cache_window_handler;
+  file->txdelta_baton = b;
+
+  return SVN_NO_ERROR;
+}
+
 /* Implements svn_ra_serf__response_handler_t */
 static svn_error_t *
 handle_fetch(serf_request_t *request,
@@ -1227,7 +1397,7 @@ fetch_for_file(file_baton_t *file,
 
   /* Open extra connections if we have enough requests to send. */
   if (ctx->sess->num_conns < ctx->sess->max_connections)
-    SVN_ERR(open_connection_if_needed(ctx->sess, ctx->num_active_fetches +
+    SVN_ERR(open_connection_if_needed(ctx, ctx->num_active_fetches +
                                                  ctx->num_active_propfinds));
 
   /* What connection should we go on? */
@@ -1249,17 +1419,26 @@ fetch_for_file(file_baton_t *file,
 
       if (file->fetch_file
           && file->final_sha1_checksum
-          && ctx->sess->wc_callbacks->get_wc_contents)
+          && (ctx->sess->wc_callbacks->get_wc_contents
+              || ctx->sess->textcache))
         {
-          svn_error_t *err;
+          svn_error_t *err = SVN_NO_ERROR;
           svn_stream_t *cached_contents = NULL;
 
-          err = ctx->sess->wc_callbacks->get_wc_contents(
+          if (ctx->sess->wc_callbacks->get_wc_contents)
+            err = ctx->sess->wc_callbacks->get_wc_contents(
                                                 ctx->sess->wc_callback_baton,
                                                 &cached_contents,
                                                 file->final_sha1_checksum,
                                                 scratch_pool);
 
+          /* Maybe another working copy fetched the same contents. */
+          if (!err && !cached_contents && ctx->sess->textcache)
+            err = svn_ra_serf__textcache_get(&cached_contents,
+                                             ctx->sess->textcache,
+                                             file->final_sha1_checksum,
+                                             scratch_pool);
+
           if (err || !cached_contents)
             svn_error_clear(err); /* ### Can we return some/most errors? */
           else
@@ -1334,6 +1513,13 @@ fetch_for_file(file_baton_t *file,
                                         : NULL;
             }
 
+          /* Without a delta base, we receive the full text and can keep
+             a copy of it for other working copies. */
+          if (!fetch_ctx->delta_base
+              && ctx->sess->textcache
+              && file->final_sha1_checksum)
+            SVN_ERR(tee_to_textcache(file, ctx->sess->textcache));
+
           handler = svn_ra_serf__create_handler(ctx->sess, file->pool);
 
           handler->method = "GET";
@@ -1455,7 +1641,7 @@ fetch_for_dir(dir_baton_t *dir,
 
   /* Open extra connections if we have enough requests to send. */
   if (ctx->sess->num_conns < ctx->sess->max_connections)
-    SVN_ERR(open_connection_if_needed(ctx->sess, ctx->num_active_fetches +
+    SVN_ERR(open_connection_if_needed(ctx, ctx->num_active_fetches +
                                                  ctx->num_active_propfinds));
 
   /* What connection should we go on? */
@@ -1676,6 +1862,8 @@ update_opened(svn_ra_serf__xml_estate_t *xes,
                                                   file->pool);
 
               file->txdelta_stream = svn_base64_decode(decoder, file->pool);
+              file->txdelta_buf = svn_stringbuf_create_ensure(
+                                        TXDELTA_BUFFER_SIZE, file->pool);
             }
         }
         break;
@@ -1707,6 +1895,23 @@ update_opened(svn_ra_serf__xml_estate_t *xes,
 
 
 
+/* Write the encoded txdelta data collected in FILE's buffer to its
+   txdelta stream. */
+static svn_error_t *
+flush_txdelta_buf(file_baton_t *file)
+{
+  apr_size_t len = file->txdelta_buf->len;
+
+  if (len)
+    {
+      SVN_ERR(svn_stream_write(file->txdelta_stream,
+                               file->txdelta_buf->data, &len));
+      svn_stringbuf_setempty(file->txdelta_buf);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Conforms to svn_ra_serf__xml_closed_t  */
 static svn_error_t *
 update_closed(svn_ra_serf__xml_estate_t *xes,
@@ -1968,6 +2173,7 @@ update_closed(svn_ra_serf__xml_estate_t *xes,
 
           if (file->txdelta_stream)
             {
+              SVN_ERR(flush_txdelta_buf(file));
               SVN_ERR(svn_stream_close(file->txdelta_stream));
               file->txdelta_stream = NULL;
             }
@@ -2046,7 +2252,15 @@ update_cdata(svn_ra_serf__xml_estate_t *xes,
   if (current_state == TXDELTA && ctx->cur_file
       && ctx->cur_file->txdelta_stream)
     {
-      SVN_ERR(svn_stream_write(ctx->cur_file->txdelta_stream, data, &len));
+      file_baton_t *file = ctx->cur_file;
+
+      if (file->txdelta_buf->len + len > TXDELTA_BUFFER_SIZE)
+        SVN_ERR(flush_txdelta_buf(file));
+
+      if (len >= TXDELTA_BUFFER_SIZE)
+        SVN_ERR(svn_stream_write(file->txdelta_stream, data, &len));
+      else
+        svn_stringbuf_appendbytes(file->txdelta_buf, data, len);
     }
 
   return SVN_NO_ERROR;
@@ -2178,7 +2392,13 @@ setup_update_report_headers(serf_bucket_t *headers,
 {
   report_context_t *report = baton;
 
-  if (report->sess->using_compression)
+  if (report->sess->using_compression && svn__lz4_supported())
+    {
+      serf_bucket_headers_setn(headers, "Accept-Encoding",
+                               "gzip,svndiff2;q=0.95,svndiff1;q=0.9,"
+                               "svndiff;q=0.8");
+    }
+  else if (report->sess->using_compression)
     {
       serf_bucket_headers_setn(headers, "Accept-Encoding",
                                "gzip,svndiff1;q=0.9,svndiff;q=0.8");
@@ -2271,7 +2491,7 @@ update_delay_handler(serf_request_t *request,
         }
 
       while ((udb->report->num_active_fetches + udb->report->num_active_propfinds)
-                 < REQUEST_COUNT_TO_RESUME)
+                 < max_active_requests(udb->report))
         {
           const char *data;
           apr_size_t len;
@@ -2355,7 +2575,7 @@ process_pending(update_delay_baton_t *udb,
   serf_bucket_alloc_t *alloc = NULL;
 
   while ((udb->report->num_active_fetches + udb->report->num_active_propfinds)
-            < REQUEST_COUNT_TO_RESUME)
+            < max_active_requests(udb->report))
     {
       const char *data;
       apr_size_t len;
@@ -2427,7 +2647,7 @@ process_editor_report(report_context_t *ctx,
   handler->response_baton = ud;
 
   /* Open the first extra connection. */
-  SVN_ERR(open_connection_if_needed(sess, 0));
+  SVN_ERR(open_connection_if_needed(ctx, 0));
 
   sess->cur_conn = 1;
 
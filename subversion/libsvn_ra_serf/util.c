@@ -480,7 +480,7 @@ load_authorities(svn_ra_serf__connection_t *conn, const char *authorities,
   return SVN_NO_ERROR;
 }
 
-#if SERF_VERSION_AT_LEAST(1, 4, 0) && defined(SVN__SERF_TEST_HTTP2)
+#if SERF_VERSION_AT_LEAST(1, 4, 0)
 /* Implements serf_ssl_protocol_result_cb_t */
 static apr_status_t
 conn_negotiate_protocol(void *data,
@@ -557,10 +557,12 @@ conn_setup(apr_socket_t *sock,
               SVN_ERR(load_authorities(conn, conn->session->ssl_authorities,
                                        conn->session->pool));
             }
-#if SERF_VERSION_AT_LEAST(1, 4, 0) && defined(SVN__SERF_TEST_HTTP2)
-          if (APR_SUCCESS ==
-                serf_ssl_negotiate_protocol(conn->ssl_context, "h2,http/1.1",
-                                            conn_negotiate_protocol, conn))
+#if SERF_VERSION_AT_LEAST(1, 4, 0)
+          if (conn->session->http20_allowed
+              && APR_SUCCESS ==
+                   serf_ssl_negotiate_protocol(conn->ssl_context,
+                                               "h2,http/1.1",
+                                               conn_negotiate_protocol, conn))
             {
                 serf_connection_set_framing_type(
                             conn->conn,
@@ -862,6 +864,12 @@ setup_serf_req(serf_request_t *request,
      the header values.  */
   serf_bucket_headers_setn(*hdrs_bkt, "User-Agent", session->useragent);
 
+  if (session->request_id)
+    {
+      serf_bucket_headers_setn(*hdrs_bkt, SVN_DAV_REQUEST_ID_HEADER,
+                               session->request_id);
+    }
+
   if (content_type)
     {
       serf_bucket_headers_setn(*hdrs_bkt, "Content-Type", content_type);
@@ -1681,6 +1689,37 @@ svn_ra_serf__discover_vcc(const char **vcc_url,
       return SVN_NO_ERROR;
     }
 
+  /* An earlier session may have found it for us. */
+  if (!session->vcc_url)
+    {
+      const char *cached_root;
+      const char *cached_uuid;
+      const char *cached_vcc;
+
+      SVN_ERR(svn_ra_serf__blncache_get_repos_info(&cached_root,
+                                                   &cached_uuid,
+                                                   &cached_vcc,
+                                                   session->blncache,
+                                                   session->pool));
+      if (cached_root && cached_uuid && cached_vcc
+          && (!session->repos_root_str
+              || strcmp(session->repos_root_str, cached_root) == 0))
+        {
+          if (!session->repos_root_str)
+            {
+              SVN_ERR(svn_ra_serf__uri_parse(&session->repos_root,
+                                             cached_root, session->pool));
+              session->repos_root_str = cached_root;
+            }
+          if (!session->uuid)
+            session->uuid = cached_uuid;
+
+          session->vcc_url = cached_vcc;
+          *vcc_url = session->vcc_url;
+          return SVN_NO_ERROR;
+        }
+    }
+
   path = session->session_url.path;
   *vcc_url = NULL;
   uuid = NULL;
@@ -1768,6 +1807,12 @@ svn_ra_serf__discover_vcc(const char **vcc_url,
       session->uuid = apr_pstrdup(session->pool, uuid);
     }
 
+  SVN_ERR(svn_ra_serf__blncache_set_repos_info(session->blncache,
+                                               session->repos_root_str,
+                                               session->uuid,
+                                               session->vcc_url,
+                                               scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
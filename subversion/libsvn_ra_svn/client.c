@@ -628,6 +628,7 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
   apr_uint64_t minver, maxver;
   svn_ra_svn__list_t *mechlist, *server_caplist, *repos_caplist;
   const char *client_string = NULL;
+  svn_boolean_t lz4_stream;
   apr_pool_t *pool = result_pool;
   svn_ra_svn__parent_t *parent;
 
@@ -742,11 +743,16 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
     return svn_error_create(SVN_ERR_RA_SVN_BAD_VERSION, NULL,
                             _("Server does not support edit pipelining"));
 
+  /* Compress the whole connection if both sides want compression. */
+  lz4_stream = (svn_ra_svn_compression_level(conn) > 0
+                && svn__lz4_supported()
+                && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_LZ4_STREAM));
+
   /* In protocol version 2, we send back our protocol version, our
    * capability list, and the URL, and subsequently there is an auth
    * request. */
   /* Client-side capabilities list: */
-  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwww)cc(?c)",
+  SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "n(wwwwww?w?w)cc(?c)",
                                   (apr_uint64_t) 2,
                                   SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                   SVN_RA_SVN_CAP_SVNDIFF1,
@@ -754,6 +760,12 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
                                   SVN_RA_SVN_CAP_DEPTH,
                                   SVN_RA_SVN_CAP_MERGEINFO,
                                   SVN_RA_SVN_CAP_LOG_REVPROPS,
+                                  svn__lz4_supported()
+                                    ? SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED
+                                    : NULL,
+                                  lz4_stream
+                                    ? SVN_RA_SVN_CAP_LZ4_STREAM
+                                    : NULL,
                                   url,
                                   SVN_RA_SVN__DEFAULT_USERAGENT,
                                   client_string));
@@ -762,6 +774,11 @@ static svn_error_t *open_session(svn_ra_svn__session_baton_t **sess_p,
   /* This is where the security layer would go into effect if we
    * supported security layers, which is a ways off. */
 
+  /* The server switches to compressed framing right after the
+   * authentication succeeded, so must we. */
+  if (lz4_stream)
+    SVN_ERR(svn_ra_svn__enable_lz4_stream(conn, pool));
+
   /* Read the repository's uuid and root URL, and perhaps learn more
      capabilities that weren't available before now. */
   SVN_ERR(svn_ra_svn__read_cmd_response(conn, pool, "c?c?l", &conn->uuid,
@@ -811,6 +828,27 @@ ra_svn_get_schemes(apr_pool_t *pool)
 
 
 
+/* If TRACE is not NULL and the server supports it, tell the server at the
+   other end of SESS to record its work under the request ID of TRACE.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+send_request_id(svn_ra_svn__session_baton_t *sess,
+                const svn_trace__t *trace,
+                apr_pool_t *scratch_pool)
+{
+  if (!trace || !svn_ra_svn_has_capability(sess->conn,
+                                           SVN_RA_SVN_CAP_REQUEST_ID))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_ra_svn__write_tuple(sess->conn, scratch_pool, "w(c)",
+                                  "request-id",
+                                  svn_trace__request_id(trace)));
+  SVN_ERR(handle_auth_request(sess, scratch_pool));
+
+  return svn_error_trace(svn_ra_svn__read_cmd_response(sess->conn,
+                                                       scratch_pool, ""));
+}
+
 static svn_error_t *ra_svn_open(svn_ra_session_t *session,
                                 const char **corrected_url,
                                 const char *url,
@@ -864,6 +902,8 @@ static svn_error_t *ra_svn_open(svn_ra_session_t *session,
                        auth_baton, sess_pool, scratch_pool));
   session->priv = sess;
 
+  SVN_ERR(send_request_id(sess, session->trace, scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -921,6 +961,8 @@ reparent_server(svn_ra_session_t *ra_session,
     err = open_session(&new_sess, url, &uri, sess->tunnel_name, sess->tunnel_argv,
                        sess->config, sess->callbacks, sess->callbacks_baton,
                        sess->auth_baton, sess_pool, sess_pool);
+  if (! err)
+    err = send_request_id(new_sess, ra_session->trace, sess_pool);
   /* We destroy the new session pool on error, since it is allocated in
      the main session pool. */
   if (err)
@@ -2083,6 +2125,136 @@ static svn_error_t *ra_svn_check_path(svn_ra_session_t *session,
 }
 
 
+/* Read the COUNT per-path responses to a check-path-many command from
+   CONN, including the final "done" marker, and append the node kinds to
+   KINDS.  Set *PATH_ERR to the first failure reported for any path or to
+   NULL.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+read_check_path_responses(apr_array_header_t *kinds,
+                          svn_error_t **path_err,
+                          svn_ra_svn_conn_t *conn,
+                          int count,
+                          apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_ra_svn__item_t *elt;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  *path_err = SVN_NO_ERROR;
+  for (i = 0; !err && i < count; ++i)
+    {
+      const char *status, *kind_word;
+      svn_ra_svn__list_t *list;
+
+      svn_pool_clear(iterpool);
+      err = svn_ra_svn__read_item(conn, iterpool, &elt);
+      if (err)
+        break;
+
+      /* The server might have encountered a fatal error in the middle of
+         the list.  It will then send "done" early and report the error in
+         the overall command response. */
+      if (is_done_response(elt))
+        break;
+
+      if (elt->kind != SVN_RA_SVN_LIST)
+        err = svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                               _("Check path response not a list"));
+      else
+        err = svn_ra_svn__parse_tuple(&elt->u.list, "wl", &status, &list);
+      if (err)
+        break;
+
+      if (strcmp(status, "failure") == 0)
+        {
+          if (*path_err)
+            svn_error_clear(svn_ra_svn__handle_failure_status(list));
+          else
+            *path_err = svn_ra_svn__handle_failure_status(list);
+
+          APR_ARRAY_PUSH(kinds, svn_node_kind_t) = svn_node_unknown;
+        }
+      else if (strcmp(status, "success") == 0)
+        {
+          err = svn_ra_svn__parse_tuple(list, "w", &kind_word);
+          if (!err)
+            APR_ARRAY_PUSH(kinds, svn_node_kind_t)
+              = svn_node_kind_from_word(kind_word);
+        }
+      else
+        err = svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                               _("Unknown status for check path command"));
+    }
+
+  /* If we didn't break early above, consume the "done" marker. */
+  if (!err && i == count)
+    {
+      svn_pool_clear(iterpool);
+      err = svn_ra_svn__read_item(conn, iterpool, &elt);
+      if (!err && !is_done_response(elt))
+        err = svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                               _("Didn't receive end marker for check "
+                                 "path responses"));
+    }
+  svn_pool_destroy(iterpool);
+
+  if (err)
+    {
+      svn_error_clear(*path_err);
+      *path_err = SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(err);
+}
+
+/* Implements svn_ra__vtable_t.check_paths(). */
+static svn_error_t *
+ra_svn_check_paths(svn_ra_session_t *session,
+                   apr_array_header_t **kinds,
+                   const apr_array_header_t *paths,
+                   svn_revnum_t rev,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  apr_pool_t *iterpool;
+  svn_error_t *path_err;
+  int i;
+
+  if (!svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_CHECK_PATH_MANY))
+    return svn_error_create(SVN_ERR_RA_NOT_IMPLEMENTED, NULL,
+                            _("Server does not support checking multiple "
+                              "paths at once"));
+
+  iterpool = svn_pool_create(scratch_pool);
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "w((?r)(!",
+                                  "check-path-many", rev));
+  for (i = 0; i < paths->nelts; ++i)
+    {
+      const char *path = APR_ARRAY_IDX(paths, i, const char *);
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "c",
+                                      reparent_path(session, path,
+                                                    iterpool)));
+    }
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "!))"));
+  SVN_ERR(handle_auth_request(sess_baton, scratch_pool));
+
+  *kinds = apr_array_make(result_pool, paths->nelts, sizeof(svn_node_kind_t));
+  SVN_ERR(read_check_path_responses(*kinds, &path_err, conn, paths->nelts,
+                                    scratch_pool));
+  SVN_ERR(svn_error_compose_create(
+            svn_ra_svn__read_cmd_response(conn, scratch_pool, ""),
+            path_err));
+
+  return SVN_NO_ERROR;
+}
+
 /* If ERR is a command not supported error, wrap it in a
    SVN_ERR_RA_NOT_IMPLEMENTED with error message MSG.  Else, return err. */
 static svn_error_t *handle_unsupported_cmd(svn_error_t *err,
@@ -2422,6 +2594,95 @@ static svn_error_t *ra_svn_get_file_revs(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_ra__vtable_t.blame(). */
+static svn_error_t *
+ra_svn_blame(svn_ra_session_t *session,
+             const char *path,
+             svn_revnum_t start,
+             svn_revnum_t end,
+             const svn_diff_file_options_t *diff_options,
+             svn_ra__blame_receiver_t receiver,
+             void *receiver_baton,
+             apr_pool_t *scratch_pool)
+{
+  svn_ra_svn__session_baton_t *sess_baton = session->priv;
+  svn_ra_svn_conn_t *conn = sess_baton->conn;
+  svn_diff_file_ignore_space_t ignore_space = svn_diff_file_ignore_space_none;
+  svn_boolean_t ignore_eol_style = FALSE;
+  const char *ignore_space_word;
+  apr_hash_t *revisions = apr_hash_make(scratch_pool);
+  apr_pool_t *iterpool;
+
+  if (!svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_BLAME))
+    return svn_error_create(SVN_ERR_RA_NOT_IMPLEMENTED, NULL,
+                            _("Server does not support blame"));
+
+  if (diff_options)
+    {
+      ignore_space = diff_options->ignore_space;
+      ignore_eol_style = diff_options->ignore_eol_style;
+    }
+
+  if (ignore_space == svn_diff_file_ignore_space_change)
+    ignore_space_word = "change";
+  else if (ignore_space == svn_diff_file_ignore_space_all)
+    ignore_space_word = "all";
+  else
+    ignore_space_word = "none";
+
+  SVN_ERR(svn_ra_svn__write_tuple(conn, scratch_pool, "w(crrwb)",
+                                  "get-blame",
+                                  reparent_path(session, path, scratch_pool),
+                                  start, end, ignore_space_word,
+                                  ignore_eol_style));
+  SVN_ERR(handle_auth_request(sess_baton, scratch_pool));
+
+  /* Every revision's properties are sent only with the first range of
+     lines attributed to it. */
+  iterpool = svn_pool_create(scratch_pool);
+  while (1)
+    {
+      svn_ra_svn__item_t *item;
+      svn_ra_svn__list_t *proplist;
+      apr_uint64_t start_line;
+      svn_revnum_t rev;
+      apr_hash_t *rev_props = NULL;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_item(conn, iterpool, &item));
+      if (is_done_response(item))
+        break;
+
+      if (item->kind != SVN_RA_SVN_LIST)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Blame entry not a list"));
+
+      SVN_ERR(svn_ra_svn__parse_tuple(&item->u.list, "n(?r)l",
+                                      &start_line, &rev, &proplist));
+      if (SVN_IS_VALID_REVNUM(rev))
+        {
+          rev_props = apr_hash_get(revisions, &rev, sizeof(rev));
+          if (!rev_props)
+            {
+              svn_revnum_t *key = apr_pmemdup(scratch_pool, &rev,
+                                              sizeof(rev));
+
+              SVN_ERR(svn_ra_svn__parse_proplist(proplist, iterpool,
+                                                 &rev_props));
+              rev_props = svn_prop_hash_dup(rev_props, scratch_pool);
+              apr_hash_set(revisions, key, sizeof(*key), rev_props);
+            }
+        }
+
+      SVN_ERR(receiver(receiver_baton, (apr_int64_t)start_line, rev,
+                       rev_props, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_ra_svn__read_cmd_response(conn, scratch_pool,
+                                                       ""));
+}
+
 /* For each path in PATH_REVS, send a 'lock' command to the server.
    Used with 1.2.x series servers which support locking, but of only
    one path at a time.  ra_svn_lock(), which supports 'lock-many'
@@ -3244,6 +3505,8 @@ static const svn_ra__vtable_t ra_svn_vtable = {
   ra_svn_get_inherited_props,
   NULL /* ra_set_svn_ra_open */,
   ra_svn_list,
+  ra_svn_check_paths,
+  ra_svn_blame,
   ra_svn_register_editor_shim_callbacks,
   NULL /* commit_ev2 */,
   NULL /* replay_range_ev2 */
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 
 #define APR_WANT_STRFUNC
+#define APR_WANT_IOVEC
 #include <apr_want.h>
 #include <apr_general.h>
 #include <apr_lib.h>
@@ -36,6 +37,7 @@
 #include "svn_types.h"
 #include "svn_string.h"
 #include "svn_error.h"
+#include "svn_io.h"
 #include "svn_pools.h"
 #include "svn_ra_svn.h"
 #include "svn_private_config.h"
@@ -177,6 +179,136 @@ svn_ra_svn__to_private_array(const apr_array_header_t *source,
   return result;
 }
 
+/* --- READ BUFFER BOOKKEEPING --- */
+
+/* String items that have been received in full with a single read get
+ * returned as pointers into the read buffer, i.e. without copying them.
+ * A buffer may only be overwritten after all pools holding such items
+ * got cleared.  Until then, the connection continues with another one.
+ *
+ * Long-lived pools would keep their buffers pinned for a long time and
+ * each replacement buffer gets allocated in the connection pool.  So, we
+ * limit the number of pinned buffers and copy the strings once the limit
+ * has been reached.
+ */
+struct svn_ra_svn__read_buf_t
+{
+  /* The buffer itself and its size. */
+  char *data;
+  apr_size_t size;
+
+  /* Number of pool cleanups still pending for this buffer. */
+  int pins;
+
+  /* Pool that pinned this buffer most recently.  NULL, if that pin has
+   * already been released. */
+  apr_pool_t *pinned_by;
+
+  /* The connection that this buffer belongs to. */
+  svn_ra_svn_conn_t *conn;
+};
+
+/* Baton type used with release_read_buf(). */
+typedef struct pin_baton_t
+{
+  svn_ra_svn__read_buf_t *buffer;
+  apr_pool_t *pool;
+} pin_baton_t;
+
+/* Pool cleanup function releasing the pin described by the pin_baton_t
+ * BATON.  Unpinned buffers that are no longer in use become spares.
+ */
+static apr_status_t
+release_read_buf(void *baton)
+{
+  pin_baton_t *pin = baton;
+  svn_ra_svn__read_buf_t *buffer = pin->buffer;
+  svn_ra_svn_conn_t *conn = buffer->conn;
+
+  if (buffer->pinned_by == pin->pool)
+    buffer->pinned_by = NULL;
+
+  if (--buffer->pins == 0)
+    {
+      --conn->pinned_read_bufs;
+      if (   buffer != conn->read_buf_info
+          && buffer->size == conn->read_buf_size)
+        APR_ARRAY_PUSH(conn->spare_read_bufs, svn_ra_svn__read_buf_t *)
+          = buffer;
+    }
+
+  return APR_SUCCESS;
+}
+
+/* Make sure the current read buffer of CONN does not get overwritten
+ * before POOL gets cleared.  Return FALSE, if that can't be guaranteed
+ * and items must be copied.
+ */
+static svn_boolean_t
+readbuf_pin(svn_ra_svn_conn_t *conn,
+            apr_pool_t *pool)
+{
+  svn_ra_svn__read_buf_t *buffer = conn->read_buf_info;
+  pin_baton_t *pin;
+
+  if (buffer->pinned_by == pool)
+    return TRUE;
+
+  /* The cleanup accesses CONN, so POOL must not outlive it. */
+  if (!apr_pool_is_ancestor(conn->pool, pool))
+    return FALSE;
+
+  /* Don't let long-lived pools hold on to ever more buffers. */
+  if (buffer->pins == 0)
+    {
+      if (conn->pinned_read_bufs >= SVN_RA_SVN__MAX_PINNED_READ_BUFS)
+        return FALSE;
+
+      ++conn->pinned_read_bufs;
+    }
+
+  pin = apr_palloc(pool, sizeof(*pin));
+  pin->buffer = buffer;
+  pin->pool = pool;
+  apr_pool_cleanup_register(pool, pin, release_read_buf,
+                            apr_pool_cleanup_null);
+
+  ++buffer->pins;
+  buffer->pinned_by = pool;
+
+  return TRUE;
+}
+
+/* Make CONN use an empty read buffer of SIZE bytes.  Take it from the
+ * spares, if possible.  Unused buffers of other sizes will be dropped.
+ */
+static void
+readbuf_replace(svn_ra_svn_conn_t *conn,
+                apr_size_t size)
+{
+  svn_ra_svn__read_buf_t *buffer = NULL;
+
+  if (size != conn->read_buf_size)
+    apr_array_clear(conn->spare_read_bufs);
+
+  if (conn->spare_read_bufs->nelts)
+    buffer = *(svn_ra_svn__read_buf_t **)apr_array_pop(conn->spare_read_bufs);
+
+  if (buffer == NULL)
+    {
+      buffer = apr_pcalloc(conn->pool, sizeof(*buffer));
+      buffer->data = apr_palloc(conn->pool, size);
+      buffer->size = size;
+      buffer->conn = conn;
+    }
+
+  conn->read_buf_info = buffer;
+  conn->read_buf = buffer->data;
+  conn->read_buf_size = size;
+  conn->read_ptr = conn->read_buf;
+  conn->read_end = conn->read_buf;
+}
+
 /* --- CONNECTION INITIALIZATION --- */
 
 svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
@@ -189,19 +321,24 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
                                            apr_uint64_t max_out,
                                            apr_pool_t *result_pool)
 {
-  svn_ra_svn_conn_t *conn;
-  void *mem = apr_palloc(result_pool, sizeof(*conn) + SVN_RA_SVN__PAGE_SIZE);
-  conn = (void*)APR_ALIGN((apr_uintptr_t)mem, SVN_RA_SVN__PAGE_SIZE);
+  svn_ra_svn_conn_t *conn = apr_palloc(result_pool, sizeof(*conn));
 
   assert((sock && !in_stream && !out_stream)
          || (!sock && in_stream && out_stream));
-#ifdef SVN_HAVE_SASL
   conn->sock = sock;
+#ifdef SVN_HAVE_SASL
   conn->encrypted = FALSE;
 #endif
   conn->session = NULL;
-  conn->read_ptr = conn->read_buf;
-  conn->read_end = conn->read_buf;
+  conn->lz4_stream = FALSE;
+  conn->write_buf_size = SVN_RA_SVN__WRITEBUF_SIZE;
+  conn->write_buf = apr_palloc(result_pool, conn->write_buf_size);
+  conn->pool = result_pool;
+  conn->spare_read_bufs = apr_array_make(result_pool, 2,
+                                         sizeof(svn_ra_svn__read_buf_t *));
+  conn->pinned_read_bufs = 0;
+  conn->read_buf_size = SVN_RA_SVN__READBUF_SIZE;
+  readbuf_replace(conn, conn->read_buf_size);
   conn->write_pos = 0;
   conn->written_since_error_check = 0;
   conn->error_check_interval = error_check_interval;
@@ -215,7 +352,6 @@ svn_ra_svn_conn_t *svn_ra_svn_create_conn5(apr_socket_t *sock,
   conn->capabilities = apr_hash_make(result_pool);
   conn->compression_level = compression_level;
   conn->zero_copy_limit = zero_copy_limit;
-  conn->pool = result_pool;
 
   if (sock != NULL)
     {
@@ -291,6 +427,29 @@ svn_ra_svn_compression_level(svn_ra_svn_conn_t *conn)
   return conn->compression_level;
 }
 
+int
+svn_ra_svn__svndiff_version(svn_ra_svn_conn_t *conn)
+{
+  /* If we don't want to use compression, use the non-compressing
+   * "version 0" implementation. */
+  if (svn_ra_svn_compression_level(conn) <= 0)
+    return 0;
+
+  /* Don't compress deltas twice on an LZ4 compressed connection. */
+  if (conn->lz4_stream)
+    return 0;
+
+  /* Prefer the cheaper LZ4-based svndiff2 over zlib-based svndiff1. */
+  if (svn__lz4_supported()
+      && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED))
+    return 2;
+  if (svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_SVNDIFF1))
+    return 1;
+
+  /* The connection does not support SVNDIFF1/2; default to "version 0". */
+  return 0;
+}
+
 apr_size_t
 svn_ra_svn_zero_copy_limit(svn_ra_svn_conn_t *conn)
 {
@@ -345,6 +504,19 @@ check_io_limits(svn_ra_svn_conn_t *conn)
   return SVN_NO_ERROR;
 }
 
+/* Return TRUE if everything written to CONN goes to its socket without
+ * any further processing and writes may block. */
+static svn_boolean_t
+writes_to_socket(svn_ra_svn_conn_t *conn)
+{
+#ifdef SVN_HAVE_SASL
+  if (conn->encrypted)
+    return FALSE;
+#endif
+
+  return conn->sock && !conn->lz4_stream && !conn->block_handler;
+}
+
 /* Write data to socket or output file as appropriate. */
 static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                                     const char *data, apr_size_t len)
@@ -398,23 +570,103 @@ static svn_error_t *writebuf_output(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   return SVN_NO_ERROR;
 }
 
+/* Send the contents of the write buffer of CONN, followed by the LEN
+ * bytes at DATA, directly to the socket of CONN.  Gather both into as
+ * few syscalls as possible.  Use POOL for temporaries.
+ */
+static svn_error_t *writebuf_output_v(svn_ra_svn_conn_t *conn,
+                                      apr_pool_t *pool,
+                                      const char *data, apr_size_t len)
+{
+  struct iovec vec[2];
+  int first = conn->write_pos ? 0 : 1;
+  apr_size_t total = conn->write_pos + len;
+  svn_ra_svn__session_baton_t *session = conn->session;
+
+  vec[0].iov_base = conn->write_buf;
+  vec[0].iov_len = conn->write_pos;
+  vec[1].iov_base = (void *)data;
+  vec[1].iov_len = len;
+  conn->write_pos = 0;
+
+  /* Same limits apply as for buffered data. */
+  conn->current_out += total;
+  SVN_ERR(check_io_limits(conn));
+
+  while (first < 2)
+    {
+      apr_size_t count;
+      apr_status_t status;
+
+      if (session && session->callbacks && session->callbacks->cancel_func)
+        SVN_ERR((session->callbacks->cancel_func)(session->callbacks_baton));
+
+      status = apr_socket_sendv(conn->sock, vec + first, 2 - first, &count);
+      if (status && count == 0)
+        return svn_error_wrap_apr(status, _("Can't write to connection"));
+
+      if (session)
+        {
+          const svn_ra_callbacks2_t *cb = session->callbacks;
+          session->bytes_written += count;
+
+          if (cb && cb->progress_func)
+            (cb->progress_func)(session->bytes_written + session->bytes_read,
+                                -1, cb->progress_baton, pool);
+        }
+
+      /* Skip what has been sent. */
+      for (; first < 2 && count >= vec[first].iov_len; ++first)
+        count -= vec[first].iov_len;
+
+      if (first < 2)
+        {
+          vec[first].iov_base = (char *)vec[first].iov_base + count;
+          vec[first].iov_len -= count;
+        }
+    }
+
+  conn->written_since_error_check += total;
+  conn->may_check_for_error
+    = conn->written_since_error_check >= conn->error_check_interval;
+
+  return SVN_NO_ERROR;
+}
+
 /* Write data from the write buffer out to the socket. */
 static svn_error_t *writebuf_flush(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
 {
+  const char *write_buf = conn->write_buf;
   apr_size_t write_pos = conn->write_pos;
 
   /* Clear conn->write_pos first in case the block handler does a read. */
   conn->write_pos = 0;
-  SVN_ERR(writebuf_output(conn, pool, conn->write_buf, write_pos));
+
+  /* A mostly full buffer means that we are sending bulk data.  Continue
+   * with a larger buffer to save on syscalls.  The old buffer's memory
+   * is not reused but the total size is bounded by twice the maximum. */
+  if (   write_pos >= conn->write_buf_size / 4 * 3
+      && conn->write_buf_size < SVN_RA_SVN__MAX_BUF_SIZE)
+    {
+      conn->write_buf_size *= 2;
+      conn->write_buf = apr_palloc(conn->pool, conn->write_buf_size);
+    }
+
+  SVN_ERR(writebuf_output(conn, pool, write_buf, write_pos));
   return SVN_NO_ERROR;
 }
 
 static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                                    const char *data, apr_size_t len)
 {
-  /* data >= 8k is sent immediately */
-  if (len >= sizeof(conn->write_buf) / 2)
+  /* data >= half the buffer size is sent immediately */
+  if (len >= conn->write_buf_size / 2)
     {
+      /* Send the buffered data, e.g. the length prefix of a string,
+       * and the payload in one go. */
+      if (writes_to_socket(conn))
+        return svn_error_trace(writebuf_output_v(conn, pool, data, len));
+
       if (conn->write_pos > 0)
         SVN_ERR(writebuf_flush(conn, pool));
 
@@ -422,7 +674,7 @@ static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
     }
 
   /* ensure room for the data to add */
-  if (conn->write_pos + len > sizeof(conn->write_buf))
+  if (conn->write_pos + len > conn->write_buf_size)
     SVN_ERR(writebuf_flush(conn, pool));
 
   /* buffer the new data block as well */
@@ -443,7 +695,7 @@ static svn_error_t *writebuf_write(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 static APR_INLINE svn_error_t *
 writebuf_writechar(svn_ra_svn_conn_t *conn, apr_pool_t *pool, char data)
 {
-  if (conn->write_pos < sizeof(conn->write_buf))
+  if (conn->write_pos < conn->write_buf_size)
   {
     conn->write_buf[conn->write_pos] = data;
     conn->write_pos++;
@@ -505,6 +757,19 @@ static svn_error_t *readbuf_input(svn_ra_svn_conn_t *conn, char *data,
   return SVN_NO_ERROR;
 }
 
+/* If the last read filled the whole read buffer of CONN, we are most
+ * likely receiving bulk data.  Switch to a larger buffer then, unless it
+ * already reached its maximum size.  Also switch buffers if parsed items
+ * still point into the current one.  The read buffer must be empty. */
+static void readbuf_prepare(svn_ra_svn_conn_t *conn)
+{
+  if (   conn->read_end == conn->read_buf + conn->read_buf_size
+      && conn->read_buf_size < SVN_RA_SVN__MAX_BUF_SIZE)
+    readbuf_replace(conn, 2 * conn->read_buf_size);
+  else if (conn->read_buf_info->pins)
+    readbuf_replace(conn, conn->read_buf_size);
+}
+
 /* Treat the next LEN input bytes from CONN as "read" */
 static svn_error_t *readbuf_skip(svn_ra_svn_conn_t *conn, apr_uint64_t len)
 {
@@ -517,7 +782,8 @@ static svn_error_t *readbuf_skip(svn_ra_svn_conn_t *conn, apr_uint64_t len)
     if (len == 0)
       break;
 
-    buflen = sizeof(conn->read_buf);
+    readbuf_prepare(conn);
+    buflen = conn->read_buf_size;
     SVN_ERR(svn_ra_svn__stream_read(conn->stream, conn->read_buf, &buflen));
     if (buflen == 0)
       return svn_error_create(SVN_ERR_RA_SVN_CONNECTION_CLOSED, NULL, NULL);
@@ -543,7 +809,8 @@ static svn_error_t *readbuf_fill(svn_ra_svn_conn_t *conn, apr_pool_t *pool)
     SVN_ERR(writebuf_flush(conn, pool));
 
   /* Fill (some of the) buffer. */
-  len = sizeof(conn->read_buf);
+  readbuf_prepare(conn);
+  len = conn->read_buf_size;
   SVN_ERR(readbuf_input(conn, conn->read_buf, &len, pool));
   conn->read_ptr = conn->read_buf;
   conn->read_end = conn->read_buf + len;
@@ -584,7 +851,7 @@ static svn_error_t *readbuf_read(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
   data = readbuf_drain(conn, data, end);
 
   /* Read large chunks directly into buffer. */
-  while (end - data > (apr_ssize_t)sizeof(conn->read_buf))
+  while (end - data > (apr_ssize_t)conn->read_buf_size)
     {
       SVN_ERR(writebuf_flush(conn, pool));
       count = end - data;
@@ -606,7 +873,7 @@ static svn_error_t *readbuf_read(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 static svn_error_t *readbuf_skip_leading_garbage(svn_ra_svn_conn_t *conn,
                                                  apr_pool_t *pool)
 {
-  char buf[256];  /* Must be smaller than sizeof(conn->read_buf) - 1. */
+  char buf[256];  /* Must be smaller than SVN_RA_SVN__READBUF_SIZE - 1. */
   const char *p, *end;
   apr_size_t len;
   svn_boolean_t lparen = FALSE;
@@ -634,6 +901,7 @@ static svn_error_t *readbuf_skip_leading_garbage(svn_ra_svn_conn_t *conn,
   /* p now points to the whitespace just after the left paren.  Fake
    * up the left paren and then copy what we have into the read
    * buffer. */
+  readbuf_prepare(conn);
   conn->read_buf[0] = '(';
   memcpy(conn->read_buf + 1, p, end - p);
   conn->read_ptr = conn->read_buf;
@@ -650,7 +918,7 @@ static svn_error_t *write_number(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
 
   /* SVN_INT64_BUFFER_SIZE includes space for a terminating NUL that
    * svn__ui64toa will always append. */
-  if (conn->write_pos + SVN_INT64_BUFFER_SIZE >= sizeof(conn->write_buf))
+  if (conn->write_pos + SVN_INT64_BUFFER_SIZE >= conn->write_buf_size)
     SVN_ERR(writebuf_flush(conn, pool));
 
   written = svn__ui64toa(conn->write_buf + conn->write_pos, number);
@@ -710,7 +978,7 @@ svn_ra_svn__write_ncstring(svn_ra_svn_conn_t *conn,
 {
   /* Apart from LEN bytes of string contents, we need room for a number,
      a colon and a space. */
-  apr_size_t max_fill = sizeof(conn->write_buf) - SVN_INT64_BUFFER_SIZE - 2;
+  apr_size_t max_fill = conn->write_buf_size - SVN_INT64_BUFFER_SIZE - 2;
 
   /* In most cases, there is enough left room in the WRITE_BUF
      the we can serialize directly into it.  On platforms with
@@ -744,6 +1012,80 @@ svn_ra_svn__write_string(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_SENDFILE
+/* Send LEN bytes from FILE, starting at OFFSET, directly to the socket
+ * of CONN.  The write buffer must be empty.  Use POOL for temporaries.
+ */
+static svn_error_t *
+sendfile_output(svn_ra_svn_conn_t *conn,
+                apr_pool_t *pool,
+                apr_file_t *file,
+                apr_off_t offset,
+                apr_size_t len)
+{
+  /* Same limits apply as for buffered data. */
+  conn->current_out += len;
+  SVN_ERR(check_io_limits(conn));
+
+  conn->written_since_error_check += len;
+  conn->may_check_for_error
+    = conn->written_since_error_check >= conn->error_check_interval;
+
+  while (len > 0)
+    {
+      /* Not all platforms update the offset. */
+      apr_off_t current = offset;
+      apr_size_t count = len;
+      apr_status_t status = apr_socket_sendfile(conn->sock, file, NULL,
+                                                &current, &count, 0);
+      if (status && count == 0)
+        return svn_error_wrap_apr(status, _("Can't write to connection"));
+
+      offset += count;
+      len -= count;
+    }
+
+  return SVN_NO_ERROR;
+}
+#endif
+
+svn_error_t *
+svn_ra_svn__write_string_from_file(svn_ra_svn_conn_t *conn,
+                                   apr_pool_t *pool,
+                                   apr_file_t *file,
+                                   apr_off_t offset,
+                                   apr_size_t len)
+{
+  char *buffer;
+
+  SVN_ERR(write_number(conn, pool, len, ':'));
+
+#if APR_HAS_SENDFILE
+  /* Let the kernel copy the data straight from the file to the socket. */
+  if (writes_to_socket(conn))
+    {
+      SVN_ERR(writebuf_flush(conn, pool));
+      SVN_ERR(sendfile_output(conn, pool, file, offset, len));
+
+      return svn_error_trace(writebuf_writechar(conn, pool, ' '));
+    }
+#endif
+
+  /* Fall back to reading the file in chunks. */
+  SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+  buffer = apr_palloc(pool, SVN__STREAM_CHUNK_SIZE);
+  while (len > 0)
+    {
+      apr_size_t count = MIN(len, SVN__STREAM_CHUNK_SIZE);
+
+      SVN_ERR(svn_io_file_read_full2(file, buffer, count, NULL, NULL, pool));
+      SVN_ERR(writebuf_write(conn, pool, buffer, count));
+      len -= count;
+    }
+
+  return svn_error_trace(writebuf_writechar(conn, pool, ' '));
+}
+
 svn_error_t *
 svn_ra_svn__write_cstring(svn_ra_svn_conn_t *conn,
                           apr_pool_t *pool,
@@ -812,7 +1154,7 @@ svn_error_t *
 svn_ra_svn__start_list(svn_ra_svn_conn_t *conn,
                        apr_pool_t *pool)
 {
-  if (conn->write_pos + 2 <= sizeof(conn->write_buf))
+  if (conn->write_pos + 2 <= conn->write_buf_size)
     {
       conn->write_buf[conn->write_pos] = '(';
       conn->write_buf[conn->write_pos+1] = ' ';
@@ -827,7 +1169,7 @@ svn_error_t *
 svn_ra_svn__end_list(svn_ra_svn_conn_t *conn,
                      apr_pool_t *pool)
 {
-  if (conn->write_pos + 2 <= sizeof(conn->write_buf))
+  if (conn->write_pos + 2 <= conn->write_buf_size)
   {
     conn->write_buf[conn->write_pos] = ')';
     conn->write_buf[conn->write_pos+1] = ' ';
@@ -972,7 +1314,7 @@ write_tuple_string_opt_list(svn_ra_svn_conn_t *conn,
 
   /* If this how far we can fill the WRITE_BUF with string data and still
      guarantee that the length info will fit in as well. */
-  max_fill = sizeof(conn->write_buf)
+  max_fill = conn->write_buf_size
            - 2                       /* open list */
            - SVN_INT64_BUFFER_SIZE   /* string length + separator */
            - 2;                      /* close list */
@@ -1185,11 +1527,13 @@ svn_ra_svn__write_tuple(svn_ra_svn_conn_t *conn,
 
 /* --- READING DATA ITEMS --- */
 
-/* Read LEN bytes from CONN into already-allocated structure ITEM.
- * Afterwards, *ITEM is of type 'SVN_RA_SVN_STRING', and its string
- * data is allocated in POOL. */
+/* Read LEN bytes from CONN into already-allocated structure ITEM and
+ * return the character following them in *NEXT.  Afterwards, *ITEM is
+ * of type 'SVN_RA_SVN_STRING', and its string data is allocated in POOL
+ * or remains valid until POOL gets cleared. */
 static svn_error_t *read_string(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
-                                svn_ra_svn__item_t *item, apr_uint64_t len64)
+                                svn_ra_svn__item_t *item, apr_uint64_t len64,
+                                char *next)
 {
   apr_size_t len = (apr_size_t)len64;
   apr_size_t readbuf_len;
@@ -1203,7 +1547,25 @@ static svn_error_t *read_string(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
                             _("String length larger than maximum"));
 
   buflen = conn->read_end - conn->read_ptr;
-  /* Shorter strings can be copied directly from the read buffer. */
+  /* Strings that are followed by whitespace within the read buffer can
+   * be used in place, with the whitespace replaced by a terminating NUL.
+   */
+  if (   len < buflen
+      && svn_iswhitespace(conn->read_ptr[len])
+      && readbuf_pin(conn, pool))
+    {
+      item->kind = SVN_RA_SVN_STRING;
+      item->u.string.data = conn->read_ptr;
+      item->u.string.len = len;
+
+      *next = conn->read_ptr[len];
+      conn->read_ptr[len] = '\0';
+      conn->read_ptr += len + 1;
+
+      return SVN_NO_ERROR;
+    }
+
+  /* Other short strings can be copied directly from the read buffer. */
   if (len <= buflen)
     {
       item->kind = SVN_RA_SVN_STRING;
@@ -1263,7 +1625,7 @@ static svn_error_t *read_string(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
       item->u.string.len = stringbuf->len;
     }
 
-  return SVN_NO_ERROR;
+  return svn_error_trace(readbuf_getchar(conn, pool, next));
 }
 
 /* Given the first non-whitespace character FIRST_CHAR, read an item
@@ -1306,8 +1668,7 @@ static svn_error_t *read_item(svn_ra_svn_conn_t *conn, apr_pool_t *pool,
       if (c == ':')
         {
           /* It's a string. */
-          SVN_ERR(read_string(conn, pool, item, val));
-          SVN_ERR(readbuf_getchar(conn, pool, &c));
+          SVN_ERR(read_string(conn, pool, item, val, &c));
         }
       else
         {
@@ -2823,7 +3184,7 @@ svn_ra_svn__write_data_log_changed_path(svn_ra_svn_conn_t *conn,
   apr_size_t flags_len = flags_str->len;
 
   /* How much buffer space can we use for non-string data (worst case)? */
-  apr_size_t max_fill = sizeof(conn->write_buf)
+  apr_size_t max_fill = conn->write_buf_size
                       - 2                          /* list start */
                       - 2 - SVN_INT64_BUFFER_SIZE  /* path */
                       - 2                          /* action */
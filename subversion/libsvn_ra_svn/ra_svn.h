@@ -62,35 +62,62 @@ typedef svn_error_t *(*ra_svn_block_handler_t)(svn_ra_svn_conn_t *conn,
 #define SVN_RA_SVN__DEFAULT_USERAGENT  "SVN/" SVN_VER_NUMBER\
                                        " (" SVN_BUILD_TARGET ")"
 
-/* The size of our per-connection read and write buffers. */
+/* The initial size of our per-connection read and write buffers. */
 #define SVN_RA_SVN__PAGE_SIZE 4096
 #define SVN_RA_SVN__READBUF_SIZE (4 * SVN_RA_SVN__PAGE_SIZE)
 #define SVN_RA_SVN__WRITEBUF_SIZE (4 * SVN_RA_SVN__PAGE_SIZE)
 
+/* The size up to which these buffers may grow during bulk transfers. */
+#define SVN_RA_SVN__MAX_BUF_SIZE (64 * SVN_RA_SVN__PAGE_SIZE)
+
+/* Maximum number of read buffers that parsed string items may point into
+ * at the same time.  Beyond that, strings get copied into their pools. */
+#define SVN_RA_SVN__MAX_PINNED_READ_BUFS 4
+
 /* Create forward reference */
 typedef struct svn_ra_svn__session_baton_t svn_ra_svn__session_baton_t;
 
+/* Bookkeeping for a read buffer that parsed items may point into. */
+typedef struct svn_ra_svn__read_buf_t svn_ra_svn__read_buf_t;
+
 /* This structure is opaque to the server.  The client pokes at the
  * first few fields during setup and cleanup. */
 struct svn_ra_svn_conn_st {
 
-  /* I/O buffers */
-  char write_buf[SVN_RA_SVN__WRITEBUF_SIZE];
-  char read_buf[SVN_RA_SVN__READBUF_SIZE];
+  /* I/O buffers.  They get replaced by larger ones, up to
+     SVN_RA_SVN__MAX_BUF_SIZE, whenever they run full. */
+  char *write_buf;
+  apr_size_t write_buf_size;
+  char *read_buf;
+  apr_size_t read_buf_size;
+  svn_ra_svn__read_buf_t *read_buf_info;
   char *read_ptr;
   char *read_end;
   apr_size_t write_pos;
 
   svn_ra_svn__stream_t *stream;
   svn_ra_svn__session_baton_t *session;
-#ifdef SVN_HAVE_SASL
+
   /* Although all reads and writes go through the svn_ra_svn__stream_t
      interface, SASL still needs direct access to the underlying socket
-     for stuff like IP addresses and port numbers. */
+     for stuff like IP addresses and port numbers.  It is also used to
+     send file contents with sendfile().  NULL for tunnels. */
   apr_socket_t *sock;
+#ifdef SVN_HAVE_SASL
   svn_boolean_t encrypted;
 #endif
 
+  /* Whether all traffic gets LZ4 compressed, see "lz4-stream". */
+  svn_boolean_t lz4_stream;
+
+  /* Read buffers of READ_BUF_SIZE that no parsed item points into
+     anymore, ready for reuse. */
+  apr_array_header_t *spare_read_bufs;
+
+  /* Number of read buffers, including the current one, that parsed items
+     still point into.  At most SVN_RA_SVN__MAX_PINNED_READ_BUFS. */
+  int pinned_read_bufs;
+
   /* abortion check control */
   apr_size_t written_since_error_check;
   apr_size_t error_check_interval;
@@ -23,6 +23,8 @@
 
 
 
+#include <string.h>
+
 #include <apr_general.h>
 #include <apr_network_io.h>
 #include <apr_poll.h>
@@ -34,6 +36,7 @@
 #include "svn_private_config.h"
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "ra_svn.h"
 
@@ -230,3 +233,244 @@ svn_ra_svn__stream_data_available(svn_ra_svn__stream_t *stream,
           svn_stream_data_available(stream->in_stream,
                                     data_available));
 }
+
+
+/* LZ4 compressed connections. */
+
+/* Maximum amount of plain data to put into a single frame.  This is also
+ * the largest amount of data a frame may expand to on the receiving side.
+ */
+#define LZ4_MAX_FRAME_SIZE 0x10000
+
+/* Baton for an LZ4 compressed svn_ra_svn__stream_t. */
+typedef struct lz4_baton_t {
+  svn_ra_svn__stream_t *stream; /* Inherited stream. */
+  svn_stringbuf_t *raw;         /* Received data not decoded yet. */
+  svn_stringbuf_t *decoded;     /* Decoded data not returned yet ... */
+  apr_size_t decoded_pos;       /* ... starting at this offset. */
+  svn_stringbuf_t *compressed;  /* Scratch buffer for compression. */
+  svn_stringbuf_t *frame;       /* Encoded frame not fully written yet ... */
+  apr_size_t frame_pos;         /* ... starting at this offset. */
+  apr_size_t frame_data_len;    /* Amount of plain data in FRAME. */
+} lz4_baton_t;
+
+/* Check whether LZ4_BATON->RAW starts with a complete frame.  If so, set
+ * *FRAME_LEN to its total length and *DATA to the start of its payload.
+ * Otherwise, set *FRAME_LEN to 0.
+ */
+static svn_error_t *
+lz4_next_frame(apr_size_t *frame_len,
+               const unsigned char **data,
+               lz4_baton_t *lz4_baton)
+{
+  const unsigned char *start = (const unsigned char *)lz4_baton->raw->data;
+  const unsigned char *end = start + lz4_baton->raw->len;
+  apr_uint64_t payload_len;
+
+  *frame_len = 0;
+  *data = svn__decode_uint(&payload_len, start, end);
+  if (*data == NULL)
+    {
+      if (lz4_baton->raw->len >= SVN__MAX_ENCODED_UINT_LEN)
+        return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                                _("Invalid compressed frame header"));
+      return SVN_NO_ERROR;
+    }
+
+  /* Incompressible data gets stored as-is, plus its length. */
+  if (payload_len == 0
+      || payload_len > LZ4_MAX_FRAME_SIZE + SVN__MAX_ENCODED_UINT_LEN)
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            _("Invalid compressed frame size"));
+
+  if (payload_len <= (apr_uint64_t)(end - *data))
+    *frame_len = (*data - start) + (apr_size_t)payload_len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_read_fn_t. */
+static svn_error_t *
+lz4_read_cb(void *baton, char *buffer, apr_size_t *len)
+{
+  lz4_baton_t *lz4_baton = baton;
+  apr_size_t available;
+
+  /* Decode whole frames until we have some data to return.  Frames may
+     be split across reads from the wrapped stream. */
+  while (lz4_baton->decoded_pos == lz4_baton->decoded->len)
+    {
+      apr_size_t frame_len;
+      const unsigned char *data;
+
+      SVN_ERR(lz4_next_frame(&frame_len, &data, lz4_baton));
+      if (frame_len)
+        {
+          apr_size_t header_len
+            = data - (const unsigned char *)lz4_baton->raw->data;
+
+          SVN_ERR(svn__decompress_lz4(data, frame_len - header_len,
+                                      lz4_baton->decoded,
+                                      LZ4_MAX_FRAME_SIZE));
+          lz4_baton->decoded_pos = 0;
+          svn_stringbuf_remove(lz4_baton->raw, 0, frame_len);
+        }
+      else
+        {
+          /* Use the caller's buffer to receive more data. */
+          apr_size_t len2 = *len;
+          SVN_ERR(svn_ra_svn__stream_read(lz4_baton->stream, buffer, &len2));
+          if (len2 == 0)
+            {
+              *len = 0;
+              return SVN_NO_ERROR;
+            }
+
+          svn_stringbuf_appendbytes(lz4_baton->raw, buffer, len2);
+        }
+    }
+
+  available = lz4_baton->decoded->len - lz4_baton->decoded_pos;
+  if (*len > available)
+    *len = available;
+
+  memcpy(buffer, lz4_baton->decoded->data + lz4_baton->decoded_pos, *len);
+  lz4_baton->decoded_pos += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_write_fn_t. */
+static svn_error_t *
+lz4_write_cb(void *baton, const char *buffer, apr_size_t *len)
+{
+  lz4_baton_t *lz4_baton = baton;
+
+  if (*len == 0)
+    return SVN_NO_ERROR;
+
+  if (lz4_baton->frame_pos == lz4_baton->frame->len)
+    {
+      unsigned char header[SVN__MAX_ENCODED_UINT_LEN];
+      unsigned char *header_end;
+
+      /* Make sure we don't put too much into a single frame. */
+      *len = (*len > LZ4_MAX_FRAME_SIZE) ? LZ4_MAX_FRAME_SIZE : *len;
+      SVN_ERR(svn__compress_lz4(buffer, *len, lz4_baton->compressed));
+
+      header_end = svn__encode_uint(header, lz4_baton->compressed->len);
+      svn_stringbuf_setempty(lz4_baton->frame);
+      svn_stringbuf_appendbytes(lz4_baton->frame, (const char *)header,
+                                header_end - header);
+      svn_stringbuf_appendstr(lz4_baton->frame, lz4_baton->compressed);
+      lz4_baton->frame_pos = 0;
+      lz4_baton->frame_data_len = *len;
+    }
+
+  do
+    {
+      apr_size_t tmplen = lz4_baton->frame->len - lz4_baton->frame_pos;
+      SVN_ERR(svn_ra_svn__stream_write(lz4_baton->stream,
+                                       lz4_baton->frame->data
+                                         + lz4_baton->frame_pos,
+                                       &tmplen));
+      if (tmplen == 0)
+        {
+          /* The rest of the frame will be written out during the next
+             call to this function (which will have the same arguments). */
+          *len = 0;
+          return SVN_NO_ERROR;
+        }
+      lz4_baton->frame_pos += tmplen;
+    }
+  while (lz4_baton->frame_pos < lz4_baton->frame->len);
+
+  *len = lz4_baton->frame_data_len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements ra_svn_timeout_fn_t. */
+static void
+lz4_timeout_cb(void *baton, apr_interval_time_t interval)
+{
+  lz4_baton_t *lz4_baton = baton;
+  svn_ra_svn__stream_timeout(lz4_baton->stream, interval);
+}
+
+/* Implements svn_stream_data_available_fn_t. */
+static svn_error_t *
+lz4_data_available_cb(void *baton, svn_boolean_t *data_available)
+{
+  lz4_baton_t *lz4_baton = baton;
+  apr_size_t frame_len;
+  const unsigned char *data;
+
+  if (lz4_baton->decoded_pos < lz4_baton->decoded->len)
+    {
+      *data_available = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  /* Frames are never empty. */
+  SVN_ERR(lz4_next_frame(&frame_len, &data, lz4_baton));
+  if (frame_len)
+    {
+      *data_available = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(svn_ra_svn__stream_data_available(lz4_baton->stream,
+                                                           data_available));
+}
+
+svn_error_t *
+svn_ra_svn__enable_lz4_stream(svn_ra_svn_conn_t *conn,
+                              apr_pool_t *pool)
+{
+  lz4_baton_t *lz4_baton;
+  svn_stream_t *lz4_in;
+  svn_stream_t *lz4_out;
+
+  if (conn->lz4_stream)
+    return SVN_NO_ERROR;
+
+  if (! svn__lz4_supported())
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("LZ4 compression is not supported by this "
+                              "build of Subversion"));
+
+  /* Flush the connection, as we're about to replace its stream. */
+  SVN_ERR(svn_ra_svn__flush(conn, pool));
+
+  lz4_baton = apr_pcalloc(conn->pool, sizeof(*lz4_baton));
+  lz4_baton->stream = conn->stream;
+  lz4_baton->raw = svn_stringbuf_create_ensure(SVN_RA_SVN__READBUF_SIZE,
+                                               conn->pool);
+  lz4_baton->decoded = svn_stringbuf_create_ensure(LZ4_MAX_FRAME_SIZE,
+                                                   conn->pool);
+  lz4_baton->compressed = svn_stringbuf_create_empty(conn->pool);
+  lz4_baton->frame = svn_stringbuf_create_empty(conn->pool);
+
+  /* If there is any data left in the read buffer at this point, it is
+     already compressed. */
+  if (conn->read_end > conn->read_ptr)
+    {
+      svn_stringbuf_appendbytes(lz4_baton->raw, conn->read_ptr,
+                                conn->read_end - conn->read_ptr);
+      conn->read_end = conn->read_ptr;
+    }
+
+  lz4_in = svn_stream_create(lz4_baton, conn->pool);
+  lz4_out = svn_stream_create(lz4_baton, conn->pool);
+
+  svn_stream_set_read2(lz4_in, lz4_read_cb, NULL /* use default */);
+  svn_stream_set_data_available(lz4_in, lz4_data_available_cb);
+  svn_stream_set_write(lz4_out, lz4_write_cb);
+
+  conn->stream = svn_ra_svn__stream_create(lz4_in, lz4_out, lz4_baton,
+                                           lz4_timeout_cb, conn->pool);
+  conn->lz4_stream = TRUE;
+
+  return SVN_NO_ERROR;
+}
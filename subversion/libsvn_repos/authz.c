@@ -26,6 +26,10 @@
 #include <apr_pools.h>
 #include <apr_file_io.h>
 #include <apr_fnmatch.h>
+#include <apr_md5.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#endif
 
 #include "svn_hash.h"
 #include "svn_pools.h"
@@ -36,6 +40,8 @@
 #include "svn_config.h"
 #include "svn_ctype.h"
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
+#include "private/svn_mutex.h"
 #include "private/svn_fspath.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_sorts_private.h"
@@ -130,6 +136,13 @@ static svn_object_pool__t *authz_pool = NULL;
 static svn_object_pool__t *filtered_pool = NULL;
 static svn_atomic_t authz_pool_initialized = FALSE;
 
+/* Maps rules / groups file combinations to their authz_snapshot_t.
+ * All snapshot data is guarded by SNAPSHOTS_MUTEX and allocated in
+ * SNAPSHOTS_POOL, unless noted otherwise. */
+static apr_hash_t *snapshots = NULL;
+static svn_mutex__t *snapshots_mutex = NULL;
+static apr_pool_t *snapshots_pool = NULL;
+
 /* Implements svn_atomic__err_init_func_t. */
 static svn_error_t *
 synchronized_authz_initialize(void *baton, apr_pool_t *pool)
@@ -143,6 +156,10 @@ synchronized_authz_initialize(void *baton, apr_pool_t *pool)
   SVN_ERR(svn_object_pool__create(&authz_pool, multi_threaded, pool));
   SVN_ERR(svn_object_pool__create(&filtered_pool, multi_threaded, pool));
 
+  SVN_ERR(svn_mutex__init(&snapshots_mutex, multi_threaded, pool));
+  snapshots_pool = pool;
+  snapshots = apr_hash_make(snapshots_pool);
+
   return SVN_NO_ERROR;
 }
 
@@ -872,27 +889,17 @@ finalize_tree(node_t *node,
   combine_right_limits(sum, local_sum);
 }
 
-/* From the authz CONFIG, extract the parts relevant to USER and REPOSITORY.
- * Return the filtered rule tree.
+/* Return all ACLs in AUTHZ for REPOSITORY in path order, allocated in
+ * RESULT_POOL.  Note that repo-specific rules replace global rules, even
+ * if they don't apply to the current user.
  */
-static node_t *
-create_user_authz(authz_full_t *authz,
-                  const char *repository,
-                  const char *user,
-                  apr_pool_t *result_pool,
-                  apr_pool_t *scratch_pool)
+static apr_array_header_t *
+get_repos_acls(authz_full_t *authz,
+               const char *repository,
+               apr_pool_t *result_pool)
 {
   int i;
-  node_t *root = create_node(NULL, result_pool);
-  construction_context_t *ctx = create_construction_context(scratch_pool);
-
-  /* Use a separate sub-pool to keep memory usage tight. */
-  apr_pool_t *subpool = svn_pool_create(scratch_pool);
-
-  /* Find all ACLs for REPOSITORY. 
-   * Note that repo-specific rules replace global rules,
-   * even if they don't apply to the current user. */
-  apr_array_header_t *acls = apr_array_make(subpool, authz->acls->nelts,
+  apr_array_header_t *acls = apr_array_make(result_pool, authz->acls->nelts,
                                             sizeof(authz_acl_t *));
   for (i = 0; i < authz->acls->nelts; ++i)
     {
@@ -920,6 +927,29 @@ create_user_authz(authz_full_t *authz,
         }
     }
 
+  return acls;
+}
+
+/* From the authz CONFIG, extract the parts relevant to USER and REPOSITORY.
+ * Return the filtered rule tree.
+ */
+static node_t *
+create_user_authz(authz_full_t *authz,
+                  const char *repository,
+                  const char *user,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  int i;
+  node_t *root = create_node(NULL, result_pool);
+  construction_context_t *ctx = create_construction_context(scratch_pool);
+
+  /* Use a separate sub-pool to keep memory usage tight. */
+  apr_pool_t *subpool = svn_pool_create(scratch_pool);
+
+  /* Find all ACLs for REPOSITORY. */
+  apr_array_header_t *acls = get_repos_acls(authz, repository, subpool);
+
   /* Filtering and tree construction. */
   for (i = 0; i < acls->nelts; ++i)
     process_acl(ctx, APR_ARRAY_IDX(acls, i, const authz_acl_t *),
@@ -964,6 +994,96 @@ create_user_authz(authz_full_t *authz,
   return root;
 }
 
+/* Compare the ints at *A and *B.  Implements the comparison callback of
+ * svn_sort__array(). */
+static int
+compare_sequence_numbers(const void *a,
+                         const void *b)
+{
+  int lhs = *(const int *)a;
+  int rhs = *(const int *)b;
+
+  return lhs < rhs ? -1 : (lhs > rhs ? 1 : 0);
+}
+
+/* Return a fingerprint of everything in AUTHZ that create_user_authz()
+ * uses for USER and REPOSITORY, allocated in RESULT_POOL.  Filtered trees
+ * with the same fingerprint are equivalent even if they have been created
+ * from different versions of the authz rules.  Thus, when the rules
+ * change, only trees for users that are actually affected by the changes
+ * need to be rebuilt.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_membuf_t *
+get_user_fingerprint(authz_full_t *authz,
+                     const char *repository,
+                     const char *user,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *acls = get_repos_acls(authz, repository, scratch_pool);
+  apr_array_header_t *sequence_numbers
+    = apr_array_make(scratch_pool, acls->nelts, sizeof(int));
+  svn_checksum_ctx_t *context
+    = svn_checksum_ctx_create(svn_checksum_md5, scratch_pool);
+  svn_checksum_t *checksum;
+  svn_membuf_t *result;
+  int i, k;
+
+  /* Only the relative order of the relevant rules matters, not their
+   * absolute sequence numbers.  Those change whenever rules get added
+   * to or removed from earlier parts of the authz file. */
+  for (i = 0; i < acls->nelts; ++i)
+    {
+      const authz_acl_t *acl = APR_ARRAY_IDX(acls, i, const authz_acl_t *);
+      if (svn_authz__get_acl_access(NULL, acl, user, repository))
+        APR_ARRAY_PUSH(sequence_numbers, int) = acl->sequence_number;
+    }
+
+  svn_sort__array(sequence_numbers, compare_sequence_numbers);
+
+  for (i = 0; i < acls->nelts; ++i)
+    {
+      const authz_acl_t *acl = APR_ARRAY_IDX(acls, i, const authz_acl_t *);
+      authz_access_t access;
+      int rank;
+
+      if (!svn_authz__get_acl_access(&access, acl, user, repository))
+        continue;
+
+      rank = svn_sort__bsearch_lower_bound(sequence_numbers,
+                                           &acl->sequence_number,
+                                           compare_sequence_numbers);
+      svn_error_clear(svn_checksum_update(context, &rank, sizeof(rank)));
+      svn_error_clear(svn_checksum_update(context, &access, sizeof(access)));
+      svn_error_clear(svn_checksum_update(context, &acl->rule.len,
+                                          sizeof(acl->rule.len)));
+
+      for (k = 0; k < acl->rule.len; ++k)
+        {
+          const authz_rule_segment_t *segment = &acl->rule.path[k];
+
+          svn_error_clear(svn_checksum_update(context, &segment->kind,
+                                              sizeof(segment->kind)));
+          svn_error_clear(svn_checksum_update(context, &segment->pattern.len,
+                                              sizeof(segment->pattern.len)));
+          svn_error_clear(svn_checksum_update(context, segment->pattern.data,
+                                              segment->pattern.len));
+        }
+    }
+
+  svn_error_clear(svn_checksum_final(&checksum, context, scratch_pool));
+
+  /* Prefix the digest such that these keys never match an AUTHZ_ID. */
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  svn_membuf__create(result, 1 + svn_checksum_size(checksum), result_pool);
+  result->size = 1 + svn_checksum_size(checksum);
+  *(char *)result->data = 'F';
+  memcpy((char *)result->data + 1, checksum->digest,
+         svn_checksum_size(checksum));
+
+  return result;
+}
+
 
 /*** Lookup. ***/
 
@@ -1375,6 +1495,116 @@ lookup(lookup_state_t *state,
 
 
 
+/*** Memoized lookups. ***/
+
+/* Dimensions of the bounded DECISIONS cache of a filtered_tree_t. */
+#define DECISION_CACHE_PAGES 16
+#define DECISION_CACHE_ITEMS_PER_PAGE 256
+
+/* A filtered path rule tree for a given user and repository, together
+ * with the results of recent lookups in it.  This is what FILTERED_POOL
+ * shares between svn_authz_t instances and threads. */
+typedef struct filtered_tree_t
+{
+  /* Root of the filtered path rule tree. */
+  node_t *root;
+
+  /* Maps keys created by construct_decision_key() to the svn_boolean_t
+   * result of the respective lookup().  NULL, if the tree does not
+   * contain any patterns, i.e. lookups are cheap anyway. */
+  svn_cache__t *decisions;
+} filtered_tree_t;
+
+/* Return TRUE, if the sub-tree at NODE contains wildcard patterns. */
+static svn_boolean_t
+has_patterns(const node_t *node)
+{
+  apr_hash_index_t *hi;
+
+  if (node->pattern_sub_nodes)
+    return TRUE;
+
+  if (node->sub_nodes)
+    for (hi = apr_hash_first(NULL, node->sub_nodes);
+         hi;
+         hi = apr_hash_next(hi))
+      if (has_patterns(apr_hash_this_val(hi)))
+        return TRUE;
+
+  return FALSE;
+}
+
+/* Implements svn_cache__serialize_func_t for svn_boolean_t. */
+static svn_error_t *
+serialize_decision(void **data,
+                   apr_size_t *data_len,
+                   void *in,
+                   apr_pool_t *pool)
+{
+  *data = apr_pmemdup(pool, in, sizeof(svn_boolean_t));
+  *data_len = sizeof(svn_boolean_t);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for svn_boolean_t. */
+static svn_error_t *
+deserialize_decision(void **out,
+                     void *data,
+                     apr_size_t data_len,
+                     apr_pool_t *pool)
+{
+  *out = data;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the DECISIONS cache key for a lookup() of PATH with the REQUIRED
+ * and RECURSIVE parameters, allocated in RESULT_POOL. */
+static const char *
+construct_decision_key(const char *path,
+                       authz_access_t required,
+                       svn_boolean_t recursive,
+                       apr_pool_t *result_pool)
+{
+  return apr_psprintf(result_pool, "%d%c%s", (int)required,
+                      recursive ? 'R' : 'N', path);
+}
+
+/* Construct the filtered tree for USER and REPOSITORY from the full AUTHZ
+ * model and return it in *TREE_P, allocated in RESULT_POOL.  If the
+ * DECISIONS cache may be accessed by multiple threads, set THREAD_SAFE.
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+create_filtered_tree(filtered_tree_t **tree_p,
+                     authz_full_t *authz,
+                     const char *repository,
+                     const char *user,
+                     svn_boolean_t thread_safe,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  filtered_tree_t *tree = apr_pcalloc(result_pool, sizeof(*tree));
+  tree->root = create_user_authz(authz, repository, user, result_pool,
+                                 scratch_pool);
+
+  if (has_patterns(tree->root))
+    SVN_ERR(svn_cache__create_inprocess(&tree->decisions,
+                                        serialize_decision,
+                                        deserialize_decision,
+                                        APR_HASH_KEY_STRING,
+                                        DECISION_CACHE_PAGES,
+                                        DECISION_CACHE_ITEMS_PER_PAGE,
+                                        thread_safe, "authz decisions",
+                                        result_pool));
+
+  *tree_p = tree;
+  return SVN_NO_ERROR;
+}
+
+
+
 /*** The authz data structure. ***/
 
 /* An entry in svn_authz_t's USER_RULES cache.  All members must be
@@ -1398,6 +1628,10 @@ struct authz_user_rules_t
    * Will remain NULL until the first usage. */
   node_t *root;
 
+  /* Memo of lookup results in ROOT, possibly shared with other threads.
+   * May be NULL. */
+  svn_cache__t *decisions;
+
   /* Reusable lookup state instance. */
   lookup_state_t *lookup_state;
 
@@ -1460,6 +1694,7 @@ get_user_rules(svn_authz_t *authz,
   authz->filtered->user = user ? apr_pstrdup(pool, user) : NULL;
   authz->filtered->lookup_state = create_lookup_state(pool);
   authz->filtered->root = NULL;
+  authz->filtered->decisions = NULL;
 
   svn_authz__get_global_rights(&authz->filtered->global_rights,
                                authz->full, user, repos_name);
@@ -1477,58 +1712,379 @@ filter_tree(svn_authz_t *authz,
   apr_pool_t *pool = authz->filtered->pool;
   const char *repos_name = authz->filtered->repository;
   const char *user = authz->filtered->user;
-  node_t *root;
+  filtered_tree_t *tree;
 
-  if (filtered_pool)
+  /* Models from svn_repos_authz_parse() have no cache key. */
+  if (filtered_pool && authz->authz_id)
     {
       svn_membuf_t *key = construct_filtered_key(repos_name, user,
                                                  authz->authz_id,
                                                  scratch_pool);
 
       /* Cache lookup. */
-      SVN_ERR(svn_object_pool__lookup((void **)&root, filtered_pool, key,
+      SVN_ERR(svn_object_pool__lookup((void **)&tree, filtered_pool, key,
                                       pool));
 
-      if (!root)
+      if (!tree)
         {
-          apr_pool_t *item_pool = svn_object_pool__new_item_pool(authz_pool);
-          authz_full_t *add_ref = NULL;
-
-          /* Make sure the underlying full authz object lives as long as the
-           * filtered one that we are about to create.  We do this by adding
-           * a reference to it in ITEM_POOL (which may live longer than AUTHZ).
-           *
-           * Note that we already have a reference to that full authz in
-           * AUTHZ->FULL. Assert that we actually don't created multiple
-           * instances of the same full model.
-           */
-          svn_error_clear(svn_object_pool__lookup((void **)&add_ref,
-                                                  authz_pool, authz->authz_id,
-                                                  item_pool));
-          SVN_ERR_ASSERT(add_ref == authz->full);
-
-          /* Now construct the new filtered tree and cache it. */
-          root = create_user_authz(authz->full, repos_name, user, item_pool,
-                                   scratch_pool);
-          svn_error_clear(svn_object_pool__insert((void **)&root,
-                                                  filtered_pool, key, root,
-                                                  item_pool, pool));
+          /* The entry for KEY will merely be an alias, sharing the tree
+           * with all rule versions that result in the same fingerprint. */
+          apr_pool_t *alias_pool = svn_object_pool__new_item_pool(authz_pool);
+          filtered_tree_t *shared;
+          svn_membuf_t *shared_key;
+
+          shared_key = construct_filtered_key(repos_name, user,
+                                              get_user_fingerprint(
+                                                authz->full, repos_name,
+                                                user, scratch_pool,
+                                                scratch_pool),
+                                              scratch_pool);
+          SVN_ERR(svn_object_pool__lookup((void **)&shared, filtered_pool,
+                                          shared_key, alias_pool));
+
+          if (!shared)
+            {
+              apr_pool_t *item_pool
+                = svn_object_pool__new_item_pool(authz_pool);
+              authz_full_t *add_ref = NULL;
+
+              /* Make sure the underlying full authz object lives as long as
+               * the filtered one that we are about to create.  We do this by
+               * adding a reference to it in ITEM_POOL (which may live longer
+               * than AUTHZ).
+               *
+               * Note that we already have a reference to that full authz in
+               * AUTHZ->FULL. Assert that we actually don't created multiple
+               * instances of the same full model.
+               */
+              svn_error_clear(svn_object_pool__lookup((void **)&add_ref,
+                                                      authz_pool,
+                                                      authz->authz_id,
+                                                      item_pool));
+              SVN_ERR_ASSERT(add_ref == authz->full);
+
+              /* Now construct the new filtered tree and cache it.  Since
+               * equal fingerprints imply equivalent rules, the decision
+               * cache will remain valid for all users of this tree. */
+              SVN_ERR(create_filtered_tree(&shared, authz->full, repos_name,
+                                           user, TRUE, item_pool,
+                                           scratch_pool));
+              svn_error_clear(svn_object_pool__insert((void **)&shared,
+                                                      filtered_pool,
+                                                      shared_key, shared,
+                                                      item_pool, alias_pool));
+            }
+
+          tree = apr_pmemdup(alias_pool, shared, sizeof(*shared));
+          svn_error_clear(svn_object_pool__insert((void **)&tree,
+                                                  filtered_pool, key, tree,
+                                                  alias_pool, pool));
         }
      }
   else
     {
-      root = create_user_authz(authz->full, repos_name, user, pool,
-                               scratch_pool);
+      SVN_ERR(create_filtered_tree(&tree, authz->full, repos_name, user,
+                                   FALSE, pool, scratch_pool));
     }
 
   /* Write a new entry. */
-  authz->filtered->root = root;
+  authz->filtered->root = tree->root;
+  authz->filtered->decisions = tree->decisions;
 
   return SVN_NO_ERROR;
 }
 
 
 
+/*** Reloading in the background. ***/
+
+/* Upper limit to the size of an AUTHZ_ID. */
+#define MAX_AUTHZ_ID_SIZE (2 * APR_MD5_DIGESTSIZE)
+
+/* The most recent authz model read from a given rules / groups file
+ * combination.  While its successor gets parsed in the background,
+ * requests will still be answered using this model. */
+typedef struct authz_snapshot_t
+{
+  /* AUTHZ_POOL key of AUTHZ.  Empty if there is no snapshot, yet. */
+  svn_membuf_t authz_id;
+
+  /* The latest model.  POOL holds a reference to it. */
+  authz_full_t *authz;
+
+  /* Root pool holding the reference to AUTHZ; NULL if there is none. */
+  apr_pool_t *pool;
+
+  /* AUTHZ_ID of the model currently being parsed.  Empty, if none. */
+  svn_membuf_t pending_id;
+
+  /* AUTHZ_ID of the latest model that failed to parse in the background.
+   * We parse it in the foreground instead to report the error. */
+  svn_membuf_t failed_id;
+} authz_snapshot_t;
+
+/* A model to parse in the background. */
+typedef struct reload_job_t
+{
+  /* The snapshot to update. */
+  authz_snapshot_t *snapshot;
+
+  /* Key and contents of the model to parse.  GROUPS may be NULL. */
+  svn_membuf_t *authz_id;
+  svn_stringbuf_t *rules;
+  svn_stringbuf_t *groups;
+
+  /* Thread-safe root pool containing this job. */
+  apr_pool_t *pool;
+} reload_job_t;
+
+/* Return TRUE, if the AUTHZ_POOL keys LHS and RHS are equal. */
+static svn_boolean_t
+same_authz_id(const svn_membuf_t *lhs,
+              const svn_membuf_t *rhs)
+{
+  return lhs->size == rhs->size
+      && memcmp(lhs->data, rhs->data, lhs->size) == 0;
+}
+
+/* Copy the AUTHZ_POOL key SOURCE into TARGET. */
+static void
+set_authz_id(svn_membuf_t *target,
+             const svn_membuf_t *source)
+{
+  memcpy(target->data, source->data, source->size);
+  target->size = source->size;
+}
+
+/* Return the snapshot for the PATH / GROUPS_PATH combination, creating
+ * an empty one as necessary.  The caller must hold SNAPSHOTS_MUTEX. */
+static authz_snapshot_t *
+get_snapshot(const char *path,
+             const char *groups_path,
+             apr_pool_t *scratch_pool)
+{
+  const char *key = apr_pstrcat(scratch_pool, path, "\n",
+                                groups_path ? groups_path : "",
+                                SVN_VA_NULL);
+  authz_snapshot_t *snapshot = svn_hash_gets(snapshots, key);
+
+  if (!snapshot)
+    {
+      snapshot = apr_pcalloc(snapshots_pool, sizeof(*snapshot));
+      svn_membuf__create(&snapshot->authz_id, MAX_AUTHZ_ID_SIZE,
+                         snapshots_pool);
+      svn_membuf__create(&snapshot->pending_id, MAX_AUTHZ_ID_SIZE,
+                         snapshots_pool);
+      svn_membuf__create(&snapshot->failed_id, MAX_AUTHZ_ID_SIZE,
+                         snapshots_pool);
+      snapshot->authz_id.size = 0;
+      snapshot->pending_id.size = 0;
+      snapshot->failed_id.size = 0;
+
+      svn_hash_sets(snapshots, apr_pstrdup(snapshots_pool, key), snapshot);
+    }
+
+  return snapshot;
+}
+
+/* Make AUTHZ with key AUTHZ_ID the latest model in SNAPSHOT, unless it
+ * already is.  The caller must hold SNAPSHOTS_MUTEX. */
+static svn_error_t *
+update_snapshot(authz_snapshot_t *snapshot,
+                const svn_membuf_t *authz_id,
+                authz_full_t *authz)
+{
+  apr_pool_t *pool;
+  authz_full_t *add_ref = NULL;
+
+  if (same_authz_id(&snapshot->authz_id, authz_id))
+    return SVN_NO_ERROR;
+
+  /* Keep the new model alive while it is in use as a snapshot.  The
+   * pool may be destroyed by whatever thread replaces the snapshot. */
+  pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  SVN_ERR(svn_object_pool__lookup((void **)&add_ref, authz_pool,
+                                  (svn_membuf_t *)authz_id, pool));
+  if (add_ref != authz)
+    {
+      svn_pool_destroy(pool);
+      return SVN_NO_ERROR;
+    }
+
+  if (snapshot->pool)
+    svn_pool_destroy(snapshot->pool);
+
+  snapshot->pool = pool;
+  snapshot->authz = authz;
+  set_authz_id(&snapshot->authz_id, authz_id);
+
+  return SVN_NO_ERROR;
+}
+
+/* Remember AUTHZ with key AUTHZ_ID as the latest model read from PATH and
+ * GROUPS_PATH.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+remember_snapshot(const char *path,
+                  const char *groups_path,
+                  const svn_membuf_t *authz_id,
+                  authz_full_t *authz,
+                  apr_pool_t *scratch_pool)
+{
+  SVN_MUTEX__WITH_LOCK(snapshots_mutex,
+                       update_snapshot(get_snapshot(path, groups_path,
+                                                    scratch_pool),
+                                       authz_id, authz));
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* Parse the model described by the reload_job_t in DATA and make it the
+ * latest snapshot.  Implements apr_thread_start_t. */
+static void * APR_THREAD_FUNC
+reload_authz(apr_thread_t *thread,
+             void *data)
+{
+  reload_job_t *job = data;
+  apr_pool_t *item_pool = svn_object_pool__new_item_pool(authz_pool);
+  apr_pool_t *ref_pool = svn_pool_create(job->pool);
+  authz_full_t *authz;
+  svn_error_t *err;
+
+  err = svn_authz__parse(&authz,
+                         svn_stream_from_stringbuf(job->rules, job->pool),
+                         job->groups
+                           ? svn_stream_from_stringbuf(job->groups, job->pool)
+                           : NULL,
+                         item_pool, job->pool);
+  if (err)
+    svn_pool_destroy(item_pool);
+  else
+    err = svn_object_pool__insert((void **)&authz, authz_pool, job->authz_id,
+                                  authz, item_pool, ref_pool);
+
+  svn_error_clear(svn_mutex__lock(snapshots_mutex));
+
+  if (err)
+    set_authz_id(&job->snapshot->failed_id, job->authz_id);
+  else
+    err = update_snapshot(job->snapshot, job->authz_id, authz);
+
+  job->snapshot->pending_id.size = 0;
+  svn_error_clear(svn_mutex__unlock(snapshots_mutex, SVN_NO_ERROR));
+
+  /* There is nobody to report errors to.  Foreground parsers will. */
+  svn_error_clear(err);
+  svn_pool_destroy(job->pool);
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+#endif
+
+/* If there is an older snapshot of the model read from PATH and
+ * GROUPS_PATH, make sure that the model with key *AUTHZ_ID, given by
+ * RULES_STREAM and GROUPS_STREAM, gets parsed in the background and return
+ * the older model in *AUTHZ_P and its key in *AUTHZ_ID, allocated in
+ * RESULT_POOL.  Otherwise, set *AUTHZ_P to NULL.  GROUPS_STREAM may be
+ * NULL.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+use_snapshot(authz_full_t **authz_p,
+             svn_membuf_t **authz_id,
+             const char *path,
+             const char *groups_path,
+             svn_stream_t *rules_stream,
+             svn_stream_t *groups_stream,
+             apr_pool_t *result_pool,
+             apr_pool_t *scratch_pool)
+{
+#if APR_HAS_THREADS
+  authz_snapshot_t *snapshot;
+  svn_membuf_t *snapshot_id = NULL;
+  svn_boolean_t start_job = FALSE;
+
+  *authz_p = NULL;
+
+  SVN_ERR(svn_mutex__lock(snapshots_mutex));
+  snapshot = get_snapshot(path, groups_path, scratch_pool);
+  if (   snapshot->authz
+      && (*authz_id)->size <= MAX_AUTHZ_ID_SIZE
+      && !same_authz_id(&snapshot->failed_id, *authz_id))
+    {
+      snapshot_id = apr_pcalloc(result_pool, sizeof(*snapshot_id));
+      svn_membuf__create(snapshot_id, snapshot->authz_id.size, result_pool);
+      set_authz_id(snapshot_id, &snapshot->authz_id);
+
+      if (!same_authz_id(&snapshot->pending_id, *authz_id))
+        {
+          /* Only one parser per file at a time. */
+          start_job = snapshot->pending_id.size == 0;
+          if (start_job)
+            set_authz_id(&snapshot->pending_id, *authz_id);
+        }
+    }
+  SVN_ERR(svn_mutex__unlock(snapshots_mutex, SVN_NO_ERROR));
+
+  if (!snapshot_id)
+    return SVN_NO_ERROR;
+
+  if (start_job)
+    {
+      apr_pool_t *pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+      reload_job_t *job = apr_pcalloc(pool, sizeof(*job));
+      apr_threadattr_t *attr;
+      apr_thread_t *thread;
+      apr_status_t status;
+      svn_error_t *err;
+
+      job->snapshot = snapshot;
+      job->pool = pool;
+      job->authz_id = apr_pcalloc(pool, sizeof(*job->authz_id));
+      svn_membuf__create(job->authz_id, (*authz_id)->size, pool);
+      set_authz_id(job->authz_id, *authz_id);
+
+      err = svn_stringbuf_from_stream(&job->rules, rules_stream, 0, pool);
+      if (!err && groups_stream)
+        err = svn_stringbuf_from_stream(&job->groups, groups_stream, 0,
+                                        pool);
+
+      status = apr_threadattr_create(&attr, pool);
+      if (!status)
+        status = apr_threadattr_detach_set(attr, 1);
+      if (!status && !err)
+        status = apr_thread_create(&thread, attr, reload_authz, job, pool);
+
+      if (status || err)
+        {
+          /* Parse in the foreground instead. */
+          svn_error_clear(svn_mutex__lock(snapshots_mutex));
+          snapshot->pending_id.size = 0;
+          svn_error_clear(svn_mutex__unlock(snapshots_mutex, SVN_NO_ERROR));
+
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+    }
+
+  /* The snapshot holds a reference, so this will succeed unless it has
+   * been replaced in the meantime.  Then, we simply parse ourselves. */
+  SVN_ERR(svn_object_pool__lookup((void **)authz_p, authz_pool, snapshot_id,
+                                  result_pool));
+  if (*authz_p)
+    *authz_id = snapshot_id;
+#else
+  *authz_p = NULL;
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+
+
 /* Read authz configuration data from PATH into *AUTHZ_P, allocated in
    RESULT_POOL.  Return the cache key in *AUTHZ_ID.  If GROUPS_PATH is set,
    use the global groups parsed from it.  Use SCRATCH_POOL for temporary
@@ -1540,13 +2096,18 @@ filter_tree(svn_authz_t *authz,
    If PATH or GROUPS_PATH is not a valid authz rule file, then return
    SVN_AUTHZ_INVALID_CONFIG.  The contents of *AUTHZ_P is then
    undefined.  If MUST_EXIST is TRUE, a missing authz or global groups file
-   is also an error. */
+   is also an error.
+
+   If RELOAD_IN_BACKGROUND is set and the authz cache is being used, a
+   changed PATH or GROUPS_PATH will be parsed in a separate thread while
+   the previous model gets returned. */
 static svn_error_t *
 authz_read(authz_full_t **authz_p,
            svn_membuf_t **authz_id,
            const char *path,
            const char *groups_path,
            svn_boolean_t must_exist,
+           svn_boolean_t reload_in_background,
            svn_repos_t *repos_hint,
            apr_pool_t *result_pool,
            apr_pool_t *scratch_pool)
@@ -1579,6 +2140,12 @@ authz_read(authz_full_t **authz_p,
       SVN_ERR(svn_object_pool__lookup((void **)authz_p, authz_pool,
                                       *authz_id, result_pool));
 
+      /* Keep using the previous model while parsing the new one? */
+      if (!*authz_p && reload_in_background)
+        SVN_ERR(use_snapshot(authz_p, authz_id, path, groups_path,
+                             rules_stream, groups_stream, result_pool,
+                             scratch_pool));
+
       /* If not found, parse and add to cache. */
       if (!*authz_p)
         {
@@ -1604,6 +2171,9 @@ authz_read(authz_full_t **authz_p,
               SVN_ERR(svn_object_pool__insert((void **)authz_p, authz_pool,
                                               *authz_id, *authz_p,
                                               item_pool, result_pool));
+              if (reload_in_background)
+                SVN_ERR(remember_snapshot(path, groups_path, *authz_id,
+                                          *authz_p, scratch_pool));
             }
         }
     }
@@ -1628,10 +2198,11 @@ authz_read(authz_full_t **authz_p,
 /*** Public functions. ***/
 
 svn_error_t *
-svn_repos_authz_read3(svn_authz_t **authz_p,
+svn_repos__authz_read(svn_authz_t **authz_p,
                       const char *path,
                       const char *groups_path,
                       svn_boolean_t must_exist,
+                      svn_boolean_t reload_in_background,
                       svn_repos_t *repos_hint,
                       apr_pool_t *result_pool,
                       apr_pool_t *scratch_pool)
@@ -1640,12 +2211,27 @@ svn_repos_authz_read3(svn_authz_t **authz_p,
   authz->pool = result_pool;
 
   SVN_ERR(authz_read(&authz->full, &authz->authz_id, path, groups_path,
-                     must_exist, repos_hint, result_pool, scratch_pool));
+                     must_exist, reload_in_background, repos_hint,
+                     result_pool, scratch_pool));
 
   *authz_p = authz;
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_repos_authz_read3(svn_authz_t **authz_p,
+                      const char *path,
+                      const char *groups_path,
+                      svn_boolean_t must_exist,
+                      svn_repos_t *repos_hint,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  return svn_error_trace(svn_repos__authz_read(authz_p, path, groups_path,
+                                               must_exist, FALSE, repos_hint,
+                                               result_pool, scratch_pool));
+}
+
 
 svn_error_t *
 svn_repos_authz_parse(svn_authz_t **authz_p, svn_stream_t *stream,
@@ -1675,6 +2261,9 @@ svn_repos_authz_check_access(svn_authz_t *authz, const char *repos_name,
   const authz_access_t required =
     ((required_access & svn_authz_read ? authz_access_read_flag : 0)
      | (required_access & svn_authz_write ? authz_access_write_flag : 0));
+  const svn_boolean_t recursive = !!(required_access & svn_authz_recursive);
+  const char *remainder;
+  const char *key = NULL;
 
   /* Pick or create the suitable pre-filtered path rule tree. */
   authz_user_rules_t *rules = get_user_rules(
@@ -1713,17 +2302,35 @@ svn_repos_authz_check_access(svn_authz_t *authz, const char *repos_name,
   if (!rules->root)
     SVN_ERR(filter_tree(authz, pool));
 
-  /* Re-use previous lookup results, if possible. */
-  path = init_lockup_state(authz->filtered->lookup_state,
-                           authz->filtered->root, path);
-
   /* Sanity check. */
   SVN_ERR_ASSERT(path[0] == '/');
 
+  /* Maybe, we did this lookup before. */
+  if (rules->decisions)
+    {
+      svn_boolean_t *decision, found;
+
+      key = construct_decision_key(path, required, recursive, pool);
+      SVN_ERR(svn_cache__get((void **)&decision, &found, rules->decisions,
+                             key, pool));
+      if (found)
+        {
+          *access_granted = *decision;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  /* Re-use previous lookup results, if possible. */
+  remainder = init_lockup_state(authz->filtered->lookup_state,
+                                authz->filtered->root, path);
+
   /* Determine the granted access for the requested path.
    * PATH does not need to be normalized for lockup(). */
-  *access_granted = lookup(rules->lookup_state, path, required,
-                           !!(required_access & svn_authz_recursive), pool);
+  *access_granted = lookup(rules->lookup_state, remainder, required,
+                           recursive, pool);
+
+  if (key)
+    SVN_ERR(svn_cache__set(rules->decisions, key, access_granted, pool));
 
   return SVN_NO_ERROR;
 }
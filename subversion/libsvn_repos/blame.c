@@ -0,0 +1,758 @@
+/* blame.c : attributing the lines of a file to revisions
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_pools.h>
+
+#include "svn_delta.h"
+#include "svn_diff.h"
+#include "svn_error.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_props.h"
+#include "svn_repos.h"
+#include "svn_sorts.h"
+
+#include "repos.h"
+#include "private/svn_cache.h"
+#include "private/svn_repos_private.h"
+#include "svn_private_config.h"
+
+/* This is the algorithm of svn_client_blame5(), without the merge
+   tracking, run next to the repository.  Clients then only need to
+   receive the final attribution instead of every revision of the file.
+
+   The attribution of a file revision never changes.  We keep it in the
+   membuffer cache, keyed by node-revision, so that blaming a later
+   revision only needs to process the revisions committed since then. */
+
+/* A revision that lines may be attributed to. */
+typedef struct blame_rev_t
+{
+  /* SVN_INVALID_REVNUM for changes before the start of the range. */
+  svn_revnum_t revision;
+
+  /* NULL for changes before the start of the range. */
+  apr_hash_t *rev_props;
+} blame_rev_t;
+
+/* A range of lines that were last changed in the same revision. */
+typedef struct blame_chunk_t
+{
+  /* The revision responsible for the lines. */
+  const blame_rev_t *rev;
+
+  /* The first line of the chunk.  The chunk extends up to the start of
+     the next one or to the end of the file. */
+  apr_off_t start;
+
+  struct blame_chunk_t *next;
+} blame_chunk_t;
+
+/* A range of lines as stored in the cache. */
+typedef struct cached_chunk_t
+{
+  /* The first line of the range. */
+  apr_int64_t start;
+
+  /* SVN_INVALID_REVNUM for changes before the start of the range. */
+  svn_revnum_t revision;
+} cached_chunk_t;
+
+/* Baton used during the whole svn_repos__blame() operation. */
+typedef struct blame_baton_t
+{
+  svn_fs_t *fs;
+
+  /* First revision to attribute lines to. */
+  svn_revnum_t start;
+
+  /* If not NULL, the attribution of the first revision to be added as
+     cached_chunk_t elements.  Used instead of attributing all lines of
+     that revision to itself. */
+  const apr_array_header_t *seed;
+
+  const svn_diff_file_options_t *diff_options;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* The current attribution in line order, and recycled chunks. */
+  blame_chunk_t *chunks;
+  blame_chunk_t *avail;
+
+  /* The revision currently being added. */
+  const blame_rev_t *rev;
+
+  /* Temporary files with the contents of the previous and the current
+     revision of the file.  They get removed with LASTPOOL and CURRPOOL,
+     respectively.  The two pools are swapped for every revision. */
+  const char *last_filename;
+  const char *filename;
+  apr_pool_t *lastpool;
+  apr_pool_t *currpool;
+
+  /* For everything that lives during the whole operation. */
+  apr_pool_t *pool;
+} blame_baton_t;
+
+/* Baton for window_handler(), one per revision. */
+typedef struct delta_baton_t
+{
+  svn_txdelta_window_handler_t wrapped_handler;
+  void *wrapped_baton;
+
+  /* The delta source, i.e. the contents of the previous revision. */
+  svn_stream_t *source;
+
+  blame_baton_t *bb;
+} delta_baton_t;
+
+/* Return a chunk of lines attributed to REV, starting at line START. */
+static blame_chunk_t *
+chunk_create(blame_baton_t *bb,
+             const blame_rev_t *rev,
+             apr_off_t start)
+{
+  blame_chunk_t *chunk;
+
+  if (bb->avail)
+    {
+      chunk = bb->avail;
+      bb->avail = chunk->next;
+    }
+  else
+    chunk = apr_palloc(bb->pool, sizeof(*chunk));
+
+  chunk->rev = rev;
+  chunk->start = start;
+  chunk->next = NULL;
+
+  return chunk;
+}
+
+/* Make CHUNK available for reuse. */
+static void
+chunk_destroy(blame_baton_t *bb,
+              blame_chunk_t *chunk)
+{
+  chunk->next = bb->avail;
+  bb->avail = chunk;
+}
+
+/* Return the chunk in the list starting at CHUNK that contains line OFF. */
+static blame_chunk_t *
+chunk_find(blame_chunk_t *chunk,
+           apr_off_t off)
+{
+  blame_chunk_t *prev = NULL;
+
+  while (chunk && chunk->start <= off)
+    {
+      prev = chunk;
+      chunk = chunk->next;
+    }
+
+  return prev;
+}
+
+/* Move CHUNK and all chunks following it by ADJUST lines. */
+static void
+chunk_adjust(blame_chunk_t *chunk,
+             apr_off_t adjust)
+{
+  for (; chunk; chunk = chunk->next)
+    chunk->start += adjust;
+}
+
+/* Remove the attribution of the LENGTH lines starting at line START. */
+static void
+delete_range(blame_baton_t *bb,
+             apr_off_t start,
+             apr_off_t length)
+{
+  blame_chunk_t *first = chunk_find(bb->chunks, start);
+  blame_chunk_t *last = chunk_find(bb->chunks, start + length);
+  blame_chunk_t *tail = last->next;
+
+  if (first != last)
+    {
+      blame_chunk_t *walk = first->next;
+      while (walk != last)
+        {
+          blame_chunk_t *next = walk->next;
+          chunk_destroy(bb, walk);
+          walk = next;
+        }
+
+      first->next = last;
+      last->start = start;
+      if (first->start == start)
+        {
+          *first = *last;
+          chunk_destroy(bb, last);
+          last = first;
+        }
+    }
+
+  if (tail && tail->start == last->start + length)
+    {
+      *last = *tail;
+      chunk_destroy(bb, tail);
+      tail = last->next;
+    }
+
+  chunk_adjust(tail, -length);
+}
+
+/* Attribute LENGTH new lines starting at line START to BB->REV. */
+static void
+insert_range(blame_baton_t *bb,
+             apr_off_t start,
+             apr_off_t length)
+{
+  blame_chunk_t *point = chunk_find(bb->chunks, start);
+  blame_chunk_t *insert;
+
+  if (point->start == start)
+    {
+      insert = chunk_create(bb, point->rev, point->start + length);
+      point->rev = bb->rev;
+      insert->next = point->next;
+      point->next = insert;
+    }
+  else
+    {
+      blame_chunk_t *middle = chunk_create(bb, bb->rev, start);
+      insert = chunk_create(bb, point->rev, start + length);
+      middle->next = insert;
+      insert->next = point->next;
+      point->next = middle;
+    }
+
+  chunk_adjust(insert->next, length);
+}
+
+/* Implements svn_diff_output_fns_t.output_diff_modified for the diff
+   between two subsequent revisions. */
+static svn_error_t *
+output_diff_modified(void *baton,
+                     apr_off_t original_start,
+                     apr_off_t original_length,
+                     apr_off_t modified_start,
+                     apr_off_t modified_length,
+                     apr_off_t latest_start,
+                     apr_off_t latest_length)
+{
+  blame_baton_t *bb = baton;
+
+  if (original_length)
+    delete_range(bb, modified_start, original_length);
+
+  if (modified_length)
+    insert_range(bb, modified_start, modified_length);
+
+  return SVN_NO_ERROR;
+}
+
+static const svn_diff_output_fns_t output_fns = {
+  NULL,
+  output_diff_modified
+};
+
+/* Set BB->CHUNKS to the attribution in SEED, given as cached_chunk_t
+   elements, and fetch the revision properties for it. */
+static svn_error_t *
+chunks_from_cache(blame_baton_t *bb,
+                  const apr_array_header_t *seed)
+{
+  apr_hash_t *revs = apr_hash_make(bb->currpool);
+  blame_chunk_t *last = NULL;
+  int i;
+
+  for (i = 0; i < seed->nelts; ++i)
+    {
+      const cached_chunk_t *cached = &APR_ARRAY_IDX(seed, i, cached_chunk_t);
+      blame_rev_t *rev = apr_hash_get(revs, &cached->revision,
+                                      sizeof(cached->revision));
+      blame_chunk_t *chunk;
+
+      if (!rev)
+        {
+          rev = apr_pcalloc(bb->pool, sizeof(*rev));
+          rev->revision = cached->revision;
+          if (SVN_IS_VALID_REVNUM(rev->revision))
+            SVN_ERR(svn_fs_revision_proplist2(&rev->rev_props, bb->fs,
+                                              rev->revision, FALSE,
+                                              bb->pool, bb->currpool));
+
+          apr_hash_set(revs, &rev->revision, sizeof(rev->revision), rev);
+        }
+
+      chunk = chunk_create(bb, rev, (apr_off_t)cached->start);
+      if (last)
+        last->next = chunk;
+      else
+        bb->chunks = chunk;
+
+      last = chunk;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Update the attribution in BB with the changes between BB->LAST_FILENAME
+   and BB->FILENAME, then prepare for the next revision. */
+static svn_error_t *
+add_revision(blame_baton_t *bb)
+{
+  apr_pool_t *pool;
+
+  if (!bb->last_filename)
+    {
+      if (bb->seed)
+        SVN_ERR(chunks_from_cache(bb, bb->seed));
+      else
+        bb->chunks = chunk_create(bb, bb->rev, 0);
+    }
+  else
+    {
+      svn_diff_t *diff;
+
+      SVN_ERR(svn_diff_file_diff_2(&diff, bb->last_filename, bb->filename,
+                                   bb->diff_options, bb->currpool));
+      SVN_ERR(svn_diff_output2(diff, bb, &output_fns,
+                               bb->cancel_func, bb->cancel_baton));
+    }
+
+  bb->last_filename = bb->filename;
+
+  pool = bb->lastpool;
+  bb->lastpool = bb->currpool;
+  bb->currpool = pool;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_txdelta_window_handler_t.  Reconstruct the current
+   revision of the file and add it to the attribution once complete. */
+static svn_error_t *
+window_handler(svn_txdelta_window_t *window,
+               void *baton)
+{
+  delta_baton_t *db = baton;
+
+  SVN_ERR(db->wrapped_handler(window, db->wrapped_baton));
+  if (window)
+    return SVN_NO_ERROR;
+
+  /* Close the source before its file may get removed. */
+  SVN_ERR(svn_stream_close(db->source));
+
+  return svn_error_trace(add_revision(db->bb));
+}
+
+/* Implements svn_file_rev_handler_t. */
+static svn_error_t *
+file_rev_handler(void *baton,
+                 const char *path,
+                 svn_revnum_t revnum,
+                 apr_hash_t *rev_props,
+                 svn_boolean_t merged_revision,
+                 svn_txdelta_window_handler_t *content_delta_handler,
+                 void **content_delta_baton,
+                 apr_array_header_t *prop_diffs,
+                 apr_pool_t *pool)
+{
+  blame_baton_t *bb = baton;
+  blame_rev_t *rev;
+  delta_baton_t *db;
+  svn_stream_t *target;
+
+  if (bb->cancel_func)
+    SVN_ERR(bb->cancel_func(bb->cancel_baton));
+
+  /* Revisions that did not change the contents don't change the
+     attribution, either. */
+  if (!content_delta_handler)
+    return SVN_NO_ERROR;
+
+  svn_pool_clear(bb->currpool);
+
+  /* The file revision before START only provides the base line. */
+  rev = apr_pcalloc(bb->pool, sizeof(*rev));
+  if (revnum >= bb->start)
+    {
+      rev->revision = revnum;
+      rev->rev_props = svn_prop_hash_dup(rev_props, bb->pool);
+    }
+  else
+    rev->revision = SVN_INVALID_REVNUM;
+
+  bb->rev = rev;
+
+  db = apr_pcalloc(bb->currpool, sizeof(*db));
+  db->bb = bb;
+  if (bb->last_filename)
+    SVN_ERR(svn_stream_open_readonly(&db->source, bb->last_filename,
+                                     bb->currpool, pool));
+  else
+    db->source = svn_stream_empty(bb->currpool);
+
+  SVN_ERR(svn_stream_open_unique(&target, &bb->filename, NULL,
+                                 svn_io_file_del_on_pool_cleanup,
+                                 bb->currpool, pool));
+
+  svn_txdelta_apply(svn_stream_disown(db->source, bb->currpool), target,
+                    NULL, NULL, bb->currpool,
+                    &db->wrapped_handler, &db->wrapped_baton);
+
+  *content_delta_handler = window_handler;
+  *content_delta_baton = db;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__serialize_func_t for arrays of cached_chunk_t. */
+static svn_error_t *
+serialize_chunks(void **data,
+                 apr_size_t *data_len,
+                 void *in,
+                 apr_pool_t *pool)
+{
+  apr_array_header_t *chunks = in;
+
+  *data = chunks->elts;
+  *data_len = chunks->nelts * sizeof(cached_chunk_t);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__deserialize_func_t for arrays of cached_chunk_t. */
+static svn_error_t *
+deserialize_chunks(void **out,
+                   void *data,
+                   apr_size_t data_len,
+                   apr_pool_t *result_pool)
+{
+  apr_array_header_t *chunks = apr_pcalloc(result_pool, sizeof(*chunks));
+
+  if (data_len == 0 || data_len % sizeof(cached_chunk_t))
+    return svn_error_create(SVN_ERR_CORRUPT_PACKED_DATA, NULL,
+                            _("Malformed blame cache entry"));
+
+  /* DATA has been allocated in RESULT_POOL and belongs to us. */
+  chunks->pool = result_pool;
+  chunks->elt_size = sizeof(cached_chunk_t);
+  chunks->nelts = (int)(data_len / sizeof(cached_chunk_t));
+  chunks->nalloc = chunks->nelts;
+  chunks->elts = data;
+
+  *out = chunks;
+  return SVN_NO_ERROR;
+}
+
+/* Set *CACHE to the blame cache of REPOS, creating it if necessary.  Set
+   it to NULL if caching is disabled.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+get_blame_cache(svn_cache__t **cache,
+                svn_repos_t *repos,
+                apr_pool_t *scratch_pool)
+{
+  if (repos->blame == NULL)
+    {
+      svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+      const char *uuid;
+
+      if (membuffer == NULL)
+        {
+          *cache = NULL;
+          return SVN_NO_ERROR;
+        }
+
+      /* Node-revision IDs are only unique within a repository.  See
+         get_mergeinfo_changes_cache() in log.c. */
+      SVN_ERR(svn_fs_get_uuid(repos->fs, &uuid, scratch_pool));
+      SVN_ERR(svn_cache__create_membuffer_cache(
+                  &repos->blame,
+                  membuffer,
+                  serialize_chunks,
+                  deserialize_chunks,
+                  APR_HASH_KEY_STRING,
+                  apr_pstrcat(scratch_pool, "svn-repos:blame:",
+                              uuid, ":", repos->path, SVN_VA_NULL),
+                  SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                  FALSE, FALSE,
+                  repos->pool, scratch_pool));
+    }
+
+  *cache = repos->blame;
+  return SVN_NO_ERROR;
+}
+
+/* Return the key for the attribution of the node-revision at PATH in ROOT,
+   starting at revision START and using DIFF_OPTIONS. */
+static svn_error_t *
+cache_key(const char **key,
+          svn_fs_root_t *root,
+          const char *path,
+          svn_revnum_t start,
+          const svn_diff_file_options_t *diff_options,
+          apr_pool_t *result_pool,
+          apr_pool_t *scratch_pool)
+{
+  const svn_fs_id_t *id;
+
+  SVN_ERR(svn_fs_node_id(&id, root, path, scratch_pool));
+  *key = apr_psprintf(result_pool, "%ld:%d:%d:%s", start,
+                      (int)diff_options->ignore_space,
+                      diff_options->ignore_eol_style,
+                      svn_fs_unparse_id(id, scratch_pool)->data);
+
+  return SVN_NO_ERROR;
+}
+
+/* Walk the history of PATH@END back to START in REPOS, like
+   svn_repos_get_file_revs2() would, and look for the newest node-revision
+   whose attribution is in CACHE.  If there is one, set *SEED to it and
+   *SEED_REV to the revision that node-revision was created in.  Otherwise,
+   set *SEED to NULL.  Set *LATEST to TRUE if it is the node-revision at
+   END.  Set *END_KEY to the cache key for the node-revision at END.
+
+   Set *COMPLETE to FALSE if AUTHZ_READ_FUNC denies access to any part of
+   the history.  Cached attributions may then not be used and the result
+   must not be cached.
+
+   Allocate the results in RESULT_POOL. */
+static svn_error_t *
+find_cached_blame(const apr_array_header_t **seed,
+                  svn_revnum_t *seed_rev,
+                  svn_boolean_t *latest,
+                  const char **end_key,
+                  svn_boolean_t *complete,
+                  svn_cache__t *cache,
+                  svn_repos_t *repos,
+                  const char *path,
+                  svn_revnum_t start,
+                  svn_revnum_t end,
+                  const svn_diff_file_options_t *diff_options,
+                  svn_repos_authz_func_t authz_read_func,
+                  void *authz_read_baton,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_pool_t *last_pool = svn_pool_create(scratch_pool);
+  svn_fs_history_t *history;
+  svn_fs_root_t *root;
+  svn_node_kind_t kind;
+  svn_revnum_t base = MAX(0, start - 1);
+
+  *seed = NULL;
+  *latest = FALSE;
+  *end_key = NULL;
+  *complete = TRUE;
+
+  /* Let svn_repos_get_file_revs2() report invalid paths. */
+  SVN_ERR(svn_fs_revision_root(&root, repos->fs, end, scratch_pool));
+  SVN_ERR(svn_fs_check_path(&kind, root, path, scratch_pool));
+  if (kind != svn_node_file)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_node_history2(&history, root, path, scratch_pool,
+                               scratch_pool));
+  while (1)
+    {
+      const char *history_path;
+      svn_revnum_t history_rev;
+      svn_fs_root_t *history_root;
+      apr_pool_t *tmp_pool;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_history_prev2(&history, history, TRUE, iterpool,
+                                   iterpool));
+      if (!history)
+        break;
+
+      SVN_ERR(svn_fs_history_location(&history_path, &history_rev,
+                                      history, iterpool));
+      SVN_ERR(svn_fs_revision_root(&history_root, repos->fs, history_rev,
+                                   iterpool));
+
+      if (authz_read_func)
+        {
+          svn_boolean_t readable;
+
+          SVN_ERR(authz_read_func(&readable, history_root, history_path,
+                                  authz_read_baton, iterpool));
+          if (!readable)
+            {
+              *seed = NULL;
+              *latest = FALSE;
+              *complete = FALSE;
+              break;
+            }
+        }
+
+      if (!*seed)
+        {
+          const char *key;
+          void *value;
+          svn_boolean_t found;
+
+          SVN_ERR(cache_key(&key, history_root, history_path, start,
+                            diff_options, result_pool, iterpool));
+          if (!*end_key)
+            *end_key = key;
+
+          SVN_ERR(svn_cache__get(&value, &found, cache, key, result_pool));
+          if (found)
+            {
+              *seed = value;
+              *seed_rev = history_rev;
+              *latest = (key == *end_key);
+
+              /* Without authz, there is nothing left to check. */
+              if (!authz_read_func)
+                break;
+            }
+        }
+
+      if (history_rev <= base)
+        break;
+
+      /* HISTORY lives in ITERPOOL.  Keep it for the next iteration. */
+      tmp_pool = iterpool;
+      iterpool = last_pool;
+      last_pool = tmp_pool;
+    }
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(last_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Store the attribution in BB->CHUNKS in CACHE under KEY. */
+static svn_error_t *
+cache_blame(svn_cache__t *cache,
+            const char *key,
+            blame_baton_t *bb,
+            apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *chunks = apr_array_make(scratch_pool, 16,
+                                              sizeof(cached_chunk_t));
+  blame_chunk_t *chunk;
+
+  for (chunk = bb->chunks; chunk; chunk = chunk->next)
+    {
+      cached_chunk_t *cached = apr_array_push(chunks);
+      cached->start = chunk->start;
+      cached->revision = chunk->rev->revision;
+    }
+
+  return svn_error_trace(svn_cache__set(cache, key, chunks, scratch_pool));
+}
+
+svn_error_t *
+svn_repos__blame(svn_repos_t *repos,
+                 const char *path,
+                 svn_revnum_t start,
+                 svn_revnum_t end,
+                 const svn_diff_file_options_t *diff_options,
+                 svn_repos_authz_func_t authz_read_func,
+                 void *authz_read_baton,
+                 svn_repos__blame_receiver_t receiver,
+                 void *receiver_baton,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  blame_baton_t bb = { 0 };
+  blame_chunk_t *chunk;
+  apr_pool_t *iterpool;
+  svn_cache__t *cache;
+  svn_revnum_t seed_rev = SVN_INVALID_REVNUM;
+  svn_boolean_t latest = FALSE;
+  const char *end_key = NULL;
+  svn_boolean_t complete = FALSE;
+
+  if (!SVN_IS_VALID_REVNUM(start) || !SVN_IS_VALID_REVNUM(end)
+      || start > end)
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Invalid blame range r%ld:%ld"),
+                             start, end);
+
+  bb.fs = repos->fs;
+  bb.start = start;
+  bb.diff_options = diff_options;
+  bb.cancel_func = cancel_func;
+  bb.cancel_baton = cancel_baton;
+  bb.pool = scratch_pool;
+  bb.lastpool = svn_pool_create(scratch_pool);
+  bb.currpool = svn_pool_create(scratch_pool);
+
+  SVN_ERR(get_blame_cache(&cache, repos, scratch_pool));
+  if (cache)
+    SVN_ERR(find_cached_blame(&bb.seed, &seed_rev, &latest, &end_key,
+                              &complete, cache, repos, path, start, end,
+                              diff_options, authz_read_func,
+                              authz_read_baton, scratch_pool, scratch_pool));
+
+  if (latest)
+    {
+      /* Nothing changed since the cached attribution.  Report the latest
+         revprops, just like svn_repos_get_file_revs2() would. */
+      SVN_ERR(svn_fs_refresh_revision_props(repos->fs, scratch_pool));
+      SVN_ERR(chunks_from_cache(&bb, bb.seed));
+    }
+  else
+    {
+      /* Continue from the cached attribution if there is one.  Otherwise,
+         start one revision early, so we know what START actually
+         changed. */
+      SVN_ERR(svn_repos_get_file_revs2(repos, path,
+                                       bb.seed ? seed_rev : MAX(0, start - 1),
+                                       end,
+                                       FALSE /* include_merged_revisions */,
+                                       authz_read_func, authz_read_baton,
+                                       file_rev_handler, &bb, scratch_pool));
+
+      /* Failing to cache the result must not fail the blame. */
+      if (complete && end_key)
+        svn_error_clear(cache_blame(cache, end_key, &bb, scratch_pool));
+    }
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (chunk = bb.chunks; chunk; chunk = chunk->next)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(receiver(receiver_baton, chunk->start, chunk->rev->revision,
+                       chunk->rev->rev_props, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  svn_pool_destroy(bb.lastpool);
+  svn_pool_destroy(bb.currpool);
+
+  return SVN_NO_ERROR;
+}
@@ -70,8 +70,8 @@ find_config(svn_config_t **cfg,
 {
   /* First, attempt the cache lookup. */
   svn_membuf_t *key = checksum_as_key(checksum, scratch_pool);
-  SVN_ERR(svn_object_pool__lookup((void **)cfg, config_pool, key,
-                                  result_pool));
+  SVN_ERR(svn_object_pool__lookup((void **)cfg, config_pool->object_pool,
+                                  key, result_pool));
 
   /* Not found? => parse and cache */
   if (!*cfg)
@@ -79,17 +79,129 @@ find_config(svn_config_t **cfg,
       svn_config_t *config;
 
       /* create a pool for the new config object and parse the data into it */
-      apr_pool_t *cfg_pool = svn_object_pool__new_item_pool(config_pool);
+      apr_pool_t *cfg_pool
+        = svn_object_pool__new_item_pool(config_pool->object_pool);
       SVN_ERR(svn_config_parse(&config, stream, FALSE, FALSE, cfg_pool));
 
       /* switch config data to r/o mode to guarantee thread-safe access */
       svn_config__set_read_only(config, cfg_pool);
 
       /* add config in pool, handle loads races and return the right config */
-      SVN_ERR(svn_object_pool__insert((void **)cfg, config_pool, key,
-                                      config, cfg_pool, result_pool));
+      SVN_ERR(svn_object_pool__insert((void **)cfg, config_pool->object_pool,
+                                      key, config, cfg_pool, result_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Copy the file_info_t for PATH in CONFIG_POOL to *INFO and set *FOUND.
+ * If there is no such entry, set *FOUND to FALSE.  If MARK_CHECKED is not
+ * 0, store it as the entry's new check time instead.
+ *
+ * The caller must hold CONFIG_POOL's mutex.
+ */
+static svn_error_t *
+access_file_info(svn_boolean_t *found,
+                 file_info_t *info,
+                 svn_repos__config_pool_t *config_pool,
+                 const char *path,
+                 apr_time_t mark_checked)
+{
+  file_info_t *entry = svn_hash_gets(config_pool->files, path);
+
+  *found = entry != NULL;
+  if (entry && mark_checked)
+    entry->checked = mark_checked;
+  else if (entry)
+    *info = *entry;
+
+  return SVN_NO_ERROR;
+}
+
+/* Remember that the local configuration file at PATH had the timestamp
+ * and size given in FINFO, taken at STAT_TIME, before we read it and found
+ * its contents to have CHECKSUM.
+ *
+ * The caller must hold CONFIG_POOL's mutex.
+ */
+static svn_error_t *
+set_file_info(svn_repos__config_pool_t *config_pool,
+              const char *path,
+              const apr_finfo_t *finfo,
+              apr_time_t stat_time,
+              const svn_checksum_t *checksum)
+{
+  file_info_t *entry = svn_hash_gets(config_pool->files, path);
+  if (!entry)
+    {
+      entry = apr_pcalloc(config_pool->pool, sizeof(*entry));
+      svn_hash_sets(config_pool->files, apr_pstrdup(config_pool->pool, path),
+                    entry);
     }
 
+  entry->mtime = finfo->mtime;
+  entry->size = finfo->size;
+  entry->stable = stat_time - finfo->mtime >= CONFIG_FILE_TIMESTAMP_SLACK;
+  entry->checked = stat_time;
+  memcpy(entry->digest, checksum->digest, sizeof(entry->digest));
+
+  return SVN_NO_ERROR;
+}
+
+/* If the local configuration file at PATH has not changed since we last
+ * read it through CONFIG_POOL and the parsed configuration is still in
+ * the pool, set *CFG to it.  Otherwise, set *CFG to NULL and *FINFO to
+ * the file's current timestamp and size.  If we did not need to stat()
+ * the file, FINFO->VALID will be 0.
+ *
+ * RESULT_POOL determines the lifetime of the returned reference and
+ * SCRATCH_POOL is being used for temporary allocations.
+ */
+static svn_error_t *
+find_unchanged_config(svn_config_t **cfg,
+                      apr_finfo_t *finfo,
+                      svn_repos__config_pool_t *config_pool,
+                      const char *path,
+                      apr_time_t now,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  file_info_t info;
+  svn_boolean_t found;
+  svn_checksum_t checksum;
+
+  *cfg = NULL;
+  finfo->valid = 0;
+
+  SVN_MUTEX__WITH_LOCK(config_pool->mutex,
+                       access_file_info(&found, &info, config_pool, path,
+                                        0));
+
+  /* Within the TTL, we don't even look at the file.  Recently modified
+   * files have to be read again anyway. */
+  if (!found || !info.stable || now - info.checked >= CONFIG_FILE_TTL)
+    {
+      SVN_ERR(svn_io_stat(finfo, path, APR_FINFO_MTIME | APR_FINFO_SIZE,
+                          scratch_pool));
+      if (   !found
+          || !info.stable
+          || finfo->mtime != info.mtime
+          || finfo->size != info.size)
+        return SVN_NO_ERROR;
+
+      SVN_MUTEX__WITH_LOCK(config_pool->mutex,
+                           access_file_info(&found, &info, config_pool, path,
+                                            now));
+    }
+
+  /* The file did not change but its configuration may have been dropped
+   * from the object pool in the meantime. */
+  checksum.digest = info.digest;
+  checksum.kind = svn_checksum_md5;
+  SVN_ERR(svn_object_pool__lookup((void **)cfg, config_pool->object_pool,
+                                  checksum_as_key(&checksum, scratch_pool),
+                                  result_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -100,8 +212,15 @@ svn_repos__config_pool_create(svn_repos__config_pool_t **config_pool,
                               svn_boolean_t thread_safe,
                               apr_pool_t *pool)
 {
-  return svn_error_trace(svn_object_pool__create(config_pool,
-                                                 thread_safe, pool));
+  svn_repos__config_pool_t *result = apr_pcalloc(pool, sizeof(*result));
+
+  SVN_ERR(svn_object_pool__create(&result->object_pool, thread_safe, pool));
+  SVN_ERR(svn_mutex__init(&result->mutex, thread_safe, pool));
+  result->files = apr_hash_make(pool);
+  result->pool = pool;
+
+  *config_pool = result;
+  return SVN_NO_ERROR;
 }
 
 svn_error_t *
@@ -114,12 +233,38 @@ svn_repos__config_pool_get(svn_config_t **cfg,
 {
   svn_error_t *err = SVN_NO_ERROR;
   apr_pool_t *scratch_pool = svn_pool_create(pool);
-  config_access_t *access = svn_repos__create_config_access(preferred_repos,
-                                                            scratch_pool);
+  config_access_t *access;
   svn_stream_t *stream;
   svn_checksum_t *checksum;
+  apr_finfo_t finfo;
+  apr_time_t now = apr_time_now();
+  svn_boolean_t is_url = svn_path_is_url(path);
 
   *cfg = NULL;
+  finfo.valid = 0;
+
+  /* Serve unchanged local files without reading them.  Any problem here
+   * will be reported by the standard code path below. */
+  if (!is_url)
+    {
+      svn_error_clear(find_unchanged_config(cfg, &finfo, config_pool, path,
+                                            now, pool, scratch_pool));
+      if (*cfg)
+        {
+          svn_pool_destroy(scratch_pool);
+          *cfg = svn_config__shallow_copy(*cfg, pool);
+          return SVN_NO_ERROR;
+        }
+
+      /* If we did not stat() the file, yet, do it now - before reading
+       * its contents.  That way, any later change will be detected. */
+      if (!finfo.valid)
+        svn_error_clear(svn_io_stat(&finfo, path,
+                                    APR_FINFO_MTIME | APR_FINFO_SIZE,
+                                    scratch_pool));
+    }
+
+  access = svn_repos__create_config_access(preferred_repos, scratch_pool);
   err = svn_repos__get_config(&stream, &checksum, access, path, must_exist,
                               scratch_pool);
   if (!err)
@@ -128,10 +273,22 @@ svn_repos__config_pool_get(svn_config_t **cfg,
                                 "Error while parsing config file: '%s':",
                                 path);
 
+  /* Remember what the file looked like when we read it. */
+  if (   !err
+      && (finfo.valid & (APR_FINFO_MTIME | APR_FINFO_SIZE))
+         == (APR_FINFO_MTIME | APR_FINFO_SIZE))
+    {
+      err = svn_mutex__lock(config_pool->mutex);
+      if (!err)
+        err = svn_mutex__unlock(config_pool->mutex,
+                                set_file_info(config_pool, path, &finfo,
+                                              now, checksum));
+    }
+
   /* Let the standard implementation handle all the difficult cases.
    * Note that for in-repo configs, there are no further special cases to
    * check for and deal with. */
-  if (!*cfg && !svn_path_is_url(path))
+  if (!*cfg && !is_url)
     {
       svn_error_clear(err);
       err = svn_config_read3(cfg, path, must_exist, FALSE, FALSE, pool);
@@ -23,7 +23,10 @@
 
 #include <stdarg.h>
 
+#include <apr_general.h>
+
 #include "svn_private_config.h"
+#include "svn_cache_config.h"
 #include "svn_pools.h"
 #include "svn_error.h"
 #include "svn_fs.h"
@@ -44,9 +47,24 @@
 #include "private/svn_sorts_private.h"
 #include "private/svn_utf_private.h"
 #include "private/svn_cache.h"
+#include "private/svn_subr_private.h"
+#include "private/svn_thread.h"
 
 #define ARE_VALID_COPY_ARGS(p,r) ((p) && SVN_IS_VALID_REVNUM(r))
 
+/* Upper limit to the number of revisions being verified concurrently. */
+#define MAX_VERIFY_JOBS 256
+
+/* Upper limit to the number of revision ranges being dumped concurrently. */
+#define MAX_DUMP_JOBS 256
+
+/* Number of consecutive revisions that a dump worker handles in one go. */
+#define DUMP_JOB_REVISIONS 16
+
+/* Dump workers buffer up to this many bytes in memory per revision range
+   and spill everything beyond that into a temporary file. */
+#define DUMP_JOB_MEMORY (1024 * 1024)
+
 /*----------------------------------------------------------------------*/
 
 
@@ -63,6 +81,13 @@
    as stored in the repository as that is the state *after* we applied
    the respective tree changes.
 
+   Because the walk is pre-order, the tracker never holds more entries than
+   the current path has segments, no matter how many paths a revision
+   touches.  Entries are trimmed from the deepest one upwards, so a lookup
+   below the most recently changed folder costs a single prefix check and
+   the worst case is O(depth).  That is what a component trie would give
+   us as well, minus the need to ever drop its sub-trees.
+
    Note that the tracker functions don't perform any sanity or validity
    checks.  Those higher-level tests have to be done in the calling code.
    However, there is no way to corrupt the data structure using the
@@ -1967,6 +1992,389 @@ write_revision_record(svn_stream_t *stream,
 
 
 
+/* Dump revision REV of FS to STREAM, as the main loop of
+   svn_repos_dump_fs4() does for every revision but without notifying
+   about the revision's completion.  START_REV is the first revision of
+   the whole dump.  Set *FOUND_OLD_REFERENCE and *FOUND_OLD_MERGEINFO if
+   the revision refers to revisions older than START_REV.  All other
+   parameters are the same as for svn_repos_dump_fs4().  Use SCRATCH_POOL
+   for temporary allocations.
+ */
+static svn_error_t *
+dump_one_revision(svn_stream_t *stream,
+                  svn_fs_t *fs,
+                  svn_revnum_t rev,
+                  svn_revnum_t start_rev,
+                  svn_boolean_t incremental,
+                  svn_boolean_t use_deltas,
+                  svn_boolean_t include_revprops,
+                  svn_boolean_t include_changes,
+                  svn_boolean_t *found_old_reference,
+                  svn_boolean_t *found_old_mergeinfo,
+                  svn_repos_notify_func_t notify_func,
+                  void *notify_baton,
+                  apr_pool_t *scratch_pool)
+{
+  const svn_delta_editor_t *dump_editor;
+  void *dump_edit_baton = NULL;
+  svn_fs_root_t *to_root;
+  svn_boolean_t use_deltas_for_rev;
+
+  /* Write the revision record. */
+  SVN_ERR(write_revision_record(stream, fs, rev, include_revprops,
+                                scratch_pool));
+
+  /* When dumping revision 0, we just write out the revision record.
+     The parser might want to use its properties.
+     If we don't want revision changes at all, skip in any case. */
+  if (rev == 0 || !include_changes)
+    return SVN_NO_ERROR;
+
+  /* Fetch the editor which dumps nodes to a file.  Regardless of
+     what we've been told, don't use deltas for the first rev of a
+     non-incremental dump. */
+  use_deltas_for_rev = use_deltas && (incremental || rev != start_rev);
+  SVN_ERR(get_dump_editor(&dump_editor, &dump_edit_baton, fs, rev,
+                          "", stream, found_old_reference,
+                          found_old_mergeinfo, NULL,
+                          notify_func, notify_baton,
+                          start_rev, use_deltas_for_rev, FALSE, FALSE,
+                          scratch_pool));
+
+  /* Drive the editor in one way or another. */
+  SVN_ERR(svn_fs_revision_root(&to_root, fs, rev, scratch_pool));
+
+  /* If this is the first revision of a non-incremental dump,
+     we're in for a full tree dump.  Otherwise, we want to simply
+     replay the revision.  */
+  if ((rev == start_rev) && (! incremental))
+    {
+      /* Compare against revision 0, so everything appears to be added. */
+      svn_fs_root_t *from_root;
+      SVN_ERR(svn_fs_revision_root(&from_root, fs, 0, scratch_pool));
+      SVN_ERR(svn_repos_dir_delta2(from_root, "", "",
+                                   to_root, "",
+                                   dump_editor, dump_edit_baton,
+                                   NULL,
+                                   NULL,
+                                   FALSE, /* don't send text-deltas */
+                                   svn_depth_infinity,
+                                   FALSE, /* don't send entry props */
+                                   FALSE, /* don't ignore ancestry */
+                                   scratch_pool));
+    }
+  else
+    {
+      /* The normal case: compare consecutive revs. */
+      SVN_ERR(svn_repos_replay2(to_root, "", SVN_INVALID_REVNUM, FALSE,
+                                dump_editor, dump_edit_baton,
+                                NULL, NULL, scratch_pool));
+
+      /* While our editor close_edit implementation is a no-op, we still
+         do this for completeness. */
+      SVN_ERR(dump_editor->close_edit(dump_edit_baton, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+
+/* A range of revisions being dumped by a worker thread in
+   dump_revisions_concurrently(). */
+typedef struct dump_job_t
+{
+  /* Parameters shared by all jobs of this dump. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+  svn_revnum_t start_rev;
+  svn_boolean_t incremental;
+  svn_boolean_t use_deltas;
+  svn_boolean_t include_revprops;
+  svn_boolean_t include_changes;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* The revisions to dump. */
+  svn_revnum_t first_rev;
+  svn_revnum_t last_rev;
+
+  /* The dump stream data for these revisions. */
+  svn_spillbuf_t *output;
+
+  /* Copies of the notifications sent while dumping, including the
+     svn_repos_notify_dump_rev_end ones, or NULL if no notifications were
+     requested.  The calling thread forwards them in revision order. */
+  apr_array_header_t *notifications;
+
+  /* Set if any of the revisions referred to revisions before START_REV. */
+  svn_boolean_t found_old_reference;
+  svn_boolean_t found_old_mergeinfo;
+
+  /* Private pool of this job. */
+  apr_pool_t *pool;
+
+  /* Result of the dump. */
+  svn_error_t *err;
+} dump_job_t;
+
+/* Implements svn_repos_notify_func_t, appending a copy of NOTIFY to the
+   notifications of the dump_job_t in BATON. */
+static void
+record_dump_notification(void *baton,
+                         const svn_repos_notify_t *notify,
+                         apr_pool_t *scratch_pool)
+{
+  dump_job_t *job = baton;
+  svn_repos_notify_t *copy = apr_pmemdup(job->pool, notify, sizeof(*notify));
+
+  copy->warning_str = apr_pstrdup(job->pool, notify->warning_str);
+  copy->path = apr_pstrdup(job->pool, notify->path);
+  APR_ARRAY_PUSH(job->notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Dump the revisions given by JOB into its output buffer.  The caller's
+   filesystem must not be used by more than one thread, so read the
+   revisions through a private instance. */
+static svn_error_t *
+run_dump_job(dump_job_t *job)
+{
+  svn_fs_t *fs;
+  svn_stream_t *stream = svn_stream__from_spillbuf(job->output, job->pool);
+  svn_repos_notify_func_t notify_func
+    = job->notifications ? record_dump_notification : NULL;
+  apr_pool_t *iterpool = svn_pool_create(job->pool);
+  svn_revnum_t rev;
+
+  SVN_ERR(svn_fs_open2(&fs, job->fs_path, job->fs_config, job->pool,
+                       iterpool));
+
+  for (rev = job->first_rev; rev <= job->last_rev; ++rev)
+    {
+      svn_pool_clear(iterpool);
+
+      if (job->cancel_func)
+        SVN_ERR(job->cancel_func(job->cancel_baton));
+
+      SVN_ERR(dump_one_revision(stream, fs, rev, job->start_rev,
+                                job->incremental, job->use_deltas,
+                                job->include_revprops, job->include_changes,
+                                &job->found_old_reference,
+                                &job->found_old_mergeinfo,
+                                notify_func, job, iterpool));
+
+      if (notify_func)
+        {
+          svn_repos_notify_t *notify
+            = svn_repos_notify_create(svn_repos_notify_dump_rev_end,
+                                      iterpool);
+          notify->revision = rev;
+          notify_func(job, notify, iterpool);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_thread__job_func_t, running the dump_job_t in DATA. */
+static void
+dump_job_func(void *data,
+              int thread_index,
+              void *baton)
+{
+  dump_job_t *job = data;
+
+  job->err = run_dump_job(job);
+}
+
+/* Initialize JOB with the shared parameters in SETTINGS to dump the
+   revisions FIRST_REV to LAST_REV.  Record notifications only if
+   RECORD_NOTIFICATIONS is set.  Allocate all job data in a sub-pool of
+   the thread-safe THREAD_POOL.
+ */
+static void
+init_dump_job(dump_job_t *job,
+              const dump_job_t *settings,
+              svn_revnum_t first_rev,
+              svn_revnum_t last_rev,
+              svn_boolean_t record_notifications,
+              apr_pool_t *thread_pool)
+{
+  *job = *settings;
+  job->first_rev = first_rev;
+  job->last_rev = last_rev;
+  job->found_old_reference = FALSE;
+  job->found_old_mergeinfo = FALSE;
+  job->err = SVN_NO_ERROR;
+  job->pool = svn_pool_create(thread_pool);
+  job->output = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE, DUMP_JOB_MEMORY,
+                                     job->pool);
+  job->notifications = record_notifications
+                     ? apr_array_make(job->pool, 0,
+                                      sizeof(svn_repos_notify_t *))
+                     : NULL;
+}
+
+/* Copy the output of the completed JOB to STREAM, forward its
+   notifications to NOTIFY_FUNC with NOTIFY_BATON and return its result.
+   Update *FOUND_OLD_REFERENCE and *FOUND_OLD_MERGEINFO.  If ABORT has
+   been set, do neither write nor notify and ignore the result.  Release
+   all memory used by JOB.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+finish_dump_job(dump_job_t *job,
+                svn_boolean_t abort,
+                svn_stream_t *stream,
+                svn_boolean_t *found_old_reference,
+                svn_boolean_t *found_old_mergeinfo,
+                svn_repos_notify_func_t notify_func,
+                void *notify_baton,
+                apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+
+  if (abort)
+    {
+      svn_error_clear(job->err);
+      job->err = SVN_NO_ERROR;
+    }
+  else
+    {
+      /* Even if the job failed, pass on everything up to the failing
+         revision, just like a sequential dump would. */
+      svn_error_t *write_err = SVN_NO_ERROR;
+      const char *data;
+      apr_size_t len;
+
+      while (!write_err)
+        {
+          write_err = svn_spillbuf__read(&data, &len, job->output,
+                                         scratch_pool);
+          if (!write_err && data == NULL)
+            break;
+          if (!write_err)
+            write_err = svn_stream_write(stream, data, &len);
+        }
+
+      job->err = svn_error_compose_create(job->err, write_err);
+
+      if (notify_func && job->notifications)
+        {
+          int i;
+          for (i = 0; i < job->notifications->nelts; ++i)
+            notify_func(notify_baton,
+                        APR_ARRAY_IDX(job->notifications, i,
+                                      svn_repos_notify_t *),
+                        scratch_pool);
+        }
+
+      *found_old_reference |= job->found_old_reference;
+      *found_old_mergeinfo |= job->found_old_mergeinfo;
+    }
+
+  err = job->err;
+  svn_pool_destroy(job->pool);
+  job->pool = NULL;
+
+  return svn_error_trace(err);
+}
+
+/* Dump the revisions START_REV to END_REV of FS to STREAM like the
+   sequential loop in svn_repos_dump_fs4() does, but with up to JOBS
+   ranges of revisions being dumped at the same time.  The dump data and
+   notifications are still written in revision order.  Update
+   *FOUND_OLD_REFERENCE and *FOUND_OLD_MERGEINFO.  The other parameters
+   are the same as for svn_repos_dump_fs4().  Use POOL for temporary
+   allocations.
+ */
+static svn_error_t *
+dump_revisions_concurrently(svn_stream_t *stream,
+                            svn_fs_t *fs,
+                            svn_revnum_t start_rev,
+                            svn_revnum_t end_rev,
+                            int jobs,
+                            svn_boolean_t incremental,
+                            svn_boolean_t use_deltas,
+                            svn_boolean_t include_revprops,
+                            svn_boolean_t include_changes,
+                            svn_boolean_t *found_old_reference,
+                            svn_boolean_t *found_old_mergeinfo,
+                            svn_repos_notify_func_t notify_func,
+                            void *notify_baton,
+                            svn_cancel_func_t cancel_func,
+                            void *cancel_baton,
+                            apr_pool_t *pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  dump_job_t settings = { 0 };
+  svn_revnum_t next_rev = start_rev;
+  dump_job_t *queue;
+  apr_array_header_t *batch;
+  apr_pool_t *thread_pool;
+  int i;
+
+  settings.fs_path = svn_fs_path(fs, pool);
+  settings.fs_config = svn_fs_config(fs, pool);
+  settings.start_rev = start_rev;
+  settings.incremental = incremental;
+  settings.use_deltas = use_deltas;
+  settings.include_revprops = include_revprops;
+  settings.include_changes = include_changes;
+  settings.cancel_func = cancel_func;
+  settings.cancel_baton = cancel_baton;
+
+  /* Job pools are used from several threads. */
+  thread_pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  queue = apr_pcalloc(pool, jobs * sizeof(*queue));
+  batch = apr_array_make(pool, jobs, sizeof(dump_job_t *));
+
+  while (!err && next_rev <= end_rev)
+    {
+      /* Dump the next JOBS revision ranges. */
+      apr_array_clear(batch);
+      while (next_rev <= end_rev && batch->nelts < jobs)
+        {
+          svn_revnum_t last_rev = MIN(next_rev + DUMP_JOB_REVISIONS - 1,
+                                      end_rev);
+          dump_job_t *job = &queue[batch->nelts];
+
+          init_dump_job(job, &settings, next_rev, last_rev,
+                        notify_func != NULL, thread_pool);
+          APR_ARRAY_PUSH(batch, dump_job_t *) = job;
+          next_rev = last_rev + 1;
+        }
+
+      svn_thread__run_batch(batch, dump_job_func, NULL, jobs);
+
+      /* Write their results in revision order. */
+      for (i = 0; i < batch->nelts; ++i)
+        {
+          svn_pool_clear(iterpool);
+
+          if (!err && cancel_func)
+            err = cancel_func(cancel_baton);
+
+          err = svn_error_compose_create(
+                  err,
+                  finish_dump_job(APR_ARRAY_IDX(batch, i, dump_job_t *),
+                                  err != SVN_NO_ERROR, stream,
+                                  found_old_reference, found_old_mergeinfo,
+                                  notify_func, notify_baton, iterpool));
+        }
+    }
+
+  svn_pool_destroy(thread_pool);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+#endif
+
+
 /* The main dumper. */
 svn_error_t *
 svn_repos_dump_fs4(svn_repos_t *repos,
@@ -1983,8 +2391,6 @@ svn_repos_dump_fs4(svn_repos_t *repos,
                    void *cancel_baton,
                    apr_pool_t *pool)
 {
-  const svn_delta_editor_t *dump_editor;
-  void *dump_edit_baton = NULL;
   svn_revnum_t rev;
   svn_fs_t *fs = svn_repos_fs(repos);
   apr_pool_t *iterpool = svn_pool_create(pool);
@@ -1994,6 +2400,20 @@ svn_repos_dump_fs4(svn_repos_t *repos,
   svn_boolean_t found_old_reference = FALSE;
   svn_boolean_t found_old_mergeinfo = FALSE;
   svn_repos_notify_t *notify;
+  apr_hash_t *fs_config = svn_fs_config(fs, pool);
+  const char *jobs_value;
+  int jobs = 1;
+
+  /* Determine the number of revision ranges we may dump concurrently.
+     The workers share the caches with us, so they must be thread-safe. */
+  jobs_value = fs_config ? svn_hash_gets(fs_config, SVN_FS_CONFIG_DUMP_JOBS)
+                         : NULL;
+  if (jobs_value && !svn_cache_config_get()->single_threaded)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, jobs_value, 0, MAX_DUMP_JOBS, 10));
+      jobs = MAX(1, (int)val);
+    }
 
   /* Make sure we catch up on the latest revprop changes.  This is the only
    * time we will refresh the revprop data in this query. */
@@ -2044,74 +2464,33 @@ svn_repos_dump_fs4(svn_repos_t *repos,
     notify = svn_repos_notify_create(svn_repos_notify_dump_rev_end,
                                      pool);
 
+#if APR_HAS_THREADS
+  if (jobs > 1 && end_rev > start_rev)
+    SVN_ERR(dump_revisions_concurrently(stream, fs, start_rev, end_rev,
+                                        jobs, incremental, use_deltas,
+                                        include_revprops, include_changes,
+                                        &found_old_reference,
+                                        &found_old_mergeinfo,
+                                        notify_func, notify_baton,
+                                        cancel_func, cancel_baton,
+                                        iterpool));
+  else
+#endif
   /* Main loop:  we're going to dump revision REV.  */
   for (rev = start_rev; rev <= end_rev; rev++)
     {
-      svn_fs_root_t *to_root;
-      svn_boolean_t use_deltas_for_rev;
-
       svn_pool_clear(iterpool);
 
       /* Check for cancellation. */
       if (cancel_func)
         SVN_ERR(cancel_func(cancel_baton));
 
-      /* Write the revision record. */
-      SVN_ERR(write_revision_record(stream, fs, rev, include_revprops,
-                                    iterpool));
-
-      /* When dumping revision 0, we just write out the revision record.
-         The parser might want to use its properties.
-         If we don't want revision changes at all, skip in any case. */
-      if (rev == 0 || !include_changes)
-        goto loop_end;
-
-      /* Fetch the editor which dumps nodes to a file.  Regardless of
-         what we've been told, don't use deltas for the first rev of a
-         non-incremental dump. */
-      use_deltas_for_rev = use_deltas && (incremental || rev != start_rev);
-      SVN_ERR(get_dump_editor(&dump_editor, &dump_edit_baton, fs, rev,
-                              "", stream, &found_old_reference,
-                              &found_old_mergeinfo, NULL,
-                              notify_func, notify_baton,
-                              start_rev, use_deltas_for_rev, FALSE, FALSE,
-                              iterpool));
-
-      /* Drive the editor in one way or another. */
-      SVN_ERR(svn_fs_revision_root(&to_root, fs, rev, iterpool));
-
-      /* If this is the first revision of a non-incremental dump,
-         we're in for a full tree dump.  Otherwise, we want to simply
-         replay the revision.  */
-      if ((rev == start_rev) && (! incremental))
-        {
-          /* Compare against revision 0, so everything appears to be added. */
-          svn_fs_root_t *from_root;
-          SVN_ERR(svn_fs_revision_root(&from_root, fs, 0, iterpool));
-          SVN_ERR(svn_repos_dir_delta2(from_root, "", "",
-                                       to_root, "",
-                                       dump_editor, dump_edit_baton,
-                                       NULL,
-                                       NULL,
-                                       FALSE, /* don't send text-deltas */
-                                       svn_depth_infinity,
-                                       FALSE, /* don't send entry props */
-                                       FALSE, /* don't ignore ancestry */
-                                       iterpool));
-        }
-      else
-        {
-          /* The normal case: compare consecutive revs. */
-          SVN_ERR(svn_repos_replay2(to_root, "", SVN_INVALID_REVNUM, FALSE,
-                                    dump_editor, dump_edit_baton,
-                                    NULL, NULL, iterpool));
-
-          /* While our editor close_edit implementation is a no-op, we still
-             do this for completeness. */
-          SVN_ERR(dump_editor->close_edit(dump_edit_baton, iterpool));
-        }
+      SVN_ERR(dump_one_revision(stream, fs, rev, start_rev, incremental,
+                                use_deltas, include_revprops,
+                                include_changes, &found_old_reference,
+                                &found_old_mergeinfo, notify_func,
+                                notify_baton, iterpool));
 
-    loop_end:
       if (notify_func)
         {
           notify->revision = rev;
@@ -2391,6 +2770,245 @@ report_error(svn_revnum_t revision,
     }
 }
 
+#if APR_HAS_THREADS
+
+/* A revision being verified by a worker thread in
+   verify_revisions_concurrently(). */
+typedef struct verify_job_t
+{
+  /* Parameters shared by all jobs of this verification run. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+  svn_revnum_t start_rev;
+  svn_boolean_t check_normalization;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* The revision to verify. */
+  svn_revnum_t rev;
+
+  /* Copies of the notifications sent while verifying REV (of type
+     svn_repos_notify_t *) or NULL if no notifications were requested.
+     The calling thread forwards them in revision order. */
+  apr_array_header_t *notifications;
+
+  /* Private pool of this job. */
+  apr_pool_t *pool;
+
+  /* Result of the verification. */
+  svn_error_t *err;
+} verify_job_t;
+
+/* Implements svn_repos_notify_func_t, appending a copy of NOTIFY to the
+   notifications of the verify_job_t in BATON. */
+static void
+record_verify_notification(void *baton,
+                           const svn_repos_notify_t *notify,
+                           apr_pool_t *scratch_pool)
+{
+  verify_job_t *job = baton;
+  svn_repos_notify_t *copy = apr_pmemdup(job->pool, notify, sizeof(*notify));
+
+  copy->warning_str = apr_pstrdup(job->pool, notify->warning_str);
+  copy->path = apr_pstrdup(job->pool, notify->path);
+  APR_ARRAY_PUSH(job->notifications, svn_repos_notify_t *) = copy;
+}
+
+/* Verify the revision given by JOB.  The caller's filesystem must not be
+   used by more than one thread, so read the revision through a private
+   instance. */
+static svn_error_t *
+run_verify_job(verify_job_t *job)
+{
+  svn_fs_t *fs;
+
+  SVN_ERR(svn_fs_open2(&fs, job->fs_path, job->fs_config, job->pool,
+                       job->pool));
+  return svn_error_trace(verify_one_revision(fs, job->rev,
+                                             job->notifications
+                                               ? record_verify_notification
+                                               : NULL,
+                                             job, job->start_rev,
+                                             job->check_normalization,
+                                             job->cancel_func,
+                                             job->cancel_baton,
+                                             job->pool));
+}
+
+/* Implements svn_thread__job_func_t, running the verify_job_t in DATA. */
+static void
+verify_job_func(void *data,
+                int thread_index,
+                void *baton)
+{
+  verify_job_t *job = data;
+
+  job->err = run_verify_job(job);
+}
+
+/* Initialize JOB to verify revision REV of the filesystem at FS_PATH,
+   using FS_CONFIG to open it.  Record notifications only if
+   RECORD_NOTIFICATIONS is set.  START_REV, CHECK_NORMALIZATION,
+   CANCEL_FUNC and CANCEL_BATON are passed on to verify_one_revision().
+   Allocate all job data in a sub-pool of the thread-safe THREAD_POOL.
+ */
+static void
+init_verify_job(verify_job_t *job,
+                const char *fs_path,
+                apr_hash_t *fs_config,
+                svn_revnum_t rev,
+                svn_revnum_t start_rev,
+                svn_boolean_t check_normalization,
+                svn_boolean_t record_notifications,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *thread_pool)
+{
+  job->fs_path = fs_path;
+  job->fs_config = fs_config;
+  job->rev = rev;
+  job->start_rev = start_rev;
+  job->check_normalization = check_normalization;
+  job->cancel_func = cancel_func;
+  job->cancel_baton = cancel_baton;
+  job->err = SVN_NO_ERROR;
+  job->pool = svn_pool_create(thread_pool);
+  job->notifications = record_notifications
+                     ? apr_array_make(job->pool, 0,
+                                      sizeof(svn_repos_notify_t *))
+                     : NULL;
+}
+
+/* Forward the notifications of the completed JOB to NOTIFY_FUNC with
+   NOTIFY_BATON and return its result.  If ABORT has been set, do not
+   notify and ignore the result.  Release all memory used by JOB.  Use
+   SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+finish_verify_job(verify_job_t *job,
+                  svn_boolean_t abort,
+                  svn_repos_notify_func_t notify_func,
+                  void *notify_baton,
+                  apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+
+  if (abort)
+    {
+      svn_error_clear(job->err);
+      job->err = SVN_NO_ERROR;
+    }
+  else if (notify_func && job->notifications)
+    {
+      int i;
+      for (i = 0; i < job->notifications->nelts; ++i)
+        notify_func(notify_baton,
+                    APR_ARRAY_IDX(job->notifications, i,
+                                  svn_repos_notify_t *),
+                    scratch_pool);
+    }
+
+  err = job->err;
+  svn_pool_destroy(job->pool);
+  job->pool = NULL;
+
+  return svn_error_trace(err);
+}
+
+/* Verify the revisions START_REV to END_REV in FS like the sequential loop
+   in svn_repos_verify_fs3() does, but with up to JOBS revisions being
+   verified at the same time.  Notifications and errors are reported one
+   revision after the other and in order.  The parameters are the same as
+   for svn_repos_verify_fs3().  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+verify_revisions_concurrently(svn_fs_t *fs,
+                              svn_revnum_t start_rev,
+                              svn_revnum_t end_rev,
+                              int jobs,
+                              svn_boolean_t check_normalization,
+                              svn_repos_notify_func_t notify_func,
+                              void *notify_baton,
+                              svn_repos_verify_callback_t verify_callback,
+                              void *verify_baton,
+                              svn_cancel_func_t cancel_func,
+                              void *cancel_baton,
+                              apr_pool_t *pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  const char *fs_path = svn_fs_path(fs, pool);
+  apr_hash_t *fs_config = svn_fs_config(fs, pool);
+  svn_repos_notify_t *notify = NULL;
+  svn_revnum_t next_rev = start_rev;
+  verify_job_t *queue;
+  apr_array_header_t *batch;
+  apr_pool_t *thread_pool;
+  int i;
+
+  if (notify_func)
+    notify = svn_repos_notify_create(svn_repos_notify_verify_rev_end, pool);
+
+  /* Job pools are used from several threads. */
+  thread_pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  queue = apr_pcalloc(pool, jobs * sizeof(*queue));
+  batch = apr_array_make(pool, jobs, sizeof(verify_job_t *));
+
+  while (!err && next_rev <= end_rev)
+    {
+      /* Verify the next JOBS revisions. */
+      apr_array_clear(batch);
+      for (; next_rev <= end_rev && batch->nelts < jobs; ++next_rev)
+        {
+          verify_job_t *job = &queue[batch->nelts];
+
+          init_verify_job(job, fs_path, fs_config, next_rev, start_rev,
+                          check_normalization, notify_func != NULL,
+                          cancel_func, cancel_baton, thread_pool);
+          APR_ARRAY_PUSH(batch, verify_job_t *) = job;
+        }
+
+      svn_thread__run_batch(batch, verify_job_func, NULL, jobs);
+
+      /* Report their results in revision order. */
+      for (i = 0; i < batch->nelts; ++i)
+        {
+          verify_job_t *job = APR_ARRAY_IDX(batch, i, verify_job_t *);
+          svn_revnum_t rev = job->rev;
+          svn_error_t *verify_err;
+
+          svn_pool_clear(iterpool);
+
+          verify_err = finish_verify_job(job, err != SVN_NO_ERROR,
+                                         notify_func, notify_baton,
+                                         iterpool);
+
+          if (verify_err && verify_err->apr_err == SVN_ERR_CANCELLED)
+            {
+              err = verify_err;
+            }
+          else if (verify_err)
+            {
+              err = report_error(rev, verify_err, verify_callback,
+                                 verify_baton, iterpool);
+            }
+          else if (!err && notify_func)
+            {
+              /* Tell the caller that we're done with this revision. */
+              notify->revision = rev;
+              notify_func(notify_baton, notify, iterpool);
+            }
+        }
+    }
+
+  svn_pool_destroy(thread_pool);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+#endif
+
 svn_error_t *
 svn_repos_verify_fs3(svn_repos_t *repos,
                      svn_revnum_t start_rev,
@@ -2412,8 +3030,21 @@ svn_repos_verify_fs3(svn_repos_t *repos,
   svn_repos_notify_t *notify;
   svn_fs_progress_notify_func_t verify_notify = NULL;
   struct verify_fs_notify_func_baton_t *verify_notify_baton = NULL;
+  apr_hash_t *fs_config = svn_fs_config(fs, pool);
+  const char *jobs_value;
+  int jobs = 1;
   svn_error_t *err;
 
+  /* Determine the number of revisions we may verify concurrently. */
+  jobs_value = fs_config ? svn_hash_gets(fs_config, SVN_FS_CONFIG_VERIFY_JOBS)
+                         : NULL;
+  if (jobs_value)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, jobs_value, 0, MAX_VERIFY_JOBS, 10));
+      jobs = MAX(1, (int)val);
+    }
+
   /* Make sure we catch up on the latest revprop changes.  This is the only
    * time we will refresh the revprop data in this query. */
   SVN_ERR(svn_fs_refresh_revision_props(fs, pool));
@@ -2454,7 +3085,7 @@ svn_repos_verify_fs3(svn_repos_t *repos,
     }
 
   /* Verify global metadata and backend-specific data first. */
-  err = svn_fs_verify(svn_fs_path(fs, pool), svn_fs_config(fs, pool),
+  err = svn_fs_verify(svn_fs_path(fs, pool), fs_config,
                       start_rev, end_rev,
                       verify_notify, verify_notify_baton,
                       cancel_func, cancel_baton, pool);
@@ -2469,6 +3100,16 @@ svn_repos_verify_fs3(svn_repos_t *repos,
                            verify_baton, iterpool));
     }
 
+#if APR_HAS_THREADS
+  if (!metadata_only && jobs > 1)
+    SVN_ERR(verify_revisions_concurrently(fs, start_rev, end_rev, jobs,
+                                          check_normalization,
+                                          notify_func, notify_baton,
+                                          verify_callback, verify_baton,
+                                          cancel_func, cancel_baton,
+                                          iterpool));
+  else
+#endif
   if (!metadata_only)
     for (rev = start_rev; rev <= end_rev; rev++)
       {
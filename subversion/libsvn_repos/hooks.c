@@ -28,6 +28,7 @@
 #include <apr_file_io.h>
 
 #include "svn_config.h"
+#include "svn_dso.h"
 #include "svn_hash.h"
 #include "svn_error.h"
 #include "svn_dirent_uri.h"
@@ -35,6 +36,7 @@
 #include "svn_pools.h"
 #include "svn_repos.h"
 #include "svn_utf.h"
+#include "svn_version.h"
 #include "repos.h"
 #include "svn_private_config.h"
 #include "private/svn_fs_private.h"
@@ -454,6 +456,87 @@ hook_symlink_error(const char *hook)
      _("Failed to run '%s' hook; broken symlink"), hook);
 }
 
+/* Set *MODULE to the in-process hook module of REPOS or to NULL, if
+   the repository has none.  The module is loaded upon first use and then
+   remembered in REPOS.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+get_hook_module(const svn_repos_hook_module_t **module,
+                svn_repos_t *repos,
+                apr_pool_t *scratch_pool)
+{
+  if (!repos->hook_module_loaded)
+    {
+#if APR_HAS_DSO
+      const char *path = svn_dirent_join(repos->hook_path,
+                                         SVN_REPOS_HOOK_MODULE,
+                                         scratch_pool);
+      svn_node_kind_t kind;
+
+      SVN_ERR(svn_io_check_path(path, &kind, scratch_pool));
+      if (kind != svn_node_none)
+        {
+          apr_dso_handle_t *dso;
+          apr_dso_handle_sym_t symbol;
+          svn_repos_hook_module_init_t init_func;
+          apr_status_t status;
+          svn_error_t *err;
+
+          /* Once loaded, the library stays loaded for the lifetime of
+             the process.  So, the function table remains valid. */
+          SVN_ERR(svn_dso_load(&dso, path));
+          if (!dso)
+            return svn_error_createf(SVN_ERR_REPOS_HOOK_FAILURE, NULL,
+                                     _("Failed to load hook module '%s'"),
+                                     svn_dirent_local_style(path,
+                                                            scratch_pool));
+
+          status = apr_dso_sym(&symbol, dso, SVN_REPOS_HOOK_MODULE_INIT);
+          if (status)
+            return svn_error_wrap_apr(status,
+                                      _("Hook module '%s' does not define "
+                                        "'%s()'"),
+                                      svn_dirent_local_style(path,
+                                                             scratch_pool),
+                                      SVN_REPOS_HOOK_MODULE_INIT);
+
+          init_func = (svn_repos_hook_module_init_t) symbol;
+          err = init_func(&repos->hook_module, svn_repos_version(),
+                          scratch_pool);
+          if (err)
+            {
+              repos->hook_module = NULL;
+              return svn_error_createf(SVN_ERR_REPOS_HOOK_FAILURE, err,
+                                       _("Failed to initialize hook "
+                                         "module '%s'"),
+                                       svn_dirent_local_style(path,
+                                                              scratch_pool));
+            }
+        }
+#endif
+
+      repos->hook_module_loaded = TRUE;
+    }
+
+  *module = repos->hook_module;
+  return SVN_NO_ERROR;
+}
+
+/* Return an error for the failure of the hook module function for hook
+   NAME, which returned ERR.  If ERR is SVN_NO_ERROR, return that. */
+static svn_error_t *
+hook_module_error(const char *name, svn_error_t *err)
+{
+  if (!err)
+    return SVN_NO_ERROR;
+
+  if (strcmp(name, SVN_REPOS__HOOK_POST_COMMIT) == 0)
+    return svn_error_createf(SVN_ERR_REPOS_HOOK_FAILURE, err,
+                             _("%s hook module failed"), name);
+
+  return svn_error_createf(SVN_ERR_REPOS_HOOK_FAILURE, err,
+                           _("Commit blocked by %s hook module"), name);
+}
+
 svn_error_t *
 svn_repos__hooks_start_commit(svn_repos_t *repos,
                               apr_hash_t *hooks_env,
@@ -463,8 +546,15 @@ svn_repos__hooks_start_commit(svn_repos_t *repos,
                               apr_pool_t *pool)
 {
   const char *hook = svn_repos_start_commit_hook(repos, pool);
+  const svn_repos_hook_module_t *module;
   svn_boolean_t broken_link;
 
+  SVN_ERR(get_hook_module(&module, repos, pool));
+  if (module && module->start_commit)
+    SVN_ERR(hook_module_error(SVN_REPOS__HOOK_START_COMMIT,
+                              module->start_commit(repos, user, capabilities,
+                                                   txn_name, pool)));
+
   if ((hook = check_hook_cmd(hook, &broken_link, pool)) && broken_link)
     {
       return hook_symlink_error(hook);
@@ -551,8 +641,31 @@ svn_repos__hooks_pre_commit(svn_repos_t *repos,
                             apr_pool_t *pool)
 {
   const char *hook = svn_repos_pre_commit_hook(repos, pool);
+  const svn_repos_hook_module_t *module;
   svn_boolean_t broken_link;
 
+  SVN_ERR(get_hook_module(&module, repos, pool));
+  if (module && module->pre_commit)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *txn_root;
+      svn_fs_access_t *access_ctx;
+      apr_hash_t *lock_tokens = NULL;
+
+      /* Unlike a hook script, the module gets to use the filesystem that
+         we already have open. */
+      SVN_ERR(svn_fs_open_txn(&txn, repos->fs, txn_name, pool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+
+      SVN_ERR(svn_fs_get_access(&access_ctx, repos->fs));
+      if (access_ctx)
+        lock_tokens = svn_fs__access_get_lock_tokens(access_ctx);
+
+      SVN_ERR(hook_module_error(SVN_REPOS__HOOK_PRE_COMMIT,
+                                module->pre_commit(repos, txn, txn_root,
+                                                   lock_tokens, pool)));
+    }
+
   if ((hook = check_hook_cmd(hook, &broken_link, pool)) && broken_link)
     {
       return hook_symlink_error(hook);
@@ -597,8 +710,15 @@ svn_repos__hooks_post_commit(svn_repos_t *repos,
                              apr_pool_t *pool)
 {
   const char *hook = svn_repos_post_commit_hook(repos, pool);
+  const svn_repos_hook_module_t *module;
   svn_boolean_t broken_link;
 
+  SVN_ERR(get_hook_module(&module, repos, pool));
+  if (module && module->post_commit)
+    SVN_ERR(hook_module_error(SVN_REPOS__HOOK_POST_COMMIT,
+                              module->post_commit(repos, rev, txn_name,
+                                                  pool)));
+
   if ((hook = check_hook_cmd(hook, &broken_link, pool)) && broken_link)
     {
       return hook_symlink_error(hook);
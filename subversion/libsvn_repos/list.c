@@ -23,17 +23,29 @@
 #include <apr_pools.h>
 #include <apr_fnmatch.h>
 
+#include "svn_cache_config.h"
+#include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_error.h"
 #include "svn_dirent_uri.h"
+#include "svn_sorts.h"
+#include "svn_string.h"
 #include "svn_time.h"
 
 #include "private/svn_repos_private.h"
 #include "private/svn_sorts_private.h"
+#include "private/svn_subr_private.h"
+#include "private/svn_thread.h"
 #include "svn_private_config.h" /* for SVN_TEMPLATE_ROOT_DIR */
 
 #include "repos.h"
 
+/* Upper limit to the number of sub-trees being listed concurrently. */
+#define MAX_LIST_JOBS 256
+
+/* List workers buffer up to this many bytes of entries in memory per
+   sub-tree and spill everything beyond that into a temporary file. */
+#define LIST_JOB_MEMORY (1024 * 1024)
 
 
 /* Utility function.  Given DIRENT->KIND, set all other elements of *DIRENT
@@ -162,47 +174,35 @@ compare_filtered_dirent(const void *lhs,
   return strcmp(lhs_dirent->dirent->name, rhs_dirent->dirent->name);
 }
 
-/* Core of svn_repos_list with the same parameter list.
+/* Fetch all entries of directory PATH under ROOT, filter them according
+ * to DEPTH and PATTERNS and return them as an array of filtered_dirent_t,
+ * sorted by name, in *SORTED.  Allocate the result in RESULT_POOL and use
+ * SCRATCH_POOL for temporary allocations.
  *
- * However, DEPTH is not svn_depth_empty and PATH has already been reported.
- * Therefore, we can call this recursively.
+ * Performance trade-off:
+ * Constructing a full path vs. faster sort due to authz filtering.
+ * We filter according to DEPTH and PATTERNS only because constructing
+ * the full path required for authz is somewhat expensive and we don't
+ * want to do this twice while authz will rarely filter paths out.
  */
 static svn_error_t *
-do_list(svn_fs_root_t *root,
-        const char *path,
-        const apr_array_header_t *patterns,
-        svn_depth_t depth,
-        svn_boolean_t path_info_only,
-        svn_repos_authz_func_t authz_read_func,
-        void *authz_read_baton,
-        svn_repos_dirent_receiver_t receiver,
-        void *receiver_baton,
-        svn_cancel_func_t cancel_func,
-        void *cancel_baton,
-        apr_pool_t *scratch_pool)
+get_sorted_entries(apr_array_header_t **sorted,
+                   svn_fs_root_t *root,
+                   const char *path,
+                   const apr_array_header_t *patterns,
+                   svn_depth_t depth,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *scratch_pool)
 {
   apr_hash_t *entries;
-  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
   apr_hash_index_t *hi;
-  apr_array_header_t *sorted;
-  int i;
 
-  /* Fetch all directory entries, filter and sort them.
-   *
-   * Performance trade-off:
-   * Constructing a full path vs. faster sort due to authz filtering.
-   * We filter according to DEPTH and PATTERNS only because constructing
-   * the full path required for authz is somewhat expensive and we don't
-   * want to do this twice while authz will rarely filter paths out.
-   */
-  SVN_ERR(svn_fs_dir_entries(&entries, root, path, scratch_pool));
-  sorted = apr_array_make(scratch_pool, apr_hash_count(entries),
-                          sizeof(filtered_dirent_t));
+  SVN_ERR(svn_fs_dir_entries(&entries, root, path, result_pool));
+  *sorted = apr_array_make(result_pool, apr_hash_count(entries),
+                           sizeof(filtered_dirent_t));
   for (hi = apr_hash_first(scratch_pool, entries); hi; hi = apr_hash_next(hi))
     {
       filtered_dirent_t filtered;
-      svn_pool_clear(iterpool);
-
       filtered.dirent = apr_hash_this_val(hi);
 
       /* Skip directories if we want to report files only. */
@@ -214,10 +214,40 @@ do_list(svn_fs_root_t *root,
       if (!filtered.is_match && filtered.dirent->kind == svn_node_file)
         continue;
 
-      APR_ARRAY_PUSH(sorted, filtered_dirent_t) = filtered;
+      APR_ARRAY_PUSH(*sorted, filtered_dirent_t) = filtered;
     }
 
-  svn_sort__array(sorted, compare_filtered_dirent);
+  svn_sort__array(*sorted, compare_filtered_dirent);
+
+  return SVN_NO_ERROR;
+}
+
+/* Core of svn_repos_list with the same parameter list.
+ *
+ * However, DEPTH is not svn_depth_empty and PATH has already been reported.
+ * Therefore, we can call this recursively.
+ */
+static svn_error_t *
+do_list(svn_fs_root_t *root,
+        const char *path,
+        const apr_array_header_t *patterns,
+        svn_depth_t depth,
+        svn_boolean_t path_info_only,
+        svn_repos_authz_func_t authz_read_func,
+        void *authz_read_baton,
+        svn_repos_dirent_receiver_t receiver,
+        void *receiver_baton,
+        svn_cancel_func_t cancel_func,
+        void *cancel_baton,
+        apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *sorted;
+  int i;
+
+  /* Fetch all directory entries, filter and sort them. */
+  SVN_ERR(get_sorted_entries(&sorted, root, path, patterns, depth,
+                             scratch_pool, iterpool));
 
   /* Iterate over all remaining directory entries and report them.
    * Recurse into sub-directories if requested. */
@@ -266,6 +296,487 @@ do_list(svn_fs_root_t *root,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+
+/* A sub-tree being walked by a worker thread in do_list_concurrently(). */
+typedef struct list_job_t
+{
+  /* Parameters shared by all jobs of this listing. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+  svn_revnum_t revision;
+  const apr_array_header_t *patterns;
+  svn_boolean_t path_info_only;
+  svn_cancel_func_t cancel_func;
+  void *cancel_baton;
+
+  /* The directory whose contents to list recursively. */
+  const char *path;
+
+  /* The list_record_t of all entries found, in path order. */
+  svn_spillbuf_t *output;
+
+  /* Private pool of this job. */
+  apr_pool_t *pool;
+
+  /* Result of the listing. */
+  svn_error_t *err;
+} list_job_t;
+
+/* Fixed-size part of an entry found by a list worker.  In the job's
+   output, it is followed by the entry's path and its last author. */
+typedef struct list_record_t
+{
+  /* Length of the path following this record. */
+  apr_size_t path_len;
+
+  /* Length of the last author following the path.  (apr_size_t)-1, if
+     the entry has no last author. */
+  apr_size_t author_len;
+
+  /* Whether the entry passed the pattern filter.  Entries that did not
+     are still directories that we must check for authz. */
+  svn_boolean_t is_match;
+
+  /* The entry's details.  The last author pointer is not valid. */
+  svn_dirent_t dirent;
+} list_record_t;
+
+/* Append the entry PATH with DIRENT and IS_MATCH to OUTPUT.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_list_record(svn_spillbuf_t *output,
+                  const char *path,
+                  const svn_dirent_t *dirent,
+                  svn_boolean_t is_match,
+                  apr_pool_t *scratch_pool)
+{
+  list_record_t record = { 0 };
+
+  record.path_len = strlen(path);
+  record.author_len = dirent->last_author ? strlen(dirent->last_author)
+                                          : (apr_size_t)-1;
+  record.is_match = is_match;
+  record.dirent = *dirent;
+  record.dirent.last_author = NULL;
+
+  SVN_ERR(svn_spillbuf__write(output, (const char *)&record, sizeof(record),
+                              scratch_pool));
+  SVN_ERR(svn_spillbuf__write(output, path, record.path_len, scratch_pool));
+  if (dirent->last_author)
+    SVN_ERR(svn_spillbuf__write(output, dirent->last_author,
+                                record.author_len, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the next entry written by write_list_record() from STREAM and
+   return it in *PATH, *DIRENT and *IS_MATCH, allocated in RESULT_POOL.
+   Set *PATH to NULL if there are no more entries. */
+static svn_error_t *
+read_list_record(const char **path,
+                 svn_dirent_t **dirent,
+                 svn_boolean_t *is_match,
+                 svn_stream_t *stream,
+                 apr_pool_t *result_pool)
+{
+  list_record_t record;
+  apr_size_t len = sizeof(record);
+  char *buffer;
+
+  SVN_ERR(svn_stream_read_full(stream, (char *)&record, &len));
+  if (len == 0)
+    {
+      *path = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  if (len != sizeof(record))
+    return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL, NULL);
+
+  *dirent = apr_pmemdup(result_pool, &record.dirent, sizeof(record.dirent));
+  *is_match = record.is_match;
+
+  len = record.path_len;
+  buffer = apr_palloc(result_pool, len + 1);
+  SVN_ERR(svn_stream_read_full(stream, buffer, &len));
+  if (len != record.path_len)
+    return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL, NULL);
+  buffer[len] = '\0';
+  *path = buffer;
+
+  if (record.author_len != (apr_size_t)-1)
+    {
+      len = record.author_len;
+      buffer = apr_palloc(result_pool, len + 1);
+      SVN_ERR(svn_stream_read_full(stream, buffer, &len));
+      if (len != record.author_len)
+        return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL, NULL);
+      buffer[len] = '\0';
+      (*dirent)->last_author = buffer;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Record all entries below PATH under ROOT in JOB's output, like do_list()
+   with infinite depth would find them.  Record all directories, whether
+   they match the patterns or not, because the calling thread must check
+   each of them for authz.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+record_subtree(list_job_t *job,
+               svn_fs_root_t *root,
+               const char *path,
+               apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_array_header_t *sorted;
+  int i;
+
+  SVN_ERR(get_sorted_entries(&sorted, root, path, job->patterns,
+                             svn_depth_infinity, scratch_pool, iterpool));
+
+  for (i = 0; i < sorted->nelts; ++i)
+    {
+      filtered_dirent_t *filtered = &APR_ARRAY_IDX(sorted, i,
+                                                   filtered_dirent_t);
+      svn_dirent_t dirent = { 0 };
+      const char *sub_path;
+
+      svn_pool_clear(iterpool);
+
+      if (job->cancel_func)
+        SVN_ERR(job->cancel_func(job->cancel_baton));
+
+      sub_path = svn_dirent_join(path, filtered->dirent->name, iterpool);
+      dirent.kind = filtered->dirent->kind;
+      if (filtered->is_match && !job->path_info_only)
+        SVN_ERR(fill_dirent(&dirent, root, sub_path, iterpool));
+
+      SVN_ERR(write_list_record(job->output, sub_path, &dirent,
+                                filtered->is_match, iterpool));
+
+      if (dirent.kind == svn_node_dir)
+        SVN_ERR(record_subtree(job, root, sub_path, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* List the sub-tree given by JOB into its output buffer.  The caller's
+   root must not be used by more than one thread, so read the tree
+   through a private filesystem instance. */
+static svn_error_t *
+run_list_job(list_job_t *job)
+{
+  svn_fs_t *fs;
+  svn_fs_root_t *root;
+  apr_pool_t *scratch_pool = svn_pool_create(job->pool);
+
+  SVN_ERR(svn_fs_open2(&fs, job->fs_path, job->fs_config, job->pool,
+                       scratch_pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, job->revision, job->pool));
+  SVN_ERR(record_subtree(job, root, job->path, scratch_pool));
+
+  svn_pool_destroy(scratch_pool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_thread__job_func_t, running the list_job_t in DATA. */
+static void
+list_job_func(void *data,
+              int thread_index,
+              void *baton)
+{
+  list_job_t *job = data;
+
+  job->err = run_list_job(job);
+}
+
+/* Initialize JOB with the shared parameters in SETTINGS to list the
+   contents of PATH.  Allocate all job data in a sub-pool of the
+   thread-safe THREAD_POOL.
+ */
+static void
+init_list_job(list_job_t *job,
+              const list_job_t *settings,
+              const char *path,
+              apr_pool_t *thread_pool)
+{
+  *job = *settings;
+  job->err = SVN_NO_ERROR;
+  job->pool = svn_pool_create(thread_pool);
+  job->path = apr_pstrdup(job->pool, path);
+  job->output = svn_spillbuf__create(SVN__STREAM_CHUNK_SIZE, LIST_JOB_MEMORY,
+                                     job->pool);
+}
+
+/* Report the entries recorded in OUTPUT to RECEIVER with RECEIVER_BATON,
+   skipping all sub-trees that AUTHZ_READ_FUNC with AUTHZ_READ_BATON
+   denies access to under ROOT.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+report_recorded_entries(svn_spillbuf_t *output,
+                        svn_fs_root_t *root,
+                        svn_repos_authz_func_t authz_read_func,
+                        void *authz_read_baton,
+                        svn_repos_dirent_receiver_t receiver,
+                        void *receiver_baton,
+                        svn_cancel_func_t cancel_func,
+                        void *cancel_baton,
+                        apr_pool_t *scratch_pool)
+{
+  svn_stream_t *stream = svn_stream__from_spillbuf(output, scratch_pool);
+  svn_stringbuf_t *denied = svn_stringbuf_create_empty(scratch_pool);
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+
+  while (TRUE)
+    {
+      const char *path;
+      svn_dirent_t *dirent;
+      svn_boolean_t is_match;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(read_list_record(&path, &dirent, &is_match, stream, iterpool));
+      if (!path)
+        break;
+
+      /* Entries are in path order, so everything below the last
+         directory that we had no access to follows it immediately. */
+      if (denied->len && svn_dirent_is_ancestor(denied->data, path))
+        continue;
+
+      if (authz_read_func)
+        {
+          svn_boolean_t has_access;
+          SVN_ERR(authz_read_func(&has_access, root, path,
+                                  authz_read_baton, iterpool));
+          if (!has_access)
+            {
+              svn_stringbuf_set(denied, path);
+              continue;
+            }
+        }
+
+      if (is_match)
+        SVN_ERR(receiver(path, dirent, receiver_baton, iterpool));
+
+      if (cancel_func)
+        SVN_ERR(cancel_func(cancel_baton));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Report the entries of the completed JOB like report_recorded_entries()
+   does and return its result.  If ABORT has been set, do not report and
+   ignore all errors.  Release all memory used by JOB.  Use SCRATCH_POOL
+   for temporary allocations.
+ */
+static svn_error_t *
+finish_list_job(list_job_t *job,
+                svn_boolean_t abort,
+                svn_fs_root_t *root,
+                svn_repos_authz_func_t authz_read_func,
+                void *authz_read_baton,
+                svn_repos_dirent_receiver_t receiver,
+                void *receiver_baton,
+                svn_cancel_func_t cancel_func,
+                void *cancel_baton,
+                apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+
+  if (abort)
+    {
+      svn_error_clear(job->err);
+      job->err = SVN_NO_ERROR;
+    }
+  else
+    {
+      /* Even if the job failed, pass on everything up to the failing
+         entry, just like a sequential listing would. */
+      job->err = svn_error_compose_create(
+                   report_recorded_entries(job->output, root,
+                                           authz_read_func, authz_read_baton,
+                                           receiver, receiver_baton,
+                                           cancel_func, cancel_baton,
+                                           scratch_pool),
+                   job->err);
+    }
+
+  err = job->err;
+  svn_pool_destroy(job->pool);
+  job->pool = NULL;
+
+  return svn_error_trace(err);
+}
+
+/* Like do_list() with infinite DEPTH but with up to JOBS sub-directories
+ * of PATH being walked at the same time.  ROOT must be a revision root.
+ * The entries are still reported in path order and all callbacks except
+ * CANCEL_FUNC get only called from the current thread.
+ */
+static svn_error_t *
+do_list_concurrently(svn_fs_root_t *root,
+                     const char *path,
+                     const apr_array_header_t *patterns,
+                     svn_boolean_t path_info_only,
+                     svn_repos_authz_func_t authz_read_func,
+                     void *authz_read_baton,
+                     svn_repos_dirent_receiver_t receiver,
+                     void *receiver_baton,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     int jobs,
+                     apr_pool_t *scratch_pool)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  svn_fs_t *fs = svn_fs_root_fs(root);
+  list_job_t settings = { 0 };
+  apr_array_header_t *sorted;
+  apr_array_header_t *sub_dirs;
+  int started = 0;
+  int finished = 0;
+  list_job_t *queue;
+  apr_array_header_t *batch;
+  apr_pool_t *thread_pool;
+  int i;
+
+  settings.fs_path = svn_fs_path(fs, scratch_pool);
+  settings.fs_config = svn_fs_config(fs, scratch_pool);
+  settings.revision = svn_fs_revision_root_revision(root);
+  settings.patterns = patterns;
+  settings.path_info_only = path_info_only;
+  settings.cancel_func = cancel_func;
+  settings.cancel_baton = cancel_baton;
+
+  SVN_ERR(get_sorted_entries(&sorted, root, path, patterns,
+                             svn_depth_infinity, scratch_pool, iterpool));
+
+  /* The sub-trees to hand out to the workers, in reporting order. */
+  sub_dirs = apr_array_make(scratch_pool, sorted->nelts,
+                            sizeof(const char *));
+  for (i = 0; i < sorted->nelts; ++i)
+    {
+      svn_fs_dirent_t *dirent = APR_ARRAY_IDX(sorted, i,
+                                              filtered_dirent_t).dirent;
+      if (dirent->kind == svn_node_dir)
+        APR_ARRAY_PUSH(sub_dirs, const char *)
+          = svn_dirent_join(path, dirent->name, scratch_pool);
+    }
+
+  /* Job pools are used from several threads. */
+  thread_pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  queue = apr_pcalloc(scratch_pool, jobs * sizeof(*queue));
+  batch = apr_array_make(scratch_pool, jobs, sizeof(list_job_t *));
+
+  for (i = 0; !err && i < sorted->nelts; ++i)
+    {
+      filtered_dirent_t *filtered = &APR_ARRAY_IDX(sorted, i,
+                                                   filtered_dirent_t);
+      svn_boolean_t has_access = TRUE;
+      const char *sub_path;
+
+      svn_pool_clear(iterpool);
+
+      /* List the next JOBS sub-trees once we have reported all
+         previously listed ones. */
+      if (filtered->dirent->kind == svn_node_dir && finished == started)
+        {
+          apr_array_clear(batch);
+          for (; started < sub_dirs->nelts && batch->nelts < jobs;
+               ++started)
+            {
+              list_job_t *job = &queue[batch->nelts];
+
+              init_list_job(job, &settings,
+                            APR_ARRAY_IDX(sub_dirs, started, const char *),
+                            thread_pool);
+              APR_ARRAY_PUSH(batch, list_job_t *) = job;
+            }
+
+          svn_thread__run_batch(batch, list_job_func, NULL, jobs);
+        }
+
+      /* Skip paths that we don't have access to? */
+      sub_path = svn_dirent_join(path, filtered->dirent->name, iterpool);
+      if (authz_read_func)
+        err = authz_read_func(&has_access, root, sub_path,
+                              authz_read_baton, iterpool);
+
+      /* Report entry, if it passed the filter. */
+      if (!err && has_access && filtered->is_match)
+        err = report_dirent(root, sub_path, filtered->dirent->kind,
+                            path_info_only, receiver, receiver_baton,
+                            iterpool);
+
+      if (!err && cancel_func)
+        err = cancel_func(cancel_baton);
+
+      /* Report the sub-tree contents. */
+      if (filtered->dirent->kind == svn_node_dir)
+        err = svn_error_compose_create(
+                err,
+                finish_list_job(&queue[finished++ % jobs],
+                                err || !has_access, root,
+                                authz_read_func, authz_read_baton,
+                                receiver, receiver_baton,
+                                cancel_func, cancel_baton, iterpool));
+    }
+
+  /* Release the sub-trees that we did not report. */
+  for (; finished < started; ++finished)
+    svn_error_clear(finish_list_job(&queue[finished % jobs], TRUE, NULL,
+                                    NULL, NULL, NULL, NULL, NULL, NULL,
+                                    iterpool));
+
+  svn_pool_destroy(thread_pool);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+/* Set *JOBS to the number of sub-trees that svn_repos_list() may walk
+ * concurrently under ROOT, as configured for its filesystem.  Use
+ * SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+get_list_jobs(int *jobs,
+              svn_fs_root_t *root,
+              apr_pool_t *scratch_pool)
+{
+  apr_hash_t *fs_config = svn_fs_config(svn_fs_root_fs(root), scratch_pool);
+  const char *jobs_value;
+
+  *jobs = 1;
+
+  /* The workers share the caches with us, so they must be thread-safe.
+     They also open the revision independently, which does not work for
+     transactions. */
+  jobs_value = fs_config ? svn_hash_gets(fs_config, SVN_FS_CONFIG_LIST_JOBS)
+                         : NULL;
+  if (   jobs_value
+      && svn_fs_is_revision_root(root)
+      && !svn_cache_config_get()->single_threaded)
+    {
+      apr_int64_t val;
+      SVN_ERR(svn_cstring_strtoi64(&val, jobs_value, 0, MAX_LIST_JOBS, 10));
+      *jobs = MAX(1, (int)val);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
 svn_error_t *
 svn_repos_list(svn_fs_root_t *root,
                const char *path,
@@ -323,6 +834,24 @@ svn_repos_list(svn_fs_root_t *root,
                           receiver, receiver_baton, scratch_pool));
 
   /* Report directory contents if requested. */
+#if APR_HAS_THREADS
+  if (depth == svn_depth_infinity)
+    {
+      int jobs;
+      SVN_ERR(get_list_jobs(&jobs, root, scratch_pool));
+      if (jobs > 1)
+        return svn_error_trace(do_list_concurrently(root, path, patterns,
+                                                    path_info_only,
+                                                    authz_read_func,
+                                                    authz_read_baton,
+                                                    receiver,
+                                                    receiver_baton,
+                                                    cancel_func,
+                                                    cancel_baton, jobs,
+                                                    scratch_pool));
+    }
+#endif
+
   if (depth > svn_depth_empty)
     SVN_ERR(do_list(root, path, patterns, depth,
                     path_info_only, authz_read_func, authz_read_baton,
@@ -21,6 +21,7 @@
  */
 
 
+#include <string.h>
 #include <apr.h>
 
 #include "svn_hash.h"
@@ -162,6 +163,120 @@ read_key_or_val(char **pbuf,
 }
 
 
+/* Property blocks up to this size will be read from the stream in one go
+   and then parsed in memory. */
+#define MAX_BUFFERED_PROPERTY_BLOCK (1024 * 1024)
+
+/* Set *P to the start of the LEN bytes following the line that starts at
+   *P and NUL-terminate them in place, overwriting the newline that must
+   follow them.  END is the end of the buffer.  Update *P to point behind
+   that newline. */
+static svn_error_t *
+take_key_or_val(char **p,
+                char *end,
+                apr_uint64_t len)
+{
+  char *data = *p;
+
+  if (len >= (apr_uint64_t)(end - data))
+    return svn_error_trace(stream_ran_dry());
+  if (data[len] != '\n')
+    return svn_error_trace(stream_malformed());
+
+  data[len] = '\0';
+  *p = data + len + 1;
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the property block of LEN bytes in DATA like parse_property_block
+   does when reading it from a stream.  The contents of DATA will be
+   modified in place.  DATA[LEN] must be '\0'.
+ */
+static svn_error_t *
+parse_buffered_property_block(char *data,
+                              apr_size_t len,
+                              const svn_repos_parse_fns3_t *parse_fns,
+                              void *record_baton,
+                              svn_boolean_t is_node)
+{
+  char *p = data;
+  char *end = data + len;
+
+  while (p < end)
+    {
+      char *line = p;
+      char *eol = memchr(p, '\n', end - p);
+      apr_uint64_t key_len;
+      char *keybuf;
+
+      if (eol == NULL)
+        return svn_error_create
+          (SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+           _("Incomplete or unterminated property block"));
+
+      *eol = '\0';
+      p = eol + 1;
+
+      if (! strcmp(line, "PROPS-END"))
+        break; /* no more properties. */
+
+      else if ((line[0] == 'K') && (line[1] == ' '))
+        {
+          svn_string_t propstring;
+          apr_uint64_t val_len;
+
+          SVN_ERR(svn_cstring_strtoui64(&key_len, line + 2, 0, APR_SIZE_MAX,
+                                        10));
+          keybuf = p;
+          SVN_ERR(take_key_or_val(&p, end, key_len));
+
+          /* Read a val length line */
+          line = p;
+          eol = memchr(p, '\n', end - p);
+          if (eol == NULL)
+            return stream_ran_dry();
+
+          *eol = '\0';
+          p = eol + 1;
+
+          if ((line[0] != 'V') || (line[1] != ' '))
+            return stream_malformed(); /* didn't find expected 'V' line */
+
+          SVN_ERR(svn_cstring_strtoui64(&val_len, line + 2, 0, APR_SIZE_MAX,
+                                        10));
+          propstring.data = p;
+          propstring.len = (apr_size_t)val_len;
+          SVN_ERR(take_key_or_val(&p, end, val_len));
+
+          /* Now, send the property pair to the vtable! */
+          if (is_node)
+            SVN_ERR(parse_fns->set_node_property(record_baton, keybuf,
+                                                 &propstring));
+          else
+            SVN_ERR(parse_fns->set_revision_property(record_baton, keybuf,
+                                                     &propstring));
+        }
+      else if ((line[0] == 'D') && (line[1] == ' '))
+        {
+          SVN_ERR(svn_cstring_strtoui64(&key_len, line + 2, 0, APR_SIZE_MAX,
+                                        10));
+          keybuf = p;
+          SVN_ERR(take_key_or_val(&p, end, key_len));
+
+          /* See parse_property_block. */
+          if (!is_node || !parse_fns->delete_node_property)
+            return stream_malformed();
+
+          SVN_ERR(parse_fns->delete_node_property(record_baton, keybuf));
+        }
+      else
+        return stream_malformed(); /* didn't find expected 'K' line */
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Read CONTENT_LENGTH bytes from STREAM, parsing the bytes as an
    encoded Subversion properties hash, and making multiple calls to
    PARSE_FNS->set_*_property on RECORD_BATON (depending on the value
@@ -170,10 +285,15 @@ read_key_or_val(char **pbuf,
    Set *ACTUAL_LENGTH to the number of bytes consumed from STREAM.
    If an error is returned, the value of *ACTUAL_LENGTH is undefined.
 
+   If EXACT_LENGTH is set, the property block is known to span exactly
+   CONTENT_LENGTH bytes.  Small blocks will then be read in one go, which
+   is much faster than parsing them line by line from STREAM.
+
    Use POOL for all allocations.  */
 static svn_error_t *
 parse_property_block(svn_stream_t *stream,
                      svn_filesize_t content_length,
+                     svn_boolean_t exact_length,
                      const svn_repos_parse_fns3_t *parse_fns,
                      void *record_baton,
                      void *parse_baton,
@@ -184,6 +304,25 @@ parse_property_block(svn_stream_t *stream,
   svn_stringbuf_t *strbuf;
   apr_pool_t *proppool = svn_pool_create(pool);
 
+  if (exact_length && content_length <= MAX_BUFFERED_PROPERTY_BLOCK)
+    {
+      apr_size_t len = (apr_size_t)content_length;
+      apr_size_t numread = len;
+      char *buf = apr_palloc(proppool, len + 1);
+
+      SVN_ERR(svn_stream_read_full(stream, buf, &numread));
+      if (numread != len)
+        return svn_error_trace(stream_ran_dry());
+
+      buf[len] = '\0';
+      *actual_length = content_length;
+      SVN_ERR(parse_buffered_property_block(buf, len, parse_fns,
+                                            record_baton, is_node));
+
+      svn_pool_destroy(proppool);
+      return SVN_NO_ERROR;
+    }
+
   *actual_length = 0;
   while (content_length != *actual_length)
     {
@@ -317,6 +456,30 @@ parse_text_block(svn_stream_t *stream,
       SVN_ERR(parse_fns->set_fulltext(&text_stream, record_baton));
     }
 
+  /* Without a sink for our data, we only need to get past it.  Seek
+     over it if STREAM allows, but read the last byte so that we still
+     notice truncated input. */
+  if (!text_stream && content_length && svn_stream_supports_mark(stream))
+    {
+      content_length--;
+      while (content_length)
+        {
+          apr_size_t skip_len = (content_length > APR_SIZE_MAX)
+                              ? APR_SIZE_MAX
+                              : (apr_size_t) content_length;
+
+          SVN_ERR(svn_stream_skip(stream, skip_len));
+          content_length -= skip_len;
+        }
+
+      rlen = 1;
+      SVN_ERR(svn_stream_read_full(stream, buffer, &rlen));
+      if (rlen != 1)
+        return stream_ran_dry();
+
+      return SVN_NO_ERROR;
+    }
+
   /* Regardless of whether or not we have a sink for our data, we
      need to read it. */
   while (content_length)
@@ -682,6 +845,7 @@ svn_repos_parse_dumpstream3(svn_stream_t *stream,
           SVN_ERR(parse_property_block
                   (stream,
                    svn__atoui64(prop_cl ? prop_cl : content_length),
+                   prop_cl != NULL,
                    parse_fns,
                    found_node ? node_baton : rev_baton,
                    parse_baton,
@@ -38,9 +38,11 @@
 #include "svn_props.h"
 #include "svn_mergeinfo.h"
 #include "repos.h"
+#include "private/svn_cache.h"
 #include "private/svn_fspath.h"
 #include "private/svn_fs_private.h"
 #include "private/svn_mergeinfo_private.h"
+#include "private/svn_skel.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_string_private.h"
@@ -56,6 +58,9 @@ typedef struct log_callbacks_t
   void *revision_receiver_baton;
   svn_repos_authz_func_t authz_read_func;
   void *authz_read_baton;
+
+  /* Cache of the mergeinfo changes per revision.  May be NULL. */
+  svn_cache__t *mergeinfo_changes;
 } log_callbacks_t;
 
 
@@ -497,65 +502,204 @@ get_history(struct path_info *info,
   return SVN_NO_ERROR;
 }
 
-/* Set INFO->HIST to the next history for the path *if* there is history
- * available and INFO->HISTORY_REV is equal to or greater than CURRENT.
- *
- * *CHANGED is set to TRUE if the path has history in the CURRENT revision,
- * otherwise it is not touched.
- *
- * If we do need to get the next history revision for the path, call
- * get_history to do it -- see it for details.
+/* Sort callback for a priority queue of struct path_info * elements,
+ * putting the path with the youngest pending history revision first.
  */
+static int
+compare_history_revs(const void *lhs,
+                     const void *rhs)
+{
+  const struct path_info *lhs_info = *(const struct path_info * const *)lhs;
+  const struct path_info *rhs_info = *(const struct path_info * const *)rhs;
+
+  if (lhs_info->history_rev == rhs_info->history_rev)
+    return 0;
+
+  return lhs_info->history_rev > rhs_info->history_rev ? -1 : 1;
+}
+
+/* The mergeinfo changes in a single revision, as reported by
+   fs_mergeinfo_changed().  This is what we keep in the mergeinfo changes
+   cache. */
+typedef struct mergeinfo_changes_t
+{
+  svn_mergeinfo_catalog_t deleted;
+  svn_mergeinfo_catalog_t added;
+} mergeinfo_changes_t;
+
+/* Append a skel describing MERGEINFO to LIST.  Allocate it in POOL. */
+static void
+mergeinfo_to_skel(svn_skel_t *list,
+                  svn_mergeinfo_t mergeinfo,
+                  apr_pool_t *pool)
+{
+  svn_skel_t *skel = svn_skel__make_empty_list(pool);
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(pool, mergeinfo); hi; hi = apr_hash_next(hi))
+    {
+      const char *source = apr_hash_this_key(hi);
+      svn_rangelist_t *rangelist = apr_hash_this_val(hi);
+      svn_skel_t *entry = svn_skel__make_empty_list(pool);
+      svn_stringbuf_t *ranges
+        = svn_stringbuf_create_ensure(rangelist->nelts
+                                        * sizeof(svn_merge_range_t),
+                                      pool);
+      int i;
+
+      /* The ranges don't leave this process, so store them verbatim. */
+      for (i = 0; i < rangelist->nelts; ++i)
+        svn_stringbuf_appendbytes(ranges,
+                                  (const char *)APR_ARRAY_IDX(rangelist, i,
+                                                   svn_merge_range_t *),
+                                  sizeof(svn_merge_range_t));
+
+      svn_skel__prepend(svn_skel__mem_atom(ranges->data, ranges->len, pool),
+                        entry);
+      svn_skel__prepend(svn_skel__str_atom(source, pool), entry);
+      svn_skel__prepend(entry, skel);
+    }
+
+  svn_skel__append(list, skel);
+}
+
+/* Return the mergeinfo described by SKEL, allocated in RESULT_POOL. */
+static svn_mergeinfo_t
+skel_to_mergeinfo(const svn_skel_t *skel,
+                  apr_pool_t *result_pool)
+{
+  svn_mergeinfo_t mergeinfo = svn_hash__make(result_pool);
+  const svn_skel_t *entry;
+
+  for (entry = skel->children; entry; entry = entry->next)
+    {
+      const svn_skel_t *source = entry->children;
+      const svn_skel_t *ranges = source->next;
+      int count = (int)(ranges->len / sizeof(svn_merge_range_t));
+      svn_rangelist_t *rangelist
+        = apr_array_make(result_pool, count, sizeof(svn_merge_range_t *));
+      int i;
+
+      for (i = 0; i < count; ++i)
+        {
+          svn_merge_range_t *range = apr_palloc(result_pool, sizeof(*range));
+          memcpy(range, ranges->data + i * sizeof(*range), sizeof(*range));
+          APR_ARRAY_PUSH(rangelist, svn_merge_range_t *) = range;
+        }
+
+      svn_hash_sets(mergeinfo,
+                    apr_pstrmemdup(result_pool, source->data, source->len),
+                    rangelist);
+    }
+
+  return mergeinfo;
+}
+
+/* Implements svn_cache__serialize_func_t for mergeinfo_changes_t. */
 static svn_error_t *
-check_history(svn_boolean_t *changed,
-              struct path_info *info,
-              svn_fs_t *fs,
-              svn_revnum_t current,
-              svn_boolean_t strict,
-              svn_repos_authz_func_t authz_read_func,
-              void *authz_read_baton,
-              svn_revnum_t start,
-              apr_pool_t *result_pool,
-              apr_pool_t *scratch_pool)
+serialize_mergeinfo_changes(void **data,
+                            apr_size_t *data_len,
+                            void *in,
+                            apr_pool_t *pool)
 {
-  /* If we're already done with histories for this path,
-     don't try to fetch any more. */
-  if (info->done)
-    return SVN_NO_ERROR;
+  mergeinfo_changes_t *changes = in;
+  svn_skel_t *skel = svn_skel__make_empty_list(pool);
+  svn_stringbuf_t *serialized;
+  apr_hash_index_t *hi;
 
-  /* If the last rev we got for this path is less than CURRENT,
-     then just return and don't fetch history for this path.
-     The caller will get to this rev eventually or else reach
-     the limit. */
-  if (info->history_rev < current)
-    return SVN_NO_ERROR;
+  /* Both catalogs always have the same keys. */
+  for (hi = apr_hash_first(pool, changes->added); hi; hi = apr_hash_next(hi))
+    {
+      const char *path = apr_hash_this_key(hi);
+      svn_skel_t *entry = svn_skel__make_empty_list(pool);
+
+      svn_skel__append(entry, svn_skel__str_atom(path, pool));
+      mergeinfo_to_skel(entry, svn_hash_gets(changes->deleted, path), pool);
+      mergeinfo_to_skel(entry, apr_hash_this_val(hi), pool);
+      svn_skel__prepend(entry, skel);
+    }
 
-  /* If the last rev we got for this path is equal to CURRENT
-     then set *CHANGED to true and get the next history
-     rev where this path was changed. */
-  *changed = TRUE;
-  return get_history(info, fs, strict, authz_read_func,
-                     authz_read_baton, start, result_pool, scratch_pool);
+  serialized = svn_skel__unparse(skel, pool);
+  *data = serialized->data;
+  *data_len = serialized->len;
+
+  return SVN_NO_ERROR;
 }
 
-/* Return the next interesting revision in our list of HISTORIES. */
-static svn_revnum_t
-next_history_rev(const apr_array_header_t *histories)
+/* Implements svn_cache__deserialize_func_t for mergeinfo_changes_t. */
+static svn_error_t *
+deserialize_mergeinfo_changes(void **out,
+                              void *data,
+                              apr_size_t data_len,
+                              apr_pool_t *result_pool)
 {
-  svn_revnum_t next_rev = SVN_INVALID_REVNUM;
-  int i;
+  mergeinfo_changes_t *changes = apr_palloc(result_pool, sizeof(*changes));
+  svn_skel_t *skel = svn_skel__parse(data, data_len, result_pool);
+  const svn_skel_t *entry;
 
-  for (i = 0; i < histories->nelts; ++i)
+  if (skel == NULL)
+    return svn_error_create(SVN_ERR_FS_MALFORMED_SKEL, NULL,
+                            _("Malformed mergeinfo changes cache entry"));
+
+  changes->deleted = svn_hash__make(result_pool);
+  changes->added = svn_hash__make(result_pool);
+
+  for (entry = skel->children; entry; entry = entry->next)
     {
-      struct path_info *info = APR_ARRAY_IDX(histories, i,
-                                             struct path_info *);
-      if (info->done)
-        continue;
-      if (info->history_rev > next_rev)
-        next_rev = info->history_rev;
+      const svn_skel_t *path = entry->children;
+      const char *key = apr_pstrmemdup(result_pool, path->data, path->len);
+
+      svn_hash_sets(changes->deleted, key,
+                    skel_to_mergeinfo(path->next, result_pool));
+      svn_hash_sets(changes->added, key,
+                    skel_to_mergeinfo(path->next->next, result_pool));
     }
 
-  return next_rev;
+  *out = changes;
+  return SVN_NO_ERROR;
+}
+
+/* Set *CACHE to the mergeinfo changes cache of REPOS, creating it if
+   necessary.  Set it to NULL if caching is disabled.  Use SCRATCH_POOL
+   for temporary allocations.
+
+   Mergeinfo changes are determined by the contents of a single, immutable
+   revision.  So, we may keep them in the process-wide membuffer cache and
+   share them between all repository instances of the same FS. */
+static svn_error_t *
+get_mergeinfo_changes_cache(svn_cache__t **cache,
+                            svn_repos_t *repos,
+                            apr_pool_t *scratch_pool)
+{
+  if (repos->mergeinfo_changes == NULL)
+    {
+      svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+      const char *uuid;
+
+      if (membuffer == NULL)
+        {
+          *cache = NULL;
+          return SVN_NO_ERROR;
+        }
+
+      /* The UUID alone is not unique, e.g. for replicas of a repository.
+         Qualify it with the repository location. */
+      SVN_ERR(svn_fs_get_uuid(repos->fs, &uuid, scratch_pool));
+      SVN_ERR(svn_cache__create_membuffer_cache(
+                  &repos->mergeinfo_changes,
+                  membuffer,
+                  serialize_mergeinfo_changes,
+                  deserialize_mergeinfo_changes,
+                  sizeof(svn_revnum_t),
+                  apr_pstrcat(scratch_pool, "svn-repos:mergeinfo-changes:",
+                              uuid, ":", repos->path, SVN_VA_NULL),
+                  SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                  FALSE, FALSE,
+                  repos->pool, scratch_pool));
+    }
+
+  *cache = repos->mergeinfo_changes;
+  return SVN_NO_ERROR;
 }
 
 /* Set *DELETED_MERGEINFO_CATALOG and *ADDED_MERGEINFO_CATALOG to
@@ -564,12 +708,12 @@ next_history_rev(const apr_array_header_t *histories)
 /* ### TODO: This would make a *great*, useful public function,
    ### svn_repos_fs_mergeinfo_changed()!  -- cmpilato  */
 static svn_error_t *
-fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
-                     svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
-                     svn_fs_t *fs,
-                     svn_revnum_t rev,
-                     apr_pool_t *result_pool,
-                     apr_pool_t *scratch_pool)
+calculate_mergeinfo_changes(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+                            svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+                            svn_fs_t *fs,
+                            svn_revnum_t rev,
+                            apr_pool_t *result_pool,
+                            apr_pool_t *scratch_pool)
 {
   svn_fs_root_t *root;
   apr_pool_t *iterpool, *iterator_pool;
@@ -823,16 +967,63 @@ fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
   return SVN_NO_ERROR;
 }
 
+/* Like calculate_mergeinfo_changes() but if CACHE is not NULL, look the
+   result up in there first and add it to CACHE after calculating it. */
+static svn_error_t *
+fs_mergeinfo_changed(svn_mergeinfo_catalog_t *deleted_mergeinfo_catalog,
+                     svn_mergeinfo_catalog_t *added_mergeinfo_catalog,
+                     svn_fs_t *fs,
+                     svn_revnum_t rev,
+                     svn_cache__t *cache,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  mergeinfo_changes_t changes;
+  svn_error_t *err;
+
+  if (cache && rev != 0)
+    {
+      mergeinfo_changes_t *cached;
+      svn_boolean_t found;
+
+      SVN_ERR(svn_cache__get((void **)&cached, &found, cache, &rev,
+                             result_pool));
+      if (found)
+        {
+          *deleted_mergeinfo_catalog = cached->deleted;
+          *added_mergeinfo_catalog = cached->added;
+          return SVN_NO_ERROR;
+        }
+    }
+
+  SVN_ERR(calculate_mergeinfo_changes(deleted_mergeinfo_catalog,
+                                      added_mergeinfo_catalog,
+                                      fs, rev, result_pool, scratch_pool));
+
+  if (cache && rev != 0)
+    {
+      changes.deleted = *deleted_mergeinfo_catalog;
+      changes.added = *added_mergeinfo_catalog;
+
+      /* Failing to cache the result must not fail the log request. */
+      err = svn_cache__set(cache, &rev, &changes, scratch_pool);
+      svn_error_clear(err);
+    }
+
+  return SVN_NO_ERROR;
+}
 
 /* Determine what (if any) mergeinfo for PATHS was modified in
    revision REV, returning the differences for added mergeinfo in
-   *ADDED_MERGEINFO and deleted mergeinfo in *DELETED_MERGEINFO. */
+   *ADDED_MERGEINFO and deleted mergeinfo in *DELETED_MERGEINFO.
+   CACHE is passed through to fs_mergeinfo_changed(). */
 static svn_error_t *
 get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
                                svn_mergeinfo_t *deleted_mergeinfo,
                                svn_fs_t *fs,
                                const apr_array_header_t *paths,
                                svn_revnum_t rev,
+                               svn_cache__t *cache,
                                apr_pool_t *result_pool,
                                apr_pool_t *scratch_pool)
 {
@@ -858,7 +1049,7 @@ get_combined_mergeinfo_changes(svn_mergeinfo_t *added_mergeinfo,
   /* Fetch the mergeinfo changes for REV. */
   err = fs_mergeinfo_changed(&deleted_mergeinfo_catalog,
                              &added_mergeinfo_catalog,
-                             fs, rev,
+                             fs, rev, cache,
                              scratch_pool, scratch_pool);
   if (err)
     {
@@ -1939,7 +2130,8 @@ do_logs(svn_fs_t *fs,
   apr_hash_t *rev_mergeinfo = NULL;
   svn_revnum_t current;
   apr_array_header_t *histories;
-  svn_boolean_t any_histories_left = TRUE;
+  apr_array_header_t *pending;
+  svn_priority_queue__t *queue;
   int send_count = 0;
   int i;
 
@@ -1966,34 +2158,54 @@ do_logs(svn_fs_t *fs,
                              callbacks->authz_read_func,
                              callbacks->authz_read_baton, pool));
 
+  /* Merge the per-path histories, youngest revision first.  Only those
+     paths that have not been depleted yet take part in the merge, so
+     each step is O(log #paths) instead of a scan over all of them. */
+  pending = apr_array_make(pool, histories->nelts,
+                           sizeof(struct path_info *));
+  for (i = 0; i < histories->nelts; i++)
+    {
+      struct path_info *info = APR_ARRAY_IDX(histories, i,
+                                             struct path_info *);
+      if (! info->done)
+        APR_ARRAY_PUSH(pending, struct path_info *) = info;
+    }
+
+  queue = svn_priority_queue__create(pending, compare_history_revs);
+
   /* Loop through all the revisions in the range and add any
      where a path was changed to the array, or if they wanted
      history in reverse order just send it to them right away. */
   iterpool = svn_pool_create(pool);
   iterpool2 = svn_pool_create(pool);
-  for (current = hist_end;
-       any_histories_left;
-       current = next_history_rev(histories))
+  while (svn_priority_queue__size(queue))
     {
       svn_boolean_t changed = FALSE;
-      any_histories_left = FALSE;
       svn_pool_clear(iterpool);
 
-      for (i = 0; i < histories->nelts; i++)
+      current = (*(struct path_info **)svn_priority_queue__peek(queue))
+                  ->history_rev;
+
+      /* Advance all paths that changed in CURRENT to their next history
+         revision. */
+      while (svn_priority_queue__size(queue))
         {
-          struct path_info *info = APR_ARRAY_IDX(histories, i,
-                                                 struct path_info *);
+          struct path_info *info
+            = *(struct path_info **)svn_priority_queue__peek(queue);
+          if (info->history_rev < current)
+            break;
 
           svn_pool_clear(iterpool2);
-
-          /* Check history for this path in current rev. */
-          SVN_ERR(check_history(&changed, info, fs, current,
-                                strict_node_history,
-                                callbacks->authz_read_func,
-                                callbacks->authz_read_baton,
-                                hist_start, pool, iterpool2));
-          if (! info->done)
-            any_histories_left = TRUE;
+          changed = TRUE;
+
+          SVN_ERR(get_history(info, fs, strict_node_history,
+                              callbacks->authz_read_func,
+                              callbacks->authz_read_baton,
+                              hist_start, pool, iterpool2));
+          if (info->done)
+            svn_priority_queue__pop(queue);
+          else
+            svn_priority_queue__update(queue);
         }
 
       svn_pool_clear(iterpool2);
@@ -2022,11 +2234,11 @@ do_logs(svn_fs_t *fs,
                                                          struct path_info *);
                   APR_ARRAY_PUSH(cur_paths, const char *) = info->path->data;
                 }
-              SVN_ERR(get_combined_mergeinfo_changes(&added_mergeinfo,
-                                                     &deleted_mergeinfo,
-                                                     fs, cur_paths,
-                                                     current,
-                                                     iterpool, iterpool));
+              SVN_ERR(get_combined_mergeinfo_changes(
+                          &added_mergeinfo, &deleted_mergeinfo,
+                          fs, cur_paths, current,
+                          callbacks->mergeinfo_changes,
+                          iterpool, iterpool));
               has_children = (apr_hash_count(added_mergeinfo) > 0
                               || apr_hash_count(deleted_mergeinfo) > 0);
             }
@@ -2281,6 +2493,10 @@ svn_repos_get_logs5(svn_repos_t *repos,
   callbacks.revision_receiver_baton = revision_receiver_baton;
   callbacks.authz_read_func = authz_read_func;
   callbacks.authz_read_baton = authz_read_baton;
+  callbacks.mergeinfo_changes = NULL;
+  if (include_merged_revisions)
+    SVN_ERR(get_mergeinfo_changes_cache(&callbacks.mergeinfo_changes, repos,
+                                        scratch_pool));
 
   if (revprops)
     {
@@ -2409,6 +2625,42 @@ svn_repos_get_logs5(svn_repos_t *repos,
       svn_pool_destroy(subpool);
     }
 
+  else
+    {
+      /* Without merged revisions, nothing after the youngest revision
+         that touched any of PATHS can make it into the log.  If the
+         filesystem can tell us that revision cheaply, start the history
+         crawl there.  PATHS still denote the same nodes as in END. */
+      svn_revnum_t youngest_change = start;
+      apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+      int i;
+
+      for (i = 0; i < paths->nelts; ++i)
+        {
+          apr_array_header_t *revisions;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(svn_fs_revisions_changed(&revisions, fs,
+                                           APR_ARRAY_IDX(paths, i,
+                                                         const char *),
+                                           start, end, 1,
+                                           iterpool, iterpool));
+          if (!revisions)
+            {
+              youngest_change = end;
+              break;
+            }
+
+          if (revisions->nelts)
+            youngest_change = MAX(youngest_change,
+                                  APR_ARRAY_IDX(revisions, 0,
+                                                svn_revnum_t));
+        }
+      svn_pool_destroy(iterpool);
+
+      end = youngest_change;
+    }
+
   return do_logs(repos->fs, paths, paths_history_mergeinfo, NULL, NULL,
                  start, end, limit, strict_node_history,
                  include_merged_revisions, FALSE, FALSE, FALSE,
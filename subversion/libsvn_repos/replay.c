@@ -918,15 +918,16 @@ get_relevant_changes(apr_hash_t **changed_paths,
 }
 
 svn_error_t *
-svn_repos_replay2(svn_fs_root_t *root,
-                  const char *base_path,
-                  svn_revnum_t low_water_mark,
-                  svn_boolean_t send_deltas,
-                  const svn_delta_editor_t *editor,
-                  void *edit_baton,
-                  svn_repos_authz_func_t authz_read_func,
-                  void *authz_read_baton,
-                  apr_pool_t *pool)
+svn_repos__replay_with_base(svn_fs_root_t *root,
+                            svn_fs_root_t *base_root,
+                            const char *base_path,
+                            svn_revnum_t low_water_mark,
+                            svn_boolean_t send_deltas,
+                            const svn_delta_editor_t *editor,
+                            void *edit_baton,
+                            svn_repos_authz_func_t authz_read_func,
+                            void *authz_read_baton,
+                            apr_pool_t *pool)
 {
 #ifndef USE_EV2_IMPL
   apr_hash_t *changed_paths;
@@ -969,12 +970,25 @@ svn_repos_replay2(svn_fs_root_t *root,
 
   if (send_deltas)
     {
-      SVN_ERR(svn_fs_revision_root(&cb_baton.compare_root,
-                                   svn_fs_root_fs(root),
-                                   svn_fs_is_revision_root(root)
-                                     ? svn_fs_revision_root_revision(root) - 1
-                                     : svn_fs_txn_root_base_revision(root),
-                                   pool));
+      svn_revnum_t base_rev = svn_fs_is_revision_root(root)
+                            ? svn_fs_revision_root_revision(root) - 1
+                            : svn_fs_txn_root_base_revision(root);
+
+      /* Re-using the caller's root keeps the nodes and contents that it
+         already looked up at hand. */
+      if (base_root)
+        {
+          SVN_ERR_ASSERT(svn_fs_is_revision_root(base_root)
+                         && svn_fs_revision_root_revision(base_root)
+                              == base_rev);
+          cb_baton.compare_root = base_root;
+        }
+      else
+        {
+          SVN_ERR(svn_fs_revision_root(&cb_baton.compare_root,
+                                       svn_fs_root_fs(root), base_rev,
+                                       pool));
+        }
     }
 
   cb_baton.copies = apr_array_make(pool, 4, sizeof(struct copy_info *));
@@ -1051,6 +1065,26 @@ svn_repos_replay2(svn_fs_root_t *root,
 #endif
 }
 
+svn_error_t *
+svn_repos_replay2(svn_fs_root_t *root,
+                  const char *base_path,
+                  svn_revnum_t low_water_mark,
+                  svn_boolean_t send_deltas,
+                  const svn_delta_editor_t *editor,
+                  void *edit_baton,
+                  svn_repos_authz_func_t authz_read_func,
+                  void *authz_read_baton,
+                  apr_pool_t *pool)
+{
+  return svn_error_trace(svn_repos__replay_with_base(root, NULL, base_path,
+                                                     low_water_mark,
+                                                     send_deltas,
+                                                     editor, edit_baton,
+                                                     authz_read_func,
+                                                     authz_read_baton,
+                                                     pool));
+}
+
 
 /*****************************************************************
  *                      Ev2 Implementation                       *
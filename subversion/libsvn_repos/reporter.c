@@ -21,6 +21,14 @@
  * ====================================================================
  */
 
+#include <apr_general.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#endif
+
+#include "svn_cache_config.h"
 #include "svn_dirent_uri.h"
 #include "svn_hash.h"
 #include "svn_path.h"
@@ -36,16 +44,40 @@
 
 #include "private/svn_dep_compat.h"
 #include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_string_private.h"
 
 #define NUM_CACHED_SOURCE_ROOTS 4
 
+/* Reports whose path infos take up no more than this number of bytes
+   are kept in memory instead of being serialized to a spill-buffer. */
+#define MAX_IN_MEMORY_REPORT_SIZE (16 * 1024 * 1024)
+
+/* Upper limit to the number of threads computing text deltas ahead of
+   the editor drive. */
+#define MAX_DELTA_WORKERS 64
+
+/* Number of files per delta worker thread whose deltas may be computed
+   ahead of the editor drive. */
+#define DELTA_JOBS_PER_WORKER 4
+
+/* Deltas whose windows need more than this number of bytes will be
+   computed by the editor drive itself. */
+#define MAX_DELTA_JOB_SIZE (1024 * 1024)
+
 /* Theory of operation: we write report operations out to a spill-buffer
    as we receive them.  When the report is finished, we read the
    operations back out again, using them to guide the progression of
    the delta between the source and target revs.
 
+   As long as the report is small enough, we simply keep the operations
+   as path_info_t structs in an array, in the order received.  Only once
+   they exceed MAX_IN_MEMORY_REPORT_SIZE, they get moved to the
+   spill-buffer.  In memory, we also know for each operation where the
+   run of operations for paths below it ends, so skipping a sub-tree
+   becomes a single step instead of a sequential scan.
+
    Spill-buffer content format: we use a simple ad-hoc format to store the
    report operations.  Each report operation is the concatention of
    the following ("+/-" indicates the single character '+' or '-';
@@ -77,7 +109,8 @@
 /* Describes the state of a working copy subtree, as given by a
    report.  Because we keep a lookahead pathinfo, we need to allocate
    each one of these things in a subpool of the report baton and free
-   it when done. */
+   it when done.  Pathinfos of reports kept in memory don't have pools
+   of their own; see release_path_info(). */
 typedef struct path_info_t
 {
   const char *path;            /* path, munged to be anchor-relative */
@@ -86,7 +119,7 @@ typedef struct path_info_t
   svn_depth_t depth;           /* Depth of this path, meaningless for files */
   svn_boolean_t start_empty;   /* Meaningless for delete_path */
   const char *lock_token;      /* NULL if no token */
-  apr_pool_t *pool;            /* Container pool */
+  apr_pool_t *pool;            /* Container pool, may be NULL */
 } path_info_t;
 
 /* Describes the standard revision properties that are relevant for
@@ -128,9 +161,33 @@ typedef struct report_baton_t
   svn_repos_authz_func_t authz_read_func;
   void *authz_read_baton;
 
+  /* Optional callback answering recursive read access checks, see
+     svn_repos__report_set_subtree_authz().  READABLE_SUBTREE is the
+     outermost target directory currently being edited that it found
+     to be fully readable, or NULL. */
+  svn_repos_authz_callback_t authz_subtree_func;
+  void *authz_subtree_baton;
+  const char *readable_subtree;
+
   /* The spill-buffer holding the report. */
   svn_spillbuf_reader_t *reader;
 
+  /* The path_info_t * of the report if it is being kept in memory, in
+     reporting order, or NULL if it has been written to READER.  They get
+     allocated in INFOS_POOL and use about INFOS_SIZE bytes.  After the
+     report has been finished, the pathinfos from index I+1 up to but not
+     including SUBTREE_ENDS[I] are exactly those for descendants of the
+     pathinfo at index I, and NEXT_INFO is the index of the entry that
+     follows the lookahead. */
+  apr_array_header_t *infos;
+  apr_pool_t *infos_pool;
+  apr_size_t infos_size;
+  int *subtree_ends;
+  int next_info;
+
+  /* Threads computing text deltas ahead of time, NULL if not used. */
+  struct delta_workers_t *workers;
+
   /* For the actual editor drive, we'll need a lookahead path info
      entry, a cache of FS roots, and a pool to store them. */
   path_info_t *lookahead;
@@ -144,6 +201,9 @@ typedef struct report_baton_t
   /* This will not change. So, fetch it once and reuse it. */
   svn_string_t *repos_uuid;
   apr_pool_t *pool;
+
+  /* When the client started sending the report, for REPOS->TRACE. */
+  apr_time_t report_start;
 } report_baton_t;
 
 /* The type of a function that accepts changes to an object's property
@@ -321,6 +381,69 @@ relevant(path_info_t *pi, const char *prefix, apr_size_t plen)
           (!*prefix || pi->path[plen] == '/'));
 }
 
+/* Advance B->lookahead to the next pathinfo of the report, or to NULL
+   at the end of the report. */
+static svn_error_t *
+read_lookahead(report_baton_t *b)
+{
+  if (b->infos)
+    {
+      b->lookahead = b->next_info < b->infos->nelts
+                   ? APR_ARRAY_IDX(b->infos, b->next_info, path_info_t *)
+                   : NULL;
+      b->next_info++;
+
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(read_path_info(&b->lookahead, b->reader,
+                                        svn_pool_create(b->pool)));
+}
+
+/* Determine B->SUBTREE_ENDS for the complete in-memory report of B. */
+static void
+index_path_infos(report_baton_t *b)
+{
+  int count = b->infos->nelts;
+  int *stack = apr_palloc(b->infos_pool, count * sizeof(*stack));
+  int depth = 0;
+  int i;
+
+  b->subtree_ends = apr_palloc(b->infos_pool, count * sizeof(int));
+  b->next_info = 0;
+
+  /* STACK holds the entries whose runs of descendants continue up to
+     the current entry.  Each of them is a descendant of the ones below
+     it on the stack. */
+  for (i = 0; i < count; ++i)
+    {
+      path_info_t *info = APR_ARRAY_IDX(b->infos, i, path_info_t *);
+
+      while (depth > 0)
+        {
+          path_info_t *parent = APR_ARRAY_IDX(b->infos, stack[depth - 1],
+                                              path_info_t *);
+          if (relevant(info, parent->path, strlen(parent->path)))
+            break;
+
+          b->subtree_ends[stack[--depth]] = i;
+        }
+
+      stack[depth++] = i;
+    }
+
+  while (depth > 0)
+    b->subtree_ends[stack[--depth]] = count;
+}
+
+/* Release the memory used by pathinfo INFO, if it has a pool of its own. */
+static void
+release_path_info(path_info_t *info)
+{
+  if (info->pool)
+    svn_pool_destroy(info->pool);
+}
+
 /* Fetch the next pathinfo from B->reader for a descendant of
    PREFIX.  If the next pathinfo is for an immediate child of PREFIX,
    set *ENTRY to the path component of the report information and
@@ -343,7 +466,6 @@ fetch_path_info(report_baton_t *b, const char **entry, path_info_t **info,
 {
   apr_size_t plen = strlen(prefix);
   const char *relpath, *sep;
-  apr_pool_t *subpool;
 
   if (!relevant(b->lookahead, prefix, plen))
     {
@@ -367,8 +489,7 @@ fetch_path_info(report_baton_t *b, const char **entry, path_info_t **info,
           /* This is an immediate child; return it and advance. */
           *entry = relpath;
           *info = b->lookahead;
-          subpool = svn_pool_create(b->pool);
-          SVN_ERR(read_path_info(&b->lookahead, b->reader, subpool));
+          SVN_ERR(read_lookahead(b));
         }
     }
   return SVN_NO_ERROR;
@@ -380,13 +501,16 @@ static svn_error_t *
 skip_path_info(report_baton_t *b, const char *prefix)
 {
   apr_size_t plen = strlen(prefix);
-  apr_pool_t *subpool;
 
   while (relevant(b->lookahead, prefix, plen))
     {
-      svn_pool_destroy(b->lookahead->pool);
-      subpool = svn_pool_create(b->pool);
-      SVN_ERR(read_path_info(&b->lookahead, b->reader, subpool));
+      /* All descendants of the lookahead are relevant as well. */
+      if (b->infos)
+        b->next_info = b->subtree_ends[b->next_info - 1];
+      else
+        release_path_info(b->lookahead);
+
+      SVN_ERR(read_lookahead(b));
     }
   return SVN_NO_ERROR;
 }
@@ -615,6 +739,371 @@ delta_proplists(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
   return SVN_NO_ERROR;
 }
 
+/* --- COMPUTING TEXT DELTAS AHEAD OF TIME --- */
+
+/* A text delta from S_REV / S_PATH (NULL for the empty file) to T_PATH in
+   the target revision that may be computed by a delta worker thread
+   before the editor drive gets to that file. */
+typedef struct delta_job_t
+{
+  svn_revnum_t s_rev;
+  const char *s_path;
+  const char *t_path;
+
+  /* Set once a worker picked up this job and once it has been finished,
+     respectively. */
+  svn_boolean_t started;
+  svn_boolean_t finished;
+
+  /* Valid once FINISHED has been set.  Unless COMPLETE is set, e.g. if
+     the delta turned out to be too large, the editor drive has to compute
+     the delta itself.  WINDOWS contains all svn_txdelta_window_t * of the
+     delta but the terminating NULL window. */
+  svn_boolean_t complete;
+  apr_array_header_t *windows;
+
+  /* Private pool of this job. */
+  apr_pool_t *pool;
+
+  /* Next job in the queue of jobs that have not been started yet. */
+  struct delta_job_t *next;
+} delta_job_t;
+
+/* The threads computing text deltas for an editor drive. */
+typedef struct delta_workers_t
+{
+  /* Filesystem to open and target revision to use in the workers. */
+  const char *fs_path;
+  apr_hash_t *fs_config;
+  svn_revnum_t t_rev;
+
+  /* Maps target paths to delta_job_t * that have been scheduled but not
+     yet taken by the editor drive.  Only used by the calling thread. */
+  apr_hash_t *jobs;
+  int max_jobs;
+
+#if APR_HAS_THREADS
+  /* Guards all following members as well as the STARTED and FINISHED
+     flags of all jobs. */
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *cond;
+  delta_job_t *queue_head;
+  delta_job_t *queue_tail;
+  svn_boolean_t shutdown;
+
+  apr_thread_t **threads;
+  int thread_count;
+#endif
+
+  /* Thread-safe pool containing all worker and job memory. */
+  apr_pool_t *pool;
+} delta_workers_t;
+
+#if APR_HAS_THREADS
+
+/* Compute the delta of JOB, reading the target from T_ROOT.  *S_ROOT is
+   the source root last used by the calling worker; replace it as needed
+   with a root of FS, allocated in WORKER_POOL. */
+static svn_error_t *
+compute_delta_job(delta_job_t *job,
+                  svn_fs_t *fs,
+                  svn_fs_root_t *t_root,
+                  svn_fs_root_t **s_root,
+                  apr_pool_t *worker_pool)
+{
+  svn_txdelta_stream_t *dstream;
+  apr_size_t size = 0;
+  apr_pool_t *iterpool;
+
+  if (job->s_path)
+    {
+      svn_boolean_t changed;
+
+      if (*s_root && svn_fs_revision_root_revision(*s_root) != job->s_rev)
+        {
+          svn_fs_close_root(*s_root);
+          *s_root = NULL;
+        }
+
+      if (*s_root == NULL)
+        SVN_ERR(svn_fs_revision_root(s_root, fs, job->s_rev, worker_pool));
+
+      /* Nothing to do for the editor drive, either. */
+      SVN_ERR(svn_fs_contents_different(&changed, t_root, job->t_path,
+                                        *s_root, job->s_path, job->pool));
+      if (!changed)
+        return SVN_NO_ERROR;
+    }
+
+  SVN_ERR(svn_fs_get_file_delta_stream(&dstream,
+                                       job->s_path ? *s_root : NULL,
+                                       job->s_path, t_root, job->t_path,
+                                       job->pool));
+
+  iterpool = svn_pool_create(job->pool);
+  while (TRUE)
+    {
+      svn_txdelta_window_t *window;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_txdelta_next_window(&window, dstream, iterpool));
+      if (window == NULL)
+        break;
+
+      size += window->num_ops * sizeof(*window->ops)
+            + (window->new_data ? window->new_data->len : 0);
+      if (size > MAX_DELTA_JOB_SIZE)
+        break;
+
+      APR_ARRAY_PUSH(job->windows, svn_txdelta_window_t *)
+        = svn_txdelta_window_dup(window, job->pool);
+    }
+  svn_pool_destroy(iterpool);
+
+  job->complete = size <= MAX_DELTA_JOB_SIZE;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements apr_thread_start_t, processing the queue of the
+   delta_workers_t in DATA using a private filesystem instance. */
+static void * APR_THREAD_FUNC
+delta_worker(apr_thread_t *thread, void *data)
+{
+  delta_workers_t *workers = data;
+  apr_pool_t *pool = svn_pool_create(workers->pool);
+  apr_hash_t *fs_config;
+  svn_fs_t *fs;
+  svn_fs_root_t *t_root = NULL;
+  svn_fs_root_t *s_root = NULL;
+  svn_error_t *err;
+
+  apr_thread_mutex_lock(workers->mutex);
+  fs_config = workers->fs_config ? apr_hash_copy(pool, workers->fs_config)
+                                 : NULL;
+  apr_thread_mutex_unlock(workers->mutex);
+
+  err = svn_fs_open2(&fs, workers->fs_path, fs_config, pool, pool);
+  if (!err)
+    err = svn_fs_revision_root(&t_root, fs, workers->t_rev, pool);
+
+  while (TRUE)
+    {
+      delta_job_t *job;
+
+      apr_thread_mutex_lock(workers->mutex);
+      while (!workers->queue_head && !workers->shutdown)
+        apr_thread_cond_wait(workers->cond, workers->mutex);
+
+      job = workers->shutdown ? NULL : workers->queue_head;
+      if (job)
+        {
+          workers->queue_head = job->next;
+          if (workers->queue_head == NULL)
+            workers->queue_tail = NULL;
+          job->started = TRUE;
+        }
+      apr_thread_mutex_unlock(workers->mutex);
+
+      if (job == NULL)
+        break;
+
+      /* The results are merely a shortcut for the editor drive, which
+         will compute the delta itself and report any errors. */
+      if (!err)
+        svn_error_clear(compute_delta_job(job, fs, t_root, &s_root, pool));
+
+      apr_thread_mutex_lock(workers->mutex);
+      job->finished = TRUE;
+      apr_thread_cond_broadcast(workers->cond);
+      apr_thread_mutex_unlock(workers->mutex);
+    }
+
+  svn_error_clear(err);
+  svn_pool_destroy(pool);
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Pool cleanup function stopping the delta_workers_t in DATA and
+   releasing all its jobs. */
+static apr_status_t
+stop_delta_workers(void *data)
+{
+  delta_workers_t *workers = data;
+  int i;
+
+  apr_thread_mutex_lock(workers->mutex);
+  workers->shutdown = TRUE;
+  apr_thread_cond_broadcast(workers->cond);
+  apr_thread_mutex_unlock(workers->mutex);
+
+  for (i = 0; i < workers->thread_count; ++i)
+    {
+      apr_status_t retval;
+      apr_thread_join(&retval, workers->threads[i]);
+    }
+
+  svn_pool_destroy(workers->pool);
+
+  return APR_SUCCESS;
+}
+
+#endif
+
+/* Start the delta workers for the editor drive of B if it has been
+   configured to use them.  Allocate the workers in POOL; they will be
+   stopped when POOL gets cleaned up. */
+static svn_error_t *
+start_delta_workers(report_baton_t *b, apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  apr_hash_t *fs_config = svn_fs_config(b->repos->fs, pool);
+  const char *value;
+  delta_workers_t *workers;
+  apr_int64_t count;
+  int i;
+
+  value = fs_config ? svn_hash_gets(fs_config, SVN_FS_CONFIG_REPORT_DELTA_JOBS)
+                    : NULL;
+  if (!value || !b->text_deltas || svn_cache_config_get()->single_threaded)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cstring_strtoi64(&count, value, 0, MAX_DELTA_WORKERS, 10));
+  if (count < 2)
+    return SVN_NO_ERROR;
+
+  workers = apr_pcalloc(pool, sizeof(*workers));
+  workers->fs_path = svn_fs_path(b->repos->fs, pool);
+  workers->fs_config = fs_config;
+  workers->t_rev = b->t_rev;
+  workers->jobs = apr_hash_make(pool);
+  workers->max_jobs = (int)count * DELTA_JOBS_PER_WORKER;
+  workers->threads = apr_pcalloc(pool, count * sizeof(*workers->threads));
+
+  /* Workers and editor drive allocate and release job memory
+     concurrently. */
+  workers->pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  if (   apr_thread_mutex_create(&workers->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                 workers->pool)
+      || apr_thread_cond_create(&workers->cond, workers->pool))
+    {
+      svn_pool_destroy(workers->pool);
+      return SVN_NO_ERROR;
+    }
+
+  for (i = 0; i < count; ++i)
+    if (apr_thread_create(&workers->threads[workers->thread_count], NULL,
+                          delta_worker, workers, workers->pool)
+        == APR_SUCCESS)
+      ++workers->thread_count;
+
+  /* The threads must be gone before their pools get destroyed. */
+  apr_pool_pre_cleanup_register(pool, workers, stop_delta_workers);
+  if (workers->thread_count)
+    b->workers = workers;
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* If B uses delta workers, schedule the delta from S_REV / S_PATH to
+   T_PATH to be computed by them.  S_PATH may be NULL for an added file.
+   Don't schedule more jobs than the workers can process ahead of time. */
+static void
+schedule_delta_job(report_baton_t *b,
+                   svn_revnum_t s_rev,
+                   const char *s_path,
+                   const char *t_path)
+{
+#if APR_HAS_THREADS
+  delta_workers_t *workers = b->workers;
+  delta_job_t *job;
+  apr_pool_t *job_pool;
+
+  if (   !workers
+      || apr_hash_count(workers->jobs) >= (unsigned)workers->max_jobs
+      || svn_hash_gets(workers->jobs, t_path))
+    return;
+
+  job_pool = svn_pool_create(workers->pool);
+  job = apr_pcalloc(job_pool, sizeof(*job));
+  job->s_rev = s_rev;
+  job->s_path = s_path ? apr_pstrdup(job_pool, s_path) : NULL;
+  job->t_path = apr_pstrdup(job_pool, t_path);
+  job->windows = apr_array_make(job_pool, 4, sizeof(svn_txdelta_window_t *));
+  job->pool = job_pool;
+  svn_hash_sets(workers->jobs, job->t_path, job);
+
+  apr_thread_mutex_lock(workers->mutex);
+  if (workers->queue_tail)
+    workers->queue_tail->next = job;
+  else
+    workers->queue_head = job;
+  workers->queue_tail = job;
+  apr_thread_cond_signal(workers->cond);
+  apr_thread_mutex_unlock(workers->mutex);
+#endif
+}
+
+/* If a delta job has been scheduled for T_PATH in B, remove it from the
+   schedule, wait for it to finish if it has been started and return it.
+   Otherwise, return NULL.  The caller must release the job's pool. */
+static delta_job_t *
+take_delta_job(report_baton_t *b,
+               const char *t_path)
+{
+#if APR_HAS_THREADS
+  delta_workers_t *workers = b->workers;
+  delta_job_t *job;
+
+  job = workers ? svn_hash_gets(workers->jobs, t_path) : NULL;
+  if (!job)
+    return NULL;
+
+  svn_hash_sets(workers->jobs, t_path, NULL);
+
+  apr_thread_mutex_lock(workers->mutex);
+  if (!job->started)
+    {
+      /* Don't wait for it; simply drop it from the queue. */
+      delta_job_t **link = &workers->queue_head;
+      delta_job_t *prev = NULL;
+
+      while (*link != job)
+        {
+          prev = *link;
+          link = &(*link)->next;
+        }
+
+      *link = job->next;
+      if (workers->queue_tail == job)
+        workers->queue_tail = prev;
+    }
+  else
+    {
+      while (!job->finished)
+        apr_thread_cond_wait(workers->cond, workers->mutex);
+    }
+  apr_thread_mutex_unlock(workers->mutex);
+
+  return job;
+#else
+  return NULL;
+#endif
+}
+
+/* Release the delta job scheduled for T_PATH in B, if there is one. */
+static void
+release_delta_job(report_baton_t *b,
+                  const char *t_path)
+{
+  delta_job_t *job = take_delta_job(b, t_path);
+  if (job)
+    svn_pool_destroy(job->pool);
+}
+
 /* Baton type to be passed into send_zero_copy_delta.
  */
 typedef struct zero_copy_baton_t
@@ -665,11 +1154,13 @@ send_zero_copy_delta(const unsigned char *contents,
 /* Make the appropriate edits on FILE_BATON to change its contents and
    properties from those in S_REV/S_PATH to those in B->t_root/T_PATH,
    possibly using LOCK_TOKEN to determine if the client's lock on the file
-   is defunct. */
+   is defunct.  If JOB is not NULL, it is the finished delta job for
+   T_PATH, which may contain the required delta already. */
 static svn_error_t *
-delta_files(report_baton_t *b, void *file_baton, svn_revnum_t s_rev,
-            const char *s_path, const char *t_path, const char *lock_token,
-            apr_pool_t *pool)
+send_file_delta(report_baton_t *b, void *file_baton, svn_revnum_t s_rev,
+                const char *s_path, const char *t_path,
+                const char *lock_token, const delta_job_t *job,
+                apr_pool_t *pool)
 {
   svn_fs_root_t *s_root = NULL;
   svn_txdelta_stream_t *dstream = NULL;
@@ -710,6 +1201,22 @@ delta_files(report_baton_t *b, void *file_baton, svn_revnum_t s_rev,
     {
       if (b->text_deltas)
         {
+          /* Did a worker compute the delta we need already? */
+          if (   job && job->complete && job->s_rev == s_rev
+              && (job->s_path && s_path
+                    ? strcmp(job->s_path, s_path) == 0
+                    : job->s_path == s_path))
+            {
+              int i;
+
+              for (i = 0; i < job->windows->nelts; ++i)
+                SVN_ERR(dhandler(APR_ARRAY_IDX(job->windows, i,
+                                               svn_txdelta_window_t *),
+                                 dbaton));
+
+              return svn_error_trace(dhandler(NULL, dbaton));
+            }
+
           /* if we send deltas against empty streams, we may use our
              zero-copy code. */
           if (b->zero_copy_limit > 0 && s_path == NULL)
@@ -743,18 +1250,67 @@ delta_files(report_baton_t *b, void *file_baton, svn_revnum_t s_rev,
   return SVN_NO_ERROR;
 }
 
+/* Like send_file_delta() but use and release any delta job scheduled for
+   T_PATH. */
+static svn_error_t *
+delta_files(report_baton_t *b, void *file_baton, svn_revnum_t s_rev,
+            const char *s_path, const char *t_path, const char *lock_token,
+            apr_pool_t *pool)
+{
+  delta_job_t *job = take_delta_job(b, t_path);
+  svn_error_t *err = send_file_delta(b, file_baton, s_rev, s_path, t_path,
+                                     lock_token, job, pool);
+  if (job)
+    svn_pool_destroy(job->pool);
+
+  return svn_error_trace(err);
+}
+
 /* Determine if the user is authorized to view B->t_root/PATH. */
 static svn_error_t *
 check_auth(report_baton_t *b, svn_boolean_t *allowed, const char *path,
            apr_pool_t *pool)
 {
-  if (b->authz_read_func)
+  /* No need to ask about paths within a fully readable sub-tree. */
+  if (b->authz_read_func
+      && !(b->readable_subtree
+           && svn_fspath__skip_ancestor(b->readable_subtree, path)))
     return svn_error_trace(b->authz_read_func(allowed, b->t_root, path,
                                               b->authz_read_baton, pool));
   *allowed = TRUE;
   return SVN_NO_ERROR;
 }
 
+/* If B can check recursive access rights and PATH is not known to be
+   fully readable, yet, check whether all of B->t_root/PATH is readable.
+   If so, make B->readable_subtree point to PATH and set *ENTERED.
+   Otherwise, set *ENTERED to FALSE.  PATH must remain valid until the
+   caller resets B->readable_subtree.  Use POOL for temporary
+   allocations. */
+static svn_error_t *
+enter_readable_subtree(report_baton_t *b,
+                       svn_boolean_t *entered,
+                       const char *path,
+                       apr_pool_t *pool)
+{
+  svn_boolean_t allowed;
+
+  *entered = FALSE;
+  if (!b->authz_read_func || !b->authz_subtree_func || b->readable_subtree)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(b->authz_subtree_func(svn_authz_read | svn_authz_recursive,
+                                &allowed, b->t_root, path,
+                                b->authz_subtree_baton, pool));
+  if (allowed)
+    {
+      b->readable_subtree = path;
+      *entered = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Create a dirent in *ENTRY for the given ROOT and PATH.  We use this to
    replace the source or target dirent when a report pathinfo tells us to
    change paths or revisions. */
@@ -809,6 +1365,72 @@ is_depth_upgrade(svn_depth_t wc_depth,
   return TRUE;
 }
 
+/* For the entries of ORDERED_ENTRIES from index *NEXT onwards, schedule
+   the text deltas that the loop over the target entries in delta_dirs()
+   will most likely request from delta_files(), as far as the delta
+   workers of B can take them.  Set *NEXT to the first entry that has not
+   been considered yet.  S_REV, S_PATH, S_ENTRIES, T_PATH, WC_DEPTH and
+   REQUESTED_DEPTH are the respective parameters and variables of
+   delta_dirs().  Use SCRATCH_POOL for temporary allocations. */
+static void
+schedule_delta_jobs(report_baton_t *b,
+                    int *next,
+                    const apr_array_header_t *ordered_entries,
+                    svn_revnum_t s_rev,
+                    const char *s_path,
+                    apr_hash_t *s_entries,
+                    const char *t_path,
+                    svn_depth_t wc_depth,
+                    svn_depth_t requested_depth,
+                    apr_pool_t *scratch_pool)
+{
+  for (; *next < ordered_entries->nelts; ++*next)
+    {
+      const svn_fs_dirent_t *t_entry
+        = APR_ARRAY_IDX(ordered_entries, *next, svn_fs_dirent_t *);
+      const svn_fs_dirent_t *s_entry = NULL;
+      const char *s_fullpath = NULL;
+
+      if (apr_hash_count(b->workers->jobs) >= (unsigned)b->workers->max_jobs)
+        break;
+
+      if (t_entry->kind != svn_node_file)
+        continue;
+
+      /* Mimic update_entry() for entries without path info. */
+      if (!is_depth_upgrade(wc_depth, requested_depth, t_entry->kind))
+        {
+          if (   requested_depth == svn_depth_unknown
+              && wc_depth < svn_depth_files)
+            continue;
+
+          s_entry = s_entries ? svn_hash_gets(s_entries, t_entry->name)
+                              : NULL;
+        }
+
+      if (s_entry && s_entry->kind == svn_node_file)
+        {
+          int distance = svn_fs_compare_ids(s_entry->id, t_entry->id);
+
+          /* Unchanged, no delta required. */
+          if (distance == 0)
+            continue;
+
+          if (distance != -1 || b->ignore_ancestry)
+            s_fullpath = svn_fspath__join(s_path, t_entry->name,
+                                          scratch_pool);
+        }
+
+      /* Added files might get sent as copies. */
+      if (!s_fullpath && b->send_copyfrom_args)
+        continue;
+
+      schedule_delta_job(b, s_rev, s_fullpath,
+                         svn_fspath__join(t_path, t_entry->name,
+                                          scratch_pool));
+    }
+}
+
 
 /* Call the B->editor's add_file() function to create PATH as a child
    of PARENT_BATON, returning a new baton in *NEW_FILE_BATON.
@@ -1164,6 +1786,8 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
   apr_hash_index_t *hi;
   apr_pool_t *subpool = svn_pool_create(pool);
   apr_array_header_t *t_ordered_entries = NULL;
+  svn_boolean_t readable_subtree = FALSE;
+  int next_to_schedule = 0;
   int i;
 
   /* Compare the property lists.  If we're starting empty, pass a NULL
@@ -1189,6 +1813,11 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
         }
       SVN_ERR(svn_fs_dir_entries(&t_entries, b->t_root, t_path, subpool));
 
+      /* Ask once whether we may skip the authz checks for all entries. */
+      if (apr_hash_count(t_entries))
+        SVN_ERR(enter_readable_subtree(b, &readable_subtree, t_path,
+                                       subpool));
+
       /* Iterate over the report information for this directory. */
       iterpool = svn_pool_create(subpool);
 
@@ -1217,7 +1846,7 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
               if (s_entries)
                 svn_hash_sets(s_entries, name, NULL);
 
-              svn_pool_destroy(info->pool);
+              release_path_info(info);
               continue;
             }
 
@@ -1256,7 +1885,7 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
           /* pathinfo entries live in their own subpools due to lookahead,
              so we need to clear each one out as we finish with it. */
           if (info)
-            svn_pool_destroy(info->pool);
+            release_path_info(info);
         }
 
       /* Remove any deleted entries.  Do this before processing the
@@ -1313,6 +1942,15 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
 
           svn_pool_clear(iterpool);
 
+          /* Let the delta workers prepare the upcoming files. */
+          if (b->workers)
+            {
+              next_to_schedule = MAX(next_to_schedule, i + 1);
+              schedule_delta_jobs(b, &next_to_schedule, t_ordered_entries,
+                                  s_rev, s_path, s_entries, t_path,
+                                  wc_depth, requested_depth, iterpool);
+            }
+
           if (is_depth_upgrade(wc_depth, requested_depth, t_entry->kind))
             {
               /* We're making the working copy deeper, pretend the source
@@ -1348,11 +1986,18 @@ delta_dirs(report_baton_t *b, svn_revnum_t s_rev, const char *s_path,
                                DEPTH_BELOW_HERE(wc_depth),
                                DEPTH_BELOW_HERE(requested_depth),
                                iterpool));
+
+          /* The delta may not have been needed after all. */
+          if (b->workers)
+            release_delta_job(b, t_fullpath);
         }
 
       /* iterpool is destroyed by destroying its parent (subpool) below */
     }
 
+  if (readable_subtree)
+    b->readable_subtree = NULL;
+
   svn_pool_destroy(subpool);
 
   return SVN_NO_ERROR;
@@ -1424,19 +2069,22 @@ static svn_error_t *
 finish_report(report_baton_t *b, apr_pool_t *pool)
 {
   path_info_t *info;
-  apr_pool_t *subpool;
   svn_revnum_t s_rev;
   int i;
 
   /* Save our pool to manage the lookahead and fs_root cache with. */
   b->pool = pool;
 
-  /* Add the end marker. */
-  SVN_ERR(svn_spillbuf__reader_write(b->reader, "-", 1, pool));
+  /* Add the end marker or index the in-memory report, respectively. */
+  if (b->infos)
+    index_path_infos(b);
+  else
+    SVN_ERR(svn_spillbuf__reader_write(b->reader, "-", 1, pool));
 
   /* Read the first pathinfo from the report and verify that it is a top-level
      set_path entry. */
-  SVN_ERR(read_path_info(&info, b->reader, pool));
+  SVN_ERR(read_lookahead(b));
+  info = b->lookahead;
   if (!info || strcmp(info->path, b->s_operand) != 0
       || info->link_path || !SVN_IS_VALID_REVNUM(info->rev))
     return svn_error_create(SVN_ERR_REPOS_BAD_REVISION_REPORT, NULL,
@@ -1444,8 +2092,7 @@ finish_report(report_baton_t *b, apr_pool_t *pool)
   s_rev = info->rev;
 
   /* Initialize the lookahead pathinfo. */
-  subpool = svn_pool_create(pool);
-  SVN_ERR(read_path_info(&b->lookahead, b->reader, subpool));
+  SVN_ERR(read_lookahead(b));
 
   if (b->lookahead && strcmp(b->lookahead->path, b->s_operand) == 0)
     {
@@ -1463,7 +2110,7 @@ finish_report(report_baton_t *b, apr_pool_t *pool)
           b->lookahead->depth = info->depth;
         }
       info = b->lookahead;
-      SVN_ERR(read_path_info(&b->lookahead, b->reader, subpool));
+      SVN_ERR(read_lookahead(b));
     }
 
   /* Open the target root and initialize the source root cache. */
@@ -1471,6 +2118,8 @@ finish_report(report_baton_t *b, apr_pool_t *pool)
   for (i = 0; i < NUM_CACHED_SOURCE_ROOTS; i++)
     b->s_roots[i] = NULL;
 
+  SVN_ERR(start_delta_workers(b, pool));
+
   {
     svn_error_t *err = svn_error_trace(drive(b, s_rev, info, pool));
 
@@ -1486,49 +2135,113 @@ finish_report(report_baton_t *b, apr_pool_t *pool)
 
 /* --- COLLECTING THE REPORT INFORMATION --- */
 
-/* Record a report operation into the spill buffer.  Return an error
-   if DEPTH is svn_depth_unknown. */
+/* Serialize the report operation INFO into the spill buffer of B.
+   INFO->DEPTH must be supported by reports.  Use POOL for temporary
+   allocations. */
 static svn_error_t *
-write_path_info(report_baton_t *b, const char *path, const char *lpath,
-                svn_revnum_t rev, svn_depth_t depth,
-                svn_boolean_t start_empty,
-                const char *lock_token, apr_pool_t *pool)
+spill_path_info(report_baton_t *b, const path_info_t *info,
+                apr_pool_t *pool)
 {
   const char *lrep, *rrep, *drep, *ltrep, *rep;
 
-  /* Munge the path to be anchor-relative, so that we can use edit paths
-     as report paths. */
-  path = svn_relpath_join(b->s_operand, path, pool);
-
-  lrep = lpath ? apr_psprintf(pool, "+%" APR_SIZE_T_FMT ":%s",
-                              strlen(lpath), lpath) : "-";
-  rrep = (SVN_IS_VALID_REVNUM(rev)) ?
-    apr_psprintf(pool, "+%ld:", rev) : "-";
+  lrep = info->link_path
+       ? apr_psprintf(pool, "+%" APR_SIZE_T_FMT ":%s",
+                      strlen(info->link_path), info->link_path)
+       : "-";
+  rrep = (SVN_IS_VALID_REVNUM(info->rev)) ?
+    apr_psprintf(pool, "+%ld:", info->rev) : "-";
 
-  if (depth == svn_depth_exclude)
+  if (info->depth == svn_depth_exclude)
     drep = "+X";
-  else if (depth == svn_depth_empty)
+  else if (info->depth == svn_depth_empty)
     drep = "+E";
-  else if (depth == svn_depth_files)
+  else if (info->depth == svn_depth_files)
     drep = "+F";
-  else if (depth == svn_depth_immediates)
+  else if (info->depth == svn_depth_immediates)
     drep = "+M";
-  else if (depth == svn_depth_infinity)
-    drep = "-";
   else
-    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
-                             _("Unsupported report depth '%s'"),
-                             svn_depth_to_word(depth));
+    drep = "-";
 
-  ltrep = lock_token ? apr_psprintf(pool, "+%" APR_SIZE_T_FMT ":%s",
-                                    strlen(lock_token), lock_token) : "-";
+  ltrep = info->lock_token
+        ? apr_psprintf(pool, "+%" APR_SIZE_T_FMT ":%s",
+                       strlen(info->lock_token), info->lock_token)
+        : "-";
   rep = apr_psprintf(pool, "+%" APR_SIZE_T_FMT ":%s%s%s%s%c%s",
-                     strlen(path), path, lrep, rrep, drep,
-                     start_empty ? '+' : '-', ltrep);
+                     strlen(info->path), info->path, lrep, rrep, drep,
+                     info->start_empty ? '+' : '-', ltrep);
   return svn_error_trace(
             svn_spillbuf__reader_write(b->reader, rep, strlen(rep), pool));
 }
 
+/* Move all report operations that B keeps in memory into its spill
+   buffer.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+spill_path_infos(report_baton_t *b, apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  int i;
+
+  for (i = 0; i < b->infos->nelts; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(spill_path_info(b, APR_ARRAY_IDX(b->infos, i, path_info_t *),
+                              iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(b->infos_pool);
+  b->infos = NULL;
+  b->infos_pool = NULL;
+
+  return SVN_NO_ERROR;
+}
+
+/* Record a report operation.  Return an error if DEPTH is
+   svn_depth_unknown. */
+static svn_error_t *
+write_path_info(report_baton_t *b, const char *path, const char *lpath,
+                svn_revnum_t rev, svn_depth_t depth,
+                svn_boolean_t start_empty,
+                const char *lock_token, apr_pool_t *pool)
+{
+  path_info_t *info;
+  apr_pool_t *result_pool = b->infos ? b->infos_pool : pool;
+
+  if (   depth != svn_depth_exclude
+      && depth != svn_depth_empty
+      && depth != svn_depth_files
+      && depth != svn_depth_immediates
+      && depth != svn_depth_infinity)
+    return svn_error_createf(SVN_ERR_REPOS_BAD_ARGS, NULL,
+                             _("Unsupported report depth '%s'"),
+                             svn_depth_to_word(depth));
+
+  /* Munge the path to be anchor-relative, so that we can use edit paths
+     as report paths. */
+  info = apr_palloc(result_pool, sizeof(*info));
+  info->path = svn_relpath_join(b->s_operand, path, result_pool);
+  info->link_path = lpath ? apr_pstrdup(result_pool, lpath) : NULL;
+  info->rev = rev;
+  info->depth = depth;
+  info->start_empty = start_empty;
+  info->lock_token = lock_token ? apr_pstrdup(result_pool, lock_token)
+                                : NULL;
+  info->pool = NULL;
+
+  if (!b->infos)
+    return svn_error_trace(spill_path_info(b, info, pool));
+
+  APR_ARRAY_PUSH(b->infos, path_info_t *) = info;
+  b->infos_size += sizeof(*info) + sizeof(info) + strlen(info->path) + 1
+                 + (lpath ? strlen(lpath) + 1 : 0)
+                 + (lock_token ? strlen(lock_token) + 1 : 0);
+
+  if (b->infos_size > MAX_IN_MEMORY_REPORT_SIZE)
+    SVN_ERR(spill_path_infos(b, pool));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_repos_set_path3(void *baton, const char *path, svn_revnum_t rev,
                     svn_depth_t depth, svn_boolean_t start_empty,
@@ -1568,9 +2281,18 @@ svn_error_t *
 svn_repos_finish_report(void *baton, apr_pool_t *pool)
 {
   report_baton_t *b = baton;
+  svn_trace__t *trace = b->repos->trace;
+  apr_time_t start;
+  svn_error_t *err;
+
+  svn_trace__span(trace, "repos", "report", b->fs_base, b->report_start);
 
+  start = svn_trace__start(trace);
   SVN_ERR(svn_fs_refresh_revision_props(svn_repos_fs(b->repos), pool));
-  return svn_error_trace(finish_report(b, pool));
+  err = finish_report(b, pool);
+  svn_trace__span(trace, "repos", "drive", b->t_path, start);
+
+  return svn_error_trace(err);
 }
 
 svn_error_t *
@@ -1628,14 +2350,35 @@ svn_repos_begin_report3(void **report_baton,
   b->edit_baton = edit_baton;
   b->authz_read_func = authz_read_func;
   b->authz_read_baton = authz_read_baton;
+  b->authz_subtree_func = NULL;
+  b->authz_subtree_baton = NULL;
+  b->readable_subtree = NULL;
   b->revision_infos = apr_hash_make(pool);
   b->pool = pool;
   b->reader = svn_spillbuf__reader_create(1000 /* blocksize */,
                                           1000000 /* maxsize */,
                                           pool);
+  b->infos_pool = svn_pool_create(pool);
+  b->infos = apr_array_make(b->infos_pool, 16, sizeof(path_info_t *));
+  b->infos_size = 0;
+  b->subtree_ends = NULL;
+  b->next_info = 0;
+  b->workers = NULL;
   b->repos_uuid = svn_string_create(uuid, pool);
+  b->report_start = svn_trace__start(repos->trace);
 
   /* Hand reporter back to client. */
   *report_baton = b;
   return SVN_NO_ERROR;
 }
+
+void
+svn_repos__report_set_subtree_authz(void *report_baton,
+                                    svn_repos_authz_callback_t authz_callback,
+                                    void *authz_baton)
+{
+  report_baton_t *b = report_baton;
+
+  b->authz_subtree_func = authz_callback;
+  b->authz_subtree_baton = authz_baton;
+}
@@ -36,6 +36,7 @@
 #include "svn_version.h"
 #include "svn_config.h"
 
+#include "private/svn_fs_private.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
 #include "svn_private_config.h" /* for SVN_TEMPLATE_ROOT_DIR */
@@ -1648,6 +1649,15 @@ svn_repos_fs(svn_repos_t *repos)
   return repos->fs;
 }
 
+void
+svn_repos__set_trace(svn_repos_t *repos,
+                     svn_trace__t *trace)
+{
+  repos->trace = trace;
+  if (repos->fs)
+    svn_fs__set_request_id(repos->fs, svn_trace__request_id(trace));
+}
+
 const char *
 svn_repos_fs_type(svn_repos_t *repos,
                   apr_pool_t *result_pool)
@@ -1964,10 +1974,11 @@ fs_hotcopy_notify(void *baton,
 
 /* Make a copy of a repository with hot backup of fs. */
 svn_error_t *
-svn_repos_hotcopy3(const char *src_path,
+svn_repos_hotcopy4(const char *src_path,
                    const char *dst_path,
                    svn_boolean_t clean_logs,
                    svn_boolean_t incremental,
+                   apr_hash_t *fs_config,
                    svn_repos_notify_func_t notify_func,
                    void *notify_baton,
                    svn_cancel_func_t cancel_func,
@@ -1993,7 +2004,7 @@ svn_repos_hotcopy3(const char *src_path,
   SVN_ERR(get_repos(&src_repos, src_abspath,
                     FALSE, FALSE,
                     FALSE,    /* don't try to open the db yet. */
-                    NULL,
+                    fs_config,
                     scratch_pool, scratch_pool));
 
   /* If we are going to clean logs, then get an exclusive lock on
@@ -2052,8 +2063,8 @@ svn_repos_hotcopy3(const char *src_path,
   fs_notify_baton.notify_func = notify_func;
   fs_notify_baton.notify_baton = notify_baton;
 
-  SVN_ERR(svn_fs_hotcopy3(src_repos->db_path, dst_repos->db_path,
-                          clean_logs, incremental,
+  SVN_ERR(svn_fs_hotcopy4(src_repos->db_path, dst_repos->db_path,
+                          clean_logs, incremental, fs_config,
                           fs_notify_func, &fs_notify_baton,
                           cancel_func, cancel_baton, scratch_pool));
 
@@ -29,6 +29,8 @@
 #include "svn_fs.h"
 #include "svn_config.h"
 
+#include "private/svn_trace.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
@@ -146,6 +148,25 @@ struct svn_repos_t
      client's -- we just don't have any other place to persist them. */
   const apr_array_header_t *client_capabilities;
 
+  /* Lazily created cache of the mergeinfo changes per revision, as used
+     by svn_repos_get_logs5().  NULL until first used or if caching has
+     been disabled. */
+  struct svn_cache__t *mergeinfo_changes;
+
+  /* Lazily created cache of file line attributions, as used by
+     svn_repos__blame().  NULL until first used or if caching has been
+     disabled. */
+  struct svn_cache__t *blame;
+
+  /* The in-process hook module of this repository, NULL if there is none.
+     Only valid if HOOK_MODULE_LOADED has been set. */
+  const svn_repos_hook_module_t *hook_module;
+  svn_boolean_t hook_module_loaded;
+
+  /* The trace of the request currently being served, NULL if there is
+     none.  See svn_repos__set_trace(). */
+  svn_trace__t *trace;
+
   /* Maps SVN_REPOS_CAPABILITY_foo keys to "yes" or "no" values.
      If a capability is not yet discovered, it is absent from the table.
      Most likely the keys and values are constants anyway (and
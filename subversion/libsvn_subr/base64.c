@@ -35,6 +35,13 @@
 #include "svn_base64.h"
 #include "private/svn_string_private.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_dep_compat.h"
+
+#if defined(SVN__HAVE_SSE2)
+#include <emmintrin.h>
+#elif defined(SVN__HAVE_NEON)
+#include <arm_neon.h>
+#endif
 
 /* When asked to format the base64-encoded output as multiple lines,
    we put this many chars in each line (plus one new line char) unless
@@ -85,6 +92,134 @@ encode_group(const unsigned char *in, char *out)
   out[3] = base64tab[part2 & 0x3f];
 }
 
+#if defined(SVN__HAVE_SSE2) || defined(SVN__HAVE_NEON)
+
+/* With SIMD support, we translate whole blocks of four groups, i.e.
+   BLOCK_BYTES binary bytes or BLOCK_CHARS base64 chars, at once. */
+#define BLOCK_BYTES 12
+#define BLOCK_CHARS 16
+
+/* Return the three bytes of the group at IN as a 24 bit number. */
+static APR_INLINE apr_uint32_t
+group_to_word(const unsigned char *in)
+{
+  return ((apr_uint32_t)in[0] << 16) | ((apr_uint32_t)in[1] << 8) | in[2];
+}
+
+#endif
+
+#if defined(SVN__HAVE_SSE2)
+
+/* Translate the 16 six-bit values in VALUES into their base64 chars.
+   Start with the offset for 'A' and correct it for each of the
+   consecutive ranges in base64tab that VALUES falls into. */
+static APR_INLINE __m128i
+values_to_chars(__m128i values)
+{
+  __m128i result = _mm_add_epi8(values, _mm_set1_epi8('A'));
+
+  result = _mm_add_epi8(result,
+                        _mm_and_si128(_mm_cmpgt_epi8(values,
+                                                     _mm_set1_epi8(25)),
+                                      _mm_set1_epi8('a' - 26 - 'A')));
+  result = _mm_add_epi8(result,
+                        _mm_and_si128(_mm_cmpgt_epi8(values,
+                                                     _mm_set1_epi8(51)),
+                                      _mm_set1_epi8('0' - 52 - 'a' + 26)));
+  result = _mm_add_epi8(result,
+                        _mm_and_si128(_mm_cmpgt_epi8(values,
+                                                     _mm_set1_epi8(61)),
+                                      _mm_set1_epi8('+' - 62 - '0' + 52)));
+  result = _mm_add_epi8(result,
+                        _mm_and_si128(_mm_cmpgt_epi8(values,
+                                                     _mm_set1_epi8(62)),
+                                      _mm_set1_epi8('/' - 63 - '+' + 62)));
+
+  return result;
+}
+
+/* Base64-encode a block.  IN needs to have BLOCK_BYTES bytes and OUT
+   needs to have room for BLOCK_CHARS bytes. */
+static APR_INLINE void
+encode_block(const unsigned char *in, char *out)
+{
+  /* One group per 32 bit lane. */
+  __m128i words = _mm_setr_epi32((int)group_to_word(in),
+                                 (int)group_to_word(in + 3),
+                                 (int)group_to_word(in + 6),
+                                 (int)group_to_word(in + 9));
+
+  /* Spread the four six-bit values of each group across the bytes
+     of its lane, most significant bits first. */
+  __m128i values
+    = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(_mm_srli_epi32(words, 18),
+                                   _mm_set1_epi32(0x3f)),
+                     _mm_and_si128(_mm_srli_epi32(words, 4),
+                                   _mm_set1_epi32(0x3f00))),
+        _mm_or_si128(_mm_and_si128(_mm_slli_epi32(words, 10),
+                                   _mm_set1_epi32(0x3f0000)),
+                     _mm_and_si128(_mm_slli_epi32(words, 24),
+                                   _mm_set1_epi32(0x3f000000))));
+
+  _mm_storeu_si128((__m128i *)out, values_to_chars(values));
+}
+
+#elif defined(SVN__HAVE_NEON)
+
+/* Translate the 16 six-bit values in VALUES into their base64 chars.
+   Start with the offset for 'A' and correct it for each of the
+   consecutive ranges in base64tab that VALUES falls into. */
+static APR_INLINE uint8x16_t
+values_to_chars(uint8x16_t values)
+{
+  uint8x16_t result = vaddq_u8(values, vdupq_n_u8('A'));
+
+  result = vaddq_u8(result,
+                    vandq_u8(vcgtq_u8(values, vdupq_n_u8(25)),
+                             vdupq_n_u8((uint8_t)('a' - 26 - 'A'))));
+  result = vaddq_u8(result,
+                    vandq_u8(vcgtq_u8(values, vdupq_n_u8(51)),
+                             vdupq_n_u8((uint8_t)('0' - 52 - 'a' + 26))));
+  result = vaddq_u8(result,
+                    vandq_u8(vcgtq_u8(values, vdupq_n_u8(61)),
+                             vdupq_n_u8((uint8_t)('+' - 62 - '0' + 52))));
+  result = vaddq_u8(result,
+                    vandq_u8(vcgtq_u8(values, vdupq_n_u8(62)),
+                             vdupq_n_u8((uint8_t)('/' - 63 - '+' + 62))));
+
+  return result;
+}
+
+/* Base64-encode a block.  IN needs to have BLOCK_BYTES bytes and OUT
+   needs to have room for BLOCK_CHARS bytes. */
+static APR_INLINE void
+encode_block(const unsigned char *in, char *out)
+{
+  /* One group per 32 bit lane. */
+  const apr_uint32_t groups[4] = { group_to_word(in),
+                                   group_to_word(in + 3),
+                                   group_to_word(in + 6),
+                                   group_to_word(in + 9) };
+  uint32x4_t words = vld1q_u32(groups);
+
+  /* Spread the four six-bit values of each group across the bytes
+     of its lane, most significant bits first. */
+  uint32x4_t values
+    = vorrq_u32(vorrq_u32(vandq_u32(vshrq_n_u32(words, 18),
+                                    vdupq_n_u32(0x3f)),
+                          vandq_u32(vshrq_n_u32(words, 4),
+                                    vdupq_n_u32(0x3f00))),
+                vorrq_u32(vandq_u32(vshlq_n_u32(words, 10),
+                                    vdupq_n_u32(0x3f0000)),
+                          vandq_u32(vshlq_n_u32(words, 24),
+                                    vdupq_n_u32(0x3f000000))));
+
+  vst1q_u8((uint8_t *)out, values_to_chars(vreinterpretq_u8_u32(values)));
+}
+
+#endif
+
 /* Base64-encode a line, i.e. BYTES_PER_LINE bytes from DATA into
    BASE64_LINELEN chars and append it to STR.  It does not assume that
    a new line char will be appended, though.
@@ -101,6 +236,11 @@ encode_line(svn_stringbuf_t *str, const char *data)
   char *out = str->data + str->len;
   char *end = out + BASE64_LINELEN;
 
+#ifdef BLOCK_BYTES
+  for ( ; end - out >= BLOCK_CHARS; in += BLOCK_BYTES, out += BLOCK_CHARS)
+    encode_block(in, out);
+#endif
+
   /* We assume that BYTES_PER_LINE is a multiple of 3 and BASE64_LINELEN
      a multiple of 4. */
   for ( ; out != end; in += 3, out += 4)
@@ -301,7 +441,7 @@ struct decode_baton {
   unsigned char buf[4];         /* Bytes waiting to be decoded */
   int buflen;                   /* Number of bytes waiting */
   svn_boolean_t done;           /* True if we already saw an '=' */
-  apr_pool_t *scratch_pool;
+  svn_stringbuf_t *decoded;     /* Output buffer, reused between writes */
 };
 
 
@@ -361,6 +501,139 @@ decode_group_directly(const unsigned char *in, char *out)
   return (part0 | part1 | part2 | part3) != (unsigned char)(-1);
 }
 
+#if defined(SVN__HAVE_SSE2)
+
+/* Return a mask that has all bits set in each byte of CHARS that lies
+   within [FIRST, LAST].  Chars >= 0x80 compare as negative numbers and
+   will never match. */
+static APR_INLINE __m128i
+chars_in_range(__m128i chars, char first, char last)
+{
+  return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(first - 1)),
+                       _mm_cmpgt_epi8(_mm_set1_epi8(last + 1), chars));
+}
+
+/* Base64-decode a block.  IN needs to have BLOCK_CHARS bytes and OUT
+   needs to have room for BLOCK_BYTES bytes.  Return FALSE and leave
+   OUT untouched if a non-base64 char has been encountered. */
+static APR_INLINE svn_boolean_t
+decode_block(const unsigned char *in, char *out)
+{
+  __m128i chars = _mm_loadu_si128((const __m128i *)in);
+  __m128i upper = chars_in_range(chars, 'A', 'Z');
+  __m128i lower = chars_in_range(chars, 'a', 'z');
+  __m128i digit = chars_in_range(chars, '0', '9');
+  __m128i plus = _mm_cmpeq_epi8(chars, _mm_set1_epi8('+'));
+  __m128i slash = _mm_cmpeq_epi8(chars, _mm_set1_epi8('/'));
+  __m128i values;
+  apr_uint32_t words[4];
+  int i;
+
+  if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(upper, lower),
+                                     _mm_or_si128(digit,
+                                                  _mm_or_si128(plus, slash))))
+      != 0xffff)
+    return FALSE;
+
+  /* Translate the base64 chars in values [0..63]. */
+  values = _mm_or_si128(
+      _mm_or_si128(_mm_and_si128(upper,
+                                 _mm_sub_epi8(chars, _mm_set1_epi8('A'))),
+                   _mm_and_si128(lower,
+                                 _mm_sub_epi8(chars,
+                                              _mm_set1_epi8('a' - 26)))),
+      _mm_or_si128(_mm_and_si128(digit,
+                                 _mm_add_epi8(chars,
+                                              _mm_set1_epi8(52 - '0'))),
+                   _mm_or_si128(_mm_and_si128(plus, _mm_set1_epi8(62)),
+                                _mm_and_si128(slash, _mm_set1_epi8(63)))));
+
+  /* Pack pairs of 6 bits into 12 bits and pairs of those into 24 bits,
+     i.e. one group per 32 bit lane. */
+  values = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(values,
+                                                     _mm_set1_epi16(0xff)),
+                                       6),
+                        _mm_srli_epi16(values, 8));
+  values = _mm_or_si128(_mm_slli_epi32(_mm_and_si128(values,
+                                                     _mm_set1_epi32(0xffff)),
+                                       12),
+                        _mm_srli_epi32(values, 16));
+  _mm_storeu_si128((__m128i *)words, values);
+
+  for (i = 0; i < 4; ++i, out += 3)
+    {
+      out[0] = (char)(words[i] >> 16);
+      out[1] = (char)(words[i] >> 8);
+      out[2] = (char)words[i];
+    }
+
+  return TRUE;
+}
+
+#elif defined(SVN__HAVE_NEON)
+
+/* Return a mask that has all bits set in each byte of CHARS that lies
+   within [FIRST, LAST]. */
+static APR_INLINE uint8x16_t
+chars_in_range(uint8x16_t chars, char first, char last)
+{
+  return vandq_u8(vcgeq_u8(chars, vdupq_n_u8((uint8_t)first)),
+                  vcleq_u8(chars, vdupq_n_u8((uint8_t)last)));
+}
+
+/* Base64-decode a block.  IN needs to have BLOCK_CHARS bytes and OUT
+   needs to have room for BLOCK_BYTES bytes.  Return FALSE and leave
+   OUT untouched if a non-base64 char has been encountered. */
+static APR_INLINE svn_boolean_t
+decode_block(const unsigned char *in, char *out)
+{
+  uint8x16_t chars = vld1q_u8(in);
+  uint8x16_t upper = chars_in_range(chars, 'A', 'Z');
+  uint8x16_t lower = chars_in_range(chars, 'a', 'z');
+  uint8x16_t digit = chars_in_range(chars, '0', '9');
+  uint8x16_t plus = vceqq_u8(chars, vdupq_n_u8('+'));
+  uint8x16_t slash = vceqq_u8(chars, vdupq_n_u8('/'));
+  uint8x16_t values;
+  uint16x8_t pairs;
+  uint32x4_t groups;
+  apr_uint32_t words[4];
+  int i;
+
+  if (vminvq_u8(vorrq_u8(vorrq_u8(upper, lower),
+                         vorrq_u8(digit, vorrq_u8(plus, slash)))) != 0xff)
+    return FALSE;
+
+  /* Translate the base64 chars in values [0..63]. */
+  values = vorrq_u8(
+      vorrq_u8(vandq_u8(upper, vsubq_u8(chars, vdupq_n_u8('A'))),
+               vandq_u8(lower, vsubq_u8(chars, vdupq_n_u8('a' - 26)))),
+      vorrq_u8(vandq_u8(digit,
+                        vaddq_u8(chars, vdupq_n_u8((uint8_t)(52 - '0')))),
+               vorrq_u8(vandq_u8(plus, vdupq_n_u8(62)),
+                        vandq_u8(slash, vdupq_n_u8(63)))));
+
+  /* Pack pairs of 6 bits into 12 bits and pairs of those into 24 bits,
+     i.e. one group per 32 bit lane. */
+  pairs = vreinterpretq_u16_u8(values);
+  pairs = vorrq_u16(vshlq_n_u16(vandq_u16(pairs, vdupq_n_u16(0xff)), 6),
+                    vshrq_n_u16(pairs, 8));
+  groups = vreinterpretq_u32_u16(pairs);
+  groups = vorrq_u32(vshlq_n_u32(vandq_u32(groups, vdupq_n_u32(0xffff)), 12),
+                     vshrq_n_u32(groups, 16));
+  vst1q_u32(words, groups);
+
+  for (i = 0; i < 4; ++i, out += 3)
+    {
+      out[0] = (char)(words[i] >> 16);
+      out[1] = (char)(words[i] >> 8);
+      out[2] = (char)words[i];
+    }
+
+  return TRUE;
+}
+
+#endif
+
 /* Base64-encode up to BASE64_LINELEN chars from *DATA and append it to
    STR.  After the function returns, *DATA will point to the first char
    that has not been translated, yet.  Returns TRUE if all BASE64_LINELEN
@@ -382,6 +655,12 @@ decode_line(svn_stringbuf_t *str, const char **data)
   /* We assume that BYTES_PER_LINE is a multiple of 3 and BASE64_LINELEN
      a multiple of 4.  Stop translation as soon as we encounter a special
      char.  Leave the entire group untouched in that case. */
+#ifdef BLOCK_CHARS
+  for (; end - out >= BLOCK_BYTES; p += BLOCK_CHARS, out += BLOCK_BYTES)
+    if (!decode_block(p, out))
+      break;
+#endif
+
   for (; out < end; p += 4, out += 3)
     if (!decode_group_directly(p, out))
       break;
@@ -469,20 +748,19 @@ static svn_error_t *
 decode_data(void *baton, const char *data, apr_size_t *len)
 {
   struct decode_baton *db = baton;
-  svn_stringbuf_t *decoded;
   apr_size_t declen;
-  svn_error_t *err = SVN_NO_ERROR;
 
-  /* Decode this block of data.  */
-  decoded = svn_stringbuf_create_empty(db->scratch_pool);
-  decode_bytes(decoded, data, *len, db->buf, &db->buflen, &db->done);
+  /* Decode this block of data.  The output buffer only ever grows to
+     the largest block written, so we don't need a scratch pool.  */
+  svn_stringbuf_setempty(db->decoded);
+  decode_bytes(db->decoded, data, *len, db->buf, &db->buflen, &db->done);
 
-  /* Write the output, clean up, go home.  */
-  declen = decoded->len;
+  /* Write the output and go home.  */
+  declen = db->decoded->len;
   if (declen != 0)
-    err = svn_stream_write(db->output, decoded->data, &declen);
-  svn_pool_clear(db->scratch_pool);
-  return err;
+    SVN_ERR(svn_stream_write(db->output, db->decoded->data, &declen));
+
+  return SVN_NO_ERROR;
 }
 
 
@@ -491,12 +769,9 @@ static svn_error_t *
 finish_decoding_data(void *baton)
 {
   struct decode_baton *db = baton;
-  svn_error_t *err;
 
-  /* Pass on the close request and clean up the baton.  */
-  err = svn_stream_close(db->output);
-  svn_pool_destroy(db->scratch_pool);
-  return err;
+  /* Pass on the close request.  */
+  return svn_error_trace(svn_stream_close(db->output));
 }
 
 
@@ -509,7 +784,7 @@ svn_base64_decode(svn_stream_t *output, apr_pool_t *pool)
   db->output = output;
   db->buflen = 0;
   db->done = FALSE;
-  db->scratch_pool = svn_pool_create(pool);
+  db->decoded = svn_stringbuf_create_empty(pool);
   stream = svn_stream_create(db, pool);
   svn_stream_set_write(stream, decode_data);
   svn_stream_set_close(stream, finish_decoding_data);
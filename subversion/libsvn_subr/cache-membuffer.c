@@ -22,7 +22,10 @@
  */
 
 #include <assert.h>
+#include <stdlib.h>
 #include <apr_md5.h>
+#include <apr_proc_mutex.h>
+#include <apr_shm.h>
 #include <apr_thread_rwlock.h>
 
 #include "svn_pools.h"
@@ -31,6 +34,7 @@
 #include "svn_hash.h"
 #include "svn_string.h"
 #include "svn_sorts.h"  /* get the MIN macro */
+#include "svn_version.h"
 
 #include "private/svn_atomic.h"
 #include "private/svn_dep_compat.h"
@@ -129,6 +133,36 @@
  * to scale well despite that bottleneck, we simply segment the cache into
  * a number of independent caches (segments). Items will be multiplexed based
  * on their hash key.
+ *
+ * Even with segmentation, all readers of a segment still modify the state
+ * of its r/w lock.  With many threads, that cache line is heavily contended.
+ * Where supported (see OPTIMISTIC_READS), full item reads therefore first
+ * try without any lock: Every writer makes the segment's WRITE_SEQUENCE
+ * counter odd while it modifies the segment.  A reader copies the item and
+ * then checks that the counter has been even and unchanged all the while.
+ * Otherwise, it falls back to the locked read.  To not write to shared
+ * memory in the lock-free path at all, hits are counted in a per-thread
+ * batch first and get applied to the entries later (see hit_batch_t).
+ *
+ * Pre-fork servers may place the membuffer into anonymous shared memory
+ * (see SHARED_MEMBUFFER).  All processes forked after the cache creation
+ * will then see the same cache contents.  Because the directory uses
+ * offsets and the shared memory is mapped at the same address in every
+ * child, the data structures are the same as in the private cache.  Only
+ * the locks and the prefix pool have to be process-shared.
+ *
+ * The TinyLFU policy (see frequency_sketch_t) changes how L1 entries are
+ * admitted to L2 and which entry gets evicted from a full group.  Instead
+ * of hit counts, which are lost upon eviction, entries compete by their
+ * estimated access frequency.
+ * L1 then acts as the admission window: data read only once, e.g. by a
+ * full export or verification run, passes through L1 but can't replace
+ * frequently used L2 entries.
+ *
+ * Optionally, a spill file on local disk may serve as a second-level
+ * cache (see cache-spill.c).  Entries of default priority or higher that
+ * get evicted from the membuffer are written to it and are being put back
+ * into the membuffer upon the next access.
  */
 
 /* APR's read-write lock implementation on Windows is horribly inefficient.
@@ -146,6 +180,45 @@
 #  define USE_SIMPLE_MUTEX 0
 #endif
 
+/* Lock-free reads need atomic loads and memory fences as well as thread-
+ * local storage for the hit batches.  Enable them for compilers that
+ * provide the __atomic builtins.  Debug builds compare entry tags, which
+ * requires a stable entry, so use locked reads only there.
+ */
+#if    APR_HAS_THREADS && !USE_SIMPLE_MUTEX \
+    && !defined(SVN_DEBUG_CACHE_MEMBUFFER) \
+    && (   defined(__clang__) \
+        || (defined(__GNUC__) \
+            && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))))
+#  define OPTIMISTIC_READS 1
+#endif
+
+/* Shared membuffer caches need mutexes that serialize between processes
+ * as well as between the threads within them.  APR provides that as
+ * "process-shared" pthread mutexes.
+ */
+#if    APR_HAS_SHARED_MEMORY && APR_HAS_PROC_PTHREAD_SERIALIZE \
+    && APR_HAS_THREADS && !USE_SIMPLE_MUTEX
+#  define SHARED_MEMBUFFER 1
+#endif
+
+/* Linux lets us ask for huge pages and NUMA interleaving on memory that
+ * has been allocated but not been touched yet.  That is the case for the
+ * data buffers and directories right after creating the cache.
+ */
+#if defined(__linux__)
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#  include <linux/mempolicy.h>
+#  define MEMBUFFER_MEMORY_HINTS 1
+#endif
+
+/* Every process-shared mutex eats a page of memory as well as some kernel
+ * resources.  With more segments than this, they will share locks.
+ */
+#define MAX_SHARED_LOCK_COUNT 64
+
 /* For more efficient copy operations, let's align all data items properly.
  * Since we can't portably align pointers, this is rather the item size
  * granularity which ensures *relative* alignment within the cache - still
@@ -197,6 +270,11 @@
  */
 #define MAX_ITEM_SIZE ((apr_uint32_t)(0 - ITEM_ALIGNMENT))
 
+/* Larger items will never be compressed.  This is well within the limits
+ * of svn__compress_lz4.
+ */
+#define MAX_COMPRESSIBLE_SIZE 0x40000000
+
 /* We use this structure to identify cache entries. There cannot be two
  * entries with the same entry key. However unlikely, though, two different
  * full keys (see full_key_t) may have the same entry key.  That is a
@@ -240,6 +318,68 @@ typedef struct full_key_t
   svn_membuf_t full_key;
 } full_key_t;
 
+/* Round SIZE up to the next ITEM_ALIGNMENT boundary.
+ */
+#define ARENA_ALIGN(size) \
+  (((apr_size_t)(size) + ITEM_ALIGNMENT - 1) & ~(apr_size_t)(ITEM_ALIGNMENT - 1))
+
+/* Trivial allocator handing out consecutive chunks of a larger memory
+ * block, e.g. a shared memory segment.  Memory is never returned to it.
+ */
+typedef struct shm_arena_t
+{
+  /* Start of the next chunk.  Always aligned to ITEM_ALIGNMENT. */
+  char *next;
+
+  /* Number of bytes left at NEXT. */
+  apr_size_t remaining;
+} shm_arena_t;
+
+/* Allocate SIZE bytes from ARENA, if that is not NULL, and from POOL
+ * otherwise.  Memory from ARENA is always zeroed.  Memory from POOL will
+ * only be zeroed if CLEAR is set.  Return NULL, if we run out of memory.
+ */
+static void *
+arena_alloc(shm_arena_t *arena,
+            apr_size_t size,
+            svn_boolean_t clear,
+            apr_pool_t *pool)
+{
+  void *result;
+
+  if (arena == NULL)
+    return clear ? apr_pcalloc(pool, size) : apr_palloc(pool, size);
+
+  size = ARENA_ALIGN(size);
+  if (size > arena->remaining)
+    return NULL;
+
+  result = arena->next;
+  arena->next += size;
+  arena->remaining -= size;
+
+  return result;
+}
+
+/* Access statistics for all entries sharing the same key prefix.
+ * Purely statistical information that may be used for profiling only.
+ * Updates are not synchronized and values may be off by a few counts.
+ */
+typedef struct prefix_stats_t
+{
+  /* Number of lookups, including has_key requests. */
+  apr_uint64_t gets;
+
+  /* Number of lookups that found an entry. */
+  apr_uint64_t hits;
+
+  /* Number of (partial) setter calls. */
+  apr_uint64_t sets;
+
+  /* Number of entries that got removed to make room for others. */
+  apr_uint64_t evictions;
+} prefix_stats_t;
+
 /* A limited capacity, thread-safe pool of unique C strings.  Operations on
  * this data structure are defined by prefix_pool_* functions.  The only
  * "public" member is VALUES (r/o access only).
@@ -254,6 +394,9 @@ typedef struct prefix_pool_t
    * VALUES_USED - 1.  May be NULL if VALUES_MAX is 0. */
   const char **values;
 
+  /* Access statistics for each entry in VALUES.  Same size as VALUES. */
+  prefix_stats_t *stats;
+
   /* Number of used entries that VALUES may have. */
   apr_uint32_t values_max;
 
@@ -269,16 +412,39 @@ typedef struct prefix_pool_t
 
   /* The serialization object. */
   svn_mutex__t *mutex;
+
+#ifdef SHARED_MEMBUFFER
+  /* If not NULL, this pool lives in shared memory and this mutex
+   * serializes access to it instead of MUTEX.  MAP will be NULL in that
+   * case because the strings must be in shared memory as well.  Lookups
+   * use a linear search over VALUES then.  */
+  apr_proc_mutex_t *shared_mutex;
+
+  /* Buffer that receives the strings in shared mode. */
+  char *strings;
+
+  /* Number of bytes that STRINGS may hold. */
+  apr_size_t strings_max;
+
+  /* Number of bytes used in STRINGS. */
+  apr_size_t strings_used;
+#endif
 } prefix_pool_t;
 
 /* Set *PREFIX_POOL to a new instance that tries to limit allocation to
  * BYTES_MAX bytes.  If MUTEX_REQUIRED is set and multi-threading is
  * supported, serialize all access to the new instance.  Allocate the
- * object from *RESULT_POOL. */
+ * object from *RESULT_POOL.
+ *
+ * If ARENA is not NULL, allocate the instance including all strings
+ * from it and make it process-shared.  ARENA must provide at least
+ * PREFIX_POOL_SHARED_SIZE(BYTES_MAX) bytes.  The mutex will still be
+ * allocated in RESULT_POOL. */
 static svn_error_t *
 prefix_pool_create(prefix_pool_t **prefix_pool,
                    apr_size_t bytes_max,
                    svn_boolean_t mutex_required,
+                   shm_arena_t *arena,
                    apr_pool_t *result_pool)
 {
   enum
@@ -295,25 +461,112 @@ prefix_pool_create(prefix_pool_t **prefix_pool,
                             bytes_max / ESTIMATED_BYTES_PER_ENTRY);
 
   /* Construct the result struct. */
-  prefix_pool_t *result = apr_pcalloc(result_pool, sizeof(*result));
-  result->map = svn_hash__make(result_pool);
+  prefix_pool_t *result = arena_alloc(arena, sizeof(*result), TRUE,
+                                      result_pool);
+  if (result == NULL)
+    return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+  result->map = arena ? NULL : svn_hash__make(result_pool);
 
   result->values = capacity
-                 ? apr_pcalloc(result_pool, capacity * sizeof(const char *))
+                 ? arena_alloc(arena, capacity * sizeof(const char *), TRUE,
+                               result_pool)
                  : NULL;
+  result->stats = capacity
+                ? arena_alloc(arena, capacity * sizeof(prefix_stats_t), TRUE,
+                              result_pool)
+                : NULL;
   result->values_max = (apr_uint32_t)capacity;
   result->values_used = 0;
 
   result->bytes_max = bytes_max;
-  result->bytes_used = capacity * sizeof(svn_membuf_t);
+  result->bytes_used = capacity * (sizeof(svn_membuf_t)
+                                   + sizeof(prefix_stats_t));
+
+#ifdef SHARED_MEMBUFFER
+  if (arena)
+    {
+      apr_status_t status;
 
-  SVN_ERR(svn_mutex__init(&result->mutex, mutex_required, result_pool));
+      /* Every entry takes less space in STRINGS than it adds to
+       * BYTES_USED, so this is enough to never run out of buffer. */
+      result->strings_max = bytes_max - MIN(bytes_max, result->bytes_used);
+      result->strings = arena_alloc(arena, result->strings_max, TRUE,
+                                    result_pool);
+      if (   result->strings == NULL
+          || (capacity && (result->values == NULL || result->stats == NULL)))
+        return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+      status = apr_proc_mutex_create(&result->shared_mutex, NULL,
+                                     APR_LOCK_PROC_PTHREAD, result_pool);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't create cache mutex"));
+    }
+#endif
+
+  SVN_ERR(svn_mutex__init(&result->mutex, mutex_required && !arena,
+                          result_pool));
 
   /* Done. */
   *prefix_pool = result;
   return SVN_NO_ERROR;
 }
 
+/* Upper limit of the number of bytes that prefix_pool_create will take
+ * from its arena for a pool of BYTES_MAX bytes.  The VALUES and STATS
+ * arrays and the STRINGS buffer together never exceed BYTES_MAX. */
+#define PREFIX_POOL_SHARED_SIZE(bytes_max) \
+  (ARENA_ALIGN(sizeof(prefix_pool_t)) + (bytes_max) + 3 * ITEM_ALIGNMENT)
+
+#ifdef SHARED_MEMBUFFER
+/* Implement prefix_pool_get_internal for the process-shared PREFIX_POOL.
+ * PREFIX_LEN is the length of PREFIX. */
+static svn_error_t *
+prefix_pool_get_shared(apr_uint32_t *prefix_idx,
+                       prefix_pool_t *prefix_pool,
+                       const char *prefix,
+                       apr_size_t prefix_len)
+{
+  /* See prefix_pool_get_internal. */
+  enum { OVERHEAD = 40 + 8 };
+
+  apr_uint32_t i;
+  apr_size_t bytes_needed;
+  char *value;
+
+  /* Lookup.  There are only a few prefixes per repository. */
+  for (i = 0; i < prefix_pool->values_used; ++i)
+    if (strcmp(prefix_pool->values[i], prefix) == 0)
+      {
+        *prefix_idx = i;
+        return SVN_NO_ERROR;
+      }
+
+  /* Capacity checks. */
+  bytes_needed = prefix_len + 1 + OVERHEAD;
+  if (   prefix_pool->values_used == prefix_pool->values_max
+      || prefix_pool->bytes_max - prefix_pool->bytes_used < bytes_needed
+      || prefix_pool->strings_max - prefix_pool->strings_used
+           < prefix_len + 1)
+    {
+      *prefix_idx = NO_INDEX;
+      return SVN_NO_ERROR;
+    }
+
+  /* Add new entry. */
+  value = prefix_pool->strings + prefix_pool->strings_used;
+  memcpy(value, prefix, prefix_len + 1);
+  prefix_pool->values[prefix_pool->values_used] = value;
+  prefix_pool->strings_used += prefix_len + 1;
+
+  *prefix_idx = prefix_pool->values_used;
+  ++prefix_pool->values_used;
+  prefix_pool->bytes_used += bytes_needed;
+
+  return SVN_NO_ERROR;
+}
+#endif
+
 /* Set *PREFIX_IDX to the offset in PREFIX_POOL->VALUES that contains the
  * value PREFIX.  If none exists, auto-insert it.  If we can't due to
  * capacity exhaustion, set *PREFIX_IDX to NO_INDEX.
@@ -339,6 +592,12 @@ prefix_pool_get_internal(apr_uint32_t *prefix_idx,
   apr_size_t bytes_needed;
   apr_pool_t *pool;
 
+#ifdef SHARED_MEMBUFFER
+  if (prefix_pool->map == NULL)
+    return svn_error_trace(prefix_pool_get_shared(prefix_idx, prefix_pool,
+                                                  prefix, prefix_len));
+#endif
+
   /* Lookup.  If we already know that prefix, return its index. */
   value = apr_hash_get(prefix_pool->map, prefix, prefix_len);
   if (value != NULL)
@@ -384,6 +643,26 @@ prefix_pool_get(apr_uint32_t *prefix_idx,
                 prefix_pool_t *prefix_pool,
                 const char *prefix)
 {
+#ifdef SHARED_MEMBUFFER
+  if (prefix_pool->shared_mutex)
+    {
+      svn_error_t *err;
+      apr_status_t status = apr_proc_mutex_lock(prefix_pool->shared_mutex);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't lock cache mutex"));
+
+      err = prefix_pool_get_internal(prefix_idx, prefix_pool, prefix);
+
+      status = apr_proc_mutex_unlock(prefix_pool->shared_mutex);
+      if (err)
+        return svn_error_trace(err);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unlock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
   SVN_MUTEX__WITH_LOCK(prefix_pool->mutex,
                        prefix_pool_get_internal(prefix_idx, prefix_pool,
                                                 prefix));
@@ -563,7 +842,12 @@ typedef struct entry_t
    * above ensures that there will be no overflows.
    * Only valid for used entries.
    */
-  apr_size_t size;
+  apr_uint32_t size;
+
+  /* If set, the item data has been compressed with svn__compress_lz4.
+   * Only valid for used entries.
+   */
+  svn_boolean_t compressed;
 
   /* Number of (read) hits for this entry. Will be reset upon write.
    * Only valid for used entries.
@@ -692,6 +976,31 @@ typedef struct cache_level_t
 
 } cache_level_t;
 
+/* Approximate access frequencies of cache keys for the TinyLFU admission
+ * policy.  This is a count-min sketch of 4 bit counters, 16 of them per
+ * table word.  Every key maps to 4 counters in different words and its
+ * frequency estimate is the minimum of those.  To let old popularity
+ * fade, all counters get halved whenever SAMPLE_SIZE accesses have been
+ * recorded.
+ *
+ * Updates are not synchronized between readers.  Lost increments only
+ * make the estimates slightly less accurate.
+ */
+typedef struct frequency_sketch_t
+{
+  /* Counter table, MASK + 1 words long. */
+  apr_uint64_t *table;
+
+  /* Number of words in TABLE minus 1.  TABLE size is a power of 2. */
+  apr_uint32_t mask;
+
+  /* Number of recorded accesses since the last halving. */
+  apr_uint32_t additions;
+
+  /* Halve all counters after this many additions. */
+  apr_uint32_t sample_size;
+} frequency_sketch_t;
+
 /* The cache header structure.
  */
 struct svn_membuffer_t
@@ -796,6 +1105,13 @@ struct svn_membuffer_t
    */
   apr_uint64_t total_hits;
 
+  /* Total number of entries removed to make room for new ones.
+   * Purely statistical information that may be used for profiling only.
+   * Updates are not synchronized and values may be nonsensicle on some
+   * platforms.
+   */
+  apr_uint64_t total_evictions;
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   /* A lock for intra-process synchronization to the cache, or NULL if
    * the cache's creator doesn't feel the cache needs to be
@@ -812,17 +1128,88 @@ struct svn_membuffer_t
    */
   svn_boolean_t allow_blocking_writes;
 #endif
+
+#ifdef SHARED_MEMBUFFER
+  /* For caches in shared memory, this process-shared mutex replaces LOCK.
+   * It may be used by more than one segment.  NULL for private caches.
+   */
+  apr_proc_mutex_t *shared_lock;
+#endif
+
+  /* If not NULL, the TinyLFU admission policy is active and this is the
+   * access frequency sketch of this segment.  Otherwise, we only use the
+   * priority and hit count based heuristics.
+   */
+  frequency_sketch_t *sketch;
+
+  /* If not NULL, important entries evicted from this segment will be
+   * written to this file and may be read back from there upon cache
+   * misses.  Shared between all segments of the cache.
+   */
+  svn_cache__spill_t *spill;
+
+  /* Incremented by every writer when it acquires and when it releases the
+   * write lock, i.e. odd while the segment is being modified.  Lock-free
+   * readers use it to detect concurrent modifications.
+   */
+  volatile svn_atomic_t write_sequence;
+
+  /* Identifies the cache that this segment belongs to.  Unique within the
+   * process, even if a cache gets allocated at the address of one that
+   * has been destroyed.  Same value for all segments of a cache.
+   */
+  svn_atomic_t cache_id;
 };
 
+/* Source of cache_id values, i.e. the ID of the last cache created. */
+static volatile svn_atomic_t last_cache_id = 0;
+
 /* Align integer VALUE to the next ITEM_ALIGNMENT boundary.
  */
 #define ALIGN_VALUE(value) (((value) + ITEM_ALIGNMENT-1) & -ITEM_ALIGNMENT)
 
+/* Mark CACHE as being modified, i.e. make its write sequence odd.
+ * This must be called right after acquiring the write lock.
+ */
+static APR_INLINE void
+begin_write_sequence(svn_membuffer_t *cache)
+{
+#ifdef OPTIMISTIC_READS
+  __atomic_store_n(&cache->write_sequence, cache->write_sequence + 1,
+                   __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+#endif
+}
+
+/* Mark the modification of CACHE as complete, i.e. make its write
+ * sequence even again.  This must be called right before releasing the
+ * write lock.
+ */
+static APR_INLINE void
+end_write_sequence(svn_membuffer_t *cache)
+{
+#ifdef OPTIMISTIC_READS
+  __atomic_store_n(&cache->write_sequence, cache->write_sequence + 1,
+                   __ATOMIC_RELEASE);
+#endif
+}
+
 /* If locking is supported for CACHE, acquire a read lock for it.
  */
 static svn_error_t *
 read_lock_cache(svn_membuffer_t *cache)
 {
+#ifdef SHARED_MEMBUFFER
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_proc_mutex_lock(cache->shared_lock);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't lock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -846,6 +1233,33 @@ read_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 {
+#ifdef SHARED_MEMBUFFER
+  if (cache->shared_lock)
+    {
+      apr_status_t status;
+      if (cache->allow_blocking_writes)
+        {
+          status = apr_proc_mutex_lock(cache->shared_lock);
+        }
+      else
+        {
+          status = apr_proc_mutex_trylock(cache->shared_lock);
+          if (SVN_LOCK_IS_BUSY(status))
+            {
+              *success = FALSE;
+              return SVN_NO_ERROR;
+            }
+        }
+
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't write-lock cache mutex"));
+
+      begin_write_sequence(cache);
+      return SVN_NO_ERROR;
+    }
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -862,7 +1276,7 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
           if (SVN_LOCK_IS_BUSY(status))
             {
               *success = FALSE;
-              status = APR_SUCCESS;
+              return SVN_NO_ERROR;
             }
         }
 
@@ -871,6 +1285,7 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
                                   _("Can't write-lock cache mutex"));
     }
 
+  begin_write_sequence(cache);
   return SVN_NO_ERROR;
 #else
   return SVN_NO_ERROR;
@@ -883,6 +1298,19 @@ write_lock_cache(svn_membuffer_t *cache, svn_boolean_t *success)
 static svn_error_t *
 force_write_lock_cache(svn_membuffer_t *cache)
 {
+#ifdef SHARED_MEMBUFFER
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_proc_mutex_lock(cache->shared_lock);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't write-lock cache mutex"));
+
+      begin_write_sequence(cache);
+      return SVN_NO_ERROR;
+    }
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__lock(cache->lock);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -891,6 +1319,7 @@ force_write_lock_cache(svn_membuffer_t *cache)
     return svn_error_wrap_apr(status,
                               _("Can't write-lock cache mutex"));
 
+  begin_write_sequence(cache);
   return SVN_NO_ERROR;
 #else
   return SVN_NO_ERROR;
@@ -903,6 +1332,20 @@ force_write_lock_cache(svn_membuffer_t *cache)
 static svn_error_t *
 unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 {
+#ifdef SHARED_MEMBUFFER
+  if (cache->shared_lock)
+    {
+      apr_status_t status = apr_proc_mutex_unlock(cache->shared_lock);
+      if (err)
+        return err;
+
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't unlock cache mutex"));
+
+      return SVN_NO_ERROR;
+    }
+#endif
+
 #if (APR_HAS_THREADS && USE_SIMPLE_MUTEX)
   return svn_mutex__unlock(cache->lock, err);
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
@@ -922,6 +1365,16 @@ unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
 #endif
 }
 
+/* Release the write lock of CACHE after the modification has been
+ * completed.  Return ERR upon success.
+ */
+static svn_error_t *
+write_unlock_cache(svn_membuffer_t *cache, svn_error_t *err)
+{
+  end_write_sequence(cache);
+  return svn_error_trace(unlock_cache(cache, err));
+}
+
 /* If supported, guard the execution of EXPR with a read lock to CACHE.
  * The macro has been modeled after SVN_MUTEX__WITH_LOCK.
  */
@@ -954,7 +1407,7 @@ do {                                                            \
       else                                                      \
         break;                                                  \
     }                                                           \
-  SVN_ERR(unlock_cache(cache, (expr)));                         \
+  SVN_ERR(write_unlock_cache(cache, (expr)));                   \
 } while (0)
 
 /* Returns 0 if the entry group identified by GROUP_INDEX in CACHE has not
@@ -1284,6 +1737,86 @@ drop_entry(svn_membuffer_t *cache, entry_t *entry)
     free_spare_group(cache, last_group);
 }
 
+/* Set *PREFIX, *KEY_DATA and *KEY_LEN to the spill file representation
+ * of ENTRY_KEY in CACHE.  Keys with a shared prefix are fully described by
+ * that prefix and their fingerprint.  All others use their FULL_KEY.
+ */
+static void
+get_spill_key(const char **prefix,
+              const void **key_data,
+              apr_size_t *key_len,
+              svn_membuffer_t *cache,
+              const entry_key_t *entry_key,
+              const void *full_key)
+{
+  if (entry_key->prefix_idx == NO_INDEX)
+    {
+      *prefix = NULL;
+      *key_data = full_key;
+      *key_len = entry_key->key_len;
+    }
+  else
+    {
+      *prefix = cache->prefix_pool->values[entry_key->prefix_idx];
+      *key_data = entry_key->fingerprint;
+      *key_len = sizeof(entry_key->fingerprint);
+    }
+}
+
+/* Remove the used ENTRY from the CACHE because we need to make room for
+ * other entries.  If CACHE has a spill file, important entries are saved
+ * there before they get dropped.  Otherwise, this is the same as
+ * drop_entry.
+ */
+static void
+evict_entry(svn_membuffer_t *cache, entry_t *entry)
+{
+  /* The spill file has no notion of compressed items. */
+  if (   cache->spill && !entry->compressed
+      && entry->priority >= SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY)
+    {
+      const unsigned char *data = cache->data + entry->offset;
+      const char *prefix;
+      const void *key_data;
+      apr_size_t key_len;
+
+      /* Failure to spill simply means losing the entry. */
+      get_spill_key(&prefix, &key_data, &key_len, cache, &entry->key, data);
+      svn_error_clear(svn_cache__spill_write(cache->spill, prefix,
+                                             key_data, key_len,
+                                             data + entry->key.key_len,
+                                             entry->size - entry->key.key_len,
+                                             entry->priority));
+    }
+
+  /* Those are for stats only. */
+  cache->total_evictions++;
+  if (entry->key.prefix_idx != NO_INDEX)
+    cache->prefix_pool->stats[entry->key.prefix_idx].evictions++;
+
+  drop_entry(cache, entry);
+}
+
+/* Remove the entry for KEY from the spill file of CACHE, if there is one.
+ * Errors will be ignored.
+ */
+static void
+remove_spilled(svn_membuffer_t *cache,
+               const full_key_t *key)
+{
+  const char *prefix;
+  const void *key_data;
+  apr_size_t key_len;
+
+  if (cache->spill == NULL)
+    return;
+
+  get_spill_key(&prefix, &key_data, &key_len, cache, &key->entry_key,
+                key->full_key.data);
+  svn_error_clear(svn_cache__spill_remove(cache->spill, prefix,
+                                          key_data, key_len));
+}
+
 /* Insert ENTRY into the chain of used dictionary entries. The entry's
  * offset and size members must already have been initialized. Also,
  * the offset must match the beginning of the insertion window.
@@ -1360,6 +1893,116 @@ let_entry_age(svn_membuffer_t *cache, entry_t *entry)
     }
 }
 
+/* Number of counters per key in a frequency_sketch_t. */
+#define SKETCH_DEPTH 4
+
+/* Maximum value of a frequency_sketch_t counter. */
+#define SKETCH_MAX_COUNT 15
+
+/* Return a well-mixed version of VALUE.  The fingerprints of fixed-size
+ * keys are only scrambled, i.e. similar keys have similar fingerprints.
+ */
+static APR_INLINE apr_uint64_t
+sketch_mix(apr_uint64_t value)
+{
+  value ^= value >> 33;
+  value *= APR_UINT64_C(0xff51afd7ed558ccd);
+  value ^= value >> 33;
+  value *= APR_UINT64_C(0xc4ceb9fe1a85ec53);
+  value ^= value >> 33;
+
+  return value;
+}
+
+/* Allocate a frequency sketch for a cache segment with ENTRY_COUNT
+ * directory entries in POOL and return it.
+ */
+static frequency_sketch_t *
+sketch_create(apr_size_t entry_count,
+              apr_pool_t *pool)
+{
+  frequency_sketch_t *sketch = apr_pcalloc(pool, sizeof(*sketch));
+  apr_size_t words = 16;
+
+  /* About 16 counters per entry, i.e. one table word. */
+  while (words < entry_count && words < APR_UINT32_MAX / 2)
+    words *= 2;
+
+  sketch->table = apr_pcalloc(pool, words * sizeof(*sketch->table));
+  sketch->mask = (apr_uint32_t)(words - 1);
+  sketch->sample_size = (apr_uint32_t)MIN(entry_count * 10,
+                                          APR_UINT32_MAX / 2);
+
+  return sketch;
+}
+
+/* Return the base hash value of KEY for SKETCH.
+ */
+static APR_INLINE apr_uint64_t
+sketch_hash(const entry_key_t *key)
+{
+  return sketch_mix(key->fingerprint[0] ^ sketch_mix(key->fingerprint[1]));
+}
+
+/* Return the frequency estimate for KEY in the sketch of CACHE.
+ */
+static apr_uint32_t
+sketch_estimate(svn_membuffer_t *cache,
+                const entry_key_t *key)
+{
+  frequency_sketch_t *sketch = cache->sketch;
+  apr_uint64_t hash = sketch_hash(key);
+  apr_uint32_t result = SKETCH_MAX_COUNT;
+  int i;
+
+  for (i = 0; i < SKETCH_DEPTH; ++i)
+    {
+      apr_uint64_t h = sketch_mix(hash + i);
+      apr_uint64_t word = sketch->table[(apr_uint32_t)h & sketch->mask];
+      apr_uint32_t count = (apr_uint32_t)(word >> ((h >> 60) * 4)) & 15;
+
+      result = MIN(result, count);
+    }
+
+  return result;
+}
+
+/* Record an access to KEY in CACHE, if the TinyLFU policy is active.
+ */
+static void
+sketch_increment(svn_membuffer_t *cache,
+                 const entry_key_t *key)
+{
+  frequency_sketch_t *sketch = cache->sketch;
+  apr_uint64_t hash;
+  int i;
+
+  if (sketch == NULL)
+    return;
+
+  hash = sketch_hash(key);
+  for (i = 0; i < SKETCH_DEPTH; ++i)
+    {
+      apr_uint64_t h = sketch_mix(hash + i);
+      apr_uint64_t *word = &sketch->table[(apr_uint32_t)h & sketch->mask];
+      int shift = (int)(h >> 60) * 4;
+
+      if (((*word >> shift) & 15) < SKETCH_MAX_COUNT)
+        *word += (apr_uint64_t)1 << shift;
+    }
+
+  /* Let the past fade away. */
+  if (++sketch->additions >= sketch->sample_size)
+    {
+      apr_uint32_t k;
+      for (k = 0; k <= sketch->mask; ++k)
+        sketch->table[k] = (sketch->table[k] >> 1)
+                         & APR_UINT64_C(0x7777777777777777);
+
+      sketch->additions /= 2;
+    }
+}
+
 /* Return whether the keys in LHS and RHS match.
  */
 static svn_boolean_t
@@ -1511,17 +2154,38 @@ find_entry(svn_membuffer_t *cache,
 
           entry = &to_shrink->entries[to_remove % GROUP_SIZE];
           entry_level = get_cache_level(cache, entry);
-          for (i = 0; i < GROUP_SIZE; ++i)
+          if (cache->sketch)
             {
-              /* keep L1 entries whenever possible */
-
-              cache_level_t *level
-                = get_cache_level(cache, &to_shrink->entries[i]);
-              if (   (level != entry_level && entry_level == &cache->l1)
-                  || (entry->hit_count > to_shrink->entries[i].hit_count))
+              /* With TinyLFU, remove the least frequently used entry.
+               * Otherwise, entries from one-off scans would push out
+               * the L2 entries of their group. */
+              apr_uint32_t min_frequency = sketch_estimate(cache,
+                                                           &entry->key);
+              for (i = 0; i < GROUP_SIZE; ++i)
                 {
-                  entry_level = level;
-                  entry = &to_shrink->entries[i];
+                  apr_uint32_t frequency
+                    = sketch_estimate(cache, &to_shrink->entries[i].key);
+                  if (frequency < min_frequency)
+                    {
+                      min_frequency = frequency;
+                      entry = &to_shrink->entries[i];
+                    }
+                }
+            }
+          else
+            {
+              for (i = 0; i < GROUP_SIZE; ++i)
+                {
+                  /* keep L1 entries whenever possible */
+
+                  cache_level_t *level
+                    = get_cache_level(cache, &to_shrink->entries[i]);
+                  if (   (level != entry_level && entry_level == &cache->l1)
+                      || (entry->hit_count > to_shrink->entries[i].hit_count))
+                    {
+                      entry_level = level;
+                      entry = &to_shrink->entries[i];
+                    }
                 }
             }
 
@@ -1533,7 +2197,7 @@ find_entry(svn_membuffer_t *cache,
             if (entry != &to_shrink->entries[i])
               let_entry_age(cache, &to_shrink->entries[i]);
 
-          drop_entry(cache, entry);
+          evict_entry(cache, entry);
         }
 
       /* initialize entry for the new key
@@ -1641,8 +2305,16 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
   /* accumulated "worth" of items dropped so far */
   apr_uint64_t drop_hits = 0;
 
+  /* Popularity of the new entry.  With the TinyLFU policy, this is the
+   * estimated access frequency.  It includes accesses from before the
+   * entry's latest insertion, such that one-off scans can't replace
+   * frequently used data. */
+  apr_uint32_t to_fit_in_hits = cache->sketch
+                              ? sketch_estimate(cache, &to_fit_in->key)
+                              : to_fit_in->hit_count;
+
   /* estimated "worth" of the new entry */
-  apr_uint64_t drop_hits_limit = (to_fit_in->hit_count + 1)
+  apr_uint64_t drop_hits_limit = (to_fit_in_hits + 1)
                                * (apr_uint64_t)to_fit_in->priority;
 
   /* This loop will eventually terminate because every cache entry
@@ -1697,7 +2369,11 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
       else
         {
           svn_boolean_t keep;
+          apr_uint32_t entry_hits;
           entry = get_entry(cache, cache->l2.next);
+          entry_hits = cache->sketch
+                     ? sketch_estimate(cache, &entry->key)
+                     : entry->hit_count;
 
           if (to_fit_in->priority < SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY)
             {
@@ -1705,7 +2381,7 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
                * entry is of even lower prio and has fewer hits.
                */
               if (   entry->priority > to_fit_in->priority
-                  || entry->hit_count > to_fit_in->hit_count)
+                  || entry_hits > to_fit_in_hits)
                 return FALSE;
             }
 
@@ -1726,7 +2402,7 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
                * The new entry may still find room by ousting other entries.
                */
               keep = to_fit_in->priority == entry->priority
-                   ? entry->hit_count >= to_fit_in->hit_count
+                   ? entry_hits >= to_fit_in_hits
                    : entry->priority > to_fit_in->priority;
             }
 
@@ -1748,9 +2424,9 @@ ensure_data_insertable_l2(svn_membuffer_t *cache,
                * provide the same data but in a further stage of processing.
                */
               if (entry->priority > SVN_CACHE__MEMBUFFER_LOW_PRIORITY)
-                drop_hits += entry->hit_count * (apr_uint64_t)entry->priority;
+                drop_hits += entry_hits * (apr_uint64_t)entry->priority;
 
-              drop_entry(cache, entry);
+              evict_entry(cache, entry);
             }
         }
     }
@@ -1818,7 +2494,7 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
               if (keep)
                 promote_entry(cache, entry);
               else
-                drop_entry(cache, entry);
+                evict_entry(cache, entry);
             }
         }
     }
@@ -1827,19 +2503,31 @@ ensure_data_insertable_l1(svn_membuffer_t *cache, apr_size_t size)
    * right answer. */
 }
 
-svn_error_t *
-svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
-                                  apr_size_t total_size,
-                                  apr_size_t directory_size,
-                                  apr_size_t segment_count,
-                                  svn_boolean_t thread_safe,
-                                  svn_boolean_t allow_blocking_writes,
-                                  apr_pool_t *pool)
+/* Implement svn_cache__membuffer_cache_create and
+ * svn_cache__membuffer_cache_create_shared.  The cache will be placed
+ * in anonymous shared memory if SHARED is set.  THREAD_SAFE is implied
+ * in that case.
+ */
+static svn_error_t *
+membuffer_cache_create(svn_membuffer_t **cache,
+                       apr_size_t total_size,
+                       apr_size_t directory_size,
+                       apr_size_t segment_count,
+                       svn_boolean_t thread_safe,
+                       svn_boolean_t allow_blocking_writes,
+                       svn_boolean_t shared,
+                       apr_pool_t *pool)
 {
   svn_membuffer_t *c;
   prefix_pool_t *prefix_pool;
+  shm_arena_t *arena = NULL;
+#ifdef SHARED_MEMBUFFER
+  apr_proc_mutex_t **shared_locks = NULL;
+  apr_size_t shared_lock_count = 0;
+#endif
 
   apr_uint32_t seg;
+  svn_atomic_t cache_id;
   apr_uint32_t group_count;
   apr_uint32_t main_group_count;
   apr_uint32_t spare_group_count;
@@ -1849,9 +2537,8 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
 
   /* Allocate 1% of the cache capacity to the prefix string pool.
    */
-  SVN_ERR(prefix_pool_create(&prefix_pool, total_size / 100, thread_safe,
-                             pool));
-  total_size -= total_size / 100;
+  apr_size_t prefix_pool_size = total_size / 100;
+  total_size -= prefix_pool_size;
 
   /* Limit the total size (only relevant if we can address > 4GB)
    */
@@ -1905,9 +2592,6 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
          && segment_count < MAX_SEGMENT_COUNT)
     segment_count *= 2;
 
-  /* allocate cache as an array of segments / cache objects */
-  c = apr_palloc(pool, segment_count * sizeof(*c));
-
   /* Split total cache size into segments of equal size
    */
   total_size /= segment_count;
@@ -1958,6 +2642,61 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   assert(spare_group_count > 0 && main_group_count > 0);
 
   group_init_size = 1 + group_count / (8 * GROUP_INIT_GRANULARITY);
+
+#ifdef SHARED_MEMBUFFER
+  /* Get a single block of shared memory that holds everything but the
+   * mutexes.  Those are process-shared objects of their own.
+   */
+  if (shared)
+    {
+      apr_shm_t *shm;
+      apr_status_t status;
+      apr_size_t i;
+      apr_uint64_t shm_size
+        = PREFIX_POOL_SHARED_SIZE(prefix_pool_size)
+        + ARENA_ALIGN(segment_count * sizeof(*c))
+        + segment_count * (  ARENA_ALIGN(group_count * sizeof(entry_group_t))
+                           + ARENA_ALIGN(group_init_size)
+                           + ARENA_ALIGN(ALIGN_VALUE(data_size)));
+
+      if (shm_size > APR_SIZE_MAX)
+        return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+      status = apr_shm_create(&shm, (apr_size_t)shm_size, NULL, pool);
+      if (status)
+        return svn_error_wrap_apr(status,
+                                  _("Can't create shared memory for cache"));
+
+      arena = apr_palloc(pool, sizeof(*arena));
+      arena->next = apr_shm_baseaddr_get(shm);
+      arena->remaining = apr_shm_size_get(shm);
+
+      shared_lock_count = MIN(segment_count, MAX_SHARED_LOCK_COUNT);
+      shared_locks = apr_palloc(pool,
+                                shared_lock_count * sizeof(*shared_locks));
+      for (i = 0; i < shared_lock_count; ++i)
+        {
+          status = apr_proc_mutex_create(&shared_locks[i], NULL,
+                                         APR_LOCK_PROC_PTHREAD, pool);
+          if (status)
+            return svn_error_wrap_apr(status,
+                                      _("Can't create cache mutex"));
+        }
+    }
+#else
+  SVN_ERR_ASSERT(!shared);
+#endif
+
+  SVN_ERR(prefix_pool_create(&prefix_pool, prefix_pool_size, thread_safe,
+                             arena, pool));
+
+  /* allocate cache as an array of segments / cache objects */
+  c = arena_alloc(arena, segment_count * sizeof(*c), FALSE, pool);
+  if (c == NULL)
+    return svn_error_wrap_apr(APR_ENOMEM, "OOM");
+
+  cache_id = svn_atomic_inc(&last_cache_id) + 1;
+
   for (seg = 0; seg < segment_count; ++seg)
     {
       /* allocate buffers and initialize cache members
@@ -1973,12 +2712,14 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       /* Allocate but don't clear / zero the directory because it would add
          significantly to the server start-up time if the caches are large.
          Group initialization will take care of that in stead. */
-      c[seg].directory = apr_palloc(pool,
-                                    group_count * sizeof(entry_group_t));
+      c[seg].directory = arena_alloc(arena,
+                                     group_count * sizeof(entry_group_t),
+                                     FALSE, pool);
 
       /* Allocate and initialize directory entries as "not initialized",
          hence "unused" */
-      c[seg].group_initialized = apr_pcalloc(pool, group_init_size);
+      c[seg].group_initialized = arena_alloc(arena, group_init_size, TRUE,
+                                             pool);
 
       /* Allocate 1/4th of the data buffer to L1
        */
@@ -1999,7 +2740,8 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].l2.current_data = c[seg].l2.start_offset;
 
       /* This cast is safe because DATA_SIZE <= MAX_SEGMENT_SIZE. */
-      c[seg].data = apr_palloc(pool, (apr_size_t)ALIGN_VALUE(data_size));
+      c[seg].data = arena_alloc(arena, (apr_size_t)ALIGN_VALUE(data_size),
+                                FALSE, pool);
       c[seg].data_used = 0;
       c[seg].max_entry_size = max_entry_size;
 
@@ -2007,11 +2749,17 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
       c[seg].total_reads = 0;
       c[seg].total_writes = 0;
       c[seg].total_hits = 0;
+      c[seg].total_evictions = 0;
+      c[seg].write_sequence = 0;
+      c[seg].cache_id = cache_id;
+      c[seg].spill = NULL;
+      c[seg].sketch = NULL;
 
       /* were allocations successful?
        * If not, initialize a minimal cache structure.
        */
-      if (c[seg].data == NULL || c[seg].directory == NULL)
+      if (   c[seg].data == NULL || c[seg].directory == NULL
+          || c[seg].group_initialized == NULL)
         {
           /* We are OOM. There is no need to proceed with "half a cache".
            */
@@ -2027,7 +2775,7 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
 #elif (APR_HAS_THREADS && !USE_SIMPLE_MUTEX)
       /* Same for read-write lock. */
       c[seg].lock = NULL;
-      if (thread_safe)
+      if (thread_safe && !shared)
         {
           apr_status_t status =
               apr_thread_rwlock_create(&(c[seg].lock), pool);
@@ -2039,6 +2787,13 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
        */
       c[seg].allow_blocking_writes = allow_blocking_writes;
 #endif
+
+#ifdef SHARED_MEMBUFFER
+      /* Shared caches use process-shared locks only. */
+      c[seg].shared_lock = NULL;
+      if (shared)
+        c[seg].shared_lock = shared_locks[seg % shared_lock_count];
+#endif
     }
 
   /* done here
@@ -2047,6 +2802,210 @@ svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_cache_create(svn_membuffer_t **cache,
+                                  apr_size_t total_size,
+                                  apr_size_t directory_size,
+                                  apr_size_t segment_count,
+                                  svn_boolean_t thread_safe,
+                                  svn_boolean_t allow_blocking_writes,
+                                  apr_pool_t *pool)
+{
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, thread_safe,
+                                                allow_blocking_writes,
+                                                FALSE, pool));
+}
+
+svn_error_t *
+svn_cache__membuffer_cache_create_shared(svn_membuffer_t **cache,
+                                         apr_size_t total_size,
+                                         apr_size_t directory_size,
+                                         apr_size_t segment_count,
+                                         svn_boolean_t allow_blocking_writes,
+                                         apr_pool_t *pool)
+{
+#ifdef SHARED_MEMBUFFER
+  return svn_error_trace(membuffer_cache_create(cache, total_size,
+                                                directory_size,
+                                                segment_count, TRUE,
+                                                allow_blocking_writes,
+                                                TRUE, pool));
+#else
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Shared memory caches are not supported "
+                            "on this platform"));
+#endif
+}
+
+svn_error_t *
+svn_cache__membuffer_set_spill_file(svn_membuffer_t *cache,
+                                    const char *path,
+                                    apr_uint64_t size,
+                                    apr_pool_t *pool)
+{
+  svn_cache__spill_t *spill;
+  apr_uint32_t seg;
+
+#ifdef SHARED_MEMBUFFER
+  /* Spill files are per-process while the cache is not. */
+  if (cache->shared_lock)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Spill files are not supported for "
+                              "shared memory caches"));
+#endif
+
+  SVN_ERR(svn_cache__spill_open(&spill, path, size, pool));
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    cache[seg].spill = spill;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_set_policy(svn_membuffer_t *cache,
+                                svn_cache__membuffer_policy_t policy,
+                                apr_pool_t *pool)
+{
+  apr_uint32_t seg;
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    {
+      svn_membuffer_t *segment = &cache[seg];
+      apr_size_t entry_count = (apr_size_t)GROUP_SIZE
+                             * (  segment->group_count
+                                + segment->spare_group_count);
+
+      switch (policy)
+        {
+          case svn_cache__membuffer_policy_priority:
+            segment->sketch = NULL;
+            break;
+
+          case svn_cache__membuffer_policy_tinylfu:
+            segment->sketch = sketch_create(entry_count, pool);
+            break;
+
+          default:
+            return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                     _("Unknown membuffer cache policy %d"),
+                                     (int)policy);
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#ifdef MEMBUFFER_MEMORY_HINTS
+
+/* Apply the HUGE_PAGES and NUMA_INTERLEAVE hints, see
+ * svn_cache__membuffer_set_memory_hints, to all whole pages within the
+ * SIZE bytes starting at START.
+ */
+static svn_error_t *
+advise_memory(void *start,
+              apr_size_t size,
+              svn_boolean_t huge_pages,
+              svn_boolean_t numa_interleave)
+{
+  apr_size_t page_size = (apr_size_t)sysconf(_SC_PAGESIZE);
+  apr_size_t begin = ((apr_size_t)start + page_size - 1) & ~(page_size - 1);
+  apr_size_t end = ((apr_size_t)start + size) & ~(page_size - 1);
+
+  if (end <= begin)
+    return SVN_NO_ERROR;
+
+#ifdef MADV_HUGEPAGE
+  if (huge_pages && madvise((void *)begin, end - begin, MADV_HUGEPAGE))
+    return svn_error_wrap_apr(apr_get_os_error(),
+                              _("Can't use huge pages for the cache"));
+#else
+  if (huge_pages)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Huge pages are not supported"));
+#endif
+
+#if defined(SYS_mbind) && defined(SYS_get_mempolicy)
+  if (numa_interleave)
+    {
+      /* Spread the pages over all nodes that we may allocate from. */
+      unsigned long nodes[16] = { 0 };
+      unsigned long max_node = sizeof(nodes) * 8;
+
+      if (   syscall(SYS_get_mempolicy, NULL, nodes, max_node, NULL,
+                     MPOL_F_MEMS_ALLOWED)
+          || syscall(SYS_mbind, begin, end - begin, MPOL_INTERLEAVE, nodes,
+                     max_node, 0))
+        return svn_error_wrap_apr(apr_get_os_error(),
+                                  _("Can't interleave the cache memory "
+                                    "across NUMA nodes"));
+    }
+#else
+  if (numa_interleave)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("NUMA interleaving is not supported"));
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+svn_error_t *
+svn_cache__membuffer_set_memory_hints(svn_membuffer_t *cache,
+                                      svn_boolean_t huge_pages,
+                                      svn_boolean_t numa_interleave)
+{
+#ifdef MEMBUFFER_MEMORY_HINTS
+  apr_uint32_t seg;
+
+  if (!huge_pages && !numa_interleave)
+    return SVN_NO_ERROR;
+
+  /* The directories are accessed randomly as well, so they benefit just
+   * like the data buffers. */
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    {
+      svn_membuffer_t *segment = &cache[seg];
+      SVN_ERR(advise_memory(segment->data,
+                            (apr_size_t)(segment->l1.size + segment->l2.size),
+                            huge_pages, numa_interleave));
+      SVN_ERR(advise_memory(segment->directory,
+                            (  segment->group_count
+                             + segment->spare_group_count)
+                            * sizeof(entry_group_t),
+                            huge_pages, numa_interleave));
+    }
+
+  return SVN_NO_ERROR;
+#else
+  if (!huge_pages && !numa_interleave)
+    return SVN_NO_ERROR;
+
+  return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                          _("Memory placement hints are not supported "
+                            "on this platform"));
+#endif
+}
+
+svn_boolean_t
+svn_cache__membuffer_has_spill_file(svn_membuffer_t *cache)
+{
+  return cache->spill != NULL;
+}
+
+svn_error_t *
+svn_cache__membuffer_spill_namespace(svn_membuffer_t *cache,
+                                     const char *name_space,
+                                     svn_revnum_t youngest)
+{
+  if (cache->spill == NULL)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(svn_cache__spill_namespace(cache->spill,
+                                                    name_space, youngest));
+}
+
 svn_error_t *
 svn_cache__membuffer_clear(svn_membuffer_t *cache)
 {
@@ -2095,7 +3054,7 @@ svn_cache__membuffer_clear(svn_membuffer_t *cache)
       cache[seg].used_entries = 0;
 
       /* Segment may be used again. */
-      SVN_ERR(unlock_cache(&cache[seg], SVN_NO_ERROR));
+      SVN_ERR(write_unlock_cache(&cache[seg], SVN_NO_ERROR));
     }
 
   /* done here */
@@ -2136,12 +3095,13 @@ entry_exists(svn_membuffer_t *cache,
   return SVN_NO_ERROR;
 }
 
-/* Given the SIZE and PRIORITY of a new item, return the cache level
+/* Given the KEY, SIZE and PRIORITY of a new item, return the cache level
    (L1 or L2) in fragment CACHE that this item shall be inserted into.
    If we can't find nor make enough room for the item, return NULL.
  */
 static cache_level_t *
 select_level(svn_membuffer_t *cache,
+             const entry_key_t *key,
              apr_size_t size,
              apr_uint32_t priority)
 {
@@ -2158,6 +3118,7 @@ select_level(svn_membuffer_t *cache,
     {
       /* Large but important items go into L2. */
       entry_t dummy_entry = { { { 0 } } };
+      dummy_entry.key = *key;
       dummy_entry.priority = priority;
       dummy_entry.size = size;
 
@@ -2172,7 +3133,8 @@ select_level(svn_membuffer_t *cache,
 
 /* Try to insert the serialized item given in BUFFER with ITEM_SIZE
  * into the group GROUP_INDEX of CACHE and uniquely identify it by
- * hash value TO_FIND.
+ * hash value TO_FIND.  COMPRESSED indicates whether BUFFER has been
+ * compressed using svn__compress_lz4.
  *
  * However, there is no guarantee that it will actually be put into
  * the cache. If there is already some data associated with TO_FIND,
@@ -2188,6 +3150,7 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
                              apr_uint32_t group_index,
                              char *buffer,
                              apr_size_t item_size,
+                             svn_boolean_t compressed,
                              apr_uint32_t priority,
                              DEBUG_CACHE_MEMBUFFER_TAG_ARG
                              apr_pool_t *scratch_pool)
@@ -2217,7 +3180,8 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
        * negative value.
        */
       cache->data_used += (apr_uint64_t)size - entry->size;
-      entry->size = size;
+      entry->size = (apr_uint32_t)size;
+      entry->compressed = compressed;
       entry->priority = priority;
 
 #ifdef SVN_DEBUG_CACHE_MEMBUFFER
@@ -2242,7 +3206,9 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
 
   /* if necessary, enlarge the insertion window.
    */
-  level = buffer ? select_level(cache, size, priority) : NULL;
+  level = buffer
+        ? select_level(cache, &to_find->entry_key, size, priority)
+        : NULL;
   if (level)
     {
       /* Remove old data for this key, if that exists.
@@ -2250,7 +3216,8 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
        * the serialized item's (future) position within data buffer.
        */
       entry = find_entry(cache, group_index, to_find, TRUE);
-      entry->size = size;
+      entry->size = (apr_uint32_t)size;
+      entry->compressed = compressed;
       entry->offset = level->current_data;
       entry->priority = priority;
 
@@ -2299,13 +3266,16 @@ membuffer_cache_set_internal(svn_membuffer_t *cache,
  * be inserted.
  *
  * The SERIALIZER is called to transform the ITEM into a single,
- * flat data buffer. Temporary allocations may be done in POOL.
+ * flat data buffer.  If COMPRESSION_THRESHOLD is not 0, serialized data
+ * of at least that size will be stored compressed if that saves space.
+ * Temporary allocations may be done in POOL.
  */
 static svn_error_t *
 membuffer_cache_set(svn_membuffer_t *cache,
                     const full_key_t *key,
                     void *item,
                     svn_cache__serialize_func_t serializer,
+                    apr_size_t compression_threshold,
                     apr_uint32_t priority,
                     DEBUG_CACHE_MEMBUFFER_TAG_ARG
                     apr_pool_t *scratch_pool)
@@ -2313,6 +3283,7 @@ membuffer_cache_set(svn_membuffer_t *cache,
   apr_uint32_t group_index;
   void *buffer = NULL;
   apr_size_t size = 0;
+  svn_boolean_t compressed = FALSE;
 
   /* find the entry group that will hold the key.
    */
@@ -2323,6 +3294,24 @@ membuffer_cache_set(svn_membuffer_t *cache,
   if (item)
     SVN_ERR(serializer(&buffer, &size, item, scratch_pool));
 
+  /* Compress outside the lock.  Items that are too large for the cache may
+   * still fit after compression, so don't check that here.
+   */
+  if (   compression_threshold && buffer
+      && size >= compression_threshold && size <= MAX_COMPRESSIBLE_SIZE)
+    {
+      svn_stringbuf_t *packed = svn_stringbuf_create_empty(scratch_pool);
+      SVN_ERR(svn__compress_lz4(buffer, size, packed));
+
+      /* Uncompressible data gets stored with some extra overhead. */
+      if (packed->len < size)
+        {
+          buffer = packed->data;
+          size = packed->len;
+          compressed = TRUE;
+        }
+    }
+
   /* The actual cache data access needs to sync'ed
    */
   WITH_WRITE_LOCK(cache,
@@ -2331,9 +3320,33 @@ membuffer_cache_set(svn_membuffer_t *cache,
                                                group_index,
                                                buffer,
                                                size,
+                                               compressed,
                                                priority,
                                                DEBUG_CACHE_MEMBUFFER_TAG
                                                scratch_pool));
+
+  /* Any spilled copy is outdated now. */
+  remove_spilled(cache, key);
+
+  return SVN_NO_ERROR;
+}
+
+/* Replace the SIZE bytes of compressed item data in *BUFFER with the
+ * uncompressed item data and update *SIZE accordingly.  Allocate the
+ * result in RESULT_POOL.
+ */
+static svn_error_t *
+decompress_item(char **buffer,
+                apr_size_t *size,
+                apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *unpacked = svn_stringbuf_create_empty(result_pool);
+  SVN_ERR(svn__decompress_lz4(*buffer, *size, unpacked,
+                              MAX_COMPRESSIBLE_SIZE));
+
+  *buffer = unpacked->data;
+  *size = unpacked->len;
+
   return SVN_NO_ERROR;
 }
 
@@ -2352,11 +3365,252 @@ increment_hit_counters(svn_membuffer_t *cache, entry_t *entry)
   cache->total_hits++;
 }
 
+#ifdef OPTIMISTIC_READS
+
+/* Number of lock-free read attempts before falling back to a read lock.
+ */
+#define OPTIMISTIC_READ_ATTEMPTS 2
+
+/* Number of different entries per thread for which hits may be pending.
+ */
+#define HIT_BATCH_SIZE 16
+
+/* Reads and hits to a single segment and entry that have not been
+ * applied to the cache, yet.
+ */
+typedef struct pending_hits_t
+{
+  /* The segment that got read from. */
+  svn_membuffer_t *segment;
+
+  /* Index of the entry that got hit.  NO_INDEX for misses. */
+  apr_uint32_t entry_index;
+
+  /* Number of reads and hits, respectively, since the last flush. */
+  apr_uint32_t reads;
+  apr_uint32_t hits;
+} pending_hits_t;
+
+/* Per-thread collection of hits found by lock-free reads.  Applying them
+ * in batches keeps the lock-free readers from writing to shared memory
+ * most of the time.
+ *
+ * A batch always refers to the segments of a single cache, OWNER.  When
+ * the thread starts reading from a different cache, any pending hits get
+ * discarded because OWNER might not exist anymore.  As hit counts are just
+ * a heuristics for the eviction strategy, losing a few does not matter.
+ *
+ * Comparing the address of OWNER is not enough to tell whether it is still
+ * the same cache: a new cache may have been allocated where a destroyed
+ * one used to be.  Pending hits are therefore only applied if the cache_id
+ * of OWNER still matches OWNER_ID.
+ */
+typedef struct hit_batch_t
+{
+  /* The first segment of the cache that all pending hits belong to. */
+  svn_membuffer_t *owner;
+
+  /* The cache_id of OWNER when the first pending hit got recorded. */
+  svn_atomic_t owner_id;
+
+  /* Number of used elements in PENDING. */
+  apr_size_t count;
+
+  /* The hits not applied, yet. */
+  pending_hits_t pending[HIT_BATCH_SIZE];
+} hit_batch_t;
+
+/* The calling thread's hit batch. */
+static __thread hit_batch_t hit_batch;
+
+/* Apply all pending hits in BATCH to their cache entries.  This does not
+ * need any lock because writers don't rely on the hit counts being exact.
+ */
+static void
+flush_hit_batch(hit_batch_t *batch)
+{
+  apr_size_t i;
+
+  for (i = 0; i < batch->count; ++i)
+    {
+      pending_hits_t *pending = &batch->pending[i];
+      if (pending->entry_index != NO_INDEX)
+        apr_atomic_add32(&get_entry(pending->segment,
+                                    pending->entry_index)->hit_count,
+                         pending->hits);
+
+      /* Those are for stats only. */
+      pending->segment->total_reads += pending->reads;
+      pending->segment->total_hits += pending->hits;
+    }
+
+  batch->count = 0;
+}
+
+/* Count a read from SEGMENT of the cache starting at segment OWNER in
+ * the calling thread's hit batch.  For hits, ENTRY_INDEX identifies the
+ * entry in SEGMENT.  It is NO_INDEX for misses.
+ */
+static void
+defer_hit(svn_membuffer_t *owner,
+          svn_membuffer_t *segment,
+          apr_uint32_t entry_index)
+{
+  hit_batch_t *batch = &hit_batch;
+  pending_hits_t *pending;
+  apr_size_t i;
+
+  /* Never touch the entries of some other cache.  Check the ID before
+   * the address as it is stored in OWNER, which is known to be alive. */
+  if (batch->owner_id != owner->cache_id || batch->owner != owner)
+    {
+      batch->owner = owner;
+      batch->owner_id = owner->cache_id;
+      batch->count = 0;
+    }
+
+  for (i = 0; i < batch->count; ++i)
+    if (   batch->pending[i].segment == segment
+        && batch->pending[i].entry_index == entry_index)
+      break;
+
+  if (i == batch->count)
+    {
+      if (batch->count == HIT_BATCH_SIZE)
+        {
+          flush_hit_batch(batch);
+          i = 0;
+        }
+
+      pending = &batch->pending[i];
+      pending->segment = segment;
+      pending->entry_index = entry_index;
+      pending->reads = 0;
+      pending->hits = 0;
+      batch->count = i + 1;
+    }
+
+  pending = &batch->pending[i];
+  pending->reads++;
+  if (entry_index != NO_INDEX)
+    pending->hits++;
+}
+
+/* Lock-free variant of membuffer_cache_get_internal.  OWNER is the first
+ * segment of the cache that contains segment CACHE.
+ *
+ * Return FALSE, if a concurrent modification of CACHE may have interfered
+ * with the lookup.  In that case, the outputs are undefined and the caller
+ * has to try again or use the locked variant.  Otherwise, return TRUE,
+ * set *BUFFER and *ITEM_SIZE like membuffer_cache_get_internal does and
+ * count the access in this thread's hit batch.  Unlike the former, the
+ * data will not be decompressed but *COMPRESSED will be set instead.
+ *
+ * Because writers may modify any part of CACHE while we read it, all
+ * indexes and offsets get checked before use and are read only once.
+ */
+static svn_boolean_t
+membuffer_cache_get_optimistic(svn_membuffer_t *owner,
+                               svn_membuffer_t *cache,
+                               apr_uint32_t group_index,
+                               const full_key_t *to_find,
+                               char **buffer,
+                               apr_size_t *item_size,
+                               svn_boolean_t *compressed,
+                               apr_pool_t *result_pool)
+{
+  apr_uint32_t group_limit = cache->group_count + cache->spare_group_count;
+  apr_uint64_t data_size = cache->l2.start_offset + cache->l2.size;
+  entry_group_t *group = &cache->directory[group_index];
+  entry_t *found = NULL;
+  entry_t entry;
+  apr_uint32_t entry_index = NO_INDEX;
+  apr_uint32_t sequence;
+  apr_size_t chain_length;
+  apr_size_t i;
+
+  /* Writers in progress?  Then, we won't read consistent data. */
+  sequence = __atomic_load_n(&cache->write_sequence, __ATOMIC_ACQUIRE);
+  if (sequence & 1)
+    return FALSE;
+
+  *buffer = NULL;
+  *item_size = 0;
+  *compressed = FALSE;
+
+  /* Same search as in find_entry but with sanity checks. */
+  if (is_group_initialized(cache, group_index))
+    for (chain_length = 0;
+         !found && chain_length < MAX_GROUP_CHAIN_LENGTH;
+         ++chain_length)
+      {
+        volatile group_header_t *header = &group->header;
+        apr_uint32_t used = header->used;
+        apr_uint32_t next = header->next;
+
+        if (used > GROUP_SIZE)
+          return FALSE;
+
+        for (i = 0; i < used; ++i)
+          if (entry_keys_match(&group->entries[i].key, &to_find->entry_key))
+            {
+              found = &group->entries[i];
+              break;
+            }
+
+        if (!found)
+          {
+            if (next == NO_INDEX)
+              break;
+            if (next >= group_limit)
+              return FALSE;
+
+            group = &cache->directory[next];
+          }
+      }
+
+  if (found)
+    {
+      /* Take a snapshot of the entry such that it won't change while we
+       * check and use it. */
+      memcpy(&entry, found, sizeof(entry));
+      if (   !entry_keys_match(&entry.key, &to_find->entry_key)
+          || entry.key.key_len > entry.size
+          || entry.offset > data_size
+          || ALIGN_VALUE(entry.size) > data_size - entry.offset)
+        return FALSE;
+
+      /* Key conflicts mean that the entry to find is not cached. */
+      if (   !entry.key.key_len
+          || memcmp(to_find->full_key.data, cache->data + entry.offset,
+                    entry.key.key_len) == 0)
+        {
+          apr_size_t size = ALIGN_VALUE(entry.size) - entry.key.key_len;
+          *buffer = apr_palloc(result_pool, size);
+          memcpy(*buffer, cache->data + entry.offset + entry.key.key_len,
+                 size);
+          *item_size = entry.size - entry.key.key_len;
+          *compressed = entry.compressed;
+          entry_index = get_index(cache, found);
+        }
+    }
+
+  /* Only if there was no writer while we read, our data is consistent. */
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&cache->write_sequence, __ATOMIC_RELAXED) != sequence)
+    return FALSE;
+
+  defer_hit(owner, cache, entry_index);
+  return TRUE;
+}
+
+#endif /* OPTIMISTIC_READS */
+
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
  * by the hash value TO_FIND. If no item has been stored for KEY,
  * *BUFFER will be NULL. Otherwise, return a copy of the serialized
- * data in *BUFFER and return its size in *ITEM_SIZE. Allocations will
- * be done in POOL.
+ * data in *BUFFER and return its size in *ITEM_SIZE.  Compressed data
+ * will be decompressed.  Allocations will be done in POOL.
  *
  * Note: This function requires the caller to serialization access.
  * Don't call it directly, call membuffer_cache_get instead.
@@ -2412,6 +3666,81 @@ membuffer_cache_get_internal(svn_membuffer_t *cache,
   increment_hit_counters(cache, entry);
   *item_size = entry->size - entry->key.key_len;
 
+  if (entry->compressed)
+    SVN_ERR(decompress_item(buffer, item_size, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Look for KEY in the spill file of CACHE.  If found, set *BUFFER and
+ * *SIZE to the serialized item allocated in RESULT_POOL and *PRIORITY to
+ * its cache priority.  Otherwise, set *BUFFER to NULL.  Spill file errors
+ * are treated as cache misses.
+ */
+static void
+read_spilled(char **buffer,
+             apr_size_t *size,
+             apr_uint32_t *priority,
+             svn_membuffer_t *cache,
+             const full_key_t *key,
+             apr_pool_t *result_pool)
+{
+  const char *prefix;
+  const void *key_data;
+  apr_size_t key_len;
+  void *data;
+  svn_error_t *err;
+
+  get_spill_key(&prefix, &key_data, &key_len, cache, &key->entry_key,
+                key->full_key.data);
+  err = svn_cache__spill_read(&data, size, priority, cache->spill, prefix,
+                              key_data, key_len, result_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      data = NULL;
+    }
+
+  *buffer = data;
+}
+
+/* Look for KEY in the spill file of CACHE and, if found, put the item
+ * back into group GROUP_INDEX of CACHE.  Return the serialized item in
+ * *BUFFER and *SIZE, allocated in RESULT_POOL.  Set *BUFFER to NULL if
+ * CACHE has no spill file or KEY could not be found in it.
+ */
+static svn_error_t *
+membuffer_cache_get_spilled(svn_membuffer_t *cache,
+                            apr_uint32_t group_index,
+                            const full_key_t *key,
+                            char **buffer,
+                            apr_size_t *size,
+                            DEBUG_CACHE_MEMBUFFER_TAG_ARG
+                            apr_pool_t *result_pool)
+{
+  apr_uint32_t priority;
+
+  *buffer = NULL;
+  if (cache->spill == NULL)
+    return SVN_NO_ERROR;
+
+  read_spilled(buffer, size, &priority, cache, key, result_pool);
+  if (*buffer == NULL)
+    return SVN_NO_ERROR;
+
+  /* Re-insert before deserialization because the latter may modify
+   * the buffer contents in-place. */
+  WITH_WRITE_LOCK(cache,
+                  membuffer_cache_set_internal(cache,
+                                               key,
+                                               group_index,
+                                               *buffer,
+                                               *size,
+                                               FALSE,
+                                               priority,
+                                               DEBUG_CACHE_MEMBUFFER_TAG
+                                               result_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -2431,10 +3760,31 @@ membuffer_cache_get(svn_membuffer_t *cache,
   apr_uint32_t group_index;
   char *buffer;
   apr_size_t size;
+#ifdef OPTIMISTIC_READS
+  svn_membuffer_t *owner = cache;
+  svn_boolean_t compressed;
+  int attempt;
+#endif
 
   /* find the entry group that will hold the key.
    */
   group_index = get_group_index(&cache, &key->entry_key);
+  sketch_increment(cache, &key->entry_key);
+
+#ifdef OPTIMISTIC_READS
+  /* Try without locking first. */
+  for (attempt = 0; attempt < OPTIMISTIC_READ_ATTEMPTS; ++attempt)
+    if (membuffer_cache_get_optimistic(owner, cache, group_index, key,
+                                       &buffer, &size, &compressed,
+                                       result_pool))
+      {
+        if (compressed)
+          SVN_ERR(decompress_item(&buffer, &size, result_pool));
+        break;
+      }
+
+  if (attempt == OPTIMISTIC_READ_ATTEMPTS)
+#endif
   WITH_READ_LOCK(cache,
                  membuffer_cache_get_internal(cache,
                                               group_index,
@@ -2444,17 +3794,171 @@ membuffer_cache_get(svn_membuffer_t *cache,
                                               DEBUG_CACHE_MEMBUFFER_TAG
                                               result_pool));
 
-  /* re-construct the original data object from its serialized form.
-   */
-  if (buffer == NULL)
+  /* Not in memory?  Maybe, we spilled it to disk earlier. */
+  if (buffer == NULL)
+    SVN_ERR(membuffer_cache_get_spilled(cache, group_index, key,
+                                        &buffer, &size,
+                                        DEBUG_CACHE_MEMBUFFER_TAG
+                                        result_pool));
+
+  /* re-construct the original data object from its serialized form.
+   */
+  if (buffer == NULL)
+    {
+      *item = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  return deserializer(item, buffer, size, result_pool);
+}
+
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+
+/* Tell the CPU that we are going to read from ADDRESS soon.
+ */
+#if defined(__GNUC__)
+#  define PREFETCH(address) __builtin_prefetch(address)
+#else
+#  define PREFETCH(address) ((void)0)
+#endif
+
+/* A single key to look up in a batch, see membuffer_cache_get_many.
+ */
+typedef struct batch_key_t
+{
+  /* The combined key to look for. */
+  full_key_t key;
+
+  /* Segment and group that would contain KEY. */
+  svn_membuffer_t *segment;
+  apr_uint32_t group_index;
+
+  /* Index of KEY in the caller's array. */
+  int idx;
+} batch_key_t;
+
+/* Sort batch_key_t by segment, group and original index.
+ * Implements the qsort() comparison function.
+ */
+static int
+compare_batch_keys(const void *lhs, const void *rhs)
+{
+  const batch_key_t *lhs_key = lhs;
+  const batch_key_t *rhs_key = rhs;
+
+  if (lhs_key->segment != rhs_key->segment)
+    return lhs_key->segment < rhs_key->segment ? -1 : 1;
+  if (lhs_key->group_index != rhs_key->group_index)
+    return lhs_key->group_index < rhs_key->group_index ? -1 : 1;
+
+  return lhs_key->idx - rhs_key->idx;
+}
+
+/* Look for the COUNT KEYS in CACHE, which must be the segment that all
+ * of them map to.  For each key, store a copy of the serialized data in
+ * BUFFERS and its size in SIZES, both indexed by the key's IDX.  BUFFERS
+ * will be NULL for keys not found.  Allocations will be done in
+ * RESULT_POOL.
+ *
+ * Note: This function requires the caller to serialization access.
+ */
+static svn_error_t *
+membuffer_cache_get_batch_internal(svn_membuffer_t *cache,
+                                   const batch_key_t *keys,
+                                   int count,
+                                   char **buffers,
+                                   apr_size_t *sizes,
+                                   apr_pool_t *result_pool)
+{
+  int i;
+
+  /* Get the groups' first cache lines on their way while we are still
+   * busy with the first keys. */
+  for (i = 0; i < count; ++i)
+    PREFETCH(&cache->directory[keys[i].group_index]);
+
+  for (i = 0; i < count; ++i)
+    SVN_ERR(membuffer_cache_get_internal(cache,
+                                         keys[i].group_index,
+                                         &keys[i].key,
+                                         &buffers[keys[i].idx],
+                                         &sizes[keys[i].idx],
+                                         result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Look for the COUNT items identified by KEYS in CACHE.  The KEYS must
+ * be sorted by segment.  Set VALUES and FOUND for each found item as
+ * membuffer_cache_get would, indexed by the respective key's IDX.  The
+ * DESERIALIZER is called to re-construct the objects from their serialized
+ * data.  Every segment will be locked only once.  Allocations will be
+ * done in RESULT_POOL.
+ */
+static svn_error_t *
+membuffer_cache_get_many(const batch_key_t *keys,
+                         int count,
+                         void **values,
+                         svn_boolean_t *found,
+                         svn_cache__deserialize_func_t deserializer,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  int total = 0;
+  char **buffers;
+  apr_size_t *sizes;
+  int first, last, i;
+
+  /* The results are indexed by the keys' IDX values. */
+  for (i = 0; i < count; ++i)
+    total = MAX(total, keys[i].idx + 1);
+
+  buffers = apr_pcalloc(scratch_pool, total * sizeof(*buffers));
+  sizes = apr_pcalloc(scratch_pool, total * sizeof(*sizes));
+
+  /* Look up all keys of the same segment under a single lock. */
+  for (first = 0; first < count; first = last)
     {
-      *item = NULL;
-      return SVN_NO_ERROR;
+      svn_membuffer_t *segment = keys[first].segment;
+      for (last = first + 1; last < count; ++last)
+        if (keys[last].segment != segment)
+          break;
+
+      WITH_READ_LOCK(segment,
+                     membuffer_cache_get_batch_internal(segment,
+                                                        keys + first,
+                                                        last - first,
+                                                        buffers,
+                                                        sizes,
+                                                        result_pool));
     }
 
-  return deserializer(item, buffer, size, result_pool);
+  /* Check the spill file for misses and re-construct the objects.
+   * These may need the write lock, so do this outside the read locks. */
+  for (i = 0; i < count; ++i)
+    {
+      int idx = keys[i].idx;
+      if (buffers[idx] == NULL)
+        SVN_ERR(membuffer_cache_get_spilled(keys[i].segment,
+                                            keys[i].group_index,
+                                            &keys[i].key,
+                                            &buffers[idx],
+                                            &sizes[idx],
+                                            result_pool));
+
+      if (buffers[idx] != NULL)
+        {
+          SVN_ERR(deserializer(&values[idx], buffers[idx], sizes[idx],
+                               result_pool));
+          found[idx] = values[idx] != NULL;
+        }
+    }
+
+  return SVN_NO_ERROR;
 }
 
+#endif /* SVN_DEBUG_CACHE_MEMBUFFER */
+
 /* Look for the cache entry in group GROUP_INDEX of CACHE, identified
  * by the hash value TO_FIND.  If no item has been stored for KEY, *FOUND
  * will be FALSE and TRUE otherwise.
@@ -2492,12 +3996,14 @@ membuffer_cache_has_key_internal(svn_membuffer_t *cache,
 static svn_error_t *
 membuffer_cache_has_key(svn_membuffer_t *cache,
                         const full_key_t *key,
-                        svn_boolean_t *found)
+                        svn_boolean_t *found,
+                        apr_pool_t *scratch_pool)
 {
   /* find the entry group that will hold the key.
    */
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
   cache->total_reads++;
+  sketch_increment(cache, &key->entry_key);
 
   WITH_READ_LOCK(cache,
                  membuffer_cache_has_key_internal(cache,
@@ -2505,6 +4011,18 @@ membuffer_cache_has_key(svn_membuffer_t *cache,
                                                   key,
                                                   found));
 
+  /* Items in the spill file are available as well.  Since callers will
+   * usually not request the item right away, don't re-insert it here. */
+  if (!*found && cache->spill)
+    {
+      apr_uint32_t priority;
+      apr_size_t size;
+      char *buffer;
+
+      read_spilled(&buffer, &size, &priority, cache, key, scratch_pool);
+      *found = buffer != NULL;
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -2561,6 +4079,14 @@ membuffer_cache_get_partial_internal(svn_membuffer_t *cache,
 
 #endif
 
+      /* The getter needs the uncompressed data. */
+      if (entry->compressed)
+        {
+          char *buffer = (char *)item_data;
+          SVN_ERR(decompress_item(&buffer, &item_size, result_pool));
+          item_data = buffer;
+        }
+
       return deserializer(item, item_data, item_size, baton, result_pool);
     }
 }
@@ -2582,6 +4108,7 @@ membuffer_cache_get_partial(svn_membuffer_t *cache,
                             apr_pool_t *result_pool)
 {
   apr_uint32_t group_index = get_group_index(&cache, &key->entry_key);
+  sketch_increment(cache, &key->entry_key);
 
   WITH_READ_LOCK(cache,
                  membuffer_cache_get_partial_internal
@@ -2589,6 +4116,23 @@ membuffer_cache_get_partial(svn_membuffer_t *cache,
                       deserializer, baton, DEBUG_CACHE_MEMBUFFER_TAG
                       result_pool));
 
+  /* Not in memory?  Maybe, we spilled it to disk earlier. */
+  if (!*found && cache->spill)
+    {
+      char *buffer;
+      apr_size_t size;
+
+      SVN_ERR(membuffer_cache_get_spilled(cache, group_index, key,
+                                          &buffer, &size,
+                                          DEBUG_CACHE_MEMBUFFER_TAG
+                                          result_pool));
+      if (buffer)
+        {
+          *found = TRUE;
+          return deserializer(item, buffer, size, baton, result_pool);
+        }
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -2646,6 +4190,16 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
 
 #endif
 
+      /* Compressed data can't be modified in-situ.  Work on an
+       * uncompressed copy and store that as a new entry.
+       */
+      if (entry->compressed)
+        {
+          char *buffer = item_data;
+          SVN_ERR(decompress_item(&buffer, &item_size, scratch_pool));
+          item_data = buffer;
+        }
+
       /* modify it, preferably in-situ.
        */
       err = func(&item_data, &item_size, baton, scratch_pool);
@@ -2678,7 +4232,8 @@ membuffer_cache_set_partial_internal(svn_membuffer_t *cache,
                   /* Write the new entry.
                    */
                   entry = find_entry(cache, group_index, to_find, TRUE);
-                  entry->size = item_size + key_len;
+                  entry->size = (apr_uint32_t)(item_size + key_len);
+                  entry->compressed = FALSE;
                   entry->offset = cache->l1.current_data;
 
                   if (key_len)
@@ -2730,11 +4285,370 @@ membuffer_cache_set_partial(svn_membuffer_t *cache,
                       DEBUG_CACHE_MEMBUFFER_TAG
                       scratch_pool));
 
+  /* A spilled copy would not reflect the modification. */
+  remove_spilled(cache, key);
+
   /* done here -> unlock the cache
    */
   return SVN_NO_ERROR;
 }
 
+/* Cache snapshots contain the serialized cache entries of one namespace.
+ * They allow to prime the cache after a restart.  The snapshot format is
+ * native to the machine and build that wrote it:
+ *
+ * - a snapshot_header_t, followed by the namespace string and some state
+ *   information given by the cache user, both without terminating NUL,
+ * - any number of snapshot_record_t, each followed by the prefix string
+ *   (without NUL), the full key and the serialized item data.
+ *
+ * Entries that use a shared prefix are identified by prefix string and
+ * fingerprint.  They store no key.  For all others, the full key already
+ * contains the prefix and the prefix string is empty.
+ */
+
+/* Identifies cache snapshots and their format.  Must fit into MAGIC.
+ */
+#define SNAPSHOT_MAGIC "SVN membuffer snapshot, v2\n"
+
+/* Written in native byte order to detect foreign snapshots.
+ */
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+/* Header of a cache snapshot.
+ */
+typedef struct snapshot_header_t
+{
+  /* Contains SNAPSHOT_MAGIC, padded with NULs. */
+  char magic[32];
+
+  /* SVN_VER_NUMBER of the writer because serialization formats may
+   * change between releases.  Padded with NULs. */
+  char version[32];
+
+  /* sizeof(void *) and SNAPSHOT_BYTE_ORDER as seen by the writer. */
+  apr_uint32_t pointer_size;
+  apr_uint32_t byte_order;
+
+  /* The YOUNGEST value given to svn_cache__membuffer_dump. */
+  apr_int64_t youngest;
+
+  /* Lengths of the namespace and state strings following the header. */
+  apr_uint32_t name_space_len;
+  apr_uint32_t state_len;
+} snapshot_header_t;
+
+/* Header of a cache snapshot record.
+ */
+typedef struct snapshot_record_t
+{
+  /* Fingerprint of the entry key. */
+  apr_uint64_t fingerprint[2];
+
+  /* Lengths of the prefix, key and data parts that follow. */
+  apr_uint32_t prefix_len;
+  apr_uint32_t key_len;
+  apr_uint32_t data_len;
+
+  /* Cache priority of the entry. */
+  apr_uint32_t priority;
+
+  /* FNV-1a checksum of the prefix XOR the one over key and data. */
+  apr_uint32_t checksum;
+
+  /* Combination of SNAPSHOT_* flags. */
+  apr_uint32_t flags;
+} snapshot_record_t;
+
+/* Flag in snapshot_record_t indicating that the data is compressed.
+ */
+#define SNAPSHOT_COMPRESSED 1
+
+/* Write all entries of the membuffer segment CACHE whose prefix starts
+ * with the NAME_SPACE_LEN bytes of NAME_SPACE to STREAM.  Use
+ * SCRATCH_POOL for temporary allocations.
+ *
+ * Note: This function requires the caller to hold at least a read lock.
+ */
+static svn_error_t *
+dump_segment(svn_membuffer_t *cache,
+             svn_stream_t *stream,
+             const char *name_space,
+             apr_size_t name_space_len,
+             apr_pool_t *scratch_pool)
+{
+  cache_level_t *levels[2];
+  int i;
+
+  levels[0] = &cache->l1;
+  levels[1] = &cache->l2;
+
+  for (i = 0; i < 2; ++i)
+    {
+      apr_uint32_t idx = levels[i]->first;
+      while (idx != NO_INDEX)
+        {
+          entry_t *entry = get_entry(cache, idx);
+          const char *data = (const char *)cache->data + entry->offset;
+          const char *prefix = "";
+          snapshot_record_t record = { { 0 } };
+          apr_size_t len;
+
+          idx = entry->next;
+
+          /* Skip entries from other namespaces. */
+          if (entry->key.prefix_idx != NO_INDEX)
+            {
+              prefix = cache->prefix_pool->values[entry->key.prefix_idx];
+              if (strncmp(prefix, name_space, name_space_len))
+                continue;
+            }
+          else if (   entry->key.key_len < name_space_len
+                   || memcmp(data, name_space, name_space_len))
+            {
+              continue;
+            }
+
+          record.fingerprint[0] = entry->key.fingerprint[0];
+          record.fingerprint[1] = entry->key.fingerprint[1];
+          record.prefix_len = (apr_uint32_t)strlen(prefix);
+          record.key_len = (apr_uint32_t)entry->key.key_len;
+          record.data_len = (apr_uint32_t)(entry->size - entry->key.key_len);
+          record.priority = entry->priority;
+          record.flags = entry->compressed ? SNAPSHOT_COMPRESSED : 0;
+
+          record.checksum = svn__fnv1a_32(prefix, record.prefix_len)
+                          ^ svn__fnv1a_32(data, entry->size);
+
+          len = sizeof(record);
+          SVN_ERR(svn_stream_write(stream, (const char *)&record, &len));
+          len = record.prefix_len;
+          SVN_ERR(svn_stream_write(stream, prefix, &len));
+          len = entry->size;
+          SVN_ERR(svn_stream_write(stream, data, &len));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_dump(svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          const char *name_space,
+                          svn_revnum_t youngest,
+                          const char *state,
+                          apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  snapshot_header_t header = { { 0 } };
+  apr_uint32_t seg;
+  apr_size_t len;
+
+  memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+  memcpy(header.version, SVN_VER_NUMBER, sizeof(SVN_VER_NUMBER));
+  header.pointer_size = sizeof(void *);
+  header.byte_order = SNAPSHOT_BYTE_ORDER;
+  header.youngest = youngest;
+  header.name_space_len = (apr_uint32_t)strlen(name_space);
+  header.state_len = (apr_uint32_t)strlen(state);
+
+  len = sizeof(header);
+  SVN_ERR(svn_stream_write(stream, (const char *)&header, &len));
+  len = header.name_space_len;
+  SVN_ERR(svn_stream_write(stream, name_space, &len));
+  len = header.state_len;
+  SVN_ERR(svn_stream_write(stream, state, &len));
+
+  /* Writers to the segment being dumped must wait or will be ignored. */
+  for (seg = 0; seg < cache->segment_count; ++seg)
+    {
+      svn_pool_clear(iterpool);
+      WITH_READ_LOCK(&cache[seg],
+                     dump_segment(&cache[seg], stream, name_space,
+                                  header.name_space_len, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+
+/* Read exactly LEN bytes from STREAM into BUFFER.  Set *COMPLETE to FALSE
+ * if the stream ended before that.
+ */
+static svn_error_t *
+read_snapshot_part(svn_boolean_t *complete,
+                   svn_stream_t *stream,
+                   void *buffer,
+                   apr_size_t len)
+{
+  apr_size_t read = len;
+  SVN_ERR(svn_stream_read_full(stream, buffer, &read));
+  *complete = read == len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__membuffer_load() for non-debug builds.
+ */
+static svn_error_t *
+load_snapshot(svn_boolean_t *loaded,
+              svn_membuffer_t *cache,
+              svn_stream_t *stream,
+              const char *name_space,
+              svn_revnum_t youngest,
+              const char *state,
+              apr_pool_t *scratch_pool)
+{
+  snapshot_header_t header;
+  apr_size_t name_space_len = strlen(name_space);
+  svn_stringbuf_t *buffer;
+  svn_stringbuf_t *prefix_buf;
+  svn_boolean_t complete;
+  full_key_t to_insert;
+  const full_key_t *key = &to_insert;
+
+  /* Is this a compatible snapshot? */
+  SVN_ERR(read_snapshot_part(&complete, stream, &header, sizeof(header)));
+  if (   !complete
+      || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)))
+    return svn_error_create(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
+                            _("Not a membuffer cache snapshot"));
+
+  if (   memcmp(header.version, SVN_VER_NUMBER, sizeof(SVN_VER_NUMBER))
+      || header.pointer_size != sizeof(void *)
+      || header.byte_order != SNAPSHOT_BYTE_ORDER)
+    return svn_error_create(SVN_ERR_BAD_VERSION_FILE_FORMAT, NULL,
+                            _("Membuffer cache snapshot has been written "
+                              "by a different build or platform"));
+
+  /* Does it match the cache user's current state?  Data from the future
+   * or an alternate past is of no use. */
+  buffer = svn_stringbuf_create_ensure(0x1000, scratch_pool);
+  svn_stringbuf_ensure(buffer, (apr_size_t)header.name_space_len
+                               + header.state_len);
+  SVN_ERR(read_snapshot_part(&complete, stream, buffer->data,
+                             (apr_size_t)header.name_space_len
+                             + header.state_len));
+  if (   !complete
+      || header.name_space_len != name_space_len
+      || header.state_len != strlen(state)
+      || memcmp(buffer->data, name_space, name_space_len)
+      || memcmp(buffer->data + name_space_len, state, header.state_len)
+      || header.youngest > youngest)
+    return SVN_NO_ERROR;
+
+  *loaded = TRUE;
+  svn_membuf__create(&to_insert.full_key, 0x100, scratch_pool);
+  prefix_buf = svn_stringbuf_create_empty(scratch_pool);
+
+  /* Insert all records until the end of the snapshot. */
+  while (TRUE)
+    {
+      snapshot_record_t record;
+      svn_membuffer_t *segment = cache;
+      apr_uint32_t group_index;
+      apr_size_t len;
+      char *prefix;
+      char *key_data;
+      char *data;
+
+      SVN_ERR(read_snapshot_part(&complete, stream, &record,
+                                 sizeof(record)));
+      if (!complete)
+        break;
+
+      len = (apr_size_t)record.prefix_len + record.key_len + record.data_len;
+      svn_stringbuf_ensure(buffer, len);
+      SVN_ERR(read_snapshot_part(&complete, stream, buffer->data, len));
+      if (!complete)
+        break;
+
+      prefix = buffer->data;
+      key_data = prefix + record.prefix_len;
+      data = key_data + record.key_len;
+
+      if (  (  svn__fnv1a_32(prefix, record.prefix_len)
+             ^ svn__fnv1a_32(key_data, len - record.prefix_len))
+          != record.checksum)
+        break;
+
+      /* Reconstruct the key.  Skip entries that don't belong to
+       * NAME_SPACE or whose prefix can't be shared in this process. */
+      to_insert.entry_key.fingerprint[0] = record.fingerprint[0];
+      to_insert.entry_key.fingerprint[1] = record.fingerprint[1];
+      to_insert.entry_key.key_len = record.key_len;
+
+      if (record.prefix_len)
+        {
+          if (   record.key_len
+              || record.prefix_len < name_space_len
+              || memcmp(prefix, name_space, name_space_len))
+            continue;
+
+          svn_stringbuf_setempty(prefix_buf);
+          svn_stringbuf_appendbytes(prefix_buf, prefix, record.prefix_len);
+          SVN_ERR(prefix_pool_get(&to_insert.entry_key.prefix_idx,
+                                  cache->prefix_pool, prefix_buf->data));
+          if (to_insert.entry_key.prefix_idx == NO_INDEX)
+            continue;
+        }
+      else
+        {
+          if (   record.key_len < name_space_len
+              || memcmp(key_data, name_space, name_space_len))
+            continue;
+
+          to_insert.entry_key.prefix_idx = NO_INDEX;
+          svn_membuf__ensure(&to_insert.full_key, record.key_len);
+          memcpy(to_insert.full_key.data, key_data, record.key_len);
+        }
+
+      group_index = get_group_index(&segment, &to_insert.entry_key);
+      WITH_WRITE_LOCK(segment,
+                      membuffer_cache_set_internal(segment,
+                                                   key,
+                                                   group_index,
+                                                   data,
+                                                   record.data_len,
+                                                   (record.flags
+                                                    & SNAPSHOT_COMPRESSED)
+                                                     != 0,
+                                                   record.priority,
+                                                   scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#endif
+
+svn_error_t *
+svn_cache__membuffer_load(svn_boolean_t *loaded,
+                          svn_membuffer_t *cache,
+                          svn_stream_t *stream,
+                          const char *name_space,
+                          svn_revnum_t youngest,
+                          const char *state,
+                          apr_pool_t *scratch_pool)
+{
+  *loaded = FALSE;
+
+#ifdef SVN_DEBUG_CACHE_MEMBUFFER
+
+  /* We can't reconstruct the debug tags of the entries. */
+  return SVN_NO_ERROR;
+
+#else
+
+  return svn_error_trace(load_snapshot(loaded, cache, stream, name_space,
+                                       youngest, state, scratch_pool));
+
+#endif
+}
+
 /* Implement the svn_cache__t interface on top of a shared membuffer cache.
  *
  * Because membuffer caches tend to be very large, there will be rather few
@@ -2781,6 +4695,11 @@ typedef struct svn_membuffer_cache_t
   /* priority class for all items written through this interface */
   apr_uint32_t priority;
 
+  /* Serialized items of at least this size will be compressed.
+   * 0 disables compression.
+   */
+  apr_size_t compression_threshold;
+
   /* Temporary buffer containing the hash key for the current access
    */
   full_key_t combined_key;
@@ -2899,6 +4818,43 @@ combine_key(svn_membuffer_cache_t *cache,
     = data[1] ^ cache->prefix.fingerprint[1];
 }
 
+/* Return the access statistics for the key prefix of CACHE or NULL if
+ * that prefix could not be added to the prefix pool.
+ */
+static prefix_stats_t *
+get_prefix_stats(svn_membuffer_cache_t *cache)
+{
+  apr_uint32_t prefix_idx = cache->combined_key.entry_key.prefix_idx;
+  return prefix_idx == NO_INDEX
+       ? NULL
+       : &cache->membuffer->prefix_pool->stats[prefix_idx];
+}
+
+/* Count a lookup in CACHE that succeeded if FOUND is set.
+ */
+static void
+count_get(svn_membuffer_cache_t *cache,
+          svn_boolean_t found)
+{
+  prefix_stats_t *stats = get_prefix_stats(cache);
+  if (stats)
+    {
+      stats->gets++;
+      if (found)
+        stats->hits++;
+    }
+}
+
+/* Count a setter call in CACHE.
+ */
+static void
+count_set(svn_membuffer_cache_t *cache)
+{
+  prefix_stats_t *stats = get_prefix_stats(cache);
+  if (stats)
+    stats->sets++;
+}
+
 /* Implement svn_cache__vtable_t.get (not thread-safe)
  */
 static svn_error_t *
@@ -2936,6 +4892,80 @@ svn_membuffer_cache_get(void **value_p,
 
   /* return result */
   *found = *value_p != NULL;
+  count_get(cache, *found);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__vtable_t.get_many (not thread-safe)
+ */
+static svn_error_t *
+svn_membuffer_cache_get_many(void **values,
+                             svn_boolean_t *found,
+                             void *cache_void,
+                             const void *const *keys,
+                             int count,
+                             apr_pool_t *result_pool,
+                             apr_pool_t *scratch_pool)
+{
+  int i;
+
+#ifdef SVN_DEBUG_CACHE_MEMBUFFER
+
+  /* Every lookup needs its own debug tag.  So, simply go one-by-one. */
+  for (i = 0; i < count; ++i)
+    SVN_ERR(svn_membuffer_cache_get(&values[i], &found[i], cache_void,
+                                    keys[i], result_pool));
+
+#else
+
+  svn_membuffer_cache_t *cache = cache_void;
+  batch_key_t *batch = apr_palloc(scratch_pool, count * sizeof(*batch));
+  int batch_count = 0;
+
+  /* Combine all keys and find the groups they belong to.  COMBINE_KEY
+   * overwrites CACHE->COMBINED_KEY, so we need to take copies. */
+  for (i = 0; i < count; ++i)
+    {
+      batch_key_t *batch_key;
+
+      values[i] = NULL;
+      found[i] = FALSE;
+
+      /* special case */
+      if (keys[i] == NULL)
+        continue;
+
+      combine_key(cache, keys[i], cache->key_len);
+
+      batch_key = &batch[batch_count++];
+      batch_key->key = cache->combined_key;
+      if (batch_key->key.entry_key.key_len)
+        batch_key->key.full_key.data
+          = apr_pmemdup(scratch_pool, cache->combined_key.full_key.data,
+                        batch_key->key.entry_key.key_len);
+
+      batch_key->segment = cache->membuffer;
+      batch_key->group_index = get_group_index(&batch_key->segment,
+                                               &batch_key->key.entry_key);
+      batch_key->idx = i;
+
+      sketch_increment(batch_key->segment, &batch_key->key.entry_key);
+    }
+
+  /* Visit each segment only once and its groups in address order. */
+  qsort(batch, batch_count, sizeof(*batch), compare_batch_keys);
+
+  /* Look the items up. */
+  SVN_ERR(membuffer_cache_get_many(batch, batch_count, values, found,
+                                   cache->deserializer, result_pool,
+                                   scratch_pool));
+
+  /* All keys share the same prefix and thus the same statistics. */
+  for (i = 0; i < batch_count; ++i)
+    count_get(cache, found[batch[i].idx]);
+
+#endif
 
   return SVN_NO_ERROR;
 }
@@ -2966,7 +4996,9 @@ svn_membuffer_cache_has_key(svn_boolean_t *found,
   /* Look the item up. */
   SVN_ERR(membuffer_cache_has_key(cache->membuffer,
                                   &cache->combined_key,
-                                  found));
+                                  found,
+                                  scratch_pool));
+  count_get(cache, *found);
 
   /* return result */
   return SVN_NO_ERROR;
@@ -2996,10 +5028,12 @@ svn_membuffer_cache_set(void *cache_void,
   /* (probably) add the item to the cache. But there is no real guarantee
    * that the item will actually be cached afterwards.
    */
+  count_set(cache);
   return membuffer_cache_set(cache->membuffer,
                              &cache->combined_key,
                              value,
                              cache->serializer,
+                             cache->compression_threshold,
                              cache->priority,
                              DEBUG_CACHE_MEMBUFFER_TAG
                              scratch_pool);
@@ -3050,6 +5084,7 @@ svn_membuffer_cache_get_partial(void **value_p,
                                       baton,
                                       DEBUG_CACHE_MEMBUFFER_TAG
                                       result_pool));
+  count_get(cache, *found);
 
   return SVN_NO_ERROR;
 }
@@ -3070,6 +5105,7 @@ svn_membuffer_cache_set_partial(void *cache_void,
   if (key != NULL)
     {
       combine_key(cache, key, cache->key_len);
+      count_set(cache);
       SVN_ERR(membuffer_cache_set_partial(cache->membuffer,
                                           &cache->combined_key,
                                           func,
@@ -3168,7 +5204,8 @@ static svn_cache__vtable_t membuffer_cache_vtable = {
   svn_membuffer_cache_is_cachable,
   svn_membuffer_cache_get_partial,
   svn_membuffer_cache_set_partial,
-  svn_membuffer_cache_get_info
+  svn_membuffer_cache_get_info,
+  svn_membuffer_cache_get_many
 };
 
 /* Implement svn_cache__vtable_t.get and serialize all cache access.
@@ -3191,6 +5228,30 @@ svn_membuffer_cache_get_synced(void **value_p,
   return SVN_NO_ERROR;
 }
 
+/* Implement svn_cache__vtable_t.get_many and serialize all cache access.
+ */
+static svn_error_t *
+svn_membuffer_cache_get_many_synced(void **values,
+                                    svn_boolean_t *found,
+                                    void *cache_void,
+                                    const void *const *keys,
+                                    int count,
+                                    apr_pool_t *result_pool,
+                                    apr_pool_t *scratch_pool)
+{
+  svn_membuffer_cache_t *cache = cache_void;
+  SVN_MUTEX__WITH_LOCK(cache->mutex,
+                       svn_membuffer_cache_get_many(values,
+                                                    found,
+                                                    cache_void,
+                                                    keys,
+                                                    count,
+                                                    result_pool,
+                                                    scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* Implement svn_cache__vtable_t.has_key and serialize all cache access.
  */
 static svn_error_t *
@@ -3281,7 +5342,8 @@ static svn_cache__vtable_t membuffer_cache_synced_vtable = {
   svn_membuffer_cache_is_cachable,        /* no sync required */
   svn_membuffer_cache_get_partial_synced,
   svn_membuffer_cache_set_partial_synced,
-  svn_membuffer_cache_get_info            /* no sync required */
+  svn_membuffer_cache_get_info,           /* no sync required */
+  svn_membuffer_cache_get_many_synced
 };
 
 /* standard serialization function for svn_stringbuf_t items.
@@ -3426,6 +5488,28 @@ svn_cache__create_membuffer_cache(svn_cache__t **cache_p,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_cache__membuffer_set_compression(svn_cache__t *cache,
+                                     apr_size_t threshold)
+{
+  svn_membuffer_cache_t *membuffer_cache;
+
+  if (   cache->vtable != &membuffer_cache_vtable
+      && cache->vtable != &membuffer_cache_synced_vtable)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Compression requires a membuffer cache"));
+
+  if (threshold && !svn__lz4_supported())
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("LZ4 compression is not supported by this "
+                              "build of Subversion"));
+
+  membuffer_cache = cache->cache_internal;
+  membuffer_cache->compression_threshold = threshold;
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 svn_membuffer_get_global_segment_info(svn_membuffer_t *segment,
                                       svn_cache__info_t *info)
@@ -3433,6 +5517,7 @@ svn_membuffer_get_global_segment_info(svn_membuffer_t *segment,
   info->gets += segment->total_reads;
   info->sets += segment->total_writes;
   info->hits += segment->total_hits;
+  info->evictions += segment->total_evictions;
 
   WITH_READ_LOCK(segment,
                   svn_membuffer_get_segment_info(segment, info, TRUE));
@@ -3460,3 +5545,101 @@ svn_cache__membuffer_get_global_info(apr_pool_t *pool)
 
   return info;
 }
+
+void
+svn_cache__membuffer_get_global_counters(apr_uint64_t *gets,
+                                         apr_uint64_t *hits)
+{
+  apr_uint32_t i;
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+
+  *gets = 0;
+  *hits = 0;
+  if (membuffer == NULL)
+    return;
+
+  for (i = 0; i < membuffer->segment_count; ++i)
+    {
+      *gets += membuffer[i].total_reads;
+      *hits += membuffer[i].total_hits;
+    }
+}
+
+/* Add the size and number of all entries in SEGMENT to the respective
+ * element in INFOS, which is indexed by the entry's prefix index.  Ignore
+ * entries with a prefix index of COUNT or larger.
+ */
+static svn_error_t *
+add_prefix_usage(svn_membuffer_t *segment,
+                 svn_cache__info_t **infos,
+                 apr_uint32_t count)
+{
+  cache_level_t *levels[2];
+  int i;
+
+  levels[0] = &segment->l1;
+  levels[1] = &segment->l2;
+
+  for (i = 0; i < 2; ++i)
+    {
+      apr_uint32_t idx;
+      for (idx = levels[i]->first; idx != NO_INDEX; )
+        {
+          entry_t *entry = get_entry(segment, idx);
+          idx = entry->next;
+
+          if (entry->key.prefix_idx < count)
+            {
+              svn_cache__info_t *info = infos[entry->key.prefix_idx];
+              info->used_size += entry->size;
+              info->data_size += entry->size;
+              info->used_entries++;
+            }
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__membuffer_get_prefix_info(apr_array_header_t **infos,
+                                     svn_membuffer_t *cache,
+                                     svn_boolean_t reset,
+                                     apr_pool_t *result_pool)
+{
+  prefix_pool_t *prefix_pool = cache->prefix_pool;
+  apr_uint32_t count = prefix_pool->values_used;
+  svn_cache__info_t **by_prefix
+    = apr_pcalloc(result_pool, count * sizeof(*by_prefix));
+  apr_uint32_t i;
+
+  /* The prefix pool only grows, so we may simply ignore prefixes that
+   * got added while we collect the data. */
+  *infos = apr_array_make(result_pool, count, sizeof(svn_cache__info_t *));
+  for (i = 0; i < count; ++i)
+    {
+      prefix_stats_t *stats = &prefix_pool->stats[i];
+      svn_cache__info_t *info = apr_pcalloc(result_pool, sizeof(*info));
+
+      info->id = apr_pstrdup(result_pool, prefix_pool->values[i]);
+      info->gets = stats->gets;
+      info->hits = stats->hits;
+      info->sets = stats->sets;
+      info->evictions = stats->evictions;
+
+      if (reset)
+        memset(stats, 0, sizeof(*stats));
+
+      by_prefix[i] = info;
+      APR_ARRAY_PUSH(*infos, svn_cache__info_t *) = info;
+    }
+
+  for (i = 0; i < cache->segment_count; ++i)
+    {
+      svn_membuffer_t *segment = cache + i;
+      WITH_READ_LOCK(segment,
+                     add_prefix_usage(segment, by_prefix, count));
+    }
+
+  return SVN_NO_ERROR;
+}
@@ -25,6 +25,7 @@
 
 #include "svn_pools.h"
 #include "svn_base64.h"
+#include "svn_hash.h"
 #include "svn_path.h"
 
 #include "svn_private_config.h"
@@ -37,11 +38,16 @@
 
 #include <apr_memcache.h>
 
+#if APR_HAS_THREADS
+#  include <apr_thread_pool.h>
+#endif
+
 /* A note on thread safety:
 
    The apr_memcache_t object does its own mutex handling, and nothing
    else in memcache_t is ever modified, so this implementation should
-   be fully thread-safe.
+   be fully thread-safe.  The same is true for the apr_thread_pool_t
+   used for asynchronous writes.
 */
 
 /* The (internal) cache object. */
@@ -61,11 +67,25 @@ typedef struct memcache_t {
   /* Used to marshal values in and out of the cache. */
   svn_cache__serialize_func_t serialize_func;
   svn_cache__deserialize_func_t deserialize_func;
+
+#if APR_HAS_THREADS
+  /* Background thread performing our writes.  NULL for synchronous
+   * writes. */
+  apr_thread_pool_t *writer;
+#endif
 } memcache_t;
 
 /* The wrapper around apr_memcache_t. */
 struct svn_memcache_t {
   apr_memcache_t *c;
+
+  /* Whether to use memcached below the membuffer caches. */
+  svn_boolean_t second_level;
+
+#if APR_HAS_THREADS
+  /* Background thread for asynchronous writes or NULL. */
+  apr_thread_pool_t *writer;
+#endif
 };
 
 
@@ -75,6 +95,14 @@ struct svn_memcache_t {
 #define MEMCACHED_KEY_UNHASHED_LEN (MAX_MEMCACHED_KEY_LEN - \
                                     2 * APR_MD5_DIGESTSIZE)
 
+/* Default for the maximum number of connections per memcached server. */
+#define DEFAULT_CONNECTIONS_PER_SERVER 10
+
+/* If that many asynchronous writes are pending, new writes will be
+   synchronous again.  That prevents the queue from growing without
+   bounds if the servers can't keep up. */
+#define MAX_PENDING_WRITES 1000
+
 
 /* Set *MC_KEY to a memcache key for the given key KEY for CACHE, allocated
    in POOL. */
@@ -176,6 +204,34 @@ memcache_internal_get(char **data,
 }
 
 
+/* Re-construct the object *VALUE_P from the DATA_LEN bytes of DATA
+ * read from CACHE.  DATA must have been allocated in RESULT_POOL, which
+ * will also be used for all further allocations.
+ */
+static svn_error_t *
+deserialize_item(void **value_p,
+                 memcache_t *cache,
+                 char *data,
+                 apr_size_t data_len,
+                 apr_pool_t *result_pool)
+{
+  if (cache->deserialize_func)
+    {
+      SVN_ERR((cache->deserialize_func)(value_p, data, data_len,
+                                        result_pool));
+    }
+  else
+    {
+      svn_stringbuf_t *value = svn_stringbuf_create_empty(result_pool);
+      value->data = data;
+      value->blocksize = data_len;
+      value->len = data_len - 1; /* account for trailing NUL */
+      *value_p = value;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 memcache_get(void **value_p,
              svn_boolean_t *found,
@@ -195,22 +251,71 @@ memcache_get(void **value_p,
 
   /* If we found it, de-serialize it. */
   if (*found)
+    SVN_ERR(deserialize_item(value_p, cache, data, data_len, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement vtable.get_many.  apr_memcache will send all requests to the
+ * same server as a single command and collect the responses afterwards.
+ */
+static svn_error_t *
+memcache_get_many(void **values,
+                  svn_boolean_t *found,
+                  void *cache_void,
+                  const void *const *keys,
+                  int count,
+                  apr_pool_t *result_pool,
+                  apr_pool_t *scratch_pool)
+{
+  memcache_t *cache = cache_void;
+  const char **mc_keys = apr_pcalloc(scratch_pool, count * sizeof(*mc_keys));
+  apr_hash_t *requests = NULL;
+  apr_status_t apr_err;
+  int i;
+
+  for (i = 0; i < count; ++i)
     {
-      if (cache->deserialize_func)
-        {
-          SVN_ERR((cache->deserialize_func)(value_p, data, data_len,
-                                            result_pool));
-        }
-      else
+      values[i] = NULL;
+      found[i] = FALSE;
+
+      if (keys[i])
         {
-          svn_stringbuf_t *value = svn_stringbuf_create_empty(result_pool);
-          value->data = data;
-          value->blocksize = data_len;
-          value->len = data_len - 1; /* account for trailing NUL */
-          *value_p = value;
+          SVN_ERR(build_key(&mc_keys[i], cache, keys[i], scratch_pool));
+          apr_memcache_add_multget_key(scratch_pool, mc_keys[i], &requests);
         }
     }
 
+  if (requests == NULL)
+    return SVN_NO_ERROR;
+
+  apr_err = apr_memcache_multgetp(cache->memcache, scratch_pool,
+                                  scratch_pool, requests);
+  if (apr_err == APR_NOTFOUND)
+    return SVN_NO_ERROR;
+  else if (apr_err != APR_SUCCESS)
+    return svn_error_wrap_apr(apr_err,
+                              _("Unknown memcached error while reading"));
+
+  for (i = 0; i < count; ++i)
+    {
+      apr_memcache_value_t *response;
+      if (mc_keys[i] == NULL)
+        continue;
+
+      response = svn_hash_gets(requests, mc_keys[i]);
+      if (response->status != APR_SUCCESS || response->data == NULL)
+        continue;
+
+      /* The same key may have been requested more than once and the
+       * deserializer may modify the data in-place.  So, use a copy. */
+      SVN_ERR(deserialize_item(&values[i], cache,
+                               apr_pmemdup(result_pool, response->data,
+                                           response->len),
+                               response->len, result_pool));
+      found[i] = TRUE;
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -234,6 +339,96 @@ memcache_has_key(svn_boolean_t *found,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+
+/* An item to be written by the background writer.  The strings are
+ * allocated in the same block of memory as the task itself.
+ */
+typedef struct write_task_t
+{
+  /* The memcached server set to write to. */
+  apr_memcache_t *memcache;
+
+  /* Key, as returned by build_key(). */
+  char *key;
+
+  /* Serialized data to write and its length. */
+  char *data;
+  apr_size_t len;
+} write_task_t;
+
+/* Write the write_task_t given in BATON and release it.
+ * Implements apr_thread_start_t.
+ */
+static void * APR_THREAD_FUNC
+write_item(apr_thread_t *thread,
+           void *baton)
+{
+  write_task_t *task = baton;
+
+  /* Nobody is waiting for the result of this.  A failed write is no
+   * different from the item being evicted right away. */
+  apr_memcache_set(task->memcache, task->key, task->data, task->len, 0, 0);
+  free(task);
+
+  return NULL;
+}
+
+/* Hand writing LEN bytes of DATA under MC_KEY to CACHE over to the
+ * background writer.  Return FALSE, if the caller has to write the data
+ * itself because there is no such writer or it is already too busy.
+ */
+static svn_boolean_t
+queue_write(memcache_t *cache,
+            const char *mc_key,
+            const char *data,
+            apr_size_t len)
+{
+  apr_size_t key_len;
+  write_task_t *task;
+
+  if (   cache->writer == NULL
+      || apr_thread_pool_tasks_count(cache->writer) >= MAX_PENDING_WRITES)
+    return FALSE;
+
+  /* The task must survive the caller's pools. */
+  key_len = strlen(mc_key) + 1;
+  task = malloc(sizeof(*task) + key_len + len);
+  if (task == NULL)
+    return FALSE;
+
+  task->memcache = cache->memcache;
+  task->key = (char *)(task + 1);
+  task->data = task->key + key_len;
+  task->len = len;
+  memcpy(task->key, mc_key, key_len);
+  memcpy(task->data, data, len);
+
+  if (apr_thread_pool_push(cache->writer, write_item, task,
+                           APR_THREAD_TASK_PRIORITY_NORMAL, NULL))
+    {
+      free(task);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* APR pool pre-cleanup handler waiting for the apr_thread_pool_t WRITER
+ * to pick up all queued writes.  The thread pool itself will wait for the
+ * running ones to finish.  Without this, queued tasks would be leaked.
+ */
+static apr_status_t
+drain_writer(void *writer)
+{
+  while (apr_thread_pool_tasks_count(writer))
+    apr_sleep(1000);
+
+  return APR_SUCCESS;
+}
+
+#endif /* APR_HAS_THREADS */
+
 /* Core functionality of our setter functions: store LENGH bytes of DATA
  * to be identified by KEY in the memcached given by CACHE_VOID. Use POOL
  * for temporary allocations.
@@ -250,6 +445,12 @@ memcache_internal_set(void *cache_void,
   apr_status_t apr_err;
 
   SVN_ERR(build_key(&mc_key, cache, key, scratch_pool));
+
+#if APR_HAS_THREADS
+  if (queue_write(cache, mc_key, data, len))
+    return SVN_NO_ERROR;
+#endif
+
   apr_err = apr_memcache_set(cache->memcache, mc_key, (char *)data, len, 0, 0);
 
   /* ### Maybe write failures should be ignored (but logged)? */
@@ -398,7 +599,8 @@ static svn_cache__vtable_t memcache_vtable = {
   memcache_is_cachable,
   memcache_get_partial,
   memcache_set_partial,
-  memcache_get_info
+  memcache_get_info,
+  memcache_get_many
 };
 
 svn_error_t *
@@ -418,6 +620,9 @@ svn_cache__create_memcache(svn_cache__t **cache_p,
   cache->klen = klen;
   cache->prefix = svn_path_uri_encode(prefix, pool);
   cache->memcache = memcache->c;
+#if APR_HAS_THREADS
+  cache->writer = memcache->writer;
+#endif
 
   wrapper->vtable = &memcache_vtable;
   wrapper->cache_internal = cache;
@@ -436,6 +641,7 @@ svn_cache__create_memcache(svn_cache__t **cache_p,
 struct ams_baton {
   apr_memcache_t *memcache;
   apr_pool_t *memcache_pool;
+  apr_uint32_t max_connections;
   svn_error_t *err;
 };
 
@@ -480,13 +686,14 @@ add_memcache_server(const char *name,
     }
 
   /* Note: the four numbers here are only relevant when an
-     apr_memcache_t is being shared by multiple threads. */
+     apr_memcache_t is being shared by multiple threads.  Idle connections
+     beyond the soft limit will be closed after the time to live. */
   apr_err = apr_memcache_server_create(b->memcache_pool,
                                        host,
                                        port,
                                        0,  /* min connections */
-                                       5,  /* soft max connections */
-                                       10, /* hard max connections */
+                                       (b->max_connections + 1) / 2,
+                                       b->max_connections,
                                        /*  time to live (in microseconds) */
                                        apr_time_from_sec(50),
                                        &server);
@@ -508,6 +715,12 @@ add_memcache_server(const char *name,
   return TRUE;
 }
 
+svn_boolean_t
+svn_cache__memcache_is_second_level(const svn_memcache_t *memcache)
+{
+  return memcache->second_level;
+}
+
 #else /* ! SVN_HAVE_MEMCACHE */
 
 /* Stubs for no apr memcache library. */
@@ -516,6 +729,12 @@ struct svn_memcache_t {
   void *unused; /* Let's not have a size-zero struct. */
 };
 
+svn_boolean_t
+svn_cache__memcache_is_second_level(const svn_memcache_t *memcache)
+{
+  return FALSE;
+}
+
 svn_error_t *
 svn_cache__create_memcache(svn_cache__t **cache_p,
                           svn_memcache_t *memcache,
@@ -565,16 +784,42 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
   {
     struct ams_baton b;
     svn_memcache_t *memcache = apr_pcalloc(result_pool, sizeof(*memcache));
-    apr_status_t apr_err = apr_memcache_create(result_pool,
-                                               (apr_uint16_t)server_count,
-                                               0, /* flags */
-                                               &(memcache->c));
+    apr_int64_t max_connections;
+    svn_boolean_t async_writes;
+    apr_status_t apr_err;
+
+    SVN_ERR(svn_config_get_int64(config, &max_connections,
+                                 SVN_CACHE_CONFIG_CATEGORY_MEMCACHED_OPTIONS,
+                                 SVN_CACHE_CONFIG_OPTION_MEMCACHED_CONNECTIONS,
+                                 DEFAULT_CONNECTIONS_PER_SERVER));
+    SVN_ERR(svn_config_get_bool(config, &async_writes,
+                                SVN_CACHE_CONFIG_CATEGORY_MEMCACHED_OPTIONS,
+                                SVN_CACHE_CONFIG_OPTION_MEMCACHED_ASYNC_WRITES,
+                                FALSE));
+    SVN_ERR(svn_config_get_bool(config, &memcache->second_level,
+                                SVN_CACHE_CONFIG_CATEGORY_MEMCACHED_OPTIONS,
+                                SVN_CACHE_CONFIG_OPTION_MEMCACHED_SECOND_LEVEL,
+                                FALSE));
+
+    if (max_connections < 1 || max_connections > APR_UINT16_MAX)
+      return svn_error_createf(SVN_ERR_BAD_CONFIG_VALUE, NULL,
+                               _("Invalid number of memcached connections "
+                                 "per server: %s"),
+                               apr_psprintf(scratch_pool,
+                                            "%" APR_INT64_T_FMT,
+                                            max_connections));
+
+    apr_err = apr_memcache_create(result_pool,
+                                  (apr_uint16_t)server_count,
+                                  0, /* flags */
+                                  &(memcache->c));
     if (apr_err != APR_SUCCESS)
       return svn_error_wrap_apr(apr_err,
                                 _("Unknown error creating apr_memcache_t"));
 
     b.memcache = memcache->c;
     b.memcache_pool = result_pool;
+    b.max_connections = (apr_uint32_t)max_connections;
     b.err = SVN_NO_ERROR;
     svn_config_enumerate2(config,
                           SVN_CACHE_CONFIG_CATEGORY_MEMCACHED_SERVERS,
@@ -584,6 +829,22 @@ svn_cache__make_memcache_from_config(svn_memcache_t **memcache_p,
     if (b.err)
       return b.err;
 
+#if APR_HAS_THREADS
+    /* A single writer keeps the order of writes to the same key. */
+    if (async_writes)
+      {
+        apr_err = apr_thread_pool_create(&memcache->writer, 1, 1,
+                                         result_pool);
+        if (apr_err != APR_SUCCESS)
+          return svn_error_wrap_apr(apr_err,
+                                    _("Can't create memcached writer"));
+
+        /* Pre-cleanups run before the thread pool gets destroyed. */
+        apr_pool_pre_cleanup_register(result_pool, memcache->writer,
+                                      drain_writer);
+      }
+#endif
+
     *memcache_p = memcache;
 
     return SVN_NO_ERROR;
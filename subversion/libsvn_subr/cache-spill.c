@@ -0,0 +1,918 @@
+/*
+ * cache-spill.c: on-disk storage for items evicted from membuffer caches
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include <apr_time.h>
+
+#include "svn_dirent_uri.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_mutex.h"
+#include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
+
+#include "svn_private_config.h"
+
+#include "cache.h"
+#include "fnv1a.h"
+
+/*
+ * A spill file is a fixed-size file on local (preferably solid-state)
+ * storage that receives items evicted from a membuffer cache.  It
+ * survives process restarts and allows to warm up the in-memory cache
+ * much faster than by reading and parsing repository data.
+ *
+ * The file consists of three parts:
+ *
+ * 1. A header of SPILL_HEADER_SIZE bytes (spill_header_t).  Besides the
+ *    file geometry and the current write position, it contains the
+ *    table of namespaces (see below).
+ *
+ * 2. The index, i.e. an array of spill_slot_t.  It is direct-mapped,
+ *    i.e. every key hash maps to exactly one slot and newer entries
+ *    simply replace older ones.
+ *
+ * 3. The data area.  It is used as a ring buffer of records.  Each one
+ *    consists of a record_header_t, the full key and the serialized item.
+ *    Positions are counted from the creation of the file and never wrap,
+ *    so it is easy to tell whether a record has been overwritten yet.
+ *    Records never span the end of the data area.
+ *
+ * Header and index are being kept in memory and get written back to disk
+ * from time to time.  Index slots may therefore refer to records that
+ * have been overwritten after the last index update.  But because every
+ * record carries its full key and a checksum, such stale slots will be
+ * detected upon lookup.  Removals, however, are written through to disk
+ * immediately since they invalidate data that is not stale for the file.
+ *
+ * Only keys whose cache prefix starts with a registered namespace get
+ * spilled.  For each namespace, the youngest revision that has been
+ * reported for it is stored with an epoch number.  If a later process
+ * reports a lower youngest revision, e.g. because the repository got
+ * replaced with an older backup, the epoch gets incremented and all
+ * records from the previous epoch become invalid.
+ *
+ * All data is stored in native byte order. The spill file is not meant
+ * to be moved to other machines.
+ *
+ * A spill file must not be used by more than one process at a time.
+ * Processes that find a spill file locked will try PATH.1, PATH.2 etc.
+ */
+
+/* Identifies spill files and their format.  Must fit into MAGIC.
+ */
+#define SPILL_MAGIC "SVN membuffer spill file, v1\n"
+
+/* Bytes reserved for the header.  Must be >= sizeof(spill_header_t).
+ */
+#define SPILL_HEADER_SIZE 0x1000
+
+/* Maximum number of namespaces that can be persisted in one file.
+ */
+#define SPILL_NAMESPACE_COUNT 64
+
+/* Number of data bytes per index slot.  Smaller values waste index space
+ * while larger ones lower the number of items that can be stored.
+ */
+#define SPILL_BYTES_PER_SLOT 0x400
+
+/* Records start at multiples of this within the data area.
+ */
+#define SPILL_ALIGNMENT 16
+
+/* Number of alternative file names to try if the given one is in use.
+ */
+#define SPILL_MAX_FILES 16
+
+/* Smallest spill file size that we support.
+ */
+#define SPILL_MIN_SIZE 0x100000
+
+/* Write the index back to disk after appending this many bytes ...
+ */
+#define SPILL_FLUSH_BYTES 0x1000000
+
+/* ... or after this many microseconds, whichever comes first.
+ */
+#define SPILL_FLUSH_INTERVAL apr_time_from_sec(10)
+
+/* Round VALUE up to the next multiple of SPILL_ALIGNMENT.
+ */
+#define ALIGN_RECORD(value) \
+  (((value) + SPILL_ALIGNMENT - 1) & ~(apr_uint64_t)(SPILL_ALIGNMENT - 1))
+
+/* Persistent information on a namespace.
+ */
+typedef struct spill_namespace_t
+{
+  /* Hash value of the namespace string.  0 for unused entries. */
+  apr_uint64_t hash;
+
+  /* Youngest revision reported for this namespace. */
+  apr_int64_t youngest;
+
+  /* Records written under a different epoch are invalid. */
+  apr_uint64_t epoch;
+} spill_namespace_t;
+
+/* The spill file header.
+ */
+typedef struct spill_header_t
+{
+  /* Contains SPILL_MAGIC, padded with NULs. */
+  char magic[32];
+
+  /* Total size of the file. */
+  apr_uint64_t file_size;
+
+  /* Number of index slots. */
+  apr_uint64_t slot_count;
+
+  /* Position behind the latest record. */
+  apr_uint64_t position;
+
+  /* Namespace table. */
+  spill_namespace_t namespaces[SPILL_NAMESPACE_COUNT];
+} spill_header_t;
+
+/* An index slot.
+ */
+typedef struct spill_slot_t
+{
+  /* Hash value of the full key of the item stored. */
+  apr_uint64_t key_hash;
+
+  /* Position of the record within the data area plus 1.
+   * 0 for empty slots. */
+  apr_uint64_t position;
+} spill_slot_t;
+
+/* Header of a data record.  It is followed by KEY_LEN bytes of key and
+ * DATA_LEN bytes of serialized item data.
+ */
+typedef struct record_header_t
+{
+  /* Hash value of the key that follows. */
+  apr_uint64_t key_hash;
+
+  /* Hash value of the namespace that the key belongs to. */
+  apr_uint64_t namespace_hash;
+
+  /* Epoch of that namespace when the record was written. */
+  apr_uint64_t epoch;
+
+  /* Number of key bytes following this header. */
+  apr_uint32_t key_len;
+
+  /* Number of data bytes following the key. */
+  apr_uint32_t data_len;
+
+  /* Cache priority of the item. */
+  apr_uint32_t priority;
+
+  /* FNV-1a checksum over the key and data. */
+  apr_uint32_t checksum;
+} record_header_t;
+
+/* A namespace that has been registered by this process.
+ */
+typedef struct registered_namespace_t
+{
+  /* The namespace string and its length. */
+  const char *name;
+  apr_size_t len;
+
+  /* Index of the persistent info in the namespace table. */
+  int index;
+} registered_namespace_t;
+
+struct svn_cache__spill_t
+{
+  /* The spill file.  Locked exclusively by this process. */
+  apr_file_t *file;
+
+  /* Current file pointer position, -1 if unknown. */
+  apr_off_t file_pos;
+
+  /* In-memory copy of the file header. */
+  spill_header_t header;
+
+  /* In-memory copy of the index, HEADER.SLOT_COUNT entries. */
+  spill_slot_t *slots;
+
+  /* File offset and size of the data area. */
+  apr_uint64_t data_start;
+  apr_uint64_t data_size;
+
+  /* Larger records won't be written. */
+  apr_uint64_t max_record_size;
+
+  /* Namespaces registered by this process (registered_namespace_t). */
+  apr_array_header_t *name_spaces;
+
+  /* Buffer used to construct full keys. */
+  svn_membuf_t key;
+
+  /* Buffer used to construct and to read records. */
+  svn_membuf_t record;
+
+  /* Number of bytes added since the index had been written to disk. */
+  apr_uint64_t unflushed;
+
+  /* Time of the last index write. */
+  apr_time_t last_flush;
+
+  /* If set, an I/O error had occurred and this file must not be used
+   * anymore. */
+  svn_boolean_t failed;
+
+  /* Serializes all access to this structure. */
+  svn_mutex__t *mutex;
+
+  /* For all long-lived allocations. */
+  apr_pool_t *pool;
+
+  /* For temporary allocations.  Cleared after every operation. */
+  apr_pool_t *scratch_pool;
+};
+
+/* Return a non-zero hash value for the LEN bytes in DATA.
+ */
+static apr_uint64_t
+hash_bytes(const void *data,
+           apr_size_t len)
+{
+  apr_uint32_t hashes[4];
+  apr_uint64_t result;
+
+  svn__fnv1a_32x4_raw(hashes, data, len);
+  result = ((apr_uint64_t)hashes[0] << 32) | hashes[1];
+
+  return result ? result : 1;
+}
+
+/* Construct the full key from PREFIX and the KEY_LEN bytes in KEY in
+ * SPILL->KEY and return its length.  If PREFIX is not NULL, KEY is the
+ * compact form of a key within that prefix.  Otherwise, KEY is the full
+ * key already.  In any case, the result starts with the cache prefix.
+ */
+static apr_size_t
+make_key(svn_cache__spill_t *spill,
+         const char *prefix,
+         const void *key,
+         apr_size_t key_len)
+{
+  apr_size_t prefix_len = prefix ? strlen(prefix) + 1 : 0;
+  apr_size_t len = prefix_len + key_len + 1;
+  char *data;
+
+  svn_membuf__ensure(&spill->key, len);
+  data = spill->key.data;
+
+  if (prefix)
+    memcpy(data, prefix, prefix_len);
+  memcpy(data + prefix_len, key, key_len);
+
+  /* The compact and the full-key form must never produce the same key. */
+  data[len - 1] = prefix ? 'P' : 'F';
+
+  return len;
+}
+
+/* Return the registered namespace that the full key of KEY_LEN bytes in
+ * SPILL->KEY belongs to.  NULL if there is none.
+ */
+static const registered_namespace_t *
+find_namespace(svn_cache__spill_t *spill,
+               apr_size_t key_len)
+{
+  int i;
+  for (i = 0; i < spill->name_spaces->nelts; ++i)
+    {
+      const registered_namespace_t *name_space
+        = &APR_ARRAY_IDX(spill->name_spaces, i, registered_namespace_t);
+
+      if (   name_space->len < key_len
+          && memcmp(spill->key.data, name_space->name, name_space->len) == 0)
+        return name_space;
+    }
+
+  return NULL;
+}
+
+/* Return TRUE if records written for NAMESPACE_HASH under EPOCH are still
+ * valid in SPILL.  The namespace must have been registered by this
+ * process.
+ */
+static svn_boolean_t
+is_valid_epoch(svn_cache__spill_t *spill,
+               apr_uint64_t namespace_hash,
+               apr_uint64_t epoch)
+{
+  int i;
+  for (i = 0; i < spill->name_spaces->nelts; ++i)
+    {
+      const registered_namespace_t *name_space
+        = &APR_ARRAY_IDX(spill->name_spaces, i, registered_namespace_t);
+      const spill_namespace_t *info
+        = &spill->header.namespaces[name_space->index];
+
+      if (info->hash == namespace_hash)
+        return info->epoch == epoch;
+    }
+
+  return FALSE;
+}
+
+/* Write LEN bytes from DATA to SPILL's file at OFFSET.
+ */
+static svn_error_t *
+write_at(svn_cache__spill_t *spill,
+         apr_uint64_t offset,
+         const void *data,
+         apr_size_t len)
+{
+  if (spill->file_pos != (apr_off_t)offset)
+    {
+      apr_off_t pos = (apr_off_t)offset;
+
+      spill->file_pos = -1;
+      SVN_ERR(svn_io_file_seek(spill->file, APR_SET, &pos,
+                               spill->scratch_pool));
+    }
+
+  spill->file_pos = -1;
+  SVN_ERR(svn_io_file_write_full(spill->file, data, len, NULL,
+                                 spill->scratch_pool));
+  spill->file_pos = (apr_off_t)(offset + len);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read LEN bytes from SPILL's file at OFFSET into DATA.  Set *READ to
+ * TRUE if all of them could be read and to FALSE if we hit EOF.
+ */
+static svn_error_t *
+read_at(svn_boolean_t *read,
+        svn_cache__spill_t *spill,
+        apr_uint64_t offset,
+        void *data,
+        apr_size_t len)
+{
+  apr_off_t pos = (apr_off_t)offset;
+  apr_size_t bytes_read;
+  svn_boolean_t eof;
+
+  spill->file_pos = -1;
+  SVN_ERR(svn_io_file_seek(spill->file, APR_SET, &pos, spill->scratch_pool));
+  SVN_ERR(svn_io_file_read_full2(spill->file, data, len, &bytes_read, &eof,
+                                 spill->scratch_pool));
+  spill->file_pos = (apr_off_t)(offset + bytes_read);
+  *read = bytes_read == len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the header of SPILL back to disk.
+ */
+static svn_error_t *
+write_header(svn_cache__spill_t *spill)
+{
+  return svn_error_trace(write_at(spill, 0, &spill->header,
+                                  sizeof(spill->header)));
+}
+
+/* Write the header and the index of SPILL back to disk.
+ */
+static svn_error_t *
+write_index(svn_cache__spill_t *spill)
+{
+  SVN_ERR(write_header(spill));
+  SVN_ERR(write_at(spill, SPILL_HEADER_SIZE, spill->slots,
+                   (apr_size_t)spill->header.slot_count
+                     * sizeof(*spill->slots)));
+  SVN_ERR(svn_io_file_flush(spill->file, spill->scratch_pool));
+
+  spill->unflushed = 0;
+  spill->last_flush = apr_time_now();
+
+  return SVN_NO_ERROR;
+}
+
+/* Reset SPILL to an empty state, both in memory and on disk.
+ */
+static svn_error_t *
+reset_file(svn_cache__spill_t *spill)
+{
+  apr_uint64_t slot_count = spill->header.slot_count;
+  apr_uint64_t file_size = spill->header.file_size;
+
+  memset(&spill->header, 0, sizeof(spill->header));
+  memcpy(spill->header.magic, SPILL_MAGIC, sizeof(SPILL_MAGIC));
+  spill->header.file_size = file_size;
+  spill->header.slot_count = slot_count;
+  spill->header.position = 0;
+
+  memset(spill->slots, 0, (apr_size_t)slot_count * sizeof(*spill->slots));
+
+  /* Drop all old contents. */
+  spill->file_pos = -1;
+  SVN_ERR(svn_io_file_trunc(spill->file, 0, spill->scratch_pool));
+  SVN_ERR(svn_io_file_trunc(spill->file, (apr_off_t)file_size,
+                            spill->scratch_pool));
+
+  return svn_error_trace(write_index(spill));
+}
+
+/* Open the file at PATH and try to lock it exclusively.  Set *FILE to the
+ * file handle upon success and to NULL if the file is locked by someone
+ * else already.  Allocate *FILE in POOL.
+ */
+static svn_error_t *
+open_and_lock(apr_file_t **file,
+              const char *path,
+              apr_pool_t *pool)
+{
+  svn_error_t *err;
+
+  SVN_ERR(svn_io_file_open(file, path,
+                           APR_READ | APR_WRITE | APR_CREATE | APR_BUFFERED
+                           | APR_BINARY,
+                           APR_OS_DEFAULT, pool));
+
+  err = svn_io_lock_open_file(*file, TRUE, TRUE, pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      SVN_ERR(svn_io_file_close(*file, pool));
+      *file = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Pool cleanup function writing the index of the svn_cache__spill_t in
+ * BATON back to disk before the file gets closed.  Errors are ignored
+ * because the index will be validated upon every lookup anyway.
+ */
+static apr_status_t
+flush_on_cleanup(void *baton)
+{
+  svn_cache__spill_t *spill = baton;
+
+  if (!spill->failed && spill->unflushed)
+    svn_error_clear(write_index(spill));
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+svn_cache__spill_open(svn_cache__spill_t **spill_p,
+                      const char *path,
+                      apr_uint64_t size,
+                      apr_pool_t *result_pool)
+{
+  svn_cache__spill_t *spill;
+  apr_uint64_t slot_count;
+  apr_uint64_t data_start;
+  apr_file_t *file = NULL;
+  svn_boolean_t read;
+  int i;
+
+  /* Determine the file geometry. */
+  if (size < SPILL_MIN_SIZE)
+    size = SPILL_MIN_SIZE;
+
+  slot_count = size / SPILL_BYTES_PER_SLOT;
+  data_start = SPILL_HEADER_SIZE + slot_count * sizeof(spill_slot_t);
+  data_start = (data_start + SPILL_HEADER_SIZE - 1)
+             & ~(apr_uint64_t)(SPILL_HEADER_SIZE - 1);
+
+  if (   slot_count * sizeof(spill_slot_t) > APR_SIZE_MAX
+      || size > APR_INT64_MAX)
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             _("Cache spill file size %s is too large"),
+                             apr_psprintf(result_pool,
+                                          "%" APR_UINT64_T_FMT, size));
+
+  /* Find a spill file that is not being used by another process. */
+  for (i = 0; i < SPILL_MAX_FILES && file == NULL; ++i)
+    SVN_ERR(open_and_lock(&file,
+                          i ? apr_psprintf(result_pool, "%s.%d", path, i)
+                            : path,
+                          result_pool));
+
+  if (file == NULL)
+    return svn_error_createf(SVN_ERR_BAD_FILENAME, NULL,
+                             _("All cache spill files '%s*' are in use"),
+                             svn_dirent_local_style(path, result_pool));
+
+  /* Construct the spill object. */
+  spill = apr_pcalloc(result_pool, sizeof(*spill));
+  spill->file = file;
+  spill->file_pos = -1;
+  spill->data_start = data_start;
+  spill->data_size = size - data_start;
+  spill->max_record_size = MIN(spill->data_size / 8, APR_UINT32_MAX);
+  spill->name_spaces = apr_array_make(result_pool, 4,
+                                      sizeof(registered_namespace_t));
+  spill->slots = apr_pcalloc(result_pool,
+                             (apr_size_t)slot_count * sizeof(*spill->slots));
+  spill->pool = result_pool;
+  spill->scratch_pool = svn_pool_create(result_pool);
+  svn_membuf__create(&spill->key, 256, result_pool);
+  svn_membuf__create(&spill->record, 0x1000, result_pool);
+  SVN_ERR(svn_mutex__init(&spill->mutex, TRUE, result_pool));
+
+  /* Use the existing contents, if they are compatible. */
+  SVN_ERR(read_at(&read, spill, 0, &spill->header, sizeof(spill->header)));
+  if (   read
+      && memcmp(spill->header.magic, SPILL_MAGIC, sizeof(SPILL_MAGIC)) == 0
+      && spill->header.file_size == size
+      && spill->header.slot_count == slot_count)
+    SVN_ERR(read_at(&read, spill, SPILL_HEADER_SIZE, spill->slots,
+                    (apr_size_t)slot_count * sizeof(*spill->slots)));
+  else
+    read = FALSE;
+
+  if (!read)
+    {
+      spill->header.file_size = size;
+      spill->header.slot_count = slot_count;
+      SVN_ERR(reset_file(spill));
+    }
+
+  svn_pool_clear(spill->scratch_pool);
+  spill->last_flush = apr_time_now();
+
+  /* Pre-cleanups run before the scratch pool and the file get closed. */
+  apr_pool_pre_cleanup_register(result_pool, spill, flush_on_cleanup);
+  *spill_p = spill;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__spill_namespace.  The caller must serialize
+ * access to SPILL.
+ */
+static svn_error_t *
+spill_namespace(svn_cache__spill_t *spill,
+                const char *name_space,
+                svn_revnum_t youngest)
+{
+  registered_namespace_t *registered;
+  spill_namespace_t *info = NULL;
+  apr_uint64_t hash = hash_bytes(name_space, strlen(name_space));
+  int i;
+
+  /* Find the persistent namespace info or create it. */
+  for (i = 0; i < SPILL_NAMESPACE_COUNT; ++i)
+    if (spill->header.namespaces[i].hash == hash)
+      {
+        info = &spill->header.namespaces[i];
+        break;
+      }
+
+  if (info == NULL)
+    for (i = 0; i < SPILL_NAMESPACE_COUNT; ++i)
+      if (spill->header.namespaces[i].hash == 0)
+        {
+          info = &spill->header.namespaces[i];
+          info->hash = hash;
+          info->youngest = youngest;
+          info->epoch = 1;
+          SVN_ERR(write_header(spill));
+          break;
+        }
+
+  /* Table full?  Then, we simply won't spill this namespace. */
+  if (info == NULL)
+    return SVN_NO_ERROR;
+
+  /* If the repository went back in time, the old records are void.
+   * Make that persistent before writing new records. */
+  if (info->youngest != youngest)
+    {
+      if (youngest < info->youngest)
+        ++info->epoch;
+
+      info->youngest = youngest;
+      SVN_ERR(write_header(spill));
+      SVN_ERR(svn_io_file_flush(spill->file, spill->scratch_pool));
+    }
+
+  /* Already registered? */
+  for (i = 0; i < spill->name_spaces->nelts; ++i)
+    if (strcmp(APR_ARRAY_IDX(spill->name_spaces, i,
+                             registered_namespace_t).name, name_space) == 0)
+      return SVN_NO_ERROR;
+
+  registered = apr_array_push(spill->name_spaces);
+  registered->name = apr_pstrdup(spill->pool, name_space);
+  registered->len = strlen(name_space);
+  registered->index = (int)(info - spill->header.namespaces);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__spill_write.  The caller must serialize access
+ * to SPILL.
+ */
+static svn_error_t *
+spill_write(svn_cache__spill_t *spill,
+            const char *prefix,
+            const void *key,
+            apr_size_t key_len,
+            const void *data,
+            apr_size_t data_len,
+            apr_uint32_t priority)
+{
+  const registered_namespace_t *name_space;
+  record_header_t *record;
+  spill_slot_t *slot;
+  apr_size_t full_key_len;
+  apr_uint64_t record_size;
+  apr_uint64_t position;
+  apr_uint64_t ring_offset;
+
+  /* Only keys from registered namespaces may be written. */
+  full_key_len = make_key(spill, prefix, key, key_len);
+  name_space = find_namespace(spill, full_key_len);
+  if (name_space == NULL)
+    return SVN_NO_ERROR;
+
+  record_size = sizeof(*record) + (apr_uint64_t)full_key_len + data_len;
+  if (record_size > spill->max_record_size)
+    return SVN_NO_ERROR;
+
+  /* Construct the record. */
+  svn_membuf__ensure(&spill->record, (apr_size_t)record_size);
+  record = spill->record.data;
+  memcpy(record + 1, spill->key.data, full_key_len);
+  memcpy((char *)(record + 1) + full_key_len, data, data_len);
+
+  record->key_hash = hash_bytes(spill->key.data, full_key_len);
+  record->namespace_hash = spill->header.namespaces[name_space->index].hash;
+  record->epoch = spill->header.namespaces[name_space->index].epoch;
+  record->key_len = (apr_uint32_t)full_key_len;
+  record->data_len = (apr_uint32_t)data_len;
+  record->priority = priority;
+  record->checksum = svn__fnv1a_32(record + 1, full_key_len + data_len);
+
+  /* Records must not span the end of the data area. */
+  position = spill->header.position;
+  ring_offset = position % spill->data_size;
+  if (ring_offset + record_size > spill->data_size)
+    {
+      position += spill->data_size - ring_offset;
+      ring_offset = 0;
+    }
+
+  /* Write it and update the index.  The record only becomes visible
+   * once it has been written successfully. */
+  SVN_ERR(write_at(spill, spill->data_start + ring_offset, record,
+                   (apr_size_t)record_size));
+
+  slot = &spill->slots[record->key_hash % spill->header.slot_count];
+  slot->key_hash = record->key_hash;
+  slot->position = position + 1;
+
+  spill->header.position = position + ALIGN_RECORD(record_size);
+  spill->unflushed += ALIGN_RECORD(record_size);
+
+  if (   spill->unflushed >= SPILL_FLUSH_BYTES
+      || apr_time_now() - spill->last_flush >= SPILL_FLUSH_INTERVAL)
+    SVN_ERR(write_index(spill));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__spill_read.  The caller must serialize access
+ * to SPILL.
+ */
+static svn_error_t *
+spill_read(void **data,
+           apr_size_t *data_len,
+           apr_uint32_t *priority,
+           svn_cache__spill_t *spill,
+           const char *prefix,
+           const void *key,
+           apr_size_t key_len,
+           apr_pool_t *result_pool)
+{
+  record_header_t header;
+  const spill_slot_t *slot;
+  apr_size_t full_key_len;
+  apr_uint64_t key_hash;
+  apr_uint64_t position;
+  apr_uint64_t ring_offset;
+  apr_uint64_t record_size;
+  const char *record_data;
+  svn_boolean_t read;
+
+  /* Look the key up in the index. */
+  full_key_len = make_key(spill, prefix, key, key_len);
+  key_hash = hash_bytes(spill->key.data, full_key_len);
+  slot = &spill->slots[key_hash % spill->header.slot_count];
+  if (slot->position == 0 || slot->key_hash != key_hash)
+    return SVN_NO_ERROR;
+
+  /* Has the record been overwritten already? */
+  position = slot->position - 1;
+  if (position + spill->data_size < spill->header.position)
+    return SVN_NO_ERROR;
+
+  /* Read and verify the record header. */
+  ring_offset = position % spill->data_size;
+  if (ring_offset + sizeof(header) > spill->data_size)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(read_at(&read, spill, spill->data_start + ring_offset, &header,
+                  sizeof(header)));
+  if (   !read
+      || header.key_hash != key_hash
+      || header.key_len != full_key_len
+      || !is_valid_epoch(spill, header.namespace_hash, header.epoch))
+    return SVN_NO_ERROR;
+
+  record_size = sizeof(header) + (apr_uint64_t)header.key_len
+              + header.data_len;
+  if (   ring_offset + record_size > spill->data_size
+      || position + record_size > spill->header.position)
+    return SVN_NO_ERROR;
+
+  /* Read and verify key and data. */
+  svn_membuf__ensure(&spill->record, (apr_size_t)record_size);
+  record_data = spill->record.data;
+  SVN_ERR(read_at(&read, spill,
+                  spill->data_start + ring_offset + sizeof(header),
+                  spill->record.data,
+                  (apr_size_t)(record_size - sizeof(header))));
+  if (   !read
+      || memcmp(record_data, spill->key.data, full_key_len) != 0
+      || svn__fnv1a_32(record_data, full_key_len + header.data_len)
+           != header.checksum)
+    return SVN_NO_ERROR;
+
+  /* Found it. */
+  *data = apr_pmemdup(result_pool, record_data + full_key_len,
+                      header.data_len);
+  *data_len = header.data_len;
+  *priority = header.priority;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implement svn_cache__spill_remove.  The caller must serialize access
+ * to SPILL.
+ */
+static svn_error_t *
+spill_remove(svn_cache__spill_t *spill,
+             const char *prefix,
+             const void *key,
+             apr_size_t key_len)
+{
+  apr_size_t full_key_len = make_key(spill, prefix, key, key_len);
+  apr_uint64_t key_hash = hash_bytes(spill->key.data, full_key_len);
+  apr_uint64_t index = key_hash % spill->header.slot_count;
+  spill_slot_t *slot = &spill->slots[index];
+
+  if (slot->position == 0 || slot->key_hash != key_hash)
+    return SVN_NO_ERROR;
+
+  /* Make the removal persistent right away. */
+  slot->key_hash = 0;
+  slot->position = 0;
+
+  return svn_error_trace(write_at(spill,
+                                  SPILL_HEADER_SIZE + index * sizeof(*slot),
+                                  slot, sizeof(*slot)));
+}
+
+/* Post-process the result ERR of an operation on SPILL.  I/O errors
+ * disable SPILL for good.  Clears the scratch pool.  All callers must
+ * serialize access to SPILL.
+ */
+static svn_error_t *
+finish_operation(svn_cache__spill_t *spill,
+                 svn_error_t *err)
+{
+  if (err)
+    spill->failed = TRUE;
+
+  svn_pool_clear(spill->scratch_pool);
+
+  return svn_error_trace(err);
+}
+
+svn_error_t *
+svn_cache__spill_namespace(svn_cache__spill_t *spill,
+                           const char *name_space,
+                           svn_revnum_t youngest)
+{
+  SVN_MUTEX__WITH_LOCK(spill->mutex,
+                       spill->failed
+                         ? SVN_NO_ERROR
+                         : finish_operation(spill,
+                                            spill_namespace(spill,
+                                                            name_space,
+                                                            youngest)));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__spill_write(svn_cache__spill_t *spill,
+                       const char *prefix,
+                       const void *key,
+                       apr_size_t key_len,
+                       const void *data,
+                       apr_size_t data_len,
+                       apr_uint32_t priority)
+{
+  /* Don't bother constructing keys if nothing will be written anyway. */
+  if (spill->name_spaces->nelts == 0)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(spill->mutex,
+                       spill->failed
+                         ? SVN_NO_ERROR
+                         : finish_operation(spill,
+                                            spill_write(spill, prefix,
+                                                        key, key_len,
+                                                        data, data_len,
+                                                        priority)));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__spill_read(void **data,
+                      apr_size_t *data_len,
+                      apr_uint32_t *priority,
+                      svn_cache__spill_t *spill,
+                      const char *prefix,
+                      const void *key,
+                      apr_size_t key_len,
+                      apr_pool_t *result_pool)
+{
+  *data = NULL;
+  *data_len = 0;
+  *priority = 0;
+
+  if (spill->name_spaces->nelts == 0)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(spill->mutex,
+                       spill->failed
+                         ? SVN_NO_ERROR
+                         : finish_operation(spill,
+                                            spill_read(data, data_len,
+                                                       priority, spill,
+                                                       prefix, key, key_len,
+                                                       result_pool)));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__spill_remove(svn_cache__spill_t *spill,
+                        const char *prefix,
+                        const void *key,
+                        apr_size_t key_len)
+{
+  if (spill->name_spaces->nelts == 0)
+    return SVN_NO_ERROR;
+
+  SVN_MUTEX__WITH_LOCK(spill->mutex,
+                       spill->failed
+                         ? SVN_NO_ERROR
+                         : finish_operation(spill,
+                                            spill_remove(spill, prefix,
+                                                         key, key_len)));
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,274 @@
+/*
+ * cache-tiered.c: two-level caching object for Subversion
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_pools.h"
+
+#include "svn_private_config.h"
+#include "cache.h"
+
+/* A note on thread safety:
+
+   This object itself never changes after construction.  Hence, it is
+   as thread-safe as the two caches it combines.
+*/
+
+/* The (internal) cache object. */
+typedef struct tiered_cache_t {
+  /* The fast, typically in-process cache.  It is looked up first. */
+  svn_cache__t *l1;
+
+  /* The slow, typically shared cache.  Hits will be copied to L1. */
+  svn_cache__t *l2;
+} tiered_cache_t;
+
+
+/* Copy VALUE found under KEY in the second level of CACHE to its first
+ * level.  Use a temporary sub-pool of POOL for allocations.
+ */
+static svn_error_t *
+promote(tiered_cache_t *cache,
+        const void *key,
+        void *value,
+        apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create(pool);
+  SVN_ERR(svn_cache__set(cache->l1, key, value, subpool));
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_get(void **value_p,
+                 svn_boolean_t *found,
+                 void *cache_void,
+                 const void *key,
+                 apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__get(value_p, found, cache->l1, key, result_pool));
+  if (*found)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cache__get(value_p, found, cache->l2, key, result_pool));
+  if (*found)
+    SVN_ERR(promote(cache, key, *value_p, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_has_key(svn_boolean_t *found,
+                     void *cache_void,
+                     const void *key,
+                     apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__has_key(found, cache->l1, key, scratch_pool));
+  if (!*found)
+    SVN_ERR(svn_cache__has_key(found, cache->l2, key, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_set(void *cache_void,
+                 const void *key,
+                 void *value,
+                 apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__set(cache->l1, key, value, scratch_pool));
+  SVN_ERR(svn_cache__set(cache->l2, key, value, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_iter(svn_boolean_t *completed,
+                  void *cache_void,
+                  svn_iter_apr_hash_cb_t user_cb,
+                  void *user_baton,
+                  apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  /* The second level is usually not iterable and would also report
+   * most keys a second time. */
+  return svn_cache__iter(completed, cache->l1, user_cb, user_baton,
+                         scratch_pool);
+}
+
+static svn_boolean_t
+tiered_cache_is_cachable(void *cache_void,
+                         apr_size_t size)
+{
+  tiered_cache_t *cache = cache_void;
+
+  /* Items too large for L1 may still be worth keeping in L2. */
+  return svn_cache__is_cachable(cache->l1, size)
+      || svn_cache__is_cachable(cache->l2, size);
+}
+
+static svn_error_t *
+tiered_cache_get_partial(void **value_p,
+                         svn_boolean_t *found,
+                         void *cache_void,
+                         const void *key,
+                         svn_cache__partial_getter_func_t func,
+                         void *baton,
+                         apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  /* We don't get the full item from L2 here and can't promote it. */
+  SVN_ERR(svn_cache__get_partial(value_p, found, cache->l1, key, func,
+                                 baton, result_pool));
+  if (!*found)
+    SVN_ERR(svn_cache__get_partial(value_p, found, cache->l2, key, func,
+                                   baton, result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_set_partial(void *cache_void,
+                         const void *key,
+                         svn_cache__partial_setter_func_t func,
+                         void *baton,
+                         apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  SVN_ERR(svn_cache__set_partial(cache->l1, key, func, baton,
+                                 scratch_pool));
+  SVN_ERR(svn_cache__set_partial(cache->l2, key, func, baton,
+                                 scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+tiered_cache_get_info(void *cache_void,
+                      svn_cache__info_t *info,
+                      svn_boolean_t reset,
+                      apr_pool_t *result_pool)
+{
+  tiered_cache_t *cache = cache_void;
+
+  /* Only L1 uses local memory.  The access counters have already been
+   * filled in from our own front-end. */
+  return (cache->l1->vtable->get_info)(cache->l1->cache_internal,
+                                       info, reset, result_pool);
+}
+
+static svn_error_t *
+tiered_cache_get_many(void **values,
+                      svn_boolean_t *found,
+                      void *cache_void,
+                      const void *const *keys,
+                      int count,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
+{
+  tiered_cache_t *cache = cache_void;
+  const void **missing_keys;
+  void **missing_values;
+  svn_boolean_t *missing_found;
+  int *missing_idx;
+  int missing_count = 0;
+  int i;
+
+  SVN_ERR(svn_cache__get_many(values, found, cache->l1, keys, count,
+                              result_pool, scratch_pool));
+
+  /* Ask L2 for all L1 misses in one go. */
+  missing_keys = apr_palloc(scratch_pool, count * sizeof(*missing_keys));
+  missing_idx = apr_palloc(scratch_pool, count * sizeof(*missing_idx));
+  for (i = 0; i < count; ++i)
+    if (!found[i] && keys[i])
+      {
+        missing_keys[missing_count] = keys[i];
+        missing_idx[missing_count] = i;
+        ++missing_count;
+      }
+
+  if (missing_count == 0)
+    return SVN_NO_ERROR;
+
+  missing_values = apr_palloc(scratch_pool,
+                              missing_count * sizeof(*missing_values));
+  missing_found = apr_palloc(scratch_pool,
+                             missing_count * sizeof(*missing_found));
+  SVN_ERR(svn_cache__get_many(missing_values, missing_found, cache->l2,
+                              missing_keys, missing_count, result_pool,
+                              scratch_pool));
+
+  for (i = 0; i < missing_count; ++i)
+    if (missing_found[i])
+      {
+        values[missing_idx[i]] = missing_values[i];
+        found[missing_idx[i]] = TRUE;
+        SVN_ERR(promote(cache, missing_keys[i], missing_values[i],
+                        scratch_pool));
+      }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_cache__vtable_t tiered_cache_vtable = {
+  tiered_cache_get,
+  tiered_cache_has_key,
+  tiered_cache_set,
+  tiered_cache_iter,
+  tiered_cache_is_cachable,
+  tiered_cache_get_partial,
+  tiered_cache_set_partial,
+  tiered_cache_get_info,
+  tiered_cache_get_many
+};
+
+svn_error_t *
+svn_cache__create_tiered(svn_cache__t **cache_p,
+                         svn_cache__t *l1,
+                         svn_cache__t *l2,
+                         apr_pool_t *result_pool)
+{
+  svn_cache__t *wrapper = apr_pcalloc(result_pool, sizeof(*wrapper));
+  tiered_cache_t *cache = apr_pcalloc(result_pool, sizeof(*cache));
+
+  cache->l1 = l1;
+  cache->l2 = l2;
+
+  wrapper->vtable = &tiered_cache_vtable;
+  wrapper->cache_internal = cache;
+  wrapper->error_handler = 0;
+  wrapper->error_baton = 0;
+  wrapper->pretend_empty = !!getenv("SVN_X_DOES_NOT_MARK_THE_SPOT");
+
+  *cache_p = wrapper;
+  return SVN_NO_ERROR;
+}
@@ -95,6 +95,74 @@ svn_cache__get(void **value_p,
   return err;
 }
 
+/* Implement svn_cache__get_many() for caches that don't support batched
+ * lookups, i.e. call the GET function of CACHE for all COUNT KEYS. */
+static svn_error_t *
+get_many_one_by_one(void **values,
+                    svn_boolean_t *found,
+                    svn_cache__t *cache,
+                    const void *const *keys,
+                    int count,
+                    apr_pool_t *result_pool)
+{
+  int i;
+  for (i = 0; i < count; ++i)
+    SVN_ERR((cache->vtable->get)(&values[i],
+                                 &found[i],
+                                 cache->cache_internal,
+                                 keys[i],
+                                 result_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_cache__get_many(void **values,
+                    svn_boolean_t *found,
+                    svn_cache__t *cache,
+                    const void *const *keys,
+                    int count,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  svn_error_t *err;
+  int i;
+
+  /* In case any errors happen and are quelched, make sure we start
+     out with all FOUND set to false. */
+  for (i = 0; i < count; ++i)
+    {
+      values[i] = NULL;
+      found[i] = FALSE;
+    }
+
+#ifdef SVN_DEBUG
+  if (cache->pretend_empty)
+    return SVN_NO_ERROR;
+#endif
+
+  cache->reads += count;
+  if (cache->vtable->get_many)
+    err = (cache->vtable->get_many)(values,
+                                    found,
+                                    cache->cache_internal,
+                                    keys,
+                                    count,
+                                    result_pool,
+                                    scratch_pool);
+  else
+    err = get_many_one_by_one(values, found, cache, keys, count,
+                              result_pool);
+
+  err = handle_error(cache, err, scratch_pool);
+
+  for (i = 0; i < count; ++i)
+    if (found[i])
+      cache->hits++;
+
+  return err;
+}
+
 svn_error_t *
 svn_cache__has_key(svn_boolean_t *found,
                    svn_cache__t *cache,
@@ -296,6 +364,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             "sets    : %" APR_UINT64_T_FMT
                             " (%5.2f%% of misses)\n"
                             "failures: %" APR_UINT64_T_FMT "\n"
+                            "evicted : %" APR_UINT64_T_FMT "\n"
                             "used    : %" APR_UINT64_T_FMT " MB (%5.2f%%)"
                             " of %" APR_UINT64_T_FMT " MB data cache"
                             " / %" APR_UINT64_T_FMT " MB total cache memory\n"
@@ -308,6 +377,7 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             info->hits, hit_rate,
                             info->sets, write_rate,
                             info->failures,
+                            info->evictions,
 
                             info->used_size / _1MB, data_usage_rate,
                             info->data_size / _1MB,
@@ -317,3 +387,33 @@ svn_cache__format_info(const svn_cache__info_t *info,
                             info->total_entries,
                             histogram);
 }
+
+svn_string_t *
+svn_cache__format_prefix_info(const apr_array_header_t *infos,
+                              apr_pool_t *result_pool)
+{
+  svn_stringbuf_t *text
+    = svn_stringbuf_create("        gets   hit rate        sets   evictions"
+                           "     entries     KB used  prefix\n",
+                           result_pool);
+  int i;
+
+  for (i = 0; i < infos->nelts; ++i)
+    {
+      const svn_cache__info_t *info
+        = APR_ARRAY_IDX(infos, i, const svn_cache__info_t *);
+      double hit_rate = (100.0 * (double)info->hits)
+                      / (double)(info->gets ? info->gets : 1);
+
+      svn_stringbuf_appendcstr(text,
+          apr_psprintf(result_pool,
+                       "%12" APR_UINT64_T_FMT " %9.2f%% %11" APR_UINT64_T_FMT
+                       " %11" APR_UINT64_T_FMT " %11" APR_UINT64_T_FMT
+                       " %11" APR_UINT64_T_FMT "  %s\n",
+                       info->gets, hit_rate, info->sets, info->evictions,
+                       info->used_entries, info->used_size / 1024,
+                       info->id));
+    }
+
+  return svn_string_create_from_buf(text, result_pool);
+}
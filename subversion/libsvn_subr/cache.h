@@ -82,6 +82,16 @@ typedef struct svn_cache__vtable_t {
                            svn_cache__info_t *info,
                            svn_boolean_t reset,
                            apr_pool_t *result_pool);
+
+  /* See svn_cache__get_many().  May be NULL, in which case the keys
+   * will be looked up one-by-one using GET. */
+  svn_error_t *(*get_many)(void **values,
+                           svn_boolean_t *found,
+                           void *cache_implementation,
+                           const void *const *keys,
+                           int count,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool);
 } svn_cache__vtable_t;
 
 struct svn_cache__t {
@@ -111,6 +121,69 @@ struct svn_cache__t {
   svn_boolean_t pretend_empty;
 };
 
+/* On-disk second-level storage for items evicted from membuffer caches.
+ * See cache-spill.c for details. */
+typedef struct svn_cache__spill_t svn_cache__spill_t;
+
+/* Open or create a spill file of SIZE bytes at PATH and return it in
+ * *SPILL.  If PATH is being used by another process, PATH.1, PATH.2 etc.
+ * will be tried.  Incompatible existing files get reinitialized.  The
+ * result may be used by multiple threads and is allocated in RESULT_POOL.
+ */
+svn_error_t *
+svn_cache__spill_open(svn_cache__spill_t **spill,
+                      const char *path,
+                      apr_uint64_t size,
+                      apr_pool_t *result_pool);
+
+/* Allow SPILL to store keys whose cache prefix starts with NAME_SPACE.
+ * YOUNGEST is the current youngest revision of the repository that the
+ * namespace refers to.  If it is lower than what an earlier process
+ * reported, all data previously stored for NAME_SPACE becomes invalid.
+ */
+svn_error_t *
+svn_cache__spill_namespace(svn_cache__spill_t *spill,
+                           const char *name_space,
+                           svn_revnum_t youngest);
+
+/* Store the DATA_LEN bytes of serialized DATA with cache PRIORITY under
+ * the key of KEY_LEN bytes in KEY in SPILL.  If PREFIX is not NULL, KEY
+ * is relative to that cache prefix.  Otherwise, it is the full key.
+ * Keys outside the registered namespaces will be ignored.
+ */
+svn_error_t *
+svn_cache__spill_write(svn_cache__spill_t *spill,
+                       const char *prefix,
+                       const void *key,
+                       apr_size_t key_len,
+                       const void *data,
+                       apr_size_t data_len,
+                       apr_uint32_t priority);
+
+/* Look up PREFIX, KEY and KEY_LEN as in svn_cache__spill_write in SPILL.
+ * If found, set *DATA, *DATA_LEN and *PRIORITY to the item's data
+ * allocated in RESULT_POOL, its length and its cache priority.
+ * Otherwise, set *DATA to NULL.
+ */
+svn_error_t *
+svn_cache__spill_read(void **data,
+                      apr_size_t *data_len,
+                      apr_uint32_t *priority,
+                      svn_cache__spill_t *spill,
+                      const char *prefix,
+                      const void *key,
+                      apr_size_t key_len,
+                      apr_pool_t *result_pool);
+
+/* Remove the item identified by PREFIX, KEY and KEY_LEN as in
+ * svn_cache__spill_write from SPILL.
+ */
+svn_error_t *
+svn_cache__spill_remove(svn_cache__spill_t *spill,
+                        const char *prefix,
+                        const void *key,
+                        apr_size_t key_len);
+
 
 #ifdef __cplusplus
 }
@@ -64,6 +64,26 @@ static svn_cache_config_t cache_settings =
 #endif
 };
 
+/* Whether to put the global membuffer cache into shared memory.
+ */
+static svn_boolean_t cache_shared = FALSE;
+
+/* Spill file to attach to the global membuffer cache and its size.
+ * No spill file will be used if CACHE_SPILL_PATH is NULL.
+ */
+static const char *cache_spill_path = NULL;
+static apr_uint64_t cache_spill_size = 0;
+
+/* Memory placement hints for the global membuffer cache.
+ */
+static svn_boolean_t cache_huge_pages = FALSE;
+static svn_boolean_t cache_numa_interleave = FALSE;
+
+/* Eviction policy to use for the global membuffer cache.
+ */
+static svn_cache__membuffer_policy_t cache_policy
+  = svn_cache__membuffer_policy_priority;
+
 /* Get the current FSFS cache configuration. */
 const svn_cache_config_t *
 svn_cache_config_get(void)
@@ -120,14 +140,36 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
         return SVN_NO_ERROR;
       apr_allocator_owner_set(allocator, pool);
 
-      err = svn_cache__membuffer_cache_create(
-          &cache,
-          (apr_size_t)cache_size,
-          (apr_size_t)(cache_size / 5),
-          0,
-          ! svn_cache_config_get()->single_threaded,
-          FALSE,
-          pool);
+      /* Try to share the cache between processes but fall back to a
+       * private one because sharing requires platform support.
+       */
+      if (cache_shared)
+        {
+          err = svn_cache__membuffer_cache_create_shared(
+              &cache,
+              (apr_size_t)cache_size,
+              (apr_size_t)(cache_size / 5),
+              0,
+              FALSE,
+              pool);
+          if (err)
+            {
+              svn_error_clear(err);
+              svn_pool_clear(pool);
+              cache = NULL;
+            }
+        }
+
+      err = cache
+          ? SVN_NO_ERROR
+          : svn_cache__membuffer_cache_create(
+                &cache,
+                (apr_size_t)cache_size,
+                (apr_size_t)(cache_size / 5),
+                0,
+                ! svn_cache_config_get()->single_threaded,
+                FALSE,
+                pool);
 
       /* Some error occurred. Most likely it's an OOM error but we don't
        * really care. Simply release all cache memory and disable caching
@@ -143,6 +185,25 @@ initialize_cache(void *baton, apr_pool_t *unused_pool)
           return svn_error_trace(err);
         }
 
+      /* The memory must not have been touched before applying these.
+       * They are mere hints, so we don't care whether they have effect. */
+      svn_error_clear(svn_cache__membuffer_set_memory_hints(
+                          cache, cache_huge_pages, cache_numa_interleave));
+
+      /* Not being able to use the requested policy is no reason to run
+       * without cache. */
+      if (cache_policy != svn_cache__membuffer_policy_priority)
+        svn_error_clear(svn_cache__membuffer_set_policy(cache, cache_policy,
+                                                        pool));
+
+      /* The spill file is optional.  Without it, we simply lose evicted
+       * entries as usual. */
+      if (cache_spill_path)
+        svn_error_clear(svn_cache__membuffer_set_spill_file(cache,
+                                                            cache_spill_path,
+                                                            cache_spill_size,
+                                                            pool));
+
       /* done */
       *cache_p = cache;
     }
@@ -173,6 +234,34 @@ svn_cache__get_global_membuffer_cache(void)
   return cache;
 }
 
+void
+svn_cache__set_global_membuffer_shared(svn_boolean_t shared)
+{
+  cache_shared = shared;
+}
+
+void
+svn_cache__set_global_membuffer_spill_file(const char *path,
+                                           apr_uint64_t size)
+{
+  cache_spill_path = path;
+  cache_spill_size = size;
+}
+
+void
+svn_cache__set_global_membuffer_memory_hints(svn_boolean_t huge_pages,
+                                             svn_boolean_t numa_interleave)
+{
+  cache_huge_pages = huge_pages;
+  cache_numa_interleave = numa_interleave;
+}
+
+void
+svn_cache__set_global_membuffer_policy(svn_cache__membuffer_policy_t policy)
+{
+  cache_policy = policy;
+}
+
 void
 svn_cache_config_set(const svn_cache_config_t *settings)
 {
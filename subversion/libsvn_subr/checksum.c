@@ -35,6 +35,7 @@
 
 #include "checksum.h"
 #include "fnv1a.h"
+#include "sha1.h"
 
 #include "private/svn_subr_private.h"
 
@@ -475,7 +476,7 @@ svn_checksum(svn_checksum_t **checksum,
              apr_size_t len,
              apr_pool_t *pool)
 {
-  apr_sha1_ctx_t sha1_ctx;
+  svn_sha1__context_t sha1_ctx;
 
   SVN_ERR(validate_kind(kind));
   *checksum = svn_checksum_create(kind, pool);
@@ -487,9 +488,9 @@ svn_checksum(svn_checksum_t **checksum,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_init(&sha1_ctx);
-        apr_sha1_update(&sha1_ctx, data, (unsigned int)len);
-        apr_sha1_final((unsigned char *)(*checksum)->digest, &sha1_ctx);
+        svn_sha1__init(&sha1_ctx);
+        svn_sha1__update(&sha1_ctx, data, len);
+        svn_sha1__final((unsigned char *)(*checksum)->digest, &sha1_ctx);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -550,8 +551,8 @@ svn_checksum_ctx_create(svn_checksum_kind_t kind,
         break;
 
       case svn_checksum_sha1:
-        ctx->apr_ctx = apr_palloc(pool, sizeof(apr_sha1_ctx_t));
-        apr_sha1_init(ctx->apr_ctx);
+        ctx->apr_ctx = apr_palloc(pool, sizeof(svn_sha1__context_t));
+        svn_sha1__init(ctx->apr_ctx);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -581,7 +582,7 @@ svn_checksum_update(svn_checksum_ctx_t *ctx,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_update(ctx->apr_ctx, data, (unsigned int)len);
+        svn_sha1__update(ctx->apr_ctx, data, len);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -600,6 +601,32 @@ svn_checksum_update(svn_checksum_ctx_t *ctx,
   return SVN_NO_ERROR;
 }
 
+/* svn_checksum__update_both feeds the data into both contexts in pieces
+ * of this size.  They are small enough to stay in the L1 cache. */
+#define UPDATE_BOTH_PIECE_SIZE 0x1000
+
+svn_error_t *
+svn_checksum__update_both(svn_checksum_ctx_t *ctx1,
+                          svn_checksum_ctx_t *ctx2,
+                          const void *data,
+                          apr_size_t len)
+{
+  const char *piece = data;
+
+  while (len > 0)
+    {
+      apr_size_t piece_len = MIN(len, UPDATE_BOTH_PIECE_SIZE);
+
+      SVN_ERR(svn_checksum_update(ctx1, piece, piece_len));
+      SVN_ERR(svn_checksum_update(ctx2, piece, piece_len));
+
+      piece += piece_len;
+      len -= piece_len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_checksum_final(svn_checksum_t **checksum,
                    const svn_checksum_ctx_t *ctx,
@@ -614,7 +641,7 @@ svn_checksum_final(svn_checksum_t **checksum,
         break;
 
       case svn_checksum_sha1:
-        apr_sha1_final((unsigned char *)(*checksum)->digest, ctx->apr_ctx);
+        svn_sha1__final((unsigned char *)(*checksum)->digest, ctx->apr_ctx);
         break;
 
       case svn_checksum_fnv1a_32:
@@ -26,11 +26,18 @@
 #include <assert.h>
 #include <zlib.h>
 
+#include "private/svn_dep_compat.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_error_private.h"
 
 #include "svn_private_config.h"
 
+#if defined(SVN__HAVE_SSE2)
+#include <emmintrin.h>
+#elif defined(SVN__HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 const char *
 svn_zlib__compiled_version(void)
 {
@@ -138,6 +145,114 @@ svn__decode_int(apr_int64_t *val,
   return result;
 }
 
+/* Number of bytes that single_byte_values() checks at once.  0, if there
+ * is no efficient way to do that on this platform.
+ */
+#if defined(SVN__HAVE_SSE2) || defined(SVN__HAVE_NEON)
+#  define DECODE_BLOCK_SIZE 16
+#elif SVN_UNALIGNED_ACCESS_IS_OK
+#  define DECODE_BLOCK_SIZE 8
+#else
+#  define DECODE_BLOCK_SIZE 0
+#endif
+
+#if DECODE_BLOCK_SIZE
+/* Return TRUE if the DECODE_BLOCK_SIZE bytes at P are all complete
+ * 7b/8b encoded integers, i.e. none of them has its MSB set.
+ */
+static APR_INLINE svn_boolean_t
+single_byte_values(const unsigned char *p)
+{
+#if defined(SVN__HAVE_SSE2)
+  return _mm_movemask_epi8(_mm_loadu_si128((const __m128i *)p)) == 0;
+#elif defined(SVN__HAVE_NEON)
+  return vmaxvq_u8(vld1q_u8(p)) < 0x80;
+#else
+  return (*(const apr_uint64_t *)p & APR_UINT64_C(0x8080808080808080)) == 0;
+#endif
+}
+#endif
+
+/* Decode one low-order first 7b/8b integer from [P..END-1] into *VALUE
+ * and return a pointer to the byte after it.  Return NULL if the integer
+ * is incomplete or too long.
+ */
+static APR_INLINE const unsigned char *
+decode_uint_le(apr_uint64_t *value,
+               const unsigned char *p,
+               const unsigned char *end)
+{
+  const unsigned char *last = p;
+  apr_uint64_t temp = 0;
+  apr_size_t len;
+
+  if (end - p > SVN__MAX_ENCODED_UINT_LEN)
+    end = p + SVN__MAX_ENCODED_UINT_LEN;
+
+  while (last < end && *last >= 0x80)
+    ++last;
+
+  if (last == end)
+    return NULL;
+
+  /* Assemble the data bits, high-order first. */
+  for (len = last - p + 1; len > 0; --len)
+    temp = (temp << 7) | (p[len - 1] & 0x7f);
+
+  *value = temp;
+  return last + 1;
+}
+
+const unsigned char *
+svn__decode_uints(apr_uint64_t *values,
+                  apr_size_t *ends,
+                  apr_size_t *count,
+                  const unsigned char *p,
+                  const unsigned char *end)
+{
+  const unsigned char *start = p;
+  apr_size_t capacity = *count;
+  apr_size_t i = 0;
+
+  while (i < capacity && p < end)
+    {
+      const unsigned char *next;
+
+#if DECODE_BLOCK_SIZE
+      /* Small numbers are very common, e.g. in deltified streams. */
+      if (   capacity - i >= DECODE_BLOCK_SIZE
+          && end - p >= DECODE_BLOCK_SIZE
+          && single_byte_values(p))
+        {
+          apr_size_t k;
+          for (k = 0; k < DECODE_BLOCK_SIZE; ++k)
+            values[i + k] = p[k];
+
+          if (ends)
+            for (k = 0; k < DECODE_BLOCK_SIZE; ++k)
+              ends[i + k] = (p - start) + k + 1;
+
+          i += DECODE_BLOCK_SIZE;
+          p += DECODE_BLOCK_SIZE;
+          continue;
+        }
+#endif
+
+      next = decode_uint_le(&values[i], p, end);
+      if (next == NULL)
+        break;
+
+      p = next;
+      if (ends)
+        ends[i] = p - start;
+
+      ++i;
+    }
+
+  *count = i;
+  return p;
+}
+
 /* If IN is a string that is >= MIN_COMPRESS_SIZE and the COMPRESSION_LEVEL
    is not SVN_DELTA_COMPRESSION_LEVEL_NONE, zlib compress it and places the
    result in OUT, with an integer prepended specifying the original size.
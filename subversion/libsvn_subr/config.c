@@ -286,6 +286,58 @@ read_all(svn_config_t **cfgp,
 }
 
 
+/* Like read_all() without registry paths, but use the snapshot file at
+   SNAPSHOT_PATH instead of parsing SYS_FILE_PATH and USR_FILE_PATH if
+   neither of them changed since the snapshot was written.  Otherwise,
+   read the files and try to write a new snapshot.
+
+   Snapshots are an optimization only.  Any problem with them makes us
+   fall back to reading the config files. */
+static svn_error_t *
+read_all_cached(svn_config_t **cfgp,
+                const char *snapshot_path,
+                const char *sys_file_path,
+                const char *usr_file_path,
+                apr_pool_t *pool)
+{
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  apr_array_header_t *sources = apr_array_make(scratch_pool, 2,
+                                               sizeof(const char *));
+  const char *key;
+  svn_error_t *err;
+
+  *cfgp = NULL;
+
+  if (sys_file_path)
+    APR_ARRAY_PUSH(sources, const char *) = sys_file_path;
+  APR_ARRAY_PUSH(sources, const char *) = usr_file_path;
+
+  err = svn_config__snapshot_key(&key, sources, scratch_pool, scratch_pool);
+  if (! err && key)
+    err = svn_config__read_snapshot(cfgp, snapshot_path, key, pool,
+                                    scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      key = NULL;
+      *cfgp = NULL;
+    }
+
+  if (! *cfgp)
+    {
+      SVN_ERR(read_all(cfgp, NULL, NULL, sys_file_path, usr_file_path,
+                       pool));
+
+      /* This fails e.g. if the user config dir does not exist. */
+      if (key)
+        svn_error_clear(svn_config__write_snapshot(snapshot_path, key, *cfgp,
+                                                   scratch_pool));
+    }
+
+  svn_pool_destroy(scratch_pool);
+  return SVN_NO_ERROR;
+}
+
 /* CONFIG_DIR provides an override for the default behavior of reading
    the default set of overlay files described by read_all()'s doc
    string.  Returns non-NULL *CFG or an error. */
@@ -324,6 +376,18 @@ get_category_config(svn_config_t **cfg,
 
   SVN_ERR(svn_config_get_user_config_path(&usr_cfg_path, config_dir, category,
                                           pool));
+
+  /* Registry contents can't be checked for modifications cheaply. */
+  if (usr_cfg_path && ! sys_reg_path && ! usr_reg_path)
+    {
+      const char *snapshot_path
+        = apr_pstrcat(pool, usr_cfg_path, SVN_CONFIG__SNAPSHOT_SUFFIX,
+                      SVN_VA_NULL);
+
+      return read_all_cached(cfg, snapshot_path, sys_cfg_path, usr_cfg_path,
+                             pool);
+    }
+
   return read_all(cfg, sys_reg_path, usr_reg_path,
                   sys_cfg_path, usr_cfg_path, pool);
 }
@@ -422,6 +486,37 @@ svn_config_merge(svn_config_t *cfg, const char *file,
   return SVN_NO_ERROR;
 }
 
+/* Baton for raw_callback. */
+typedef struct raw_baton_t
+{
+  svn_config__raw_option_fn_t callback;
+  void *baton;
+} raw_baton_t;
+
+static svn_boolean_t
+raw_callback(void *baton, cfg_section_t *section, cfg_option_t *option)
+{
+  raw_baton_t *b = baton;
+
+  if (option->value)
+    b->callback(b->baton, section->name, option->name, option->value);
+
+  return FALSE;
+}
+
+void
+svn_config__enumerate_raw(svn_config_t *cfg,
+                          svn_config__raw_option_fn_t callback,
+                          void *baton,
+                          apr_pool_t *scratch_pool)
+{
+  raw_baton_t b;
+
+  b.callback = callback;
+  b.baton = baton;
+  for_each_option(cfg, &b, scratch_pool, raw_callback);
+}
+
 
 
 /* Remove variable expansions from CFG.  Walk through the options tree,
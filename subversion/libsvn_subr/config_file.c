@@ -23,8 +23,11 @@
 
 
 
+#include <string.h>
+
 #include <apr_lib.h>
 #include <apr_env.h>
+#include <apr_strings.h>
 #include <apr_tables.h>
 
 #include "config_impl.h"
@@ -754,6 +757,162 @@ svn_config__parse_file(svn_config_t *cfg, const char *file,
   return err;
 }
 
+
+/*** Config snapshots ***/
+
+/* First line of every snapshot file.  Bump the number whenever the
+   format changes. */
+#define SNAPSHOT_MAGIC "SVN-CONFIG-SNAPSHOT 1\n"
+
+/* Sources modified less than this many microseconds ago don't get a key.
+   Some filesystems store modification times with a granularity of a
+   second or more and a change made during that window would go unnoticed
+   if it does not change the file size. */
+#define SNAPSHOT_MIN_AGE apr_time_from_sec(2)
+
+svn_error_t *
+svn_config__snapshot_key(const char **key,
+                         const apr_array_header_t *sources,
+                         apr_pool_t *result_pool,
+                         apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buf = svn_stringbuf_create(SNAPSHOT_MAGIC, result_pool);
+  apr_time_t cutoff = apr_time_now() - SNAPSHOT_MIN_AGE;
+  int i;
+
+  for (i = 0; i < sources->nelts; ++i)
+    {
+      const char *path = APR_ARRAY_IDX(sources, i, const char *);
+      apr_finfo_t finfo;
+      svn_error_t *err;
+
+      err = svn_io_stat(&finfo, path, APR_FINFO_MTIME | APR_FINFO_SIZE,
+                        scratch_pool);
+      if (err && (APR_STATUS_IS_ENOENT(err->apr_err)
+                  || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+        {
+          /* A missing file is a valid state, too.  Should it show up
+             later, the key will be different. */
+          svn_error_clear(err);
+          finfo.mtime = 0;
+          finfo.size = -1;
+        }
+      else if (err)
+        return svn_error_trace(err);
+      else if (finfo.mtime > cutoff)
+        {
+          *key = NULL;
+          return SVN_NO_ERROR;
+        }
+
+      svn_stringbuf_appendcstr(buf,
+                               apr_psprintf(scratch_pool,
+                                            "%" APR_TIME_T_FMT
+                                            " %" APR_OFF_T_FMT
+                                            " %" APR_SIZE_T_FMT " %s\n",
+                                            finfo.mtime, finfo.size,
+                                            strlen(path), path));
+    }
+
+  /* Terminate the key with an empty line. */
+  svn_stringbuf_appendbyte(buf, '\n');
+  *key = buf->data;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_config__read_snapshot(svn_config_t **cfgp,
+                          const char *path,
+                          const char *key,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *contents;
+  apr_size_t key_len = strlen(key);
+  svn_config_t *cfg;
+  const char *p, *end;
+  svn_error_t *err;
+
+  *cfgp = NULL;
+
+  err = svn_stringbuf_from_file2(&contents, path, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  else
+    SVN_ERR(err);
+
+  /* Written for a different state of the sources? */
+  if (contents->len < key_len || memcmp(contents->data, key, key_len))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_config_create2(&cfg, FALSE, FALSE, result_pool));
+
+  /* The remainder is a sequence of NUL-terminated section name, option
+     name and value triplets.  STRINGBUF guarantees a terminating NUL
+     after the last byte, so we only need to check that each string ends
+     within the data. */
+  p = contents->data + key_len;
+  end = contents->data + contents->len;
+  while (p < end)
+    {
+      const char *section = p;
+      const char *option;
+      const char *value;
+
+      option = section + strlen(section) + 1;
+      if (option >= end)
+        return SVN_NO_ERROR;
+
+      value = option + strlen(option) + 1;
+      if (value >= end)
+        return SVN_NO_ERROR;
+
+      p = value + strlen(value) + 1;
+      if (p > end)
+        return SVN_NO_ERROR;
+
+      svn_config_set(cfg, section, option, value);
+    }
+
+  *cfgp = cfg;
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_config__raw_option_fn_t, appending the record for
+   SECTION, OPTION and VALUE to the svn_stringbuf_t in BATON. */
+static void
+add_snapshot_record(void *baton,
+                    const char *section,
+                    const char *option,
+                    const char *value)
+{
+  svn_stringbuf_t *buf = baton;
+
+  svn_stringbuf_appendbytes(buf, section, strlen(section) + 1);
+  svn_stringbuf_appendbytes(buf, option, strlen(option) + 1);
+  svn_stringbuf_appendbytes(buf, value, strlen(value) + 1);
+}
+
+svn_error_t *
+svn_config__write_snapshot(const char *path,
+                           const char *key,
+                           svn_config_t *cfg,
+                           apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buf = svn_stringbuf_create(key, scratch_pool);
+
+  svn_config__enumerate_raw(cfg, add_snapshot_record, buf, scratch_pool);
+
+  /* Concurrent writers will race but each of them produces a complete,
+     valid file. */
+  return svn_error_trace(svn_io_write_atomic2(path, buf->data, buf->len,
+                                              NULL, FALSE, scratch_pool));
+}
+
 svn_error_t *
 svn_config__parse_stream(svn_stream_t *stream,
                          svn_config__constructor_t *constructor,
@@ -1150,9 +1309,20 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "###   http-compression           Whether to compress HTTP requests" NL
         "###   http-max-connections       Maximum number of parallel server" NL
         "###                              connections to use for any given"  NL
-        "###                              HTTP operation."                   NL
+        "###                              HTTP operation (at most 64).  More"NL
+        "###                              connections get opened as long as" NL
+        "###                              they increase the throughput."     NL
         "###   http-chunked-requests      Whether to use chunked transfer"   NL
         "###                              encoding for HTTP requests body."  NL
+        "###   http-http2                 Whether to offer HTTP/2 to HTTPS"  NL
+        "###                              servers.  HTTP/2 multiplexes all"  NL
+        "###                              requests over a single connection."NL
+        "###   http-metadata-cache-ttl    Number of seconds to remember"     NL
+        "###                              repository root, UUID and baseline"NL
+        "###                              info on disk (0 = don't cache)."   NL
+        "###   http-content-cache-size    Megabytes of file contents to"     NL
+        "###                              share between working copies on"  NL
+        "###                              disk (0 = don't cache)."           NL
         "###   ssl-authority-files        List of files, each of a trusted CA"
                                                                              NL
         "###   ssl-trust-default-ca       Trust the system 'default' CAs"    NL
@@ -1166,6 +1336,10 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "###   http-bulk-updates          Whether to request bulk update"    NL
         "###                              responses or to fetch each file"   NL
         "###                              in an individual request. "        NL
+        "###   trace-file                 File to append the timing of"      NL
+        "###                              requests to.  Servers that support"NL
+        "###                              it record their part under the"    NL
+        "###                              same request ID."                  NL
         "###   store-passwords            Specifies whether passwords used"  NL
         "###                              to authenticate against a"         NL
         "###                              Subversion server may be cached"   NL
@@ -1511,6 +1685,17 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### to show meaningful differences for binary file formats.  [New"  NL
         "### in 1.9]"                                                        NL
         "# diff-ignore-content-type = no"                                    NL
+        "### Set parallel-diff-fetches to the number of connections used to" NL
+        "### fetch file contents when comparing two repository trees with"   NL
+        "### 'svn diff'.  Using more than one requires credentials to be"    NL
+        "### cached, as there can't be any prompting."                       NL
+        "# parallel-diff-fetches = 1"                                        NL
+        "### Set log-cache-ttl to the number of seconds the results of"      NL
+        "### 'svn log' queries for fixed revision ranges may be answered"    NL
+        "### from a cache on disk, rather than by the server.  Changes of"   NL
+        "### revision properties, e.g. of log messages, may go unnoticed"    NL
+        "### for that long.  By default, nothing is cached."                 NL
+        "# log-cache-ttl = 0"                                                NL
         ""                                                                   NL
         "### Section for configuring automatic properties."                  NL
         "[auto-props]"                                                       NL
@@ -1552,6 +1737,44 @@ svn_config_ensure(const char *config_dir, apr_pool_t *pool)
         "### returning an error.  The default is 10000, i.e. 10 seconds."    NL
         "### Longer values may be useful when exclusive locking is enabled." NL
         "# busy-timeout = 10000"                                             NL
+        "### Set to true to store new pristine copies of files (the text"    NL
+        "### bases in the .svn directory) LZ4 compressed.  This reduces the" NL
+        "### disk space used by working copies.  Pristines stored before"    NL
+        "### remain readable either way."                                    NL
+        "# compress-pristines = false"                                       NL
+        "### Set to the path of a directory to share pristine copies of"     NL
+        "### files between all working copies on the same file system."     NL
+        "### Working copies then hard link pristines that others already"   NL
+        "### have instead of storing them again, and checkouts take such"   NL
+        "### files from there instead of downloading them."                 NL
+        "# shared-pristine-store = /var/cache/svn-pristine"                 NL
+        "### Set to the number of directory externals to fetch at the same"  NL
+        "### time during checkouts, updates and switches.  Fetching more"    NL
+        "### than one requires credentials to be cached, as there can't be" NL
+        "### any prompting; conflicts in externals are postponed."          NL
+        "# parallel-externals = 1"                                           NL
+        "### Set to true to remember a fast hash of files found unmodified,"  NL
+        "### so that files whose timestamps changed but whose contents did"  NL
+        "### not are recognized without detranslating them again.  This"    NL
+        "### makes 'svn status' and similar commands write to the working"  NL
+        "### copy database."                                                NL
+        "# cache-text-hashes = false"                                        NL
+        "### Set to the number of working copy databases to keep open at"    NL
+        "### most.  Long-running programs that access many working copies"  NL
+        "### close the least recently used ones beyond that.  The default,"  NL
+        "### 0, keeps all of them open."                                     NL
+        "# max-open-working-copies = 0"                                      NL
+        "### Set to the size in KiB of the page cache of each working copy"  NL
+        "### database.  The default, 0, uses SQLite's default size."        NL
+        "# sqlite-cache-size = 0"                                            NL
+        "### Set to 'local-disk' to open working copy databases with a"      NL
+        "### write-ahead log, memory mapping and a larger page cache."       NL
+        "### This speeds up large working copies considerably but must"      NL
+        "### only be used if all of them are on local disks.  Once a"        NL
+        "### working copy uses a write-ahead log, it keeps doing so even"    NL
+        "### when opened with the default profile.  By default, working"     NL
+        "### copy databases use a rollback journal."                         NL
+        "# sqlite-profile = default"                                         NL
         ;
 
       err = svn_io_file_open(&f, path,
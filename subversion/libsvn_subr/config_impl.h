@@ -88,6 +88,55 @@ svn_error_t *svn_config__parse_file(svn_config_t *cfg,
                                     svn_boolean_t must_exist,
                                     apr_pool_t *pool);
 
+/* Callback for svn_config__enumerate_raw, called with BATON for every
+   OPTION in SECTION.  VALUE is never NULL and has not been expanded. */
+typedef void (*svn_config__raw_option_fn_t)(void *baton,
+                                            const char *section,
+                                            const char *option,
+                                            const char *value);
+
+/* Call CALLBACK with BATON for every option in CFG that has a value.
+   Use SCRATCH_POOL for temporary allocations. */
+void svn_config__enumerate_raw(svn_config_t *cfg,
+                               svn_config__raw_option_fn_t callback,
+                               void *baton,
+                               apr_pool_t *scratch_pool);
+
+/* Snapshots cache the result of parsing and merging a set of config files
+   so that later reads of the same, unchanged files can skip the parser.
+   A snapshot file starts with a key that records the modification time
+   and size of every source file, followed by the section name, option
+   name and unexpanded value of each option as NUL-terminated strings. */
+
+/* Set *KEY to the snapshot key for the current state of SOURCES, an array
+   of const char * file paths, allocated in RESULT_POOL.  Set *KEY to NULL
+   if a source has been modified so recently that further modifications
+   might not be detectable.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *svn_config__snapshot_key(const char **key,
+                                      const apr_array_header_t *sources,
+                                      apr_pool_t *result_pool,
+                                      apr_pool_t *scratch_pool);
+
+/* If the snapshot file PATH exists and has been written for KEY, set *CFGP
+   to a new case-insensitive config in RESULT_POOL holding its options.
+   Otherwise, set *CFGP to NULL.  Use SCRATCH_POOL for temporary
+   allocations. */
+svn_error_t *svn_config__read_snapshot(svn_config_t **cfgp,
+                                       const char *path,
+                                       const char *key,
+                                       apr_pool_t *result_pool,
+                                       apr_pool_t *scratch_pool);
+
+/* Atomically replace the snapshot file PATH with the options of CFG under
+   KEY.  Use SCRATCH_POOL for temporary allocations. */
+svn_error_t *svn_config__write_snapshot(const char *path,
+                                        const char *key,
+                                        svn_config_t *cfg,
+                                        apr_pool_t *scratch_pool);
+
+/* File name suffix of the snapshot files in the user config area. */
+#define SVN_CONFIG__SNAPSHOT_SUFFIX ".snapshot"
+
 /* The name of the magic [DEFAULT] section. */
 #define SVN_CONFIG__DEFAULT_SECTION "DEFAULT"
 
@@ -39,6 +39,13 @@
 #include "dirent_uri.h"
 #include "private/svn_fspath.h"
 #include "private/svn_cert.h"
+#include "private/svn_dep_compat.h"
+
+#if defined(SVN__HAVE_SSE2)
+#include <emmintrin.h>
+#elif defined(SVN__HAVE_NEON)
+#include <arm_neon.h>
+#endif
 
 /* The canonical empty path.  Can this be changed?  Well, change the empty
    test below and the path library will work, not so sure about the fs/wc
@@ -817,9 +824,11 @@ is_child(path_type_t type, const char *path1, const char *path2,
      if they should be parent/child or not. */
   /* Hmmm... aren't paths assumed to be canonical in this function?
    * How can "foo///bar" even happen if the paths are canonical? */
-  for (i = 0; path1[i] && path2[i]; i++)
-    if (path1[i] != path2[i])
-      return NULL;
+  /* PATH1 must be a prefix of PATH2.  If PATH2 is shorter, the
+     comparison fails at PATH2's terminating NUL. */
+  i = strlen(path1);
+  if (strncmp(path1, path2, i) != 0)
+    return NULL;
 
   /* FIXME: This comment does not really match
    * the checks made in the code it refers to: */
@@ -1649,13 +1658,26 @@ svn_uri_canonicalize(const char *uri, apr_pool_t *pool)
 const char *
 svn_relpath_canonicalize(const char *relpath, apr_pool_t *pool)
 {
+  /* Most callers pass paths that are canonical already.  Checking that
+     is much cheaper than rebuilding the path segment by segment. */
+  if (relpath_is_canonical(relpath))
+    return apr_pstrdup(pool, relpath);
+
   return canonicalize(type_relpath, relpath, pool);
 }
 
 const char *
 svn_dirent_canonicalize(const char *dirent, apr_pool_t *pool)
 {
-  const char *dst = canonicalize(type_dirent, dirent, pool);
+  const char *dst;
+
+#ifndef SVN_USE_DOS_PATHS
+  /* See svn_relpath_canonicalize(). */
+  if (svn_dirent_is_canonical(dirent, pool))
+    return apr_pstrdup(pool, dirent);
+#endif
+
+  dst = canonicalize(type_dirent, dirent, pool);
 
 #ifdef SVN_USE_DOS_PATHS
   /* Handle a specific case on Windows where path == "X:/". Here we have to
@@ -1715,12 +1737,72 @@ svn_dirent_is_canonical(const char *dirent, apr_pool_t *scratch_pool)
   return relpath_is_canonical(ptr);
 }
 
+/* Return TRUE if the LEN bytes at PTR contain an empty segment ("//")
+ * or a "." segment ("/./").
+ */
+static svn_boolean_t
+has_empty_or_dot_segment(const char *ptr, apr_size_t len)
+{
+  apr_size_t i = 0;
+
+#if defined(SVN__HAVE_SSE2)
+
+  /* Test 16 positions at once.  Each of them needs to see the two bytes
+   * following it, hence the overlapping loads. */
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i dot = _mm_set1_epi8('.');
+
+  for (; i + sizeof(__m128i) + 2 <= len; i += sizeof(__m128i))
+    {
+      __m128i c0 = _mm_loadu_si128((const __m128i *)(ptr + i));
+      __m128i c1 = _mm_loadu_si128((const __m128i *)(ptr + i + 1));
+      __m128i c2 = _mm_loadu_si128((const __m128i *)(ptr + i + 2));
+      __m128i next_is_slash = _mm_cmpeq_epi8(c1, slash);
+      __m128i next_is_dot_slash = _mm_and_si128(_mm_cmpeq_epi8(c1, dot),
+                                                _mm_cmpeq_epi8(c2, slash));
+      __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(c0, slash),
+                                  _mm_or_si128(next_is_slash,
+                                               next_is_dot_slash));
+      if (_mm_movemask_epi8(hit))
+        return TRUE;
+    }
+
+#elif defined(SVN__HAVE_NEON)
+
+  const uint8x16_t slash = vdupq_n_u8('/');
+  const uint8x16_t dot = vdupq_n_u8('.');
+
+  for (; i + sizeof(uint8x16_t) + 2 <= len; i += sizeof(uint8x16_t))
+    {
+      uint8x16_t c0 = vld1q_u8((const uint8_t *)(ptr + i));
+      uint8x16_t c1 = vld1q_u8((const uint8_t *)(ptr + i + 1));
+      uint8x16_t c2 = vld1q_u8((const uint8_t *)(ptr + i + 2));
+      uint8x16_t next_is_slash = vceqq_u8(c1, slash);
+      uint8x16_t next_is_dot_slash = vandq_u8(vceqq_u8(c1, dot),
+                                              vceqq_u8(c2, slash));
+      uint8x16_t hit = vandq_u8(vceqq_u8(c0, slash),
+                                vorrq_u8(next_is_slash, next_is_dot_slash));
+      if (vmaxvq_u8(hit))
+        return TRUE;
+    }
+
+#endif
+
+  /* The remaining positions will be examined the naive way: */
+  for (; i + 1 < len; ++i)
+    if (ptr[i] == '/'
+        && (ptr[i + 1] == '/'
+            || (ptr[i + 1] == '.' && i + 2 < len && ptr[i + 2] == '/')))
+      return TRUE;
+
+  return FALSE;
+}
+
 static svn_boolean_t
 relpath_is_canonical(const char *relpath)
 {
-  const char *dot_pos, *ptr = relpath;
-  apr_size_t i, len;
-  unsigned pattern = 0;
+  const char *ptr = relpath;
+  apr_size_t len;
 
   /* RELPATH is canonical if it has:
    *  - no '.' segments
@@ -1744,25 +1826,10 @@ relpath_is_canonical(const char *relpath)
   if (ptr[len-1] == '/' || (ptr[len-1] == '.' && ptr[len-2] == '/'))
     return FALSE;
 
-  /* '.' are rare. So, search for them globally. There will often be no
-   * more than one hit.  Also note that we already checked for invalid
-   * starts and endings, i.e. we only need to check for "/./"
+  /* We already checked for invalid starts and endings, i.e. we only
+   * need to check for "//" and "/./" in the rest of the path.
    */
-  for (dot_pos = memchr(ptr, '.', len);
-       dot_pos;
-       dot_pos = strchr(dot_pos+1, '.'))
-    if (dot_pos > ptr && dot_pos[-1] == '/' && dot_pos[1] == '/')
-      return FALSE;
-
-  /* Now validate the rest of the path. */
-  for (i = 0; i < len - 1; ++i)
-    {
-      pattern = ((pattern & 0xff) << 8) + (unsigned char)ptr[i];
-      if (pattern == 0x101 * (unsigned char)('/'))
-        return FALSE;
-    }
-
-  return TRUE;
+  return ! has_empty_or_dot_segment(ptr, len);
 }
 
 svn_boolean_t
@@ -30,9 +30,46 @@
 #include "private/svn_eol_private.h"
 #include "private/svn_dep_compat.h"
 
+#if defined(SVN__HAVE_SSE2)
+#include <emmintrin.h>
+#elif defined(SVN__HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 char *
 svn_eol__find_eol_start(char *buf, apr_size_t len)
 {
+#if defined(SVN__HAVE_SSE2)
+
+  /* Scan the input 16 bytes at a time.  The code below will find the
+   * exact position within the block that stopped us. */
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+
+  for (; len >= sizeof(__m128i)
+       ; buf += sizeof(__m128i), len -= sizeof(__m128i))
+    {
+      __m128i chunk = _mm_loadu_si128((const __m128i *)buf);
+      if (_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, cr),
+                                         _mm_cmpeq_epi8(chunk, lf))))
+        break;
+    }
+
+#elif defined(SVN__HAVE_NEON)
+
+  const uint8x16_t cr = vdupq_n_u8('\r');
+  const uint8x16_t lf = vdupq_n_u8('\n');
+
+  for (; len >= sizeof(uint8x16_t)
+       ; buf += sizeof(uint8x16_t), len -= sizeof(uint8x16_t))
+    {
+      uint8x16_t chunk = vld1q_u8((const uint8_t *)buf);
+      if (vmaxvq_u8(vorrq_u8(vceqq_u8(chunk, cr), vceqq_u8(chunk, lf))))
+        break;
+    }
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Scan the input one machine word at a time. */
@@ -70,6 +107,74 @@ svn_eol__find_eol_start(char *buf, apr_size_t len)
   return NULL;
 }
 
+char *
+svn_eol__find_eol_or_keyword_start(char *buf, apr_size_t len)
+{
+#if defined(SVN__HAVE_SSE2)
+
+  const __m128i cr = _mm_set1_epi8('\r');
+  const __m128i lf = _mm_set1_epi8('\n');
+  const __m128i dollar = _mm_set1_epi8('$');
+
+  for (; len >= sizeof(__m128i)
+       ; buf += sizeof(__m128i), len -= sizeof(__m128i))
+    {
+      __m128i chunk = _mm_loadu_si128((const __m128i *)buf);
+      __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chunk, cr),
+                                   _mm_cmpeq_epi8(chunk, lf));
+      found = _mm_or_si128(found, _mm_cmpeq_epi8(chunk, dollar));
+      if (_mm_movemask_epi8(found))
+        break;
+    }
+
+#elif defined(SVN__HAVE_NEON)
+
+  const uint8x16_t cr = vdupq_n_u8('\r');
+  const uint8x16_t lf = vdupq_n_u8('\n');
+  const uint8x16_t dollar = vdupq_n_u8('$');
+
+  for (; len >= sizeof(uint8x16_t)
+       ; buf += sizeof(uint8x16_t), len -= sizeof(uint8x16_t))
+    {
+      uint8x16_t chunk = vld1q_u8((const uint8_t *)buf);
+      uint8x16_t found = vorrq_u8(vceqq_u8(chunk, cr), vceqq_u8(chunk, lf));
+      found = vorrq_u8(found, vceqq_u8(chunk, dollar));
+      if (vmaxvq_u8(found))
+        break;
+    }
+
+#endif
+
+#if SVN_UNALIGNED_ACCESS_IS_OK
+
+  /* Same as in svn_eol__find_eol_start, with a third test for '$'. */
+  for (; len > sizeof(apr_uintptr_t)
+       ; buf += sizeof(apr_uintptr_t), len -= sizeof(apr_uintptr_t))
+    {
+      apr_uintptr_t chunk = *(const apr_uintptr_t *)buf;
+      apr_uintptr_t r_test = chunk ^ SVN__R_MASK;
+      apr_uintptr_t n_test = chunk ^ SVN__N_MASK;
+      apr_uintptr_t d_test = chunk ^ SVN__DOLLAR_MASK;
+
+      r_test |= (r_test & SVN__LOWER_7BITS_SET) + SVN__LOWER_7BITS_SET;
+      n_test |= (n_test & SVN__LOWER_7BITS_SET) + SVN__LOWER_7BITS_SET;
+      d_test |= (d_test & SVN__LOWER_7BITS_SET) + SVN__LOWER_7BITS_SET;
+
+      if ((r_test & n_test & d_test & SVN__BIT_7_SET) != SVN__BIT_7_SET)
+        break;
+    }
+
+#endif
+
+  for (; len > 0; ++buf, --len)
+    {
+      if (*buf == '\n' || *buf == '\r' || *buf == '$')
+        return buf;
+    }
+
+  return NULL;
+}
+
 const char *
 svn_eol__detect_eol(char *buf, apr_size_t len, char **eolp)
 {
@@ -250,6 +250,114 @@ hash_read(apr_hash_t *hash, svn_stream_t *stream, const char *terminator,
   return SVN_NO_ERROR;
 }
 
+/* Return the line starting at offset *POS in DATA of length LEN as a
+   NUL-terminated string by replacing its newline with a NUL.  Set *EOF
+   if the line is not terminated by a newline.  Advance *POS to the start
+   of the next line.  DATA[LEN] must be NUL.  */
+static char *
+buffer_readline(apr_size_t *line_len,
+                svn_boolean_t *eof,
+                char *data,
+                apr_size_t len,
+                apr_size_t *pos)
+{
+  char *line = data + *pos;
+  char *eol = memchr(line, '\n', len - *pos);
+
+  *eof = (eol == NULL);
+  if (*eof)
+    {
+      *line_len = len - *pos;
+      *pos = len;
+    }
+  else
+    {
+      *eol = '\0';
+      *line_len = eol - line;
+      *pos += *line_len + 1;
+    }
+
+  return line;
+}
+
+svn_error_t *
+svn_hash__read_buffer(apr_hash_t *hash,
+                      char *data,
+                      apr_size_t len,
+                      const char *terminator,
+                      apr_pool_t *pool)
+{
+  apr_size_t pos = 0;
+
+  while (1)
+    {
+      apr_size_t line_len;
+      svn_boolean_t eof;
+      apr_uint64_t ui64;
+      svn_error_t *err;
+      char *key;
+      apr_size_t keylen;
+      svn_string_t *val;
+      char *line;
+
+      /* Read a key length line.  Might be END, though. */
+      line = buffer_readline(&line_len, &eof, data, len, &pos);
+
+      /* Check for the end of the hash. */
+      if ((!terminator && eof && line_len == 0)
+          || (terminator && (strcmp(line, terminator) == 0)))
+        return SVN_NO_ERROR;
+
+      /* Check for unexpected end of data */
+      if (eof)
+        return svn_error_create(SVN_ERR_MALFORMED_FILE, NULL,
+                                _("Serialized hash missing terminator"));
+
+      if ((line_len < 3) || (line[0] != 'K') || (line[1] != ' '))
+        return svn_error_create(SVN_ERR_MALFORMED_FILE, NULL,
+                                _("Serialized hash malformed"));
+
+      /* Get the length of the key */
+      err = svn_cstring_strtoui64(&ui64, line + 2, 0, APR_SIZE_MAX, 10);
+      if (err)
+        return svn_error_create(SVN_ERR_MALFORMED_FILE, err,
+                                _("Serialized hash malformed key length"));
+      keylen = (apr_size_t)ui64;
+
+      /* The key must be followed by a newline, which we replace by the
+         key's terminating NUL. */
+      if (keylen >= len - pos || data[pos + keylen] != '\n')
+        return svn_error_create(SVN_ERR_MALFORMED_FILE, NULL,
+                                _("Serialized hash malformed key data"));
+      key = data + pos;
+      key[keylen] = '\0';
+      pos += keylen + 1;
+
+      /* Read a val length line */
+      line = buffer_readline(&line_len, &eof, data, len, &pos);
+      if ((line[0] != 'V') || (line[1] != ' '))
+        return svn_error_create(SVN_ERR_MALFORMED_FILE, NULL,
+                                _("Serialized hash malformed"));
+
+      /* Get the length of the val */
+      err = svn_cstring_strtoui64(&ui64, line + 2, 0, APR_SIZE_MAX, 10);
+      if (err)
+        return svn_error_create(SVN_ERR_MALFORMED_FILE, err,
+                                _("Serialized hash malformed value length"));
+
+      val = apr_palloc(pool, sizeof(*val));
+      val->len = (apr_size_t)ui64;
+      if (val->len >= len - pos || data[pos + val->len] != '\n')
+        return svn_error_create(SVN_ERR_MALFORMED_FILE, NULL,
+                                _("Serialized hash malformed value data"));
+      val->data = data + pos;
+      data[pos + val->len] = '\0';
+      pos += val->len + 1;
+
+      apr_hash_set(hash, key, keylen, val);
+    }
+}
+
 
 /* Implements svn_hash_write2 and svn_hash_write_incremental. */
 static svn_error_t *
@@ -51,11 +51,27 @@
 #include <fcntl.h>
 #endif
 
+/* Linux and macOS can copy file contents without moving them through
+ * user space.  Copy-on-write file systems may even share the data blocks.
+ */
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/fs.h>
+#if defined(FICLONE) || defined(SYS_copy_file_range)
+#define SVN_IO_KERNEL_COPY 1
+#endif
+#elif defined(__APPLE__)
+#include <copyfile.h>
+#define SVN_IO_KERNEL_COPY 1
+#endif
+
 #include "svn_hash.h"
 #include "svn_types.h"
 #include "svn_dirent_uri.h"
 #include "svn_path.h"
 #include "svn_string.h"
+#include "svn_sorts.h"
 #include "svn_error.h"
 #include "svn_io.h"
 #include "svn_pools.h"
@@ -69,6 +85,18 @@
 #include "private/svn_utf_private.h"
 #include "private/svn_dep_compat.h"
 
+/* Directory trees can be copied relative to open directory handles,
+ * which saves resolving the full path of every node over and over.
+ */
+#if !defined(WIN32) && defined(HAVE_OPENAT) && defined(HAVE_FSTATAT) \
+    && defined(HAVE_FDOPENDIR) && defined(HAVE_MKDIRAT) \
+    && defined(HAVE_READLINKAT) && defined(HAVE_SYMLINKAT)
+#include <errno.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#define SVN_IO_COPY_TREE_AT 1
+#endif
+
 #define SVN_SLEEP_ENV_VAR "SVN_I_LOVE_CORRUPTED_WORKING_COPIES_SO_DISABLE_SLEEP_FOR_TIMESTAMPS"
 
 /*
@@ -824,8 +852,88 @@ svn_io_temp_dir(const char **dir,
 
 /*** Creating, copying and appending files. ***/
 
-/* Transfer the contents of FROM_FILE to TO_FILE, using POOL for temporary
- * allocations.
+/* Largest buffer that copy_contents() will use.  Large files are being
+ * copied in chunks of this size to minimize the number of system calls.
+ */
+#define COPY_BUFFER_SIZE (1024 * 1024)
+
+#ifdef SVN_IO_KERNEL_COPY
+
+/* Maximum number of bytes to copy with a single copy_file_range call. */
+#define KERNEL_COPY_CHUNK_SIZE (64 * 1024 * 1024)
+
+/* Try to copy the whole contents of FROM_FILE to the empty TO_FILE
+ * within the kernel, i.e. by letting them share the same data blocks
+ * or by copy_file_range.  Set *DONE if that succeeded.  Leave it unset
+ * and return APR_SUCCESS if the kernel did not copy anything, e.g. because
+ * the files live on different file systems.  Return an error only if the
+ * copy failed half-way.
+ */
+static apr_status_t
+kernel_copy_contents(svn_boolean_t *done,
+                     apr_file_t *from_file,
+                     apr_file_t *to_file)
+{
+  apr_os_file_t from_fd, to_fd;
+#ifdef SYS_copy_file_range
+  apr_off_t copied = 0;
+#endif
+
+  *done = FALSE;
+  if (   apr_os_file_get(&from_fd, from_file)
+      || apr_os_file_get(&to_fd, to_file))
+    return APR_SUCCESS;
+
+#ifdef __APPLE__
+  /* Let the kernel copy the data.  If that fails, rewind both files so
+     that the user space fallback starts from scratch. */
+  if (fcopyfile(from_fd, to_fd, NULL, COPYFILE_DATA) == 0)
+    {
+      *done = TRUE;
+      return APR_SUCCESS;
+    }
+
+  if (   lseek(from_fd, 0, SEEK_SET) != 0
+      || lseek(to_fd, 0, SEEK_SET) != 0
+      || ftruncate(to_fd, 0) != 0)
+    return apr_get_os_error();
+#endif
+
+#ifdef FICLONE
+  /* Reflink, i.e. make TO_FILE share all data blocks with FROM_FILE. */
+  if (ioctl(to_fd, FICLONE, from_fd) == 0)
+    {
+      *done = TRUE;
+      return APR_SUCCESS;
+    }
+#endif
+
+#ifdef SYS_copy_file_range
+  while (1)
+    {
+      long count = syscall(SYS_copy_file_range, from_fd, NULL, to_fd, NULL,
+                           (size_t)KERNEL_COPY_CHUNK_SIZE, 0U);
+      if (count == 0)
+        {
+          *done = TRUE;
+          break;
+        }
+
+      if (count < 0)
+        return copied ? apr_get_os_error() : APR_SUCCESS;
+
+      copied += count;
+    }
+#endif
+
+  return APR_SUCCESS;
+}
+
+#endif
+
+/* Transfer the contents of FROM_FILE to the empty TO_FILE, using POOL for
+ * temporary allocations.  If the platform supports it, let the kernel do
+ * the copying.
  *
  * NOTE: We don't use apr_copy_file() for this, since it takes filenames
  * as parameters.  Since we want to copy to a temporary file
@@ -838,11 +946,30 @@ copy_contents(apr_file_t *from_file,
               apr_file_t *to_file,
               apr_pool_t *pool)
 {
+  char small_buf[SVN__STREAM_CHUNK_SIZE];
+  char *buf = small_buf;
+  apr_size_t buf_size = sizeof(small_buf);
+  apr_finfo_t finfo;
+
+#ifdef SVN_IO_KERNEL_COPY
+  svn_boolean_t done;
+  apr_status_t status = kernel_copy_contents(&done, from_file, to_file);
+  if (status || done)
+    return status;
+#endif
+
+  /* Use larger buffers for larger files. */
+  if (   apr_file_info_get(&finfo, APR_FINFO_SIZE, from_file) == APR_SUCCESS
+      && finfo.size > (apr_off_t)buf_size)
+    {
+      buf_size = (apr_size_t)MIN(finfo.size, COPY_BUFFER_SIZE);
+      buf = apr_palloc(pool, buf_size);
+    }
+
   /* Copy bytes till the cows come home. */
   while (1)
     {
-      char buf[SVN__STREAM_CHUNK_SIZE];
-      apr_size_t bytes_this_time = sizeof(buf);
+      apr_size_t bytes_this_time = buf_size;
       apr_status_t read_err;
       apr_status_t write_err;
 
@@ -1055,6 +1182,272 @@ svn_io_append_file(const char *src, const char *dst, apr_pool_t *pool)
 }
 
 
+#ifdef SVN_IO_COPY_TREE_AT
+
+/* Return an error for failing with STATUS to copy the entry NAME, given
+ * in native encoding, from directory SRC to directory DST.
+ */
+static svn_error_t *
+copy_entry_error(apr_status_t status,
+                 const char *src,
+                 const char *dst,
+                 const char *name,
+                 apr_pool_t *pool)
+{
+  const char *name_utf8;
+  svn_error_t *err = entry_name_to_utf8(&name_utf8, name, src, pool);
+
+  if (err)
+    return svn_error_compose_create(svn_error_wrap_apr(status, NULL), err);
+
+  return svn_error_wrap_apr(status, _("Can't copy '%s' to '%s'"),
+                            svn_dirent_local_style(
+                              svn_dirent_join(src, name_utf8, pool), pool),
+                            svn_dirent_local_style(
+                              svn_dirent_join(dst, name_utf8, pool), pool));
+}
+
+/* Copy the regular file NAME, described by INFO, from the directory open
+ * as SRC_FD to the directory open as DST_FD.  Copy its permissions, if
+ * COPY_PERMS is set.  Use POOL for temporary allocations.
+ */
+static apr_status_t
+copy_file_at(int src_fd,
+             int dst_fd,
+             const char *name,
+             const struct stat *info,
+             svn_boolean_t copy_perms,
+             apr_pool_t *pool)
+{
+  apr_file_t *from_file, *to_file;
+  apr_os_file_t from_fd, to_fd;
+  apr_status_t status;
+
+  from_fd = openat(src_fd, name, O_RDONLY | O_CLOEXEC);
+  if (from_fd < 0)
+    return apr_get_os_error();
+
+  /* The target directory is new, so there is no need to write to a
+     temporary file first. */
+  to_fd = openat(dst_fd, name, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                 0666);
+  if (to_fd < 0)
+    {
+      status = apr_get_os_error();
+      close(from_fd);
+      return status;
+    }
+
+  status = apr_os_file_put(&from_file, &from_fd, APR_READ, pool);
+  if (!status)
+    status = apr_os_file_put(&to_file, &to_fd, APR_WRITE, pool);
+  if (!status)
+    status = copy_contents(from_file, to_file, pool);
+  if (!status && copy_perms && fchmod(to_fd, info->st_mode & 07777))
+    status = apr_get_os_error();
+
+  if (close(to_fd) && !status)
+    status = apr_get_os_error();
+  close(from_fd);
+
+  return status;
+}
+
+/* Copy the symlink NAME, described by INFO, from the directory open as
+ * SRC_FD to the directory open as DST_FD.  Use POOL for temporary
+ * allocations.
+ */
+static apr_status_t
+copy_link_at(int src_fd,
+             int dst_fd,
+             const char *name,
+             const struct stat *info,
+             apr_pool_t *pool)
+{
+  /* Some file systems don't report the size of the link target. */
+  apr_size_t size = info->st_size > 0 ? (apr_size_t)info->st_size + 1
+                                      : APR_PATH_MAX;
+  char *target = apr_palloc(pool, size);
+  ssize_t len = readlinkat(src_fd, name, target, size);
+
+  if (len < 0)
+    return apr_get_os_error();
+  if ((apr_size_t)len >= size)
+    return APR_ENAMETOOLONG;
+
+  target[len] = '\0';
+  if (symlinkat(target, dst_fd, name))
+    return apr_get_os_error();
+
+  return APR_SUCCESS;
+}
+
+/* Copy all entries of the directory open as SRC_FD into the empty
+ * directory open as DST_FD, addressing them relative to these handles.
+ * SRC and DST are the UTF-8 paths of both directories and only used
+ * for error messages.  Skip the directory identified by ROOT_DEV and
+ * ROOT_INO, i.e. the root of the copy if it lies within the source tree.
+ * The other parameters are as for svn_io_copy_dir_recursively().
+ */
+static svn_error_t *
+copy_dir_contents_at(int src_fd,
+                     int dst_fd,
+                     const char *src,
+                     const char *dst,
+                     dev_t root_dev,
+                     ino_t root_ino,
+                     svn_boolean_t copy_perms,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *pool)
+{
+  apr_pool_t *iterpool;
+  svn_error_t *err = SVN_NO_ERROR;
+  DIR *dir;
+
+  /* fdopendir() takes ownership of the file descriptor. */
+  int dir_fd = dup(src_fd);
+  dir = dir_fd < 0 ? NULL : fdopendir(dir_fd);
+  if (dir == NULL)
+    {
+      apr_status_t status = apr_get_os_error();
+      if (dir_fd >= 0)
+        close(dir_fd);
+
+      return svn_error_wrap_apr(status, _("Can't open directory '%s'"),
+                                svn_dirent_local_style(src, pool));
+    }
+
+  iterpool = svn_pool_create(pool);
+  while (!err)
+    {
+      struct dirent *entry;
+      struct stat info;
+      const char *name;
+      apr_status_t status = APR_SUCCESS;
+
+      errno = 0;
+      entry = readdir(dir);
+      if (entry == NULL)
+        {
+          if (errno)
+            err = svn_error_wrap_apr(apr_get_os_error(),
+                                     _("Can't read directory '%s'"),
+                                     svn_dirent_local_style(src, pool));
+          break;
+        }
+
+      name = entry->d_name;
+      if (name[0] == '.'
+          && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0')))
+        continue;
+
+      svn_pool_clear(iterpool);
+      if (cancel_func)
+        {
+          err = cancel_func(cancel_baton);
+          if (err)
+            break;
+        }
+
+      if (fstatat(src_fd, name, &info, AT_SYMLINK_NOFOLLOW))
+        status = apr_get_os_error();
+      else if (S_ISREG(info.st_mode))
+        status = copy_file_at(src_fd, dst_fd, name, &info, copy_perms,
+                              iterpool);
+      else if (S_ISLNK(info.st_mode))
+        status = copy_link_at(src_fd, dst_fd, name, &info, iterpool);
+      else if (S_ISDIR(info.st_mode)
+               && (info.st_dev != root_dev || info.st_ino != root_ino))
+        {
+          const char *name_utf8;
+          int sub_src_fd = -1;
+          int sub_dst_fd = -1;
+
+          if (mkdirat(dst_fd, name, 0777)
+              || (sub_src_fd = openat(src_fd, name, O_RDONLY | O_DIRECTORY
+                                      | O_NOFOLLOW | O_CLOEXEC)) < 0
+              || (sub_dst_fd = openat(dst_fd, name, O_RDONLY | O_DIRECTORY
+                                      | O_NOFOLLOW | O_CLOEXEC)) < 0)
+            status = apr_get_os_error();
+          else
+            {
+              err = entry_name_to_utf8(&name_utf8, name, src, iterpool);
+              if (!err)
+                err = copy_dir_contents_at(
+                        sub_src_fd, sub_dst_fd,
+                        svn_dirent_join(src, name_utf8, iterpool),
+                        svn_dirent_join(dst, name_utf8, iterpool),
+                        root_dev, root_ino, copy_perms,
+                        cancel_func, cancel_baton, iterpool);
+            }
+
+          if (sub_src_fd >= 0)
+            close(sub_src_fd);
+          if (sub_dst_fd >= 0)
+            close(sub_dst_fd);
+        }
+      /* ### support other node types someday?? */
+
+      if (status)
+        err = copy_entry_error(status, src, dst, name, iterpool);
+    }
+
+  closedir(dir);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(err);
+}
+
+/* Implement svn_io_copy_dir_recursively() for the case that all checks
+ * have passed and DST_PATH has been created as a copy of SRC.
+ */
+static svn_error_t *
+copy_tree_at(const char *src,
+             const char *dst_path,
+             svn_boolean_t copy_perms,
+             svn_cancel_func_t cancel_func,
+             void *cancel_baton,
+             apr_pool_t *pool)
+{
+  const char *src_apr, *dst_apr;
+  struct stat root_info;
+  int src_fd, dst_fd;
+  svn_error_t *err;
+
+  SVN_ERR(cstring_from_utf8(&src_apr, src, pool));
+  SVN_ERR(cstring_from_utf8(&dst_apr, dst_path, pool));
+
+  src_fd = open(src_apr, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (src_fd < 0)
+    return svn_error_wrap_apr(apr_get_os_error(),
+                              _("Can't open directory '%s'"),
+                              svn_dirent_local_style(src, pool));
+
+  dst_fd = open(dst_apr, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dst_fd < 0 || fstat(dst_fd, &root_info))
+    {
+      err = svn_error_wrap_apr(apr_get_os_error(),
+                               _("Can't open directory '%s'"),
+                               svn_dirent_local_style(dst_path, pool));
+      if (dst_fd >= 0)
+        close(dst_fd);
+      close(src_fd);
+
+      return err;
+    }
+
+  err = copy_dir_contents_at(src_fd, dst_fd, src, dst_path,
+                             root_info.st_dev, root_info.st_ino,
+                             copy_perms, cancel_func, cancel_baton, pool);
+  close(dst_fd);
+  close(src_fd);
+
+  return svn_error_trace(err);
+}
+
+#endif
+
 svn_error_t *svn_io_copy_dir_recursively(const char *src,
                                          const char *dst_parent,
                                          const char *dst_basename,
@@ -1100,6 +1493,14 @@ svn_error_t *svn_io_copy_dir_recursively(const char *src,
   /* ### TODO: copy permissions (needs apr_file_attrs_get()) */
   SVN_ERR(svn_io_dir_make(dst_path, APR_OS_DEFAULT, pool));
 
+#ifdef SVN_IO_COPY_TREE_AT
+  SVN_ERR(copy_tree_at(src, dst_path, copy_perms, cancel_func, cancel_baton,
+                       subpool));
+  svn_pool_destroy(subpool);
+
+  return SVN_NO_ERROR;
+#endif
+
   /* Loop over the dirents in SRC.  ('.' and '..' are auto-excluded) */
   SVN_ERR(svn_io_dir_open(&this_dir, src, subpool));
 
@@ -3818,6 +4219,30 @@ svn_io_file_seek(apr_file_t *file, apr_seek_where_t where,
              pool);
 }
 
+svn_error_t *
+svn_io__file_prefetch(apr_file_t *file,
+                      const svn_io__read_request_t *requests,
+                      int count,
+                      apr_pool_t *scratch_pool)
+{
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+  apr_os_file_t fd;
+  int i;
+
+  if (apr_os_file_get(&fd, file))
+    return SVN_NO_ERROR;
+
+  /* The kernel starts reading all ranges in the background.  Failures
+     only cost us the hint. */
+  for (i = 0; i < count; ++i)
+    if (requests[i].len > 0)
+      (void)posix_fadvise(fd, requests[i].offset, requests[i].len,
+                          POSIX_FADV_WILLNEED);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_io_file_aligned_seek(apr_file_t *file,
                          apr_off_t block_size,
@@ -648,12 +648,13 @@ svn_error_t *
 svn_rangelist__combine_adjacent_ranges(svn_rangelist_t *rangelist,
                                        apr_pool_t *scratch_pool)
 {
-  int i;
+  int i, j;
   svn_merge_range_t *range, *lastrange;
 
   lastrange = APR_ARRAY_IDX(rangelist, 0, svn_merge_range_t *);
 
-  for (i = 1; i < rangelist->nelts; i++)
+  /* Compact the array in place: J is the number of ranges kept so far. */
+  for (i = 1, j = 1; i < rangelist->nelts; i++)
     {
       range = APR_ARRAY_IDX(rangelist, i, svn_merge_range_t *);
       if (lastrange->start <= range->end
@@ -682,13 +683,16 @@ svn_rangelist__combine_adjacent_ranges(svn_rangelist_t *rangelist,
           if (lastrange->inheritable == range->inheritable)
             {
               lastrange->end = MAX(range->end, lastrange->end);
-              svn_sort__array_delete(rangelist, i, 1);
-              i--;
+              continue;
             }
         }
-      lastrange = APR_ARRAY_IDX(rangelist, i, svn_merge_range_t *);
+      APR_ARRAY_IDX(rangelist, j++, svn_merge_range_t *) = range;
+      lastrange = range;
     }
 
+  if (rangelist->nelts > 1)
+    rangelist->nelts = j;
+
   return SVN_NO_ERROR;
 }
 
@@ -792,403 +796,164 @@ svn_mergeinfo_parse(svn_mergeinfo_t *mergeinfo,
   return err;
 }
 
-/* Cleanup after svn_rangelist_merge2 when it modifies the ending range of
-   a single rangelist element in-place.
-
-   If *RANGE_INDEX is not a valid element in RANGELIST do nothing.  Otherwise
-   ensure that RANGELIST[*RANGE_INDEX]->END does not adjoin or overlap any
-   subsequent ranges in RANGELIST.
+/* State of svn_rangelist_merge2() while it builds the merged rangelist. */
+typedef struct rangelist_merge_t
+{
+  /* The merged ranges so far, in order. */
+  apr_array_header_t *output;
 
-   If overlap is found, then remove, modify, and/or add elements to RANGELIST
-   as per the invariants for rangelists documented in svn_mergeinfo.h.  If
-   RANGELIST[*RANGE_INDEX]->END adjoins a subsequent element then combine the
-   elements if their inheritability permits -- The inheritance of intersecting
-   and adjoining ranges is handled as per svn_mergeinfo_merge2.  Upon return
-   set *RANGE_INDEX to the index of the youngest element modified, added, or
-   adjoined to RANGELIST[*RANGE_INDEX].
+  /* Range objects of the original rangelist that are no longer needed
+     and may be reused for the output: ELTS[REUSE] up to ELTS[REUSABLE-1]. */
+  svn_merge_range_t **elts;
+  int reuse;
+  int reusable;
 
-   Note: Adjoining rangelist elements are those where the end rev of the older
-   element is equal to the start rev of the younger element.
+  apr_pool_t *result_pool;
+} rangelist_merge_t;
 
-   Any new elements inserted into RANGELIST are allocated in  RESULT_POOL.*/
+/* Append the range START:END with inheritability INHERITABLE to the
+   output of MB, combining it with the last range if they adjoin and have
+   the same inheritability. */
 static void
-adjust_remaining_ranges(svn_rangelist_t *rangelist,
-                        int *range_index,
-                        apr_pool_t *result_pool)
+merge_emit(rangelist_merge_t *mb,
+           svn_revnum_t start,
+           svn_revnum_t end,
+           svn_boolean_t inheritable)
 {
-  int i;
-  int starting_index;
-  int elements_to_delete = 0;
-  svn_merge_range_t *modified_range;
-
-  if (*range_index >= rangelist->nelts)
-    return;
-
-  starting_index = *range_index + 1;
-  modified_range = APR_ARRAY_IDX(rangelist, *range_index, svn_merge_range_t *);
+  svn_merge_range_t *range;
 
-  for (i = *range_index + 1; i < rangelist->nelts; i++)
+  if (mb->output->nelts)
     {
-      svn_merge_range_t *next_range = APR_ARRAY_IDX(rangelist, i,
-                                                    svn_merge_range_t *);
-
-      /* If MODIFIED_RANGE doesn't adjoin or overlap the next range in
-         RANGELIST then we are finished. */
-      if (modified_range->end < next_range->start)
-        break;
-
-      /* Does MODIFIED_RANGE adjoin NEXT_RANGE? */
-      if (modified_range->end == next_range->start)
-        {
-          if (modified_range->inheritable == next_range->inheritable)
-            {
-              /* Combine adjoining ranges with the same inheritability. */
-              modified_range->end = next_range->end;
-              elements_to_delete++;
-            }
-          else
-            {
-              /* Cannot join because inheritance differs. */
-              (*range_index)++;
-            }
-          break;
-        }
-
-      /* Alright, we know MODIFIED_RANGE overlaps NEXT_RANGE, but how? */
-      if (modified_range->end > next_range->end)
-        {
-          /* NEXT_RANGE is a proper subset of MODIFIED_RANGE and the two
-             don't share the same end range. */
-          if (modified_range->inheritable
-              || (modified_range->inheritable == next_range->inheritable))
-            {
-              /* MODIFIED_RANGE absorbs NEXT_RANGE. */
-              elements_to_delete++;
-            }
-          else
-            {
-              /* NEXT_RANGE is a proper subset MODIFIED_RANGE but
-                 MODIFIED_RANGE is non-inheritable and NEXT_RANGE is
-                 inheritable.  This means MODIFIED_RANGE is truncated,
-                 NEXT_RANGE remains, and the portion of MODIFIED_RANGE
-                 younger than NEXT_RANGE is added as a separate range:
-                  ______________________________________________
-                 |                                              |
-                 M                 MODIFIED_RANGE               N
-                 |                 (!inheritable)               |
-                 |______________________________________________|
-                                  |              |
-                                  O  NEXT_RANGE  P
-                                  | (inheritable)|
-                                  |______________|
-                                         |
-                                         V
-                  _______________________________________________
-                 |                |              |               |
-                 M MODIFIED_RANGE O  NEXT_RANGE  P   NEW_RANGE   N
-                 | (!inheritable) | (inheritable)| (!inheritable)|
-                 |________________|______________|_______________|
-              */
-              svn_merge_range_t *new_modified_range =
-                apr_palloc(result_pool, sizeof(*new_modified_range));
-              new_modified_range->start = next_range->end;
-              new_modified_range->end = modified_range->end;
-              new_modified_range->inheritable = FALSE;
-              modified_range->end = next_range->start;
-              (*range_index)+=2;
-              svn_sort__array_insert(rangelist, &new_modified_range,
-                                     *range_index);
-              /* Recurse with the new range. */
-              adjust_remaining_ranges(rangelist, range_index, result_pool);
-              break;
-            }
-        }
-      else if (modified_range->end == next_range->end)
-        {
-          /* NEXT_RANGE is a proper subset MODIFIED_RANGE and share
-             the same end range. */
-          if (modified_range->inheritable
-              || (modified_range->inheritable == next_range->inheritable))
-            {
-              /* MODIFIED_RANGE absorbs NEXT_RANGE. */
-              elements_to_delete++;
-            }
-          else
-            {
-              /* The intersection between MODIFIED_RANGE and NEXT_RANGE is
-                 absorbed by the latter. */
-              modified_range->end = next_range->start;
-              (*range_index)++;
-            }
-          break;
-        }
-      else
+      range = APR_ARRAY_IDX(mb->output, mb->output->nelts - 1,
+                            svn_merge_range_t *);
+      if (range->end == start && range->inheritable == inheritable)
         {
-          /* NEXT_RANGE and MODIFIED_RANGE intersect but NEXT_RANGE is not
-             a proper subset of MODIFIED_RANGE, nor do the two share the
-             same end revision, i.e. they overlap. */
-          if (modified_range->inheritable == next_range->inheritable)
-            {
-              /* Combine overlapping ranges with the same inheritability. */
-              modified_range->end = next_range->end;
-              elements_to_delete++;
-            }
-          else if (modified_range->inheritable)
-            {
-              /* MODIFIED_RANGE absorbs the portion of NEXT_RANGE it overlaps
-                 and NEXT_RANGE is truncated. */
-              next_range->start = modified_range->end;
-              (*range_index)++;
-            }
-          else
-            {
-              /* NEXT_RANGE absorbs the portion of MODIFIED_RANGE it overlaps
-                 and MODIFIED_RANGE is truncated. */
-              modified_range->end = next_range->start;
-              (*range_index)++;
-            }
-          break;
+          range->end = end;
+          return;
         }
     }
 
-  if (elements_to_delete)
-    svn_sort__array_delete(rangelist, starting_index, elements_to_delete);
+  if (mb->reuse < mb->reusable)
+    range = mb->elts[mb->reuse++];
+  else
+    range = apr_palloc(mb->result_pool, sizeof(*range));
+
+  range->start = start;
+  range->end = end;
+  range->inheritable = inheritable;
+  APR_ARRAY_PUSH(mb->output, svn_merge_range_t *) = range;
 }
 
+/* The merge sweeps over both rangelists at once and emits the union
+   segment by segment.  A revision in the result is inheritable if it is
+   inheritable in either input.  This takes linear time, while inserting
+   into RANGELIST in place would take quadratic time for large
+   rangelists. */
 svn_error_t *
 svn_rangelist_merge2(svn_rangelist_t *rangelist,
                      const svn_rangelist_t *changes,
                      apr_pool_t *result_pool,
                      apr_pool_t *scratch_pool)
 {
+  rangelist_merge_t mb;
+  svn_merge_range_t range, change;
+  svn_merge_range_t *change_values;
+  svn_boolean_t have_range, have_change;
   int i = 0;
   int j = 0;
 
-  /* We may modify CHANGES, so make a copy in SCRATCH_POOL. */
-  changes = svn_rangelist_dup(changes, scratch_pool);
+  /* Nothing to do? */
+  if (changes->nelts == 0)
+    return SVN_NO_ERROR;
 
-  while (i < rangelist->nelts && j < changes->nelts)
+  /* CHANGES may be RANGELIST itself or share range objects with it.
+     Since those get reused for the output, read all changes up-front. */
+  change_values = apr_palloc(scratch_pool,
+                             changes->nelts * sizeof(*change_values));
+  for (j = 0; j < changes->nelts; j++)
+    change_values[j] = *APR_ARRAY_IDX(changes, j, svn_merge_range_t *);
+  j = 0;
+
+  mb.output = apr_array_make(scratch_pool,
+                             rangelist->nelts + changes->nelts,
+                             sizeof(svn_merge_range_t *));
+  mb.elts = (svn_merge_range_t **)rangelist->elts;
+  mb.reuse = 0;
+  mb.reusable = 0;
+  mb.result_pool = result_pool;
+
+  /* RANGE and CHANGE are the parts of RANGELIST[I-1] and CHANGES[J-1]
+     that have not been merged, yet.  Once a RANGELIST element has been
+     copied to RANGE, it may be reused for the output. */
+  if ((have_range = (i < rangelist->nelts)))
     {
-      svn_merge_range_t *range =
-        APR_ARRAY_IDX(rangelist, i, svn_merge_range_t *);
-      svn_merge_range_t *change =
-        APR_ARRAY_IDX(changes, j, svn_merge_range_t *);
-      int res = svn_sort_compare_ranges(&range, &change);
+      range = *mb.elts[i++];
+      mb.reusable = i;
+    }
+  if ((have_change = (j < changes->nelts)))
+    change = change_values[j++];
 
-      if (res == 0)
-        {
-          /* Only when merging two non-inheritable ranges is the result also
-             non-inheritable.  In all other cases ensure an inheritable
-             result. */
-          if (range->inheritable || change->inheritable)
-            range->inheritable = TRUE;
-          i++;
-          j++;
-        }
-      else if (res < 0) /* CHANGE is younger than RANGE */
+  while (have_range || have_change)
+    {
+      if (have_range && (!have_change || range.start < change.start))
         {
-          if (range->end < change->start)
+          /* RANGE starts first.  Emit its part before CHANGE. */
+          if (!have_change || range.end <= change.start)
             {
-              /* RANGE is older than CHANGE and the two do not
-                 adjoin or overlap */
-              i++;
-            }
-          else if (range->end == change->start)
-            {
-              /* RANGE and CHANGE adjoin */
-              if (range->inheritable == change->inheritable)
-                {
-                  /* RANGE and CHANGE have the same inheritability so
-                     RANGE expands to absord CHANGE. */
-                  range->end = change->end;
-                  adjust_remaining_ranges(rangelist, &i, result_pool);
-                  j++;
-                }
-              else
-                {
-                  /* RANGE and CHANGE adjoin, but have different
-                     inheritability.  Since RANGE is older, just
-                     move on to the next RANGE. */
-                  i++;
-                }
+              merge_emit(&mb, range.start, range.end, range.inheritable);
+              have_range = FALSE;
             }
           else
             {
-              /* RANGE and CHANGE overlap, but how? */
-              if ((range->inheritable == change->inheritable)
-                  || range->inheritable)
-                {
-                  /* If CHANGE is a proper subset of RANGE, it absorbs RANGE
-                      with no adjustment otherwise only the intersection is
-                      absorbed and CHANGE is truncated. */
-                  if (range->end >= change->end)
-                    j++;
-                  else
-                    change->start = range->end;
-                }
-              else
-                {
-                  /* RANGE is non-inheritable and CHANGE is inheritable. */
-                  if (range->start < change->start)
-                    {
-                      /* CHANGE absorbs intersection with RANGE and RANGE
-                         is truncated. */
-                      svn_merge_range_t *range_copy =
-                        svn_merge_range_dup(range, result_pool);
-                      range_copy->end = change->start;
-                      range->start = change->start;
-                      svn_sort__array_insert(rangelist, &range_copy, i++);
-                    }
-                  else
-                    {
-                      /* CHANGE and RANGE share the same start rev, but
-                         RANGE is considered older because its end rev
-                         is older. */
-                      range->inheritable = TRUE;
-                      change->start = range->end;
-                    }
-                }
+              merge_emit(&mb, range.start, change.start, range.inheritable);
+              range.start = change.start;
             }
         }
-      else /* res > 0, CHANGE is older than RANGE */
+      else if (have_change && (!have_range || change.start < range.start))
         {
-          if (change->end < range->start)
-            {
-              /* CHANGE is older than RANGE and the two do not
-                 adjoin or overlap, so insert a copy of CHANGE
-                 into RANGELIST. */
-              svn_merge_range_t *change_copy =
-                svn_merge_range_dup(change, result_pool);
-              svn_sort__array_insert(rangelist, &change_copy, i++);
-              j++;
-            }
-          else if (change->end == range->start)
+          /* CHANGE starts first.  Emit its part before RANGE. */
+          if (!have_range || change.end <= range.start)
             {
-              /* RANGE and CHANGE adjoin */
-              if (range->inheritable == change->inheritable)
-                {
-                  /* RANGE and CHANGE have the same inheritability so we
-                     can simply combine the two in place. */
-                  range->start = change->start;
-                  j++;
-                }
-              else
-                {
-                  /* RANGE and CHANGE have different inheritability so insert
-                     a copy of CHANGE into RANGELIST. */
-                  svn_merge_range_t *change_copy =
-                    svn_merge_range_dup(change, result_pool);
-                  svn_sort__array_insert(rangelist, &change_copy, i);
-                  j++;
-                }
+              merge_emit(&mb, change.start, change.end, change.inheritable);
+              have_change = FALSE;
             }
           else
             {
-              /* RANGE and CHANGE overlap. */
-              if (range->inheritable == change->inheritable)
-                {
-                  /* RANGE and CHANGE have the same inheritability so we
-                     can simply combine the two in place... */
-                  range->start = change->start;
-                  if (range->end < change->end)
-                    {
-                      /* ...but if RANGE is expanded ensure that we don't
-                         violate any rangelist invariants. */
-                      range->end = change->end;
-                      adjust_remaining_ranges(rangelist, &i, result_pool);
-                    }
-                  j++;
-                }
-              else if (range->inheritable)
-                {
-                  if (change->start < range->start)
-                    {
-                      /* RANGE is inheritable so absorbs any part of CHANGE
-                         it overlaps.  CHANGE is truncated and the remainder
-                         inserted into RANGELIST. */
-                      svn_merge_range_t *change_copy =
-                        svn_merge_range_dup(change, result_pool);
-                      change_copy->end = range->start;
-                      change->start = range->start;
-                      svn_sort__array_insert(rangelist, &change_copy, i++);
-                    }
-                  else
-                    {
-                      /* CHANGE and RANGE share the same start rev, but
-                         CHANGE is considered older because CHANGE->END is
-                         older than RANGE->END. */
-                      j++;
-                    }
-                }
-              else
-                {
-                  /* RANGE is non-inheritable and CHANGE is inheritable. */
-                  if (change->start < range->start)
-                    {
-                      if (change->end == range->end)
-                        {
-                          /* RANGE is a proper subset of CHANGE and share the
-                             same end revision, so set RANGE equal to CHANGE. */
-                          range->start = change->start;
-                          range->inheritable = TRUE;
-                          j++;
-                        }
-                      else if (change->end > range->end)
-                        {
-                          /* RANGE is a proper subset of CHANGE and CHANGE has
-                             a younger end revision, so set RANGE equal to its
-                             intersection with CHANGE and truncate CHANGE. */
-                          range->start = change->start;
-                          range->inheritable = TRUE;
-                          change->start = range->end;
-                        }
-                      else
-                        {
-                          /* CHANGE and RANGE overlap. Set RANGE equal to its
-                             intersection with CHANGE and take the remainder
-                             of RANGE and insert it into RANGELIST. */
-                          svn_merge_range_t *range_copy =
-                            svn_merge_range_dup(range, result_pool);
-                          range_copy->start = change->end;
-                          range->start = change->start;
-                          range->end = change->end;
-                          range->inheritable = TRUE;
-                          svn_sort__array_insert(rangelist, &range_copy, ++i);
-                          j++;
-                        }
-                    }
-                  else
-                    {
-                      /* CHANGE and RANGE share the same start rev, but
-                         CHANGE is considered older because its end rev
-                         is older.
-
-                         Insert the intersection of RANGE and CHANGE into
-                         RANGELIST and then set RANGE to the non-intersecting
-                         portion of RANGE. */
-                      svn_merge_range_t *range_copy =
-                        svn_merge_range_dup(range, result_pool);
-                      range_copy->end = change->end;
-                      range_copy->inheritable = TRUE;
-                      range->start = change->end;
-                      svn_sort__array_insert(rangelist, &range_copy, i++);
-                      j++;
-                    }
-                }
+              merge_emit(&mb, change.start, range.start, change.inheritable);
+              change.start = range.start;
             }
         }
-    }
+      else
+        {
+          /* Both start at the same revision.  Only when merging two
+             non-inheritable ranges is the result also non-inheritable. */
+          svn_revnum_t end = MIN(range.end, change.end);
+
+          merge_emit(&mb, range.start, end,
+                     range.inheritable || change.inheritable);
+          range.start = end;
+          change.start = end;
+          have_range = (range.start < range.end);
+          have_change = (change.start < change.end);
+        }
 
-  /* Copy any remaining elements in CHANGES into RANGELIST. */
-  for (; j < (changes)->nelts; j++)
-    {
-      svn_merge_range_t *change =
-        APR_ARRAY_IDX(changes, j, svn_merge_range_t *);
-      svn_merge_range_t *change_copy = svn_merge_range_dup(change,
-                                                           result_pool);
-      svn_sort__array_insert(rangelist, &change_copy, rangelist->nelts);
+      if (!have_range && i < rangelist->nelts)
+        {
+          range = *mb.elts[i++];
+          mb.reusable = i;
+          have_range = TRUE;
+        }
+      if (!have_change && j < changes->nelts)
+        {
+          change = change_values[j++];
+          have_change = TRUE;
+        }
     }
 
+  /* Replace the contents of RANGELIST with the result. */
+  apr_array_clear(rangelist);
+  apr_array_cat(rangelist, mb.output);
+
   return SVN_NO_ERROR;
 }
 
@@ -37,14 +37,22 @@
 
 
 
+/* Number of independently locked shards in a thread-safe object pool.
+ * Lookups of objects in different shards don't contend for the same
+ * mutex.  Must be a power of 2.
+ */
+#define SHARD_COUNT 16
+
+typedef struct shard_t shard_t;
+
 /* A reference counting wrapper around the user-provided object.
  */
 typedef struct object_ref_t
 {
-  /* reference to the parent container */
-  svn_object_pool__t *object_pool;
+  /* reference to the shard of the parent container that contains us */
+  shard_t *shard;
 
-  /* identifies the bucket in OBJECT_POOL->OBJECTS in which this entry
+  /* identifies the bucket in SHARD->OBJECTS in which this entry
    * belongs. */
   svn_membuf_t key;
 
@@ -60,9 +68,10 @@ typedef struct object_ref_t
 } object_ref_t;
 
 
-/* Core data structure.  All access to it must be serialized using MUTEX.
+/* A subset of the objects in an object pool, selected by a hash of their
+ * keys.  All access to it must be serialized using MUTEX.
  */
-struct svn_object_pool__t
+struct shard_t
 {
   /* serialization object for all non-atomic data in this struct */
   svn_mutex__t *mutex;
@@ -82,38 +91,50 @@ struct svn_object_pool__t
      Due to races, this may be *temporarily* off by one or more.
      Hence we must not strictly depend on it. */
   volatile svn_atomic_t unused_count;
+};
+
+
+/* Core data structure.
+ */
+struct svn_object_pool__t
+{
+  /* The objects, distributed over SHARD_COUNT shards in thread-safe
+   * pools and put into a single shard otherwise. */
+  shard_t *shards;
+  apr_size_t shard_count;
 
   /* the root pool owning this structure */
   apr_pool_t *pool;
 };
 
-
+
 /* Pool cleanup function for the whole object pool.
  */
 static apr_status_t
 object_pool_cleanup(void *baton)
 {
   svn_object_pool__t *object_pool = baton;
+  apr_size_t i;
 
   /* all entries must have been released up by now */
-  SVN_ERR_ASSERT_NO_RETURN(   object_pool->object_count
-                           == object_pool->unused_count);
+  for (i = 0; i < object_pool->shard_count; ++i)
+    SVN_ERR_ASSERT_NO_RETURN(   object_pool->shards[i].object_count
+                             == object_pool->shards[i].unused_count);
 
   return APR_SUCCESS;
 }
 
-/* Remove entries from OBJECTS in OBJECT_POOL that have a ref-count of 0.
+/* Remove entries from OBJECTS in SHARD that have a ref-count of 0.
  *
- * Requires external serialization on OBJECT_POOL.
+ * Requires external serialization on SHARD.
  */
 static void
-remove_unused_objects(svn_object_pool__t *object_pool)
+remove_unused_objects(shard_t *shard)
 {
-  apr_pool_t *subpool = svn_pool_create(object_pool->pool);
-
-  /* process all hash buckets */
+  /* process all hash buckets.  Use the hash's internal iterator; access
+     to SHARD is serialized anyway. */
   apr_hash_index_t *hi;
-  for (hi = apr_hash_first(subpool, object_pool->objects);
+  for (hi = apr_hash_first(NULL, shard->objects);
        hi != NULL;
        hi = apr_hash_next(hi))
     {
@@ -123,16 +144,14 @@ remove_unused_objects(svn_object_pool__t *object_pool)
          to the hash is serialized */
       if (svn_atomic_read(&object_ref->ref_count) == 0)
         {
-          apr_hash_set(object_pool->objects, object_ref->key.data,
+          apr_hash_set(shard->objects, object_ref->key.data,
                        object_ref->key.size, NULL);
-          svn_atomic_dec(&object_pool->object_count);
-          svn_atomic_dec(&object_pool->unused_count);
+          svn_atomic_dec(&shard->object_count);
+          svn_atomic_dec(&shard->unused_count);
 
           svn_pool_destroy(object_ref->pool);
         }
     }
-
-  svn_pool_destroy(subpool);
 }
 
 /* Cleanup function called when an object_ref_t gets released.
@@ -141,7 +160,7 @@ static apr_status_t
 object_ref_cleanup(void *baton)
 {
   object_ref_t *object = baton;
-  svn_object_pool__t *object_pool = object->object_pool;
+  shard_t *shard = object->shard;
 
   /* If we released the last reference to object, there is one more
      unused entry.
@@ -153,7 +172,7 @@ object_ref_cleanup(void *baton)
      all threads left the racy sections.
    */
   if (svn_atomic_dec(&object->ref_count) == 0)
-    svn_atomic_inc(&object_pool->unused_count);
+    svn_atomic_inc(&shard->unused_count);
 
   return APR_SUCCESS;
 }
@@ -161,7 +180,7 @@ object_ref_cleanup(void *baton)
 /* Handle reference counting for the OBJECT_REF that the caller is about
  * to return.  The reference will be released when POOL gets cleaned up.
  *
- * Requires external serialization on OBJECT_REF->OBJECT_POOL.
+ * Requires external serialization on OBJECT_REF->SHARD.
  */
 static void
 add_object_ref(object_ref_t *object_ref,
@@ -170,25 +189,38 @@ add_object_ref(object_ref_t *object_ref,
   /* Update ref counter.
      Note that this is racy with object_ref_cleanup; see comment there. */
   if (svn_atomic_inc(&object_ref->ref_count) == 0)
-    svn_atomic_dec(&object_ref->object_pool->unused_count);
+    svn_atomic_dec(&object_ref->shard->unused_count);
 
   /* make sure the reference gets released automatically */
   apr_pool_cleanup_register(pool, object_ref, object_ref_cleanup,
                             apr_pool_cleanup_null);
 }
 
+/* Return the shard in OBJECT_POOL that is responsible for KEY.
+ */
+static shard_t *
+get_shard(svn_object_pool__t *object_pool,
+          const svn_membuf_t *key)
+{
+  if (object_pool->shard_count == 1)
+    return object_pool->shards;
+
+  return &object_pool->shards[  svn__fnv1a_32(key->data, key->size)
+                              & (object_pool->shard_count - 1)];
+}
+
 /* Actual implementation of svn_object_pool__lookup.
  *
- * Requires external serialization on OBJECT_POOL.
+ * Requires external serialization on SHARD.
  */
 static svn_error_t *
 lookup(void **object,
-       svn_object_pool__t *object_pool,
+       shard_t *shard,
        svn_membuf_t *key,
        apr_pool_t *result_pool)
 {
   object_ref_t *object_ref
-    = apr_hash_get(object_pool->objects, key->data, key->size);
+    = apr_hash_get(shard->objects, key->data, key->size);
 
   if (object_ref)
     {
@@ -205,18 +237,18 @@ lookup(void **object,
 
 /* Actual implementation of svn_object_pool__insert.
  *
- * Requires external serialization on OBJECT_POOL.
+ * Requires external serialization on SHARD.
  */
 static svn_error_t *
 insert(void **object,
-       svn_object_pool__t *object_pool,
+       shard_t *shard,
        const svn_membuf_t *key,
        void *item,
        apr_pool_t *item_pool,
        apr_pool_t *result_pool)
 {
   object_ref_t *object_ref
-    = apr_hash_get(object_pool->objects, key->data, key->size);
+    = apr_hash_get(shard->objects, key->data, key->size);
   if (object_ref)
     {
       /* Destroy the new one and return a reference to the existing one
@@ -228,7 +260,7 @@ insert(void **object,
     {
       /* add new index entry */
       object_ref = apr_pcalloc(item_pool, sizeof(*object_ref));
-      object_ref->object_pool = object_pool;
+      object_ref->shard = shard;
       object_ref->object = item;
       object_ref->pool = item_pool;
 
@@ -236,14 +268,14 @@ insert(void **object,
       object_ref->key.size = key->size;
       memcpy(object_ref->key.data, key->data, key->size);
 
-      apr_hash_set(object_pool->objects, object_ref->key.data,
+      apr_hash_set(shard->objects, object_ref->key.data,
                    object_ref->key.size, object_ref);
-      svn_atomic_inc(&object_pool->object_count);
+      svn_atomic_inc(&shard->object_count);
 
       /* the new entry is *not* in use yet.
        * add_object_ref will update counters again.
        */
-      svn_atomic_inc(&object_ref->object_pool->unused_count);
+      svn_atomic_inc(&shard->unused_count);
     }
 
   /* return a reference to the object we just added */
@@ -251,9 +283,9 @@ insert(void **object,
   add_object_ref(object_ref, result_pool);
 
   /* limit memory usage */
-  if (svn_atomic_read(&object_pool->unused_count) * 2
-      > apr_hash_count(object_pool->objects) + 2)
-    remove_unused_objects(object_pool);
+  if (svn_atomic_read(&shard->unused_count) * 2
+      > apr_hash_count(shard->objects) + 2)
+    remove_unused_objects(shard);
 
   return SVN_NO_ERROR;
 }
@@ -267,15 +299,25 @@ svn_object_pool__create(svn_object_pool__t **object_pool,
                         apr_pool_t *pool)
 {
   svn_object_pool__t *result;
+  apr_size_t i;
 
   /* construct the object pool in our private ROOT_POOL to survive POOL
    * cleanup and to prevent threading issues with the allocator
    */
   result = apr_pcalloc(pool, sizeof(*result));
-  SVN_ERR(svn_mutex__init(&result->mutex, thread_safe, pool));
-
   result->pool = pool;
-  result->objects = svn_hash__make(result->pool);
+
+  /* Without concurrent access, sharding has no benefit. */
+  result->shard_count = thread_safe ? SHARD_COUNT : 1;
+  result->shards = apr_pcalloc(pool,
+                               result->shard_count * sizeof(*result->shards));
+  for (i = 0; i < result->shard_count; ++i)
+    {
+      shard_t *shard = &result->shards[i];
+
+      SVN_ERR(svn_mutex__init(&shard->mutex, thread_safe, pool));
+      shard->objects = svn_hash__make(pool);
+    }
 
   /* make sure we clean up nicely.
    * We need two cleanup functions of which exactly one will be run
@@ -303,9 +345,11 @@ svn_object_pool__lookup(void **object,
                         svn_membuf_t *key,
                         apr_pool_t *result_pool)
 {
+  shard_t *shard = get_shard(object_pool, key);
+
   *object = NULL;
-  SVN_MUTEX__WITH_LOCK(object_pool->mutex,
-                       lookup(object, object_pool, key, result_pool));
+  SVN_MUTEX__WITH_LOCK(shard->mutex,
+                       lookup(object, shard, key, result_pool));
   return SVN_NO_ERROR;
 }
 
@@ -317,9 +361,11 @@ svn_object_pool__insert(void **object,
                         apr_pool_t *item_pool,
                         apr_pool_t *result_pool)
 {
+  shard_t *shard = get_shard(object_pool, key);
+
   *object = NULL;
-  SVN_MUTEX__WITH_LOCK(object_pool->mutex,
-                       insert(object, object_pool, key, item, 
+  SVN_MUTEX__WITH_LOCK(shard->mutex,
+                       insert(object, shard, key, item,
                               item_pool, result_pool));
   return SVN_NO_ERROR;
 }
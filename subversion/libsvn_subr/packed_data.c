@@ -804,9 +804,12 @@ svn_packed__data_fill_buffer(svn_packed__int_stream_t *stream)
          The goal is that read_packed_uint_body doesn't need check for
          overflows. */
       unsigned char local_buffer[10 * SVN__PACKED_DATA_BUFFER_SIZE];
+      apr_uint64_t values[SVN__PACKED_DATA_BUFFER_SIZE];
       unsigned char *p;
       unsigned char *start;
       apr_size_t packed_read;
+      apr_size_t available;
+      apr_size_t decoded = end;
 
       if (private_data->packed->len < sizeof(local_buffer))
         {
@@ -817,14 +820,24 @@ svn_packed__data_fill_buffer(svn_packed__int_stream_t *stream)
           memset(local_buffer + private_data->packed->len, 0, MIN(trail, end));
 
           p = local_buffer;
+          available = private_data->packed->len + MIN(trail, end);
         }
       else
-        p = (unsigned char *)private_data->packed->data;
+        {
+          p = (unsigned char *)private_data->packed->data;
+          available = private_data->packed->len;
+        }
 
-      /* unpack numbers */
+      /* unpack numbers.  Overlong ones stop the bulk decoder. */
       start = p;
-      for (i = end; i > 0; --i)
-        p = read_packed_uint_body(p, &stream->buffer[i-1]);
+      p = (unsigned char *)svn__decode_uints(values, NULL, &decoded, p,
+                                             p + available);
+      for (i = decoded; i < end; ++i)
+        p = read_packed_uint_body(p, &values[i]);
+
+      /* the buffer is being used in reverse order */
+      for (i = 0; i < end; ++i)
+        stream->buffer[end - 1 - i] = values[i];
 
       /* adjust remaining packed data buffer */
       packed_read = p - start;
@@ -870,6 +883,75 @@ svn_packed__get_int(svn_packed__int_stream_t *stream)
   return (apr_int64_t)svn_packed__get_uint(stream);
 }
 
+void
+svn_packed__get_uints(svn_packed__int_stream_t *stream,
+                      apr_uint64_t *values,
+                      apr_size_t count)
+{
+  packed_int_private_t *private_data = stream->private_data;
+  apr_size_t i = 0;
+
+  /* hand out what has been decoded already */
+  for (; i < count && stream->buffer_used; ++i)
+    values[i] = stream->buffer[--stream->buffer_used];
+
+  /* Decode directly into VALUES.  Limit the chunk such that even the
+     longest encoding will not read beyond the packed data buffer. */
+  if (!private_data->current_substream && private_data->packed)
+    {
+      apr_size_t chunk = MIN(count - i, private_data->item_count);
+      chunk = MIN(chunk, private_data->packed->len / 10);
+
+      if (chunk)
+        {
+          unsigned char *start = (unsigned char *)private_data->packed->data;
+          apr_size_t available = private_data->packed->len;
+          unsigned char *p;
+          apr_size_t end = i + chunk;
+          apr_size_t decoded = chunk;
+          apr_size_t packed_read;
+          apr_size_t k;
+
+          /* Overlong numbers stop the bulk decoder. */
+          p = (unsigned char *)svn__decode_uints(values + i, NULL, &decoded,
+                                                 start, start + available);
+          for (k = i + decoded; k < end; ++k)
+            p = read_packed_uint_body(p, &values[k]);
+
+          /* adjust remaining packed data buffer */
+          packed_read = p - start;
+          private_data->packed->data += packed_read;
+          private_data->packed->len -= packed_read;
+          private_data->packed->blocksize -= packed_read;
+          private_data->item_count -= chunk;
+
+          /* undeltify numbers, if configured */
+          if (private_data->diff)
+            {
+              apr_uint64_t last_value = private_data->last_value;
+              for (k = i; k < end; ++k)
+                {
+                  last_value += unmap_uint(values[k]);
+                  values[k] = last_value;
+                }
+
+              private_data->last_value = last_value;
+            }
+          else if (private_data->is_signed)
+            {
+              for (k = i; k < end; ++k)
+                values[k] = unmap_uint(values[k]);
+            }
+
+          i = end;
+        }
+    }
+
+  /* sub-streams, the tail of the packed data and beyond the end */
+  for (; i < count; ++i)
+    values[i] = svn_packed__get_uint(stream);
+}
+
 const char *
 svn_packed__get_bytes(svn_packed__byte_stream_t *stream,
                       apr_size_t *len)
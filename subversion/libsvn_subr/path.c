@@ -39,6 +39,7 @@
 #include "svn_ctype.h"
 
 #include "dirent_uri.h"
+#include "private/svn_string_private.h"
 
 
 /* The canonical empty path.  Can this be changed?  Well, change the empty
@@ -421,14 +422,13 @@ svn_path_compare_paths(const char *path1,
   apr_size_t path1_len = strlen(path1);
   apr_size_t path2_len = strlen(path2);
   apr_size_t min_len = ((path1_len < path2_len) ? path1_len : path2_len);
-  apr_size_t i = 0;
+  apr_size_t i;
 
   assert(is_canonical(path1, path1_len));
   assert(is_canonical(path2, path2_len));
 
   /* Skip past common prefix. */
-  while (i < min_len && path1[i] == path2[i])
-    ++i;
+  i = svn_cstring__match_length(path1, path2, min_len);
 
   /* Are the paths exactly the same? */
   if ((path1_len == path2_len) && (i >= min_len))
@@ -21,11 +21,20 @@
  * ====================================================================
  */
 
+#include <apr_thread_proc.h>
+
 #include "svn_pools.h"
 
 #include "private/svn_subr_private.h"
 #include "private/svn_mutex.h"
 
+/* Keep at most this many unused pools in the shared collection.  Any
+ * further pools get destroyed upon release.  Together with the limit
+ * on free memory retained by each pool's allocator, this bounds the
+ * memory held by idle root pools after a load peak.
+ */
+#define MAX_UNUSED_POOLS 64
+
 struct svn_root_pools__t
 {
   /* unused pools.
@@ -36,8 +45,33 @@ struct svn_root_pools__t
   /* Mutex to serialize access to UNUSED_POOLS */
   svn_mutex__t *mutex;
 
+#if APR_HAS_THREADS
+  /* Each thread caches the root pool it released last under this key,
+   * so that it can acquire it again without taking MUTEX.  NULL if
+   * thread-specific storage is not available.
+   */
+  apr_threadkey_t *thread_pool;
+#endif
 };
 
+#if APR_HAS_THREADS
+/* Destructor for the thread-specific pool cache: destroy the root pool
+ * cached by an exiting thread.
+ */
+static void
+destroy_thread_pool(void *data)
+{
+  svn_pool_destroy(data);
+}
+#endif
+
+/* Return a new root pool with its own allocator. */
+static apr_pool_t *
+create_root_pool(void)
+{
+  return apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+}
+
 svn_error_t *
 svn_root_pools__create(svn_root_pools__t **pools)
 {
@@ -51,6 +85,15 @@ svn_root_pools__create(svn_root_pools__t **pools)
   SVN_ERR(svn_mutex__init(&result->mutex, TRUE, pool));
   result->unused_pools = apr_array_make(pool, 16, sizeof(apr_pool_t *));
 
+#if APR_HAS_THREADS && !defined(WIN32)
+  /* Without thread-specific storage, we simply use the shared pools.
+     APR does not run the destructor on Windows, so exiting threads
+     would leak their pools there. */
+  if (apr_threadkey_private_create(&result->thread_pool,
+                                   destroy_thread_pool, pool))
+    result->thread_pool = NULL;
+#endif
+
   /* done */
   *pools = result;
 
@@ -67,9 +110,13 @@ acquire_pool_internal(apr_pool_t **pool,
   SVN_ERR(svn_mutex__lock(pools->mutex));
   *pool = pools->unused_pools->nelts
         ? *(apr_pool_t **)apr_array_pop(pools->unused_pools)
-        : apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+        : NULL;
   SVN_ERR(svn_mutex__unlock(pools->mutex, SVN_NO_ERROR));
 
+  /* Create new pools outside the critical section. */
+  if (*pool == NULL)
+    *pool = create_root_pool();
+
   return SVN_NO_ERROR;
 }
 
@@ -77,12 +124,26 @@ apr_pool_t *
 svn_root_pools__acquire_pool(svn_root_pools__t *pools)
 {
   apr_pool_t *pool;
-  svn_error_t *err = acquire_pool_internal(&pool, pools);
+  svn_error_t *err;
+
+#if APR_HAS_THREADS
+  /* Try the pool cached by the current thread first. */
+  if (pools->thread_pool)
+    {
+      void *data = NULL;
+      if (   !apr_threadkey_private_get(&data, pools->thread_pool)
+          && data
+          && !apr_threadkey_private_set(NULL, pools->thread_pool))
+        return data;
+    }
+#endif
+
+  err = acquire_pool_internal(&pool, pools);
   if (err)
     {
       /* Mutex failure?!  Well, try to continue with unrecycled data. */
       svn_error_clear(err);
-      pool = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      pool = create_root_pool();
     }
 
   return pool;
@@ -96,6 +157,18 @@ svn_root_pools__release_pool(apr_pool_t *pool,
 
   svn_pool_clear(pool);
 
+#if APR_HAS_THREADS
+  /* Cache POOL for the current thread, unless it already has one. */
+  if (pools->thread_pool)
+    {
+      void *data = NULL;
+      if (   !apr_threadkey_private_get(&data, pools->thread_pool)
+          && !data
+          && !apr_threadkey_private_set(pool, pools->thread_pool))
+        return;
+    }
+#endif
+
   err = svn_mutex__lock(pools->mutex);
   if (err)
     {
@@ -104,7 +177,15 @@ svn_root_pools__release_pool(apr_pool_t *pool,
     }
   else
     {
-      APR_ARRAY_PUSH(pools->unused_pools, apr_pool_t *) = pool;
+      if (pools->unused_pools->nelts < MAX_UNUSED_POOLS)
+        {
+          APR_ARRAY_PUSH(pools->unused_pools, apr_pool_t *) = pool;
+          pool = NULL;
+        }
       svn_error_clear(svn_mutex__unlock(pools->mutex, SVN_NO_ERROR));
+
+      /* The shared collection is full.  Release the memory. */
+      if (pool)
+        svn_pool_destroy(pool);
     }
 }
@@ -0,0 +1,614 @@
+/*
+ * sha1.c :  SHA-1 implementation with hardware acceleration
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_sorts.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_dep_compat.h"
+
+#include "sha1.h"
+
+/* Select the hardware implementations that this compiler can produce.
+ *
+ * The x86 SHA extensions are not part of any base instruction set, so
+ * the respective code gets compiled for that extension only and will be
+ * used only if CPUID reports it.  ARMv8 crypto extensions are used
+ * unconditionally if the compiler targets them anyway.  Otherwise, we
+ * ask the Linux kernel whether the CPU supports them.
+ *
+ * Define SVN_DISABLE_SIMD to use the portable implementation only.
+ */
+#ifndef SVN_DISABLE_SIMD
+
+#if (defined(__x86_64__) || defined(__i386__)) \
+    && (   (defined(__clang__) \
+            && (__clang_major__ > 3 \
+                || (__clang_major__ == 3 && __clang_minor__ >= 8))) \
+        || (!defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 5))
+#  define SHA1_X86 1
+#  define SHA1_X86_TARGET __attribute__((target("sha,ssse3")))
+#  include <cpuid.h>
+#  include <immintrin.h>
+#elif defined(_MSC_VER) && _MSC_VER >= 1900 \
+      && (defined(_M_X64) || defined(_M_IX86))
+#  define SHA1_X86 1
+#  define SHA1_X86_TARGET
+#  include <intrin.h>
+#  include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) \
+    && (defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_SHA2))
+#  define SHA1_ARMV8 1
+#  define SHA1_ARMV8_TARGET
+#  include <arm_neon.h>
+#elif defined(__aarch64__) && defined(__linux__) \
+      && !defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 7
+#  define SHA1_ARMV8 1
+#  define SHA1_ARMV8_DETECT 1
+#  define SHA1_ARMV8_TARGET __attribute__((target("+crypto")))
+#  include <arm_neon.h>
+#  include <sys/auxv.h>
+#  include <asm/hwcap.h>
+#endif
+
+#endif /* SVN_DISABLE_SIMD */
+
+/* Signature of the functions processing BLOCKS complete blocks of DATA
+ * and updating the hash value in STATE accordingly. */
+typedef void (*sha1_blocks_func_t)(apr_uint32_t state[5],
+                                   const unsigned char *data,
+                                   apr_size_t blocks);
+
+/* Rotate X by N bits to the left. */
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* Read a 32 bit big-endian value from P. */
+#define LOAD_BE32(p) (  ((apr_uint32_t)(p)[0] << 24) \
+                      | ((apr_uint32_t)(p)[1] << 16) \
+                      | ((apr_uint32_t)(p)[2] <<  8) \
+                      |  (apr_uint32_t)(p)[3])
+
+/* The SHA-1 round constants. */
+#define K0 0x5a827999
+#define K1 0x6ed9eba1
+#define K2 0x8f1bbcdc
+#define K3 0xca62c1d6
+
+/* Implement sha1_blocks_func_t in portable C, following FIPS 180-4. */
+static void
+sha1_blocks_generic(apr_uint32_t state[5],
+                    const unsigned char *data,
+                    apr_size_t blocks)
+{
+  apr_uint32_t w[80];
+  int i;
+
+  for (; blocks > 0; --blocks, data += SVN_SHA1__BLOCK_SIZE)
+    {
+      apr_uint32_t a = state[0];
+      apr_uint32_t b = state[1];
+      apr_uint32_t c = state[2];
+      apr_uint32_t d = state[3];
+      apr_uint32_t e = state[4];
+      apr_uint32_t t;
+
+      for (i = 0; i < 16; ++i)
+        w[i] = LOAD_BE32(data + 4 * i);
+      for (; i < 80; ++i)
+        {
+          t = w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16];
+          w[i] = ROTL(t, 1);
+        }
+
+      for (i = 0; i < 80; ++i)
+        {
+          if (i < 20)
+            t = ((b & c) | (~b & d)) + K0;
+          else if (i < 40)
+            t = (b ^ c ^ d) + K1;
+          else if (i < 60)
+            t = ((b & c) | (b & d) | (c & d)) + K2;
+          else
+            t = (b ^ c ^ d) + K3;
+
+          t += ROTL(a, 5) + e + w[i];
+          e = d;
+          d = c;
+          c = ROTL(b, 30);
+          b = a;
+          a = t;
+        }
+
+      state[0] += a;
+      state[1] += b;
+      state[2] += c;
+      state[3] += d;
+      state[4] += e;
+    }
+}
+
+#ifdef SHA1_X86
+
+/* Four rounds using the x86 SHA extensions.  Advance E_IN by the next
+ * four message words MSG, remember the current ABCD in E_OUT for the
+ * next group and apply the round function number FUNC. */
+#define X86_ROUNDS4(e_in, e_out, msg, func)          \
+  do                                                 \
+    {                                                \
+      e_in = _mm_sha1nexte_epu32(e_in, msg);         \
+      e_out = abcd;                                  \
+      abcd = _mm_sha1rnds4_epu32(abcd, e_in, func);  \
+    }                                                \
+  while (0)
+
+/* Implement sha1_blocks_func_t using the x86 SHA extensions.
+ *
+ * Each group of four rounds consumes one of the MSG0 .. MSG3 registers
+ * while the future message words get calculated from them in the same
+ * round-robin fashion. */
+static SHA1_X86_TARGET void
+sha1_blocks_x86(apr_uint32_t state[5],
+                const unsigned char *data,
+                apr_size_t blocks)
+{
+  const __m128i mask = _mm_set_epi64x(0x0001020304050607LL,
+                                      0x08090a0b0c0d0e0fLL);
+  __m128i abcd, abcd_save, e0, e1, e_save;
+  __m128i msg0, msg1, msg2, msg3;
+
+  abcd = _mm_loadu_si128((const __m128i *)state);
+  abcd = _mm_shuffle_epi32(abcd, 0x1b);
+  e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+
+  for (; blocks > 0; --blocks, data += SVN_SHA1__BLOCK_SIZE)
+    {
+      abcd_save = abcd;
+      e_save = e0;
+
+      msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), mask);
+      msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16)),
+                              mask);
+      msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 32)),
+                              mask);
+      msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 48)),
+                              mask);
+
+      /* Rounds 0-3 */
+      e0 = _mm_add_epi32(e0, msg0);
+      e1 = abcd;
+      abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+      /* Rounds 4-19 */
+      X86_ROUNDS4(e1, e0, msg1, 0);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+      X86_ROUNDS4(e0, e1, msg2, 0);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      X86_ROUNDS4(e1, e0, msg3, 0);
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      X86_ROUNDS4(e0, e1, msg0, 0);
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      /* Rounds 20-39 */
+      X86_ROUNDS4(e1, e0, msg1, 1);
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      X86_ROUNDS4(e0, e1, msg2, 1);
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      X86_ROUNDS4(e1, e0, msg3, 1);
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      X86_ROUNDS4(e0, e1, msg0, 1);
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      X86_ROUNDS4(e1, e0, msg1, 1);
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      /* Rounds 40-59 */
+      X86_ROUNDS4(e0, e1, msg2, 2);
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      X86_ROUNDS4(e1, e0, msg3, 2);
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      X86_ROUNDS4(e0, e1, msg0, 2);
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      X86_ROUNDS4(e1, e0, msg1, 2);
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      X86_ROUNDS4(e0, e1, msg2, 2);
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+      msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+      msg0 = _mm_xor_si128(msg0, msg2);
+
+      /* Rounds 60-79 */
+      X86_ROUNDS4(e1, e0, msg3, 3);
+      msg0 = _mm_sha1msg2_epu32(msg0, msg3);
+      msg2 = _mm_sha1msg1_epu32(msg2, msg3);
+      msg1 = _mm_xor_si128(msg1, msg3);
+
+      X86_ROUNDS4(e0, e1, msg0, 3);
+      msg1 = _mm_sha1msg2_epu32(msg1, msg0);
+      msg3 = _mm_sha1msg1_epu32(msg3, msg0);
+      msg2 = _mm_xor_si128(msg2, msg0);
+
+      X86_ROUNDS4(e1, e0, msg1, 3);
+      msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+      msg3 = _mm_xor_si128(msg3, msg1);
+
+      X86_ROUNDS4(e0, e1, msg2, 3);
+      msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+
+      X86_ROUNDS4(e1, e0, msg3, 3);
+
+      /* Add this block's result to the hash value. */
+      e0 = _mm_sha1nexte_epu32(e0, e_save);
+      abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+  abcd = _mm_shuffle_epi32(abcd, 0x1b);
+  _mm_storeu_si128((__m128i *)state, abcd);
+  state[4] = (apr_uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(e0, 12));
+}
+
+/* Return TRUE if the CPU supports the SSSE3 and SHA instructions. */
+static svn_boolean_t
+x86_has_sha(void)
+{
+#ifdef _MSC_VER
+  int regs[4];
+
+  __cpuid(regs, 0);
+  if (regs[0] < 7)
+    return FALSE;
+
+  __cpuid(regs, 1);
+  if (!(regs[2] & (1 << 9)))
+    return FALSE;
+
+  __cpuidex(regs, 7, 0);
+  return (regs[1] & (1 << 29)) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+
+  if (__get_cpuid_max(0, NULL) < 7)
+    return FALSE;
+
+  __cpuid(1, eax, ebx, ecx, edx);
+  if (!(ecx & bit_SSSE3))
+    return FALSE;
+
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return (ebx & (1 << 29)) != 0;
+#endif
+}
+
+#endif /* SHA1_X86 */
+
+#ifdef SHA1_ARMV8
+
+/* Four rounds using the ARMv8 crypto extensions.  The hash value of
+ * E_IN gets consumed together with the round constant-adjusted message
+ * words in TMP.  E_OUT receives the value for the next group.  OP is
+ * one of the vsha1?q_u32 round functions. */
+#define ARM_ROUNDS4(e_in, e_out, tmp, op)          \
+  do                                               \
+    {                                              \
+      e_out = vsha1h_u32(vgetq_lane_u32(abcd, 0)); \
+      abcd = op(abcd, e_in, tmp);                  \
+    }                                              \
+  while (0)
+
+/* Implement sha1_blocks_func_t using the ARMv8 crypto extensions.
+ * This follows the same round-robin scheme as sha1_blocks_x86. */
+static SHA1_ARMV8_TARGET void
+sha1_blocks_armv8(apr_uint32_t state[5],
+                  const unsigned char *data,
+                  apr_size_t blocks)
+{
+  const uint32x4_t k0 = vdupq_n_u32(K0);
+  const uint32x4_t k1 = vdupq_n_u32(K1);
+  const uint32x4_t k2 = vdupq_n_u32(K2);
+  const uint32x4_t k3 = vdupq_n_u32(K3);
+  uint32x4_t abcd, abcd_save;
+  uint32x4_t msg0, msg1, msg2, msg3, tmp0, tmp1;
+  uint32_t e0, e1, e_save;
+
+  abcd = vld1q_u32(state);
+  e0 = state[4];
+
+  for (; blocks > 0; --blocks, data += SVN_SHA1__BLOCK_SIZE)
+    {
+      abcd_save = abcd;
+      e_save = e0;
+
+      msg0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data)));
+      msg1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16)));
+      msg2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 32)));
+      msg3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 48)));
+
+      tmp0 = vaddq_u32(msg0, k0);
+      tmp1 = vaddq_u32(msg1, k0);
+
+      /* Rounds 0-19 */
+      ARM_ROUNDS4(e0, e1, tmp0, vsha1cq_u32);
+      tmp0 = vaddq_u32(msg2, k0);
+      msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+      ARM_ROUNDS4(e1, e0, tmp1, vsha1cq_u32);
+      tmp1 = vaddq_u32(msg3, k0);
+      msg0 = vsha1su1q_u32(msg0, msg3);
+      msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+
+      ARM_ROUNDS4(e0, e1, tmp0, vsha1cq_u32);
+      tmp0 = vaddq_u32(msg0, k0);
+      msg1 = vsha1su1q_u32(msg1, msg0);
+      msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+
+      ARM_ROUNDS4(e1, e0, tmp1, vsha1cq_u32);
+      tmp1 = vaddq_u32(msg1, k1);
+      msg2 = vsha1su1q_u32(msg2, msg1);
+      msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+
+      ARM_ROUNDS4(e0, e1, tmp0, vsha1cq_u32);
+      tmp0 = vaddq_u32(msg2, k1);
+      msg3 = vsha1su1q_u32(msg3, msg2);
+      msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+      /* Rounds 20-39 */
+      ARM_ROUNDS4(e1, e0, tmp1, vsha1pq_u32);
+      tmp1 = vaddq_u32(msg3, k1);
+      msg0 = vsha1su1q_u32(msg0, msg3);
+      msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+
+      ARM_ROUNDS4(e0, e1, tmp0, vsha1pq_u32);
+      tmp0 = vaddq_u32(msg0, k1);
+      msg1 = vsha1su1q_u32(msg1, msg0);
+      msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+
+      ARM_ROUNDS4(e1, e0, tmp1, vsha1pq_u32);
+      tmp1 = vaddq_u32(msg1, k1);
+      msg2 = vsha1su1q_u32(msg2, msg1);
+      msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+
+      ARM_ROUNDS4(e0, e1, tmp0, vsha1pq_u32);
+      tmp0 = vaddq_u32(msg2, k2);
+      msg3 = vsha1su1q_u32(msg3, msg2);
+      msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+      ARM_ROUNDS4(e1, e0, tmp1, vsha1pq_u32);
+      tmp1 = vaddq_u32(msg3, k2);
+      msg0 = vsha1su1q_u32(msg0, msg3);
+      msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+
+      /* Rounds 40-59 */
+      ARM_ROUNDS4(e0, e1, tmp0, vsha1mq_u32);
+      tmp0 = vaddq_u32(msg0, k2);
+      msg1 = vsha1su1q_u32(msg1, msg0);
+      msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+
+      ARM_ROUNDS4(e1, e0, tmp1, vsha1mq_u32);
+      tmp1 = vaddq_u32(msg1, k2);
+      msg2 = vsha1su1q_u32(msg2, msg1);
+      msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+
+      ARM_ROUNDS4(e0, e1, tmp0, vsha1mq_u32);
+      tmp0 = vaddq_u32(msg2, k2);
+      msg3 = vsha1su1q_u32(msg3, msg2);
+      msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+      ARM_ROUNDS4(e1, e0, tmp1, vsha1mq_u32);
+      tmp1 = vaddq_u32(msg3, k3);
+      msg0 = vsha1su1q_u32(msg0, msg3);
+      msg1 = vsha1su0q_u32(msg1, msg2, msg3);
+
+      ARM_ROUNDS4(e0, e1, tmp0, vsha1mq_u32);
+      tmp0 = vaddq_u32(msg0, k3);
+      msg1 = vsha1su1q_u32(msg1, msg0);
+      msg2 = vsha1su0q_u32(msg2, msg3, msg0);
+
+      /* Rounds 60-79 */
+      ARM_ROUNDS4(e1, e0, tmp1, vsha1pq_u32);
+      tmp1 = vaddq_u32(msg1, k3);
+      msg2 = vsha1su1q_u32(msg2, msg1);
+      msg3 = vsha1su0q_u32(msg3, msg0, msg1);
+
+      ARM_ROUNDS4(e0, e1, tmp0, vsha1pq_u32);
+      tmp0 = vaddq_u32(msg2, k3);
+      msg3 = vsha1su1q_u32(msg3, msg2);
+
+      ARM_ROUNDS4(e1, e0, tmp1, vsha1pq_u32);
+      tmp1 = vaddq_u32(msg3, k3);
+
+      ARM_ROUNDS4(e0, e1, tmp0, vsha1pq_u32);
+
+      ARM_ROUNDS4(e1, e0, tmp1, vsha1pq_u32);
+
+      /* Add this block's result to the hash value. */
+      e0 += e_save;
+      abcd = vaddq_u32(abcd, abcd_save);
+    }
+
+  vst1q_u32(state, abcd);
+  state[4] = e0;
+}
+
+/* Return TRUE if the CPU supports the ARMv8 SHA-1 instructions. */
+static svn_boolean_t
+armv8_has_sha1(void)
+{
+#ifdef SHA1_ARMV8_DETECT
+  return (getauxval(AT_HWCAP) & HWCAP_SHA1) != 0;
+#else
+  return TRUE;
+#endif
+}
+
+#endif /* SHA1_ARMV8 */
+
+/* The block function selected for this CPU.
+ * Set by select_implementation. */
+static sha1_blocks_func_t sha1_blocks = sha1_blocks_generic;
+
+/* Implement svn_atomic__str_init_func_t.
+ * Select the fastest block function supported by this CPU. */
+static const char *
+select_implementation(void *baton)
+{
+#ifdef SHA1_X86
+  if (x86_has_sha())
+    sha1_blocks = sha1_blocks_x86;
+#endif
+#ifdef SHA1_ARMV8
+  if (armv8_has_sha1())
+    sha1_blocks = sha1_blocks_armv8;
+#endif
+
+  return NULL;
+}
+
+/* Make sure that sha1_blocks has been selected. */
+static void
+ensure_initialized(void)
+{
+  static volatile svn_atomic_t init_state = 0;
+  svn_atomic__init_once_no_error(&init_state, select_implementation, NULL);
+}
+
+void
+svn_sha1__init(svn_sha1__context_t *context)
+{
+  ensure_initialized();
+
+  context->state[0] = 0x67452301;
+  context->state[1] = 0xefcdab89;
+  context->state[2] = 0x98badcfe;
+  context->state[3] = 0x10325476;
+  context->state[4] = 0xc3d2e1f0;
+  context->length = 0;
+}
+
+void
+svn_sha1__update(svn_sha1__context_t *context,
+                 const void *data,
+                 apr_size_t len)
+{
+  const unsigned char *input = data;
+  apr_size_t buffered = (apr_size_t)(context->length
+                                     % SVN_SHA1__BLOCK_SIZE);
+
+  context->length += len;
+
+  /* Complete a partial block from previous calls. */
+  if (buffered)
+    {
+      apr_size_t to_copy = MIN(len, SVN_SHA1__BLOCK_SIZE - buffered);
+      memcpy(context->buffer + buffered, input, to_copy);
+      if (buffered + to_copy < SVN_SHA1__BLOCK_SIZE)
+        return;
+
+      sha1_blocks(context->state, context->buffer, 1);
+      input += to_copy;
+      len -= to_copy;
+    }
+
+  /* Process all complete blocks directly from the input buffer. */
+  if (len >= SVN_SHA1__BLOCK_SIZE)
+    {
+      apr_size_t blocks = len / SVN_SHA1__BLOCK_SIZE;
+      sha1_blocks(context->state, input, blocks);
+      input += blocks * SVN_SHA1__BLOCK_SIZE;
+      len -= blocks * SVN_SHA1__BLOCK_SIZE;
+    }
+
+  /* Keep the remainder for later. */
+  if (len)
+    memcpy(context->buffer, input, len);
+}
+
+void
+svn_sha1__final(unsigned char digest[SVN_SHA1__DIGEST_SIZE],
+                svn_sha1__context_t *context)
+{
+  apr_uint64_t bits = context->length * 8;
+  apr_size_t buffered = (apr_size_t)(context->length
+                                     % SVN_SHA1__BLOCK_SIZE);
+  int i;
+
+  /* Append the 0x80 terminator, zero padding and the 64 bit message
+   * length, spilling into an extra block if necessary. */
+  context->buffer[buffered++] = 0x80;
+  if (buffered > SVN_SHA1__BLOCK_SIZE - 8)
+    {
+      memset(context->buffer + buffered, 0,
+             SVN_SHA1__BLOCK_SIZE - buffered);
+      sha1_blocks(context->state, context->buffer, 1);
+      buffered = 0;
+    }
+
+  memset(context->buffer + buffered, 0,
+         SVN_SHA1__BLOCK_SIZE - 8 - buffered);
+  for (i = 0; i < 8; ++i)
+    context->buffer[SVN_SHA1__BLOCK_SIZE - 1 - i]
+      = (unsigned char)(bits >> (8 * i));
+
+  sha1_blocks(context->state, context->buffer, 1);
+
+  for (i = 0; i < 5; ++i)
+    {
+      digest[4 * i]     = (unsigned char)(context->state[i] >> 24);
+      digest[4 * i + 1] = (unsigned char)(context->state[i] >> 16);
+      digest[4 * i + 2] = (unsigned char)(context->state[i] >> 8);
+      digest[4 * i + 3] = (unsigned char)(context->state[i]);
+    }
+}
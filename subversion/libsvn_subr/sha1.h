@@ -0,0 +1,81 @@
+/*
+ * sha1.h :  SHA-1 implementation with hardware acceleration
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef SVN_LIBSVN_SUBR_SHA1_H
+#define SVN_LIBSVN_SUBR_SHA1_H
+
+#include <apr.h>
+
+#include "svn_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/* Size of a SHA-1 digest in bytes. */
+#define SVN_SHA1__DIGEST_SIZE 20
+
+/* SHA-1 processes data in blocks of this many bytes. */
+#define SVN_SHA1__BLOCK_SIZE 64
+
+/* SHA-1 checksum creation context.  The block function gets selected
+ * at runtime and uses the SHA instructions of the CPU, if available.
+ * This struct is public to allow for allocation on the stack only.
+ */
+typedef struct svn_sha1__context_t
+{
+  /* Intermediate hash value. */
+  apr_uint32_t state[5];
+
+  /* Number of bytes fed into the context so far. */
+  apr_uint64_t length;
+
+  /* Data of the current, incomplete block.  Its length is given by
+   * LENGTH modulo SVN_SHA1__BLOCK_SIZE. */
+  unsigned char buffer[SVN_SHA1__BLOCK_SIZE];
+} svn_sha1__context_t;
+
+/* Initialize the SHA-1 checksum creation CONTEXT.
+ */
+void
+svn_sha1__init(svn_sha1__context_t *context);
+
+/* Feed LEN bytes from DATA into the SHA-1 checksum creation CONTEXT.
+ */
+void
+svn_sha1__update(svn_sha1__context_t *context,
+                 const void *data,
+                 apr_size_t len);
+
+/* Write the SHA-1 digest over all data fed into CONTEXT to DIGEST.
+ * CONTEXT must be re-initialized before it can be used again.
+ */
+void
+svn_sha1__final(unsigned char digest[SVN_SHA1__DIGEST_SIZE],
+                svn_sha1__context_t *context);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* SVN_LIBSVN_SUBR_SHA1_H */
@@ -720,6 +720,135 @@ svn_skel__parse_proplist(apr_hash_t **proplist_p,
   return SVN_NO_ERROR;
 }
 
+/* Scan the next element of a proplist skel starting at *DATA and ending
+   before END.  If it is an atom, set *ATOM and *ATOM_LEN to its contents,
+   advance *DATA past it and return 1.  At the closing paren of the list,
+   advance *DATA past it and return 0.  Return -1 for anything else,
+   i.e. sub-lists and malformed data.  */
+static int
+next_proplist_atom(const char **atom,
+                   apr_size_t *atom_len,
+                   const char **data,
+                   const char *end)
+{
+  const char *p = *data;
+
+  /* Skip any whitespace.  */
+  while (p < end && skel_char_type[(unsigned char) *p] == type_space)
+    p++;
+
+  /* End of data, but no closing paren?  */
+  if (p >= end)
+    return -1;
+
+  /* End of list?  */
+  if (*p == ')')
+    {
+      *data = p + 1;
+      return 0;
+    }
+
+  /* Sub-lists are not allowed.  */
+  if (*p == '(')
+    return -1;
+
+  if (skel_char_type[(unsigned char) *p] == type_name)
+    {
+      /* Implicit length; same as implicit_atom().  */
+      *atom = p;
+      while (++p < end
+             && skel_char_type[(unsigned char) *p] != type_space
+             && skel_char_type[(unsigned char) *p] != type_paren)
+        ;
+      *atom_len = p - *atom;
+    }
+  else
+    {
+      /* Explicit length; same as explicit_atom().  */
+      const char *next;
+      apr_size_t size = getsize(p, end - p, &next, end - p);
+
+      if (! next)
+        return -1;
+
+      p = next;
+      if (p >= end || skel_char_type[(unsigned char) *p] != type_space)
+        return -1;
+      p++;
+
+      if (end - p < size)
+        return -1;
+
+      *atom = p;
+      *atom_len = size;
+      p += size;
+    }
+
+  *data = p;
+  return 1;
+}
+
+svn_error_t *
+svn_skel__parse_proplist_data(apr_hash_t **proplist_p,
+                              const char *data,
+                              apr_size_t len,
+                              apr_pool_t *result_pool)
+{
+  const char *end = data + len;
+  const char *p;
+  const char *atom;
+  apr_size_t atom_len;
+  apr_size_t count = 0;
+  apr_size_t total = 0;
+  int status;
+  char *buffer;
+  svn_string_t *values;
+  apr_hash_t *proplist;
+
+  if (len == 0 || *data != '(')
+    return skel_err("proplist");
+
+  /* First pass: validate and determine the memory required. */
+  p = data + 1;
+  while ((status = next_proplist_atom(&atom, &atom_len, &p, end)) > 0)
+    {
+      total += atom_len + 1;
+      ++count;
+    }
+
+  if (status < 0 || (count & 1))
+    return skel_err("proplist");
+
+  /* Second pass: copy all names and values into a single block. */
+  proplist = apr_hash_make(result_pool);
+  buffer = apr_palloc(result_pool, total);
+  values = apr_palloc(result_pool, count / 2 * sizeof(*values));
+
+  p = data + 1;
+  while (next_proplist_atom(&atom, &atom_len, &p, end) > 0)
+    {
+      const char *name = buffer;
+      apr_size_t name_len = atom_len;
+
+      memcpy(buffer, atom, atom_len);
+      buffer[atom_len] = '\0';
+      buffer += atom_len + 1;
+
+      /* Validated above, so there is always a value. */
+      next_proplist_atom(&atom, &atom_len, &p, end);
+      memcpy(buffer, atom, atom_len);
+      buffer[atom_len] = '\0';
+      values->data = buffer;
+      values->len = atom_len;
+      buffer += atom_len + 1;
+
+      apr_hash_set(proplist, name, name_len, values++);
+    }
+
+  *proplist_p = proplist;
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_skel__parse_iprops(apr_array_header_t **iprops,
                        const svn_skel_t *skel,
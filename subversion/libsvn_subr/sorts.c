@@ -27,6 +27,7 @@
 #include <apr_hash.h>
 #include <apr_tables.h>
 #include <stdlib.h>       /* for qsort()   */
+#include <string.h>
 #include <assert.h>
 #include "svn_hash.h"
 #include "svn_path.h"
@@ -134,12 +135,147 @@ svn_sort_compare_ranges(const void *a, const void *b)
   return item1->start < item2->start ? -1 : 1;
 }
 
+
+
+/*** Path sorting ***/
+
+/* Sorting paths is common enough to warrant a specialized algorithm.
+   qsort() has to call svn_path_compare_paths() for every comparison,
+   which scans the common prefix of both paths again and again.  Instead,
+   we use a multi-key quicksort (Bentley & Sedgewick): partition by a
+   single character at a time and only look at the next character within
+   the partition of equal ones.  Each character gets inspected about
+   log(N) times.
+
+   The functions below work on arrays with elements of at most
+   sizeof(svn_sort__item_t) bytes that start with a NUL-terminated path.
+   That covers arrays of const char * as well as of svn_sort__item_t.
+ */
+
+/* Partitions with fewer elements than this get sorted by insertion sort. */
+#define PATH_SORT_THRESHOLD 16
+
+/* The path at index IDX of an array at BASE with ELT_SIZE bytes per
+   element. */
+#define PATH_AT(base, elt_size, idx) \
+  (*(const char * const *)((base) + (apr_size_t)(idx) * (elt_size)))
+
+/* Return the sort key of the path character C.  The terminating NUL maps
+   to 0 and '/' to 1, so that ordering paths by these keys matches
+   svn_path_compare_paths(). */
+static APR_INLINE int
+path_char_key(char c)
+{
+  if (c == '/')
+    return 1;
+
+  return c ? (unsigned char)c + 1 : 0;
+}
+
+/* Compare paths LHS and RHS like svn_path_compare_paths() but only
+   starting at offset DEPTH.  The first DEPTH characters must be equal. */
+static int
+compare_paths_from(const char *lhs,
+                   const char *rhs,
+                   apr_size_t depth)
+{
+  lhs += depth;
+  rhs += depth;
+  while (*lhs && *lhs == *rhs)
+    {
+      ++lhs;
+      ++rhs;
+    }
+
+  return path_char_key(*lhs) - path_char_key(*rhs);
+}
+
+/* Exchange the elements LHS and RHS of the array at BASE with ELT_SIZE
+   bytes per element. */
+static APR_INLINE void
+swap_elements(char *base,
+              apr_size_t elt_size,
+              int lhs,
+              int rhs)
+{
+  char temp[sizeof(svn_sort__item_t)];
+  char *lhs_value = base + (apr_size_t)lhs * elt_size;
+  char *rhs_value = base + (apr_size_t)rhs * elt_size;
+
+  if (lhs == rhs)
+    return;
+
+  memcpy(temp, lhs_value, elt_size);
+  memcpy(lhs_value, rhs_value, elt_size);
+  memcpy(rhs_value, temp, elt_size);
+}
+
+/* Sort the NELTS elements of ELT_SIZE bytes at BASE by their paths.
+   All paths must be equal up to offset DEPTH. */
+static void
+sort_paths(char *base,
+           int nelts,
+           apr_size_t elt_size,
+           apr_size_t depth)
+{
+  int i, k;
+
+  while (nelts >= PATH_SORT_THRESHOLD)
+    {
+      int lt = 0;
+      int gt = nelts;
+      int pivot;
+
+      /* Use the middle element as pivot.  Input is often sorted already
+         and the first one would be the worst possible choice then. */
+      swap_elements(base, elt_size, 0, nelts / 2);
+      pivot = path_char_key(PATH_AT(base, elt_size, 0)[depth]);
+
+      /* Partition into [0, LT) less than, [LT, GT) equal to and
+         [GT, NELTS) greater than PIVOT. */
+      i = 0;
+      while (i < gt)
+        {
+          int key = path_char_key(PATH_AT(base, elt_size, i)[depth]);
+
+          if (key < pivot)
+            swap_elements(base, elt_size, lt++, i++);
+          else if (key > pivot)
+            swap_elements(base, elt_size, i, --gt);
+          else
+            ++i;
+        }
+
+      sort_paths(base, lt, elt_size, depth);
+
+      /* Equal paths need no further sorting once they ended. */
+      if (pivot != 0)
+        sort_paths(base + (apr_size_t)lt * elt_size, gt - lt, elt_size,
+                   depth + 1);
+
+      base += (apr_size_t)gt * elt_size;
+      nelts -= gt;
+    }
+
+  for (i = 1; i < nelts; ++i)
+    for (k = i;
+         k > 0 && compare_paths_from(PATH_AT(base, elt_size, k - 1),
+                                     PATH_AT(base, elt_size, k),
+                                     depth) > 0;
+         --k)
+      swap_elements(base, elt_size, k - 1, k);
+}
+
 void
 svn_sort__array(apr_array_header_t *array,
                 int (*comparison_func)(const void *,
                                        const void *))
 {
-  qsort(array->elts, array->nelts, array->elt_size, comparison_func);
+  if (   comparison_func == svn_sort_compare_paths
+      && array->elt_size == sizeof(const char *))
+    sort_paths(array->elts, array->nelts, array->elt_size, 0);
+  else
+    qsort(array->elts, array->nelts, array->elt_size, comparison_func);
 }
 
 apr_array_header_t *
@@ -179,7 +315,9 @@ svn_sort__hash(apr_hash_t *ht,
     }
 
   /* quicksort the array if it isn't already sorted.  */
-  if (!sorted)
+  if (!sorted && comparison_func == svn_sort_compare_items_as_paths)
+    sort_paths(ary->elts, ary->nelts, ary->elt_size, 0);
+  else if (!sorted)
     svn_sort__array(ary,
           (int (*)(const void *, const void *))comparison_func);
 
@@ -425,6 +563,18 @@ heap_swap(svn_priority_queue__t *queue,
   char *lhs_value = queue->elements->elts + lhs * queue->elements->elt_size;
   char *rhs_value = queue->elements->elts + rhs * queue->elements->elt_size;
 
+  /* Most queues hold pointers.  Move those as a whole instead of byte by
+     byte; the compiler turns these memcpy()s into plain loads and stores. */
+  if (queue->elements->elt_size == sizeof(void *))
+    {
+      void *temp;
+
+      memcpy(&temp, lhs_value, sizeof(temp));
+      memcpy(lhs_value, rhs_value, sizeof(temp));
+      memcpy(rhs_value, &temp, sizeof(temp));
+      return;
+    }
+
   for (i = 0; i < queue->elements->elt_size; ++i)
     {
       char temp = lhs_value[i];
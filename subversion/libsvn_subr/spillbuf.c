@@ -22,6 +22,7 @@
  */
 
 #include <apr_file_io.h>
+#include <apr_mmap.h>
 
 #include "svn_io.h"
 #include "svn_pools.h"
@@ -29,6 +30,17 @@
 #include "private/svn_subr_private.h"
 
 
+/* Only map the spill file for reading when at least this much content
+   remains in it.  Smaller spills are read faster through the file.  */
+#define SPILL_MMAP_THRESHOLD 0x100000
+
+/* Map at most this much of the spill file at once, starting at an offset
+   that is a multiple of SPILL_MMAP_ALIGNMENT.  The latter must be a
+   multiple of the page size (and of the allocation granularity on
+   Windows).  */
+#define SPILL_MMAP_WINDOW 0x1000000
+#define SPILL_MMAP_ALIGNMENT 0x10000
+
 struct memblock_t {
   apr_size_t size;
   char *data;
@@ -74,6 +86,19 @@ struct svn_spillbuf_t {
   /* How much content remains in SPILL.  */
   svn_filesize_t spill_size;
 
+  /* The current position of the file pointer of SPILL, or -1 if unknown.
+     Seeking flushes APR's write buffer, so we only do it when a read
+     has actually moved the file pointer away from where we need it.  */
+  apr_off_t spill_pos;
+
+#if APR_HAS_MMAP
+  /* A read-only mapping of part of SPILL, starting at SPILL_MAP_OFFSET,
+     or NULL.  Once SPILL_MAP_FAILED is set, we no longer try to map.  */
+  apr_mmap_t *spill_map;
+  apr_off_t spill_map_offset;
+  svn_boolean_t spill_map_failed;
+#endif
+
   /* When false, do not delete the spill file when it is closed. */
   svn_boolean_t delete_on_close;
 
@@ -251,6 +276,7 @@ svn_spillbuf__write(svn_spillbuf_t *buf,
                                         ? svn_io_file_del_on_close
                                         : svn_io_file_del_none),
                                        buf->pool, scratch_pool));
+      buf->spill_pos = 0;
 
       /* Optionally write the memory contents into the file. */
       if (buf->spill_all_contents)
@@ -270,6 +296,7 @@ svn_spillbuf__write(svn_spillbuf_t *buf,
              the same chunk sizes as were written, so we'll leave this
              change for later.*/
           buf->spill_start = buf->memory_size;
+          buf->spill_pos = buf->memory_size;
         }
     }
 
@@ -278,17 +305,26 @@ svn_spillbuf__write(svn_spillbuf_t *buf,
      in memory.  */
   if (buf->spill != NULL)
     {
-      apr_off_t output_unused = 0;  /* ### stupid API  */
+      apr_off_t spill_end = buf->spill_start + buf->spill_size;
 
-      /* Seek to the end of the spill file. We don't know if a read has
-         occurred since our last write, and moved the file position.  */
-      SVN_ERR(svn_io_file_seek(buf->spill,
-                               APR_END, &output_unused,
-                               scratch_pool));
+      /* Seek to the end of the spill file, if a read has occurred since
+         our last write and moved the file position.  Consecutive writes
+         can then accumulate in APR's file buffer.  */
+      if (buf->spill_pos != spill_end)
+        {
+          apr_off_t output_unused = 0;  /* ### stupid API  */
+
+          buf->spill_pos = -1;
+          SVN_ERR(svn_io_file_seek(buf->spill,
+                                   APR_END, &output_unused,
+                                   scratch_pool));
+        }
 
+      buf->spill_pos = -1;
       SVN_ERR(svn_io_file_write_full(buf->spill, data, len,
                                      NULL, scratch_pool));
       buf->spill_size += len;
+      buf->spill_pos = spill_end + len;
 
       return SVN_NO_ERROR;
     }
@@ -344,6 +380,104 @@ svn_spillbuf__write(svn_spillbuf_t *buf,
 }
 
 
+#if APR_HAS_MMAP
+/* Make sure that BUF->SPILL_MAP covers the LEN bytes at BUF->SPILL_START,
+   if the remainder of the spill file is large enough to make mapping it
+   worthwhile.  Leave BUF->SPILL_MAP as NULL if we shall read through the
+   file instead.  */
+static svn_error_t *
+maybe_map_spill(svn_spillbuf_t *buf,
+                apr_size_t len,
+                apr_pool_t *scratch_pool)
+{
+  apr_off_t spill_end = buf->spill_start + buf->spill_size;
+  apr_off_t offset;
+  apr_off_t size;
+  apr_status_t status;
+
+  if (buf->spill_map != NULL)
+    {
+      if (buf->spill_start >= buf->spill_map_offset
+          && buf->spill_start + (apr_off_t)len
+               <= buf->spill_map_offset + (apr_off_t)buf->spill_map->size)
+        return SVN_NO_ERROR;
+
+      apr_mmap_delete(buf->spill_map);
+      buf->spill_map = NULL;
+    }
+
+  if (buf->spill_map_failed || buf->spill_size < SPILL_MMAP_THRESHOLD)
+    return SVN_NO_ERROR;
+
+  /* Map a window that covers at least the requested range.  */
+  offset = buf->spill_start - buf->spill_start % SPILL_MMAP_ALIGNMENT;
+  size = buf->spill_start - offset + (apr_off_t)len;
+  if (size < SPILL_MMAP_WINDOW)
+    size = SPILL_MMAP_WINDOW;
+  if (size > spill_end - offset)
+    size = spill_end - offset;
+
+  if ((apr_uint64_t)size > APR_SIZE_MAX)
+    {
+      buf->spill_map_failed = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  /* Data written recently may still sit in APR's file buffer.  */
+  SVN_ERR(svn_io_file_flush(buf->spill, scratch_pool));
+
+  status = apr_mmap_create(&buf->spill_map, buf->spill, offset,
+                           (apr_size_t)size, APR_MMAP_READ, buf->pool);
+  if (status)
+    {
+      /* Fall back to reading through the file for good.  */
+      buf->spill_map = NULL;
+      buf->spill_map_failed = TRUE;
+      return SVN_NO_ERROR;
+    }
+
+  buf->spill_map_offset = offset;
+  return SVN_NO_ERROR;
+}
+#endif
+
+/* Read *LEN bytes from BUF's spill file at BUF->SPILL_START into DATA.
+   Set *LEN to the number of bytes actually read.  */
+static svn_error_t *
+read_spill(char *data,
+           apr_size_t *len,
+           svn_spillbuf_t *buf,
+           apr_pool_t *scratch_pool)
+{
+#if APR_HAS_MMAP
+  SVN_ERR(maybe_map_spill(buf, *len, scratch_pool));
+  if (buf->spill_map != NULL)
+    {
+      memcpy(data,
+             (const char *)buf->spill_map->mm
+               + (buf->spill_start - buf->spill_map_offset),
+             *len);
+      return SVN_NO_ERROR;
+    }
+#endif
+
+  /* Seek to where we left off reading, unless we are already there.  */
+  if (buf->spill_pos != buf->spill_start)
+    {
+      apr_off_t offset = buf->spill_start;
+
+      buf->spill_pos = -1;
+      SVN_ERR(svn_io_file_seek(buf->spill, APR_SET, &offset, scratch_pool));
+    }
+
+  buf->spill_pos = -1;
+  SVN_ERR(svn_io_file_read(buf->spill, data, len, scratch_pool));
+  buf->spill_pos = buf->spill_start + *len;
+
+  return SVN_NO_ERROR;
+}
+
+
 /* Return a memblock of content, if any is available. *mem will be NULL if
    no further content is available. The memblock should eventually be
    passed to return_buffer() (or stored into buf->out_for_reading which
@@ -378,8 +512,6 @@ read_data(struct memblock_t **mem,
       return SVN_NO_ERROR;
     }
 
-  /* Assume that the caller has seeked the spill file to the correct pos.  */
-
   /* Get a buffer that we can read content into.  */
   *mem = get_buffer(buf);
   /* NOTE: mem's size/next are uninitialized.  */
@@ -391,8 +523,7 @@ read_data(struct memblock_t **mem,
   (*mem)->next = NULL;
 
   /* Read some data from the spill file into the memblock.  */
-  err = svn_io_file_read(buf->spill, (*mem)->data, &(*mem)->size,
-                         scratch_pool);
+  err = read_spill((*mem)->data, &(*mem)->size, buf, scratch_pool);
   if (err)
     {
       return_buffer(buf, *mem);
@@ -406,9 +537,17 @@ read_data(struct memblock_t **mem,
   if ((buf->spill_size -= (*mem)->size) == 0)
     {
       /* Close and reset our spill file information.  */
+#if APR_HAS_MMAP
+      if (buf->spill_map != NULL)
+        {
+          apr_mmap_delete(buf->spill_map);
+          buf->spill_map = NULL;
+        }
+#endif
       SVN_ERR(svn_io_file_close(buf->spill, scratch_pool));
       buf->spill = NULL;
       buf->spill_start = 0;
+      buf->spill_pos = 0;
     }
 
   /* *mem has been initialized. Done.  */
@@ -416,34 +555,6 @@ read_data(struct memblock_t **mem,
 }
 
 
-/* If the next read would consume data from the file, then seek to the
-   correct position.  */
-static svn_error_t *
-maybe_seek(svn_boolean_t *seeked,
-           const svn_spillbuf_t *buf,
-           apr_pool_t *scratch_pool)
-{
-  if (buf->head == NULL && buf->spill != NULL)
-    {
-      apr_off_t output_unused;
-
-      /* Seek to where we left off reading.  */
-      output_unused = buf->spill_start;  /* ### stupid API  */
-      SVN_ERR(svn_io_file_seek(buf->spill,
-                               APR_SET, &output_unused,
-                               scratch_pool));
-      if (seeked != NULL)
-        *seeked = TRUE;
-    }
-  else if (seeked != NULL)
-    {
-      *seeked = FALSE;
-    }
-
-  return SVN_NO_ERROR;
-}
-
-
 svn_error_t *
 svn_spillbuf__read(const char **data,
                    apr_size_t *len,
@@ -452,9 +563,6 @@ svn_spillbuf__read(const char **data,
 {
   struct memblock_t *mem;
 
-  /* Possibly seek... */
-  SVN_ERR(maybe_seek(NULL, buf, scratch_pool));
-
   SVN_ERR(read_data(&mem, buf, scratch_pool));
   if (mem == NULL)
     {
@@ -485,7 +593,6 @@ svn_spillbuf__process(svn_boolean_t *exhausted,
                       void *read_baton,
                       apr_pool_t *scratch_pool)
 {
-  svn_boolean_t has_seeked = FALSE;
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
 
   *exhausted = FALSE;
@@ -498,11 +605,6 @@ svn_spillbuf__process(svn_boolean_t *exhausted,
 
       svn_pool_clear(iterpool);
 
-      /* If this call to read_data() will read from the spill file, and we
-         have not seek'd the file... then do it now.  */
-      if (!has_seeked)
-        SVN_ERR(maybe_seek(&has_seeked, buf, iterpool));
-
       /* Get some content to pass to the read callback.  */
       SVN_ERR(read_data(&mem, buf, iterpool));
       if (mem == NULL)
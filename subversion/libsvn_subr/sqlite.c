@@ -669,7 +669,8 @@ svn_sqlite__column_properties(apr_hash_t **props,
   apr_size_t len;
   const void *val;
 
-  /* svn_skel__parse_proplist copies everything needed to result_pool */
+  /* svn_skel__parse_proplist_data copies everything needed to
+     result_pool */
   val = svn_sqlite__column_blob(stmt, column, &len, NULL);
   if (val == NULL)
     {
@@ -677,9 +678,7 @@ svn_sqlite__column_properties(apr_hash_t **props,
       return SVN_NO_ERROR;
     }
 
-  SVN_ERR(svn_skel__parse_proplist(props,
-                                   svn_skel__parse(val, len, scratch_pool),
-                                   result_pool));
+  SVN_ERR(svn_skel__parse_proplist_data(props, val, len, result_pool));
 
   return SVN_NO_ERROR;
 }
@@ -781,6 +780,33 @@ svn_sqlite__read_schema_version(int *version,
 }
 
 
+/* Use the TRUNCATE journal mode for DB unless it has been switched to
+   write-ahead logging by svn_sqlite__enable_wal().  Use SCRATCH_POOL for
+   temporary allocations. */
+static svn_error_t *
+set_default_journal_mode(svn_sqlite__db_t *db,
+                         apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t is_wal;
+
+  SVN_ERR(prepare_statement(&stmt, db, "PRAGMA journal_mode;", scratch_pool));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+  is_wal = (svn_cstring_casecmp(svn_sqlite__column_text(stmt, 0, NULL),
+                                "wal") == 0);
+  SVN_ERR(svn_sqlite__finalize(stmt));
+
+  /* The WAL mode is stored in the database and shared by all connections.
+     Leaving it requires exclusive access and would make clients with
+     different settings switch the mode back and forth.  So, keep it. */
+  if (is_wal)
+    return SVN_NO_ERROR;
+
+  /* Testing shows TRUNCATE is faster than DELETE on Windows. */
+  return svn_error_trace(exec_sql(db, "PRAGMA journal_mode = TRUNCATE;"));
+}
+
+
 static volatile svn_atomic_t sqlite_init_state = 0;
 
 /* If possible, verify that SQLite was compiled in a thread-safe
@@ -1164,11 +1190,11 @@ svn_sqlite__open(svn_sqlite__db_t **db, const char *path,
                  affects application(read: Subversion) performance/behavior. */
               "PRAGMA foreign_keys=OFF;"      /* SQLITE_DEFAULT_FOREIGN_KEYS*/
               "PRAGMA locking_mode = NORMAL;" /* SQLITE_DEFAULT_LOCKING_MODE */
-              /* Testing shows TRUNCATE is faster than DELETE on Windows. */
-              "PRAGMA journal_mode = TRUNCATE;"
               ),
                 *db);
 
+  SVN_SQLITE__ERR_CLOSE(set_default_journal_mode(*db, scratch_pool), *db);
+
 #if defined(SVN_DEBUG)
   /* When running in debug mode, enable the checking of foreign key
      constraints.  This has possible performance implications, so we don't
@@ -1232,6 +1258,44 @@ svn_sqlite__close(svn_sqlite__db_t *db)
   return svn_error_wrap_apr(result, NULL);
 }
 
+svn_error_t *
+svn_sqlite__set_cache_size(svn_sqlite__db_t *db,
+                           int kilobytes)
+{
+  char sql[64];
+
+  /* Negative values are sizes in KiB rather than numbers of pages. */
+  apr_snprintf(sql, sizeof(sql), "PRAGMA cache_size = -%d;", kilobytes);
+
+  return svn_error_trace(exec_sql(db, sql));
+}
+
+svn_error_t *
+svn_sqlite__enable_wal(svn_sqlite__db_t *db,
+                       apr_int64_t mmap_size)
+{
+  char sql[64];
+
+  /* Unlike the OFF we use by default, NORMAL syncs the log before each
+     checkpoint and thereby keeps the database consistent across power
+     failures.  With a write-ahead log, that is rare enough to be cheap. */
+  SVN_ERR(exec_sql(db, "PRAGMA journal_mode = WAL;"
+                       "PRAGMA synchronous = NORMAL;"));
+
+  /* Memory mapping may be disabled in the SQLite build; that's fine. */
+  apr_snprintf(sql, sizeof(sql), "PRAGMA mmap_size = %" APR_INT64_T_FMT ";",
+               mmap_size);
+  svn_error_clear(exec_sql(db, sql));
+
+  return SVN_NO_ERROR;
+}
+
+svn_boolean_t
+svn_sqlite__in_transaction(svn_sqlite__db_t *db)
+{
+  return !sqlite3_get_autocommit(db->db3);
+}
+
 static svn_error_t *
 reset_all_statements(svn_sqlite__db_t *db,
                      svn_error_t *error_to_wrap)
@@ -31,6 +31,9 @@
 #include <apr_errno.h>
 #include <apr_poll.h>
 #include <apr_portable.h>
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
 
 #include <zlib.h>
 
@@ -62,6 +65,8 @@ struct svn_stream_t {
   svn_stream_seek_fn_t seek_fn;
   svn_stream_data_available_fn_t data_available_fn;
   svn_stream_readline_fn_t readline_fn;
+  svn_stream__borrow_fn_t borrow_fn;
+  svn_stream__writev_fn_t writev_fn;
   apr_file_t *file; /* Maybe NULL */
 };
 
@@ -145,6 +150,20 @@ svn_stream_set_readline(svn_stream_t *stream,
   stream->readline_fn = readline_fn;
 }
 
+void
+svn_stream__set_borrow(svn_stream_t *stream,
+                       svn_stream__borrow_fn_t borrow_fn)
+{
+  stream->borrow_fn = borrow_fn;
+}
+
+void
+svn_stream__set_writev(svn_stream_t *stream,
+                       svn_stream__writev_fn_t writev_fn)
+{
+  stream->writev_fn = writev_fn;
+}
+
 /* Standard implementation for svn_stream_read_full() based on
    multiple svn_stream_read2() calls (in separate function to make
    it more likely for svn_stream_read_full to be inlined) */
@@ -222,6 +241,44 @@ svn_stream_write(svn_stream_t *stream, const char *data, apr_size_t *len)
 }
 
 
+svn_boolean_t
+svn_stream__supports_borrow(svn_stream_t *stream)
+{
+  return stream->borrow_fn != NULL;
+}
+
+svn_error_t *
+svn_stream__borrow(svn_stream_t *stream,
+                   const char **data,
+                   apr_size_t *len)
+{
+  if (stream->borrow_fn == NULL)
+    return svn_error_create(SVN_ERR_STREAM_NOT_SUPPORTED, NULL, NULL);
+
+  return svn_error_trace(stream->borrow_fn(stream->baton, data, len));
+}
+
+svn_error_t *
+svn_stream__writev(svn_stream_t *stream,
+                   const svn_string_t *vec,
+                   int count)
+{
+  int i;
+
+  if (stream->writev_fn)
+    return svn_error_trace(stream->writev_fn(stream->baton, vec, count));
+
+  for (i = 0; i < count; ++i)
+    if (vec[i].len > 0)
+      {
+        apr_size_t len = vec[i].len;
+        SVN_ERR(svn_stream_write(stream, vec[i].data, &len));
+      }
+
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_stream_reset(svn_stream_t *stream)
 {
@@ -396,13 +453,18 @@ svn_error_t *svn_stream_copy3(svn_stream_t *from, svn_stream_t *to,
                               void *cancel_baton,
                               apr_pool_t *scratch_pool)
 {
-  char *buf = apr_palloc(scratch_pool, SVN__STREAM_CHUNK_SIZE);
+  char *buf = NULL;
   svn_error_t *err;
   svn_error_t *err2;
+  svn_boolean_t borrow = svn_stream__supports_borrow(from);
+
+  if (!borrow)
+    buf = apr_palloc(scratch_pool, SVN__STREAM_CHUNK_SIZE);
 
   /* Read and write chunks until we get a short read, indicating the
      end of the stream.  (We can't get a short write without an
-     associated error.) */
+     associated error.)  If FROM can lend us its data, pass that on
+     directly and stop at the first empty chunk instead. */
   while (1)
     {
       apr_size_t len = SVN__STREAM_CHUNK_SIZE;
@@ -414,6 +476,21 @@ svn_error_t *svn_stream_copy3(svn_stream_t *from, svn_stream_t *to,
              break;
         }
 
+      if (borrow)
+        {
+          const char *data;
+
+          err = svn_stream__borrow(from, &data, &len);
+          if (err || len == 0)
+            break;
+
+          err = svn_stream_write(to, data, &len);
+          if (err)
+            break;
+
+          continue;
+        }
+
       err = svn_stream_read_full(from, buf, &len);
       if (err)
          break;
@@ -619,6 +696,18 @@ write_handler_disown(void *baton, const char *buffer, apr_size_t *len)
   return svn_error_trace(svn_stream_write(baton, buffer, len));
 }
 
+static svn_error_t *
+borrow_handler_disown(void *baton, const char **data, apr_size_t *len)
+{
+  return svn_error_trace(svn_stream__borrow(baton, data, len));
+}
+
+static svn_error_t *
+writev_handler_disown(void *baton, const svn_string_t *vec, int count)
+{
+  return svn_error_trace(svn_stream__writev(baton, vec, count));
+}
+
 static svn_error_t *
 mark_handler_disown(void *baton, svn_stream_mark_t **mark, apr_pool_t *pool)
 {
@@ -660,6 +749,10 @@ svn_stream_disown(svn_stream_t *stream, apr_pool_t *pool)
   svn_stream_set_seek(s, seek_handler_disown);
   svn_stream_set_data_available(s, data_available_disown);
   svn_stream_set_readline(s, readline_handler_disown);
+  svn_stream__set_writev(s, writev_handler_disown);
+
+  if (svn_stream__supports_borrow(stream))
+    svn_stream__set_borrow(s, borrow_handler_disown);
 
   return s;
 }
@@ -764,6 +857,54 @@ write_handler_apr(void *baton, const char *data, apr_size_t *len)
   return svn_error_trace(err);
 }
 
+/* Maximum number of pieces that writev_handler_apr hands to the OS
+   in one go. */
+#define MAX_WRITEV_PIECES 16
+
+static svn_error_t *
+writev_handler_apr(void *baton, const svn_string_t *vec, int count)
+{
+  struct baton_apr *btn = baton;
+  struct iovec iov[MAX_WRITEV_PIECES];
+
+  while (count > 0)
+    {
+      int pieces = MIN(count, MAX_WRITEV_PIECES);
+      apr_size_t written;
+      apr_status_t status;
+      int i;
+
+      for (i = 0; i < pieces; ++i)
+        {
+          iov[i].iov_base = (void *)vec[i].data;
+          iov[i].iov_len = vec[i].len;
+        }
+
+      status = apr_file_writev_full(btn->file, iov, pieces, &written);
+      if (status)
+        {
+          const char *fname;
+          svn_error_t *err = svn_io_file_name_get(&fname, btn->file,
+                                                  btn->pool);
+          if (err)
+            fname = NULL;
+          svn_error_clear(err);
+
+          if (fname)
+            return svn_error_wrap_apr(status, _("Can't write to file '%s'"),
+                                      svn_dirent_local_style(fname,
+                                                             btn->pool));
+          else
+            return svn_error_wrap_apr(status, _("Can't write to stream"));
+        }
+
+      vec += pieces;
+      count -= pieces;
+    }
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 close_handler_apr(void *baton)
 {
@@ -1066,6 +1207,7 @@ make_stream_from_apr_file(apr_file_t *file,
   stream = svn_stream_create(baton, pool);
   svn_stream_set_read2(stream, read_handler_apr, read_full_handler_apr);
   svn_stream_set_write(stream, write_handler_apr);
+  svn_stream__set_writev(stream, writev_handler_apr);
 
   if (supports_seek)
     {
@@ -1115,6 +1257,8 @@ struct zbaton {
                                    substream */
   int read_flush;               /* what flush mode to use while
                                    reading */
+  char *borrow_buffer;          /* decompressed data lent to the
+                                   reader, allocated on demand */
   apr_pool_t *pool;             /* The pool this baton is allocated
                                    on */
 };
@@ -1216,15 +1360,33 @@ read_handler_gz(void *baton, char *buffer, apr_size_t *len)
   return SVN_NO_ERROR;
 }
 
-/* Compress data and write it to the substream */
+/* Decompress up to *LEN bytes into a buffer of our own and lend it to
+   the caller */
 static svn_error_t *
-write_handler_gz(void *baton, const char *buffer, apr_size_t *len)
+borrow_handler_gz(void *baton, const char **data, apr_size_t *len)
+{
+  struct zbaton *btn = baton;
+
+  if (btn->borrow_buffer == NULL)
+    btn->borrow_buffer = apr_palloc(btn->pool, SVN__STREAM_CHUNK_SIZE);
+
+  *len = MIN(*len, SVN__STREAM_CHUNK_SIZE);
+  SVN_ERR(read_handler_gz(baton, btn->borrow_buffer, len));
+  *data = btn->borrow_buffer;
+
+  return SVN_NO_ERROR;
+}
+
+/* Compress the COUNT pieces of data in VEC and write the result to the
+   substream */
+static svn_error_t *
+writev_handler_gz(void *baton, const svn_string_t *vec, int count)
 {
   struct zbaton *btn = baton;
   apr_pool_t *subpool;
   void *write_buf;
-  apr_size_t buf_size, write_len;
-  int zerr;
+  apr_size_t buf_size, write_len, total = 0;
+  int zerr, i;
 
   if (btn->out == NULL)
     {
@@ -1238,24 +1400,31 @@ write_handler_gz(void *baton, const char *buffer, apr_size_t *len)
     }
 
   /* The largest buffer we should need is 0.1% larger than the
-     compressed data, + 12 bytes. This info comes from zlib.h.  */
-  buf_size = *len + (*len / 1000) + 13;
+     compressed data, + 12 bytes. This info comes from zlib.h.
+     Share it between all pieces. */
+  for (i = 0; i < count; ++i)
+    total += vec[i].len;
+
+  buf_size = total + (total / 1000) + 13;
   subpool = svn_pool_create(btn->pool);
   write_buf = apr_palloc(subpool, buf_size);
 
-  btn->out->next_in = (Bytef *) buffer;  /* Casting away const! */
-  btn->out->avail_in = (uInt) *len;
-
-  while (btn->out->avail_in > 0)
+  for (i = 0; i < count; ++i)
     {
-      btn->out->next_out = write_buf;
-      btn->out->avail_out = (uInt) buf_size;
-
-      zerr = deflate(btn->out, Z_NO_FLUSH);
-      SVN_ERR(svn_error__wrap_zlib(zerr, "deflate", btn->out->msg));
-      write_len = buf_size - btn->out->avail_out;
-      if (write_len > 0)
-        SVN_ERR(svn_stream_write(btn->substream, write_buf, &write_len));
+      btn->out->next_in = (Bytef *) vec[i].data;  /* Casting away const! */
+      btn->out->avail_in = (uInt) vec[i].len;
+
+      while (btn->out->avail_in > 0)
+        {
+          btn->out->next_out = write_buf;
+          btn->out->avail_out = (uInt) buf_size;
+
+          zerr = deflate(btn->out, Z_NO_FLUSH);
+          SVN_ERR(svn_error__wrap_zlib(zerr, "deflate", btn->out->msg));
+          write_len = buf_size - btn->out->avail_out;
+          if (write_len > 0)
+            SVN_ERR(svn_stream_write(btn->substream, write_buf, &write_len));
+        }
     }
 
   svn_pool_destroy(subpool);
@@ -1263,6 +1432,18 @@ write_handler_gz(void *baton, const char *buffer, apr_size_t *len)
   return SVN_NO_ERROR;
 }
 
+/* Compress data and write it to the substream */
+static svn_error_t *
+write_handler_gz(void *baton, const char *buffer, apr_size_t *len)
+{
+  svn_string_t data;
+
+  data.data = buffer;
+  data.len = *len;
+
+  return svn_error_trace(writev_handler_gz(baton, &data, 1));
+}
+
 /* Handle flushing and closing the stream */
 static svn_error_t *
 close_handler_gz(void *baton)
@@ -1321,16 +1502,209 @@ svn_stream_compressed(svn_stream_t *stream, apr_pool_t *pool)
   baton->pool = pool;
   baton->read_buffer = NULL;
   baton->read_flush = Z_SYNC_FLUSH;
+  baton->borrow_buffer = NULL;
 
   zstream = svn_stream_create(baton, pool);
   svn_stream_set_read2(zstream, NULL /* only full read support */,
                        read_handler_gz);
   svn_stream_set_write(zstream, write_handler_gz);
+  svn_stream__set_borrow(zstream, borrow_handler_gz);
+  svn_stream__set_writev(zstream, writev_handler_gz);
   svn_stream_set_close(zstream, close_handler_gz);
 
   return zstream;
 }
 
+
+/* LZ4 compressed stream support */
+
+/* The compressed data is a sequence of blocks, each of which holds the
+   compressed form of up to LZ4_BLOCK_SIZE bytes of uncompressed data.
+   Every block starts with its length as 4 bytes in network byte order,
+   followed by that many bytes produced by svn__compress_lz4(). */
+#define LZ4_BLOCK_SIZE 0x10000
+#define LZ4_BLOCK_HEADER_SIZE 4
+
+struct lz4_baton_t {
+  svn_stream_t *substream;      /* The substream */
+  svn_stringbuf_t *pending;     /* uncompressed data not written yet */
+  svn_stringbuf_t *block;       /* current compressed block */
+  svn_stringbuf_t *data;        /* uncompressed data of the block read
+                                   last */
+  apr_size_t data_pos;          /* offset of the first unread byte in
+                                   DATA */
+};
+
+/* Compress the LEN bytes at DATA into a single block and write it to
+   the substream of BTN. */
+static svn_error_t *
+write_block_lz4(struct lz4_baton_t *btn,
+                const char *data,
+                apr_size_t len)
+{
+  unsigned char header[LZ4_BLOCK_HEADER_SIZE];
+  apr_size_t write_len = sizeof(header);
+
+  SVN_ERR(svn__compress_lz4(data, len, btn->block));
+
+  header[0] = (unsigned char)(btn->block->len >> 24);
+  header[1] = (unsigned char)(btn->block->len >> 16);
+  header[2] = (unsigned char)(btn->block->len >> 8);
+  header[3] = (unsigned char)(btn->block->len);
+
+  SVN_ERR(svn_stream_write(btn->substream, (const char *)header,
+                           &write_len));
+  write_len = btn->block->len;
+  return svn_error_trace(svn_stream_write(btn->substream, btn->block->data,
+                                          &write_len));
+}
+
+/* Read the next block from the substream of BTN and decompress it into
+   BTN->DATA.  Leave BTN->DATA empty at the end of the substream. */
+static svn_error_t *
+read_block_lz4(struct lz4_baton_t *btn)
+{
+  unsigned char header[LZ4_BLOCK_HEADER_SIZE];
+  apr_size_t read_len = sizeof(header);
+  apr_size_t block_len;
+
+  svn_stringbuf_setempty(btn->data);
+  btn->data_pos = 0;
+
+  SVN_ERR(svn_stream_read_full(btn->substream, (char *)header, &read_len));
+  if (read_len == 0)
+    return SVN_NO_ERROR;
+
+  block_len = ((apr_size_t)header[0] << 24) | ((apr_size_t)header[1] << 16)
+            | ((apr_size_t)header[2] << 8) | header[3];
+
+  /* Incompressible data is stored verbatim behind its length. */
+  if (read_len < sizeof(header)
+      || block_len > LZ4_BLOCK_SIZE + SVN__MAX_ENCODED_UINT_LEN)
+    return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                            _("Invalid block in LZ4 compressed stream"));
+
+  svn_stringbuf_ensure(btn->block, block_len);
+  read_len = block_len;
+  SVN_ERR(svn_stream_read_full(btn->substream, btn->block->data, &read_len));
+  if (read_len < block_len)
+    return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
+                            _("Truncated LZ4 compressed stream"));
+
+  SVN_ERR(svn__decompress_lz4(btn->block->data, block_len, btn->data,
+                              LZ4_BLOCK_SIZE));
+  if (btn->data->len == 0)
+    return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                            _("Invalid block in LZ4 compressed stream"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Handle reading from an LZ4 compressed stream */
+static svn_error_t *
+read_handler_lz4(void *baton, char *buffer, apr_size_t *len)
+{
+  struct lz4_baton_t *btn = baton;
+  apr_size_t total = 0;
+
+  while (total < *len)
+    {
+      apr_size_t to_copy;
+
+      if (btn->data_pos == btn->data->len)
+        {
+          SVN_ERR(read_block_lz4(btn));
+          if (btn->data->len == 0)
+            break;
+        }
+
+      to_copy = MIN(*len - total, btn->data->len - btn->data_pos);
+      memcpy(buffer + total, btn->data->data + btn->data_pos, to_copy);
+      btn->data_pos += to_copy;
+      total += to_copy;
+    }
+
+  *len = total;
+  return SVN_NO_ERROR;
+}
+
+/* Compress data and write it to the substream in full blocks */
+static svn_error_t *
+write_handler_lz4(void *baton, const char *buffer, apr_size_t *len)
+{
+  struct lz4_baton_t *btn = baton;
+  apr_size_t remaining = *len;
+
+  /* Complete the block that previous writes started. */
+  if (btn->pending->len)
+    {
+      apr_size_t to_copy = MIN(remaining,
+                               LZ4_BLOCK_SIZE - btn->pending->len);
+
+      svn_stringbuf_appendbytes(btn->pending, buffer, to_copy);
+      buffer += to_copy;
+      remaining -= to_copy;
+
+      if (btn->pending->len < LZ4_BLOCK_SIZE)
+        return SVN_NO_ERROR;
+
+      SVN_ERR(write_block_lz4(btn, btn->pending->data, btn->pending->len));
+      svn_stringbuf_setempty(btn->pending);
+    }
+
+  /* Compress full blocks directly from the caller's buffer. */
+  while (remaining >= LZ4_BLOCK_SIZE)
+    {
+      SVN_ERR(write_block_lz4(btn, buffer, LZ4_BLOCK_SIZE));
+      buffer += LZ4_BLOCK_SIZE;
+      remaining -= LZ4_BLOCK_SIZE;
+    }
+
+  svn_stringbuf_appendbytes(btn->pending, buffer, remaining);
+
+  return SVN_NO_ERROR;
+}
+
+/* Handle flushing and closing the stream */
+static svn_error_t *
+close_handler_lz4(void *baton)
+{
+  struct lz4_baton_t *btn = baton;
+
+  if (btn->pending->len)
+    {
+      SVN_ERR(write_block_lz4(btn, btn->pending->data, btn->pending->len));
+      svn_stringbuf_setempty(btn->pending);
+    }
+
+  return svn_error_trace(svn_stream_close(btn->substream));
+}
+
+svn_stream_t *
+svn_stream__lz4_compressed(svn_stream_t *stream,
+                           apr_pool_t *result_pool)
+{
+  struct svn_stream_t *lz4_stream;
+  struct lz4_baton_t *baton;
+
+  assert(stream != NULL);
+
+  baton = apr_palloc(result_pool, sizeof(*baton));
+  baton->substream = stream;
+  baton->pending = svn_stringbuf_create_empty(result_pool);
+  baton->block = svn_stringbuf_create_empty(result_pool);
+  baton->data = svn_stringbuf_create_empty(result_pool);
+  baton->data_pos = 0;
+
+  lz4_stream = svn_stream_create(baton, result_pool);
+  svn_stream_set_read2(lz4_stream, NULL /* only full read support */,
+                       read_handler_lz4);
+  svn_stream_set_write(lz4_stream, write_handler_lz4);
+  svn_stream_set_close(lz4_stream, close_handler_lz4);
+
+  return lz4_stream;
+}
+
 
 /* Checksummed stream support */
 
@@ -1379,6 +1753,22 @@ read_full_handler_checksum(void *baton, char *buffer, apr_size_t *len)
 }
 
 
+static svn_error_t *
+borrow_handler_checksum(void *baton, const char **data, apr_size_t *len)
+{
+  struct checksum_stream_baton *btn = baton;
+
+  SVN_ERR(svn_stream__borrow(btn->proxy, data, len));
+
+  if (btn->read_checksum)
+    SVN_ERR(svn_checksum_update(btn->read_ctx, *data, *len));
+
+  if (*len == 0)
+    btn->read_more = FALSE;
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 write_handler_checksum(void *baton, const char *buffer, apr_size_t *len)
 {
@@ -1390,6 +1780,21 @@ write_handler_checksum(void *baton, const char *buffer, apr_size_t *len)
   return svn_error_trace(svn_stream_write(btn->proxy, buffer, len));
 }
 
+static svn_error_t *
+writev_handler_checksum(void *baton, const svn_string_t *vec, int count)
+{
+  struct checksum_stream_baton *btn = baton;
+  int i;
+
+  if (btn->write_checksum)
+    for (i = 0; i < count; ++i)
+      if (vec[i].len > 0)
+        SVN_ERR(svn_checksum_update(btn->write_ctx, vec[i].data,
+                                    vec[i].len));
+
+  return svn_error_trace(svn_stream__writev(btn->proxy, vec, count));
+}
+
 static svn_error_t *
 data_available_handler_checksum(void *baton, svn_boolean_t *data_available)
 {
@@ -1462,8 +1867,13 @@ svn_stream_checksummed2(svn_stream_t *stream,
   s = svn_stream_create(baton, pool);
   svn_stream_set_read2(s, read_handler_checksum, read_full_handler_checksum);
   svn_stream_set_write(s, write_handler_checksum);
+  svn_stream__set_writev(s, writev_handler_checksum);
   svn_stream_set_data_available(s, data_available_handler_checksum);
   svn_stream_set_close(s, close_handler_checksum);
+
+  if (svn_stream__supports_borrow(stream))
+    svn_stream__set_borrow(s, borrow_handler_checksum);
+
   return s;
 }
 
@@ -1579,6 +1989,18 @@ read_handler_stringbuf(void *baton, char *buffer, apr_size_t *len)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+borrow_handler_stringbuf(void *baton, const char **data, apr_size_t *len)
+{
+  struct stringbuf_stream_baton *btn = baton;
+  apr_size_t left_to_read = btn->str->len - btn->amt_read;
+
+  *len = (*len > left_to_read) ? left_to_read : *len;
+  *data = btn->str->data + btn->amt_read;
+  btn->amt_read += *len;
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 skip_handler_stringbuf(void *baton, apr_size_t len)
 {
@@ -1599,6 +2021,24 @@ write_handler_stringbuf(void *baton, const char *data, apr_size_t *len)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+writev_handler_stringbuf(void *baton, const svn_string_t *vec, int count)
+{
+  struct stringbuf_stream_baton *btn = baton;
+  apr_size_t total = btn->str->len;
+  int i;
+
+  /* Grow the buffer only once. */
+  for (i = 0; i < count; ++i)
+    total += vec[i].len;
+  svn_stringbuf_ensure(btn->str, total);
+
+  for (i = 0; i < count; ++i)
+    svn_stringbuf_appendbytes(btn->str, vec[i].data, vec[i].len);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 mark_handler_stringbuf(void *baton, svn_stream_mark_t **mark, apr_pool_t *pool)
 {
@@ -1688,6 +2128,8 @@ svn_stream_from_stringbuf(svn_stringbuf_t *str,
   svn_stream_set_read2(stream, read_handler_stringbuf, read_handler_stringbuf);
   svn_stream_set_skip(stream, skip_handler_stringbuf);
   svn_stream_set_write(stream, write_handler_stringbuf);
+  svn_stream__set_borrow(stream, borrow_handler_stringbuf);
+  svn_stream__set_writev(stream, writev_handler_stringbuf);
   svn_stream_set_mark(stream, mark_handler_stringbuf);
   svn_stream_set_seek(stream, seek_handler_stringbuf);
   svn_stream_set_data_available(stream, data_available_handler_stringbuf);
@@ -1718,6 +2160,18 @@ read_handler_string(void *baton, char *buffer, apr_size_t *len)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+borrow_handler_string(void *baton, const char **data, apr_size_t *len)
+{
+  struct string_stream_baton *btn = baton;
+  apr_size_t left_to_read = btn->str->len - btn->amt_read;
+
+  *len = (*len > left_to_read) ? left_to_read : *len;
+  *data = btn->str->data + btn->amt_read;
+  btn->amt_read += *len;
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 mark_handler_string(void *baton, svn_stream_mark_t **mark, apr_pool_t *pool)
 {
@@ -1816,6 +2270,7 @@ svn_stream_from_string(const svn_string_t *str,
   baton->amt_read = 0;
   stream = svn_stream_create(baton, pool);
   svn_stream_set_read2(stream, read_handler_string, read_handler_string);
+  svn_stream__set_borrow(stream, borrow_handler_string);
   svn_stream_set_mark(stream, mark_handler_string);
   svn_stream_set_seek(stream, seek_handler_string);
   svn_stream_set_skip(stream, skip_handler_string);
@@ -1921,6 +2376,341 @@ svn_stream_buffered(apr_pool_t *result_pool)
 
 
 
+/*** Read-ahead Streams ***/
+
+#if APR_HAS_THREADS
+
+/* A chunk of data that has been read ahead. */
+typedef struct read_ahead_block_t
+{
+  char *data;
+  apr_size_t len;
+} read_ahead_block_t;
+
+/* Baton shared between the read-ahead stream and its worker thread.
+ * All members not explicitly documented otherwise are guarded by MUTEX.
+ */
+typedef struct read_ahead_baton_t
+{
+  /* The stream being read.  Only the worker thread accesses it until
+     the worker has been stopped. */
+  svn_stream_t *source;
+
+  /* Ring buffer of BLOCK_COUNT blocks, FILLED of which contain data,
+     starting at READ_INDEX. */
+  read_ahead_block_t *blocks;
+  apr_size_t block_count;
+  apr_size_t read_index;
+  apr_size_t filled;
+
+  /* Reader only:  Set if the reader is currently consuming the block at
+     READ_INDEX and the read position within it. */
+  svn_boolean_t current;
+  apr_size_t pos;
+
+  /* Set by the worker when it won't provide more data.  ERR is the error
+     that stopped it, if any. */
+  svn_boolean_t done;
+  svn_error_t *err;
+
+  /* Set by the reader to stop the worker early. */
+  svn_boolean_t abort;
+
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *cond;
+
+  /* The worker thread.  NULL after it has been joined.  It lives in the
+     thread-safe THREAD_POOL, which is independent from the stream's pool
+     and destroyed after the join. */
+  apr_thread_t *thread;
+  apr_pool_t *thread_pool;
+} read_ahead_baton_t;
+
+/* Implements apr_thread_start_t, filling the free blocks of the
+ * read_ahead_baton_t in DATA from its source stream. */
+static void * APR_THREAD_FUNC
+read_ahead_worker(apr_thread_t *thread,
+                  void *data)
+{
+  read_ahead_baton_t *btn = data;
+  svn_error_t *err = SVN_NO_ERROR;
+  svn_boolean_t eof = FALSE;
+
+  while (!eof && !err)
+    {
+      read_ahead_block_t *block = NULL;
+
+      /* Wait for a free block. */
+      apr_thread_mutex_lock(btn->mutex);
+      while (btn->filled == btn->block_count && !btn->abort)
+        apr_thread_cond_wait(btn->cond, btn->mutex);
+
+      if (!btn->abort)
+        block = &btn->blocks[  (btn->read_index + btn->filled)
+                             % btn->block_count];
+      apr_thread_mutex_unlock(btn->mutex);
+
+      if (block == NULL)
+        break;
+
+      /* The actual I/O happens without holding the lock. */
+      block->len = SVN__STREAM_CHUNK_SIZE;
+      err = svn_stream_read_full(btn->source, block->data, &block->len);
+      eof = block->len < SVN__STREAM_CHUNK_SIZE;
+
+      if (!err && block->len)
+        {
+          apr_thread_mutex_lock(btn->mutex);
+          ++btn->filled;
+          apr_thread_cond_broadcast(btn->cond);
+          apr_thread_mutex_unlock(btn->mutex);
+        }
+    }
+
+  apr_thread_mutex_lock(btn->mutex);
+  btn->err = err;
+  btn->done = TRUE;
+  apr_thread_cond_broadcast(btn->cond);
+  apr_thread_mutex_unlock(btn->mutex);
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Make sure that the block at BTN->READ_INDEX contains unread data,
+ * waiting for the worker thread as necessary.  Set *EOF if there is no
+ * more data. */
+static svn_error_t *
+read_ahead_next(read_ahead_baton_t *btn,
+                svn_boolean_t *eof)
+{
+  svn_error_t *err = SVN_NO_ERROR;
+
+  *eof = FALSE;
+  if (btn->current && btn->pos < btn->blocks[btn->read_index].len)
+    return SVN_NO_ERROR;
+
+  apr_thread_mutex_lock(btn->mutex);
+
+  /* Return the consumed block to the worker. */
+  if (btn->current)
+    {
+      btn->read_index = (btn->read_index + 1) % btn->block_count;
+      --btn->filled;
+      btn->current = FALSE;
+      btn->pos = 0;
+      apr_thread_cond_broadcast(btn->cond);
+    }
+
+  while (btn->filled == 0 && !btn->done)
+    apr_thread_cond_wait(btn->cond, btn->mutex);
+
+  if (btn->filled)
+    {
+      btn->current = TRUE;
+    }
+  else
+    {
+      /* Report the worker's error only once. */
+      *eof = TRUE;
+      err = btn->err;
+      btn->err = SVN_NO_ERROR;
+    }
+
+  apr_thread_mutex_unlock(btn->mutex);
+
+  return svn_error_trace(err);
+}
+
+/* Implements svn_read_fn_t, returning the data of the current block. */
+static svn_error_t *
+read_handler_read_ahead(void *baton,
+                        char *buffer,
+                        apr_size_t *len)
+{
+  read_ahead_baton_t *btn = baton;
+  read_ahead_block_t *block;
+  svn_boolean_t eof;
+
+  SVN_ERR(read_ahead_next(btn, &eof));
+  if (eof)
+    {
+      *len = 0;
+      return SVN_NO_ERROR;
+    }
+
+  block = &btn->blocks[btn->read_index];
+  *len = MIN(*len, block->len - btn->pos);
+  memcpy(buffer, block->data + btn->pos, *len);
+  btn->pos += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_read_fn_t */
+static svn_error_t *
+read_full_handler_read_ahead(void *baton,
+                             char *buffer,
+                             apr_size_t *len)
+{
+  apr_size_t to_read = *len;
+
+  *len = 0;
+  while (*len < to_read)
+    {
+      apr_size_t count = to_read - *len;
+      SVN_ERR(read_handler_read_ahead(baton, buffer + *len, &count));
+      if (count == 0)
+        break;
+
+      *len += count;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_stream_readline_fn_t, scanning whole blocks at once. */
+static svn_error_t *
+readline_handler_read_ahead(void *baton,
+                            svn_stringbuf_t **stringbuf,
+                            const char *eol,
+                            svn_boolean_t *eof,
+                            apr_pool_t *pool)
+{
+  read_ahead_baton_t *btn = baton;
+  apr_size_t eol_len = strlen(eol);
+  char eol_last = eol[eol_len - 1];
+  svn_stringbuf_t *line = svn_stringbuf_create_empty(pool);
+
+  while (TRUE)
+    {
+      read_ahead_block_t *block;
+      const char *start;
+      const char *found;
+      apr_size_t available;
+
+      SVN_ERR(read_ahead_next(btn, eof));
+      if (*eof)
+        break;
+
+      /* Copy up to and including the next char that may complete EOL. */
+      block = &btn->blocks[btn->read_index];
+      start = block->data + btn->pos;
+      available = block->len - btn->pos;
+      found = memchr(start, eol_last, available);
+      if (found)
+        available = found - start + 1;
+
+      svn_stringbuf_appendbytes(line, start, available);
+      btn->pos += available;
+
+      if (   found
+          && line->len >= eol_len
+          && memcmp(line->data + line->len - eol_len, eol, eol_len) == 0)
+        {
+          svn_stringbuf_chop(line, eol_len);
+          break;
+        }
+    }
+
+  *stringbuf = line;
+  return SVN_NO_ERROR;
+}
+
+/* Stop the worker thread of BTN and wait for it to terminate.  Discard
+ * any error that the reader has not received, yet. */
+static void
+read_ahead_stop(read_ahead_baton_t *btn)
+{
+  apr_status_t retval;
+
+  if (btn->thread == NULL)
+    return;
+
+  apr_thread_mutex_lock(btn->mutex);
+  btn->abort = TRUE;
+  apr_thread_cond_broadcast(btn->cond);
+  apr_thread_mutex_unlock(btn->mutex);
+
+  apr_thread_join(&retval, btn->thread);
+  btn->thread = NULL;
+  svn_pool_destroy(btn->thread_pool);
+
+  svn_error_clear(btn->err);
+  btn->err = SVN_NO_ERROR;
+}
+
+/* Pool cleanup function making sure that the worker thread of the
+ * read_ahead_baton_t in DATA does not outlive the stream. */
+static apr_status_t
+read_ahead_cleanup(void *data)
+{
+  read_ahead_stop(data);
+  return APR_SUCCESS;
+}
+
+/* Implements svn_close_fn_t */
+static svn_error_t *
+close_handler_read_ahead(void *baton)
+{
+  read_ahead_baton_t *btn = baton;
+
+  read_ahead_stop(btn);
+  return svn_error_trace(svn_stream_close(btn->source));
+}
+
+#endif
+
+svn_stream_t *
+svn_stream__read_ahead(svn_stream_t *stream,
+                       int block_count,
+                       apr_pool_t *result_pool)
+{
+#if APR_HAS_THREADS
+  read_ahead_baton_t *btn;
+  svn_stream_t *result;
+  int i;
+
+  if (block_count < 2)
+    return stream;
+
+  btn = apr_pcalloc(result_pool, sizeof(*btn));
+  btn->source = stream;
+  btn->block_count = block_count;
+  btn->blocks = apr_pcalloc(result_pool, block_count * sizeof(*btn->blocks));
+  for (i = 0; i < block_count; ++i)
+    btn->blocks[i].data = apr_palloc(result_pool, SVN__STREAM_CHUNK_SIZE);
+
+  /* Without a worker thread, simply read STREAM directly. */
+  btn->thread_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  if (   apr_thread_mutex_create(&btn->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                 result_pool)
+      || apr_thread_cond_create(&btn->cond, result_pool)
+      || apr_thread_create(&btn->thread, NULL, read_ahead_worker, btn,
+                           btn->thread_pool))
+    {
+      svn_pool_destroy(btn->thread_pool);
+      return stream;
+    }
+
+  /* The worker must be gone before the blocks and the synchronization
+     objects get released. */
+  apr_pool_pre_cleanup_register(result_pool, btn, read_ahead_cleanup);
+
+  result = svn_stream_create(btn, result_pool);
+  svn_stream_set_read2(result, read_handler_read_ahead,
+                       read_full_handler_read_ahead);
+  svn_stream_set_readline(result, readline_handler_read_ahead);
+  svn_stream_set_close(result, close_handler_read_ahead);
+
+  return result;
+#else
+  return stream;
+#endif
+}
+
+
 /*** Lazyopen Streams ***/
 
 /* Custom baton for lazyopen-style wrapper streams. */
@@ -30,6 +30,8 @@
 
 #include <string.h>      /* for memcpy(), memcmp(), strlen() */
 #include <apr_fnmatch.h>
+#include <apr_hash.h>
+#include <apr_strings.h>
 #include "svn_string.h"  /* loads "svn_types.h" and <apr_pools.h> */
 #include "svn_ctype.h"
 #include "private/svn_dep_compat.h"
@@ -37,6 +39,12 @@
 
 #include "svn_private_config.h"
 
+#if defined(SVN__HAVE_SSE2)
+#include <emmintrin.h>
+#elif defined(SVN__HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 
 
 /* Allocate the space for a memory buffer from POOL.
@@ -1502,6 +1510,30 @@ svn_cstring__match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#if defined(SVN__HAVE_SSE2)
+
+  /* Long matches are common in deltification.  Compare 16 bytes at once
+   * and let the code below find the exact mismatch position. */
+  for (; max_len - pos >= sizeof(__m128i); pos += sizeof(__m128i))
+    {
+      __m128i lhs = _mm_loadu_si128((const __m128i *)(a + pos));
+      __m128i rhs = _mm_loadu_si128((const __m128i *)(b + pos));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) != 0xffff)
+        break;
+    }
+
+#elif defined(SVN__HAVE_NEON)
+
+  for (; max_len - pos >= sizeof(uint8x16_t); pos += sizeof(uint8x16_t))
+    {
+      uint8x16_t lhs = vld1q_u8((const uint8_t *)(a + pos));
+      uint8x16_t rhs = vld1q_u8((const uint8_t *)(b + pos));
+      if (vminvq_u8(vceqq_u8(lhs, rhs)) != 0xff)
+        break;
+    }
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1530,6 +1562,33 @@ svn_cstring__reverse_match_length(const char *a,
 {
   apr_size_t pos = 0;
 
+#if defined(SVN__HAVE_SSE2)
+
+  /* Same as in svn_cstring__match_length, just backwards. */
+  for (pos = sizeof(__m128i); pos <= max_len; pos += sizeof(__m128i))
+    {
+      __m128i lhs = _mm_loadu_si128((const __m128i *)(a - pos));
+      __m128i rhs = _mm_loadu_si128((const __m128i *)(b - pos));
+      if (_mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) != 0xffff)
+        break;
+    }
+
+  pos -= sizeof(__m128i);
+
+#elif defined(SVN__HAVE_NEON)
+
+  for (pos = sizeof(uint8x16_t); pos <= max_len; pos += sizeof(uint8x16_t))
+    {
+      uint8x16_t lhs = vld1q_u8((const uint8_t *)(a - pos));
+      uint8x16_t rhs = vld1q_u8((const uint8_t *)(b - pos));
+      if (vminvq_u8(vceqq_u8(lhs, rhs)) != 0xff)
+        break;
+    }
+
+  pos -= sizeof(uint8x16_t);
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Chunky processing is so much faster ...
@@ -1538,7 +1597,7 @@ svn_cstring__reverse_match_length(const char *a,
    * because A and B will probably have different alignment. So, skipping
    * the first few chars until alignment is reached is not an option.
    */
-  for (pos = sizeof(apr_size_t); pos <= max_len; pos += sizeof(apr_size_t))
+  for (pos += sizeof(apr_size_t); pos <= max_len; pos += sizeof(apr_size_t))
     if (*(const apr_size_t*)(a - pos) != *(const apr_size_t*)(b - pos))
       break;
 
@@ -1571,3 +1630,35 @@ svn_cstring_skip_prefix(const char *str, const char *prefix)
       return NULL;
     }
 }
+
+
+/* The interning table.  Keys and values of STRINGS are the same interned,
+   NUL-terminated strings. */
+struct svn_string__interner_t
+{
+  apr_hash_t *strings;
+};
+
+svn_string__interner_t *
+svn_string__interner_create(apr_pool_t *pool)
+{
+  svn_string__interner_t *interner = apr_palloc(pool, sizeof(*interner));
+  interner->strings = apr_hash_make(pool);
+
+  return interner;
+}
+
+const char *
+svn_string__intern(svn_string__interner_t *interner,
+                   const char *s,
+                   apr_size_t len)
+{
+  const char *result = apr_hash_get(interner->strings, s, len);
+  if (result == NULL)
+    {
+      result = apr_pstrmemdup(apr_hash_pool_get(interner->strings), s, len);
+      apr_hash_set(interner->strings, result, len, result);
+    }
+
+  return result;
+}
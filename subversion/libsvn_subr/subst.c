@@ -1123,26 +1123,23 @@ translate_chunk(svn_stream_t *dst,
               /* skip current EOL */
               len += b->eol_str_len;
 
-              if (b->keywords)
+              if (b->keywords && b->eol_str)
                 {
-                  /* Check 4 bytes at once to allow for efficient pipelining
-                    and to reduce loop condition overhead. */
-                  while ((end - p) >= (len + 4))
-                    {
-                      if (interesting[(unsigned char)p[len]]
-                          || interesting[(unsigned char)p[len+1]]
-                          || interesting[(unsigned char)p[len+2]]
-                          || interesting[(unsigned char)p[len+3]])
-                        break;
-
-                      len += 4;
-                    }
-
-                  /* Found an interesting char or EOF in the next 4 bytes.
-                     Find its exact position. */
-                  while ((p + len) < end
-                         && !interesting[(unsigned char)p[len]])
-                    ++len;
+                  /* Skip whole blocks without any EOL or '$' at once. */
+                  const char *start = p + len;
+                  const char *next
+                    = svn_eol__find_eol_or_keyword_start((char *)start,
+                                                         end - start);
+
+                  len += (next ? next : end) - start;
+                }
+              else if (b->keywords)
+                {
+                  /* Only keywords need to be translated. */
+                  const char *start = p + len;
+                  const char *next = memchr(start, '$', end - start);
+
+                  len += (next ? next : end) - start;
                 }
               else
                 {
@@ -0,0 +1,140 @@
+/*
+ * thread.c: running batches of independent jobs on several threads
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <apr_thread_proc.h>
+
+#include "svn_pools.h"
+#include "svn_sorts.h"
+
+#include "private/svn_atomic.h"
+#include "private/svn_thread.h"
+
+/* A batch of jobs being processed. */
+typedef struct batch_t
+{
+  /* Parameters passed to svn_thread__run_batch. */
+  const apr_array_header_t *jobs;
+  svn_thread__job_func_t worker_fn;
+  void *baton;
+
+  /* Index of the next job to process. */
+  volatile svn_atomic_t next;
+} batch_t;
+
+/* Process jobs from BATCH on the thread with THREAD_INDEX until there are
+   none left. */
+static void
+process_jobs(batch_t *batch,
+             int thread_index)
+{
+  while (TRUE)
+    {
+      /* svn_atomic_inc returns the value before the increment. */
+      apr_uint32_t i = svn_atomic_inc(&batch->next);
+      if (i >= (apr_uint32_t)batch->jobs->nelts)
+        break;
+
+      batch->worker_fn(APR_ARRAY_IDX(batch->jobs, i, void *), thread_index,
+                       batch->baton);
+    }
+}
+
+#if APR_HAS_THREADS
+
+/* One of the additional threads processing a batch. */
+typedef struct worker_t
+{
+  batch_t *batch;
+  int thread_index;
+} worker_t;
+
+/* Implements apr_thread_start_t, calling process_jobs for the worker_t
+   in DATA. */
+static void * APR_THREAD_FUNC
+worker_thread(apr_thread_t *thread, void *data)
+{
+  worker_t *worker = data;
+  process_jobs(worker->batch, worker->thread_index);
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+#endif
+
+void
+svn_thread__run_batch(const apr_array_header_t *jobs,
+                      svn_thread__job_func_t worker_fn,
+                      void *baton,
+                      int max_threads)
+{
+  batch_t batch;
+#if APR_HAS_THREADS
+  apr_pool_t *pool;
+  apr_thread_t **threads;
+  worker_t *workers;
+  int count = MIN(max_threads, jobs->nelts) - 1;
+  int thread_count = 0;
+  int i;
+#endif
+
+  batch.jobs = jobs;
+  batch.worker_fn = worker_fn;
+  batch.baton = baton;
+  batch.next = 0;
+
+#if APR_HAS_THREADS
+  if (count < 1)
+    {
+      process_jobs(&batch, 0);
+      return;
+    }
+
+  /* Threads create and destroy their own sub-pools concurrently. */
+  pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  threads = apr_palloc(pool, count * sizeof(*threads));
+  workers = apr_palloc(pool, count * sizeof(*workers));
+
+  for (i = 0; i < count; ++i)
+    {
+      workers[thread_count].batch = &batch;
+      workers[thread_count].thread_index = thread_count + 1;
+      if (apr_thread_create(&threads[thread_count], NULL, worker_thread,
+                            &workers[thread_count], pool) == APR_SUCCESS)
+        ++thread_count;
+    }
+
+  /* The calling thread does its share, too. */
+  process_jobs(&batch, 0);
+
+  for (i = 0; i < thread_count; ++i)
+    {
+      apr_status_t retval;
+      apr_thread_join(&retval, threads[i]);
+    }
+
+  svn_pool_destroy(pool);
+#else
+  process_jobs(&batch, 0);
+#endif
+}
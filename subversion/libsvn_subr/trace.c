@@ -0,0 +1,189 @@
+/*
+ * trace.c: timing spans of requests across client and server
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+#include <apr_strings.h>
+
+#include "svn_pools.h"
+#include "svn_io.h"
+#include "svn_types.h"
+
+#include "private/svn_trace.h"
+
+/* Size of the buffer for formatted spans not written yet. */
+#define BUFFER_SIZE 0x4000
+
+/* Upper limit for the length of a single formatted span. */
+#define MAX_LINE_LEN 512
+
+struct svn_trace__t
+{
+  /* Absolute path of the trace file to append to.  NULL if spans get
+   * discarded. */
+  const char *path;
+
+  /* ID given to all spans of this trace. */
+  const char *request_id;
+
+  /* Formatted spans not written yet.  BUFFER holds BUFFER_SIZE bytes of
+   * which the first USED are in use.  NULL if PATH is. */
+  char *buffer;
+  apr_size_t used;
+
+  /* Owns this structure.  Scratch pool for writing the buffer. */
+  apr_pool_t *pool;
+  apr_pool_t *scratch_pool;
+};
+
+/* Append the buffer contents of TRACE to its file using SCRATCH_POOL and
+ * empty the buffer.  The file gets opened and closed every time so that
+ * multiple traces and processes may share it; each flush is a single
+ * append. */
+static svn_error_t *
+flush_buffer(svn_trace__t *trace,
+             apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+  apr_size_t used = trace->used;
+
+  if (used == 0)
+    return SVN_NO_ERROR;
+
+  /* Drop the data even if we fail to write it.  A trace with gaps is
+   * still more useful than one that stops at the first problem. */
+  trace->used = 0;
+
+  SVN_ERR(svn_io_file_open(&file, trace->path,
+                           APR_WRITE | APR_CREATE | APR_APPEND,
+                           APR_OS_DEFAULT, scratch_pool));
+  SVN_ERR(svn_io_file_write_full(file, trace->buffer, used, NULL,
+                                 scratch_pool));
+
+  return svn_error_trace(svn_io_file_close(file, scratch_pool));
+}
+
+/* Pool cleanup function writing the remaining spans in DATA, a
+ * svn_trace__t. */
+static apr_status_t
+trace_cleanup(void *data)
+{
+  svn_trace__t *trace = data;
+
+  /* SCRATCH_POOL has been destroyed already as it is a sub-pool of
+   * TRACE->POOL. */
+  svn_error_clear(flush_buffer(trace, trace->pool));
+
+  return APR_SUCCESS;
+}
+
+svn_trace__t *
+svn_trace__create(const char *path,
+                  const char *request_id,
+                  apr_pool_t *pool)
+{
+  apr_pool_t *trace_pool = svn_pool_create(pool);
+  svn_trace__t *trace = apr_pcalloc(trace_pool, sizeof(*trace));
+
+  trace->request_id = request_id
+                    ? apr_pstrdup(trace_pool, request_id)
+                    : svn_uuid_generate(trace_pool);
+  trace->pool = trace_pool;
+
+  if (path)
+    {
+      trace->path = apr_pstrdup(trace_pool, path);
+      trace->buffer = apr_palloc(trace_pool, BUFFER_SIZE);
+      trace->scratch_pool = svn_pool_create(trace_pool);
+
+      apr_pool_cleanup_register(trace_pool, trace, trace_cleanup,
+                                apr_pool_cleanup_null);
+    }
+
+  return trace;
+}
+
+svn_trace__t *
+svn_trace__dup(const svn_trace__t *trace,
+               apr_pool_t *pool)
+{
+  return trace ? svn_trace__create(trace->path, trace->request_id, pool)
+               : NULL;
+}
+
+svn_boolean_t
+svn_trace__valid_request_id(const char *request_id)
+{
+  apr_size_t len;
+
+  for (len = 0; request_id[len]; ++len)
+    if (   len == SVN_TRACE__MAX_REQUEST_ID_LEN
+        || request_id[len] <= ' ' || request_id[len] > '~')
+      return FALSE;
+
+  return len > 0;
+}
+
+const char *
+svn_trace__request_id(const svn_trace__t *trace)
+{
+  return trace ? trace->request_id : NULL;
+}
+
+apr_time_t
+svn_trace__start(const svn_trace__t *trace)
+{
+  return trace ? apr_time_now() : 0;
+}
+
+void
+svn_trace__span(svn_trace__t *trace,
+                const char *component,
+                const char *phase,
+                const char *detail,
+                apr_time_t start)
+{
+  char line[MAX_LINE_LEN];
+  apr_size_t len;
+
+  if (!trace || !trace->path || !start)
+    return;
+
+  len = apr_snprintf(line, sizeof(line),
+                     "%" APR_TIME_T_FMT "\t%s\t%s\t%s\t%s"
+                     "\t%" APR_TIME_T_FMT "\n",
+                     start, trace->request_id, component, phase,
+                     detail ? detail : "-", apr_time_now() - start);
+
+  /* Don't write truncated lines without their newline. */
+  if (len == sizeof(line) - 1)
+    line[len - 1] = '\n';
+
+  if (trace->used + len > BUFFER_SIZE)
+    {
+      svn_error_clear(flush_buffer(trace, trace->scratch_pool));
+      svn_pool_clear(trace->scratch_pool);
+    }
+
+  memcpy(trace->buffer + trace->used, line, len);
+  trace->used += len;
+}
@@ -60,6 +60,12 @@
 #include "private/svn_eol_private.h"
 #include "private/svn_dep_compat.h"
 
+#if defined(SVN__HAVE_SSE2)
+#include <emmintrin.h>
+#elif defined(SVN__HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 /* Lookup table to categorise each octet in the string. */
 static const char octet_category[256] = {
   0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, /* 0x00-0x7f */
@@ -258,6 +264,24 @@ static const char machine [9][14] = {
 static const char *
 first_non_fsm_start_char(const char *data, apr_size_t max_len)
 {
+#if defined(SVN__HAVE_SSE2)
+
+  /* Scan the input 16 bytes at a time.  A non-ASCII char sets the MSB,
+   * which is exactly what the movemask collects. */
+  for (; max_len >= sizeof(__m128i)
+       ; data += sizeof(__m128i), max_len -= sizeof(__m128i))
+    if (_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)data)))
+      break;
+
+#elif defined(SVN__HAVE_NEON)
+
+  for (; max_len >= sizeof(uint8x16_t)
+       ; data += sizeof(uint8x16_t), max_len -= sizeof(uint8x16_t))
+    if (vmaxvq_u8(vld1q_u8((const uint8_t *)data)) >= 0x80)
+      break;
+
+#endif
+
 #if SVN_UNALIGNED_ACCESS_IS_OK
 
   /* Scan the input one machine word at a time. */
@@ -290,7 +314,14 @@ svn_utf__last_valid(const char *data, apr_size_t len)
       int category = octet_category[octet];
       state = machine[state][category];
       if (state == FSM_START)
-        start = data;
+        {
+          /* Skip the ASCII run following a complete char in bulk. */
+          if (data < end && (unsigned char)*data < 0x80)
+            data = first_non_fsm_start_char(data, end - data);
+          start = data;
+        }
+      else if (state == FSM_ERROR)
+        break;
     }
   return start;
 }
@@ -320,6 +351,14 @@ svn_utf__is_valid(const char *data, apr_size_t len)
       unsigned char octet = *data++;
       int category = octet_category[octet];
       state = machine[state][category];
+      if (state == FSM_START)
+        {
+          /* Skip the ASCII run following a complete char in bulk. */
+          if (data < end && (unsigned char)*data < 0x80)
+            data = first_non_fsm_start_char(data, end - data);
+        }
+      else if (state == FSM_ERROR)
+        return FALSE;
     }
   return state == FSM_START;
 }
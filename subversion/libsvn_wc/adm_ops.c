@@ -875,6 +875,21 @@ svn_wc__get_pristine_contents_by_checksum(svn_stream_t **contents,
       *contents = svn_stream_lazyopen_create(get_pristine_lazyopen_func,
                                              gpl_baton, FALSE, result_pool);
     }
+  else
+    {
+      /* Another working copy on this machine may have it.  That is just
+         an optimization, so don't fail if we can't use it. */
+      svn_error_t *err = svn_wc__db_pristine_read_shared(contents,
+                                                         wc_ctx->db,
+                                                         checksum,
+                                                         result_pool,
+                                                         scratch_pool);
+      if (err)
+        {
+          svn_error_clear(err);
+          *contents = NULL;
+        }
+    }
 
   return SVN_NO_ERROR;
 }
@@ -25,17 +25,23 @@
 
 #include <string.h>
 
+#include <apr_pools.h>
+
 #include "svn_wc.h"
 #include "svn_error.h"
 #include "svn_pools.h"
 #include "svn_io.h"
 #include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_subst.h"
 
 #include "wc.h"
 #include "adm_files.h"
 #include "lock.h"
+#include "translate.h"
 #include "workqueue.h"
 
+#include "private/svn_thread.h"
 #include "private/svn_wc_private.h"
 #include "svn_private_config.h"
 
@@ -67,16 +73,320 @@ can_be_cleaned(int *wc_format,
   return SVN_NO_ERROR;
 }
 
-/* Dummy svn_wc_status_func4_t implementation */
+
+/*** Repairing recorded timestamps ***/
+
+/* A file whose recorded size or timestamp does not match the working file
+   must be read, normalized and hashed to find out whether it still
+   matches its pristine text, before its recorded information can be
+   repaired.  After a tree got touched, that is the bulk of the work, so
+   many files get compared in parallel.  The information of the
+   unmodified ones is then recorded in a single transaction per batch. */
+
+/* Maximum number of files to compare in parallel. */
+#define REPAIR_BATCH_SIZE 256
+
+/* Maximum number of threads comparing files. */
+#define REPAIR_THREAD_COUNT 8
+
+/* One file to compare with its pristine text. */
+typedef struct repair_job_t
+{
+  const char *local_abspath;
+
+  /* The working file as found before comparing it. */
+  const svn_io_dirent2_t *dirent;
+
+  /* The pristine text to compare with. */
+  const svn_checksum_t *checksum;
+
+  /* How to normalize the working file before hashing it. */
+  svn_boolean_t need_translation;
+  const char *eol_str;
+  apr_hash_t *keywords;
+
+  /* Results. */
+  svn_boolean_t modified;
+  svn_error_t *err;
+
+  /* Pool only to be used by the thread processing this job. */
+  apr_pool_t *pool;
+} repair_job_t;
+
+/* The files queued for comparison. */
+typedef struct repair_batch_t
+{
+  /* The repair_job_t * to process. */
+  apr_array_header_t *jobs;
+
+  /* Thread-safe pool holding JOBS, cleared after each batch. */
+  apr_pool_t *pool;
+} repair_batch_t;
+
+/* Set JOB->MODIFIED to whether JOB's working file differs from its
+   pristine text, after normalization.  Use SCRATCH_POOL for temporary
+   allocations. */
 static svn_error_t *
-status_dummy_callback(void *baton,
-                      const char *local_abspath,
-                      const svn_wc_status3_t *status,
-                      apr_pool_t *scratch_pool)
+compare_repair_job(repair_job_t *job,
+                   apr_pool_t *scratch_pool)
 {
+  svn_stream_t *stream;
+  svn_checksum_t *checksum;
+
+  SVN_ERR(svn_stream_open_readonly(&stream, job->local_abspath,
+                                   scratch_pool, scratch_pool));
+  if (job->need_translation)
+    stream = svn_subst_stream_translated(stream, job->eol_str,
+                                         TRUE /* repair */,
+                                         job->keywords,
+                                         FALSE /* expand */,
+                                         scratch_pool);
+
+  SVN_ERR(svn_stream_contents_checksum(&checksum, stream,
+                                       job->checksum->kind,
+                                       scratch_pool, scratch_pool));
+  job->modified = !svn_checksum_match(checksum, job->checksum);
+
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_thread__job_func_t, comparing the repair_job_t in
+   DATA. */
+static void
+compare_repair_job_func(void *data,
+                        int thread_index,
+                        void *baton)
+{
+  repair_job_t *job = data;
+
+  job->err = compare_repair_job(job, job->pool);
+}
+
+/* Compare all files queued in BATCH, using additional threads if
+   available, and record the size and timestamp of the unmodified ones in
+   the working copy containing WRI_ABSPATH in DB.  Empty BATCH afterwards.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_repair_batch(repair_batch_t *batch,
+                 svn_wc__db_t *db,
+                 const char *wri_abspath,
+                 apr_pool_t *scratch_pool)
+{
+  apr_hash_t *record_map = apr_hash_make(scratch_pool);
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  if (batch->jobs->nelts == 0)
+    return SVN_NO_ERROR;
+
+  svn_thread__run_batch(batch->jobs, compare_repair_job_func, NULL,
+                        REPAIR_THREAD_COUNT);
+
+  /* Report the first failure in walk order, but still repair the files
+     that could be compared. */
+  for (i = 0; i < batch->jobs->nelts; i++)
+    {
+      repair_job_t *job = APR_ARRAY_IDX(batch->jobs, i, repair_job_t *);
+
+      if (job->err && !err)
+        err = job->err;
+      else if (job->err)
+        svn_error_clear(job->err);
+      else if (!job->modified)
+        svn_hash_sets(record_map, job->local_abspath, job->dirent);
+    }
+
+  err = svn_error_compose_create(
+          err,
+          svn_wc__db_global_record_fileinfo_many(db, wri_abspath, record_map,
+                                                 scratch_pool));
+
+  svn_pool_clear(batch->pool);
+  batch->jobs = apr_array_make(batch->pool, REPAIR_BATCH_SIZE,
+                               sizeof(repair_job_t *));
+
+  return svn_error_trace(err);
+}
+
+/* Queue the versioned file LOCAL_ABSPATH, described by INFO and found on
+   disk as DIRENT, to be compared with its pristine text in BATCH.  Files
+   that can't be compared that way, like symlinks, get compared and
+   repaired right away.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+queue_repair(repair_batch_t *batch,
+             svn_wc__db_t *db,
+             const char *local_abspath,
+             const struct svn_wc__db_info_t *info,
+             const svn_io_dirent2_t *dirent,
+             apr_pool_t *scratch_pool)
+{
+  svn_subst_eol_style_t eol_style = svn_subst_eol_style_none;
+  const char *eol_str = NULL;
+  apr_hash_t *keywords = NULL;
+  svn_boolean_t special = FALSE;
+  repair_job_t *job;
+
+  if (info->had_props || info->props_mod)
+    SVN_ERR(svn_wc__get_translate_info(&eol_style, &eol_str, &keywords,
+                                       &special, db, local_abspath, NULL,
+                                       TRUE, batch->pool, scratch_pool));
+
+  if (special || dirent->special
+      || (eol_style != svn_subst_eol_style_none
+          && eol_style != svn_subst_eol_style_native
+          && eol_style != svn_subst_eol_style_fixed))
+    {
+      svn_boolean_t modified;
+
+      /* Leave the unusual cases to the standard implementation, which
+         also repairs the recorded information as we hold the lock. */
+      return svn_error_trace(svn_wc__internal_file_modified_p(
+                                             &modified, db, local_abspath,
+                                             FALSE, scratch_pool));
+    }
+
+  job = apr_pcalloc(batch->pool, sizeof(*job));
+  job->need_translation = svn_subst_translation_required(eol_style, eol_str,
+                                                         keywords, FALSE,
+                                                         TRUE);
+  if (!job->need_translation)
+    {
+      svn_filesize_t pristine_size;
+
+      /* A different size tells the file is modified. */
+      SVN_ERR(svn_wc__db_pristine_read(NULL, &pristine_size, db,
+                                       local_abspath, info->checksum,
+                                       scratch_pool, scratch_pool));
+      if (pristine_size != dirent->filesize)
+        return SVN_NO_ERROR;
+    }
+  else if (eol_style == svn_subst_eol_style_native)
+    eol_str = SVN_SUBST_NATIVE_EOL_STR;
+
+  job->local_abspath = apr_pstrdup(batch->pool, local_abspath);
+  job->dirent = svn_io_dirent2_dup(dirent, batch->pool);
+  job->checksum = svn_checksum_dup(info->checksum, batch->pool);
+  job->eol_str = eol_str;
+  job->keywords = keywords;
+  job->pool = svn_pool_create(batch->pool);
+
+  APR_ARRAY_PUSH(batch->jobs, repair_job_t *) = job;
+
+  return SVN_NO_ERROR;
+}
+
+/* Queue all versioned files below the versioned directory DIR_ABSPATH in
+   BATCH whose recorded size or timestamp don't match the working files.
+   Run BATCH whenever it is full.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+queue_repairs(repair_batch_t *batch,
+              svn_wc__db_t *db,
+              const char *dir_abspath,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *scratch_pool)
+{
+  apr_hash_t *nodes, *conflicts, *dirents;
+  apr_hash_index_t *hi;
+  apr_pool_t *iterpool;
+  svn_error_t *err;
+
+  if (cancel_func)
+    SVN_ERR(cancel_func(cancel_baton));
+
+  err = svn_io_get_dirents3(&dirents, dir_abspath, FALSE,
+                            scratch_pool, scratch_pool);
+  if (err && (APR_STATUS_IS_ENOENT(err->apr_err)
+              || SVN__APR_STATUS_IS_ENOTDIR(err->apr_err)))
+    {
+      /* Nothing to repair in a missing directory. */
+      svn_error_clear(err);
+      return SVN_NO_ERROR;
+    }
+  else
+    SVN_ERR(err);
+
+  SVN_ERR(svn_wc__db_read_children_info(&nodes, &conflicts, db, dir_abspath,
+                                        FALSE, scratch_pool, scratch_pool));
+
+  iterpool = svn_pool_create(scratch_pool);
+  for (hi = apr_hash_first(scratch_pool, nodes); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const struct svn_wc__db_info_t *info = apr_hash_this_val(hi);
+      const svn_io_dirent2_t *dirent = svn_hash_gets(dirents, name);
+      const char *child_abspath;
+
+      svn_pool_clear(iterpool);
+
+      if (!dirent
+          || (info->status != svn_wc__db_status_normal
+              && info->status != svn_wc__db_status_added))
+        continue;
+
+      child_abspath = svn_dirent_join(dir_abspath, name, iterpool);
+
+      if (info->kind == svn_node_dir && dirent->kind == svn_node_dir)
+        {
+          svn_boolean_t is_wcroot;
+
+          /* Don't descend into obstructing working copies. */
+          SVN_ERR(svn_wc__db_is_wcroot(&is_wcroot, db, child_abspath,
+                                       iterpool));
+          if (!is_wcroot)
+            SVN_ERR(queue_repairs(batch, db, child_abspath,
+                                  cancel_func, cancel_baton, iterpool));
+        }
+      else if (info->kind == svn_node_file && dirent->kind == svn_node_file
+               && info->checksum)
+        {
+          /* The same heuristic as svn_wc__internal_file_modified_p() */
+          if ((info->recorded_size == SVN_INVALID_FILESIZE
+               || dirent->filesize == info->recorded_size)
+              && dirent->mtime == info->recorded_time)
+            continue;
+
+          SVN_ERR(queue_repair(batch, db, child_abspath, info, dirent,
+                               iterpool));
+
+          if (batch->jobs->nelts >= REPAIR_BATCH_SIZE)
+            SVN_ERR(run_repair_batch(batch, db, dir_abspath, iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Repair the recorded sizes and timestamps of all unmodified files below
+   DIR_ABSPATH in DB, which must be locked.  Use SCRATCH_POOL for temporary
+   allocations. */
+static svn_error_t *
+repair_timestamps(svn_wc__db_t *db,
+                  const char *dir_abspath,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *scratch_pool)
+{
+  repair_batch_t batch = { 0 };
+  svn_error_t *err;
+
+  /* Job pools are used from several threads. */
+  batch.pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  batch.jobs = apr_array_make(batch.pool, REPAIR_BATCH_SIZE,
+                              sizeof(repair_job_t *));
+
+  err = queue_repairs(&batch, db, dir_abspath, cancel_func, cancel_baton,
+                      scratch_pool);
+  if (!err)
+    err = run_repair_batch(&batch, db, dir_abspath, scratch_pool);
+
+  svn_pool_destroy(batch.pool);
+  return svn_error_trace(err);
+}
+
+
 /* */
 static svn_error_t *
 cleanup_internal(svn_wc__db_t *db,
@@ -132,19 +442,8 @@ cleanup_internal(svn_wc__db_t *db,
     }
 
   if (fix_recorded_timestamps)
-    {
-      /* Instead of implementing a separate repair step here, use the standard
-         status walker's optimized implementation, which performs repairs when
-         there is a lock. */
-      SVN_ERR(svn_wc__internal_walk_status(db, dir_abspath, svn_depth_infinity,
-                                           FALSE /* get_all */,
-                                           FALSE /* no_ignore */,
-                                           FALSE /* ignore_text_mods */,
-                                           NULL /* ignore patterns */,
-                                           status_dummy_callback, NULL,
-                                           cancel_func, cancel_baton,
-                                           scratch_pool));
-    }
+    SVN_ERR(repair_timestamps(db, dir_abspath, cancel_func, cancel_baton,
+                              scratch_pool));
 
   /* All done, toss the lock */
   SVN_ERR(svn_wc__db_wclock_release(db, dir_abspath, scratch_pool));
@@ -793,7 +793,9 @@ merge_file_trivial(svn_skel_t **work_items,
 
 
 /* Handle a non-trivial merge of 'text' files.  (Assume that a trivial
- * merge was not possible.)
+ * merge was not possible.)  The merged text has already been written to
+ * RESULT_TARGET by run_text_merge(); CONTAINS_CONFLICTS tells whether it
+ * contains conflict markers.
  *
  * Set *WORK_ITEMS, *CONFLICT_SKEL and *MERGE_OUTCOME according to the
  * result -- to install the merged file, or to indicate a conflict.
@@ -824,61 +826,18 @@ merge_text_file(svn_skel_t **work_items,
                 const char *target_label,
                 svn_boolean_t dry_run,
                 const char *detranslated_target_abspath,
+                const char *result_target,
+                svn_boolean_t contains_conflicts,
                 svn_cancel_func_t cancel_func,
                 void *cancel_baton,
                 apr_pool_t *result_pool,
                 apr_pool_t *scratch_pool)
 {
   apr_pool_t *pool = scratch_pool;  /* ### temporary rename  */
-  svn_boolean_t contains_conflicts;
-  apr_file_t *result_f;
-  const char *result_target;
-  const char *base_name;
-  const char *temp_dir;
   svn_skel_t *work_item;
 
   *work_items = NULL;
 
-  base_name = svn_dirent_basename(mt->local_abspath, scratch_pool);
-
-  /* Open a second temporary file for writing; this is where diff3
-     will write the merged results.  We want to use a tempfile
-     with a name that reflects the original, in case this
-     ultimately winds up in a conflict resolution editor.  */
-  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&temp_dir, mt->db, mt->wri_abspath,
-                                         pool, pool));
-  SVN_ERR(svn_io_open_uniquely_named(&result_f, &result_target,
-                                     temp_dir, base_name, ".tmp",
-                                     svn_io_file_del_none, pool, pool));
-
-  /* Run the external or internal merge, as requested. */
-  if (mt->diff3_cmd)
-      SVN_ERR(do_text_merge_external(&contains_conflicts,
-                                     result_f,
-                                     mt->diff3_cmd,
-                                     mt->merge_options,
-                                     detranslated_target_abspath,
-                                     left_abspath,
-                                     right_abspath,
-                                     target_label,
-                                     left_label,
-                                     right_label,
-                                     pool));
-  else /* Use internal merge. */
-    SVN_ERR(do_text_merge(&contains_conflicts,
-                          result_f,
-                          mt->merge_options,
-                          detranslated_target_abspath,
-                          left_abspath,
-                          right_abspath,
-                          target_label,
-                          left_label,
-                          right_label,
-                          cancel_func, cancel_baton,
-                          pool));
-
-  SVN_ERR(svn_io_file_close(result_f, pool));
-
   /* Determine the MERGE_OUTCOME, and record any conflict. */
   if (contains_conflicts)
     {
@@ -1074,113 +1033,278 @@ merge_binary_file(svn_skel_t **work_items,
   return SVN_NO_ERROR;
 }
 
-svn_error_t *
-svn_wc__internal_merge(svn_skel_t **work_items,
-                       svn_skel_t **conflict_skel,
-                       enum svn_wc_merge_outcome_t *merge_outcome,
-                       svn_wc__db_t *db,
-                       const char *left_abspath,
-                       const char *right_abspath,
-                       const char *target_abspath,
-                       const char *wri_abspath,
-                       const char *left_label,
-                       const char *right_label,
-                       const char *target_label,
-                       apr_hash_t *old_actual_props,
-                       svn_boolean_t dry_run,
-                       const char *diff3_cmd,
-                       const apr_array_header_t *merge_options,
-                       const apr_array_header_t *prop_diff,
-                       svn_cancel_func_t cancel_func,
-                       void *cancel_baton,
-                       apr_pool_t *result_pool,
-                       apr_pool_t *scratch_pool)
+/* The state of a merge of a file's contents between prepare_text_merge(),
+ * run_text_merge() and complete_text_merge().
+ */
+typedef struct text_merge_t
 {
+  merge_target_t mt;
+
+  /* The inputs, as for svn_wc__internal_merge().  LEFT_ABSPATH has been
+     converted to the new EOL style, if the merge changes it. */
+  const char *left_abspath;
+  const char *right_abspath;
   const char *detranslated_target_abspath;
-  svn_boolean_t is_binary = FALSE;
+  const char *left_label;
+  const char *right_label;
+  const char *target_label;
+  svn_boolean_t is_binary;
+  svn_boolean_t dry_run;
+
+  /* Outcome and work items of the attempt to merge trivially. */
+  enum svn_wc_merge_outcome_t merge_outcome;
+  svn_skel_t *work_items;
+
+  /* The directory to write the merge result to, if run_text_merge() has to
+     merge the texts.  NULL otherwise. */
+  const char *temp_dir;
+
+  /* The merge result, as set by run_text_merge(). */
+  const char *result_target;
+  svn_boolean_t contains_conflicts;
+
+  /* The pool containing this structure. */
+  apr_pool_t *pool;
+} text_merge_t;
+
+/* Prepare the merge of the contents of TARGET_ABSPATH for
+ * svn_wc__internal_merge(), which describes the other arguments, and
+ * return it in *TEXT_MERGE.  If the merge can be done trivially or if the
+ * files are binary, determine the outcome right away.
+ *
+ * If COPY_INPUTS is set and the texts need to be merged, merge copies of
+ * LEFT_ABSPATH and RIGHT_ABSPATH.  The caller may then remove those files
+ * before run_text_merge() gets called.
+ *
+ * Allocate the work items of a trivial merge in RESULT_POOL.  Allocate
+ * *TEXT_MERGE and temporary files in STATE_POOL, which must live until
+ * the merge has been completed.  Use SCRATCH_POOL for temporary
+ * allocations.
+ */
+static svn_error_t *
+prepare_text_merge(text_merge_t **text_merge,
+                   svn_wc__db_t *db,
+                   const char *left_abspath,
+                   const char *right_abspath,
+                   const char *target_abspath,
+                   const char *wri_abspath,
+                   const char *left_label,
+                   const char *right_label,
+                   const char *target_label,
+                   apr_hash_t *old_actual_props,
+                   svn_boolean_t dry_run,
+                   const char *diff3_cmd,
+                   const apr_array_header_t *merge_options,
+                   const apr_array_header_t *prop_diff,
+                   svn_boolean_t copy_inputs,
+                   svn_cancel_func_t cancel_func,
+                   void *cancel_baton,
+                   apr_pool_t *result_pool,
+                   apr_pool_t *state_pool,
+                   apr_pool_t *scratch_pool)
+{
+  text_merge_t *tm = apr_pcalloc(state_pool, sizeof(*tm));
   const svn_prop_t *mimeprop;
-  svn_skel_t *work_item;
-  merge_target_t mt;
 
   SVN_ERR_ASSERT(svn_dirent_is_absolute(left_abspath));
   SVN_ERR_ASSERT(svn_dirent_is_absolute(right_abspath));
   SVN_ERR_ASSERT(svn_dirent_is_absolute(target_abspath));
 
-  *work_items = NULL;
-
   /* Fill the merge target baton */
-  mt.db = db;
-  mt.local_abspath = target_abspath;
-  mt.wri_abspath = wri_abspath;
-  mt.old_actual_props = old_actual_props;
-  mt.prop_diff = prop_diff;
-  mt.diff3_cmd = diff3_cmd;
-  mt.merge_options = merge_options;
+  tm->mt.db = db;
+  tm->mt.local_abspath = target_abspath;
+  tm->mt.wri_abspath = wri_abspath;
+  tm->mt.old_actual_props = old_actual_props;
+  tm->mt.prop_diff = prop_diff;
+  tm->mt.diff3_cmd = diff3_cmd;
+  tm->mt.merge_options = merge_options;
+
+  tm->right_abspath = right_abspath;
+  tm->left_label = left_label;
+  tm->right_label = right_label;
+  tm->target_label = target_label;
+  tm->dry_run = dry_run;
+  tm->pool = state_pool;
 
   /* Decide if the merge target is a text or binary file. */
   if ((mimeprop = get_prop(prop_diff, SVN_PROP_MIME_TYPE))
       && mimeprop->value)
-    is_binary = svn_mime_type_is_binary(mimeprop->value->data);
+    tm->is_binary = svn_mime_type_is_binary(mimeprop->value->data);
   else
     {
-      const char *value = svn_prop_get_value(mt.old_actual_props,
+      const char *value = svn_prop_get_value(tm->mt.old_actual_props,
                                              SVN_PROP_MIME_TYPE);
 
-      is_binary = value && svn_mime_type_is_binary(value);
+      tm->is_binary = value && svn_mime_type_is_binary(value);
     }
 
-  SVN_ERR(detranslate_wc_file(&detranslated_target_abspath, &mt,
-                              (! is_binary) && diff3_cmd != NULL,
+  SVN_ERR(detranslate_wc_file(&tm->detranslated_target_abspath, &tm->mt,
+                              (! tm->is_binary) && diff3_cmd != NULL,
                               target_abspath,
                               cancel_func, cancel_baton,
-                              scratch_pool, scratch_pool));
+                              state_pool, scratch_pool));
 
   /* We cannot depend on the left file to contain the same eols as the
      right file. If the merge target has mods, this will mark the entire
      file as conflicted, so we need to compensate. */
-  SVN_ERR(maybe_update_target_eols(&left_abspath, prop_diff, left_abspath,
+  SVN_ERR(maybe_update_target_eols(&tm->left_abspath, prop_diff,
+                                   left_abspath,
                                    cancel_func, cancel_baton,
-                                   scratch_pool, scratch_pool));
+                                   state_pool, scratch_pool));
 
-  SVN_ERR(merge_file_trivial(work_items, merge_outcome,
-                             left_abspath, right_abspath,
-                             target_abspath, detranslated_target_abspath,
+  SVN_ERR(merge_file_trivial(&tm->work_items, &tm->merge_outcome,
+                             tm->left_abspath, right_abspath,
+                             target_abspath, tm->detranslated_target_abspath,
                              dry_run, db, cancel_func, cancel_baton,
                              result_pool, scratch_pool));
+
+  if (tm->merge_outcome == svn_wc_merge_no_merge && ! tm->is_binary)
+    {
+      /* The merge result will be written to a temporary file in here. */
+      SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&tm->temp_dir, db, wri_abspath,
+                                             state_pool, scratch_pool));
+
+      if (copy_inputs)
+        {
+          const char *left_copy;
+          const char *right_copy;
+
+          SVN_ERR(svn_io_open_unique_file3(NULL, &left_copy, tm->temp_dir,
+                                           svn_io_file_del_on_pool_cleanup,
+                                           state_pool, scratch_pool));
+          SVN_ERR(svn_io_copy_file(tm->left_abspath, left_copy, FALSE,
+                                   scratch_pool));
+          SVN_ERR(svn_io_open_unique_file3(NULL, &right_copy, tm->temp_dir,
+                                           svn_io_file_del_on_pool_cleanup,
+                                           state_pool, scratch_pool));
+          SVN_ERR(svn_io_copy_file(right_abspath, right_copy, FALSE,
+                                   scratch_pool));
+
+          tm->left_abspath = left_copy;
+          tm->right_abspath = right_copy;
+        }
+    }
+
+  *text_merge = tm;
+
+  return SVN_NO_ERROR;
+}
+
+/* Merge the texts of TM, if prepare_text_merge() decided that we need to.
+ * This only accesses the files given to prepare_text_merge() and TM's
+ * temporary directory, but not the working copy database.
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+run_text_merge(text_merge_t *tm,
+               svn_cancel_func_t cancel_func,
+               void *cancel_baton,
+               apr_pool_t *scratch_pool)
+{
+  apr_file_t *result_f;
+  const char *base_name;
+
+  if (tm->temp_dir == NULL || tm->result_target)
+    return SVN_NO_ERROR;
+
+  base_name = svn_dirent_basename(tm->mt.local_abspath, scratch_pool);
+
+  /* Open a second temporary file for writing; this is where diff3
+     will write the merged results.  We want to use a tempfile
+     with a name that reflects the original, in case this
+     ultimately winds up in a conflict resolution editor.  */
+  SVN_ERR(svn_io_open_uniquely_named(&result_f, &tm->result_target,
+                                     tm->temp_dir, base_name, ".tmp",
+                                     svn_io_file_del_none,
+                                     tm->pool, scratch_pool));
+
+  /* Run the external or internal merge, as requested. */
+  if (tm->mt.diff3_cmd)
+      SVN_ERR(do_text_merge_external(&tm->contains_conflicts,
+                                     result_f,
+                                     tm->mt.diff3_cmd,
+                                     tm->mt.merge_options,
+                                     tm->detranslated_target_abspath,
+                                     tm->left_abspath,
+                                     tm->right_abspath,
+                                     tm->target_label,
+                                     tm->left_label,
+                                     tm->right_label,
+                                     scratch_pool));
+  else /* Use internal merge. */
+    SVN_ERR(do_text_merge(&tm->contains_conflicts,
+                          result_f,
+                          tm->mt.merge_options,
+                          tm->detranslated_target_abspath,
+                          tm->left_abspath,
+                          tm->right_abspath,
+                          tm->target_label,
+                          tm->left_label,
+                          tm->right_label,
+                          cancel_func, cancel_baton,
+                          scratch_pool));
+
+  SVN_ERR(svn_io_file_close(result_f, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Finish the merge TM for svn_wc__internal_merge(), which describes the
+ * other arguments, after run_text_merge() has been called for it.
+ */
+static svn_error_t *
+complete_text_merge(svn_skel_t **work_items,
+                    svn_skel_t **conflict_skel,
+                    enum svn_wc_merge_outcome_t *merge_outcome,
+                    text_merge_t *tm,
+                    svn_cancel_func_t cancel_func,
+                    void *cancel_baton,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  svn_skel_t *work_item;
+
+  *work_items = tm->work_items;
+  *merge_outcome = tm->merge_outcome;
+
   if (*merge_outcome == svn_wc_merge_no_merge)
     {
       /* We have a non-trivial merge.  If we classify it as a merge of
        * 'binary' files we'll just raise a conflict, otherwise we'll do
        * the actual merge of 'text' file contents. */
-      if (is_binary)
+      if (tm->is_binary)
         {
           /* Raise a text conflict */
           SVN_ERR(merge_binary_file(work_items,
                                     conflict_skel,
                                     merge_outcome,
-                                    &mt,
-                                    left_abspath,
-                                    right_abspath,
-                                    left_label,
-                                    right_label,
-                                    target_label,
-                                    dry_run,
-                                    detranslated_target_abspath,
+                                    &tm->mt,
+                                    tm->left_abspath,
+                                    tm->right_abspath,
+                                    tm->left_label,
+                                    tm->right_label,
+                                    tm->target_label,
+                                    tm->dry_run,
+                                    tm->detranslated_target_abspath,
                                     result_pool, scratch_pool));
         }
       else
         {
+          SVN_ERR_ASSERT(tm->result_target != NULL);
           SVN_ERR(merge_text_file(work_items,
                                   conflict_skel,
                                   merge_outcome,
-                                  &mt,
-                                  left_abspath,
-                                  right_abspath,
-                                  left_label,
-                                  right_label,
-                                  target_label,
-                                  dry_run,
-                                  detranslated_target_abspath,
+                                  &tm->mt,
+                                  tm->left_abspath,
+                                  tm->right_abspath,
+                                  tm->left_label,
+                                  tm->right_label,
+                                  tm->target_label,
+                                  tm->dry_run,
+                                  tm->detranslated_target_abspath,
+                                  tm->result_target,
+                                  tm->contains_conflicts,
                                   cancel_func, cancel_baton,
                                   result_pool, scratch_pool));
         }
@@ -1189,10 +1313,10 @@ svn_wc__internal_merge(svn_skel_t **work_items,
   /* Merging is complete.  Regardless of text or binariness, we might
      need to tweak the executable bit on the new working file, and
      possibly make it read-only. */
-  if (! dry_run)
+  if (! tm->dry_run)
     {
-      SVN_ERR(svn_wc__wq_build_sync_file_flags(&work_item, db,
-                                               target_abspath,
+      SVN_ERR(svn_wc__wq_build_sync_file_flags(&work_item, tm->mt.db,
+                                               tm->mt.local_abspath,
                                                result_pool, scratch_pool));
       *work_items = svn_wc__wq_merge(*work_items, work_item, result_pool);
     }
@@ -1200,42 +1324,137 @@ svn_wc__internal_merge(svn_skel_t **work_items,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__internal_merge(svn_skel_t **work_items,
+                       svn_skel_t **conflict_skel,
+                       enum svn_wc_merge_outcome_t *merge_outcome,
+                       svn_wc__db_t *db,
+                       const char *left_abspath,
+                       const char *right_abspath,
+                       const char *target_abspath,
+                       const char *wri_abspath,
+                       const char *left_label,
+                       const char *right_label,
+                       const char *target_label,
+                       apr_hash_t *old_actual_props,
+                       svn_boolean_t dry_run,
+                       const char *diff3_cmd,
+                       const apr_array_header_t *merge_options,
+                       const apr_array_header_t *prop_diff,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  text_merge_t *tm;
+
+  *work_items = NULL;
+
+  SVN_ERR(prepare_text_merge(&tm, db, left_abspath, right_abspath,
+                             target_abspath, wri_abspath,
+                             left_label, right_label, target_label,
+                             old_actual_props, dry_run, diff3_cmd,
+                             merge_options, prop_diff, FALSE,
+                             cancel_func, cancel_baton,
+                             result_pool, scratch_pool, scratch_pool));
+  SVN_ERR(run_text_merge(tm, cancel_func, cancel_baton, scratch_pool));
+  SVN_ERR(complete_text_merge(work_items, conflict_skel, merge_outcome, tm,
+                              cancel_func, cancel_baton,
+                              result_pool, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
+/* The state of a merge into a working file, see svn_wc__merge_prepare(). */
+struct svn_wc__merge_t
+{
+  svn_wc_context_t *wc_ctx;
+  const char *target_abspath;
+  const svn_wc_conflict_version_t *left_version;
+  const svn_wc_conflict_version_t *right_version;
+  svn_boolean_t dry_run;
+  const apr_array_header_t *merge_options;
+  const apr_array_header_t *prop_diff;
+  svn_wc_conflict_resolver_func2_t conflict_func;
+  void *conflict_baton;
+
+  /* TRUE if the target is not a versioned file and nothing is merged. */
+  svn_boolean_t skip;
+  svn_node_kind_t kind;
+
+  /* The result of the property merge, if MERGE_PROPS is set. */
+  svn_boolean_t merge_props;
+  enum svn_wc_notify_state_t props_outcome;
+  apr_hash_t *new_actual_props;
+  svn_skel_t *conflict_skel;
+
+  /* The merge of the file contents. */
+  text_merge_t *text;
+
+  /* The pool containing this structure. */
+  apr_pool_t *pool;
+};
 
 svn_error_t *
-svn_wc_merge5(enum svn_wc_merge_outcome_t *merge_content_outcome,
-              enum svn_wc_notify_state_t *merge_props_outcome,
-              svn_wc_context_t *wc_ctx,
-              const char *left_abspath,
-              const char *right_abspath,
-              const char *target_abspath,
-              const char *left_label,
-              const char *right_label,
-              const char *target_label,
-              const svn_wc_conflict_version_t *left_version,
-              const svn_wc_conflict_version_t *right_version,
-              svn_boolean_t dry_run,
-              const char *diff3_cmd,
-              const apr_array_header_t *merge_options,
-              apr_hash_t *original_props,
-              const apr_array_header_t *prop_diff,
-              svn_wc_conflict_resolver_func2_t conflict_func,
-              void *conflict_baton,
-              svn_cancel_func_t cancel_func,
-              void *cancel_baton,
-              apr_pool_t *scratch_pool)
+svn_wc__merge_prepare(svn_wc__merge_t **merge,
+                      svn_wc_context_t *wc_ctx,
+                      const char *left_abspath,
+                      const char *right_abspath,
+                      const char *target_abspath,
+                      const char *left_label,
+                      const char *right_label,
+                      const char *target_label,
+                      const svn_wc_conflict_version_t *left_version,
+                      const svn_wc_conflict_version_t *right_version,
+                      svn_boolean_t dry_run,
+                      const char *diff3_cmd,
+                      const apr_array_header_t *merge_options,
+                      apr_hash_t *original_props,
+                      const apr_array_header_t *prop_diff,
+                      svn_boolean_t merge_props,
+                      svn_boolean_t copy_inputs,
+                      svn_wc_conflict_resolver_func2_t conflict_func,
+                      void *conflict_baton,
+                      svn_cancel_func_t cancel_func,
+                      void *cancel_baton,
+                      apr_pool_t *result_pool,
+                      apr_pool_t *scratch_pool)
 {
   const char *dir_abspath = svn_dirent_dirname(target_abspath, scratch_pool);
-  svn_skel_t *work_items;
-  svn_skel_t *conflict_skel = NULL;
+  svn_wc__merge_t *m = apr_pcalloc(result_pool, sizeof(*m));
   apr_hash_t *pristine_props = NULL;
   apr_hash_t *old_actual_props;
-  apr_hash_t *new_actual_props = NULL;
-  svn_node_kind_t kind;
 
   SVN_ERR_ASSERT(svn_dirent_is_absolute(left_abspath));
   SVN_ERR_ASSERT(svn_dirent_is_absolute(right_abspath));
   SVN_ERR_ASSERT(svn_dirent_is_absolute(target_abspath));
 
+  /* The merge may be completed after the caller's pools are gone. */
+  target_abspath = apr_pstrdup(result_pool, target_abspath);
+  left_label = apr_pstrdup(result_pool, left_label);
+  right_label = apr_pstrdup(result_pool, right_label);
+  target_label = apr_pstrdup(result_pool, target_label);
+  prop_diff = svn_prop_array_dup(prop_diff, result_pool);
+
+  m->wc_ctx = wc_ctx;
+  m->target_abspath = target_abspath;
+  m->left_version = left_version
+                    ? svn_wc_conflict_version_dup(left_version, result_pool)
+                    : NULL;
+  m->right_version = right_version
+                     ? svn_wc_conflict_version_dup(right_version, result_pool)
+                     : NULL;
+  m->dry_run = dry_run;
+  m->merge_options = merge_options;
+  m->prop_diff = prop_diff;
+  m->conflict_func = conflict_func;
+  m->conflict_baton = conflict_baton;
+  m->merge_props = merge_props;
+  m->props_outcome = svn_wc_notify_state_unchanged;
+  m->pool = result_pool;
+  *merge = m;
+
   /* Before we do any work, make sure we hold a write lock.  */
   if (!dry_run)
     SVN_ERR(svn_wc__write_check(wc_ctx->db, dir_abspath, scratch_pool));
@@ -1247,20 +1466,18 @@ svn_wc_merge5(enum svn_wc_merge_outcome_t *merge_content_outcome,
     svn_boolean_t props_mod;
     svn_boolean_t conflicted;
 
-    SVN_ERR(svn_wc__db_read_info(&status, &kind, NULL, NULL, NULL, NULL, NULL,
+    SVN_ERR(svn_wc__db_read_info(&status, &m->kind, NULL, NULL, NULL, NULL,
+                                 NULL, NULL, NULL, NULL, NULL, NULL, NULL,
                                  NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-                                 NULL, NULL, NULL, NULL, NULL, NULL,
                                  &conflicted, NULL, &had_props, &props_mod,
                                  NULL, NULL, NULL,
                                  wc_ctx->db, target_abspath,
                                  scratch_pool, scratch_pool));
 
-    if (kind != svn_node_file || (status != svn_wc__db_status_normal
-                                  && status != svn_wc__db_status_added))
+    if (m->kind != svn_node_file || (status != svn_wc__db_status_normal
+                                     && status != svn_wc__db_status_added))
       {
-        *merge_content_outcome = svn_wc_merge_no_merge;
-        if (merge_props_outcome)
-          *merge_props_outcome = svn_wc_notify_state_unchanged;
+        m->skip = TRUE;
         return SVN_NO_ERROR;
       }
 
@@ -1289,30 +1506,30 @@ svn_wc_merge5(enum svn_wc_merge_outcome_t *merge_content_outcome,
         /* else: Conflict was resolved by removing markers */
       }
 
-    if (merge_props_outcome && had_props)
+    if (merge_props && had_props)
       {
         SVN_ERR(svn_wc__db_read_pristine_props(&pristine_props,
                                                wc_ctx->db, target_abspath,
-                                               scratch_pool, scratch_pool));
+                                               result_pool, scratch_pool));
       }
-    else if (merge_props_outcome)
-      pristine_props = apr_hash_make(scratch_pool);
+    else if (merge_props)
+      pristine_props = apr_hash_make(result_pool);
 
     if (props_mod)
       {
         SVN_ERR(svn_wc__db_read_props(&old_actual_props,
                                       wc_ctx->db, target_abspath,
-                                      scratch_pool, scratch_pool));
+                                      result_pool, scratch_pool));
       }
     else if (pristine_props)
       old_actual_props = pristine_props;
     else
-      old_actual_props = apr_hash_make(scratch_pool);
+      old_actual_props = apr_hash_make(result_pool);
   }
 
   /* Merge the properties, if requested.  We merge the properties first
    * because the properties can affect the text (EOL style, keywords). */
-  if (merge_props_outcome)
+  if (merge_props)
     {
       int i;
 
@@ -1332,90 +1549,138 @@ svn_wc_merge5(enum svn_wc_merge_outcome_t *merge_content_outcome,
                                                             scratch_pool));
         }
 
-      SVN_ERR(svn_wc__merge_props(&conflict_skel,
-                                  merge_props_outcome,
-                                  &new_actual_props,
+      SVN_ERR(svn_wc__merge_props(&m->conflict_skel,
+                                  &m->props_outcome,
+                                  &m->new_actual_props,
                                   wc_ctx->db, target_abspath,
                                   original_props, pristine_props, old_actual_props,
                                   prop_diff,
-                                  scratch_pool, scratch_pool));
+                                  result_pool, scratch_pool));
     }
 
-  /* Merge the text. */
-  SVN_ERR(svn_wc__internal_merge(&work_items,
-                                 &conflict_skel,
-                                 merge_content_outcome,
-                                 wc_ctx->db,
-                                 left_abspath,
-                                 right_abspath,
-                                 target_abspath,
-                                 target_abspath,
-                                 left_label, right_label, target_label,
-                                 old_actual_props,
-                                 dry_run,
-                                 diff3_cmd,
-                                 merge_options,
-                                 prop_diff,
-                                 cancel_func, cancel_baton,
-                                 scratch_pool, scratch_pool));
+  /* Prepare the merge of the text. */
+  SVN_ERR(prepare_text_merge(&m->text, wc_ctx->db,
+                             left_abspath, right_abspath,
+                             target_abspath, target_abspath,
+                             left_label, right_label, target_label,
+                             old_actual_props, dry_run, diff3_cmd,
+                             merge_options, prop_diff, copy_inputs,
+                             cancel_func, cancel_baton,
+                             result_pool, result_pool, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_boolean_t
+svn_wc__merge_needs_run(const svn_wc__merge_t *merge)
+{
+  return merge->text != NULL
+         && merge->text->temp_dir != NULL
+         && merge->text->result_target == NULL;
+}
+
+svn_error_t *
+svn_wc__merge_run(svn_wc__merge_t *merge,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *scratch_pool)
+{
+  if (merge->skip)
+    return SVN_NO_ERROR;
+
+  return svn_error_trace(run_text_merge(merge->text,
+                                        cancel_func, cancel_baton,
+                                        scratch_pool));
+}
+
+svn_error_t *
+svn_wc__merge_complete(enum svn_wc_merge_outcome_t *merge_content_outcome,
+                       enum svn_wc_notify_state_t *merge_props_outcome,
+                       svn_wc__merge_t *merge,
+                       svn_cancel_func_t cancel_func,
+                       void *cancel_baton,
+                       apr_pool_t *scratch_pool)
+{
+  svn_wc__db_t *db = merge->wc_ctx->db;
+  const char *target_abspath = merge->target_abspath;
+  svn_skel_t *work_items;
+
+  if (merge_props_outcome)
+    *merge_props_outcome = merge->props_outcome;
+
+  if (merge->skip)
+    {
+      *merge_content_outcome = svn_wc_merge_no_merge;
+      return SVN_NO_ERROR;
+    }
+
+  /* Complete the text merge. */
+  SVN_ERR(complete_text_merge(&work_items, &merge->conflict_skel,
+                              merge_content_outcome, merge->text,
+                              cancel_func, cancel_baton,
+                              scratch_pool, scratch_pool));
 
   /* If this isn't a dry run, then update the DB, run the work, and
    * call the conflict resolver callback.  */
-  if (!dry_run)
+  if (!merge->dry_run)
     {
+      svn_skel_t *conflict_skel = merge->conflict_skel;
+
       if (conflict_skel)
         {
           svn_skel_t *work_item;
 
           SVN_ERR(svn_wc__conflict_skel_set_op_merge(conflict_skel,
-                                                     left_version,
-                                                     right_version,
+                                                     merge->left_version,
+                                                     merge->right_version,
                                                      scratch_pool,
                                                      scratch_pool));
 
           SVN_ERR(svn_wc__conflict_create_markers(&work_item,
-                                                  wc_ctx->db, target_abspath,
+                                                  db, target_abspath,
                                                   conflict_skel,
                                                   scratch_pool, scratch_pool));
 
           work_items = svn_wc__wq_merge(work_items, work_item, scratch_pool);
         }
 
-      if (new_actual_props)
-        SVN_ERR(svn_wc__db_op_set_props(wc_ctx->db, target_abspath,
-                                        new_actual_props,
-                                        svn_wc__has_magic_property(prop_diff),
+      if (merge->new_actual_props)
+        SVN_ERR(svn_wc__db_op_set_props(db, target_abspath,
+                                        merge->new_actual_props,
+                                        svn_wc__has_magic_property(
+                                                        merge->prop_diff),
                                         conflict_skel, work_items,
                                         scratch_pool));
       else if (conflict_skel)
-        SVN_ERR(svn_wc__db_op_mark_conflict(wc_ctx->db, target_abspath,
+        SVN_ERR(svn_wc__db_op_mark_conflict(db, target_abspath,
                                             conflict_skel, work_items,
                                             scratch_pool));
       else if (work_items)
-        SVN_ERR(svn_wc__db_wq_add(wc_ctx->db, target_abspath, work_items,
+        SVN_ERR(svn_wc__db_wq_add(db, target_abspath, work_items,
                                   scratch_pool));
 
       if (work_items)
-        SVN_ERR(svn_wc__wq_run(wc_ctx->db, target_abspath,
+        SVN_ERR(svn_wc__wq_run(db, target_abspath,
                                cancel_func, cancel_baton,
                                scratch_pool));
 
-      if (conflict_skel && conflict_func)
+      if (conflict_skel && merge->conflict_func)
         {
           svn_boolean_t text_conflicted, prop_conflicted;
 
           SVN_ERR(svn_wc__conflict_invoke_resolver(
-                    wc_ctx->db, target_abspath, kind,
-                    conflict_skel, merge_options,
-                    conflict_func, conflict_baton,
+                    db, target_abspath, merge->kind,
+                    conflict_skel, merge->merge_options,
+                    merge->conflict_func, merge->conflict_baton,
                     cancel_func, cancel_baton,
                     scratch_pool));
 
           /* Reset *MERGE_CONTENT_OUTCOME etc. if a conflict was resolved. */
           SVN_ERR(svn_wc__internal_conflicted_p(
                     &text_conflicted, &prop_conflicted, NULL,
-                    wc_ctx->db, target_abspath, scratch_pool));
-          if (*merge_props_outcome == svn_wc_notify_state_conflicted
+                    db, target_abspath, scratch_pool));
+          if (merge_props_outcome
+              && *merge_props_outcome == svn_wc_notify_state_conflicted
               && ! prop_conflicted)
             *merge_props_outcome = svn_wc_notify_state_merged;
           if (*merge_content_outcome == svn_wc_merge_conflict
@@ -1426,3 +1691,46 @@ svn_wc_merge5(enum svn_wc_merge_outcome_t *merge_content_outcome,
 
   return SVN_NO_ERROR;
 }
+
+svn_error_t *
+svn_wc_merge5(enum svn_wc_merge_outcome_t *merge_content_outcome,
+              enum svn_wc_notify_state_t *merge_props_outcome,
+              svn_wc_context_t *wc_ctx,
+              const char *left_abspath,
+              const char *right_abspath,
+              const char *target_abspath,
+              const char *left_label,
+              const char *right_label,
+              const char *target_label,
+              const svn_wc_conflict_version_t *left_version,
+              const svn_wc_conflict_version_t *right_version,
+              svn_boolean_t dry_run,
+              const char *diff3_cmd,
+              const apr_array_header_t *merge_options,
+              apr_hash_t *original_props,
+              const apr_array_header_t *prop_diff,
+              svn_wc_conflict_resolver_func2_t conflict_func,
+              void *conflict_baton,
+              svn_cancel_func_t cancel_func,
+              void *cancel_baton,
+              apr_pool_t *scratch_pool)
+{
+  svn_wc__merge_t *merge;
+
+  SVN_ERR(svn_wc__merge_prepare(&merge, wc_ctx,
+                                left_abspath, right_abspath, target_abspath,
+                                left_label, right_label, target_label,
+                                left_version, right_version,
+                                dry_run, diff3_cmd, merge_options,
+                                original_props, prop_diff,
+                                merge_props_outcome != NULL, FALSE,
+                                conflict_func, conflict_baton,
+                                cancel_func, cancel_baton,
+                                scratch_pool, scratch_pool));
+  SVN_ERR(svn_wc__merge_run(merge, cancel_func, cancel_baton, scratch_pool));
+  SVN_ERR(svn_wc__merge_complete(merge_content_outcome, merge_props_outcome,
+                                 merge, cancel_func, cancel_baton,
+                                 scratch_pool));
+
+  return SVN_NO_ERROR;
+}
@@ -89,6 +89,10 @@
  * keywords to working-copy form according to VERSIONED_FILE_ABSPATH's
  * properties, and compare the result with VERSIONED_FILE_ABSPATH.
  *
+ * If DB caches text hashes and EXACT_COMPARISON is FALSE, consider the
+ * file unmodified if its raw contents match the hash cached for it, and
+ * cache that hash whenever the comparison finds it unmodified.
+ *
  * HAS_PROPS should be TRUE if the file had properties when it was not
  * modified, otherwise FALSE.
  *
@@ -115,6 +119,8 @@ compare_and_verify(svn_boolean_t *modified_p,
   svn_boolean_t need_translation;
   svn_stream_t *v_stream; /* versioned_file */
   svn_checksum_t *v_checksum;
+  svn_boolean_t cache_hashes = FALSE;
+  svn_checksum_t *v_hash = NULL;
   svn_error_t *err;
 
   SVN_ERR_ASSERT(svn_dirent_is_absolute(versioned_file_abspath));
@@ -154,6 +160,34 @@ compare_and_verify(svn_boolean_t *modified_p,
         }
     }
 
+  /* If the file has been found unmodified before, hashing its raw
+     contents is enough to tell that it still is. */
+  if (!exact_comparison && !special)
+    {
+      const svn_checksum_t *cached_hash;
+
+      SVN_ERR(svn_wc__db_read_text_hash(&cache_hashes, &cached_hash, db,
+                                        versioned_file_abspath,
+                                        scratch_pool, scratch_pool));
+      if (cached_hash)
+        {
+          err = svn_io_file_checksum2(&v_hash, versioned_file_abspath,
+                                      cached_hash->kind, scratch_pool);
+          /* Convert EACCESS on working copy path to WC specific error
+             code. */
+          if (err && APR_STATUS_IS_EACCES(err->apr_err))
+            return svn_error_create(SVN_ERR_WC_PATH_ACCESS_DENIED, err, NULL);
+          else
+            SVN_ERR(err);
+
+          if (svn_checksum_match(v_hash, cached_hash))
+            {
+              *modified_p = FALSE;
+              return SVN_NO_ERROR;
+            }
+        }
+    }
+
   /* ### Other checks possible? */
 
   /* Reading files is necessary. */
@@ -176,6 +210,13 @@ compare_and_verify(svn_boolean_t *modified_p,
         SVN_ERR(err);
       v_stream = svn_stream_from_aprfile2(file, FALSE, scratch_pool);
 
+      /* Hash the raw contents on the way, to be cached if they turn out
+         to be unmodified. */
+      if (cache_hashes)
+        v_stream = svn_stream_checksummed2(v_stream, &v_hash, NULL,
+                                           svn_checksum_fnv1a_32x4, TRUE,
+                                           scratch_pool);
+
       if (need_translation)
         {
           if (!exact_comparison)
@@ -231,6 +272,11 @@ compare_and_verify(svn_boolean_t *modified_p,
 
   *modified_p = (! svn_checksum_match(v_checksum, pristine_checksum));
 
+  if (!*modified_p && v_hash)
+    SVN_ERR(svn_wc__db_store_text_hash(db, versioned_file_abspath,
+                                       pristine_checksum, v_hash,
+                                       scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -246,9 +246,71 @@ revert_restore_handle_copied_dirs(svn_boolean_t *removed_self,
   return SVN_NO_ERROR;
 }
 
+/* Files to be restored from their pristines, queued while walking the
+   tree.  Rather than adding one work item and running the work queue per
+   file or per directory, they get added in a single transaction and
+   installed in batches large enough for the work queue to install many
+   files in parallel. */
+typedef struct install_queue_t
+{
+  /* Work items (svn_skel_t *) not added to the work queue yet. */
+  apr_array_header_t *work_items;
+
+  /* Pool for WORK_ITEMS and their contents, cleared whenever they ran. */
+  apr_pool_t *pool;
+} install_queue_t;
+
+/* Run the queue once this many files are to be restored. */
+#define INSTALL_QUEUE_SIZE 1024
+
+/* Create an empty install_queue_t in RESULT_POOL. */
+static install_queue_t *
+install_queue_create(apr_pool_t *result_pool)
+{
+  install_queue_t *queue = apr_pcalloc(result_pool, sizeof(*queue));
+
+  queue->pool = svn_pool_create(result_pool);
+  queue->work_items = apr_array_make(queue->pool, INSTALL_QUEUE_SIZE,
+                                     sizeof(svn_skel_t *));
+
+  return queue;
+}
+
+/* Add all work items in QUEUE to the work queue of the working copy
+   containing WRI_ABSPATH in DB and run it.  Empty QUEUE afterwards. */
+static svn_error_t *
+install_queue_run(install_queue_t *queue,
+                  svn_wc__db_t *db,
+                  const char *wri_abspath,
+                  svn_cancel_func_t cancel_func,
+                  void *cancel_baton,
+                  apr_pool_t *scratch_pool)
+{
+  svn_skel_t *work_items;
+  int i;
+
+  if (queue->work_items->nelts == 0)
+    return SVN_NO_ERROR;
+
+  work_items = svn_skel__make_empty_list(queue->pool);
+  for (i = queue->work_items->nelts; i > 0; i--)
+    svn_skel__prepend(APR_ARRAY_IDX(queue->work_items, i - 1, svn_skel_t *),
+                      work_items);
+
+  SVN_ERR(svn_wc__db_wq_add(db, wri_abspath, work_items, scratch_pool));
+
+  svn_pool_clear(queue->pool);
+  queue->work_items = apr_array_make(queue->pool, INSTALL_QUEUE_SIZE,
+                                     sizeof(svn_skel_t *));
+
+  return svn_error_trace(svn_wc__wq_run(db, wri_abspath,
+                                        cancel_func, cancel_baton,
+                                        scratch_pool));
+}
+
 /* Forward definition */
 static svn_error_t *
-revert_wc_data(svn_boolean_t *run_wq,
+revert_wc_data(install_queue_t *queue,
                svn_boolean_t *notify_required,
                svn_wc__db_t *db,
                const char *local_abspath,
@@ -271,14 +333,14 @@ revert_wc_data(svn_boolean_t *run_wq,
    REVERT_ROOT is true for explicit revert targets and FALSE for targets
    reached via recursion.
 
-   Sets *RUN_WQ to TRUE when the caller should (eventually) run the workqueue.
-   (The function sets it to FALSE when it has run the WQ itself)
+   Adds the files to restore to QUEUE, which the caller should
+   (eventually) run.  QUEUE gets run whenever it has grown large enough.
 
    If INFO is NULL, LOCAL_ABSPATH doesn't exist in DB. Otherwise INFO
    specifies the state of LOCAL_ABSPATH in DB.
  */
 static svn_error_t *
-revert_restore(svn_boolean_t *run_wq,
+revert_restore(install_queue_t *queue,
                svn_wc__db_t *db,
                const char *local_abspath,
                svn_depth_t depth,
@@ -373,7 +435,7 @@ revert_restore(svn_boolean_t *run_wq,
 
   if (!metadata_only)
     {
-      SVN_ERR(revert_wc_data(run_wq,
+      SVN_ERR(revert_wc_data(queue,
                              &notify_required,
                              db, local_abspath, status, kind,
                              reverted_kind, recorded_size, recorded_time,
@@ -426,7 +488,7 @@ revert_restore(svn_boolean_t *run_wq,
 
           child_abspath = svn_dirent_join(local_abspath, child_name, iterpool);
 
-          SVN_ERR(revert_restore(run_wq,
+          SVN_ERR(revert_restore(queue,
                                  db, child_abspath, depth, metadata_only,
                                  use_commit_times, FALSE /* revert root */,
                                  apr_hash_this_val(hi),
@@ -435,13 +497,10 @@ revert_restore(svn_boolean_t *run_wq,
                                  iterpool));
         }
 
-      /* Run the queue per directory */
-      if (*run_wq)
-        {
-          SVN_ERR(svn_wc__wq_run(db, local_abspath, cancel_func, cancel_baton,
-                                 iterpool));
-          *run_wq = FALSE;
-        }
+      /* Restore files in large batches, not per directory */
+      if (queue->work_items->nelts >= INSTALL_QUEUE_SIZE)
+        SVN_ERR(install_queue_run(queue, db, local_abspath,
+                                  cancel_func, cancel_baton, iterpool));
 
       svn_pool_destroy(iterpool);
     }
@@ -455,7 +514,7 @@ revert_restore(svn_boolean_t *run_wq,
 
 /* Perform the in-working copy revert of LOCAL_ABSPATH, to what is stored in DB */
 static svn_error_t *
-revert_wc_data(svn_boolean_t *run_wq,
+revert_wc_data(install_queue_t *queue,
                svn_boolean_t *notify_required,
                svn_wc__db_t *db,
                const char *local_abspath,
@@ -693,10 +752,8 @@ revert_wc_data(svn_boolean_t *run_wq,
 
           SVN_ERR(svn_wc__wq_build_file_install(&work_item, db, local_abspath,
                                                 NULL, use_commit_times, TRUE,
-                                                scratch_pool, scratch_pool));
-          SVN_ERR(svn_wc__db_wq_add(db, local_abspath, work_item,
-                                    scratch_pool));
-          *run_wq = TRUE;
+                                                queue->pool, scratch_pool));
+          APR_ARRAY_PUSH(queue->work_items, svn_skel_t *) = work_item;
         }
       *notify_required = TRUE;
     }
@@ -720,7 +777,7 @@ revert(svn_wc__db_t *db,
 {
   svn_error_t *err;
   const struct svn_wc__db_info_t *info = NULL;
-  svn_boolean_t run_queue = FALSE;
+  install_queue_t *queue = install_queue_create(scratch_pool);
 
   SVN_ERR_ASSERT(depth == svn_depth_empty || depth == svn_depth_infinity);
 
@@ -760,17 +817,18 @@ revert(svn_wc__db_t *db,
 
   if (!err)
     err = svn_error_trace(
-              revert_restore(&run_queue, db, local_abspath, depth, metadata_only,
+              revert_restore(queue, db, local_abspath, depth, metadata_only,
                              use_commit_times, TRUE /* revert root */,
                              info, cancel_func, cancel_baton,
                              notify_func, notify_baton,
                              scratch_pool));
 
-  if (run_queue)
-    err = svn_error_compose_create(err,
-                                   svn_wc__wq_run(db, local_abspath,
-                                                  cancel_func, cancel_baton,
-                                                  scratch_pool));
+  /* Restore what got queued even after an error; the database has been
+     reverted already. */
+  err = svn_error_compose_create(err,
+                                 install_queue_run(queue, db, local_abspath,
+                                                   cancel_func, cancel_baton,
+                                                   scratch_pool));
 
   err = svn_error_compose_create(err,
                                  svn_wc__db_revert_list_done(db,
@@ -29,6 +29,11 @@
 #include <apr_pools.h>
 #include <apr_file_io.h>
 #include <apr_hash.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#endif
 
 #include "svn_pools.h"
 #include "svn_types.h"
@@ -45,6 +50,7 @@
 #include "svn_private_config.h"
 
 #include "wc.h"
+#include "adm_files.h"
 #include "props.h"
 
 #include "private/svn_sorts_private.h"
@@ -100,6 +106,21 @@ struct walk_status_baton
 
   /* Repository locks, if set. */
   apr_hash_t *repos_locks;
+
+  /* If not NULL, the children of all versioned directories below
+     PREFETCH_ABSPATH (inclusive) that are part of the working copy rooted
+     at PREFETCH_WCROOT_ABSPATH, as returned by
+     svn_wc__db_read_subtree_children_info(). */
+  apr_hash_t *prefetched_dirs;
+  const char *prefetch_abspath;
+  const char *prefetch_wcroot_abspath;
+
+  /* Threads reading directories and checksumming files ahead of the
+     walk, NULL if not used. */
+  struct status_workers_t *workers;
+
+  /* State of the change journal, NULL if not used. */
+  struct watch_state_t *watch;
 };
 
 /*** Editor batons ***/
@@ -316,6 +337,30 @@ internal_status(svn_wc__internal_status_t **status,
                 apr_pool_t *result_pool,
                 apr_pool_t *scratch_pool);
 
+/* Return TRUE if the text status of the file described by INFO and DIRENT
+   can be determined by comparing the SHA-1 checksum of the working file
+   with INFO->CHECKSUM, without looking at the pristine or translating the
+   file.  That is the case if the file has neither properties, i.e. no
+   keywords or eol-style, nor a different size, but its timestamp does not
+   tell. */
+static svn_boolean_t
+checksum_decides_text_status(const struct svn_wc__db_info_t *info,
+                             const svn_io_dirent2_t *dirent)
+{
+  return (info->kind == svn_node_file
+          && (info->status == svn_wc__db_status_normal
+              || info->status == svn_wc__db_status_added)
+          && info->checksum
+          && info->checksum->kind == svn_checksum_sha1
+          && !info->had_props
+          && !info->props_mod
+          && dirent
+          && dirent->kind == svn_node_file
+          && !dirent->special
+          && info->recorded_size == dirent->filesize
+          && info->recorded_time != dirent->mtime);
+}
+
 /* Fill in *STATUS for LOCAL_ABSPATH, using DB. Allocate *STATUS in
    RESULT_POOL and use SCRATCH_POOL for temporary allocations.
 
@@ -334,6 +379,9 @@ internal_status(svn_wc__internal_status_t **status,
    do not adjust the result for missing working copy files.
 
    The status struct's repos_lock field will be set to REPOS_LOCK.
+
+   If ACTUAL_CHECKSUM is not NULL, it is the SHA-1 checksum of the
+   working file, which may save reading the file again.
 */
 static svn_error_t *
 assemble_status(svn_wc__internal_status_t **status,
@@ -348,6 +396,7 @@ assemble_status(svn_wc__internal_status_t **status,
                 svn_boolean_t ignore_text_mods,
                 svn_boolean_t check_working_copy,
                 const svn_lock_t *repos_lock,
+                const svn_checksum_t *actual_checksum,
                 apr_pool_t *result_pool,
                 apr_pool_t *scratch_pool)
 {
@@ -468,6 +517,10 @@ assemble_status(svn_wc__internal_status_t **status,
                      && info->recorded_size == dirent->filesize
                      && info->recorded_time == dirent->mtime))
             text_modified_p = FALSE;
+          else if (actual_checksum
+                   && checksum_decides_text_status(info, dirent))
+            text_modified_p = !svn_checksum_match(actual_checksum,
+                                                  info->checksum);
           else
             {
               svn_error_t *err;
@@ -785,6 +838,670 @@ assemble_unversioned(svn_wc__internal_status_t **status,
 }
 
 
+/*** Change journal ***/
+
+/* An external file system watcher may keep a journal of the changes in a
+   working copy in its administrative area, see SVN_WC__ADM_WATCH_JOURNAL.
+   The format is
+
+     SVN-WC-WATCH-JOURNAL 1
+     <session>
+     <relpath>
+     ...
+
+   where SESSION is an arbitrary token identifying an uninterrupted watch.
+   Each RELPATH is a path relative to the working copy root, "" for the
+   root itself, that got created, deleted, modified or had its attributes
+   changed, including everything within newly created directories.
+   Changes to the administrative area itself are not listed.  The watcher
+   only ever appends complete lines to the journal and has to rewrite it
+   with a new session token whenever it may have missed changes.
+
+   After a status walk of the whole working copy, we store the session and
+   the size of the journal at the start of the walk in the baseline file
+   SVN_WC__ADM_WATCH_BASELINE, together with the directories whose entries
+   on disk were not as implied by the working copy database.  As long as
+   the session continues, later walks only read those directories plus
+   the ones that contain the paths appended to the journal since.  The
+   entries of all other directories are taken from the database. */
+
+#define WATCH_JOURNAL_HEADER "SVN-WC-WATCH-JOURNAL 1"
+#define WATCH_BASELINE_HEADER "SVN-WC-WATCH-BASELINE 1"
+
+/* Change journal information for a status walk. */
+typedef struct watch_state_t
+{
+  /* The working copy that the journal belongs to. */
+  const char *wcroot_abspath;
+
+  /* The relpaths of the directories that must be read from disk, or NULL
+     to read all directories. */
+  apr_hash_t *check_dirs;
+
+  /* The journal session and size at the start of the walk. */
+  const char *session;
+  apr_size_t journal_size;
+
+  /* The relpaths of the directories found to differ from what the
+     database implies, or NULL if no baseline will be written. */
+  apr_hash_t *dirty_dirs;
+
+  /* Pool for DIRTY_DIRS. */
+  apr_pool_t *pool;
+} watch_state_t;
+
+/* Split the contents of a journal or baseline file BUF into lines, in
+   place, and return them in *LINES.  Return the byte offset within BUF at
+   which each line starts in *OFFSETS.  Return FALSE if BUF does not end
+   with a complete line. */
+static svn_boolean_t
+split_watch_file(apr_array_header_t **lines,
+                 apr_array_header_t **offsets,
+                 svn_stringbuf_t *buf,
+                 apr_pool_t *result_pool)
+{
+  apr_size_t start = 0;
+
+  if (buf->len == 0 || buf->data[buf->len - 1] != '\n')
+    return FALSE;
+
+  *lines = apr_array_make(result_pool, 16, sizeof(const char *));
+  *offsets = apr_array_make(result_pool, 16, sizeof(apr_size_t));
+  while (start < buf->len)
+    {
+      char *eol = strchr(buf->data + start, '\n');
+
+      *eol = '\0';
+      APR_ARRAY_PUSH(*lines, const char *) = buf->data + start;
+      APR_ARRAY_PUSH(*offsets, apr_size_t) = start;
+      start = eol - buf->data + 1;
+    }
+
+  return TRUE;
+}
+
+/* Set *WATCH to the change journal state of the working copy at
+   WCROOT_ABSPATH, or to NULL if it has no usable journal.  If RECORD is
+   set, prepare for writing a new baseline after the walk.  Allocate the
+   result in RESULT_POOL and use SCRATCH_POOL for temporary allocations.
+
+   The journal is an optional optimization, so problems reading it or
+   the baseline simply make us read all directories. */
+static void
+read_watch_state(watch_state_t **watch,
+                 const char *wcroot_abspath,
+                 svn_boolean_t record,
+                 apr_pool_t *result_pool,
+                 apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *journal, *baseline;
+  apr_array_header_t *journal_lines, *journal_offsets;
+  apr_array_header_t *baseline_lines, *baseline_offsets;
+  watch_state_t *result;
+  svn_error_t *err;
+  apr_int64_t baseline_size;
+  int i;
+
+  *watch = NULL;
+
+  err = svn_stringbuf_from_file2(&journal,
+                                 svn_wc__adm_child(wcroot_abspath,
+                                                   SVN_WC__ADM_WATCH_JOURNAL,
+                                                   scratch_pool),
+                                 scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return;
+    }
+
+  if (!split_watch_file(&journal_lines, &journal_offsets, journal,
+                        scratch_pool)
+      || journal_lines->nelts < 2
+      || strcmp(APR_ARRAY_IDX(journal_lines, 0, const char *),
+                WATCH_JOURNAL_HEADER) != 0
+      || !*APR_ARRAY_IDX(journal_lines, 1, const char *))
+    return;
+
+  result = apr_pcalloc(result_pool, sizeof(*result));
+  result->wcroot_abspath = apr_pstrdup(result_pool, wcroot_abspath);
+  result->session = apr_pstrdup(result_pool,
+                                APR_ARRAY_IDX(journal_lines, 1,
+                                              const char *));
+  result->journal_size = journal->len;
+  result->pool = result_pool;
+  if (record)
+    result->dirty_dirs = apr_hash_make(result_pool);
+  *watch = result;
+
+  /* Without a baseline for this session, read everything. */
+  err = svn_stringbuf_from_file2(&baseline,
+                                 svn_wc__adm_child(wcroot_abspath,
+                                                   SVN_WC__ADM_WATCH_BASELINE,
+                                                   scratch_pool),
+                                 scratch_pool);
+  if (err)
+    {
+      svn_error_clear(err);
+      return;
+    }
+
+  if (!split_watch_file(&baseline_lines, &baseline_offsets, baseline,
+                        scratch_pool)
+      || baseline_lines->nelts < 3
+      || strcmp(APR_ARRAY_IDX(baseline_lines, 0, const char *),
+                WATCH_BASELINE_HEADER) != 0
+      || strcmp(APR_ARRAY_IDX(baseline_lines, 1, const char *),
+                result->session) != 0)
+    return;
+
+  err = svn_cstring_atoi64(&baseline_size,
+                           APR_ARRAY_IDX(baseline_lines, 2, const char *));
+  if (err || baseline_size < 0 || baseline_size > (apr_int64_t)journal->len)
+    {
+      svn_error_clear(err);
+      return;
+    }
+
+  result->check_dirs = apr_hash_make(result_pool);
+  for (i = 3; i < baseline_lines->nelts; i++)
+    svn_hash_sets(result->check_dirs,
+                  apr_pstrdup(result_pool,
+                              APR_ARRAY_IDX(baseline_lines, i, const char *)),
+                  "");
+
+  for (i = 2; i < journal_lines->nelts; i++)
+    {
+      const char *relpath = APR_ARRAY_IDX(journal_lines, i, const char *);
+
+      if (APR_ARRAY_IDX(journal_offsets, i, apr_size_t)
+          < (apr_size_t)baseline_size)
+        continue;
+
+      if (!svn_relpath_is_canonical(relpath))
+        {
+          result->check_dirs = NULL;
+          return;
+        }
+
+      relpath = apr_pstrdup(result_pool, relpath);
+      svn_hash_sets(result->check_dirs, relpath, "");
+      if (*relpath)
+        svn_hash_sets(result->check_dirs,
+                      svn_relpath_dirname(relpath, result_pool), "");
+    }
+}
+
+/* Write the baseline for the journal state WATCH after a complete status
+   walk.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+write_watch_baseline(const watch_state_t *watch,
+                     apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *baseline;
+  apr_hash_index_t *hi;
+
+  baseline = svn_stringbuf_createf(scratch_pool,
+                                   "%s\n%s\n%" APR_SIZE_T_FMT "\n",
+                                   WATCH_BASELINE_HEADER, watch->session,
+                                   watch->journal_size);
+  for (hi = apr_hash_first(scratch_pool, watch->dirty_dirs);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      svn_stringbuf_appendcstr(baseline, apr_hash_this_key(hi));
+      svn_stringbuf_appendbyte(baseline, '\n');
+    }
+
+  return svn_error_trace(
+           svn_io_write_atomic2(svn_wc__adm_child(watch->wcroot_abspath,
+                                                  SVN_WC__ADM_WATCH_BASELINE,
+                                                  scratch_pool),
+                                baseline->data, baseline->len,
+                                NULL, FALSE, scratch_pool));
+}
+
+/* Return the entries of a directory as implied by its versioned children
+   NODES, i.e. with the recorded size and timestamp for all files.  Return
+   NULL if they cannot be derived from NODES.  Allocate the result in
+   RESULT_POOL and use SCRATCH_POOL for temporary allocations. */
+static apr_hash_t *
+get_implied_dirents(apr_hash_t *nodes,
+                    apr_pool_t *result_pool,
+                    apr_pool_t *scratch_pool)
+{
+  apr_hash_t *dirents = apr_hash_make(result_pool);
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(scratch_pool, nodes); hi; hi = apr_hash_next(hi))
+    {
+      const struct svn_wc__db_info_t *info = apr_hash_this_val(hi);
+      svn_io_dirent2_t *dirent;
+
+      if (info->status == svn_wc__db_status_deleted
+          || info->status == svn_wc__db_status_not_present
+          || info->status == svn_wc__db_status_excluded
+          || info->status == svn_wc__db_status_server_excluded)
+        continue;
+
+      if (info->status != svn_wc__db_status_normal
+          && info->status != svn_wc__db_status_added
+          && info->status != svn_wc__db_status_incomplete)
+        return NULL;
+
+#ifdef HAVE_SYMLINK
+      if (info->special)
+        return NULL;
+#endif
+
+      dirent = svn_io_dirent2_create(result_pool);
+      if (info->kind == svn_node_dir)
+        dirent->kind = svn_node_dir;
+      else if (info->kind == svn_node_file
+               && info->recorded_size != SVN_INVALID_FILESIZE
+               && info->recorded_time != 0)
+        {
+          dirent->kind = svn_node_file;
+          dirent->filesize = info->recorded_size;
+          dirent->mtime = info->recorded_time;
+        }
+      else
+        return NULL;
+
+      apr_hash_set(dirents, apr_hash_this_key(hi), apr_hash_this_key_len(hi),
+                   dirent);
+    }
+
+  return dirents;
+}
+
+/* Return TRUE if the directory entries DIRENTS read from disk are exactly
+   the IMPLIED ones, ignoring the administrative directory.  Use
+   SCRATCH_POOL for temporary allocations. */
+static svn_boolean_t
+dirents_match(apr_hash_t *implied,
+              apr_hash_t *dirents,
+              apr_pool_t *scratch_pool)
+{
+  apr_hash_index_t *hi;
+  unsigned int count = 0;
+
+  for (hi = apr_hash_first(scratch_pool, dirents); hi; hi = apr_hash_next(hi))
+    {
+      const char *name = apr_hash_this_key(hi);
+      const svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+      const svn_io_dirent2_t *expected;
+
+      if (svn_wc_is_adm_dir(name, scratch_pool))
+        continue;
+
+      expected = svn_hash_gets(implied, name);
+      if (!expected
+          || expected->kind != dirent->kind
+          || expected->special != dirent->special)
+        return FALSE;
+
+      if (dirent->kind == svn_node_file
+          && (expected->filesize != dirent->filesize
+              || expected->mtime != dirent->mtime))
+        return FALSE;
+
+      ++count;
+    }
+
+  return count == apr_hash_count(implied);
+}
+
+/*** Reading ahead on worker threads ***/
+
+/* On network file systems, most of the time of a status walk is spent
+   waiting for readdir(), stat() and read() calls to return.  The walk
+   itself has to stay in order and on the calling thread, because it
+   reports to STATUS_FUNC and uses the working copy database.  But the
+   directories and files it will look at next are known in advance, so a
+   few threads can read those while the walk is still busy with earlier
+   nodes. */
+
+/* Number of threads reading ahead of a status walk. */
+#define STATUS_WORKER_COUNT 8
+
+/* Number of children of a directory that may be read ahead of the one
+   the walk is currently processing. */
+#define STATUS_JOBS_AHEAD (2 * STATUS_WORKER_COUNT)
+
+/* Reading a directory or checksumming a file ahead of the status walk. */
+typedef struct status_job_t
+{
+  /* The node to read and whether it is a directory or a file. */
+  const char *local_abspath;
+  svn_boolean_t is_dir;
+
+  /* Passed to svn_io_get_dirents3() for directories. */
+  svn_boolean_t only_check_type;
+
+  /* Set once a worker picked up this job and once it has been finished,
+     respectively. */
+  svn_boolean_t started;
+  svn_boolean_t finished;
+
+  /* Valid once FINISHED has been set.  The dirents of a directory or the
+     SHA-1 checksum of a file.  NULL if there was an error, which the walk
+     will run into and report itself. */
+  apr_hash_t *dirents;
+  svn_checksum_t *checksum;
+
+  /* Private pool of this job. */
+  apr_pool_t *pool;
+
+  /* Next job in the queue of jobs that have not been started yet. */
+  struct status_job_t *next;
+} status_job_t;
+
+/* The threads reading ahead of a status walk. */
+typedef struct status_workers_t
+{
+  /* Maps local abspaths to status_job_t * that have been scheduled but
+     not yet taken by the walk.  Only used by the calling thread. */
+  apr_hash_t *jobs;
+
+#if APR_HAS_THREADS
+  /* Guards all following members as well as the STARTED and FINISHED
+     flags of all jobs. */
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *cond;
+  status_job_t *queue_head;
+  status_job_t *queue_tail;
+  svn_boolean_t shutdown;
+
+  apr_thread_t *threads[STATUS_WORKER_COUNT];
+  int thread_count;
+#endif
+
+  /* Thread-safe pool containing all job memory. */
+  apr_pool_t *pool;
+} status_workers_t;
+
+#if APR_HAS_THREADS
+
+/* Implements apr_thread_start_t, processing the queue of the
+   status_workers_t in DATA. */
+static void * APR_THREAD_FUNC
+status_worker(apr_thread_t *thread, void *data)
+{
+  status_workers_t *workers = data;
+
+  while (TRUE)
+    {
+      status_job_t *job;
+      svn_error_t *err;
+
+      apr_thread_mutex_lock(workers->mutex);
+      while (!workers->queue_head && !workers->shutdown)
+        apr_thread_cond_wait(workers->cond, workers->mutex);
+
+      job = workers->shutdown ? NULL : workers->queue_head;
+      if (job)
+        {
+          workers->queue_head = job->next;
+          if (workers->queue_head == NULL)
+            workers->queue_tail = NULL;
+          job->started = TRUE;
+        }
+      apr_thread_mutex_unlock(workers->mutex);
+
+      if (job == NULL)
+        break;
+
+      if (job->is_dir)
+        err = svn_io_get_dirents3(&job->dirents, job->local_abspath,
+                                  job->only_check_type,
+                                  job->pool, job->pool);
+      else
+        err = svn_io_file_checksum2(&job->checksum, job->local_abspath,
+                                    svn_checksum_sha1, job->pool);
+
+      /* The walk will do it again and report the error. */
+      if (err)
+        {
+          svn_error_clear(err);
+          job->dirents = NULL;
+          job->checksum = NULL;
+        }
+
+      apr_thread_mutex_lock(workers->mutex);
+      job->finished = TRUE;
+      apr_thread_cond_broadcast(workers->cond);
+      apr_thread_mutex_unlock(workers->mutex);
+    }
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Pool cleanup function stopping the status_workers_t in DATA and
+   releasing all its jobs. */
+static apr_status_t
+stop_status_workers(void *data)
+{
+  status_workers_t *workers = data;
+  int i;
+
+  apr_thread_mutex_lock(workers->mutex);
+  workers->shutdown = TRUE;
+  apr_thread_cond_broadcast(workers->cond);
+  apr_thread_mutex_unlock(workers->mutex);
+
+  for (i = 0; i < workers->thread_count; ++i)
+    {
+      apr_status_t retval;
+      apr_thread_join(&retval, workers->threads[i]);
+    }
+
+  svn_pool_destroy(workers->pool);
+
+  return APR_SUCCESS;
+}
+
+#endif
+
+/* Set *WORKERS to a new set of threads reading ahead of a status walk,
+   or to NULL if threads are not available.  Allocate the workers in
+   POOL; they will be stopped when POOL gets cleaned up. */
+static void
+start_status_workers(status_workers_t **workers,
+                     apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  status_workers_t *result = apr_pcalloc(pool, sizeof(*result));
+  int i;
+
+  *workers = NULL;
+
+  /* Walk and workers allocate and release job memory concurrently. */
+  result->jobs = apr_hash_make(pool);
+  result->pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  if (   apr_thread_mutex_create(&result->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                 result->pool)
+      || apr_thread_cond_create(&result->cond, result->pool))
+    {
+      svn_pool_destroy(result->pool);
+      return;
+    }
+
+  for (i = 0; i < STATUS_WORKER_COUNT; ++i)
+    if (apr_thread_create(&result->threads[result->thread_count], NULL,
+                          status_worker, result, result->pool)
+        == APR_SUCCESS)
+      ++result->thread_count;
+
+  /* The threads must be gone before their pools get destroyed. */
+  apr_pool_pre_cleanup_register(pool, result, stop_status_workers);
+  if (result->thread_count)
+    *workers = result;
+#else
+  *workers = NULL;
+#endif
+}
+
+/* Schedule reading the directory (if IS_DIR is set) or checksumming the
+   file LOCAL_ABSPATH on WORKERS. */
+static void
+schedule_status_job(status_workers_t *workers,
+                    const char *local_abspath,
+                    svn_boolean_t is_dir,
+                    svn_boolean_t only_check_type)
+{
+#if APR_HAS_THREADS
+  status_job_t *job;
+  apr_pool_t *job_pool;
+
+  if (svn_hash_gets(workers->jobs, local_abspath))
+    return;
+
+  job_pool = svn_pool_create(workers->pool);
+  job = apr_pcalloc(job_pool, sizeof(*job));
+  job->local_abspath = apr_pstrdup(job_pool, local_abspath);
+  job->is_dir = is_dir;
+  job->only_check_type = only_check_type;
+  job->pool = job_pool;
+  svn_hash_sets(workers->jobs, job->local_abspath, job);
+
+  apr_thread_mutex_lock(workers->mutex);
+  if (workers->queue_tail)
+    workers->queue_tail->next = job;
+  else
+    workers->queue_head = job;
+  workers->queue_tail = job;
+  apr_thread_cond_signal(workers->cond);
+  apr_thread_mutex_unlock(workers->mutex);
+#endif
+}
+
+/* If a job of kind IS_DIR has been scheduled for LOCAL_ABSPATH on WORKERS,
+   remove it from the schedule, wait for it to finish if it has been
+   started and return it.  Otherwise, return NULL.  A job that has not been
+   started yet is returned unfinished.  WORKERS may be NULL.  The caller
+   must release the job's pool. */
+static status_job_t *
+take_status_job(status_workers_t *workers,
+                const char *local_abspath,
+                svn_boolean_t is_dir)
+{
+#if APR_HAS_THREADS
+  status_job_t *job;
+
+  job = workers ? svn_hash_gets(workers->jobs, local_abspath) : NULL;
+  if (!job || job->is_dir != is_dir)
+    return NULL;
+
+  svn_hash_sets(workers->jobs, local_abspath, NULL);
+
+  apr_thread_mutex_lock(workers->mutex);
+  if (!job->started)
+    {
+      /* Don't wait for it; simply drop it from the queue. */
+      status_job_t **link = &workers->queue_head;
+      status_job_t *prev = NULL;
+
+      while (*link != job)
+        {
+          prev = *link;
+          link = &(*link)->next;
+        }
+
+      *link = job->next;
+      if (workers->queue_tail == job)
+        workers->queue_tail = prev;
+    }
+  else
+    {
+      while (!job->finished)
+        apr_thread_cond_wait(workers->cond, workers->mutex);
+    }
+  apr_thread_mutex_unlock(workers->mutex);
+
+  return job;
+#else
+  return NULL;
+#endif
+}
+
+/* Release the job of kind IS_DIR scheduled for LOCAL_ABSPATH on WORKERS,
+   if there is one. */
+static void
+release_status_job(status_workers_t *workers,
+                   const char *local_abspath,
+                   svn_boolean_t is_dir)
+{
+  status_job_t *job = take_status_job(workers, local_abspath, is_dir);
+  if (job)
+    svn_pool_destroy(job->pool);
+}
+
+/* Return FALSE if the journal state WATCH allows for not reading the
+   directory LOCAL_ABSPATH from disk.  WATCH may be NULL. */
+static svn_boolean_t
+watch_reads_dir(const struct watch_state_t *watch,
+                const char *local_abspath)
+{
+  const char *relpath;
+
+  if (!watch || !watch->check_dirs)
+    return TRUE;
+
+  relpath = svn_dirent_skip_ancestor(watch->wcroot_abspath, local_abspath);
+  return !relpath || svn_hash_gets(watch->check_dirs, relpath) != NULL;
+}
+
+/* Schedule reading ahead the children of DIR_ABSPATH in SORTED_CHILDREN
+   from index *NEXT up to, but not including, index LIMIT, and update
+   *NEXT accordingly.  NODES and DIRENTS are the children as known to the
+   working copy and found on disk, DEPTH is the depth of the walk below
+   DIR_ABSPATH.  Use SCRATCH_POOL for temporary allocations. */
+static void
+schedule_status_jobs(const struct walk_status_baton *wb,
+                     const char *dir_abspath,
+                     const apr_array_header_t *sorted_children,
+                     apr_hash_t *nodes,
+                     apr_hash_t *dirents,
+                     svn_depth_t depth,
+                     int *next,
+                     int limit,
+                     apr_pool_t *scratch_pool)
+{
+  for (; *next < limit && *next < sorted_children->nelts; ++*next)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(sorted_children, *next,
+                                              svn_sort__item_t);
+      const struct svn_wc__db_info_t *info
+        = apr_hash_get(nodes, item->key, item->klen);
+      const svn_io_dirent2_t *dirent
+        = apr_hash_get(dirents, item->key, item->klen);
+
+      if (!info || !dirent)
+        continue;
+
+      if (info->kind == svn_node_dir && dirent->kind == svn_node_dir)
+        {
+          const char *child_abspath = svn_dirent_join(dir_abspath, item->key,
+                                                      scratch_pool);
+
+          if (depth == svn_depth_infinity && wb->check_working_copy
+              && watch_reads_dir(wb->watch, child_abspath))
+            schedule_status_job(wb->workers, child_abspath,
+                                TRUE, wb->ignore_text_mods);
+        }
+      else if (!wb->ignore_text_mods
+               && checksum_decides_text_status(info, dirent))
+        {
+          schedule_status_job(wb->workers,
+                              svn_dirent_join(dir_abspath, item->key,
+                                              scratch_pool),
+                              FALSE, FALSE);
+        }
+    }
+}
+
 /* Given an ENTRY object representing PATH, build a status structure
    and pass it off to the STATUS_FUNC/STATUS_BATON.  All other
    arguments are the same as those passed to assemble_status().  */
@@ -803,6 +1520,8 @@ send_status_structure(const struct walk_status_baton *wb,
 {
   svn_wc__internal_status_t *statstruct;
   const svn_lock_t *repos_lock = NULL;
+  status_job_t *job = take_status_job(wb->workers, local_abspath, FALSE);
+  svn_error_t *err;
 
   /* Check for a repository lock. */
   if (wb->repos_locks)
@@ -826,12 +1545,17 @@ send_status_structure(const struct walk_status_baton *wb,
         }
     }
 
-  SVN_ERR(assemble_status(&statstruct, wb->db, local_abspath,
-                          parent_repos_root_url, parent_repos_relpath,
-                          parent_repos_uuid,
-                          info, dirent, get_all,
-                          wb->ignore_text_mods, wb->check_working_copy,
-                          repos_lock, scratch_pool, scratch_pool));
+  err = assemble_status(&statstruct, wb->db, local_abspath,
+                        parent_repos_root_url, parent_repos_relpath,
+                        parent_repos_uuid,
+                        info, dirent, get_all,
+                        wb->ignore_text_mods, wb->check_working_copy,
+                        repos_lock,
+                        job && job->finished ? job->checksum : NULL,
+                        scratch_pool, scratch_pool);
+  if (job)
+    svn_pool_destroy(job->pool);
+  SVN_ERR(err);
 
   if (statstruct && status_func)
     return svn_error_trace((*status_func)(status_baton, local_abspath,
@@ -1188,6 +1912,59 @@ one_child_status(const struct walk_status_baton *wb,
   return SVN_NO_ERROR;
 }
 
+/* Don't read the whole working copy at once if it has more nodes than this.
+   Each node takes a few hundred bytes of memory. */
+#define PREFETCH_MAX_NODES 50000
+
+/* Like svn_wc__db_read_children_info() for LOCAL_ABSPATH, but use the
+   data prefetched in WB, if available. */
+static svn_error_t *
+read_dir_children_info(apr_hash_t **nodes,
+                       apr_hash_t **conflicts,
+                       const struct walk_status_baton *wb,
+                       const char *local_abspath,
+                       apr_pool_t *result_pool,
+                       apr_pool_t *scratch_pool)
+{
+  const char *relpath = NULL;
+
+  if (wb->prefetched_dirs)
+    relpath = svn_dirent_skip_ancestor(wb->prefetch_abspath, local_abspath);
+
+  if (relpath)
+    {
+      const char *wcroot_abspath;
+
+      /* Nested working copies have their own database. */
+      SVN_ERR(svn_wc__db_get_wcroot(&wcroot_abspath, wb->db, local_abspath,
+                                    scratch_pool, scratch_pool));
+      if (strcmp(wcroot_abspath, wb->prefetch_wcroot_abspath) == 0)
+        {
+          svn_wc__db_children_info_t *dir
+            = svn_hash_gets(wb->prefetched_dirs, relpath);
+
+          if (dir)
+            {
+              *nodes = dir->nodes;
+              *conflicts = dir->conflicts;
+            }
+          else
+            {
+              *nodes = apr_hash_make(result_pool);
+              *conflicts = apr_hash_make(result_pool);
+            }
+
+          return SVN_NO_ERROR;
+        }
+    }
+
+  return svn_error_trace(svn_wc__db_read_children_info(nodes, conflicts,
+                                                       wb->db, local_abspath,
+                                                       !wb->check_working_copy,
+                                                       result_pool,
+                                                       scratch_pool));
+}
+
 /* Send svn_wc_status3_t * structures for the directory LOCAL_ABSPATH and
    for all its child nodes (according to DEPTH) through STATUS_FUNC /
    STATUS_BATON.
@@ -1235,7 +2012,10 @@ get_dir_status(const struct walk_status_baton *wb,
   apr_array_header_t *collected_ignore_patterns = NULL;
   apr_pool_t *iterpool;
   svn_error_t *err;
-  int i;
+  status_job_t *dirents_job;
+  const char *watch_relpath = NULL;
+  apr_hash_t *implied_dirents = NULL;
+  int i, next_job;
 
   if (cancel_func)
     SVN_ERR(cancel_func(cancel_baton));
@@ -1245,7 +2025,46 @@ get_dir_status(const struct walk_status_baton *wb,
 
   iterpool = svn_pool_create(scratch_pool);
 
-  if (wb->check_working_copy)
+  if (!dir_info)
+    SVN_ERR(svn_wc__db_read_single_info(&dir_info, wb->db, local_abspath,
+                                        !wb->check_working_copy,
+                                        scratch_pool, iterpool));
+
+  SVN_ERR(get_repos_root_url_relpath(&dir_repos_relpath, &dir_repos_root_url,
+                                     &dir_repos_uuid, dir_info,
+                                     parent_repos_relpath,
+                                     parent_repos_root_url, parent_repos_uuid,
+                                     wb->db, local_abspath,
+                                     scratch_pool, iterpool));
+
+  /* Create a hash containing all children.  The source hashes
+     don't all map the same types, but only the keys of the result
+     hash are subsequently used. */
+  SVN_ERR(read_dir_children_info(&nodes, &conflicts, wb, local_abspath,
+                                 scratch_pool, iterpool));
+
+  /* A change journal may tell us that the directory is as the working
+     copy expects it to be. */
+  if (wb->watch)
+    {
+      watch_relpath = svn_dirent_skip_ancestor(wb->watch->wcroot_abspath,
+                                               local_abspath);
+      if (watch_relpath)
+        implied_dirents = get_implied_dirents(nodes, scratch_pool, iterpool);
+    }
+
+  /* Our parent may have read the directory for us already. */
+  dirents_job = take_status_job(wb->workers, local_abspath, TRUE);
+  if (implied_dirents && wb->watch->check_dirs
+      && !svn_hash_gets(wb->watch->check_dirs, watch_relpath))
+    {
+      dirents = implied_dirents;
+    }
+  else if (dirents_job && dirents_job->finished && dirents_job->dirents)
+    {
+      dirents = dirents_job->dirents;
+    }
+  else if (wb->check_working_copy)
     {
       err = svn_io_get_dirents3(&dirents, local_abspath,
                                 wb->ignore_text_mods /* only_check_type*/,
@@ -1263,25 +2082,13 @@ get_dir_status(const struct walk_status_baton *wb,
   else
     dirents = apr_hash_make(scratch_pool);
 
-  if (!dir_info)
-    SVN_ERR(svn_wc__db_read_single_info(&dir_info, wb->db, local_abspath,
-                                        !wb->check_working_copy,
-                                        scratch_pool, iterpool));
-
-  SVN_ERR(get_repos_root_url_relpath(&dir_repos_relpath, &dir_repos_root_url,
-                                     &dir_repos_uuid, dir_info,
-                                     parent_repos_relpath,
-                                     parent_repos_root_url, parent_repos_uuid,
-                                     wb->db, local_abspath,
-                                     scratch_pool, iterpool));
-
-  /* Create a hash containing all children.  The source hashes
-     don't all map the same types, but only the keys of the result
-     hash are subsequently used. */
-  SVN_ERR(svn_wc__db_read_children_info(&nodes, &conflicts,
-                                        wb->db, local_abspath,
-                                        !wb->check_working_copy,
-                                        scratch_pool, iterpool));
+  /* Remember the directories that the next walk will have to read. */
+  if (watch_relpath && wb->watch->dirty_dirs
+      && dirents != implied_dirents
+      && !(implied_dirents && dirents_match(implied_dirents, dirents,
+                                            iterpool)))
+    svn_hash_sets(wb->watch->dirty_dirs,
+                  apr_pstrdup(wb->watch->pool, watch_relpath), "");
 
   all_children = apr_hash_overlay(scratch_pool, nodes, dirents);
   if (apr_hash_count(conflicts) > 0)
@@ -1340,6 +2147,7 @@ get_dir_status(const struct walk_status_baton *wb,
   sorted_children = svn_sort__hash(all_children,
                                    svn_sort_compare_items_lexically,
                                    scratch_pool);
+  next_job = 0;
   for (i = 0; i < sorted_children->nelts; i++)
     {
       const void *key;
@@ -1351,6 +2159,11 @@ get_dir_status(const struct walk_status_baton *wb,
 
       svn_pool_clear(iterpool);
 
+      if (wb->workers)
+        schedule_status_jobs(wb, local_abspath, sorted_children,
+                             nodes, dirents, depth,
+                             &next_job, i + STATUS_JOBS_AHEAD, iterpool);
+
       item = APR_ARRAY_IDX(sorted_children, i, svn_sort__item_t);
       key = item.key;
       klen = item.klen;
@@ -1381,8 +2194,24 @@ get_dir_status(const struct walk_status_baton *wb,
                                iterpool));
     }
 
+  /* Release the jobs of children that the walk did not look at, e.g.
+     because they are externals. */
+  for (i = 0; i < next_job; i++)
+    {
+      svn_sort__item_t *item = &APR_ARRAY_IDX(sorted_children, i,
+                                              svn_sort__item_t);
+      const char *child_abspath;
+
+      svn_pool_clear(iterpool);
+      child_abspath = svn_dirent_join(local_abspath, item->key, iterpool);
+      release_status_job(wb->workers, child_abspath, TRUE);
+      release_status_job(wb->workers, child_abspath, FALSE);
+    }
+
   /* Destroy our subpools. */
   svn_pool_destroy(iterpool);
+  if (dirents_job)
+    svn_pool_destroy(dirents_job->pool);
 
   return SVN_NO_ERROR;
 }
@@ -2513,6 +3342,9 @@ svn_wc__get_status_editor(const svn_delta_editor_t **editor,
   eb->wb.check_working_copy = check_working_copy;
   eb->wb.repos_locks      = NULL;
   eb->wb.repos_root       = NULL;
+  eb->wb.prefetched_dirs  = NULL;
+  eb->wb.workers          = NULL;
+  eb->wb.watch            = NULL;
 
   SVN_ERR(svn_wc__db_externals_defined_below(&eb->wb.externals,
                                              wc_ctx->db, eb->target_abspath,
@@ -2644,6 +3476,9 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
   wb.check_working_copy = TRUE;
   wb.repos_root = NULL;
   wb.repos_locks = NULL;
+  wb.prefetched_dirs = NULL;
+  wb.workers = NULL;
+  wb.watch = NULL;
 
   /* Use the caller-provided ignore patterns if provided; the build-time
      configured defaults otherwise. */
@@ -2690,6 +3525,30 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
       && info->status != svn_wc__db_status_excluded
       && info->status != svn_wc__db_status_server_excluded)
     {
+      /* Reading the whole tree at once is much cheaper than reading it
+         directory by directory. */
+      if (depth == svn_depth_infinity || depth == svn_depth_unknown)
+        {
+          SVN_ERR(svn_wc__db_read_subtree_children_info(&wb.prefetched_dirs,
+                                                        db, local_abspath,
+                                                        FALSE,
+                                                        PREFETCH_MAX_NODES,
+                                                        scratch_pool,
+                                                        scratch_pool));
+          wb.prefetch_abspath = local_abspath;
+          SVN_ERR(svn_wc__db_get_wcroot(&wb.prefetch_wcroot_abspath, db,
+                                        local_abspath,
+                                        scratch_pool, scratch_pool));
+          start_status_workers(&wb.workers, scratch_pool);
+
+          /* A baseline can only be written after a complete walk. */
+          if (!ignore_text_mods)
+            read_watch_state(&wb.watch, wb.prefetch_wcroot_abspath,
+                             strcmp(wb.prefetch_wcroot_abspath,
+                                    local_abspath) == 0,
+                             scratch_pool, scratch_pool);
+        }
+
       SVN_ERR(get_dir_status(&wb,
                              local_abspath,
                              FALSE /* skip_root */,
@@ -2703,6 +3562,10 @@ svn_wc__internal_walk_status(svn_wc__db_t *db,
                              status_func, status_baton,
                              cancel_func, cancel_baton,
                              scratch_pool));
+
+      /* The baseline is a mere cache; the working copy may be read-only. */
+      if (wb.watch && wb.watch->dirty_dirs)
+        svn_error_clear(write_watch_baseline(wb.watch, scratch_pool));
     }
   else
     {
@@ -2901,6 +3764,7 @@ internal_status(svn_wc__internal_status_t **status,
                                          TRUE /* get_all */,
                                          FALSE, check_working_copy,
                                          NULL /* repos_lock */,
+                                         NULL /* actual_checksum */,
                                          result_pool, scratch_pool));
 }
 
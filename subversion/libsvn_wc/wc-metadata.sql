@@ -88,13 +88,15 @@ CREATE TABLE PRISTINE (
      pristine texts referenced from this database. */
   checksum  TEXT NOT NULL PRIMARY KEY,
 
-  /* Enumerated values specifying type of compression. The only value
-     supported so far is NULL, meaning that no compression has been applied
-     and the pristine text is stored verbatim in the file. */
+  /* Enumerated values specifying type of compression. NULL means that no
+     compression has been applied and the pristine text is stored verbatim
+     in the file. 1 means that the file holds a sequence of LZ4 compressed
+     blocks, see svn_stream__lz4_compressed(). */
   compression  INTEGER,
 
-  /* The size in bytes of the file in which the pristine text is stored.
-     Used to verify the pristine file is "proper". */
+  /* The size in bytes of the pristine text, i.e. of the file in which it
+     is stored if it is not compressed.  Used to verify the pristine file
+     is "proper". */
   size  INTEGER NOT NULL,
 
   /* The number of rows in the NODES table that have a 'checksum' column
@@ -163,6 +163,44 @@ SELECT local_relpath, changelist, properties, conflict_data
 FROM actual_node
 WHERE wc_id = ?1 AND parent_relpath = ?2
 
+-- STMT_SELECT_NODE_DESCENDANTS_INFO
+/* Like STMT_SELECT_NODE_CHILDREN_INFO, but for all descendants of ?2.
+   All rows of a node are still returned together. */
+SELECT op_depth, nodes.repos_id, nodes.repos_path, presence, kind, revision,
+  checksum, translated_size, changed_revision, changed_date, changed_author,
+  depth, symlink_target, last_mod_time, properties, lock_token, lock_owner,
+  lock_comment, lock_date, local_relpath, moved_here, moved_to, file_external
+FROM nodes
+LEFT OUTER JOIN lock ON nodes.repos_id = lock.repos_id
+  AND nodes.repos_path = lock.repos_relpath AND nodes.op_depth = 0
+WHERE wc_id = ?1 AND IS_STRICT_DESCENDANT_OF(local_relpath, ?2)
+ORDER BY local_relpath DESC, op_depth DESC
+
+-- STMT_SELECT_BASE_NODE_DESCENDANTS_INFO
+/* See above re: result ordering. */
+SELECT op_depth, nodes.repos_id, nodes.repos_path, presence, kind, revision,
+  checksum, translated_size, changed_revision, changed_date, changed_author,
+  depth, symlink_target, last_mod_time, properties, lock_token, lock_owner,
+  lock_comment, lock_date, local_relpath, moved_here, moved_to, file_external
+FROM nodes
+LEFT OUTER JOIN lock ON nodes.repos_id = lock.repos_id
+  AND nodes.repos_path = lock.repos_relpath
+WHERE wc_id = ?1 AND IS_STRICT_DESCENDANT_OF(local_relpath, ?2)
+  AND op_depth = 0
+ORDER BY local_relpath DESC
+
+-- STMT_SELECT_ACTUAL_DESCENDANTS_INFO
+SELECT local_relpath, changelist, properties, conflict_data
+FROM actual_node
+WHERE wc_id = ?1 AND IS_STRICT_DESCENDANT_OF(local_relpath, ?2)
+
+-- STMT_COUNT_NODE_DESCENDANTS_LIMITED
+/* Counts the node rows below ?2, but stops at ?3. */
+SELECT COUNT(*) FROM (
+  SELECT 1 FROM nodes
+  WHERE wc_id = ?1 AND IS_STRICT_DESCENDANT_OF(local_relpath, ?2)
+  LIMIT ?3)
+
 -- STMT_SELECT_REPOSITORY_BY_ID
 SELECT root, uuid FROM repository WHERE id = ?1
 
@@ -869,16 +907,20 @@ INSERT INTO work_queue (work) VALUES (?1)
 -- STMT_SELECT_WORK_ITEM
 SELECT id, work FROM work_queue ORDER BY id LIMIT 1
 
+-- STMT_SELECT_WORK_ITEMS_FROM
+SELECT id, work FROM work_queue WHERE id >= ?1 ORDER BY id LIMIT ?2
+
 -- STMT_DELETE_WORK_ITEM
 DELETE FROM work_queue WHERE id = ?1
 
 -- STMT_INSERT_OR_IGNORE_PRISTINE
-INSERT OR IGNORE INTO pristine (checksum, md5_checksum, size, refcount)
-VALUES (?1, ?2, ?3, 0)
+INSERT OR IGNORE INTO pristine (checksum, md5_checksum, size, refcount,
+                                compression)
+VALUES (?1, ?2, ?3, 0, ?4)
 
 -- STMT_INSERT_PRISTINE
-INSERT INTO pristine (checksum, md5_checksum, size, refcount)
-VALUES (?1, ?2, ?3, 0)
+INSERT INTO pristine (checksum, md5_checksum, size, refcount, compression)
+VALUES (?1, ?2, ?3, 0, ?4)
 
 -- STMT_SELECT_PRISTINE
 SELECT md5_checksum
@@ -886,7 +928,7 @@ FROM pristine
 WHERE checksum = ?1
 
 -- STMT_SELECT_PRISTINE_SIZE
-SELECT size
+SELECT size, compression
 FROM pristine
 WHERE checksum = ?1 LIMIT 1
 
@@ -906,7 +948,7 @@ WHERE checksum = ?1 AND refcount = 0
 
 -- STMT_SELECT_COPY_PRISTINES
 /* For the root itself */
-SELECT n.checksum, md5_checksum, size
+SELECT n.checksum, md5_checksum, size, compression
 FROM nodes_current n
 LEFT JOIN pristine p ON n.checksum = p.checksum
 WHERE wc_id = ?1
@@ -914,7 +956,7 @@ WHERE wc_id = ?1
   AND n.checksum IS NOT NULL
 UNION ALL
 /* And all descendants */
-SELECT n.checksum, md5_checksum, size
+SELECT n.checksum, md5_checksum, size, compression
 FROM nodes n
 LEFT JOIN pristine p ON n.checksum = p.checksum
 WHERE wc_id = ?1
@@ -1297,6 +1339,141 @@ SELECT local_relpath FROM nodes_current
 
 /* ------------------------------------------------------------------------- */
 
+/* The shared pristine store keeps pristine texts for many working copies
+   in a directory of its own, with a separate database.  Its files are
+   hard links to the files in the pristine stores of the working copies
+   that use them.  SHARED_PRISTINE_USER records which working copy uses
+   which text, and SHARED_PRISTINE.refcount counts these rows. */
+
+-- STMT_CREATE_SHARED_PRISTINE_SCHEMA
+CREATE TABLE IF NOT EXISTS shared_pristine (
+  checksum  TEXT NOT NULL PRIMARY KEY,
+  compression  INTEGER,
+  size  INTEGER NOT NULL,
+  refcount  INTEGER NOT NULL,
+  md5_checksum  TEXT NOT NULL
+  );
+CREATE TABLE IF NOT EXISTS shared_pristine_user (
+  wcroot  TEXT NOT NULL,
+  checksum  TEXT NOT NULL REFERENCES shared_pristine (checksum),
+  PRIMARY KEY (wcroot, checksum)
+  );
+CREATE TRIGGER IF NOT EXISTS shared_pristine_user_insert_trigger
+AFTER INSERT ON shared_pristine_user
+BEGIN
+  UPDATE shared_pristine SET refcount = refcount + 1
+  WHERE checksum = new.checksum;
+END;
+CREATE TRIGGER IF NOT EXISTS shared_pristine_user_delete_trigger
+AFTER DELETE ON shared_pristine_user
+BEGIN
+  UPDATE shared_pristine SET refcount = refcount - 1
+  WHERE checksum = old.checksum;
+END;
+
+-- STMT_SELECT_SHARED_PRISTINE
+SELECT compression
+FROM shared_pristine
+WHERE checksum = ?1
+
+-- STMT_INSERT_SHARED_PRISTINE
+INSERT INTO shared_pristine (checksum, md5_checksum, size, refcount,
+                             compression)
+VALUES (?1, ?2, ?3, 0, ?4)
+
+-- STMT_INSERT_OR_IGNORE_SHARED_PRISTINE_USER
+INSERT OR IGNORE INTO shared_pristine_user (wcroot, checksum)
+VALUES (?1, ?2)
+
+-- STMT_DELETE_SHARED_PRISTINE_USER
+DELETE FROM shared_pristine_user
+WHERE wcroot = ?1 AND checksum = ?2
+
+-- STMT_SELECT_SHARED_PRISTINE_WCROOTS
+SELECT DISTINCT wcroot
+FROM shared_pristine_user
+
+-- STMT_DELETE_SHARED_PRISTINE_WCROOT
+DELETE FROM shared_pristine_user
+WHERE wcroot = ?1
+
+-- STMT_SELECT_UNREFERENCED_SHARED_PRISTINES
+SELECT checksum
+FROM shared_pristine
+WHERE refcount = 0
+
+-- STMT_DELETE_SHARED_PRISTINE_IF_UNREFERENCED
+DELETE FROM shared_pristine
+WHERE checksum = ?1 AND refcount = 0
+
+/* ------------------------------------------------------------------------- */
+
+/* TEXT_HASH caches a fast hash of working files that were found to be
+   unmodified, so that a later check after a timestamp change only has to
+   hash the file again.  The table is created on first use; its triggers
+   drop the hash whenever the node's pristine or properties change, as the
+   result of the comparison depends on both. */
+
+-- STMT_CREATE_TEXT_HASH_SCHEMA
+CREATE TABLE IF NOT EXISTS text_hash (
+  wc_id  INTEGER NOT NULL REFERENCES WCROOT (id),
+  local_relpath  TEXT NOT NULL,
+  hash  TEXT NOT NULL,
+  PRIMARY KEY (wc_id, local_relpath)
+  );
+CREATE TRIGGER IF NOT EXISTS text_hash_nodes_insert_trigger
+AFTER INSERT ON nodes
+BEGIN
+  DELETE FROM text_hash
+  WHERE wc_id = new.wc_id AND local_relpath = new.local_relpath;
+END;
+CREATE TRIGGER IF NOT EXISTS text_hash_nodes_update_trigger
+AFTER UPDATE OF checksum, properties, presence ON nodes
+BEGIN
+  DELETE FROM text_hash
+  WHERE wc_id = old.wc_id AND local_relpath = old.local_relpath;
+END;
+CREATE TRIGGER IF NOT EXISTS text_hash_nodes_delete_trigger
+AFTER DELETE ON nodes
+BEGIN
+  DELETE FROM text_hash
+  WHERE wc_id = old.wc_id AND local_relpath = old.local_relpath;
+END;
+CREATE TRIGGER IF NOT EXISTS text_hash_actual_insert_trigger
+AFTER INSERT ON actual_node
+BEGIN
+  DELETE FROM text_hash
+  WHERE wc_id = new.wc_id AND local_relpath = new.local_relpath;
+END;
+CREATE TRIGGER IF NOT EXISTS text_hash_actual_update_trigger
+AFTER UPDATE OF properties ON actual_node
+BEGIN
+  DELETE FROM text_hash
+  WHERE wc_id = old.wc_id AND local_relpath = old.local_relpath;
+END;
+CREATE TRIGGER IF NOT EXISTS text_hash_actual_delete_trigger
+AFTER DELETE ON actual_node
+BEGIN
+  DELETE FROM text_hash
+  WHERE wc_id = old.wc_id AND local_relpath = old.local_relpath;
+END;
+
+-- STMT_SELECT_TEXT_HASH
+SELECT hash FROM text_hash
+WHERE wc_id = ?1 AND local_relpath = ?2
+
+/* Only record the hash if the node still has the pristine it was
+   compared with. */
+-- STMT_INSERT_TEXT_HASH
+INSERT OR REPLACE INTO text_hash (wc_id, local_relpath, hash)
+SELECT ?1, ?2, ?4 FROM nodes
+WHERE wc_id = ?1 AND local_relpath = ?2
+  AND op_depth = (SELECT MAX(op_depth) FROM nodes
+                  WHERE wc_id = ?1 AND local_relpath = ?2)
+  AND checksum = ?3
+
+/* ------------------------------------------------------------------------- */
+
 /* these are used in entries.c  */
 
 -- STMT_INSERT_ACTUAL_NODE
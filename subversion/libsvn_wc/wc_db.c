@@ -6098,6 +6098,127 @@ svn_wc__db_global_record_fileinfo(svn_wc__db_t *db,
 }
 
 
+/* Create the TEXT_HASH table and its triggers in WCROOT, unless that has
+   been done before. */
+static svn_error_t *
+ensure_text_hash_schema(svn_wc__db_wcroot_t *wcroot)
+{
+  if (!wcroot->text_hash_schema)
+    {
+      SVN_ERR(svn_sqlite__exec_statements(wcroot->sdb,
+                                          STMT_CREATE_TEXT_HASH_SCHEMA));
+      wcroot->text_hash_schema = TRUE;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* The body of svn_wc__db_read_text_hash(). */
+static svn_error_t *
+read_text_hash(const svn_checksum_t **hash,
+               svn_wc__db_wcroot_t *wcroot,
+               const char *local_relpath,
+               apr_pool_t *result_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_error_t *err = SVN_NO_ERROR;
+
+  SVN_ERR(ensure_text_hash_schema(wcroot));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_TEXT_HASH));
+  SVN_ERR(svn_sqlite__bindf(stmt, "is", wcroot->wc_id, local_relpath));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  if (have_row)
+    err = svn_sqlite__column_checksum(hash, stmt, 0, result_pool);
+
+  return svn_error_trace(svn_error_compose_create(err,
+                                                  svn_sqlite__reset(stmt)));
+}
+
+svn_error_t *
+svn_wc__db_read_text_hash(svn_boolean_t *enabled,
+                          const svn_checksum_t **hash,
+                          svn_wc__db_t *db,
+                          const char *local_abspath,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+  svn_error_t *err;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(local_abspath));
+
+  *enabled = db->cache_text_hashes;
+  *hash = NULL;
+  if (!db->cache_text_hashes)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              local_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  err = read_text_hash(hash, wcroot, local_relpath, result_pool);
+  if (err)
+    {
+      /* E.g. a read-only working copy that has no cache yet. */
+      svn_error_clear(err);
+      *hash = NULL;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* The body of svn_wc__db_store_text_hash(). */
+static svn_error_t *
+store_text_hash(svn_wc__db_wcroot_t *wcroot,
+                const char *local_relpath,
+                const svn_checksum_t *pristine_checksum,
+                const svn_checksum_t *hash,
+                apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(ensure_text_hash_schema(wcroot));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_INSERT_TEXT_HASH));
+  SVN_ERR(svn_sqlite__bindf(stmt, "is", wcroot->wc_id, local_relpath));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 3, pristine_checksum,
+                                    scratch_pool));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 4, hash, scratch_pool));
+
+  return svn_error_trace(svn_sqlite__step_done(stmt));
+}
+
+svn_error_t *
+svn_wc__db_store_text_hash(svn_wc__db_t *db,
+                           const char *local_abspath,
+                           const svn_checksum_t *pristine_checksum,
+                           const svn_checksum_t *hash,
+                           apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(local_abspath));
+
+  if (!db->cache_text_hashes)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              local_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  svn_error_clear(store_text_hash(wcroot, local_relpath, pristine_checksum,
+                                  hash, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+
 /* Set the ACTUAL_NODE properties column for (WC_ID, LOCAL_RELPATH) to
  * PROPS.
  *
@@ -9264,6 +9385,52 @@ find_conflict_descendants(svn_boolean_t *conflict_exists,
   return svn_error_trace(svn_sqlite__reset(stmt));
 }
 
+#ifdef HAVE_SYMLINK
+/* Set *SPECIAL to TRUE if the serialized property list in COLUMN of STMT
+   contains SVN_PROP_SPECIAL and to FALSE otherwise.
+
+   Most nodes with properties are not special, and parsing their whole
+   property skel is a good part of the CPU time spent by status.  So only
+   parse it if the property name occurs anywhere in its raw form. */
+static svn_error_t *
+column_has_special_prop(svn_boolean_t *special,
+                        svn_sqlite__stmt_t *stmt,
+                        int column,
+                        apr_pool_t *scratch_pool)
+{
+  apr_size_t len;
+  const char *data = svn_sqlite__column_blob(stmt, column, &len, NULL);
+  const apr_size_t name_len = sizeof(SVN_PROP_SPECIAL) - 1;
+  const char *end;
+  const char *p;
+
+  *special = FALSE;
+  if (data == NULL)
+    return SVN_NO_ERROR;
+
+  end = data + len;
+  for (p = data; (apr_size_t)(end - p) >= name_len; ++p)
+    {
+      p = memchr(p, SVN_PROP_SPECIAL[0], end - p - name_len + 1);
+      if (p == NULL)
+        break;
+
+      if (memcmp(p, SVN_PROP_SPECIAL, name_len) == 0)
+        {
+          apr_hash_t *properties;
+
+          SVN_ERR(svn_sqlite__column_properties(&properties, stmt, column,
+                                                scratch_pool, scratch_pool));
+          *special = (properties
+                      && svn_hash_gets(properties, SVN_PROP_SPECIAL));
+          break;
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+#endif
+
 /* What we really want to store about a node.  This relies on the
    offset of svn_wc__db_info_t being zero. */
 struct read_children_info_item_t
@@ -9274,12 +9441,42 @@ struct read_children_info_item_t
   svn_boolean_t was_dir;
 };
 
-/* Implementation of svn_wc__db_read_children_info */
+/* Return the entry for the parent directory of CHILD_RELPATH in SUBTREE,
+   which maps parent relpaths to svn_wc__db_children_info_t.  Create the
+   entry in RESULT_POOL if it does not exist, yet. */
+static svn_wc__db_children_info_t *
+get_subtree_dir(apr_hash_t *subtree,
+                const char *child_relpath,
+                apr_pool_t *result_pool)
+{
+  const char *slash = strrchr(child_relpath, '/');
+  apr_ssize_t len = slash ? slash - child_relpath : 0;
+  svn_wc__db_children_info_t *dir = apr_hash_get(subtree, child_relpath, len);
+
+  if (!dir)
+    {
+      dir = apr_pcalloc(result_pool, sizeof(*dir));
+      dir->nodes = apr_hash_make(result_pool);
+      dir->conflicts = apr_hash_make(result_pool);
+      apr_hash_set(subtree, apr_pstrmemdup(result_pool, child_relpath, len),
+                   len, dir);
+    }
+
+  return dir;
+}
+
+/* Implementation of svn_wc__db_read_children_info.
+
+   If SUBTREE is not NULL, read the children of all directories below
+   DIR_RELPATH as well and add them to SUBTREE, which maps the relpath of
+   each parent directory to a svn_wc__db_children_info_t.  CONFLICTS and
+   NODES are ignored in that case. */
 static svn_error_t *
 read_children_info(svn_wc__db_wcroot_t *wcroot,
                    const char *dir_relpath,
                    apr_hash_t *conflicts,
                    apr_hash_t *nodes,
+                   apr_hash_t *subtree,
                    svn_boolean_t base_tree_only,
                    apr_pool_t *result_pool,
                    apr_pool_t *scratch_pool)
@@ -9291,10 +9488,16 @@ read_children_info(svn_wc__db_wcroot_t *wcroot,
   apr_int64_t last_repos_id = INVALID_REPOS_ID;
   const char *last_repos_root_url = NULL;
 
-  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
-                                    (base_tree_only
-                                     ? STMT_SELECT_BASE_NODE_CHILDREN_INFO
-                                     : STMT_SELECT_NODE_CHILDREN_INFO)));
+  if (subtree)
+    SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                      (base_tree_only
+                                       ? STMT_SELECT_BASE_NODE_DESCENDANTS_INFO
+                                       : STMT_SELECT_NODE_DESCENDANTS_INFO)));
+  else
+    SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                      (base_tree_only
+                                       ? STMT_SELECT_BASE_NODE_CHILDREN_INFO
+                                       : STMT_SELECT_NODE_CHILDREN_INFO)));
   SVN_ERR(svn_sqlite__bindf(stmt, "is", wcroot->wc_id, dir_relpath));
   SVN_ERR(svn_sqlite__step(&have_row, stmt));
 
@@ -9309,6 +9512,9 @@ read_children_info(svn_wc__db_wcroot_t *wcroot,
       int op_depth;
       svn_boolean_t new_child;
 
+      if (subtree)
+        nodes = get_subtree_dir(subtree, child_relpath, result_pool)->nodes;
+
       child_item = (base_tree_only ? NULL : svn_hash_gets(nodes, name));
       if (child_item)
         new_child = FALSE;
@@ -9420,19 +9626,22 @@ read_children_info(svn_wc__db_wcroot_t *wcroot,
           child->recorded_time = svn_sqlite__column_int64(stmt, 13);
           child->recorded_size = get_recorded_size(stmt, 7);
           child->has_checksum = !svn_sqlite__column_is_null(stmt, 6);
+          if (child->has_checksum && child->kind == svn_node_file)
+            {
+              err = svn_sqlite__column_checksum(&child->checksum, stmt, 6,
+                                                result_pool);
+              if (err)
+                SVN_ERR(svn_error_compose_create(err, svn_sqlite__reset(stmt)));
+            }
           child->copied = op_depth > 0 && !svn_sqlite__column_is_null(stmt, 2);
           child->had_props = SQLITE_PROPERTIES_AVAILABLE(stmt, 14);
 #ifdef HAVE_SYMLINK
           if (child->had_props)
             {
-              apr_hash_t *properties;
-              err = svn_sqlite__column_properties(&properties, stmt, 14,
-                                                  scratch_pool, scratch_pool);
+              err = column_has_special_prop(&child->special, stmt, 14,
+                                            scratch_pool);
               if (err)
                 SVN_ERR(svn_error_compose_create(err, svn_sqlite__reset(stmt)));
-
-              child->special = (child->had_props
-                                && svn_hash_gets(properties, SVN_PROP_SPECIAL));
             }
 #endif
           if (op_depth == 0)
@@ -9521,7 +9730,9 @@ read_children_info(svn_wc__db_wcroot_t *wcroot,
   if (!base_tree_only)
     {
       SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
-                                        STMT_SELECT_ACTUAL_CHILDREN_INFO));
+                                        subtree
+                                          ? STMT_SELECT_ACTUAL_DESCENDANTS_INFO
+                                          : STMT_SELECT_ACTUAL_CHILDREN_INFO));
       SVN_ERR(svn_sqlite__bindf(stmt, "is", wcroot->wc_id, dir_relpath));
       SVN_ERR(svn_sqlite__step(&have_row, stmt));
 
@@ -9532,6 +9743,14 @@ read_children_info(svn_wc__db_wcroot_t *wcroot,
           const char *child_relpath = svn_sqlite__column_text(stmt, 0, NULL);
           const char *name = svn_relpath_basename(child_relpath, NULL);
 
+          if (subtree)
+            {
+              svn_wc__db_children_info_t *dir
+                = get_subtree_dir(subtree, child_relpath, result_pool);
+              nodes = dir->nodes;
+              conflicts = dir->conflicts;
+            }
+
           child_item = svn_hash_gets(nodes, name);
           if (!child_item)
             {
@@ -9548,14 +9767,11 @@ read_children_info(svn_wc__db_wcroot_t *wcroot,
           if (child->props_mod)
             {
               svn_error_t *err;
-              apr_hash_t *properties;
 
-              err = svn_sqlite__column_properties(&properties, stmt, 2,
-                                                  scratch_pool, scratch_pool);
+              err = column_has_special_prop(&child->special, stmt, 2,
+                                            scratch_pool);
               if (err)
                 SVN_ERR(svn_error_compose_create(err, svn_sqlite__reset(stmt)));
-              child->special = (NULL != svn_hash_gets(properties,
-                                                      SVN_PROP_SPECIAL));
             }
 #endif
 
@@ -9596,13 +9812,94 @@ svn_wc__db_read_children_info(apr_hash_t **nodes,
   VERIFY_USABLE_WCROOT(wcroot);
 
   SVN_WC__DB_WITH_TXN(
-    read_children_info(wcroot, dir_relpath, *conflicts, *nodes,
+    read_children_info(wcroot, dir_relpath, *conflicts, *nodes, NULL,
                        base_tree_only, result_pool, scratch_pool),
     wcroot);
 
   return SVN_NO_ERROR;
 }
 
+/* Implementation of svn_wc__db_read_subtree_children_info.  Set *SUBTREE
+   to NULL if there are more than MAX_NODES rows to read. */
+static svn_error_t *
+read_subtree_children_info(apr_hash_t **subtree,
+                           svn_wc__db_wcroot_t *wcroot,
+                           const char *dir_relpath,
+                           svn_boolean_t base_tree_only,
+                           int max_nodes,
+                           apr_pool_t *result_pool,
+                           apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  int count;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_COUNT_NODE_DESCENDANTS_LIMITED));
+  SVN_ERR(svn_sqlite__bindf(stmt, "isd", wcroot->wc_id, dir_relpath,
+                            max_nodes + 1));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+  count = svn_sqlite__column_int(stmt, 0);
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  if (count > max_nodes)
+    {
+      *subtree = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  *subtree = apr_hash_make(result_pool);
+  return svn_error_trace(read_children_info(wcroot, dir_relpath, NULL, NULL,
+                                            *subtree, base_tree_only,
+                                            result_pool, scratch_pool));
+}
+
+svn_error_t *
+svn_wc__db_read_subtree_children_info(apr_hash_t **dirs,
+                                      svn_wc__db_t *db,
+                                      const char *dir_abspath,
+                                      svn_boolean_t base_tree_only,
+                                      int max_nodes,
+                                      apr_pool_t *result_pool,
+                                      apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *dir_relpath;
+  apr_hash_t *subtree;
+  apr_hash_index_t *hi;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(dir_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &dir_relpath, db,
+                                                dir_abspath,
+                                                scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  SVN_WC__DB_WITH_TXN(
+    read_subtree_children_info(&subtree, wcroot, dir_relpath,
+                               base_tree_only, max_nodes,
+                               result_pool, scratch_pool),
+    wcroot);
+
+  if (subtree == NULL)
+    {
+      *dirs = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  /* Make the keys relative to DIR_RELPATH. */
+  *dirs = apr_hash_make(result_pool);
+  for (hi = apr_hash_first(scratch_pool, subtree); hi; hi = apr_hash_next(hi))
+    {
+      const char *relpath = svn_relpath_skip_ancestor(dir_relpath,
+                                                      apr_hash_this_key(hi));
+
+      if (relpath)
+        svn_hash_sets(*dirs, relpath, apr_hash_this_val(hi));
+    }
+
+  return SVN_NO_ERROR;
+}
+
 /* Implementation of svn_wc__db_read_single_info.
 
    ### This function is very similar to a lot of code inside
@@ -13455,9 +13752,12 @@ svn_wc__db_wq_add(svn_wc__db_t *db,
                               wri_abspath, scratch_pool, scratch_pool));
   VERIFY_USABLE_WCROOT(wcroot);
 
-  /* Add the work item(s) to the WORK_QUEUE.  */
-  return svn_error_trace(add_work_items(wcroot->sdb, work_item,
-                                        scratch_pool));
+  /* Add the work item(s) to the WORK_QUEUE, all of them in one
+     transaction.  */
+  SVN_WC__DB_WITH_TXN(add_work_items(wcroot->sdb, work_item, scratch_pool),
+                      wcroot);
+
+  return SVN_NO_ERROR;
 }
 
 /* The body of svn_wc__db_wq_fetch_next().
@@ -13599,6 +13899,126 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__db_wq_fetch_items(apr_array_header_t **ids,
+                          apr_array_header_t **work_items,
+                          svn_wc__db_t *db,
+                          const char *wri_abspath,
+                          apr_uint64_t first_id,
+                          int max_items,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  *ids = apr_array_make(result_pool, max_items, sizeof(apr_uint64_t));
+  *work_items = apr_array_make(result_pool, max_items, sizeof(svn_skel_t *));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_WORK_ITEMS_FROM));
+  SVN_ERR(svn_sqlite__bind_int64(stmt, 1, first_id));
+  SVN_ERR(svn_sqlite__bind_int(stmt, 2, max_items));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  while (have_row)
+    {
+      apr_size_t len;
+      const void *val;
+
+      APR_ARRAY_PUSH(*ids, apr_uint64_t) = svn_sqlite__column_int64(stmt, 0);
+
+      val = svn_sqlite__column_blob(stmt, 1, &len, result_pool);
+      APR_ARRAY_PUSH(*work_items, svn_skel_t *) = svn_skel__parse(val, len,
+                                                                  result_pool);
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+/* The body of svn_wc__db_wq_record_and_complete().
+ */
+static svn_error_t *
+wq_record_and_complete(svn_wc__db_wcroot_t *wcroot,
+                       const apr_array_header_t *completed_ids,
+                       apr_hash_t *record_map,
+                       apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  int i;
+
+  for (i = 0; i < completed_ids->nelts; i++)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                        STMT_DELETE_WORK_ITEM));
+      SVN_ERR(svn_sqlite__bind_int64(stmt, 1,
+                                     APR_ARRAY_IDX(completed_ids, i,
+                                                   apr_uint64_t)));
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
+
+  if (record_map)
+    SVN_ERR(wq_record(wcroot, record_map, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_wq_record_and_complete(svn_wc__db_t *db,
+                                  const char *wri_abspath,
+                                  const apr_array_header_t *completed_ids,
+                                  apr_hash_t *record_map,
+                                  apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  SVN_WC__DB_WITH_TXN(
+    wq_record_and_complete(wcroot, completed_ids, record_map, scratch_pool),
+    wcroot);
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_global_record_fileinfo_many(svn_wc__db_t *db,
+                                       const char *wri_abspath,
+                                       apr_hash_t *record_map,
+                                       apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+
+  if (apr_hash_count(record_map) == 0)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  SVN_WC__DB_WITH_TXN(wq_record(wcroot, record_map, scratch_pool), wcroot);
+
+  return SVN_NO_ERROR;
+}
+
 
 
 /* ### temporary API. remove before release.  */
@@ -905,6 +905,10 @@ svn_wc__db_base_get_lock_tokens_recursive(apr_hash_t **lock_tokens,
    ### This is temporary - callers should not be looking at the file
    directly.
 
+   If the text is stored compressed, set *PRISTINE_ABSPATH to a temporary
+   decompressed copy instead, which will be removed when RESULT_POOL is
+   cleared or destroyed.
+
    Allocate the path in RESULT_POOL. */
 svn_error_t *
 svn_wc__db_pristine_get_path(const char **pristine_abspath,
@@ -925,6 +929,47 @@ svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
                                     apr_pool_t *result_pool,
                                     apr_pool_t *scratch_pool);
 
+/* Set *COMPRESSED to TRUE if the pristine text identified by SHA1_CHECKSUM
+   within the WC identified by WRI_ABSPATH in DB is stored compressed, and
+   to FALSE otherwise, also if it is not in the pristine store. */
+svn_error_t *
+svn_wc__db_pristine_get_compressed(svn_boolean_t *compressed,
+                                   svn_wc__db_t *db,
+                                   const char *wri_abspath,
+                                   const svn_checksum_t *sha1_checksum,
+                                   apr_pool_t *scratch_pool);
+
+/* Set *CONTENTS to a readable stream that yields the pristine text stored
+   in the file PRISTINE_ABSPATH, as returned by
+   svn_wc__db_pristine_get_future_path().  Decompress the file if
+   COMPRESSED is TRUE.  This does not access the database, so callers
+   must know that the text is in the store.
+
+   Allocate the stream in RESULT_POOL. */
+svn_error_t *
+svn_wc__db_pristine_open_file(svn_stream_t **contents,
+                              const char *pristine_abspath,
+                              svn_boolean_t compressed,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool);
+
+/* Set *CONTENTS to a readable stream that yields the pristine text
+   identified by SHA1_CHECKSUM from the shared pristine store configured
+   for DB, i.e. from any working copy on this machine that uses the same
+   store.  Set *CONTENTS to NULL if there is no shared store or the text
+   is not in it.
+
+   Installing a text into a working copy hard links it to the shared
+   copy, if there is one.
+
+   Allocate the stream in RESULT_POOL. */
+svn_error_t *
+svn_wc__db_pristine_read_shared(svn_stream_t **contents,
+                                svn_wc__db_t *db,
+                                const svn_checksum_t *sha1_checksum,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool);
+
 
 /* If requested set *CONTENTS to a readable stream that will yield the pristine
    text identified by SHA1_CHECKSUM (must be a SHA-1 checksum) within the WC
@@ -2006,6 +2051,9 @@ struct svn_wc__db_info_t {
   svn_boolean_t op_root;
 
   svn_boolean_t has_checksum;
+  /* The pristine checksum of a file.  Only provided by
+     svn_wc__db_read_children_info() and friends, NULL otherwise. */
+  const svn_checksum_t *checksum;
   svn_boolean_t copied;
   svn_boolean_t had_props;
   svn_boolean_t props_mod;
@@ -2047,6 +2095,38 @@ svn_wc__db_read_children_info(apr_hash_t **nodes,
                               apr_pool_t *result_pool,
                               apr_pool_t *scratch_pool);
 
+/* The children of a single directory as returned by
+   svn_wc__db_read_subtree_children_info. */
+typedef struct svn_wc__db_children_info_t
+{
+  /* Maps names to struct svn_wc__db_info_t *. */
+  apr_hash_t *nodes;
+
+  /* The names in NODES that are in conflict. */
+  apr_hash_t *conflicts;
+} svn_wc__db_children_info_t;
+
+/* Like svn_wc__db_read_children_info, but for DIR_ABSPATH and all of its
+   versioned descendant directories at once.  This replaces a couple of
+   queries per directory with a few queries for the whole subtree.
+
+   Set *DIRS to a hash mapping the relpath of each directory within
+   DIR_ABSPATH to a svn_wc__db_children_info_t.  DIR_ABSPATH itself
+   maps to "".  Directories without any children have no entry.
+
+   The subtree must fit into memory, so if it has more than MAX_NODES
+   rows in the NODES table, set *DIRS to NULL and don't read anything.
+   The caller should fall back to svn_wc__db_read_children_info then.
+ */
+svn_error_t *
+svn_wc__db_read_subtree_children_info(apr_hash_t **dirs,
+                                      svn_wc__db_t *db,
+                                      const char *dir_abspath,
+                                      svn_boolean_t base_tree_only,
+                                      int max_nodes,
+                                      apr_pool_t *result_pool,
+                                      apr_pool_t *scratch_pool);
+
 /* Like svn_wc__db_read_children_info, but only gets an info node for the root
    element.
 
@@ -2662,6 +2742,45 @@ svn_wc__db_global_record_fileinfo(svn_wc__db_t *db,
                                   apr_time_t recorded_time,
                                   apr_pool_t *scratch_pool);
 
+/* Like svn_wc__db_global_record_fileinfo(), but for all files in
+   RECORD_MAP, a hash mapping const char *local_abspath to the
+   svn_io_dirent2_t * to record, in a single transaction.  Paths not in
+   the working copy containing WRI_ABSPATH are ignored. */
+svn_error_t *
+svn_wc__db_global_record_fileinfo_many(svn_wc__db_t *db,
+                                       const char *wri_abspath,
+                                       apr_hash_t *record_map,
+                                       apr_pool_t *scratch_pool);
+
+/* Set *HASH to the hash of the working file LOCAL_ABSPATH that was
+   recorded by svn_wc__db_store_text_hash(), allocated in RESULT_POOL.
+   Set *HASH to NULL if there is none.
+
+   Set *ENABLED to whether DB caches such hashes at all.  If not, or if
+   the cache can't be read, this is not an error.  */
+svn_error_t *
+svn_wc__db_read_text_hash(svn_boolean_t *enabled,
+                          const svn_checksum_t **hash,
+                          svn_wc__db_t *db,
+                          const char *local_abspath,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Record HASH as the hash of the working file LOCAL_ABSPATH, which has
+   been found to be unmodified relative to the pristine text identified
+   by PRISTINE_CHECKSUM.  The hash is forgotten as soon as the node's
+   pristine text or properties change.
+
+   Do nothing if DB doesn't cache hashes or if the node's pristine text
+   is no longer PRISTINE_CHECKSUM.  The cache is an optimization only, so
+   failing to update it is not an error.  */
+svn_error_t *
+svn_wc__db_store_text_hash(svn_wc__db_t *db,
+                           const char *local_abspath,
+                           const svn_checksum_t *pristine_checksum,
+                           const svn_checksum_t *hash,
+                           apr_pool_t *scratch_pool);
+
 
 /* ### post-commit handling.
    ### maybe multiple phases?
@@ -3028,6 +3147,33 @@ svn_wc__db_wq_record_and_fetch_next(apr_uint64_t *id,
                                     apr_pool_t *result_pool,
                                     apr_pool_t *scratch_pool);
 
+/* Look ahead in the work queue: return the identifiers (apr_uint64_t) and
+   data (svn_skel_t *) of up to MAX_ITEMS work items, starting with item
+   FIRST_ID, in queue order in *IDS and *WORK_ITEMS.  Nothing gets marked
+   as completed.
+
+   RESULT_POOL will be used to allocate the results, and SCRATCH_POOL
+   will be used for all temporary allocations.  */
+svn_error_t *
+svn_wc__db_wq_fetch_items(apr_array_header_t **ids,
+                          apr_array_header_t **work_items,
+                          svn_wc__db_t *db,
+                          const char *wri_abspath,
+                          apr_uint64_t first_id,
+                          int max_items,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool);
+
+/* Mark the work items COMPLETED_IDS (apr_uint64_t) as completed and record
+   the timestamps and sizes in RECORD_MAP (may be NULL) in a single
+   transaction.  */
+svn_error_t *
+svn_wc__db_wq_record_and_complete(svn_wc__db_t *db,
+                                  const char *wri_abspath,
+                                  const apr_array_header_t *completed_ids,
+                                  apr_hash_t *record_map,
+                                  apr_pool_t *scratch_pool);
+
 
 /* @} */
 
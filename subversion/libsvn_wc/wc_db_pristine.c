@@ -28,10 +28,12 @@
 #include "svn_pools.h"
 #include "svn_io.h"
 #include "svn_dirent_uri.h"
+#include "svn_path.h"
 
 #include "private/svn_io_private.h"
 
 #include "wc.h"
+#include "adm_files.h"
 #include "wc_db.h"
 #include "wc-queries.h"
 #include "wc_db_private.h"
@@ -40,8 +42,24 @@
 #define PRISTINE_STORAGE_RELPATH "pristine"
 #define PRISTINE_TEMPDIR_RELPATH "tmp"
 
+/* Value of the PRISTINE.compression column for pristine files that
+   hold LZ4 compressed blocks as written by svn_stream__lz4_compressed(). */
+#define PRISTINE_COMPRESSION_LZ4 1
 
 
+
+/* Return the absolute path to the temporary directory for pristine text
+   files within WCROOT. */
+static char *
+pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
+{
+  return svn_dirent_join_many(result_pool, wcroot->abspath,
+                              svn_wc_get_adm_dir(scratch_pool),
+                              PRISTINE_TEMPDIR_RELPATH, SVN_VA_NULL);
+}
+
 /* Returns in PRISTINE_ABSPATH a new string allocated from RESULT_POOL,
    holding the local absolute path to the file location that is dedicated
    to hold CHECKSUM's pristine file, relating to the pristine store
@@ -92,6 +110,95 @@ get_pristine_fname(const char **pristine_abspath,
   return SVN_NO_ERROR;
 }
 
+/* Set *COMPRESSED according to the PRISTINE.compression value in COLUMN
+   of STMT, the row of the pristine text SHA1_CHECKSUM.  Return an error
+   for compression types that we don't know. */
+static svn_error_t *
+column_compressed(svn_boolean_t *compressed,
+                  svn_sqlite__stmt_t *stmt,
+                  int column,
+                  const svn_checksum_t *sha1_checksum,
+                  apr_pool_t *scratch_pool)
+{
+  if (svn_sqlite__column_is_null(stmt, column))
+    *compressed = FALSE;
+  else if (svn_sqlite__column_int(stmt, column) == PRISTINE_COMPRESSION_LZ4)
+    *compressed = TRUE;
+  else
+    return svn_error_createf(SVN_ERR_WC_CORRUPT_TEXT_BASE, NULL,
+                             _("Pristine text '%s' uses an unsupported "
+                               "compression type"),
+                             svn_checksum_to_cstring_display(sha1_checksum,
+                                                             scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *COMPRESSED to whether the pristine text SHA1_CHECKSUM is stored
+   compressed in the pristine store of WCROOT.  Set *PRESENT to whether
+   there is a row for it in the PRISTINE table, if PRESENT is not NULL.
+   If PRESENT is NULL, return an error for texts that are not present. */
+static svn_error_t *
+get_pristine_compression(svn_boolean_t *compressed,
+                         svn_boolean_t *present,
+                         svn_wc__db_wcroot_t *wcroot,
+                         const svn_checksum_t *sha1_checksum,
+                         apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, wcroot->sdb,
+                                    STMT_SELECT_PRISTINE_SIZE));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+
+  *compressed = FALSE;
+  if (have_row)
+    SVN_ERR(svn_error_compose_create(
+              column_compressed(compressed, stmt, 1, sha1_checksum,
+                                scratch_pool),
+              svn_sqlite__reset(stmt)));
+  else
+    SVN_ERR(svn_sqlite__reset(stmt));
+
+  if (present)
+    *present = have_row;
+  else if (! have_row)
+    return svn_error_createf(SVN_ERR_WC_PATH_NOT_FOUND, NULL,
+                             _("Pristine text '%s' not present"),
+                             svn_checksum_to_cstring_display(
+                               sha1_checksum, scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_pristine_open_file(svn_stream_t **contents,
+                              const char *pristine_abspath,
+                              svn_boolean_t compressed,
+                              apr_pool_t *result_pool,
+                              apr_pool_t *scratch_pool)
+{
+  apr_file_t *file;
+
+  /* Open the file as a readable stream.  It will remain readable even when
+   * deleted from disk; APR guarantees that on Windows as well as Unix.
+   *
+   * We also don't enable APR_BUFFERED on this file to maximize throughput
+   * e.g. for fulltext comparison.  As we use SVN__STREAM_CHUNK_SIZE buffers
+   * where needed in streams, there is no point in having another layer of
+   * buffers. */
+  SVN_ERR(svn_io_file_open(&file, pristine_abspath, APR_READ,
+                           APR_OS_DEFAULT, result_pool));
+  *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
+
+  if (compressed)
+    *contents = svn_stream__lz4_compressed(*contents, result_pool);
+
+  return SVN_NO_ERROR;
+}
+
 
 svn_error_t *
 svn_wc__db_pristine_get_path(const char **pristine_abspath,
@@ -104,6 +211,7 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
   svn_wc__db_wcroot_t *wcroot;
   const char *local_relpath;
   svn_boolean_t present;
+  svn_boolean_t compressed;
 
   SVN_ERR_ASSERT(pristine_abspath != NULL);
   SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
@@ -134,6 +242,28 @@ svn_wc__db_pristine_get_path(const char **pristine_abspath,
                              sha1_checksum,
                              result_pool, scratch_pool));
 
+  SVN_ERR(get_pristine_compression(&compressed, NULL, wcroot, sha1_checksum,
+                                   scratch_pool));
+  if (compressed)
+    {
+      svn_stream_t *contents;
+      svn_stream_t *uncompressed;
+
+      /* Callers want to read the file itself.  Give them a decompressed
+         copy that goes away together with RESULT_POOL. */
+      SVN_ERR(svn_wc__db_pristine_open_file(&contents, *pristine_abspath,
+                                            TRUE, scratch_pool,
+                                            scratch_pool));
+      SVN_ERR(svn_stream_open_unique(&uncompressed, pristine_abspath,
+                                     pristine_get_tempdir(wcroot,
+                                                          scratch_pool,
+                                                          scratch_pool),
+                                     svn_io_file_del_on_pool_cleanup,
+                                     result_pool, scratch_pool));
+      SVN_ERR(svn_stream_copy3(contents, uncompressed, NULL, NULL,
+                               scratch_pool));
+    }
+
   return SVN_NO_ERROR;
 }
 
@@ -150,6 +280,29 @@ svn_wc__db_pristine_get_future_path(const char **pristine_abspath,
   return SVN_NO_ERROR;
 }
 
+svn_error_t *
+svn_wc__db_pristine_get_compressed(svn_boolean_t *compressed,
+                                   svn_wc__db_t *db,
+                                   const char *wri_abspath,
+                                   const svn_checksum_t *sha1_checksum,
+                                   apr_pool_t *scratch_pool)
+{
+  svn_wc__db_wcroot_t *wcroot;
+  const char *local_relpath;
+  svn_boolean_t present;
+
+  SVN_ERR_ASSERT(svn_dirent_is_absolute(wri_abspath));
+  SVN_ERR_ASSERT(sha1_checksum->kind == svn_checksum_sha1);
+
+  SVN_ERR(svn_wc__db_wcroot_parse_local_abspath(&wcroot, &local_relpath, db,
+                              wri_abspath, scratch_pool, scratch_pool));
+  VERIFY_USABLE_WCROOT(wcroot);
+
+  return svn_error_trace(get_pristine_compression(compressed, &present,
+                                                  wcroot, sha1_checksum,
+                                                  scratch_pool));
+}
+
 /* Set *CONTENTS to a readable stream from which the pristine text
  * identified by SHA1_CHECKSUM and PRISTINE_ABSPATH can be read from the
  * pristine store of WCROOT.  If SIZE is not null, set *SIZE to the size
@@ -176,6 +329,7 @@ pristine_read_txn(svn_stream_t **contents,
 {
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+  svn_boolean_t compressed = FALSE;
 
   /* Check that this pristine text is present in the store.  (The presence
    * of the file is not sufficient.) */
@@ -187,7 +341,14 @@ pristine_read_txn(svn_stream_t **contents,
   if (size)
     *size = svn_sqlite__column_int64(stmt, 0);
 
-  SVN_ERR(svn_sqlite__reset(stmt));
+  if (have_row)
+    SVN_ERR(svn_error_compose_create(
+              column_compressed(&compressed, stmt, 1, sha1_checksum,
+                                scratch_pool),
+              svn_sqlite__reset(stmt)));
+  else
+    SVN_ERR(svn_sqlite__reset(stmt));
+
   if (! have_row)
     {
       return svn_error_createf(SVN_ERR_WC_PATH_NOT_FOUND, NULL,
@@ -196,20 +357,11 @@ pristine_read_txn(svn_stream_t **contents,
                                  sha1_checksum, scratch_pool));
     }
 
-  /* Open the file as a readable stream.  It will remain readable even when
-   * deleted from disk; APR guarantees that on Windows as well as Unix.
-   *
-   * We also don't enable APR_BUFFERED on this file to maximize throughput
-   * e.g. for fulltext comparison.  As we use SVN__STREAM_CHUNK_SIZE buffers
-   * where needed in streams, there is no point in having another layer of
-   * buffers. */
+  /* Compressed pristines get decompressed while they are being read. */
   if (contents)
-    {
-      apr_file_t *file;
-      SVN_ERR(svn_io_file_open(&file, pristine_abspath, APR_READ,
-                               APR_OS_DEFAULT, result_pool));
-      *contents = svn_stream_from_aprfile2(file, FALSE, result_pool);
-    }
+    SVN_ERR(svn_wc__db_pristine_open_file(contents, pristine_abspath,
+                                          compressed, result_pool,
+                                          scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -256,18 +408,451 @@ svn_wc__db_pristine_read(svn_stream_t **contents,
 }
 
 
-/* Return the absolute path to the temporary directory for pristine text
-   files within WCROOT. */
-static char *
-pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
-                     apr_pool_t *result_pool,
+
+/* Shared pristine store
+ *
+ * A shared pristine store is a directory with a database of its own and
+ * the pristine files of many working copies, laid out like the pristine
+ * store of a single working copy.  The files are hard links to the files
+ * in the stores of the working copies that use them, so they take disk
+ * space only once.  Working copies still have all their pristine texts
+ * in their own stores; the shared store is only used to find texts that
+ * another working copy already has.
+ */
+
+#define SHARED_PRISTINE_SDB_FNAME "pristine.db"
+
+WC_QUERIES_SQL_DECLARE_STATEMENTS(shared_statements);
+
+/* Set *SDB to the database of the shared pristine store configured in DB,
+   opening or creating it on first use.  Set *SDB to NULL if DB does not
+   use a shared pristine store.  If the database can't be opened, stop
+   using the shared store for DB and return the error. */
+static svn_error_t *
+get_shared_sdb(svn_sqlite__db_t **sdb,
+               svn_wc__db_t *db,
+               apr_pool_t *scratch_pool)
+{
+  if (db->shared_pristine_abspath && !db->shared_pristine_sdb)
+    {
+      svn_sqlite__db_t *shared_sdb;
+      svn_error_t *err;
+
+      err = svn_io_make_dir_recursively(db->shared_pristine_abspath,
+                                        scratch_pool);
+      if (!err)
+        err = svn_sqlite__open(&shared_sdb,
+                               svn_dirent_join(db->shared_pristine_abspath,
+                                               SHARED_PRISTINE_SDB_FNAME,
+                                               scratch_pool),
+                               svn_sqlite__mode_rwcreate, shared_statements,
+                               0, NULL, db->timeout,
+                               db->state_pool, scratch_pool);
+      if (!err)
+        err = svn_sqlite__exec_statements(shared_sdb,
+                                          STMT_CREATE_SHARED_PRISTINE_SCHEMA);
+      if (err)
+        {
+          db->shared_pristine_abspath = NULL;
+          return svn_error_trace(err);
+        }
+
+      db->shared_pristine_sdb = shared_sdb;
+    }
+
+  *sdb = db->shared_pristine_sdb;
+  return SVN_NO_ERROR;
+}
+
+/* Set *SHARED_ABSPATH to the path of the file of pristine text
+   SHA1_CHECKSUM in the shared pristine store of DB. */
+static svn_error_t *
+get_shared_pristine_fname(const char **shared_abspath,
+                          svn_wc__db_t *db,
+                          const svn_checksum_t *sha1_checksum,
+                          apr_pool_t *result_pool,
+                          apr_pool_t *scratch_pool)
+{
+  const char *hexdigest = svn_checksum_to_cstring(sha1_checksum,
+                                                  scratch_pool);
+
+  *shared_abspath = svn_dirent_join_many(result_pool,
+                                         db->shared_pristine_abspath,
+                                         apr_pstrmemdup(scratch_pool,
+                                                        hexdigest, 2),
+                                         apr_pstrcat(scratch_pool, hexdigest,
+                                                     PRISTINE_STORAGE_EXT,
+                                                     SVN_VA_NULL),
+                                         SVN_VA_NULL);
+  return SVN_NO_ERROR;
+}
+
+/* Create TO_ABSPATH as a hard link to the file FROM_ABSPATH. */
+static svn_error_t *
+link_pristine_file(const char *from_abspath,
+                   const char *to_abspath,
+                   apr_pool_t *scratch_pool)
+{
+  const char *from_apr, *to_apr;
+  apr_status_t status;
+
+  SVN_ERR(svn_path_cstring_from_utf8(&from_apr, from_abspath, scratch_pool));
+  SVN_ERR(svn_path_cstring_from_utf8(&to_apr, to_abspath, scratch_pool));
+
+  status = apr_file_link(from_apr, to_apr);
+  if (status)
+    return svn_error_wrap_apr(status, _("Can't link '%s' to '%s'"),
+                              svn_dirent_local_style(to_abspath,
+                                                     scratch_pool),
+                              svn_dirent_local_style(from_abspath,
+                                                     scratch_pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Share the pristine text SHA1_CHECKSUM of WCROOT, stored in the file
+   PRISTINE_ABSPATH, through the shared pristine store with database SDB
+   of DB.  If the shared store has the text already, replace the file of
+   WCROOT with a link to the shared file.  Otherwise, add a link to the
+   file of WCROOT to the shared store.  MD5_CHECKSUM, SIZE and COMPRESSED
+   describe the text as in the PRISTINE table.
+
+   This function expects to be executed inside a SQLite txn on SDB that
+   has already acquired a 'RESERVED' lock. */
+static svn_error_t *
+share_pristine_txn(svn_wc__db_t *db,
+                   svn_sqlite__db_t *sdb,
+                   svn_wc__db_wcroot_t *wcroot,
+                   const char *pristine_abspath,
+                   const svn_checksum_t *sha1_checksum,
+                   const svn_checksum_t *md5_checksum,
+                   svn_filesize_t size,
+                   svn_boolean_t compressed,
+                   apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_boolean_t shared_compressed = FALSE;
+  const char *shared_abspath;
+
+  SVN_ERR(get_shared_pristine_fname(&shared_abspath, db, sha1_checksum,
+                                    scratch_pool, scratch_pool));
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_SHARED_PRISTINE));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  if (have_row)
+    SVN_ERR(svn_error_compose_create(
+              column_compressed(&shared_compressed, stmt, 0, sha1_checksum,
+                                scratch_pool),
+              svn_sqlite__reset(stmt)));
+  else
+    SVN_ERR(svn_sqlite__reset(stmt));
+
+  if (have_row)
+    {
+      const char *tmp_abspath;
+      svn_error_t *err;
+
+      /* Our file would read differently, so keep it. */
+      if (shared_compressed != compressed)
+        return SVN_NO_ERROR;
+
+      /* Link next to our file and move the link into place, so that our
+         store never lacks the file. */
+      SVN_ERR(svn_io_open_unique_file3(NULL, &tmp_abspath,
+                                       pristine_get_tempdir(wcroot,
+                                                            scratch_pool,
+                                                            scratch_pool),
+                                       svn_io_file_del_none,
+                                       scratch_pool, scratch_pool));
+      SVN_ERR(svn_io_remove_file2(tmp_abspath, FALSE, scratch_pool));
+      SVN_ERR(link_pristine_file(shared_abspath, tmp_abspath, scratch_pool));
+      err = svn_io_file_rename2(tmp_abspath, pristine_abspath, FALSE,
+                                scratch_pool);
+      if (err)
+        return svn_error_compose_create(
+                 err, svn_io_remove_file2(tmp_abspath, TRUE, scratch_pool));
+    }
+  else
+    {
+      /* A file without a row was left behind by an interrupted operation. */
+      SVN_ERR(svn_io_make_dir_recursively(svn_dirent_dirname(shared_abspath,
+                                                             scratch_pool),
+                                          scratch_pool));
+      SVN_ERR(svn_io_remove_file2(shared_abspath, TRUE, scratch_pool));
+      SVN_ERR(link_pristine_file(pristine_abspath, shared_abspath,
+                                 scratch_pool));
+
+      SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                        STMT_INSERT_SHARED_PRISTINE));
+      SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum,
+                                        scratch_pool));
+      SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum,
+                                        scratch_pool));
+      SVN_ERR(svn_sqlite__bind_int64(stmt, 3, size));
+      if (compressed)
+        SVN_ERR(svn_sqlite__bind_int(stmt, 4, PRISTINE_COMPRESSION_LZ4));
+      SVN_ERR(svn_sqlite__insert(NULL, stmt));
+    }
+
+  SVN_ERR(svn_sqlite__get_statement(
+            &stmt, sdb, STMT_INSERT_OR_IGNORE_SHARED_PRISTINE_USER));
+  SVN_ERR(svn_sqlite__bindf(stmt, "s", wcroot->abspath));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__insert(NULL, stmt));
+
+  return SVN_NO_ERROR;
+}
+
+/* Share the newly installed pristine text SHA1_CHECKSUM of WCROOT through
+   the shared pristine store of DB, if there is one.  See
+   share_pristine_txn() for the other arguments. */
+static svn_error_t *
+share_pristine(svn_wc__db_t *db,
+               svn_wc__db_wcroot_t *wcroot,
+               const char *pristine_abspath,
+               const svn_checksum_t *sha1_checksum,
+               const svn_checksum_t *md5_checksum,
+               svn_filesize_t size,
+               svn_boolean_t compressed,
+               apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+
+  SVN_ERR(get_shared_sdb(&sdb, db, scratch_pool));
+  if (!sdb)
+    return SVN_NO_ERROR;
+
+  SVN_SQLITE__WITH_IMMEDIATE_TXN(
+    share_pristine_txn(db, sdb, wcroot, pristine_abspath,
+                       sha1_checksum, md5_checksum, size, compressed,
+                       scratch_pool),
+    sdb);
+
+  return SVN_NO_ERROR;
+}
+
+/* Remove the pristine text SHA1_CHECKSUM from the shared pristine store
+   of SDB, if it is no longer in use.
+
+   This function expects to be executed inside a SQLite txn on SDB that
+   has already acquired a 'RESERVED' lock. */
+static svn_error_t *
+remove_shared_pristine_if_unreferenced_txn(svn_wc__db_t *db,
+                                           svn_sqlite__db_t *sdb,
+                                           const svn_checksum_t *sha1_checksum,
+                                           apr_pool_t *scratch_pool)
+{
+  svn_sqlite__stmt_t *stmt;
+  int affected_rows;
+
+  SVN_ERR(svn_sqlite__get_statement(
+            &stmt, sdb, STMT_DELETE_SHARED_PRISTINE_IF_UNREFERENCED));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__update(&affected_rows, stmt));
+
+  if (affected_rows > 0)
+    {
+      const char *shared_abspath;
+
+      SVN_ERR(get_shared_pristine_fname(&shared_abspath, db, sha1_checksum,
+                                        scratch_pool, scratch_pool));
+      SVN_ERR(svn_io_remove_file2(shared_abspath, TRUE, scratch_pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Like remove_shared_pristine_if_unreferenced_txn() but first drop the
+   reference of WCROOT to the text.
+
+   This function expects to be executed inside a SQLite txn on SDB that
+   has already acquired a 'RESERVED' lock. */
+static svn_error_t *
+unshare_pristine_txn(svn_wc__db_t *db,
+                     svn_sqlite__db_t *sdb,
+                     svn_wc__db_wcroot_t *wcroot,
+                     const svn_checksum_t *sha1_checksum,
                      apr_pool_t *scratch_pool)
 {
-  return svn_dirent_join_many(result_pool, wcroot->abspath,
-                              svn_wc_get_adm_dir(scratch_pool),
-                              PRISTINE_TEMPDIR_RELPATH, SVN_VA_NULL);
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    STMT_DELETE_SHARED_PRISTINE_USER));
+  SVN_ERR(svn_sqlite__bindf(stmt, "s", wcroot->abspath));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__step_done(stmt));
+
+  return svn_error_trace(
+           remove_shared_pristine_if_unreferenced_txn(db, sdb, sha1_checksum,
+                                                      scratch_pool));
+}
+
+/* Drop the reference of WCROOT to the pristine text SHA1_CHECKSUM in the
+   shared pristine store of DB, if there is one, and remove the text from
+   there if no other working copy uses it. */
+static svn_error_t *
+unshare_pristine(svn_wc__db_t *db,
+                 svn_wc__db_wcroot_t *wcroot,
+                 const svn_checksum_t *sha1_checksum,
+                 apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+
+  SVN_ERR(get_shared_sdb(&sdb, db, scratch_pool));
+  if (!sdb)
+    return SVN_NO_ERROR;
+
+  SVN_SQLITE__WITH_IMMEDIATE_TXN(
+    unshare_pristine_txn(db, sdb, wcroot, sha1_checksum, scratch_pool),
+    sdb);
+
+  return SVN_NO_ERROR;
 }
 
+/* Drop all references of working copies that no longer exist from the
+   shared pristine store of DB, if there is one.  Then remove all texts
+   from there that no working copy uses. */
+static svn_error_t *
+shared_pristine_cleanup(svn_wc__db_t *db,
+                        apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  apr_array_header_t *items;
+  apr_pool_t *iterpool;
+  int i;
+
+  SVN_ERR(get_shared_sdb(&sdb, db, scratch_pool));
+  if (!sdb)
+    return SVN_NO_ERROR;
+
+  iterpool = svn_pool_create(scratch_pool);
+
+  /* Find working copies that are gone. */
+  items = apr_array_make(scratch_pool, 0, sizeof(const char *));
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    STMT_SELECT_SHARED_PRISTINE_WCROOTS));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      const char *wcroot_abspath = svn_sqlite__column_text(stmt, 0,
+                                                           scratch_pool);
+      svn_node_kind_t kind;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+      err = svn_io_check_path(svn_wc__adm_child(wcroot_abspath, "wc.db",
+                                                iterpool),
+                              &kind, iterpool);
+      if (err)
+        return svn_error_compose_create(err, svn_sqlite__reset(stmt));
+
+      if (kind == svn_node_none)
+        APR_ARRAY_PUSH(items, const char *) = wcroot_abspath;
+
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  for (i = 0; i < items->nelts; i++)
+    {
+      SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                        STMT_DELETE_SHARED_PRISTINE_WCROOT));
+      SVN_ERR(svn_sqlite__bindf(stmt, "s",
+                                APR_ARRAY_IDX(items, i, const char *)));
+      SVN_ERR(svn_sqlite__step_done(stmt));
+    }
+
+  /* Remove what is unused now. */
+  items = apr_array_make(scratch_pool, 0, sizeof(const svn_checksum_t *));
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb,
+                                    STMT_SELECT_UNREFERENCED_SHARED_PRISTINES));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  while (have_row)
+    {
+      const svn_checksum_t *sha1_checksum;
+      svn_error_t *err;
+
+      err = svn_sqlite__column_checksum(&sha1_checksum, stmt, 0,
+                                        scratch_pool);
+      if (err)
+        return svn_error_compose_create(err, svn_sqlite__reset(stmt));
+
+      APR_ARRAY_PUSH(items, const svn_checksum_t *) = sha1_checksum;
+      SVN_ERR(svn_sqlite__step(&have_row, stmt));
+    }
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  for (i = 0; i < items->nelts; i++)
+    {
+      svn_pool_clear(iterpool);
+      SVN_SQLITE__WITH_IMMEDIATE_TXN(
+        remove_shared_pristine_if_unreferenced_txn(
+          db, sdb, APR_ARRAY_IDX(items, i, const svn_checksum_t *),
+          iterpool),
+        sdb);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svn_wc__db_pristine_read_shared(svn_stream_t **contents,
+                                svn_wc__db_t *db,
+                                const svn_checksum_t *sha1_checksum,
+                                apr_pool_t *result_pool,
+                                apr_pool_t *scratch_pool)
+{
+  svn_sqlite__db_t *sdb;
+  svn_sqlite__stmt_t *stmt;
+  svn_boolean_t have_row;
+  svn_boolean_t compressed = FALSE;
+  const char *shared_abspath;
+  svn_error_t *err;
+
+  *contents = NULL;
+  if (sha1_checksum->kind != svn_checksum_sha1)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_shared_sdb(&sdb, db, scratch_pool));
+  if (!sdb)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_SHARED_PRISTINE));
+  SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
+  SVN_ERR(svn_sqlite__step(&have_row, stmt));
+  if (have_row)
+    SVN_ERR(svn_error_compose_create(
+              column_compressed(&compressed, stmt, 0, sha1_checksum,
+                                scratch_pool),
+              svn_sqlite__reset(stmt)));
+  else
+    SVN_ERR(svn_sqlite__reset(stmt));
+
+  if (!have_row)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(get_shared_pristine_fname(&shared_abspath, db, sha1_checksum,
+                                    scratch_pool, scratch_pool));
+
+  /* The last user may have removed it just now. */
+  err = svn_wc__db_pristine_open_file(contents, shared_abspath, compressed,
+                                      result_pool, scratch_pool);
+  if (err && APR_STATUS_IS_ENOENT(err->apr_err))
+    {
+      svn_error_clear(err);
+      *contents = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  return svn_error_trace(err);
+}
+
+
 /* Install the pristine text described by BATON into the pristine store of
  * SDB.  If it is already stored then just delete the new file
  * BATON->tempfile_abspath.
@@ -278,7 +863,11 @@ pristine_get_tempdir(svn_wc__db_wcroot_t *wcroot,
  * Implements 'notes/wc-ng/pristine-store' section A-3(a).
  */
 static svn_error_t *
-pristine_install_txn(svn_sqlite__db_t *sdb,
+pristine_install_txn(/* Set to whether the file was moved into the store,
+                        and if so, to the size of the text. */
+                     svn_boolean_t *installed,
+                     svn_filesize_t *installed_size,
+                     svn_sqlite__db_t *sdb,
                      /* The path to the source file that is to be moved into place. */
                      svn_stream_t *install_stream,
                      /* The target path for the file (within the pristine store). */
@@ -287,64 +876,77 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
                      const svn_checksum_t *sha1_checksum,
                      /* The pristine text's MD-5 checksum. */
                      const svn_checksum_t *md5_checksum,
+                     /* Whether INSTALL_STREAM holds compressed data. */
+                     svn_boolean_t compressed,
+                     /* The size of the text, if COMPRESSED. */
+                     svn_filesize_t text_size,
                      apr_pool_t *scratch_pool)
 {
   svn_sqlite__stmt_t *stmt;
   svn_boolean_t have_row;
+  apr_finfo_t finfo;
+
+  *installed = FALSE;
+  if (! compressed)
+    {
+      SVN_ERR(svn_stream__install_get_info(&finfo, install_stream,
+                                           APR_FINFO_SIZE, scratch_pool));
+      text_size = finfo.size;
+    }
 
   /* If this pristine text is already present in the store, just keep it:
    * delete the new one and return. */
-  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_PRISTINE));
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_SELECT_PRISTINE_SIZE));
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
   SVN_ERR(svn_sqlite__step(&have_row, stmt));
-  SVN_ERR(svn_sqlite__reset(stmt));
 
   if (have_row)
     {
 #ifdef SVN_DEBUG
-      /* Consistency checks.  Verify both files exist and match.
+      /* Consistency checks.  Verify both texts have the same size.  The
+       * existing one may be stored in a different format, so compare the
+       * recorded size.
        * ### We could check much more. */
-      {
-        apr_finfo_t finfo1, finfo2;
-
-        SVN_ERR(svn_stream__install_get_info(&finfo1, install_stream, APR_FINFO_SIZE,
-                                             scratch_pool));
-
-        SVN_ERR(svn_io_stat(&finfo2, pristine_abspath, APR_FINFO_SIZE,
-                            scratch_pool));
-        if (finfo1.size != finfo2.size)
-          {
-            return svn_error_createf(
-              SVN_ERR_WC_CORRUPT_TEXT_BASE, NULL,
-              _("New pristine text '%s' has different size: %s versus %s"),
-              svn_checksum_to_cstring_display(sha1_checksum, scratch_pool),
-              apr_off_t_toa(scratch_pool, finfo1.size),
-              apr_off_t_toa(scratch_pool, finfo2.size));
-          }
-      }
+      svn_filesize_t stored_size = svn_sqlite__column_int64(stmt, 0);
+
+      if (text_size != stored_size)
+        {
+          SVN_ERR(svn_sqlite__reset(stmt));
+          return svn_error_createf(
+            SVN_ERR_WC_CORRUPT_TEXT_BASE, NULL,
+            _("New pristine text '%s' has different size: "
+              "%" SVN_FILESIZE_T_FMT " versus %" SVN_FILESIZE_T_FMT),
+            svn_checksum_to_cstring_display(sha1_checksum, scratch_pool),
+            text_size, stored_size);
+        }
 #endif
 
+      SVN_ERR(svn_sqlite__reset(stmt));
+
       /* Remove the temp file: it's already there */
       SVN_ERR(svn_stream__install_delete(install_stream, scratch_pool));
       return SVN_NO_ERROR;
     }
 
+  SVN_ERR(svn_sqlite__reset(stmt));
+
   /* Move the file to its target location.  (If it is already there, it is
    * an orphan file and it doesn't matter if we overwrite it.) */
   {
-    apr_finfo_t finfo;
-    SVN_ERR(svn_stream__install_get_info(&finfo, install_stream,
-                                         APR_FINFO_SIZE, scratch_pool));
     SVN_ERR(svn_stream__install_stream(install_stream, pristine_abspath,
                                        TRUE, scratch_pool));
 
     SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, STMT_INSERT_PRISTINE));
     SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, sha1_checksum, scratch_pool));
     SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
-    SVN_ERR(svn_sqlite__bind_int64(stmt, 3, finfo.size));
+    SVN_ERR(svn_sqlite__bind_int64(stmt, 3, text_size));
+    if (compressed)
+      SVN_ERR(svn_sqlite__bind_int(stmt, 4, PRISTINE_COMPRESSION_LZ4));
     SVN_ERR(svn_sqlite__insert(NULL, stmt));
 
     SVN_ERR(svn_io_set_file_read_only(pristine_abspath, FALSE, scratch_pool));
+    *installed = TRUE;
+    *installed_size = text_size;
   }
 
   return SVN_NO_ERROR;
@@ -352,10 +954,43 @@ pristine_install_txn(svn_sqlite__db_t *sdb,
 
 struct svn_wc__db_install_data_t
 {
+  svn_wc__db_t *db;
   svn_wc__db_wcroot_t *wcroot;
   svn_stream_t *inner_stream;
+
+  /* Whether INNER_STREAM receives LZ4 compressed data, and if so, the
+     compressing stream wrapped around it.  */
+  svn_boolean_t compressed;
+  svn_stream_t *compressed_stream;
+
+  /* The number of bytes of text written so far, if COMPRESSED.  */
+  svn_filesize_t size;
 };
 
+/* Implements svn_write_fn_t, counting the bytes written to the install
+   stream of the svn_wc__db_install_data_t given as BATON.  */
+static svn_error_t *
+install_size_write(void *baton,
+                   const char *data,
+                   apr_size_t *len)
+{
+  svn_wc__db_install_data_t *install_data = baton;
+
+  SVN_ERR(svn_stream_write(install_data->compressed_stream, data, len));
+  install_data->size += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_close_fn_t for install_size_write().  */
+static svn_error_t *
+install_size_close(void *baton)
+{
+  svn_wc__db_install_data_t *install_data = baton;
+
+  return svn_error_trace(svn_stream_close(install_data->compressed_stream));
+}
+
 svn_error_t *
 svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
                                     svn_wc__db_install_data_t **install_data,
@@ -379,6 +1014,7 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
   temp_dir_abspath = pristine_get_tempdir(wcroot, scratch_pool, scratch_pool);
 
   *install_data = apr_pcalloc(result_pool, sizeof(**install_data));
+  (*install_data)->db = db;
   (*install_data)->wcroot = wcroot;
 
   SVN_ERR_W(svn_stream__create_for_install(stream,
@@ -388,6 +1024,17 @@ svn_wc__db_pristine_prepare_install(svn_stream_t **stream,
 
   (*install_data)->inner_stream = *stream;
 
+  if (db->compress_pristines)
+    {
+      (*install_data)->compressed = TRUE;
+      (*install_data)->compressed_stream
+        = svn_stream__lz4_compressed(*stream, result_pool);
+
+      *stream = svn_stream_create(*install_data, result_pool);
+      svn_stream_set_write(*stream, install_size_write);
+      svn_stream_set_close(*stream, install_size_close);
+    }
+
   if (md5_checksum)
     *stream = svn_stream_checksummed2(*stream, NULL, md5_checksum,
                                       svn_checksum_md5, FALSE, result_pool);
@@ -406,6 +1053,8 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
 {
   svn_wc__db_wcroot_t *wcroot = install_data->wcroot;
   const char *pristine_abspath;
+  svn_boolean_t installed;
+  svn_filesize_t size;
 
   SVN_ERR_ASSERT(sha1_checksum != NULL);
   SVN_ERR_ASSERT(sha1_checksum->kind == svn_checksum_sha1);
@@ -419,12 +1068,22 @@ svn_wc__db_pristine_install(svn_wc__db_install_data_t *install_data,
   /* Ensure the SQL txn has at least a 'RESERVED' lock before we start looking
    * at the disk, to ensure no concurrent pristine install/delete txn. */
   SVN_SQLITE__WITH_IMMEDIATE_TXN(
-    pristine_install_txn(wcroot->sdb,
+    pristine_install_txn(&installed, &size, wcroot->sdb,
                          install_data->inner_stream, pristine_abspath,
                          sha1_checksum, md5_checksum,
+                         install_data->compressed, install_data->size,
                          scratch_pool),
     wcroot->sdb);
 
+  /* Our store is complete without the shared one, so don't let the latter
+     fail the install. */
+  if (installed)
+    svn_error_clear(share_pristine(install_data->db, wcroot,
+                                   pristine_abspath, sha1_checksum,
+                                   md5_checksum, size,
+                                   install_data->compressed,
+                                   scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -514,13 +1173,15 @@ svn_wc__db_pristine_get_sha1(const svn_checksum_t **sha1_checksum,
 }
 
 /* Handle the moving of a pristine from SRC_WCROOT to DST_WCROOT. The existing
-   pristine in SRC_WCROOT is described by CHECKSUM, MD5_CHECKSUM and SIZE */
+   pristine in SRC_WCROOT is described by CHECKSUM, MD5_CHECKSUM, SIZE and
+   COMPRESSED.  The file is copied as it is stored. */
 static svn_error_t *
 maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
                             svn_wc__db_wcroot_t *dst_wcroot,
                             const svn_checksum_t *checksum,
                             const svn_checksum_t *md5_checksum,
                             apr_int64_t size,
+                            svn_boolean_t compressed,
                             svn_cancel_func_t cancel_func,
                             void *cancel_baton,
                             apr_pool_t *scratch_pool)
@@ -539,6 +1200,8 @@ maybe_transfer_one_pristine(svn_wc__db_wcroot_t *src_wcroot,
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 1, checksum, scratch_pool));
   SVN_ERR(svn_sqlite__bind_checksum(stmt, 2, md5_checksum, scratch_pool));
   SVN_ERR(svn_sqlite__bind_int64(stmt, 3, size));
+  if (compressed)
+    SVN_ERR(svn_sqlite__bind_int(stmt, 4, PRISTINE_COMPRESSION_LZ4));
 
   SVN_ERR(svn_sqlite__update(&affected_rows, stmt));
 
@@ -623,6 +1286,7 @@ pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
       const svn_checksum_t *checksum;
       const svn_checksum_t *md5_checksum;
       apr_int64_t size;
+      svn_boolean_t compressed;
       svn_error_t *err;
 
       svn_pool_clear(iterpool);
@@ -631,10 +1295,13 @@ pristine_transfer_txn(svn_wc__db_wcroot_t *src_wcroot,
       SVN_ERR(svn_sqlite__column_checksum(&md5_checksum, stmt, 1, iterpool));
       size = svn_sqlite__column_int64(stmt, 2);
 
-      err = maybe_transfer_one_pristine(src_wcroot, dst_wcroot,
-                                        checksum, md5_checksum, size,
-                                        cancel_func, cancel_baton,
-                                        iterpool);
+      err = column_compressed(&compressed, stmt, 3, checksum, iterpool);
+      if (! err)
+        err = maybe_transfer_one_pristine(src_wcroot, dst_wcroot,
+                                          checksum, md5_checksum, size,
+                                          compressed,
+                                          cancel_func, cancel_baton,
+                                          iterpool);
 
       if (err)
         return svn_error_trace(svn_error_compose_create(
@@ -695,7 +1362,8 @@ svn_wc__db_pristine_transfer(svn_wc__db_t *db,
  * acquired a 'RESERVED' lock.
  */
 static svn_error_t *
-pristine_remove_if_unreferenced_txn(svn_sqlite__db_t *sdb,
+pristine_remove_if_unreferenced_txn(svn_boolean_t *removed,
+                                    svn_sqlite__db_t *sdb,
                                     svn_wc__db_wcroot_t *wcroot,
                                     const svn_checksum_t *sha1_checksum,
                                     const char *pristine_abspath,
@@ -711,6 +1379,7 @@ pristine_remove_if_unreferenced_txn(svn_sqlite__db_t *sdb,
   SVN_ERR(svn_sqlite__update(&affected_rows, stmt));
 
   /* If we removed the DB row, then remove the file. */
+  *removed = (affected_rows > 0);
   if (affected_rows > 0)
     {
       /* If the file is not present, something has gone wrong, but at this
@@ -731,15 +1400,17 @@ pristine_remove_if_unreferenced_txn(svn_sqlite__db_t *sdb,
 
 /* If the pristine text referenced by SHA1_CHECKSUM in WCROOT has a
  * reference count of zero, delete it (both the database row and the disk
- * file).
+ * file).  Also drop it from the shared pristine store of DB.
  *
  * Implements 'notes/wc-ng/pristine-store' section A-3(b). */
 static svn_error_t *
-pristine_remove_if_unreferenced(svn_wc__db_wcroot_t *wcroot,
+pristine_remove_if_unreferenced(svn_wc__db_t *db,
+                                svn_wc__db_wcroot_t *wcroot,
                                 const svn_checksum_t *sha1_checksum,
                                 apr_pool_t *scratch_pool)
 {
   const char *pristine_abspath;
+  svn_boolean_t removed;
 
   SVN_ERR(get_pristine_fname(&pristine_abspath, wcroot->abspath,
                              sha1_checksum, scratch_pool, scratch_pool));
@@ -748,9 +1419,14 @@ pristine_remove_if_unreferenced(svn_wc__db_wcroot_t *wcroot,
    * at the disk, to ensure no concurrent pristine install/delete txn. */
   SVN_SQLITE__WITH_IMMEDIATE_TXN(
     pristine_remove_if_unreferenced_txn(
-      wcroot->sdb, wcroot, sha1_checksum, pristine_abspath, scratch_pool),
+      &removed, wcroot->sdb, wcroot, sha1_checksum, pristine_abspath,
+      scratch_pool),
     wcroot->sdb);
 
+  if (removed)
+    svn_error_clear(unshare_pristine(db, wcroot, sha1_checksum,
+                                     scratch_pool));
+
   return SVN_NO_ERROR;
 }
 
@@ -792,7 +1468,8 @@ svn_wc__db_pristine_remove(svn_wc__db_t *db,
   }
 
   /* If not referenced, remove the PRISTINE table row and the file. */
-  SVN_ERR(pristine_remove_if_unreferenced(wcroot, sha1_checksum, scratch_pool));
+  SVN_ERR(pristine_remove_if_unreferenced(db, wcroot, sha1_checksum,
+                                          scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -830,7 +1507,8 @@ svn_wc__db_pristine_remove(svn_wc__db_t *db,
  * TODO: Provide feedback about any errors found and any corrections made.
  */
 static svn_error_t *
-pristine_cleanup_wcroot(svn_wc__db_wcroot_t *wcroot,
+pristine_cleanup_wcroot(svn_wc__db_t *db,
+                        svn_wc__db_wcroot_t *wcroot,
                         apr_pool_t *scratch_pool)
 {
   svn_sqlite__stmt_t *stmt;
@@ -853,7 +1531,7 @@ pristine_cleanup_wcroot(svn_wc__db_wcroot_t *wcroot,
 
       SVN_ERR(svn_sqlite__column_checksum(&sha1_checksum, stmt, 0,
                                           iterpool));
-      err = pristine_remove_if_unreferenced(wcroot, sha1_checksum,
+      err = pristine_remove_if_unreferenced(db, wcroot, sha1_checksum,
                                             iterpool);
     }
 
@@ -877,7 +1555,8 @@ svn_wc__db_pristine_cleanup(svn_wc__db_t *db,
                               wri_abspath, scratch_pool, scratch_pool));
   VERIFY_USABLE_WCROOT(wcroot);
 
-  SVN_ERR(pristine_cleanup_wcroot(wcroot, scratch_pool));
+  SVN_ERR(pristine_cleanup_wcroot(db, wcroot, scratch_pool));
+  SVN_ERR(shared_pristine_cleanup(db, scratch_pool));
 
   return SVN_NO_ERROR;
 }
@@ -52,6 +52,32 @@ struct svn_wc__db_t {
   /* Busy timeout in ms., 0 for the libsvn_subr default. */
   apr_int32_t timeout;
 
+  /* Should new pristine texts be stored compressed? */
+  svn_boolean_t compress_pristines;
+
+  /* The directory of the shared pristine store, or NULL if none is used.
+     Its database gets opened on first use.  */
+  const char *shared_pristine_abspath;
+  svn_sqlite__db_t *shared_pristine_sdb;
+
+  /* Should hashes of unmodified working files be cached? */
+  svn_boolean_t cache_text_hashes;
+
+  /* Maximum number of wcroots to keep open, 0 for no limit.  Beyond that,
+     the least recently used ones get closed.  */
+  int max_wcroots;
+
+  /* Page cache size of each wcroot's database in KiB, 0 for the SQLite
+     default.  */
+  int sqlite_cache_size;
+
+  /* Should databases use the SQLite settings for local disks, i.e.
+     write-ahead logging and memory mapping?  */
+  svn_boolean_t sqlite_local_disk;
+
+  /* Incremented whenever a wcroot gets used; see wcroot->last_used.  */
+  apr_uint64_t wcroot_clock;
+
   /* Map a given working copy directory to its relevant data.
      const char *local_abspath -> svn_wc__db_wcroot_t *wcroot  */
   apr_hash_t *dir_data;
@@ -107,6 +133,19 @@ typedef struct svn_wc__db_wcroot_t {
      const char *local_abspath -> svn_wc_adm_access_t *adm_access */
   apr_hash_t *access_cache;
 
+  /* Has the TEXT_HASH table been created in SDB, as far as we know?  */
+  svn_boolean_t text_hash_schema;
+
+  /* The pool this structure and SDB live in.  If that is not the
+     state_pool of the owning svn_wc__db_t, it is dedicated to this
+     wcroot and gets destroyed when the wcroot is closed for being
+     least recently used.  */
+  apr_pool_t *pool;
+
+  /* The owning svn_wc__db_t's wcroot_clock when this wcroot was used
+     last.  */
+  apr_uint64_t last_used;
+
 } svn_wc__db_wcroot_t;
 
 
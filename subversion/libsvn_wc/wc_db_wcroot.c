@@ -31,6 +31,8 @@
 #include "svn_pools.h"
 #include "svn_version.h"
 
+#include "private/svn_subr_private.h"
+
 #include "wc.h"
 #include "adm_files.h"
 #include "wc_db_private.h"
@@ -43,6 +45,11 @@
 #define UNKNOWN_WC_ID ((apr_int64_t) -1)
 #define FORMAT_FROM_SDB (-1)
 
+/* Memory mapping limit and default page cache size in KiB used with the
+   'local-disk' SQLite profile. */
+#define SQLITE_LOCAL_DISK_MMAP_SIZE  APR_INT64_C(0x10000000)
+#define SQLITE_LOCAL_DISK_CACHE_SIZE 16384
+
 /* #define VERIFY_ON_CLOSE */
 
 /* Get the format version from a wc-1 directory. If it is not a working copy
@@ -240,6 +247,12 @@ svn_wc__db_open(svn_wc__db_t **db,
     {
       svn_error_t *err;
       svn_boolean_t sqlite_exclusive = FALSE;
+      svn_boolean_t compress_pristines = FALSE;
+      svn_boolean_t cache_text_hashes = FALSE;
+      apr_int64_t max_wcroots;
+      apr_int64_t sqlite_cache_size;
+      const char *sqlite_profile;
+      const char *shared_pristine_dir;
       apr_int64_t timeout;
 
       err = svn_config_get_bool(config, &sqlite_exclusive,
@@ -261,6 +274,61 @@ svn_wc__db_open(svn_wc__db_t **db,
         svn_error_clear(err);
       else
         (*db)->timeout = (apr_int32_t)timeout;
+
+      err = svn_config_get_bool(config, &compress_pristines,
+                                SVN_CONFIG_SECTION_WORKING_COPY,
+                                SVN_CONFIG_OPTION_COMPRESS_PRISTINES,
+                                FALSE);
+      if (err)
+        svn_error_clear(err);
+      else
+        (*db)->compress_pristines = compress_pristines
+                                    && svn__lz4_supported();
+
+      err = svn_config_get_bool(config, &cache_text_hashes,
+                                SVN_CONFIG_SECTION_WORKING_COPY,
+                                SVN_CONFIG_OPTION_CACHE_TEXT_HASHES,
+                                FALSE);
+      if (err)
+        svn_error_clear(err);
+      else
+        (*db)->cache_text_hashes = cache_text_hashes;
+
+      err = svn_config_get_int64(config, &max_wcroots,
+                                 SVN_CONFIG_SECTION_WORKING_COPY,
+                                 SVN_CONFIG_OPTION_MAX_OPEN_WORKING_COPIES,
+                                 0);
+      if (err || max_wcroots < 0 || max_wcroots > APR_INT32_MAX)
+        svn_error_clear(err);
+      else
+        (*db)->max_wcroots = (int)max_wcroots;
+
+      err = svn_config_get_int64(config, &sqlite_cache_size,
+                                 SVN_CONFIG_SECTION_WORKING_COPY,
+                                 SVN_CONFIG_OPTION_SQLITE_CACHE_SIZE,
+                                 0);
+      if (err || sqlite_cache_size < 0 || sqlite_cache_size > APR_INT32_MAX)
+        svn_error_clear(err);
+      else
+        (*db)->sqlite_cache_size = (int)sqlite_cache_size;
+
+      svn_config_get(config, &sqlite_profile,
+                     SVN_CONFIG_SECTION_WORKING_COPY,
+                     SVN_CONFIG_OPTION_SQLITE_PROFILE, "default");
+      (*db)->sqlite_local_disk = (svn_cstring_casecmp(sqlite_profile,
+                                                      "local-disk") == 0);
+
+      svn_config_get(config, &shared_pristine_dir,
+                     SVN_CONFIG_SECTION_WORKING_COPY,
+                     SVN_CONFIG_OPTION_SHARED_PRISTINE_STORE, NULL);
+      if (shared_pristine_dir && *shared_pristine_dir)
+        {
+          err = svn_dirent_get_absolute(&(*db)->shared_pristine_abspath,
+                                        svn_dirent_internal_style(
+                                          shared_pristine_dir, scratch_pool),
+                                        result_pool);
+          svn_error_clear(err);
+        }
     }
 
   return SVN_NO_ERROR;
@@ -377,6 +445,9 @@ svn_wc__db_pdh_create_wcroot(svn_wc__db_wcroot_t **wcroot,
   (*wcroot)->owned_locks = apr_array_make(result_pool, 8,
                                           sizeof(svn_wc__db_wclock_t));
   (*wcroot)->access_cache = apr_hash_make(result_pool);
+  (*wcroot)->text_hash_schema = FALSE;
+  (*wcroot)->pool = result_pool;
+  (*wcroot)->last_used = 0;
 
   /* SDB will be NULL for pre-NG working copies. We only need to run a
      cleanup when the SDB is present.  */
@@ -399,7 +470,7 @@ svn_wc__db_close_many_wcroots(apr_hash_t *roots,
       svn_wc__db_wcroot_t *wcroot = apr_hash_this_val(hi);
       apr_status_t result;
 
-      result = apr_pool_cleanup_run(state_pool, wcroot, close_wcroot);
+      result = apr_pool_cleanup_run(wcroot->pool, wcroot, close_wcroot);
       if (result != APR_SUCCESS)
         return svn_error_wrap_apr(result, NULL);
     }
@@ -506,6 +577,72 @@ fetch_sdb_info(apr_int64_t *wc_id,
 }
 
 
+/* Close the least recently used wcroots in DB other than KEEP, until no
+   more than DB->MAX_WCROOTS are open.  Only close wcroots that have their
+   own pool and are not in use, i.e. that have no locks, no cached access
+   batons and no running transaction.  */
+static svn_error_t *
+close_unused_wcroots(svn_wc__db_t *db,
+                     svn_wc__db_wcroot_t *keep,
+                     apr_pool_t *scratch_pool)
+{
+  apr_hash_t *roots = apr_hash_make(scratch_pool);
+  apr_hash_index_t *hi;
+
+  for (hi = apr_hash_first(scratch_pool, db->dir_data);
+       hi;
+       hi = apr_hash_next(hi))
+    {
+      svn_wc__db_wcroot_t *wcroot = apr_hash_this_val(hi);
+
+      if (wcroot->sdb)
+        svn_hash_sets(roots, wcroot->abspath, wcroot);
+    }
+
+  while (apr_hash_count(roots) > (unsigned int)db->max_wcroots)
+    {
+      svn_wc__db_wcroot_t *victim = NULL;
+      apr_status_t result;
+
+      for (hi = apr_hash_first(scratch_pool, roots);
+           hi;
+           hi = apr_hash_next(hi))
+        {
+          svn_wc__db_wcroot_t *wcroot = apr_hash_this_val(hi);
+
+          if (wcroot == keep
+              || wcroot->pool == db->state_pool
+              || wcroot->owned_locks->nelts > 0
+              || apr_hash_count(wcroot->access_cache) > 0
+              || svn_sqlite__in_transaction(wcroot->sdb))
+            continue;
+
+          if (!victim || wcroot->last_used < victim->last_used)
+            victim = wcroot;
+        }
+
+      if (!victim)
+        break;
+
+      svn_hash_sets(roots, victim->abspath, NULL);
+      for (hi = apr_hash_first(scratch_pool, db->dir_data);
+           hi;
+           hi = apr_hash_next(hi))
+        {
+          if (apr_hash_this_val(hi) == victim)
+            svn_hash_sets(db->dir_data, apr_hash_this_key(hi), NULL);
+        }
+
+      result = apr_pool_cleanup_run(victim->pool, victim, close_wcroot);
+      svn_pool_destroy(victim->pool);
+      if (result != APR_SUCCESS)
+        return svn_error_wrap_apr(result, NULL);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+
 svn_error_t *
 svn_wc__db_wcroot_parse_local_abspath(svn_wc__db_wcroot_t **wcroot,
                                       const char **local_relpath,
@@ -522,6 +659,8 @@ svn_wc__db_wcroot_parse_local_abspath(svn_wc__db_wcroot_t **wcroot,
   svn_wc__db_wcroot_t *found_wcroot = NULL;
   const char *scan_abspath;
   svn_sqlite__db_t *sdb = NULL;
+  apr_pool_t *sdb_pool = db->state_pool;
+  svn_boolean_t opened_wcroot = FALSE;
   svn_boolean_t moved_upwards = FALSE;
   svn_boolean_t always_check = FALSE;
   int wc_format = 0;
@@ -545,6 +684,7 @@ svn_wc__db_wcroot_parse_local_abspath(svn_wc__db_wcroot_t **wcroot,
       /* ### for most callers, we could pass NULL for result_pool.  */
       *local_relpath = compute_relpath(probe_wcroot, local_abspath,
                                        result_pool);
+      probe_wcroot->last_used = ++db->wcroot_clock;
 
       return SVN_NO_ERROR;
     }
@@ -581,6 +721,7 @@ svn_wc__db_wcroot_parse_local_abspath(svn_wc__db_wcroot_t **wcroot,
           *local_relpath = svn_relpath_join(dir_relpath,
                                             build_relpath,
                                             result_pool);
+          probe_wcroot->last_used = ++db->wcroot_clock;
           return SVN_NO_ERROR;
         }
 
@@ -633,11 +774,30 @@ svn_wc__db_wcroot_parse_local_abspath(svn_wc__db_wcroot_t **wcroot,
 
              We could decide what to do on a per-operation basis, but since
              we're caching database handles, it make sense to be as permissive
-             as the filesystem allows. */
+             as the filesystem allows.
+
+             If the number of open wcroots is limited, give each its own
+             pool, so that closing one releases its memory as well. */
+          if (db->max_wcroots > 0)
+            sdb_pool = svn_pool_create(db->state_pool);
+
           err = svn_wc__db_util_open_db(&sdb, local_abspath, SDB_FILE,
                                         svn_sqlite__mode_readwrite,
                                         db->exclusive, db->timeout, NULL,
-                                        db->state_pool, scratch_pool);
+                                        sdb_pool, scratch_pool);
+          /* Switching the journal mode may fail while others have the
+             database open; just keep the current mode then. */
+          if (err == NULL && db->sqlite_local_disk)
+            svn_error_clear(svn_sqlite__enable_wal(
+                              sdb, SQLITE_LOCAL_DISK_MMAP_SIZE));
+
+          /* The default cache size is fine, too. */
+          if (err == NULL && db->sqlite_cache_size > 0)
+            svn_error_clear(svn_sqlite__set_cache_size(sdb,
+                                                       db->sqlite_cache_size));
+          else if (err == NULL && db->sqlite_local_disk)
+            svn_error_clear(svn_sqlite__set_cache_size(
+                              sdb, SQLITE_LOCAL_DISK_CACHE_SIZE));
           if (err == NULL)
             {
 #ifdef SVN_DEBUG
@@ -656,6 +816,11 @@ svn_wc__db_wcroot_parse_local_abspath(svn_wc__db_wcroot_t **wcroot,
 #endif
               break;
             }
+          if (sdb_pool != db->state_pool)
+            {
+              svn_pool_destroy(sdb_pool);
+              sdb_pool = db->state_pool;
+            }
           if (err->apr_err != SVN_ERR_SQLITE_ERROR
               && !APR_STATUS_IS_ENOENT(err->apr_err))
             return svn_error_trace(err);
@@ -764,13 +929,13 @@ try_symlink_as_dir:
          (ie. where we found it).  */
 
       err = svn_wc__db_pdh_create_wcroot(wcroot,
-                            apr_pstrdup(db->state_pool,
+                            apr_pstrdup(sdb_pool,
                                         symlink_wcroot_abspath
                                           ? symlink_wcroot_abspath
                                           : local_abspath),
                             sdb, wc_id, format,
                             db->verify_format,
-                            db->state_pool, scratch_pool);
+                            sdb_pool, scratch_pool);
       if (err && (err->apr_err == SVN_ERR_WC_UNSUPPORTED_FORMAT ||
                   err->apr_err == SVN_ERR_WC_UPGRADE_REQUIRED) &&
           kind == svn_node_symlink)
@@ -787,6 +952,8 @@ try_symlink_as_dir:
              upgrading with exclusive wc locking. */
           return svn_error_compose_create(err, svn_sqlite__close(sdb));
         }
+      else
+        opened_wcroot = TRUE;
     }
   else
     {
@@ -928,6 +1095,8 @@ try_symlink_as_dir:
                  to be used further so close it. */
               if (sdb)
                 SVN_ERR(svn_sqlite__close(sdb));
+              sdb = NULL;
+              opened_wcroot = FALSE;
               goto try_symlink_as_dir;
             }
         }
@@ -936,8 +1105,13 @@ try_symlink_as_dir:
   /* We've found the appropriate WCROOT for the requested path. Stash
      it into that path's directory.  */
   svn_hash_sets(db->dir_data,
-                apr_pstrdup(db->state_pool, local_dir_abspath),
+                apr_pstrdup((*wcroot)->pool, local_dir_abspath),
                 *wcroot);
+  (*wcroot)->last_used = ++db->wcroot_clock;
+
+  /* Make room for the database we just opened. */
+  if (opened_wcroot && db->max_wcroots > 0)
+    SVN_ERR(close_unused_wcroots(db, *wcroot, scratch_pool));
 
   /* Did we traverse up to parent directories?  */
   if (!moved_upwards)
@@ -963,7 +1137,7 @@ try_symlink_as_dir:
       parent_wcroot = svn_hash_gets(db->dir_data, parent_dir);
       if (parent_wcroot == NULL)
         {
-          svn_hash_sets(db->dir_data, apr_pstrdup(db->state_pool, parent_dir),
+          svn_hash_sets(db->dir_data, apr_pstrdup((*wcroot)->pool, parent_dir),
                         *wcroot);
         }
 
@@ -1005,7 +1179,7 @@ svn_wc__db_drop_root(svn_wc__db_t *db,
         svn_hash_sets(db->dir_data, apr_hash_this_key(hi), NULL);
     }
 
-  result = apr_pool_cleanup_run(db->state_pool, root_wcroot, close_wcroot);
+  result = apr_pool_cleanup_run(root_wcroot->pool, root_wcroot, close_wcroot);
   if (result != APR_SUCCESS)
     return svn_error_wrap_apr(result, NULL);
 
@@ -40,6 +40,7 @@
 
 #include "private/svn_io_private.h"
 #include "private/svn_skel.h"
+#include "private/svn_thread.h"
 
 
 /* Workqueue operation names.  */
@@ -445,46 +446,69 @@ svn_wc__wq_build_postupgrade(svn_skel_t **work_item,
 
 /* OP_FILE_INSTALL */
 
-/* Process the OP_FILE_INSTALL work item WORK_ITEM.
- * See svn_wc__wq_build_file_install() which generates this work item.
- * Implements (struct work_item_dispatch).func. */
+/* Everything needed to install a file, as read from the working copy
+   database.  With this, the installation itself does not access the
+   database and may happen on any thread. */
+typedef struct file_install_t
+{
+  /* The file to install and the source to install it from.  The source
+     is LZ4 compressed if it is a compressed pristine. */
+  const char *local_abspath;
+  const char *source_abspath;
+  svn_boolean_t source_compressed;
+
+  /* How to translate the source.  If SPECIAL is set, the source is the
+     repository normal form of a special file. */
+  svn_boolean_t special;
+  svn_boolean_t translate;
+  const char *eol;
+  apr_hash_t *keywords;
+
+  /* Where to put the temporary file. */
+  const char *temp_dir_abspath;
+
+  /* How to tweak the installed file. */
+  svn_boolean_t set_executable;
+  svn_boolean_t set_read_only;
+  apr_time_t affected_time; /* 0 to leave alone */
+
+  /* Whether to record the size and timestamp of the installed file. */
+  svn_boolean_t record_fileinfo;
+} file_install_t;
+
+/* Read everything required to process the OP_FILE_INSTALL work item
+   WORK_ITEM into *INSTALL, allocated in RESULT_POOL.
+   Use SCRATCH_POOL for temporary allocations. */
 static svn_error_t *
-run_file_install(work_item_baton_t *wqb,
-                 svn_wc__db_t *db,
-                 const svn_skel_t *work_item,
-                 const char *wri_abspath,
-                 svn_cancel_func_t cancel_func,
-                 void *cancel_baton,
-                 apr_pool_t *scratch_pool)
+prepare_file_install(file_install_t **install,
+                     svn_wc__db_t *db,
+                     const svn_skel_t *work_item,
+                     const char *wri_abspath,
+                     apr_pool_t *result_pool,
+                     apr_pool_t *scratch_pool)
 {
   const svn_skel_t *arg1 = work_item->children->next;
   const svn_skel_t *arg4 = arg1->next->next->next;
+  file_install_t *result = apr_pcalloc(result_pool, sizeof(*result));
   const char *local_relpath;
   const char *local_abspath;
   svn_boolean_t use_commit_times;
-  svn_boolean_t record_fileinfo;
-  svn_boolean_t special;
-  svn_stream_t *src_stream;
   svn_subst_eol_style_t style;
-  const char *eol;
-  apr_hash_t *keywords;
-  const char *temp_dir_abspath;
-  svn_stream_t *dst_stream;
   apr_int64_t val;
   const char *wcroot_abspath;
-  const char *source_abspath;
   const svn_checksum_t *checksum;
   apr_hash_t *props;
   apr_time_t changed_date;
 
   local_relpath = apr_pstrmemdup(scratch_pool, arg1->data, arg1->len);
   SVN_ERR(svn_wc__db_from_relpath(&local_abspath, db, wri_abspath,
-                                  local_relpath, scratch_pool, scratch_pool));
+                                  local_relpath, result_pool, scratch_pool));
+  result->local_abspath = local_abspath;
 
   SVN_ERR(svn_skel__parse_int(&val, arg1->next, scratch_pool));
   use_commit_times = (val != 0);
   SVN_ERR(svn_skel__parse_int(&val, arg1->next->next, scratch_pool));
-  record_fileinfo = (val != 0);
+  result->record_fileinfo = (val != 0);
 
   SVN_ERR(svn_wc__db_read_node_install_info(&wcroot_abspath,
                                             &checksum, &props,
@@ -496,9 +520,9 @@ run_file_install(work_item_baton_t *wqb,
     {
       /* Use the provided path for the source.  */
       local_relpath = apr_pstrmemdup(scratch_pool, arg4->data, arg4->len);
-      SVN_ERR(svn_wc__db_from_relpath(&source_abspath, db, wri_abspath,
-                                      local_relpath,
-                                      scratch_pool, scratch_pool));
+      SVN_ERR(svn_wc__db_from_relpath(&result->source_abspath, db,
+                                      wri_abspath, local_relpath,
+                                      result_pool, scratch_pool));
     }
   else if (! checksum)
     {
@@ -518,26 +542,86 @@ run_file_install(work_item_baton_t *wqb,
     }
   else
     {
-      SVN_ERR(svn_wc__db_pristine_get_future_path(&source_abspath,
+      SVN_ERR(svn_wc__db_pristine_get_future_path(&result->source_abspath,
                                                   wcroot_abspath,
                                                   checksum,
-                                                  scratch_pool, scratch_pool));
+                                                  result_pool, scratch_pool));
+      SVN_ERR(svn_wc__db_pristine_get_compressed(&result->source_compressed,
+                                                 db, wcroot_abspath,
+                                                 checksum, scratch_pool));
     }
 
-  SVN_ERR(svn_stream_open_readonly(&src_stream, source_abspath,
-                                   scratch_pool, scratch_pool));
-
   /* Fetch all the translation bits.  */
-  SVN_ERR(svn_wc__get_translate_info(&style, &eol,
-                                     &keywords,
-                                     &special, db, local_abspath,
+  SVN_ERR(svn_wc__get_translate_info(&style, &result->eol,
+                                     &result->keywords,
+                                     &result->special, db, local_abspath,
                                      props, FALSE,
-                                     scratch_pool, scratch_pool));
-  if (special)
+                                     result_pool, scratch_pool));
+  *install = result;
+
+  /* No need to set exec or read-only flags on special files.  */
+  if (result->special)
+    return SVN_NO_ERROR;
+
+  result->translate = svn_subst_translation_required(style, result->eol,
+                                                     result->keywords,
+                                                     FALSE /* special */,
+                                                     TRUE /* force_eol_check */);
+
+  /* Where is the Right Place to put a temp file in this working copy?  */
+  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&result->temp_dir_abspath,
+                                         db, wcroot_abspath,
+                                         result_pool, scratch_pool));
+
+#ifndef WIN32
+  result->set_executable = (props
+                            && svn_hash_gets(props, SVN_PROP_EXECUTABLE));
+#endif
+
+  /* Note that this explicitly checks the pristine properties, to make sure
+     that when the lock is locally set (=modification) it is not read only */
+  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
+    {
+      svn_wc__db_status_t status;
+      svn_wc__db_lock_t *lock;
+      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL,
+                                   db, local_abspath,
+                                   scratch_pool, scratch_pool));
+
+      result->set_read_only = (!lock && status != svn_wc__db_status_added);
+    }
+
+  if (use_commit_times)
+    result->affected_time = changed_date;
+
+  return SVN_NO_ERROR;
+}
+
+/* Install the file described by INSTALL.  This does not access the working
+   copy database.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+perform_file_install(const file_install_t *install,
+                     svn_cancel_func_t cancel_func,
+                     void *cancel_baton,
+                     apr_pool_t *scratch_pool)
+{
+  svn_stream_t *src_stream;
+  svn_stream_t *dst_stream;
+
+  SVN_ERR(svn_wc__db_pristine_open_file(&src_stream,
+                                        install->source_abspath,
+                                        install->source_compressed,
+                                        scratch_pool, scratch_pool));
+
+  if (install->special)
     {
       /* When this stream is closed, the resulting special file will
          atomically be created/moved into place at LOCAL_ABSPATH.  */
-      SVN_ERR(svn_subst_create_specialfile(&dst_stream, local_abspath,
+      SVN_ERR(svn_subst_create_specialfile(&dst_stream,
+                                           install->local_abspath,
                                            scratch_pool, scratch_pool));
 
       /* Copy the "repository normal" form of the special file into the
@@ -546,33 +630,25 @@ run_file_install(work_item_baton_t *wqb,
                                cancel_func, cancel_baton,
                                scratch_pool));
 
-      /* No need to set exec or read-only flags on special files.  */
-
       /* ### Shouldn't this record a timestamp and size, etc.? */
       return SVN_NO_ERROR;
     }
 
-  if (svn_subst_translation_required(style, eol, keywords,
-                                     FALSE /* special */,
-                                     TRUE /* force_eol_check */))
+  if (install->translate)
     {
       /* Wrap it in a translating (expanding) stream.  */
-      src_stream = svn_subst_stream_translated(src_stream, eol,
+      src_stream = svn_subst_stream_translated(src_stream, install->eol,
                                                TRUE /* repair */,
-                                               keywords,
+                                               install->keywords,
                                                TRUE /* expand */,
                                                scratch_pool);
     }
 
-  /* Where is the Right Place to put a temp file in this working copy?  */
-  SVN_ERR(svn_wc__db_temp_wcroot_tempdir(&temp_dir_abspath,
-                                         db, wcroot_abspath,
-                                         scratch_pool, scratch_pool));
-
   /* Translate to a temporary file. We don't want the user seeing a partial
      file, nor let them muck with it while we translate. We may also need to
      get its TRANSLATED_SIZE before the user can monkey it.  */
-  SVN_ERR(svn_stream__create_for_install(&dst_stream, temp_dir_abspath,
+  SVN_ERR(svn_stream__create_for_install(&dst_stream,
+                                         install->temp_dir_abspath,
                                          scratch_pool, scratch_pool));
 
   /* Copy from the source to the dest, translating as we go. This will also
@@ -585,45 +661,49 @@ run_file_install(work_item_baton_t *wqb,
   /* With a single db we might want to install files in a missing directory.
      Simply trying this scenario on error won't do any harm and at least
      one user reported this problem on IRC. */
-  SVN_ERR(svn_stream__install_stream(dst_stream, local_abspath,
+  SVN_ERR(svn_stream__install_stream(dst_stream, install->local_abspath,
                                      TRUE /* make_parents*/, scratch_pool));
 
   /* Tweak the on-disk file according to its properties.  */
-#ifndef WIN32
-  if (props && svn_hash_gets(props, SVN_PROP_EXECUTABLE))
-    SVN_ERR(svn_io_set_file_executable(local_abspath, TRUE, FALSE,
+  if (install->set_executable)
+    SVN_ERR(svn_io_set_file_executable(install->local_abspath, TRUE, FALSE,
                                        scratch_pool));
-#endif
 
-  /* Note that this explicitly checks the pristine properties, to make sure
-     that when the lock is locally set (=modification) it is not read only */
-  if (props && svn_hash_gets(props, SVN_PROP_NEEDS_LOCK))
-    {
-      svn_wc__db_status_t status;
-      svn_wc__db_lock_t *lock;
-      SVN_ERR(svn_wc__db_read_info(&status, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, &lock, NULL, NULL, NULL, NULL,
-                                   NULL, NULL, NULL, NULL, NULL, NULL,
-                                   db, local_abspath,
-                                   scratch_pool, scratch_pool));
+  if (install->set_read_only)
+    SVN_ERR(svn_io_set_file_read_only(install->local_abspath, FALSE,
+                                      scratch_pool));
 
-      if (!lock && status != svn_wc__db_status_added)
-        SVN_ERR(svn_io_set_file_read_only(local_abspath, FALSE, scratch_pool));
-    }
+  if (install->affected_time)
+    SVN_ERR(svn_io_set_file_affected_time(install->affected_time,
+                                          install->local_abspath,
+                                          scratch_pool));
 
-  if (use_commit_times)
-    {
-      if (changed_date)
-        SVN_ERR(svn_io_set_file_affected_time(changed_date,
-                                              local_abspath,
-                                              scratch_pool));
-    }
+  return SVN_NO_ERROR;
+}
+
+/* Process the OP_FILE_INSTALL work item WORK_ITEM.
+ * See svn_wc__wq_build_file_install() which generates this work item.
+ * Implements (struct work_item_dispatch).func. */
+static svn_error_t *
+run_file_install(work_item_baton_t *wqb,
+                 svn_wc__db_t *db,
+                 const svn_skel_t *work_item,
+                 const char *wri_abspath,
+                 svn_cancel_func_t cancel_func,
+                 void *cancel_baton,
+                 apr_pool_t *scratch_pool)
+{
+  file_install_t *install;
+
+  SVN_ERR(prepare_file_install(&install, db, work_item, wri_abspath,
+                               scratch_pool, scratch_pool));
+  SVN_ERR(perform_file_install(install, cancel_func, cancel_baton,
+                               scratch_pool));
 
   /* ### this should happen before we rename the file into place.  */
-  if (record_fileinfo)
+  if (install->record_fileinfo && !install->special)
     {
-      SVN_ERR(get_and_record_fileinfo(wqb, local_abspath,
+      SVN_ERR(get_and_record_fileinfo(wqb, install->local_abspath,
                                       FALSE /* ignore_enoent */,
                                       scratch_pool));
     }
@@ -1474,6 +1554,202 @@ dispatch_work_item(work_item_baton_t *wqb,
 }
 
 
+/* Return ERR, the error of running work item ID, WORK_ITEM queued for
+   WRI_ABSPATH, wrapped to tell the user which item failed. */
+static svn_error_t *
+wrap_work_item_error(svn_error_t *err,
+                     const char *wri_abspath,
+                     apr_uint64_t id,
+                     const svn_skel_t *work_item,
+                     apr_pool_t *scratch_pool)
+{
+  const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
+
+  return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
+                           _("Failed to run the WC DB work queue "
+                             "associated with '%s', work item %d %s"),
+                           svn_dirent_local_style(wri_abspath,
+                                                  scratch_pool),
+                           (int)id, skel);
+}
+
+/* ------------------------------------------------------------------------ */
+/* Installing files in parallel */
+
+/* A checkout or update queues one OP_FILE_INSTALL item per file, which
+   translates the pristine to a temporary file, moves that into place and
+   tweaks it.  For many small files, that I/O dominates.  Runs of
+   independent OP_FILE_INSTALL items are therefore read from the database
+   on the calling thread but installed on several threads.  The results are
+   recorded and the items completed in a single transaction afterwards. */
+
+/* Maximum number of work items to install in parallel. */
+#define INSTALL_BATCH_SIZE 256
+
+/* Maximum number of threads installing files. */
+#define INSTALL_THREAD_COUNT 8
+
+/* One file of an install batch. */
+typedef struct install_job_t
+{
+  const file_install_t *install;
+
+  /* Results. */
+  const svn_io_dirent2_t *dirent;
+  svn_error_t *err;
+
+  /* Pool only to be used by the thread processing this job. */
+  apr_pool_t *pool;
+} install_job_t;
+
+/* Implements svn_thread__job_func_t, installing the install_job_t in
+   DATA. */
+static void
+install_file_job(void *data,
+                 int thread_index,
+                 void *baton)
+{
+  install_job_t *job = data;
+
+  /* The calling thread checks for cancellation between batches. */
+  job->err = perform_file_install(job->install, NULL, NULL, job->pool);
+  if (!job->err && job->install->record_fileinfo && !job->install->special)
+    job->err = svn_io_stat_dirent2(&job->dirent, job->install->local_abspath,
+                                   FALSE, FALSE, job->pool, job->pool);
+}
+
+/* Try to run a batch of OP_FILE_INSTALL work items queued for WRI_ABSPATH,
+   starting with item FIRST_ID, in parallel.  If successful, mark them as
+   completed and set *DONE.  Otherwise, i.e. if there is just a single
+   item to install, leave everything to the caller.
+
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_file_install_batch(svn_boolean_t *done,
+                       svn_wc__db_t *db,
+                       const char *wri_abspath,
+                       apr_uint64_t first_id,
+                       apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *ids, *work_items;
+  apr_hash_t *targets = apr_hash_make(scratch_pool);
+  apr_hash_t *sources = apr_hash_make(scratch_pool);
+  apr_hash_t *record_map = apr_hash_make(scratch_pool);
+  apr_array_header_t *jobs;
+  apr_pool_t *jobs_pool;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  *done = FALSE;
+
+  SVN_ERR(svn_wc__db_wq_fetch_items(&ids, &work_items, db, wri_abspath,
+                                    first_id, INSTALL_BATCH_SIZE,
+                                    scratch_pool, scratch_pool));
+
+  /* Job pools are used from several threads. */
+  jobs_pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  jobs = apr_array_make(scratch_pool, work_items->nelts,
+                        sizeof(install_job_t *));
+
+  /* Only the leading run of installs of distinct files is independent. */
+  for (i = 0; i < work_items->nelts; i++)
+    {
+      const svn_skel_t *work_item = APR_ARRAY_IDX(work_items, i,
+                                                  const svn_skel_t *);
+      install_job_t *job;
+      file_install_t *install;
+
+      if (!svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL))
+        break;
+
+      job = apr_pcalloc(scratch_pool, sizeof(*job));
+      job->pool = svn_pool_create(jobs_pool);
+      err = prepare_file_install(&install, db, work_item, wri_abspath,
+                                 job->pool, job->pool);
+      if (err)
+        {
+          /* Let the caller run into that error again. */
+          svn_error_clear(err);
+          err = SVN_NO_ERROR;
+          break;
+        }
+
+      if (svn_hash_gets(targets, install->local_abspath)
+          || svn_hash_gets(sources, install->local_abspath)
+          || svn_hash_gets(targets, install->source_abspath))
+        break;
+
+      svn_hash_sets(targets, install->local_abspath, "");
+      svn_hash_sets(sources, install->source_abspath, "");
+      job->install = install;
+      APR_ARRAY_PUSH(jobs, install_job_t *) = job;
+    }
+
+  if (jobs->nelts < 2)
+    {
+      svn_pool_destroy(jobs_pool);
+      return SVN_NO_ERROR;
+    }
+
+  svn_thread__run_batch(jobs, install_file_job, NULL, INSTALL_THREAD_COUNT);
+
+  /* Report the first failure in queue order.  The successful installs
+     will simply be repeated by the next run. */
+  for (i = 0; i < jobs->nelts; i++)
+    {
+      install_job_t *job = APR_ARRAY_IDX(jobs, i, install_job_t *);
+
+      if (job->err && !err)
+        err = wrap_work_item_error(job->err, wri_abspath,
+                                   APR_ARRAY_IDX(ids, i, apr_uint64_t),
+                                   APR_ARRAY_IDX(work_items, i, svn_skel_t *),
+                                   scratch_pool);
+      else if (job->err)
+        svn_error_clear(job->err);
+      else if (job->dirent && job->dirent->kind == svn_node_file)
+        svn_hash_sets(record_map, job->install->local_abspath, job->dirent);
+    }
+
+  if (!err)
+    {
+      ids->nelts = jobs->nelts;
+      err = svn_wc__db_wq_record_and_complete(db, wri_abspath, ids,
+                                              record_map, scratch_pool);
+    }
+
+  svn_pool_destroy(jobs_pool);
+  SVN_ERR(err);
+
+  *done = TRUE;
+  return SVN_NO_ERROR;
+}
+
+
+/* Maximum number of work items to run before marking them completed in
+   a single transaction. */
+#define WQ_BATCH_SIZE 256
+
+/* Return TRUE if WORK_ITEM does not modify the working copy database, so
+   that it can be part of a batch of work items that get completed in a
+   single transaction.  Any other item is completed on its own, before the
+   following items run.  Even so, a crash before completion will run all
+   items of the batch again, like any item that did not complete. */
+static svn_boolean_t
+is_batchable(const svn_skel_t *work_item)
+{
+  return (svn_skel__matches_atom(work_item->children, OP_FILE_COMMIT)
+          || svn_skel__matches_atom(work_item->children, OP_FILE_INSTALL)
+          || svn_skel__matches_atom(work_item->children, OP_FILE_REMOVE)
+          || svn_skel__matches_atom(work_item->children, OP_FILE_MOVE)
+          || svn_skel__matches_atom(work_item->children,
+                                    OP_FILE_COPY_TRANSLATED)
+          || svn_skel__matches_atom(work_item->children, OP_SYNC_FILE_FLAGS)
+          || svn_skel__matches_atom(work_item->children, OP_PREJ_INSTALL)
+          || svn_skel__matches_atom(work_item->children, OP_DIRECTORY_INSTALL)
+          || svn_skel__matches_atom(work_item->children,
+                                    OP_DIRECTORY_REMOVE));
+}
+
 svn_error_t *
 svn_wc__wq_run(svn_wc__db_t *db,
                const char *wri_abspath,
@@ -1482,7 +1758,6 @@ svn_wc__wq_run(svn_wc__db_t *db,
                apr_pool_t *scratch_pool)
 {
   apr_pool_t *iterpool = svn_pool_create(scratch_pool);
-  apr_uint64_t last_id = 0;
   work_item_baton_t wib = { 0 };
   wib.result_pool = svn_pool_create(scratch_pool);
 
@@ -1502,64 +1777,93 @@ svn_wc__wq_run(svn_wc__db_t *db,
 
   while (TRUE)
     {
-      apr_uint64_t id;
-      svn_skel_t *work_item;
-      svn_error_t *err;
+      apr_array_header_t *ids, *work_items;
+      svn_error_t *err = SVN_NO_ERROR;
+      int completed = 0;
 
       svn_pool_clear(iterpool);
 
-      if (! wib.used)
+      SVN_ERR(svn_wc__db_wq_fetch_items(&ids, &work_items, db, wri_abspath,
+                                        0, WQ_BATCH_SIZE,
+                                        iterpool, iterpool));
+
+      /* If we have WORK_ITEMS, then process the suckers. Otherwise,
+         we're done.  */
+      if (work_items->nelts == 0)
+        break;
+
+      /* Checkouts and updates queue lots of these in a row. */
+      if (svn_skel__matches_atom(APR_ARRAY_IDX(work_items, 0,
+                                               svn_skel_t *)->children,
+                                 OP_FILE_INSTALL))
         {
-          /* Make sure to do this *early* in the loop iteration. There may
-             be a LAST_ID that needs to be marked as completed, *before* we
-             start worrying about anything else.  */
-          SVN_ERR(svn_wc__db_wq_fetch_next(&id, &work_item, db, wri_abspath,
-                                           last_id, iterpool, iterpool));
+          svn_boolean_t done;
+
+          if (cancel_func)
+            SVN_ERR(cancel_func(cancel_baton));
+
+          SVN_ERR(run_file_install_batch(&done, db, wri_abspath,
+                                         APR_ARRAY_IDX(ids, 0, apr_uint64_t),
+                                         iterpool));
+          if (done)
+            continue;
         }
-      else
+
+      while (completed < work_items->nelts)
         {
-          /* Make sure to do this *early* in the loop iteration. There may
-             be a LAST_ID that needs to be marked as completed, *before* we
-             start worrying about anything else.  */
-          SVN_ERR(svn_wc__db_wq_record_and_fetch_next(&id, &work_item,
-                                                      db, wri_abspath,
-                                                      last_id, wib.record_map,
-                                                      iterpool,
-                                                      wib.result_pool));
-
-          svn_pool_clear(wib.result_pool);
-          wib.record_map = NULL;
-          wib.used = FALSE;
+          const svn_skel_t *work_item = APR_ARRAY_IDX(work_items, completed,
+                                                      svn_skel_t *);
+          svn_boolean_t batchable = is_batchable(work_item);
+
+          /* Items that modify the database run on their own, and runs of
+             installs start a new batch. */
+          if (completed > 0
+              && (!batchable
+                  || svn_skel__matches_atom(work_item->children,
+                                            OP_FILE_INSTALL)))
+            break;
+
+          /* Stop work queue processing, if requested. A future 'svn cleanup'
+             should be able to continue the processing.  */
+          if (cancel_func)
+            err = cancel_func(cancel_baton);
+
+          if (!err)
+            {
+              err = dispatch_work_item(&wib, db, wri_abspath, work_item,
+                                       cancel_func, cancel_baton, iterpool);
+              if (err)
+                err = wrap_work_item_error(err, wri_abspath,
+                                           APR_ARRAY_IDX(ids, completed,
+                                                         apr_uint64_t),
+                                           work_item, scratch_pool);
+            }
+
+          if (err)
+            break;
+
+          completed++;
+          if (!batchable)
+            break;
         }
 
-      /* Stop work queue processing, if requested. A future 'svn cleanup'
-         should be able to continue the processing. Note that we may
-         have WORK_ITEM, but we'll just skip its processing for now.  */
-      if (cancel_func)
-        SVN_ERR(cancel_func(cancel_baton));
-
-      /* If we have a WORK_ITEM, then process the sucker. Otherwise,
-         we're done.  */
-      if (work_item == NULL)
-        break;
-
-      err = dispatch_work_item(&wib, db, wri_abspath, work_item,
-                               cancel_func, cancel_baton, iterpool);
-      if (err)
+      /* Mark the items that finished without error completed, together
+         with the file info they recorded.  */
+      if (completed > 0)
         {
-          const char *skel = svn_skel__unparse(work_item, scratch_pool)->data;
-
-          return svn_error_createf(SVN_ERR_WC_BAD_ADM_LOG, err,
-                                   _("Failed to run the WC DB work queue "
-                                     "associated with '%s', work item %d %s"),
-                                   svn_dirent_local_style(wri_abspath,
-                                                          scratch_pool),
-                                   (int)id, skel);
+          ids->nelts = completed;
+          err = svn_error_compose_create(
+                  err,
+                  svn_wc__db_wq_record_and_complete(db, wri_abspath, ids,
+                                                    wib.record_map,
+                                                    iterpool));
         }
 
-      /* The work item finished without error. Mark it completed
-         in the next loop.  */
-      last_id = id;
+      svn_pool_clear(wib.result_pool);
+      wib.record_map = NULL;
+      wib.used = FALSE;
+
+      SVN_ERR(err);
     }
 
   svn_pool_destroy(iterpool);
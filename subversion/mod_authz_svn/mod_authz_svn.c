@@ -47,6 +47,7 @@
 #include "svn_pools.h"
 #include "svn_dirent_uri.h"
 #include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
 
 /* The apache headers define these and they conflict with our definitions. */
 #ifdef PACKAGE_BUGREPORT
@@ -82,6 +83,7 @@ typedef struct authz_svn_config_rec {
   const char *repo_relative_access_file;
   const char *groups_file;
   const char *force_username_case;
+  int reload_in_background;
 } authz_svn_config_rec;
 
 /* version where ap_some_auth_required breaks */
@@ -262,6 +264,13 @@ static const command_rec authz_svn_cmds[] =
                 OR_AUTHCFG,
                 "Set to 'Upper' or 'Lower' to convert the username before "
                 "checking for authorization."),
+  AP_INIT_FLAG("AuthzSVNReloadInBackground", ap_set_flag_slot,
+               (void *)APR_OFFSETOF(authz_svn_config_rec,
+                                    reload_in_background),
+               OR_AUTHCFG,
+               "Set to 'On' to keep using the previous access rules while "
+               "a modified access file is being parsed in the background. "
+               "(default is Off.)"),
   { NULL }
 };
 
@@ -464,9 +473,9 @@ get_access_conf(request_rec *r, authz_svn_config_rec *conf,
                     "Path to groups file is %s", groups_file);
     }
 
-  svn_err = svn_repos_authz_read3(&access_conf,
+  svn_err = svn_repos__authz_read(&access_conf,
                                   access_file, groups_file,
-                                  TRUE, NULL,
+                                  TRUE, conf->reload_in_background, NULL,
                                   r->connection->pool, scratch_pool);
 
   if (svn_err)
@@ -777,12 +786,14 @@ req_check_access(request_rec *r,
 }
 
 /*
- * Implementation of subreq_bypass with scratch_pool parameter.
+ * Implementation of subreq_bypass and subtree_bypass with scratch_pool
+ * parameter.  REQUIRED is the access to check for.
  */
 static int
 subreq_bypass2(request_rec *r,
                const char *repos_path,
                const char *repos_name,
+               svn_repos_authz_access_t required,
                apr_pool_t *scratch_pool)
 {
   svn_error_t *svn_err = NULL;
@@ -816,7 +827,7 @@ subreq_bypass2(request_rec *r,
       svn_err = svn_repos_authz_check_access(access_conf, repos_name,
                                              repos_path,
                                              username_to_authorize,
-                                             svn_authz_none|svn_authz_read,
+                                             required,
                                              &authz_access_granted,
                                              scratch_pool);
       if (svn_err)
@@ -852,7 +863,28 @@ subreq_bypass(request_rec *r,
   apr_pool_t *scratch_pool;
 
   scratch_pool = svn_pool_create(r->pool);
-  status = subreq_bypass2(r, repos_path, repos_name, scratch_pool);
+  status = subreq_bypass2(r, repos_path, repos_name,
+                          svn_authz_none|svn_authz_read, scratch_pool);
+  svn_pool_destroy(scratch_pool);
+
+  return status;
+}
+
+/*
+ * This function is used as a provider to allow mod_dav_svn to check
+ * read access to whole subtrees at once, e.g. during checkouts.
+ */
+static int
+subtree_bypass(request_rec *r,
+               const char *repos_path,
+               const char *repos_name)
+{
+  int status;
+  apr_pool_t *scratch_pool;
+
+  scratch_pool = svn_pool_create(r->pool);
+  status = subreq_bypass2(r, repos_path, repos_name,
+                          svn_authz_read|svn_authz_recursive, scratch_pool);
   svn_pool_destroy(scratch_pool);
 
   return status;
@@ -1088,6 +1120,11 @@ register_hooks(apr_pool_t *p)
                        AUTHZ_SVN__SUBREQ_BYPASS_PROV_NAME,
                        AUTHZ_SVN__SUBREQ_BYPASS_PROV_VER,
                        (void*)subreq_bypass);
+  ap_register_provider(p,
+                       AUTHZ_SVN__SUBREQ_BYPASS_PROV_GRP,
+                       AUTHZ_SVN__SUBTREE_BYPASS_PROV_NAME,
+                       AUTHZ_SVN__SUBTREE_BYPASS_PROV_VER,
+                       (void*)subtree_bypass);
 }
 
 module AP_MODULE_DECLARE_DATA authz_svn_module =
@@ -24,6 +24,7 @@
 #include <http_request.h>
 #include <http_log.h>
 
+#include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_dirent_uri.h"
 #include "svn_path.h"
@@ -34,6 +35,76 @@
 #include "dav_svn.h"
 
 
+/* Key of the per-request memo used by allow_read_subtree(). */
+#define SUBTREE_ACCESS_KEY "mod_dav_svn-subtree-access"
+
+static const char subtree_readable[] = "readable";
+static const char subtree_restricted[] = "restricted";
+
+/* Return TRUE if the user of R may read the whole directory containing
+   the fspath PATH in REPOS, as reported by SUBTREE_FUNC.
+
+   Checking the parent directory once instead of every path in it lets
+   e.g. a checkout get away with at most one authz lookup per directory.
+   The results are remembered for the lifetime of R.  Once a directory
+   is known to be fully readable, no lookups are needed for anything
+   below it.  Use POOL for temporary allocations.
+*/
+static svn_boolean_t
+allow_read_subtree(request_rec *r,
+                   const dav_svn_repos *repos,
+                   const char *path,
+                   authz_svn__subtree_bypass_func_t subtree_func,
+                   apr_pool_t *pool)
+{
+  apr_hash_t *memo;
+  void *data;
+  const char *parent;
+  const char *ancestor;
+  const char *verdict;
+
+  apr_pool_userdata_get(&data, SUBTREE_ACCESS_KEY, r->pool);
+  memo = data;
+  if (memo == NULL)
+    {
+      memo = apr_hash_make(r->pool);
+      apr_pool_userdata_setn(memo, SUBTREE_ACCESS_KEY, NULL, r->pool);
+    }
+
+  parent = svn_fspath__is_root(path, strlen(path))
+         ? path
+         : svn_fspath__dirname(path, pool);
+
+  verdict = svn_hash_gets(memo, parent);
+  if (verdict == subtree_restricted)
+    return FALSE;
+
+  /* Any fully readable ancestor covers PATH as well. */
+  for (ancestor = parent; verdict == NULL; )
+    {
+      if (svn_fspath__is_root(ancestor, strlen(ancestor)))
+        break;
+
+      ancestor = svn_fspath__dirname(ancestor, pool);
+      verdict = svn_hash_gets(memo, ancestor);
+      if (verdict == subtree_restricted)
+        verdict = NULL;
+    }
+
+  if (verdict == subtree_readable)
+    return TRUE;
+
+  if (subtree_func(r, parent, repos->repo_basename) == OK)
+    verdict = subtree_readable;
+  else
+    verdict = subtree_restricted;
+
+  svn_hash_sets(memo, apr_pstrdup(r->pool, parent), verdict);
+
+  return verdict == subtree_readable;
+}
+
+
 svn_boolean_t
 dav_svn__allow_read(request_rec *r,
                     const dav_svn_repos *repos,
@@ -46,6 +117,8 @@ dav_svn__allow_read(request_rec *r,
   enum dav_svn__build_what uri_type;
   svn_boolean_t allowed = FALSE;
   authz_svn__subreq_bypass_func_t allow_read_bypass = NULL;
+  authz_svn__subtree_bypass_func_t subtree_bypass = NULL;
+  dav_svn__request_stats_t *stats;
 
   /* Easy out:  if the admin has explicitly set 'SVNPathAuthz Off',
      then this whole callback does nothing. */
@@ -54,6 +127,10 @@ dav_svn__allow_read(request_rec *r,
       return TRUE;
     }
 
+  stats = dav_svn__get_request_stats(r);
+  if (stats)
+    stats->authz_checks++;
+
   /* Sometimes we get paths that do not start with '/' and
      hence below uri concatenation would lead to wrong uris .*/
   if (path && path[0] != '/')
@@ -67,6 +144,13 @@ dav_svn__allow_read(request_rec *r,
   allow_read_bypass = dav_svn__get_pathauthz_bypass(r);
   if (allow_read_bypass != NULL)
     {
+      /* Authz rules don't depend on the revision, so a single lookup
+         may cover all paths within a readable directory. */
+      subtree_bypass = dav_svn__get_pathauthz_subtree_bypass(r);
+      if (subtree_bypass != NULL && path != NULL
+          && allow_read_subtree(r, repos, path, subtree_bypass, pool))
+        return TRUE;
+
       if (allow_read_bypass(r, path, repos->repo_basename) == OK)
         return TRUE;
       else
@@ -272,6 +272,11 @@ struct dav_resource_private {
   /* ### record the base for computing a delta during a GET */
   const char *delta_base;
 
+  /* the byte range of the file contents to send for a GET request with
+     a Range header.  RANGE_LENGTH is 0 if all contents shall be sent. */
+  apr_off_t range_start;
+  apr_off_t range_length;
+
   /* SVNDIFF version we can transmit to the client.  */
   int svndiff_version;
 
@@ -344,11 +349,41 @@ dav_svn__get_nodeprop_cache_flag(request_rec *r);
  * request? */
 svn_boolean_t dav_svn__get_block_read_flag(request_rec *r);
 
+/* for the repository referred to by this request, may generated directory
+ * listings be cached? */
+svn_boolean_t dav_svn__get_listing_cache_flag(request_rec *r);
+
+/* Statistics collected for a single request if SVNRequestStatistics is on.
+ * They are made available to mod_log_config when the request is done. */
+typedef struct dav_svn__request_stats_t
+{
+  /* global membuffer cache counters at the start of the request */
+  apr_uint64_t cache_gets;
+  apr_uint64_t cache_hits;
+
+  /* number of path-based authz checks */
+  apr_uint64_t authz_checks;
+
+  /* time spent sending svndiff deltas */
+  apr_interval_time_t delta_time;
+} dav_svn__request_stats_t;
+
+/* for this request or its main request, return the statistics being
+ * collected.  NULL if statistics are not enabled. */
+dav_svn__request_stats_t *dav_svn__get_request_stats(request_rec *r);
+
 /* for the repository referred to by this request, are subrequests bypassed?
  * A function pointer if yes, NULL if not.
  */
 authz_svn__subreq_bypass_func_t dav_svn__get_pathauthz_bypass(request_rec *r);
 
+/* for the repository referred to by this request, can whole subtrees be
+ * checked for read access without subrequests?  A function pointer if
+ * yes, NULL if not.
+ */
+authz_svn__subtree_bypass_func_t
+dav_svn__get_pathauthz_subtree_bypass(request_rec *r);
+
 /* for the repository referred to by this request, is a GET of
    SVNParentPath allowed? */
 svn_boolean_t dav_svn__get_list_parentpath_flag(request_rec *r);
@@ -417,6 +452,14 @@ const char *dav_svn__get_master_uri(request_rec *r);
    Comes from the <SVNMasterVersion> directive. */
 svn_version_t *dav_svn__get_master_version(request_rec *r);
 
+/* Return the local directory in which a caching slave keeps responses
+   from the master server, or NULL if this is not a caching slave.
+   Comes from the <SVNMasterCache> directive. */
+const char *dav_svn__get_master_cache_dir(request_rec *r);
+
+/* Return the maximum size of the master cache in bytes. */
+apr_off_t dav_svn__get_master_cache_size(request_rec *r);
+
 /* Return the disk path to the activities db.
    Comes from the <SVNActivitiesDB> directive. */
 const char *dav_svn__get_activities_db(request_rec *r);
@@ -429,6 +472,9 @@ const char *dav_svn__get_root_dir(request_rec *r);
 /* Return the data compression level to be used over the wire. */
 int dav_svn__get_compression_level(request_rec *r);
 
+/* Return the file to record the spans of traced requests in, or NULL. */
+const char *dav_svn__get_trace_file(request_rec *r);
+
 /* Return the hook script environment parsed from the configuration. */
 const char *dav_svn__get_hooks_env(request_rec *r);
 
@@ -481,6 +527,14 @@ dav_svn__output *
 dav_svn__output_create(request_rec *r,
                        apr_pool_t *pool);
 
+/* Create an output wrapper for request R, allocated in POOL, that appends
+   everything written through the dav_svn__brigade_* functions to BUFFER
+   instead of sending it to R's output filters. */
+dav_svn__output *
+dav_svn__output_create_stringbuf(request_rec *r,
+                                 svn_stringbuf_t *buffer,
+                                 apr_pool_t *pool);
+
 /* Get a bucket allocator to use for all bucket/brigade creations
    when writing to OUTPUT. */
 apr_bucket_alloc_t *
@@ -1138,6 +1192,14 @@ apr_status_t dav_svn__location_header_filter(ap_filter_t *f,
 apr_status_t dav_svn__location_body_filter(ap_filter_t *f,
                                            apr_bucket_brigade *bb);
 
+/* An Apache output filter F which stores cacheable responses to proxied
+ * GET requests in the master cache.  BB is passed on unmodified. */
+apr_status_t dav_svn__master_cache_filter(ap_filter_t *f,
+                                          apr_bucket_brigade *bb);
+
+/* An Apache handler serving GET requests R from the master cache. */
+int dav_svn__master_cache_handler(request_rec *r);
+
 
 #ifdef __cplusplus
 }
@@ -23,12 +23,23 @@
 
 #include <assert.h>
 
+#include <apr_atomic.h>
 #include <apr_strmatch.h>
 
 #include <httpd.h>
 #include <http_core.h>
+#include <http_log.h>
+#include <http_protocol.h>
+
+#include "svn_checksum.h"
+#include "svn_dav.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
 
 #include "private/svn_fspath.h"
+#include "private/svn_sorts_private.h"
 
 #include "dav_svn.h"
 
@@ -38,10 +49,12 @@
    specified in the SVNMasterURI Apache configuration value.
    URI_SEGMENT is the URI bits relative to the repository root (but if
    non-empty, *does* have a leading slash delimiter).
-   MASTER_URI and URI_SEGMENT are not URI-encoded. */
+   MASTER_URI and URI_SEGMENT are not URI-encoded.  Locations in the
+   response body will only be rewritten if REWRITE_BODY is set. */
 static int proxy_request_fixup(request_rec *r,
                                const char *master_uri,
-                               const char *uri_segment)
+                               const char *uri_segment,
+                               svn_boolean_t rewrite_body)
 {
     if (uri_segment[0] != '\0' && uri_segment[0] != '/')
       {
@@ -70,19 +83,498 @@ static int proxy_request_fixup(request_rec *r,
            dav_svn__location_body_filter().  -- cmpilato */
 
     ap_add_output_filter("LocationRewrite", NULL, r, r->connection);
-    ap_add_output_filter("ReposRewrite", NULL, r, r->connection);
+    if (rewrite_body)
+        ap_add_output_filter("ReposRewrite", NULL, r, r->connection);
     ap_add_input_filter("IncomingRewrite", NULL, r, r->connection);
     return OK;
 }
 
 
+
+/*** Caching slave ***/
+
+/* With SVNMasterCache, the slave has no replica of the repository.  All
+   requests get proxied to the master.  Responses to GET requests that
+   the master marks as cacheable, i.e. file contents in fixed revisions,
+   are kept in a local directory and served from there the next time.
+
+   Each entry consists of two files named after the MD5 of the request
+   key: a .body file with the response body and a .hdrs file with the
+   relevant response headers in svn hash format.  The .hdrs file gets
+   written last and removed first, so its presence marks a complete
+   entry. */
+
+/* Handler name for requests served from the master cache. */
+#define MASTER_CACHE_HANDLER "svn-master-cache"
+
+/* Key of the master_cache_hit_t in the request pool's userdata. */
+#define MASTER_CACHE_HIT_KEY "mod_dav_svn-master-cache-hit"
+
+/* Response headers to keep along with a cached body.  The content type
+   is handled separately. */
+static const char *const cached_headers[] = {
+    "Cache-Control",
+    "Content-Encoding",
+    "ETag",
+    "Last-Modified",
+    "Vary",
+    SVN_DAV_DELTA_BASE_HEADER,
+    NULL
+};
+
+/* Check the size of the master cache once in this many stores. */
+#define MASTER_CACHE_CHECK_INTERVAL 64
+
+/* When the master cache has grown too large, shrink it to this
+   percentage of its maximum size. */
+#define MASTER_CACHE_SHRINK_PERCENT 90
+
+/* Number of entries stored by this process, used to schedule size
+   checks. */
+static volatile apr_uint32_t master_cache_stores = 0;
+
+/* An entry in the master cache found for a request. */
+typedef struct master_cache_hit_t
+{
+    /* the opened .body file */
+    apr_file_t *body;
+    apr_off_t size;
+    const char *body_path;
+
+    /* cached response headers, mapping const char * to svn_string_t * */
+    apr_hash_t *headers;
+} master_cache_hit_t;
+
+/* State of the master cache output filter. */
+typedef struct master_cache_ctx_t
+{
+    /* temporary file receiving the response body.  NULL once storing
+       the response has been given up. */
+    apr_file_t *file;
+    const char *tmp_path;
+
+    /* cache entry path without suffix */
+    const char *entry;
+
+    apr_off_t size;
+    apr_off_t max_size;
+} master_cache_ctx_t;
+
+/* Return the path of the master cache entry for request R in CACHE_DIR,
+   without suffix.  The key covers everything that the master's response
+   may depend on, including the user because the master will only send
+   contents that the user may read. */
+static const char *master_cache_entry(request_rec *r,
+                                      const char *cache_dir)
+{
+    const char *delta_base = apr_table_get(r->headers_in,
+                                           SVN_DAV_DELTA_BASE_HEADER);
+    const char *encoding = apr_table_get(r->headers_in, "Accept-Encoding");
+    const char *key;
+    const char *digest;
+    svn_checksum_t *checksum;
+
+    key = apr_pstrcat(r->pool, r->unparsed_uri,
+                      "\n", delta_base ? delta_base : "",
+                      "\n", encoding ? encoding : "",
+                      "\n", r->user ? r->user : "",
+                      SVN_VA_NULL);
+    svn_error_clear(svn_checksum(&checksum, svn_checksum_md5,
+                                 key, strlen(key), r->pool));
+    digest = svn_checksum_to_cstring_display(checksum, r->pool);
+
+    return svn_dirent_join_many(r->pool, cache_dir,
+                                apr_pstrndup(r->pool, digest, 2), digest,
+                                SVN_VA_NULL);
+}
+
+/* Set *HIT to the master cache entry ENTRY, allocated in POOL.  Set it
+   to NULL, if there is no such entry. */
+static svn_error_t *open_master_cache_entry(master_cache_hit_t **hit,
+                                            const char *entry,
+                                            apr_pool_t *pool)
+{
+    master_cache_hit_t *result = apr_pcalloc(pool, sizeof(*result));
+    svn_stream_t *stream;
+    svn_error_t *err;
+
+    *hit = NULL;
+
+    err = svn_stream_open_readonly(&stream,
+                                   apr_pstrcat(pool, entry, ".hdrs",
+                                               SVN_VA_NULL),
+                                   pool, pool);
+    if (err && APR_STATUS_IS_ENOENT(err->apr_err)) {
+        svn_error_clear(err);
+        return SVN_NO_ERROR;
+    }
+    SVN_ERR(err);
+
+    result->headers = apr_hash_make(pool);
+    SVN_ERR(svn_hash_read2(result->headers, stream, SVN_HASH_TERMINATOR,
+                           pool));
+    SVN_ERR(svn_stream_close(stream));
+
+    /* Once opened, the body stays readable even if the entry gets
+       evicted concurrently. */
+    result->body_path = apr_pstrcat(pool, entry, ".body", SVN_VA_NULL);
+    SVN_ERR(svn_io_file_open(&result->body, result->body_path,
+                             APR_READ | APR_BINARY, APR_OS_DEFAULT, pool));
+    SVN_ERR(svn_io_file_size_get(&result->size, result->body, pool));
+
+    *hit = result;
+    return SVN_NO_ERROR;
+}
+
+/* An entry of the master cache as seen by shrink_master_cache(). */
+typedef struct master_cache_file_t
+{
+    const char *body_path;
+    apr_time_t mtime;
+    apr_off_t size;
+} master_cache_file_t;
+
+/* Sort master_cache_file_t * by ascending modification time. */
+static int compare_mtime(const void *lhs, const void *rhs)
+{
+    const master_cache_file_t *a = *(const master_cache_file_t *const *)lhs;
+    const master_cache_file_t *b = *(const master_cache_file_t *const *)rhs;
+
+    return a->mtime < b->mtime ? -1 : (a->mtime > b->mtime ? 1 : 0);
+}
+
+/* Remove the least recently used entries from the master cache in
+   CACHE_DIR until it is no larger than MASTER_CACHE_SHRINK_PERCENT of
+   MAX_SIZE.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *shrink_master_cache(const char *cache_dir,
+                                        apr_off_t max_size,
+                                        apr_pool_t *scratch_pool)
+{
+    apr_array_header_t *files
+        = apr_array_make(scratch_pool, 64, sizeof(master_cache_file_t *));
+    apr_hash_t *subdirs;
+    apr_hash_index_t *hi;
+    apr_off_t total = 0;
+    apr_off_t limit = max_size / 100 * MASTER_CACHE_SHRINK_PERCENT;
+    int i;
+
+    SVN_ERR(svn_io_get_dirents3(&subdirs, cache_dir, TRUE,
+                                scratch_pool, scratch_pool));
+    for (hi = apr_hash_first(scratch_pool, subdirs); hi;
+         hi = apr_hash_next(hi)) {
+        const char *name = apr_hash_this_key(hi);
+        svn_io_dirent2_t *dirent = apr_hash_this_val(hi);
+        const char *subdir;
+        apr_hash_t *entries;
+        apr_hash_index_t *hi2;
+
+        if (dirent->kind != svn_node_dir)
+            continue;
+
+        subdir = svn_dirent_join(cache_dir, name, scratch_pool);
+        SVN_ERR(svn_io_get_dirents3(&entries, subdir, FALSE,
+                                    scratch_pool, scratch_pool));
+        for (hi2 = apr_hash_first(scratch_pool, entries); hi2;
+             hi2 = apr_hash_next(hi2)) {
+            const char *file_name = apr_hash_this_key(hi2);
+            svn_io_dirent2_t *file_dirent = apr_hash_this_val(hi2);
+            master_cache_file_t *file;
+            apr_size_t len = strlen(file_name);
+
+            if (len < 5 || strcmp(file_name + len - 5, ".body") != 0)
+                continue;
+
+            file = apr_pcalloc(scratch_pool, sizeof(*file));
+            file->body_path = svn_dirent_join(subdir, file_name,
+                                              scratch_pool);
+            file->mtime = file_dirent->mtime;
+            file->size = file_dirent->filesize;
+            APR_ARRAY_PUSH(files, master_cache_file_t *) = file;
+            total += file->size;
+        }
+    }
+
+    if (total <= max_size)
+        return SVN_NO_ERROR;
+
+    svn_sort__array(files, compare_mtime);
+    for (i = 0; i < files->nelts && total > limit; ++i) {
+        master_cache_file_t *file
+            = APR_ARRAY_IDX(files, i, master_cache_file_t *);
+        const char *body_path = file->body_path;
+        const char *hdrs_path
+            = apr_pstrcat(scratch_pool,
+                          apr_pstrndup(scratch_pool, body_path,
+                                       strlen(body_path) - 5),
+                          ".hdrs", SVN_VA_NULL);
+
+        svn_error_clear(svn_io_remove_file2(hdrs_path, TRUE, scratch_pool));
+        svn_error_clear(svn_io_remove_file2(body_path, TRUE, scratch_pool));
+        total -= file->size;
+    }
+
+    return SVN_NO_ERROR;
+}
+
+/* Set up request R for the master cache in CACHE_DIR.  Either serve it
+   from the cache or proxy it to MASTER_URI.  ROOT_DIR is the location of
+   the repository on this server. */
+static int master_cache_fixup(request_rec *r,
+                              const char *master_uri,
+                              const char *root_dir,
+                              const char *cache_dir)
+{
+    const char *seg;
+    const char *entry = NULL;
+    int rv;
+
+    seg = ap_strstr(r->uri, root_dir);
+    if (!seg)
+        return OK;
+    seg += strlen(root_dir);
+
+    if (r->method_number == M_GET) {
+        master_cache_hit_t *hit;
+        svn_error_t *err;
+
+        entry = master_cache_entry(r, cache_dir);
+        err = open_master_cache_entry(&hit, entry, r->pool);
+        if (err) {
+            /* Broken entries will eventually get evicted. */
+            svn_error_clear(err);
+            hit = NULL;
+        }
+
+        if (hit) {
+            apr_pool_userdata_setn(hit, MASTER_CACHE_HIT_KEY, NULL, r->pool);
+            r->handler = MASTER_CACHE_HANDLER;
+            return OK;
+        }
+    }
+
+    /* File contents are versioned data and must not be rewritten. */
+    rv = proxy_request_fixup(r, master_uri, seg,
+                             r->method_number != M_GET);
+    if (rv)
+        return rv;
+
+    if (entry) {
+        master_cache_ctx_t *ctx = apr_pcalloc(r->pool, sizeof(*ctx));
+        ctx->entry = entry;
+        ctx->max_size = dav_svn__get_master_cache_size(r) / 8;
+        ap_add_output_filter("SVN-MASTER-CACHE", ctx, r, r->connection);
+    }
+
+    return OK;
+}
+
+/* Return whether the response to R may be stored in the master cache. */
+static svn_boolean_t master_response_cacheable(request_rec *r)
+{
+    const char *cache_control;
+
+    if (r->main || r->header_only || r->status != HTTP_OK)
+        return FALSE;
+
+    /* Only keep what the master marked as immutable. */
+    cache_control = apr_table_get(r->headers_out, "Cache-Control");
+    if (!cache_control
+        || ap_strstr_c(cache_control, "max-age=0")
+        || ap_strstr_c(cache_control, "no-")
+        || ap_strstr_c(cache_control, "private"))
+        return FALSE;
+
+    return TRUE;
+}
+
+/* Give up storing the response body in CTX. */
+static void abort_master_cache_store(master_cache_ctx_t *ctx,
+                                     apr_pool_t *scratch_pool)
+{
+    if (ctx->file) {
+        svn_error_clear(svn_io_file_close(ctx->file, scratch_pool));
+        svn_error_clear(svn_io_remove_file2(ctx->tmp_path, TRUE,
+                                            scratch_pool));
+        ctx->file = NULL;
+    }
+}
+
+/* Turn the response to R received in CTX into a master cache entry.
+   Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *finish_master_cache_store(request_rec *r,
+                                              master_cache_ctx_t *ctx,
+                                              apr_pool_t *scratch_pool)
+{
+    const char *cache_dir = dav_svn__get_master_cache_dir(r);
+    apr_hash_t *headers = apr_hash_make(scratch_pool);
+    svn_stream_t *stream;
+    const char *tmp_path;
+    int i;
+
+    SVN_ERR(svn_io_file_close(ctx->file, scratch_pool));
+    ctx->file = NULL;
+
+    for (i = 0; cached_headers[i]; ++i) {
+        const char *value = apr_table_get(r->headers_out, cached_headers[i]);
+        if (value)
+            svn_hash_sets(headers, cached_headers[i],
+                          svn_string_create(value, scratch_pool));
+    }
+    if (r->content_type)
+        svn_hash_sets(headers, "Content-Type",
+                      svn_string_create(r->content_type, scratch_pool));
+
+    SVN_ERR(svn_stream_open_unique(&stream, &tmp_path, cache_dir,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   scratch_pool, scratch_pool));
+    SVN_ERR(svn_hash_write2(headers, stream, SVN_HASH_TERMINATOR,
+                            scratch_pool));
+    SVN_ERR(svn_stream_close(stream));
+
+    SVN_ERR(svn_io_make_dir_recursively(svn_dirent_dirname(ctx->entry,
+                                                           scratch_pool),
+                                        scratch_pool));
+    SVN_ERR(svn_io_file_rename2(ctx->tmp_path,
+                                apr_pstrcat(scratch_pool, ctx->entry,
+                                            ".body", SVN_VA_NULL),
+                                FALSE, scratch_pool));
+    SVN_ERR(svn_io_file_rename2(tmp_path,
+                                apr_pstrcat(scratch_pool, ctx->entry,
+                                            ".hdrs", SVN_VA_NULL),
+                                FALSE, scratch_pool));
+
+    if (apr_atomic_inc32(&master_cache_stores) % MASTER_CACHE_CHECK_INTERVAL
+        == 0)
+        SVN_ERR(shrink_master_cache(cache_dir,
+                                    dav_svn__get_master_cache_size(r),
+                                    scratch_pool));
+
+    return SVN_NO_ERROR;
+}
+
+apr_status_t dav_svn__master_cache_filter(ap_filter_t *f,
+                                          apr_bucket_brigade *bb)
+{
+    request_rec *r = f->r;
+    master_cache_ctx_t *ctx = f->ctx;
+    apr_bucket *bkt;
+
+    /* Decide whether to store the response once its headers are known. */
+    if (!ctx->file && !ctx->tmp_path) {
+        svn_error_t *err = NULL;
+
+        if (master_response_cacheable(r))
+            err = svn_io_open_unique_file3(&ctx->file, &ctx->tmp_path,
+                                           dav_svn__get_master_cache_dir(r),
+                                           svn_io_file_del_on_pool_cleanup,
+                                           r->pool, r->pool);
+        if (err || !ctx->file) {
+            svn_error_clear(err);
+            ap_remove_output_filter(f);
+            return ap_pass_brigade(f->next, bb);
+        }
+    }
+
+    for (bkt = APR_BRIGADE_FIRST(bb);
+         ctx->file && bkt != APR_BRIGADE_SENTINEL(bb);
+         bkt = APR_BUCKET_NEXT(bkt)) {
+        const char *data;
+        apr_size_t len;
+        svn_error_t *err;
+
+        if (APR_BUCKET_IS_EOS(bkt)) {
+            apr_pool_t *scratch_pool = svn_pool_create(r->pool);
+
+            err = finish_master_cache_store(r, ctx, scratch_pool);
+            if (err) {
+                ap_log_rerror(APLOG_MARK, APLOG_WARNING, err->apr_err, r,
+                              "Could not store response in master cache");
+                svn_error_clear(err);
+            }
+            svn_pool_destroy(scratch_pool);
+            break;
+        }
+
+        if (APR_BUCKET_IS_METADATA(bkt))
+            continue;
+
+        if (apr_bucket_read(bkt, &data, &len, APR_BLOCK_READ) != APR_SUCCESS
+            || ctx->size + (apr_off_t)len > ctx->max_size) {
+            abort_master_cache_store(ctx, r->pool);
+            break;
+        }
+
+        err = svn_io_file_write_full(ctx->file, data, len, NULL, r->pool);
+        if (err) {
+            svn_error_clear(err);
+            abort_master_cache_store(ctx, r->pool);
+            break;
+        }
+        ctx->size += len;
+    }
+
+    return ap_pass_brigade(f->next, bb);
+}
+
+int dav_svn__master_cache_handler(request_rec *r)
+{
+    master_cache_hit_t *hit;
+    apr_hash_index_t *hi;
+    apr_bucket_brigade *bb;
+    apr_bucket *bkt;
+    void *data;
+    int status;
+
+    if (!r->handler || strcmp(r->handler, MASTER_CACHE_HANDLER) != 0)
+        return DECLINED;
+
+    apr_pool_userdata_get(&data, MASTER_CACHE_HIT_KEY, r->pool);
+    hit = data;
+    if (!hit)
+        return DECLINED;
+
+    for (hi = apr_hash_first(r->pool, hit->headers); hi;
+         hi = apr_hash_next(hi)) {
+        const char *name = apr_hash_this_key(hi);
+        const svn_string_t *value = apr_hash_this_val(hi);
+
+        if (strcmp(name, "Content-Type") == 0)
+            ap_set_content_type(r, value->data);
+        else
+            apr_table_setn(r->headers_out, name, value->data);
+    }
+    ap_set_content_length(r, hit->size);
+
+    status = ap_meets_conditions(r);
+    if (status != OK)
+        return status;
+
+    /* Keep recently used entries in the cache. */
+    apr_file_mtime_set(hit->body_path, apr_time_now(), r->pool);
+
+    bb = apr_brigade_create(r->pool, r->connection->bucket_alloc);
+    apr_brigade_insert_file(bb, hit->body, 0, hit->size, r->pool);
+    bkt = apr_bucket_eos_create(r->connection->bucket_alloc);
+    APR_BRIGADE_INSERT_TAIL(bb, bkt);
+
+    if (ap_pass_brigade(r->output_filters, bb) != APR_SUCCESS)
+        return AP_FILTER_ERROR;
+
+    return OK;
+}
+
+
 int dav_svn__proxy_request_fixup(request_rec *r)
 {
-    const char *root_dir, *master_uri, *special_uri;
+    const char *root_dir, *master_uri, *special_uri, *cache_dir;
 
     root_dir = dav_svn__get_root_dir(r);
     master_uri = dav_svn__get_master_uri(r);
     special_uri = dav_svn__get_special_uri(r);
+    cache_dir = dav_svn__get_master_cache_dir(r);
+
+    if (root_dir && master_uri && cache_dir)
+        return master_cache_fixup(r, master_uri, root_dir, cache_dir);
 
     if (root_dir && master_uri) {
         const char *seg;
@@ -109,7 +601,7 @@ int dav_svn__proxy_request_fixup(request_rec *r)
                                                     "/txr/", SVN_VA_NULL))) {
                     int rv;
                     seg += strlen(root_dir);
-                    rv = proxy_request_fixup(r, master_uri, seg);
+                    rv = proxy_request_fixup(r, master_uri, seg, TRUE);
                     if (rv) return rv;
                 }
             }
@@ -126,7 +618,7 @@ int dav_svn__proxy_request_fixup(request_rec *r)
                     ap_strstr_c(seg, special_uri))) {
             int rv;
             seg += strlen(root_dir);
-            rv = proxy_request_fixup(r, master_uri, seg);
+            rv = proxy_request_fixup(r, master_uri, seg, TRUE);
             if (rv) return rv;
             return OK;
         }
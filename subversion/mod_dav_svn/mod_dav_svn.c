@@ -42,6 +42,7 @@
 #include "svn_dso.h"
 #include "mod_dav_svn.h"
 
+#include "private/svn_cache.h"
 #include "private/svn_fspath.h"
 #include "private/svn_subr_private.h"
 
@@ -67,6 +68,10 @@ typedef struct server_conf_t {
      compression level. */
   int compression_level;
 
+  /* File to append the spans of requests that carry a request ID to,
+     NULL if they should not be recorded. */
+  const char *trace_file;
+
 } server_conf_t;
 
 
@@ -101,12 +106,16 @@ typedef struct dir_conf_t {
   const char *root_dir;              /* our top-level directory */
   const char *master_uri;            /* URI to the master SVN repos */
   svn_version_t *master_version;     /* version of master server */
+  const char *master_cache_dir;      /* local cache of master responses */
+  apr_off_t master_cache_size;       /* max. size of that cache in bytes */
   const char *activities_db;         /* path to activities database(s) */
   enum conf_flag txdelta_cache;      /* whether to enable txdelta caching */
   enum conf_flag fulltext_cache;     /* whether to enable fulltext caching */
   enum conf_flag revprop_cache;      /* whether to enable revprop caching */
   enum conf_flag nodeprop_cache;     /* whether to enable nodeprop caching */
   enum conf_flag block_read;         /* whether to enable block read mode */
+  enum conf_flag listing_cache;      /* whether to cache directory listings */
+  enum conf_flag request_stats;      /* whether to log per-request stats */
   const char *hooks_env;             /* path to hook script env config file */
 } dir_conf_t;
 
@@ -119,6 +128,15 @@ extern module AP_MODULE_DECLARE_DATA dav_svn_module;
 
 /* The authz_svn provider for bypassing path authz. */
 static authz_svn__subreq_bypass_func_t pathauthz_bypass_func = NULL;
+static authz_svn__subtree_bypass_func_t pathauthz_subtree_func = NULL;
+
+/* Set by SVNInMemoryCacheShared.  The cache must then be created in the
+   parent process before any child gets forked. */
+static svn_boolean_t in_memory_cache_shared = FALSE;
+
+/* Set by SVNInMemoryCacheHugePages and SVNInMemoryCacheNUMAInterleave. */
+static svn_boolean_t in_memory_cache_huge_pages = FALSE;
+static svn_boolean_t in_memory_cache_numa_interleave = FALSE;
 
 static int
 init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
@@ -150,6 +168,29 @@ init(apr_pool_t *p, apr_pool_t *plog, apr_pool_t *ptemp, server_rec *s)
   conf = ap_get_module_config(s->module_config, &dav_svn_module);
   svn_utf_initialize2(conf->use_utf8, p);
 
+  /* Create the shared cache now, so all children inherit it.  The first
+     call to this hook only checks the configuration and the module may
+     get reloaded afterwards.  Don't allocate the cache twice then. */
+  if (in_memory_cache_shared)
+    {
+      void *data = NULL;
+      const char *key = "dav_svn_shared_cache";
+
+      apr_pool_userdata_get(&data, key, s->process->pool);
+      if (data)
+        {
+          if (svn_cache__get_global_membuffer_cache() == NULL)
+            ap_log_perror(APLOG_MARK, APLOG_WARNING, 0, p,
+                          "mod_dav_svn: could not create the shared "
+                          "in-memory cache");
+        }
+      else
+        {
+          apr_pool_userdata_set((const void *)1, key, apr_pool_cleanup_null,
+                                s->process->pool);
+        }
+    }
+
   return OK;
 }
 
@@ -219,6 +260,7 @@ merge_server_config(apr_pool_t *p, void *base, void *overrides)
   newconf = apr_pcalloc(p, sizeof(*newconf));
 
   newconf->special_uri = INHERIT_VALUE(parent, child, special_uri);
+  newconf->trace_file = INHERIT_VALUE(parent, child, trace_file);
 
   if (child->compression_level < 0)
     {
@@ -269,6 +311,9 @@ merge_dir_config(apr_pool_t *p, void *base, void *overrides)
   newconf->fs_path = INHERIT_VALUE(parent, child, fs_path);
   newconf->master_uri = INHERIT_VALUE(parent, child, master_uri);
   newconf->master_version = INHERIT_VALUE(parent, child, master_version);
+  newconf->master_cache_dir = INHERIT_VALUE(parent, child, master_cache_dir);
+  newconf->master_cache_size = INHERIT_VALUE(parent, child,
+                                             master_cache_size);
   newconf->activities_db = INHERIT_VALUE(parent, child, activities_db);
   newconf->repo_name = INHERIT_VALUE(parent, child, repo_name);
   newconf->xslt_uri = INHERIT_VALUE(parent, child, xslt_uri);
@@ -283,6 +328,8 @@ merge_dir_config(apr_pool_t *p, void *base, void *overrides)
   newconf->revprop_cache = INHERIT_VALUE(parent, child, revprop_cache);
   newconf->nodeprop_cache = INHERIT_VALUE(parent, child, nodeprop_cache);
   newconf->block_read = INHERIT_VALUE(parent, child, block_read);
+  newconf->listing_cache = INHERIT_VALUE(parent, child, listing_cache);
+  newconf->request_stats = INHERIT_VALUE(parent, child, request_stats);
   newconf->root_dir = INHERIT_VALUE(parent, child, root_dir);
   newconf->hooks_env = INHERIT_VALUE(parent, child, hooks_env);
 
@@ -357,6 +404,34 @@ SVNMasterVersion_cmd(cmd_parms *cmd, void *config, const char *arg1)
 }
 
 
+static const char *
+SVNMasterCache_cmd(cmd_parms *cmd, void *config,
+                   const char *arg1, const char *arg2)
+{
+  dir_conf_t *conf = config;
+  const char *path;
+  apr_uint64_t value = 0;
+  svn_error_t *err = svn_cstring_atoui64(&value, arg2);
+  if (err)
+    {
+      svn_error_clear(err);
+      return "Invalid decimal number for the SVN master cache size.";
+    }
+
+  if (value == 0)
+    return "SVNMasterCache size must be at least 1 MB.";
+
+  path = ap_server_root_relative(cmd->pool, arg1);
+  if (path == NULL)
+    return "Invalid path for the SVN master cache.";
+
+  conf->master_cache_dir = svn_dirent_internal_style(path, cmd->pool);
+  conf->master_cache_size = (apr_off_t)(value * 0x100000);
+
+  return NULL;
+}
+
+
 static const char *
 SVNActivitiesDB_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -452,6 +527,13 @@ SVNPathAuthz_cmd(cmd_parms *cmd, void *config, const char *arg1)
                                AUTHZ_SVN__SUBREQ_BYPASS_PROV_NAME,
                                AUTHZ_SVN__SUBREQ_BYPASS_PROV_VER);
         }
+      if (pathauthz_subtree_func == NULL)
+        {
+          pathauthz_subtree_func =
+            ap_lookup_provider(AUTHZ_SVN__SUBREQ_BYPASS_PROV_GRP,
+                               AUTHZ_SVN__SUBTREE_BYPASS_PROV_NAME,
+                               AUTHZ_SVN__SUBTREE_BYPASS_PROV_VER);
+        }
     }
   else if (apr_strnatcasecmp("on", arg1) == 0)
     {
@@ -604,6 +686,32 @@ SVNBlockRead_cmd(cmd_parms *cmd, void *config, int arg)
   return NULL;
 }
 
+static const char *
+SVNCacheListings_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  dir_conf_t *conf = config;
+
+  if (arg)
+    conf->listing_cache = CONF_FLAG_ON;
+  else
+    conf->listing_cache = CONF_FLAG_OFF;
+
+  return NULL;
+}
+
+static const char *
+SVNRequestStatistics_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  dir_conf_t *conf = config;
+
+  if (arg)
+    conf->request_stats = CONF_FLAG_ON;
+  else
+    conf->request_stats = CONF_FLAG_OFF;
+
+  return NULL;
+}
+
 static const char *
 SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -624,6 +732,90 @@ SVNInMemoryCacheSize_cmd(cmd_parms *cmd, void *config, const char *arg1)
   return NULL;
 }
 
+static const char *
+SVNInMemoryCacheShared_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  in_memory_cache_shared = arg;
+  svn_cache__set_global_membuffer_shared(arg);
+
+  return NULL;
+}
+
+static const char *
+SVNInMemoryCacheHugePages_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  in_memory_cache_huge_pages = arg;
+  svn_cache__set_global_membuffer_memory_hints(
+      in_memory_cache_huge_pages, in_memory_cache_numa_interleave);
+
+  return NULL;
+}
+
+static const char *
+SVNInMemoryCacheNUMAInterleave_cmd(cmd_parms *cmd, void *config, int arg)
+{
+  in_memory_cache_numa_interleave = arg;
+  svn_cache__set_global_membuffer_memory_hints(
+      in_memory_cache_huge_pages, in_memory_cache_numa_interleave);
+
+  return NULL;
+}
+
+static const char *
+SVNInMemoryCachePolicy_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  if (apr_strnatcasecmp("priority", arg1) == 0)
+    svn_cache__set_global_membuffer_policy(
+        svn_cache__membuffer_policy_priority);
+  else if (apr_strnatcasecmp("tinylfu", arg1) == 0)
+    svn_cache__set_global_membuffer_policy(
+        svn_cache__membuffer_policy_tinylfu);
+  else
+    return "Unrecognized value for SVNInMemoryCachePolicy directive";
+
+  return NULL;
+}
+
+static const char *
+SVNCacheSpillFile_cmd(cmd_parms *cmd, void *config,
+                      const char *arg1, const char *arg2)
+{
+  const char *path;
+  apr_uint64_t value = 0;
+  svn_error_t *err = svn_cstring_atoui64(&value, arg2);
+  if (err)
+    {
+      svn_error_clear(err);
+      return "Invalid decimal number for the SVN cache spill file size.";
+    }
+
+  /* The path must remain valid for the lifetime of the process. */
+  path = ap_server_root_relative(cmd->server->process->pool, arg1);
+  if (path == NULL)
+    return "Invalid path for the SVN cache spill file.";
+
+  path = svn_dirent_internal_style(path, cmd->server->process->pool);
+  svn_cache__set_global_membuffer_spill_file(path, value * 0x100000);
+
+  return NULL;
+}
+
+static const char *
+SVNTraceFile_cmd(cmd_parms *cmd, void *config, const char *arg1)
+{
+  server_conf_t *conf;
+  const char *path = ap_server_root_relative(cmd->pool, arg1);
+
+  if (path == NULL)
+    return "Invalid path for the SVN trace file.";
+
+  conf = ap_get_module_config(cmd->server->module_config,
+                              &dav_svn_module);
+  conf->trace_file = svn_dirent_internal_style(path, cmd->pool);
+
+  return NULL;
+}
+
 static const char *
 SVNCompressionLevel_cmd(cmd_parms *cmd, void *config, const char *arg1)
 {
@@ -790,6 +982,26 @@ dav_svn__get_master_uri(request_rec *r)
 }
 
 
+const char *
+dav_svn__get_master_cache_dir(request_rec *r)
+{
+  dir_conf_t *conf;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+  return conf->master_uri ? conf->master_cache_dir : NULL;
+}
+
+
+apr_off_t
+dav_svn__get_master_cache_size(request_rec *r)
+{
+  dir_conf_t *conf;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+  return conf->master_cache_size;
+}
+
+
 svn_version_t *
 dav_svn__get_master_version(request_rec *r)
 {
@@ -965,6 +1177,19 @@ dav_svn__get_pathauthz_bypass(request_rec *r)
 }
 
 
+authz_svn__subtree_bypass_func_t
+dav_svn__get_pathauthz_subtree_bypass(request_rec *r)
+{
+  dir_conf_t *conf;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+
+  if (conf->path_authz_method == CONF_PATHAUTHZ_BYPASS)
+    return pathauthz_subtree_func;
+  return NULL;
+}
+
+
 svn_boolean_t
 dav_svn__get_list_parentpath_flag(request_rec *r)
 {
@@ -1035,6 +1260,25 @@ dav_svn__get_block_read_flag(request_rec *r)
   return conf->block_read == CONF_FLAG_ON;
 }
 
+svn_boolean_t
+dav_svn__get_listing_cache_flag(request_rec *r)
+{
+  dir_conf_t *conf;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+  return conf->listing_cache == CONF_FLAG_ON;
+}
+
+
+dav_svn__request_stats_t *
+dav_svn__get_request_stats(request_rec *r)
+{
+  while (r->main)
+    r = r->main;
+
+  return ap_get_module_config(r->request_config, &dav_svn_module);
+}
+
 int
 dav_svn__get_compression_level(request_rec *r)
 {
@@ -1053,6 +1297,16 @@ dav_svn__get_compression_level(request_rec *r)
     }
 }
 
+const char *
+dav_svn__get_trace_file(request_rec *r)
+{
+  server_conf_t *conf;
+
+  conf = ap_get_module_config(r->server->module_config,
+                              &dav_svn_module);
+  return conf->trace_file;
+}
+
 const char *
 dav_svn__get_hooks_env(request_rec *r)
 {
@@ -1335,6 +1589,14 @@ static const command_rec cmds[] =
                 "specifies the Subversion release version of a master "
                 "Subversion server "),
 
+  /* per directory/location */
+  AP_INIT_TAKE2("SVNMasterCache", SVNMasterCache_cmd, NULL, ACCESS_CONF,
+                "turns this slave into a caching proxy for SVNMasterURI: "
+                "all requests get forwarded to the master and immutable "
+                "file contents are kept in the given local directory up "
+                "to the given size in MB.  No local replica of the "
+                "repository is used (default is none)."),
+
   /* per directory/location */
   AP_INIT_TAKE1("SVNActivitiesDB", SVNActivitiesDB_cmd, NULL, ACCESS_CONF,
                 "specifies the location in the filesystem in which the "
@@ -1390,6 +1652,22 @@ static const command_rec cmds[] =
                "caches (see SVNInMemoryCacheSize) have been configured."
                "(default is Off)."),
 
+  /* per directory/location */
+  AP_INIT_FLAG("SVNCacheListings", SVNCacheListings_cmd, NULL,
+               ACCESS_CONF|RSRC_CONF,
+               "speeds up repeated GETs on directories at fixed revisions "
+               "by caching the generated listings per user.  Changes to "
+               "path-based authz rules may not affect cached listings "
+               "until the server is restarted (default is Off)."),
+
+  /* per directory/location */
+  AP_INIT_FLAG("SVNRequestStatistics", SVNRequestStatistics_cmd, NULL,
+               ACCESS_CONF|RSRC_CONF,
+               "makes per-request statistics like in-memory cache hits "
+               "and authz checks available to LogFormat as SVN-CACHE-GETS, "
+               "SVN-CACHE-HITS, SVN-AUTHZ-CHECKS and SVN-DELTA-USEC "
+               "environment variables (default is Off)."),
+
   /* per server */
   AP_INIT_TAKE1("SVNInMemoryCacheSize", SVNInMemoryCacheSize_cmd, NULL,
                 RSRC_CONF,
@@ -1397,12 +1675,49 @@ static const command_rec cmds[] =
                 "in-memory object cache (default value is 16384; 0 switches "
                 "to dynamically sized caches)."),
   /* per server */
+  AP_INIT_FLAG("SVNInMemoryCacheShared", SVNInMemoryCacheShared_cmd, NULL,
+               RSRC_CONF,
+               "shares the in-memory object cache (see SVNInMemoryCacheSize) "
+               "between all server processes instead of using one per "
+               "process (default is Off)."),
+  /* per server */
+  AP_INIT_FLAG("SVNInMemoryCacheHugePages", SVNInMemoryCacheHugePages_cmd,
+               NULL, RSRC_CONF,
+               "backs the in-memory object cache with huge pages where "
+               "supported by the platform (default is Off)."),
+  /* per server */
+  AP_INIT_FLAG("SVNInMemoryCacheNUMAInterleave",
+               SVNInMemoryCacheNUMAInterleave_cmd, NULL, RSRC_CONF,
+               "spreads the in-memory object cache evenly across all NUMA "
+               "nodes where supported by the platform (default is Off)."),
+  /* per server */
+  AP_INIT_TAKE1("SVNInMemoryCachePolicy", SVNInMemoryCachePolicy_cmd, NULL,
+                RSRC_CONF,
+                "specifies the eviction policy of the in-memory object "
+                "cache: Priority or TinyLFU.  The latter protects "
+                "frequently used data from large one-off scans "
+                "(default is Priority)."),
+  /* per server */
+  AP_INIT_TAKE2("SVNCacheSpillFile", SVNCacheSpillFile_cmd, NULL,
+                RSRC_CONF,
+                "specifies a file on local disk and its size in MB that "
+                "keeps items evicted from the in-memory object cache "
+                "across server restarts.  Each process uses its own file; "
+                "concurrent processes append .1, .2 etc. to the name.  Not "
+                "used with SVNInMemoryCacheShared (default is none)."),
+  /* per server */
   AP_INIT_TAKE1("SVNCompressionLevel", SVNCompressionLevel_cmd, NULL,
                 RSRC_CONF,
                 "specifies the compression level used before sending file "
                 "content over the network (0 for no compression, 9 for "
                 "maximum, 5 is default)."),
 
+  /* per server */
+  AP_INIT_TAKE1("SVNTraceFile", SVNTraceFile_cmd, NULL,
+                RSRC_CONF,
+                "specifies a file to append the timing of requests to "
+                "for clients that send a request ID (default is none)."),
+
   /* per server */
   AP_INIT_FLAG("SVNUseUTF8",
                SVNUseUTF8_cmd, NULL,
@@ -1431,6 +1746,59 @@ static dav_provider provider =
 };
 
 
+/* Start collecting statistics for request R, if configured.  Implements
+   Apache's fixups hook. */
+static int
+start_request_stats(request_rec *r)
+{
+  dir_conf_t *conf;
+  dav_svn__request_stats_t *stats;
+
+  conf = ap_get_module_config(r->per_dir_config, &dav_svn_module);
+  if (r->main || conf->request_stats != CONF_FLAG_ON)
+    return DECLINED;
+
+  stats = apr_pcalloc(r->pool, sizeof(*stats));
+  svn_cache__membuffer_get_global_counters(&stats->cache_gets,
+                                           &stats->cache_hits);
+  ap_set_module_config(r->request_config, &dav_svn_module, stats);
+
+  return DECLINED;
+}
+
+/* Make the statistics collected for request R available to mod_log_config.
+   Implements Apache's log_transaction hook. */
+static int
+log_request_stats(request_rec *r)
+{
+  dav_svn__request_stats_t *stats
+    = ap_get_module_config(r->request_config, &dav_svn_module);
+  apr_uint64_t gets;
+  apr_uint64_t hits;
+
+  if (stats == NULL)
+    return DECLINED;
+
+  /* The cache is shared by all requests of this process, so concurrent
+     requests will be included in the difference. */
+  svn_cache__membuffer_get_global_counters(&gets, &hits);
+  apr_table_set(r->subprocess_env, "SVN-CACHE-GETS",
+                apr_psprintf(r->pool, "%" APR_UINT64_T_FMT,
+                             gets - stats->cache_gets));
+  apr_table_set(r->subprocess_env, "SVN-CACHE-HITS",
+                apr_psprintf(r->pool, "%" APR_UINT64_T_FMT,
+                             hits - stats->cache_hits));
+  apr_table_set(r->subprocess_env, "SVN-AUTHZ-CHECKS",
+                apr_psprintf(r->pool, "%" APR_UINT64_T_FMT,
+                             stats->authz_checks));
+  apr_table_set(r->subprocess_env, "SVN-DELTA-USEC",
+                apr_psprintf(r->pool, "%" APR_TIME_T_FMT,
+                             stats->delta_time));
+
+  return DECLINED;
+}
+
+
 /* Implements the #register_hooks method of Apache's #module vtable. */
 static void
 register_hooks(apr_pool_t *pconf)
@@ -1469,12 +1837,22 @@ register_hooks(apr_pool_t *pconf)
   ap_register_input_filter("IncomingRewrite", dav_svn__location_in_filter,
                            NULL, AP_FTYPE_CONTENT_SET);
   ap_hook_fixups(dav_svn__proxy_request_fixup, NULL, NULL, APR_HOOK_MIDDLE);
+  ap_register_output_filter("SVN-MASTER-CACHE",
+                            dav_svn__master_cache_filter, NULL,
+                            AP_FTYPE_CONTENT_SET + 5);
+  ap_hook_handler(dav_svn__master_cache_handler, NULL, NULL,
+                  APR_HOOK_FIRST);
   /* translate_name hook is LAST so that it doesn't interfere with modules
    * like mod_alias that are MIDDLE. */
   ap_hook_translate_name(dav_svn__translate_name, NULL, NULL, APR_HOOK_LAST);
   /* map_to_storage hook is LAST to avoid interferring with mod_http's
    * handling of OPTIONS and TRACE. */
   ap_hook_map_to_storage(dav_svn__map_to_storage, NULL, NULL, APR_HOOK_LAST);
+
+  /* per-request statistics; must be set before mod_log_config runs. */
+  ap_hook_fixups(start_request_stats, NULL, NULL, APR_HOOK_FIRST);
+  ap_hook_log_transaction(log_request_stats, NULL, NULL,
+                          APR_HOOK_REALLY_FIRST);
 }
 
 
@@ -323,14 +323,14 @@ log_revision_receiver(void *baton,
   SVN_ERR(dav_svn__brigade_puts(lrb->bb, lrb->output,
                                 "</S:log-item>" DEBUG_CR));
 
-  /* In general APR will flush the brigade every 8000 bytes through the filter
-     stack, but log items may not be generated that fast, especially in
-     combination with authz and busy servers. We now explictly flush after
-     log-item 4, 16, 64 and 256 to produce a few results fast.
+  /* In general our output helpers will flush the brigade every 64k through
+     the filter stack, but log items may not be generated that fast,
+     especially in combination with authz and busy servers. We now explictly
+     flush after log-item 4, 16, 64 and 256 to produce a few results fast.
 
      This introduces 4 full flushes of our brigade and the installed output
      filters at growing intervals and then falls back to the standard
-     buffering of 8000 bytes + whatever buffers are added in output filters. */
+     buffering of 64k + whatever buffers are added in output filters. */
   lrb->result_count++;
   if (lrb->result_count == lrb->next_forced_flush)
     {
@@ -53,10 +53,13 @@
 #include "mod_dav_svn.h"
 #include "svn_ra.h"  /* for SVN_RA_CAPABILITY_* */
 #include "svn_dirent_uri.h"
+#include "private/svn_cache.h"
 #include "private/svn_log.h"
 #include "private/svn_fspath.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_sorts_private.h"
+#include "private/svn_subr_private.h"
+#include "private/svn_trace.h"
 
 #include "dav_svn.h"
 
@@ -1768,7 +1771,12 @@ negotiate_encoding_prefs(request_rec *r, int *svndiff_version)
     {
       struct accept_rec rec = APR_ARRAY_IDX(encoding_prefs, i,
                                             struct accept_rec);
-      if (strcmp(rec.name, "svndiff1") == 0)
+      if (strcmp(rec.name, "svndiff2") == 0 && svn__lz4_supported())
+        {
+          *svndiff_version = 2;
+          break;
+        }
+      else if (strcmp(rec.name, "svndiff1") == 0)
         {
           *svndiff_version = 1;
           break;
@@ -2116,6 +2124,59 @@ parse_querystring(request_rec *r, const char *query,
   return NULL;
 }
 
+/* Baton for end_request_trace(). */
+typedef struct request_trace_baton_t
+{
+  request_rec *r;
+  svn_repos_t *repos;
+  svn_trace__t *trace;
+} request_trace_baton_t;
+
+/* Pool cleanup function recording the span of the request in DATA, a
+   request_trace_baton_t, and detaching its trace from the repository,
+   which remains cached for the connection. */
+static apr_status_t
+end_request_trace(void *data)
+{
+  request_trace_baton_t *baton = data;
+
+  svn_trace__span(baton->trace, "mod_dav_svn", baton->r->method,
+                  baton->r->uri, baton->r->request_time);
+  svn_repos__set_trace(baton->repos, NULL);
+
+  return APR_SUCCESS;
+}
+
+/* If the client sent a request ID with R, record the work done on REPOS
+   for R under that ID until the request has been completed. */
+static void
+set_request_trace(request_rec *r,
+                  svn_repos_t *repos)
+{
+  const char *id = apr_table_get(r->headers_in, SVN_DAV_REQUEST_ID_HEADER);
+  request_trace_baton_t *baton;
+  void *userdata;
+
+  /* The repository of a sub-request is the one of the main request. */
+  if (!id || r->main || !svn_trace__valid_request_id(id))
+    return;
+
+  /* Resources may get looked up multiple times per request. */
+  apr_pool_userdata_get(&userdata, "mod_dav_svn:trace", r->pool);
+  if (userdata)
+    return;
+
+  baton = apr_palloc(r->pool, sizeof(*baton));
+  baton->r = r;
+  baton->repos = repos;
+  baton->trace = svn_trace__create(dav_svn__get_trace_file(r), id, r->pool);
+  svn_repos__set_trace(repos, baton->trace);
+  apr_pool_userdata_setn(baton, "mod_dav_svn:trace", NULL, r->pool);
+
+  /* Run before the trace's pool gets destroyed. */
+  apr_pool_pre_cleanup_register(r->pool, baton, end_request_trace);
+}
+
 static dav_error *
 get_resource(request_rec *r,
              const char *root_path,
@@ -2442,6 +2503,8 @@ get_resource(request_rec *r,
                                        HTTP_INTERNAL_SERVER_ERROR, r);
     }
 
+  set_request_trace(r, repos->repos);
+
   /* cache the filesystem object */
   repos->fs = svn_repos_fs(repos->repos);
 
@@ -3049,6 +3112,23 @@ dav_svn__getetag(const dav_resource *resource, apr_pool_t *pool)
 
   /* ### what kind of etag to return for activities, etc.? */
 
+  /* The contents of a file are fully determined by its SHA-1 checksum.
+     Using that as a strong ETag allows caches to recognize identical
+     contents and to resume downloads across revisions. */
+  if (! resource->collection && ! resource->info->keyword_subst)
+    {
+      svn_checksum_t *checksum;
+
+      serr = svn_fs_file_checksum(&checksum, svn_checksum_sha1,
+                                  resource->info->root.root,
+                                  resource->info->repos_path, FALSE, pool);
+      if (serr == NULL && checksum != NULL)
+        return apr_psprintf(pool, "\"%s\"",
+                            svn_checksum_to_cstring(checksum, pool));
+
+      svn_error_clear(serr);
+    }
+
   if ((serr = svn_fs_node_created_rev(&created_rev, resource->info->root.root,
                                       resource->info->repos_path,
                                       pool)))
@@ -3101,12 +3181,81 @@ is_cacheable(request_rec *r, const dav_resource *resource)
       return FALSE;
 }
 
+/* Helper for set_headers().  If request R asks for a single byte range
+ * of a file with LENGTH bytes and ETAG, set *START and *RANGE_LENGTH to
+ * that range and return TRUE.  Return FALSE for anything else, including
+ * multiple and unsatisfiable ranges; httpd's byterange filter will take
+ * care of those. */
+static svn_boolean_t
+get_single_range(apr_off_t *start,
+                 apr_off_t *range_length,
+                 request_rec *r,
+                 svn_filesize_t length,
+                 const char *etag)
+{
+  const char *range = apr_table_get(r->headers_in, "Range");
+  const char *if_range = apr_table_get(r->headers_in, "If-Range");
+  const char *dash;
+  char *end;
+  apr_int64_t first = -1;
+  apr_int64_t last = -1;
+
+  if (range == NULL || length <= 0
+      || strncmp(range, "bytes=", 6) != 0
+      || strchr(range, ',') != NULL)
+    return FALSE;
+
+  /* If the client's copy is out of date, it needs the whole file. */
+  if (if_range && strcmp(if_range, etag) != 0)
+    return FALSE;
+
+  range += 6;
+  dash = strchr(range, '-');
+  if (dash == NULL)
+    return FALSE;
+
+  if (dash != range)
+    {
+      first = apr_strtoi64(range, &end, 10);
+      if (end != dash || first < 0)
+        return FALSE;
+    }
+  if (dash[1] != '\0')
+    {
+      last = apr_strtoi64(dash + 1, &end, 10);
+      if (*end != '\0' || last < 0)
+        return FALSE;
+    }
+
+  if (first < 0)
+    {
+      /* "bytes=-N" requests the last N bytes. */
+      if (last <= 0)
+        return FALSE;
+      first = last < length ? length - last : 0;
+      last = length - 1;
+    }
+  else if (last < 0 || last >= length)
+    {
+      last = length - 1;
+    }
+
+  if (first > last || first >= length)
+    return FALSE;
+
+  *start = (apr_off_t)first;
+  *range_length = (apr_off_t)(last - first + 1);
+
+  return TRUE;
+}
+
 static dav_error *
 set_headers(request_rec *r, const dav_resource *resource)
 {
   svn_error_t *serr;
   svn_filesize_t length;
   const char *mimetype = NULL;
+  const char *etag;
 
   /* As version resources don't change, encourage caching. */
   if (is_cacheable(r, resource))
@@ -3119,8 +3268,8 @@ set_headers(request_rec *r, const dav_resource *resource)
     return NULL;
 
   /* generate our etag and place it into the output */
-  apr_table_setn(r->headers_out, "ETag",
-                 dav_svn__getetag(resource, resource->pool));
+  etag = dav_svn__getetag(resource, resource->pool);
+  apr_table_setn(r->headers_out, "ETag", etag);
 
   /* we accept byte-ranges */
   apr_table_setn(r->headers_out, "Accept-Ranges", "bytes");
@@ -3224,6 +3373,28 @@ set_headers(request_rec *r, const dav_resource *resource)
                                           resource->pool);
             }
           ap_set_content_length(r, (apr_off_t) length);
+
+          /* Serve single ranges of immutable files directly instead of
+             letting the byterange filter discard the rest of the file. */
+          if (r->method_number == M_GET
+              && is_cacheable(r, resource)
+              && get_single_range(&resource->info->range_start,
+                                  &resource->info->range_length,
+                                  r, length, etag))
+            {
+              apr_off_t range_end = resource->info->range_start
+                                  + resource->info->range_length - 1;
+
+              apr_table_setn(r->headers_out, "Content-Range",
+                             apr_psprintf(r->pool,
+                                          "bytes %" APR_OFF_T_FMT
+                                          "-%" APR_OFF_T_FMT
+                                          "/%" SVN_FILESIZE_T_FMT,
+                                          resource->info->range_start,
+                                          range_end, length));
+              ap_set_content_length(r, resource->info->range_length);
+              r->status = HTTP_PARTIAL_CONTENT;
+            }
         }
     }
 
@@ -3514,6 +3685,57 @@ emit_collection_tail(const dav_resource *resource,
 }
 
 
+/* Set *CACHE to the cache of generated directory listings and *KEY to
+   the key of the listing of RESOURCE in it, as produced with GEN_HTML.
+   Set *CACHE to NULL, if RESOURCE's listing shall not be cached.
+
+   Only listings of directories in committed revisions are cached.  The
+   key includes the authenticated user because the listing depends on
+   the user's read permissions.  Allocate the results in POOL. */
+static svn_error_t *
+get_listing_cache(svn_cache__t **cache,
+                  const char **key,
+                  const dav_resource *resource,
+                  int gen_html,
+                  apr_pool_t *pool)
+{
+  request_rec *r = resource->info->r;
+  const char *uuid;
+  const char *user;
+
+  *cache = NULL;
+  *key = NULL;
+
+  if (resource->type == DAV_RESOURCE_TYPE_WORKING
+      || resource->info->restype == DAV_SVN_RESTYPE_PARENTPATH_COLLECTION
+      || !resource->info->root.root
+      || !svn_fs_is_revision_root(resource->info->root.root)
+      || !dav_svn__get_listing_cache_flag(r)
+      || svn_cache__get_global_membuffer_cache() == NULL)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_fs_get_uuid(resource->info->repos->fs, &uuid, pool));
+  user = r->user ? r->user : "";
+
+  /* The request URI covers the repository location as well as any
+     query parameters that may affect the generated output. */
+  *key = apr_psprintf(pool, "%s:%ld:%d:%" APR_SIZE_T_FMT ":%s%s",
+                      uuid,
+                      svn_fs_revision_root_revision(resource->info->root.root),
+                      gen_html, strlen(r->unparsed_uri), r->unparsed_uri,
+                      user);
+
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            cache, svn_cache__get_global_membuffer_cache(),
+            NULL, NULL, APR_HASH_KEY_STRING,
+            "mod_dav_svn:listing:",
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+            FALSE, FALSE, pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+
 static dav_error *
 deliver(const dav_resource *resource, ap_filter_t *unused)
 {
@@ -3542,6 +3764,10 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
       apr_pool_t *iterpool;
       apr_array_header_t *sorted;
       svn_revnum_t dir_rev = SVN_INVALID_REVNUM;
+      svn_cache__t *listing_cache;
+      const char *listing_key;
+      svn_stringbuf_t *listing = NULL;
+      dav_svn__output *real_output = output;
       int i;
 
       /* <svn version="1.3.0 (dev-build)"
@@ -3555,6 +3781,62 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
          </svn> */
 
 
+      bb = apr_brigade_create(resource->pool,
+                              dav_svn__output_get_bucket_alloc(output));
+
+      /* Listings of committed directories don't change, except for
+         changes to the authz rules.  Serve them from the cache, if
+         enabled. */
+      serr = get_listing_cache(&listing_cache, &listing_key, resource,
+                               gen_html, resource->pool);
+      if (serr != NULL)
+        {
+          svn_error_clear(serr);
+          listing_cache = NULL;
+        }
+
+      if (listing_cache)
+        {
+          svn_boolean_t found;
+          void *cached;
+
+          serr = svn_cache__get(&cached, &found, listing_cache, listing_key,
+                                resource->pool);
+          if (serr != NULL)
+            {
+              svn_error_clear(serr);
+              found = FALSE;
+            }
+
+          if (found)
+            {
+              listing = cached;
+              serr = dav_svn__brigade_write(bb, output, listing->data,
+                                            listing->len);
+              if (serr != NULL)
+                return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                            "could not output collection",
+                                            resource->pool);
+
+              bkt = apr_bucket_eos_create(
+                      dav_svn__output_get_bucket_alloc(output));
+              APR_BRIGADE_INSERT_TAIL(bb, bkt);
+              serr = dav_svn__output_pass_brigade(output, bb);
+              if (serr != NULL)
+                return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                            "Could not write EOS to filter.",
+                                            resource->pool);
+
+              return NULL;
+            }
+
+          /* Generate the listing into a buffer first. */
+          listing = svn_stringbuf_create_empty(resource->pool);
+          output = dav_svn__output_create_stringbuf(resource->info->r,
+                                                    listing,
+                                                    resource->pool);
+        }
+
       /* ### TO-DO:  check for a new mod_dav_svn directive here also. */
       if (resource->info->restype == DAV_SVN_RESTYPE_PARENTPATH_COLLECTION)
         {
@@ -3624,9 +3906,6 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
                                         resource->pool);
         }
 
-      bb = apr_brigade_create(resource->pool,
-                              dav_svn__output_get_bucket_alloc(output));
-
       serr = emit_collection_head(resource, bb, output, gen_html,
                                   resource->pool);
       if (serr != NULL)
@@ -3688,6 +3967,21 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
                                     "could not output collection",
                                     resource->pool);
 
+      if (listing)
+        {
+          /* Remember the listing and send it for real. */
+          svn_error_clear(svn_cache__set(listing_cache, listing_key, listing,
+                                         resource->pool));
+
+          output = real_output;
+          serr = dav_svn__brigade_write(bb, output, listing->data,
+                                        listing->len);
+          if (serr != NULL)
+            return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                        "could not output collection",
+                                        resource->pool);
+        }
+
       bkt = apr_bucket_eos_create(dav_svn__output_get_bucket_alloc(output));
       APR_BRIGADE_INSERT_TAIL(bb, bkt);
       serr = dav_svn__output_pass_brigade(output, bb);
@@ -3713,6 +4007,8 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
       svn_txdelta_window_handler_t handler;
       void * h_baton;
       diff_ctx_t dc = { 0 };
+      dav_svn__request_stats_t *stats;
+      apr_time_t start;
 
       /* First order of business is to parse it. */
       serr = dav_svn__simple_parse_uri(&info, resource,
@@ -3777,10 +4073,16 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
           /* got everything set up. read in delta windows and shove them into
              the handler, which pushes data into the output stream, which goes
              to the network. */
+          stats = dav_svn__get_request_stats(resource->info->r);
+          start = stats ? apr_time_now() : 0;
+
           serr = svn_txdelta_send_txstream(txd_stream, handler, h_baton,
                                            resource->pool);
           apr_brigade_destroy(bb);
 
+          if (stats)
+            stats->delta_time += apr_time_now() - start;
+
           if (serr != NULL)
             return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
                                         "could not deliver the txdelta stream",
@@ -3799,6 +4101,7 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
     {
       svn_stream_t *stream;
       char *block;
+      apr_off_t remaining = -1;
 
       serr = svn_fs_file_contents(&stream,
                                   resource->info->root.root,
@@ -3882,6 +4185,21 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
             }
         }
 
+      /* Skip to the start of the requested byte range, if any.  FS
+         streams don't support seeking, so this may still have to read
+         the data, but at least it doesn't get sent. */
+      if (resource->info->range_length > 0)
+        {
+          apr_size_t skip = (apr_size_t)resource->info->range_start;
+
+          remaining = resource->info->range_length;
+          serr = svn_stream_skip(stream, skip);
+          if (serr != NULL)
+            return dav_svn__convert_err(serr, HTTP_INTERNAL_SERVER_ERROR,
+                                        "could not skip to the requested "
+                                        "range", resource->pool);
+        }
+
       /* ### one day in the future, we can create a custom bucket type
          ### which will read from the FS stream on demand */
 
@@ -3889,9 +4207,12 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
       bb = apr_brigade_create(resource->pool,
                               dav_svn__output_get_bucket_alloc(output));
 
-      while (1) {
+      while (remaining != 0) {
         apr_size_t bufsize = SVN__STREAM_CHUNK_SIZE;
 
+        if (remaining > 0 && remaining < bufsize)
+          bufsize = (apr_size_t)remaining;
+
         /* read from the FS ... */
         serr = svn_stream_read_full(stream, block, &bufsize);
         if (serr != NULL)
@@ -3904,6 +4225,9 @@ deliver(const dav_resource *resource, ap_filter_t *unused)
         if (bufsize == 0)
           break;
 
+        if (remaining > 0)
+          remaining -= bufsize;
+
         /* write to the filter ... */
         bkt = apr_bucket_transient_create(
           block, bufsize, dav_svn__output_get_bucket_alloc(output));
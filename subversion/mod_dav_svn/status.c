@@ -70,6 +70,7 @@
 int dav_svn__status(request_rec *r)
 {
   svn_cache__info_t *info;
+  svn_membuffer_t *membuffer;
   svn_string_t *text_stats;
   apr_array_header_t *lines;
   int i;
@@ -113,7 +114,30 @@ int dav_svn__status(request_rec *r)
       ap_rvputs(r, "<dt>", line, "</dt>\n", SVN_VA_NULL);
     }
 
-  ap_rvputs(r, "</dl></body></html>\n", SVN_VA_NULL);
+  ap_rvputs(r, "</dl>\n", SVN_VA_NULL);
+
+  /* Break the numbers down by cache, i.e. by key prefix. */
+  membuffer = svn_cache__get_global_membuffer_cache();
+  if (membuffer)
+    {
+      apr_array_header_t *infos;
+      svn_error_t *err = svn_cache__membuffer_get_prefix_info(&infos,
+                                                              membuffer,
+                                                              FALSE,
+                                                              r->pool);
+      if (err)
+        svn_error_clear(err);
+      else
+        ap_rvputs(r,
+                  "<h2>Cache Usage by Prefix</h2>\n<pre>\n",
+                  ap_escape_html(r->pool,
+                                 svn_cache__format_prefix_info(infos,
+                                                               r->pool)
+                                   ->data),
+                  "</pre>\n", SVN_VA_NULL);
+    }
+
+  ap_rvputs(r, "</body></html>\n", SVN_VA_NULL);
 
   return 0;
 }
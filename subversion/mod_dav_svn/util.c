@@ -469,9 +469,20 @@ dav_svn__find_ns(const apr_array_header_t *namespaces, const char *uri)
 /*** Output helpers ***/
 
 
+/* Collect at least this many bytes of response data before handing them
+   to the output filters.  Small writes are gathered in APR's 8k heap
+   buckets; passing each of them down individually wastes a lot of CPU
+   in the filter chain.  Since the core output filter blocks once it has
+   a certain amount of data pending for the client, this also bounds the
+   memory that a slow client can pin. */
+#define OUTPUT_FLUSH_THRESHOLD 0x10000
+
 struct dav_svn__output
 {
   request_rec *r;
+
+  /* If not NULL, collect all output here instead of passing it on. */
+  svn_stringbuf_t *buffer;
 };
 
 dav_svn__output *
@@ -483,6 +494,47 @@ dav_svn__output_create(request_rec *r,
   return output;
 }
 
+dav_svn__output *
+dav_svn__output_create_stringbuf(request_rec *r,
+                                 svn_stringbuf_t *buffer,
+                                 apr_pool_t *pool)
+{
+  dav_svn__output *output = dav_svn__output_create(r, pool);
+  output->buffer = buffer;
+  return output;
+}
+
+/* Implements apr_brigade_flush for the brigade BB written to the
+   dav_svn__output CTX.  Pass BB down the filter chain only if it has
+   grown beyond OUTPUT_FLUSH_THRESHOLD.  Otherwise, make sure that it
+   doesn't reference the caller's memory any longer. */
+static apr_status_t
+output_flush(apr_bucket_brigade *bb, void *ctx)
+{
+  dav_svn__output *output = ctx;
+  apr_off_t len;
+  apr_bucket *e;
+  apr_status_t status;
+
+  status = apr_brigade_length(bb, FALSE, &len);
+  if (status || len < 0 || len >= OUTPUT_FLUSH_THRESHOLD)
+    return ap_filter_flush(bb, output->r->output_filters);
+
+  for (e = APR_BRIGADE_FIRST(bb);
+       e != APR_BRIGADE_SENTINEL(bb);
+       e = APR_BUCKET_NEXT(e))
+    {
+      if (APR_BUCKET_IS_TRANSIENT(e))
+        {
+          status = apr_bucket_setaside(e, output->r->pool);
+          if (status)
+            return status;
+        }
+    }
+
+  return APR_SUCCESS;
+}
+
 apr_bucket_alloc_t *
 dav_svn__output_get_bucket_alloc(dav_svn__output *output)
 {
@@ -495,6 +547,12 @@ dav_svn__output_pass_brigade(dav_svn__output *output,
 {
   apr_status_t status;
 
+  if (output->buffer)
+    {
+      apr_brigade_cleanup(bb);
+      return SVN_NO_ERROR;
+    }
+
   status = ap_pass_brigade(output->r->output_filters, bb);
   /* Empty the brigade here, as required by ap_pass_brigade(). */
   apr_brigade_cleanup(bb);
@@ -519,8 +577,14 @@ dav_svn__brigade_write(apr_bucket_brigade *bb,
                        apr_size_t len)
 {
   apr_status_t apr_err;
-  apr_err = apr_brigade_write(bb, ap_filter_flush,
-                              output->r->output_filters, data, len);
+
+  if (output->buffer)
+    {
+      svn_stringbuf_appendbytes(output->buffer, data, len);
+      return SVN_NO_ERROR;
+    }
+
+  apr_err = apr_brigade_write(bb, output_flush, output, data, len);
   if (apr_err)
     return svn_error_create(apr_err, 0, NULL);
   /* Check for an aborted connection, since the brigade functions don't
@@ -537,8 +601,14 @@ dav_svn__brigade_puts(apr_bucket_brigade *bb,
                       const char *str)
 {
   apr_status_t apr_err;
-  apr_err = apr_brigade_puts(bb, ap_filter_flush,
-                             output->r->output_filters, str);
+
+  if (output->buffer)
+    {
+      svn_stringbuf_appendcstr(output->buffer, str);
+      return SVN_NO_ERROR;
+    }
+
+  apr_err = apr_brigade_puts(bb, output_flush, output, str);
   if (apr_err)
     return svn_error_create(apr_err, 0, NULL);
   /* Check for an aborted connection, since the brigade functions don't
@@ -559,8 +629,14 @@ dav_svn__brigade_printf(apr_bucket_brigade *bb,
   va_list ap;
 
   va_start(ap, fmt);
-  apr_err = apr_brigade_vprintf(bb, ap_filter_flush,
-                                output->r->output_filters, fmt, ap);
+  if (output->buffer)
+    {
+      svn_stringbuf_appendcstr(output->buffer,
+                               apr_pvsprintf(output->r->pool, fmt, ap));
+      va_end(ap);
+      return SVN_NO_ERROR;
+    }
+  apr_err = apr_brigade_vprintf(bb, output_flush, output, fmt, ap);
   va_end(ap);
   if (apr_err)
     return svn_error_create(apr_err, 0, NULL);
@@ -581,8 +657,16 @@ dav_svn__brigade_putstrs(apr_bucket_brigade *bb,
   va_list ap;
 
   va_start(ap, output);
-  apr_err = apr_brigade_vputstrs(bb, ap_filter_flush,
-                                 output->r->output_filters, ap);
+  if (output->buffer)
+    {
+      const char *str;
+
+      while ((str = va_arg(ap, const char *)) != NULL)
+        svn_stringbuf_appendcstr(output->buffer, str);
+      va_end(ap);
+      return SVN_NO_ERROR;
+    }
+  apr_err = apr_brigade_vputstrs(bb, output_flush, output, ap);
   va_end(ap);
   if (apr_err)
     return svn_error_create(apr_err, NULL, NULL);
@@ -666,8 +750,7 @@ brigade_write_fn(void *baton, const char *data, apr_size_t *len)
   struct brigade_write_baton *wb = baton;
   apr_status_t apr_err;
 
-  apr_err = apr_brigade_write(wb->bb, ap_filter_flush,
-                              wb->output->r->output_filters, data, *len);
+  apr_err = apr_brigade_write(wb->bb, output_flush, wb->output, data, *len);
 
   if (apr_err != APR_SUCCESS)
     return svn_error_wrap_apr(apr_err, "Error writing base64 data");
@@ -44,6 +44,7 @@
 #include "svn_xml.h"
 
 #include "private/svn_cmdline_private.h"
+#include "private/svn_io_private.h"
 #include "private/svn_opt_private.h"
 #include "private/svn_sorts_private.h"
 #include "private/svn_subr_private.h"
@@ -59,6 +60,10 @@
  * The current threshold is 64MB. */
 #define BLOCK_READ_CACHE_THRESHOLD (0x40 * 0x100000)
 
+/* Number of SVN__STREAM_CHUNK_SIZE blocks that 'svnadmin load' may read
+ * ahead of the dump stream parser. */
+#define LOAD_READ_AHEAD_BLOCKS 64
+
 static svn_cancel_func_t check_cancel = NULL;
 
 /* Custom filesystem warning function. */
@@ -150,7 +155,10 @@ enum svnadmin__cmdline_options_t
     svnadmin__compatible_version,
     svnadmin__check_normalization,
     svnadmin__metadata_only,
-    svnadmin__no_flush_to_disk
+    svnadmin__no_flush_to_disk,
+    svnadmin__jobs,
+    svnadmin__link_packed,
+    svnadmin__bulk
   };
 
 /* Option codes and descriptions.
@@ -273,6 +281,21 @@ static const apr_getopt_option_t options_table[] =
      N_("disable flushing to disk during the operation\n"
         "                             (faster, but unsafe on power off)")},
 
+    {"jobs", svnadmin__jobs, 1,
+     N_("pack, verify, dump or hotcopy up to ARG shards\n"
+        "                             or revisions concurrently. Default: 1.\n"
+        "                             [pack, hotcopy: used for FSFS repositories\n"
+        "                             only]")},
+
+    {"link-packed", svnadmin__link_packed, 0,
+     N_("hard-link packed shards instead of copying them\n"
+        "                             where possible [FSFS only]")},
+
+    {"bulk", svnadmin__bulk, 0,
+     N_("load without flushing or updating the rep-cache\n"
+        "                             per revision; pack and flush once at\n"
+        "                             the end [FSFS only]")},
+
     {NULL}
   };
 
@@ -330,7 +353,8 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
     "every path present in the repository as of that revision.  (In either\n"
     "case, the second and subsequent revisions, if any, describe only paths\n"
     "changed in those revisions.)\n"),
-  {'r', svnadmin__incremental, svnadmin__deltas, 'q', 'M', 'F'},
+  {'r', svnadmin__incremental, svnadmin__deltas, 'q', 'M', 'F',
+   svnadmin__jobs},
   {{'F', N_("write to file ARG instead of stdout")}} },
 
   {"dump-revprops", subcommand_dump_revprops, {0}, N_
@@ -364,8 +388,11 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
    ("usage: svnadmin hotcopy REPOS_PATH NEW_REPOS_PATH\n\n"
     "Make a hot copy of a repository.\n"
     "If --incremental is passed, data which already exists at the destination\n"
-    "is not copied again.  Incremental mode is implemented for FSFS repositories.\n"),
-   {svnadmin__clean_logs, svnadmin__incremental, 'q'} },
+    "is not copied again.  Incremental mode is implemented for FSFS repositories.\n"
+    "If --link-packed is passed, packed shards of a FSFS repository are shared\n"
+    "with the destination through hard links, making the copy nearly instant.\n"),
+   {svnadmin__clean_logs, svnadmin__incremental, 'q', svnadmin__jobs,
+    svnadmin__link_packed} },
 
   {"info", subcommand_info, {0}, N_
    ("usage: svnadmin info REPOS_PATH\n\n"
@@ -391,12 +418,19 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
     "was previously empty, its UUID will, by default, be changed to the\n"
     "one specified in the stream.  Progress feedback is sent to stdout.\n"
     "If --revision is specified, limit the loaded revisions to only those\n"
-    "in the dump stream whose revision numbers match the specified range.\n"),
+    "in the dump stream whose revision numbers match the specified range.\n"
+    "\n"
+    "For initial imports, --bulk speeds up the load by deferring work\n"
+    "that is normally done for every revision: nothing gets flushed to\n"
+    "disk and the rep-cache is written in large batches.  Once all\n"
+    "revisions have been loaded, complete shards get packed and the\n"
+    "repository is flushed to disk.  If the load gets interrupted, the\n"
+    "revisions loaded so far may not have reached the disk.\n"),
    {'q', 'r', svnadmin__ignore_uuid, svnadmin__force_uuid,
     svnadmin__ignore_dates,
     svnadmin__use_pre_commit_hook, svnadmin__use_post_commit_hook,
     svnadmin__parent_dir, svnadmin__bypass_prop_validation, 'M',
-    svnadmin__no_flush_to_disk, 'F'},
+    svnadmin__no_flush_to_disk, svnadmin__bulk, 'F'},
    {{'F', N_("read from file ARG instead of stdin")}} },
 
   {"load-revprops", subcommand_load_revprops, {0}, N_
@@ -436,7 +470,7 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
    ("usage: svnadmin pack REPOS_PATH\n\n"
     "Possibly compact the repository into a more efficient storage model.\n"
     "This may not apply to all repositories, in which case, exit.\n"),
-   {'q', 'M'} },
+   {'q', 'M', svnadmin__jobs} },
 
   {"recover", subcommand_recover, {0}, N_
    ("usage: svnadmin recover REPOS_PATH\n\n"
@@ -512,7 +546,8 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
    ("usage: svnadmin verify REPOS_PATH\n\n"
     "Verify the data stored in the repository.\n"),
    {'t', 'r', 'q', svnadmin__keep_going, 'M',
-    svnadmin__check_normalization, svnadmin__metadata_only} },
+    svnadmin__check_normalization, svnadmin__metadata_only,
+    svnadmin__jobs} },
 
   { NULL, NULL, {0}, NULL, {0} }
 };
@@ -546,6 +581,9 @@ struct svnadmin_opt_state
   svn_boolean_t bypass_prop_validation;             /* --bypass-prop-validation */
   svn_boolean_t ignore_dates;                       /* --ignore-dates */
   svn_boolean_t no_flush_to_disk;                   /* --no-flush-to-disk */
+  int jobs;                                         /* --jobs */
+  svn_boolean_t link_packed;                        /* --link-packed */
+  svn_boolean_t bulk;                               /* --bulk */
   enum svn_repos_load_uuid uuid_action;             /* --ignore-uuid,
                                                        --force-uuid */
   apr_uint64_t memory_cache_size;                   /* --memory-cache-size M */
@@ -580,6 +618,17 @@ open_repos(svn_repos_t **repos,
                            use_block_read ? "1" : "0");
   svn_hash_sets(fs_config, SVN_FS_CONFIG_NO_FLUSH_TO_DISK,
                            opt_state->no_flush_to_disk ? "1" : "0");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BULK_LOAD,
+                           opt_state->bulk ? "1" : "0");
+  if (opt_state->jobs > 1)
+    {
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_PACK_JOBS,
+                               apr_itoa(pool, opt_state->jobs));
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_VERIFY_JOBS,
+                               apr_itoa(pool, opt_state->jobs));
+      svn_hash_sets(fs_config, SVN_FS_CONFIG_DUMP_JOBS,
+                               apr_itoa(pool, opt_state->jobs));
+    }
 
   /* now, open the requested repository */
   SVN_ERR(svn_repos_open3(repos, path, fs_config, pool, pool));
@@ -923,7 +972,7 @@ repos_verify_callback(void *baton,
 
 /* Implementation of svn_repos_notify_func_t to wrap the output to a
    response stream for svn_repos_dump_fs2(), svn_repos_verify_fs(),
-   svn_repos_hotcopy3() and others. */
+   svn_repos_hotcopy4() and others. */
 static void
 repos_notify_handler(void *baton,
                      const svn_repos_notify_t *notify,
@@ -1499,6 +1548,7 @@ subcommand_load(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   svn_revnum_t lower, upper;
   svn_stream_t *in_stream;
   svn_stream_t *feedback_stream = NULL;
+  apr_pool_t *in_pool;
 
   /* Expect no more arguments. */
   SVN_ERR(parse_args(NULL, os, 0, 0, pool));
@@ -1509,12 +1559,19 @@ subcommand_load(apr_getopt_t *os, void *baton, apr_pool_t *pool)
 
   SVN_ERR(open_repos(&repos, opt_state->repository_path, opt_state, pool));
 
-  /* Open the file or STDIN, depending on whether -F was specified. */
+  /* Open the file or STDIN, depending on whether -F was specified.
+     The input will be read on a separate thread, so give it a pool
+     of its own. */
+  in_pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
   if (opt_state->file)
     SVN_ERR(svn_stream_open_readonly(&in_stream, opt_state->file,
-                                     pool, pool));
+                                     in_pool, pool));
   else
-    SVN_ERR(svn_stream_for_stdin2(&in_stream, TRUE, pool));
+    SVN_ERR(svn_stream_for_stdin2(&in_stream, TRUE, in_pool));
+
+  /* Parse and commit revisions while the next ones are being read. */
+  in_stream = svn_stream__read_ahead(in_stream, LOAD_READ_AHEAD_BLOCKS,
+                                     pool);
 
   /* Progress feedback goes to STDOUT, unless they asked to suppress it. */
   if (! opt_state->quiet)
@@ -1528,6 +1585,22 @@ subcommand_load(apr_getopt_t *os, void *baton, apr_pool_t *pool)
                            opt_state->ignore_dates,
                            opt_state->quiet ? NULL : repos_notify_handler,
                            feedback_stream, check_cancel, NULL, pool);
+
+  /* Stop reading before releasing the input. */
+  err = svn_error_compose_create(err, svn_stream_close(in_stream));
+  svn_pool_destroy(in_pool);
+
+  /* Catch up on what --bulk deferred, so the result is a regular
+     repository: pack the complete shards and make everything durable. */
+  if (!err && opt_state->bulk)
+    {
+      err = svn_repos_fs_pack2(repos,
+                               opt_state->quiet ? NULL : repos_notify_handler,
+                               feedback_stream, check_cancel, NULL, pool);
+      if (!err)
+        err = svn_fs_sync(svn_repos_fs(repos), pool);
+    }
+
   if (err && err->apr_err == SVN_ERR_BAD_PROPERTY_VALUE)
     return svn_error_quick_wrap(err,
                                 _("Invalid property value found in "
@@ -2128,6 +2201,7 @@ subcommand_hotcopy(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   svn_stream_t *feedback_stream = NULL;
   apr_array_header_t *targets;
   const char *new_repos_path;
+  apr_hash_t *fs_config = NULL;
 
   /* Expect one more argument: NEW_REPOS_PATH */
   SVN_ERR(parse_args(&targets, os, 1, 1, pool));
@@ -2138,8 +2212,17 @@ subcommand_hotcopy(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   if (! opt_state->quiet)
     feedback_stream = recode_stream_create(stdout, pool);
 
-  return svn_repos_hotcopy3(opt_state->repository_path, new_repos_path,
+  if (opt_state->jobs > 1 || opt_state->link_packed)
+    fs_config = apr_hash_make(pool);
+  if (opt_state->jobs > 1)
+    svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_HOTCOPY_JOBS,
+                             apr_itoa(pool, opt_state->jobs));
+  if (opt_state->link_packed)
+    svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_HOTCOPY_LINK, "1");
+
+  return svn_repos_hotcopy4(opt_state->repository_path, new_repos_path,
                             opt_state->clean_logs, opt_state->incremental,
+                            fs_config,
                             !opt_state->quiet ? repos_notify_handler : NULL,
                             feedback_stream, check_cancel, NULL, pool);
 }
@@ -2861,6 +2944,19 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnadmin__no_flush_to_disk:
         opt_state.no_flush_to_disk = TRUE;
         break;
+      case svnadmin__jobs:
+        SVN_ERR(svn_cstring_atoi(&opt_state.jobs, opt_arg));
+        if (opt_state.jobs < 1)
+          return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("Invalid number of jobs '%s'"),
+                                   opt_arg);
+        break;
+      case svnadmin__link_packed:
+        opt_state.link_packed = TRUE;
+        break;
+      case svnadmin__bulk:
+        opt_state.bulk = TRUE;
+        break;
       default:
         {
           SVN_ERR(subcommand_help(NULL, NULL, pool));
@@ -2988,7 +3084,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_t settings = *svn_cache_config_get();
 
     settings.cache_size = opt_state.memory_cache_size;
-    settings.single_threaded = TRUE;
+
+    /* Parallel pack, verify, dump and hotcopy jobs share the caches. */
+    settings.single_threaded = opt_state.jobs <= 1;
 
     svn_cache_config_set(&settings);
   }
@@ -96,6 +96,11 @@ typedef struct svn_cl__opt_state_t
   svn_boolean_t trust_server_cert_not_yet_valid;
   svn_boolean_t trust_server_cert_other_failure;
   apr_array_header_t* search_patterns; /* pattern arguments for --search */
+  apr_int64_t file_count;        /* number of files to commit */
+  apr_int64_t file_size;         /* average size of committed files */
+  int dir_size;                  /* max. entries per committed directory */
+  int clients;                   /* number of concurrent clients */
+  int duration;                  /* length of the load run in seconds */
 } svn_cl__opt_state_t;
 
 
@@ -110,10 +115,14 @@ typedef struct svn_cl__cmd_baton_t
 svn_opt_subcommand_t
   svn_cl__help,
   svn_cl__null_blame,
+  svn_cl__null_checkout,
+  svn_cl__null_commit,
   svn_cl__null_export,
   svn_cl__null_list,
+  svn_cl__null_load,
   svn_cl__null_log,
-  svn_cl__null_info;
+  svn_cl__null_info,
+  svn_cl__null_update;
 
 
 /* See definition in main.c for documentation. */
@@ -182,6 +191,37 @@ svn_cl__args_to_target_array_print_reserved(apr_array_header_t **targets_p,
                                             svn_boolean_t keep_dest_origpath_on_truepath_collision,
                                             apr_pool_t *pool);
 
+/* Where the wall clock time of a null-checkout, null-update or null-commit
+ * went.  All times are in microseconds. */
+typedef struct svn_cl__timing_t
+{
+  /* Time between sending the request and the first response. */
+  apr_time_t server_wait;
+
+  /* Time spent sending and receiving data, including the RA layer's
+   * protocol handling. */
+  apr_time_t network;
+
+  /* Time spent creating resp. applying text deltas. */
+  apr_time_t delta;
+
+  /* Any other time spent in our own code, e.g. in editor callbacks. */
+  apr_time_t client;
+
+  /* CPU time used by this process, user and system combined. */
+  apr_time_t cpu;
+} svn_cl__timing_t;
+
+/* Return the CPU time used by this process so far, or 0 if that is not
+ * available on this platform. */
+apr_time_t
+svn_cl__cpu_time(void);
+
+/* Print the break-down in TIMING.  Use POOL for temporary allocations. */
+svn_error_t *
+svn_cl__print_timing(const svn_cl__timing_t *timing,
+                     apr_pool_t *pool);
+
 /* Return an error if TARGET is a URL; otherwise return SVN_NO_ERROR. */
 svn_error_t *
 svn_cl__check_target_is_local_path(const char *target);
@@ -0,0 +1,375 @@
+/*
+ * null-commit-cmd.c -- Subversion benchmark client: commit a synthetic tree
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* ==================================================================== */
+
+
+
+/*** Includes. ***/
+
+#include "svn_client.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_hash.h"
+#include "svn_path.h"
+#include "svn_props.h"
+#include "svn_cmdline.h"
+#include "svn_sorts.h"
+#include "cl.h"
+
+#include "svn_private_config.h"
+#include "private/svn_string_private.h"
+#include "private/svn_client_private.h"
+
+/* Defaults for the tree shape options. */
+#define DEFAULT_FILE_COUNT 1000
+#define DEFAULT_FILE_SIZE 4096
+#define DEFAULT_DIR_SIZE 32
+
+/* State of the synthetic commit. */
+typedef struct commit_baton_t
+{
+  const svn_delta_editor_t *editor;
+
+  /* Tree shape. */
+  apr_int64_t file_size;
+  int dir_size;
+
+  /* State of our pseudo-random number generator. */
+  apr_uint32_t seed;
+
+  /* Statistics. */
+  apr_int64_t file_count;
+  apr_int64_t dir_count;
+  apr_int64_t byte_count;
+  svn_cl__timing_t *timing;
+
+  /* Set by the commit callback. */
+  svn_revnum_t revision;
+} commit_baton_t;
+
+/* Return the next pseudo-random number from CB's generator.  We want the
+ * same tree for the same parameters, so we don't use any system RNG. */
+static apr_uint32_t
+next_random(commit_baton_t *cb)
+{
+  cb->seed = cb->seed * 1103515245 + 12345;
+  return cb->seed >> 8;
+}
+
+/* Return the size of the next file in CB.  Sizes range from 0 to 3 times
+ * the average size given by the user, with small sizes being much more
+ * frequent than larger ones -- similar to typical source trees. */
+static apr_size_t
+next_file_size(commit_baton_t *cb)
+{
+  double r = (next_random(cb) & 0xffff) / 65536.0;
+  return (apr_size_t)(3 * r * r * cb->file_size);
+}
+
+/* Return LEN bytes of text-like content allocated in POOL.  It consists of
+ * pseudo-random lower-case "words" and lines such that it compresses and
+ * deltifies about as well as real text does. */
+static svn_string_t *
+make_content(commit_baton_t *cb,
+             apr_size_t len,
+             apr_pool_t *pool)
+{
+  char *data = apr_palloc(pool, len + 1);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    {
+      apr_uint32_t r = next_random(cb);
+      if (r % 64 == 0)
+        data[i] = '\n';
+      else if (r % 8 == 0)
+        data[i] = ' ';
+      else
+        data[i] = (char)('a' + (r >> 6) % 26);
+    }
+
+  data[len] = 0;
+  return svn_string_ncreate(data, len, pool);
+}
+
+/* Add a file at PATH below DIR_BATON and send its synthetic contents.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+add_file(commit_baton_t *cb,
+         const char *path,
+         void *dir_baton,
+         apr_pool_t *scratch_pool)
+{
+  const svn_delta_editor_t *editor = cb->editor;
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_txdelta_stream_t *delta_stream;
+  svn_txdelta_window_t *window;
+  svn_string_t *content;
+  void *file_baton;
+  apr_time_t start;
+  apr_time_t now;
+
+  start = apr_time_now();
+  content = make_content(cb, next_file_size(cb), scratch_pool);
+  now = apr_time_now();
+  cb->timing->client += now - start;
+  start = now;
+
+  SVN_ERR(editor->add_file(path, dir_baton, NULL, SVN_INVALID_REVNUM,
+                           scratch_pool, &file_baton));
+  SVN_ERR(editor->apply_textdelta(file_baton, NULL, scratch_pool,
+                                  &handler, &handler_baton));
+  now = apr_time_now();
+  cb->timing->network += now - start;
+  start = now;
+
+  /* Create the delta windows ourselves, so we can tell the time spent
+   * on that from the time spent on sending them. */
+  svn_txdelta2(&delta_stream, svn_stream_empty(scratch_pool),
+               svn_stream_from_string(content, scratch_pool), FALSE,
+               scratch_pool);
+  do
+    {
+      SVN_ERR(svn_txdelta_next_window(&window, delta_stream, scratch_pool));
+      now = apr_time_now();
+      cb->timing->delta += now - start;
+      start = now;
+
+      SVN_ERR(handler(window, handler_baton));
+      now = apr_time_now();
+      cb->timing->network += now - start;
+      start = now;
+    }
+  while (window);
+
+  SVN_ERR(editor->close_file(file_baton, NULL, scratch_pool));
+  cb->timing->network += apr_time_now() - start;
+
+  cb->file_count++;
+  cb->byte_count += content->len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Add COUNT files to the directory at PATH with DIR_BATON.  If they don't
+ * fit into a single directory, distribute them over as few levels of
+ * sub-directories as possible.  Use SCRATCH_POOL for temporary
+ * allocations. */
+static svn_error_t *
+add_tree(commit_baton_t *cb,
+         const char *path,
+         void *dir_baton,
+         apr_int64_t count,
+         apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_int64_t i;
+
+  if (count <= cb->dir_size)
+    {
+      for (i = 0; i < count; ++i)
+        {
+          const char *name;
+
+          svn_pool_clear(iterpool);
+          name = apr_psprintf(iterpool, "file%" APR_INT64_T_FMT, i);
+          SVN_ERR(add_file(cb, svn_relpath_join(path, name, iterpool),
+                           dir_baton, iterpool));
+        }
+    }
+  else
+    {
+      /* Number of files per sub-directory. */
+      apr_int64_t per_dir = cb->dir_size;
+      while (per_dir * cb->dir_size < count)
+        per_dir *= cb->dir_size;
+
+      for (i = 0; count > 0; ++i)
+        {
+          const char *sub_path;
+          void *sub_baton;
+          apr_int64_t sub_count = MIN(count, per_dir);
+          apr_time_t start;
+
+          svn_pool_clear(iterpool);
+          sub_path = svn_relpath_join(path,
+                                      apr_psprintf(iterpool,
+                                                   "dir%" APR_INT64_T_FMT, i),
+                                      iterpool);
+
+          start = apr_time_now();
+          SVN_ERR(cb->editor->add_directory(sub_path, dir_baton, NULL,
+                                            SVN_INVALID_REVNUM, iterpool,
+                                            &sub_baton));
+          cb->timing->network += apr_time_now() - start;
+          cb->dir_count++;
+
+          SVN_ERR(add_tree(cb, sub_path, sub_baton, sub_count, iterpool));
+
+          start = apr_time_now();
+          SVN_ERR(cb->editor->close_directory(sub_baton, iterpool));
+          cb->timing->network += apr_time_now() - start;
+
+          count -= sub_count;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_commit_callback2_t. */
+static svn_error_t *
+commit_callback(const svn_commit_info_t *commit_info,
+                void *baton,
+                apr_pool_t *pool)
+{
+  commit_baton_t *cb = baton;
+  cb->revision = commit_info->revision;
+
+  return SVN_NO_ERROR;
+}
+
+/*** Code. ***/
+
+/* This implements the `svn_opt_subcommand_t' interface. */
+svn_error_t *
+svn_cl__null_commit(apr_getopt_t *os,
+                    void *baton,
+                    apr_pool_t *pool)
+{
+  svn_cl__opt_state_t *opt_state = ((svn_cl__cmd_baton_t *) baton)->opt_state;
+  svn_client_ctx_t *ctx = ((svn_cl__cmd_baton_t *) baton)->ctx;
+  apr_array_header_t *targets;
+  const char *url;
+  const char *root_path;
+  svn_ra_session_t *ra_session;
+  svn_revnum_t head;
+  apr_hash_t *revprops;
+  void *edit_baton;
+  void *root_baton;
+  void *dir_baton;
+  apr_int64_t file_count;
+  svn_cl__timing_t timing = { 0 };
+  commit_baton_t cb = { 0 };
+  apr_time_t cpu_start = svn_cl__cpu_time();
+  apr_time_t start = apr_time_now();
+  apr_time_t now;
+  svn_error_t *err;
+
+  SVN_ERR(svn_cl__args_to_target_array_print_reserved(&targets, os,
+                                                      opt_state->targets,
+                                                      ctx, FALSE, pool));
+
+  /* We want exactly 1 target for this subcommand. */
+  if (targets->nelts < 1)
+    return svn_error_create(SVN_ERR_CL_INSUFFICIENT_ARGS, 0, NULL);
+  if (targets->nelts > 1)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, 0, NULL);
+
+  url = APR_ARRAY_IDX(targets, 0, const char *);
+  if (! svn_path_is_url(url))
+    return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                             _("'%s' does not appear to be a URL"), url);
+
+  file_count = opt_state->file_count ? opt_state->file_count
+                                     : DEFAULT_FILE_COUNT;
+  cb.file_size = opt_state->file_size ? opt_state->file_size
+                                      : DEFAULT_FILE_SIZE;
+  cb.dir_size = opt_state->dir_size ? opt_state->dir_size
+                                    : DEFAULT_DIR_SIZE;
+  cb.seed = (apr_uint32_t)(file_count ^ cb.file_size ^ cb.dir_size);
+  cb.revision = SVN_INVALID_REVNUM;
+  cb.timing = &timing;
+
+  if (cb.dir_size < 2)
+    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                            _("Directories must hold at least 2 entries"));
+
+  revprops = opt_state->revprop_table
+           ? apr_hash_copy(pool, opt_state->revprop_table)
+           : apr_hash_make(pool);
+  if (! svn_hash_gets(revprops, SVN_PROP_REVISION_LOG))
+    svn_hash_sets(revprops, SVN_PROP_REVISION_LOG,
+                  svn_string_create("Synthetic commit by svnbench", pool));
+
+  /* Each run adds a new tree next to those of earlier runs. */
+  root_path = apr_psprintf(pool, "svnbench-%" APR_TIME_T_FMT, start);
+
+  SVN_ERR(svn_client_open_ra_session2(&ra_session, url, NULL, ctx,
+                                      pool, pool));
+  SVN_ERR(svn_ra_get_latest_revnum(ra_session, &head, pool));
+  SVN_ERR(svn_ra_get_commit_editor3(ra_session, &cb.editor, &edit_baton,
+                                    revprops, commit_callback, &cb,
+                                    NULL, FALSE, pool));
+
+  SVN_ERR(cb.editor->open_root(edit_baton, head, pool, &root_baton));
+  SVN_ERR(cb.editor->add_directory(root_path, root_baton, NULL,
+                                   SVN_INVALID_REVNUM, pool, &dir_baton));
+  now = apr_time_now();
+  timing.network += now - start;
+  cb.dir_count++;
+
+  err = add_tree(&cb, root_path, dir_baton, file_count, pool);
+
+  if (! err)
+    {
+      start = apr_time_now();
+      err = cb.editor->close_directory(dir_baton, pool);
+      if (! err)
+        err = cb.editor->close_directory(root_baton, pool);
+      now = apr_time_now();
+      timing.network += now - start;
+      start = now;
+
+      /* The server only now makes the transaction a revision. */
+      if (! err)
+        err = cb.editor->close_edit(edit_baton, pool);
+      timing.server_wait += apr_time_now() - start;
+    }
+
+  if (err)
+    return svn_error_compose_create(
+                err,
+                cb.editor->abort_edit(edit_baton, pool));
+
+  timing.cpu = svn_cl__cpu_time() - cpu_start;
+
+  if (!opt_state->quiet)
+    {
+      SVN_ERR(svn_cmdline_printf(pool,
+                                 _("Committed revision %ld.\n"
+                                   "%15s directories\n"
+                                   "%15s files\n"
+                                   "%15s bytes in files\n"),
+                                 cb.revision,
+                                 svn__ui64toa_sep(cb.dir_count, ',', pool),
+                                 svn__ui64toa_sep(cb.file_count, ',', pool),
+                                 svn__ui64toa_sep(cb.byte_count, ',', pool)));
+      SVN_ERR(svn_cl__print_timing(&timing, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,534 @@
+/*
+ * null-load-cmd.c -- Subversion benchmark client: concurrent load generator
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* ==================================================================== */
+
+
+
+/*** Includes. ***/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <apr_thread_proc.h>
+
+#include "svn_client.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_path.h"
+#include "svn_pools.h"
+#include "svn_cmdline.h"
+#include "svn_utf.h"
+#include "cl.h"
+
+#include "svn_private_config.h"
+#include "private/svn_string_private.h"
+
+/* Defaults for the load options. */
+#define DEFAULT_CLIENTS 1
+#define DEFAULT_DURATION 10
+
+/* Number of log entries to fetch in a "log" operation. */
+#define LOG_LIMIT 100
+
+/* The operations that a workload may consist of. */
+typedef enum operation_t
+{
+  op_latest,
+  op_info,
+  op_list,
+  op_log,
+  op_checkout,
+
+  /* Number of operations. */
+  op_count
+} operation_t;
+
+/* Operation names as used in the workload spec. */
+static const char *const operation_names[op_count] =
+{
+  "latest",
+  "info",
+  "list",
+  "log",
+  "checkout"
+};
+
+/* Relative frequency of each operation in the workload. */
+typedef struct workload_t
+{
+  int weights[op_count];
+  int total;
+} workload_t;
+
+/* State of a single simulated client.  All members except the results
+ * are owned by the client's thread while it is running. */
+typedef struct client_t
+{
+  /* The client's own pool.  It uses an allocator of its own as well. */
+  apr_pool_t *pool;
+
+  /* The client's own RA session. */
+  svn_ra_session_t *session;
+
+  /* What to do and for how long.  END may be reset by other threads. */
+  const workload_t *workload;
+  volatile apr_time_t end;
+
+  /* State of our pseudo-random number generator. */
+  apr_uint32_t seed;
+
+  /* Results: latencies of successful operations as apr_time_t arrays
+   * and the number of failed operations, per operation type. */
+  apr_array_header_t *latencies[op_count];
+  apr_int64_t errors[op_count];
+} client_t;
+
+/* Set *OP to the operation named NAME.  Return an error, if there is no
+ * such operation. */
+static svn_error_t *
+parse_operation(operation_t *op,
+                const char *name)
+{
+  int i;
+  for (i = 0; i < op_count; ++i)
+    if (strcmp(operation_names[i], name) == 0)
+      {
+        *op = i;
+        return SVN_NO_ERROR;
+      }
+
+  return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                           _("Unknown operation '%s'"), name);
+}
+
+/* Add the operation spec SPEC of the form "OP[:WEIGHT]" to WORKLOAD.
+ * Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+parse_spec(workload_t *workload,
+           const char *spec,
+           apr_pool_t *scratch_pool)
+{
+  operation_t op;
+  int weight = 1;
+  const char *colon = strchr(spec, ':');
+
+  if (colon)
+    {
+      SVN_ERR(svn_cstring_atoi(&weight, colon + 1));
+      if (weight < 0)
+        return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                 _("Negative weight in '%s'"), spec);
+
+      spec = apr_pstrmemdup(scratch_pool, spec, colon - spec);
+    }
+
+  SVN_ERR(parse_operation(&op, spec));
+  workload->weights[op] += weight;
+  workload->total += weight;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the next pseudo-random number from CLIENT's generator. */
+static apr_uint32_t
+next_random(client_t *client)
+{
+  client->seed = client->seed * 1103515245 + 12345;
+  return client->seed >> 8;
+}
+
+/* Return a random operation from CLIENT's workload, chosen according to
+ * the operation weights. */
+static operation_t
+pick_operation(client_t *client)
+{
+  int pick = (int)(next_random(client) % client->workload->total);
+  int i;
+
+  for (i = 0; i < op_count - 1; ++i)
+    {
+      pick -= client->workload->weights[i];
+      if (pick < 0)
+        break;
+    }
+
+  return i;
+}
+
+/* Implements svn_log_entry_receiver_t, discarding all entries. */
+static svn_error_t *
+log_receiver(void *baton,
+             svn_log_entry_t *log_entry,
+             apr_pool_t *pool)
+{
+  return SVN_NO_ERROR;
+}
+
+/* Execute OP in SESSION.  Use SCRATCH_POOL for temporary allocations. */
+static svn_error_t *
+run_operation(svn_ra_session_t *session,
+              operation_t op,
+              apr_pool_t *scratch_pool)
+{
+  switch (op)
+    {
+      case op_latest:
+        {
+          svn_revnum_t revision;
+          SVN_ERR(svn_ra_get_latest_revnum(session, &revision,
+                                           scratch_pool));
+        }
+        break;
+
+      case op_info:
+        {
+          svn_dirent_t *dirent;
+          SVN_ERR(svn_ra_stat(session, "", SVN_INVALID_REVNUM, &dirent,
+                              scratch_pool));
+        }
+        break;
+
+      case op_list:
+        {
+          apr_hash_t *dirents;
+          SVN_ERR(svn_ra_get_dir2(session, &dirents, NULL, NULL, "",
+                                  SVN_INVALID_REVNUM, SVN_DIRENT_ALL,
+                                  scratch_pool));
+        }
+        break;
+
+      case op_log:
+        {
+          apr_array_header_t *paths = apr_array_make(scratch_pool, 1,
+                                                     sizeof(const char *));
+          APR_ARRAY_PUSH(paths, const char *) = "";
+          SVN_ERR(svn_ra_get_log2(session, paths, SVN_INVALID_REVNUM, 0,
+                                  LOG_LIMIT, FALSE, FALSE, FALSE, NULL,
+                                  log_receiver, NULL, scratch_pool));
+        }
+        break;
+
+      case op_checkout:
+        {
+          svn_revnum_t revision;
+          const svn_ra_reporter3_t *reporter;
+          void *report_baton;
+
+          SVN_ERR(svn_ra_get_latest_revnum(session, &revision,
+                                           scratch_pool));
+          SVN_ERR(svn_ra_do_update3(session, &reporter, &report_baton,
+                                    revision, "", svn_depth_infinity,
+                                    FALSE, FALSE,
+                                    svn_delta_default_editor(scratch_pool),
+                                    NULL, scratch_pool, scratch_pool));
+          SVN_ERR(reporter->set_path(report_baton, "", revision,
+                                     svn_depth_infinity, TRUE, NULL,
+                                     scratch_pool));
+          SVN_ERR(reporter->finish_report(report_baton, scratch_pool));
+        }
+        break;
+
+      default:
+        SVN_ERR_MALFUNCTION();
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Run random operations from CLIENT's workload until its time is up or
+ * the user cancelled us. */
+static void
+run_client(client_t *client)
+{
+  apr_pool_t *iterpool = svn_pool_create(client->pool);
+
+  while (apr_time_now() < client->end)
+    {
+      operation_t op = pick_operation(client);
+      apr_time_t start;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+
+      err = svn_cl__check_cancel(NULL);
+      if (err)
+        {
+          svn_error_clear(err);
+          break;
+        }
+
+      start = apr_time_now();
+      err = run_operation(client->session, op, iterpool);
+      if (err)
+        {
+          svn_error_clear(err);
+          client->errors[op]++;
+        }
+      else
+        {
+          APR_ARRAY_PUSH(client->latencies[op], apr_time_t)
+            = apr_time_now() - start;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+}
+
+#if APR_HAS_THREADS
+/* Implements apr_thread_start_t, calling run_client for the client_t
+   in DATA. */
+static void * APR_THREAD_FUNC
+client_worker(apr_thread_t *thread, void *data)
+{
+  run_client(data);
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+#endif
+
+/* qsort-compatible comparison function for apr_time_t. */
+static int
+compare_times(const void *lhs, const void *rhs)
+{
+  apr_time_t lhs_time = *(const apr_time_t *)lhs;
+  apr_time_t rhs_time = *(const apr_time_t *)rhs;
+
+  if (lhs_time < rhs_time)
+    return -1;
+
+  return lhs_time > rhs_time ? 1 : 0;
+}
+
+/* Return the PERMILLE percentile of the sorted TIMES in milliseconds,
+ * using the nearest-rank method. */
+static double
+percentile(const apr_array_header_t *times,
+           int permille)
+{
+  int rank = (int)(((apr_int64_t)times->nelts * permille + 999) / 1000);
+  if (rank < 1)
+    rank = 1;
+
+  return APR_ARRAY_IDX(times, rank - 1, apr_time_t) / 1.0e3;
+}
+
+/* Print the statistics for all CLIENT_COUNT CLIENTS for the DURATION of
+ * the run.  Use POOL for temporary allocations. */
+static svn_error_t *
+print_stats(client_t *clients,
+            int client_count,
+            apr_time_t duration,
+            apr_pool_t *pool)
+{
+  int op;
+
+  SVN_ERR(svn_cmdline_printf(pool,
+                             _("%-10s %12s %10s %10s %10s %10s %8s\n"),
+                             _("operation"), _("count"), _("ops/sec"),
+                             _("p50 [ms]"), _("p99 [ms]"), _("p999 [ms]"),
+                             _("errors")));
+
+  for (op = 0; op < op_count; ++op)
+    {
+      apr_array_header_t *latencies;
+      apr_int64_t errors = 0;
+      int i;
+
+      latencies = apr_array_make(pool, 0, sizeof(apr_time_t));
+      for (i = 0; i < client_count; ++i)
+        {
+          apr_array_cat(latencies, clients[i].latencies[op]);
+          errors += clients[i].errors[op];
+        }
+
+      if (latencies->nelts == 0 && errors == 0)
+        continue;
+
+      if (latencies->nelts == 0)
+        {
+          SVN_ERR(svn_cmdline_printf(pool, "%-10s %12s %10s %10s %10s "
+                                           "%10s %8s\n",
+                                     operation_names[op], "0", "-", "-",
+                                     "-", "-",
+                                     svn__i64toa_sep(errors, ',', pool)));
+          continue;
+        }
+
+      qsort(latencies->elts, latencies->nelts, latencies->elt_size,
+            compare_times);
+
+      SVN_ERR(svn_cmdline_printf(pool, "%-10s %12s %10.1f %10.3f %10.3f "
+                                       "%10.3f %8s\n",
+                                 operation_names[op],
+                                 svn__i64toa_sep(latencies->nelts, ',',
+                                                 pool),
+                                 latencies->nelts * 1.0e6 / duration,
+                                 percentile(latencies, 500),
+                                 percentile(latencies, 990),
+                                 percentile(latencies, 999),
+                                 svn__i64toa_sep(errors, ',', pool)));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/*** Code. ***/
+
+/* This implements the `svn_opt_subcommand_t' interface. */
+svn_error_t *
+svn_cl__null_load(apr_getopt_t *os,
+                  void *baton,
+                  apr_pool_t *pool)
+{
+  svn_cl__opt_state_t *opt_state = ((svn_cl__cmd_baton_t *) baton)->opt_state;
+  svn_client_ctx_t *ctx = ((svn_cl__cmd_baton_t *) baton)->ctx;
+  apr_array_header_t *args;
+  const char *url;
+  workload_t workload = { { 0 } };
+  client_t *clients;
+  int client_count = opt_state->clients ? opt_state->clients
+                                        : DEFAULT_CLIENTS;
+  apr_time_t duration = apr_time_from_sec(opt_state->duration
+                                          ? opt_state->duration
+                                          : DEFAULT_DURATION);
+  apr_time_t start;
+  int i;
+
+  SVN_ERR(svn_opt_parse_all_args(&args, os, pool));
+  if (args->nelts < 1)
+    return svn_error_create(SVN_ERR_CL_INSUFFICIENT_ARGS, 0, NULL);
+
+  SVN_ERR(svn_utf_cstring_to_utf8(&url, APR_ARRAY_IDX(args, 0, const char *),
+                                  pool));
+  if (! svn_path_is_url(url))
+    return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                             _("'%s' does not appear to be a URL"), url);
+  url = svn_uri_canonicalize(url, pool);
+
+  for (i = 1; i < args->nelts; ++i)
+    {
+      const char *spec;
+      SVN_ERR(svn_utf_cstring_to_utf8(&spec,
+                                      APR_ARRAY_IDX(args, i, const char *),
+                                      pool));
+      SVN_ERR(parse_spec(&workload, spec, pool));
+    }
+
+  /* Default: a read-mostly mix of cheap operations. */
+  if (args->nelts == 1)
+    {
+      workload.weights[op_latest] = 1;
+      workload.weights[op_info] = 4;
+      workload.weights[op_list] = 4;
+      workload.weights[op_log] = 1;
+      workload.total = 10;
+    }
+
+  if (workload.total == 0)
+    return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                            _("The workload must not be empty"));
+
+#if !APR_HAS_THREADS
+  if (client_count > 1)
+    return svn_error_create(SVN_ERR_UNSUPPORTED_FEATURE, NULL,
+                            _("Multiple clients require thread support"));
+#endif
+
+  /* The progress notification is not thread-safe. */
+  ctx->progress_func = NULL;
+  ctx->progress_baton = NULL;
+
+  /* Open all sessions up-front and from this thread, so the
+   * authentication providers don't need to be thread-safe. */
+  clients = apr_pcalloc(pool, client_count * sizeof(*clients));
+  for (i = 0; i < client_count; ++i)
+    {
+      client_t *client = &clients[i];
+      int op;
+
+      client->pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      client->workload = &workload;
+      client->seed = i;
+      for (op = 0; op < op_count; ++op)
+        client->latencies[op] = apr_array_make(client->pool, 0,
+                                               sizeof(apr_time_t));
+
+      SVN_ERR(svn_client_open_ra_session2(&client->session, url, NULL, ctx,
+                                          client->pool, client->pool));
+    }
+
+  start = apr_time_now();
+  for (i = 0; i < client_count; ++i)
+    clients[i].end = start + duration;
+
+#if APR_HAS_THREADS
+  {
+    apr_thread_t **threads = apr_pcalloc(pool,
+                                         client_count * sizeof(*threads));
+
+    /* The calling thread runs the first client. */
+    for (i = 1; i < client_count; ++i)
+      {
+        apr_status_t status = apr_thread_create(&threads[i], NULL,
+                                                client_worker, &clients[i],
+                                                pool);
+        if (status)
+          {
+            /* Stop all clients that are already running. */
+            int k;
+            for (k = 0; k < client_count; ++k)
+              clients[k].end = 0;
+            for (k = 1; k < i; ++k)
+              {
+                apr_status_t retval;
+                apr_thread_join(&retval, threads[k]);
+              }
+
+            return svn_error_wrap_apr(status, _("Can't create thread"));
+          }
+      }
+
+    run_client(&clients[0]);
+
+    for (i = 1; i < client_count; ++i)
+      {
+        apr_status_t retval;
+        apr_thread_join(&retval, threads[i]);
+      }
+  }
+#else
+  run_client(&clients[0]);
+#endif
+
+  if (!opt_state->quiet)
+    SVN_ERR(print_stats(clients, client_count, apr_time_now() - start,
+                        pool));
+
+  for (i = 0; i < client_count; ++i)
+    svn_pool_destroy(clients[i].pool);
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,685 @@
+/*
+ * null-update-cmd.c -- Subversion benchmark client: checkout and update
+ *                      without a working copy to write to
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* ==================================================================== */
+
+
+
+/*** Includes. ***/
+
+#include <string.h>
+
+#include "svn_client.h"
+#include "svn_error.h"
+#include "svn_dirent_uri.h"
+#include "svn_path.h"
+#include "svn_cmdline.h"
+#include "svn_wc.h"
+#include "cl.h"
+
+#include "svn_private_config.h"
+#include "private/svn_string_private.h"
+#include "private/svn_client_private.h"
+
+/*** The timing null editor. ***/
+
+/* All editor callbacks share this baton.  Besides counting what we
+ * receive, it keeps track of where the time goes:  Time spent between
+ * two callbacks is attributed to the RA layer, i.e. to the network,
+ * time spent inside the callbacks to the client. */
+typedef struct edit_baton_t
+{
+  apr_int64_t file_count;
+  apr_int64_t dir_count;
+  apr_int64_t byte_count;
+  apr_int64_t prop_count;
+  apr_int64_t prop_byte_count;
+
+  /* Where the time went. */
+  svn_cl__timing_t *timing;
+
+  /* When we last returned control to the RA layer. */
+  apr_time_t mark;
+
+  /* When the current callback has been entered. */
+  apr_time_t entered;
+
+  /* Set once we received the first response from the server. */
+  svn_boolean_t got_response;
+
+  /* Provides the delta base, see zero_read_handler(). */
+  svn_stream_t *source;
+
+  /* Discards the delta application result. */
+  svn_stream_t *target;
+} edit_baton_t;
+
+/* Per-file baton. */
+typedef struct file_baton_t
+{
+  edit_baton_t *eb;
+
+  /* Handler and baton returned by svn_txdelta_apply(). */
+  svn_txdelta_window_handler_t apply_handler;
+  void *apply_baton;
+} file_baton_t;
+
+/* Call this at the start of every editor callback in EB. */
+static void
+enter_callback(edit_baton_t *eb)
+{
+  eb->entered = apr_time_now();
+  if (eb->got_response)
+    {
+      eb->timing->network += eb->entered - eb->mark;
+    }
+  else
+    {
+      eb->timing->server_wait += eb->entered - eb->mark;
+      eb->got_response = TRUE;
+    }
+}
+
+/* Call this at the end of every editor callback in EB and add the time
+ * spent in it to *BUCKET. */
+static void
+leave_callback(edit_baton_t *eb,
+               apr_time_t *bucket)
+{
+  eb->mark = apr_time_now();
+  *bucket += eb->mark - eb->entered;
+}
+
+/* Implements svn_read_fn_t, producing an infinite sequence of NUL bytes.
+ * We don't have the delta base for updates, but the amount of work spent
+ * on applying the delta is the same with any base of sufficient size. */
+static svn_error_t *
+zero_read_handler(void *baton,
+                  char *buffer,
+                  apr_size_t *len)
+{
+  memset(buffer, 0, *len);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+set_target_revision(void *edit_baton,
+                    svn_revnum_t target_revision,
+                    apr_pool_t *pool)
+{
+  edit_baton_t *eb = edit_baton;
+  enter_callback(eb);
+  leave_callback(eb, &eb->timing->client);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+open_root(void *edit_baton,
+          svn_revnum_t base_revision,
+          apr_pool_t *pool,
+          void **root_baton)
+{
+  edit_baton_t *eb = edit_baton;
+  enter_callback(eb);
+
+  *root_baton = eb;
+
+  leave_callback(eb, &eb->timing->client);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+delete_entry(const char *path,
+             svn_revnum_t revision,
+             void *parent_baton,
+             apr_pool_t *pool)
+{
+  edit_baton_t *eb = parent_baton;
+  enter_callback(eb);
+  leave_callback(eb, &eb->timing->client);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+add_directory(const char *path,
+              void *parent_baton,
+              const char *copyfrom_path,
+              svn_revnum_t copyfrom_revision,
+              apr_pool_t *pool,
+              void **baton)
+{
+  edit_baton_t *eb = parent_baton;
+  enter_callback(eb);
+
+  eb->dir_count++;
+  *baton = eb;
+
+  leave_callback(eb, &eb->timing->client);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+open_directory(const char *path,
+               void *parent_baton,
+               svn_revnum_t base_revision,
+               apr_pool_t *pool,
+               void **baton)
+{
+  edit_baton_t *eb = parent_baton;
+  enter_callback(eb);
+
+  eb->dir_count++;
+  *baton = eb;
+
+  leave_callback(eb, &eb->timing->client);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+change_dir_prop(void *dir_baton,
+                const char *name,
+                const svn_string_t *value,
+                apr_pool_t *pool)
+{
+  edit_baton_t *eb = dir_baton;
+  enter_callback(eb);
+
+  eb->prop_count++;
+  if (value)
+    eb->prop_byte_count += value->len;
+
+  leave_callback(eb, &eb->timing->client);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+close_directory(void *dir_baton,
+                apr_pool_t *pool)
+{
+  edit_baton_t *eb = dir_baton;
+  enter_callback(eb);
+  leave_callback(eb, &eb->timing->client);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+add_file(const char *path,
+         void *parent_baton,
+         const char *copyfrom_path,
+         svn_revnum_t copyfrom_revision,
+         apr_pool_t *pool,
+         void **baton)
+{
+  edit_baton_t *eb = parent_baton;
+  file_baton_t *fb;
+  enter_callback(eb);
+
+  eb->file_count++;
+  fb = apr_pcalloc(pool, sizeof(*fb));
+  fb->eb = eb;
+  *baton = fb;
+
+  leave_callback(eb, &eb->timing->client);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+open_file(const char *path,
+          void *parent_baton,
+          svn_revnum_t base_revision,
+          apr_pool_t *pool,
+          void **baton)
+{
+  edit_baton_t *eb = parent_baton;
+  file_baton_t *fb;
+  enter_callback(eb);
+
+  eb->file_count++;
+  fb = apr_pcalloc(pool, sizeof(*fb));
+  fb->eb = eb;
+  *baton = fb;
+
+  leave_callback(eb, &eb->timing->client);
+  return SVN_NO_ERROR;
+}
+
+/* Apply WINDOW to null data and discard the result. */
+static svn_error_t *
+window_handler(svn_txdelta_window_t *window, void *baton)
+{
+  file_baton_t *fb = baton;
+  edit_baton_t *eb = fb->eb;
+  svn_error_t *err;
+  enter_callback(eb);
+
+  if (window != NULL)
+    eb->byte_count += window->tview_len;
+
+  err = fb->apply_handler(window, fb->apply_baton);
+
+  leave_callback(eb, &eb->timing->delta);
+  return svn_error_trace(err);
+}
+
+static svn_error_t *
+apply_textdelta(void *file_baton,
+                const char *base_checksum,
+                apr_pool_t *pool,
+                svn_txdelta_window_handler_t *handler,
+                void **handler_baton)
+{
+  file_baton_t *fb = file_baton;
+  edit_baton_t *eb = fb->eb;
+  enter_callback(eb);
+
+  svn_txdelta_apply(eb->source, eb->target, NULL, NULL, pool,
+                    &fb->apply_handler, &fb->apply_baton);
+  *handler = window_handler;
+  *handler_baton = fb;
+
+  leave_callback(eb, &eb->timing->delta);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+change_file_prop(void *file_baton,
+                 const char *name,
+                 const svn_string_t *value,
+                 apr_pool_t *pool)
+{
+  file_baton_t *fb = file_baton;
+  edit_baton_t *eb = fb->eb;
+  enter_callback(eb);
+
+  eb->prop_count++;
+  if (value)
+    eb->prop_byte_count += value->len;
+
+  leave_callback(eb, &eb->timing->client);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+close_file(void *file_baton,
+           const char *text_checksum,
+           apr_pool_t *pool)
+{
+  file_baton_t *fb = file_baton;
+  edit_baton_t *eb = fb->eb;
+  enter_callback(eb);
+  leave_callback(eb, &eb->timing->client);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+close_edit(void *edit_baton,
+           apr_pool_t *pool)
+{
+  edit_baton_t *eb = edit_baton;
+  enter_callback(eb);
+  leave_callback(eb, &eb->timing->client);
+
+  return SVN_NO_ERROR;
+}
+
+/*** The timing reporter. ***/
+
+/* Baton for the reporter that wraps the RA layer's reporter. */
+typedef struct report_baton_t
+{
+  const svn_ra_reporter3_t *reporter;
+  void *baton;
+  edit_baton_t *eb;
+
+  /* When we started to report. */
+  apr_time_t start;
+} report_baton_t;
+
+static svn_error_t *
+set_path(void *report_baton,
+         const char *path,
+         svn_revnum_t revision,
+         svn_depth_t depth,
+         svn_boolean_t start_empty,
+         const char *lock_token,
+         apr_pool_t *pool)
+{
+  report_baton_t *rb = report_baton;
+  return svn_error_trace(rb->reporter->set_path(rb->baton, path, revision,
+                                                depth, start_empty,
+                                                lock_token, pool));
+}
+
+static svn_error_t *
+delete_path(void *report_baton,
+            const char *path,
+            apr_pool_t *pool)
+{
+  report_baton_t *rb = report_baton;
+  return svn_error_trace(rb->reporter->delete_path(rb->baton, path, pool));
+}
+
+static svn_error_t *
+link_path(void *report_baton,
+          const char *path,
+          const char *url,
+          svn_revnum_t revision,
+          svn_depth_t depth,
+          svn_boolean_t start_empty,
+          const char *lock_token,
+          apr_pool_t *pool)
+{
+  report_baton_t *rb = report_baton;
+  return svn_error_trace(rb->reporter->link_path(rb->baton, path, url,
+                                                 revision, depth,
+                                                 start_empty, lock_token,
+                                                 pool));
+}
+
+/* Everything up to here has been reporting, i.e. client work.  Note that
+ * the RA layer may send parts of the report while we are still building
+ * it; we attribute that to the client as well. */
+static svn_error_t *
+finish_report(void *report_baton,
+              apr_pool_t *pool)
+{
+  report_baton_t *rb = report_baton;
+  rb->eb->mark = apr_time_now();
+  rb->eb->timing->client += rb->eb->mark - rb->start;
+
+  return svn_error_trace(rb->reporter->finish_report(rb->baton, pool));
+}
+
+static svn_error_t *
+abort_report(void *report_baton,
+             apr_pool_t *pool)
+{
+  report_baton_t *rb = report_baton;
+  return svn_error_trace(rb->reporter->abort_report(rb->baton, pool));
+}
+
+static const svn_ra_reporter3_t timing_reporter =
+{
+  set_path,
+  delete_path,
+  link_path,
+  finish_report,
+  abort_report
+};
+
+/*** Public Interfaces ***/
+
+/* Run an update of the tree at URL[@PEG_REVISION] to REVISION with the
+ * given DEPTH and feed the result into the null editor with baton EB.
+ * If WC_ABSPATH is not NULL, report the state of that working copy
+ * directory.  Otherwise, report an empty tree, i.e. do a checkout.
+ */
+static svn_error_t *
+bench_null_update(const char *url,
+                  const svn_opt_revision_t *peg_revision,
+                  const svn_opt_revision_t *revision,
+                  const char *wc_abspath,
+                  svn_depth_t depth,
+                  edit_baton_t *eb,
+                  svn_client_ctx_t *ctx,
+                  apr_pool_t *pool)
+{
+  svn_client__pathrev_t *loc;
+  svn_ra_session_t *ra_session;
+  svn_node_kind_t kind;
+  const svn_delta_editor_t *cancel_editor;
+  void *cancel_baton;
+  report_baton_t rb = { 0 };
+  svn_delta_editor_t *editor = svn_delta_default_editor(pool);
+  apr_time_t start = apr_time_now();
+
+  /* Get the RA connection. */
+  SVN_ERR(svn_client__ra_session_from_path2(&ra_session, &loc, url,
+                                            wc_abspath, peg_revision,
+                                            revision, ctx, pool));
+
+  SVN_ERR(svn_ra_check_path(ra_session, "", loc->rev, &kind, pool));
+  if (kind == svn_node_none)
+    return svn_error_createf(SVN_ERR_RA_ILLEGAL_URL, NULL,
+                             _("URL '%s' doesn't exist"), url);
+  if (kind != svn_node_dir)
+    return svn_error_createf(SVN_ERR_RA_ILLEGAL_URL, NULL,
+                             _("URL '%s' refers to a file, not a directory"),
+                             url);
+
+  editor->set_target_revision = set_target_revision;
+  editor->open_root = open_root;
+  editor->delete_entry = delete_entry;
+  editor->add_directory = add_directory;
+  editor->open_directory = open_directory;
+  editor->change_dir_prop = change_dir_prop;
+  editor->close_directory = close_directory;
+  editor->add_file = add_file;
+  editor->open_file = open_file;
+  editor->apply_textdelta = apply_textdelta;
+  editor->change_file_prop = change_file_prop;
+  editor->close_file = close_file;
+  editor->close_edit = close_edit;
+
+  eb->source = svn_stream_create(eb, pool);
+  svn_stream_set_read2(eb->source, NULL, zero_read_handler);
+  eb->target = svn_stream_empty(pool);
+
+  SVN_ERR(svn_delta_get_cancellation_editor(ctx->cancel_func,
+                                            ctx->cancel_baton,
+                                            editor, eb,
+                                            &cancel_editor, &cancel_baton,
+                                            pool));
+
+  SVN_ERR(svn_ra_do_update3(ra_session,
+                            &rb.reporter, &rb.baton,
+                            loc->rev,
+                            "", /* no sub-target */
+                            depth,
+                            FALSE, /* don't want copyfrom-args */
+                            FALSE, /* don't want ignore_ancestry */
+                            cancel_editor, cancel_baton,
+                            pool, pool));
+
+  /* Session setup. */
+  rb.eb = eb;
+  rb.start = apr_time_now();
+  eb->timing->network += rb.start - start;
+
+  if (wc_abspath)
+    {
+      /* The crawler will finish the report. */
+      SVN_ERR(svn_wc_crawl_revisions5(ctx->wc_ctx, wc_abspath,
+                                      &timing_reporter, &rb,
+                                      FALSE, /* don't restore files */
+                                      depth,
+                                      TRUE, /* honor depth exclude */
+                                      FALSE, /* no depth compat. trick */
+                                      FALSE, /* no commit times */
+                                      ctx->cancel_func, ctx->cancel_baton,
+                                      NULL, NULL, pool));
+    }
+  else
+    {
+      SVN_ERR(timing_reporter.set_path(&rb, "", loc->rev,
+                                       /* Depth is irrelevant, as we're
+                                          passing start_empty=TRUE anyway. */
+                                       svn_depth_infinity,
+                                       TRUE, /* "help, my dir is empty!" */
+                                       NULL, pool));
+
+      SVN_ERR(timing_reporter.finish_report(&rb, pool));
+
+      /* We don't receive the "add directory" callback for the starting
+       * node. */
+      eb->dir_count++;
+    }
+
+  /* Time spent in the RA layer after the last editor callback. */
+  eb->timing->network += apr_time_now() - eb->mark;
+
+  return SVN_NO_ERROR;
+}
+
+/* Print the statistics collected in EB unless QUIET is set.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+print_stats(const edit_baton_t *eb,
+            svn_boolean_t quiet,
+            apr_pool_t *pool)
+{
+  if (quiet)
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_cmdline_printf(pool,
+                             _("%15s directories\n"
+                               "%15s files\n"
+                               "%15s bytes in files\n"
+                               "%15s properties\n"
+                               "%15s bytes in properties\n"),
+                             svn__ui64toa_sep(eb->dir_count, ',', pool),
+                             svn__ui64toa_sep(eb->file_count, ',', pool),
+                             svn__ui64toa_sep(eb->byte_count, ',', pool),
+                             svn__ui64toa_sep(eb->prop_count, ',', pool),
+                             svn__ui64toa_sep(eb->prop_byte_count, ',',
+                                              pool)));
+
+  return svn_error_trace(svn_cl__print_timing(eb->timing, pool));
+}
+
+/*** Code. ***/
+
+/* This implements the `svn_opt_subcommand_t' interface. */
+svn_error_t *
+svn_cl__null_checkout(apr_getopt_t *os,
+                      void *baton,
+                      apr_pool_t *pool)
+{
+  svn_cl__opt_state_t *opt_state = ((svn_cl__cmd_baton_t *) baton)->opt_state;
+  svn_client_ctx_t *ctx = ((svn_cl__cmd_baton_t *) baton)->ctx;
+  apr_array_header_t *targets;
+  svn_opt_revision_t peg_revision;
+  const char *url;
+  svn_opt_revision_t *revision = &opt_state->start_revision;
+  svn_cl__timing_t timing = { 0 };
+  edit_baton_t eb = { 0 };
+  apr_time_t cpu_start = svn_cl__cpu_time();
+  svn_error_t *err;
+
+  SVN_ERR(svn_cl__args_to_target_array_print_reserved(&targets, os,
+                                                      opt_state->targets,
+                                                      ctx, FALSE, pool));
+
+  /* We want exactly 1 target for this subcommand. */
+  if (targets->nelts < 1)
+    return svn_error_create(SVN_ERR_CL_INSUFFICIENT_ARGS, 0, NULL);
+  if (targets->nelts > 1)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, 0, NULL);
+
+  SVN_ERR(svn_opt_parse_path(&peg_revision, &url,
+                             APR_ARRAY_IDX(targets, 0, const char *), pool));
+  if (! svn_path_is_url(url))
+    return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                             _("'%s' does not appear to be a URL"), url);
+
+  if (peg_revision.kind == svn_opt_revision_unspecified)
+    peg_revision.kind = svn_opt_revision_head;
+  if (revision->kind == svn_opt_revision_unspecified)
+    revision = &peg_revision;
+
+  if (opt_state->depth == svn_depth_unknown)
+    opt_state->depth = svn_depth_infinity;
+
+  eb.timing = &timing;
+  err = bench_null_update(url, &peg_revision, revision, NULL,
+                          opt_state->depth, &eb, ctx, pool);
+  timing.cpu = svn_cl__cpu_time() - cpu_start;
+
+  SVN_ERR(svn_error_compose_create(err, print_stats(&eb, opt_state->quiet,
+                                                    pool)));
+
+  return SVN_NO_ERROR;
+}
+
+/* This implements the `svn_opt_subcommand_t' interface. */
+svn_error_t *
+svn_cl__null_update(apr_getopt_t *os,
+                    void *baton,
+                    apr_pool_t *pool)
+{
+  svn_cl__opt_state_t *opt_state = ((svn_cl__cmd_baton_t *) baton)->opt_state;
+  svn_client_ctx_t *ctx = ((svn_cl__cmd_baton_t *) baton)->ctx;
+  apr_array_header_t *targets;
+  const char *path;
+  const char *local_abspath;
+  const char *url;
+  svn_node_kind_t kind;
+  svn_opt_revision_t peg_revision;
+  svn_opt_revision_t *revision = &opt_state->start_revision;
+  svn_cl__timing_t timing = { 0 };
+  edit_baton_t eb = { 0 };
+  apr_time_t cpu_start = svn_cl__cpu_time();
+  svn_error_t *err;
+
+  SVN_ERR(svn_cl__args_to_target_array_print_reserved(&targets, os,
+                                                      opt_state->targets,
+                                                      ctx, FALSE, pool));
+
+  /* Add "." if user passed 0 arguments */
+  svn_opt_push_implicit_dot_target(targets, pool);
+  if (targets->nelts > 1)
+    return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, 0, NULL);
+
+  path = APR_ARRAY_IDX(targets, 0, const char *);
+  SVN_ERR(svn_cl__check_target_is_local_path(path));
+  SVN_ERR(svn_dirent_get_absolute(&local_abspath, path, pool));
+
+  SVN_ERR(svn_wc_read_kind2(&kind, ctx->wc_ctx, local_abspath,
+                            FALSE, FALSE, pool));
+  if (kind != svn_node_dir)
+    return svn_error_createf(SVN_ERR_ILLEGAL_TARGET, NULL,
+                             _("'%s' is not a working copy directory"),
+                             svn_dirent_local_style(local_abspath, pool));
+
+  SVN_ERR(svn_client_url_from_path2(&url, local_abspath, ctx, pool, pool));
+
+  peg_revision.kind = svn_opt_revision_head;
+  if (revision->kind == svn_opt_revision_unspecified)
+    revision = &peg_revision;
+
+  /* Like 'svn update', stay within the working copy's depth by default. */
+  eb.timing = &timing;
+  err = bench_null_update(url, &peg_revision, revision, local_abspath,
+                          opt_state->depth, &eb, ctx, pool);
+  timing.cpu = svn_cl__cpu_time() - cpu_start;
+
+  SVN_ERR(svn_error_compose_create(err, print_stats(&eb, opt_state->quiet,
+                                                    pool)));
+
+  return SVN_NO_ERROR;
+}
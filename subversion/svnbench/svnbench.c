@@ -69,7 +69,12 @@ typedef enum svn_cl__longopt_t {
   opt_trust_server_cert,
   opt_trust_server_cert_failures,
   opt_changelist,
-  opt_search
+  opt_search,
+  opt_file_count,
+  opt_file_size,
+  opt_dir_size,
+  opt_clients,
+  opt_duration
 } svn_cl__longopt_t;
 
 
@@ -168,6 +173,20 @@ const apr_getopt_option_t svn_cl__options[] =
                        "history")},
   {"search", opt_search, 1,
                        N_("use ARG as search pattern (glob syntax)")},
+  {"file-count",    opt_file_count, 1,
+                    N_("commit ARG files (default: 1000)")},
+  {"file-size",     opt_file_size, 1,
+                    N_("make committed files ARG bytes large on average\n"
+                       "                             "
+                       "(default: 4096)")},
+  {"dir-size",      opt_dir_size, 1,
+                    N_("put at most ARG entries into each committed\n"
+                       "                             "
+                       "directory (default: 32)")},
+  {"clients",       opt_clients, 1,
+                    N_("run ARG clients concurrently (default: 1)")},
+  {"duration",      opt_duration, 1,
+                    N_("run for ARG seconds (default: 10)")},
 
   /* Long-opt Aliases
    *
@@ -230,6 +249,40 @@ const svn_opt_subcommand_desc2_t svn_cl__cmd_table[] =
      "  Write the annotated result to standard output.\n"),
     {'r', 'g'} },
 
+  { "null-checkout", svn_cl__null_checkout, {"null-co"}, N_
+    ("Check out a tree without writing it anywhere.\n"
+     "usage: null-checkout [-r REV] URL[@PEGREV]\n"
+     "\n"
+     "  Runs the update protocol for an empty working copy of URL, at\n"
+     "  revision REV if it is given, otherwise at HEAD.  All data received\n"
+     "  is processed as for a real checkout, including the application of\n"
+     "  text deltas, and then discarded.\n"
+     "\n"
+     "  If specified, PEGREV determines in which revision the target is first\n"
+     "  looked up.\n"
+     "\n"
+     "  Besides the totals, reports where the time went:  Waiting for the\n"
+     "  server to respond, transferring data, applying deltas, other client\n"
+     "  code and the client's CPU time.\n"),
+    {'r', 'q', opt_depth} },
+
+  { "null-commit", svn_cl__null_commit, {0}, N_
+    ("Commit a synthetic tree.\n"
+     "usage: null-commit URL\n"
+     "\n"
+     "  Adds a new directory with generated contents below URL, in a single\n"
+     "  commit.  Use --file-count, --file-size and --dir-size to control the\n"
+     "  shape of the tree.  File sizes vary between 0 and 3 times the given\n"
+     "  average size, with small files being more frequent than large ones.\n"
+     "\n"
+     "  Besides the totals, reports where the time went:  Waiting for the\n"
+     "  server to finish the commit, transferring data, creating deltas,\n"
+     "  generating the contents and the client's CPU time.\n"),
+    {'q', opt_file_count, opt_file_size, opt_dir_size, opt_with_revprop},
+    {{opt_with_revprop, N_("set revision property ARG in new revision\n"
+                           "                             "
+                           "using the name[=value] format")}} },
+
   { "null-export", svn_cl__null_export, {0}, N_
     ("Create an unversioned copy of a tree.\n"
      "usage: null-export [-r REV] URL[@PEGREV]\n"
@@ -262,6 +315,28 @@ const svn_opt_subcommand_desc2_t svn_cl__cmd_table[] =
      "    Date and time of the last commit\n"),
     {'r', 'v', 'q', 'R', opt_depth, opt_search} },
 
+  { "null-load", svn_cl__null_load, {0}, N_
+    ("Put a repository server under load from concurrent clients.\n"
+     "usage: null-load [--clients N] [--duration SECS] URL [OP[:WEIGHT]...]\n"
+     "\n"
+     "  Runs N clients, each in a thread and with a session of its own, that\n"
+     "  repeatedly execute operations on URL for SECS seconds.\n"
+     "  Each operation is picked at random, with the probability given by\n"
+     "  its WEIGHT (default: 1) relative to the sum of all weights.\n"
+     "  The available operations are:\n"
+     "\n"
+     "    latest     fetch the HEAD revision number\n"
+     "    info       fetch information about URL\n"
+     "    list       list the directory at URL\n"
+     "    log        fetch the latest 100 log messages for URL\n"
+     "    checkout   check out URL, discarding all data\n"
+     "\n"
+     "  The default is 'latest:1 info:4 list:4 log:1'.\n"
+     "\n"
+     "  Reports throughput and the 50th, 99th and 99.9th percentile of the\n"
+     "  latency for each operation.\n"),
+    {'q', opt_clients, opt_duration} },
+
   { "null-log", svn_cl__null_log, {0}, N_
     ("Fetch the log messages for a set of revision(s) and/or path(s).\n"
      "usage: 1. null-log [PATH][@REV]\n"
@@ -306,6 +381,22 @@ const svn_opt_subcommand_desc2_t svn_cl__cmd_table[] =
     {'r', 'R', opt_depth, opt_targets, opt_changelist}
   },
 
+  { "null-update", svn_cl__null_update, {"null-up"}, N_
+    ("Update a working copy without modifying it.\n"
+     "usage: null-update [-r REV] [PATH]\n"
+     "\n"
+     "  Reports the state of the working copy directory PATH (default: '.')\n"
+     "  to the server and requests an update to revision REV if it is given,\n"
+     "  otherwise to HEAD.  All data received is processed as for a real\n"
+     "  update, including the application of text deltas, and then\n"
+     "  discarded.  The working copy itself remains unchanged.\n"
+     "\n"
+     "  Besides the totals, reports where the time went:  Waiting for the\n"
+     "  server to respond, transferring data, applying deltas, other client\n"
+     "  code, e.g. for crawling the working copy, and the client's CPU\n"
+     "  time.\n"),
+    {'r', 'q', opt_depth} },
+
   { NULL, NULL, {0}, NULL, {0} }
 };
 
@@ -690,6 +781,56 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
                                  apr_pstrdup(pool, utf8_opt_arg),
                                  pool);
         break;
+      case opt_file_count:
+        err = svn_cstring_atoi64(&opt_state.file_count, opt_arg);
+        if (err)
+          return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, err,
+                                  _("Non-numeric file count given"));
+        if (opt_state.file_count <= 0)
+          return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                  _("Argument to --file-count must be "
+                                    "positive"));
+        break;
+      case opt_file_size:
+        err = svn_cstring_atoi64(&opt_state.file_size, opt_arg);
+        if (err)
+          return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, err,
+                                  _("Non-numeric file size given"));
+        if (opt_state.file_size <= 0)
+          return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                  _("Argument to --file-size must be "
+                                    "positive"));
+        break;
+      case opt_dir_size:
+        err = svn_cstring_atoi(&opt_state.dir_size, opt_arg);
+        if (err)
+          return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, err,
+                                  _("Non-numeric directory size given"));
+        if (opt_state.dir_size < 2)
+          return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                  _("Argument to --dir-size must be "
+                                    "at least 2"));
+        break;
+      case opt_clients:
+        err = svn_cstring_atoi(&opt_state.clients, opt_arg);
+        if (err)
+          return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, err,
+                                  _("Non-numeric client count given"));
+        if (opt_state.clients <= 0)
+          return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                  _("Argument to --clients must be "
+                                    "positive"));
+        break;
+      case opt_duration:
+        err = svn_cstring_atoi(&opt_state.duration, opt_arg);
+        if (err)
+          return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, err,
+                                  _("Non-numeric duration given"));
+        if (opt_state.duration <= 0)
+          return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                  _("Argument to --duration must be "
+                                    "positive"));
+        break;
       default:
         /* Hmmm. Perhaps this would be a good place to squirrel away
            opts that commands like svn diff might need. Hmmm indeed. */
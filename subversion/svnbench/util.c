@@ -33,7 +33,13 @@
 #include <ctype.h>
 #include <assert.h>
 
+#ifndef WIN32
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
 #include "svn_private_config.h"
+#include "svn_cmdline.h"
 #include "svn_error.h"
 #include "svn_path.h"
 
@@ -90,3 +96,48 @@ svn_cl__local_style_skip_ancestor(const char *parent_path,
   return svn_dirent_local_style(relpath ? relpath : path, pool);
 }
 
+apr_time_t
+svn_cl__cpu_time(void)
+{
+#ifdef WIN32
+  FILETIME creation_time, exit_time, kernel_time, user_time;
+  ULARGE_INTEGER kernel, user;
+
+  if (!GetProcessTimes(GetCurrentProcess(), &creation_time, &exit_time,
+                       &kernel_time, &user_time))
+    return 0;
+
+  kernel.LowPart = kernel_time.dwLowDateTime;
+  kernel.HighPart = kernel_time.dwHighDateTime;
+  user.LowPart = user_time.dwLowDateTime;
+  user.HighPart = user_time.dwHighDateTime;
+
+  /* FILETIME counts in units of 100ns. */
+  return (apr_time_t)((kernel.QuadPart + user.QuadPart) / 10);
+#else
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+
+  return apr_time_make(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec,
+                       usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+#endif
+}
+
+svn_error_t *
+svn_cl__print_timing(const svn_cl__timing_t *timing,
+                     apr_pool_t *pool)
+{
+  return svn_error_trace(svn_cmdline_printf(pool,
+                           _("%15.6f seconds waiting for the server\n"
+                             "%15.6f seconds in network transfers\n"
+                             "%15.6f seconds processing deltas\n"
+                             "%15.6f seconds in other client code\n"
+                             "%15.6f seconds of client CPU time\n"),
+                           timing->server_wait / 1.0e6,
+                           timing->network / 1.0e6,
+                           timing->delta / 1.0e6,
+                           timing->client / 1.0e6,
+                           timing->cpu / 1.0e6));
+}
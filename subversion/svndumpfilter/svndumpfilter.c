@@ -44,6 +44,7 @@
 #include "svn_version.h"
 
 #include "private/svn_repos_private.h"
+#include "private/svn_io_private.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_sorts_private.h"
@@ -105,50 +106,6 @@ write_propdel_to_stringbuf(svn_stringbuf_t **strbuf,
 }
 
 
-/* Compare the node-path PATH with the (const char *) prefixes in PFXLIST.
- * Return TRUE if any prefix is a prefix of PATH (matching whole path
- * components); FALSE otherwise.
- * PATH starts with a '/', as do the (const char *) paths in PREFIXES. */
-static svn_boolean_t
-ary_prefix_match(const apr_array_header_t *pfxlist, const char *path)
-{
-  int i;
-  size_t path_len = strlen(path);
-
-  for (i = 0; i < pfxlist->nelts; i++)
-    {
-      const char *pfx = APR_ARRAY_IDX(pfxlist, i, const char *);
-      size_t pfx_len = strlen(pfx);
-
-      if (path_len < pfx_len)
-        continue;
-      if (strncmp(path, pfx, pfx_len) == 0
-          && (pfx_len == 1 || path[pfx_len] == '\0' || path[pfx_len] == '/'))
-        return TRUE;
-    }
-
-  return FALSE;
-}
-
-
-/* Check whether we need to skip this PATH based on its presence in
-   the PREFIXES list, and the DO_EXCLUDE option.
-   PATH starts with a '/', as do the (const char *) paths in PREFIXES. */
-static APR_INLINE svn_boolean_t
-skip_path(const char *path, const apr_array_header_t *prefixes,
-          svn_boolean_t do_exclude, svn_boolean_t glob)
-{
-  const svn_boolean_t matches =
-    (glob
-     ? svn_cstring_match_glob_list(path, prefixes)
-     : ary_prefix_match(prefixes, path));
-
-  /* NXOR */
-  return (matches ? do_exclude : !do_exclude);
-}
-
-
-
 /* Note: the input stream parser calls us with events.
    Output of the filtered dump occurs for the most part streamily with the
    event callbacks, to avoid caching large quantities of data in memory.
@@ -172,6 +129,17 @@ struct revmap_t
   svn_boolean_t was_dropped; /* Was this revision dropped? */
 };
 
+/* A node in the trie of path prefixes used for matching whole path
+   components.  The root represents "/". */
+struct prefix_trie_t
+{
+  /* Is the path leading to this node one of the prefixes? */
+  svn_boolean_t is_prefix;
+
+  /* Path component -> struct prefix_trie_t *, NULL if there are none. */
+  apr_hash_t *children;
+};
+
 struct parse_baton_t
 {
   /* Command-line options values. */
@@ -185,6 +153,7 @@ struct parse_baton_t
   svn_boolean_t skip_missing_merge_sources;
   svn_boolean_t allow_deltas;
   apr_array_header_t *prefixes;
+  struct prefix_trie_t *prefix_trie;  /* PREFIXES, unless GLOB is set. */
 
   /* Input and output streams. */
   svn_stream_t *in_stream;
@@ -192,14 +161,154 @@ struct parse_baton_t
 
   /* State for the filtering process. */
   apr_int32_t rev_drop_count;
-  apr_hash_t *dropped_nodes;
-  apr_hash_t *renumber_history;  /* svn_revnum_t -> struct revmap_t */
+  apr_hash_t *dropped_nodes;     /* Only kept for the final report. */
+  /* The struct revmap_t of every original revision from RENUMBER_BASE
+     on, indexed by their distance.  Revisions missing from the input
+     map to SVN_INVALID_REVNUM without being dropped. */
+  apr_array_header_t *renumber_history;
+  svn_revnum_t renumber_base;
   svn_revnum_t last_live_revision;
   /* The oldest original revision, greater than r0, in the input
      stream which was not filtered. */
   svn_revnum_t oldest_original_rev;
 };
 
+/* Add the prefixes in PREFIXES to the trie at ROOT, allocated in POOL.
+   The (const char *) paths in PREFIXES start with a '/'. */
+static void
+add_prefixes(struct prefix_trie_t *root,
+             const apr_array_header_t *prefixes,
+             apr_pool_t *pool)
+{
+  int i;
+
+  for (i = 0; i < prefixes->nelts; i++)
+    {
+      const char *start = APR_ARRAY_IDX(prefixes, i, const char *) + 1;
+      struct prefix_trie_t *node = root;
+
+      /* Prefix "/" matches everything. */
+      while (*start || node != root)
+        {
+          const char *end = strchr(start, '/');
+          apr_ssize_t len = end ? end - start : (apr_ssize_t)strlen(start);
+          struct prefix_trie_t *child = NULL;
+
+          if (node->children)
+            child = apr_hash_get(node->children, start, len);
+          else
+            node->children = apr_hash_make(pool);
+
+          if (! child)
+            {
+              child = apr_pcalloc(pool, sizeof(*child));
+              apr_hash_set(node->children, apr_pstrmemdup(pool, start, len),
+                           len, child);
+            }
+
+          node = child;
+          if (! end)
+            break;
+          start = end + 1;
+        }
+
+      node->is_prefix = TRUE;
+    }
+}
+
+/* Return TRUE if any prefix in TRIE is a prefix of PATH (matching whole
+   path components); FALSE otherwise.  PATH starts with a '/'. */
+static svn_boolean_t
+trie_prefix_match(const struct prefix_trie_t *trie, const char *path)
+{
+  const char *start = path + 1;
+
+  while (! trie->is_prefix)
+    {
+      const char *end = strchr(start, '/');
+      apr_ssize_t len = end ? end - start : (apr_ssize_t)strlen(start);
+
+      if (! trie->children)
+        return FALSE;
+
+      trie = apr_hash_get(trie->children, start, len);
+      if (! trie)
+        return FALSE;
+
+      if (! end)
+        return trie->is_prefix;
+      start = end + 1;
+    }
+
+  return TRUE;
+}
+
+
+/* Check whether we need to skip this PATH based on its presence in
+   the prefixes of PB, and the DO_EXCLUDE option.
+   PATH starts with a '/', as do the prefixes. */
+static APR_INLINE svn_boolean_t
+skip_path(const char *path, const struct parse_baton_t *pb)
+{
+  const svn_boolean_t matches =
+    (pb->glob
+     ? svn_cstring_match_glob_list(path, pb->prefixes)
+     : trie_prefix_match(pb->prefix_trie, path));
+
+  /* NXOR */
+  return (matches ? pb->do_exclude : !pb->do_exclude);
+}
+
+
+/* Return the renumbering information of the original revision REV in PB,
+   or NULL if there is none. */
+static struct revmap_t *
+get_revmap(const struct parse_baton_t *pb, svn_revnum_t rev)
+{
+  if (! SVN_IS_VALID_REVNUM(pb->renumber_base)
+      || rev < pb->renumber_base
+      || rev - pb->renumber_base >= pb->renumber_history->nelts)
+    return NULL;
+
+  return &APR_ARRAY_IDX(pb->renumber_history, rev - pb->renumber_base,
+                        struct revmap_t);
+}
+
+/* Record in PB that the original revision REV_ORIG maps to REV and
+   whether it WAS_DROPPED. */
+static svn_error_t *
+set_revmap(struct parse_baton_t *pb,
+           svn_revnum_t rev_orig,
+           svn_revnum_t rev,
+           svn_boolean_t was_dropped)
+{
+  struct revmap_t *revmap;
+
+  if (! SVN_IS_VALID_REVNUM(pb->renumber_base))
+    pb->renumber_base = rev_orig;
+
+  /* The table is indexed by revision, so revisions have to come in
+     ascending order, as they do in any dump stream. */
+  if (rev_orig - pb->renumber_base < pb->renumber_history->nelts)
+    return svn_error_createf(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                             _("Revision %ld out of order in dump stream"),
+                             rev_orig);
+
+  while (rev_orig - pb->renumber_base > pb->renumber_history->nelts)
+    {
+      revmap = apr_array_push(pb->renumber_history);
+      revmap->rev = SVN_INVALID_REVNUM;
+      revmap->was_dropped = FALSE;
+    }
+
+  revmap = apr_array_push(pb->renumber_history);
+  revmap->rev = rev;
+  revmap->was_dropped = was_dropped;
+
+  return SVN_NO_ERROR;
+}
+
+
 struct revision_baton_t
 {
   /* Reference to the global parse baton. */
@@ -394,16 +503,7 @@ output_revision(struct revision_baton_t *rb)
 
       if (rb->pb->do_renumber_revs)
         {
-          svn_revnum_t *rr_key;
-          struct revmap_t *rr_val;
-          apr_pool_t *rr_pool = apr_hash_pool_get(rb->pb->renumber_history);
-          rr_key = apr_palloc(rr_pool, sizeof(*rr_key));
-          rr_val = apr_palloc(rr_pool, sizeof(*rr_val));
-          *rr_key = rb->rev_orig;
-          rr_val->rev = rb->rev_actual;
-          rr_val->was_dropped = FALSE;
-          apr_hash_set(rb->pb->renumber_history, rr_key,
-                       sizeof(*rr_key), rr_val);
+          SVN_ERR(set_revmap(rb->pb, rb->rev_orig, rb->rev_actual, FALSE));
           rb->pb->last_live_revision = rb->rev_actual;
         }
 
@@ -417,18 +517,8 @@ output_revision(struct revision_baton_t *rb)
       /* We're dropping this revision. */
       rb->pb->rev_drop_count++;
       if (rb->pb->do_renumber_revs)
-        {
-          svn_revnum_t *rr_key;
-          struct revmap_t *rr_val;
-          apr_pool_t *rr_pool = apr_hash_pool_get(rb->pb->renumber_history);
-          rr_key = apr_palloc(rr_pool, sizeof(*rr_key));
-          rr_val = apr_palloc(rr_pool, sizeof(*rr_val));
-          *rr_key = rb->rev_orig;
-          rr_val->rev = rb->pb->last_live_revision;
-          rr_val->was_dropped = TRUE;
-          apr_hash_set(rb->pb->renumber_history, rr_key,
-                       sizeof(*rr_key), rr_val);
-        }
+        SVN_ERR(set_revmap(rb->pb, rb->rev_orig,
+                           rb->pb->last_live_revision, TRUE));
 
       if (! rb->pb->quiet)
         SVN_ERR(svn_cmdline_fprintf(stderr, subpool,
@@ -479,17 +569,17 @@ new_node_record(void **node_baton,
   if (copyfrom_path && copyfrom_path[0] != '/')
     copyfrom_path = apr_pstrcat(pool, "/", copyfrom_path, SVN_VA_NULL);
 
-  nb->do_skip = skip_path(node_path, pb->prefixes,
-                          pb->do_exclude, pb->glob);
+  nb->do_skip = skip_path(node_path, pb);
 
-  /* If we're skipping the node, take note of path, discarding the
-     rest.  */
+  /* If we're skipping the node, take note of path for the report,
+     discarding the rest.  */
   if (nb->do_skip)
     {
-      svn_hash_sets(pb->dropped_nodes,
-                    apr_pstrdup(apr_hash_pool_get(pb->dropped_nodes),
-                                node_path),
-                    (void *)1);
+      if (! pb->quiet)
+        svn_hash_sets(pb->dropped_nodes,
+                      apr_pstrdup(apr_hash_pool_get(pb->dropped_nodes),
+                                  node_path),
+                      (void *)1);
       nb->rb->had_dropped_nodes = TRUE;
     }
   else
@@ -500,8 +590,7 @@ new_node_record(void **node_baton,
       tcl = svn_hash_gets(headers, SVN_REPOS_DUMPFILE_TEXT_CONTENT_LENGTH);
 
       /* Test if this node was copied from dropped source. */
-      if (copyfrom_path &&
-          skip_path(copyfrom_path, pb->prefixes, pb->do_exclude, pb->glob))
+      if (copyfrom_path && skip_path(copyfrom_path, pb))
         {
           /* This node was copied from a dropped source.
              We have a problem, since we did not want to drop this node too.
@@ -593,7 +682,7 @@ new_node_record(void **node_baton,
 
           /* Rewrite Node-Copyfrom-Rev if we are renumbering revisions.
              The number points to some revision in the past. We keep track
-             of revision renumbering in an apr_hash, which maps original
+             of revision renumbering in a table, which maps original
              revisions to new ones. Dropped revision are mapped to -1.
              This should never happen here.
           */
@@ -604,9 +693,7 @@ new_node_record(void **node_baton,
               struct revmap_t *cf_renum_val;
 
               cf_orig_rev = SVN_STR_TO_REV(val);
-              cf_renum_val = apr_hash_get(pb->renumber_history,
-                                          &cf_orig_rev,
-                                          sizeof(cf_orig_rev));
+              cf_renum_val = get_revmap(pb, cf_orig_rev);
               if (! (cf_renum_val && SVN_IS_VALID_REVNUM(cf_renum_val->rev)))
                 return svn_error_createf
                   (SVN_ERR_NODE_UNEXPECTED_KIND, NULL,
@@ -672,7 +759,7 @@ adjust_mergeinfo(svn_string_t **final_val, const svn_string_t *initial_val,
       struct parse_baton_t *pb = rb->pb;
 
       /* Determine whether the merge_source is a part of the prefix. */
-      if (skip_path(merge_source, pb->prefixes, pb->do_exclude, pb->glob))
+      if (skip_path(merge_source, pb))
         {
           if (pb->skip_missing_merge_sources)
             continue;
@@ -695,15 +782,13 @@ adjust_mergeinfo(svn_string_t **final_val, const svn_string_t *initial_val,
               svn_merge_range_t *range = APR_ARRAY_IDX(rangelist, i,
                                                        svn_merge_range_t *);
 
-              revmap_start = apr_hash_get(pb->renumber_history,
-                                          &range->start, sizeof(range->start));
+              revmap_start = get_revmap(pb, range->start);
               if (! (revmap_start && SVN_IS_VALID_REVNUM(revmap_start->rev)))
                 return svn_error_createf
                   (SVN_ERR_NODE_UNEXPECTED_KIND, NULL,
                    _("No valid revision range 'start' in filtered stream"));
 
-              revmap_end = apr_hash_get(pb->renumber_history,
-                                        &range->end, sizeof(range->end));
+              revmap_end = get_revmap(pb, range->end);
               if (! (revmap_end && SVN_IS_VALID_REVNUM(revmap_end->rev)))
                 return svn_error_createf
                   (SVN_ERR_NODE_UNEXPECTED_KIND, NULL,
@@ -1032,9 +1117,17 @@ parse_baton_initialize(struct parse_baton_t **pb,
                        apr_pool_t *pool)
 {
   struct parse_baton_t *baton = apr_palloc(pool, sizeof(*baton));
+  apr_file_t *stdin_file;
+  apr_finfo_t finfo;
 
-  /* Read the stream from STDIN.  Users can redirect a file. */
+  /* Read the stream from STDIN.  Users can redirect a file.  If they do,
+     the parser may seek over the contents of nodes we drop. */
   SVN_ERR(svn_stream_for_stdin2(&baton->in_stream, TRUE, pool));
+  stdin_file = svn_stream__aprfile(baton->in_stream);
+  if (stdin_file
+      && apr_file_info_get(&finfo, APR_FINFO_TYPE, stdin_file) == APR_SUCCESS
+      && finfo.filetype == APR_REG)
+    baton->in_stream = svn_stream_from_aprfile2(stdin_file, TRUE, pool);
 
   /* Have the parser dump results to STDOUT. Users can redirect a file. */
   SVN_ERR(svn_stream_for_stdout(&baton->out_stream, pool));
@@ -1053,10 +1146,15 @@ parse_baton_initialize(struct parse_baton_t **pb,
   baton->quiet = opt_state->quiet;
   baton->glob = opt_state->glob;
   baton->prefixes = opt_state->prefixes;
+  baton->prefix_trie = apr_pcalloc(pool, sizeof(*baton->prefix_trie));
+  if (! baton->glob)
+    add_prefixes(baton->prefix_trie, baton->prefixes, pool);
   baton->skip_missing_merge_sources = opt_state->skip_missing_merge_sources;
   baton->rev_drop_count = 0; /* used to shift revnums while filtering */
   baton->dropped_nodes = apr_hash_make(pool);
-  baton->renumber_history = apr_hash_make(pool);
+  baton->renumber_history = apr_array_make(pool, 0,
+                                           sizeof(struct revmap_t));
+  baton->renumber_base = SVN_INVALID_REVNUM;
   baton->last_live_revision = SVN_INVALID_REVNUM;
   baton->oldest_original_rev = SVN_INVALID_REVNUM;
   baton->allow_deltas = FALSE;
@@ -1191,28 +1289,18 @@ do_filter(apr_getopt_t *os,
       SVN_ERR(svn_cmdline_fputs(_("Revisions renumbered as follows:\n"),
                                 stderr, subpool));
 
-      /* Get the keys of the hash, sort them, then print the hash keys
-         and values, sorted by keys. */
-      num_keys = apr_hash_count(pb->renumber_history);
-      keys = apr_array_make(pool, num_keys + 1, sizeof(svn_revnum_t));
-      for (hi = apr_hash_first(pool, pb->renumber_history);
-           hi;
-           hi = apr_hash_next(hi))
+      /* The table is sorted by original revision already. */
+      for (i = 0; i < pb->renumber_history->nelts; i++)
         {
-          const svn_revnum_t *revnum = apr_hash_this_key(hi);
+          svn_revnum_t this_key = pb->renumber_base + i;
+          struct revmap_t *this_val = &APR_ARRAY_IDX(pb->renumber_history, i,
+                                                     struct revmap_t);
 
-          APR_ARRAY_PUSH(keys, svn_revnum_t) = *revnum;
-        }
-      svn_sort__array(keys, svn_sort_compare_revisions);
-      for (i = 0; i < keys->nelts; i++)
-        {
-          svn_revnum_t this_key;
-          struct revmap_t *this_val;
+          /* Skip revisions missing from the input. */
+          if (! this_val->was_dropped && ! SVN_IS_VALID_REVNUM(this_val->rev))
+            continue;
 
           svn_pool_clear(subpool);
-          this_key = APR_ARRAY_IDX(keys, i, svn_revnum_t);
-          this_val = apr_hash_get(pb->renumber_history, &this_key,
-                                  sizeof(this_key));
           if (this_val->was_dropped)
             SVN_ERR(svn_cmdline_fprintf(stderr, subpool,
                                         _("   %ld => (dropped)\n"),
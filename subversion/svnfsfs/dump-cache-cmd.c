@@ -0,0 +1,104 @@
+/* dump-cache-cmd.c -- implements the dump-cache sub-command.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "svn_dirent_uri.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_pools.h"
+#include "private/svn_fs_fs_private.h"
+
+#include "svn_private_config.h"
+#include "svnfsfs.h"
+
+/* Read the directory PATH in ROOT and all its sub-directories such that
+ * their contents get cached.  Use SCRATCH_POOL for temporary allocations.
+ */
+static svn_error_t *
+read_tree(svn_fs_root_t *root,
+          const char *path,
+          apr_pool_t *scratch_pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(scratch_pool);
+  apr_hash_t *entries;
+  apr_hash_t *props;
+  apr_hash_index_t *hi;
+
+  SVN_ERR(check_cancel(NULL));
+  SVN_ERR(svn_fs_node_proplist(&props, root, path, scratch_pool));
+  SVN_ERR(svn_fs_dir_entries(&entries, root, path, scratch_pool));
+
+  for (hi = apr_hash_first(scratch_pool, entries); hi; hi = apr_hash_next(hi))
+    {
+      svn_fs_dirent_t *dirent = apr_hash_this_val(hi);
+
+      svn_pool_clear(iterpool);
+      if (dirent->kind == svn_node_dir)
+        SVN_ERR(read_tree(root,
+                          svn_dirent_join(path, dirent->name, iterpool),
+                          iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Open the repository at PATH, read the tree of its HEAD revision and
+ * write a snapshot of the resulting cache contents to stdout.  Use POOL
+ * for allocations.
+ */
+static svn_error_t *
+dump_cache(const char *path,
+           apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_root_t *root;
+  svn_revnum_t youngest;
+  svn_stream_t *stream;
+
+  /* Servers open repositories by their absolute path.  Since that path
+   * is part of all cache keys, we have to do the same. */
+  SVN_ERR(svn_dirent_get_absolute(&path, path, pool));
+  SVN_ERR(open_fs(&fs, path, pool));
+
+  /* Fill the cache. */
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, youngest, pool));
+  SVN_ERR(read_tree(root, "/", pool));
+
+  /* Dump it. */
+  SVN_ERR(svn_stream_for_stdout(&stream, pool));
+  SVN_ERR(svn_fs_fs__dump_cache(fs, stream, pool));
+
+  return svn_error_trace(svn_stream_close(stream));
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+svn_error_t *
+subcommand__dump_cache(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+
+  SVN_ERR(dump_cache(opt_state->repository_path, pool));
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,59 @@
+/* rebuild-indexes-cmd.c -- implements the rebuild-indexes sub-command.
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include "private/svn_fs_fs_private.h"
+
+#include "svn_private_config.h"
+
+#include "svnfsfs.h"
+
+/* Our progress function prints the first REVISION of every rev / pack
+ * file that got its indexes rebuilt, unless BATON says to be quiet.
+ */
+static void
+print_progress(svn_revnum_t revision,
+               void *baton,
+               apr_pool_t *pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+
+  if (!opt_state->quiet)
+    {
+      printf(_("* Rebuilt indexes of the file starting at r%ld.\n"),
+             revision);
+      fflush(stdout);
+    }
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+svn_error_t *
+subcommand__rebuild_indexes(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  svnfsfs__opt_state *opt_state = baton;
+  svn_fs_t *fs;
+
+  SVN_ERR(open_fs(&fs, opt_state->repository_path, pool));
+  SVN_ERR(svn_fs_fs__rebuild_indexes(fs, opt_state->jobs, print_progress,
+                                     opt_state, check_cancel, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
@@ -76,7 +76,9 @@ check_lib_versions(void)
 
 enum svnfsfs__cmdline_options_t
   {
-    svnfsfs__version = SVN_OPT_FIRST_LONGOPT_ID
+    svnfsfs__version = SVN_OPT_FIRST_LONGOPT_ID,
+    svnfsfs__jobs,
+    svnfsfs__stats_cache
   };
 
 /* Option codes and descriptions.
@@ -104,6 +106,14 @@ static const apr_getopt_option_t options_table[] =
      N_("size of the extra in-memory cache in MB used to\n"
         "                             minimize redundant operations. Default: 16.")},
 
+    {"jobs",          svnfsfs__jobs, 1,
+     N_("process up to ARG pack files concurrently.\n"
+        "                             Default: 1.")},
+
+    {"stats-cache",   svnfsfs__stats_cache, 1,
+     N_("keep the data read from pack files in directory\n"
+        "                             ARG and reuse it in later runs")},
+
     {NULL}
   };
 
@@ -118,6 +128,16 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
     "Describe the usage of this program or its subcommands.\n"),
    {0} },
 
+  {"dump-cache", subcommand__dump_cache, {0}, N_
+   ("usage: svnfsfs dump-cache REPOS_PATH\n\n"
+    "Read all directories of the HEAD revision and write a snapshot of the\n"
+    "resulting in-memory cache contents to console.  Servers can be configured\n"
+    "to pre-load their caches from that snapshot using the 'snapshot-file'\n"
+    "option in the repository's db/fsfs.conf file.  The snapshot can only be\n"
+    "used by the same Subversion release on the same platform.  Make sure that\n"
+    "the -M cache size is large enough to hold all directories.\n"),
+   {'M'} },
+
   {"dump-index", subcommand__dump_index, {0}, N_
    ("usage: svnfsfs dump-index REPOS_PATH -r REV\n\n"
     "Dump the index contents for the revision / pack file containing revision REV\n"
@@ -152,10 +172,25 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
     "number is automatically extracted from input stream.  No ordering is required.\n"),
    {'M'} },
 
+  {"rebuild-indexes", subcommand__rebuild_indexes, {0}, N_
+   ("usage: svnfsfs rebuild-indexes REPOS_PATH\n\n"
+    "Rewrite the log-to-phys and phys-to-log indexes of all revision and pack\n"
+    "files from the contents of their phys-to-log indexes.  Item checksums are\n"
+    "recalculated from the file contents and the index page sizes configured\n"
+    "in db/fsfs.conf are used.  This is only available for FSFS format 7\n"
+    "(SVN 1.9+) repositories.  With --jobs, multiple files are processed\n"
+    "concurrently.  The repository will not be packed while this runs.\n"),
+   {'q', 'M', svnfsfs__jobs} },
+
   {"stats", subcommand__stats, {0}, N_
    ("usage: svnfsfs stats REPOS_PATH\n\n"
-    "Write object size statistics to console.\n"),
-   {'M'} },
+    "Write object size statistics to console.\n"
+    "\n"
+    "In repositories using logical addressing (FSFS format 7+), --jobs allows\n"
+    "pack files to be read concurrently.  With --stats-cache, the data read\n"
+    "from pack files is kept in the given directory, so later runs only need\n"
+    "to read shards that have been packed since.\n"),
+   {'M', svnfsfs__jobs, svnfsfs__stats_cache} },
 
   { NULL, NULL, {0}, NULL, {0} }
 };
@@ -247,6 +282,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_state.start_revision.kind = svn_opt_revision_unspecified;
   opt_state.end_revision.kind = svn_opt_revision_unspecified;
   opt_state.memory_cache_size = svn_cache_config_get()->cache_size;
+  opt_state.jobs = 1;
 
   /* Parse options. */
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
@@ -307,6 +343,18 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       case svnfsfs__version:
         opt_state.version = TRUE;
         break;
+      case svnfsfs__jobs:
+        SVN_ERR(svn_cstring_atoi(&opt_state.jobs, opt_arg));
+        if (opt_state.jobs < 1)
+          return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("Invalid number of jobs '%s'"),
+                                   opt_arg);
+        break;
+      case svnfsfs__stats_cache:
+        SVN_ERR(svn_utf_cstring_to_utf8(&utf8_opt_arg, opt_arg, pool));
+        opt_state.stats_cache = svn_dirent_internal_style(utf8_opt_arg,
+                                                          pool);
+        break;
       default:
         {
           SVN_ERR(subcommand__help(NULL, NULL, pool));
@@ -433,7 +481,9 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     svn_cache_config_t settings = *svn_cache_config_get();
 
     settings.cache_size = opt_state.memory_cache_size;
-    settings.single_threaded = TRUE;
+
+    /* Parallel stats and rebuild-indexes jobs share the caches. */
+    settings.single_threaded = opt_state.jobs <= 1;
 
     svn_cache_config_set(&settings);
   }
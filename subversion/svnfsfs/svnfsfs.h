@@ -45,13 +45,17 @@ typedef struct svnfsfs__opt_state
   svn_boolean_t version;                            /* --version */
   svn_boolean_t quiet;                              /* --quiet */
   apr_uint64_t memory_cache_size;                   /* --memory-cache-size M */
+  int jobs;                                         /* --jobs */
+  const char *stats_cache;                          /* --stats-cache */
 } svnfsfs__opt_state;
 
 /* Declare all the command procedures */
 svn_opt_subcommand_t
   subcommand__help,
+  subcommand__dump_cache,
   subcommand__dump_index,
   subcommand__load_index,
+  subcommand__rebuild_indexes,
   subcommand__stats;
 
 
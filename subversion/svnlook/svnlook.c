@@ -28,6 +28,7 @@
 #include <apr_pools.h>
 #include <apr_time.h>
 #include <apr_file_io.h>
+#include <apr_strings.h>
 
 #define APR_WANT_STDIO
 #define APR_WANT_STRFUNC
@@ -70,6 +71,7 @@
 
 static svn_opt_subcommand_t
   subcommand_author,
+  subcommand_batch,
   subcommand_cat,
   subcommand_changed,
   subcommand_date,
@@ -219,6 +221,22 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
       "Print the author.\n"),
    {'r', 't'} },
 
+  {"batch", subcommand_batch, {0},
+   N_("usage: svnlook batch REPOS_PATH\n\n"
+      "Read svnlook commands from standard input, one per line, and run\n"
+      "them against REPOS_PATH in a single process.  Each line holds a\n"
+      "subcommand with its arguments and options, but without REPOS_PATH.\n"
+      "Arguments may be quoted.  Empty lines and lines starting with '#'\n"
+      "are ignored.  Commands without '--revision' or '--transaction' act\n"
+      "on the revision or transaction given to 'batch'.\n"
+      "\n"
+      "The repository, its caches and every revision or transaction root\n"
+      "looked at stay open until the end of the input, so hook scripts\n"
+      "running many commands against the same commit do not pay for\n"
+      "opening them over and over.  A failing command is reported on\n"
+      "standard error and does not stop the batch.\n"),
+   {'r', 't', 'M'} },
+
   {"cat", subcommand_cat, {0},
    N_("usage: svnlook cat REPOS_PATH FILE_PATH\n\n"
       "Print the contents of a file.  Leading '/' on FILE_PATH is optional.\n"),
@@ -319,6 +337,23 @@ static const svn_opt_subcommand_desc2_t cmd_table[] =
 };
 
 
+/* Repository state kept open across all commands of 'svnlook batch'. */
+typedef struct batch_state_t
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+
+  /* Open transactions (svn_fs_txn_t *), keyed by name. */
+  apr_hash_t *txns;
+
+  /* Open roots (svn_fs_root_t *), keyed by "r<revision>" for revision
+   * roots and "t<name>" for transaction roots. */
+  apr_hash_t *roots;
+
+  /* Everything above lives in this pool. */
+  apr_pool_t *pool;
+} batch_state_t;
+
 /* Baton for passing option/argument state to a subcommand function. */
 struct svnlook_opt_state
 {
@@ -348,6 +383,7 @@ struct svnlook_opt_state
   svn_boolean_t show_inherited_props; /*  --show-inherited-props */
   svn_boolean_t no_newline;       /* --no-newline */
   apr_uint64_t memory_cache_size; /* --memory-cache-size */
+  batch_state_t *batch;           /* non-NULL while running 'batch' */
 };
 
 
@@ -370,6 +406,7 @@ typedef struct svnlook_ctxt_t
   svn_boolean_t ignore_properties;
   svn_boolean_t properties_only;
   const char *diff_cmd;
+  batch_state_t *batch;
 
 } svnlook_ctxt_t;
 
@@ -428,6 +465,29 @@ get_root(svn_fs_root_t **root,
          svnlook_ctxt_t *c,
          apr_pool_t *pool)
 {
+  /* In batch mode, reuse the roots of the previous commands. */
+  if (c->batch)
+    {
+      batch_state_t *batch = c->batch;
+      const char *key = c->is_revision
+                      ? apr_psprintf(pool, "r%ld", c->rev_id)
+                      : apr_pstrcat(pool, "t", c->txn_name, SVN_VA_NULL);
+
+      *root = svn_hash_gets(batch->roots, key);
+      if (*root == NULL)
+        {
+          if (c->is_revision)
+            SVN_ERR(svn_fs_revision_root(root, c->fs, c->rev_id,
+                                         batch->pool));
+          else
+            SVN_ERR(svn_fs_txn_root(root, c->txn, batch->pool));
+
+          svn_hash_sets(batch->roots, apr_pstrdup(batch->pool, key), *root);
+        }
+
+      return SVN_NO_ERROR;
+    }
+
   /* Open up the appropriate root (revision or transaction). */
   if (c->is_revision)
     {
@@ -2065,10 +2125,19 @@ get_ctxt_baton(svnlook_ctxt_t **baton_p,
 {
   svnlook_ctxt_t *baton = apr_pcalloc(pool, sizeof(*baton));
 
-  SVN_ERR(svn_repos_open3(&(baton->repos), opt_state->repos_path, NULL,
-                          pool, pool));
-  baton->fs = svn_repos_fs(baton->repos);
-  svn_fs_set_warning_func(baton->fs, warning_func, NULL);
+  if (opt_state->batch)
+    {
+      baton->repos = opt_state->batch->repos;
+      baton->fs = opt_state->batch->fs;
+      baton->batch = opt_state->batch;
+    }
+  else
+    {
+      SVN_ERR(svn_repos_open3(&(baton->repos), opt_state->repos_path, NULL,
+                              pool, pool));
+      baton->fs = svn_repos_fs(baton->repos);
+      svn_fs_set_warning_func(baton->fs, warning_func, NULL);
+    }
   baton->show_ids = opt_state->show_ids;
   baton->limit = opt_state->limit;
   baton->no_diff_deleted = opt_state->no_diff_deleted;
@@ -2086,7 +2155,21 @@ get_ctxt_baton(svnlook_ctxt_t **baton_p,
   baton->properties_only = opt_state->properties_only;
   baton->diff_cmd = opt_state->diff_cmd;
 
-  if (baton->txn_name)
+  if (baton->txn_name && baton->batch)
+    {
+      batch_state_t *batch = baton->batch;
+
+      baton->txn = svn_hash_gets(batch->txns, baton->txn_name);
+      if (baton->txn == NULL)
+        {
+          SVN_ERR(svn_fs_open_txn(&(baton->txn), baton->fs,
+                                  baton->txn_name, batch->pool));
+          svn_hash_sets(batch->txns,
+                        apr_pstrdup(batch->pool, baton->txn_name),
+                        baton->txn);
+        }
+    }
+  else if (baton->txn_name)
     SVN_ERR(svn_fs_open_txn(&(baton->txn), baton->fs,
                             baton->txn_name, pool));
   else if (baton->rev_id == SVN_INVALID_REVNUM)
@@ -2096,6 +2179,159 @@ get_ctxt_baton(svnlook_ctxt_t **baton_p,
   return SVN_NO_ERROR;
 }
 
+/* Apply the option OPT_ID with argument OPT_ARG, as returned by
+ * apr_getopt_long() for options_table, to OPT_STATE. */
+static svn_error_t *
+parse_option(struct svnlook_opt_state *opt_state,
+             int opt_id,
+             const char *opt_arg)
+{
+  switch (opt_id)
+    {
+    case 'r':
+      {
+        char *digits_end = NULL;
+        opt_state->rev = strtol(opt_arg, &digits_end, 10);
+        if ((! SVN_IS_VALID_REVNUM(opt_state->rev))
+            || (! digits_end)
+            || *digits_end)
+          return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                  _("Invalid revision number supplied"));
+      }
+      break;
+
+    case 't':
+      opt_state->txn = opt_arg;
+      break;
+
+    case 'M':
+      opt_state->memory_cache_size
+        = 0x100000 * apr_strtoi64(opt_arg, NULL, 0);
+      break;
+
+    case 'N':
+      opt_state->non_recursive = TRUE;
+      break;
+
+    case 'v':
+      opt_state->verbose = TRUE;
+      break;
+
+    case 'h':
+    case '?':
+      opt_state->help = TRUE;
+      break;
+
+    case 'q':
+      opt_state->quiet = TRUE;
+      break;
+
+    case svnlook__revprop_opt:
+      opt_state->revprop = TRUE;
+      break;
+
+    case svnlook__xml_opt:
+      opt_state->xml = TRUE;
+      break;
+
+    case svnlook__version:
+      opt_state->version = TRUE;
+      break;
+
+    case svnlook__show_ids:
+      opt_state->show_ids = TRUE;
+      break;
+
+    case 'l':
+      {
+        char *end;
+        opt_state->limit = strtol(opt_arg, &end, 10);
+        if (end == opt_arg || *end != '\0')
+          {
+            return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                    _("Non-numeric limit argument given"));
+          }
+        if (opt_state->limit <= 0)
+          {
+            return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                _("Argument to --limit must be positive"));
+          }
+      }
+      break;
+
+    case svnlook__no_diff_deleted:
+      opt_state->no_diff_deleted = TRUE;
+      break;
+
+    case svnlook__no_diff_added:
+      opt_state->no_diff_added = TRUE;
+      break;
+
+    case svnlook__diff_copy_from:
+      opt_state->diff_copy_from = TRUE;
+      break;
+
+    case svnlook__full_paths:
+      opt_state->full_paths = TRUE;
+      break;
+
+    case svnlook__copy_info:
+      opt_state->copy_info = TRUE;
+      break;
+
+    case 'x':
+      opt_state->extensions = opt_arg;
+      break;
+
+    case svnlook__ignore_properties:
+      opt_state->ignore_properties = TRUE;
+      break;
+
+    case svnlook__properties_only:
+      opt_state->properties_only = TRUE;
+      break;
+
+    case svnlook__diff_cmd:
+      opt_state->diff_cmd = opt_arg;
+      break;
+
+    case svnlook__show_inherited_props:
+      opt_state->show_inherited_props = TRUE;
+      break;
+
+    case svnlook__no_newline:
+      opt_state->no_newline = TRUE;
+      break;
+
+    default:
+      return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                              _("Unknown option"));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Return an error if the options in OPT_STATE contradict each other. */
+static svn_error_t *
+check_option_conflicts(const struct svnlook_opt_state *opt_state)
+{
+  /* The --transaction and --revision options may not co-exist. */
+  if ((opt_state->rev != SVN_INVALID_REVNUM) && opt_state->txn)
+    return svn_error_create
+                (SVN_ERR_CL_MUTUALLY_EXCLUSIVE_ARGS, NULL,
+                 _("The '--transaction' (-t) and '--revision' (-r) arguments "
+                   "cannot co-exist"));
+
+  /* The --show-inherited-props and --revprop options may not co-exist. */
+  if (opt_state->show_inherited_props && opt_state->revprop)
+    return svn_error_create
+                (SVN_ERR_CL_MUTUALLY_EXCLUSIVE_ARGS, NULL,
+                 _("Cannot use the '--show-inherited-props' option with the "
+                   "'--revprop' option"));
+
+  return SVN_NO_ERROR;
+}
+
 
 
 /*** Subcommands. ***/
@@ -2114,6 +2350,210 @@ subcommand_author(apr_getopt_t *os, void *baton, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Run the command in LINE, which has the syntax of an svnlook command
+ * line without the program name and the repository path, against the
+ * repository opened in BATCH.  Take the repository path and the default
+ * revision or transaction from BATCH_OPT_STATE.  Use POOL for all
+ * allocations. */
+static svn_error_t *
+run_batch_command(const char *line,
+                  const struct svnlook_opt_state *batch_opt_state,
+                  batch_state_t *batch,
+                  apr_pool_t *pool)
+{
+  const svn_opt_subcommand_desc2_t *subcommand = NULL;
+  struct svnlook_opt_state opt_state;
+  apr_array_header_t *received_opts;
+  apr_status_t apr_err;
+  apr_getopt_t *os;
+  char **tokens;
+  const char **argv;
+  int argc;
+  int opt_id;
+  int i;
+
+  apr_err = apr_tokenize_to_argv(line, &tokens, pool);
+  if (apr_err)
+    return svn_error_wrap_apr(apr_err, _("Can't parse command '%s'"), line);
+
+  /* apr_getopt expects the program name in front of the arguments. */
+  for (argc = 0; tokens[argc]; argc++)
+    ;
+  argv = apr_palloc(pool, (argc + 2) * sizeof(*argv));
+  argv[0] = "svnlook";
+  for (i = 0; i < argc; i++)
+    argv[i + 1] = tokens[i];
+  argv[++argc] = NULL;
+
+  SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
+  os->interleave = 1;
+
+  memset(&opt_state, 0, sizeof(opt_state));
+  opt_state.rev = SVN_INVALID_REVNUM;
+  opt_state.memory_cache_size = batch_opt_state->memory_cache_size;
+  opt_state.repos_path = batch_opt_state->repos_path;
+  opt_state.batch = batch;
+
+  received_opts = apr_array_make(pool, SVN_OPT_MAX_OPTIONS, sizeof(int));
+  while (1)
+    {
+      const char *opt_arg;
+
+      apr_err = apr_getopt_long(os, options_table, &opt_id, &opt_arg);
+      if (APR_STATUS_IS_EOF(apr_err))
+        break;
+      else if (apr_err)
+        return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                 _("Invalid options in command '%s'"),
+                                 line);
+
+      APR_ARRAY_PUSH(received_opts, int) = opt_id;
+      SVN_ERR(parse_option(&opt_state, opt_id, opt_arg));
+    }
+
+  SVN_ERR(check_option_conflicts(&opt_state));
+
+  if (opt_state.help)
+    subcommand = svn_opt_get_canonical_subcommand2(cmd_table, "help");
+
+  if (subcommand == NULL)
+    {
+      const char *first_arg;
+
+      if (os->ind >= os->argc)
+        return svn_error_create(SVN_ERR_CL_INSUFFICIENT_ARGS, NULL,
+                                _("Subcommand argument required"));
+
+      first_arg = os->argv[os->ind++];
+      subcommand = svn_opt_get_canonical_subcommand2(cmd_table, first_arg);
+      if (subcommand == NULL)
+        {
+          const char *first_arg_utf8;
+
+          SVN_ERR(svn_utf_cstring_to_utf8(&first_arg_utf8, first_arg,
+                                          pool));
+          return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("Unknown subcommand: '%s'"),
+                                   first_arg_utf8);
+        }
+      if (subcommand->cmd_func == subcommand_batch)
+        return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                _("The 'batch' subcommand cannot be used "
+                                  "within a batch"));
+    }
+
+  /* Commands without a revision or transaction of their own look at
+     the one given to 'batch', as far as they support it. */
+  if (! SVN_IS_VALID_REVNUM(opt_state.rev) && opt_state.txn == NULL)
+    {
+      if (svn_opt_subcommand_takes_option3(subcommand, 'r', NULL))
+        opt_state.rev = batch_opt_state->rev;
+      if (svn_opt_subcommand_takes_option3(subcommand, 't', NULL))
+        opt_state.txn = batch_opt_state->txn;
+    }
+
+  /* As on the command line, any arguments after the subcommand are
+     ARG1 and ARG2.  Only the repository path has been left out. */
+  if (subcommand->cmd_func != subcommand_help)
+    {
+      if (os->ind < os->argc)
+        {
+          SVN_ERR(svn_utf_cstring_to_utf8(&opt_state.arg1,
+                                          os->argv[os->ind++], pool));
+          opt_state.arg1 = svn_dirent_internal_style(opt_state.arg1, pool);
+        }
+      if (os->ind < os->argc)
+        {
+          SVN_ERR(svn_utf_cstring_to_utf8(&opt_state.arg2,
+                                          os->argv[os->ind++], pool));
+          opt_state.arg2 = svn_dirent_internal_style(opt_state.arg2, pool);
+        }
+    }
+
+  for (i = 0; i < received_opts->nelts; i++)
+    {
+      opt_id = APR_ARRAY_IDX(received_opts, i, int);
+
+      if (opt_id == 'h' || opt_id == '?')
+        continue;
+
+      if (! svn_opt_subcommand_takes_option3(subcommand, opt_id, NULL))
+        {
+          const char *optstr;
+          const apr_getopt_option_t *badopt =
+            svn_opt_get_option_from_code2(opt_id, options_table, subcommand,
+                                          pool);
+          svn_opt_format_option(&optstr, badopt, FALSE, pool);
+          return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                   _("Subcommand '%s' doesn't accept "
+                                     "option '%s'"),
+                                   subcommand->name, optstr);
+        }
+    }
+
+  return svn_error_trace((*subcommand->cmd_func)(os, &opt_state, pool));
+}
+
+/* This implements `svn_opt_subcommand_t'. */
+static svn_error_t *
+subcommand_batch(apr_getopt_t *os, void *baton, apr_pool_t *pool)
+{
+  struct svnlook_opt_state *opt_state = baton;
+  batch_state_t *batch = apr_pcalloc(pool, sizeof(*batch));
+  apr_pool_t *iterpool;
+  svn_stream_t *in;
+  svn_boolean_t eof = FALSE;
+  svn_boolean_t failed = FALSE;
+
+  SVN_ERR(check_number_of_args(opt_state, 0));
+
+  SVN_ERR(svn_repos_open3(&batch->repos, opt_state->repos_path, NULL,
+                          pool, pool));
+  batch->fs = svn_repos_fs(batch->repos);
+  svn_fs_set_warning_func(batch->fs, warning_func, NULL);
+  batch->txns = apr_hash_make(pool);
+  batch->roots = apr_hash_make(pool);
+  batch->pool = pool;
+
+  SVN_ERR(svn_stream_for_stdin2(&in, TRUE, pool));
+
+  iterpool = svn_pool_create(pool);
+  while (! eof)
+    {
+      svn_stringbuf_t *line;
+      svn_error_t *err;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(check_cancel(NULL));
+
+      SVN_ERR(svn_stream_readline(in, &line, "\n", &eof, iterpool));
+      svn_stringbuf_strip_whitespace(line);
+      if (line->len == 0 || line->data[0] == '#')
+        continue;
+
+      err = run_batch_command(line->data, opt_state, batch, iterpool);
+      if (err && err->apr_err == SVN_ERR_CANCELLED)
+        return svn_error_trace(err);
+      if (err)
+        {
+          /* Report the error, but move on to the next command. */
+          svn_handle_error2(err, stderr, FALSE /* non-fatal */, "svnlook: ");
+          svn_error_clear(err);
+          failed = TRUE;
+        }
+
+      /* Let the caller see each command's output as soon as it is done. */
+      SVN_ERR(svn_cmdline_fflush(stdout));
+    }
+  svn_pool_destroy(iterpool);
+
+  if (failed)
+    return svn_error_create(SVN_ERR_ILLEGAL_TARGET, NULL,
+                            _("Not all commands of the batch succeeded"));
+
+  return SVN_NO_ERROR;
+}
+
 /* This implements `svn_opt_subcommand_t'. */
 static svn_error_t *
 subcommand_cat(apr_getopt_t *os, void *baton, apr_pool_t *pool)
@@ -2486,144 +2926,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       /* Stash the option code in an array before parsing it. */
       APR_ARRAY_PUSH(received_opts, int) = opt_id;
 
-      switch (opt_id)
-        {
-        case 'r':
-          {
-            char *digits_end = NULL;
-            opt_state.rev = strtol(opt_arg, &digits_end, 10);
-            if ((! SVN_IS_VALID_REVNUM(opt_state.rev))
-                || (! digits_end)
-                || *digits_end)
-              return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
-                                      _("Invalid revision number supplied"));
-          }
-          break;
-
-        case 't':
-          opt_state.txn = opt_arg;
-          break;
-
-        case 'M':
-          opt_state.memory_cache_size
-            = 0x100000 * apr_strtoi64(opt_arg, NULL, 0);
-          break;
-
-        case 'N':
-          opt_state.non_recursive = TRUE;
-          break;
-
-        case 'v':
-          opt_state.verbose = TRUE;
-          break;
-
-        case 'h':
-        case '?':
-          opt_state.help = TRUE;
-          break;
-
-        case 'q':
-          opt_state.quiet = TRUE;
-          break;
-
-        case svnlook__revprop_opt:
-          opt_state.revprop = TRUE;
-          break;
-
-        case svnlook__xml_opt:
-          opt_state.xml = TRUE;
-          break;
-
-        case svnlook__version:
-          opt_state.version = TRUE;
-          break;
-
-        case svnlook__show_ids:
-          opt_state.show_ids = TRUE;
-          break;
-
-        case 'l':
-          {
-            char *end;
-            opt_state.limit = strtol(opt_arg, &end, 10);
-            if (end == opt_arg || *end != '\0')
-              {
-                return svn_error_create(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
-                                        _("Non-numeric limit argument given"));
-              }
-            if (opt_state.limit <= 0)
-              {
-                return svn_error_create(SVN_ERR_INCORRECT_PARAMS, NULL,
-                                    _("Argument to --limit must be positive"));
-              }
-          }
-          break;
-
-        case svnlook__no_diff_deleted:
-          opt_state.no_diff_deleted = TRUE;
-          break;
-
-        case svnlook__no_diff_added:
-          opt_state.no_diff_added = TRUE;
-          break;
-
-        case svnlook__diff_copy_from:
-          opt_state.diff_copy_from = TRUE;
-          break;
-
-        case svnlook__full_paths:
-          opt_state.full_paths = TRUE;
-          break;
-
-        case svnlook__copy_info:
-          opt_state.copy_info = TRUE;
-          break;
-
-        case 'x':
-          opt_state.extensions = opt_arg;
-          break;
-
-        case svnlook__ignore_properties:
-          opt_state.ignore_properties = TRUE;
-          break;
-
-        case svnlook__properties_only:
-          opt_state.properties_only = TRUE;
-          break;
-
-        case svnlook__diff_cmd:
-          opt_state.diff_cmd = opt_arg;
-          break;
-
-        case svnlook__show_inherited_props:
-          opt_state.show_inherited_props = TRUE;
-          break;
-
-        case svnlook__no_newline:
-          opt_state.no_newline = TRUE;
-          break;
-
-        default:
-          SVN_ERR(subcommand_help(NULL, NULL, pool));
-          *exit_code = EXIT_FAILURE;
-          return SVN_NO_ERROR;
-
-        }
+      SVN_ERR(parse_option(&opt_state, opt_id, opt_arg));
     }
 
-  /* The --transaction and --revision options may not co-exist. */
-  if ((opt_state.rev != SVN_INVALID_REVNUM) && opt_state.txn)
-    return svn_error_create
-                (SVN_ERR_CL_MUTUALLY_EXCLUSIVE_ARGS, NULL,
-                 _("The '--transaction' (-t) and '--revision' (-r) arguments "
-                   "cannot co-exist"));
-
-  /* The --show-inherited-props and --revprop options may not co-exist. */
-  if (opt_state.show_inherited_props && opt_state.revprop)
-    return svn_error_create
-                (SVN_ERR_CL_MUTUALLY_EXCLUSIVE_ARGS, NULL,
-                 _("Cannot use the '--show-inherited-props' option with the "
-                   "'--revprop' option"));
+  SVN_ERR(check_option_conflicts(&opt_state));
 
   /* If the user asked for help, then the rest of the arguments are
      the names of subcommands to get help on (if any), or else they're
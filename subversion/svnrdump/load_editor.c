@@ -41,6 +41,15 @@
 
 #define SVNRDUMP_PROP_LOCK SVN_PROP_PREFIX "rdump-lock"
 
+/* Revision 0 properties of the target repository recording the load
+   progress, so that an interrupted load can be resumed.  Both hold a
+   dump stream revision and a target revision separated by a space:
+   the revision about to be committed and the last one that has been
+   committed completely, including its revision properties. */
+#define SVNRDUMP_PROP_CURRENTLY_LOADING \
+          SVN_PROP_PREFIX "rdump-currently-loading"
+#define SVNRDUMP_PROP_LAST_LOADED SVN_PROP_PREFIX "rdump-last-loaded"
+
 #define ARE_VALID_COPY_ARGS(p,r) ((p) && SVN_IS_VALID_REVNUM(r))
 
 
@@ -87,6 +96,21 @@ struct parse_baton
   /* An hash containing specific revision properties to skip while
      loading. */
   apr_hash_t *skip_revprops;
+
+  /* When resuming an interrupted load, the dump stream revision that
+     has been loaded last and the target revision it became.  Dump
+     stream revisions up to and including RESUME_REV are skipped.
+     SVN_INVALID_REVNUM if not resuming or once RESUME_REV has been
+     passed. */
+  svn_revnum_t resume_rev;
+  svn_revnum_t resume_target_rev;
+
+  /* Whether RESUME_REV has been committed but its revision properties
+     may not have been set. */
+  svn_boolean_t resume_revprops;
+
+  /* The svn_revnum_t dump stream revisions > 0 skipped so far. */
+  apr_array_header_t *skipped_revs;
 };
 
 /**
@@ -146,6 +170,9 @@ struct revision_baton
   apr_hash_t *revprop_table;
   apr_int32_t rev_offset;
 
+  /* Whether this revision has been loaded before and is only parsed. */
+  svn_boolean_t skip;
+
   const svn_string_t *datestamp;
   const svn_string_t *author;
 
@@ -182,21 +209,15 @@ get_revision_mapping(apr_hash_t *rev_map,
 }
 
 
-static svn_error_t *
-commit_callback(const svn_commit_info_t *commit_info,
-                void *baton,
-                apr_pool_t *pool)
+/* Record in PB that dump stream revision FROM_REV has been loaded as
+   TO_REV. */
+static void
+map_revision(struct parse_baton *pb,
+             svn_revnum_t from_rev,
+             svn_revnum_t to_rev)
 {
-  struct revision_baton *rb = baton;
-  struct parse_baton *pb = rb->pb;
-
-  /* ### Don't print directly; generate a notification. */
-  if (! pb->quiet)
-    SVN_ERR(svn_cmdline_printf(pool, "* Loaded revision %ld.\n",
-                               commit_info->revision));
-
   /* Add the mapping of the dumpstream revision to the committed revision. */
-  set_revision_mapping(pb->rev_map, rb->rev, commit_info->revision);
+  set_revision_mapping(pb->rev_map, from_rev, to_rev);
 
   /* If the incoming dump stream has non-contiguous revisions (e.g. from
      using svndumpfilter --drop-empty-revs without --renumber-revs) then
@@ -204,18 +225,78 @@ commit_callback(const svn_commit_info_t *commit_info,
      might not be able to map all mergeinfo source revisions to the correct
      revisions in the target repos. */
   if ((pb->last_rev_mapped != SVN_INVALID_REVNUM)
-      && (rb->rev != pb->last_rev_mapped + 1))
+      && (from_rev != pb->last_rev_mapped + 1))
     {
       svn_revnum_t i;
 
-      for (i = pb->last_rev_mapped + 1; i < rb->rev; i++)
+      for (i = pb->last_rev_mapped + 1; i < from_rev; i++)
         {
           set_revision_mapping(pb->rev_map, i, pb->last_rev_mapped);
         }
     }
 
   /* Update our "last revision mapped". */
-  pb->last_rev_mapped = rb->rev;
+  pb->last_rev_mapped = from_rev;
+}
+
+/* Set the revision 0 property NAME of the target repository in PB to
+   the pair of DUMP_REV and TARGET_REV.  Use POOL for allocations. */
+static svn_error_t *
+set_progress_prop(struct parse_baton *pb,
+                  const char *name,
+                  svn_revnum_t dump_rev,
+                  svn_revnum_t target_rev,
+                  apr_pool_t *pool)
+{
+  return svn_error_trace(
+           svn_ra_change_rev_prop2(pb->session, 0, name, NULL,
+                                   svn_string_createf(pool, "%ld %ld",
+                                                      dump_rev, target_rev),
+                                   pool));
+}
+
+/* Parse the revision 0 property NAME in REVPROPS as written by
+   set_progress_prop into *DUMP_REV and *TARGET_REV.  Set both to
+   SVN_INVALID_REVNUM if the property does not exist. */
+static svn_error_t *
+parse_progress_prop(svn_revnum_t *dump_rev,
+                    svn_revnum_t *target_rev,
+                    apr_hash_t *revprops,
+                    const char *name)
+{
+  const svn_string_t *value = svn_hash_gets(revprops, name);
+  const char *end;
+
+  *dump_rev = SVN_INVALID_REVNUM;
+  *target_rev = SVN_INVALID_REVNUM;
+  if (! value)
+    return SVN_NO_ERROR;
+
+  if (svn_revnum_parse(dump_rev, value->data, &end)
+      || *end != ' '
+      || svn_revnum_parse(target_rev, end + 1, &end)
+      || *end != '\0')
+    return svn_error_createf(SVN_ERR_BAD_PROPERTY_VALUE, NULL,
+                             _("Malformed value '%s' of revision property "
+                               "'%s' on r0"), value->data, name);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+commit_callback(const svn_commit_info_t *commit_info,
+                void *baton,
+                apr_pool_t *pool)
+{
+  struct revision_baton *rb = baton;
+  struct parse_baton *pb = rb->pb;
+
+  /* ### Don't print directly; generate a notification. */
+  if (! pb->quiet)
+    SVN_ERR(svn_cmdline_printf(pool, "* Loaded revision %ld.\n",
+                               commit_info->revision));
+
+  map_revision(pb, rb->rev, commit_info->revision);
 
   return SVN_NO_ERROR;
 }
@@ -404,6 +485,36 @@ new_revision_record(void **revision_baton,
   if (rev_str)
     rb->rev = SVN_STR_TO_REV(rev_str);
 
+  /* Stash the oldest (non-zero) dumpstream revision seen. */
+  if ((rb->rev > 0) && (!SVN_IS_VALID_REVNUM(pb->oldest_dumpstream_rev)))
+    pb->oldest_dumpstream_rev = rb->rev;
+
+  /* When resuming, skip everything up to the last revision loaded.  The
+     revisions we skip have been committed one after the other, so we
+     can tell their mapping once we get to the last one. */
+  if (SVN_IS_VALID_REVNUM(pb->resume_rev))
+    {
+      if (rb->rev <= pb->resume_rev)
+        {
+          rb->skip = TRUE;
+          rb->revprop_table = apr_hash_make(rb->pool);
+          if (rb->rev > 0)
+            APR_ARRAY_PUSH(pb->skipped_revs, svn_revnum_t) = rb->rev;
+
+          *revision_baton = rb;
+          return SVN_NO_ERROR;
+        }
+
+      if (pb->skipped_revs->nelts)
+        return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                                 _("Can't resume: the dump stream does not "
+                                   "contain revision %ld, which has been "
+                                   "loaded last"), pb->resume_rev);
+
+      /* Nothing of this stream has been loaded yet. */
+      pb->resume_rev = SVN_INVALID_REVNUM;
+    }
+
   SVN_ERR(svn_ra_get_latest_revnum(pb->session, &head_rev, pool));
 
   /* FIXME: This is a lame fallback loading multiple segments of dump in
@@ -412,9 +523,11 @@ new_revision_record(void **revision_baton,
      It might be positive or negative. */
   rb->rev_offset = (apr_int32_t) ((rb->rev) - (head_rev + 1));
 
-  /* Stash the oldest (non-zero) dumpstream revision seen. */
-  if ((rb->rev > 0) && (!SVN_IS_VALID_REVNUM(pb->oldest_dumpstream_rev)))
-    pb->oldest_dumpstream_rev = rb->rev;
+  /* Tell a resumed load what is about to happen in case we get
+     interrupted during the commit. */
+  if (rb->rev > 0)
+    SVN_ERR(set_progress_prop(pb, SVNRDUMP_PROP_CURRENTLY_LOADING,
+                              rb->rev, head_rev + 1, pool));
 
   /* Set the commit_editor/ commit_edit_baton to NULL and wait for
      them to be created in new_node_record */
@@ -500,6 +613,12 @@ new_node_record(void **node_baton,
 
   nb = apr_pcalloc(rb->pool, sizeof(*nb));
   nb->rb = rb;
+
+  if (rb->skip)
+    {
+      *node_baton = nb;
+      return SVN_NO_ERROR;
+    }
   nb->is_added = FALSE;
   nb->copyfrom_path = NULL;
   nb->copyfrom_url = NULL;
@@ -713,6 +832,12 @@ set_revision_property(void *baton,
 {
   struct revision_baton *rb = baton;
 
+  /* Skipped revisions only need their properties if the revision has
+     been committed without them. */
+  if (rb->skip
+      && ! (rb->rev == rb->pb->resume_rev && rb->pb->resume_revprops))
+    return SVN_NO_ERROR;
+
   SVN_ERR(svn_rdump__normalize_prop(name, &value, rb->pool));
 
   SVN_ERR(svn_repos__validate_prop(name, value, rb->pool));
@@ -755,6 +880,9 @@ set_node_property(void *baton,
   apr_pool_t *pool = nb->rb->pool;
   svn_prop_t *prop;
 
+  if (rb->skip)
+    return SVN_NO_ERROR;
+
   if (value && strcmp(name, SVN_PROP_MERGEINFO) == 0)
     {
       svn_string_t *new_value;
@@ -796,6 +924,9 @@ delete_node_property(void *baton,
   apr_pool_t *pool = nb->rb->pool;
   svn_prop_t *prop;
 
+  if (nb->rb->skip)
+    return SVN_NO_ERROR;
+
   SVN_ERR(svn_repos__validate_prop(name, NULL, pool));
 
   prop = apr_palloc(pool, sizeof (*prop));
@@ -825,6 +956,9 @@ remove_node_props(void *baton)
   const char *orig_path;
   svn_revnum_t orig_rev;
 
+  if (rb->skip)
+    return SVN_NO_ERROR;
+
   /* Find the path and revision that has the node's original properties */
   if (ARE_VALID_COPY_ARGS(nb->copyfrom_path, nb->copyfrom_rev))
     {
@@ -890,6 +1024,13 @@ set_fulltext(svn_stream_t **stream,
   void *handler_baton;
   apr_pool_t *pool = nb->rb->pool;
 
+  /* Without a stream, the parser just reads over the text. */
+  if (nb->rb->skip)
+    {
+      *stream = NULL;
+      return SVN_NO_ERROR;
+    }
+
   SVN_ERR(commit_editor->apply_textdelta(nb->file_baton, nb->base_checksum,
                                          pool, &handler, &handler_baton));
   *stream = svn_txdelta_target_push(handler, handler_baton,
@@ -906,6 +1047,12 @@ apply_textdelta(svn_txdelta_window_handler_t *handler,
   const struct svn_delta_editor_t *commit_editor = nb->rb->pb->commit_editor;
   apr_pool_t *pool = nb->rb->pool;
 
+  if (nb->rb->skip)
+    {
+      *handler = NULL;
+      return SVN_NO_ERROR;
+    }
+
   SVN_ERR(commit_editor->apply_textdelta(nb->file_baton, nb->base_checksum,
                                          pool, handler, handler_baton));
 
@@ -920,6 +1067,9 @@ close_node(void *baton)
   apr_pool_t *pool = nb->rb->pool;
   apr_hash_index_t *hi;
 
+  if (nb->rb->skip)
+    return SVN_NO_ERROR;
+
   for (hi = apr_hash_first(pool, nb->prop_changes);
        hi; hi = apr_hash_next(hi))
     {
@@ -953,6 +1103,46 @@ close_node(void *baton)
   return SVN_NO_ERROR;
 }
 
+/* Finish the skipped revision RB of a resumed load.  If it is the last
+   one loaded before, establish the revision mapping for all skipped
+   revisions and complete its revision properties if necessary. */
+static svn_error_t *
+close_skipped_revision(struct revision_baton *rb)
+{
+  struct parse_baton *pb = rb->pb;
+  apr_hash_index_t *hi;
+  int i;
+
+  /* ### Don't print directly; generate a notification. */
+  if (! pb->quiet)
+    SVN_ERR(svn_cmdline_printf(rb->pool,
+                               "* Skipped revision %ld (already loaded).\n",
+                               rb->rev));
+
+  if (rb->rev != pb->resume_rev)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < pb->skipped_revs->nelts; i++)
+    map_revision(pb, APR_ARRAY_IDX(pb->skipped_revs, i, svn_revnum_t),
+                 pb->resume_target_rev - (pb->skipped_revs->nelts - 1 - i));
+
+  if (pb->resume_revprops)
+    {
+      for (hi = apr_hash_first(rb->pool, rb->revprop_table);
+           hi; hi = apr_hash_next(hi))
+        SVN_ERR(svn_ra_change_rev_prop2(pb->session, pb->resume_target_rev,
+                                        apr_hash_this_key(hi), NULL,
+                                        apr_hash_this_val(hi), rb->pool));
+
+      SVN_ERR(set_progress_prop(pb, SVNRDUMP_PROP_LAST_LOADED, rb->rev,
+                                pb->resume_target_rev, rb->pool));
+    }
+
+  pb->resume_rev = SVN_INVALID_REVNUM;
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 close_revision(void *baton)
 {
@@ -961,6 +1151,13 @@ close_revision(void *baton)
   void *commit_edit_baton = rb->pb->commit_edit_baton;
   svn_revnum_t committed_rev = SVN_INVALID_REVNUM;
 
+  if (rb->skip)
+    {
+      SVN_ERR(close_skipped_revision(rb));
+      svn_pool_destroy(rb->pool);
+      return SVN_NO_ERROR;
+    }
+
   /* Fake revision 0 */
   if (rb->rev == 0)
     {
@@ -1033,17 +1230,66 @@ close_revision(void *baton)
         }
     }
 
+  /* This revision is complete now. */
+  if (rb->rev > 0 && SVN_IS_VALID_REVNUM(committed_rev))
+    SVN_ERR(set_progress_prop(rb->pb, SVNRDUMP_PROP_LAST_LOADED, rb->rev,
+                              committed_rev, rb->pool));
+
   svn_pool_destroy(rb->pool);
 
   return SVN_NO_ERROR;
 }
 
+/* Determine from the revision 0 properties of the target repository in
+   PB where the previous load into it stopped and prepare PB to continue
+   from there.  Use POOL for temporary allocations. */
+static svn_error_t *
+get_resume_point(struct parse_baton *pb,
+                 apr_pool_t *pool)
+{
+  apr_hash_t *revprops;
+  svn_revnum_t last_rev, last_target_rev;
+  svn_revnum_t current_rev, current_target_rev;
+  svn_revnum_t head_rev;
+
+  SVN_ERR(svn_ra_rev_proplist(pb->session, 0, &revprops, pool));
+  SVN_ERR(parse_progress_prop(&last_rev, &last_target_rev, revprops,
+                              SVNRDUMP_PROP_LAST_LOADED));
+  SVN_ERR(parse_progress_prop(&current_rev, &current_target_rev, revprops,
+                              SVNRDUMP_PROP_CURRENTLY_LOADING));
+  SVN_ERR(svn_ra_get_latest_revnum(pb->session, &head_rev, pool));
+
+  /* If we got interrupted after the last complete revision, the commit
+     of the next one may or may not have made it. */
+  if (SVN_IS_VALID_REVNUM(current_rev)
+      && (! SVN_IS_VALID_REVNUM(last_rev) || current_rev > last_rev)
+      && head_rev >= current_target_rev)
+    {
+      last_rev = current_rev;
+      last_target_rev = current_target_rev;
+      pb->resume_revprops = TRUE;
+    }
+
+  pb->resume_rev = last_rev;
+  pb->resume_target_rev = last_target_rev;
+
+  /* ### Don't print directly; generate a notification. */
+  if (SVN_IS_VALID_REVNUM(last_rev) && ! pb->quiet)
+    SVN_ERR(svn_cmdline_printf(pool,
+                               "* Resuming after revision %ld "
+                               "(loaded as revision %ld).\n",
+                               last_rev, last_target_rev));
+
+  return SVN_NO_ERROR;
+}
+
 svn_error_t *
 svn_rdump__load_dumpstream(svn_stream_t *stream,
                            svn_ra_session_t *session,
                            svn_ra_session_t *aux_session,
                            svn_boolean_t quiet,
                            apr_hash_t *skip_revprops,
+                           svn_boolean_t resume,
                            svn_cancel_func_t cancel_func,
                            void *cancel_baton,
                            apr_pool_t *pool)
@@ -1088,9 +1334,33 @@ svn_rdump__load_dumpstream(svn_stream_t *stream,
   parse_baton->last_rev_mapped = SVN_INVALID_REVNUM;
   parse_baton->oldest_dumpstream_rev = SVN_INVALID_REVNUM;
   parse_baton->skip_revprops = skip_revprops;
+  parse_baton->resume_rev = SVN_INVALID_REVNUM;
+  parse_baton->resume_target_rev = SVN_INVALID_REVNUM;
+  parse_baton->skipped_revs = apr_array_make(pool, 0, sizeof(svn_revnum_t));
+
+  err = SVN_NO_ERROR;
+  if (resume)
+    err = get_resume_point(parse_baton, pool);
+
+  if (! err)
+    err = svn_repos_parse_dumpstream3(stream, parser, parse_baton, FALSE,
+                                      cancel_func, cancel_baton, pool);
 
-  err = svn_repos_parse_dumpstream3(stream, parser, parse_baton, FALSE,
-                                    cancel_func, cancel_baton, pool);
+  if (! err && SVN_IS_VALID_REVNUM(parse_baton->resume_rev)
+      && parse_baton->skipped_revs->nelts)
+    err = svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                            _("Can't resume: the dump stream does not "
+                              "contain revision %ld, which has been "
+                              "loaded last"), parse_baton->resume_rev);
+
+  /* There is nothing to resume after a complete load. */
+  if (! err)
+    err = svn_ra_change_rev_prop2(session, 0,
+                                  SVNRDUMP_PROP_CURRENTLY_LOADING,
+                                  NULL, NULL, pool);
+  if (! err)
+    err = svn_ra_change_rev_prop2(session, 0, SVNRDUMP_PROP_LAST_LOADED,
+                                  NULL, NULL, pool);
 
   /* If all goes well, or if we're cancelled cleanly, don't leave a
      stray lock behind. */
@@ -23,6 +23,11 @@
  */
 
 #include <apr_uri.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#endif
 
 #include "svn_pools.h"
 #include "svn_cmdline.h"
@@ -35,6 +40,7 @@
 #include "svn_private_config.h"
 #include "svn_string.h"
 #include "svn_props.h"
+#include "svn_sorts.h"
 
 #include "svnrdump.h"
 
@@ -42,6 +48,15 @@
 #include "private/svn_cmdline_private.h"
 #include "private/svn_ra_private.h"
 
+/* Upper limit for --jobs. */
+#define MAX_JOBS 64
+
+/* Number of dump segments per job a parallel dump aims for, and the
+   upper limit for the number of revisions in a segment.  Smaller
+   segments balance the load better, larger ones save replay requests. */
+#define SEGMENTS_PER_JOB 4
+#define MAX_SEGMENT_REVISIONS 1000
+
 
 
 /*** Cancellation ***/
@@ -66,6 +81,8 @@ enum svn_svnrdump__longopt_t
     opt_incremental,
     opt_trust_server_cert,
     opt_trust_server_cert_failures,
+    opt_jobs,
+    opt_resume,
     opt_version
   };
 
@@ -85,12 +102,20 @@ static const svn_opt_subcommand_desc2_t svnrdump__cmd_table[] =
     N_("usage: svnrdump dump URL [-r LOWER[:UPPER]]\n\n"
        "Dump revisions LOWER to UPPER of repository at remote URL to stdout\n"
        "in a 'dumpfile' portable format.  If only LOWER is given, dump that\n"
-       "one revision.\n"),
-    { 'r', 'q', opt_incremental, SVN_SVNRDUMP__BASE_OPTIONS } },
+       "one revision.\n"
+       "\n"
+       "With --jobs, the revisions are fetched in parallel over the given\n"
+       "number of sessions in ranges that get written out in order.\n"),
+    { 'r', 'q', opt_incremental, opt_jobs, SVN_SVNRDUMP__BASE_OPTIONS } },
   { "load", load_cmd, { 0 },
     N_("usage: svnrdump load URL\n\n"
-       "Load a 'dumpfile' given on stdin to a repository at remote URL.\n"),
-    { 'q', opt_skip_revprop, SVN_SVNRDUMP__BASE_OPTIONS } },
+       "Load a 'dumpfile' given on stdin to a repository at remote URL.\n"
+       "\n"
+       "Until the load completes, its progress is recorded in revision\n"
+       "properties on revision 0 of the repository.  If a load gets\n"
+       "interrupted, run it again on the same 'dumpfile' with --resume to\n"
+       "skip the revisions that have been loaded already.\n"),
+    { 'q', opt_skip_revprop, opt_resume, SVN_SVNRDUMP__BASE_OPTIONS } },
   { "help", 0, { "?", "h" },
     N_("usage: svnrdump help [SUBCOMMAND...]\n\n"
        "Describe the usage of this program or its subcommands.\n"),
@@ -108,6 +133,10 @@ static const apr_getopt_option_t svnrdump__options[] =
                       N_("dump incrementally")},
     {"skip-revprop",  opt_skip_revprop, 1,
                       N_("skip revision property ARG (e.g., \"svn:author\")")},
+    {"jobs",          opt_jobs, 1,
+                      N_("use ARG parallel sessions")},
+    {"resume",        opt_resume, 0,
+                      N_("continue an interrupted load")},
     {"config-dir",    opt_config_dir, 1,
                       N_("read user configuration files from directory ARG")},
     {"username",      opt_auth_username, 1,
@@ -181,6 +210,8 @@ typedef struct opt_baton_t {
   svn_boolean_t quiet;
   svn_boolean_t incremental;
   apr_hash_t *skip_revprops;
+  int jobs;
+  svn_boolean_t resume;
 } opt_baton_t;
 
 /* Print dumpstream-formatted information about REVISION.
@@ -450,17 +481,319 @@ dump_initial_full_revision(svn_ra_session_t *session,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+
+/* A range of revisions dumped by one of the jobs of a parallel dump.
+ */
+typedef struct dump_segment_t
+{
+  svn_revnum_t start_revision;
+  svn_revnum_t end_revision;
+
+  /* Temporary file with the dump of the range, positioned at its start
+     once DONE is set. */
+  apr_file_t *file;
+
+  /* Set by the job that dumped the range, together with the error that
+     stopped it, if any. */
+  svn_boolean_t done;
+  svn_error_t *err;
+
+  /* Owns FILE.  NULL until the segment gets dumped. */
+  apr_pool_t *pool;
+} dump_segment_t;
+
+/* State shared between the jobs of a parallel dump and the main thread,
+ * which writes the dumped segments to stdout in order.
+ */
+typedef struct parallel_dump_baton_t
+{
+  /* All dump_segment_t * in ascending order.  Read-only. */
+  apr_array_header_t *segments;
+
+  /* Guards all following members and those of the SEGMENTS. */
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *cond;
+
+  /* Index of the next segment to dump and of the next one to write.
+     NEXT_TO_DUMP never gets ahead of NEXT_TO_WRITE by more than
+     MAX_AHEAD so that the temporary files stay bounded. */
+  int next_to_dump;
+  int next_to_write;
+  int max_ahead;
+
+  /* Set by the main thread to stop the jobs. */
+  svn_boolean_t shutdown;
+
+  /* Thread-safe pool containing all of the above. */
+  apr_pool_t *pool;
+} parallel_dump_baton_t;
+
+/* A job of a parallel dump with its sessions.
+ */
+typedef struct dump_job_t
+{
+  parallel_dump_baton_t *pdb;
+  svn_ra_session_t *session;
+  svn_ra_session_t *extra_ra_session;
+  apr_thread_t *thread;
+} dump_job_t;
+
+/* Dump the revisions of SEGMENT into its temporary file, using the
+ * sessions of JOB.  Use POOL for temporary allocations.
+ */
+static svn_error_t *
+dump_segment(dump_job_t *job,
+             dump_segment_t *segment,
+             apr_pool_t *pool)
+{
+  struct replay_baton replay_baton = { 0 };
+  apr_off_t offset = 0;
+
+  segment->pool = svn_pool_create(job->pdb->pool);
+  SVN_ERR(svn_io_open_unique_file3(&segment->file, NULL, NULL,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   segment->pool, pool));
+
+  /* Progress gets reported when the segment is written out. */
+  replay_baton.extra_ra_session = job->extra_ra_session;
+  replay_baton.stdout_stream = svn_stream_from_aprfile2(segment->file, TRUE,
+                                                        pool);
+  replay_baton.quiet = TRUE;
+
+  SVN_ERR(svn_ra_replay_range(job->session, segment->start_revision,
+                              segment->end_revision, 0, TRUE,
+                              replay_revstart, replay_revend,
+                              &replay_baton, pool));
+
+  return svn_error_trace(svn_io_file_seek(segment->file, APR_SET, &offset,
+                                          pool));
+}
+
+/* Implements apr_thread_start_t, dumping segments of the
+ * parallel_dump_baton_t of the dump_job_t in DATA until there are no
+ * more left or one of them fails.
+ */
+static void * APR_THREAD_FUNC
+dump_job_thread(apr_thread_t *thread, void *data)
+{
+  dump_job_t *job = data;
+  parallel_dump_baton_t *pdb = job->pdb;
+  apr_pool_t *iterpool = svn_pool_create(pdb->pool);
+  svn_error_t *err = SVN_NO_ERROR;
+
+  while (! err)
+    {
+      dump_segment_t *segment = NULL;
+
+      svn_pool_clear(iterpool);
+
+      apr_thread_mutex_lock(pdb->mutex);
+      while (! pdb->shutdown
+             && pdb->next_to_dump < pdb->segments->nelts
+             && pdb->next_to_dump >= pdb->next_to_write + pdb->max_ahead)
+        apr_thread_cond_wait(pdb->cond, pdb->mutex);
+
+      if (! pdb->shutdown && pdb->next_to_dump < pdb->segments->nelts)
+        segment = APR_ARRAY_IDX(pdb->segments, pdb->next_to_dump++,
+                                dump_segment_t *);
+      apr_thread_mutex_unlock(pdb->mutex);
+
+      if (segment == NULL)
+        break;
+
+      err = dump_segment(job, segment, iterpool);
+
+      apr_thread_mutex_lock(pdb->mutex);
+      segment->err = err;
+      segment->done = TRUE;
+      apr_thread_cond_broadcast(pdb->cond);
+      apr_thread_mutex_unlock(pdb->mutex);
+    }
+  svn_pool_destroy(iterpool);
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Write the dump of revisions START_REVISION thru END_REVISION of the
+ * repository at which SESSION is rooted to STDOUT_STREAM like
+ * svn_ra_replay_range with the replay_revstart and replay_revend
+ * callbacks does, but using JOBS threads, each with sessions of its own
+ * opened through CTX, that dump disjoint ranges of revisions into
+ * temporary files.  Those get copied to STDOUT_STREAM in order.  If
+ * QUIET is set, don't generate progress messages.  Use POOL for
+ * temporary allocations.
+ */
+static svn_error_t *
+replay_revisions_parallel(svn_ra_session_t *session,
+                          svn_client_ctx_t *ctx,
+                          svn_stream_t *stdout_stream,
+                          svn_revnum_t start_revision,
+                          svn_revnum_t end_revision,
+                          int jobs,
+                          svn_boolean_t quiet,
+                          apr_pool_t *pool)
+{
+  parallel_dump_baton_t *pdb;
+  dump_job_t *job_list;
+  const char *url;
+  const char *repos_root;
+  svn_revnum_t revision;
+  svn_revnum_t segment_size;
+  svn_revnum_t latest;
+  apr_status_t status;
+  svn_error_t *err = SVN_NO_ERROR;
+  apr_pool_t *iterpool;
+  int started = 0;
+  int i;
+
+  SVN_ERR(svn_ra_get_session_url(session, &url, pool));
+  SVN_ERR(svn_ra_get_repos_root2(session, &repos_root, pool));
+
+  /* All threads allocate and release segment memory. */
+  pdb = apr_pcalloc(pool, sizeof(*pdb));
+  pdb->pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+
+  segment_size = (end_revision - start_revision + 1
+                  + jobs * SEGMENTS_PER_JOB - 1) / (jobs * SEGMENTS_PER_JOB);
+  segment_size = MIN(segment_size, MAX_SEGMENT_REVISIONS);
+  pdb->segments = apr_array_make(pool, jobs * SEGMENTS_PER_JOB,
+                                 sizeof(dump_segment_t *));
+  for (revision = start_revision;
+       revision <= end_revision;
+       revision += segment_size)
+    {
+      dump_segment_t *segment = apr_pcalloc(pool, sizeof(*segment));
+
+      segment->start_revision = revision;
+      segment->end_revision = MIN(revision + segment_size - 1,
+                                  end_revision);
+      APR_ARRAY_PUSH(pdb->segments, dump_segment_t *) = segment;
+    }
+
+  jobs = MIN(jobs, pdb->segments->nelts);
+  pdb->max_ahead = 2 * jobs;
+
+  /* Each job needs sessions of its own that do not share our allocator.
+     The auth baton is not thread-safe, so make sure the sessions have
+     authenticated before the threads start. */
+  job_list = apr_pcalloc(pool, jobs * sizeof(*job_list));
+  for (i = 0; i < jobs && ! err; i++)
+    {
+      dump_job_t *job = &job_list[i];
+
+      job->pdb = pdb;
+      err = svn_client_open_ra_session2(&job->session, url, NULL, ctx,
+                                        pdb->pool, pool);
+      if (! err)
+        err = svn_ra_get_latest_revnum(job->session, &latest, pool);
+      if (! err)
+        err = svn_client_open_ra_session2(&job->extra_ra_session, url, NULL,
+                                          ctx, pdb->pool, pool);
+      if (! err)
+        err = svn_ra_reparent(job->extra_ra_session, repos_root, pool);
+    }
+
+  if (! err)
+    {
+      status = apr_thread_mutex_create(&pdb->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                       pdb->pool);
+      if (! status)
+        status = apr_thread_cond_create(&pdb->cond, pdb->pool);
+      while (started < jobs && ! status)
+        {
+          status = apr_thread_create(&job_list[started].thread, NULL,
+                                     dump_job_thread, &job_list[started],
+                                     pdb->pool);
+          if (! status)
+            started++;
+        }
+      if (status)
+        err = svn_error_wrap_apr(status, _("Can't start dump job"));
+    }
+
+  /* Write the segments in order as they become available. */
+  iterpool = svn_pool_create(pool);
+  for (i = 0; i < pdb->segments->nelts && ! err; i++)
+    {
+      dump_segment_t *segment = APR_ARRAY_IDX(pdb->segments, i,
+                                              dump_segment_t *);
+
+      svn_pool_clear(iterpool);
+
+      apr_thread_mutex_lock(pdb->mutex);
+      while (! segment->done)
+        apr_thread_cond_wait(pdb->cond, pdb->mutex);
+      err = segment->err;
+      apr_thread_mutex_unlock(pdb->mutex);
+
+      if (! err)
+        err = svn_stream_copy3(svn_stream_from_aprfile2(segment->file, TRUE,
+                                                        iterpool),
+                               svn_stream_disown(stdout_stream, iterpool),
+                               check_cancel, NULL, iterpool);
+
+      for (revision = segment->start_revision;
+           revision <= segment->end_revision && ! err && ! quiet;
+           revision++)
+        err = svn_cmdline_fprintf(stderr, iterpool,
+                                  "* Dumped revision %lu.\n", revision);
+
+      svn_pool_destroy(segment->pool);
+      segment->pool = NULL;
+
+      apr_thread_mutex_lock(pdb->mutex);
+      pdb->next_to_write = i + 1;
+      apr_thread_cond_broadcast(pdb->cond);
+      apr_thread_mutex_unlock(pdb->mutex);
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Stop the jobs that are still running. */
+  if (started)
+    {
+      apr_thread_mutex_lock(pdb->mutex);
+      pdb->shutdown = TRUE;
+      apr_thread_cond_broadcast(pdb->cond);
+      apr_thread_mutex_unlock(pdb->mutex);
+
+      for (i = 0; i < started; i++)
+        apr_thread_join(&status, job_list[i].thread);
+    }
+
+  /* Errors of segments that never got written are likely the result of
+     us stopping the jobs. */
+  for (i = 0; i < pdb->segments->nelts; i++)
+    {
+      dump_segment_t *segment = APR_ARRAY_IDX(pdb->segments, i,
+                                              dump_segment_t *);
+      if (segment->err != err)
+        svn_error_clear(segment->err);
+    }
+
+  /* Release the sessions and any segments that have not been written. */
+  svn_pool_destroy(pdb->pool);
+
+  return svn_error_trace(err);
+}
+
+#endif
+
 /* Replay revisions START_REVISION thru END_REVISION (inclusive) of
  * the repository URL at which SESSION is rooted, using callbacks
  * which generate Subversion repository dumpstreams describing the
  * changes made in those revisions.  If QUIET is set, don't generate
- * progress messages.
+ * progress messages.  If JOBS is larger than 1, use that many parallel
+ * sessions, opened through CTX, for the replay.
  */
 static svn_error_t *
 replay_revisions(svn_ra_session_t *session,
                  svn_ra_session_t *extra_ra_session,
+                 svn_client_ctx_t *ctx,
                  svn_revnum_t start_revision,
                  svn_revnum_t end_revision,
+                 int jobs,
                  svn_boolean_t quiet,
                  svn_boolean_t incremental,
                  apr_pool_t *pool)
@@ -512,6 +845,15 @@ replay_revisions(svn_ra_session_t *session,
     }
 
   /* If there are still revisions left to be dumped, do so. */
+#if APR_HAS_THREADS
+  if (jobs > 1 && start_revision < end_revision)
+    {
+      SVN_ERR(replay_revisions_parallel(session, ctx, stdout_stream,
+                                        start_revision, end_revision,
+                                        jobs, quiet, pool));
+    }
+  else
+#endif
   if (start_revision <= end_revision)
     {
 #ifndef USE_EV2_IMPL
@@ -533,7 +875,7 @@ replay_revisions(svn_ra_session_t *session,
  * of transmitting that information to the repository located at URL
  * (to which SESSION has been opened).  AUX_SESSION is a second RA
  * session opened to the same URL for performing auxiliary out-of-band
- * operations.
+ * operations.  If RESUME is set, continue an interrupted earlier load.
  */
 static svn_error_t *
 load_revisions(svn_ra_session_t *session,
@@ -541,6 +883,7 @@ load_revisions(svn_ra_session_t *session,
                const char *url,
                svn_boolean_t quiet,
                apr_hash_t *skip_revprops,
+               svn_boolean_t resume,
                apr_pool_t *pool)
 {
   svn_stream_t *stdin_stream;
@@ -548,7 +891,7 @@ load_revisions(svn_ra_session_t *session,
   SVN_ERR(svn_stream_for_stdin2(&stdin_stream, TRUE, pool));
 
   SVN_ERR(svn_rdump__load_dumpstream(stdin_stream, session, aux_session,
-                                     quiet, skip_revprops,
+                                     quiet, skip_revprops, resume,
                                      check_cancel, NULL, pool));
 
   return SVN_NO_ERROR;
@@ -614,9 +957,11 @@ dump_cmd(apr_getopt_t *os,
   SVN_ERR(svn_ra_reparent(extra_ra_session, repos_root, pool));
 
   return replay_revisions(opt_baton->session, extra_ra_session,
+                          opt_baton->ctx,
                           opt_baton->start_revision.value.number,
                           opt_baton->end_revision.value.number,
-                          opt_baton->quiet, opt_baton->incremental, pool);
+                          opt_baton->jobs, opt_baton->quiet,
+                          opt_baton->incremental, pool);
 }
 
 /* Handle the "load" subcommand.  Implements `svn_opt_subcommand_t'.  */
@@ -631,7 +976,8 @@ load_cmd(apr_getopt_t *os,
   SVN_ERR(svn_client_open_ra_session2(&aux_session, opt_baton->url, NULL,
                                       opt_baton->ctx, pool, pool));
   return load_revisions(opt_baton->session, aux_session, opt_baton->url,
-                        opt_baton->quiet, opt_baton->skip_revprops, pool);
+                        opt_baton->quiet, opt_baton->skip_revprops,
+                        opt_baton->resume, pool);
 }
 
 /* Handle the "help" subcommand.  Implements `svn_opt_subcommand_t'.  */
@@ -779,6 +1125,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   opt_baton->end_revision.kind = svn_opt_revision_unspecified;
   opt_baton->url = NULL;
   opt_baton->skip_revprops = apr_hash_make(pool);
+  opt_baton->jobs = 1;
 
   SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
 
@@ -867,6 +1214,16 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           SVN_ERR(svn_utf_cstring_to_utf8(&opt_arg, opt_arg, pool));
           svn_hash_sets(opt_baton->skip_revprops, opt_arg, opt_arg);
           break;
+        case opt_jobs:
+          SVN_ERR(svn_cstring_atoi(&opt_baton->jobs, opt_arg));
+          if (opt_baton->jobs < 1 || opt_baton->jobs > MAX_JOBS)
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("--jobs must be between 1 and %d"),
+                                     MAX_JOBS);
+          break;
+        case opt_resume:
+          opt_baton->resume = TRUE;
+          break;
         case opt_trust_server_cert: /* backward compat */
           trust_unknown_ca = TRUE;
           break;
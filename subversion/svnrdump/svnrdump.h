@@ -83,6 +83,12 @@ svn_rdump__get_dump_editor_v2(svn_editor_t **editor,
  * for all memory allocations.  Use @a cancel_func and @a cancel_baton
  * to check for user cancellation of the operation (for
  * timely-but-safe termination).
+ *
+ * The progress of the load is recorded in revision 0 properties of the
+ * target repository until the load completes.  If @a resume is set, skip
+ * the revisions of @a stream that an earlier, interrupted load of the
+ * same stream has committed already and continue with the first one it
+ * didn't.
  */
 svn_error_t *
 svn_rdump__load_dumpstream(svn_stream_t *stream,
@@ -90,6 +96,7 @@ svn_rdump__load_dumpstream(svn_stream_t *stream,
                            svn_ra_session_t *aux_session,
                            svn_boolean_t quiet,
                            apr_hash_t *skip_revprops,
+                           svn_boolean_t resume,
                            svn_cancel_func_t cancel_func,
                            void *cancel_baton,
                            apr_pool_t *pool);
@@ -0,0 +1,299 @@
+/*
+ * repos_pool.c : Implementation of the svnserve repository handle pool
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+
+
+#include <string.h>
+
+#include <apr_time.h>
+
+#include "svn_error.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_pools.h"
+
+#include "private/svn_mutex.h"
+#include "private/svn_sorts_private.h"
+
+#include "svn_private_config.h"
+#include "repos_pool.h"
+
+/* Keep at most this many idle handles per repository.  More than that
+ * are only needed during bursts of concurrent connections and would
+ * otherwise linger.
+ */
+#define MAX_IDLE_HANDLES 16
+
+/* Idle handles that have not been used for this long will be closed.
+ * This limits the time a repository that got replaced on disk
+ * (e.g. by a hotcopy) may still be served from stale handles.
+ */
+#define IDLE_HANDLE_TTL apr_time_from_sec(30)
+
+/* Key used to attach the pooled_repos_t to its connection pool. */
+#define HANDLE_KEY "svnserve-repos-pool-handle"
+
+struct repos_pool_t
+{
+  /* Maps repository root paths to arrays of pooled_repos_t *.  Handles
+   * are ordered by the time they were returned, oldest first. */
+  apr_hash_t *idle;
+
+  /* mutex used to serialize access to this structure */
+  svn_mutex__t *mutex;
+
+  /* pool for IDLE and its keys */
+  apr_pool_t *pool;
+};
+
+/* A repository object plus the information required to recycle it.
+ */
+typedef struct pooled_repos_t
+{
+  /* The repository object itself. */
+  svn_repos_t *repos;
+
+  /* Root path of REPOS, also the key in the owner's IDLE hash. */
+  const char *repos_root;
+
+  /* Hooks environment path as last given to svn_repos_hooks_setenv().
+   * Only valid if HOOKS_ENV_SET is TRUE. */
+  const char *hooks_env;
+  svn_boolean_t hooks_env_set;
+
+  /* When this handle has been returned to the pool the last time. */
+  apr_time_t returned;
+
+  /* The pool that this handle belongs to. */
+  repos_pool_t *owner;
+
+  /* Root pool containing REPOS and this structure. */
+  apr_pool_t *pool;
+} pooled_repos_t;
+
+/* No-op FS warning function to be used while a handle is idle.  The
+ * previous warning baton belongs to the last connection.
+ */
+static void
+ignore_fs_warning(void *baton,
+                  svn_error_t *err)
+{
+}
+
+svn_error_t *
+repos_pool__create(repos_pool_t **repos_pool,
+                   svn_boolean_t thread_safe,
+                   apr_pool_t *pool)
+{
+  repos_pool_t *result = apr_pcalloc(pool, sizeof(*result));
+  result->pool = svn_pool_create(pool);
+  result->idle = apr_hash_make(result->pool);
+  SVN_ERR(svn_mutex__init(&result->mutex, thread_safe, pool));
+
+  *repos_pool = result;
+
+  return SVN_NO_ERROR;
+}
+
+/* Take the most recently returned handle for REPOS_ROOT from REPOS_POOL
+ * and return it in *HANDLE.  Set it to NULL, if there is none.  Remove
+ * all handles for REPOS_ROOT that have been idle for too long from the
+ * pool and append them to EXPIRED.
+ *
+ * The caller must hold REPOS_POOL's mutex.
+ */
+static svn_error_t *
+take_idle_handle(pooled_repos_t **handle,
+                 apr_array_header_t *expired,
+                 repos_pool_t *repos_pool,
+                 const char *repos_root)
+{
+  apr_array_header_t *idle = svn_hash_gets(repos_pool->idle, repos_root);
+  apr_time_t now = apr_time_now();
+  int i;
+
+  *handle = NULL;
+  if (idle == NULL)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < idle->nelts; ++i)
+    {
+      pooled_repos_t *candidate = APR_ARRAY_IDX(idle, i, pooled_repos_t *);
+      if (now - candidate->returned < IDLE_HANDLE_TTL)
+        break;
+
+      APR_ARRAY_PUSH(expired, pooled_repos_t *) = candidate;
+    }
+
+  svn_sort__array_delete(idle, 0, i);
+  if (idle->nelts)
+    *handle = *(pooled_repos_t **)apr_array_pop(idle);
+
+  return SVN_NO_ERROR;
+}
+
+/* Add HANDLE to the idle handles of its owner, if there is room.  Set
+ * *ADDED accordingly.
+ *
+ * The caller must hold the owner's mutex.
+ */
+static svn_error_t *
+add_idle_handle(svn_boolean_t *added,
+                pooled_repos_t *handle)
+{
+  repos_pool_t *repos_pool = handle->owner;
+  apr_array_header_t *idle = svn_hash_gets(repos_pool->idle,
+                                           handle->repos_root);
+  if (idle == NULL)
+    {
+      idle = apr_array_make(repos_pool->pool, 4, sizeof(handle));
+      svn_hash_sets(repos_pool->idle,
+                    apr_pstrdup(repos_pool->pool, handle->repos_root),
+                    idle);
+    }
+
+  *added = idle->nelts < MAX_IDLE_HANDLES;
+  if (*added)
+    APR_ARRAY_PUSH(idle, pooled_repos_t *) = handle;
+
+  return SVN_NO_ERROR;
+}
+
+/* Reset HANDLE and add it to the idle handles of its owner, if there is
+ * room.  Set *ADDED accordingly.
+ */
+static svn_error_t *
+recycle_handle(svn_boolean_t *added,
+               pooled_repos_t *handle)
+{
+  svn_fs_t *fs = svn_repos_fs(handle->repos);
+
+  /* Forget everything that refers to the connection. */
+  svn_fs_set_warning_func(fs, ignore_fs_warning, NULL);
+  SVN_ERR(svn_fs_set_access(fs, NULL));
+  SVN_ERR(svn_repos_remember_client_capabilities(handle->repos, NULL));
+  handle->returned = apr_time_now();
+
+  SVN_MUTEX__WITH_LOCK(handle->owner->mutex,
+                       add_idle_handle(added, handle));
+
+  return SVN_NO_ERROR;
+}
+
+/* Pool cleanup function returning the pooled_repos_t given as BATON
+ * to its owner.
+ */
+static apr_status_t
+return_handle(void *baton)
+{
+  pooled_repos_t *handle = baton;
+  svn_boolean_t added = FALSE;
+
+  /* Don't recycle handles in an unknown state. */
+  svn_error_clear(recycle_handle(&added, handle));
+  if (!added)
+    svn_pool_destroy(handle->pool);
+
+  return APR_SUCCESS;
+}
+
+svn_error_t *
+repos_pool__borrow(svn_repos_t **repos,
+                   repos_pool_t *repos_pool,
+                   const char *repos_root,
+                   apr_hash_t *fs_config,
+                   apr_pool_t *connection_pool,
+                   apr_pool_t *scratch_pool)
+{
+  pooled_repos_t *handle;
+  apr_array_header_t *expired
+    = apr_array_make(scratch_pool, 0, sizeof(handle));
+  int i;
+
+  SVN_MUTEX__WITH_LOCK(repos_pool->mutex,
+                       take_idle_handle(&handle, expired, repos_pool,
+                                        repos_root));
+
+  /* Close expired handles outside the lock. */
+  for (i = 0; i < expired->nelts; ++i)
+    svn_pool_destroy(APR_ARRAY_IDX(expired, i, pooled_repos_t *)->pool);
+
+  if (handle == NULL)
+    {
+      apr_pool_t *pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      svn_error_t *err;
+
+      handle = apr_pcalloc(pool, sizeof(*handle));
+      handle->repos_root = apr_pstrdup(pool, repos_root);
+      handle->owner = repos_pool;
+      handle->pool = pool;
+
+      err = svn_repos_open3(&handle->repos, repos_root, fs_config, pool,
+                            scratch_pool);
+      if (err)
+        {
+          svn_pool_destroy(pool);
+          return svn_error_trace(err);
+        }
+    }
+
+  apr_pool_userdata_setn(handle, HANDLE_KEY, NULL, connection_pool);
+  apr_pool_cleanup_register(connection_pool, handle, return_handle,
+                            apr_pool_cleanup_null);
+
+  *repos = handle->repos;
+
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+repos_pool__hooks_setenv(svn_repos_t *repos,
+                         const char *hooks_env,
+                         apr_pool_t *connection_pool,
+                         apr_pool_t *scratch_pool)
+{
+  void *data;
+  pooled_repos_t *handle;
+
+  apr_pool_userdata_get(&data, HANDLE_KEY, connection_pool);
+  handle = data;
+
+  /* Not a pooled repository?  Nothing to economize on. */
+  if (handle == NULL || handle->repos != repos)
+    return svn_error_trace(svn_repos_hooks_setenv(repos, hooks_env,
+                                                  scratch_pool));
+
+  if (handle->hooks_env_set
+      && (hooks_env == handle->hooks_env
+          || (hooks_env && handle->hooks_env
+              && strcmp(hooks_env, handle->hooks_env) == 0)))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(svn_repos_hooks_setenv(repos, hooks_env, scratch_pool));
+  handle->hooks_env = hooks_env ? apr_pstrdup(handle->pool, hooks_env)
+                                : NULL;
+  handle->hooks_env_set = TRUE;
+
+  return SVN_NO_ERROR;
+}
@@ -0,0 +1,95 @@
+/*
+ * repos_pool.h : Public definitions for the svnserve repository handle pool
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#ifndef REPOS_POOL_H
+#define REPOS_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+#include "svn_repos.h"
+
+
+
+/* Opaque collection of opened repositories that are currently not in use
+ * by any connection.  Access to it will be serialized among threads within
+ * the same process.
+ *
+ * Opening a repository reads its format files, instantiates the FS and its
+ * caches etc.  Short-lived connections spend a good part of their time on
+ * that.  Handing a repository that was used by an earlier connection to
+ * the next one eliminates most of that overhead.
+ *
+ * Every repository handle is used by at most one connection at a time.
+ */
+typedef struct repos_pool_t repos_pool_t;
+
+/* Create a new, empty repository pool in POOL and return it in
+ * *REPOS_POOL.  If THREAD_SAFE is not set, the pool may only be used
+ * from a single thread.
+ */
+svn_error_t *
+repos_pool__create(repos_pool_t **repos_pool,
+                   svn_boolean_t thread_safe,
+                   apr_pool_t *pool);
+
+/* Set *REPOS to an opened repository object for the repository at
+ * REPOS_ROOT, opened with FS_CONFIG.  Take it from REPOS_POOL, if an
+ * idle one is available, or open a new one.  The repository will be
+ * handed back to REPOS_POOL when CONNECTION_POOL gets cleared or
+ * destroyed.  There can be at most one repository borrowed per
+ * CONNECTION_POOL.
+ *
+ * The caller must not store connection-specific data in *REPOS that
+ * may outlive CONNECTION_POOL, except for the FS access context, warning
+ * function and client capabilities, which will be reset upon return.
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+repos_pool__borrow(svn_repos_t **repos,
+                   repos_pool_t *repos_pool,
+                   const char *repos_root,
+                   apr_hash_t *fs_config,
+                   apr_pool_t *connection_pool,
+                   apr_pool_t *scratch_pool);
+
+/* Like svn_repos_hooks_setenv() for REPOS and HOOKS_ENV but don't allocate
+ * anything if REPOS, borrowed for CONNECTION_POOL, has been configured the
+ * same way before.  Pooled repositories are long-lived and should not
+ * accumulate memory with every connection.
+ *
+ * Use SCRATCH_POOL for temporary allocations.
+ */
+svn_error_t *
+repos_pool__hooks_setenv(svn_repos_t *repos,
+                         const char *hooks_env,
+                         apr_pool_t *connection_pool,
+                         apr_pool_t *scratch_pool);
+
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+
+#endif /* REPOS_POOL_H */
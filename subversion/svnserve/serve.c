@@ -48,13 +48,17 @@
 #include "svn_time.h"
 #include "svn_config.h"
 #include "svn_props.h"
+#include "svn_sorts.h"
 #include "svn_mergeinfo.h"
 #include "svn_user.h"
 
+#include "private/svn_fs_private.h"
 #include "private/svn_log.h"
 #include "private/svn_mergeinfo_private.h"
 #include "private/svn_ra_svn_private.h"
+#include "private/svn_subr_private.h"
 #include "private/svn_fspath.h"
+#include "private/svn_repos_private.h"
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>   /* For getpid() */
@@ -62,6 +66,7 @@
 
 #include "server.h"
 #include "logger.h"
+#include "repos_pool.h"
 
 typedef struct commit_callback_baton_t {
   apr_pool_t *pool;
@@ -419,12 +424,13 @@ static void convert_case(char *text, svn_boolean_t to_uppercase)
 /* Set *ALLOWED to TRUE if PATH is accessible in the REQUIRED mode to
    the user described in BATON according to the authz rules in BATON.
    Use POOL for temporary allocations only.  If no authz rules are
-   present in BATON, grant access by default. */
-static svn_error_t *authz_check_access(svn_boolean_t *allowed,
-                                       const char *path,
-                                       svn_repos_authz_access_t required,
-                                       server_baton_t *b,
-                                       apr_pool_t *pool)
+   present in BATON, grant access by default.  Unlike
+   authz_check_access(), don't log denied access. */
+static svn_error_t *authz_lookup(svn_boolean_t *allowed,
+                                 const char *path,
+                                 svn_repos_authz_access_t required,
+                                 server_baton_t *b,
+                                 apr_pool_t *pool)
 {
   repository_t *repository = b->repository;
   client_info_t *client_info = b->client_info;
@@ -462,10 +468,24 @@ static svn_error_t *authz_check_access(svn_boolean_t *allowed,
       client_info->authz_user = authz_user;
     }
 
-  SVN_ERR(svn_repos_authz_check_access(repository->authzdb,
-                                       repository->authz_repos_name,
-                                       path, client_info->authz_user,
-                                       required, allowed, pool));
+  return svn_error_trace(
+           svn_repos_authz_check_access(repository->authzdb,
+                                        repository->authz_repos_name,
+                                        path, client_info->authz_user,
+                                        required, allowed, pool));
+}
+
+/* Set *ALLOWED to TRUE if PATH is accessible in the REQUIRED mode to
+   the user described in BATON according to the authz rules in BATON.
+   Use POOL for temporary allocations only.  If no authz rules are
+   present in BATON, grant access by default. */
+static svn_error_t *authz_check_access(svn_boolean_t *allowed,
+                                       const char *path,
+                                       svn_repos_authz_access_t required,
+                                       server_baton_t *b,
+                                       apr_pool_t *pool)
+{
+  SVN_ERR(authz_lookup(allowed, path, required, b, pool));
   if (!*allowed)
     SVN_ERR(log_authz_denied(path, required, b, pool));
 
@@ -488,6 +508,24 @@ static svn_error_t *authz_check_access_cb(svn_boolean_t *allowed,
                             sb->server, pool);
 }
 
+/* Set *ALLOWED to TRUE if PATH is accessible in the REQUIRED mode to the
+ * user described in BATON.  Denied access is not logged because the
+ * reporter merely probes for sub-trees that are readable as a whole.
+ * Use POOL for temporary allocations only.  ROOT is not used.
+ * Implements the svn_repos_authz_callback_t interface.
+ */
+static svn_error_t *authz_subtree_cb(svn_repos_authz_access_t required,
+                                     svn_boolean_t *allowed,
+                                     svn_fs_root_t *root,
+                                     const char *path,
+                                     void *baton,
+                                     apr_pool_t *pool)
+{
+  authz_baton_t *sb = baton;
+
+  return authz_lookup(allowed, path, required, sb->server, pool);
+}
+
 /* If authz is enabled in the specified BATON, return a read authorization
    function. Otherwise, return NULL. */
 static svn_repos_authz_func_t authz_check_access_cb_func(server_baton_t *baton)
@@ -988,6 +1026,8 @@ static svn_error_t *accept_report(svn_boolean_t *only_empty_entry,
                                       authz_check_access_cb_func(b),
                                       &ab, svn_ra_svn_zero_copy_limit(conn),
                                       pool));
+  if (b->repository->authzdb)
+    svn_repos__report_set_subtree_authz(report_baton, authz_subtree_cb, &ab);
 
   rb.sb = b;
   rb.repos_url = svn_path_uri_decode(b->repository->repos_url, pool);
@@ -1144,6 +1184,47 @@ get_latest_rev(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Pool cleanup function detaching the trace of the connection from DATA,
+ * an svn_repos_t. */
+static apr_status_t
+clear_repos_trace(void *data)
+{
+  svn_repos__set_trace(data, NULL);
+  return APR_SUCCESS;
+}
+
+/* Record the work done for the client from now on under the request ID
+ * it sends, so that it can be matched up with the client's own trace. */
+static svn_error_t *
+request_id(svn_ra_svn_conn_t *conn,
+           apr_pool_t *pool,
+           svn_ra_svn__list_t *params,
+           void *baton)
+{
+  server_baton_t *b = baton;
+  const char *id;
+
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "c", &id));
+  if (!svn_trace__valid_request_id(id))
+    return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                            "Invalid request ID");
+
+  SVN_ERR(log_command(b, conn, pool, "request-id %s", id));
+  SVN_ERR(trivial_auth_request(conn, pool, b));
+
+  /* The repository object may get reused by later connections while the
+   * trace goes away with this one. */
+  if (!b->trace)
+    apr_pool_pre_cleanup_register(b->pool, b->repository->repos,
+                                  clear_repos_trace);
+
+  b->trace = svn_trace__create(b->trace_file, id, b->pool);
+  svn_repos__set_trace(b->repository->repos, b->trace);
+
+  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 get_dated_rev(svn_ra_svn_conn_t *conn,
               apr_pool_t *pool,
@@ -1551,6 +1632,14 @@ commit(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Files at least this large will be sent straight from the repository's
+ * files on disk, if their contents are stored verbatim. */
+#define FILE_REGION_THRESHOLD 0x10000
+
+/* Send file regions in strings of at most that size, so the client does
+ * not have to hold the whole file in memory. */
+#define FILE_REGION_CHUNK_SIZE 0x100000
+
 static svn_error_t *
 get_file(svn_ra_svn_conn_t *conn,
          apr_pool_t *pool,
@@ -1573,6 +1662,9 @@ get_file(svn_ra_svn_conn_t *conn,
   svn_error_t *err, *write_err;
   int i;
   authz_baton_t ab;
+  apr_file_t *region_file = NULL;
+  apr_array_header_t *regions;
+  svn_filesize_t length;
 
   ab.server = b;
   ab.conn = conn;
@@ -1614,7 +1706,17 @@ get_file(svn_ra_svn_conn_t *conn,
                           &ab, root, full_path,
                           pool));
   if (want_contents)
-    SVN_CMD_ERR(svn_fs_file_contents(&contents, root, full_path, pool));
+    {
+      /* Large files stored verbatim don't need to be read through our
+         own buffers. */
+      SVN_CMD_ERR(svn_fs_file_length(&length, root, full_path, pool));
+      if (length >= FILE_REGION_THRESHOLD)
+        SVN_CMD_ERR(svn_fs__try_get_contents_regions(&region_file, &regions,
+                                                     root, full_path,
+                                                     pool, pool));
+      if (!region_file)
+        SVN_CMD_ERR(svn_fs_file_contents(&contents, root, full_path, pool));
+    }
 
   /* Send successful command response with revision and props. */
   SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "w((?c)r(!", "success",
@@ -1644,7 +1746,36 @@ get_file(svn_ra_svn_conn_t *conn,
   SVN_ERR(svn_ra_svn__write_tuple(conn, pool, "!))"));
 
   /* Now send the file's contents. */
-  if (want_contents)
+  if (want_contents && region_file)
+    {
+      apr_pool_t *iterpool = svn_pool_create(pool);
+
+      for (i = 0; i < regions->nelts; ++i)
+        {
+          svn_fs__file_region_t *region
+            = &APR_ARRAY_IDX(regions, i, svn_fs__file_region_t);
+          apr_off_t offset = region->offset;
+          svn_filesize_t remaining = region->length;
+
+          while (remaining > 0)
+            {
+              apr_size_t chunk_size
+                = (apr_size_t)MIN(remaining, FILE_REGION_CHUNK_SIZE);
+
+              svn_pool_clear(iterpool);
+              SVN_ERR(svn_ra_svn__write_string_from_file(conn, iterpool,
+                                                         region_file, offset,
+                                                         chunk_size));
+              offset += chunk_size;
+              remaining -= chunk_size;
+            }
+        }
+      svn_pool_destroy(iterpool);
+
+      SVN_ERR(svn_ra_svn__write_cstring(conn, pool, ""));
+      SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+    }
+  else if (want_contents)
     {
       err = SVN_NO_ERROR;
       while (1)
@@ -2518,6 +2649,108 @@ check_path(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Like check_path but for a list of paths, so clients don't have to wait
+ * for every individual response.  Similar to lock_many, report the result
+ * of each path individually, followed by "done" and the overall command
+ * response.
+ */
+static svn_error_t *
+check_path_many(svn_ra_svn_conn_t *conn,
+                apr_pool_t *pool,
+                svn_ra_svn__list_t *params,
+                void *baton)
+{
+  server_baton_t *b = baton;
+  svn_revnum_t rev;
+  svn_ra_svn__list_t *paths;
+  svn_fs_root_t *root = NULL;
+  apr_array_header_t *full_paths, *readable_paths, *kinds;
+  apr_pool_t *iterpool;
+  svn_error_t *err, *write_err = SVN_NO_ERROR;
+  int i, k;
+
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "(?r)l", &rev, &paths));
+
+  /* Because we can only send a single auth reply per request, require
+     blanket read access here.  Paths that are not readable will be
+     reported as failures individually. */
+  SVN_ERR(must_have_access(conn, pool, b, svn_authz_read, NULL, FALSE));
+
+  for (i = 0; i < paths->nelts; ++i)
+    if (SVN_RA_SVN__LIST_ITEM(paths, i).kind != SVN_RA_SVN_STRING)
+      return svn_error_create(SVN_ERR_RA_SVN_MALFORMED_DATA, NULL,
+                              "Check path requests should be list of paths");
+
+  err = SVN_IS_VALID_REVNUM(rev)
+      ? SVN_NO_ERROR
+      : svn_fs_youngest_rev(&rev, b->repository->fs, pool);
+  if (!err)
+    err = svn_fs_revision_root(&root, b->repository->fs, rev, pool);
+
+  if (!err)
+    SVN_ERR(log_command(b, conn, pool, "check-path-many r%ld (%d paths)",
+                        rev, paths->nelts));
+
+  /* Filter out unreadable paths, marked by NULL in FULL_PATHS, and look
+     up the kinds of all others in one go. */
+  full_paths = apr_array_make(pool, paths->nelts, sizeof(const char *));
+  readable_paths = apr_array_make(pool, paths->nelts, sizeof(const char *));
+  for (i = 0; !err && i < paths->nelts; ++i)
+    {
+      const char *path = SVN_RA_SVN__LIST_ITEM(paths, i).u.string.data;
+      const char *full_path
+        = svn_fspath__join(b->repository->fs_path->data,
+                           svn_relpath_canonicalize(path, pool), pool);
+
+      if (lookup_access(pool, b, svn_authz_read, full_path, FALSE))
+        APR_ARRAY_PUSH(readable_paths, const char *) = full_path;
+      else
+        full_path = NULL;
+
+      APR_ARRAY_PUSH(full_paths, const char *) = full_path;
+    }
+
+  if (!err)
+    err = svn_fs_check_paths(&kinds, root, readable_paths, pool, pool);
+
+  /* Return results in the same order as the paths were supplied. */
+  iterpool = svn_pool_create(pool);
+  for (i = 0, k = 0; !err && i < paths->nelts; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      if (APR_ARRAY_IDX(full_paths, i, const char *) == NULL)
+        {
+          svn_error_t *path_err
+            = error_create_and_log(SVN_ERR_RA_NOT_AUTHORIZED, NULL, NULL, b);
+
+          write_err = svn_ra_svn__write_cmd_failure(conn, iterpool, path_err);
+          svn_error_clear(path_err);
+        }
+      else
+        {
+          svn_node_kind_t kind = APR_ARRAY_IDX(kinds, k++, svn_node_kind_t);
+
+          write_err = svn_ra_svn__write_cmd_response(conn, iterpool, "w",
+                                            svn_node_kind_to_word(kind));
+        }
+
+      if (write_err)
+        break;
+    }
+  svn_pool_destroy(iterpool);
+
+  if (!write_err)
+    write_err = svn_ra_svn__write_word(conn, pool, "done");
+  if (!write_err)
+    SVN_CMD_ERR(err);
+  svn_error_clear(err);
+  SVN_ERR(write_err);
+  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 stat_cmd(svn_ra_svn_conn_t *conn,
          apr_pool_t *pool,
@@ -2821,15 +3054,10 @@ static svn_error_t *file_rev_handler(void *baton, const char *path,
       svn_stream_set_write(stream, svndiff_handler);
       svn_stream_set_close(stream, svndiff_close_handler);
 
-      /* If the connection does not support SVNDIFF1 or if we don't want to use
-       * compression, use the non-compressing "version 0" implementation */
-      if (   svn_ra_svn_compression_level(frb->conn) > 0
-          && svn_ra_svn_has_capability(frb->conn, SVN_RA_SVN_CAP_SVNDIFF1))
-        svn_txdelta_to_svndiff3(d_handler, d_baton, stream, 1,
-                                svn_ra_svn_compression_level(frb->conn), pool);
-      else
-        svn_txdelta_to_svndiff3(d_handler, d_baton, stream, 0,
-                                svn_ra_svn_compression_level(frb->conn), pool);
+      /* Use the best svndiff version that the connection supports. */
+      svn_txdelta_to_svndiff3(d_handler, d_baton, stream,
+                              svn_ra_svn__svndiff_version(frb->conn),
+                              svn_ra_svn_compression_level(frb->conn), pool);
     }
   else
     SVN_ERR(svn_ra_svn__write_cstring(frb->conn, pool, ""));
@@ -2893,6 +3121,107 @@ get_file_revs(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Baton for blame_receiver(). */
+typedef struct blame_baton_t
+{
+  svn_ra_svn_conn_t *conn;
+
+  /* Revisions whose properties have already been sent.
+     Maps svn_revnum_t to an arbitrary non-NULL value. */
+  apr_hash_t *sent_revs;
+  apr_pool_t *pool;
+} blame_baton_t;
+
+/* Implements svn_repos__blame_receiver_t.  Send one range of lines to
+   the client, but each revision's properties only once. */
+static svn_error_t *
+blame_receiver(void *baton,
+               apr_int64_t start_line,
+               svn_revnum_t revision,
+               apr_hash_t *rev_props,
+               apr_pool_t *scratch_pool)
+{
+  blame_baton_t *bb = baton;
+
+  SVN_ERR(svn_ra_svn__write_tuple(bb->conn, scratch_pool, "n(?r)(!",
+                                  (apr_uint64_t)start_line, revision));
+
+  if (SVN_IS_VALID_REVNUM(revision)
+      && !apr_hash_get(bb->sent_revs, &revision, sizeof(revision)))
+    {
+      apr_hash_set(bb->sent_revs,
+                   apr_pmemdup(bb->pool, &revision, sizeof(revision)),
+                   sizeof(revision), "");
+      if (rev_props)
+        SVN_ERR(svn_ra_svn__write_proplist(bb->conn, scratch_pool,
+                                           rev_props));
+    }
+
+  return svn_error_trace(svn_ra_svn__write_tuple(bb->conn, scratch_pool,
+                                                 "!))"));
+}
+
+static svn_error_t *
+get_blame(svn_ra_svn_conn_t *conn,
+          apr_pool_t *pool,
+          svn_ra_svn__list_t *params,
+          void *baton)
+{
+  server_baton_t *b = baton;
+  svn_error_t *err, *write_err;
+  blame_baton_t bb;
+  svn_diff_file_options_t *diff_options;
+  svn_revnum_t start_rev, end_rev;
+  const char *path;
+  const char *full_path;
+  const char *ignore_space;
+  svn_boolean_t ignore_eol_style;
+  authz_baton_t ab;
+
+  ab.server = b;
+  ab.conn = conn;
+
+  /* Parse arguments. */
+  SVN_ERR(svn_ra_svn__parse_tuple(params, "crrwb", &path, &start_rev,
+                                  &end_rev, &ignore_space,
+                                  &ignore_eol_style));
+  path = svn_relpath_canonicalize(path, pool);
+  SVN_ERR(trivial_auth_request(conn, pool, b));
+  full_path = svn_fspath__join(b->repository->fs_path->data, path, pool);
+
+  diff_options = svn_diff_file_options_create(pool);
+  diff_options->ignore_eol_style = ignore_eol_style;
+  if (strcmp(ignore_space, "change") == 0)
+    diff_options->ignore_space = svn_diff_file_ignore_space_change;
+  else if (strcmp(ignore_space, "all") == 0)
+    diff_options->ignore_space = svn_diff_file_ignore_space_all;
+  else
+    diff_options->ignore_space = svn_diff_file_ignore_space_none;
+
+  SVN_ERR(log_command(b, conn, pool, "get-blame %s r%ld:%ld",
+                      svn_path_uri_encode(full_path, pool),
+                      start_rev, end_rev));
+
+  bb.conn = conn;
+  bb.sent_revs = apr_hash_make(pool);
+  bb.pool = pool;
+
+  err = svn_repos__blame(b->repository->repos, full_path, start_rev,
+                         end_rev, diff_options,
+                         authz_check_access_cb_func(b), &ab,
+                         blame_receiver, &bb, NULL, NULL, pool);
+  write_err = svn_ra_svn__write_word(conn, pool, "done");
+  if (write_err)
+    {
+      svn_error_clear(err);
+      return write_err;
+    }
+  SVN_CMD_ERR(err);
+  SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 lock(svn_ra_svn_conn_t *conn,
      apr_pool_t *pool,
@@ -3386,11 +3715,17 @@ get_locks(svn_ra_svn_conn_t *conn,
   return SVN_NO_ERROR;
 }
 
+/* Replay revision REV to the client.  Open its root in ROOT_POOL and
+   return it in *ROOT_P, if that is not NULL.  If BASE_ROOT is not NULL,
+   it is the root of REV - 1 and will be used as the delta base. */
 static svn_error_t *replay_one_revision(svn_ra_svn_conn_t *conn,
                                         server_baton_t *b,
+                                        svn_fs_root_t **root_p,
+                                        svn_fs_root_t *base_root,
                                         svn_revnum_t rev,
                                         svn_revnum_t low_water_mark,
                                         svn_boolean_t send_deltas,
+                                        apr_pool_t *root_pool,
                                         apr_pool_t *pool)
 {
   const svn_delta_editor_t *editor;
@@ -3402,18 +3737,27 @@ static svn_error_t *replay_one_revision(svn_ra_svn_conn_t *conn,
   ab.server = b;
   ab.conn = conn;
 
+  if (root_p)
+    *root_p = NULL;
+
   SVN_ERR(log_command(b, conn, pool,
                       svn_log__replay(b->repository->fs_path->data, rev,
                                       pool)));
 
   svn_ra_svn_get_editor(&editor, &edit_baton, conn, pool, NULL, NULL);
 
-  err = svn_fs_revision_root(&root, b->repository->fs, rev, pool);
+  err = svn_fs_revision_root(&root, b->repository->fs, rev, root_pool);
 
   if (! err)
-    err = svn_repos_replay2(root, b->repository->fs_path->data,
-                            low_water_mark, send_deltas, editor, edit_baton,
-                            authz_check_access_cb_func(b), &ab, pool);
+    err = svn_repos__replay_with_base(root, base_root,
+                                      b->repository->fs_path->data,
+                                      low_water_mark, send_deltas,
+                                      editor, edit_baton,
+                                      authz_check_access_cb_func(b), &ab,
+                                      pool);
+
+  if (! err && root_p)
+    *root_p = root;
 
   if (err)
     svn_error_clear(editor->abort_edit(edit_baton, pool));
@@ -3437,8 +3781,8 @@ replay(svn_ra_svn_conn_t *conn,
 
   SVN_ERR(trivial_auth_request(conn, pool, b));
 
-  SVN_ERR(replay_one_revision(conn, b, rev, low_water_mark,
-                              send_deltas, pool));
+  SVN_ERR(replay_one_revision(conn, b, NULL, NULL, rev, low_water_mark,
+                              send_deltas, pool, pool));
 
   SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
 
@@ -3455,6 +3799,8 @@ replay_range(svn_ra_svn_conn_t *conn,
   svn_boolean_t send_deltas;
   server_baton_t *b = baton;
   apr_pool_t *iterpool;
+  apr_pool_t *root_pools[2];
+  svn_fs_root_t *prev_root = NULL;
   authz_baton_t ab;
 
   ab.server = b;
@@ -3466,12 +3812,18 @@ replay_range(svn_ra_svn_conn_t *conn,
 
   SVN_ERR(trivial_auth_request(conn, pool, b));
 
+  /* Each revision root lives for two iterations, so it can serve as the
+     delta base when replaying the next revision. */
   iterpool = svn_pool_create(pool);
+  root_pools[0] = svn_pool_create(pool);
+  root_pools[1] = svn_pool_create(pool);
   for (rev = start_rev; rev <= end_rev; rev++)
     {
       apr_hash_t *props;
+      apr_pool_t *root_pool = root_pools[rev % 2];
 
       svn_pool_clear(iterpool);
+      svn_pool_clear(root_pool);
 
       SVN_CMD_ERR(svn_repos_fs_revision_proplist(&props,
                                                  b->repository->repos, rev,
@@ -3482,10 +3834,14 @@ replay_range(svn_ra_svn_conn_t *conn,
       SVN_ERR(svn_ra_svn__write_proplist(conn, iterpool, props));
       SVN_ERR(svn_ra_svn__write_tuple(conn, iterpool, "!)"));
 
-      SVN_ERR(replay_one_revision(conn, b, rev, low_water_mark,
-                                  send_deltas, iterpool));
+      SVN_ERR(replay_one_revision(conn, b, &prev_root,
+                                  send_deltas ? prev_root : NULL, rev,
+                                  low_water_mark, send_deltas, root_pool,
+                                  iterpool));
 
     }
+  svn_pool_destroy(root_pools[1]);
+  svn_pool_destroy(root_pools[0]);
   svn_pool_destroy(iterpool);
 
   SVN_ERR(svn_ra_svn__write_cmd_response(conn, pool, ""));
@@ -3695,6 +4051,7 @@ list(svn_ra_svn_conn_t *conn,
 static const svn_ra_svn__cmd_entry_t main_commands[] = {
   { "reparent",        reparent },
   { "get-latest-rev",  get_latest_rev },
+  { "request-id",      request_id },
   { "get-dated-rev",   get_dated_rev },
   { "change-rev-prop", change_rev_prop },
   { "change-rev-prop2",change_rev_prop2 },
@@ -3710,10 +4067,12 @@ static const svn_ra_svn__cmd_entry_t main_commands[] = {
   { "get-mergeinfo",   get_mergeinfo },
   { "log",             log_cmd },
   { "check-path",      check_path },
+  { "check-path-many", check_path_many },
   { "stat",            stat_cmd },
   { "get-locations",   get_locations },
   { "get-location-segments",   get_location_segments },
   { "get-file-revs",   get_file_revs },
+  { "get-blame",       get_blame },
   { "lock",            lock },
   { "lock-many",       lock_many },
   { "unlock",          unlock },
@@ -3785,7 +4144,8 @@ repos_path_valid(const char *path)
  * and fs_path fields of REPOSITORY.  VHOST and READ_ONLY flags are the
  * same as in the server baton.
  *
- * CONFIG_POOL shall be used to load config objects.
+ * CONFIG_POOL shall be used to load config objects.  Take the repository
+ * object from REPOS_POOL, if not NULL.
  *
  * Use SCRATCH_POOL for temporary allocations.
  *
@@ -3798,6 +4158,7 @@ find_repos(const char *url,
            svn_config_t *cfg,
            repository_t *repository,
            svn_repos__config_pool_t *config_pool,
+           repos_pool_t *repos_pool,
            apr_hash_t *fs_config,
            apr_pool_t *result_pool,
            apr_pool_t *scratch_pool)
@@ -3837,8 +4198,13 @@ find_repos(const char *url,
                              "No repository found in '%s'", url);
 
   /* Open the repository and fill in b with the resulting information. */
-  SVN_ERR(svn_repos_open3(&repository->repos, repository->repos_root,
-                          fs_config, result_pool, scratch_pool));
+  if (repos_pool)
+    SVN_ERR(repos_pool__borrow(&repository->repos, repos_pool,
+                               repository->repos_root, fs_config,
+                               result_pool, scratch_pool));
+  else
+    SVN_ERR(svn_repos_open3(&repository->repos, repository->repos_root,
+                            fs_config, result_pool, scratch_pool));
   SVN_ERR(svn_repos_remember_client_capabilities(repository->repos,
                                                  repository->capabilities));
   repository->fs = svn_repos_fs(repository->repos);
@@ -3914,7 +4280,8 @@ find_repos(const char *url,
   if (hooks_env)
     hooks_env = svn_dirent_internal_style(hooks_env, scratch_pool);
 
-  SVN_ERR(svn_repos_hooks_setenv(repository->repos, hooks_env, scratch_pool));
+  SVN_ERR(repos_pool__hooks_setenv(repository->repos, hooks_env,
+                                   result_pool, scratch_pool));
   repository->hooks_env = apr_pstrdup(result_pool, hooks_env);
 
   return SVN_NO_ERROR;
@@ -4114,6 +4481,7 @@ construct_server_baton(server_baton_t **baton,
   b->read_only = params->read_only;
   b->pool = conn_pool;
   b->vhost = params->vhost;
+  b->trace_file = params->trace_file;
 
   b->logger = params->logger;
   b->client_info = get_client_info(conn, params, conn_pool);
@@ -4122,7 +4490,7 @@ construct_server_baton(server_baton_t **baton,
    * send an empty mechlist. */
   if (params->compression_level > 0)
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwwwww?w?w)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_SVNDIFF1,
@@ -4135,11 +4503,20 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_CHECK_PATH_MANY,
+                                           SVN_RA_SVN_CAP_BLAME,
+                                           SVN_RA_SVN_CAP_REQUEST_ID,
+                                           svn__lz4_supported()
+                                             ? SVN_RA_SVN_CAP_SVNDIFF2_ACCEPTED
+                                             : NULL,
+                                           svn__lz4_supported()
+                                             ? SVN_RA_SVN_CAP_LZ4_STREAM
+                                             : NULL
                                            ));
   else
     SVN_ERR(svn_ra_svn__write_cmd_response(conn, scratch_pool,
-                                           "nn()(wwwwwwwwwww)",
+                                           "nn()(wwwwwwwwwwwwww)",
                                            (apr_uint64_t) 2, (apr_uint64_t) 2,
                                            SVN_RA_SVN_CAP_EDIT_PIPELINE,
                                            SVN_RA_SVN_CAP_ABSENT_ENTRIES,
@@ -4151,7 +4528,10 @@ construct_server_baton(server_baton_t **baton,
                                            SVN_RA_SVN_CAP_INHERITED_PROPS,
                                            SVN_RA_SVN_CAP_EPHEMERAL_TXNPROPS,
                                            SVN_RA_SVN_CAP_GET_FILE_REVS_REVERSE,
-                                           SVN_RA_SVN_CAP_LIST
+                                           SVN_RA_SVN_CAP_LIST,
+                                           SVN_RA_SVN_CAP_CHECK_PATH_MANY,
+                                           SVN_RA_SVN_CAP_BLAME,
+                                           SVN_RA_SVN_CAP_REQUEST_ID
                                            ));
 
   /* Read client response, which we assume to be in version 2 format:
@@ -4209,6 +4589,7 @@ construct_server_baton(server_baton_t **baton,
   err = handle_config_error(find_repos(client_url, params->root, b->vhost,
                                        b->read_only, params->cfg,
                                        b->repository, params->config_pool,
+                                       params->repos_pool,
                                        params->fs_config,
                                        conn_pool, scratch_pool),
                             b);
@@ -4225,6 +4606,13 @@ construct_server_baton(server_baton_t **baton,
   if (!err)
     {
       SVN_ERR(auth_request(conn, scratch_pool, b, READ_ACCESS, FALSE));
+
+      /* We only offered compression if we support it.  The client
+         switches right after the authentication exchange. */
+      if (params->compression_level > 0
+          && svn_ra_svn_has_capability(conn, SVN_RA_SVN_CAP_LZ4_STREAM))
+        SVN_ERR(svn_ra_svn__enable_lz4_stream(conn, scratch_pool));
+
       if (current_access(b) == NO_ACCESS)
         err = error_create_and_log(SVN_ERR_RA_NOT_AUTHORIZED, NULL,
                                    "Not authorized for access", b);
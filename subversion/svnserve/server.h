@@ -40,6 +40,7 @@ extern "C" {
 #include "private/svn_mutex.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_subr_private.h"
+#include "private/svn_trace.h"
 
 enum username_case_type { CASE_FORCE_UPPER, CASE_FORCE_LOWER, CASE_ASIS };
 
@@ -90,6 +91,8 @@ typedef struct server_baton_t {
                               May be NULL even if log_file is not. */
   svn_boolean_t read_only; /* Disallow write access (global flag) */
   svn_boolean_t vhost;     /* Use virtual-host-based path to repo. */
+  const char *trace_file;  /* Where to record request spans, may be NULL */
+  svn_trace__t *trace;     /* Trace of the client's request ID or NULL */
   apr_pool_t *pool;
 } server_baton_t;
 
@@ -127,6 +130,10 @@ typedef struct serve_params_t {
   /* all configurations should be opened through this factory */
   svn_repos__config_pool_t *config_pool;
 
+  /* Opened repositories that may be reused by later connections;
+     possibly NULL. */
+  struct repos_pool_t *repos_pool;
+
   /* The FS configuration to be applied to all repositories.
      It mainly contains things like cache settings. */
   apr_hash_t *fs_config;
@@ -159,6 +166,10 @@ typedef struct serve_params_t {
 
   /* Use virtual-host-based path to repo. */
   svn_boolean_t vhost;
+
+  /* File to append the spans of requests from clients that send a
+     request ID to; possibly NULL. */
+  const char *trace_file;
 } serve_params_t;
 
 /* This structure contains all data that describes a client / server
@@ -28,6 +28,7 @@
 #include <apr_general.h>
 #include <apr_getopt.h>
 #include <apr_network_io.h>
+#include <apr_poll.h>
 #include <apr_signal.h>
 #include <apr_thread_proc.h>
 #include <apr_portable.h>
@@ -55,7 +56,9 @@
 #include "private/svn_dep_compat.h"
 #include "private/svn_cmdline_private.h"
 #include "private/svn_atomic.h"
+#include "private/svn_cache.h"
 #include "private/svn_mutex.h"
+#include "private/svn_ra_svn_private.h"
 #include "private/svn_subr_private.h"
 
 #if APR_HAS_THREADS
@@ -63,6 +66,7 @@
 #endif
 
 #include "winservice.h"
+#include "repos_pool.h"
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>   /* For getpid() */
@@ -145,6 +149,14 @@ enum run_mode {
  */
 #define THREADPOOL_THREAD_IDLE_LIMIT 1000000
 
+/* Number of idle connections that we expect to park in the poll set when
+ * running with --poll-idle.  epoll and kqueue based poll sets will grow
+ * beyond this.  If the poll set can't take more connections, the extra
+ * ones are being served the traditional way, i.e. with one worker thread
+ * waiting for their next command.
+ */
+#define IDLE_POLLSET_SIZE 1024
+
 /* Number of client to server connections that may concurrently in the
  * TCP 3-way handshake state, i.e. are in the process of being created.
  *
@@ -222,6 +234,14 @@ void winservice_notify_stop(void)
 #define SVNSERVE_OPT_MAX_REQUEST     274
 #define SVNSERVE_OPT_MAX_RESPONSE    275
 #define SVNSERVE_OPT_CACHE_NODEPROPS 276
+#define SVNSERVE_OPT_CACHE_SHARED    277
+#define SVNSERVE_OPT_CACHE_SPILL_FILE 278
+#define SVNSERVE_OPT_CACHE_SPILL_SIZE 279
+#define SVNSERVE_OPT_CACHE_POLICY    280
+#define SVNSERVE_OPT_CACHE_HUGE_PAGES 281
+#define SVNSERVE_OPT_CACHE_NUMA_INTERLEAVE 282
+#define SVNSERVE_OPT_POLL_IDLE       283
+#define SVNSERVE_OPT_TRACE_FILE      284
 
 /* Text macro because we can't use #ifdef sections inside a N_("...")
    macro expansion. */
@@ -325,6 +345,44 @@ static const apr_getopt_option_t svnserve__options[] =
         "Default is yes.\n"
         "                             "
         "[used for FSFS repositories only]")},
+    {"cache-shared", SVNSERVE_OPT_CACHE_SHARED, 1,
+     N_("share the in-memory cache between all processes\n"
+        "                             "
+        "forked by the server.\n"
+        "                             "
+        "Default is no.\n"
+        "                             "
+        "[used in fork mode only]")},
+    {"cache-spill-file", SVNSERVE_OPT_CACHE_SPILL_FILE, 1,
+     N_("keep items evicted from the in-memory cache in\n"
+        "                             "
+        "the file ARG on local disk.  The file persists\n"
+        "                             "
+        "across server restarts.  Not used with\n"
+        "                             "
+        "--cache-shared.\n"
+        "                             "
+        "Default is none.")},
+    {"cache-spill-size", SVNSERVE_OPT_CACHE_SPILL_SIZE, 1,
+     N_("size of the cache spill file in MB.\n"
+        "                             "
+        "Default is 1024.")},
+    {"cache-policy", SVNSERVE_OPT_CACHE_POLICY, 1,
+     N_("eviction policy of the in-memory cache.  ARG may\n"
+        "                             "
+        "be 'priority' or 'tinylfu'.  The latter protects\n"
+        "                             "
+        "frequently used data from large one-off scans.\n"
+        "                             "
+        "Default is priority.")},
+    {"cache-huge-pages", SVNSERVE_OPT_CACHE_HUGE_PAGES, 1,
+     N_("back the in-memory cache with huge pages where\n"
+        "                             "
+        "supported.  Default is no.")},
+    {"cache-numa-interleave", SVNSERVE_OPT_CACHE_NUMA_INTERLEAVE, 1,
+     N_("spread the in-memory cache evenly across all\n"
+        "                             "
+        "NUMA nodes where supported.  Default is no.")},
     {"client-speed", SVNSERVE_OPT_CLIENT_SPEED, 1,
      N_("Optimize network handling based on the assumption\n"
         "                             "
@@ -362,6 +420,17 @@ static const apr_getopt_option_t svnserve__options[] =
         "                             "
         "Default is " APR_STRINGIFY(THREADPOOL_MAX_SIZE) "."
         ONLY_AVAILABLE_WITH_THEADS)},
+    {"poll-idle",        SVNSERVE_OPT_POLL_IDLE, 0,
+     N_("Don't keep a server thread waiting for the next\n"
+        "                             "
+        "command of each connection.  Park idle connections\n"
+        "                             "
+        "in a poll set (epoll, kqueue etc.) instead, so the\n"
+        "                             "
+        "number of threads scales with active requests.\n"
+        "                             "
+        "Default is no."
+        ONLY_AVAILABLE_WITH_THEADS)},
 #endif
     {"max-request-size", SVNSERVE_OPT_MAX_REQUEST, 1,
      N_("Maximum acceptable size of a client request in MB.\n"
@@ -395,7 +464,17 @@ static const apr_getopt_option_t svnserve__options[] =
         "                             "
         "process (useful for debugging)")},
     {"log-file",         SVNSERVE_OPT_LOG_FILE, 1,
+#ifdef SIGUSR1
+     N_("svnserve log file.  SIGUSR1 makes svnserve write\n"
+        "                             "
+        "its cache statistics to this file.")},
+#else
      N_("svnserve log file")},
+#endif
+    {"trace-file",       SVNSERVE_OPT_TRACE_FILE, 1,
+     N_("append the timing of requests from clients that\n"
+        "                             "
+        "send a request ID to this file")},
     {"pid-file",         SVNSERVE_OPT_PID_FILE, 1,
 #ifdef WIN32
      N_("write server process ID to file ARG\n"
@@ -492,6 +571,49 @@ static void sigchld_handler(int signo)
 }
 #endif
 
+#ifdef SIGUSR1
+/* Set by SIGUSR1 to request the cache statistics to be logged. */
+static volatile sig_atomic_t cache_stats_requested = FALSE;
+
+static void sigusr1_handler(int signo)
+{
+  /* Interrupt the accept() and let the main loop do the actual work. */
+  cache_stats_requested = TRUE;
+}
+
+/* Write the global and per-prefix statistics of the membuffer cache to
+ * LOGGER.  Use SCRATCH_POOL for temporary allocations.
+ */
+static void
+log_cache_stats(logger_t *logger,
+                apr_pool_t *scratch_pool)
+{
+  svn_membuffer_t *membuffer = svn_cache__get_global_membuffer_cache();
+  apr_array_header_t *infos;
+  svn_string_t *text;
+  svn_error_t *err;
+
+  if (!logger || !membuffer)
+    return;
+
+  text = svn_cache__format_info(
+             svn_cache__membuffer_get_global_info(scratch_pool),
+             FALSE, scratch_pool);
+  err = logger__write(logger, text->data, text->len);
+
+  if (!err)
+    err = svn_cache__membuffer_get_prefix_info(&infos, membuffer, FALSE,
+                                               scratch_pool);
+  if (!err)
+    {
+      text = svn_cache__format_prefix_info(infos, scratch_pool);
+      err = logger__write(logger, text->data, text->len);
+    }
+
+  svn_error_clear(err);
+}
+#endif
+
 /* Redirect stdout to stderr.  ARG is the pool.
  *
  * In tunnel or inetd mode, we don't want hook scripts corrupting the
@@ -547,6 +669,13 @@ accept_connection(connection_t **connection,
 
       status = apr_socket_accept(&(*connection)->usock, sock,
                                  connection_pool);
+#ifdef SIGUSR1
+      if (cache_stats_requested)
+        {
+          cache_stats_requested = FALSE;
+          log_cache_stats(params->logger, connection_pool);
+        }
+#endif
       if (handling_mode == connection_mode_fork)
         {
           apr_proc_t proc;
@@ -561,6 +690,20 @@ accept_connection(connection_t **connection,
     || APR_STATUS_IS_ECONNABORTED(status)
     || APR_STATUS_IS_ECONNRESET(status));
 
+  /* A non-blocking listener (see --poll-idle) may have nothing to accept
+     if the client gave up between poll() and accept(). */
+  if (APR_STATUS_IS_EAGAIN(status))
+    {
+      svn_pool_destroy(connection_pool);
+      *connection = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  /* The new socket may have inherited the non-blocking flag.  Our protocol
+     implementation expects blocking I/O, though. */
+  if (!status)
+    status = apr_socket_timeout_set((*connection)->usock, -1);
+
   return status
        ? svn_error_wrap_apr(status, _("Can't accept client connection"))
        : SVN_NO_ERROR;
@@ -624,19 +767,58 @@ is_busy(connection_t *connection)
        > apr_thread_pool_thread_max_get(threads);
 }
 
+/* Poll set containing the listening socket and all connections that are
+   waiting for their next command.  NULL, unless --poll-idle was given. */
+static apr_pollset_t *idle_connections;
+
+/* Load determination callback for serve_interruptable in --poll-idle mode:
+   Never wait for the next command in a worker thread. */
+static svn_boolean_t
+park_when_idle(connection_t *connection)
+{
+  return TRUE;
+}
+
+/* Add CONNECTION to IDLE_CONNECTIONS, so the main thread will hand it
+   back to a worker once the next command comes in. */
+static apr_status_t
+park_connection(connection_t *connection)
+{
+  apr_pollfd_t pfd = { 0 };
+
+  pfd.p = connection->pool;
+  pfd.desc_type = APR_POLL_SOCKET;
+  pfd.reqevents = APR_POLLIN;
+  pfd.desc.s = connection->usock;
+  pfd.client_data = connection;
+
+  return apr_pollset_add(idle_connections, &pfd);
+}
+
 /* Serve the connection given by DATA.  Under high load, serve only
    the current command (if any) and then put the connection back into
-   THREAD's task pool. */
+   THREAD's task pool.  In --poll-idle mode, always do that and park the
+   connection in IDLE_CONNECTIONS until the next command arrives. */
 static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
 {
   svn_boolean_t done;
+  svn_boolean_t pending = TRUE;
   connection_t *connection = data;
   svn_error_t *err;
 
   apr_pool_t *pool = svn_root_pools__acquire_pool(connection_pools);
 
   /* process the actual request and log errors */
-  err = serve_interruptable(&done, connection, is_busy, pool);
+  err = serve_interruptable(&done, connection,
+                            idle_connections ? park_when_idle : is_busy,
+                            pool);
+
+  /* The client may have sent more commands than we processed.  Those are
+     in our receive buffer and won't make the socket signal in the poll
+     set, so keep serving the connection without parking it. */
+  if (!err && !done && idle_connections)
+    err = svn_ra_svn__has_command(&pending, &done, connection->conn, pool);
+
   if (err)
     {
       logger__log_error(connection->params->logger, err, NULL,
@@ -647,15 +829,59 @@ static void * APR_THREAD_FUNC serve_thread(apr_thread_t *tid, void *data)
     }
   svn_root_pools__release_pool(pool, connection_pools);
 
-  /* Close or re-schedule connection. */
+  /* Close, park or re-schedule connection.  If the poll set is full,
+     fall back to having a worker thread wait for the next command. */
   if (done)
     close_connection(connection);
-  else
+  else if (pending || park_connection(connection))
     apr_thread_pool_push(threads, serve_thread, connection, 0, NULL);
 
   return NULL;
 }
 
+/* Wait for activity on IDLE_CONNECTIONS.  Hand every parked connection
+   that received a new command to a worker thread.  Return once SOCK, the
+   listening socket, signals a new client. */
+static svn_error_t *
+wait_for_connection(apr_socket_t *sock)
+{
+  svn_boolean_t new_client = FALSE;
+
+  while (!new_client)
+    {
+      apr_int32_t count, i;
+      const apr_pollfd_t *descs;
+      apr_status_t status;
+
+      status = apr_pollset_poll(idle_connections, -1, &count, &descs);
+      if (APR_STATUS_IS_EINTR(status))
+        continue;
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't poll connections"));
+
+      for (i = 0; i < count; ++i)
+        {
+          connection_t *connection = descs[i].client_data;
+
+          /* Only the listening socket comes without a connection. */
+          if (connection == NULL)
+            {
+              new_client = TRUE;
+              continue;
+            }
+
+          /* That includes hang-ups, which the worker will detect. */
+          apr_pollset_remove(idle_connections, &descs[i]);
+          status = apr_thread_pool_push(threads, serve_thread, connection,
+                                        0, NULL);
+          if (status)
+            return svn_error_wrap_apr(status, _("Can't push task"));
+        }
+    }
+
+  return SVN_NO_ERROR;
+}
+
 #endif
 
 /* Write the PID of the current process as a decimal number, followed by a
@@ -724,6 +950,11 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_boolean_t cache_nodeprops = TRUE;
   svn_boolean_t cache_txdeltas = TRUE;
   svn_boolean_t cache_revprops = FALSE;
+  svn_boolean_t cache_shared = FALSE;
+  svn_boolean_t cache_huge_pages = FALSE;
+  svn_boolean_t cache_numa_interleave = FALSE;
+  const char *cache_spill_file = NULL;
+  apr_uint64_t cache_spill_size = APR_UINT64_C(1024) * 0x100000;
   svn_boolean_t use_block_read = FALSE;
   apr_uint16_t port = SVN_RA_SVN_PORT;
   const char *host = NULL;
@@ -742,6 +973,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   svn_node_kind_t kind;
   apr_size_t min_thread_count = THREADPOOL_MIN_SIZE;
   apr_size_t max_thread_count = THREADPOOL_MAX_SIZE;
+  svn_boolean_t poll_idle = FALSE;
 #ifdef SVN_HAVE_SASL
   SVN_ERR(cyrus_init(pool));
 #endif
@@ -766,6 +998,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.compression_level = SVN_DELTA_COMPRESSION_LEVEL_DEFAULT;
   params.logger = NULL;
   params.config_pool = NULL;
+  params.repos_pool = NULL;
   params.fs_config = NULL;
   params.vhost = FALSE;
   params.username_case = CASE_ASIS;
@@ -774,6 +1007,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   params.error_check_interval = 4096;
   params.max_request_size = MAX_REQUEST_SIZE * 0x100000;
   params.max_response_size = 0;
+  params.trace_file = NULL;
 
   while (1)
     {
@@ -920,6 +1154,43 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           cache_nodeprops = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
 
+        case SVNSERVE_OPT_CACHE_SHARED:
+          cache_shared = svn_tristate__from_word(arg) == svn_tristate_true;
+          break;
+
+        case SVNSERVE_OPT_CACHE_HUGE_PAGES:
+          cache_huge_pages
+            = svn_tristate__from_word(arg) == svn_tristate_true;
+          break;
+
+        case SVNSERVE_OPT_CACHE_NUMA_INTERLEAVE:
+          cache_numa_interleave
+            = svn_tristate__from_word(arg) == svn_tristate_true;
+          break;
+
+        case SVNSERVE_OPT_CACHE_SPILL_FILE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&cache_spill_file, arg, pool));
+          cache_spill_file = svn_dirent_internal_style(cache_spill_file, pool);
+          SVN_ERR(svn_dirent_get_absolute(&cache_spill_file,
+                                          cache_spill_file, pool));
+          break;
+
+        case SVNSERVE_OPT_CACHE_SPILL_SIZE:
+          cache_spill_size = 0x100000 * apr_strtoi64(arg, NULL, 0);
+          break;
+
+        case SVNSERVE_OPT_CACHE_POLICY:
+          if (strcmp(arg, "priority") == 0)
+            svn_cache__set_global_membuffer_policy(
+                svn_cache__membuffer_policy_priority);
+          else if (strcmp(arg, "tinylfu") == 0)
+            svn_cache__set_global_membuffer_policy(
+                svn_cache__membuffer_policy_tinylfu);
+          else
+            return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR, NULL,
+                                     _("Invalid cache policy '%s'"), arg);
+          break;
+
         case SVNSERVE_OPT_BLOCK_READ:
           use_block_read = svn_tristate__from_word(arg) == svn_tristate_true;
           break;
@@ -957,6 +1228,10 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           max_thread_count = (apr_size_t)apr_strtoi64(arg, NULL, 0);
           break;
 
+        case SVNSERVE_OPT_POLL_IDLE:
+          poll_idle = TRUE;
+          break;
+
 #ifdef WIN32
         case SVNSERVE_OPT_SERVICE:
           if (run_mode != run_mode_service)
@@ -990,6 +1265,14 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
           SVN_ERR(svn_dirent_get_absolute(&log_filename, log_filename, pool));
           break;
 
+         case SVNSERVE_OPT_TRACE_FILE:
+          SVN_ERR(svn_utf_cstring_to_utf8(&params.trace_file, arg, pool));
+          params.trace_file = svn_dirent_internal_style(params.trace_file,
+                                                        pool);
+          SVN_ERR(svn_dirent_get_absolute(&params.trace_file,
+                                          params.trace_file, pool));
+          break;
+
         }
     }
 
@@ -1048,6 +1331,7 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
   SVN_ERR(svn_repos__config_pool_create(&params.config_pool,
                                         is_multi_threaded,
                                         pool));
+  SVN_ERR(repos_pool__create(&params.repos_pool, is_multi_threaded, pool));
 
   /* If a configuration file is specified, load it and any referenced
    * password and authorization files. */
@@ -1290,6 +1574,28 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
       }
 
     svn_cache_config_set(&settings);
+    svn_cache__set_global_membuffer_memory_hints(cache_huge_pages,
+                                                 cache_numa_interleave);
+
+    if (cache_spill_file)
+      svn_cache__set_global_membuffer_spill_file(cache_spill_file,
+                                                 cache_spill_size);
+
+    /* Forked processes serve a single connection and would start with an
+     * empty cache each time.  Create the cache in shared memory before
+     * forking, such that they all can feed from and fill it. */
+    if (cache_shared && handling_mode == connection_mode_fork)
+      {
+        svn_cache__set_global_membuffer_shared(TRUE);
+        svn_cache__get_global_membuffer_cache();
+      }
+
+#ifdef SIGUSR1
+    /* Forked children have their own private caches, which we can't
+     * report on. */
+    if (cache_shared || handling_mode != connection_mode_fork)
+      apr_signal(SIGUSR1, sigusr1_handler);
+#endif
   }
 
 #if APR_HAS_THREADS
@@ -1323,13 +1629,47 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
     {
       threads = NULL;
     }
+
+  if (threads && poll_idle)
+    {
+      apr_pollfd_t pfd = { 0 };
+
+      status = apr_pollset_create(&idle_connections, IDLE_POLLSET_SIZE,
+                                  pool, APR_POLLSET_THREADSAFE);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't create poll set"));
+
+      /* The main thread will wait on the poll set instead of blocking in
+         accept().  It must not get stuck if a client disappears after
+         being signalled, though. */
+      status = apr_socket_timeout_set(sock, 0);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't set socket timeout"));
+
+      pfd.p = pool;
+      pfd.desc_type = APR_POLL_SOCKET;
+      pfd.reqevents = APR_POLLIN;
+      pfd.desc.s = sock;
+      pfd.client_data = NULL;
+
+      status = apr_pollset_add(idle_connections, &pfd);
+      if (status)
+        return svn_error_wrap_apr(status, _("Can't add socket to poll set"));
+    }
 #endif
 
   while (1)
     {
       connection_t *connection = NULL;
+#if APR_HAS_THREADS
+      if (idle_connections)
+        SVN_ERR(wait_for_connection(sock));
+#endif
       SVN_ERR(accept_connection(&connection, sock, &params, handling_mode,
                                 pool));
+      if (connection == NULL)
+        continue;
+
       if (run_mode == run_mode_listen_once)
         {
           err = serve_socket(connection, connection->pool);
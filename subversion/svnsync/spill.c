@@ -0,0 +1,814 @@
+/*
+ * spill.c :  record editor drives in a file and play them back later
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+#include <string.h>
+
+#include "svn_pools.h"
+#include "svn_delta.h"
+#include "svn_io.h"
+#include "svn_string.h"
+
+#include "private/svn_string_private.h"
+
+#include "sync.h"
+
+#include "svn_private_config.h"
+
+
+/*** Spill file format ***/
+
+/* A spill file is a sequence of records, each starting with one of the
+ * operation codes below.  All numbers are stored as 8 bytes, most
+ * significant first.  Strings are stored as their length, followed by
+ * their contents; NULL strings have a length of -1.
+ *
+ * Directory and file batons are represented by tokens, numbered in the
+ * order in which they have been opened, starting with 0 for the root.
+ * The text delta of a file is a sequence of window records, terminated
+ * by a SPILL_DELTA_END record.  Edits don't get closed or aborted within
+ * the spill file; the file simply ends.
+ */
+enum spill_op_t
+{
+  SPILL_SET_TARGET_REVISION = 1,    /* revision */
+  SPILL_OPEN_ROOT,                  /* base-rev */
+  SPILL_DELETE_ENTRY,               /* parent path base-rev */
+  SPILL_ADD_DIRECTORY,              /* parent path copyfrom-path -rev */
+  SPILL_OPEN_DIRECTORY,             /* parent path base-rev */
+  SPILL_CHANGE_DIR_PROP,            /* dir name value */
+  SPILL_CLOSE_DIRECTORY,            /* dir */
+  SPILL_ABSENT_DIRECTORY,           /* parent path */
+  SPILL_ADD_FILE,                   /* parent path copyfrom-path -rev */
+  SPILL_OPEN_FILE,                  /* parent path base-rev */
+  SPILL_APPLY_TEXTDELTA,            /* file base-checksum */
+  SPILL_DELTA_WINDOW,               /* file window */
+  SPILL_DELTA_END,                  /* file */
+  SPILL_CHANGE_FILE_PROP,           /* file name value */
+  SPILL_CLOSE_FILE,                 /* file text-checksum */
+  SPILL_ABSENT_FILE                 /* parent path */
+};
+
+/* Write the number N to STREAM. */
+static svn_error_t *
+write_number(svn_stream_t *stream,
+             apr_int64_t n)
+{
+  unsigned char buffer[8];
+  apr_uint64_t value = (apr_uint64_t)n;
+  apr_size_t len = sizeof(buffer);
+  int i;
+
+  for (i = sizeof(buffer) - 1; i >= 0; --i)
+    {
+      buffer[i] = (unsigned char)(value & 0xff);
+      value >>= 8;
+    }
+
+  return svn_error_trace(svn_stream_write(stream, (const char *)buffer,
+                                          &len));
+}
+
+/* Write LEN bytes of DATA to STREAM.  DATA may be NULL. */
+static svn_error_t *
+write_data(svn_stream_t *stream,
+           const char *data,
+           apr_size_t len)
+{
+  if (data == NULL)
+    return svn_error_trace(write_number(stream, -1));
+
+  SVN_ERR(write_number(stream, len));
+  if (len)
+    SVN_ERR(svn_stream_write(stream, data, &len));
+
+  return SVN_NO_ERROR;
+}
+
+/* Write the C string STR, which may be NULL, to STREAM. */
+static svn_error_t *
+write_cstring(svn_stream_t *stream,
+              const char *str)
+{
+  return svn_error_trace(write_data(stream, str, str ? strlen(str) : 0));
+}
+
+/* Write the svn_string_t STR, which may be NULL, to STREAM. */
+static svn_error_t *
+write_string(svn_stream_t *stream,
+             const svn_string_t *str)
+{
+  return svn_error_trace(write_data(stream, str ? str->data : NULL,
+                                    str ? str->len : 0));
+}
+
+/* Read a number from STREAM into *N.  If the stream ends before the
+ * number starts and EOF is not NULL, set *EOF and return without error. */
+static svn_error_t *
+read_number(apr_int64_t *n,
+            svn_boolean_t *eof,
+            svn_stream_t *stream)
+{
+  unsigned char buffer[8];
+  apr_size_t len = sizeof(buffer);
+  apr_uint64_t value = 0;
+  apr_size_t i;
+
+  SVN_ERR(svn_stream_read_full(stream, (char *)buffer, &len));
+  if (eof)
+    {
+      *eof = (len == 0);
+      if (*eof)
+        return SVN_NO_ERROR;
+    }
+
+  if (len != sizeof(buffer))
+    return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
+                            _("Unexpected end of svnsync spill file"));
+
+  for (i = 0; i < sizeof(buffer); ++i)
+    value = (value << 8) | buffer[i];
+
+  *n = (apr_int64_t)value;
+  return SVN_NO_ERROR;
+}
+
+/* Read a string from STREAM into *STR, allocated in POOL.  NULL strings
+ * will be returned as NULL. */
+static svn_error_t *
+read_string(svn_string_t **str,
+            svn_stream_t *stream,
+            apr_pool_t *pool)
+{
+  apr_int64_t n;
+  apr_size_t len;
+  svn_stringbuf_t *buffer;
+
+  SVN_ERR(read_number(&n, NULL, stream));
+  if (n < 0)
+    {
+      *str = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  if ((apr_uint64_t)n >= APR_SIZE_MAX)
+    return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                            _("Invalid string length in svnsync spill "
+                              "file"));
+
+  len = (apr_size_t)n;
+  buffer = svn_stringbuf_create_ensure(len, pool);
+  SVN_ERR(svn_stream_read_full(stream, buffer->data, &len));
+  if (len != (apr_size_t)n)
+    return svn_error_create(SVN_ERR_STREAM_UNEXPECTED_EOF, NULL,
+                            _("Unexpected end of svnsync spill file"));
+
+  buffer->len = len;
+  buffer->data[len] = '\0';
+  *str = svn_stringbuf__morph_into_string(buffer);
+
+  return SVN_NO_ERROR;
+}
+
+/* Like read_string but return a C string in *STR. */
+static svn_error_t *
+read_cstring(const char **str,
+             svn_stream_t *stream,
+             apr_pool_t *pool)
+{
+  svn_string_t *string;
+
+  SVN_ERR(read_string(&string, stream, pool));
+  *str = string ? string->data : NULL;
+
+  return SVN_NO_ERROR;
+}
+
+
+/*** The recording editor ***/
+
+/* Edit baton */
+typedef struct spill_edit_baton_t
+{
+  svn_stream_t *stream;
+  apr_int64_t next_token;
+} spill_edit_baton_t;
+
+/* A dual-purpose baton for files and directories. */
+typedef struct spill_node_baton_t
+{
+  spill_edit_baton_t *eb;
+  apr_int64_t token;
+} spill_node_baton_t;
+
+/* Write the operation code OP and the token of the baton NB to the spill
+ * file of NB. */
+static svn_error_t *
+write_op(spill_node_baton_t *nb,
+         enum spill_op_t op)
+{
+  SVN_ERR(write_number(nb->eb->stream, op));
+  return svn_error_trace(write_number(nb->eb->stream, nb->token));
+}
+
+/* Return a new node baton for EB, allocated in POOL. */
+static spill_node_baton_t *
+make_node_baton(spill_edit_baton_t *eb,
+                apr_pool_t *pool)
+{
+  spill_node_baton_t *nb = apr_palloc(pool, sizeof(*nb));
+  nb->eb = eb;
+  nb->token = eb->next_token++;
+
+  return nb;
+}
+
+static svn_error_t *
+spill_set_target_revision(void *edit_baton,
+                          svn_revnum_t target_revision,
+                          apr_pool_t *pool)
+{
+  spill_edit_baton_t *eb = edit_baton;
+
+  SVN_ERR(write_number(eb->stream, SPILL_SET_TARGET_REVISION));
+  return svn_error_trace(write_number(eb->stream, target_revision));
+}
+
+static svn_error_t *
+spill_open_root(void *edit_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *pool,
+                void **root_baton)
+{
+  spill_edit_baton_t *eb = edit_baton;
+
+  *root_baton = make_node_baton(eb, pool);
+  SVN_ERR(write_number(eb->stream, SPILL_OPEN_ROOT));
+  return svn_error_trace(write_number(eb->stream, base_revision));
+}
+
+static svn_error_t *
+spill_delete_entry(const char *path,
+                   svn_revnum_t base_revision,
+                   void *parent_baton,
+                   apr_pool_t *pool)
+{
+  spill_node_baton_t *pb = parent_baton;
+
+  SVN_ERR(write_op(pb, SPILL_DELETE_ENTRY));
+  SVN_ERR(write_cstring(pb->eb->stream, path));
+  return svn_error_trace(write_number(pb->eb->stream, base_revision));
+}
+
+/* Record an add_directory or add_file operation OP. */
+static svn_error_t *
+spill_add_node(enum spill_op_t op,
+               const char *path,
+               void *parent_baton,
+               const char *copyfrom_path,
+               svn_revnum_t copyfrom_rev,
+               apr_pool_t *pool,
+               void **child_baton)
+{
+  spill_node_baton_t *pb = parent_baton;
+
+  *child_baton = make_node_baton(pb->eb, pool);
+  SVN_ERR(write_op(pb, op));
+  SVN_ERR(write_cstring(pb->eb->stream, path));
+  SVN_ERR(write_cstring(pb->eb->stream, copyfrom_path));
+  return svn_error_trace(write_number(pb->eb->stream, copyfrom_rev));
+}
+
+/* Record an open_directory or open_file operation OP. */
+static svn_error_t *
+spill_open_node(enum spill_op_t op,
+                const char *path,
+                void *parent_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *pool,
+                void **child_baton)
+{
+  spill_node_baton_t *pb = parent_baton;
+
+  *child_baton = make_node_baton(pb->eb, pool);
+  SVN_ERR(write_op(pb, op));
+  SVN_ERR(write_cstring(pb->eb->stream, path));
+  return svn_error_trace(write_number(pb->eb->stream, base_revision));
+}
+
+/* Record an absent_directory or absent_file operation OP. */
+static svn_error_t *
+spill_absent_node(enum spill_op_t op,
+                  const char *path,
+                  void *parent_baton)
+{
+  spill_node_baton_t *pb = parent_baton;
+
+  SVN_ERR(write_op(pb, op));
+  return svn_error_trace(write_cstring(pb->eb->stream, path));
+}
+
+/* Record a change_dir_prop or change_file_prop operation OP. */
+static svn_error_t *
+spill_change_prop(enum spill_op_t op,
+                  void *node_baton,
+                  const char *name,
+                  const svn_string_t *value)
+{
+  spill_node_baton_t *nb = node_baton;
+
+  SVN_ERR(write_op(nb, op));
+  SVN_ERR(write_cstring(nb->eb->stream, name));
+  return svn_error_trace(write_string(nb->eb->stream, value));
+}
+
+static svn_error_t *
+spill_add_directory(const char *path,
+                    void *parent_baton,
+                    const char *copyfrom_path,
+                    svn_revnum_t copyfrom_rev,
+                    apr_pool_t *pool,
+                    void **child_baton)
+{
+  return svn_error_trace(spill_add_node(SPILL_ADD_DIRECTORY, path,
+                                        parent_baton, copyfrom_path,
+                                        copyfrom_rev, pool, child_baton));
+}
+
+static svn_error_t *
+spill_open_directory(const char *path,
+                     void *parent_baton,
+                     svn_revnum_t base_revision,
+                     apr_pool_t *pool,
+                     void **child_baton)
+{
+  return svn_error_trace(spill_open_node(SPILL_OPEN_DIRECTORY, path,
+                                         parent_baton, base_revision,
+                                         pool, child_baton));
+}
+
+static svn_error_t *
+spill_change_dir_prop(void *dir_baton,
+                      const char *name,
+                      const svn_string_t *value,
+                      apr_pool_t *pool)
+{
+  return svn_error_trace(spill_change_prop(SPILL_CHANGE_DIR_PROP, dir_baton,
+                                           name, value));
+}
+
+static svn_error_t *
+spill_close_directory(void *dir_baton,
+                      apr_pool_t *pool)
+{
+  return svn_error_trace(write_op(dir_baton, SPILL_CLOSE_DIRECTORY));
+}
+
+static svn_error_t *
+spill_absent_directory(const char *path,
+                       void *parent_baton,
+                       apr_pool_t *pool)
+{
+  return svn_error_trace(spill_absent_node(SPILL_ABSENT_DIRECTORY, path,
+                                           parent_baton));
+}
+
+static svn_error_t *
+spill_add_file(const char *path,
+               void *parent_baton,
+               const char *copyfrom_path,
+               svn_revnum_t copyfrom_rev,
+               apr_pool_t *pool,
+               void **file_baton)
+{
+  return svn_error_trace(spill_add_node(SPILL_ADD_FILE, path, parent_baton,
+                                        copyfrom_path, copyfrom_rev, pool,
+                                        file_baton));
+}
+
+static svn_error_t *
+spill_open_file(const char *path,
+                void *parent_baton,
+                svn_revnum_t base_revision,
+                apr_pool_t *pool,
+                void **file_baton)
+{
+  return svn_error_trace(spill_open_node(SPILL_OPEN_FILE, path, parent_baton,
+                                         base_revision, pool, file_baton));
+}
+
+/* Implements svn_txdelta_window_handler_t, recording WINDOW for the
+ * file baton BATON. */
+static svn_error_t *
+spill_window_handler(svn_txdelta_window_t *window,
+                     void *baton)
+{
+  spill_node_baton_t *fb = baton;
+  svn_stream_t *stream = fb->eb->stream;
+  int i;
+
+  if (window == NULL)
+    return svn_error_trace(write_op(fb, SPILL_DELTA_END));
+
+  SVN_ERR(write_op(fb, SPILL_DELTA_WINDOW));
+  SVN_ERR(write_number(stream, window->sview_offset));
+  SVN_ERR(write_number(stream, window->sview_len));
+  SVN_ERR(write_number(stream, window->tview_len));
+  SVN_ERR(write_number(stream, window->src_ops));
+  SVN_ERR(write_number(stream, window->num_ops));
+  for (i = 0; i < window->num_ops; ++i)
+    {
+      const svn_txdelta_op_t *op = &window->ops[i];
+
+      SVN_ERR(write_number(stream, op->action_code));
+      SVN_ERR(write_number(stream, op->offset));
+      SVN_ERR(write_number(stream, op->length));
+    }
+
+  return svn_error_trace(write_string(stream, window->new_data));
+}
+
+static svn_error_t *
+spill_apply_textdelta(void *file_baton,
+                      const char *base_checksum,
+                      apr_pool_t *pool,
+                      svn_txdelta_window_handler_t *handler,
+                      void **handler_baton)
+{
+  spill_node_baton_t *fb = file_baton;
+
+  SVN_ERR(write_op(fb, SPILL_APPLY_TEXTDELTA));
+  SVN_ERR(write_cstring(fb->eb->stream, base_checksum));
+
+  *handler = spill_window_handler;
+  *handler_baton = fb;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+spill_change_file_prop(void *file_baton,
+                       const char *name,
+                       const svn_string_t *value,
+                       apr_pool_t *pool)
+{
+  return svn_error_trace(spill_change_prop(SPILL_CHANGE_FILE_PROP,
+                                           file_baton, name, value));
+}
+
+static svn_error_t *
+spill_close_file(void *file_baton,
+                 const char *text_checksum,
+                 apr_pool_t *pool)
+{
+  spill_node_baton_t *fb = file_baton;
+
+  SVN_ERR(write_op(fb, SPILL_CLOSE_FILE));
+  return svn_error_trace(write_cstring(fb->eb->stream, text_checksum));
+}
+
+static svn_error_t *
+spill_absent_file(const char *path,
+                  void *parent_baton,
+                  apr_pool_t *pool)
+{
+  return svn_error_trace(spill_absent_node(SPILL_ABSENT_FILE, path,
+                                           parent_baton));
+}
+
+static svn_error_t *
+spill_close_edit(void *edit_baton,
+                 apr_pool_t *pool)
+{
+  spill_edit_baton_t *eb = edit_baton;
+
+  return svn_error_trace(svn_stream_close(eb->stream));
+}
+
+svn_error_t *
+svnsync_get_spill_editor(const svn_delta_editor_t **editor,
+                         void **edit_baton,
+                         apr_file_t *file,
+                         apr_pool_t *pool)
+{
+  svn_delta_editor_t *tree_editor = svn_delta_default_editor(pool);
+  spill_edit_baton_t *eb = apr_pcalloc(pool, sizeof(*eb));
+
+  tree_editor->set_target_revision = spill_set_target_revision;
+  tree_editor->open_root = spill_open_root;
+  tree_editor->delete_entry = spill_delete_entry;
+  tree_editor->add_directory = spill_add_directory;
+  tree_editor->open_directory = spill_open_directory;
+  tree_editor->change_dir_prop = spill_change_dir_prop;
+  tree_editor->close_directory = spill_close_directory;
+  tree_editor->absent_directory = spill_absent_directory;
+  tree_editor->add_file = spill_add_file;
+  tree_editor->open_file = spill_open_file;
+  tree_editor->apply_textdelta = spill_apply_textdelta;
+  tree_editor->change_file_prop = spill_change_file_prop;
+  tree_editor->close_file = spill_close_file;
+  tree_editor->absent_file = spill_absent_file;
+  tree_editor->close_edit = spill_close_edit;
+
+  eb->stream = svn_stream_from_aprfile2(file, TRUE, pool);
+  eb->next_token = 0;
+
+  *editor = tree_editor;
+  *edit_baton = eb;
+
+  return SVN_NO_ERROR;
+}
+
+
+/*** Playing back a spill file ***/
+
+/* What we know about a directory or file baton of the editor being
+ * driven. */
+typedef struct play_node_t
+{
+  void *baton;
+
+  /* Position of this node in the list of all nodes. */
+  int token;
+
+  /* Lives as long as the node is open. */
+  apr_pool_t *pool;
+
+  /* Text delta being applied to a file.  HANDLER is NULL otherwise. */
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+} play_node_t;
+
+/* Return the node for the token read from STREAM in NODES.  Don't return
+ * nodes that have been closed already. */
+static svn_error_t *
+read_node(play_node_t **node,
+          svn_stream_t *stream,
+          apr_array_header_t *nodes)
+{
+  apr_int64_t token;
+
+  SVN_ERR(read_number(&token, NULL, stream));
+  if (token < 0 || token >= nodes->nelts
+      || APR_ARRAY_IDX(nodes, token, play_node_t *) == NULL)
+    return svn_error_createf(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                             _("Invalid node token %s in svnsync spill "
+                               "file"),
+                             apr_psprintf(nodes->pool, "%" APR_INT64_T_FMT,
+                                          token));
+
+  *node = APR_ARRAY_IDX(nodes, token, play_node_t *);
+  return SVN_NO_ERROR;
+}
+
+/* Add a new node for a child of PARENT, or for the root if PARENT is
+ * NULL, to NODES and return it.  Its pool will be a sub-pool of PARENT's
+ * pool or POOL, respectively. */
+static play_node_t *
+add_node(apr_array_header_t *nodes,
+         play_node_t *parent,
+         apr_pool_t *pool)
+{
+  apr_pool_t *node_pool = svn_pool_create(parent ? parent->pool : pool);
+  play_node_t *node = apr_pcalloc(node_pool, sizeof(*node));
+
+  node->pool = node_pool;
+  node->token = nodes->nelts;
+  APR_ARRAY_PUSH(nodes, play_node_t *) = node;
+
+  return node;
+}
+
+/* Remove the closed NODE from NODES and release its memory. */
+static void
+remove_node(apr_array_header_t *nodes,
+            play_node_t *node)
+{
+  APR_ARRAY_IDX(nodes, node->token, play_node_t *) = NULL;
+  svn_pool_destroy(node->pool);
+}
+
+/* Read a delta window from STREAM into *WINDOW, allocated in POOL. */
+static svn_error_t *
+read_window(svn_txdelta_window_t **window,
+            svn_stream_t *stream,
+            apr_pool_t *pool)
+{
+  svn_txdelta_window_t *w = apr_pcalloc(pool, sizeof(*w));
+  svn_txdelta_op_t *ops;
+  svn_string_t *new_data;
+  apr_int64_t n;
+  int i;
+
+  SVN_ERR(read_number(&n, NULL, stream));
+  w->sview_offset = (svn_filesize_t)n;
+  SVN_ERR(read_number(&n, NULL, stream));
+  w->sview_len = (apr_size_t)n;
+  SVN_ERR(read_number(&n, NULL, stream));
+  w->tview_len = (apr_size_t)n;
+  SVN_ERR(read_number(&n, NULL, stream));
+  w->src_ops = (int)n;
+  SVN_ERR(read_number(&n, NULL, stream));
+  if (n < 0 || n > (apr_int64_t)w->tview_len)
+    return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                            _("Invalid delta window in svnsync spill "
+                              "file"));
+  w->num_ops = (int)n;
+
+  ops = apr_palloc(pool, w->num_ops * sizeof(*ops));
+  for (i = 0; i < w->num_ops; ++i)
+    {
+      SVN_ERR(read_number(&n, NULL, stream));
+      ops[i].action_code = (enum svn_delta_action)n;
+      SVN_ERR(read_number(&n, NULL, stream));
+      ops[i].offset = (apr_size_t)n;
+      SVN_ERR(read_number(&n, NULL, stream));
+      ops[i].length = (apr_size_t)n;
+    }
+  w->ops = ops;
+
+  SVN_ERR(read_string(&new_data, stream, pool));
+  w->new_data = new_data;
+
+  *window = w;
+  return SVN_NO_ERROR;
+}
+
+svn_error_t *
+svnsync_play_spill_file(apr_file_t *file,
+                        const svn_delta_editor_t *editor,
+                        void *edit_baton,
+                        apr_pool_t *pool)
+{
+  svn_stream_t *stream = svn_stream_from_aprfile2(file, TRUE, pool);
+  apr_array_header_t *nodes = apr_array_make(pool, 16,
+                                             sizeof(play_node_t *));
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  while (TRUE)
+    {
+      apr_int64_t op;
+      svn_boolean_t eof;
+      play_node_t *parent, *node;
+      const char *path, *copyfrom_path, *name, *checksum;
+      svn_string_t *value;
+      svn_txdelta_window_t *window;
+      apr_int64_t n;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(read_number(&op, &eof, stream));
+      if (eof)
+        break;
+
+      switch (op)
+        {
+          case SPILL_SET_TARGET_REVISION:
+            SVN_ERR(read_number(&n, NULL, stream));
+            SVN_ERR(editor->set_target_revision(edit_baton, (svn_revnum_t)n,
+                                                iterpool));
+            break;
+
+          case SPILL_OPEN_ROOT:
+            SVN_ERR(read_number(&n, NULL, stream));
+            node = add_node(nodes, NULL, pool);
+            SVN_ERR(editor->open_root(edit_baton, (svn_revnum_t)n,
+                                      node->pool, &node->baton));
+            break;
+
+          case SPILL_DELETE_ENTRY:
+            SVN_ERR(read_node(&parent, stream, nodes));
+            SVN_ERR(read_cstring(&path, stream, iterpool));
+            SVN_ERR(read_number(&n, NULL, stream));
+            SVN_ERR(editor->delete_entry(path, (svn_revnum_t)n,
+                                         parent->baton, iterpool));
+            break;
+
+          case SPILL_ADD_DIRECTORY:
+          case SPILL_ADD_FILE:
+            SVN_ERR(read_node(&parent, stream, nodes));
+            node = add_node(nodes, parent, pool);
+            SVN_ERR(read_cstring(&path, stream, node->pool));
+            SVN_ERR(read_cstring(&copyfrom_path, stream, node->pool));
+            SVN_ERR(read_number(&n, NULL, stream));
+            if (op == SPILL_ADD_DIRECTORY)
+              SVN_ERR(editor->add_directory(path, parent->baton,
+                                            copyfrom_path, (svn_revnum_t)n,
+                                            node->pool, &node->baton));
+            else
+              SVN_ERR(editor->add_file(path, parent->baton,
+                                       copyfrom_path, (svn_revnum_t)n,
+                                       node->pool, &node->baton));
+            break;
+
+          case SPILL_OPEN_DIRECTORY:
+          case SPILL_OPEN_FILE:
+            SVN_ERR(read_node(&parent, stream, nodes));
+            node = add_node(nodes, parent, pool);
+            SVN_ERR(read_cstring(&path, stream, node->pool));
+            SVN_ERR(read_number(&n, NULL, stream));
+            if (op == SPILL_OPEN_DIRECTORY)
+              SVN_ERR(editor->open_directory(path, parent->baton,
+                                             (svn_revnum_t)n, node->pool,
+                                             &node->baton));
+            else
+              SVN_ERR(editor->open_file(path, parent->baton,
+                                        (svn_revnum_t)n, node->pool,
+                                        &node->baton));
+            break;
+
+          case SPILL_CHANGE_DIR_PROP:
+          case SPILL_CHANGE_FILE_PROP:
+            SVN_ERR(read_node(&node, stream, nodes));
+            SVN_ERR(read_cstring(&name, stream, iterpool));
+            SVN_ERR(read_string(&value, stream, iterpool));
+            if (op == SPILL_CHANGE_DIR_PROP)
+              SVN_ERR(editor->change_dir_prop(node->baton, name, value,
+                                              iterpool));
+            else
+              SVN_ERR(editor->change_file_prop(node->baton, name, value,
+                                               iterpool));
+            break;
+
+          case SPILL_CLOSE_DIRECTORY:
+            SVN_ERR(read_node(&node, stream, nodes));
+            SVN_ERR(editor->close_directory(node->baton, iterpool));
+            remove_node(nodes, node);
+            break;
+
+          case SPILL_ABSENT_DIRECTORY:
+          case SPILL_ABSENT_FILE:
+            SVN_ERR(read_node(&parent, stream, nodes));
+            SVN_ERR(read_cstring(&path, stream, iterpool));
+            if (op == SPILL_ABSENT_DIRECTORY)
+              SVN_ERR(editor->absent_directory(path, parent->baton,
+                                               iterpool));
+            else
+              SVN_ERR(editor->absent_file(path, parent->baton, iterpool));
+            break;
+
+          case SPILL_APPLY_TEXTDELTA:
+            SVN_ERR(read_node(&node, stream, nodes));
+            SVN_ERR(read_cstring(&checksum, stream, iterpool));
+            SVN_ERR(editor->apply_textdelta(node->baton, checksum,
+                                            node->pool, &node->handler,
+                                            &node->handler_baton));
+            break;
+
+          case SPILL_DELTA_WINDOW:
+          case SPILL_DELTA_END:
+            SVN_ERR(read_node(&node, stream, nodes));
+            if (node->handler == NULL)
+              return svn_error_create(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                                      _("Delta window without text delta "
+                                        "in svnsync spill file"));
+
+            if (op == SPILL_DELTA_WINDOW)
+              {
+                SVN_ERR(read_window(&window, stream, iterpool));
+                SVN_ERR(node->handler(window, node->handler_baton));
+              }
+            else
+              {
+                SVN_ERR(node->handler(NULL, node->handler_baton));
+                node->handler = NULL;
+              }
+            break;
+
+          case SPILL_CLOSE_FILE:
+            SVN_ERR(read_node(&node, stream, nodes));
+            SVN_ERR(read_cstring(&checksum, stream, iterpool));
+            SVN_ERR(editor->close_file(node->baton, checksum, iterpool));
+            remove_node(nodes, node);
+            break;
+
+          default:
+            return svn_error_createf(SVN_ERR_STREAM_MALFORMED_DATA, NULL,
+                                     _("Invalid operation %d in svnsync "
+                                       "spill file"), (int)op);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
@@ -44,6 +44,11 @@
 #include "svn_private_config.h"
 
 #include <apr_uuid.h>
+#if APR_HAS_THREADS
+#include <apr_thread_proc.h>
+#include <apr_thread_mutex.h>
+#include <apr_thread_cond.h>
+#endif
 
 static svn_opt_subcommand_t initialize_cmd,
                             synchronize_cmd,
@@ -71,7 +76,8 @@ enum svnsync__opt {
   svnsync_opt_trust_server_cert_failures_dst,
   svnsync_opt_allow_non_empty,
   svnsync_opt_skip_unchanged,
-  svnsync_opt_steal_lock
+  svnsync_opt_steal_lock,
+  svnsync_opt_prefetch
 };
 
 #define SVNSYNC_OPTS_DEFAULT svnsync_opt_non_interactive, \
@@ -127,9 +133,15 @@ static const svn_opt_subcommand_desc2_t svnsync_cmd_table[] =
          "ignoring what is recorded in the destination repository as the\n"
          "source URL.  Specifying SOURCE_URL is recommended in particular\n"
          "if untrusted users/administrators may have write access to the\n"
-         "DEST_URL repository.\n"),
+         "DEST_URL repository.\n"
+         "\n"
+         "With --prefetch, the following revisions are read from the source\n"
+         "into temporary files while the current one is being committed to\n"
+         "the destination.  This speeds up the initial mirroring of large\n"
+         "repositories.\n"),
       { SVNSYNC_OPTS_DEFAULT, svnsync_opt_source_prop_encoding, 'q',
-        svnsync_opt_disable_locking, svnsync_opt_steal_lock, 'M' } },
+        svnsync_opt_disable_locking, svnsync_opt_steal_lock, 'M',
+        svnsync_opt_prefetch } },
     { "copy-revprops", copy_revprops_cmd, { 0 },
       N_("usage:\n"
          "\n"
@@ -274,6 +286,10 @@ static const apr_getopt_option_t svnsync_options[] =
                           "and is not being concurrently accessed by another\n"
                           "                             "
                           "svnsync instance.")},
+    {"prefetch",       svnsync_opt_prefetch, 1,
+                       N_("read up to ARG revisions from the source ahead\n"
+                          "                             "
+                          "of the commit to the destination (default: 0)")},
     {"memory-cache-size", 'M', 1,
                        N_("size of the extra in-memory cache in MB used to\n"
                           "                             "
@@ -311,6 +327,7 @@ typedef struct opt_baton_t {
   svn_boolean_t quiet;
   svn_boolean_t allow_non_empty;
   svn_boolean_t skip_unchanged;
+  int prefetch;
   svn_boolean_t version;
   svn_boolean_t help;
   svn_opt_revision_t start_rev;
@@ -420,6 +437,7 @@ typedef struct subcommand_baton_t {
 
   /* synchronize only */
   svn_revnum_t committed_rev;
+  int prefetch;   /* Number of revisions to replay ahead of the commit. */
 
   /* copy-revprops only */
   svn_revnum_t start_rev;
@@ -761,6 +779,7 @@ make_subcommand_baton(opt_baton_t *opt_baton,
   b->sync_callbacks.auth_baton = opt_baton->sync_auth_baton;
   b->quiet = opt_baton->quiet;
   b->skip_unchanged = opt_baton->skip_unchanged;
+  b->prefetch = opt_baton->prefetch;
   b->allow_non_empty = opt_baton->allow_non_empty;
   b->to_url = to_url;
   b->source_prop_encoding = opt_baton->source_prop_encoding;
@@ -1419,6 +1438,305 @@ replay_rev_finished(svn_revnum_t revision,
   return SVN_NO_ERROR;
 }
 
+#if APR_HAS_THREADS
+
+/* A revision that has been replayed from the source into a spill file
+ * and is waiting to be committed to the destination.
+ */
+typedef struct spilled_rev_t
+{
+  svn_revnum_t revision;
+  apr_hash_t *rev_props;
+
+  /* Spill file, positioned at its start. */
+  apr_file_t *file;
+
+  /* Owns this structure, the revprops and the spill file. */
+  apr_pool_t *pool;
+
+  struct spilled_rev_t *next;
+} spilled_rev_t;
+
+/* State shared between the prefetching thread, which replays revisions
+ * from the source into spill files, and the committing thread.
+ */
+typedef struct prefetch_baton_t
+{
+  /* Used by the prefetching thread only. */
+  svn_ra_session_t *from_session;
+  svn_revnum_t start_revision;
+  svn_revnum_t end_revision;
+  spilled_rev_t *current;
+
+  /* Guards all following members. */
+  apr_thread_mutex_t *mutex;
+  apr_thread_cond_t *cond;
+
+  /* Replayed revisions in ascending order.  QUEUED never exceeds
+     MAX_QUEUED. */
+  spilled_rev_t *queue_head;
+  spilled_rev_t *queue_tail;
+  int queued;
+  int max_queued;
+
+  /* Set by the prefetching thread when it is done, together with the
+     error that stopped it, if any. */
+  svn_boolean_t finished;
+  svn_error_t *err;
+
+  /* Set by the committing thread to stop the prefetching. */
+  svn_boolean_t shutdown;
+
+  /* Thread-safe pool containing all of the above. */
+  apr_pool_t *pool;
+} prefetch_baton_t;
+
+/* Callback function for svn_ra_replay_range in the prefetching thread,
+ * recording the replay of REVISION in a new spill file.  Wait while the
+ * queue is full.
+ */
+static svn_error_t *
+prefetch_rev_started(svn_revnum_t revision,
+                     void *replay_baton,
+                     const svn_delta_editor_t **editor,
+                     void **edit_baton,
+                     apr_hash_t *rev_props,
+                     apr_pool_t *pool)
+{
+  prefetch_baton_t *pb = replay_baton;
+  apr_pool_t *rev_pool;
+  spilled_rev_t *rev;
+  svn_boolean_t shutdown;
+
+  apr_thread_mutex_lock(pb->mutex);
+  while (pb->queued >= pb->max_queued && !pb->shutdown)
+    apr_thread_cond_wait(pb->cond, pb->mutex);
+  shutdown = pb->shutdown;
+  apr_thread_mutex_unlock(pb->mutex);
+
+  if (shutdown)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  rev_pool = svn_pool_create(pb->pool);
+  rev = apr_pcalloc(rev_pool, sizeof(*rev));
+  rev->revision = revision;
+  rev->pool = rev_pool;
+  SVN_ERR(svn_io_open_unique_file3(&rev->file, NULL, NULL,
+                                   svn_io_file_del_on_pool_cleanup,
+                                   rev_pool, pool));
+  pb->current = rev;
+
+  return svn_error_trace(svnsync_get_spill_editor(editor, edit_baton,
+                                                  rev->file, rev_pool));
+}
+
+/* Callback function for svn_ra_replay_range in the prefetching thread,
+ * handing the spilled REVISION over to the committing thread.
+ */
+static svn_error_t *
+prefetch_rev_finished(svn_revnum_t revision,
+                      void *replay_baton,
+                      const svn_delta_editor_t *editor,
+                      void *edit_baton,
+                      apr_hash_t *rev_props,
+                      apr_pool_t *pool)
+{
+  prefetch_baton_t *pb = replay_baton;
+  spilled_rev_t *rev = pb->current;
+  apr_off_t offset = 0;
+
+  SVN_ERR(editor->close_edit(edit_baton, pool));
+  SVN_ERR(svn_io_file_seek(rev->file, APR_SET, &offset, pool));
+  rev->rev_props = svn_prop_hash_dup(rev_props, rev->pool);
+  pb->current = NULL;
+
+  apr_thread_mutex_lock(pb->mutex);
+  if (pb->queue_tail)
+    pb->queue_tail->next = rev;
+  else
+    pb->queue_head = rev;
+  pb->queue_tail = rev;
+  pb->queued++;
+  apr_thread_cond_broadcast(pb->cond);
+  apr_thread_mutex_unlock(pb->mutex);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements apr_thread_start_t, replaying the revisions of the
+ * prefetch_baton_t in DATA into spill files. */
+static void * APR_THREAD_FUNC
+prefetch_thread(apr_thread_t *thread, void *data)
+{
+  prefetch_baton_t *pb = data;
+  apr_pool_t *pool = svn_pool_create(pb->pool);
+  svn_error_t *err;
+
+  err = svn_ra_replay_range(pb->from_session, pb->start_revision,
+                            pb->end_revision, 0, TRUE,
+                            prefetch_rev_started, prefetch_rev_finished,
+                            pb, pool);
+  svn_pool_destroy(pool);
+
+  apr_thread_mutex_lock(pb->mutex);
+  pb->err = err;
+  pb->finished = TRUE;
+  apr_thread_cond_broadcast(pb->cond);
+  apr_thread_mutex_unlock(pb->mutex);
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+
+/* Commit the spilled revision REV to the destination as described by RB.
+ * Use POOL for temporary allocations.
+ */
+static svn_error_t *
+commit_spilled_rev(replay_baton_t *rb,
+                   spilled_rev_t *rev,
+                   apr_pool_t *pool)
+{
+  const svn_delta_editor_t *editor;
+  void *edit_baton;
+  svn_error_t *err;
+
+  SVN_ERR(check_cancel(NULL));
+  SVN_ERR(replay_rev_started(rev->revision, rb, &editor, &edit_baton,
+                             rev->rev_props, pool));
+
+  err = svnsync_play_spill_file(rev->file, editor, edit_baton, pool);
+  if (err)
+    return svn_error_compose_create(err, editor->abort_edit(edit_baton,
+                                                            pool));
+
+  return svn_error_trace(replay_rev_finished(rev->revision, rb, editor,
+                                             edit_baton, rev->rev_props,
+                                             pool));
+}
+
+/* Copy revisions START_REVISION through END_REVISION to the destination
+ * like svn_ra_replay_range with the replay_rev_started and
+ * replay_rev_finished callbacks does, but pipelined: a separate thread
+ * with its own source session replays up to RB->SB->PREFETCH revisions
+ * ahead into spill files while the current revision gets committed.
+ * Use POOL for temporary allocations.
+ */
+static svn_error_t *
+replay_range_prefetched(replay_baton_t *rb,
+                        svn_revnum_t start_revision,
+                        svn_revnum_t end_revision,
+                        apr_pool_t *pool)
+{
+  prefetch_baton_t *pb;
+  apr_pool_t *thread_safe_pool;
+  apr_thread_t *thread;
+  apr_status_t status;
+  const char *url;
+  const char *uuid;
+  svn_revnum_t latest;
+  svn_revnum_t revision;
+  svn_error_t *err;
+  apr_pool_t *iterpool;
+
+  SVN_ERR(svn_ra_get_session_url(rb->from_session, &url, pool));
+  SVN_ERR(svn_ra_get_uuid2(rb->from_session, &uuid, pool));
+
+  /* Both threads allocate and release revision memory. */
+  thread_safe_pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  pb = apr_pcalloc(thread_safe_pool, sizeof(*pb));
+  pb->pool = thread_safe_pool;
+  pb->start_revision = start_revision;
+  pb->end_revision = end_revision;
+  pb->max_queued = rb->sb->prefetch;
+
+  /* The prefetching thread needs a session of its own that does not
+     share our allocator.  The auth baton is not thread-safe, so make
+     sure the session has authenticated before the thread starts. */
+  err = svn_ra_open4(&pb->from_session, NULL, url, uuid,
+                     &rb->sb->source_callbacks, rb->sb, rb->sb->config,
+                     pb->pool);
+  if (!err)
+    err = svn_ra_get_latest_revnum(pb->from_session, &latest, pool);
+
+  if (!err)
+    {
+      status = apr_thread_mutex_create(&pb->mutex, APR_THREAD_MUTEX_DEFAULT,
+                                       pb->pool);
+      if (!status)
+        status = apr_thread_cond_create(&pb->cond, pb->pool);
+      if (!status)
+        status = apr_thread_create(&thread, NULL, prefetch_thread, pb,
+                                   pb->pool);
+      if (status)
+        err = svn_error_wrap_apr(status, _("Can't start prefetching thread"));
+    }
+
+  if (err)
+    {
+      svn_pool_destroy(pb->pool);
+      return svn_error_trace(err);
+    }
+
+  iterpool = svn_pool_create(pool);
+  for (revision = start_revision; revision <= end_revision; ++revision)
+    {
+      spilled_rev_t *rev;
+
+      svn_pool_clear(iterpool);
+
+      apr_thread_mutex_lock(pb->mutex);
+      while (!pb->queue_head && !pb->finished)
+        apr_thread_cond_wait(pb->cond, pb->mutex);
+
+      rev = pb->queue_head;
+      if (rev)
+        {
+          pb->queue_head = rev->next;
+          if (pb->queue_head == NULL)
+            pb->queue_tail = NULL;
+          pb->queued--;
+          apr_thread_cond_broadcast(pb->cond);
+        }
+      apr_thread_mutex_unlock(pb->mutex);
+
+      /* Prefetching stopped early. */
+      if (rev == NULL)
+        break;
+
+      err = commit_spilled_rev(rb, rev, iterpool);
+      svn_pool_destroy(rev->pool);
+      if (err)
+        break;
+    }
+  svn_pool_destroy(iterpool);
+
+  /* Stop the prefetching thread, if it is still running. */
+  apr_thread_mutex_lock(pb->mutex);
+  pb->shutdown = TRUE;
+  apr_thread_cond_broadcast(pb->cond);
+  apr_thread_mutex_unlock(pb->mutex);
+  apr_thread_join(&status, thread);
+
+  /* Failed commits take precedence over the prefetching thread's error,
+     which is then likely the result of us stopping it. */
+  if (err)
+    svn_error_clear(pb->err);
+  else if (revision <= end_revision)
+    err = pb->err ? pb->err
+                  : svn_error_createf(SVN_ERR_INCOMPLETE_DATA, NULL,
+                                      _("Source did not replay r%ld"),
+                                      revision);
+  else
+    svn_error_clear(pb->err);
+
+  /* Release any revisions that have not been committed. */
+  svn_pool_destroy(pb->pool);
+
+  return svn_error_trace(err);
+}
+
+#endif
+
 /* Synchronize the repository associated with RA session TO_SESSION,
  * using information found in BATON.
  *
@@ -1551,9 +1869,14 @@ do_synchronize(svn_ra_session_t *to_session,
 
   SVN_ERR(check_cancel(NULL));
 
-  SVN_ERR(svn_ra_replay_range(from_session, start_revision, end_revision,
-                              0, TRUE, replay_rev_started,
-                              replay_rev_finished, rb, pool));
+#if APR_HAS_THREADS
+  if (baton->prefetch > 0)
+    SVN_ERR(replay_range_prefetched(rb, start_revision, end_revision, pool));
+  else
+#endif
+    SVN_ERR(svn_ra_replay_range(from_session, start_revision, end_revision,
+                                0, TRUE, replay_rev_started,
+                                replay_rev_finished, rb, pool));
 
   SVN_ERR(log_properties_normalized(rb->normalized_rev_props_count
                                       + normalized_rev_props_count,
@@ -2125,6 +2448,21 @@ sub_main(int *exit_code, int argc, const char *argv[], apr_pool_t *pool)
             opt_baton.skip_unchanged = TRUE;
             break;
 
+          case svnsync_opt_prefetch:
+            {
+              apr_int64_t val;
+
+              SVN_ERR(svn_utf_cstring_to_utf8(&opt_arg, opt_arg, pool));
+              opt_err = svn_cstring_strtoi64(&val, opt_arg, 0, 1000, 10);
+              if (opt_err)
+                return svn_error_createf(SVN_ERR_CL_ARG_PARSING_ERROR,
+                                         opt_err,
+                                         _("Invalid prefetch count '%s'"),
+                                         opt_arg);
+              opt_baton.prefetch = (int)val;
+            }
+            break;
+
           case 'q':
             opt_baton.quiet = TRUE;
             break;
@@ -78,6 +78,29 @@ svnsync_get_sync_editor(const svn_delta_editor_t *wrapped_editor,
                         apr_pool_t *pool);
 
 
+/* Set *EDITOR and *EDIT_BATON to an editor that records the edit being
+ * driven through it in FILE, such that svnsync_play_spill_file() can
+ * repeat it later.  Closing the edit flushes the record but does not
+ * close FILE.  Allocate the editor in POOL.
+ */
+svn_error_t *
+svnsync_get_spill_editor(const svn_delta_editor_t **editor,
+                         void **edit_baton,
+                         apr_file_t *file,
+                         apr_pool_t *pool);
+
+
+/* Drive EDITOR / EDIT_BATON with the edit recorded in FILE by an editor
+ * from svnsync_get_spill_editor(), starting at the current position in
+ * FILE.  Do not close or abort the edit.  Use POOL for all allocations.
+ */
+svn_error_t *
+svnsync_play_spill_file(apr_file_t *file,
+                        const svn_delta_editor_t *editor,
+                        void *edit_baton,
+                        apr_pool_t *pool);
+
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -5807,9 +5807,8 @@ def patch_binary_file(sbox):
     '===================================================================\n',
     'diff --git a/iota b/iota\n',
     'GIT binary patch\n',
-    'literal 48\n',
-    'zc$^E#$ShU>qLPeMg|y6^R0Z|S{E|d<JuZf(=9bpB_PpZ!+|-hc%)E52)STkf{{Wp*\n',
-    'B5)uFa\n',
+    'delta 28\n',
+    'jc$||om>?<6(A3=0+SZ;|oS&Ool98F0&Xt-|ocbRCkCzJ*\n',
     '\n',
     'literal 25\n',
     'ec$^E#$ShU>qLPeMg|y6^R0Z|S{E|d<JuU!m{s;*G\n',
@@ -3391,6 +3391,36 @@ def load_no_flush_to_disk(sbox):
   load_and_verify_dumpstream(sbox, [], [], expected, True, dump,
                              '--no-flush-to-disk', '--ignore-uuid')
 
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+@SkipUnless(svntest.main.fs_has_pack)
+def load_bulk(sbox):
+  "svnadmin load --bulk"
+
+  # Add the same text a few times so that the load can share it.
+  sbox.build()
+  for i in range(3):
+    sbox.simple_add_text('same text\n', 'file-%d' % i)
+    sbox.simple_commit()
+  expected_dump = svntest.actions.run_and_verify_dump(sbox.repo_dir)
+
+  # Load into a repository with two revisions per shard.
+  sbox2 = sbox.clone_dependent()
+  sbox2.build(create_wc=False, empty=True)
+  patch_format(sbox2.repo_dir, shard_size=2)
+  svntest.main.run_command_stdin(svntest.main.svnadmin_binary, [], 0, True,
+                                 expected_dump, 'load', '--bulk', '--quiet',
+                                 sbox2.repo_dir)
+
+  # The two complete shards have been packed at the end.
+  for shard in ['0.pack', '1.pack']:
+    if not os.path.exists(os.path.join(sbox2.repo_dir, 'db', 'revs', shard)):
+      raise svntest.Failure("Shard '%s' has not been packed" % shard)
+
+  svntest.actions.run_and_verify_svnadmin(None, [], 'verify', '--quiet',
+                                          sbox2.repo_dir)
+  actual_dump = svntest.actions.run_and_verify_dump(sbox2.repo_dir)
+  svntest.verify.compare_dump_files(None, None, expected_dump, actual_dump)
+
 def dump_to_file(sbox):
   "svnadmin dump --file ARG"
 
@@ -3499,6 +3529,7 @@ test_list = [ None,
               dump_no_op_change,
               dump_no_op_prop_change,
               load_no_flush_to_disk,
+              load_bulk,
               dump_to_file,
               load_from_file
              ]
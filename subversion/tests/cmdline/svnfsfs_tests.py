@@ -310,6 +310,87 @@ def load_index_sharded(sbox):
   svntest.actions.run_and_verify_svnadmin(expected_output, [],
                                           "verify", sbox.repo_dir)
 
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+@SkipUnless(svntest.main.fs_has_pack)
+@SkipUnless(svntest.main.is_fs_log_addressing)
+def rebuild_indexes(sbox):
+  "rebuild-indexes in a partly packed repo"
+
+  # Two files per shard, so there is a pack file as well as rev files.
+  sbox.build(create_wc=False)
+  patch_format(sbox.repo_dir, shard_size=2)
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "pack", sbox.repo_dir)
+
+  sbox.simple_repo_copy('A/B', 'A/B2')
+  sbox.simple_repo_copy('A/D', 'A/D2')
+
+  # Remember the index contents to compare with.
+  exit_code, expected, errput = \
+    svntest.actions.run_and_verify_svnfsfs(None, [], "dump-index", "-r0",
+                                           sbox.repo_dir)
+
+  expected_output = ["* Rebuilt indexes of the file starting at r0.\n",
+                     "* Rebuilt indexes of the file starting at r2.\n",
+                     "* Rebuilt indexes of the file starting at r3.\n"]
+  svntest.actions.run_and_verify_svnfsfs(expected_output, [],
+                                         "rebuild-indexes", "--jobs", "2",
+                                         sbox.repo_dir)
+
+  # The P2L contents must not have changed.
+  svntest.actions.run_and_verify_svnfsfs(expected, [], "dump-index", "-r0",
+                                         sbox.repo_dir)
+
+  # Run verify to see whether we broke anything.
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "verify", sbox.repo_dir)
+
+@SkipUnless(svntest.main.is_fs_type_fsfs)
+@SkipUnless(svntest.main.fs_has_pack)
+@SkipUnless(svntest.main.is_fs_log_addressing)
+def rebuild_indexes_threaded(sbox):
+  "rebuild-indexes and stats with many jobs"
+
+  # Many small shards, so that plenty of jobs run at the same time and
+  # share the caches.
+  sbox.build(create_wc=False)
+  patch_format(sbox.repo_dir, shard_size=2)
+  for i in range(2, 17):
+    sbox.simple_repo_copy('A/B', 'A/B%d' % i)
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "pack", sbox.repo_dir)
+
+  # Remember the index contents of every file to compare with.
+  first_revs = list(range(0, 17, 2))
+  expected = {}
+  for rev in first_revs:
+    exit_code, expected[rev], errput = \
+      svntest.actions.run_and_verify_svnfsfs(None, [], "dump-index",
+                                             "-r%d" % rev, sbox.repo_dir)
+
+  # A small cache makes the jobs evict each other's entries.
+  expected_output = ["* Rebuilt indexes of the file starting at r%d.\n" % rev
+                     for rev in first_revs]
+  svntest.actions.run_and_verify_svnfsfs(expected_output, [],
+                                         "rebuild-indexes", "--jobs", "8",
+                                         "-M", "1", sbox.repo_dir)
+
+  for rev in first_revs:
+    svntest.actions.run_and_verify_svnfsfs(expected[rev], [], "dump-index",
+                                           "-r%d" % rev, sbox.repo_dir)
+
+  # Parallel stats must match the sequential ones.
+  exit_code, expected_stats, errput = \
+    svntest.actions.run_and_verify_svnfsfs(None, [], "stats", "-M", "1",
+                                           sbox.repo_dir)
+  svntest.actions.run_and_verify_svnfsfs(expected_stats, [], "stats",
+                                         "--jobs", "8", "-M", "1",
+                                         sbox.repo_dir)
+
+  # Run verify to see whether we broke anything.
+  svntest.actions.run_and_verify_svnadmin(None, [],
+                                          "verify", sbox.repo_dir)
+
 @SkipUnless(svntest.main.is_fs_type_fsfs)
 def test_stats_on_empty_repo(sbox):
   "stats on empty repo shall not crash"
@@ -328,6 +409,8 @@ test_list = [ None,
               test_stats,
               load_index_sharded,
               test_stats_on_empty_repo,
+              rebuild_indexes,
+              rebuild_indexes_threaded,
              ]
 
 if __name__ == '__main__':
@@ -718,6 +718,37 @@ def property_delete(sbox):
   svntest.actions.run_and_verify_svnlook(["_U  A/mu\n"], [],
                                          'changed', repo_dir)
 
+#----------------------------------------------------------------------
+def batch(sbox):
+  "run several commands with 'svnlook batch'"
+
+  sbox.build()
+  repo_dir = sbox.repo_dir
+
+  sbox.simple_propset('foo', 'bar', 'A/mu')
+  sbox.simple_commit()
+
+  # Commands default to the batch's revision, may pick their own, and
+  # a failing one does not stop the rest.
+  commands = [ '# comment\n',
+               'youngest\n',
+               'changed -r 2\n',
+               '\n',
+               'cat A/mu\n',
+               'propget foo A/mu\n',
+               'propget -r 2 foo "A/mu"\n',
+             ]
+  exit_code, output, errput = svntest.main.run_command_stdin(
+    svntest.main.svnlook_binary, 1, -1, False, commands,
+    'batch', '-r', '1', repo_dir)
+
+  expect('batch', [ '2\n',
+                    '_U  A/mu\n',
+                    "This is the file 'mu'.\n",
+                    'bar' ], output)
+  if exit_code != 1 or len(errput) == 0:
+    raise svntest.Failure("'svnlook batch' did not report the failure")
+
 
 ########################################################################
 # Run the tests
@@ -738,6 +769,7 @@ test_list = [ None,
               test_filesize,
               test_txn_flag,
               property_delete,
+              batch,
              ]
 
 if __name__ == '__main__':
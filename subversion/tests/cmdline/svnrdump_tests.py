@@ -982,6 +982,58 @@ def load_non_deltas_with_props(sbox):
     actual = map(str.strip, out)
     svntest.verify.compare_and_display_lines(None, 'PROPS', expected, actual)
 
+#----------------------------------------------------------------------
+
+def parallel_dump(sbox):
+  "dump: using parallel sessions"
+  run_dump_test(sbox, "skeleton.dump", extra_options=['--jobs', '3'])
+
+def resume_load(sbox):
+  "load: resume an interrupted load"
+
+  # Create an empty sandbox repository
+  sbox.build(create_wc=False, empty=True)
+
+  # Create the revprop-change hook for this test
+  svntest.actions.enable_revprop_changes(sbox.repo_dir)
+
+  dumpfile = open(os.path.join(os.path.dirname(sys.argv[0]),
+                               'svnrdump_tests_data',
+                               'skeleton.dump'),
+                  'rb').readlines()
+
+  # Set the UUID of the sbox repository to the UUID specified in the
+  # dumpfile ### RA layer doesn't have a set_uuid functionality
+  uuid = dumpfile[2].split(b' ')[1][:-1].decode()
+  svntest.actions.run_and_verify_svnadmin2(None, None, 0,
+                                           'setuuid', sbox.repo_dir,
+                                           uuid)
+
+  # Load the first three revisions and leave the progress properties
+  # behind the way an interrupted load would, in the middle of the
+  # commit of r4.
+  cut = dumpfile.index(b'Revision-number: 4\n')
+  svntest.actions.run_and_verify_svnrdump(dumpfile[:cut],
+                                          svntest.verify.AnyOutput,
+                                          [], 0, 'load', sbox.repo_url)
+  svntest.actions.run_and_verify_svn(None, [], 'propset', '--force',
+                                     '--revprop', '-r0',
+                                     'svn:rdump-last-loaded', '3 3',
+                                     sbox.repo_url)
+  svntest.actions.run_and_verify_svn(None, [], 'propset', '--force',
+                                     '--revprop', '-r0',
+                                     'svn:rdump-currently-loading', '4 4',
+                                     sbox.repo_url)
+
+  # Resuming must load the remaining revisions only; loading any of the
+  # first three again would show up in the comparison.
+  svntest.actions.run_and_verify_svnrdump(dumpfile,
+                                          svntest.verify.AnyOutput,
+                                          [], 0, 'load', '--resume',
+                                          sbox.repo_url)
+
+  compare_repos_dumps(sbox, dumpfile)
+
 ########################################################################
 # Run the tests
 
@@ -1043,6 +1095,8 @@ test_list = [ None,
               load_non_deltas_replace_copy_with_props,
               dump_replace_with_copy,
               load_non_deltas_with_props,
+              parallel_dump,
+              resume_load,
              ]
 
 if __name__ == '__main__':
@@ -1408,6 +1408,200 @@ test_copy_pin_externals_select_subtree(const svn_test_opts_t *opts, apr_pool_t *
   return SVN_NO_ERROR;
 }
 
+/* A line of the file blamed by test_blame_random_edits(). */
+typedef struct blame_line_t
+{
+  svn_revnum_t rev;
+  int id;
+} blame_line_t;
+
+/* Baton for blame_verify_receiver(). */
+typedef struct blame_verify_baton_t
+{
+  const blame_line_t *lines;
+  int nbr_lines;
+  int next_line;
+} blame_verify_baton_t;
+
+/* Implements svn_client_blame_receiver3_t.  Verify that the line matches
+ * the next one expected in BATON. */
+static svn_error_t *
+blame_verify_receiver(void *baton,
+                      svn_revnum_t start_revnum,
+                      svn_revnum_t end_revnum,
+                      apr_int64_t line_no,
+                      svn_revnum_t revision,
+                      apr_hash_t *rev_props,
+                      svn_revnum_t merged_revision,
+                      apr_hash_t *merged_rev_props,
+                      const char *merged_path,
+                      const char *line,
+                      svn_boolean_t local_change,
+                      apr_pool_t *pool)
+{
+  blame_verify_baton_t *b = baton;
+  const blame_line_t *expected;
+
+  SVN_TEST_ASSERT(b->next_line < b->nbr_lines);
+  SVN_TEST_ASSERT(line_no == b->next_line);
+
+  expected = &b->lines[b->next_line++];
+  SVN_TEST_STRING_ASSERT(line, apr_psprintf(pool, "r%ld.%d", expected->rev,
+                                            expected->id));
+  if (revision != expected->rev)
+    return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                             "Line %d blamed on r%ld instead of r%ld",
+                             (int)line_no, revision, expected->rev);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the contents of the NBR_LINES LINES. */
+static svn_stream_t *
+blame_lines_stream(const blame_line_t *lines,
+                   int nbr_lines,
+                   apr_pool_t *pool)
+{
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(pool);
+  int i;
+
+  for (i = 0; i < nbr_lines; ++i)
+    svn_stringbuf_appendcstr(contents, apr_psprintf(pool, "r%ld.%d\n",
+                                                    lines[i].rev,
+                                                    lines[i].id));
+
+  return svn_stream_from_stringbuf(contents, pool);
+}
+
+/* Commit many random line insertions, deletions and replacements, most of
+ * them at the boundaries of earlier changes, and verify that blame
+ * attributes every line to the revision that added it. */
+static svn_error_t *
+test_blame_random_edits(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  enum { MAX_LINES = 1000, NBR_REVS = 60 };
+  blame_line_t *lines = apr_pcalloc(pool, MAX_LINES * sizeof(*lines));
+  int nbr_lines = 0;
+  apr_uint32_t seed = 0x5eed;
+  const char *repos_url;
+  const char *file_url;
+  svn_client_ctx_t *ctx;
+  svn_opt_revision_t peg_rev, start_rev, end_rev;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t rev;
+  int merged;
+
+  SVN_ERR(svn_test__create_repos2(NULL, &repos_url, NULL,
+                                  "test-blame-random-edits", opts,
+                                  pool, pool));
+  SVN_ERR(svn_client_create_context2(&ctx, NULL, pool));
+  SVN_ERR(svn_test__init_auth_baton(&ctx->auth_baton, pool));
+
+  for (rev = 1; rev <= NBR_REVS; ++rev)
+    {
+      svn_client__mtcc_t *mtcc;
+      int next_id = 0;
+      int edits = (rev == 1) ? 0 : 1 + svn_test_rand(&seed) % 3;
+
+      svn_pool_clear(iterpool);
+
+      if (rev == 1)
+        {
+          for (nbr_lines = 0; nbr_lines < 30; ++nbr_lines)
+            {
+              lines[nbr_lines].rev = rev;
+              lines[nbr_lines].id = next_id++;
+            }
+        }
+
+      while (edits--)
+        {
+          int pos = svn_test_rand(&seed) % (nbr_lines + 1);
+          int to_delete = 0;
+          int to_insert = 0;
+          int i;
+
+          /* Prefer positions where the blamed revision changes. */
+          while (pos > 0 && pos < nbr_lines
+                 && lines[pos - 1].rev == lines[pos].rev
+                 && svn_test_rand(&seed) % 4)
+            --pos;
+
+          switch (svn_test_rand(&seed) % 3)
+            {
+              case 0:
+                to_insert = 1 + svn_test_rand(&seed) % 4;
+                break;
+              case 1:
+                to_delete = 1 + svn_test_rand(&seed) % 4;
+                break;
+              default:
+                to_delete = 1 + svn_test_rand(&seed) % 4;
+                to_insert = 1 + svn_test_rand(&seed) % 4;
+                break;
+            }
+
+          to_delete = MIN(to_delete, nbr_lines - pos);
+          if (nbr_lines - to_delete + to_insert > MAX_LINES)
+            to_insert = 0;
+
+          memmove(&lines[pos + to_insert], &lines[pos + to_delete],
+                  (nbr_lines - pos - to_delete) * sizeof(*lines));
+          nbr_lines += to_insert - to_delete;
+          for (i = 0; i < to_insert; ++i)
+            {
+              lines[pos + i].rev = rev;
+              lines[pos + i].id = next_id++;
+            }
+        }
+
+      SVN_ERR(svn_client__mtcc_create(&mtcc, repos_url, rev - 1, ctx,
+                                      iterpool, iterpool));
+      if (rev == 1)
+        SVN_ERR(svn_client__mtcc_add_add_file("f",
+                                              blame_lines_stream(lines,
+                                                                 nbr_lines,
+                                                                 iterpool),
+                                              NULL, mtcc, iterpool));
+      else
+        SVN_ERR(svn_client__mtcc_add_update_file("f",
+                                                 blame_lines_stream(lines,
+                                                                    nbr_lines,
+                                                                    iterpool),
+                                                 NULL, NULL, NULL,
+                                                 mtcc, iterpool));
+      SVN_ERR(svn_client__mtcc_commit(NULL, NULL, NULL, mtcc, iterpool));
+    }
+
+  /* Without merge tracking, the server may do the work for us.  Either
+     way, the results must match. */
+  file_url = apr_pstrcat(pool, repos_url, "/f", SVN_VA_NULL);
+  peg_rev.kind = svn_opt_revision_head;
+  start_rev.kind = svn_opt_revision_number;
+  start_rev.value.number = 1;
+  end_rev.kind = svn_opt_revision_head;
+  for (merged = 0; merged < 2; ++merged)
+    {
+      blame_verify_baton_t b;
+
+      svn_pool_clear(iterpool);
+      b.lines = lines;
+      b.nbr_lines = nbr_lines;
+      b.next_line = 0;
+
+      SVN_ERR(svn_client_blame5(file_url, &peg_rev, &start_rev, &end_rev,
+                                svn_diff_file_options_create(iterpool),
+                                FALSE, merged, blame_verify_receiver, &b,
+                                ctx, iterpool));
+      SVN_TEST_INT_ASSERT(b.next_line, nbr_lines);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* ========================================================================== */
 
 
@@ -1436,6 +1630,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test svn_client_copy7 with externals_to_pin"),
     SVN_TEST_OPTS_PASS(test_copy_pin_externals_select_subtree,
                        "pin externals on selected subtrees only"),
+    SVN_TEST_OPTS_PASS(test_blame_random_edits,
+                       "blame many small edits"),
     SVN_TEST_NULL
   };
 
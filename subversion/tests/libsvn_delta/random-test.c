@@ -280,9 +280,12 @@ copy_tempfile(apr_file_t *fp, apr_pool_t *pool)
 
 
 
-/* (Note: *LAST_SEED is an output parameter.) */
+/* Run the random delta test, using svndiff format SVNDIFF_VERSION for
+   the intermediate encoding.
+   (Note: *LAST_SEED is an output parameter.) */
 static svn_error_t *
 do_random_test(apr_pool_t *pool,
+               int svndiff_version,
                apr_uint32_t *last_seed)
 {
   apr_uint32_t seed, maxlen;
@@ -330,8 +333,8 @@ do_random_test(apr_pool_t *pool,
 
       /* Make stage 2: encode the text delta in svndiff format using
                        varying compression levels. */
-      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream, 1, i % 10,
-                              delta_pool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton, stream,
+                              svndiff_version, i % 10, delta_pool);
 
       /* Make stage 1: create the text delta.  */
       svn_txdelta2(&txdelta_stream,
@@ -363,12 +366,48 @@ static svn_error_t *
 random_test(apr_pool_t *pool)
 {
   apr_uint32_t seed;
-  svn_error_t *err = do_random_test(pool, &seed);
+  svn_error_t *err = do_random_test(pool, 1, &seed);
   if (err)
     fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
   return err;
 }
 
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+random_svndiff2_test(apr_pool_t *pool)
+{
+  apr_uint32_t seed;
+  svn_error_t *err = do_random_test(pool, 2, &seed);
+  if (err)
+    fprintf(stderr, "SEED: %lu\n", (unsigned long)seed);
+  return err;
+}
+
+
+
+/* Implements svn_test_driver_t. */
+static svn_error_t *
+large_window_test(apr_pool_t *pool)
+{
+  /* svndiff2 header followed by a window header with an empty source
+     view and a target view of SVN_DELTA_WINDOW_SIZE + 1 bytes. */
+  static const char data[] = { 'S', 'V', 'N', 2,
+                               0, 0, (char)0x86, (char)0xA0, 1, 0, 0 };
+  apr_size_t len = sizeof(data);
+  svn_txdelta_window_handler_t handler;
+  void *handler_baton;
+  svn_stream_t *stream;
+
+  /* The window limit is the same for all svndiff versions. */
+  svn_txdelta_apply(svn_stream_empty(pool), svn_stream_empty(pool),
+                    NULL, NULL, pool, &handler, &handler_baton);
+  stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE, pool);
+  SVN_TEST_ASSERT_ERROR(svn_stream_write(stream, data, &len),
+                        SVN_ERR_SVNDIFF_CORRUPT_WINDOW);
+
+  return SVN_NO_ERROR;
+}
+
 
 
 /* (Note: *LAST_SEED is an output parameter.) */
@@ -533,6 +572,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "random delta test"),
     SVN_TEST_PASS2(random_combine_test,
                    "random combine delta test"),
+    SVN_TEST_PASS2(random_svndiff2_test,
+                   "random delta test using svndiff2"),
+    SVN_TEST_PASS2(large_window_test,
+                   "reject svndiff2 windows above the standard size"),
 #ifdef SVN_RANGE_INDEX_TEST_H
     SVN_TEST_PASS2(random_range_index_test,
                    "random range index test"),
@@ -22,6 +22,7 @@
  */
 
 #include <apr_pools.h>
+#include <apr_strings.h>
 
 #include "../svn_test.h"
 
@@ -96,6 +97,72 @@ stream_window_test(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+read_window_test(apr_pool_t *pool)
+{
+  svn_stringbuf_t *source = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *target = svn_stringbuf_create_empty(pool);
+  int version, i;
+
+  for (i = 0; i < 2000; ++i)
+    {
+      svn_stringbuf_appendcstr(source, apr_psprintf(pool, "line %d\n", i));
+      svn_stringbuf_appendcstr(target, apr_psprintf(pool, "line %d\n", i));
+      if (i % 100 == 0)
+        svn_stringbuf_appendcstr(target, "some new data\n");
+    }
+
+  /* Parse uncompressed as well as compressed windows of all versions. */
+  for (version = 0; version <= 2; ++version)
+    for (i = 0; i < 2; ++i)
+      {
+        int level = i ? SVN_DELTA_COMPRESSION_LEVEL_DEFAULT
+                      : SVN_DELTA_COMPRESSION_LEVEL_NONE;
+        svn_stringbuf_t *diff = svn_stringbuf_create_empty(pool);
+        svn_txdelta_stream_t *txstream;
+        svn_txdelta_window_handler_t handler;
+        void *handler_baton;
+        svn_txdelta_window_t *window;
+        svn_stream_t *stream;
+        char header[4];
+        apr_size_t len = sizeof(header);
+        char *tbuf;
+
+        if (version == 2 && i && !svn__lz4_supported())
+          continue;
+
+        svn_txdelta2(&txstream, svn_stream_from_stringbuf(source, pool),
+                     svn_stream_from_stringbuf(target, pool), FALSE, pool);
+        svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                                svn_stream_from_stringbuf(diff, pool),
+                                version, level, pool);
+        SVN_ERR(svn_txdelta_send_txstream(txstream, handler, handler_baton,
+                                          pool));
+
+        /* The target fits into a single window. */
+        stream = svn_stream_from_stringbuf(diff, pool);
+        SVN_ERR(svn_stream_read_full(stream, header, &len));
+        SVN_TEST_INT_ASSERT(header[3], version);
+        SVN_ERR(svn_txdelta_read_svndiff_window(&window, stream, version,
+                                                pool));
+
+        SVN_TEST_INT_ASSERT(window->tview_len, target->len);
+        SVN_TEST_ASSERT(window->new_data->len > 0);
+        SVN_TEST_ASSERT(window->new_data->data[window->new_data->len]
+                        == '\0');
+
+        tbuf = apr_palloc(pool, window->tview_len);
+        len = window->tview_len;
+        svn_txdelta_apply_instructions(window,
+                                       source->data + window->sview_offset,
+                                       tbuf, &len);
+        SVN_TEST_INT_ASSERT(len, target->len);
+        SVN_TEST_ASSERT(memcmp(tbuf, target->data, len) == 0);
+      }
+
+  return SVN_NO_ERROR;
+}
+
 
 
 /* The test table.  */
@@ -107,6 +174,8 @@ static struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_NULL,
     SVN_TEST_PASS2(stream_window_test,
                    "txdelta stream and windows test"),
+    SVN_TEST_PASS2(read_window_test,
+                   "read svndiff windows of all versions"),
     SVN_TEST_NULL
   };
 
@@ -3077,6 +3077,359 @@ three_way_double_add(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_patience(apr_pool_t *pool)
+{
+  svn_diff_file_options_t *diff_opts = svn_diff_file_options_create(pool);
+  apr_array_header_t *args = apr_array_make(pool, 1, sizeof(const char *));
+
+  APR_ARRAY_PUSH(args, const char *) = "--patience";
+  SVN_ERR(svn_diff_file_options_parse(diff_opts, args, pool));
+  SVN_TEST_ASSERT(diff_opts->patience);
+
+  /* The unique lines A, B and C anchor the diff; the gaps between them
+     only contain repeated lines and go through the fallback. */
+  SVN_ERR(two_way_diff("patience1a", "patience1b",
+                       "A\n"
+                       "x\n"
+                       "B\n"
+                       "x\n"
+                       "C\n",
+
+                       "A\n"
+                       "x\n"
+                       "B\n"
+                       "D\n"
+                       "x\n"
+                       "C\n",
+
+                       "--- patience1a"  NL
+                       "+++ patience1b"  NL
+                       "@@ -1,5 +1,6 @@" NL
+                       " A\n"
+                       " x\n"
+                       " B\n"
+                       "+D\n"
+                       " x\n"
+                       " C\n",
+                       diff_opts, pool));
+
+  /* A moved line that is unique in both files. */
+  SVN_ERR(two_way_diff("patience2a", "patience2b",
+                       "A\n"
+                       "B\n"
+                       "C\n"
+                       "D\n"
+                       "E\n",
+
+                       "A\n"
+                       "D\n"
+                       "B\n"
+                       "C\n"
+                       "E\n",
+
+                       "--- patience2a"  NL
+                       "+++ patience2b"  NL
+                       "@@ -1,5 +1,5 @@" NL
+                       " A\n"
+                       "+D\n"
+                       " B\n"
+                       " C\n"
+                       "-D\n"
+                       " E\n",
+                       diff_opts, pool));
+
+  SVN_ERR(three_way_merge("patience3a", "patience3b", "patience3c",
+                          "A\n"
+                          "x\n"
+                          "B\n"
+                          "x\n"
+                          "C\n",
+
+                          "A\n"
+                          "x\n"
+                          "B\n"
+                          "D\n"
+                          "x\n"
+                          "C\n",
+
+                          "A\n"
+                          "y\n"
+                          "B\n"
+                          "x\n"
+                          "C\n",
+
+                          "A\n"
+                          "y\n"
+                          "B\n"
+                          "D\n"
+                          "x\n"
+                          "C\n",
+                          diff_opts,
+                          svn_diff_conflict_display_modified_latest,
+                          pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for the in-memory datasources of test_token_hash_collisions(). */
+typedef struct line_source_t
+{
+  const char **lines[2];
+  int nbr_lines[2];
+  int pos[2];
+
+  /* Applied to all token hashes, to force collisions. */
+  apr_uint32_t hash_mask;
+} line_source_t;
+
+/* Implements svn_diff_fns2_t.datasources_open. */
+static svn_error_t *
+line_source_open(void *baton,
+                 apr_off_t *prefix_lines,
+                 apr_off_t *suffix_lines,
+                 const svn_diff_datasource_e *datasources,
+                 apr_size_t datasources_len)
+{
+  line_source_t *source = baton;
+
+  source->pos[0] = source->pos[1] = 0;
+  *prefix_lines = 0;
+  *suffix_lines = 0;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_diff_fns2_t.datasource_close. */
+static svn_error_t *
+line_source_close(void *baton,
+                  svn_diff_datasource_e datasource)
+{
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_diff_fns2_t.datasource_get_next_token. */
+static svn_error_t *
+line_source_next(apr_uint32_t *hash,
+                 void **token,
+                 void *baton,
+                 svn_diff_datasource_e datasource)
+{
+  line_source_t *source = baton;
+  int i = (datasource == svn_diff_datasource_original) ? 0 : 1;
+  const char *line;
+  apr_uint32_t h = 0;
+
+  if (source->pos[i] == source->nbr_lines[i])
+    {
+      *token = NULL;
+      return SVN_NO_ERROR;
+    }
+
+  line = source->lines[i][source->pos[i]++];
+  *token = (void *)line;
+  while (*line)
+    h = h * 33 + (unsigned char)*line++;
+  *hash = h & source->hash_mask;
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_diff_fns2_t.token_compare. */
+static svn_error_t *
+line_source_compare(void *baton,
+                    void *ltoken,
+                    void *rtoken,
+                    int *compare)
+{
+  *compare = strcmp(ltoken, rtoken);
+  return SVN_NO_ERROR;
+}
+
+static const svn_diff_fns2_t line_source_vtable =
+  {
+    line_source_open,
+    line_source_close,
+    line_source_next,
+    line_source_compare,
+    NULL,
+    NULL
+  };
+
+/* Baton for recording the ranges of a two-way diff. */
+typedef struct diff_ranges_t
+{
+  line_source_t *source;
+  svn_stringbuf_t *ranges;
+  apr_off_t original_end;
+  apr_off_t modified_end;
+} diff_ranges_t;
+
+/* Append the given ranges to BATON, verify that they are adjacent to the
+ * previous ones and, if COMMON, that they are actually equal. */
+static svn_error_t *
+record_range(diff_ranges_t *b,
+             svn_boolean_t common,
+             apr_off_t original_start,
+             apr_off_t original_length,
+             apr_off_t modified_start,
+             apr_off_t modified_length)
+{
+  apr_off_t i;
+
+  SVN_TEST_ASSERT(original_start == b->original_end);
+  SVN_TEST_ASSERT(modified_start == b->modified_end);
+  b->original_end += original_length;
+  b->modified_end += modified_length;
+
+  if (common)
+    {
+      SVN_TEST_ASSERT(original_length == modified_length);
+      for (i = 0; i < original_length; i++)
+        SVN_TEST_STRING_ASSERT(
+          b->source->lines[0][original_start + i],
+          b->source->lines[1][modified_start + i]);
+    }
+
+  svn_stringbuf_appendcstr(b->ranges,
+                           apr_psprintf(b->ranges->pool,
+                                        "%c%" APR_OFF_T_FMT
+                                        ",%" APR_OFF_T_FMT
+                                        ",%" APR_OFF_T_FMT
+                                        ",%" APR_OFF_T_FMT " ",
+                                        common ? 'c' : 'd',
+                                        original_start, original_length,
+                                        modified_start, modified_length));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_diff_output_fns_t.output_common. */
+static svn_error_t *
+record_common(void *baton,
+              apr_off_t original_start,
+              apr_off_t original_length,
+              apr_off_t modified_start,
+              apr_off_t modified_length,
+              apr_off_t latest_start,
+              apr_off_t latest_length)
+{
+  return record_range(baton, TRUE, original_start, original_length,
+                      modified_start, modified_length);
+}
+
+/* Implements svn_diff_output_fns_t.output_diff_modified. */
+static svn_error_t *
+record_modified(void *baton,
+                apr_off_t original_start,
+                apr_off_t original_length,
+                apr_off_t modified_start,
+                apr_off_t modified_length,
+                apr_off_t latest_start,
+                apr_off_t latest_length)
+{
+  return record_range(baton, FALSE, original_start, original_length,
+                      modified_start, modified_length);
+}
+
+/* Diff the lines in SOURCE and return the ranges found in *RANGES. */
+static svn_error_t *
+diff_line_source(const char **ranges,
+                 line_source_t *source,
+                 apr_pool_t *pool)
+{
+  svn_diff_output_fns_t output_fns = { 0 };
+  diff_ranges_t b;
+  svn_diff_t *diff;
+
+  output_fns.output_common = record_common;
+  output_fns.output_diff_modified = record_modified;
+
+  b.source = source;
+  b.ranges = svn_stringbuf_create_empty(pool);
+  b.original_end = 0;
+  b.modified_end = 0;
+
+  SVN_ERR(svn_diff_diff_2(&diff, source, &line_source_vtable, pool));
+  SVN_ERR(svn_diff_output2(diff, &b, &output_fns, NULL, NULL));
+
+  SVN_TEST_ASSERT(b.original_end == source->nbr_lines[0]);
+  SVN_TEST_ASSERT(b.modified_end == source->nbr_lines[1]);
+
+  *ranges = b.ranges->data;
+  return SVN_NO_ERROR;
+}
+
+/* Distinct tokens with equal hashes must neither be mixed up nor get
+ * lost when the token table grows, and repeated tokens must be found. */
+static svn_error_t *
+test_token_hash_collisions(apr_pool_t *pool)
+{
+  enum { NBR_LINES = 3000, NBR_DISTINCT = 1500 };
+  const apr_uint32_t hash_masks[] = { 0, 1, 0x80000000, 0x3ff };
+  apr_uint32_t seed = 0xd1ff;
+  line_source_t source;
+  const char *expected;
+  const char **original, **modified;
+  int i, m;
+
+  original = apr_palloc(pool, NBR_LINES * sizeof(*original));
+  modified = apr_palloc(pool, 2 * NBR_LINES * sizeof(*modified));
+
+  /* Each line occurs twice in the original on average. */
+  for (i = 0; i < NBR_LINES; i++)
+    original[i] = apr_psprintf(pool, "line %d",
+                               (int)(svn_test_rand(&seed) % NBR_DISTINCT));
+
+  /* Randomly drop, replace or duplicate lines, and add some new ones. */
+  for (i = 0, m = 0; i < NBR_LINES; i++)
+    switch (svn_test_rand(&seed) % 8)
+      {
+        case 0:
+          break;
+        case 1:
+          modified[m++] = apr_psprintf(pool, "new %d", i);
+          break;
+        case 2:
+          modified[m++] = original[i];
+          modified[m++] = original[i];
+          break;
+        default:
+          modified[m++] = original[i];
+          break;
+      }
+
+  source.lines[0] = original;
+  source.nbr_lines[0] = NBR_LINES;
+  source.lines[1] = modified;
+  source.nbr_lines[1] = m;
+
+  /* Well-distributed hashes give the reference result. */
+  source.hash_mask = 0xffffffff;
+  SVN_ERR(diff_line_source(&expected, &source, pool));
+  SVN_TEST_ASSERT(strchr(expected, 'd') != NULL);
+
+  for (i = 0; i < sizeof(hash_masks) / sizeof(hash_masks[0]); i++)
+    {
+      const char *ranges;
+
+      source.hash_mask = hash_masks[i];
+      SVN_ERR(diff_line_source(&ranges, &source, pool));
+      SVN_TEST_STRING_ASSERT(ranges, expected);
+    }
+
+  /* Identical inputs with all hashes colliding. */
+  source.lines[1] = original;
+  source.nbr_lines[1] = NBR_LINES;
+  source.hash_mask = 0;
+  SVN_ERR(diff_line_source(&expected, &source, pool));
+  SVN_TEST_STRING_ASSERT(expected,
+                         apr_psprintf(pool, "c0,%d,0,%d ",
+                                      NBR_LINES, NBR_LINES));
+
+  return SVN_NO_ERROR;
+}
+
 /* ========================================================================== */
 
 
@@ -3121,6 +3474,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "2-way issue #3362 test v2"),
     SVN_TEST_PASS2(three_way_double_add,
                    "3-way merge, double add"),
+    SVN_TEST_PASS2(test_patience,
+                   "2-way and 3-way diff with --patience"),
+    SVN_TEST_PASS2(test_token_hash_collisions,
+                   "2-way diff with colliding token hashes"),
     SVN_TEST_NULL
   };
 
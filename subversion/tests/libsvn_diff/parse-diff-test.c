@@ -1104,6 +1104,85 @@ test_parse_unidiff_with_mergeinfo(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Check that the binary patch in PATCH describes ORIGINAL and LATEST */
+static svn_error_t *
+check_binary_patch(const svn_patch_t *patch,
+                   const svn_stringbuf_t *original,
+                   const svn_stringbuf_t *latest,
+                   apr_pool_t *pool)
+{
+  svn_stringbuf_t *buf;
+
+  SVN_TEST_ASSERT(patch && patch->binary_patch);
+
+  SVN_ERR(svn_stringbuf_from_stream(
+            &buf,
+            svn_diff_get_binary_diff_original_stream(patch->binary_patch,
+                                                     pool),
+            0, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(buf, original));
+
+  SVN_ERR(svn_stringbuf_from_stream(
+            &buf,
+            svn_diff_get_binary_diff_result_stream(patch->binary_patch,
+                                                   pool),
+            0, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(buf, latest));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_binary_delta_roundtrip(apr_pool_t *pool)
+{
+  svn_stringbuf_t *original = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *latest;
+  svn_stringbuf_t *diff = svn_stringbuf_create("diff --git a/f b/f" NL, pool);
+  svn_patch_file_t *patch_file;
+  svn_patch_t *patch;
+  apr_uint32_t seed = 1;
+  int i;
+
+  /* Hardly compressible data with a few local changes. */
+  for (i = 0; i < 200000; i++)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendbyte(original, (char)(seed >> 16));
+    }
+
+  latest = svn_stringbuf_dup(original, pool);
+  memset(latest->data + 1000, 'x', 100);
+  svn_stringbuf_remove(latest, 150000, 300);
+  svn_stringbuf_appendcstr(latest, "some more data at the end");
+
+  SVN_ERR(svn_diff_output_binary(svn_stream_from_stringbuf(diff, pool),
+                                 svn_stream_from_stringbuf(original, pool),
+                                 svn_stream_from_stringbuf(latest, pool),
+                                 NULL, NULL, pool));
+
+  /* The latest version is sent as a short delta. */
+  SVN_TEST_ASSERT(strstr(diff->data, NL "delta "));
+  SVN_TEST_ASSERT(diff->len < original->len);
+
+  SVN_ERR(create_patch_file(&patch_file, diff->data, pool));
+  SVN_ERR(svn_diff_parse_next_patch(&patch, patch_file,
+                                    FALSE, /* reverse */
+                                    FALSE, /* ignore_whitespace */
+                                    pool, pool));
+  SVN_ERR(check_binary_patch(patch, original, latest, pool));
+  SVN_ERR(svn_diff_close_patch_file(patch_file, pool));
+
+  SVN_ERR(create_patch_file(&patch_file, diff->data, pool));
+  SVN_ERR(svn_diff_parse_next_patch(&patch, patch_file,
+                                    TRUE, /* reverse */
+                                    FALSE, /* ignore_whitespace */
+                                    pool, pool));
+  SVN_ERR(check_binary_patch(patch, latest, original, pool));
+  SVN_ERR(svn_diff_close_patch_file(patch_file, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* ========================================================================== */
 
 
@@ -1132,6 +1211,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test parsing unidiffs lacking trailing eol"),
     SVN_TEST_PASS2(test_parse_unidiff_with_mergeinfo,
                    "test parsing unidiffs with mergeinfo"),
+    SVN_TEST_PASS2(test_binary_delta_roundtrip,
+                   "test binary patches with git deltas"),
     SVN_TEST_NULL
   };
 
@@ -7342,6 +7342,78 @@ test_rep_sharing_strict_content_check(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Verify that svn_fs_check_paths() reports the same node kinds for the
+   NULL-terminated list of PATHS in ROOT as svn_fs_check_path().  Use
+   POOL for allocations. */
+static svn_error_t *
+compare_check_paths(svn_fs_root_t *root,
+                    const char **paths,
+                    apr_pool_t *pool)
+{
+  apr_array_header_t *path_list = apr_array_make(pool, 16,
+                                                 sizeof(const char *));
+  apr_array_header_t *kinds;
+  int i;
+
+  for (i = 0; paths[i]; ++i)
+    APR_ARRAY_PUSH(path_list, const char *) = paths[i];
+
+  SVN_ERR(svn_fs_check_paths(&kinds, root, path_list, pool, pool));
+  SVN_TEST_INT_ASSERT(kinds->nelts, path_list->nelts);
+
+  for (i = 0; i < path_list->nelts; ++i)
+    {
+      svn_node_kind_t kind;
+
+      SVN_ERR(svn_fs_check_path(&kind, root, paths[i], pool));
+      SVN_TEST_ASSERT(APR_ARRAY_IDX(kinds, i, svn_node_kind_t) == kind);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_check_paths(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  svn_revnum_t new_rev;
+
+  /* Unsorted, with duplicates, non-canonical and non-existent paths as
+     well as paths below files. */
+  const char *paths[] = {
+    "A/D/G/rho", "/", "A/B/lambda", "A/D/gamma/sub", "/A/D/G/", "iota",
+    "A/B/E/alpha", "A/B/E/alpha", "A/C", "A-missing", "A/D/H/omega",
+    "A/B/F", "missing/deeper", "A/D/G/pi/x", "A/D", "/A/B/E/beta",
+    "A/mu", "", "A/D/H", "A/B/lambda/", "A/B/EE", "A/D/G/tau",
+    NULL
+  };
+
+  SVN_ERR(svn_test__create_fs(&fs, "test-check-paths", opts, pool));
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, 0, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+
+  /* Transaction roots ... */
+  SVN_ERR(compare_check_paths(txn_root, paths, pool));
+
+  /* ... and revision roots. */
+  SVN_ERR(test_commit_txn(&new_rev, txn, NULL, pool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, new_rev, pool));
+  SVN_ERR(compare_check_paths(rev_root, paths, pool));
+
+  /* Changes in a transaction must be visible. */
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, new_rev, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_delete(txn_root, "A/D/G", pool));
+  SVN_ERR(svn_fs_make_dir(txn_root, "A/B/EE", pool));
+  SVN_ERR(compare_check_paths(txn_root, paths, pool));
+
+  return SVN_NO_ERROR;
+}
+
 /* ------------------------------------------------------------------------ */
 
 /* The test table.  */
@@ -7485,6 +7557,8 @@ static struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_OPTS_XFAIL_OTOH(test_rep_sharing_strict_content_check,
                              "test rep-sharing on content rather than SHA1",
                              SVN_TEST_PASS_IF_FS_TYPE_IS(SVN_FS_TYPE_FSFS)),
+    SVN_TEST_OPTS_PASS(test_check_paths,
+                       "test checking many paths at once"),
     SVN_TEST_NULL
   };
 
@@ -30,6 +30,7 @@
 #include "svn_time.h"
 #include "svn_string.h"
 #include "svn_fs.h"
+#include "svn_sorts.h"
 
 #include "../svn_test_fs.h"
 
@@ -1322,6 +1323,240 @@ skip_deltas(const svn_test_opts_t *opts,
 }
 
 
+/* Trail-ish helpers for retry_read(). */
+struct retry_read_args
+{
+  /* Number of attempts with and without a Berkeley DB transaction. */
+  int txn_attempts;
+  int plain_attempts;
+
+  /* Fail all attempts without a transaction? */
+  svn_boolean_t fail_without_txn;
+
+  /* Fail all attempts? */
+  svn_boolean_t fail_always;
+};
+
+static svn_error_t *
+txn_body_retry_read(void *baton, trail_t *trail)
+{
+  struct retry_read_args *args = baton;
+
+  if (trail->db_txn)
+    ++args->txn_attempts;
+  else
+    ++args->plain_attempts;
+
+  if (args->fail_always || (args->fail_without_txn && ! trail->db_txn))
+    return svn_error_create(SVN_ERR_FS_REP_CHANGED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+/* Test that svn_fs_base__retry_read() reads without a transaction and
+   falls back to a transactional trail only if that fails. */
+static svn_error_t *
+retry_read(const svn_test_opts_t *opts,
+           apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  struct retry_read_args args = { 0 };
+
+  SVN_ERR(svn_test__create_bdb_fs(&fs, "test-repo-retry-read", opts,
+                                  pool));
+
+  /* The usual case. */
+  SVN_ERR(svn_fs_base__retry_read(fs, txn_body_retry_read, &args, TRUE,
+                                  pool));
+  SVN_TEST_INT_ASSERT(args.plain_attempts, 1);
+  SVN_TEST_INT_ASSERT(args.txn_attempts, 0);
+
+  /* A concurrent change got in the way. */
+  memset(&args, 0, sizeof(args));
+  args.fail_without_txn = TRUE;
+  SVN_ERR(svn_fs_base__retry_read(fs, txn_body_retry_read, &args, TRUE,
+                                  pool));
+  SVN_TEST_INT_ASSERT(args.plain_attempts, 1);
+  SVN_TEST_INT_ASSERT(args.txn_attempts, 1);
+
+  /* Errors from the transactional attempt get reported. */
+  memset(&args, 0, sizeof(args));
+  args.fail_always = TRUE;
+  SVN_TEST_ASSERT_ERROR(svn_fs_base__retry_read(fs, txn_body_retry_read,
+                                                &args, TRUE, pool),
+                        SVN_ERR_FS_REP_CHANGED);
+  SVN_TEST_INT_ASSERT(args.plain_attempts, 1);
+  SVN_TEST_INT_ASSERT(args.txn_attempts, 1);
+
+  return SVN_NO_ERROR;
+}
+
+
+/* Sizes of the reads in read_ahead(), chosen to straddle the boundaries
+   of the representation read-ahead buffer in various ways. */
+static const apr_size_t read_ahead_sizes[] =
+  { 1, 7, 4096, 100000, 65536, 300000, 13, 262144 };
+
+/* Read from STREAM in chunks of the sizes in READ_AHEAD_SIZES, starting
+   with the one at index *STEP, until *OFFSET reaches END.  Compare the
+   data with EXPECTED, starting at *OFFSET, and advance *OFFSET and *STEP
+   accordingly.  BUF must be large enough for any of these chunks. */
+static svn_error_t *
+read_and_compare(svn_stream_t *stream,
+                 const svn_stringbuf_t *expected,
+                 apr_size_t *offset,
+                 apr_size_t end,
+                 int *step,
+                 char *buf)
+{
+  const int count = sizeof(read_ahead_sizes) / sizeof(read_ahead_sizes[0]);
+
+  while (*offset < end)
+    {
+      apr_size_t requested = read_ahead_sizes[(*step)++ % count];
+      apr_size_t len;
+
+      if (requested > end - *offset)
+        requested = end - *offset;
+
+      len = requested;
+      SVN_ERR(svn_stream_read_full(stream, buf, &len));
+      SVN_TEST_INT_ASSERT(len, requested);
+      if (memcmp(buf, expected->data + *offset, len))
+        return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                 "Wrong contents read at offset %"
+                                 APR_SIZE_T_FMT, *offset);
+
+      *offset += len;
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Commit CONTENTS as the new contents of file "f" in FS on top of
+   *YOUNGEST_REV, deltify the new revision and update *YOUNGEST_REV.
+   Use POOL for temporary allocations. */
+static svn_error_t *
+commit_and_deltify(svn_fs_t *fs,
+                   svn_revnum_t *youngest_rev,
+                   const svn_stringbuf_t *contents,
+                   apr_pool_t *pool)
+{
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_node_kind_t kind;
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, *youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_check_path(&kind, txn_root, "f", pool));
+  if (kind == svn_node_none)
+    SVN_ERR(svn_fs_make_file(txn_root, "f", pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "f", contents->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, youngest_rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(*youngest_rev));
+  SVN_ERR(svn_fs_deltify_revision(fs, *youngest_rev, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Test that reading file contents through the read-ahead buffer returns
+   the correct data, even if concurrent commits deltify the underlying
+   representation while the stream is open. */
+static svn_error_t *
+read_ahead(const svn_test_opts_t *opts,
+           apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_root_t *rev_root;
+  svn_stream_t *stream, *stream2;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_revnum_t youngest_rev = 0;
+  svn_stringbuf_t *original = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *modified;
+  apr_uint32_t seed = 0x5eed;
+  apr_size_t offset = 0, offset2 = 0;
+  int step = 0, step2 = 3;
+  int i;
+  char *buf = apr_palloc(pool, 300000);
+
+  SVN_ERR(svn_test__create_bdb_fs(&fs, "test-repo-read-ahead", opts,
+                                  pool));
+
+  /* Several read-ahead buffers worth of data that deltifies well. */
+  while (original->len < 3 * 256 * 1024 + 12345)
+    svn_stringbuf_appendcstr(original,
+                             apr_psprintf(subpool, "line %08x\n",
+                                          svn_test_rand(&seed)));
+  svn_pool_clear(subpool);
+
+  SVN_ERR(commit_and_deltify(fs, &youngest_rev, original, subpool));
+  svn_pool_clear(subpool);
+
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_file_contents(&stream, rev_root, "f", pool));
+  SVN_ERR(svn_fs_file_contents(&stream2, rev_root, "f", pool));
+
+  /* Read some of it, including a partially consumed read-ahead buffer. */
+  SVN_ERR(read_and_compare(stream, original, &offset, 200000, &step, buf));
+  SVN_ERR(read_and_compare(stream2, original, &offset2, 5, &step2, buf));
+
+  /* Each commit replaces the fulltext of our rep with a delta against the
+     new contents, in between the reads of both streams. */
+  modified = svn_stringbuf_dup(original, pool);
+  for (i = 0; i < 4; ++i)
+    {
+      apr_size_t pos = svn_test_rand(&seed) % (modified->len - 8);
+
+      memcpy(modified->data + pos, "CHANGED!", 8);
+      svn_stringbuf_appendcstr(modified, "another line\n");
+      SVN_ERR(commit_and_deltify(fs, &youngest_rev, modified, subpool));
+      svn_pool_clear(subpool);
+
+      SVN_ERR(read_and_compare(stream, original, &offset,
+                               MIN(offset + 150000, original->len),
+                               &step, buf));
+      SVN_ERR(read_and_compare(stream2, original, &offset2,
+                               MIN(offset2 + 250000, original->len),
+                               &step2, buf));
+    }
+
+  /* Read the rest, which also verifies the checksums. */
+  SVN_ERR(read_and_compare(stream, original, &offset, original->len,
+                           &step, buf));
+  SVN_ERR(read_and_compare(stream2, original, &offset2, original->len,
+                           &step2, buf));
+
+  /* Reading past the end is harmless. */
+  for (i = 0; i < 2; ++i)
+    {
+      apr_size_t len = 1;
+
+      SVN_ERR(svn_stream_read_full(stream, buf, &len));
+      SVN_TEST_INT_ASSERT(len, 0);
+    }
+
+  SVN_ERR(svn_stream_close(stream));
+  SVN_ERR(svn_stream_close(stream2));
+
+  /* A fresh stream on the deltified rep reads the same data. */
+  offset = 0;
+  step = 5;
+  SVN_ERR(svn_fs_file_contents(&stream, rev_root, "f", pool));
+  SVN_ERR(read_and_compare(stream, original, &offset, original->len,
+                           &step, buf));
+
+  /* As does the latest revision. */
+  offset = 0;
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_file_contents(&stream, rev_root, "f", pool));
+  SVN_ERR(read_and_compare(stream, modified, &offset, modified->len,
+                           &step, buf));
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+
 /* Trail-ish helpers for redundant_copy(). */
 struct get_txn_args
 {
@@ -1540,6 +1775,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test svn_fs__canonicalize_abspath"),
     SVN_TEST_OPTS_PASS(skip_deltas,
                        "test skip deltas"),
+    SVN_TEST_OPTS_PASS(retry_read,
+                       "test reading without a transaction"),
+    SVN_TEST_OPTS_PASS(read_ahead,
+                       "test read-ahead with concurrent deltification"),
     SVN_TEST_OPTS_PASS(redundant_copy,
                        "ensure no-op for redundant copies"),
     SVN_TEST_OPTS_PASS(orphaned_textmod_change,
@@ -0,0 +1,1017 @@
+/* fs-fs-benchmark.c --- micro-benchmarks of FSFS / FSX internals
+ *
+ * ====================================================================
+ *    Licensed to the Apache Software Foundation (ASF) under one
+ *    or more contributor license agreements.  See the NOTICE file
+ *    distributed with this work for additional information
+ *    regarding copyright ownership.  The ASF licenses this file
+ *    to you under the Apache License, Version 2.0 (the
+ *    "License"); you may not use this file except in compliance
+ *    with the License.  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing,
+ *    software distributed under the License is distributed on an
+ *    "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ *    KIND, either express or implied.  See the License for the
+ *    specific language governing permissions and limitations
+ *    under the License.
+ * ====================================================================
+ */
+
+/* This is not a test but a set of benchmarks.  Each of them sets up its
+ * own data, e.g. a repository, and then times the operation of interest
+ * only.  Results are written to stdout, one line per measurement with
+ * tab-separated fields, so they can be collected and compared across
+ * builds by scripts:
+ *
+ *   NAME  OPERATIONS  SECONDS  OPERATIONS-PER-SECOND
+ *
+ * Lines starting with '#' are comments.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <apr_getopt.h>
+#include <apr_thread_proc.h>
+
+#include "svn_cmdline.h"
+#include "svn_dirent_uri.h"
+#include "svn_delta.h"
+#include "svn_fs.h"
+#include "svn_hash.h"
+#include "svn_io.h"
+#include "svn_pools.h"
+#include "svn_string.h"
+
+#include "private/svn_cache.h"
+#include "private/svn_cmdline_private.h"
+
+#include "../../libsvn_fs_fs/fs.h"
+#include "../../libsvn_fs_fs/index.h"
+#include "../../libsvn_fs_fs/rev_file.h"
+#include "../../libsvn_fs_fs/util.h"
+
+#include "svn_private_config.h"
+
+
+/*** Benchmark infrastructure. ***/
+
+/* Options shared by all benchmarks. */
+typedef struct bench_opts_t
+{
+  /* Directory to create the repositories in. */
+  const char *data_dir;
+
+  /* Backend to use, i.e. "fsfs" or "fsx". */
+  const char *fs_type;
+
+  /* Multiplier for all problem sizes. */
+  int scale;
+
+  /* Number of threads for the contention benchmarks. */
+  int threads;
+} bench_opts_t;
+
+/* Signature of a benchmark.  It shall report its measurements through
+ * print_result(). */
+typedef svn_error_t *(*bench_func_t)(const bench_opts_t *opts,
+                                     apr_pool_t *pool);
+
+/* Report that the benchmark NAME did OPS operations in DURATION. */
+static svn_error_t *
+print_result(const char *name,
+             apr_int64_t ops,
+             apr_time_t duration,
+             apr_pool_t *pool)
+{
+  double seconds = duration / 1.0e6;
+
+  return svn_error_trace(svn_cmdline_printf(pool,
+                                            "%s\t%" APR_INT64_T_FMT
+                                            "\t%.6f\t%.1f\n",
+                                            name, ops, seconds,
+                                            seconds > 0 ? ops / seconds
+                                                        : 0.0));
+}
+
+/* Return the next number from the pseudo-random sequence in *SEED.
+ * We want reproducible input data, so don't use any system RNG. */
+static apr_uint32_t
+next_random(apr_uint32_t *seed)
+{
+  *seed = *seed * 1103515245 + 12345;
+  return *seed >> 8;
+}
+
+/* Return LEN bytes of pseudo-random, text-like content from *SEED,
+ * allocated in POOL. */
+static svn_stringbuf_t *
+make_text(apr_size_t len,
+          apr_uint32_t *seed,
+          apr_pool_t *pool)
+{
+  svn_stringbuf_t *text = svn_stringbuf_create_ensure(len, pool);
+  apr_size_t i;
+
+  for (i = 0; i < len; ++i)
+    {
+      apr_uint32_t r = next_random(seed);
+      text->data[i] = r % 64 == 0 ? '\n' : (char)('a' + (r >> 6) % 26);
+    }
+
+  text->data[len] = 0;
+  text->len = len;
+
+  return text;
+}
+
+/* Create a new, empty repository NAME below OPTS->DATA_DIR and return it
+ * in *FS.  If CONFIG is not NULL, use it as the FS configuration.
+ * Allocate the result in POOL. */
+static svn_error_t *
+create_fs(svn_fs_t **fs,
+          const bench_opts_t *opts,
+          const char *name,
+          apr_hash_t *config,
+          apr_pool_t *pool)
+{
+  const char *path = svn_dirent_join(opts->data_dir, name, pool);
+  if (!config)
+    config = apr_hash_make(pool);
+
+  svn_hash_sets(config, SVN_FS_CONFIG_FS_TYPE, opts->fs_type);
+  SVN_ERR(svn_io_remove_dir2(path, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_fs_create2(fs, path, config, pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Write CONTENTS to the file at PATH in ROOT.  Use POOL for allocations. */
+static svn_error_t *
+set_contents(svn_fs_root_t *root,
+             const char *path,
+             const svn_stringbuf_t *contents,
+             apr_pool_t *pool)
+{
+  svn_stream_t *stream;
+  apr_size_t len = contents->len;
+
+  SVN_ERR(svn_fs_apply_text(&stream, root, path, NULL, pool));
+  SVN_ERR(svn_stream_write(stream, contents->data, &len));
+  SVN_ERR(svn_stream_close(stream));
+
+  return SVN_NO_ERROR;
+}
+
+/* Commit TXN in FS.  Use POOL for allocations. */
+static svn_error_t *
+commit_txn(svn_fs_txn_t *txn,
+           apr_pool_t *pool)
+{
+  const char *conflict;
+  svn_revnum_t new_rev;
+
+  SVN_ERR(svn_fs_commit_txn(&conflict, &new_rev, txn, pool));
+  SVN_ERR_ASSERT(SVN_IS_VALID_REVNUM(new_rev));
+
+  return SVN_NO_ERROR;
+}
+
+
+/*** membuffer cache ***/
+
+/* Number of distinct keys per SCALE. */
+#define MEMBUFFER_KEYS 10000
+
+/* Number of cache accesses per thread and SCALE. */
+#define MEMBUFFER_OPS 200000
+
+/* Size of each cached value. */
+#define MEMBUFFER_VALUE_SIZE 100
+
+/* Total size of the cache. */
+#define MEMBUFFER_SIZE (64 * 1024 * 1024)
+
+/* Per-thread state of the membuffer contention benchmark. */
+typedef struct membuffer_worker_t
+{
+  svn_cache__t *cache;
+  apr_pool_t *pool;
+  apr_uint32_t seed;
+  apr_int64_t key_count;
+  apr_int64_t ops;
+  svn_error_t *err;
+} membuffer_worker_t;
+
+/* Run WORKER's share of cache accesses: 1 write for every 4 reads. */
+static svn_error_t *
+membuffer_access(membuffer_worker_t *worker)
+{
+  apr_pool_t *iterpool = svn_pool_create(worker->pool);
+  svn_stringbuf_t *value = make_text(MEMBUFFER_VALUE_SIZE, &worker->seed,
+                                     worker->pool);
+  apr_int64_t i;
+
+  for (i = 0; i < worker->ops; ++i)
+    {
+      apr_uint64_t key = next_random(&worker->seed) % worker->key_count;
+
+      if (i % 256 == 0)
+        svn_pool_clear(iterpool);
+
+      if (i % 5 == 0)
+        {
+          SVN_ERR(svn_cache__set(worker->cache, &key, value, iterpool));
+        }
+      else
+        {
+          void *result;
+          svn_boolean_t found;
+
+          SVN_ERR(svn_cache__get(&result, &found, worker->cache, &key,
+                                 iterpool));
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+/* Implements apr_thread_start_t for membuffer_access(). */
+static void * APR_THREAD_FUNC
+membuffer_thread(apr_thread_t *thread, void *data)
+{
+  membuffer_worker_t *worker = data;
+  worker->err = membuffer_access(worker);
+
+  apr_thread_exit(thread, APR_SUCCESS);
+  return NULL;
+}
+#endif
+
+/* Reads and writes of small entries in a shared membuffer cache, with
+ * OPTS->THREADS threads competing for it. */
+static svn_error_t *
+bench_membuffer(const bench_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  membuffer_worker_t *workers;
+  int thread_count = opts->threads;
+  apr_time_t start;
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+#if !APR_HAS_THREADS
+  thread_count = 1;
+#endif
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, MEMBUFFER_SIZE,
+                                            MEMBUFFER_SIZE / 16, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache, membuffer, NULL, NULL,
+                                            sizeof(apr_uint64_t),
+                                            "bench:", 0, TRUE, FALSE,
+                                            pool, pool));
+
+  workers = apr_pcalloc(pool, thread_count * sizeof(*workers));
+  for (i = 0; i < thread_count; ++i)
+    {
+      workers[i].cache = cache;
+      workers[i].pool
+        = apr_allocator_owner_get(svn_pool_create_allocator(FALSE));
+      workers[i].seed = i;
+      workers[i].key_count = (apr_int64_t)MEMBUFFER_KEYS * opts->scale;
+      workers[i].ops = (apr_int64_t)MEMBUFFER_OPS * opts->scale;
+    }
+
+  start = apr_time_now();
+
+#if APR_HAS_THREADS
+  {
+    apr_thread_t **threads = apr_pcalloc(pool,
+                                         thread_count * sizeof(*threads));
+    int thread_started = 1;
+
+    /* The calling thread runs the first worker. */
+    for (i = 1; i < thread_count; ++i)
+      {
+        apr_status_t status = apr_thread_create(&threads[i], NULL,
+                                                membuffer_thread,
+                                                &workers[i], pool);
+        if (status)
+          {
+            err = svn_error_wrap_apr(status, _("Can't create thread"));
+            break;
+          }
+
+        ++thread_started;
+      }
+
+    workers[0].err = membuffer_access(&workers[0]);
+
+    for (i = 1; i < thread_started; ++i)
+      {
+        apr_status_t retval;
+        apr_thread_join(&retval, threads[i]);
+      }
+  }
+#else
+  workers[0].err = membuffer_access(&workers[0]);
+#endif
+
+  for (i = 0; i < thread_count; ++i)
+    {
+      err = svn_error_compose_create(err, workers[i].err);
+      svn_pool_destroy(workers[i].pool);
+    }
+  SVN_ERR(err);
+
+  return svn_error_trace(print_result(apr_psprintf(pool,
+                                                   "membuffer-%d-threads",
+                                                   thread_count),
+                                      (apr_int64_t)MEMBUFFER_OPS
+                                        * opts->scale * thread_count,
+                                      apr_time_now() - start, pool));
+}
+
+
+/*** l2p / p2l index lookups ***/
+
+/* Number of revisions per SCALE. */
+#define INDEX_REVISIONS 200
+
+/* Number of files added per revision. */
+#define INDEX_FILES_PER_REV 10
+
+/* Number of lookups per SCALE. */
+#define INDEX_LOOKUPS 100000
+
+/* Translate random item numbers into offsets (l2p) and look up the item
+ * at those offsets (p2l).  FSFS only. */
+static svn_error_t *
+bench_index(const bench_opts_t *opts,
+            apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_revnum_t rev;
+  svn_revnum_t rev_count = INDEX_REVISIONS * opts->scale;
+  apr_int64_t lookup_count = (apr_int64_t)INDEX_LOOKUPS * opts->scale;
+  apr_array_header_t *max_ids;
+  svn_fs_fs__revision_file_t **rev_files;
+  svn_revnum_t *revisions;
+  apr_off_t *offsets;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint32_t seed = 0;
+  apr_time_t start;
+  apr_int64_t i;
+
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_FSFS))
+    return SVN_NO_ERROR;
+
+  SVN_ERR(create_fs(&fs, opts, "index", NULL, pool));
+  if (!svn_fs_fs__use_log_addressing(fs))
+    return SVN_NO_ERROR;
+
+  for (rev = 0; rev < rev_count; ++rev)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *root;
+      const char *dir;
+      int k;
+
+      svn_pool_clear(iterpool);
+      dir = apr_psprintf(iterpool, "dir%ld", rev);
+
+      SVN_ERR(svn_fs_begin_txn2(&txn, fs, rev, 0, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_fs_make_dir(root, dir, iterpool));
+      for (k = 0; k < INDEX_FILES_PER_REV; ++k)
+        {
+          const char *path = apr_psprintf(iterpool, "%s/file%d", dir, k);
+          SVN_ERR(svn_fs_make_file(root, path, iterpool));
+          SVN_ERR(set_contents(root, path,
+                               make_text(1000, &seed, iterpool),
+                               iterpool));
+        }
+
+      SVN_ERR(commit_txn(txn, iterpool));
+    }
+
+  /* Revision 0 is always there. */
+  ++rev_count;
+  SVN_ERR(svn_fs_fs__l2p_get_max_ids(&max_ids, fs, 0, rev_count, pool,
+                                     pool));
+  rev_files = apr_pcalloc(pool, rev_count * sizeof(*rev_files));
+  for (rev = 0; rev < rev_count; ++rev)
+    SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_files[rev], fs, rev,
+                                             pool, iterpool));
+
+  revisions = apr_palloc(pool, lookup_count * sizeof(*revisions));
+  offsets = apr_palloc(pool, lookup_count * sizeof(*offsets));
+
+  start = apr_time_now();
+  for (i = 0; i < lookup_count; ++i)
+    {
+      apr_uint64_t max_id;
+      apr_uint64_t item_index;
+
+      if (i % 256 == 0)
+        svn_pool_clear(iterpool);
+
+      /* Item index 0 is never used. */
+      rev = next_random(&seed) % rev_count;
+      max_id = APR_ARRAY_IDX(max_ids, rev, apr_uint64_t);
+      item_index = max_id > 1 ? 1 + next_random(&seed) % (max_id - 1) : 1;
+
+      revisions[i] = rev;
+      SVN_ERR(svn_fs_fs__item_offset(&offsets[i], fs, rev_files[rev], rev,
+                                     NULL, item_index, iterpool));
+    }
+  SVN_ERR(print_result("l2p-lookup", lookup_count, apr_time_now() - start,
+                       pool));
+
+  start = apr_time_now();
+  for (i = 0; i < lookup_count; ++i)
+    {
+      svn_fs_fs__p2l_entry_t *entry;
+
+      if (i % 256 == 0)
+        svn_pool_clear(iterpool);
+
+      rev = revisions[i];
+      if (offsets[i] < 0)
+        continue;
+
+      SVN_ERR(svn_fs_fs__p2l_entry_lookup(&entry, fs, rev_files[rev], rev,
+                                          offsets[i], iterpool, iterpool));
+    }
+  SVN_ERR(print_result("p2l-lookup", lookup_count, apr_time_now() - start,
+                       pool));
+
+  for (rev = 0; rev < rev_count; ++rev)
+    SVN_ERR(svn_fs_fs__close_revision_file(rev_files[rev]));
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+
+/*** Directory entry lookup ***/
+
+/* Number of entries in the wide directory per SCALE. */
+#define WIDE_DIR_ENTRIES 10000
+
+/* Number of lookups per SCALE. */
+#define WIDE_DIR_LOOKUPS 100000
+
+/* Look up random entries of a wide directory. */
+static svn_error_t *
+bench_wide_dir(const bench_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t youngest;
+  int entry_count = WIDE_DIR_ENTRIES * opts->scale;
+  apr_int64_t lookup_count = (apr_int64_t)WIDE_DIR_LOOKUPS * opts->scale;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_uint32_t seed = 0;
+  apr_time_t start;
+  apr_int64_t i;
+
+  SVN_ERR(create_fs(&fs, opts, "wide-dir", NULL, pool));
+
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, 0, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "wide", pool));
+  for (i = 0; i < entry_count; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_make_file(root,
+                               apr_psprintf(iterpool,
+                                            "wide/file%" APR_INT64_T_FMT, i),
+                               iterpool));
+    }
+  SVN_ERR(commit_txn(txn, pool));
+
+  SVN_ERR(svn_fs_youngest_rev(&youngest, fs, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, youngest, pool));
+
+  start = apr_time_now();
+  for (i = 0; i < lookup_count; ++i)
+    {
+      svn_node_kind_t kind;
+      const char *path;
+
+      if (i % 256 == 0)
+        svn_pool_clear(iterpool);
+
+      path = apr_psprintf(iterpool, "wide/file%u",
+                          (unsigned)(next_random(&seed) % entry_count));
+      SVN_ERR(svn_fs_check_path(&kind, root, path, iterpool));
+      SVN_ERR_ASSERT(kind == svn_node_file);
+    }
+
+  svn_pool_destroy(iterpool);
+  return svn_error_trace(print_result("dir-entry-lookup", lookup_count,
+                                      apr_time_now() - start, pool));
+}
+
+
+/*** txdelta / svndiff ***/
+
+/* Size of the delta source and target per SCALE. */
+#define DELTA_TEXT_SIZE (1024 * 1024)
+
+/* Number of encode / decode runs. */
+#define DELTA_RUNS 20
+
+/* Return a modified copy of SOURCE with small changes sprinkled all over
+ * it, allocated in POOL.  Use *SEED for the pseudo-random changes. */
+static svn_stringbuf_t *
+modify_text(const svn_stringbuf_t *source,
+            apr_uint32_t *seed,
+            apr_pool_t *pool)
+{
+  svn_stringbuf_t *target = svn_stringbuf_dup(source, pool);
+  apr_size_t pos;
+
+  for (pos = 0; pos + 64 < target->len; pos += 4096)
+    {
+      svn_stringbuf_t *change = make_text(16, seed, pool);
+      switch (next_random(seed) % 3)
+        {
+          case 0:
+            svn_stringbuf_replace(target, pos, change->len, change->data,
+                                  change->len);
+            break;
+          case 1:
+            svn_stringbuf_insert(target, pos, change->data, change->len);
+            break;
+          default:
+            svn_stringbuf_remove(target, pos, change->len);
+            break;
+        }
+    }
+
+  return target;
+}
+
+/* Compute the delta between two versions of a text (xdelta), encode it
+ * in svndiff format and decode + apply it again. */
+static svn_error_t *
+bench_delta(const bench_opts_t *opts,
+            apr_pool_t *pool)
+{
+  apr_uint32_t seed = 0;
+  svn_stringbuf_t *source = make_text(DELTA_TEXT_SIZE * opts->scale, &seed,
+                                      pool);
+  svn_stringbuf_t *target = modify_text(source, &seed, pool);
+  svn_stringbuf_t *svndiff = svn_stringbuf_create_empty(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  const char *suffix = apr_psprintf(pool, "-%dMB", opts->scale);
+  apr_time_t start;
+  int i;
+
+  /* xdelta only, i.e. create the delta windows. */
+  start = apr_time_now();
+  for (i = 0; i < DELTA_RUNS; ++i)
+    {
+      svn_txdelta_stream_t *delta_stream;
+      svn_txdelta_window_t *window;
+
+      svn_pool_clear(iterpool);
+      svn_txdelta2(&delta_stream,
+                   svn_stream_from_stringbuf(source, iterpool),
+                   svn_stream_from_stringbuf(target, iterpool),
+                   FALSE, iterpool);
+      do
+        {
+          SVN_ERR(svn_txdelta_next_window(&window, delta_stream,
+                                          iterpool));
+        }
+      while (window);
+    }
+  SVN_ERR(print_result(apr_pstrcat(pool, "txdelta-create", suffix,
+                                   SVN_VA_NULL),
+                       DELTA_RUNS, apr_time_now() - start, pool));
+
+  /* xdelta plus svndiff encoding. */
+  start = apr_time_now();
+  for (i = 0; i < DELTA_RUNS; ++i)
+    {
+      svn_txdelta_stream_t *delta_stream;
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+
+      svn_pool_clear(iterpool);
+      svn_stringbuf_setempty(svndiff);
+      svn_txdelta2(&delta_stream,
+                   svn_stream_from_stringbuf(source, iterpool),
+                   svn_stream_from_stringbuf(target, iterpool),
+                   FALSE, iterpool);
+      svn_txdelta_to_svndiff3(&handler, &handler_baton,
+                              svn_stream_from_stringbuf(svndiff, iterpool),
+                              1, SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                              iterpool);
+      SVN_ERR(svn_txdelta_send_txstream(delta_stream, handler,
+                                        handler_baton, iterpool));
+    }
+  SVN_ERR(print_result(apr_pstrcat(pool, "svndiff-encode", suffix,
+                                   SVN_VA_NULL),
+                       DELTA_RUNS, apr_time_now() - start, pool));
+
+  /* svndiff decoding plus delta application. */
+  start = apr_time_now();
+  for (i = 0; i < DELTA_RUNS; ++i)
+    {
+      svn_txdelta_window_handler_t handler;
+      void *handler_baton;
+      svn_stream_t *stream;
+      apr_size_t len = svndiff->len;
+
+      svn_pool_clear(iterpool);
+      svn_txdelta_apply(svn_stream_from_stringbuf(source, iterpool),
+                        svn_stream_empty(iterpool), NULL, NULL, iterpool,
+                        &handler, &handler_baton);
+      stream = svn_txdelta_parse_svndiff(handler, handler_baton, TRUE,
+                                         iterpool);
+      SVN_ERR(svn_stream_write(stream, svndiff->data, &len));
+      SVN_ERR(svn_stream_close(stream));
+    }
+  SVN_ERR(print_result(apr_pstrcat(pool, "svndiff-decode", suffix,
+                                   SVN_VA_NULL),
+                       DELTA_RUNS, apr_time_now() - start, pool));
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+
+/*** Representation reconstruction ***/
+
+/* Number of changes to the file per SCALE. */
+#define CHAIN_LENGTH 200
+
+/* Size of the file. */
+#define CHAIN_FILE_SIZE (64 * 1024)
+
+/* Number of times to read the file. */
+#define CHAIN_READS 100
+
+/* Read the latest version of a file that has been modified many times,
+ * i.e. that is stored at the end of a long delta chain, with all text
+ * caches disabled. */
+static svn_error_t *
+bench_delta_chain(const bench_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_revnum_t rev;
+  svn_revnum_t chain_length = CHAIN_LENGTH * opts->scale;
+  apr_hash_t *config = apr_hash_make(pool);
+  svn_stringbuf_t *contents;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_pool_t *contents_pool = svn_pool_create(pool);
+  apr_pool_t *prev_contents_pool = svn_pool_create(pool);
+  apr_uint32_t seed = 0;
+  apr_time_t start;
+  int i;
+
+  SVN_ERR(create_fs(&fs, opts, "delta-chain", NULL, pool));
+
+  /* Make FSFS deltify linearly against the predecessor instead of using
+   * skip-deltas, giving us a chain as long as the history. */
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_FSFS) == 0)
+    {
+      const char *fs_config
+        = apr_psprintf(pool,
+                       "[" CONFIG_SECTION_DELTIFICATION "]\n"
+                       CONFIG_OPTION_MAX_LINEAR_DELTIFICATION " = %ld\n",
+                       chain_length + 1);
+
+      SVN_ERR(svn_io_write_atomic2(svn_dirent_join(svn_fs_path(fs, pool),
+                                                   PATH_CONFIG, pool),
+                                   fs_config, strlen(fs_config), NULL,
+                                   FALSE, pool));
+      SVN_ERR(svn_fs_open2(&fs, svn_fs_path(fs, pool), NULL, pool, pool));
+    }
+
+  contents = make_text(CHAIN_FILE_SIZE, &seed, prev_contents_pool);
+  for (rev = 0; rev < chain_length; ++rev)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *root;
+      apr_pool_t *swap;
+
+      svn_pool_clear(iterpool);
+
+      /* Keep only the current and the previous contents. */
+      svn_pool_clear(contents_pool);
+      contents = modify_text(contents, &seed, contents_pool);
+      swap = contents_pool;
+      contents_pool = prev_contents_pool;
+      prev_contents_pool = swap;
+
+      SVN_ERR(svn_fs_begin_txn2(&txn, fs, rev, 0, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      if (rev == 0)
+        SVN_ERR(svn_fs_make_file(root, "file", iterpool));
+      SVN_ERR(set_contents(root, "file", contents, iterpool));
+      SVN_ERR(commit_txn(txn, iterpool));
+    }
+
+  /* Re-open the repository without any caches that would allow us to
+   * skip the reconstruction. */
+  svn_hash_sets(config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS, "0");
+  svn_hash_sets(config, SVN_FS_CONFIG_FSFS_CACHE_FULLTEXTS, "0");
+  SVN_ERR(svn_fs_open2(&fs, svn_fs_path(fs, pool), config, pool, pool));
+
+  start = apr_time_now();
+  for (i = 0; i < CHAIN_READS; ++i)
+    {
+      svn_fs_root_t *root;
+      svn_stream_t *stream;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, chain_length, iterpool));
+      SVN_ERR(svn_fs_file_contents(&stream, root, "file", iterpool));
+      SVN_ERR(svn_stream_copy3(stream, svn_stream_empty(iterpool),
+                               NULL, NULL, iterpool));
+    }
+
+  svn_pool_destroy(prev_contents_pool);
+  svn_pool_destroy(contents_pool);
+  svn_pool_destroy(iterpool);
+  return svn_error_trace(print_result(apr_psprintf(pool,
+                                                   "rep-reconstruct-%ld",
+                                                   chain_length),
+                                      CHAIN_READS, apr_time_now() - start,
+                                      pool));
+}
+
+
+/*** Commit ***/
+
+/* Number of files per commit and SCALE. */
+#define COMMIT_FILES 1000
+
+/* Number of files per directory. */
+#define COMMIT_DIR_SIZE 100
+
+/* Number of commits. */
+#define COMMIT_RUNS 5
+
+/* Commit many small files at once. */
+static svn_error_t *
+bench_commit(const bench_opts_t *opts,
+             apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  int file_count = COMMIT_FILES * opts->scale;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_pool_t *filepool = svn_pool_create(pool);
+  apr_uint32_t seed = 0;
+  apr_time_t duration = 0;
+  svn_revnum_t rev;
+
+  SVN_ERR(create_fs(&fs, opts, "commit", NULL, pool));
+
+  for (rev = 0; rev < COMMIT_RUNS; ++rev)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *root;
+      apr_time_t start = apr_time_now();
+      const char *dir;
+      int i;
+
+      svn_pool_clear(iterpool);
+      dir = apr_psprintf(iterpool, "run%ld", rev);
+      SVN_ERR(svn_fs_begin_txn2(&txn, fs, rev, 0, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_fs_make_dir(root, dir, iterpool));
+
+      for (i = 0; i < file_count; ++i)
+        {
+          const char *path;
+
+          svn_pool_clear(filepool);
+          if (i % COMMIT_DIR_SIZE == 0)
+            SVN_ERR(svn_fs_make_dir(root,
+                                    apr_psprintf(filepool, "%s/%d", dir,
+                                                 i / COMMIT_DIR_SIZE),
+                                    filepool));
+
+          path = apr_psprintf(filepool, "%s/%d/file%d", dir,
+                              i / COMMIT_DIR_SIZE, i);
+          SVN_ERR(svn_fs_make_file(root, path, filepool));
+          SVN_ERR(set_contents(root, path,
+                               make_text(next_random(&seed) % 4096, &seed,
+                                         filepool),
+                               filepool));
+        }
+
+      SVN_ERR(commit_txn(txn, iterpool));
+      duration += apr_time_now() - start;
+    }
+
+  svn_pool_destroy(filepool);
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(print_result("commit-files",
+                                      (apr_int64_t)file_count * COMMIT_RUNS,
+                                      duration, pool));
+}
+
+
+/*** Main. ***/
+
+/* All benchmarks. */
+static const struct
+{
+  const char *name;
+  bench_func_t func;
+  const char *description;
+} benchmarks[] =
+{
+  { "membuffer",   bench_membuffer,
+    "membuffer cache get / set with concurrent threads" },
+  { "index",       bench_index,
+    "l2p and p2l index lookups (fsfs only)" },
+  { "wide-dir",    bench_wide_dir,
+    "directory entry lookup in a wide directory" },
+  { "delta",       bench_delta,
+    "txdelta creation, svndiff encoding and decoding" },
+  { "delta-chain", bench_delta_chain,
+    "reading a file at the end of a long delta chain" },
+  { "commit",      bench_commit,
+    "committing many small files" },
+  { NULL }
+};
+
+static const apr_getopt_option_t options[] =
+{
+  {"data-dir", 'd', 1, "create the repositories below ARG"},
+  {"fs-type",  't', 1, "use the backend ARG (default: fsfs)"},
+  {"scale",    's', 1, "multiply all problem sizes by ARG"},
+  {"threads",  'j', 1, "use ARG threads for contention tests (default: 4)"},
+  {"help",     'h', 0, "show this text"},
+  {0,          0,   0, 0}
+};
+
+/* Print the usage text to stdout.  Use POOL for allocations. */
+static svn_error_t *
+usage(apr_pool_t *pool)
+{
+  int i;
+
+  SVN_ERR(svn_cmdline_printf(pool,
+            "usage: fs-fs-benchmark [OPTIONS] [BENCHMARK...]\n"
+            "\n"
+            "Run the given benchmarks, or all of them, and print one line\n"
+            "per result: NAME, OPERATIONS, SECONDS and OPERATIONS/SEC,\n"
+            "separated by tabs.\n"
+            "\n"
+            "Options:\n"));
+  for (i = 0; options[i].name; ++i)
+    SVN_ERR(svn_cmdline_printf(pool, "  -%c, --%-10s %s\n",
+                               options[i].optch, options[i].name,
+                               options[i].description));
+
+  SVN_ERR(svn_cmdline_printf(pool, "\nBenchmarks:\n"));
+  for (i = 0; benchmarks[i].name; ++i)
+    SVN_ERR(svn_cmdline_printf(pool, "  %-12s %s\n", benchmarks[i].name,
+                               benchmarks[i].description));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the integer value of option argument ARG in *VALUE.  It must be
+ * positive. */
+static svn_error_t *
+parse_positive(int *value,
+               const char *arg)
+{
+  SVN_ERR(svn_cstring_atoi(value, arg));
+  if (*value <= 0)
+    return svn_error_createf(SVN_ERR_INCORRECT_PARAMS, NULL,
+                             "'%s' is not a positive number", arg);
+
+  return SVN_NO_ERROR;
+}
+
+/* Parse the command line ARGC / ARGV and run the benchmarks.  Use POOL
+ * for allocations. */
+static svn_error_t *
+sub_main(int *exit_code,
+         int argc,
+         const char *argv[],
+         apr_pool_t *pool)
+{
+  bench_opts_t opts = { 0 };
+  apr_getopt_t *os;
+  apr_array_header_t *selected = apr_array_make(pool, 0,
+                                                sizeof(const char *));
+  apr_pool_t *iterpool;
+  int i;
+
+  opts.fs_type = SVN_FS_TYPE_FSFS;
+  opts.scale = 1;
+  opts.threads = 4;
+
+  SVN_ERR(svn_cmdline__getopt_init(&os, argc, argv, pool));
+  while (1)
+    {
+      const char *opt_arg;
+      int opt_id;
+      apr_status_t status = apr_getopt_long(os, options, &opt_id, &opt_arg);
+
+      if (APR_STATUS_IS_EOF(status))
+        break;
+      if (status)
+        {
+          SVN_ERR(usage(pool));
+          *exit_code = EXIT_FAILURE;
+          return SVN_NO_ERROR;
+        }
+
+      switch (opt_id)
+        {
+          case 'd':
+            SVN_ERR(svn_dirent_get_absolute(&opts.data_dir, opt_arg, pool));
+            break;
+          case 't':
+            opts.fs_type = opt_arg;
+            break;
+          case 's':
+            SVN_ERR(parse_positive(&opts.scale, opt_arg));
+            break;
+          case 'j':
+            SVN_ERR(parse_positive(&opts.threads, opt_arg));
+            break;
+          default:
+            return svn_error_trace(usage(pool));
+        }
+    }
+
+  while (os->ind < os->argc)
+    APR_ARRAY_PUSH(selected, const char *) = os->argv[os->ind++];
+
+  /* Use a directory of our own, so we can safely remove it afterwards. */
+  if (!opts.data_dir)
+    SVN_ERR(svn_io_temp_dir(&opts.data_dir, pool));
+  opts.data_dir = svn_dirent_join(opts.data_dir, "fs-fs-benchmark", pool);
+  SVN_ERR(svn_io_dir_make(opts.data_dir, APR_OS_DEFAULT, pool));
+
+  SVN_ERR(svn_cmdline_printf(pool,
+                             "# fs-type=%s scale=%d threads=%d\n"
+                             "# name\toperations\tseconds\tops/sec\n",
+                             opts.fs_type, opts.scale, opts.threads));
+
+  iterpool = svn_pool_create(pool);
+  for (i = 0; benchmarks[i].name; ++i)
+    {
+      svn_pool_clear(iterpool);
+      if (selected->nelts == 0
+          || svn_cstring_match_list(benchmarks[i].name, selected))
+        SVN_ERR(benchmarks[i].func(&opts, iterpool));
+    }
+  svn_pool_destroy(iterpool);
+
+  return svn_error_trace(svn_io_remove_dir2(opts.data_dir, TRUE, NULL,
+                                            NULL, pool));
+}
+
+int
+main(int argc, const char *argv[])
+{
+  apr_pool_t *pool;
+  int exit_code = EXIT_SUCCESS;
+  svn_error_t *err;
+
+  if (svn_cmdline_init("fs-fs-benchmark", stderr) != EXIT_SUCCESS)
+    return EXIT_FAILURE;
+
+  /* apr_thread_create() allocates the threads' pools from the pool we
+   * pass in and they get destroyed by those threads, so our top-level
+   * pool must be thread-safe. */
+  pool = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+
+  err = sub_main(&exit_code, argc, argv, pool);
+  err = svn_error_compose_create(err, svn_cmdline_fflush(stdout));
+  if (err)
+    {
+      exit_code = EXIT_FAILURE;
+      svn_cmdline_handle_exit_error(err, NULL, "fs-fs-benchmark: ");
+    }
+
+  svn_pool_destroy(pool);
+  return exit_code;
+}
@@ -28,15 +28,22 @@
 #include "../../libsvn_fs/fs-loader.h"
 #include "../../libsvn_fs_fs/fs.h"
 #include "../../libsvn_fs_fs/fs_fs.h"
+#include "../../libsvn_fs_fs/history_index.h"
+#include "../../libsvn_fs_fs/id.h"
+#include "../../libsvn_fs_fs/index.h"
 #include "../../libsvn_fs_fs/low_level.h"
 #include "../../libsvn_fs_fs/pack.h"
+#include "../../libsvn_fs_fs/rep-cache.h"
 #include "../../libsvn_fs_fs/util.h"
 
+#include "svn_cache_config.h"
 #include "svn_hash.h"
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "private/svn_fs_private.h"
 #include "private/svn_string_private.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test_fs.h"
 
@@ -190,7 +197,7 @@ create_packed_filesystem(const char *dir,
   /* Now pack the FS */
   pnb.expected_shard = 0;
   pnb.expected_action = svn_fs_pack_notify_start;
-  return svn_fs_pack(dir, pack_notify, &pnb, NULL, NULL, pool);
+  return svn_fs_pack2(dir, NULL, pack_notify, &pnb, NULL, NULL, pool);
 }
 
 /* Create a packed FSFS filesystem for revprop tests at REPO_NAME with
@@ -225,7 +232,7 @@ prepare_revprop_repo(svn_fs_t **fs,
   svn_pool_destroy(subpool);
 
   /* Pack the repository. */
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -662,7 +669,7 @@ recover_fully_packed(const svn_test_opts_t *opts,
   SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, subpool));
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(after_rev));
   svn_pool_destroy(subpool);
-  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
   SVN_ERR(svn_fs_recover(REPO_NAME, NULL, NULL, pool));
 
   /* Now, delete the youngest revprop file, and recover again.  This
@@ -1001,7 +1008,7 @@ upgrade_txns_to_log_addressing(const svn_test_opts_t *opts,
   /* Pack repo to verify that old and new shard get packed according to
      their respective addressing mode */
 
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   /* verify that our changes got in */
 
@@ -1887,8 +1894,2133 @@ large_delta_against_plain(const svn_test_opts_t *opts,
 
 #undef REPO_NAME
 
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-compression_policy"
+
+/* Set *COUNT to the number of svndiff streams of version VER in the data
+ * of revision REV in FS.  Use POOL for allocations. */
+static svn_error_t *
+count_svndiff_streams(int *count,
+                      svn_fs_t *fs,
+                      svn_revnum_t rev,
+                      char ver,
+                      apr_pool_t *pool)
+{
+  svn_stringbuf_t *rev_contents;
+  const char header[4] = { 'S', 'V', 'N', ver };
+  apr_size_t i;
+
+  SVN_ERR(svn_stringbuf_from_file2(&rev_contents,
+                                   svn_fs_fs__path_rev_absolute(fs, rev, pool),
+                                   pool));
+
+  *count = 0;
+  for (i = 0; i + sizeof(header) <= rev_contents->len; ++i)
+    if (memcmp(rev_contents->data + i, header, sizeof(header)) == 0)
+      ++*count;
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the files of revision REV in the repository at REPO_NAME through
+ * a new FS instance using FS_CONFIG and compare them with the expected
+ * SMALL, LARGE and ARCHIVE contents.  Use POOL for allocations. */
+static svn_error_t *
+verify_compression_policy_files(svn_revnum_t rev,
+                                apr_hash_t *fs_config,
+                                svn_stringbuf_t *small,
+                                svn_stringbuf_t *large,
+                                svn_stringbuf_t *archive,
+                                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_root_t *root;
+  svn_stringbuf_t *contents;
+
+  /* Use a separate namespace to avoid simply reading data from cache. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+
+  SVN_ERR(svn_test__get_file_contents(root, "small", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, small->data);
+  SVN_ERR(svn_test__get_file_contents(root, "large", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, large->data);
+  SVN_ERR(svn_test__get_file_contents(root, "archive.zip", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, archive->data);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+compression_policy(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *small, *large, *archive;
+  apr_hash_t *fs_config;
+  char default_ver;
+  int count;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_DELTIFICATION_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.6 SVN doesn't support fsfs.conf");
+
+  /* Compress small reps with LZ4, if available.  Large reps as well as
+   * zip archives shall be stored uncompressed. */
+  if (   ffd->format >= SVN_FS_FS__MIN_SVNDIFF2_FORMAT
+      && svn__lz4_supported())
+    {
+      ffd->delta_compression_type = compression_type_lz4;
+      default_ver = 2;
+    }
+  else
+    {
+      ffd->delta_compression_type = compression_type_zlib;
+      default_ver = 1;
+    }
+
+  ffd->large_rep_threshold = 10000;
+  ffd->large_rep_compression_type = compression_type_none;
+  ffd->large_rep_compression_level = SVN_DELTA_COMPRESSION_LEVEL_NONE;
+  ffd->uncompressed_mime_types = apr_array_make(pool, 1,
+                                                sizeof(const char *));
+  APR_ARRAY_PUSH(ffd->uncompressed_mime_types, const char *)
+    = "application/*zip";
+
+  small = svn_stringbuf_create("small", pool);
+  while (small->len < 5000)
+    svn_stringbuf_appendstr(small, small);
+
+  /* Large content spanning multiple txdelta windows. */
+  large = svn_stringbuf_create("large", pool);
+  while (large->len < 2 * 102400)
+    svn_stringbuf_appendstr(large, large);
+  archive = svn_stringbuf_create("zip!", pool);
+  while (archive->len < 5000)
+    svn_stringbuf_appendstr(archive, archive);
+
+  /* Revision 1: add one file for each policy. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "small", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "small", small->data, pool));
+  SVN_ERR(svn_fs_make_file(root, "large", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "large", large->data, pool));
+  SVN_ERR(svn_fs_make_file(root, "archive.zip", pool));
+  SVN_ERR(svn_fs_change_node_prop(root, "archive.zip", SVN_PROP_MIME_TYPE,
+                                  svn_string_create("application/zip", pool),
+                                  pool));
+  SVN_ERR(svn_test__set_file_contents(root, "archive.zip", archive->data,
+                                      pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* The large file and the zip archive must have been stored as svndiff0.
+   * The small file and the directory use the default compression. */
+  SVN_ERR(count_svndiff_streams(&count, fs, rev, 0, pool));
+  SVN_TEST_INT_ASSERT(count, 2);
+  SVN_ERR(count_svndiff_streams(&count, fs, rev, default_ver, pool));
+  SVN_TEST_ASSERT(count >= 2);
+
+  /* Read the data back from disk, once with block-read enabled. */
+  fs_config = apr_hash_make(pool);
+  SVN_ERR(verify_compression_policy_files(rev, fs_config, small, large,
+                                          archive, pool));
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_BLOCK_READ, "1");
+  SVN_ERR(verify_compression_policy_files(rev, fs_config, small, large,
+                                          archive, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-combined_chunk_cache"
+#define MAX_REV 10
+
+/* Return the contents of "f" in revision REV: a few hundred kB that
+   change a little in every revision.  Allocate the result in POOL. */
+static svn_stringbuf_t *
+get_chunked_contents(svn_revnum_t rev,
+                     apr_pool_t *pool)
+{
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(pool);
+  int i;
+
+  for (i = 0; i < 20000; ++i)
+    svn_stringbuf_appendcstr(contents,
+                             apr_psprintf(pool, "line %5d, rev %3ld\n", i,
+                                          i % 1000 == 0 ? rev : 0l));
+
+  return contents;
+}
+
+/* Read the first LEN bytes of "f" in revision REV under ROOT and compare
+ * them with the expected contents.  LEN may exceed the file size.
+ * Use POOL for allocations. */
+static svn_error_t *
+verify_chunked_contents(svn_fs_root_t *root,
+                        svn_revnum_t rev,
+                        apr_size_t len,
+                        apr_pool_t *pool)
+{
+  svn_stringbuf_t *expected = get_chunked_contents(rev, pool);
+  svn_stringbuf_t *actual = svn_stringbuf_create_ensure(len, pool);
+  svn_stream_t *stream;
+
+  SVN_ERR(svn_fs_file_contents(&stream, root, "f", pool));
+  SVN_ERR(svn_stream_read_full(stream, actual->data, &len));
+  SVN_ERR(svn_stream_close(stream));
+
+  SVN_TEST_ASSERT(len <= expected->len);
+  SVN_TEST_ASSERT(memcmp(actual->data, expected->data, len) == 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read "f" in all revisions under FS, either the first 1000 bytes or, if
+ * FULL is set, completely.  Compare them with the expected contents.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+verify_chunked_revisions(svn_fs_t *fs,
+                         svn_boolean_t full,
+                         apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t rev;
+
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_fs_root_t *root;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+      SVN_ERR(verify_chunked_contents(root, rev, full ? 1000000 : 1000,
+                                      iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+combined_chunk_cache(const svn_test_opts_t *opts,
+                     apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config;
+  svn_cache__info_t info;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Build a delta chain for a file that spans multiple windows. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "f", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_revnum_t new_rev;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, "f",
+                                          get_chunked_contents(rev,
+                                                               iterpool)->data,
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &new_rev, txn, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  /* Read the contents through a fresh cache namespace.  Disable the
+   * fulltext cache such that everything gets reconstructed from deltas. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_DELTAS, "1");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_FULLTEXTS, "0");
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  ffd = fs->fsap_data;
+  if (ffd->combined_chunk_cache == NULL)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "delta caching not available");
+
+  /* Read only the start of each revision first.  Reading them in full
+   * will then find the first chunk in cache and continue from there. */
+  SVN_ERR(verify_chunked_revisions(fs, FALSE, pool));
+  SVN_ERR(svn_cache__get_info(ffd->combined_chunk_cache, &info, TRUE,
+                              pool));
+  SVN_ERR(verify_chunked_revisions(fs, TRUE, pool));
+  SVN_ERR(svn_cache__get_info(ffd->combined_chunk_cache, &info, TRUE,
+                              pool));
+  SVN_TEST_ASSERT(info.hits > 0);
+  SVN_TEST_ASSERT(info.sets > 0);
+
+  /* Now, all non-trivial combinations are in cache. */
+  SVN_ERR(verify_chunked_revisions(fs, TRUE, pool));
+  SVN_ERR(svn_cache__get_info(ffd->combined_chunk_cache, &info, TRUE,
+                              pool));
+  SVN_TEST_ASSERT(info.hits > 0);
+  SVN_TEST_ASSERT(info.sets == 0);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-similarity_deltification"
+
+/* Return SIZE bytes of pseudo-random data generated from SEED.
+ * The data contains no NUL bytes, so it can be used as a C string.
+ * Allocate the result in POOL. */
+static svn_stringbuf_t *
+random_contents(apr_uint32_t seed,
+                apr_size_t size,
+                apr_pool_t *pool)
+{
+  svn_stringbuf_t *result = svn_stringbuf_create_ensure(size, pool);
+  while (result->len < size)
+    svn_stringbuf_appendbyte(result,
+                             (char)((svn_test_rand(&seed) >> 16) % 255 + 1));
+
+  return result;
+}
+
+static svn_error_t *
+similarity_deltification(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *original, *similar, *unrelated, *contents;
+  svn_stringbuf_t *rev_contents;
+  apr_hash_t *fs_config;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (!ffd->rep_sharing_allowed)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "rep-sharing not supported");
+
+  /* Only file contents shall be deltified, such that the rep headers
+   * tell us which files have been deltified against what. */
+  ffd->similarity_deltification = TRUE;
+  ffd->deltify_directories = FALSE;
+  ffd->deltify_properties = FALSE;
+
+  /* Incompressible contents, such that only deltification saves space.
+   * SIMILAR has a different header and footer but is otherwise the same
+   * as ORIGINAL, like a patched vendor drop. */
+  original = random_contents(1, 200000, pool);
+  similar = svn_stringbuf_create("A new header.\n", pool);
+  svn_stringbuf_appendbytes(similar, original->data + 100,
+                            original->len - 100);
+  svn_stringbuf_appendcstr(similar, "A new footer.\n");
+  unrelated = random_contents(2, 200000, pool);
+
+  /* Revision 1: add the original file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "original", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "original", original->data,
+                                      pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: add a similar and an unrelated new file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "similar", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "similar", similar->data, pool));
+  SVN_ERR(svn_fs_make_file(root, "unrelated", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "unrelated", unrelated->data,
+                                      pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Only the similar file has been deltified against r1, and its delta
+   * is small.  The unrelated one has been stored as fulltext. */
+  SVN_ERR(svn_stringbuf_from_file2(&rev_contents,
+                                   svn_fs_fs__path_rev_absolute(fs, rev,
+                                                                pool),
+                                   pool));
+  SVN_TEST_ASSERT(stringbuf_find(rev_contents, "DELTA 1 ") != APR_SIZE_MAX);
+  SVN_TEST_ASSERT(rev_contents->len < unrelated->len + original->len / 10);
+
+  /* Read the contents back through a fresh cache namespace. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+
+  SVN_ERR(svn_test__get_file_contents(root, "similar", &contents, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(contents, similar));
+  SVN_ERR(svn_test__get_file_contents(root, "unrelated", &contents, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(contents, unrelated));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-chunked_reps"
+
+static svn_error_t *
+chunked_reps(const svn_test_opts_t *opts,
+             apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *original, *modified, *contents;
+  svn_stringbuf_t *rev_contents;
+  apr_hash_t *fs_config;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_CHUNKED_REP_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "chunked reps not supported");
+  if (!ffd->rep_sharing_allowed)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "rep-sharing not supported");
+
+  ffd->chunked_rep_threshold = 0x100000;
+
+  /* Incompressible contents spanning several chunks.  MODIFIED has a
+   * few bytes inserted near the start, which shifts all later data. */
+  original = random_contents(3, 8 * 0x100000, pool);
+  modified = svn_stringbuf_create("A new header.\n", pool);
+  svn_stringbuf_appendstr(modified, original);
+
+  /* Revision 1: add the original file. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "file", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "file", original->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Revision 2: modify it without using r1 as delta base. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_delete(root, "file", pool));
+  SVN_ERR(svn_fs_make_file(root, "file", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "file", modified->data, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Only the chunk containing the insertion has been stored anew.  All
+   * others are shared with r1. */
+  SVN_ERR(svn_stringbuf_from_file2(&rev_contents,
+                                   svn_fs_fs__path_rev_absolute(fs, rev,
+                                                                pool),
+                                   pool));
+  SVN_TEST_ASSERT(stringbuf_find(rev_contents, "CHUNKED\n") != APR_SIZE_MAX);
+  SVN_TEST_ASSERT(rev_contents->len < modified->len / 4 * 3);
+
+  /* Read the contents back through a fresh cache namespace. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                           svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev - 1, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "file", &contents, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(contents, original));
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "file", &contents, pool));
+  SVN_TEST_ASSERT(svn_stringbuf_compare(contents, modified));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-pack-jobs"
+#define SHARD_SIZE 4
+#define MAX_REV 38
+
+static svn_error_t *
+pack_with_jobs(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  struct pack_notify_baton pnb;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t i;
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+
+  /* Pack more shards than we run jobs concurrently.  Progress must still
+     be reported for one shard after the other. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_PACK_JOBS, "3");
+  pnb.expected_shard = 0;
+  pnb.expected_action = svn_fs_pack_notify_start;
+  SVN_ERR(svn_fs_pack2(REPO_NAME, fs_config, pack_notify, &pnb, NULL, NULL,
+                       pool));
+  SVN_TEST_ASSERT(pnb.expected_shard == (MAX_REV + 1) / SHARD_SIZE);
+
+  /* All completed shards must have been packed. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, pool));
+  SVN_TEST_ASSERT(((fs_fs_data_t *)fs->fsap_data)->min_unpacked_rev
+                  == (MAX_REV + 1) / SHARD_SIZE * SHARD_SIZE);
+
+  /* And their contents must have survived. */
+  for (i = 2; i <= MAX_REV; i++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stream_t *stream;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, iterpool));
+      SVN_ERR(svn_fs_file_contents(&stream, rev_root, "iota", iterpool));
+      SVN_ERR(svn_test__stream_to_string(&contents, stream, iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data, get_rev_contents(i, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-background-pack"
+#define SHARD_SIZE 4
+
+static svn_error_t *
+background_pack(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  const char *conflict;
+  svn_revnum_t after_rev;
+  int i;
+
+  /* Leave the first shard one revision short of being complete. */
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, SHARD_SIZE - 2,
+                                       SHARD_SIZE, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  ffd->background_pack = TRUE;
+
+  /* Completing the shard must trigger a background pack. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, SHARD_SIZE - 2, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      get_rev_contents(SHARD_SIZE - 1, pool),
+                                      pool));
+  SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, pool));
+  SVN_TEST_ASSERT(after_rev == SHARD_SIZE - 1);
+
+  /* Give the packer plenty of time to finish. */
+  for (i = 0; i < 300; ++i)
+    {
+      if (svn_atomic_read(&ffd->shared->background_pack_pending) == 0)
+        break;
+
+      apr_sleep(100000);
+    }
+
+  SVN_TEST_ASSERT(svn_atomic_read(&ffd->shared->background_pack_pending)
+                  == 0);
+  SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, pool));
+  SVN_TEST_ASSERT(ffd->min_unpacked_rev == SHARD_SIZE);
+
+  /* To be sure: Verify that we didn't break the repo. */
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SHARD_SIZE - 1, NULL, NULL,
+                        NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "background packing requires thread support");
+#endif
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-memory-mapped-reads"
+#define SHARD_SIZE 5
+#define MAX_REV 11
+
+static svn_error_t *
+memory_mapped_reads(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_revnum_t i;
+
+  /* Cover packed as well as non-packed revisions. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  ffd->memory_map = TRUE;
+
+  for (i = 1; i <= MAX_REV; i++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stream_t *rstream;
+      svn_stringbuf_t *rstring;
+      const char *expected;
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, i, pool));
+      SVN_ERR(svn_fs_file_contents(&rstream, rev_root, "iota", pool));
+      SVN_ERR(svn_test__stream_to_string(&rstring, rstream, pool));
+
+      expected = i == 1 ? "This is the file 'iota'.\n"
+                        : get_rev_contents(i, pool);
+      SVN_TEST_STRING_ASSERT(rstring->data, expected);
+    }
+
+  /* Indexes and footers must have been read correctly from memory. */
+  if (ffd->format >= SVN_FS_FS__MIN_LOG_ADDRESSING_FORMAT)
+    {
+      svn_fs_fs__revision_file_t *rev_file;
+      apr_off_t offset;
+
+      SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, 1, pool,
+                                               pool));
+#if APR_HAS_MMAP
+      SVN_TEST_ASSERT(rev_file->mapped_data != NULL);
+#endif
+      SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
+      SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, 1, NULL,
+                                     SVN_FS_FS__ITEM_INDEX_ROOT_NODE,
+                                     pool));
+      SVN_TEST_ASSERT(offset > 0 && offset < rev_file->l2p_offset);
+      SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-cached-file-handles"
+#define SHARD_SIZE 4
+#define MAX_REV 5
+
+static svn_error_t *
+cached_file_handles(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_fs__revision_file_t *rev_file;
+  apr_file_t *apr_file;
+  svn_boolean_t log_addressing;
+
+  if (svn_cache_config_get()->file_handle_count == 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "file handle cache has been disabled");
+
+  SVN_ERR(create_non_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                       pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  log_addressing = svn_fs_fs__use_log_addressing(fs);
+
+  /* Closing a file shall keep it open for the next user. */
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, 1, pool, pool));
+  if (log_addressing)
+    SVN_ERR(svn_fs_fs__auto_read_footer(rev_file));
+  apr_file = rev_file->file;
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, 1, pool, pool));
+  SVN_TEST_ASSERT(rev_file->file == apr_file);
+  if (log_addressing)
+    SVN_TEST_ASSERT(rev_file->l2p_offset != -1);
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  /* Packing must not leave handles to the old shard behind. */
+  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_fs__update_min_unpacked_rev(fs, pool));
+
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, 1, pool, pool));
+  SVN_TEST_ASSERT(rev_file->is_packed);
+  SVN_TEST_ASSERT(rev_file->l2p_offset == -1);
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  /* Handles returned upon pool cleanup must be usable as well. */
+  {
+    apr_pool_t *subpool = svn_pool_create(pool);
+    SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, 1, subpool,
+                                             subpool));
+    svn_pool_destroy(subpool);
+  }
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, MAX_REV, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+
+#define REPO_NAME "test-repo-indexed-directories"
+#define DIR_SIZE (SVN_FS_FS__DIR_INDEX_MIN_ENTRIES + 100)
+
+static svn_error_t *
+indexed_directories(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *rev_contents;
+  const char *index;
+  apr_hash_t *fs_config;
+  apr_hash_t *entries;
+  svn_node_kind_t kind;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_DIR_INDEX_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "directory indexes not supported");
+
+  /* Deltified directories don't get an index. */
+  ffd->deltify_directories = FALSE;
+
+  /* Revision 1: a small directory and a huge one. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "small", pool));
+  SVN_ERR(svn_fs_make_file(root, "small/file", pool));
+  SVN_ERR(svn_fs_make_dir(root, "assets", pool));
+  for (i = 0; i < DIR_SIZE; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_make_file(root, apr_psprintf(iterpool, "assets/f%05d",
+                                                  i * 2),
+                               iterpool));
+    }
+  SVN_ERR(svn_fs_make_dir(root, "assets/dir", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Only the huge directory got an index. */
+  SVN_ERR(svn_stringbuf_from_file2(&rev_contents,
+                                   svn_fs_fs__path_rev_absolute(fs, rev,
+                                                                pool),
+                                   pool));
+  index = strstr(rev_contents->data, SVN_FS_FS__DIR_INDEX_PREFIX);
+  SVN_TEST_ASSERT(index);
+  SVN_TEST_ASSERT(!strstr(index + 1, SVN_FS_FS__DIR_INDEX_PREFIX));
+
+  /* Use fresh caches such that lookups have to go to the index. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS,
+                svn_uuid_generate(pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+
+  for (i = 0; i < 2 * DIR_SIZE; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_check_path(&kind, root,
+                                apr_psprintf(iterpool, "assets/f%05d", i),
+                                iterpool));
+      SVN_TEST_ASSERT(kind == (i % 2 ? svn_node_none : svn_node_file));
+    }
+
+  SVN_ERR(svn_fs_check_path(&kind, root, "assets/dir", pool));
+  SVN_TEST_ASSERT(kind == svn_node_dir);
+  SVN_ERR(svn_fs_check_path(&kind, root, "assets/a", pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(svn_fs_check_path(&kind, root, "assets/z", pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  SVN_ERR(svn_fs_check_path(&kind, root, "small/file", pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  /* Reading the whole directory must skip the index. */
+  SVN_ERR(svn_fs_dir_entries(&entries, root, "assets", pool));
+  SVN_TEST_ASSERT(apr_hash_count(entries) == DIR_SIZE + 1);
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, rev, NULL, NULL, NULL, NULL,
+                        pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef DIR_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-dir-change-log"
+#define DIR_SIZE 2000
+
+static svn_error_t *
+dir_change_log(const svn_test_opts_t *opts,
+               apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  const svn_fs_id_t *id;
+  apr_hash_t *entries;
+  svn_node_kind_t kind;
+  apr_finfo_t finfo;
+  apr_off_t full_size;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_DIR_CHANGE_LOG_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "directory change logs not supported");
+
+  ffd->deltify_directories = TRUE;
+
+  /* Revision 1: a wide directory. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_dir(root, "wide", pool));
+  for (i = 0; i < DIR_SIZE; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_make_file(root, apr_psprintf(iterpool, "wide/f%05d", i),
+                               iterpool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  SVN_ERR(svn_io_stat(&finfo, svn_fs_fs__path_rev_absolute(fs, rev, pool),
+                      APR_FINFO_SIZE, pool));
+  full_size = finfo.size;
+
+  /* Revision 2: change a single entry. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_delete(root, "wide/f00010", pool));
+  SVN_ERR(svn_fs_make_file(root, "wide/new", pool));
+
+  /* The txn only records the change against the committed contents. */
+  SVN_ERR(svn_fs_node_id(&id, root, "wide", pool));
+  SVN_ERR(svn_io_stat(&finfo, svn_fs_fs__path_txn_node_children(fs, id,
+                                                                  pool),
+                      APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT(finfo.size < 1000);
+
+  SVN_ERR(svn_fs_dir_entries(&entries, root, "wide", pool));
+  SVN_TEST_ASSERT(apr_hash_count(entries) == DIR_SIZE);
+  SVN_TEST_ASSERT(svn_hash_gets(entries, "new"));
+  SVN_TEST_ASSERT(!svn_hash_gets(entries, "f00010"));
+  SVN_ERR(svn_fs_check_path(&kind, root, "wide/f00011", pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* The new directory rep is a small delta. */
+  SVN_ERR(svn_io_stat(&finfo, svn_fs_fs__path_rev_absolute(fs, rev, pool),
+                      APR_FINFO_SIZE, pool));
+  SVN_TEST_ASSERT(finfo.size < full_size / 4);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_fs_dir_entries(&entries, root, "wide", pool));
+  SVN_TEST_ASSERT(apr_hash_count(entries) == DIR_SIZE);
+  SVN_TEST_ASSERT(svn_hash_gets(entries, "new"));
+  SVN_TEST_ASSERT(!svn_hash_gets(entries, "f00010"));
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, rev, NULL, NULL, NULL, NULL,
+                        pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef DIR_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-commit-rollback"
+
+static svn_error_t *
+commit_rollback(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_fs_access_t *access;
+  svn_lock_t *lock;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Revision 1: the greek tree. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(root, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Someone else locks iota. */
+  SVN_ERR(svn_fs_create_access(&access, "alice", pool));
+  SVN_ERR(svn_fs_set_access(fs, access));
+  SVN_ERR(svn_fs_lock(&lock, fs, "/iota", NULL, "", 0, 0,
+                      SVN_INVALID_REVNUM, FALSE, pool));
+
+  /* Our commit gets finalized but fails the lock check. */
+  SVN_ERR(svn_fs_create_access(&access, "bob", pool));
+  SVN_ERR(svn_fs_set_access(fs, access));
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, 1, SVN_FS_TXN_CHECK_LOCKS, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "iota", "new iota\n", pool));
+  SVN_TEST_ASSERT_ANY_ERROR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(!SVN_IS_VALID_REVNUM(rev));
+
+  /* The txn must have been left intact and be committable now. */
+  SVN_ERR(svn_fs_unlock(fs, "/iota", NULL, TRUE, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "A/mu", "new mu\n", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 2);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "iota", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "new iota\n");
+  SVN_ERR(svn_test__get_file_contents(root, "A/mu", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "new mu\n");
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, rev, NULL, NULL, NULL, NULL,
+                        pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-async-rep-cache"
+#define FILE_COUNT 50
+
+static svn_error_t *
+async_rep_cache(const svn_test_opts_t *opts,
+                apr_pool_t *pool)
+{
+#if APR_HAS_THREADS
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (!ffd->rep_sharing_allowed)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "rep-sharing not supported");
+
+  ffd->async_rep_cache_updates = TRUE;
+
+  /* Revision 1: a number of files with distinct contents. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  for (i = 0; i < FILE_COUNT; ++i)
+    {
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_psprintf(iterpool, "f%d", i);
+      SVN_ERR(svn_fs_make_file(root, path, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, path,
+                                          apr_psprintf(iterpool,
+                                                       "contents %d\n", i),
+                                          iterpool));
+    }
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  /* Give the writer plenty of time to finish. */
+  for (i = 0; i < 300; ++i)
+    {
+      if (svn_atomic_read(&ffd->shared->rep_cache_updates_pending) == 0)
+        break;
+
+      apr_sleep(100000);
+    }
+
+  SVN_TEST_ASSERT(svn_atomic_read(&ffd->shared->rep_cache_updates_pending)
+                  == 0);
+
+  /* All file reps must have made it into the rep-cache. */
+  SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+  for (i = 0; i < FILE_COUNT; ++i)
+    {
+      const char *contents;
+      svn_checksum_t *checksum;
+      representation_t *rep;
+
+      svn_pool_clear(iterpool);
+      contents = apr_psprintf(iterpool, "contents %d\n", i);
+      SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, contents,
+                           strlen(contents), iterpool));
+      SVN_ERR(svn_fs_fs__get_rep_reference(&rep, fs, checksum, iterpool));
+      SVN_TEST_ASSERT(rep && rep->revision == rev);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+#else
+  return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                          "asynchronous rep-cache updates require thread "
+                          "support");
+#endif
+}
+
+#undef REPO_NAME
+#undef FILE_COUNT
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-rep-cache-filter"
+#define FILE_COUNT 20
+
+static svn_error_t *
+rep_cache_filter(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_checksum_t *checksum;
+  representation_t *rep;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  if (!ffd->rep_sharing_allowed)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "rep-sharing not supported");
+
+  ffd->rep_cache_filter = TRUE;
+
+  /* Revisions 1 .. FILE_COUNT: one new file each. */
+  for (rev = 0; rev < FILE_COUNT; )
+    {
+      const char *path;
+
+      svn_pool_clear(iterpool);
+      path = apr_psprintf(iterpool, "f%ld", rev);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+      SVN_ERR(svn_fs_make_file(root, path, iterpool));
+      SVN_ERR(svn_test__set_file_contents(root, path,
+                                          apr_psprintf(iterpool,
+                                                       "contents %ld\n",
+                                                       rev),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  /* Every committed rep must be found through the filter ... */
+  SVN_ERR(svn_fs_fs__open_rep_cache(fs, pool));
+  for (i = 0; i < FILE_COUNT; ++i)
+    {
+      const char *contents;
+
+      svn_pool_clear(iterpool);
+      contents = apr_psprintf(iterpool, "contents %d\n", i);
+      SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, contents,
+                           strlen(contents), iterpool));
+      SVN_ERR(svn_fs_fs__get_rep_reference(&rep, fs, checksum, iterpool));
+      SVN_TEST_ASSERT(rep && rep->revision == i + 1);
+    }
+
+  /* ... while unknown ones are still not found. */
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, "unknown", 7, pool));
+  SVN_ERR(svn_fs_fs__get_rep_reference(&rep, fs, checksum, pool));
+  SVN_TEST_ASSERT(rep == NULL);
+  SVN_TEST_ASSERT(ffd->shared->rep_cache_filter);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef FILE_COUNT
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-group-commit"
+
+static svn_error_t *
+group_commit(const svn_test_opts_t *opts,
+             apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn, *txn2, *txn3;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  const char *conflict;
+  svn_stringbuf_t *contents;
+  svn_error_t *err;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  ffd->group_commit = TRUE;
+
+  /* r1: two files. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "a", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "a", "a1\n", pool));
+  SVN_ERR(svn_fs_make_file(root, "b", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "b", "b1\n", pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 1);
+
+  /* Three txns based on r1.  The first two don't conflict. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "a", "a2\n", pool));
+  SVN_ERR(svn_fs_begin_txn(&txn2, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn2, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "b", "b2\n", pool));
+  SVN_ERR(svn_fs_begin_txn(&txn3, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn3, pool));
+  SVN_ERR(svn_test__set_file_contents(root, "a", "a3\n", pool));
+
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == 2);
+
+  /* Out of date but mergeable. */
+  SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn2, pool));
+  SVN_TEST_ASSERT(rev == 3);
+
+  /* Conflicting. */
+  err = svn_fs_commit_txn(&conflict, &rev, txn3, pool);
+  SVN_TEST_ASSERT_ERROR(err, SVN_ERR_FS_CONFLICT);
+  SVN_TEST_ASSERT(!SVN_IS_VALID_REVNUM(rev));
+  SVN_TEST_STRING_ASSERT(conflict, "/a");
+  SVN_ERR(svn_fs_abort_txn(txn3, pool));
+
+  /* r3 has got both changes. */
+  SVN_ERR(svn_fs_revision_root(&root, fs, 3, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "a", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "a2\n");
+  SVN_ERR(svn_test__get_file_contents(root, "b", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, "b2\n");
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-indexed-revprop-packs"
+#define SHARD_SIZE 4
+#define MAX_REV 10
+
+static svn_error_t *
+indexed_revprop_packs(const svn_test_opts_t *opts,
+                      apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_string_t *prop_value;
+  svn_stringbuf_t *pack_contents;
+  const char *manifest_path, *pack_path;
+  svn_stringbuf_t *manifest;
+  svn_revnum_t rev;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(prepare_revprop_repo(&fs, REPO_NAME, MAX_REV, SHARD_SIZE, opts,
+                               pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_INDEXED_REVPROP_PACK_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "indexed revprop packs not supported");
+
+  /* Revisions 4 .. 7 have been packed into a single, indexed pack. */
+  manifest_path = svn_dirent_join_many(pool, REPO_NAME, PATH_REVPROPS_DIR,
+                                       "1" PATH_EXT_PACKED_SHARD,
+                                       PATH_MANIFEST, SVN_VA_NULL);
+  pack_path = svn_dirent_join_many(pool, REPO_NAME, PATH_REVPROPS_DIR,
+                                   "1" PATH_EXT_PACKED_SHARD, "4.0",
+                                   SVN_VA_NULL);
+  SVN_ERR(svn_stringbuf_from_file2(&manifest, manifest_path, pool));
+  SVN_TEST_STRING_ASSERT(manifest->data, "4.0\n4.0\n4.0\n4.0\n");
+
+  SVN_ERR(svn_stringbuf_from_file2(&pack_contents, pack_path, pool));
+  SVN_TEST_ASSERT(!strncmp(pack_contents->data, "indexed revprops 1\n",
+                           strlen("indexed revprops 1\n")));
+
+  /* Replace revprops in the middle of the pack. */
+  SVN_ERR(svn_fs_change_rev_prop(fs, 5, SVN_PROP_REVISION_LOG,
+                                 default_log(5, pool), pool));
+  SVN_ERR(svn_fs_change_rev_prop(fs, 6, SVN_PROP_REVISION_LOG,
+                                 large_log(6, 1000, pool), pool));
+
+  /* Reading from a fresh FS instance must see all changes and leave the
+   * other revprops untouched. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = 4; rev < 8; ++rev)
+    {
+      SVN_ERR(svn_fs_revision_prop(&prop_value, fs, rev,
+                                   SVN_PROP_REVISION_LOG, pool));
+      if (rev == 5)
+        SVN_TEST_STRING_ASSERT(prop_value->data,
+                               default_log(rev, pool)->data);
+      else if (rev == 6)
+        SVN_TEST_STRING_ASSERT(prop_value->data,
+                               large_log(rev, 1000, pool)->data);
+      else
+        SVN_TEST_ASSERT(prop_value == NULL);
+    }
+
+  SVN_ERR(svn_fs_revision_prop(&prop_value, fs, 7,
+                               SVN_PROP_REVISION_DATE, pool));
+  SVN_TEST_ASSERT(prop_value != NULL);
+
+  /* The modified pack is still indexed. */
+  SVN_ERR(svn_stringbuf_from_file2(&pack_contents, pack_path, pool));
+  SVN_TEST_ASSERT(!strncmp(pack_contents->data, "indexed revprops 1\n",
+                           strlen("indexed revprops 1\n")));
+
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+/* Baton for hotcopy_notify(). */
+struct hotcopy_notify_baton
+{
+  /* The next revision that must be reported. */
+  svn_revnum_t expected_rev;
+
+  /* Set if notifications arrived out of order. */
+  svn_boolean_t out_of_order;
+};
+
+/* Implements svn_fs_hotcopy_notify_t, checking that revision ranges get
+   reported in ascending order and without gaps. */
+static void
+hotcopy_notify(void *baton,
+               svn_revnum_t start_revision,
+               svn_revnum_t end_revision,
+               apr_pool_t *scratch_pool)
+{
+  struct hotcopy_notify_baton *hnb = baton;
+
+  if (start_revision != hnb->expected_rev || end_revision < start_revision)
+    hnb->out_of_order = TRUE;
+
+  hnb->expected_rev = end_revision + 1;
+}
+
+/* Verify that r2 .. YOUNGEST of the filesystem at PATH contain the
+   expected "iota" contents.  Use POOL for allocations. */
+static svn_error_t *
+check_iota_contents(const char *path,
+                    svn_revnum_t youngest,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_revnum_t rev;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_fs_open2(&fs, path, NULL, pool, pool));
+  SVN_ERR(svn_fs_youngest_rev(&rev, fs, pool));
+  SVN_TEST_ASSERT(rev == youngest);
+
+  for (rev = 2; rev <= youngest; rev++)
+    {
+      svn_fs_root_t *rev_root;
+      svn_stream_t *stream;
+      svn_stringbuf_t *contents;
+
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_revision_root(&rev_root, fs, rev, iterpool));
+      SVN_ERR(svn_fs_file_contents(&stream, rev_root, "iota", iterpool));
+      SVN_ERR(svn_test__stream_to_string(&contents, stream, iterpool));
+      SVN_TEST_STRING_ASSERT(contents->data, get_rev_contents(rev, iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-hotcopy-jobs"
+#define COPY_NAME "test-repo-hotcopy-jobs-copy"
+#define SHARD_SIZE 4
+#define MAX_REV 21
+#define MORE_REVS 9
+
+static svn_error_t *
+hotcopy_with_jobs(const svn_test_opts_t *opts,
+                  apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  const char *conflict;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  struct hotcopy_notify_baton hnb;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  /* r0 .. r19 are packed, the remainder is not. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_io_remove_dir2(COPY_NAME, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(COPY_NAME);
+
+  /* Copy more shards than we run jobs concurrently.  Progress must still
+     be reported for one range after the other. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_HOTCOPY_JOBS, "3");
+  hnb.expected_rev = 0;
+  hnb.out_of_order = FALSE;
+  SVN_ERR(svn_fs_hotcopy4(REPO_NAME, COPY_NAME, FALSE, FALSE, fs_config,
+                          hotcopy_notify, &hnb, NULL, NULL, pool));
+  SVN_TEST_ASSERT(!hnb.out_of_order);
+  SVN_TEST_ASSERT(hnb.expected_rev == MAX_REV + 1);
+  SVN_ERR(check_iota_contents(COPY_NAME, MAX_REV, pool));
+
+  /* Add a few revisions and pack them, then update the copy
+     incrementally.  Only the new data must be reported. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = MAX_REV; rev < MAX_REV + MORE_REVS; )
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          get_rev_contents(rev + 1,
+                                                           iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, iterpool));
+      SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+    }
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
+
+  hnb.expected_rev = MAX_REV + 1 - (MAX_REV + 1) % SHARD_SIZE;
+  hnb.out_of_order = FALSE;
+  SVN_ERR(svn_fs_hotcopy4(REPO_NAME, COPY_NAME, FALSE, TRUE, fs_config,
+                          hotcopy_notify, &hnb, NULL, NULL, pool));
+  SVN_TEST_ASSERT(!hnb.out_of_order);
+  SVN_TEST_ASSERT(hnb.expected_rev == MAX_REV + MORE_REVS + 1);
+  SVN_ERR(check_iota_contents(COPY_NAME, MAX_REV + MORE_REVS, pool));
+
+  SVN_ERR(svn_fs_verify(COPY_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef COPY_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+#undef MORE_REVS
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-hotcopy-link"
+#define COPY_NAME "test-repo-hotcopy-link-copy"
+#define SHARD_SIZE 4
+#define MAX_REV 21
+#define MORE_REVS 5
+
+static svn_error_t *
+hotcopy_with_links(const svn_test_opts_t *opts,
+                   apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  const char *conflict;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  /* r0 .. r19 are packed, the remainder is not. */
+  SVN_ERR(create_packed_filesystem(REPO_NAME, opts, MAX_REV, SHARD_SIZE,
+                                   pool));
+  SVN_ERR(svn_io_remove_dir2(COPY_NAME, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(COPY_NAME);
+
+  /* Whether or not the links can be created here, the result must be a
+     complete repository. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_HOTCOPY_LINK, "true");
+  SVN_ERR(svn_fs_hotcopy4(REPO_NAME, COPY_NAME, FALSE, FALSE, fs_config,
+                          NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(check_iota_contents(COPY_NAME, MAX_REV, pool));
+
+  /* Writing to the copy must not affect the source. */
+  SVN_ERR(svn_fs_open2(&fs, COPY_NAME, NULL, pool, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, MAX_REV, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "modified\n",
+                                      pool));
+  SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == MAX_REV + 1);
+  SVN_ERR(svn_fs_verify(REPO_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(check_iota_contents(REPO_NAME, MAX_REV, pool));
+
+  /* Start over with a fresh copy.  Shards packed later must get linked
+     by incremental hotcopies. */
+  SVN_ERR(svn_io_remove_dir2(COPY_NAME, TRUE, NULL, NULL, pool));
+  SVN_ERR(svn_fs_hotcopy4(REPO_NAME, COPY_NAME, FALSE, FALSE, fs_config,
+                          NULL, NULL, NULL, NULL, pool));
+
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = MAX_REV; rev < MAX_REV + MORE_REVS; )
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          get_rev_contents(rev + 1,
+                                                           iterpool),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, iterpool));
+      SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(rev));
+    }
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
+
+  SVN_ERR(svn_fs_hotcopy4(REPO_NAME, COPY_NAME, FALSE, TRUE, fs_config,
+                          NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(check_iota_contents(COPY_NAME, MAX_REV + MORE_REVS, pool));
+  SVN_ERR(svn_fs_verify(COPY_NAME, NULL, 0, SVN_INVALID_REVNUM,
+                        NULL, NULL, NULL, NULL, pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef COPY_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+#undef MORE_REVS
+
+/* ------------------------------------------------------------------------ */
+
+/* Commit the current txn TXN in FS and verify that it became revision
+   EXPECTED_REV.  Use POOL for allocations. */
+static svn_error_t *
+commit_expected(svn_fs_txn_t *txn,
+                svn_revnum_t expected_rev,
+                apr_pool_t *pool)
+{
+  svn_revnum_t rev;
+
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+  SVN_TEST_ASSERT(rev == expected_rev);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that svn_fs_revisions_changed() reports exactly the revisions
+   given in the -1 terminated list EXPECTED, youngest first, for PATH in
+   FS between START and END with the given LIMIT.  Use POOL for
+   allocations. */
+static svn_error_t *
+check_revisions_changed(svn_fs_t *fs,
+                        const char *path,
+                        svn_revnum_t start,
+                        svn_revnum_t end,
+                        int limit,
+                        const svn_revnum_t *expected,
+                        apr_pool_t *pool)
+{
+  apr_array_header_t *revisions;
+  int i;
+
+  SVN_ERR(svn_fs_revisions_changed(&revisions, fs, path, start, end, limit,
+                                   pool, pool));
+  SVN_TEST_ASSERT(revisions != NULL);
+
+  for (i = 0; expected[i] != -1; ++i)
+    {
+      SVN_TEST_ASSERT(i < revisions->nelts);
+      SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, i, svn_revnum_t)
+                      == expected[i]);
+    }
+  SVN_TEST_ASSERT(i == revisions->nelts);
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-changed-paths-index"
+#define SHARD_SIZE 4
+
+static svn_error_t *
+changed_paths_index(const svn_test_opts_t *opts,
+                    apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root, *rev_root;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_array_header_t *revisions;
+  svn_node_kind_t kind;
+
+  static const svn_revnum_t pi_revs[] = { 7, 1, -1 };
+  static const svn_revnum_t gamma2_revs[] = { 10, 6, 1, -1 };
+  static const svn_revnum_t a_revs[] = { 10, 8, 7, 6, 4, 3, 1, -1 };
+  static const svn_revnum_t a_revs_limited[] = { 10, 8, -1 };
+  static const svn_revnum_t iota_revs[] = { 5, -1 };
+  static const svn_revnum_t no_revs[] = { -1 };
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+  ffd = fs->fsap_data;
+  if (ffd->format < SVN_FS_FS__MIN_CHANGED_PATHS_INDEX_FORMAT)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "changed paths indexes not supported");
+
+  /* Nothing to look up without an index. */
+  SVN_ERR(svn_fs_revisions_changed(&revisions, fs, "/iota", 0, 0, 0,
+                                   pool, pool));
+  SVN_TEST_ASSERT(revisions == NULL);
+  ffd->changed_paths_index = TRUE;
+
+  /* r1: the Greek tree */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(commit_expected(txn, 1, pool));
+
+  /* r2: modify iota */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 1, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "r2\n", pool));
+  SVN_ERR(commit_expected(txn, 2, pool));
+
+  /* r3: modify A/mu */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 2, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/mu", "r3\n", pool));
+  SVN_ERR(commit_expected(txn, 3, pool));
+
+  /* r4: set a property on A */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 3, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_change_node_prop(txn_root, "A", "prop",
+                                  svn_string_create("r4", pool), pool));
+  SVN_ERR(commit_expected(txn, 4, pool));
+
+  /* r5: modify iota */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 4, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "r5\n", pool));
+  SVN_ERR(commit_expected(txn, 5, pool));
+
+  /* r6: copy A/D to A/D2 */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 5, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_revision_root(&rev_root, fs, 5, pool));
+  SVN_ERR(svn_fs_copy(rev_root, "A/D", txn_root, "A/D2", pool));
+  SVN_ERR(commit_expected(txn, 6, pool));
+
+  /* r7: modify A/D/G/pi */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 6, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/D/G/pi", "r7\n", pool));
+  SVN_ERR(commit_expected(txn, 7, pool));
+
+  /* r8: delete A/B */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 7, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_fs_delete(txn_root, "A/B", pool));
+  SVN_ERR(commit_expected(txn, 8, pool));
+
+  /* r9: modify iota */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 8, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "r9\n", pool));
+  SVN_ERR(commit_expected(txn, 9, pool));
+
+  /* r10: modify A/D2/gamma */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 9, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "A/D2/gamma", "r10\n",
+                                      pool));
+  SVN_ERR(commit_expected(txn, 10, pool));
+
+  /* r0 .. r7 get packed, each shard with an index. */
+  SVN_ERR(svn_fs_fs__pack(fs, 0, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_io_check_path(svn_fs_fs__path_rev_packed(fs, 4,
+                                                       PATH_CHANGED_PATHS,
+                                                       pool),
+                            &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  /* Property changes on parents don't count, replacements do. */
+  SVN_ERR(check_revisions_changed(fs, "/A/D/G/pi", 0, 10, 0, pi_revs,
+                                  pool));
+  SVN_ERR(check_revisions_changed(fs, "A/D2/gamma", 10, 0, 0, gamma2_revs,
+                                  pool));
+
+  /* Changes below the path count as well, across packed and non-packed
+     revisions. */
+  SVN_ERR(check_revisions_changed(fs, "/A", 0, 10, 0, a_revs, pool));
+  SVN_ERR(check_revisions_changed(fs, "/A", 0, 10, 2, a_revs_limited,
+                                  pool));
+
+  /* Ranges within a shard. */
+  SVN_ERR(check_revisions_changed(fs, "/iota", 3, 8, 0, iota_revs, pool));
+  SVN_ERR(check_revisions_changed(fs, "/A/C", 2, 10, 0, no_revs, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef SHARD_SIZE
+
+/* ------------------------------------------------------------------------ */
+
+/* Verify that the history of /iota in revision YOUNGEST of FS consists of
+   all revisions from YOUNGEST down to 1.  Use POOL for allocations. */
+static svn_error_t *
+check_iota_history(svn_fs_t *fs,
+                   svn_revnum_t youngest,
+                   apr_pool_t *pool)
+{
+  svn_fs_root_t *root;
+  svn_fs_history_t *history;
+  svn_revnum_t expected = youngest;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, youngest, pool));
+  SVN_ERR(svn_fs_node_history2(&history, root, "iota", pool, pool));
+  while (1)
+    {
+      const char *path;
+      svn_revnum_t rev;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_history_prev2(&history, history, TRUE, pool, iterpool));
+      if (!history)
+        break;
+
+      SVN_ERR(svn_fs_history_location(&path, &rev, history, iterpool));
+      SVN_TEST_STRING_ASSERT(path, "/iota");
+      SVN_TEST_ASSERT(rev == expected);
+      --expected;
+    }
+
+  SVN_TEST_ASSERT(expected == 0);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the history index of FS knows /iota in revision REVISION
+   iff FOUND is set.  Use POOL for allocations. */
+static svn_error_t *
+check_iota_indexed(svn_fs_t *fs,
+                   svn_revnum_t revision,
+                   svn_boolean_t found,
+                   apr_pool_t *pool)
+{
+  svn_fs_root_t *root;
+  const svn_fs_id_t *id, *predecessor_id;
+  const char *created_path;
+  svn_boolean_t indexed;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, revision, pool));
+  SVN_ERR(svn_fs_node_id(&id, root, "iota", pool));
+  SVN_ERR(svn_fs_fs__history_index_lookup(&indexed, &predecessor_id,
+                                          &created_path, fs, id,
+                                          pool, pool));
+  SVN_TEST_ASSERT(indexed == found);
+  if (indexed)
+    {
+      SVN_TEST_STRING_ASSERT(created_path, "/iota");
+      if (revision == 1)
+        SVN_TEST_ASSERT(predecessor_id == NULL);
+      else
+        SVN_TEST_ASSERT(svn_fs_fs__id_rev(predecessor_id) == revision - 1);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+#define REPO_NAME "test-repo-history-index"
+
+static svn_error_t *
+history_index(const svn_test_opts_t *opts,
+              apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  fs_fs_data_t *ffd;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t rev;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  ffd = fs->fsap_data;
+  ffd->history_index = TRUE;
+
+  /* r1: the Greek tree, r2 .. r10: modify iota */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(commit_expected(txn, 1, pool));
+
+  for (rev = 2; rev <= 10; ++rev)
+    {
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev - 1, pool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(pool, "r%ld\n", rev),
+                                          pool));
+      SVN_ERR(commit_expected(txn, rev, pool));
+    }
+
+  /* Tracing the history writes the index. */
+  SVN_ERR(check_iota_history(fs, 10, pool));
+
+  /* A new FS instance finds everything but the start of the walk. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  ffd = fs->fsap_data;
+  ffd->history_index = TRUE;
+
+  SVN_ERR(check_iota_indexed(fs, 1, TRUE, pool));
+  SVN_ERR(check_iota_indexed(fs, 5, TRUE, pool));
+  SVN_ERR(check_iota_indexed(fs, 9, TRUE, pool));
+  SVN_ERR(check_iota_indexed(fs, 10, FALSE, pool));
+  SVN_ERR(check_iota_history(fs, 10, pool));
+
+  /* Younger node revisions get appended. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 10, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", "r11\n", pool));
+  SVN_ERR(commit_expected(txn, 11, pool));
+
+  SVN_ERR(check_iota_history(fs, 11, pool));
+  SVN_ERR(check_iota_indexed(fs, 10, TRUE, pool));
+
+  /* Without the index, history is still the same. */
+  ffd->history_index = FALSE;
+  SVN_ERR(check_iota_history(fs, 11, pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-shared-dag-cache"
+#define COPY_NAME "test-repo-shared-dag-cache-copy"
+
+/* Verify that "iota" in revision REV of FS has the EXPECTED contents.
+   Use POOL for allocations. */
+static svn_error_t *
+check_iota(svn_fs_t *fs,
+           svn_revnum_t rev,
+           const char *expected,
+           apr_pool_t *pool)
+{
+  svn_fs_root_t *root;
+  svn_stringbuf_t *contents;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "iota", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, expected);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set "iota" to CONTENTS in the next revision of FS, which must become
+   EXPECTED_REV.  Use POOL for allocations. */
+static svn_error_t *
+commit_iota(svn_fs_t *fs,
+            svn_revnum_t expected_rev,
+            const char *contents,
+            apr_pool_t *pool)
+{
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, expected_rev - 1, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", contents, pool));
+  SVN_ERR(commit_expected(txn, expected_rev, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+shared_dag_cache(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs, *other_fs, *copy_fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* r1: the Greek tree */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(commit_expected(txn, 1, pool));
+
+  /* Naive copies have the same UUID and instance ID. */
+  SVN_ERR(svn_io_remove_dir2(COPY_NAME, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(COPY_NAME);
+  SVN_ERR(svn_io_copy_dir_recursively(REPO_NAME, ".", COPY_NAME, TRUE,
+                                      NULL, NULL, pool));
+
+  /* Let the repositories diverge in r2. */
+  SVN_ERR(svn_fs_open2(&copy_fs, COPY_NAME, NULL, pool, pool));
+  SVN_ERR(commit_iota(fs, 2, "original\n", pool));
+  SVN_ERR(commit_iota(copy_fs, 2, "copy\n", pool));
+
+  /* Nodes read through one FS object are available to the other ones.
+     They must still be the right ones. */
+  SVN_ERR(check_iota(fs, 2, "original\n", pool));
+  SVN_ERR(svn_fs_open2(&other_fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(check_iota(other_fs, 1, "This is the file 'iota'.\n", pool));
+  SVN_ERR(check_iota(other_fs, 2, "original\n", pool));
+  SVN_ERR(check_iota(fs, 1, "This is the file 'iota'.\n", pool));
+
+  /* The copy must not see them. */
+  SVN_ERR(check_iota(copy_fs, 2, "copy\n", pool));
+  SVN_ERR(svn_fs_open2(&copy_fs, COPY_NAME, NULL, pool, pool));
+  SVN_ERR(check_iota(copy_fs, 2, "copy\n", pool));
+
+  /* New revisions in one object show up in the others. */
+  SVN_ERR(commit_iota(other_fs, 3, "r3\n", pool));
+  SVN_ERR(check_iota(fs, 3, "r3\n", pool));
+  SVN_ERR(check_iota(fs, 2, "original\n", pool));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef COPY_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-contents-regions"
+
+/* If the contents of PATH in ROOT can be found as file regions, set
+ * *FOUND and verify that they match EXPECTED.  Use POOL for allocations.
+ */
+static svn_error_t *
+check_contents_regions(svn_boolean_t *found,
+                       svn_fs_root_t *root,
+                       const char *path,
+                       svn_stringbuf_t *expected,
+                       apr_pool_t *pool)
+{
+  apr_file_t *file;
+  apr_array_header_t *regions;
+  svn_stringbuf_t *actual = svn_stringbuf_create_empty(pool);
+  int i;
+
+  SVN_ERR(svn_fs__try_get_contents_regions(&file, &regions, root, path,
+                                           pool, pool));
+  *found = file != NULL;
+  if (!*found)
+    return SVN_NO_ERROR;
+
+  for (i = 0; i < regions->nelts; ++i)
+    {
+      svn_fs__file_region_t *region
+        = &APR_ARRAY_IDX(regions, i, svn_fs__file_region_t);
+      apr_off_t offset = region->offset;
+      apr_size_t len = (apr_size_t)region->length;
+
+      svn_stringbuf_ensure(actual, actual->len + len);
+      SVN_ERR(svn_io_file_seek(file, APR_SET, &offset, pool));
+      SVN_ERR(svn_io_file_read_full2(file, actual->data + actual->len, len,
+                                     NULL, NULL, pool));
+      actual->len += len;
+      actual->data[actual->len] = '\0';
+    }
+
+  SVN_TEST_ASSERT(actual->len == expected->len);
+  SVN_TEST_ASSERT(memcmp(actual->data, expected->data, actual->len) == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+contents_regions(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_stringbuf_t *random_text, *plain_text;
+  apr_uint32_t seed = 0x12345678;
+  svn_boolean_t found;
+  apr_file_t *file;
+  apr_array_header_t *regions;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  /* Incompressible contents spanning multiple delta windows and a text
+   * that compresses well.  Neither contains NULs. */
+  random_text = svn_stringbuf_create_ensure(300000, pool);
+  for (i = 0; i < 300000; ++i)
+    {
+      seed = seed * 1103515245 + 12345;
+      svn_stringbuf_appendbyte(random_text, (char)(1 + (seed >> 16) % 255));
+    }
+
+  plain_text = svn_stringbuf_create_empty(pool);
+  for (i = 0; i < 10000; ++i)
+    svn_stringbuf_appendcstr(plain_text, "This is a line of text.\n");
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_fs_make_file(root, "random", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "random", random_text->data,
+                                      pool));
+  SVN_ERR(svn_fs_make_file(root, "text", pool));
+  SVN_ERR(svn_test__set_file_contents(root, "text", plain_text->data, pool));
+
+  /* Uncommitted contents are never reported. */
+  SVN_ERR(check_contents_regions(&found, root, "random", random_text, pool));
+  SVN_TEST_ASSERT(!found);
+
+  SVN_ERR(commit_expected(txn, 1, pool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, 1, pool));
+
+  /* Data that does not compress is stored verbatim. */
+  SVN_ERR(check_contents_regions(&found, root, "random", random_text, pool));
+  SVN_TEST_ASSERT(found);
+
+  /* Compressed text may or may not be found, depending on the format,
+   * but it must be correct. */
+  SVN_ERR(check_contents_regions(&found, root, "text", plain_text, pool));
+
+  /* Directories are never reported. */
+  SVN_ERR(svn_fs__try_get_contents_regions(&file, &regions, root, "/",
+                                           pool, pool));
+  SVN_TEST_ASSERT(file == NULL);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-access-trace"
+
+static svn_error_t *
+access_trace(const svn_test_opts_t *opts,
+             apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  svn_stringbuf_t *contents;
+  svn_stringbuf_t *trace;
+  apr_array_header_t *lines;
+  apr_hash_t *fs_config;
+  apr_pool_t *subpool;
+  const char *config;
+  svn_boolean_t found_file_open = FALSE;
+  int i;
+
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL, NULL);
+
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(root, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  config = "[" CONFIG_SECTION_DEBUG "]\n"
+           CONFIG_OPTION_TRACE_FILE " = trace\n";
+  SVN_ERR(svn_io_write_atomic2(svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                               config, strlen(config), NULL, FALSE, pool));
+
+  /* Use a cache namespace of our own, so the data has to come from disk. */
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_CACHE_NS, REPO_NAME);
+
+  subpool = svn_pool_create(pool);
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, fs_config, subpool, subpool));
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, subpool));
+  SVN_ERR(svn_test__get_file_contents(root, "A/mu", &contents, subpool));
+  SVN_TEST_STRING_ASSERT(contents->data, "This is the file 'mu'.\n");
+
+  /* Closing the FS writes out the buffered events. */
+  svn_pool_destroy(subpool);
+
+  SVN_ERR(svn_stringbuf_from_file2(&trace,
+                                   svn_dirent_join(REPO_NAME, "trace", pool),
+                                   pool));
+  lines = svn_cstring_split(trace->data, "\n", FALSE, pool);
+  SVN_TEST_ASSERT(lines->nelts > 0);
+
+  for (i = 0; i < lines->nelts; ++i)
+    {
+      const char *line = APR_ARRAY_IDX(lines, i, const char *);
+      apr_array_header_t *fields = svn_cstring_split(line, "\t", FALSE,
+                                                     pool);
+
+      /* Time, event, what, revision, item, offset, size, latency and
+       * request ID. */
+      SVN_TEST_ASSERT(fields->nelts == 9);
+      if (strcmp(APR_ARRAY_IDX(fields, 1, const char *), "file-open") == 0)
+        found_file_open = TRUE;
+    }
+
+  SVN_TEST_ASSERT(found_file_open);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
+/* ------------------------------------------------------------------------ */
 
-
 /* The test table.  */
 
 static int max_threads = 4;
@@ -1942,6 +4074,50 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "pack with limited memory for metadata"),
     SVN_TEST_OPTS_PASS(large_delta_against_plain,
                        "large deltas against PLAIN, issue #4658"),
+    SVN_TEST_OPTS_PASS(compression_policy,
+                       "fsfs.conf compression policy"),
+    SVN_TEST_OPTS_PASS(combined_chunk_cache,
+                       "cache combined chunks of long delta chains"),
+    SVN_TEST_OPTS_PASS(similarity_deltification,
+                       "deltify new files against similar ones"),
+    SVN_TEST_OPTS_PASS(chunked_reps,
+                       "store large files as shared chunks"),
+    SVN_TEST_OPTS_PASS(pack_with_jobs,
+                       "pack several shards concurrently"),
+    SVN_TEST_OPTS_PASS(background_pack,
+                       "pack completed shards in the background"),
+    SVN_TEST_OPTS_PASS(memory_mapped_reads,
+                       "read through memory-mapped rev / pack files"),
+    SVN_TEST_OPTS_PASS(cached_file_handles,
+                       "reuse open rev / pack files across sessions"),
+    SVN_TEST_OPTS_PASS(indexed_directories,
+                       "binary search in indexed huge directories"),
+    SVN_TEST_OPTS_PASS(dir_change_log,
+                       "store wide txn directories as change logs"),
+    SVN_TEST_OPTS_PASS(commit_rollback,
+                       "keep txns intact if a finalized commit fails"),
+    SVN_TEST_OPTS_PASS(async_rep_cache,
+                       "add reps to the rep-cache in the background"),
+    SVN_TEST_OPTS_PASS(rep_cache_filter,
+                       "skip rep-cache queries for unknown reps"),
+    SVN_TEST_OPTS_PASS(group_commit,
+                       "commit with group commits enabled"),
+    SVN_TEST_OPTS_PASS(indexed_revprop_packs,
+                       "read and replace revprops in indexed packs"),
+    SVN_TEST_OPTS_PASS(hotcopy_with_jobs,
+                       "hotcopy with concurrent jobs"),
+    SVN_TEST_OPTS_PASS(hotcopy_with_links,
+                       "hotcopy with hard-linked packed shards"),
+    SVN_TEST_OPTS_PASS(changed_paths_index,
+                       "find revisions through changed paths indexes"),
+    SVN_TEST_OPTS_PASS(history_index,
+                       "trace history through history indexes"),
+    SVN_TEST_OPTS_PASS(shared_dag_cache,
+                       "share DAG nodes between FS objects"),
+    SVN_TEST_OPTS_PASS(contents_regions,
+                       "locate verbatim file contents on disk"),
+    SVN_TEST_OPTS_PASS(access_trace,
+                       "record FS accesses in a trace file"),
     SVN_TEST_NULL
   };
 
@@ -209,8 +209,8 @@ get_repo_stats(const svn_test_opts_t *opts,
   SVN_ERR(create_greek_repo(&repos, &rev, opts, REPO_NAME, pool, pool));
 
   /* Gather statistics info on that repo. */
-  SVN_ERR(svn_fs_fs__get_stats(&stats, svn_repos_fs(repos), NULL, NULL,
-                               NULL, NULL, pool, pool));
+  SVN_ERR(svn_fs_fs__get_stats(&stats, svn_repos_fs(repos), 1, NULL,
+                               NULL, NULL, NULL, NULL, pool, pool));
 
   /* Check that the stats make sense. */
   SVN_TEST_ASSERT(stats->total_size > 1000 && stats->total_size < 10000);
@@ -419,7 +419,310 @@ load_index(const svn_test_opts_t *opts, apr_pool_t *pool)
 #undef REPO_NAME
 
 
+#define REPO_NAME "test-repo-item-offsets-test"
+
+static svn_error_t *
+item_offsets(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_revnum_t rev;
+  svn_fs_t *fs;
+  svn_fs_fs__revision_file_t *rev_file;
+  apr_array_header_t *entries = apr_array_make(pool, 41, sizeof(void *));
+  svn_revnum_t *revisions;
+  apr_uint64_t *item_indexes;
+  apr_off_t *offsets;
+  int count = 0;
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 9))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.9 SVN doesn't have FSFS indexes");
+
+  /* Create a filesystem */
+  SVN_ERR(create_greek_repo(&repos, &rev, opts, REPO_NAME, pool, pool));
+  fs = svn_repos_fs(repos);
+
+  /* The P2L index tells us where each item is. */
+  SVN_ERR(svn_fs_fs__dump_index(fs, rev, receive_index, entries,
+                                NULL, NULL, pool));
+
+  revisions = apr_palloc(pool, entries->nelts * sizeof(*revisions));
+  item_indexes = apr_palloc(pool, entries->nelts * sizeof(*item_indexes));
+  offsets = apr_palloc(pool, entries->nelts * sizeof(*offsets));
+
+  /* Request the items in reverse order to exercise the sorting. */
+  for (i = entries->nelts - 1; i >= 0; --i)
+    {
+      svn_fs_fs__p2l_entry_t *entry
+        = APR_ARRAY_IDX(entries, i, svn_fs_fs__p2l_entry_t *);
+      if (entry->type == SVN_FS_FS__ITEM_TYPE_UNUSED)
+        continue;
+
+      revisions[count] = entry->item.revision;
+      item_indexes[count] = entry->item.number;
+      ++count;
+    }
+
+  /* Resolve them all at once and compare with single lookups. */
+  SVN_ERR(svn_fs_fs__open_pack_or_rev_file(&rev_file, fs, rev, pool, pool));
+  SVN_ERR(svn_fs_fs__item_offsets(offsets, fs, rev_file, revisions,
+                                  item_indexes, count, pool));
+
+  for (i = 0; i < count; ++i)
+    {
+      apr_off_t offset;
+      SVN_ERR(svn_fs_fs__item_offset(&offset, fs, rev_file, revisions[i],
+                                     NULL, item_indexes[i], pool));
+      SVN_TEST_ASSERT(offsets[i] == offset);
+    }
+
+  SVN_ERR(svn_fs_fs__close_revision_file(rev_file));
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+
 
+#define REPO_NAME "test-repo-verify-with-jobs-test"
+#define MAX_REV 8
+
+/* Implements svn_repos_notify_func_t, appending the revision of every
+ * svn_repos_notify_verify_rev_end notification to the array in BATON. */
+static void
+receive_verified_rev(void *baton,
+                     const svn_repos_notify_t *notify,
+                     apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *revisions = baton;
+  if (notify->action == svn_repos_notify_verify_rev_end)
+    APR_ARRAY_PUSH(revisions, svn_revnum_t) = notify->revision;
+}
+
+static svn_error_t *
+verify_with_jobs(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_revnum_t rev;
+  svn_fs_t *fs;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  apr_array_header_t *revisions
+    = apr_array_make(pool, MAX_REV + 1, sizeof(svn_revnum_t));
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  /* Create a filesystem with a few revisions. */
+  SVN_ERR(create_greek_repo(&repos, &rev, opts, REPO_NAME, pool, pool));
+  fs = svn_repos_fs(repos);
+
+  while (rev < MAX_REV)
+    {
+      svn_fs_txn_t *txn;
+      svn_fs_root_t *txn_root;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool,
+                                                       "iota in r%ld\n",
+                                                       rev + 1),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  /* Verify concurrently.  Notifications must be in revision order. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_VERIFY_JOBS, "3");
+  SVN_ERR(svn_repos_open3(&repos, REPO_NAME, fs_config, pool, pool));
+  SVN_ERR(svn_repos_verify_fs3(repos, 0, MAX_REV, FALSE, FALSE,
+                               receive_verified_rev, revisions,
+                               NULL, NULL, NULL, NULL, pool));
+
+  SVN_TEST_ASSERT(revisions->nelts == MAX_REV + 1);
+  for (i = 0; i < revisions->nelts; ++i)
+    SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, i, svn_revnum_t) == i);
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef MAX_REV
+
+/* ------------------------------------------------------------------------ */
+
+#define REPO_NAME "test-repo-get-repo-stats-with-jobs"
+#define CACHE_NAME "test-repo-get-repo-stats-with-jobs-cache"
+#define SHARD_SIZE 3
+#define MAX_REV 13
+
+/* Implements svn_fs_progress_notify_func_t, appending REVISION to the
+ * apr_array_header_t * in BATON. */
+static void
+receive_stats_progress(svn_revnum_t revision,
+                       void *baton,
+                       apr_pool_t *scratch_pool)
+{
+  apr_array_header_t *revisions = baton;
+  APR_ARRAY_PUSH(revisions, svn_revnum_t) = revision;
+}
+
+/* Gather statistics on FS, reading up to JOBS pack files concurrently and
+ * using CACHE_DIR.  Return them in *STATS, allocated in POOL.  Verify that
+ * progress has been reported for the pack files in revision order. */
+static svn_error_t *
+get_stats_with_jobs(svn_fs_fs__stats_t **stats,
+                    svn_fs_t *fs,
+                    int jobs,
+                    const char *cache_dir,
+                    apr_pool_t *pool)
+{
+  apr_array_header_t *revisions
+    = apr_array_make(pool, MAX_REV + 1, sizeof(svn_revnum_t));
+  int i;
+
+  SVN_ERR(svn_fs_fs__get_stats(stats, fs, jobs, cache_dir,
+                               receive_stats_progress, revisions,
+                               NULL, NULL, pool, pool));
+
+  SVN_TEST_ASSERT(revisions->nelts >= (MAX_REV + 1) / SHARD_SIZE);
+  for (i = 0; i < (MAX_REV + 1) / SHARD_SIZE; ++i)
+    SVN_TEST_ASSERT(APR_ARRAY_IDX(revisions, i, svn_revnum_t)
+                    == i * SHARD_SIZE);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that the EXPECTED and ACTUAL statistics are the same. */
+static svn_error_t *
+compare_stats(const svn_fs_fs__stats_t *expected,
+              const svn_fs_fs__stats_t *actual)
+{
+  apr_size_t i;
+
+  SVN_TEST_ASSERT(expected->total_size == actual->total_size);
+  SVN_TEST_ASSERT(expected->revision_count == actual->revision_count);
+  SVN_TEST_ASSERT(expected->change_count == actual->change_count);
+  SVN_TEST_ASSERT(expected->change_len == actual->change_len);
+
+  SVN_TEST_ASSERT(!memcmp(&expected->total_rep_stats,
+                          &actual->total_rep_stats,
+                          sizeof(expected->total_rep_stats)));
+  SVN_TEST_ASSERT(!memcmp(&expected->file_rep_stats,
+                          &actual->file_rep_stats,
+                          sizeof(expected->file_rep_stats)));
+  SVN_TEST_ASSERT(!memcmp(&expected->dir_rep_stats,
+                          &actual->dir_rep_stats,
+                          sizeof(expected->dir_rep_stats)));
+  SVN_TEST_ASSERT(!memcmp(&expected->total_node_stats,
+                          &actual->total_node_stats,
+                          sizeof(expected->total_node_stats)));
+  SVN_TEST_ASSERT(!memcmp(&expected->rep_size_histogram,
+                          &actual->rep_size_histogram,
+                          sizeof(expected->rep_size_histogram)));
+
+  SVN_TEST_ASSERT(expected->largest_changes->min_size
+                  == actual->largest_changes->min_size);
+  for (i = 0; i < expected->largest_changes->count; ++i)
+    {
+      svn_fs_fs__large_change_info_t *lhs
+        = expected->largest_changes->changes[i];
+      svn_fs_fs__large_change_info_t *rhs
+        = actual->largest_changes->changes[i];
+
+      SVN_TEST_ASSERT(lhs->size == rhs->size);
+      SVN_TEST_ASSERT(lhs->revision == rhs->revision);
+      SVN_TEST_STRING_ASSERT(lhs->path->data, rhs->path->data);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+get_repo_stats_with_jobs(const svn_test_opts_t *opts,
+                         apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_revnum_t rev;
+  apr_hash_t *fs_config = apr_hash_make(pool);
+  svn_fs_fs__stats_t *expected, *stats;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsfs") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSFS repositories only");
+
+  if (opts->server_minor_version && (opts->server_minor_version < 9))
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "pre-1.9 SVN doesn't support log addressing");
+
+  /* Create a filesystem with a few shards worth of revisions. */
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_FSFS_SHARD_SIZE,
+                apr_itoa(pool, SHARD_SIZE));
+  SVN_ERR(svn_test__create_fs2(&fs, REPO_NAME, opts, fs_config, pool));
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, pool));
+
+  while (rev < MAX_REV)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                          apr_psprintf(iterpool,
+                                                       "iota in r%ld\n",
+                                                       rev + 1),
+                                          iterpool));
+      SVN_ERR(svn_fs_commit_txn(NULL, &rev, txn, iterpool));
+    }
+
+  /* r0 .. r11 are packed, the remainder is not. */
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  SVN_ERR(svn_io_remove_dir2(CACHE_NAME, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(CACHE_NAME);
+
+  /* Scanning the pack files concurrently must not change the results. */
+  SVN_ERR(get_stats_with_jobs(&expected, fs, 1, NULL, pool));
+  SVN_ERR(get_stats_with_jobs(&stats, fs, 3, CACHE_NAME, pool));
+  SVN_ERR(compare_stats(expected, stats));
+
+  /* Neither must reusing the cached data, with and without jobs. */
+  SVN_ERR(get_stats_with_jobs(&stats, fs, 3, CACHE_NAME, pool));
+  SVN_ERR(compare_stats(expected, stats));
+  SVN_ERR(get_stats_with_jobs(&stats, fs, 1, CACHE_NAME, pool));
+  SVN_ERR(compare_stats(expected, stats));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef CACHE_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+
+
 /* The test table.  */
 
 static int max_threads = 0;
@@ -433,6 +736,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "dump the P2L index"),
     SVN_TEST_OPTS_PASS(load_index,
                        "load the P2L index"),
+    SVN_TEST_OPTS_PASS(item_offsets,
+                       "batched L2P index lookups"),
+    SVN_TEST_OPTS_PASS(verify_with_jobs,
+                       "verify revisions concurrently"),
+    SVN_TEST_OPTS_PASS(get_repo_stats_with_jobs,
+                       "get statistics reading pack files concurrently"),
     SVN_TEST_NULL
   };
 
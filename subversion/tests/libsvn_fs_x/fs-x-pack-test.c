@@ -23,6 +23,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <apr_pools.h>
+#include <apr_thread_proc.h>
 
 #include "../svn_test.h"
 #include "../../libsvn_fs_x/batch_fsync.h"
@@ -32,6 +33,7 @@
 #include "svn_pools.h"
 #include "svn_props.h"
 #include "svn_fs.h"
+#include "svn_io.h"
 #include "private/svn_string_private.h"
 
 #include "../svn_test_fs.h"
@@ -192,7 +194,7 @@ create_packed_filesystem(const char *dir,
   /* Now pack the FS */
   pnb.expected_shard = 0;
   pnb.expected_action = svn_fs_pack_notify_start;
-  return svn_fs_pack(dir, pack_notify, &pnb, NULL, NULL, pool);
+  return svn_fs_pack2(dir, NULL, pack_notify, &pnb, NULL, NULL, pool);
 }
 
 /* Create a packed FSFS filesystem for revprop tests at REPO_NAME with
@@ -227,7 +229,7 @@ prepare_revprop_repo(svn_fs_t **fs,
   svn_pool_destroy(subpool);
 
   /* Pack the repository. */
-  SVN_ERR(svn_fs_pack(repo_name, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(repo_name, NULL, NULL, NULL, NULL, NULL, pool));
 
   return SVN_NO_ERROR;
 }
@@ -652,7 +654,7 @@ recover_fully_packed(const svn_test_opts_t *opts,
   SVN_ERR(svn_fs_commit_txn(&conflict, &after_rev, txn, subpool));
   SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(after_rev));
   svn_pool_destroy(subpool);
-  SVN_ERR(svn_fs_pack(REPO_NAME, NULL, NULL, NULL, NULL, pool));
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
   SVN_ERR(svn_fs_recover(REPO_NAME, NULL, NULL, pool));
 
   /* Now, delete the youngest revprop file, and recover again.  This
@@ -778,6 +780,7 @@ test_reps(const svn_test_opts_t *opts,
   svn_stringbuf_t *serialized;
   svn_stream_t *stream;
   svn_stringbuf_t *contents = svn_stringbuf_create_ensure(10000, pool);
+  apr_pool_t *iterpool;
   int i;
 
   for (i = 0; i < 10000; ++i)
@@ -794,8 +797,9 @@ test_reps(const svn_test_opts_t *opts,
 
   SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
 
+  /* Include texts shorter than the matching block size. */
   builder = svn_fs_x__reps_builder_create(fs, pool);
-  for (i = 10000; i > 10; --i)
+  for (i = 10000; i > 0; --i)
     {
       apr_size_t idx;
       svn_string_t string;
@@ -803,6 +807,7 @@ test_reps(const svn_test_opts_t *opts,
       string.len = i;
 
       SVN_ERR(svn_fs_x__reps_add(&idx, builder, &string));
+      SVN_TEST_INT_ASSERT(idx, 10000 - i);
     }
 
   serialized = svn_stringbuf_create_empty(pool);
@@ -813,6 +818,24 @@ test_reps(const svn_test_opts_t *opts,
   SVN_ERR(svn_fs_x__read_reps_container(&container, stream, pool, pool));
   SVN_ERR(svn_stream_close(stream));
 
+  /* Extract all texts again. */
+  iterpool = svn_pool_create(pool);
+  for (i = 10000; i > 0; --i)
+    {
+      svn_fs_x__rep_extractor_t *extractor;
+      svn_stringbuf_t *text;
+
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_x__reps_get(&extractor, fs, container, 10000 - i,
+                                 iterpool));
+      SVN_ERR(svn_fs_x__extractor_drive(&text, extractor, 0, 0, iterpool,
+                                        iterpool));
+      SVN_TEST_INT_ASSERT(text->len, i);
+      SVN_TEST_ASSERT(memcmp(text->data, contents->data, i) == 0);
+    }
+
+  svn_pool_destroy(iterpool);
+
   return SVN_NO_ERROR;
 }
 
@@ -929,6 +952,288 @@ test_batch_fsync(const svn_test_opts_t *opts,
 }
 #undef REPO_NAME
 /* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-fsx-shared-reps-containers"
+#define SHARD_SIZE 4
+#define MAX_REV 8
+#define DIR_COUNT 3
+#define FILE_COUNT 8
+
+/* Return the contents of file number FILE in directory number DIR as of
+   revision REV.  They are all very similar but not identical. */
+static const char *
+get_similar_contents(int dir,
+                     int file,
+                     svn_revnum_t rev,
+                     apr_pool_t *pool)
+{
+  svn_stringbuf_t *contents = svn_stringbuf_create_empty(pool);
+  int i;
+
+  for (i = 0; i < 50; ++i)
+    svn_stringbuf_appendcstr(contents,
+                             apr_psprintf(pool, "This is line %d.\n",
+                                          i == file ? i + 1000 : i));
+
+  svn_stringbuf_appendcstr(contents,
+                           apr_psprintf(pool, "%d/%d@%ld\n", dir, file, rev));
+
+  return contents->data;
+}
+
+static svn_error_t *
+pack_shared_reps_containers(const svn_test_opts_t *opts,
+                            apr_pool_t *pool)
+{
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *root;
+  svn_revnum_t rev;
+  const char *conflict;
+  int version, dir, file;
+  const char *config = "[" CONFIG_SECTION_DELTIFICATION "]\n"
+                       CONFIG_OPTION_REPS_CONTAINER_SIZE " = 4\n";
+  apr_pool_t *iterpool = svn_pool_create(pool);
+
+  /* Bail (with success) on known-untestable scenarios */
+  if (strcmp(opts->fs_type, "fsx") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSX repositories only");
+
+  /* Use small shards and containers that span multiple paths but will
+     not hold all representations of a shard. */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_io_read_version_file(&version,
+                                   svn_dirent_join(REPO_NAME, "format",
+                                                   pool),
+                                   pool));
+  SVN_ERR(write_format(REPO_NAME, version, SHARD_SIZE, pool));
+  SVN_ERR(svn_io_write_atomic2(svn_dirent_join(REPO_NAME, PATH_CONFIG, pool),
+                               config, strlen(config), NULL, FALSE, pool));
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+
+  /* Modify all files in every revision. */
+  for (rev = 0; rev < MAX_REV; )
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, rev, iterpool));
+      SVN_ERR(svn_fs_txn_root(&root, txn, iterpool));
+
+      for (dir = 0; dir < DIR_COUNT; ++dir)
+        {
+          const char *dir_path = apr_psprintf(iterpool, "dir%d", dir);
+          if (rev == 0)
+            SVN_ERR(svn_fs_make_dir(root, dir_path, iterpool));
+
+          for (file = 0; file < FILE_COUNT; ++file)
+            {
+              const char *path = apr_psprintf(iterpool, "%s/file%d",
+                                              dir_path, file);
+              if (rev == 0)
+                SVN_ERR(svn_fs_make_file(root, path, iterpool));
+
+              SVN_ERR(svn_test__set_file_contents(root, path,
+                          get_similar_contents(dir, file, rev + 1, iterpool),
+                          iterpool));
+            }
+        }
+
+      SVN_ERR(svn_fs_commit_txn(&conflict, &rev, txn, iterpool));
+    }
+
+  SVN_ERR(svn_fs_pack2(REPO_NAME, NULL, NULL, NULL, NULL, NULL, pool));
+
+  /* Read everything back from a fresh FS instance. */
+  SVN_ERR(svn_fs_open2(&fs, REPO_NAME, NULL, pool, pool));
+  for (rev = 1; rev <= MAX_REV; ++rev)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_fs_revision_root(&root, fs, rev, iterpool));
+
+      for (dir = 0; dir < DIR_COUNT; ++dir)
+        for (file = 0; file < FILE_COUNT; ++file)
+          {
+            svn_stringbuf_t *contents;
+            const char *path = apr_psprintf(iterpool, "dir%d/file%d",
+                                            dir, file);
+
+            SVN_ERR(svn_test__get_file_contents(root, path, &contents,
+                                                iterpool));
+            SVN_TEST_STRING_ASSERT(contents->data,
+                                   get_similar_contents(dir, file, rev,
+                                                        iterpool));
+          }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+#undef REPO_NAME
+#undef SHARD_SIZE
+#undef MAX_REV
+#undef DIR_COUNT
+#undef FILE_COUNT
+/* ------------------------------------------------------------------------ */
+#define REPO_NAME "test-repo-fsx-shared-dag-cache"
+#define COPY_NAME "test-repo-fsx-shared-dag-cache-copy"
+#define THREAD_COUNT 4
+
+/* Verify that "iota" in revision REV of FS has the EXPECTED contents.
+   Use POOL for allocations. */
+static svn_error_t *
+check_iota(svn_fs_t *fs,
+           svn_revnum_t rev,
+           const char *expected,
+           apr_pool_t *pool)
+{
+  svn_fs_root_t *root;
+  svn_stringbuf_t *contents;
+
+  SVN_ERR(svn_fs_revision_root(&root, fs, rev, pool));
+  SVN_ERR(svn_test__get_file_contents(root, "iota", &contents, pool));
+  SVN_TEST_STRING_ASSERT(contents->data, expected);
+
+  return SVN_NO_ERROR;
+}
+
+/* Set "iota" to CONTENTS in the next revision of FS, which must become
+   EXPECTED_REV.  Use POOL for allocations. */
+static svn_error_t *
+commit_iota(svn_fs_t *fs,
+            svn_revnum_t expected_rev,
+            const char *contents,
+            apr_pool_t *pool)
+{
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  const char *conflict;
+  svn_revnum_t new_rev;
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, expected_rev - 1, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota", contents, pool));
+  SVN_ERR(svn_fs_commit_txn(&conflict, &new_rev, txn, pool));
+  SVN_TEST_INT_ASSERT(new_rev, expected_rev);
+
+  return SVN_NO_ERROR;
+}
+
+#if APR_HAS_THREADS
+/* Thread function reading "iota" from a new FS object for the repository
+   whose path is given as DATA.  Returns the svn_error_t *. */
+static void * APR_THREAD_FUNC
+read_iota_thread(apr_thread_t *tid,
+                 void *data)
+{
+  apr_pool_t *pool = svn_pool_create(NULL);
+  svn_error_t *err = SVN_NO_ERROR;
+  svn_fs_t *fs;
+  int i;
+
+  err = svn_fs_open2(&fs, data, NULL, pool, pool);
+  for (i = 0; i < 100 && !err; ++i)
+    err = check_iota(fs, 1 + i % 3,
+                     i % 3 == 0 ? "This is the file 'iota'.\n"
+                                : i % 3 == 1 ? "original\n" : "r3\n",
+                     pool);
+
+  /* Errors are allocated independently of POOL. */
+  svn_pool_destroy(pool);
+  apr_thread_exit(tid, APR_SUCCESS);
+
+  return err;
+}
+#endif
+
+static svn_error_t *
+shared_dag_cache(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_fs_t *fs, *other_fs, *copy_fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  const char *conflict;
+  svn_revnum_t new_rev;
+
+  if (strcmp(opts->fs_type, "fsx") != 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "this will test FSX repositories only");
+
+  /* r1: the Greek tree */
+  SVN_ERR(svn_test__create_fs(&fs, REPO_NAME, opts, pool));
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_fs_commit_txn(&conflict, &new_rev, txn, pool));
+  SVN_TEST_INT_ASSERT(new_rev, 1);
+
+  /* Naive copies have the same UUID and instance ID. */
+  SVN_ERR(svn_io_remove_dir2(COPY_NAME, TRUE, NULL, NULL, pool));
+  svn_test_add_dir_cleanup(COPY_NAME);
+  SVN_ERR(svn_io_copy_dir_recursively(REPO_NAME, ".", COPY_NAME, TRUE,
+                                      NULL, NULL, pool));
+
+  /* Let the repositories diverge in r2. */
+  SVN_ERR(svn_fs_open2(&copy_fs, COPY_NAME, NULL, pool, pool));
+  SVN_ERR(commit_iota(fs, 2, "original\n", pool));
+  SVN_ERR(commit_iota(copy_fs, 2, "copy\n", pool));
+
+  /* Nodes read through one FS object are available to the other ones.
+     They must still be the right ones. */
+  SVN_ERR(check_iota(fs, 2, "original\n", pool));
+  SVN_ERR(svn_fs_open2(&other_fs, REPO_NAME, NULL, pool, pool));
+  SVN_ERR(check_iota(other_fs, 1, "This is the file 'iota'.\n", pool));
+  SVN_ERR(check_iota(other_fs, 2, "original\n", pool));
+  SVN_ERR(check_iota(fs, 1, "This is the file 'iota'.\n", pool));
+
+  /* The copy must not see them. */
+  SVN_ERR(check_iota(copy_fs, 2, "copy\n", pool));
+  SVN_ERR(svn_fs_open2(&copy_fs, COPY_NAME, NULL, pool, pool));
+  SVN_ERR(check_iota(copy_fs, 2, "copy\n", pool));
+
+  /* New revisions in one object show up in the others. */
+  SVN_ERR(commit_iota(other_fs, 3, "r3\n", pool));
+  SVN_ERR(check_iota(fs, 3, "r3\n", pool));
+  SVN_ERR(check_iota(fs, 2, "original\n", pool));
+
+#if APR_HAS_THREADS
+  /* Many readers in parallel, each with its own FS object. */
+  {
+    apr_thread_t *threads[THREAD_COUNT];
+    svn_error_t *err = SVN_NO_ERROR;
+    int i;
+
+    for (i = 0; i < THREAD_COUNT; ++i)
+      {
+        apr_status_t status = apr_thread_create(&threads[i], NULL,
+                                                read_iota_thread,
+                                                (void *)REPO_NAME, pool);
+        if (status)
+          return svn_error_wrap_apr(status, "Can't create thread");
+      }
+
+    for (i = 0; i < THREAD_COUNT; ++i)
+      {
+        apr_status_t retval;
+        apr_status_t status = apr_thread_join(&retval, threads[i]);
+        if (status)
+          return svn_error_compose_create(err,
+                     svn_error_wrap_apr(status, "Can't join thread"));
+
+        err = svn_error_compose_create(err, apr_thread_data_get(threads[i]));
+      }
+
+    SVN_ERR(err);
+  }
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+#undef REPO_NAME
+#undef COPY_NAME
+#undef THREAD_COUNT
+/* ------------------------------------------------------------------------ */
 
 /* The test table.  */
 
@@ -963,6 +1268,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test packing with shard size = 1"),
     SVN_TEST_OPTS_PASS(test_batch_fsync,
                        "test batch fsync"),
+    SVN_TEST_OPTS_PASS(pack_shared_reps_containers,
+                       "pack with reps containers spanning many paths"),
+    SVN_TEST_OPTS_PASS(shared_dag_cache,
+                       "share DAG nodes between FSX instances"),
     SVN_TEST_NULL
   };
 
@@ -36,10 +36,16 @@
 #include "svn_cmdline.h"
 #include "svn_dirent_uri.h"
 #include "svn_hash.h"
+#include "svn_sorts.h"
+
+#include "private/svn_ra_private.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
+#include "../../libsvn_ra/ra_loader.h"
 #include "../../libsvn_ra_local/ra_local.h"
+#include "../../libsvn_ra_svn/ra_svn.h"
 
 /*-------------------------------------------------------------------*/
 
@@ -143,6 +149,7 @@ typedef struct tunnel_baton_t
   int magic; /* TUNNEL_MAGIC */
   int open_count;
   svn_boolean_t last_check;
+  const char *compression; /* svnserve's --compression level or NULL */
 } tunnel_baton_t;
 
 #define TUNNEL_MAGIC 0xF00DF00F
@@ -185,13 +192,19 @@ open_tunnel(svn_stream_t **request, svn_stream_t **response,
   apr_proc_t *proc;
   apr_procattr_t *attr;
   apr_status_t status;
-  const char *args[] = { "svnserve", "-t", "-r", ".", NULL };
+  const char *args[] = { "svnserve", "-t", "-r", ".", NULL, NULL, NULL };
   const char *svnserve;
   tunnel_baton_t *b = tunnel_baton;
   close_baton_t *cb;
 
   SVN_TEST_ASSERT(b->magic == TUNNEL_MAGIC);
 
+  if (b->compression)
+    {
+      args[4] = "--compression";
+      args[5] = b->compression;
+    }
+
   SVN_ERR(svn_dirent_get_absolute(&svnserve, "../../svnserve/svnserve", pool));
 #ifdef WIN32
   svnserve = apr_pstrcat(pool, svnserve, ".exe", SVN_VA_NULL);
@@ -1682,6 +1695,577 @@ commit_empty_last_change(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Call svn_ra__check_paths() for the NBR_PATHS PATHS in REVISION and
+ * verify that the result matches the EXPECTED kinds. */
+static svn_error_t *
+verify_check_paths(svn_ra_session_t *session,
+                   const char *paths[],
+                   const svn_node_kind_t expected[],
+                   int nbr_paths,
+                   svn_revnum_t revision,
+                   apr_pool_t *pool)
+{
+  apr_array_header_t *path_array = apr_array_make(pool, nbr_paths,
+                                                  sizeof(const char *));
+  apr_array_header_t *kinds;
+  int i;
+
+  for (i = 0; i < nbr_paths; ++i)
+    APR_ARRAY_PUSH(path_array, const char *) = paths[i];
+
+  SVN_ERR(svn_ra__check_paths(session, &kinds, path_array, revision,
+                              pool, pool));
+
+  SVN_TEST_INT_ASSERT(kinds->nelts, nbr_paths);
+  for (i = 0; i < nbr_paths; ++i)
+    if (APR_ARRAY_IDX(kinds, i, svn_node_kind_t) != expected[i])
+      return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                               "Path '%s' in r%ld is a %s, expected %s",
+                               paths[i], revision,
+                               svn_node_kind_to_word(
+                                 APR_ARRAY_IDX(kinds, i, svn_node_kind_t)),
+                               svn_node_kind_to_word(expected[i]));
+
+  return SVN_NO_ERROR;
+}
+
+/* Check a batch of paths, including paths that are missing, repeated or
+ * not in the requested revision, relative to SESSION which must be opened
+ * on the root of a repository that only contains commit_tree() in r1. */
+static svn_error_t *
+check_paths_batches(svn_ra_session_t *session,
+                    apr_pool_t *pool)
+{
+  const char *root_url;
+  const char *paths[] = { "", "A", "A/B/f", "A/C", "A/B/f/x", "A" };
+  const svn_node_kind_t head_kinds[] = { svn_node_dir, svn_node_dir,
+                                         svn_node_file, svn_node_none,
+                                         svn_node_none, svn_node_dir };
+  const svn_node_kind_t r0_kinds[] = { svn_node_dir, svn_node_none,
+                                       svn_node_none, svn_node_none,
+                                       svn_node_none, svn_node_none };
+  const char *sub_paths[] = { "B", "BB/g", "" };
+  const svn_node_kind_t sub_kinds[] = { svn_node_dir, svn_node_file,
+                                        svn_node_dir };
+
+  SVN_ERR(verify_check_paths(session, paths, head_kinds, 6,
+                             SVN_INVALID_REVNUM, pool));
+  SVN_ERR(verify_check_paths(session, paths, head_kinds, 6, 1, pool));
+  SVN_ERR(verify_check_paths(session, paths, r0_kinds, 6, 0, pool));
+  SVN_ERR(verify_check_paths(session, paths, NULL, 0, 1, pool));
+
+  {
+    apr_array_header_t *path_array = apr_array_make(pool, 1,
+                                                    sizeof(const char *));
+    apr_array_header_t *kinds;
+
+    APR_ARRAY_PUSH(path_array, const char *) = "A";
+    SVN_TEST_ASSERT_ERROR(svn_ra__check_paths(session, &kinds, path_array, 2,
+                                              pool, pool),
+                          SVN_ERR_FS_NO_SUCH_REVISION);
+  }
+
+  /* Paths are relative to the session URL. */
+  SVN_ERR(svn_ra_get_repos_root2(session, &root_url, pool));
+  SVN_ERR(svn_ra_reparent(session, svn_path_url_add_component2(root_url,
+                                                               "A", pool),
+                          pool));
+  SVN_ERR(verify_check_paths(session, sub_paths, sub_kinds, 3, 1, pool));
+  SVN_ERR(svn_ra_reparent(session, root_url, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Batched path checks with the RA layer chosen by the test options. */
+static svn_error_t *
+check_paths_test(const svn_test_opts_t *opts,
+                 apr_pool_t *pool)
+{
+  svn_ra_session_t *session;
+
+  SVN_ERR(make_and_open_repos(&session, "test-repo-check-paths", opts,
+                              pool));
+  SVN_ERR(commit_tree(session, pool));
+
+  SVN_ERR(check_paths_batches(session, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Batched path checks against svnserve, with and without the
+ * check-path-many capability. */
+static svn_error_t *
+tunnel_check_paths_test(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  tunnel_baton_t *b = apr_pcalloc(pool, sizeof(*b));
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  const char *url;
+  svn_ra_callbacks2_t *cbtable;
+  svn_ra_session_t *session;
+  svn_ra_svn__session_baton_t *sess_baton;
+  const char tunnel_repos_name[] = "test-repo-tunnel-check-paths";
+
+  b->magic = TUNNEL_MAGIC;
+
+  SVN_ERR(svn_test__create_repos(NULL, tunnel_repos_name, opts, scratch_pool));
+
+  /* Immediately close the repository to avoid race condition with svnserve
+     (and then the cleanup code) with BDB when our pool is cleared. */
+  svn_pool_clear(scratch_pool);
+
+  url = apr_pstrcat(pool, "svn+test://localhost/", tunnel_repos_name,
+                    SVN_VA_NULL);
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  cbtable->check_tunnel_func = check_tunnel;
+  cbtable->open_tunnel_func = open_tunnel;
+  cbtable->tunnel_baton = b;
+  SVN_ERR(svn_cmdline_create_auth_baton2(&cbtable->auth_baton,
+                                         TRUE  /* non_interactive */,
+                                         "jrandom", "rayjandom",
+                                         NULL,
+                                         TRUE  /* no_auth_cache */,
+                                         FALSE /* trust_server_cert */,
+                                         FALSE, FALSE, FALSE, FALSE,
+                                         NULL, NULL, NULL, pool));
+
+  SVN_ERR(svn_ra_open4(&session, NULL, url, NULL, cbtable, NULL, NULL,
+                       scratch_pool));
+  SVN_ERR(commit_tree(session, scratch_pool));
+
+  /* All paths get checked in a single request. */
+  sess_baton = session->priv;
+  SVN_TEST_ASSERT(svn_ra_svn_has_capability(sess_baton->conn,
+                                            SVN_RA_SVN_CAP_CHECK_PATH_MANY));
+  SVN_ERR(check_paths_batches(session, scratch_pool));
+
+  /* The session remains usable after the batch. */
+  {
+    svn_node_kind_t kind;
+
+    SVN_ERR(svn_ra_check_path(session, "A/BB", 1, &kind, scratch_pool));
+    SVN_TEST_ASSERT(kind == svn_node_dir);
+  }
+
+  /* Pretend to talk to an older server, which makes the client fall back
+     to one check-path request per path. */
+  svn_hash_sets(sess_baton->conn->capabilities,
+                SVN_RA_SVN_CAP_CHECK_PATH_MANY, NULL);
+  SVN_ERR(check_paths_batches(session, scratch_pool));
+
+  svn_pool_destroy(scratch_pool);
+  SVN_TEST_ASSERT(b->open_count == 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the ra_svn encoding of COUNT string items, each one followed by
+ * a space.  Item I is the decimal representation of I, padded to 300
+ * bytes such that the data spans multiple read buffers. */
+static svn_string_t *
+make_string_items(int count,
+                  apr_pool_t *pool)
+{
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  int i;
+
+  for (i = 0; i < count; ++i)
+    svn_stringbuf_appendcstr(data, apr_psprintf(pool, "300:%0300d ", i));
+
+  return svn_string_create_from_buf(data, pool);
+}
+
+/* Return an ra_svn connection that reads DATA and discards all output. */
+static svn_ra_svn_conn_t *
+make_string_conn(const svn_string_t *data,
+                 apr_pool_t *pool)
+{
+  return svn_ra_svn_create_conn5(NULL,
+                                 svn_stream_from_string(data, pool),
+                                 svn_stream_empty(pool),
+                                 SVN_DELTA_COMPRESSION_LEVEL_NONE,
+                                 0, 0, 0, 0, pool);
+}
+
+/* Read the next item from CONN into POOL, verify that it is item I as
+ * created by make_string_items() and return it in *ITEM. */
+static svn_error_t *
+read_string_item(const svn_ra_svn__item_t **item,
+                 svn_ra_svn_conn_t *conn,
+                 int i,
+                 apr_pool_t *pool)
+{
+  svn_ra_svn__item_t *result;
+
+  SVN_ERR(svn_ra_svn__read_item(conn, pool, &result));
+  SVN_TEST_ASSERT(result->kind == SVN_RA_SVN_STRING);
+  SVN_TEST_STRING_ASSERT(result->u.string.data,
+                         apr_psprintf(pool, "%0300d", i));
+
+  *item = result;
+  return SVN_NO_ERROR;
+}
+
+/* Strings parsed in place must remain valid while their pool lives,
+ * without letting a long-lived pool pin an unbounded number of buffers. */
+static svn_error_t *
+ra_svn_readbuf_pinning(apr_pool_t *pool)
+{
+  enum { COUNT = 4000 };
+  svn_ra_svn_conn_t *conn = make_string_conn(make_string_items(COUNT, pool),
+                                             pool);
+  apr_pool_t *items_pool = svn_pool_create(conn->pool);
+  const svn_ra_svn__item_t **items = apr_pcalloc(pool,
+                                                 COUNT * sizeof(*items));
+  int i;
+
+  /* All items get allocated in the same long-lived pool. */
+  for (i = 0; i < COUNT; ++i)
+    {
+      SVN_ERR(read_string_item(&items[i], conn, i, items_pool));
+      SVN_TEST_ASSERT(conn->pinned_read_bufs
+                      <= SVN_RA_SVN__MAX_PINNED_READ_BUFS);
+    }
+
+  /* The data spans more buffers than may be pinned.  So, some items must
+   * have been copied and none of them may have been overwritten. */
+  SVN_TEST_INT_ASSERT(conn->pinned_read_bufs,
+                      SVN_RA_SVN__MAX_PINNED_READ_BUFS);
+  for (i = 0; i < COUNT; ++i)
+    SVN_TEST_STRING_ASSERT(items[i]->u.string.data,
+                           apr_psprintf(pool, "%0300d", i));
+
+  /* Destroying the pool releases all pins. */
+  svn_pool_destroy(items_pool);
+  SVN_TEST_INT_ASSERT(conn->pinned_read_bufs, 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Pins held by short-lived pools get released and the buffers reused. */
+static svn_error_t *
+ra_svn_readbuf_release(apr_pool_t *pool)
+{
+  enum { COUNT = 4000 };
+  svn_ra_svn_conn_t *conn = make_string_conn(make_string_items(COUNT, pool),
+                                             pool);
+  apr_pool_t *iterpool = svn_pool_create(conn->pool);
+  const svn_ra_svn__item_t *item;
+  int i;
+
+  for (i = 0; i < COUNT; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(read_string_item(&item, conn, i, iterpool));
+      SVN_TEST_ASSERT(conn->pinned_read_bufs <= 1);
+    }
+
+  svn_pool_clear(iterpool);
+  SVN_TEST_INT_ASSERT(conn->pinned_read_bufs, 0);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* A pinned buffer must be replaced, not overwritten, when the connection
+ * reads more data. */
+static svn_error_t *
+ra_svn_readbuf_replace(apr_pool_t *pool)
+{
+  enum { COUNT = 4000 };
+  svn_ra_svn_conn_t *conn = make_string_conn(make_string_items(COUNT, pool),
+                                             pool);
+  apr_pool_t *first_pool = svn_pool_create(conn->pool);
+  apr_pool_t *iterpool = svn_pool_create(conn->pool);
+  const svn_ra_svn__item_t *first;
+  const svn_ra_svn__item_t *item;
+  const char *first_data;
+  int i;
+
+  /* Pin the first buffer for the whole run. */
+  SVN_ERR(read_string_item(&first, conn, 0, first_pool));
+  first_data = first->u.string.data;
+  SVN_TEST_INT_ASSERT(conn->pinned_read_bufs, 1);
+
+  for (i = 1; i < COUNT; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(read_string_item(&item, conn, i, iterpool));
+      SVN_TEST_ASSERT(conn->pinned_read_bufs <= 2);
+    }
+
+  /* The first item still points into its buffer and is still intact. */
+  SVN_TEST_ASSERT(first->u.string.data == first_data);
+  SVN_TEST_STRING_ASSERT(first_data, apr_psprintf(pool, "%0300d", 0));
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(first_pool);
+  SVN_TEST_INT_ASSERT(conn->pinned_read_bufs, 0);
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for a stream that reads from DATA at most CHUNK_SIZE bytes at a
+ * time. */
+typedef struct chunked_baton_t
+{
+  const svn_stringbuf_t *data;
+  apr_size_t pos;
+  apr_size_t chunk_size;
+} chunked_baton_t;
+
+/* Implements svn_read_fn_t for chunked_baton_t. */
+static svn_error_t *
+chunked_read(void *baton,
+             char *buffer,
+             apr_size_t *len)
+{
+  chunked_baton_t *b = baton;
+  apr_size_t available = b->data->len - b->pos;
+
+  *len = MIN(*len, MIN(available, b->chunk_size));
+  memcpy(buffer, b->data->data + b->pos, *len);
+  b->pos += *len;
+
+  return SVN_NO_ERROR;
+}
+
+/* Return an LZ4 compressed ra_svn connection that reads DATA in chunks of
+ * at most CHUNK_SIZE bytes and discards all output. */
+static svn_error_t *
+make_lz4_reading_conn(svn_ra_svn_conn_t **conn,
+                      const svn_stringbuf_t *data,
+                      apr_size_t chunk_size,
+                      apr_pool_t *pool)
+{
+  chunked_baton_t *b = apr_pcalloc(pool, sizeof(*b));
+  svn_stream_t *in = svn_stream_create(b, pool);
+
+  b->data = data;
+  b->chunk_size = chunk_size;
+  svn_stream_set_read2(in, chunked_read, NULL);
+
+  *conn = svn_ra_svn_create_conn5(NULL, in, svn_stream_empty(pool),
+                                  SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                                  0, 0, 0, 0, pool);
+  SVN_ERR(svn_ra_svn__enable_lz4_stream(*conn, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Send the NBR_ITEMS ITEMS as strings over an LZ4 compressed connection,
+ * flushing after each of them, and return the data put on the wire in
+ * *WIRE_DATA. */
+static svn_error_t *
+lz4_write_items(svn_stringbuf_t **wire_data,
+                const svn_string_t *items[],
+                int nbr_items,
+                apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *conn;
+  int i;
+
+  *wire_data = svn_stringbuf_create_empty(pool);
+  conn = svn_ra_svn_create_conn5(NULL, svn_stream_empty(pool),
+                                 svn_stream_from_stringbuf(*wire_data, pool),
+                                 SVN_DELTA_COMPRESSION_LEVEL_DEFAULT,
+                                 0, 0, 0, 0, pool);
+  SVN_ERR(svn_ra_svn__enable_lz4_stream(conn, pool));
+
+  /* Enabling compression twice is a no-op. */
+  SVN_ERR(svn_ra_svn__enable_lz4_stream(conn, pool));
+
+  for (i = 0; i < nbr_items; ++i)
+    {
+      SVN_ERR(svn_ra_svn__write_string(conn, pool, items[i]));
+      SVN_ERR(svn_ra_svn__flush(conn, pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Read WIRE_DATA in chunks of CHUNK_SIZE bytes from an LZ4 compressed
+ * connection and verify that it contains the NBR_ITEMS ITEMS. */
+static svn_error_t *
+lz4_verify_items(const svn_stringbuf_t *wire_data,
+                 apr_size_t chunk_size,
+                 const svn_string_t *items[],
+                 int nbr_items,
+                 apr_pool_t *pool)
+{
+  svn_ra_svn_conn_t *conn;
+  svn_ra_svn__item_t *item;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  SVN_ERR(make_lz4_reading_conn(&conn, wire_data, chunk_size, pool));
+  for (i = 0; i < nbr_items; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_ra_svn__read_item(conn, iterpool, &item));
+      SVN_TEST_ASSERT(item->kind == SVN_RA_SVN_STRING);
+      SVN_TEST_INT_ASSERT(item->u.string.len, items[i]->len);
+      SVN_TEST_ASSERT(memcmp(item->u.string.data, items[i]->data,
+                             items[i]->len) == 0);
+    }
+
+  /* All data has been consumed. */
+  SVN_TEST_ASSERT_ERROR(svn_ra_svn__read_item(conn, iterpool, &item),
+                        SVN_ERR_RA_SVN_CONNECTION_CLOSED);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Data sent over LZ4 compressed connections must arrive unchanged, no
+ * matter how it is split into frames and how the frames arrive. */
+static svn_error_t *
+ra_svn_lz4_stream_roundtrip(apr_pool_t *pool)
+{
+  enum { RANDOM_SIZE = 200000, TEXT_SIZE = 100000 };
+  const apr_size_t chunk_sizes[] = { 1, 7, 4096, 1000000 };
+  const svn_string_t *items[5];
+  svn_stringbuf_t *text = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *noise = svn_stringbuf_create_ensure(RANDOM_SIZE, pool);
+  svn_stringbuf_t *wire_data;
+  apr_uint32_t seed = (apr_uint32_t) apr_time_now();
+  apr_size_t i;
+
+  if (! svn__lz4_supported())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "LZ4 is not supported by this build");
+
+  while (text->len < TEXT_SIZE)
+    svn_stringbuf_appendcstr(text, "all work and no play\n");
+  for (i = 0; i < RANDOM_SIZE; ++i)
+    svn_stringbuf_appendbyte(noise, (char)svn_test_rand(&seed));
+
+  /* Small frames, compressible and incompressible data spanning multiple
+     frames, and an empty item. */
+  items[0] = svn_string_create("x", pool);
+  items[1] = svn_string_create_from_buf(text, pool);
+  items[2] = svn_string_create_from_buf(noise, pool);
+  items[3] = svn_string_create("", pool);
+  items[4] = svn_string_create("small frame", pool);
+
+  SVN_ERR(lz4_write_items(&wire_data, items, 5, pool));
+
+  /* The compressible data got compressed and the incompressible data did
+     not expand much. */
+  SVN_TEST_ASSERT(wire_data->len < RANDOM_SIZE + TEXT_SIZE / 2);
+  SVN_TEST_ASSERT(wire_data->len > RANDOM_SIZE);
+
+  for (i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); ++i)
+    SVN_ERR(lz4_verify_items(wire_data, chunk_sizes[i], items, 5, pool));
+
+  /* Invalid frame sizes get detected. */
+  {
+    svn_ra_svn_conn_t *conn;
+    svn_ra_svn__item_t *item;
+    svn_stringbuf_t *bad_data = svn_stringbuf_create_empty(pool);
+
+    svn_stringbuf_appendbyte(bad_data, 0);
+    svn_stringbuf_appendcstr(bad_data, "1:x ");
+    SVN_ERR(make_lz4_reading_conn(&conn, bad_data, 100, pool));
+    SVN_TEST_ASSERT_ERROR(svn_ra_svn__read_item(conn, pool, &item),
+                          SVN_ERR_RA_SVN_MALFORMED_DATA);
+  }
+
+  return SVN_NO_ERROR;
+}
+
+/* Open a session to the repository REPOS_NAME through a tunnel to svnserve
+ * running with the --compression level given in B. */
+static svn_error_t *
+open_tunnel_session(svn_ra_session_t **session,
+                    tunnel_baton_t *b,
+                    const char *repos_name,
+                    apr_pool_t *pool)
+{
+  const char *url;
+  svn_ra_callbacks2_t *cbtable;
+
+  url = apr_pstrcat(pool, "svn+test://localhost/", repos_name, SVN_VA_NULL);
+  SVN_ERR(svn_ra_create_callbacks(&cbtable, pool));
+  cbtable->check_tunnel_func = check_tunnel;
+  cbtable->open_tunnel_func = open_tunnel;
+  cbtable->tunnel_baton = b;
+  SVN_ERR(svn_cmdline_create_auth_baton2(&cbtable->auth_baton,
+                                         TRUE  /* non_interactive */,
+                                         "jrandom", "rayjandom",
+                                         NULL,
+                                         TRUE  /* no_auth_cache */,
+                                         FALSE /* trust_server_cert */,
+                                         FALSE, FALSE, FALSE, FALSE,
+                                         NULL, NULL, NULL, pool));
+
+  SVN_ERR(svn_ra_open4(session, NULL, url, NULL, cbtable, NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* The lz4-stream capability gets used if both sides support it and the
+ * connection works either way. */
+static svn_error_t *
+tunnel_lz4_stream_test(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  tunnel_baton_t *b = apr_pcalloc(pool, sizeof(*b));
+  apr_pool_t *scratch_pool = svn_pool_create(pool);
+  const char tunnel_repos_name[] = "test-repo-tunnel-lz4-stream";
+  const char *compression_levels[] = { NULL, "0" };
+  int i;
+
+  b->magic = TUNNEL_MAGIC;
+
+  SVN_ERR(svn_test__create_repos(NULL, tunnel_repos_name, opts, scratch_pool));
+
+  /* Immediately close the repository to avoid race condition with svnserve
+     (and then the cleanup code) with BDB when our pool is cleared. */
+  svn_pool_clear(scratch_pool);
+
+  for (i = 0; i < 2; ++i)
+    {
+      svn_ra_session_t *session;
+      svn_ra_svn__session_baton_t *sess_baton;
+      svn_boolean_t expect_lz4;
+      apr_hash_t *dirents;
+      svn_dirent_t *dirent;
+
+      svn_pool_clear(scratch_pool);
+
+      /* Without compression, svnserve won't offer the lz4-stream
+         capability. */
+      b->compression = compression_levels[i];
+      expect_lz4 = svn__lz4_supported() && !b->compression;
+
+      SVN_ERR(open_tunnel_session(&session, b, tunnel_repos_name,
+                                  scratch_pool));
+      sess_baton = session->priv;
+      SVN_TEST_ASSERT(!sess_baton->conn->lz4_stream == !expect_lz4);
+      SVN_TEST_ASSERT(!svn_ra_svn_has_capability(sess_baton->conn,
+                                                 SVN_RA_SVN_CAP_LZ4_STREAM)
+                      == !expect_lz4);
+
+      /* Do some work, including data transfers in both directions. */
+      if (i == 0)
+        SVN_ERR(commit_tree(session, scratch_pool));
+
+      SVN_ERR(svn_ra_get_dir2(session, &dirents, NULL, NULL, "A/B", 1,
+                              SVN_DIRENT_KIND, scratch_pool));
+      SVN_TEST_INT_ASSERT(apr_hash_count(dirents), 2);
+      dirent = svn_hash_gets(dirents, "f");
+      SVN_TEST_ASSERT(dirent && dirent->kind == svn_node_file);
+
+      SVN_ERR(check_paths_batches(session, scratch_pool));
+    }
+
+  svn_pool_destroy(scratch_pool);
+  SVN_TEST_ASSERT(b->open_count == 0);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -1716,6 +2300,20 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "verify checkout over a tunnel"),
     SVN_TEST_OPTS_PASS(commit_empty_last_change,
                        "check how last change applies to empty commit"),
+    SVN_TEST_OPTS_PASS(check_paths_test,
+                       "check multiple paths at once"),
+    SVN_TEST_OPTS_PASS(tunnel_check_paths_test,
+                       "check multiple paths at once over ra_svn"),
+    SVN_TEST_PASS2(ra_svn_readbuf_pinning,
+                   "limit read buffers pinned by ra_svn items"),
+    SVN_TEST_PASS2(ra_svn_readbuf_release,
+                   "release ra_svn read buffer pins"),
+    SVN_TEST_PASS2(ra_svn_readbuf_replace,
+                   "replace pinned ra_svn read buffers"),
+    SVN_TEST_PASS2(ra_svn_lz4_stream_roundtrip,
+                   "round-trip data over LZ4 compressed connections"),
+    SVN_TEST_OPTS_PASS(tunnel_lz4_stream_test,
+                       "negotiate LZ4 compressed ra_svn connections"),
     SVN_TEST_NULL
   };
 
@@ -270,6 +270,54 @@ split_url_test(const svn_test_opts_t *opts,
 }
 
 
+/* Check that repository objects get reused by later sessions but are
+   never shared by concurrent ones nor survive re-creating the repository.
+ */
+static svn_error_t *
+reuse_repos(const svn_test_opts_t *opts,
+            apr_pool_t *pool)
+{
+  svn_repos_t *repos, *repos1, *repos2, *repos3;
+  const char *url, *repos_path, *fs_path, *uuid1, *uuid2;
+  apr_pool_t *subpool1 = svn_pool_create(pool);
+  apr_pool_t *subpool2 = svn_pool_create(pool);
+
+  if (strcmp(opts->fs_type, SVN_FS_TYPE_BDB) == 0)
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "BDB repositories are never reused");
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-reuse", opts, pool));
+  SVN_ERR(svn_uri_get_file_url_from_dirent(&url, "test-repo-reuse", pool));
+
+  /* Released objects get reused. */
+  SVN_ERR(svn_ra_local__split_URL(&repos1, &repos_path, &fs_path, url,
+                                  subpool1));
+  SVN_ERR(svn_fs_get_uuid(svn_repos_fs(repos1), &uuid1, pool));
+  svn_pool_clear(subpool1);
+  SVN_ERR(svn_ra_local__split_URL(&repos2, &repos_path, &fs_path, url,
+                                  subpool1));
+  SVN_TEST_ASSERT(repos1 == repos2);
+
+  /* Objects in use don't. */
+  SVN_ERR(svn_ra_local__split_URL(&repos3, &repos_path, &fs_path, url,
+                                  subpool2));
+  SVN_TEST_ASSERT(repos2 != repos3);
+  svn_pool_clear(subpool1);
+  svn_pool_clear(subpool2);
+
+  /* A re-created repository is not mistaken for the old one. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-reuse", opts, pool));
+  SVN_ERR(svn_ra_local__split_URL(&repos1, &repos_path, &fs_path, url,
+                                  subpool1));
+  SVN_ERR(svn_fs_get_uuid(svn_repos_fs(repos1), &uuid2, pool));
+  SVN_TEST_ASSERT(strcmp(uuid1, uuid2) != 0);
+  svn_pool_destroy(subpool1);
+  svn_pool_destroy(subpool2);
+
+  return SVN_NO_ERROR;
+}
+
+
 
 /* The test table.  */
 
@@ -296,6 +344,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "svn_ra_local__split_URL: valid host names"),
     SVN_TEST_OPTS_PASS(split_url_test,
                        "test svn_ra_local__split_URL correctness"),
+    SVN_TEST_OPTS_PASS(reuse_repos,
+                       "reuse repository objects across sessions"),
     SVN_TEST_NULL
   };
 
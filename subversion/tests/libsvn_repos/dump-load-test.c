@@ -27,6 +27,7 @@
 #include "svn_pools.h"
 #include "svn_error.h"
 #include "svn_fs.h"
+#include "svn_hash.h"
 #include "svn_repos.h"
 #include "private/svn_repos_private.h"
 
@@ -272,6 +273,83 @@ test_load_r0_mergeinfo(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Dump all revisions of REPOS, with deltas if USE_DELTAS is set, and
+   return the dump stream data in *DUMP_DATA_P. */
+static svn_error_t *
+dump_all(svn_stringbuf_t **dump_data_p,
+         svn_repos_t *repos,
+         svn_boolean_t use_deltas,
+         apr_pool_t *pool)
+{
+  *dump_data_p = svn_stringbuf_create_empty(pool);
+  SVN_ERR(svn_repos_dump_fs4(repos,
+                             svn_stream_from_stringbuf(*dump_data_p, pool),
+                             SVN_INVALID_REVNUM, SVN_INVALID_REVNUM,
+                             FALSE, use_deltas, TRUE, TRUE,
+                             NULL, NULL, NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Concurrent dumps must produce the same stream as sequential ones. */
+static svn_error_t *
+test_dump_concurrently(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev = 0;
+  apr_hash_t *fs_config;
+  svn_stringbuf_t *sequential, *concurrent;
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-dump-concurrently",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* r1: the greek tree */
+  SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* Enough revisions to span several dump jobs. */
+  for (i = 0; i < 50; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_fs_begin_txn2(&txn, fs, youngest_rev, 0, iterpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, iterpool));
+      SVN_ERR(svn_test__set_file_contents(txn_root,
+                                          i % 2 ? "/iota" : "/A/mu",
+                                          apr_psprintf(iterpool,
+                                                       "Change %d\n", i),
+                                          iterpool));
+      if (i % 7 == 0)
+        SVN_ERR(svn_fs_copy(NULL, "/A/B", txn_root,
+                            apr_psprintf(iterpool, "/A/B%d", i), iterpool));
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      iterpool));
+    }
+
+  svn_pool_destroy(iterpool);
+
+  SVN_ERR(dump_all(&sequential, repos, TRUE, pool));
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_DUMP_JOBS, "3");
+  SVN_ERR(svn_repos_open3(&repos, svn_repos_path(repos, pool), fs_config,
+                          pool, pool));
+  SVN_ERR(dump_all(&concurrent, repos, TRUE, pool));
+
+  SVN_TEST_ASSERT(svn_stringbuf_compare(sequential, concurrent));
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -283,6 +361,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test dumping with r0 mergeinfo"),
     SVN_TEST_OPTS_PASS(test_load_r0_mergeinfo,
                        "test loading with r0 mergeinfo"),
+    SVN_TEST_OPTS_PASS(test_dump_concurrently,
+                       "test dumping with several jobs"),
     SVN_TEST_NULL
   };
 
@@ -34,6 +34,7 @@
 #include "svn_hash.h"
 #include "svn_repos.h"
 #include "svn_path.h"
+#include "svn_dirent_uri.h"
 #include "svn_delta.h"
 #include "svn_config.h"
 #include "svn_props.h"
@@ -41,6 +42,7 @@
 #include "svn_version.h"
 #include "private/svn_repos_private.h"
 #include "private/svn_dep_compat.h"
+#include "private/svn_thread.h"
 
 /* be able to look into svn_config_t */
 #include "../../libsvn_subr/config_impl.h"
@@ -1575,6 +1577,442 @@ test_authz_wildcard_performance(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Two versions of the rules used by the authz reload tests.  Only HARRY's
+ * access differs between them, so SALLY's filtered rules and decisions
+ * may be shared across reloads. */
+static const char *reload_rules1 =
+  "[/]"                                                                      NL
+  "* = r"                                                                    NL
+  ""                                                                         NL
+  "[/A/B]"                                                                   NL
+  "harry = rw"                                                               NL
+  ""                                                                         NL
+  "[:glob:/**/secret*]"                                                      NL
+  "harry ="                                                                  NL
+  "sally = rw"                                                               NL;
+
+static const char *reload_rules2 =
+  "[/]"                                                                      NL
+  "* = r"                                                                    NL
+  ""                                                                         NL
+  "[/A/B]"                                                                   NL
+  "harry ="                                                                  NL
+  ""                                                                         NL
+  "[:glob:/**/secret*]"                                                      NL
+  "harry = r"                                                                NL
+  "sally = rw"                                                               NL;
+
+/* Duplicate sections make the rules invalid. */
+static const char *reload_rules_invalid =
+  "[/]"                                                                      NL
+  "* = r"                                                                    NL
+  ""                                                                         NL
+  "[/]"                                                                      NL
+  "* ="                                                                      NL;
+
+static const char *reload_users[] = { "harry", "sally", "mallory" };
+static const char *reload_paths[] = { "/", "/A", "/A/secret", "/A/B",
+                                      "/A/B/secret", "/A/B/secret/x",
+                                      "/A/B/E/alpha" };
+static const svn_repos_authz_access_t reload_access[] = {
+  svn_authz_read,
+  svn_authz_write,
+  svn_authz_read | svn_authz_recursive,
+  svn_authz_write | svn_authz_recursive
+};
+
+#define RELOAD_USER_DECISIONS \
+  (sizeof(reload_paths) / sizeof(reload_paths[0]) \
+   * sizeof(reload_access) / sizeof(reload_access[0]))
+#define RELOAD_DECISIONS \
+  (sizeof(reload_users) / sizeof(reload_users[0]) * RELOAD_USER_DECISIONS)
+
+/* Fill DECISIONS with AUTHZ's answers for all combinations of
+ * RELOAD_USERS, RELOAD_PATHS and RELOAD_ACCESS.  Ask twice and fail if the
+ * second answer, which may come from the decision cache, differs.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+get_reload_decisions(svn_boolean_t decisions[RELOAD_DECISIONS],
+                     svn_authz_t *authz,
+                     apr_pool_t *pool)
+{
+  int round;
+
+  for (round = 0; round < 2; ++round)
+    {
+      apr_size_t i, k, m, n = 0;
+
+      for (i = 0; i < sizeof(reload_users) / sizeof(reload_users[0]); ++i)
+        for (k = 0; k < sizeof(reload_paths) / sizeof(reload_paths[0]); ++k)
+          for (m = 0; m < sizeof(reload_access) / sizeof(reload_access[0]);
+               ++m, ++n)
+            {
+              svn_boolean_t granted;
+
+              SVN_ERR(svn_repos_authz_check_access(authz, "greek",
+                                                   reload_paths[k],
+                                                   reload_users[i],
+                                                   reload_access[m],
+                                                   &granted, pool));
+              if (round == 0)
+                decisions[n] = granted;
+              else if (decisions[n] != granted)
+                return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                         "Repeated authz check for user "
+                                         "'%s' on '%s' changed its answer",
+                                         reload_users[i], reload_paths[k]);
+            }
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set DECISIONS to the answers of a freshly parsed, uncached model of
+ * RULES.  Use POOL for temporary allocations. */
+static svn_error_t *
+get_expected_decisions(svn_boolean_t decisions[RELOAD_DECISIONS],
+                       const char *rules,
+                       apr_pool_t *pool)
+{
+  svn_authz_t *authz;
+
+  SVN_ERR(authz_get_handle(&authz, rules, FALSE, pool));
+  SVN_ERR(get_reload_decisions(decisions, authz, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the version, 1 or 2, whose EXPECTED1 or EXPECTED2 answers equal
+ * DECISIONS and 0 if neither does. */
+static int
+reload_version(const svn_boolean_t decisions[RELOAD_DECISIONS],
+               const svn_boolean_t expected1[RELOAD_DECISIONS],
+               const svn_boolean_t expected2[RELOAD_DECISIONS])
+{
+  if (!memcmp(decisions, expected1, RELOAD_DECISIONS * sizeof(*decisions)))
+    return 1;
+  if (!memcmp(decisions, expected2, RELOAD_DECISIONS * sizeof(*decisions)))
+    return 2;
+
+  return 0;
+}
+
+/* Read the authz file at PATH, in the background if BACKGROUND is set,
+ * and return its version as per reload_version() in *VERSION.
+ * Use POOL for all allocations. */
+static svn_error_t *
+read_reload_version(int *version,
+                    const char *path,
+                    svn_boolean_t background,
+                    const svn_boolean_t expected1[RELOAD_DECISIONS],
+                    const svn_boolean_t expected2[RELOAD_DECISIONS],
+                    apr_pool_t *pool)
+{
+  svn_authz_t *authz;
+  svn_boolean_t decisions[RELOAD_DECISIONS];
+
+  SVN_ERR(svn_repos__authz_read(&authz, path, NULL, TRUE, background, NULL,
+                                pool, pool));
+  SVN_ERR(get_reload_decisions(decisions, authz, pool));
+  *version = reload_version(decisions, expected1, expected2);
+
+  return SVN_NO_ERROR;
+}
+
+/* Replace the contents of the authz file at PATH with RULES.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+write_reload_rules(const char *path,
+                   const char *rules,
+                   apr_pool_t *pool)
+{
+  return svn_error_trace(svn_io_write_atomic2(path, rules, strlen(rules),
+                                              NULL, FALSE, pool));
+}
+
+/* Set up the authz cache, set *PATH to a new authz file named NAME
+ * containing RELOAD_RULES1 and fill EXPECTED1 and EXPECTED2 with the
+ * answers for both rule versions.  Allocate *PATH in POOL. */
+static svn_error_t *
+init_authz_reload(const char **path,
+                  const char *name,
+                  svn_boolean_t expected1[RELOAD_DECISIONS],
+                  svn_boolean_t expected2[RELOAD_DECISIONS],
+                  apr_pool_t *pool)
+{
+  const char *wrk_dir = svn_test_data_path("authz_reload", pool);
+  apr_size_t i;
+
+  /* The cache outlives this test. */
+  SVN_ERR(svn_repos_authz_initialize(
+            apr_allocator_owner_get(svn_pool_create_allocator(TRUE))));
+
+  SVN_ERR(get_expected_decisions(expected1, reload_rules1, pool));
+  SVN_ERR(get_expected_decisions(expected2, reload_rules2, pool));
+
+  /* Only HARRY's answers may differ and some of them must. */
+  SVN_TEST_ASSERT(memcmp(expected1, expected2,
+                         RELOAD_USER_DECISIONS * sizeof(*expected1)));
+  for (i = RELOAD_USER_DECISIONS; i < RELOAD_DECISIONS; ++i)
+    SVN_TEST_ASSERT(expected1[i] == expected2[i]);
+
+  SVN_ERR(svn_io_make_dir_recursively(wrk_dir, pool));
+  *path = svn_dirent_join(wrk_dir, name, pool);
+  SVN_ERR(write_reload_rules(*path, reload_rules1, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Test that cached authz models and decisions follow changes to the
+ * rules file and that older models keep their answers. */
+static svn_error_t *
+test_authz_reload(apr_pool_t *pool)
+{
+  const char *path;
+  svn_authz_t *authz1, *authz2;
+  svn_boolean_t expected1[RELOAD_DECISIONS];
+  svn_boolean_t expected2[RELOAD_DECISIONS];
+  svn_boolean_t decisions[RELOAD_DECISIONS];
+  int version;
+
+  SVN_ERR(init_authz_reload(&path, "reload", expected1, expected2, pool));
+
+  /* Fill the caches and read them back. */
+  SVN_ERR(svn_repos_authz_read3(&authz1, path, NULL, TRUE, NULL, pool, pool));
+  SVN_ERR(get_reload_decisions(decisions, authz1, pool));
+  SVN_TEST_INT_ASSERT(reload_version(decisions, expected1, expected2), 1);
+
+  SVN_ERR(read_reload_version(&version, path, FALSE, expected1, expected2,
+                              pool));
+  SVN_TEST_INT_ASSERT(version, 1);
+
+  /* Changing the rules must invalidate HARRY's cached decisions only. */
+  SVN_ERR(write_reload_rules(path, reload_rules2, pool));
+  SVN_ERR(svn_repos_authz_read3(&authz2, path, NULL, TRUE, NULL, pool, pool));
+  SVN_ERR(get_reload_decisions(decisions, authz2, pool));
+  SVN_TEST_INT_ASSERT(reload_version(decisions, expected1, expected2), 2);
+
+  /* The old model is unaffected. */
+  SVN_ERR(get_reload_decisions(decisions, authz1, pool));
+  SVN_TEST_INT_ASSERT(reload_version(decisions, expected1, expected2), 1);
+
+  /* Switching back re-uses the first model's cache entries. */
+  SVN_ERR(write_reload_rules(path, reload_rules1, pool));
+  SVN_ERR(read_reload_version(&version, path, FALSE, expected1, expected2,
+                              pool));
+  SVN_TEST_INT_ASSERT(version, 1);
+
+  SVN_ERR(get_reload_decisions(decisions, authz2, pool));
+  SVN_TEST_INT_ASSERT(reload_version(decisions, expected1, expected2), 2);
+
+  return SVN_NO_ERROR;
+}
+
+/* Read the authz file at PATH in the background until it yields the
+ * rules of version WANTED while never returning anything but the versions
+ * in EXPECTED1 or EXPECTED2.  Give up after about 10 seconds.
+ * Use POOL for temporary allocations. */
+static svn_error_t *
+wait_for_reload(const char *path,
+                int wanted,
+                const svn_boolean_t expected1[RELOAD_DECISIONS],
+                const svn_boolean_t expected2[RELOAD_DECISIONS],
+                apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int i, version = 0;
+
+  for (i = 0; i < 1000 && version != wanted; ++i)
+    {
+      svn_pool_clear(iterpool);
+      if (i)
+        apr_sleep(apr_time_from_msec(10));
+
+      SVN_ERR(read_reload_version(&version, path, TRUE, expected1,
+                                  expected2, iterpool));
+      SVN_TEST_ASSERT(version != 0);
+    }
+
+  svn_pool_destroy(iterpool);
+  SVN_TEST_INT_ASSERT(version, wanted);
+
+  return SVN_NO_ERROR;
+}
+
+/* Test that models reloaded in the background eventually replace the
+ * older ones and that parser errors get reported. */
+static svn_error_t *
+test_authz_background_reload(apr_pool_t *pool)
+{
+  const char *path;
+  svn_boolean_t expected1[RELOAD_DECISIONS];
+  svn_boolean_t expected2[RELOAD_DECISIONS];
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_error_t *err = SVN_NO_ERROR;
+  int i, version;
+
+  SVN_ERR(init_authz_reload(&path, "background", expected1, expected2,
+                            pool));
+
+  /* There is no older snapshot, so we get the current rules. */
+  SVN_ERR(read_reload_version(&version, path, TRUE, expected1, expected2,
+                              pool));
+  SVN_TEST_INT_ASSERT(version, 1);
+
+  SVN_ERR(write_reload_rules(path, reload_rules2, pool));
+  SVN_ERR(wait_for_reload(path, 2, expected1, expected2, pool));
+
+  /* Invalid rules must not be hidden behind the last valid snapshot. */
+  SVN_ERR(write_reload_rules(path, reload_rules_invalid, pool));
+  for (i = 0; i < 1000 && !err; ++i)
+    {
+      svn_pool_clear(iterpool);
+      if (i)
+        apr_sleep(apr_time_from_msec(10));
+
+      err = read_reload_version(&version, path, TRUE, expected1, expected2,
+                                iterpool);
+      if (!err)
+        SVN_TEST_INT_ASSERT(version, 2);
+    }
+
+  SVN_TEST_ASSERT(err);
+  SVN_TEST_ASSERT(svn_error_find_cause(err, SVN_ERR_AUTHZ_INVALID_CONFIG));
+  svn_error_clear(err);
+
+  /* Once failed, the errors stick until the rules get fixed. */
+  err = read_reload_version(&version, path, TRUE, expected1, expected2,
+                            iterpool);
+  SVN_TEST_ASSERT(err);
+  svn_error_clear(err);
+
+  SVN_ERR(write_reload_rules(path, reload_rules1, pool));
+  SVN_ERR(wait_for_reload(path, 1, expected1, expected2, pool));
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* A job for test_authz_concurrent_reload. */
+typedef struct authz_reload_job_t
+{
+  /* The authz file shared by all jobs. */
+  const char *path;
+
+  /* Rewrite the rules instead of reading them? */
+  svn_boolean_t writer;
+
+  /* Reload in the background? */
+  svn_boolean_t background;
+
+  /* Answers expected for either version of the rules. */
+  const svn_boolean_t *expected1;
+  const svn_boolean_t *expected2;
+
+  /* Private to this job. */
+  apr_pool_t *pool;
+
+  /* Result. */
+  svn_error_t *err;
+} authz_reload_job_t;
+
+/* Number of rewrites resp. reads that each job performs. */
+#define RELOAD_ITERATIONS 100
+
+/* Perform the reads or writes of JOB. */
+static svn_error_t *
+run_authz_reload_job(authz_reload_job_t *job)
+{
+  apr_pool_t *iterpool = svn_pool_create(job->pool);
+  int i, version;
+
+  for (i = 0; i < RELOAD_ITERATIONS; ++i)
+    {
+      svn_pool_clear(iterpool);
+
+      if (job->writer)
+        {
+          SVN_ERR(write_reload_rules(job->path,
+                                     i % 2 ? reload_rules1 : reload_rules2,
+                                     iterpool));
+          apr_sleep(apr_time_from_msec(1));
+        }
+      else
+        {
+          SVN_ERR(read_reload_version(&version, job->path, job->background,
+                                      job->expected1, job->expected2,
+                                      iterpool));
+          if (version == 0)
+            return svn_error_createf(SVN_ERR_TEST_FAILED, NULL,
+                                     "Authz model read from '%s' mixes "
+                                     "answers of different rule versions",
+                                     job->path);
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_thread__job_func_t for authz_reload_job_t. */
+static void
+authz_reload_job_func(void *job,
+                      int thread_index,
+                      void *baton)
+{
+  authz_reload_job_t *reload_job = job;
+  reload_job->err = run_authz_reload_job(reload_job);
+}
+
+/* Test that readers see consistent authz models while the rules get
+ * rewritten concurrently. */
+static svn_error_t *
+test_authz_concurrent_reload(apr_pool_t *pool)
+{
+  enum { JOB_COUNT = 5 };
+
+  const char *path;
+  svn_boolean_t expected1[RELOAD_DECISIONS];
+  svn_boolean_t expected2[RELOAD_DECISIONS];
+  apr_array_header_t *jobs = apr_array_make(pool, JOB_COUNT,
+                                            sizeof(authz_reload_job_t *));
+  apr_pool_t *jobs_pool
+    = apr_allocator_owner_get(svn_pool_create_allocator(TRUE));
+  svn_error_t *err = SVN_NO_ERROR;
+  int i;
+
+  SVN_ERR(init_authz_reload(&path, "concurrent", expected1, expected2,
+                            pool));
+
+  /* One writer and several readers, half of them reloading in the
+   * background. */
+  for (i = 0; i < JOB_COUNT; ++i)
+    {
+      authz_reload_job_t *job = apr_pcalloc(pool, sizeof(*job));
+      job->path = path;
+      job->writer = (i == 0);
+      job->background = (i % 2 == 0);
+      job->expected1 = expected1;
+      job->expected2 = expected2;
+      job->pool = svn_pool_create(jobs_pool);
+
+      APR_ARRAY_PUSH(jobs, authz_reload_job_t *) = job;
+    }
+
+  svn_thread__run_batch(jobs, authz_reload_job_func, NULL, JOB_COUNT);
+
+  for (i = 0; i < JOB_COUNT; ++i)
+    err = svn_error_compose_create(err,
+                                   APR_ARRAY_IDX(jobs, i,
+                                                 authz_reload_job_t *)->err);
+
+  svn_pool_destroy(jobs_pool);
+
+  return svn_error_trace(err);
+}
+
 /* Test that the latest definition wins, regardless of whether the ":glob:"
  * prefix has been given. */
 static svn_error_t *
@@ -3274,6 +3712,137 @@ reporter_depth_exclude(const svn_test_opts_t *opts,
 }
 
 
+/* Baton for the authz callbacks and the editor used by
+   reporter_subtree_authz(). */
+struct subtree_authz_baton_t
+{
+  svn_authz_t *authz;
+  int read_checks;
+  int absent_dirs;
+};
+
+/* Implements svn_repos_authz_func_t, counting the calls in BATON. */
+static svn_error_t *
+count_read_checks(svn_boolean_t *allowed,
+                  svn_fs_root_t *root,
+                  const char *path,
+                  void *baton,
+                  apr_pool_t *pool)
+{
+  struct subtree_authz_baton_t *sab = baton;
+
+  ++sab->read_checks;
+  return svn_repos_authz_check_access(sab->authz, NULL, path, NULL,
+                                      svn_authz_read, allowed, pool);
+}
+
+/* Implements svn_repos_authz_callback_t. */
+static svn_error_t *
+check_subtree_access(svn_repos_authz_access_t required,
+                     svn_boolean_t *allowed,
+                     svn_fs_root_t *root,
+                     const char *path,
+                     void *baton,
+                     apr_pool_t *pool)
+{
+  struct subtree_authz_baton_t *sab = baton;
+
+  return svn_repos_authz_check_access(sab->authz, NULL, path, NULL,
+                                      required, allowed, pool);
+}
+
+/* Editor callbacks passing the edit baton down to all directories. */
+static svn_error_t *
+subtree_authz_open_root(void *edit_baton,
+                        svn_revnum_t base_revision,
+                        apr_pool_t *dir_pool,
+                        void **root_baton)
+{
+  *root_baton = edit_baton;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+subtree_authz_add_directory(const char *path,
+                            void *parent_baton,
+                            const char *copyfrom_path,
+                            svn_revnum_t copyfrom_revision,
+                            apr_pool_t *dir_pool,
+                            void **child_baton)
+{
+  *child_baton = parent_baton;
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+subtree_authz_absent_directory(const char *path,
+                               void *parent_baton,
+                               apr_pool_t *pool)
+{
+  struct subtree_authz_baton_t *sab = parent_baton;
+
+  ++sab->absent_dirs;
+  return SVN_NO_ERROR;
+}
+
+/* Test that the reporter skips per-path authz checks within fully
+   readable sub-trees. */
+static svn_error_t *
+reporter_subtree_authz(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  svn_delta_editor_t *editor;
+  void *report_baton;
+  struct subtree_authz_baton_t sab = { 0 };
+  const char *contents =
+    "[/]"                                                                    NL
+    "* = r"                                                                  NL
+    ""                                                                       NL
+    "[/A/B]"                                                                 NL
+    "* ="                                                                    NL;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-reporter-subtree-authz",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(youngest_rev));
+
+  SVN_ERR(authz_get_handle(&sab.authz, contents, FALSE, pool));
+
+  editor = svn_delta_default_editor(pool);
+  editor->open_root = subtree_authz_open_root;
+  editor->add_directory = subtree_authz_add_directory;
+  editor->absent_directory = subtree_authz_absent_directory;
+
+  /* Check out the whole tree. */
+  SVN_ERR(svn_repos_begin_report3(&report_baton, youngest_rev, repos,
+                                  "/", "", NULL, TRUE, svn_depth_infinity,
+                                  FALSE, FALSE, editor, &sab,
+                                  count_read_checks, &sab, 0, pool));
+  svn_repos__report_set_subtree_authz(report_baton, check_subtree_access,
+                                      &sab);
+  SVN_ERR(svn_repos_set_path3(report_baton, "", 0, svn_depth_infinity,
+                              TRUE, NULL, pool));
+  SVN_ERR(svn_repos_finish_report(report_baton, pool));
+
+  /* A/B must still be denied.  Only the anchor, the children of / and
+     those of /A need individual checks. */
+  SVN_TEST_INT_ASSERT(sab.absent_dirs, 1);
+  SVN_TEST_INT_ASSERT(sab.read_checks, 1 + 2 + 4);
+
+  return SVN_NO_ERROR;
+}
+
+
 
 /* Test if prop values received by the server are validated.
  * These tests "send" property values to the server and diagnose the
@@ -3512,6 +4081,126 @@ get_logs(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Log receiver which appends the revision to the array in BATON. */
+static svn_error_t *
+log_rev_receiver(void *baton,
+                 svn_log_entry_t *log_entry,
+                 apr_pool_t *pool)
+{
+  apr_array_header_t *revs = baton;
+  APR_ARRAY_PUSH(revs, svn_revnum_t) = log_entry->revision;
+  return SVN_NO_ERROR;
+}
+
+/* Several paths change in the same revisions, some of the paths
+ * contain others and some histories end early.  Each revision must still
+ * be reported exactly once and in order. */
+static svn_error_t *
+get_logs_multiple_paths(const svn_test_opts_t *opts,
+                        apr_pool_t *pool)
+{
+  /* Files changed in r2 and later, with bit I referring to FILES[I].
+     The first change to A/new adds it. */
+  const char *files[] = { "iota", "A/mu", "A/D/gamma", "A/D/G/pi",
+                          "A/B/lambda", "A/new" };
+  const int changes[] = { 0x1F, 0x01, 0x10, 0x06, 0x20, 0x0C,
+                          0x23, 0x10, 0x04, 0x3F, 0x08, 0x02 };
+  /* Files affecting the log of the target paths below. */
+  const int targets_mask = 0x2F;
+  const char *targets[] = { "/A/D/gamma", "/iota", "/A/new", "/A/D",
+                            "/A/mu" };
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev = 0;
+  apr_array_header_t *paths;
+  apr_array_header_t *expected;
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_boolean_t new_added = FALSE;
+  int i, limit;
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-get-logs-multiple-paths",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* Revision 1:  Add the Greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, subpool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, subpool));
+
+  /* All targets but A/new get reported for r1. */
+  expected = apr_array_make(pool, 16, sizeof(svn_revnum_t));
+  APR_ARRAY_PUSH(expected, svn_revnum_t) = youngest_rev;
+
+  for (i = 0; i < sizeof(changes) / sizeof(changes[0]); i++)
+    {
+      int f;
+
+      svn_pool_clear(subpool);
+      SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, subpool));
+      SVN_ERR(svn_fs_txn_root(&txn_root, txn, subpool));
+      for (f = 0; f < sizeof(files) / sizeof(files[0]); f++)
+        if (changes[i] & (1 << f))
+          {
+            if (!strcmp(files[f], "A/new") && !new_added)
+              {
+                SVN_ERR(svn_fs_make_file(txn_root, files[f], subpool));
+                new_added = TRUE;
+              }
+            SVN_ERR(svn_test__set_file_contents(
+                      txn_root, files[f],
+                      apr_psprintf(subpool, "Revision %ld\n",
+                                   youngest_rev + 1),
+                      subpool));
+          }
+      SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn,
+                                      subpool));
+
+      if (changes[i] & targets_mask)
+        APR_ARRAY_PUSH(expected, svn_revnum_t) = youngest_rev;
+    }
+
+  paths = apr_array_make(pool, 5, sizeof(const char *));
+  for (i = 0; i < sizeof(targets) / sizeof(targets[0]); i++)
+    APR_ARRAY_PUSH(paths, const char *) = targets[i];
+
+  /* Youngest first and oldest first, with and without limits. */
+  for (limit = 0; limit <= expected->nelts; limit++)
+    {
+      int direction;
+
+      for (direction = 0; direction < 2; direction++)
+        {
+          apr_array_header_t *revs;
+          int count = limit ? limit : expected->nelts;
+
+          svn_pool_clear(subpool);
+          revs = apr_array_make(subpool, 16, sizeof(svn_revnum_t));
+          SVN_ERR(svn_repos_get_logs4(repos, paths,
+                                      direction ? 1 : youngest_rev,
+                                      direction ? youngest_rev : 1,
+                                      limit, FALSE, FALSE, FALSE, NULL,
+                                      NULL, NULL, log_rev_receiver, revs,
+                                      subpool));
+
+          SVN_TEST_INT_ASSERT(revs->nelts, count);
+          for (i = 0; i < count; i++)
+            {
+              int expected_idx = direction ? i : expected->nelts - 1 - i;
+
+              SVN_TEST_INT_ASSERT(APR_ARRAY_IDX(revs, i, svn_revnum_t),
+                                  APR_ARRAY_IDX(expected, expected_idx,
+                                                svn_revnum_t));
+            }
+        }
+    }
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
 
 /* Tests for svn_repos_get_file_revsN() */
 
@@ -3988,6 +4677,22 @@ test_config_pool(const svn_test_opts_t *opts,
       svn_pool_clear(subpool);
     }
 
+  /* modifying a config file must become visible immediately, even if
+     the timestamp may not have changed */
+  SVN_ERR(svn_io_write_atomic2(svn_dirent_join(wrk_dir,
+                                               "config-pool-test1.cfg",
+                                               pool),
+                               cfg_buffer2->data, cfg_buffer2->len, NULL,
+                               FALSE, pool));
+  SVN_ERR(svn_repos__config_pool_get(
+                                &cfg, config_pool,
+                                svn_dirent_join(wrk_dir,
+                                                "config-pool-test1.cfg",
+                                                pool),
+                                TRUE, NULL, subpool));
+  SVN_TEST_ASSERT(cfg->sections == sections2);
+  svn_pool_clear(subpool);
+
   /* create an in-repo config */
   SVN_ERR(svn_dirent_get_absolute(&repo_root_url, repo_name, pool));
   SVN_ERR(svn_uri_get_file_url_from_dirent(&repo_root_url, repo_root_url,
@@ -4466,6 +5171,212 @@ test_list(const svn_test_opts_t *opts,
   return SVN_NO_ERROR;
 }
 
+/* Implements svn_repos_dirent_receiver_t, appending PATH and the
+   created revision of DIRENT to the svn_stringbuf_t in BATON. */
+static svn_error_t *
+list_to_buffer(const char *path,
+               svn_dirent_t *dirent,
+               void *baton,
+               apr_pool_t *pool)
+{
+  svn_stringbuf_t *buffer = baton;
+  svn_stringbuf_appendcstr(buffer,
+                           apr_psprintf(pool, "%s %d %ld %s\n", path,
+                                        dirent->kind, dirent->created_rev,
+                                        dirent->last_author
+                                          ? dirent->last_author : "-"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos_authz_func_t, denying access to /A/D/G and /A/B/E
+   and everything below them. */
+static svn_error_t *
+list_authz_func(svn_boolean_t *allowed,
+                svn_fs_root_t *root,
+                const char *path,
+                void *baton,
+                apr_pool_t *pool)
+{
+  *allowed = !svn_dirent_is_ancestor("/A/D/G", path)
+          && !svn_dirent_is_ancestor("/A/B/E", path);
+
+  return SVN_NO_ERROR;
+}
+
+/* List the whole tree of revision REV in REPOS into *BUFFER, using
+   PATTERNS and our test authz function. */
+static svn_error_t *
+list_all(svn_stringbuf_t **buffer,
+         svn_repos_t *repos,
+         svn_revnum_t rev,
+         const apr_array_header_t *patterns,
+         apr_pool_t *pool)
+{
+  svn_fs_root_t *rev_root;
+
+  *buffer = svn_stringbuf_create_empty(pool);
+  SVN_ERR(svn_fs_revision_root(&rev_root, svn_repos_fs(repos), rev, pool));
+  SVN_ERR(svn_repos_list(rev_root, "/", patterns, svn_depth_infinity, FALSE,
+                         list_authz_func, NULL, list_to_buffer, *buffer,
+                         NULL, NULL, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_list_concurrently(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  apr_hash_t *fs_config;
+  apr_array_header_t *patterns;
+  svn_stringbuf_t *sequential, *concurrent;
+
+  /* Create yet another greek tree repository. */
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-list-concurrently",
+                                 opts, pool));
+  fs = svn_repos_fs(repos);
+
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(youngest_rev));
+
+  patterns = apr_array_make(pool, 1, sizeof(const char *));
+  APR_ARRAY_PUSH(patterns, const char *) = "*a*";
+
+  /* Walk the tree with one and with several threads. */
+  SVN_ERR(list_all(&sequential, repos, youngest_rev, NULL, pool));
+
+  fs_config = apr_hash_make(pool);
+  svn_hash_sets(fs_config, SVN_FS_CONFIG_LIST_JOBS, "3");
+  SVN_ERR(svn_repos_open3(&repos, svn_repos_path(repos, pool), fs_config,
+                          pool, pool));
+  SVN_ERR(list_all(&concurrent, repos, youngest_rev, NULL, pool));
+
+  SVN_TEST_ASSERT(svn_stringbuf_compare(sequential, concurrent));
+  SVN_TEST_ASSERT(strstr(sequential->data, "/A/D/H/psi") != NULL);
+  SVN_TEST_ASSERT(strstr(sequential->data, "/A/D/G") == NULL);
+
+  /* Same with a pattern that does not match all directories. */
+  SVN_ERR(list_all(&concurrent, repos, youngest_rev, patterns, pool));
+
+  SVN_ERR(svn_repos_open3(&repos, svn_repos_path(repos, pool), NULL,
+                          pool, pool));
+  SVN_ERR(list_all(&sequential, repos, youngest_rev, patterns, pool));
+
+  SVN_TEST_ASSERT(svn_stringbuf_compare(sequential, concurrent));
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_repos__blame_receiver_t.  Append "START_LINE:REVISION "
+   to the svn_stringbuf_t BATON. */
+static svn_error_t *
+blame_to_buf(void *baton,
+             apr_int64_t start_line,
+             svn_revnum_t revision,
+             apr_hash_t *rev_props,
+             apr_pool_t *scratch_pool)
+{
+  svn_stringbuf_t *buf = baton;
+
+  SVN_TEST_ASSERT(SVN_IS_VALID_REVNUM(revision) == (rev_props != NULL));
+  svn_stringbuf_appendcstr(buf,
+                           apr_psprintf(scratch_pool,
+                                        "%" APR_INT64_T_FMT ":%ld ",
+                                        start_line, revision));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_blame(const svn_test_opts_t *opts,
+           apr_pool_t *pool)
+{
+  svn_repos_t *repos;
+  svn_fs_t *fs;
+  svn_fs_txn_t *txn;
+  svn_fs_root_t *txn_root;
+  svn_revnum_t youngest_rev;
+  svn_diff_file_options_t *diff_options;
+  svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+
+  SVN_ERR(svn_test__create_repos(&repos, "test-repo-blame", opts, pool));
+  fs = svn_repos_fs(repos);
+
+  /* r1: the greek tree. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, 0, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__create_greek_tree(txn_root, pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r2: append a line to iota. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "This is the file 'iota'.\n"
+                                      "second\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  /* r3: prepend a line and change whitespace in the last one. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "first\n"
+                                      "This is the file 'iota'.\n"
+                                      "second \n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  diff_options = svn_diff_file_options_create(pool);
+  SVN_ERR(svn_repos__blame(repos, "/iota", 1, youngest_rev, diff_options,
+                           NULL, NULL, blame_to_buf, buf, NULL, NULL, pool));
+  SVN_TEST_STRING_ASSERT(buf->data, "0:3 1:1 2:3 ");
+
+  /* Whitespace changes may be ignored. */
+  svn_stringbuf_setempty(buf);
+  diff_options->ignore_space = svn_diff_file_ignore_space_change;
+  SVN_ERR(svn_repos__blame(repos, "/iota", 1, youngest_rev, diff_options,
+                           NULL, NULL, blame_to_buf, buf, NULL, NULL, pool));
+  SVN_TEST_STRING_ASSERT(buf->data, "0:3 1:1 2:2 ");
+
+  /* Lines changed before the start of the range are not attributed. */
+  svn_stringbuf_setempty(buf);
+  SVN_ERR(svn_repos__blame(repos, "/iota", 2, youngest_rev, diff_options,
+                           NULL, NULL, blame_to_buf, buf, NULL, NULL, pool));
+  SVN_TEST_STRING_ASSERT(buf->data, "0:3 1:-1 2:2 ");
+
+  /* r4: append another line.  Blaming it may continue from the
+     attribution of r3, which should make no difference. */
+  SVN_ERR(svn_fs_begin_txn(&txn, fs, youngest_rev, pool));
+  SVN_ERR(svn_fs_txn_root(&txn_root, txn, pool));
+  SVN_ERR(svn_test__set_file_contents(txn_root, "iota",
+                                      "first\n"
+                                      "This is the file 'iota'.\n"
+                                      "second \n"
+                                      "third\n", pool));
+  SVN_ERR(svn_repos_fs_commit_txn(NULL, repos, &youngest_rev, txn, pool));
+
+  svn_stringbuf_setempty(buf);
+  SVN_ERR(svn_repos__blame(repos, "/iota", 1, youngest_rev, diff_options,
+                           NULL, NULL, blame_to_buf, buf, NULL, NULL, pool));
+  SVN_TEST_STRING_ASSERT(buf->data, "0:3 1:1 2:2 3:4 ");
+
+  /* Same again, now entirely from the attribution of r4. */
+  svn_stringbuf_setempty(buf);
+  SVN_ERR(svn_repos__blame(repos, "/iota", 1, youngest_rev, diff_options,
+                           NULL, NULL, blame_to_buf, buf, NULL, NULL, pool));
+  SVN_TEST_STRING_ASSERT(buf->data, "0:3 1:1 2:2 3:4 ");
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 4;
@@ -4501,10 +5412,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test svn_repos_node_location_segments"),
     SVN_TEST_OPTS_PASS(reporter_depth_exclude,
                        "test reporter and svn_depth_exclude"),
+    SVN_TEST_OPTS_PASS(reporter_subtree_authz,
+                       "test reporter with recursive authz checks"),
     SVN_TEST_OPTS_PASS(prop_validation,
                        "test if revprops are validated by repos"),
     SVN_TEST_OPTS_PASS(get_logs,
                        "test svn_repos_get_logs ranges and limits"),
+    SVN_TEST_OPTS_PASS(get_logs_multiple_paths,
+                       "test svn_repos_get_logs with several paths"),
     SVN_TEST_OPTS_PASS(test_get_file_revs,
                        "test svn_repos_get_file_revsN"),
     SVN_TEST_OPTS_PASS(issue_4060,
@@ -4535,8 +5450,18 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test the different types of authz wildcards"),
     SVN_TEST_SKIP2(test_authz_wildcard_performance, TRUE,
                    "optional authz wildcard performance test"),
+    SVN_TEST_PASS2(test_authz_reload,
+                   "test authz caching across rule changes"),
+    SVN_TEST_PASS2(test_authz_background_reload,
+                   "test reloading authz rules in the background"),
+    SVN_TEST_PASS2(test_authz_concurrent_reload,
+                   "test authz reads with concurrent rule changes"),
     SVN_TEST_OPTS_PASS(test_list,
                        "test svn_repos_list"),
+    SVN_TEST_OPTS_PASS(test_list_concurrently,
+                       "test svn_repos_list with several jobs"),
+    SVN_TEST_OPTS_PASS(test_blame,
+                       "test svn_repos__blame"),
     SVN_TEST_NULL
   };
 
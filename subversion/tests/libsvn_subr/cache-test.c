@@ -22,14 +22,19 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <apr_general.h>
 #include <apr_lib.h>
+#include <apr_thread_proc.h>
 #include <apr_time.h>
 
+#include "svn_dirent_uri.h"
 #include "svn_pools.h"
+#include "svn_sorts.h"
 
 #include "private/svn_cache.h"
+#include "private/svn_subr_private.h"
 #include "svn_private_config.h"
 
 #include "../svn_test.h"
@@ -444,6 +449,791 @@ test_membuffer_cache_clearing(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Create a membuffer svn_cache__t for revnums in POOL with a tiny backend
+ * of its own and return it in *CACHE_P.
+ */
+static svn_error_t *
+create_tiny_revnum_cache(svn_cache__t **cache_p,
+                         apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(cache_p,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_reads_during_evictions(apr_pool_t *pool)
+{
+  apr_pool_t *pool1 = svn_pool_create(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_cache__t *cache1, *cache2;
+  svn_boolean_t found;
+  svn_revnum_t *value;
+  svn_revnum_t i, k;
+
+  /* Two caches with separate backends.  Far more entries than fit. */
+  SVN_ERR(create_tiny_revnum_cache(&cache1, pool1));
+  SVN_ERR(create_tiny_revnum_cache(&cache2, pool));
+
+  for (i = 0; i < 1000; ++i)
+    {
+      const char *key;
+      svn_pool_clear(iterpool);
+
+      key = apr_psprintf(iterpool, "key %ld", i);
+      SVN_ERR(svn_cache__set(cache1, key, &i, iterpool));
+      SVN_ERR(svn_cache__set(cache2, key, &i, iterpool));
+
+      /* The latest entry must be there. */
+      SVN_ERR(svn_cache__get((void **) &value, &found, cache1, key,
+                             iterpool));
+      SVN_TEST_ASSERT(found && *value == i);
+
+      /* Whatever survived must be intact, no matter how often entries
+       * got read, moved and evicted. */
+      for (k = MAX(0, i - 50); k <= i; ++k)
+        {
+          key = apr_psprintf(iterpool, "key %ld", k);
+          SVN_ERR(svn_cache__get((void **) &value, &found, cache1, key,
+                                 iterpool));
+          SVN_TEST_ASSERT(!found || *value == k);
+          SVN_ERR(svn_cache__get((void **) &value, &found, cache2, key,
+                                 iterpool));
+          SVN_TEST_ASSERT(!found || *value == k);
+        }
+    }
+
+  /* Reads from the second cache must still work after the first one
+   * has been destroyed. */
+  svn_pool_destroy(pool1);
+  for (k = 0; k < 1000; ++k)
+    {
+      const char *key;
+      svn_pool_clear(iterpool);
+
+      key = apr_psprintf(iterpool, "key %ld", k);
+      SVN_ERR(svn_cache__get((void **) &value, &found, cache2, key,
+                             iterpool));
+      SVN_TEST_ASSERT(!found || *value == k);
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_shared(apr_pool_t *pool)
+{
+  svn_cache__t *cache;
+  svn_membuffer_t *membuffer;
+  svn_error_t *err;
+  svn_boolean_t found;
+  svn_revnum_t *value;
+  svn_revnum_t forty = 40;
+#if APR_HAS_FORK
+  apr_proc_t proc;
+  apr_status_t status;
+#endif
+
+  err = svn_cache__membuffer_cache_create_shared(&membuffer, 10*1024, 1, 0,
+                                                 TRUE, pool);
+  if (err && err->apr_err == SVN_ERR_UNSUPPORTED_FEATURE)
+    {
+      svn_error_clear(err);
+      return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                              "shared memory caches not supported");
+    }
+  SVN_ERR(err);
+
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            APR_HASH_KEY_STRING,
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  SVN_ERR(basic_cache_test(cache, FALSE, pool));
+
+#if APR_HAS_FORK
+  /* Data written by a child process must become visible to the parent. */
+  status = apr_proc_fork(&proc, pool);
+  if (status == APR_INCHILD)
+    {
+      err = svn_cache__set(cache, "forty", &forty, pool);
+      exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+  else if (status == APR_INPARENT)
+    {
+      int exit_code;
+      apr_exit_why_e exit_why;
+
+      status = apr_proc_wait(&proc, &exit_code, &exit_why, APR_WAIT);
+      if (!APR_STATUS_IS_CHILD_DONE(status))
+        return svn_error_wrap_apr(status, "apr_proc_wait");
+      SVN_TEST_ASSERT(APR_PROC_CHECK_EXIT(exit_why) && exit_code == 0);
+
+      SVN_ERR(svn_cache__get((void **) &value, &found, cache, "forty",
+                             pool));
+      SVN_TEST_ASSERT(found && *value == forty);
+    }
+  else
+    {
+      return svn_error_wrap_apr(status, "apr_proc_fork");
+    }
+#else
+  SVN_ERR(svn_cache__set(cache, "forty", &forty, pool));
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "forty", pool));
+  SVN_TEST_ASSERT(found && *value == forty);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Create a revnum cache with fixed-size keys in POOL on top of a tiny
+ * membuffer that uses the spill file at PATH.  Allow keys to be spilled
+ * and tell the spill file that we are at revision YOUNGEST.  Return the
+ * cache in *CACHE_P.
+ */
+static svn_error_t *
+create_spilling_revnum_cache(svn_cache__t **cache_p,
+                             const char *path,
+                             svn_revnum_t youngest,
+                             apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 0,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_set_spill_file(membuffer, path, 0x1000000,
+                                              pool));
+  SVN_TEST_ASSERT(svn_cache__membuffer_has_spill_file(membuffer));
+  SVN_ERR(svn_cache__membuffer_spill_namespace(membuffer, "cache:",
+                                               youngest));
+
+  SVN_ERR(svn_cache__create_membuffer_cache(cache_p,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(svn_revnum_t),
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *COUNT to the number of revnums in 0 .. MAX_REV-1 that can be read
+ * from CACHE.  Verify that they all map to themselves.
+ */
+static svn_error_t *
+count_cached_revnums(int *count,
+                     svn_cache__t *cache,
+                     svn_revnum_t max_rev,
+                     apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_revnum_t i;
+
+  *count = 0;
+  for (i = 0; i < max_rev; ++i)
+    {
+      svn_boolean_t found;
+      svn_revnum_t *value;
+      svn_pool_clear(iterpool);
+
+      SVN_ERR(svn_cache__get((void **) &value, &found, cache, &i, iterpool));
+      if (found)
+        {
+          SVN_TEST_ASSERT(*value == i);
+          ++*count;
+        }
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_spill(apr_pool_t *pool)
+{
+  apr_pool_t *subpool = svn_pool_create(pool);
+  svn_cache__t *cache;
+  const char *sb_dir;
+  const char *path;
+  svn_revnum_t i;
+  int count;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&sb_dir, "cache-test-spill", pool));
+  path = svn_dirent_join(sb_dir, "spill", pool);
+
+  /* Far more entries than fit into memory.  Almost all of them must be
+   * available from the spill file.  Only index slot collisions may lose
+   * a few. */
+  SVN_ERR(create_spilling_revnum_cache(&cache, path, 10, subpool));
+  for (i = 0; i < 1000; ++i)
+    SVN_ERR(svn_cache__set(cache, &i, &i, subpool));
+
+  SVN_ERR(count_cached_revnums(&count, cache, 1000, subpool));
+  SVN_TEST_ASSERT(count >= 900);
+
+  /* The spill file outlives the membuffer that used it. */
+  svn_pool_clear(subpool);
+  SVN_ERR(create_spilling_revnum_cache(&cache, path, 10, subpool));
+  SVN_ERR(count_cached_revnums(&count, cache, 1000, subpool));
+  SVN_TEST_ASSERT(count >= 800);
+
+  /* Going back in history invalidates all contents. */
+  svn_pool_clear(subpool);
+  SVN_ERR(create_spilling_revnum_cache(&cache, path, 5, subpool));
+  SVN_ERR(count_cached_revnums(&count, cache, 1000, subpool));
+  SVN_TEST_ASSERT(count == 0);
+
+  svn_pool_destroy(subpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_tinylfu(apr_pool_t *pool)
+{
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_boolean_t found;
+  svn_revnum_t *value;
+  svn_revnum_t i;
+  int k;
+  int count = 0;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024*1024,
+                                            100*1024, 1, TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__membuffer_set_policy(membuffer,
+                                          svn_cache__membuffer_policy_tinylfu,
+                                          pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(svn_revnum_t),
+                                            "cache:",
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  /* A small hot set of frequently read entries. */
+  for (k = 0; k < 20; ++k)
+    for (i = 0; i < 50; ++i)
+      {
+        svn_pool_clear(iterpool);
+        SVN_ERR(svn_cache__get((void **) &value, &found, cache, &i,
+                               iterpool));
+        if (!found)
+          SVN_ERR(svn_cache__set(cache, &i, &i, iterpool));
+      }
+
+  /* A scan reading far more entries than fit, each one only once. */
+  for (i = 1000; i < 30000; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cache__get((void **) &value, &found, cache, &i,
+                             iterpool));
+      SVN_TEST_ASSERT(!found);
+      SVN_ERR(svn_cache__set(cache, &i, &i, iterpool));
+    }
+
+  /* The hot set must mostly have survived. */
+  for (i = 0; i < 50; ++i)
+    {
+      svn_pool_clear(iterpool);
+      SVN_ERR(svn_cache__get((void **) &value, &found, cache, &i,
+                             iterpool));
+      if (found)
+        {
+          SVN_TEST_ASSERT(*value == i);
+          ++count;
+        }
+    }
+
+  SVN_TEST_ASSERT(count >= 40);
+
+  /* Invalid policies get rejected. */
+  SVN_TEST_ASSERT_ERROR(svn_cache__membuffer_set_policy(
+                            membuffer, (svn_cache__membuffer_policy_t)42,
+                            pool),
+                        SVN_ERR_INCORRECT_PARAMS);
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+/* Create a revnum cache with fixed-size keys on top of MEMBUFFER that
+ * uses the key PREFIX.  Return it in *CACHE_P, allocated in POOL.
+ */
+static svn_error_t *
+create_revnum_cache(svn_cache__t **cache_p,
+                    svn_membuffer_t *membuffer,
+                    const char *prefix,
+                    apr_pool_t *pool)
+{
+  SVN_ERR(svn_cache__create_membuffer_cache(cache_p,
+                                            membuffer,
+                                            serialize_revnum,
+                                            deserialize_revnum,
+                                            sizeof(svn_revnum_t),
+                                            prefix,
+                                            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                            FALSE,
+                                            FALSE,
+                                            pool, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_cache_snapshot(apr_pool_t *pool)
+{
+  svn_membuffer_t *source;
+  svn_membuffer_t *target;
+  svn_cache__t *cache;
+  svn_cache__t *other_cache;
+  svn_stringbuf_t *snapshot = svn_stringbuf_create_empty(pool);
+  svn_stream_t *stream;
+  svn_boolean_t loaded;
+  svn_revnum_t i;
+  int count;
+
+  /* Fill a cache that is large enough to hold everything. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&source, 1024*1024, 100*1024,
+                                            1, TRUE, TRUE, pool));
+  SVN_ERR(create_revnum_cache(&cache, source, "cache:", pool));
+  SVN_ERR(create_revnum_cache(&other_cache, source, "other:", pool));
+  for (i = 0; i < 100; ++i)
+    {
+      SVN_ERR(svn_cache__set(cache, &i, &i, pool));
+      SVN_ERR(svn_cache__set(other_cache, &i, &i, pool));
+    }
+
+  /* Take a snapshot of one namespace only. */
+  stream = svn_stream_from_stringbuf(snapshot, pool);
+  SVN_ERR(svn_cache__membuffer_dump(source, stream, "cache:", 10, "state",
+                                    pool));
+  SVN_ERR(svn_stream_close(stream));
+
+  /* Restore it into an empty cache. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&target, 1024*1024, 100*1024,
+                                            1, TRUE, TRUE, pool));
+  stream = svn_stream_from_stringbuf(snapshot, pool);
+  SVN_ERR(svn_cache__membuffer_load(&loaded, target, stream, "cache:", 10,
+                                    "state", pool));
+
+  SVN_ERR(create_revnum_cache(&cache, target, "cache:", pool));
+  SVN_ERR(create_revnum_cache(&other_cache, target, "other:", pool));
+  SVN_ERR(count_cached_revnums(&count, other_cache, 100, pool));
+  SVN_TEST_ASSERT(count == 0);
+
+  SVN_ERR(count_cached_revnums(&count, cache, 100, pool));
+#ifdef SVN_DEBUG_CACHE_MEMBUFFER
+  /* Debug builds don't load snapshots. */
+  SVN_TEST_ASSERT(!loaded && count == 0);
+#else
+  SVN_TEST_ASSERT(loaded && count == 100);
+#endif
+
+  /* Snapshots for other namespaces, states or newer revisions get
+   * rejected. */
+  stream = svn_stream_from_stringbuf(snapshot, pool);
+  SVN_ERR(svn_cache__membuffer_load(&loaded, target, stream, "other:", 10,
+                                    "state", pool));
+  SVN_TEST_ASSERT(!loaded);
+
+  stream = svn_stream_from_stringbuf(snapshot, pool);
+  SVN_ERR(svn_cache__membuffer_load(&loaded, target, stream, "cache:", 10,
+                                    "packed", pool));
+  SVN_TEST_ASSERT(!loaded);
+
+  stream = svn_stream_from_stringbuf(snapshot, pool);
+  SVN_ERR(svn_cache__membuffer_load(&loaded, target, stream, "cache:", 9,
+                                    "state", pool));
+  SVN_TEST_ASSERT(!loaded);
+
+#ifndef SVN_DEBUG_CACHE_MEMBUFFER
+  /* Something that isn't a snapshot at all. */
+  stream = svn_stream_from_string(svn_string_create("garbage", pool), pool);
+  SVN_TEST_ASSERT_ERROR(svn_cache__membuffer_load(&loaded, target, stream,
+                                                  "cache:", 10, "state",
+                                                  pool),
+                        SVN_ERR_BAD_VERSION_FILE_FORMAT);
+#endif
+
+  return SVN_NO_ERROR;
+}
+
+/* Return the element of the svn_cache__info_t * array INFOS whose ID
+ * is PREFIX.  Return NULL if there is none.
+ */
+static const svn_cache__info_t *
+find_prefix_info(const apr_array_header_t *infos,
+                 const char *prefix)
+{
+  int i;
+  for (i = 0; i < infos->nelts; ++i)
+    {
+      const svn_cache__info_t *info
+        = APR_ARRAY_IDX(infos, i, const svn_cache__info_t *);
+      if (strcmp(info->id, prefix) == 0)
+        return info;
+    }
+
+  return NULL;
+}
+
+static svn_error_t *
+test_membuffer_prefix_info(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache_a;
+  svn_cache__t *cache_b;
+  apr_array_header_t *infos;
+  const svn_cache__info_t *info;
+  svn_boolean_t found;
+  svn_revnum_t *value;
+  svn_revnum_t i;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024*1024, 100*1024,
+                                            1, TRUE, TRUE, pool));
+  SVN_ERR(create_revnum_cache(&cache_a, membuffer, "a:", pool));
+  SVN_ERR(create_revnum_cache(&cache_b, membuffer, "b:", pool));
+
+  /* 10 hits in A, 3 misses in B. */
+  for (i = 0; i < 10; ++i)
+    SVN_ERR(svn_cache__set(cache_a, &i, &i, pool));
+  for (i = 0; i < 5; ++i)
+    SVN_ERR(svn_cache__set(cache_b, &i, &i, pool));
+
+  for (i = 0; i < 10; ++i)
+    SVN_ERR(svn_cache__get((void **) &value, &found, cache_a, &i, pool));
+  for (i = 10; i < 13; ++i)
+    SVN_ERR(svn_cache__get((void **) &value, &found, cache_b, &i, pool));
+
+  SVN_ERR(svn_cache__membuffer_get_prefix_info(&infos, membuffer, TRUE,
+                                               pool));
+  SVN_TEST_ASSERT(infos->nelts == 2);
+
+  info = find_prefix_info(infos, "a:");
+  SVN_TEST_ASSERT(info);
+  SVN_TEST_ASSERT(info->gets == 10 && info->hits == 10 && info->sets == 10);
+  SVN_TEST_ASSERT(info->used_entries == 10 && info->used_size > 0);
+  SVN_TEST_ASSERT(info->evictions == 0);
+
+  info = find_prefix_info(infos, "b:");
+  SVN_TEST_ASSERT(info);
+  SVN_TEST_ASSERT(info->gets == 3 && info->hits == 0 && info->sets == 5);
+  SVN_TEST_ASSERT(info->used_entries == 5);
+
+  /* Counters have been reset but the contents remains. */
+  SVN_ERR(svn_cache__membuffer_get_prefix_info(&infos, membuffer, FALSE,
+                                               pool));
+  info = find_prefix_info(infos, "a:");
+  SVN_TEST_ASSERT(info->gets == 0 && info->hits == 0 && info->sets == 0);
+  SVN_TEST_ASSERT(info->used_entries == 10);
+
+  /* Overflowing a tiny cache causes evictions. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 10*1024, 1, 1,
+                                            TRUE, TRUE, pool));
+  SVN_ERR(create_revnum_cache(&cache_a, membuffer, "a:", pool));
+  for (i = 0; i < 1000; ++i)
+    SVN_ERR(svn_cache__set(cache_a, &i, &i, pool));
+
+  SVN_ERR(svn_cache__membuffer_get_prefix_info(&infos, membuffer, FALSE,
+                                               pool));
+  info = find_prefix_info(infos, "a:");
+  SVN_TEST_ASSERT(info && info->evictions > 0);
+  SVN_TEST_ASSERT(info->used_entries + info->evictions <= 1000);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_memory_hints(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_revnum_t i;
+  int count;
+  svn_error_t *err;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 8*1024*1024,
+                                            1024*1024, 1, TRUE, TRUE, pool));
+
+  /* No hints are always fine. */
+  SVN_ERR(svn_cache__membuffer_set_memory_hints(membuffer, FALSE, FALSE));
+
+  /* Platforms, kernels and containers may or may not support these but
+   * they must never break the cache. */
+  err = svn_cache__membuffer_set_memory_hints(membuffer, TRUE, TRUE);
+  svn_error_clear(err);
+
+  SVN_ERR(create_revnum_cache(&cache, membuffer, "cache:", pool));
+  for (i = 0; i < 1000; ++i)
+    SVN_ERR(svn_cache__set(cache, &i, &i, pool));
+
+  SVN_ERR(count_cached_revnums(&count, cache, 1000, pool));
+  SVN_TEST_ASSERT(count == 1000);
+
+  return SVN_NO_ERROR;
+}
+
+/* Store revnum I under KEYS[I] in CACHE for all even I < COUNT.  Then,
+ * look up all COUNT KEYS plus a NULL key in a single call and verify
+ * the results.
+ */
+static svn_error_t *
+check_get_many(svn_cache__t *cache,
+               const void **keys,
+               int count,
+               apr_pool_t *pool)
+{
+  void **values = apr_pcalloc(pool, (count + 1) * sizeof(*values));
+  svn_boolean_t *found = apr_pcalloc(pool, (count + 1) * sizeof(*found));
+  const void **lookups = apr_pcalloc(pool, (count + 1) * sizeof(*lookups));
+  svn_revnum_t i;
+
+  for (i = 0; i < count; i += 2)
+    SVN_ERR(svn_cache__set(cache, keys[i], &i, pool));
+
+  /* Look up in reverse order, terminated by a NULL key. */
+  for (i = 0; i < count; ++i)
+    lookups[i] = keys[count - 1 - i];
+
+  SVN_ERR(svn_cache__get_many(values, found, cache, lookups, count + 1,
+                              pool, pool));
+
+  for (i = 0; i < count; ++i)
+    {
+      svn_revnum_t expected = count - 1 - i;
+      if (expected % 2)
+        {
+          SVN_TEST_ASSERT(!found[i] && values[i] == NULL);
+        }
+      else
+        {
+          SVN_TEST_ASSERT(found[i]);
+          SVN_TEST_ASSERT(*(svn_revnum_t *)values[i] == expected);
+        }
+    }
+
+  SVN_TEST_ASSERT(!found[count] && values[count] == NULL);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_cache_get_many(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  const void **revnum_keys;
+  const void **string_keys;
+  svn_revnum_t *revnums;
+  int count = 200;
+  int i;
+
+  revnum_keys = apr_pcalloc(pool, count * sizeof(*revnum_keys));
+  string_keys = apr_pcalloc(pool, count * sizeof(*string_keys));
+  revnums = apr_pcalloc(pool, count * sizeof(*revnums));
+  for (i = 0; i < count; ++i)
+    {
+      revnums[i] = i;
+      revnum_keys[i] = &revnums[i];
+      string_keys[i] = apr_psprintf(pool, "key-%d", i);
+    }
+
+  /* Use multiple segments to exercise the per-segment batching. */
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 4*1024*1024,
+                                            1024*1024, 4, TRUE, TRUE, pool));
+
+  /* Short, fixed-size keys. */
+  SVN_ERR(create_revnum_cache(&cache, membuffer, "fixed:", pool));
+  SVN_ERR(check_get_many(cache, revnum_keys, count, pool));
+
+  /* Variable-size keys that require full key comparison. */
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            &cache, membuffer, serialize_revnum, deserialize_revnum,
+            APR_HASH_KEY_STRING, "string:",
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, TRUE, FALSE,
+            pool, pool));
+  SVN_ERR(check_get_many(cache, string_keys, count, pool));
+
+  /* Caches without batch support fall back to single lookups. */
+  SVN_ERR(svn_cache__create_inprocess(&cache, serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING, 16, 16, TRUE,
+                                      "", pool));
+  SVN_ERR(check_get_many(cache, string_keys, count, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_tiered_cache(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *l1;
+  svn_cache__t *l2;
+  svn_cache__t *cache;
+  const void *keys[3] = { "both", "l2 only", "none" };
+  void *values[3];
+  svn_boolean_t found[3];
+  svn_revnum_t one = 1, two = 2;
+  svn_revnum_t *value;
+  svn_boolean_t is_cached;
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024*1024,
+                                            100*1024, 1, TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            &l1, membuffer, serialize_revnum, deserialize_revnum,
+            APR_HASH_KEY_STRING, "l1:",
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+            pool, pool));
+  SVN_ERR(svn_cache__create_inprocess(&l2, serialize_revnum,
+                                      deserialize_revnum,
+                                      APR_HASH_KEY_STRING, 16, 16, FALSE,
+                                      "l2:", pool));
+  SVN_ERR(svn_cache__create_tiered(&cache, l1, l2, pool));
+
+  /* Writes go to both levels. */
+  SVN_ERR(svn_cache__set(cache, keys[0], &one, pool));
+  SVN_ERR(svn_cache__has_key(&is_cached, l1, keys[0], pool));
+  SVN_TEST_ASSERT(is_cached);
+  SVN_ERR(svn_cache__has_key(&is_cached, l2, keys[0], pool));
+  SVN_TEST_ASSERT(is_cached);
+
+  /* L2 hits get promoted to L1. */
+  SVN_ERR(svn_cache__set(l2, keys[1], &two, pool));
+  SVN_ERR(svn_cache__has_key(&is_cached, cache, keys[1], pool));
+  SVN_TEST_ASSERT(is_cached);
+  SVN_ERR(svn_cache__get((void **) &value, &is_cached, cache, keys[1],
+                         pool));
+  SVN_TEST_ASSERT(is_cached && *value == 2);
+  SVN_ERR(svn_cache__has_key(&is_cached, l1, keys[1], pool));
+  SVN_TEST_ASSERT(is_cached);
+
+  /* Same with batched lookups. */
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            &l1, membuffer, serialize_revnum, deserialize_revnum,
+            APR_HASH_KEY_STRING, "new l1:",
+            SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY, FALSE, FALSE,
+            pool, pool));
+  SVN_ERR(svn_cache__create_tiered(&cache, l1, l2, pool));
+  SVN_ERR(svn_cache__set(l1, keys[0], &one, pool));
+
+  SVN_ERR(svn_cache__get_many(values, found, cache, keys, 3, pool, pool));
+  SVN_TEST_ASSERT(found[0] && *(svn_revnum_t *)values[0] == 1);
+  SVN_TEST_ASSERT(found[1] && *(svn_revnum_t *)values[1] == 2);
+  SVN_TEST_ASSERT(!found[2]);
+  SVN_ERR(svn_cache__has_key(&is_cached, l1, keys[1], pool));
+  SVN_TEST_ASSERT(is_cached);
+
+  return SVN_NO_ERROR;
+}
+
+/* Implements svn_cache__partial_getter_func_t by returning the length
+ * of the serialized data as an apr_size_t. */
+static svn_error_t *
+get_data_len_partial_getter_func(void **out,
+                                 const void *data,
+                                 apr_size_t data_len,
+                                 void *baton,
+                                 apr_pool_t *result_pool)
+{
+  apr_size_t *len = apr_palloc(result_pool, sizeof(*len));
+  *len = data_len;
+  *out = len;
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_membuffer_compression(apr_pool_t *pool)
+{
+  svn_membuffer_t *membuffer;
+  svn_cache__t *cache;
+  svn_cache__t *inprocess;
+  svn_cache__info_t info;
+  svn_stringbuf_t *large = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *small = svn_stringbuf_create("tiny", pool);
+  svn_stringbuf_t *value;
+  apr_size_t *len;
+  svn_boolean_t found;
+  int i;
+
+  if (!svn__lz4_supported())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "LZ4 not supported by this build");
+
+  /* Highly redundant content that will compress well. */
+  for (i = 0; i < 1000; ++i)
+    svn_stringbuf_appendcstr(large, "compress me ");
+
+  SVN_ERR(svn_cache__membuffer_cache_create(&membuffer, 1024*1024,
+                                            100*1024, 1, TRUE, TRUE, pool));
+  SVN_ERR(svn_cache__create_membuffer_cache(
+            &cache, membuffer, NULL, NULL, APR_HASH_KEY_STRING,
+            "compressed:", SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+            FALSE, FALSE, pool, pool));
+  SVN_ERR(svn_cache__membuffer_set_compression(cache, 100));
+
+  SVN_ERR(svn_cache__set(cache, "large", large, pool));
+  SVN_ERR(svn_cache__set(cache, "small", small, pool));
+
+  /* Only the large item should have been compressed. */
+  SVN_ERR(svn_cache__get_info(cache, &info, FALSE, pool));
+  SVN_TEST_ASSERT(info.used_entries == 2);
+  SVN_TEST_ASSERT(info.used_size < large->len);
+
+  /* Both must be returned as they were. */
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "large", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(svn_stringbuf_compare(value, large));
+  SVN_ERR(svn_cache__get((void **) &value, &found, cache, "small", pool));
+  SVN_TEST_ASSERT(found);
+  SVN_TEST_ASSERT(svn_stringbuf_compare(value, small));
+
+  /* Partial getters see the uncompressed data. */
+  SVN_ERR(svn_cache__get_partial((void **) &len, &found, cache, "large",
+                                 get_data_len_partial_getter_func, NULL,
+                                 pool));
+  SVN_TEST_ASSERT(found && *len == large->len);
+
+  /* Compression is specific to membuffer caches. */
+  SVN_ERR(svn_cache__create_inprocess(&inprocess, NULL, NULL,
+                                      APR_HASH_KEY_STRING, 16, 16, FALSE,
+                                      "inprocess:", pool));
+  SVN_TEST_ASSERT_ERROR(svn_cache__membuffer_set_compression(inprocess, 100),
+                        SVN_ERR_UNSUPPORTED_FEATURE);
+
+  return SVN_NO_ERROR;
+}
+
 /* Implements svn_iter_apr_hash_cb_t. */
 static svn_error_t *
 null_cache_iter_func(void *baton,
@@ -590,6 +1380,82 @@ test_membuffer_unaligned_fixed_keys(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_membuffer_cache_recreate(apr_pool_t *pool)
+{
+  apr_pool_t *cache_pool = svn_pool_create(pool);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int round, i;
+
+  /* Reads defer their hit counts in a per-thread batch.  Destroy and
+   * recreate caches, usually at the same address, and make sure that
+   * the hits left over from one cache never get applied to the next one.
+   * Each round uses a smaller cache such that stale entry indexes would
+   * point beyond the end of the new directory. */
+  for (round = 0; round < 4; ++round)
+    {
+      svn_membuffer_t *membuffer;
+      svn_cache__t *cache;
+      svn_cache__info_t info;
+      int entries = 64 >> round;
+
+      svn_pool_clear(cache_pool);
+      SVN_ERR(svn_cache__membuffer_cache_create(&membuffer,
+                                                (256 * 1024) >> round,
+                                                (64 * 1024) >> round, 1,
+                                                TRUE, TRUE, cache_pool));
+      SVN_ERR(svn_cache__create_membuffer_cache(&cache,
+                                                membuffer,
+                                                serialize_revnum,
+                                                deserialize_revnum,
+                                                APR_HASH_KEY_STRING,
+                                                "cache:",
+                                                SVN_CACHE__MEMBUFFER_DEFAULT_PRIORITY,
+                                                FALSE,
+                                                FALSE,
+                                                cache_pool, cache_pool));
+
+      for (i = 0; i < entries; ++i)
+        {
+          svn_revnum_t value = round * 1000 + i;
+          const char *key;
+
+          svn_pool_clear(iterpool);
+          key = apr_psprintf(iterpool, "%d", i);
+          SVN_ERR(svn_cache__set(cache, key, &value, iterpool));
+        }
+
+      /* Fill the thread's hit batch but leave it pending. */
+      for (i = 0; i < entries; ++i)
+        {
+          svn_revnum_t *answer;
+          svn_boolean_t found;
+          const char *key;
+
+          svn_pool_clear(iterpool);
+          key = apr_psprintf(iterpool, "%d", i);
+          SVN_ERR(svn_cache__get((void **)&answer, &found, cache, key,
+                                 iterpool));
+
+          /* Small caches may have evicted some entries but must never
+           * return the data of a previous incarnation. */
+          if (found)
+            SVN_TEST_ASSERT(*answer == round * 1000 + i);
+        }
+
+      /* Hits may still be pending, so there cannot be more of them than
+       * lookups in this cache. */
+      SVN_ERR(svn_cache__get_info(cache, &info, TRUE, iterpool));
+      SVN_TEST_ASSERT(info.hits <= (apr_uint64_t)entries);
+      SVN_TEST_ASSERT(info.used_entries <= (apr_uint64_t)entries);
+    }
+
+  svn_pool_destroy(iterpool);
+  svn_pool_destroy(cache_pool);
+
+  return SVN_NO_ERROR;
+}
+
 
 /* The test table.  */
 
@@ -616,6 +1482,28 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test membuffer cache with unaligned string keys"),
     SVN_TEST_PASS2(test_membuffer_unaligned_fixed_keys,
                    "test membuffer cache with unaligned fixed keys"),
+    SVN_TEST_PASS2(test_membuffer_reads_during_evictions,
+                   "test membuffer cache reads while evicting"),
+    SVN_TEST_PASS2(test_membuffer_cache_shared,
+                   "test membuffer cache in shared memory"),
+    SVN_TEST_PASS2(test_membuffer_cache_spill,
+                   "test membuffer cache with spill file"),
+    SVN_TEST_PASS2(test_membuffer_cache_tinylfu,
+                   "test membuffer cache TinyLFU policy under scans"),
+    SVN_TEST_PASS2(test_membuffer_cache_snapshot,
+                   "test membuffer cache snapshots"),
+    SVN_TEST_PASS2(test_membuffer_prefix_info,
+                   "test membuffer per-prefix statistics"),
+    SVN_TEST_PASS2(test_membuffer_memory_hints,
+                   "test membuffer cache with memory placement hints"),
+    SVN_TEST_PASS2(test_cache_get_many,
+                   "test batched svn_cache lookups"),
+    SVN_TEST_PASS2(test_tiered_cache,
+                   "test two-level svn_cache"),
+    SVN_TEST_PASS2(test_membuffer_compression,
+                   "membuffer cache with compressed entries"),
+    SVN_TEST_PASS2(test_membuffer_cache_recreate,
+                   "reads from a cache recreated at the same address"),
     SVN_TEST_NULL
   };
 
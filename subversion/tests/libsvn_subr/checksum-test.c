@@ -27,6 +27,8 @@
 
 #include "svn_error.h"
 #include "svn_io.h"
+#include "svn_sorts.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test.h"
 
@@ -296,6 +298,96 @@ test_checksum_parse_all_zero(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Verify that DATA of LEN bytes has the SHA1 checksum given as hex string
+ * EXPECTED, both when hashed at once and when fed in pieces of varying
+ * size.  Use POOL for allocations.
+ */
+static svn_error_t *
+verify_sha1(const char *data,
+            apr_size_t len,
+            const char *expected,
+            apr_pool_t *pool)
+{
+  svn_checksum_t *checksum;
+  svn_checksum_ctx_t *ctx;
+  apr_size_t offset, piece_len;
+
+  SVN_ERR(svn_checksum(&checksum, svn_checksum_sha1, data, len, pool));
+  SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring_display(checksum, pool),
+                         expected);
+
+  ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
+  for (offset = 0, piece_len = 1; offset < len; offset += piece_len)
+    {
+      piece_len = MIN(len - offset, (piece_len * 7) % 131 + 1);
+      SVN_ERR(svn_checksum_update(ctx, data + offset, piece_len));
+    }
+
+  SVN_ERR(svn_checksum_final(&checksum, ctx, pool));
+  SVN_TEST_STRING_ASSERT(svn_checksum_to_cstring_display(checksum, pool),
+                         expected);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_sha1_vectors(apr_pool_t *pool)
+{
+  char *million_a = apr_palloc(pool, 1000000);
+  memset(million_a, 'a', 1000000);
+
+  /* Test vectors from FIPS 180-2, appendix A. */
+  SVN_ERR(verify_sha1("abc", 3,
+                      "a9993e364706816aba3e25717850c26c9cd0d89d", pool));
+  SVN_ERR(verify_sha1("abcdbcdecdefdefgefghfghighijhijk"
+                      "ijkljklmklmnlmnomnopnopq", 56,
+                      "84983e441c3bd26ebaae4aa1f95129e5e54670f1", pool));
+  SVN_ERR(verify_sha1(million_a, 1000000,
+                      "34aa973cd4c4daa4f61eeb2bdbad27316534016f", pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_checksum_update_both(apr_pool_t *pool)
+{
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  svn_checksum_t *md5_expected, *sha1_expected;
+  svn_checksum_t *md5_actual, *sha1_actual;
+  svn_checksum_ctx_t *md5_ctx, *sha1_ctx;
+  apr_size_t offset, len;
+  apr_uint32_t seed = 42;
+
+  while (data->len < 100000)
+    svn_stringbuf_appendbyte(data, (char)svn_test_rand(&seed));
+
+  SVN_ERR(svn_checksum(&md5_expected, svn_checksum_md5, data->data,
+                       data->len, pool));
+  SVN_ERR(svn_checksum(&sha1_expected, svn_checksum_sha1, data->data,
+                       data->len, pool));
+
+  /* Feed the data in pieces that are smaller and larger than the
+   * internal processing unit. */
+  md5_ctx = svn_checksum_ctx_create(svn_checksum_md5, pool);
+  sha1_ctx = svn_checksum_ctx_create(svn_checksum_sha1, pool);
+  for (offset = 0; offset < data->len; offset += len)
+    {
+      len = MIN(data->len - offset, offset % 10000 + 1);
+      SVN_ERR(svn_checksum__update_both(md5_ctx, sha1_ctx,
+                                        data->data + offset, len));
+    }
+
+  SVN_ERR(svn_checksum_final(&md5_actual, md5_ctx, pool));
+  SVN_ERR(svn_checksum_final(&sha1_actual, sha1_ctx, pool));
+
+  SVN_TEST_ASSERT(svn_checksum_match(md5_expected, md5_actual));
+  SVN_TEST_ASSERT(svn_checksum_match(sha1_expected, sha1_actual));
+  SVN_TEST_ASSERT(md5_actual->kind == svn_checksum_md5);
+  SVN_TEST_ASSERT(sha1_actual->kind == svn_checksum_sha1);
+
+  return SVN_NO_ERROR;
+}
+
 /* An array of all test functions */
 
 static int max_threads = 1;
@@ -317,6 +409,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "checksum (de-)serialization"),
     SVN_TEST_PASS2(test_checksum_parse_all_zero,
                    "checksum parse all zero"),
+    SVN_TEST_PASS2(test_sha1_vectors,
+                   "SHA1 test vectors"),
+    SVN_TEST_PASS2(test_checksum_update_both,
+                   "combined MD5 and SHA1 update"),
     SVN_TEST_NULL
   };
 
@@ -36,6 +36,8 @@
 #include "svn_dirent_uri.h"
 #include "svn_error.h"
 #include "svn_config.h"
+#include "svn_hash.h"
+#include "svn_io.h"
 #include "private/svn_subr_private.h"
 #include "private/svn_config_private.h"
 
@@ -458,6 +460,81 @@ test_serialization(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Replace the file PATH with one containing CONTENTS and set its
+   modification time to MTIME. */
+static svn_error_t *
+write_old_file(const char *path,
+               const char *contents,
+               apr_time_t mtime,
+               apr_pool_t *pool)
+{
+  SVN_ERR(svn_io_remove_file2(path, TRUE, pool));
+  SVN_ERR(svn_io_file_create(path, contents, pool));
+  SVN_ERR(svn_io_set_file_affected_time(mtime, path, pool));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_snapshot(apr_pool_t *pool)
+{
+  const char *config_dir;
+  const char *config_path;
+  const char *snapshot_path;
+  apr_hash_t *cfg_hash;
+  svn_config_t *cfg;
+  svn_node_kind_t kind;
+  const char *val;
+  apr_time_t mtime = apr_time_now() - apr_time_from_sec(60);
+
+  SVN_ERR(svn_test_make_sandbox_dir(&config_dir, "config-snapshot", pool));
+  config_path = svn_dirent_join(config_dir, SVN_CONFIG_CATEGORY_CONFIG, pool);
+  snapshot_path = apr_pstrcat(pool, config_path, ".snapshot", SVN_VA_NULL);
+
+  SVN_ERR(write_old_file(config_path,
+                         "[sec]\nfoo = %(bar)s\nbar = one\n", mtime, pool));
+
+  /* The first read writes the snapshot. */
+  SVN_ERR(svn_config_get_config(&cfg_hash, config_dir, pool));
+  SVN_ERR(svn_io_check_path(snapshot_path, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_file);
+
+  /* The second read uses it and values still get expanded on demand. */
+  SVN_ERR(svn_config_get_config(&cfg_hash, config_dir, pool));
+  cfg = svn_hash_gets(cfg_hash, SVN_CONFIG_CATEGORY_CONFIG);
+  svn_config_get(cfg, &val, "sec", "foo", NULL);
+  SVN_TEST_STRING_ASSERT(val, "one");
+  svn_config_set(cfg, "sec", "bar", "two");
+  svn_config_get(cfg, &val, "sec", "foo", NULL);
+  SVN_TEST_STRING_ASSERT(val, "two");
+
+  /* Modifications are detected by modification time and size. */
+  SVN_ERR(write_old_file(config_path,
+                         "[sec]\nfoo = %(bar)s\nbar = three\n",
+                         mtime, pool));
+  SVN_ERR(svn_config_get_config(&cfg_hash, config_dir, pool));
+  cfg = svn_hash_gets(cfg_hash, SVN_CONFIG_CATEGORY_CONFIG);
+  svn_config_get(cfg, &val, "sec", "foo", NULL);
+  SVN_TEST_STRING_ASSERT(val, "three");
+
+  SVN_ERR(write_old_file(config_path,
+                         "[sec]\nfoo = %(bar)s\nbar = four!\n",
+                         mtime + apr_time_from_sec(1), pool));
+  SVN_ERR(svn_config_get_config(&cfg_hash, config_dir, pool));
+  cfg = svn_hash_gets(cfg_hash, SVN_CONFIG_CATEGORY_CONFIG);
+  svn_config_get(cfg, &val, "sec", "foo", NULL);
+  SVN_TEST_STRING_ASSERT(val, "four!");
+
+  /* A corrupt snapshot is ignored. */
+  SVN_ERR(write_old_file(snapshot_path, "garbage", mtime, pool));
+  SVN_ERR(svn_config_get_config(&cfg_hash, config_dir, pool));
+  cfg = svn_hash_gets(cfg_hash, SVN_CONFIG_CATEGORY_CONFIG);
+  svn_config_get(cfg, &val, "sec", "foo", NULL);
+  SVN_TEST_STRING_ASSERT(val, "four!");
+
+  return SVN_NO_ERROR;
+}
+
 /*
    ====================================================================
    If you add a new test to this file, update this array.
@@ -494,6 +571,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test parsing config file with invalid BOM"),
     SVN_TEST_PASS2(test_serialization,
                    "test writing a config"),
+    SVN_TEST_PASS2(test_snapshot,
+                   "test cached config snapshots"),
     SVN_TEST_NULL
   };
 
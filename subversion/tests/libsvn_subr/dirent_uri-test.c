@@ -1165,6 +1165,10 @@ test_relpath_is_canonical(apr_pool_t *pool)
     { "dirA",                  TRUE },
     { "foo/dirA",              TRUE },
     { "foo/./bar",             FALSE },
+    { "long/path/without/any/dot/segments", TRUE },
+    { "long/path/with/an/empty//segment",   FALSE },
+    { "long/path/with/a/./dot/segment",     FALSE },
+    { "long/path/with/..//near/the/start",  FALSE },
     { "http://hst",            FALSE },
     { "http://hst/foo/../bar", FALSE },
     { "http://HST/",           FALSE },
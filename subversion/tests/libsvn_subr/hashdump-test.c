@@ -36,6 +36,8 @@
 #include "svn_error.h"
 #include "svn_hash.h"
 
+#include "private/svn_subr_private.h"
+
 
 /* Our own global variables */
 static apr_hash_t *proplist, *new_proplist;
@@ -230,6 +232,68 @@ read_hash_buffered_test(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+read_hash_from_buffer_test(apr_pool_t *pool)
+{
+  apr_hash_t *ht;
+  svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+  svn_string_t *value;
+  apr_size_t i;
+  static const char *malformed[] =
+    {
+      "",
+      "K 3\nfoo\nV 3\nbar\n",
+      "K 3\nfoo\nV 3\nbar",
+      "K 4\nfoo\nV 3\nbar\nEND\n",
+      "K 3\nfoo\nV 4\nbar\nEND\n",
+      "K x\nfoo\nV 3\nbar\nEND\n",
+      "K 3\nfoo\nW 3\nbar\nEND\n",
+      "D 3\nfoo\nEND\n"
+    };
+
+  /* Write a hash table to a buffer. */
+  ht = apr_hash_make(pool);
+  svn_hash_sets(ht, "color", svn_string_create("red", pool));
+  svn_hash_sets(ht, "wine review", svn_string_create(review, pool));
+  svn_hash_sets(ht, "empty", svn_string_create_empty(pool));
+  SVN_ERR(svn_hash_write2(ht, svn_stream_from_stringbuf(buf, pool),
+                          SVN_HASH_TERMINATOR, pool));
+
+  /* Read it back. */
+  ht = apr_hash_make(pool);
+  SVN_ERR(svn_hash__read_buffer(ht, buf->data, buf->len,
+                                SVN_HASH_TERMINATOR, pool));
+
+  SVN_TEST_ASSERT(apr_hash_count(ht) == 3);
+  SVN_TEST_STRING_ASSERT(hash_gets_stringt(ht, "color"), "red");
+  SVN_TEST_STRING_ASSERT(hash_gets_stringt(ht, "wine review"), review);
+  SVN_TEST_STRING_ASSERT(hash_gets_stringt(ht, "empty"), "");
+
+  /* The values must point into the buffer. */
+  value = svn_hash_gets(ht, "color");
+  SVN_TEST_ASSERT(value->data > buf->data
+                  && value->data < buf->data + buf->len
+                  && value->len == 3);
+
+  /* Without terminator, the data simply ends. */
+  ht = apr_hash_make(pool);
+  buf = svn_stringbuf_create("K 3\nfoo\nV 3\nbar\n", pool);
+  SVN_ERR(svn_hash__read_buffer(ht, buf->data, buf->len, NULL, pool));
+  SVN_TEST_STRING_ASSERT(hash_gets_stringt(ht, "foo"), "bar");
+
+  /* Reject malformed input. */
+  for (i = 0; i < sizeof(malformed) / sizeof(malformed[0]); ++i)
+    {
+      ht = apr_hash_make(pool);
+      buf = svn_stringbuf_create(malformed[i], pool);
+      SVN_TEST_ASSERT_ERROR(svn_hash__read_buffer(ht, buf->data, buf->len,
+                                                  SVN_HASH_TERMINATOR, pool),
+                            SVN_ERR_MALFORMED_FILE);
+    }
+
+  return SVN_NO_ERROR;
+}
+
 
 /*
    ====================================================================
@@ -252,6 +316,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "write hash out, read back in, compare"),
     SVN_TEST_PASS2(read_hash_buffered_test,
                    "read hash from buffered file"),
+    SVN_TEST_PASS2(read_hash_from_buffer_test,
+                   "read hash from memory buffer"),
     SVN_TEST_NULL
   };
 
@@ -34,6 +34,7 @@
 #include "private/svn_skel.h"
 #include "private/svn_dep_compat.h"
 #include "private/svn_io_private.h"
+#include "private/svn_trace.h"
 
 #include "../svn_test.h"
 #include "../svn_test_fs.h"
@@ -1147,6 +1148,120 @@ test_apr_trunc_workaround(apr_pool_t *pool)
   return SVN_NO_ERROR;  
 }
 
+static svn_error_t *
+test_copy_dir_recursively(apr_pool_t *pool)
+{
+  const char *tmp_dir;
+  const char *src_dir;
+  const char *copy_dir;
+  svn_stringbuf_t *actual_content;
+  svn_node_kind_t actual_kind;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&tmp_dir, "test_copy_dir_recursively",
+                                    pool));
+
+  src_dir = svn_dirent_join(tmp_dir, "src", pool);
+  SVN_ERR(svn_io_make_dir_recursively(svn_dirent_join_many(pool, src_dir,
+                                                           "sub", "deep",
+                                                           SVN_VA_NULL),
+                                      pool));
+  SVN_ERR(svn_io_file_create(svn_dirent_join(src_dir, "foo", pool),
+                             "foo content", pool));
+  SVN_ERR(svn_io_file_create(svn_dirent_join_many(pool, src_dir, "sub",
+                                                  "deep", "bar",
+                                                  SVN_VA_NULL),
+                             "bar content", pool));
+
+  /* Copy into a sibling directory. */
+  SVN_ERR(svn_io_copy_dir_recursively(src_dir, tmp_dir, "copy", TRUE,
+                                      NULL, NULL, pool));
+
+  copy_dir = svn_dirent_join(tmp_dir, "copy", pool);
+  SVN_ERR(svn_stringbuf_from_file2(&actual_content,
+                                   svn_dirent_join(copy_dir, "foo", pool),
+                                   pool));
+  SVN_TEST_STRING_ASSERT(actual_content->data, "foo content");
+  SVN_ERR(svn_stringbuf_from_file2(&actual_content,
+                                   svn_dirent_join_many(pool, copy_dir,
+                                                        "sub", "deep", "bar",
+                                                        SVN_VA_NULL),
+                                   pool));
+  SVN_TEST_STRING_ASSERT(actual_content->data, "bar content");
+
+  /* Copy into the source directory itself.  The new directory must not
+     be copied into itself. */
+  SVN_ERR(svn_io_copy_dir_recursively(src_dir, src_dir, "self", FALSE,
+                                      NULL, NULL, pool));
+
+  copy_dir = svn_dirent_join(src_dir, "self", pool);
+  SVN_ERR(svn_stringbuf_from_file2(&actual_content,
+                                   svn_dirent_join_many(pool, copy_dir,
+                                                        "sub", "deep", "bar",
+                                                        SVN_VA_NULL),
+                                   pool));
+  SVN_TEST_STRING_ASSERT(actual_content->data, "bar content");
+  SVN_ERR(svn_io_check_path(svn_dirent_join(copy_dir, "self", pool),
+                            &actual_kind, pool));
+  SVN_TEST_ASSERT(actual_kind == svn_node_none);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_trace(apr_pool_t *pool)
+{
+  const char *tmp_dir;
+  const char *path;
+  apr_pool_t *trace_pool = svn_pool_create(pool);
+  svn_trace__t *trace, *dup;
+  svn_stringbuf_t *content;
+  apr_array_header_t *lines;
+  svn_node_kind_t kind;
+  apr_time_t start;
+
+  SVN_ERR(svn_test_make_sandbox_dir(&tmp_dir, "test_trace", pool));
+  path = svn_dirent_join(tmp_dir, "trace", pool);
+
+  SVN_TEST_ASSERT(svn_trace__valid_request_id("a-b_c.1"));
+  SVN_TEST_ASSERT(!svn_trace__valid_request_id(""));
+  SVN_TEST_ASSERT(!svn_trace__valid_request_id("a b"));
+  SVN_TEST_ASSERT(!svn_trace__valid_request_id("a\tb"));
+  SVN_TEST_ASSERT(!svn_trace__valid_request_id(apr_psprintf(pool,
+                        "%065d", 0)));
+
+  /* Without a trace, nothing happens. */
+  SVN_TEST_ASSERT(svn_trace__request_id(NULL) == NULL);
+  SVN_TEST_ASSERT(svn_trace__start(NULL) == 0);
+  svn_trace__span(NULL, "test", "nothing", NULL, 0);
+
+  /* A generated ID is valid. */
+  trace = svn_trace__create(NULL, NULL, trace_pool);
+  SVN_TEST_ASSERT(svn_trace__valid_request_id(svn_trace__request_id(trace)));
+
+  trace = svn_trace__create(path, "id-1", trace_pool);
+  dup = svn_trace__dup(trace, trace_pool);
+  SVN_TEST_STRING_ASSERT(svn_trace__request_id(dup), "id-1");
+
+  start = svn_trace__start(trace);
+  SVN_TEST_ASSERT(start != 0);
+  svn_trace__span(trace, "test", "first", "detail", start);
+  svn_trace__span(dup, "test", "second", NULL, start);
+
+  /* Spans are buffered until the trace goes away. */
+  SVN_ERR(svn_io_check_path(path, &kind, pool));
+  SVN_TEST_ASSERT(kind == svn_node_none);
+  svn_pool_destroy(trace_pool);
+
+  SVN_ERR(svn_stringbuf_from_file2(&content, path, pool));
+  lines = svn_cstring_split(content->data, "\n", TRUE, pool);
+  SVN_TEST_INT_ASSERT(lines->nelts, 2);
+  SVN_TEST_ASSERT(strstr(content->data,
+                         "\tid-1\ttest\tfirst\tdetail\t"));
+  SVN_TEST_ASSERT(strstr(content->data, "\tid-1\ttest\tsecond\t-\t"));
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 3;
@@ -1184,6 +1299,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test svn_io_open_uniquely_named()"),
     SVN_TEST_PASS2(test_apr_trunc_workaround,
                    "test workaround for APR in svn_io_file_trunc"),
+    SVN_TEST_PASS2(test_copy_dir_recursively,
+                   "test svn_io_copy_dir_recursively"),
+    SVN_TEST_PASS2(test_trace,
+                   "test request tracing"),
     SVN_TEST_NULL
   };
 
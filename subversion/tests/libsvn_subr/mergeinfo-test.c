@@ -1358,6 +1358,228 @@ test_rangelist_merge(apr_pool_t *pool)
   return err;
 }
 
+/* Return a rangelist containing copies of the NBR_RANGES elements of
+   RANGES, in that order and without any normalization. */
+static svn_rangelist_t *
+make_rangelist(const svn_merge_range_t *ranges,
+               int nbr_ranges,
+               apr_pool_t *pool)
+{
+  svn_rangelist_t *rangelist = apr_array_make(pool, nbr_ranges,
+                                              sizeof(svn_merge_range_t *));
+  int i;
+
+  for (i = 0; i < nbr_ranges; i++)
+    APR_ARRAY_PUSH(rangelist, svn_merge_range_t *)
+      = svn_merge_range_dup(&ranges[i], pool);
+
+  return rangelist;
+}
+
+static svn_error_t *
+test_rangelist_combine_adjacent(apr_pool_t *pool)
+{
+  int i;
+
+  /* Sorted but not compacted input to svn_rangelist__combine_adjacent_ranges.
+     A negative EXPECTED_RANGES means a parse error. */
+  struct combine_test_data
+  {
+    int nbr_ranges;
+    svn_merge_range_t ranges[5];
+    int expected_ranges;
+    svn_merge_range_t expected[3];
+  } test_data[] =
+    {
+      /* Adjacent ranges. */
+      {2, {{0, 5, TRUE }, {5, 8, TRUE }}, 1, {{0, 8, TRUE }}},
+      {2, {{0, 5, FALSE}, {5, 8, FALSE}}, 1, {{0, 8, FALSE}}},
+      {2, {{0, 5, TRUE }, {5, 8, FALSE}}, 2, {{0, 5, TRUE }, {5, 8, FALSE}}},
+      {2, {{0, 5, FALSE}, {5, 8, TRUE }}, 2, {{0, 5, FALSE}, {5, 8, TRUE }}},
+
+      /* Overlapping ranges. */
+      {2, {{0, 5, TRUE }, {3, 8, TRUE }}, 1, {{0, 8, TRUE }}},
+      {2, {{0, 10, FALSE}, {2, 4, FALSE}}, 1, {{0, 10, FALSE}}},
+      {2, {{0, 5, TRUE }, {3, 8, FALSE}}, -1},
+      {2, {{0, 10, FALSE}, {2, 4, TRUE }}, -1},
+
+      /* Runs of both. */
+      {5, {{0, 5, FALSE}, {5, 8, FALSE}, {8, 9, TRUE }, {9, 12, TRUE },
+           {20, 21, FALSE}},
+       3, {{0, 8, FALSE}, {8, 12, TRUE }, {20, 21, FALSE}}},
+      {4, {{0, 2, TRUE }, {1, 4, TRUE }, {4, 6, FALSE}, {7, 9, FALSE}},
+       3, {{0, 4, TRUE }, {4, 6, FALSE}, {7, 9, FALSE}}},
+
+      /* Nothing to combine. */
+      {1, {{4, 5, FALSE}}, 1, {{4, 5, FALSE}}},
+      {0, {{0, 0, FALSE}}, 0, {{0, 0, FALSE}}}
+    };
+
+  for (i = 0; i < sizeof(test_data) / sizeof(test_data[0]); i++)
+    {
+      svn_rangelist_t *rangelist = make_rangelist(test_data[i].ranges,
+                                                  test_data[i].nbr_ranges,
+                                                  pool);
+      svn_error_t *err
+        = svn_rangelist__combine_adjacent_ranges(rangelist, pool);
+
+      if (test_data[i].expected_ranges < 0)
+        SVN_TEST_ASSERT_ERROR(err, SVN_ERR_MERGEINFO_PARSE_ERROR);
+      else
+        SVN_ERR(verify_ranges_match(rangelist, test_data[i].expected,
+                                    test_data[i].expected_ranges,
+                                    apr_psprintf(pool,
+                                                 "svn_rangelist__combine_"
+                                                 "adjacent_ranges case %d",
+                                                 i),
+                                    "combine", pool));
+    }
+
+  /* Unsorted input needs to be canonicalized. */
+  {
+    svn_merge_range_t unsorted[] = {{10, 12, TRUE}, {0, 5, TRUE},
+                                    {5, 7, TRUE}, {3, 4, TRUE}};
+    svn_merge_range_t expected[] = {{0, 7, TRUE}, {10, 12, TRUE}};
+    svn_rangelist_t *rangelist = make_rangelist(unsorted, 4, pool);
+
+    SVN_ERR(svn_rangelist__canonicalize(rangelist, pool));
+    SVN_ERR(verify_ranges_match(rangelist, expected, 2,
+                                "svn_rangelist__canonicalize", "combine",
+                                pool));
+  }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_rangelist_merge_aliasing(apr_pool_t *pool)
+{
+  svn_rangelist_t *rangelist, *changes;
+  svn_string_t *result;
+  int i;
+
+  /* Merging a rangelist into itself does not change it. */
+  SVN_ERR(svn_rangelist__parse(&rangelist, "1-5*,7,10-12", pool));
+  SVN_ERR(svn_rangelist_merge2(rangelist, rangelist, pool, pool));
+  SVN_ERR(svn_rangelist_to_string(&result, rangelist, pool));
+  SVN_TEST_STRING_ASSERT(result->data, "1-5*,7,10-12");
+
+  /* CHANGES refer to the same range objects as RANGELIST, behind a change
+     that comes first in the merged result. */
+  SVN_ERR(svn_rangelist__parse(&rangelist, "3-4*,10-15,20", pool));
+  SVN_ERR(svn_rangelist__parse(&changes, "1-2", pool));
+  for (i = 0; i < rangelist->nelts; i++)
+    APR_ARRAY_PUSH(changes, svn_merge_range_t *)
+      = APR_ARRAY_IDX(rangelist, i, svn_merge_range_t *);
+
+  SVN_ERR(svn_rangelist_merge2(rangelist, changes, pool, pool));
+  SVN_ERR(svn_rangelist_to_string(&result, rangelist, pool));
+  SVN_TEST_STRING_ASSERT(result->data, "1-2,3-4*,10-15,20");
+
+  /* Same with overlaps and mixed inheritability. */
+  SVN_ERR(svn_rangelist__parse(&rangelist, "5-9*,12-14", pool));
+  SVN_ERR(svn_rangelist__parse(&changes, "1-6", pool));
+  for (i = 0; i < rangelist->nelts; i++)
+    APR_ARRAY_PUSH(changes, svn_merge_range_t *)
+      = APR_ARRAY_IDX(rangelist, i, svn_merge_range_t *);
+
+  SVN_ERR(svn_rangelist_merge2(rangelist, changes, pool, pool));
+  SVN_ERR(svn_rangelist_to_string(&result, rangelist, pool));
+  SVN_TEST_STRING_ASSERT(result->data, "1-6,7-9*,12-14");
+
+  return SVN_NO_ERROR;
+}
+
+/* Return a compacted rangelist of the revisions in
+   REVS[RANDOM_REV_ARRAY_LENGTH], which are 0 for revisions not contained
+   in it, 1 for non-inheritable and 2 for inheritable revisions. */
+static svn_rangelist_t *
+rev_states_to_rangelist(const int *revs,
+                        apr_pool_t *pool)
+{
+  svn_rangelist_t *rangelist = apr_array_make(pool, 0,
+                                              sizeof(svn_merge_range_t *));
+  svn_merge_range_t *last = NULL;
+  int i;
+
+  for (i = 1; i < RANDOM_REV_ARRAY_LENGTH; i++)
+    {
+      if (revs[i] == 0)
+        {
+          last = NULL;
+        }
+      else if (last && last->inheritable == (revs[i] == 2))
+        {
+          last->end = i;
+        }
+      else
+        {
+          last = apr_palloc(pool, sizeof(*last));
+          last->start = i - 1;
+          last->end = i;
+          last->inheritable = (revs[i] == 2);
+          APR_ARRAY_PUSH(rangelist, svn_merge_range_t *) = last;
+        }
+    }
+
+  return rangelist;
+}
+
+static svn_error_t *
+test_rangelist_merge_randomly(apr_pool_t *pool)
+{
+  int i;
+  apr_pool_t *iterpool;
+
+  random_rev_array_seed = (apr_uint32_t) apr_time_now();
+
+  iterpool = svn_pool_create(pool);
+
+  for (i = 0; i < 50; i++)
+    {
+      int first_revs[RANDOM_REV_ARRAY_LENGTH];
+      int second_revs[RANDOM_REV_ARRAY_LENGTH];
+      int expected_revs[RANDOM_REV_ARRAY_LENGTH];
+      svn_rangelist_t *rangelist, *changes;
+      svn_string_t *changes_before, *changes_after, *actual, *expected;
+      int j;
+
+      svn_pool_clear(iterpool);
+
+      /* Long runs of equal states make for adjacent and overlapping ranges
+         with both equal and different inheritability. */
+      for (j = 0; j < RANDOM_REV_ARRAY_LENGTH; j++)
+        {
+          first_revs[j] = (j % 4 && j > 0) ? first_revs[j - 1]
+                        : (int)(svn_test_rand(&random_rev_array_seed) % 3);
+          second_revs[j] = (j % 3 && j > 0) ? second_revs[j - 1]
+                         : (int)(svn_test_rand(&random_rev_array_seed) % 3);
+          expected_revs[j] = (first_revs[j] > second_revs[j])
+                           ? first_revs[j] : second_revs[j];
+        }
+
+      rangelist = rev_states_to_rangelist(first_revs, iterpool);
+      changes = rev_states_to_rangelist(second_revs, iterpool);
+      SVN_ERR(svn_rangelist_to_string(&changes_before, changes, iterpool));
+
+      SVN_ERR(svn_rangelist_merge2(rangelist, changes, iterpool, iterpool));
+
+      SVN_ERR(svn_rangelist_to_string(&actual, rangelist, iterpool));
+      SVN_ERR(svn_rangelist_to_string(&expected,
+                                      rev_states_to_rangelist(expected_revs,
+                                                              iterpool),
+                                      iterpool));
+      SVN_TEST_STRING_ASSERT(actual->data, expected->data);
+
+      SVN_ERR(svn_rangelist_to_string(&changes_after, changes, iterpool));
+      SVN_TEST_STRING_ASSERT(changes_after->data, changes_before->data);
+    }
+
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_rangelist_diff(apr_pool_t *pool)
 {
@@ -1710,6 +1932,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "turning mergeinfo back into a string"),
     SVN_TEST_PASS2(test_rangelist_merge,
                    "merge of rangelists"),
+    SVN_TEST_PASS2(test_rangelist_combine_adjacent,
+                   "combining adjacent and overlapping ranges"),
+    SVN_TEST_PASS2(test_rangelist_merge_aliasing,
+                   "merging rangelists sharing ranges"),
+    SVN_TEST_PASS2(test_rangelist_merge_randomly,
+                   "merging random rangelists"),
     SVN_TEST_PASS2(test_rangelist_diff,
                    "diff of rangelists"),
     SVN_TEST_PASS2(test_remove_prefix_from_catalog,
@@ -31,12 +31,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <apr_pools.h>
+#include <apr_time.h>
 
 #include "../svn_test.h"
 
 #include "svn_error.h"
 #include "svn_string.h"   /* This includes <apr_*.h> */
 #include "private/svn_packed_data.h"
+#include "private/svn_subr_private.h"
 
 /* Take the WRITE_ROOT, serialize its contents, parse it again into a new
  * data root and return it in *READ_ROOT.  Allocate it in POOL.
@@ -191,6 +193,226 @@ test_int_stream(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Check that COUNT signed numbers from VALUES can be read from a packed
+ * data stream with svn_packed__get_uints, after reading the first FIRST
+ * of them individually.  Deltify data in the stream if DIFF is set.  Use
+ * POOL for allocations.
+ */
+static svn_error_t *
+verify_batch_read(const apr_int64_t *values,
+                  apr_size_t count,
+                  apr_size_t first,
+                  svn_boolean_t diff,
+                  apr_pool_t *pool)
+{
+  svn_packed__data_root_t *root = svn_packed__data_create_root(pool);
+  svn_packed__int_stream_t *stream
+    = svn_packed__create_int_stream(root, diff, TRUE);
+  apr_uint64_t *read_values = apr_palloc(pool,
+                                         (count + 2) * sizeof(*read_values));
+
+  apr_size_t i;
+  for (i = 0; i < count; ++i)
+    svn_packed__add_int(stream, values[i]);
+
+  SVN_ERR(get_read_root(&root, root, pool));
+  stream = svn_packed__first_int_stream(root);
+  SVN_TEST_ASSERT(stream);
+
+  for (i = 0; i < first; ++i)
+    SVN_TEST_ASSERT(svn_packed__get_int(stream) == values[i]);
+
+  /* read the rest in one go plus 2 values beyond eos */
+  svn_packed__get_uints(stream, read_values, count - first + 2);
+  for (i = first; i < count; ++i)
+    SVN_TEST_ASSERT((apr_int64_t)read_values[i - first] == values[i]);
+
+  SVN_TEST_ASSERT(read_values[count - first] == 0);
+  SVN_TEST_ASSERT(read_values[count - first + 1] == 0);
+  SVN_TEST_ASSERT(svn_packed__int_count(stream) == 0);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_batch_read(apr_pool_t *pool)
+{
+  enum { COUNT = 1000 };
+  apr_int64_t values[COUNT];
+  apr_size_t i;
+
+  /* a mix of small and large numbers, positive and negative */
+  for (i = 0; i < COUNT; ++i)
+    if (i % 7 == 0)
+      values[i] = APR_INT64_MAX - (apr_int64_t)i;
+    else if (i % 7 == 1)
+      values[i] = -APR_INT64_MAX + (apr_int64_t)i;
+    else
+      values[i] = (apr_int64_t)(i * i) - 5000;
+
+  SVN_ERR(verify_batch_read(values, COUNT, 0, FALSE, pool));
+  SVN_ERR(verify_batch_read(values, COUNT, 0, TRUE, pool));
+  SVN_ERR(verify_batch_read(values, COUNT, 3, FALSE, pool));
+  SVN_ERR(verify_batch_read(values, COUNT, 3, TRUE, pool));
+  SVN_ERR(verify_batch_read(values, 5, 0, TRUE, pool));
+
+  return SVN_NO_ERROR;
+}
+
+/* Encode VALUE in the low-order first 7b/8b format at P and return the
+ * position after it.
+ */
+static unsigned char *
+encode_uint_le(unsigned char *p,
+               apr_uint64_t value)
+{
+  while (value >= 0x80)
+    {
+      *p++ = (unsigned char)((value & 0x7f) | 0x80);
+      value >>= 7;
+    }
+
+  *p++ = (unsigned char)value;
+  return p;
+}
+
+/* Return the I-th test value for the bulk decoder.  Most of them are
+ * small, as is typical for deltified data.
+ */
+static apr_uint64_t
+bulk_test_value(apr_size_t i)
+{
+  switch (i % 23)
+    {
+      case 5:  return APR_UINT64_MAX - i;
+      case 11: return (apr_uint64_t)i * 0x12345;
+      case 17: return 0x80;
+      default: return (i * 7) % 0x80;
+    }
+}
+
+/* Encode COUNT test values into a buffer allocated in POOL.  Return it
+ * and set *LEN to its length.
+ */
+static unsigned char *
+encode_bulk_test_values(apr_size_t *len,
+                        apr_size_t count,
+                        apr_pool_t *pool)
+{
+  unsigned char *buffer
+    = apr_palloc(pool, count * SVN__MAX_ENCODED_UINT_LEN + 1);
+  unsigned char *p = buffer;
+  apr_size_t i;
+
+  for (i = 0; i < count; ++i)
+    p = encode_uint_le(p, bulk_test_value(i));
+
+  *len = p - buffer;
+  return buffer;
+}
+
+static svn_error_t *
+test_bulk_decode(apr_pool_t *pool)
+{
+  enum { COUNT = 1000 };
+  apr_uint64_t values[COUNT];
+  apr_size_t ends[COUNT];
+  apr_size_t len, count, i;
+  const unsigned char *end;
+  unsigned char *buffer = encode_bulk_test_values(&len, COUNT, pool);
+  unsigned char overlong[SVN__MAX_ENCODED_UINT_LEN + 1];
+
+  /* all at once */
+  count = COUNT;
+  end = svn__decode_uints(values, ends, &count, buffer, buffer + len);
+  SVN_TEST_ASSERT(count == COUNT);
+  SVN_TEST_ASSERT(end == buffer + len);
+  SVN_TEST_ASSERT(ends[COUNT - 1] == len);
+  for (i = 0; i < COUNT; ++i)
+    SVN_TEST_ASSERT(values[i] == bulk_test_value(i));
+
+  /* the ENDS must be consistent with decoding number by number */
+  for (i = 0; i + 1 < COUNT; ++i)
+    {
+      apr_uint64_t value;
+      apr_size_t one = 1;
+      end = svn__decode_uints(&value, NULL, &one, buffer + ends[i],
+                              buffer + len);
+      SVN_TEST_ASSERT(one == 1);
+      SVN_TEST_ASSERT(value == values[i + 1]);
+      SVN_TEST_ASSERT(end == buffer + ends[i + 1]);
+    }
+
+  /* limited capacity */
+  count = 37;
+  end = svn__decode_uints(values, NULL, &count, buffer, buffer + len);
+  SVN_TEST_ASSERT(count == 37);
+  SVN_TEST_ASSERT(end == buffer + ends[36]);
+
+  /* incomplete last number */
+  count = COUNT;
+  end = svn__decode_uints(values, NULL, &count, buffer, buffer + len - 1);
+  SVN_TEST_ASSERT(count < COUNT);
+  SVN_TEST_ASSERT(end == buffer + ends[count - 1]);
+
+  /* numbers longer than 10 bytes are rejected */
+  memset(overlong, 0x80, sizeof(overlong));
+  overlong[sizeof(overlong) - 1] = 1;
+  count = 1;
+  end = svn__decode_uints(values, NULL, &count, overlong,
+                          overlong + sizeof(overlong));
+  SVN_TEST_ASSERT(count == 0);
+  SVN_TEST_ASSERT(end == overlong);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_bulk_decode_speed(const svn_test_opts_t *opts,
+                       apr_pool_t *pool)
+{
+  enum { COUNT = 100000, RUNS = 20 };
+  apr_uint64_t *values = apr_palloc(pool, COUNT * sizeof(*values));
+  apr_uint64_t sum_bulk = 0, sum_single = 0;
+  apr_size_t len, i, k;
+  unsigned char *buffer = encode_bulk_test_values(&len, COUNT, pool);
+  apr_time_t start, bulk_time, single_time;
+
+  /* bulk decoding */
+  start = apr_time_now();
+  for (k = 0; k < RUNS; ++k)
+    {
+      apr_size_t count = COUNT;
+      svn__decode_uints(values, NULL, &count, buffer, buffer + len);
+      SVN_TEST_ASSERT(count == COUNT);
+      for (i = 0; i < COUNT; ++i)
+        sum_bulk += values[i];
+    }
+  bulk_time = apr_time_now() - start;
+
+  /* number by number */
+  start = apr_time_now();
+  for (k = 0; k < RUNS; ++k)
+    {
+      const unsigned char *p = buffer;
+      for (i = 0; i < COUNT; ++i)
+        {
+          apr_size_t count = 1;
+          p = svn__decode_uints(&values[i], NULL, &count, p, buffer + len);
+          sum_single += values[i];
+        }
+    }
+  single_time = apr_time_now() - start;
+
+  SVN_TEST_ASSERT(sum_bulk == sum_single);
+  if (opts->verbose)
+    printf("decoding %d numbers %d times: %" APR_TIME_T_FMT " usec in bulk, "
+           "%" APR_TIME_T_FMT " usec one by one\n",
+           COUNT, RUNS, bulk_time, single_time);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_byte_stream(apr_pool_t *pool)
 {
@@ -568,6 +790,12 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test a single int stream"),
     SVN_TEST_PASS2(test_byte_stream,
                    "test a single bytes stream"),
+    SVN_TEST_PASS2(test_batch_read,
+                   "test reading many ints at once"),
+    SVN_TEST_PASS2(test_bulk_decode,
+                   "test bulk decoding of 7b/8b numbers"),
+    SVN_TEST_OPTS_PASS(test_bulk_decode_speed,
+                       "measure bulk decoding of 7b/8b numbers"),
     SVN_TEST_PASS2(test_empty_structure,
                    "test empty, nested structure"),
     SVN_TEST_PASS2(test_full_structure,
@@ -29,6 +29,7 @@
 #endif
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <apr_general.h>
 
@@ -45,6 +46,9 @@
 #define SVN_DEPRECATED
 
 #include "svn_path.h"
+#include "svn_hash.h"
+#include "svn_sorts.h"
+#include "private/svn_sorts_private.h"
 
 
 /* Using a symbol, because I tried experimenting with different
@@ -1691,6 +1695,61 @@ test_path_resolve_repos_relative_url(apr_pool_t *pool)
 }
 
 
+static svn_error_t *
+test_sort_paths(apr_pool_t *pool)
+{
+  /* Few and similar characters, so that there are many common prefixes
+     and duplicates.  '-' sorts before '/' in plain byte order. */
+  static const char chars[] = "ab-A~";
+  apr_array_header_t *paths = apr_array_make(pool, 0, sizeof(const char *));
+  apr_array_header_t *expected;
+  apr_hash_t *hash = apr_hash_make(pool);
+  apr_array_header_t *items;
+  apr_uint32_t seed = 4711;
+  int i;
+
+  for (i = 0; i < 2000; ++i)
+    {
+      svn_stringbuf_t *path = svn_stringbuf_create_empty(pool);
+      int components = 1 + svn_test_rand(&seed) % 4;
+
+      while (components--)
+        {
+          int len = 1 + svn_test_rand(&seed) % 3;
+
+          if (path->len)
+            svn_stringbuf_appendbyte(path, '/');
+          while (len--)
+            svn_stringbuf_appendbyte(path,
+                                     chars[svn_test_rand(&seed)
+                                           % (sizeof(chars) - 1)]);
+        }
+
+      APR_ARRAY_PUSH(paths, const char *) = path->data;
+      svn_hash_sets(hash, path->data, path->data);
+    }
+
+  /* Compare with what qsort() makes of it. */
+  expected = apr_array_copy(pool, paths);
+  qsort(expected->elts, expected->nelts, expected->elt_size,
+        svn_sort_compare_paths);
+
+  svn_sort__array(paths, svn_sort_compare_paths);
+  for (i = 0; i < paths->nelts; ++i)
+    SVN_TEST_STRING_ASSERT(APR_ARRAY_IDX(paths, i, const char *),
+                           APR_ARRAY_IDX(expected, i, const char *));
+
+  items = svn_sort__hash(hash, svn_sort_compare_items_as_paths, pool);
+  SVN_TEST_INT_ASSERT(items->nelts, apr_hash_count(hash));
+  for (i = 1; i < items->nelts; ++i)
+    SVN_TEST_ASSERT(svn_path_compare_paths(
+                      APR_ARRAY_IDX(items, i - 1, svn_sort__item_t).key,
+                      APR_ARRAY_IDX(items, i, svn_sort__item_t).key) < 0);
+
+  return SVN_NO_ERROR;
+}
+
+
 /* local define to support XFail-ing tests on Windows/Cygwin only */
 #ifdef SVN_USE_DOS_PATHS
 #define WINDOWS_OR_CYGWIN TRUE
@@ -1760,6 +1819,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test svn_path_is_repos_relative_url"),
     SVN_TEST_PASS2(test_path_resolve_repos_relative_url,
                    "test svn_path_resolve_repos_relative_url"),
+    SVN_TEST_PASS2(test_sort_paths,
+                   "test sorting paths"),
     SVN_TEST_NULL
   };
 
@@ -883,6 +883,81 @@ unparse_list(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+parse_proplist_data(apr_pool_t *pool)
+{
+  apr_hash_t *props;
+  apr_hash_t *parsed;
+  svn_skel_t *skel;
+  svn_stringbuf_t *str;
+  svn_string_t *value;
+  apr_size_t i;
+  static const char *valid[] =
+    {
+      "()",
+      "(name value)",
+      "( 4 name  5 value a 0 )",
+      "(4 name5 value)",
+      "(a b) trailing garbage"
+    };
+  static const char *invalid[] =
+    {
+      "",
+      " ()",
+      "name",
+      "(name)",
+      "(name value",
+      "(name (value))",
+      "(name 9 value)",
+      "(name 5value)",
+      "[name value]"
+    };
+
+  /* Round-trip a proplist. */
+  props = apr_hash_make(pool);
+  apr_hash_set(props, "svn:eol-style", APR_HASH_KEY_STRING,
+               svn_string_create("native", pool));
+  apr_hash_set(props, "empty", APR_HASH_KEY_STRING,
+               svn_string_create_empty(pool));
+  apr_hash_set(props, "with space", APR_HASH_KEY_STRING,
+               svn_string_create("a (b) c\n", pool));
+  SVN_ERR(svn_skel__unparse_proplist(&skel, props, pool));
+  str = svn_skel__unparse(skel, pool);
+
+  SVN_ERR(svn_skel__parse_proplist_data(&parsed, str->data, str->len, pool));
+  SVN_TEST_ASSERT(apr_hash_count(parsed) == 3);
+  value = apr_hash_get(parsed, "svn:eol-style", APR_HASH_KEY_STRING);
+  SVN_TEST_STRING_ASSERT(value->data, "native");
+  value = apr_hash_get(parsed, "empty", APR_HASH_KEY_STRING);
+  SVN_TEST_ASSERT(value->len == 0 && value->data[0] == '\0');
+  value = apr_hash_get(parsed, "with space", APR_HASH_KEY_STRING);
+  SVN_TEST_STRING_ASSERT(value->data, "a (b) c\n");
+
+  /* Accept and reject the same data as svn_skel__parse_proplist. */
+  for (i = 0; i < sizeof(valid) / sizeof(valid[0]); ++i)
+    {
+      apr_hash_t *expected;
+
+      skel = svn_skel__parse(valid[i], strlen(valid[i]), pool);
+      SVN_ERR(svn_skel__parse_proplist(&expected, skel, pool));
+      SVN_ERR(svn_skel__parse_proplist_data(&parsed, valid[i],
+                                            strlen(valid[i]), pool));
+      SVN_TEST_ASSERT(apr_hash_count(parsed) == apr_hash_count(expected));
+    }
+
+  value = apr_hash_get(parsed, "a", 1);
+  SVN_TEST_STRING_ASSERT(value->data, "b");
+
+  for (i = 0; i < sizeof(invalid) / sizeof(invalid[0]); ++i)
+    SVN_TEST_ASSERT_ERROR(svn_skel__parse_proplist_data(&parsed, invalid[i],
+                                                        strlen(invalid[i]),
+                                                        pool),
+                          SVN_ERR_FS_MALFORMED_SKEL);
+
+  return SVN_NO_ERROR;
+}
+
+
 
 /* The test table.  */
 
@@ -903,6 +978,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "unparse implicit-length atoms"),
     SVN_TEST_PASS2(unparse_list,
                    "unparse lists"),
+    SVN_TEST_PASS2(parse_proplist_data,
+                   "parse proplists without building skels"),
     SVN_TEST_NULL
   };
 
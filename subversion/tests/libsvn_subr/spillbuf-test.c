@@ -21,6 +21,7 @@
  * ====================================================================
  */
 
+#include "svn_pools.h"
 #include "svn_types.h"
 
 #include "private/svn_subr_private.h"
@@ -558,6 +559,55 @@ test_spillbuf_file_attrs_spill_all(apr_pool_t *pool)
   return test_spillbuf__file_attrs(pool, TRUE, buf);
 }
 
+static svn_error_t *
+test_spillbuf_large(apr_pool_t *pool)
+{
+  /* Spill enough to read part of the content back through a memory map.
+     Interleave the writes with the reads so that the mapping needs to
+     be moved and the spill file grows while mapped.  */
+  const apr_size_t blocksize = 1000;
+  svn_spillbuf_t *buf = svn_spillbuf__create(blocksize, blocksize, pool);
+  char *block = apr_palloc(pool, blocksize);
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  int written = 0;
+  int read = 0;
+  int round;
+
+  for (round = 0; round < 2; ++round)
+    {
+      int i;
+
+      for (i = 0; i < 2000; ++i, ++written)
+        {
+          apr_size_t k;
+
+          for (k = 0; k < blocksize; ++k)
+            block[k] = (char)(written * 7 + k);
+
+          SVN_ERR(svn_spillbuf__write(buf, block, blocksize, iterpool));
+        }
+
+      for (i = 0; i < (round ? 2500 : 1500); ++i, ++read)
+        {
+          const char *readptr;
+          apr_size_t readlen;
+          apr_size_t k;
+
+          svn_pool_clear(iterpool);
+          SVN_ERR(svn_spillbuf__read(&readptr, &readlen, buf, iterpool));
+          SVN_TEST_ASSERT(readptr != NULL && readlen == blocksize);
+
+          for (k = 0; k < blocksize; ++k)
+            SVN_TEST_ASSERT(readptr[k] == (char)(read * 7 + k));
+        }
+    }
+
+  SVN_TEST_ASSERT(svn_spillbuf__get_size(buf) == 0);
+  svn_pool_destroy(iterpool);
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -589,6 +639,8 @@ static struct svn_test_descriptor_t test_funcs[] =
     SVN_TEST_PASS2(test_spillbuf_file_attrs, "check spill file properties"),
     SVN_TEST_PASS2(test_spillbuf_file_attrs_spill_all,
                    "check spill file properties (spill-all-data)"),
+    SVN_TEST_PASS2(test_spillbuf_large,
+                   "read back a large spill file"),
     SVN_TEST_NULL
   };
 
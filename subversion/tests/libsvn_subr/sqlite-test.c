@@ -170,6 +170,73 @@ test_sqlite_txn_commit_busy(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* Set *MODE to the journal mode of SDB as returned by the PRAGMA statement
+   with index STMT_IDX. */
+static svn_error_t *
+get_journal_mode(const char **mode,
+                 svn_sqlite__db_t *sdb,
+                 int stmt_idx,
+                 apr_pool_t *pool)
+{
+  svn_sqlite__stmt_t *stmt;
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, stmt_idx));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+  *mode = svn_sqlite__column_text(stmt, 0, pool);
+
+  return svn_error_trace(svn_sqlite__reset(stmt));
+}
+
+static svn_error_t *
+test_sqlite_wal_persists(apr_pool_t *pool)
+{
+  svn_sqlite__db_t *sdb;
+  svn_sqlite__stmt_t *stmt;
+  const char *db_abspath;
+  const char *mode;
+
+  static const char *const statements[] = {
+    "CREATE TABLE test (one TEXT NOT NULL PRIMARY KEY)",
+
+    "INSERT INTO test(one) VALUES ('foo')",
+
+    "SELECT one FROM test",
+
+    "PRAGMA journal_mode",
+
+    NULL
+  };
+
+  /* New databases use a rollback journal. */
+  SVN_ERR(open_db(&sdb, &db_abspath, "wal_persists", statements, 0, pool));
+  SVN_ERR(svn_sqlite__exec_statements(sdb, 0));
+  SVN_ERR(get_journal_mode(&mode, sdb, 3, pool));
+  SVN_TEST_STRING_ASSERT(mode, "truncate");
+
+  SVN_ERR(svn_sqlite__enable_wal(sdb, 0));
+  SVN_ERR(get_journal_mode(&mode, sdb, 3, pool));
+  SVN_TEST_STRING_ASSERT(mode, "wal");
+
+  SVN_ERR(svn_sqlite__exec_statements(sdb, 1));
+  SVN_ERR(svn_sqlite__close(sdb));
+
+  /* Opening the database without enabling WAL must neither switch it back
+     to a rollback journal nor lose any data. */
+  SVN_ERR(svn_sqlite__open(&sdb, db_abspath, svn_sqlite__mode_readwrite,
+                           statements, 0, NULL, 0, pool, pool));
+  SVN_ERR(get_journal_mode(&mode, sdb, 3, pool));
+  SVN_TEST_STRING_ASSERT(mode, "wal");
+
+  SVN_ERR(svn_sqlite__get_statement(&stmt, sdb, 2));
+  SVN_ERR(svn_sqlite__step_row(stmt));
+  SVN_TEST_STRING_ASSERT(svn_sqlite__column_text(stmt, 0, NULL), "foo");
+  SVN_ERR(svn_sqlite__reset(stmt));
+
+  SVN_ERR(svn_sqlite__close(sdb));
+
+  return SVN_NO_ERROR;
+}
+
 
 static int max_threads = 1;
 
@@ -180,6 +247,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "sqlite reset"),
     SVN_TEST_PASS2(test_sqlite_txn_commit_busy,
                    "sqlite busy on transaction commit"),
+    SVN_TEST_PASS2(test_sqlite_wal_persists,
+                   "sqlite keeps write-ahead logging on reopen"),
     SVN_TEST_NULL
   };
 
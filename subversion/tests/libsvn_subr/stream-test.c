@@ -26,9 +26,11 @@
 #include "svn_io.h"
 #include "svn_subst.h"
 #include "svn_base64.h"
+#include "svn_sorts.h"
 #include <apr_general.h>
 
 #include "private/svn_io_private.h"
+#include "private/svn_subr_private.h"
 
 #include "../svn_test.h"
 
@@ -870,6 +872,75 @@ test_stream_checksum(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_stream_borrow_writev(apr_pool_t *pool)
+{
+  svn_string_t *str =
+    svn_string_create("The quick brown fox jumps over the lazy dog", pool);
+  svn_stringbuf_t *buf = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *compressed = svn_stringbuf_create_empty(pool);
+  svn_checksum_t *checksum;
+  svn_string_t vec[3];
+  svn_stream_t *stream;
+  const char *data;
+  apr_size_t len;
+
+  /* Borrowing from a string stream hands out its own data. */
+  stream = svn_stream_from_string(str, pool);
+  SVN_TEST_ASSERT(svn_stream__supports_borrow(stream));
+  len = 9;
+  SVN_ERR(svn_stream__borrow(stream, &data, &len));
+  SVN_TEST_ASSERT(len == 9 && data == str->data);
+  len = 100;
+  SVN_ERR(svn_stream__borrow(stream, &data, &len));
+  SVN_TEST_ASSERT(len == str->len - 9 && data == str->data + 9);
+  len = 100;
+  SVN_ERR(svn_stream__borrow(stream, &data, &len));
+  SVN_TEST_ASSERT(len == 0);
+
+  /* Borrowing through a checksummed stream updates the checksum. */
+  stream = svn_stream_checksummed2(svn_stream_from_string(str, pool),
+                                   &checksum, NULL, svn_checksum_md5,
+                                   FALSE, pool);
+  SVN_TEST_ASSERT(svn_stream__supports_borrow(stream));
+  do
+    {
+      len = 5;
+      SVN_ERR(svn_stream__borrow(stream, &data, &len));
+    }
+  while (len);
+  SVN_ERR(svn_stream_close(stream));
+  SVN_TEST_STRING_ASSERT("9e107d9d372bb6826bd81d3542a419d6",
+                         svn_checksum_to_cstring(checksum, pool));
+
+  /* Gather writes through compression, borrowing reads back. */
+  vec[0].data = str->data;
+  vec[0].len = 4;
+  vec[1].data = str->data + 4;
+  vec[1].len = 0;
+  vec[2].data = str->data + 4;
+  vec[2].len = str->len - 4;
+
+  stream = svn_stream_compressed(svn_stream_from_stringbuf(compressed, pool),
+                                 pool);
+  SVN_ERR(svn_stream__writev(stream, vec, 3));
+  SVN_ERR(svn_stream_close(stream));
+
+  stream = svn_stream_compressed(svn_stream_from_stringbuf(compressed, pool),
+                                 pool);
+  SVN_ERR(svn_stream_copy3(stream, svn_stream_from_stringbuf(buf, pool),
+                           NULL, NULL, pool));
+  SVN_TEST_STRING_ASSERT(buf->data, str->data);
+
+  /* Disowned streams forward gather writes. */
+  svn_stringbuf_setempty(buf);
+  stream = svn_stream_from_stringbuf(buf, pool);
+  SVN_ERR(svn_stream__writev(svn_stream_disown(stream, pool), vec, 3));
+  SVN_TEST_STRING_ASSERT(buf->data, str->data);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_stream_readline_file(const char *testname,
                           const char *eol,
@@ -1000,6 +1071,149 @@ test_stream_readline_file_crlf(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_stream_read_ahead(apr_pool_t *pool)
+{
+  svn_stringbuf_t *source = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *line;
+  svn_stream_t *stream;
+  svn_boolean_t eof;
+  char buffer[1000];
+  apr_size_t len;
+  int i;
+
+  /* Spread enough lines over many stream chunks. */
+  for (i = 0; i < 100000; ++i)
+    svn_stringbuf_appendcstr(source,
+                             apr_psprintf(pool, "line %d\r\n", i));
+
+  /* Read everything line by line, using only 2 blocks of read-ahead. */
+  stream = svn_stream__read_ahead(svn_stream_from_stringbuf(source, pool),
+                                  2, pool);
+  for (i = 0; i < 100000; ++i)
+    {
+      SVN_ERR(svn_stream_readline(stream, &line, "\r\n", &eof, pool));
+      SVN_TEST_STRING_ASSERT(line->data, apr_psprintf(pool, "line %d", i));
+      SVN_TEST_ASSERT(!eof);
+    }
+
+  SVN_ERR(svn_stream_readline(stream, &line, "\r\n", &eof, pool));
+  SVN_TEST_ASSERT(line->len == 0);
+  SVN_TEST_ASSERT(eof);
+  SVN_ERR(svn_stream_close(stream));
+
+  /* Mix LF lines with full reads. */
+  stream = svn_stream__read_ahead(svn_stream_from_stringbuf(source, pool),
+                                  8, pool);
+  SVN_ERR(svn_stream_readline(stream, &line, "\n", &eof, pool));
+  SVN_TEST_STRING_ASSERT(line->data, "line 0\r");
+
+  len = sizeof(buffer);
+  SVN_ERR(svn_stream_read_full(stream, buffer, &len));
+  SVN_TEST_ASSERT(len == sizeof(buffer));
+  SVN_TEST_ASSERT(memcmp(buffer, source->data + strlen("line 0\r\n"),
+                         len) == 0);
+
+  /* Close before the end of the source. */
+  SVN_ERR(svn_stream_close(stream));
+
+  /* Empty sources are at EOF immediately. */
+  stream = svn_stream__read_ahead(svn_stream_empty(pool), 4, pool);
+  len = sizeof(buffer);
+  SVN_ERR(svn_stream_read_full(stream, buffer, &len));
+  SVN_TEST_ASSERT(len == 0);
+  SVN_ERR(svn_stream_close(stream));
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_stream_lz4_compressed(apr_pool_t *pool)
+{
+  apr_size_t sizes[] = { 0, 1, 1000, 0x10000, 0x10001, 300000 };
+  apr_pool_t *iterpool = svn_pool_create(pool);
+  apr_size_t i;
+
+  if (!svn__lz4_supported())
+    return svn_error_create(SVN_ERR_TEST_SKIPPED, NULL,
+                            "LZ4 is not supported by this build");
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+    {
+      svn_stringbuf_t *origbuf, *outbuf, *inbuf;
+      svn_stream_t *stream;
+      apr_size_t len, pos;
+
+      svn_pool_clear(iterpool);
+
+      /* Mix compressible and random data. */
+      origbuf = generate_test_bytes((int)sizes[i] / 2, iterpool);
+      while (origbuf->len < sizes[i])
+        svn_stringbuf_appendbyte(origbuf, (char)('a' + origbuf->len % 3));
+
+      /* Write in odd-sized pieces to cross the block boundaries. */
+      outbuf = svn_stringbuf_create_empty(iterpool);
+      stream = svn_stream__lz4_compressed(
+                 svn_stream_from_stringbuf(outbuf, iterpool), iterpool);
+      for (pos = 0; pos < origbuf->len; pos += len)
+        {
+          len = MIN(origbuf->len - pos, 4999);
+          SVN_ERR(svn_stream_write(stream, origbuf->data + pos, &len));
+        }
+      SVN_ERR(svn_stream_close(stream));
+
+      stream = svn_stream__lz4_compressed(
+                 svn_stream_from_stringbuf(outbuf, iterpool), iterpool);
+      SVN_ERR(svn_stringbuf_from_stream(&inbuf, stream, 0, iterpool));
+      SVN_ERR(svn_stream_close(stream));
+
+      SVN_TEST_ASSERT(svn_stringbuf_compare(inbuf, origbuf));
+    }
+
+  svn_pool_destroy(iterpool);
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_base64_all_chars(apr_pool_t *pool)
+{
+  /* These bytes encode to every base64 char in order.  Repeating them
+     19 times yields 16 full lines of input for the line-based code. */
+  static const char alphabet_data[] =
+    "\x00\x10\x83\x10\x51\x87\x20\x92\x8b\x30\xd3\x8f\x41\x14\x93\x51"
+    "\x55\x97\x61\x96\x9b\x71\xd7\x9f\x82\x18\xa3\x92\x59\xa7\xa2\x9a"
+    "\xab\xb2\xdb\xaf\xc3\x1c\xb3\xd3\x5d\xb7\xe3\x9e\xbb\xf3\xdf\xbf";
+  static const char alphabet[]
+    = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  svn_stringbuf_t *data = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *expected = svn_stringbuf_create_empty(pool);
+  svn_string_t data_str;
+  const svn_string_t *encoded;
+  const svn_string_t *decoded;
+  int i;
+
+  for (i = 0; i < 19; i++)
+    {
+      svn_stringbuf_appendbytes(data, alphabet_data,
+                                sizeof(alphabet_data) - 1);
+      svn_stringbuf_appendcstr(expected, alphabet);
+    }
+
+  data_str.data = data->data;
+  data_str.len = data->len;
+
+  encoded = svn_base64_encode_string2(&data_str, FALSE, pool);
+  SVN_TEST_STRING_ASSERT(encoded->data, expected->data);
+  decoded = svn_base64_decode_string(encoded, pool);
+  SVN_TEST_ASSERT(svn_string_compare(decoded, &data_str));
+
+  encoded = svn_base64_encode_string2(&data_str, TRUE, pool);
+  decoded = svn_base64_decode_string(encoded, pool);
+  SVN_TEST_ASSERT(svn_string_compare(decoded, &data_str));
+
+  return SVN_NO_ERROR;
+}
+
 /* The test table.  */
 
 static int max_threads = 1;
@@ -1037,6 +1251,14 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test reading LF-terminated lines from file"),
     SVN_TEST_PASS2(test_stream_readline_file_crlf,
                    "test reading CRLF-terminated lines from file"),
+    SVN_TEST_PASS2(test_stream_read_ahead,
+                   "test read-ahead streams"),
+    SVN_TEST_PASS2(test_stream_lz4_compressed,
+                   "test LZ4 compressed streams"),
+    SVN_TEST_PASS2(test_base64_all_chars,
+                   "test base64 encoding of all chars"),
+    SVN_TEST_PASS2(test_stream_borrow_writev,
+                   "test borrowing reads and gather writes"),
     SVN_TEST_NULL
   };
 
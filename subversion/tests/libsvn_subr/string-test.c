@@ -1013,6 +1013,75 @@ test_stringbuf_set(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_string_matching_long(apr_pool_t *pool)
+{
+  /* Exercise the chunky code paths for all mismatch positions within
+   * buffers spanning several chunks, using different alignments. */
+  enum { LEN = 100 };
+  char a[LEN + 8];
+  char b[LEN + 8];
+  apr_size_t offset, len, pos, i;
+
+  for (offset = 0; offset < 8; ++offset)
+    for (len = 0; len <= LEN; ++len)
+      {
+        const char *a_start = a + offset;
+        const char *b_start = b + (7 - offset);
+
+        for (i = 0; i < len; ++i)
+          a[offset + i] = b[7 - offset + i] = (char)('a' + i % 26);
+
+        /* identical content */
+        SVN_TEST_INT_ASSERT(svn_cstring__match_length(a_start, b_start,
+                                                      len),
+                            len);
+        SVN_TEST_INT_ASSERT(svn_cstring__reverse_match_length(a_start + len,
+                                                              b_start + len,
+                                                              len),
+                            len);
+
+        /* single mismatch at POS */
+        for (pos = 0; pos < len; ++pos)
+          {
+            a[offset + pos] = '_';
+            SVN_TEST_INT_ASSERT(svn_cstring__match_length(a_start, b_start,
+                                                          len),
+                                pos);
+            SVN_TEST_INT_ASSERT(svn_cstring__reverse_match_length(
+                                    a_start + len, b_start + len, len),
+                                len - pos - 1);
+            a[offset + pos] = b[7 - offset + pos];
+          }
+      }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_string_intern(apr_pool_t *pool)
+{
+  svn_string__interner_t *interner = svn_string__interner_create(pool);
+  const char *path = "/trunk/subversion/libsvn_subr";
+  char copy[] = "/trunk/subversion/libsvn_subr";
+  const char *a, *b, *c;
+
+  a = svn_string__intern(interner, path, strlen(path));
+  b = svn_string__intern(interner, copy, strlen(copy));
+  c = svn_string__intern(interner, path, strlen("/trunk"));
+
+  /* Equal values map to the same interned copy. */
+  SVN_TEST_STRING_ASSERT(a, path);
+  SVN_TEST_ASSERT(a == b && a != path && a != copy);
+
+  /* Prefixes are separate strings and NUL-terminated. */
+  SVN_TEST_STRING_ASSERT(c, "/trunk");
+  SVN_TEST_ASSERT(c != a);
+  SVN_TEST_ASSERT(c == svn_string__intern(interner, "/trunk", 6));
+
+  return SVN_NO_ERROR;
+}
+
 /*
    ====================================================================
    If you add a new test to this file, update this array.
@@ -1095,6 +1164,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test svn_stringbuf_leftchop"),
     SVN_TEST_PASS2(test_stringbuf_set,
                    "test svn_stringbuf_set()"),
+    SVN_TEST_PASS2(test_string_matching_long,
+                   "test string matching across chunks"),
+    SVN_TEST_PASS2(test_string_intern,
+                   "test string interning"),
     SVN_TEST_NULL
   };
 
@@ -248,6 +248,65 @@ test_svn_subst_translate_cstring2(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_svn_subst_translate_long_runs(apr_pool_t *pool)
+{
+  svn_stringbuf_t *source = svn_stringbuf_create_empty(pool);
+  svn_stringbuf_t *expected = svn_stringbuf_create_empty(pool);
+  apr_hash_t *keywords = apr_hash_make(pool);
+  const char *result;
+  int i;
+
+  svn_hash_sets(keywords, "Rev", svn_string_create("42", pool));
+
+  /* Put EOLs and keywords at all sorts of offsets within and across
+     the blocks that get scanned at once, with runs of plain text of
+     up to 100 bytes in between. */
+  for (i = 0; i < 500; i++)
+    {
+      const char *text = apr_psprintf(pool, "%.*s",
+                                      (i * 7) % 101,
+                                      "0123456789abcdefghijklmnopqrstuvwxyz"
+                                      "0123456789abcdefghijklmnopqrstuvwxyz"
+                                      "0123456789abcdefghijklmnopqrstuvwxyz");
+
+      svn_stringbuf_appendcstr(source, text);
+      svn_stringbuf_appendcstr(expected, text);
+      switch (i % 5)
+        {
+          case 0:
+            svn_stringbuf_appendcstr(source, "\n");
+            svn_stringbuf_appendcstr(expected, "\r\n");
+            break;
+          case 1:
+            svn_stringbuf_appendcstr(source, "$Rev$");
+            svn_stringbuf_appendcstr(expected, "$Rev: 42 $");
+            break;
+          case 2:
+            svn_stringbuf_appendcstr(source, "$ $Rev$\r\n");
+            svn_stringbuf_appendcstr(expected, "$ $Rev: 42 $\r\n");
+            break;
+          case 3:
+            svn_stringbuf_appendcstr(source, "\r");
+            svn_stringbuf_appendcstr(expected, "\r\n");
+            break;
+          default:
+            break;
+        }
+    }
+
+  SVN_ERR(svn_subst_translate_cstring2(source->data, &result, "\r\n", TRUE,
+                                       keywords, TRUE, pool));
+  SVN_TEST_STRING_ASSERT(result, expected->data);
+
+  /* Without keywords, '$' is just text. */
+  SVN_ERR(svn_subst_translate_cstring2(expected->data, &result, "\r\n",
+                                       FALSE, NULL, FALSE, pool));
+  SVN_TEST_STRING_ASSERT(result, expected->data);
+
+  return SVN_NO_ERROR;
+}
+
 static svn_error_t *
 test_svn_subst_build_keywords3(apr_pool_t *pool)
 {
@@ -513,6 +572,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "test repairing svn_subst_translate_string2()"),
     SVN_TEST_PASS2(test_svn_subst_translate_cstring2,
                    "test svn_subst_translate_cstring2()"),
+    SVN_TEST_PASS2(test_svn_subst_translate_long_runs,
+                   "test translating EOLs and keywords in long runs"),
     SVN_TEST_PASS2(test_svn_subst_build_keywords3,
                    "test svn_subst_build_keywords3()"),
     SVN_TEST_PASS2(test_svn_subst_truncated_keywords,
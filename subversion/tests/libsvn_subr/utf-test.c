@@ -196,13 +196,19 @@ utf_validate2(apr_pool_t *pool)
       apr_size_t len;
 
       /* A random string; experiment shows that it's occasionally (less
-         than 1%) valid but usually invalid. */
+         than 1%) valid but usually invalid.  Every other string is mostly
+         ASCII, so the bulk skipping of ASCII runs gets exercised, too. */
       for (j = 0; j < sizeof(str) - 1; ++j)
-        str[j] = (char)range_rand(0, 255);
+        if (i % 2 && range_rand(0, 9))
+          str[j] = (char)range_rand(1, 127);
+        else
+          str[j] = (char)range_rand(0, 255);
       str[sizeof(str) - 1] = 0;
       len = strlen(str);
 
-      if (svn_utf__last_valid(str, len) != svn_utf__last_valid2(str, len))
+      if (svn_utf__last_valid(str, len) != svn_utf__last_valid2(str, len)
+          || svn_utf__is_valid(str, len) != (svn_utf__last_valid2(str, len)
+                                             == str + len))
         {
           /* Duplicate calls for easy debugging */
           svn_utf__last_valid(str, len);
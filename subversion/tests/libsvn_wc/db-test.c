@@ -34,6 +34,7 @@
 #define SVN_DEPRECATED
 #include "svn_io.h"
 
+#include "svn_config.h"
 #include "svn_dirent_uri.h"
 #include "svn_pools.h"
 
@@ -1525,6 +1526,61 @@ test_externals_store(apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+static svn_error_t *
+test_max_open_wcroots(apr_pool_t *pool)
+{
+  svn_config_t *config;
+  svn_wc__db_t *db;
+  const char *wc_abspath[3];
+  svn_boolean_t own_lock;
+  int i, round;
+
+  SVN_ERR(svn_config_create2(&config, FALSE, FALSE, pool));
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_MAX_OPEN_WORKING_COPIES, "1");
+  svn_config_set(config, SVN_CONFIG_SECTION_WORKING_COPY,
+                 SVN_CONFIG_OPTION_SQLITE_CACHE_SIZE, "256");
+  SVN_ERR(svn_wc__db_open(&db, config, FALSE, TRUE, pool, pool));
+
+  for (i = 0; i < 3; i++)
+    {
+      SVN_ERR(svn_dirent_get_absolute(
+                &wc_abspath[i],
+                svn_dirent_join(svn_test_data_path("db-test", pool),
+                                apr_psprintf(pool, "max_open_wcroots_%d", i),
+                                pool),
+                pool));
+      SVN_ERR(svn_io_remove_dir2(wc_abspath[i], TRUE, NULL, NULL, pool));
+      SVN_ERR(svn_test__create_fake_wc(wc_abspath[i], TESTING_DATA,
+                                       nodes_init_data, actual_init_data,
+                                       pool));
+      svn_test_add_dir_cleanup(wc_abspath[i]);
+    }
+
+  /* A locked working copy stays open. */
+  SVN_ERR(svn_wc__db_wclock_obtain(db, wc_abspath[0], 0, FALSE, pool));
+
+  /* Going back and forth reopens the others. */
+  for (round = 0; round < 2; round++)
+    for (i = 0; i < 3; i++)
+      {
+        svn_node_kind_t kind;
+
+        SVN_ERR(svn_wc__db_read_kind(&kind, db,
+                                     svn_dirent_join(wc_abspath[i], "A",
+                                                     pool),
+                                     FALSE, FALSE, FALSE, pool));
+        SVN_TEST_ASSERT(kind == svn_node_file);
+      }
+
+  SVN_ERR(svn_wc__db_wclock_owns_lock(&own_lock, db, wc_abspath[0], FALSE,
+                                      pool));
+  SVN_TEST_ASSERT(own_lock);
+  SVN_ERR(svn_wc__db_wclock_release(db, wc_abspath[0], pool));
+
+  return SVN_NO_ERROR;
+}
+
 static int max_threads = 2;
 
 static struct svn_test_descriptor_t test_funcs[] =
@@ -1550,6 +1606,8 @@ static struct svn_test_descriptor_t test_funcs[] =
                    "work queue processing"),
     SVN_TEST_PASS2(test_externals_store,
                    "externals store"),
+    SVN_TEST_PASS2(test_max_open_wcroots,
+                   "limiting the number of open working copies"),
     SVN_TEST_NULL
   };
 
@@ -82,6 +82,10 @@ static const int schema_statements[] =
   STMT_CREATE_REVERT_LIST,
   STMT_CREATE_DELETE_LIST,
   STMT_CREATE_UPDATE_MOVE_LIST,
+  /* Shared pristine store */
+  STMT_CREATE_SHARED_PRISTINE_SCHEMA,
+  /* Text hash cache */
+  STMT_CREATE_TEXT_HASH_SCHEMA,
   -1 /* final marker */
 };
 
@@ -105,6 +109,10 @@ static const int slow_statements[] =
 
   /* Designed as slow to avoid penalty on other queries */
   STMT_SELECT_UNREFERENCED_PRISTINES,
+  STMT_SELECT_UNREFERENCED_SHARED_PRISTINES,
+
+  /* Only used by cleanup */
+  STMT_SELECT_SHARED_PRISTINE_WCROOTS,
 
   /* Slow, but just if foreign keys are enabled:
    * STMT_DELETE_PRISTINE_IF_UNREFERENCED,
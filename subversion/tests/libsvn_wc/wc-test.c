@@ -40,9 +40,11 @@
 
 #include "private/svn_wc_private.h"
 #include "private/svn_sqlite.h"
+#include "private/svn_skel.h"
 #include "private/svn_dep_compat.h"
 #include "../../libsvn_wc/wc.h"
 #include "../../libsvn_wc/wc_db.h"
+#include "../../libsvn_wc/workqueue.h"
 #define SVN_WC__I_AM_WC_DB
 #include "../../libsvn_wc/wc_db_private.h"
 
@@ -493,6 +495,297 @@ test_internal_file_modified(const svn_test_opts_t *opts, apr_pool_t *pool)
   return SVN_NO_ERROR;
 }
 
+/* The files of the greek tree, as queued by queue_wq_round(). */
+static const char *wq_files[] = {
+  "iota", "A/mu", "A/B/lambda", "A/B/E/alpha", "A/B/E/beta", "A/D/gamma",
+  "A/D/G/pi", "A/D/G/rho", "A/D/G/tau", "A/D/H/chi", "A/D/H/omega",
+  "A/D/H/psi"
+};
+
+#define WQ_FILE_COUNT ((int)(sizeof(wq_files) / sizeof(wq_files[0])))
+
+/* Queue an install, if INSTALL is set, or else a removal of each file in
+   WQ_FILES in B's working copy. */
+static svn_error_t *
+queue_wq_round(svn_test__sandbox_t *b,
+               svn_boolean_t install)
+{
+  int i;
+
+  for (i = 0; i < WQ_FILE_COUNT; i++)
+    {
+      const char *local_abspath = sbox_wc_path(b, wq_files[i]);
+      svn_skel_t *work_item;
+
+      if (install)
+        SVN_ERR(svn_wc__wq_build_file_install(&work_item, b->wc_ctx->db,
+                                              local_abspath, NULL, FALSE,
+                                              TRUE, b->pool, b->pool));
+      else
+        SVN_ERR(svn_wc__wq_build_file_remove(&work_item, b->wc_ctx->db,
+                                             b->wc_abspath, local_abspath,
+                                             b->pool, b->pool));
+
+      SVN_ERR(svn_wc__db_wq_add(b->wc_ctx->db, b->wc_abspath, work_item,
+                                b->pool));
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Set *WORK_ITEM to a work item that copies SRC_PATH to DST_PATH in B's
+   working copy, translating it like "A/mu". */
+static svn_error_t *
+build_wq_copy(svn_skel_t **work_item,
+              svn_test__sandbox_t *b,
+              const char *src_path,
+              const char *dst_path)
+{
+  return svn_error_trace(svn_wc__wq_build_file_copy_translated(
+                           work_item, b->wc_ctx->db,
+                           sbox_wc_path(b, "A/mu"),
+                           sbox_wc_path(b, src_path),
+                           sbox_wc_path(b, dst_path),
+                           b->pool, b->pool));
+}
+
+/* Set *COUNT to the number of items in the work queue of B. */
+static svn_error_t *
+count_wq_items(int *count,
+               svn_test__sandbox_t *b)
+{
+  apr_array_header_t *ids, *work_items;
+
+  SVN_ERR(svn_wc__db_wq_fetch_items(&ids, &work_items, b->wc_ctx->db,
+                                    b->wc_abspath, 0, 100000, b->pool,
+                                    b->pool));
+  *count = work_items->nelts;
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that PATH in B's working copy has the contents TEXT. */
+static svn_error_t *
+verify_wq_text(svn_test__sandbox_t *b,
+               const char *path,
+               const char *text)
+{
+  svn_stringbuf_t *contents;
+
+  SVN_ERR(svn_stringbuf_from_file2(&contents, sbox_wc_path(b, path),
+                                   b->pool));
+  SVN_TEST_STRING_ASSERT(contents->data, text);
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that each file in WQ_FILES is present in B's working copy with
+   its pristine contents and that its size and timestamp are recorded. */
+static svn_error_t *
+verify_wq_files(svn_test__sandbox_t *b)
+{
+  int i;
+
+  for (i = 0; i < WQ_FILE_COUNT; i++)
+    {
+      const char *local_abspath = sbox_wc_path(b, wq_files[i]);
+      svn_filesize_t recorded_size;
+      apr_time_t recorded_time;
+      const svn_io_dirent2_t *dirent;
+
+      SVN_ERR(verify_wq_text(b, wq_files[i],
+                             apr_psprintf(b->pool, "This is the file '%s'.\n",
+                                          svn_relpath_basename(wq_files[i],
+                                                               NULL))));
+
+      SVN_ERR(svn_wc__db_read_info(NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, &recorded_size,
+                                   &recorded_time, NULL, NULL, NULL, NULL,
+                                   NULL, NULL, NULL, NULL, b->wc_ctx->db,
+                                   local_abspath, b->pool, b->pool));
+      SVN_ERR(svn_io_stat_dirent2(&dirent, local_abspath, FALSE, FALSE,
+                                  b->pool, b->pool));
+      SVN_TEST_INT_ASSERT(recorded_size, dirent->filesize);
+      SVN_TEST_INT_ASSERT(recorded_time, dirent->mtime);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+/* Verify that no file in WQ_FILES is present in B's working copy. */
+static svn_error_t *
+verify_wq_files_removed(svn_test__sandbox_t *b)
+{
+  int i;
+
+  for (i = 0; i < WQ_FILE_COUNT; i++)
+    {
+      svn_node_kind_t kind;
+
+      SVN_ERR(svn_io_check_path(sbox_wc_path(b, wq_files[i]), &kind,
+                                b->pool));
+      SVN_TEST_ASSERT(kind == svn_node_none);
+    }
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_wq_run_batches(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  svn_skel_t *work_item;
+  svn_error_t *err;
+  int i, count;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "wq_run_batches", opts, pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+
+  /* More items than fit into a single batch, ending with installs. */
+  for (i = 0; i < 26; i++)
+    {
+      SVN_ERR(queue_wq_round(&b, i % 2));
+
+      /* A legacy item that modifies wc.db and must run on its own. */
+      if (i == 11)
+        {
+          work_item = svn_skel__make_empty_list(pool);
+          svn_skel__prepend_str("iota", work_item, pool);
+          svn_skel__prepend_str("record-fileinfo", work_item, pool);
+          SVN_ERR(svn_wc__db_wq_add(b.wc_ctx->db, b.wc_abspath, work_item,
+                                    pool));
+        }
+    }
+
+  SVN_ERR(count_wq_items(&count, &b));
+  SVN_TEST_INT_ASSERT(count, 26 * WQ_FILE_COUNT + 1);
+
+  SVN_ERR(svn_wc__wq_run(b.wc_ctx->db, b.wc_abspath, NULL, NULL, pool));
+  SVN_ERR(count_wq_items(&count, &b));
+  SVN_TEST_INT_ASSERT(count, 0);
+  SVN_ERR(verify_wq_files(&b));
+
+  /* A failing item stops the run.  The items before it are completed,
+     the failed one and those after it remain queued. */
+  SVN_ERR(queue_wq_round(&b, FALSE));
+  SVN_ERR(build_wq_copy(&work_item, &b, "wq-src", "wq-dst"));
+  SVN_ERR(svn_wc__db_wq_add(b.wc_ctx->db, b.wc_abspath, work_item, pool));
+  SVN_ERR(queue_wq_round(&b, TRUE));
+
+  err = svn_wc__wq_run(b.wc_ctx->db, b.wc_abspath, NULL, NULL, pool);
+  SVN_TEST_ASSERT(err);
+  svn_error_clear(err);
+
+  SVN_ERR(count_wq_items(&count, &b));
+  SVN_TEST_INT_ASSERT(count, WQ_FILE_COUNT + 1);
+  SVN_ERR(verify_wq_files_removed(&b));
+
+  /* Once the cause is gone, the rest runs exactly as queued. */
+  SVN_ERR(sbox_file_write(&b, "wq-src", "source\n"));
+  SVN_ERR(svn_wc__wq_run(b.wc_ctx->db, b.wc_abspath, NULL, NULL, pool));
+  SVN_ERR(count_wq_items(&count, &b));
+  SVN_TEST_INT_ASSERT(count, 0);
+  SVN_ERR(verify_wq_files(&b));
+  SVN_ERR(verify_wq_text(&b, "wq-dst", "source\n"));
+
+  return SVN_NO_ERROR;
+}
+
+/* Baton for wq_cancel_func(). */
+typedef struct wq_cancel_baton_t
+{
+  /* Number of calls so far. */
+  int calls;
+
+  /* If not 0, cancel this and all later calls. */
+  int cancel_at;
+
+  /* If not 0, queue WORK_ITEM through the separate handle DB in
+     WRI_ABSPATH during this call. */
+  int queue_at;
+  svn_wc__db_t *db;
+  const char *wri_abspath;
+  svn_skel_t *work_item;
+
+  apr_pool_t *pool;
+} wq_cancel_baton_t;
+
+/* Implements svn_cancel_func_t. */
+static svn_error_t *
+wq_cancel_func(void *baton)
+{
+  wq_cancel_baton_t *cb = baton;
+
+  cb->calls++;
+  if (cb->calls == cb->queue_at)
+    SVN_ERR(svn_wc__db_wq_add(cb->db, cb->wri_abspath, cb->work_item,
+                              cb->pool));
+
+  if (cb->cancel_at && cb->calls >= cb->cancel_at)
+    return svn_error_create(SVN_ERR_CANCELLED, NULL, NULL);
+
+  return SVN_NO_ERROR;
+}
+
+static svn_error_t *
+test_wq_run_concurrent_queue(const svn_test_opts_t *opts, apr_pool_t *pool)
+{
+  svn_test__sandbox_t b;
+  wq_cancel_baton_t cb = { 0 };
+  int count;
+
+  SVN_ERR(svn_test__sandbox_create(&b, "wq_run_concurrent_queue", opts,
+                                   pool));
+  SVN_ERR(sbox_add_and_commit_greek_tree(&b));
+  SVN_ERR(sbox_file_write(&b, "wq-src", "source\n"));
+
+  /* Another writer queues an item while a batch is running.  It must not
+     be completed along with that batch without having run. */
+  SVN_ERR(svn_wc__db_open(&cb.db, NULL, FALSE, FALSE, pool, pool));
+  cb.wri_abspath = b.wc_abspath;
+  cb.pool = pool;
+  SVN_ERR(build_wq_copy(&cb.work_item, &b, "wq-src",
+                        "wq-dst1"));
+
+  SVN_ERR(queue_wq_round(&b, FALSE));
+  SVN_ERR(queue_wq_round(&b, TRUE));
+  cb.queue_at = 2;
+  SVN_ERR(svn_wc__wq_run(b.wc_ctx->db, b.wc_abspath, wq_cancel_func, &cb,
+                         pool));
+
+  SVN_ERR(count_wq_items(&count, &b));
+  SVN_TEST_INT_ASSERT(count, 0);
+  SVN_ERR(verify_wq_files(&b));
+  SVN_ERR(verify_wq_text(&b, "wq-dst1", "source\n"));
+
+  /* The same with a cancellation in the middle of a batch.  Everything
+     not completed before must run on the next attempt. */
+  SVN_ERR(build_wq_copy(&cb.work_item, &b, "wq-src",
+                        "wq-dst2"));
+  SVN_ERR(queue_wq_round(&b, FALSE));
+  SVN_ERR(queue_wq_round(&b, TRUE));
+  cb.calls = 0;
+  cb.queue_at = 2;
+  cb.cancel_at = 5;
+  SVN_TEST_ASSERT_ERROR(svn_wc__wq_run(b.wc_ctx->db, b.wc_abspath,
+                                       wq_cancel_func, &cb, pool),
+                        SVN_ERR_CANCELLED);
+
+  SVN_ERR(count_wq_items(&count, &b));
+  SVN_TEST_ASSERT(count > 0 && count <= 2 * WQ_FILE_COUNT + 1);
+
+  SVN_ERR(svn_wc__wq_run(b.wc_ctx->db, b.wc_abspath, NULL, NULL, pool));
+  SVN_ERR(count_wq_items(&count, &b));
+  SVN_TEST_INT_ASSERT(count, 0);
+  SVN_ERR(verify_wq_files(&b));
+  SVN_ERR(verify_wq_text(&b, "wq-dst2", "source\n"));
+
+  SVN_ERR(svn_wc__db_close(cb.db));
+
+  return SVN_NO_ERROR;
+}
+
 /* ---------------------------------------------------------------------- */
 /* The list of test functions */
 
@@ -515,6 +808,10 @@ static struct svn_test_descriptor_t test_funcs[] =
                        "test legacy commit2"),
     SVN_TEST_OPTS_PASS(test_internal_file_modified,
                        "test internal_file_modified"),
+    SVN_TEST_OPTS_PASS(test_wq_run_batches,
+                       "test running the work queue in batches"),
+    SVN_TEST_OPTS_PASS(test_wq_run_concurrent_queue,
+                       "test work items queued while the queue runs"),
     SVN_TEST_NULL
   };
 
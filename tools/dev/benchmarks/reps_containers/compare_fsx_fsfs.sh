@@ -0,0 +1,125 @@
+#!/bin/sh
+
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# usage: compare_fsx_fsfs.sh DUMPFILE [CONTAINER_SIZES]
+#
+# Loads DUMPFILE into a FSFS repository (current format) and into FSX
+# repositories, one per "reps-container-size" in kBytes given in the
+# space-separated list CONTAINER_SIZES (default: "0 1024 4096").  All
+# repositories get packed.  Then, their on-disk sizes get compared as well
+# as the time it takes to export the HEAD revision and to check it out
+# via svnserve.
+#
+# Run it from the root of your working copy and / or adjust the path
+# settings below as needed.
+
+DUMPFILE=$1
+CONTAINER_SIZES=${2:-"0 1024 4096"}
+
+if [ ! -f "${DUMPFILE}" ] ; then
+  echo "usage: $0 DUMPFILE [CONTAINER_SIZES]"
+  exit 1
+fi
+
+# set SVNPATH to the 'subversion' folder of your SVN source code w/c
+
+SVNPATH="$('pwd')/subversion"
+
+SVN=${SVNPATH}/svn/svn
+SVNADMIN=${SVNPATH}/svnadmin/svnadmin
+SVNSERVE=${SVNPATH}/svnserve/svnserve
+
+# set your data paths here
+
+WC=/dev/shm/wc
+REPOROOT=/dev/shm/reps_containers
+
+# number of runs per measurement and server cache size in MB
+
+RUNS=3
+SERVEROPTS="-M 1000"
+PORT=54322
+
+# from here on, we should be good
+
+TIMEFORMAT='%3R  %3U  %3S'
+
+rm -rf $WC $REPOROOT
+mkdir -p $REPOROOT
+
+${SVNSERVE} -dr ${REPOROOT} ${SERVEROPTS} --listen-port ${PORT} --foreground &
+PID=$!
+sleep 1
+
+# create_repo NAME FS-TYPE [CONTAINER_SIZE]
+create_repo() {
+  ${SVNADMIN} create --fs-type $2 $REPOROOT/$1
+  if [ "$3" != "" ] ; then
+    printf "[deltification]\nreps-container-size = $3\n" \
+      >> $REPOROOT/$1/db/fsx.conf
+  fi
+
+  ${SVNADMIN} load -q $REPOROOT/$1 < ${DUMPFILE}
+  ${SVNADMIN} pack -q $REPOROOT/$1
+}
+
+# measure NAME
+measure() {
+  printf "%-16s %10s kB" $1 $( du -sk $REPOROOT/$1/db | cut -f1 )
+
+  # The first run only warms up the caches.
+  printf "\n  export   real   user    sys\n"
+  for i in 0 $( seq 1 $RUNS ) ; do
+    rm -rf $WC
+    if [ $i -eq 0 ] ; then
+      ${SVN} export -q file://$REPOROOT/$1 $WC
+    else
+      printf "         "
+      time ${SVN} export -q file://$REPOROOT/$1 $WC
+    fi
+  done
+
+  printf "  checkout real   user    sys\n"
+  for i in 0 $( seq 1 $RUNS ) ; do
+    rm -rf $WC
+    if [ $i -eq 0 ] ; then
+      ${SVN} co -q svn://localhost:$PORT/$1 $WC
+    else
+      printf "         "
+      time ${SVN} co -q svn://localhost:$PORT/$1 $WC
+    fi
+  done
+}
+
+printf "using "
+${SVN} --version | grep " version"
+echo
+
+create_repo fsfs fsfs
+for size in ${CONTAINER_SIZES} ; do
+  create_repo fsx-$size fsx $size
+done
+
+measure fsfs
+for size in ${CONTAINER_SIZES} ; do
+  measure fsx-$size
+done
+
+kill $PID
+rm -rf $WC $REPOROOT
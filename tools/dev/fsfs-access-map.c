@@ -743,7 +743,10 @@ print_usage(void)
   printf("1 and 2 hits, yellow to read-ish colors for up to 20, shares of\n");
   printf("for up to 100 and black for > 200 hits.\n\n");
   printf("A typical strace invocation looks like this:\n");
-  printf("strace -e trace=open,close,read,lseek -o strace.txt svn log ...\n");
+  printf("strace -e trace=open,close,read,lseek -o strace.txt svn log ...\n\n");
+  printf("FSFS can also record its accesses itself, including item reads,\n");
+  printf("cache misses and latencies.  See the 'trace-file' option in the\n");
+  printf("[debug] section of the repository's db/fsfs.conf.\n");
 }
 
 /* linear control flow */